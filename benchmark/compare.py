@@ -0,0 +1,47 @@
+# Compares two results of cnstream_benchmarks written with --benchmark_out_format=json, e.g. of the baseline and of
+# a change. It only depends on the standard library. The repetitions of a benchmark are averaged.
+#
+# usage: python compare.py baseline.json result.json [threshold]
+#        exits with 1 if any benchmark is slower than the baseline by more than threshold (0.1 by default)
+
+import json
+import sys
+
+_NANOSECONDS = {"ns": 1, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+    with open(path) as f:
+        content = json.load(f)
+    times = {}
+    for bench in content["benchmarks"]:
+        if bench.get("run_type") == "aggregate" or "error_occurred" in bench:
+            continue
+        # the time per iteration in nanoseconds
+        time = bench["real_time"] * _NANOSECONDS[bench.get("time_unit", "ns")]
+        times.setdefault(bench["name"], []).append(time)
+    return {name: sum(values) / len(values) for name, values in times.items()}
+
+
+def compare(baseline, result, threshold):
+    regressions = []
+    width = max([len(name) for name in result] + [9])
+    print("%-*s %14s %14s %8s" % (width, "benchmark", "baseline(ns)", "result(ns)", "change"))
+    for name in sorted(result):
+        if name not in baseline:
+            print("%-*s %14s %14.1f %8s" % (width, name, "-", result[name], "new"))
+            continue
+        change = result[name] / baseline[name] - 1 if baseline[name] else 0
+        print("%-*s %14.1f %14.1f %+7.1f%%" % (width, name, baseline[name], result[name], change * 100))
+        if change > threshold:
+            regressions.append(name)
+    return regressions
+
+
+if __name__ == "__main__":
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 0.1
+    regressions = compare(load(sys.argv[1]), load(sys.argv[2]), threshold)
+    if regressions:
+        print("%d benchmarks are slower by more than %d%%: %s" % (len(regressions), threshold * 100,
+                                                                    ", ".join(regressions)))
+        sys.exit(1)
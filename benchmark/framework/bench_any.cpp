@@ -0,0 +1,95 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util/cnstream_any.hpp"
+
+namespace cnstream {
+
+// int and shared_ptr fit in the buffer of any, copying the vector allocates
+static void BM_AnyConstruct_Int(benchmark::State& state) {
+  for (auto _ : state) {
+    any value(1);
+    benchmark::DoNotOptimize(value);
+  }
+}
+BENCHMARK(BM_AnyConstruct_Int);
+
+static void BM_AnyConstruct_SharedPtr(benchmark::State& state) {
+  auto ptr = std::make_shared<int>(1);
+  for (auto _ : state) {
+    any value(ptr);
+    benchmark::DoNotOptimize(value);
+  }
+}
+BENCHMARK(BM_AnyConstruct_SharedPtr);
+
+static void BM_AnyConstruct_Vector(benchmark::State& state) {
+  std::vector<float> vec(16);
+  for (auto _ : state) {
+    any value(vec);
+    benchmark::DoNotOptimize(value);
+  }
+}
+BENCHMARK(BM_AnyConstruct_Vector);
+
+// the data is moved into the collection of the frame
+static void BM_AnyMove_SharedPtr(benchmark::State& state) {
+  auto ptr = std::make_shared<int>(1);
+  for (auto _ : state) {
+    any value(ptr);
+    any moved(std::move(value));
+    benchmark::DoNotOptimize(moved);
+  }
+}
+BENCHMARK(BM_AnyMove_SharedPtr);
+
+static void BM_AnyCast_Pointer(benchmark::State& state) {
+  any value(std::make_shared<int>(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(any_cast<std::shared_ptr<int>>(&value));
+  }
+}
+BENCHMARK(BM_AnyCast_Pointer);
+
+static void BM_AnyCast_Reference(benchmark::State& state) {
+  any value(std::make_shared<int>(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(&any_cast<std::shared_ptr<int>&>(value));
+  }
+}
+BENCHMARK(BM_AnyCast_Reference);
+
+// a failed cast by pointer returns nullptr, as the modules check optional data
+static void BM_AnyCast_Mismatch(benchmark::State& state) {
+  any value(std::make_shared<int>(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(any_cast<std::string>(&value));
+  }
+}
+BENCHMARK(BM_AnyCast_Mismatch);
+
+}  // namespace cnstream
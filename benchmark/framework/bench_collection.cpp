@@ -0,0 +1,108 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_collection.hpp"
+
+namespace cnstream {
+
+static constexpr CollectionSlot<std::shared_ptr<int>> kBenchSlot("BenchData", kCollectionSlotNum - 1);
+static const bool bench_slot_registered = Collection::RegisterSlot(kBenchSlot);
+
+static std::vector<std::string> MakeTags(size_t num) {
+  std::vector<std::string> tags;
+  for (size_t i = 0; i < num; ++i) tags.push_back("tag_" + std::to_string(i));
+  return tags;
+}
+
+// A frame collects the results of the modules, the collection is created and filled once per frame.
+static void BM_CollectionAdd(benchmark::State& state) {
+  const std::vector<std::string> tags = MakeTags(state.range(0));
+  auto value = std::make_shared<int>(0);
+  for (auto _ : state) {
+    Collection collection;
+    for (const auto& tag : tags) collection.Add(tag, value);
+  }
+  state.SetItemsProcessed(state.iterations() * tags.size());
+}
+BENCHMARK(BM_CollectionAdd)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_CollectionAddSlot(benchmark::State& state) {
+  auto value = std::make_shared<int>(0);
+  for (auto _ : state) {
+    Collection collection;
+    collection.Add(kBenchSlot, value);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["registered"] = bench_slot_registered;
+}
+BENCHMARK(BM_CollectionAddSlot);
+
+static Collection g_collection;
+
+static void FillCollection(const benchmark::State&) {
+  if (g_collection.HasValue("tag_0")) return;
+  for (const auto& tag : MakeTags(16)) g_collection.Add(tag, std::make_shared<int>(0));
+  g_collection.Add(kBenchSlot, std::make_shared<int>(0));
+}
+
+// The modules of a frame read the collection from their own threads.
+static void BM_CollectionGet(benchmark::State& state) {
+  const std::string tag = "tag_7";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(g_collection.Get<std::shared_ptr<int>>(tag));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CollectionGet)->Setup(FillCollection)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_CollectionGetSlot(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(g_collection.Get(kBenchSlot));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CollectionGetSlot)->Setup(FillCollection)->ThreadRange(1, 8)->UseRealTime();
+
+// The modules not updated to the slots still read the value of a slot by its tag.
+static void BM_CollectionGetSlotByTag(benchmark::State& state) {
+  const std::string tag = "BenchData";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(g_collection.Get<std::shared_ptr<int>>(tag));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CollectionGetSlotByTag)->Setup(FillCollection)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_CollectionHasValue(benchmark::State& state) {
+  const std::string tag = "tag_missing";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(g_collection.HasValue(tag));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CollectionHasValue)->Setup(FillCollection)->ThreadRange(1, 8)->UseRealTime();
+
+}  // namespace cnstream
@@ -0,0 +1,76 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <memory>
+
+#include "cnstream_frame.hpp"
+#include "conveyor.hpp"
+
+namespace cnstream {
+
+// shared by the threads of a run, created before the threads start
+static std::unique_ptr<Conveyor> g_conveyor;
+
+template <typename ConveyorT>
+static void CreateConveyor(const benchmark::State&) { g_conveyor.reset(new ConveyorT(256)); }
+
+static void DestroyConveyor(const benchmark::State&) { g_conveyor.reset(); }
+
+// Every thread pushes a frame and pops one, so the pops never wait and the cost is the one of the synchronization.
+static void BM_ConveyorPushPop(benchmark::State& state) {
+  CNFrameInfoPtr data = CNFrameInfo::Create("stream");
+  for (auto _ : state) {
+    g_conveyor->PushDataBuffer(data);
+    benchmark::DoNotOptimize(g_conveyor->TryPopDataBuffer());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConveyorPushPop)
+    ->Name("BM_ConveyorPushPop<Conveyor>")
+    ->Setup(CreateConveyor<Conveyor>)
+    ->Teardown(DestroyConveyor)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+BENCHMARK(BM_ConveyorPushPop)
+    ->Name("BM_ConveyorPushPop<LockFreeConveyor>")
+    ->Setup(CreateConveyor<LockFreeConveyor>)
+    ->Teardown(DestroyConveyor)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// Pops in batches as the modules with a batch size do.
+template <typename ConveyorT>
+static void BM_ConveyorPopBatch(benchmark::State& state) {
+  const size_t batch_size = state.range(0);
+  ConveyorT conveyor(batch_size);
+  CNFrameInfoPtr data = CNFrameInfo::Create("stream");
+  for (auto _ : state) {
+    for (size_t i = 0; i < batch_size; ++i) conveyor.PushDataBuffer(data);
+    benchmark::DoNotOptimize(conveyor.PopDataBuffers(batch_size, std::chrono::microseconds(0)));
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK_TEMPLATE(BM_ConveyorPopBatch, Conveyor)->Arg(4)->Arg(16);
+BENCHMARK_TEMPLATE(BM_ConveyorPopBatch, LockFreeConveyor)->Arg(4)->Arg(16);
+
+}  // namespace cnstream
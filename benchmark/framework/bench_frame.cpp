@@ -0,0 +1,59 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_frame_pool.hpp"
+
+namespace cnstream {
+
+static void BM_FrameCreate(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(CNFrameInfo::Create("stream"));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrameCreate)->ThreadRange(1, 8)->UseRealTime();
+
+// the frame is released right away, so it is reused by the next iteration
+static void BM_FramePoolCreate(benchmark::State& state) {
+  CNFrameInfoPool pool(16);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pool.Create("stream"));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FramePoolCreate);
+
+static void BM_FrameCreateWithData(benchmark::State& state) {
+  auto value = std::make_shared<int>(0);
+  for (auto _ : state) {
+    std::shared_ptr<CNFrameInfo> frame = CNFrameInfo::Create("stream");
+    frame->collection.Add("data", value);
+    benchmark::DoNotOptimize(frame);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrameCreateWithData);
+
+}  // namespace cnstream
@@ -0,0 +1,54 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "private/cnstream_parallel.hpp"
+
+namespace cnstream {
+
+// A memory-bound row-wise job like color conversion on a 4K BGR image, on the calling thread only (threads:0) and
+// in bands on the shared pool.
+static void BM_ParallelFor_RowJob(benchmark::State& state) {
+  const int width = 3840 * 3, height = 2160;
+  std::vector<uint8_t> src(width * height, 1), dst(width * height, 0);
+  auto job = [&](int begin, int end) {
+    for (int r = begin; r < end; ++r) {
+      const uint8_t* s = src.data() + r * width;
+      uint8_t* d = dst.data() + r * width;
+      for (int c = 0; c < width; ++c) d[c] = static_cast<uint8_t>(s[c] * 3 + (c >> 4));
+    }
+  };
+  const int thread_num = GetParallelThreadNum();
+  if (state.range(0) >= 0) SetParallelThreadNum(state.range(0));
+  for (auto _ : state) {
+    ParallelFor(height, 256, 2, job);
+    benchmark::DoNotOptimize(dst.data());
+  }
+  SetParallelThreadNum(thread_num);
+  state.SetBytesProcessed(state.iterations() * src.size());
+}
+// -1 keeps the default number of the pool threads
+BENCHMARK(BM_ParallelFor_RowJob)->ArgName("threads")->Arg(0)->Arg(-1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace cnstream
@@ -0,0 +1,119 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_module.hpp"
+#include "cnstream_pipeline.hpp"
+
+namespace cnstream {
+
+class BenchNullModule : public Module, public ModuleCreator<BenchNullModule> {
+ public:
+  explicit BenchNullModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override { return 0; }
+};  // class BenchNullModule
+
+// A chain of null modules, the cost per frame is the one of the framework passing the frame to the next module.
+class NullGraph {
+ public:
+  explicit NullGraph(int module_num) : pipeline_("bench_pipeline") {
+    std::vector<CNModuleConfig> configs(module_num);
+    for (int i = 0; i < module_num; ++i) {
+      configs[i].name = "module" + std::to_string(i);
+      configs[i].className = "cnstream::BenchNullModule";
+      configs[i].parallelism = 1;
+      configs[i].maxInputQueueSize = 20;
+      if (i + 1 < module_num) configs[i].next = {"module" + std::to_string(i + 1)};
+    }
+    ok_ = pipeline_.BuildPipeline(configs);
+    pipeline_.RegisterFrameDoneCallBack([this](std::shared_ptr<CNFrameInfo> data) {
+      std::lock_guard<std::mutex> lk(mtx_);
+      ++done_num_;
+      cond_.notify_one();
+    });
+    ok_ = ok_ && pipeline_.Start();
+    head_ = pipeline_.GetModule("module0");
+  }
+  ~NullGraph() { pipeline_.Stop(); }
+
+  bool IsOk() const { return ok_ && head_; }
+
+  void Provide(int64_t ts) {
+    auto data = CNFrameInfo::Create("stream");
+    data->SetStreamIndex(0);
+    data->timestamp = ts;
+    pipeline_.ProvideData(head_, data);
+  }
+
+  void WaitDone(int64_t num) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    cond_.wait(lk, [&] { return done_num_ >= num; });
+  }
+
+ private:
+  Pipeline pipeline_;
+  Module* head_ = nullptr;
+  bool ok_ = false;
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  int64_t done_num_ = 0;
+};  // class NullGraph
+
+// frames are provided back to back, the queues are kept full
+static void BM_TransmitDataThroughput(benchmark::State& state) {
+  NullGraph graph(state.range(0));
+  if (!graph.IsOk()) {
+    state.SkipWithError("failed to start the pipeline");
+    return;
+  }
+  int64_t num = 0;
+  for (auto _ : state) graph.Provide(num++);
+  graph.WaitDone(num);
+  state.SetItemsProcessed(num);
+}
+BENCHMARK(BM_TransmitDataThroughput)->RangeMultiplier(4)->Range(1, 16)->UseRealTime();
+
+// a frame is provided after the previous one is done
+static void BM_TransmitDataLatency(benchmark::State& state) {
+  NullGraph graph(state.range(0));
+  if (!graph.IsOk()) {
+    state.SkipWithError("failed to start the pipeline");
+    return;
+  }
+  int64_t num = 0;
+  for (auto _ : state) {
+    graph.Provide(num++);
+    graph.WaitDone(num);
+  }
+  state.SetItemsProcessed(num);
+}
+BENCHMARK(BM_TransmitDataLatency)->RangeMultiplier(4)->Range(1, 16)->UseRealTime();
+
+}  // namespace cnstream
@@ -0,0 +1,80 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "detection_postproc.hpp"
+
+namespace cnstream {
+
+// candidates of 80 classes, e.g. the proposals of yolo networks
+static std::vector<DetectionBox> RandomBoxes(size_t num, int class_num, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> pos(0, 0.9), size(0.02, 0.1), score(0, 1);
+  std::uniform_int_distribution<int> label(0, class_num - 1);
+  std::vector<DetectionBox> boxes(num);
+  for (auto& box : boxes) {
+    box.label = label(gen);
+    box.score = score(gen);
+    box.left = pos(gen);
+    box.top = pos(gen);
+    box.right = box.left + size(gen);
+    box.bottom = box.top + size(gen);
+  }
+  return boxes;
+}
+
+static void BM_Nms(benchmark::State& state) {
+  const std::vector<DetectionBox> boxes = RandomBoxes(state.range(0), 80, 1);
+  for (auto _ : state) {
+    std::vector<DetectionBox> kept = boxes;
+    Nms(&kept, 0.45);
+    benchmark::DoNotOptimize(kept.data());
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_Nms)->ArgName("boxes")->Arg(200)->Arg(2000)->Unit(benchmark::kMicrosecond);
+
+// all pairs are compared without partitioning by the class, the baseline of BM_Nms
+static void BM_NmsAllPairs(benchmark::State& state) {
+  const std::vector<DetectionBox> boxes = RandomBoxes(state.range(0), 80, 1);
+  for (auto _ : state) {
+    std::vector<DetectionBox> sorted = boxes;
+    std::sort(sorted.begin(), sorted.end(), [](const DetectionBox& a, const DetectionBox& b) {
+      return a.score > b.score;
+    });
+    std::vector<bool> suppressed(sorted.size(), false);
+    for (size_t m = 0; m < sorted.size(); ++m) {
+      if (suppressed[m]) continue;
+      for (size_t n = m + 1; n < sorted.size(); ++n) {
+        if (sorted[m].label == sorted[n].label && IoU(sorted[m], sorted[n]) > 0.45) suppressed[n] = true;
+      }
+    }
+    benchmark::DoNotOptimize(suppressed);
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_NmsAllPairs)->ArgName("boxes")->Arg(200)->Arg(2000)->Unit(benchmark::kMicrosecond);
+
+}  // namespace cnstream
@@ -0,0 +1,102 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "feature_extractor.hpp"
+
+namespace cnstream {
+
+static constexpr int kWidth = 1920;
+static constexpr int kHeight = 1080;
+
+// a crowded 1080p frame, 64 objects on a random BGR image
+static CNFrameInfoPtr CreateCrowdedFrame(cv::Mat* img) {
+  img->create(kHeight, kWidth, CV_8UC3);
+  cv::randu(*img, cv::Scalar::all(0), cv::Scalar::all(255));
+  auto data = CNFrameInfo::Create("0");
+  std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+  frame->width = kWidth;
+  frame->height = kHeight;
+  frame->stride[0] = kWidth;
+  frame->ctx.dev_type = DevContext::DevType::CPU;
+  frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_BGR24;
+  void* ptr_cpu[1] = {img->data};
+  frame->CopyToSyncMem(ptr_cpu, false);
+  std::shared_ptr<CNInferObjs> objs_holder = std::make_shared<CNInferObjs>();
+  for (int i = 0; i < 64; ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = "0";
+    obj->bbox = {(i % 16) / 16.f, (i / 16) / 4.f, 1 / 16.f, 1 / 4.f};
+    objs_holder->objs_.push_back(obj);
+  }
+  data->collection.Add(kCNDataFrameTag, frame);
+  data->collection.Add(kCNInferObjsTag, objs_holder);
+  return data;
+}
+
+static void BM_FeatureExtractorCpu(benchmark::State& state) {
+  cv::Mat img;
+  CNFrameInfoPtr data = CreateCrowdedFrame(&img);
+  FeatureExtractor extractor([](const CNFrameInfoPtr, bool) {});
+  for (auto _ : state) {
+    if (!extractor.ExtractFeature(data)) {
+      state.SkipWithError("failed to extract the features");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_FeatureExtractorCpu)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// the baseline of BM_FeatureExtractorCpu, a new ORB on the BGR crop of each object
+static void BM_OrbPerObject(benchmark::State& state) {
+  cv::Mat img;
+  CNFrameInfoPtr data = CreateCrowdedFrame(&img);
+  CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+  CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+  for (auto _ : state) {
+    const cv::Mat image = frame->ImageBGR();
+    for (auto& obj : objs_holder->objs_) {
+      cv::Rect rect(obj->bbox.x * kWidth, obj->bbox.y * kHeight, obj->bbox.w * kWidth, obj->bbox.h * kHeight);
+#if (CV_MAJOR_VERSION == 2)
+      cv::Ptr<cv::ORB> processer = new cv::ORB(512);
+#else
+      cv::Ptr<cv::ORB> processer = cv::ORB::create(512);
+#endif
+      std::vector<cv::KeyPoint> keypoints;
+      cv::Mat desc;
+      processer->detect(image(rect), keypoints);
+      processer->compute(image(rect), keypoints, desc);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * objs_holder->objs_.size());
+}
+BENCHMARK(BM_OrbPerObject)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace cnstream
@@ -0,0 +1,86 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "private/cnstream_parallel.hpp"
+
+namespace cnstream {
+
+static const int kFormats[] = {static_cast<int>(CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12),
+                               static_cast<int>(CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21),
+                               static_cast<int>(CNDataFormat::CN_PIXEL_FORMAT_BGR24),
+                               static_cast<int>(CNDataFormat::CN_PIXEL_FORMAT_RGB24)};
+static const int kHeights[] = {720, 1080, 2160};
+
+static void FormatArgs(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({"fmt", "height"});
+  for (int fmt : kFormats) {
+    for (int height : kHeights) bench->Args({fmt, height});
+  }
+}
+
+// The frame caches the image, so a new frame holding the same pixels is created out of the timing for each call.
+// BGR24 without padding is not converted, it measures the cost of wrapping the planes.
+static void BM_ImageBGR(benchmark::State& state) {
+  const CNDataFormat fmt = static_cast<CNDataFormat>(state.range(0));
+  const int height = state.range(1);
+  const int width = height * 16 / 9;
+  const bool yuv = fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 || fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21;
+  std::vector<uint8_t> pixels(yuv ? width * height * 3 / 2 : width * height * 3);
+  for (size_t i = 0; i < pixels.size(); ++i) pixels[i] = static_cast<uint8_t>(i * 7);
+  void* planes[2] = {pixels.data(), pixels.data() + width * height};
+  for (auto _ : state) {
+    state.PauseTiming();
+    CNDataFrame frame;
+    frame.ctx.dev_type = DevContext::DevType::CPU;
+    frame.fmt = fmt;
+    frame.width = width;
+    frame.height = height;
+    frame.stride[0] = frame.stride[1] = width;
+    frame.CopyToSyncMem(planes, false);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(frame.ImageBGR().data);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * pixels.size());
+}
+BENCHMARK(BM_ImageBGR)->Apply(FormatArgs)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Large YUV frames are converted in bands on the shared pool, compared with BM_ImageBGR, this one converts them on
+// the calling thread only.
+static void BM_ImageBGR_SingleThread(benchmark::State& state) {
+  const int thread_num = GetParallelThreadNum();
+  SetParallelThreadNum(0);
+  BM_ImageBGR(state);
+  SetParallelThreadNum(thread_num);
+}
+BENCHMARK(BM_ImageBGR_SingleThread)
+    ->ArgNames({"fmt", "height"})
+    ->Args({static_cast<int>(CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12), 1080})
+    ->Args({static_cast<int>(CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12), 2160})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+}  // namespace cnstream
@@ -0,0 +1,142 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_infer_objs_codec.hpp"
+
+namespace cnstream {
+
+// 100 objects per frame, each with two attributes and an extra attribute
+static CNObjsVec CreateObjs(int num) {
+  CNObjsVec objs;
+  for (int i = 0; i < num; ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = std::to_string(i % 80);
+    obj->track_id = std::to_string(i);
+    obj->score = 0.5f + i * 0.001f;
+    obj->bbox.x = 0.1f;
+    obj->bbox.y = 0.2f + i * 0.0001f;
+    obj->bbox.w = 0.3f;
+    obj->bbox.h = 0.4f;
+    CNInferAttr attr;
+    attr.id = 1;
+    attr.value = i % 10;
+    attr.score = 0.9f;
+    obj->AddAttribute("color", attr);
+    attr.id = 2;
+    attr.value = -1;
+    attr.score = 0.8f;
+    obj->AddAttribute("type", attr);
+    obj->AddExtraAttribute("plate", "A12345");
+    objs.push_back(obj);
+  }
+  return objs;
+}
+
+static void BM_InferObjsEncode(benchmark::State& state) {
+  const CNObjsVec objs = CreateObjs(100);
+  std::string buffer;
+  uint64_t frame_id = 0;
+  for (auto _ : state) {
+    buffer.clear();
+    InferObjsCodec::Encode("stream_0", frame_id, frame_id, objs, 0, &buffer);
+    ++frame_id;
+  }
+  state.counters["bytes"] = buffer.size();
+  state.SetItemsProcessed(state.iterations() * objs.size());
+}
+BENCHMARK(BM_InferObjsEncode)->Unit(benchmark::kMicrosecond);
+
+static void BM_InferObjsDecode(benchmark::State& state) {
+  std::string buffer;
+  InferObjsCodec::Encode("stream_0", 0, 0, CreateObjs(100), 0, &buffer);
+  InferObjsCodec::Frame frame;
+  for (auto _ : state) {
+    if (!InferObjsCodec::Decode(buffer.data(), buffer.size(), &frame)) {
+      state.SkipWithError("failed to decode the objects");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * frame.objs.size());
+}
+BENCHMARK(BM_InferObjsDecode)->Unit(benchmark::kMicrosecond);
+
+// the baseline of BM_InferObjsEncode, the JSON written by the kafka handlers
+static void BM_InferObjsEncodeJson(benchmark::State& state) {
+  const CNObjsVec objs = CreateObjs(100);
+  const std::string stream_id = "stream_0";
+  rapidjson::StringBuffer json;
+  rapidjson::Writer<rapidjson::StringBuffer> writer;
+  uint64_t frame_id = 0;
+  for (auto _ : state) {
+    json.Clear();
+    writer.Reset(json);
+    writer.StartObject();
+    writer.Key("StreamName");
+    writer.String(stream_id.c_str(), static_cast<rapidjson::SizeType>(stream_id.length()));
+    writer.Key("FrameCount");
+    writer.Uint64(frame_id++);
+    writer.Key("Objects");
+    writer.StartArray();
+    for (const auto& obj : objs) {
+      writer.StartObject();
+      writer.Key("Label");
+      writer.String(obj->id.c_str(), static_cast<rapidjson::SizeType>(obj->id.length()));
+      writer.Key("TrackId");
+      writer.String(obj->track_id.c_str(), static_cast<rapidjson::SizeType>(obj->track_id.length()));
+      writer.Key("Score");
+      writer.Double(obj->score);
+      writer.Key("BBox");
+      writer.StartArray();
+      writer.Double(obj->bbox.x);
+      writer.Double(obj->bbox.y);
+      writer.Double(obj->bbox.w);
+      writer.Double(obj->bbox.h);
+      writer.EndArray();
+      writer.Key("Attributes");
+      writer.StartObject();
+      for (const auto& attr : obj->GetAttributes()) {
+        writer.Key(attr.first.c_str(), static_cast<rapidjson::SizeType>(attr.first.length()));
+        writer.StartArray();
+        writer.Int(attr.second.id);
+        writer.Int(attr.second.value);
+        writer.Double(attr.second.score);
+        writer.EndArray();
+      }
+      writer.EndObject();
+      writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+  }
+  state.counters["bytes"] = json.GetSize();
+  state.SetItemsProcessed(state.iterations() * objs.size());
+}
+BENCHMARK(BM_InferObjsEncodeJson)->Unit(benchmark::kMicrosecond);
+
+}  // namespace cnstream
@@ -0,0 +1,99 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "scaler/scaler.hpp"
+
+namespace cnstream {
+
+static Scaler::Buffer AllocScalerBuffer(Scaler::ColorFormat color, uint32_t width, uint32_t height,
+                                        std::vector<uint8_t>* data) {
+  Scaler::Buffer buffer = Scaler::Buffer();
+  buffer.width = width;
+  buffer.height = height;
+  buffer.color = color;
+  if (color <= Scaler::ColorFormat::YUV_NV21) {
+    data->resize(width * height * 3 / 2);
+    buffer.data[0] = data->data();
+    buffer.stride[0] = width;
+    buffer.data[1] = buffer.data[0] + width * height;
+    if (color == Scaler::ColorFormat::YUV_I420) {
+      buffer.stride[1] = buffer.stride[2] = width / 2;
+      buffer.data[2] = buffer.data[1] + width * height / 4;
+    } else {
+      buffer.stride[1] = width;
+    }
+  } else {
+    uint32_t bytes_in_pixel = color <= Scaler::ColorFormat::RGB ? 3 : 4;
+    data->resize(width * height * bytes_in_pixel);
+    buffer.data[0] = data->data();
+    buffer.stride[0] = width * bytes_in_pixel;
+  }
+  return buffer;
+}
+
+static void ScalerArgs(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({"carrier", "src", "dst"});
+  // the conversions of the encoder: decoded frames and bgr images to yuv, with and without resizing
+  const int conversions[][2] = {{Scaler::ColorFormat::YUV_NV12, Scaler::ColorFormat::YUV_NV12},
+                                {Scaler::ColorFormat::YUV_NV21, Scaler::ColorFormat::YUV_I420},
+                                {Scaler::ColorFormat::BGR, Scaler::ColorFormat::YUV_NV12},
+                                {Scaler::ColorFormat::BGR, Scaler::ColorFormat::BGR}};
+  for (int carrier = Scaler::Carrier::OPENCV; carrier <= Scaler::Carrier::FFMPEG; ++carrier) {
+    for (const auto& conversion : conversions) bench->Args({carrier, conversion[0], conversion[1]});
+  }
+}
+
+// 1080p to 720p
+static void BM_ScalerProcess(benchmark::State& state) {
+  const int carrier = state.range(0);
+  std::vector<uint8_t> src_data, dst_data;
+  Scaler::Buffer src = AllocScalerBuffer(static_cast<Scaler::ColorFormat>(state.range(1)), 1920, 1080, &src_data);
+  Scaler::Buffer dst = AllocScalerBuffer(static_cast<Scaler::ColorFormat>(state.range(2)), 1280, 720, &dst_data);
+  for (size_t i = 0; i < src_data.size(); ++i) src_data[i] = static_cast<uint8_t>(i * 7);
+  for (auto _ : state) {
+    if (!Scaler::Process(&src, &dst, nullptr, nullptr, carrier)) {
+      state.SkipWithError("the conversion is not supported by the carrier");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * src_data.size());
+}
+BENCHMARK(BM_ScalerProcess)->Apply(ScalerArgs)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// all the conversions of each carrier, to choose the carrier of a conversion
+static void AllScalerArgs(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({"carrier", "src", "dst"});
+  for (int carrier = Scaler::Carrier::OPENCV; carrier <= Scaler::Carrier::FFMPEG; ++carrier) {
+    for (int src = 0; src < Scaler::ColorFormat::COLOR_MAX; ++src) {
+      for (int dst = 0; dst < Scaler::ColorFormat::COLOR_MAX; ++dst) bench->Args({carrier, src, dst});
+    }
+  }
+}
+
+static void BM_ScalerProcess_AllFormats(benchmark::State& state) { BM_ScalerProcess(state); }
+BENCHMARK(BM_ScalerProcess_AllFormats)->Apply(AllScalerArgs)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+}  // namespace cnstream
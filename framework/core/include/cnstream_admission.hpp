@@ -0,0 +1,174 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_ADMISSION_HPP_
+#define CNSTREAM_ADMISSION_HPP_
+
+/**
+ *  @file cnstream_admission.hpp
+ *
+ *  This file contains a declaration of the AdmissionController class.
+ */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "cnstream_common.hpp"
+#include "cnstream_config.hpp"
+
+namespace cnstream {
+
+/**
+ * @struct AdmissionSample
+ *
+ * @brief AdmissionSample is the state of a pipeline sampled by the admission controller.
+ */
+struct AdmissionSample {
+  bool overloaded = false;        ///< Whether the input queues of a module are full, see AdmissionConfig.
+  uint64_t completed_frames = 0;  ///< The frames completed by the pipeline since it started.
+};
+
+/**
+ * @struct AdmissionStreamState
+ *
+ * @brief AdmissionStreamState is the state of a stream kept by the admission controller.
+ */
+struct AdmissionStreamState {
+  double weight = 1;        ///< The weight of the stream, see AdmissionController::SetWeight.
+  double offered_fps = 0;   ///< The frame rate sent by the source in the latest sample.
+  double allowed_fps = -1;  ///< The frame rate admitted. A negative value means no limit.
+  uint64_t admitted = 0;    ///< The frames admitted.
+  uint64_t rejected = 0;    ///< The frames rejected.
+};
+
+/**
+ * @class AdmissionController
+ *
+ * @brief AdmissionController limits the frame rates of the streams sent by the source modules, so that an overloaded
+ * pipeline degrades all streams fairly instead of the ones whose threads happen to wake up late.
+ *
+ * Each sample, the capacity of the pipeline is adjusted (multiplicative decrease when overloaded, multiplicative
+ * increase otherwise) and shared by the streams by weighted max-min fairness. Each stream has a token bucket refilled
+ * at its share, a frame is admitted if it takes a token. See AdmissionConfig.
+ *
+ * Pipeline creates an admission controller when ``admission_config`` is enabled.
+ */
+class AdmissionController : private NonCopyable {
+ public:
+  /**
+   * @brief Gets the state of the pipeline.
+   */
+  using SampleFunc = std::function<AdmissionSample()>;
+
+  /**
+   * @brief Constructs an admission controller.
+   *
+   * @param[in] config The configuration of the admission controller.
+   */
+  explicit AdmissionController(const AdmissionConfig& config);
+  /**
+   * @brief Stops the admission controller.
+   */
+  ~AdmissionController();
+  /**
+   * @brief Starts a thread sampling the pipeline every ``interval_ms`` and updating the shares of the streams.
+   *
+   * @param[in] sample_func The function getting the state of the pipeline.
+   *
+   * @return Returns true if the controller is started. Otherwise, returns false.
+   */
+  bool Start(SampleFunc sample_func);
+  /**
+   * @brief Stops the sampling thread. The frames are admitted without limit once it is stopped.
+   */
+  void Stop();
+  /**
+   * @brief Checks whether a frame of a stream is admitted. It is called by the source modules for each frame.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] now The time the frame is sent.
+   *
+   * @return Returns true if the frame is admitted, or false if it should be dropped.
+   */
+  bool Admit(const std::string& stream_id, std::chrono::steady_clock::time_point now);
+  bool Admit(const std::string& stream_id) { return Admit(stream_id, std::chrono::steady_clock::now()); }
+  /**
+   * @brief Sets the weight of a stream. A stream with a larger weight gets a larger share of the capacity, the
+   * default weight is 1.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] weight The weight, must be greater than 0.
+   *
+   * @return Returns false if the weight is not valid.
+   */
+  bool SetWeight(const std::string& stream_id, double weight);
+  /**
+   * @brief Forgets a stream, e.g. after its EOS.
+   *
+   * @param[in] stream_id The stream identification.
+   */
+  void RemoveStream(const std::string& stream_id);
+  /**
+   * @brief Updates the capacity and the shares of the streams from one sample of the pipeline.
+   *
+   * @param[in] overloaded Whether the pipeline is overloaded.
+   * @param[in] completed_fps The frame rate completed by the pipeline since the last sample.
+   * @param[in] elapsed_s The seconds since the last sample.
+   */
+  void Update(bool overloaded, double completed_fps, double elapsed_s);
+  /**
+   * @brief Gets the capacity shared by the streams, in frames per second. A negative value means no limit.
+   */
+  double GetCapacity() const;
+  /**
+   * @brief Gets the states of the streams, keyed by the stream identification.
+   */
+  std::map<std::string, AdmissionStreamState> GetStreamStates() const;
+
+ private:
+  struct StreamState {
+    AdmissionStreamState state;
+    uint64_t offered = 0;  // the frames sent since the last sample
+    double tokens = 0;
+    std::chrono::steady_clock::time_point refill_time;
+  };
+  void Loop();
+  // the share of a stream whose frame rate is not measured yet, called with mtx_ locked
+  double DefaultShare(double weight) const;
+
+  AdmissionConfig config_;
+  SampleFunc sample_func_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  std::mutex exit_mtx_;
+  std::condition_variable exit_cond_;
+  mutable std::mutex mtx_;  // guards the members below
+  double capacity_ = -1;
+  std::map<std::string, StreamState> streams_;
+};  // class AdmissionController
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_ADMISSION_HPP_
@@ -0,0 +1,318 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_ASYNC_IO_HPP_
+#define CNSTREAM_ASYNC_IO_HPP_
+
+/**
+ *  @file cnstream_async_io.hpp
+ *
+ *  This file contains the declarations of the IoRing, the AsyncFileReader and the AsyncFileWriter class.
+ */
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+/**
+ * @class IoRing
+ *
+ * @brief IoRing submits file reads and writes to an io_uring instance of the kernel, so that the submitting threads
+ * do not block in the system calls. The completions are reaped by a thread of the ring, which calls the callbacks of
+ * the requests.
+ *
+ * If io_uring is not supported, e.g. by an old kernel or by the seccomp policy of a container, the requests are done
+ * by ``pread`` and ``pwrite`` in the submitting thread, and the callbacks are called before the submission returns.
+ */
+class IoRing : private NonCopyable {
+ public:
+  /**
+   * @brief The callback of a request, called with the bytes transferred or a negative errno.
+   */
+  using Callback = std::function<void(int64_t result)>;
+  /**
+   * @brief Constructor.
+   *
+   * @param[in] entries The maximum number of requests in flight, rounded up to a power of 2 by the kernel.
+   * @param[in] enable Whether to use io_uring. If it is false, the requests are done synchronously.
+   */
+  explicit IoRing(uint32_t entries = 256, bool enable = true);
+  /**
+   * @brief Destructor, waits for the requests in flight.
+   */
+  ~IoRing();
+  /**
+   * @brief Gets the ring shared by the whole process. io_uring is not used if the environment variable
+   * CNSTREAM_IO_URING is set to false.
+   */
+  static IoRing& Instance();
+  /**
+   * @brief Checks whether the requests are done asynchronously by io_uring.
+   */
+  bool IsAsync() const { return ring_fd_ >= 0; }
+  /**
+   * @brief Reads a file at an offset. A short read means the end of the file is reached.
+   *
+   * @param[in] fd The file descriptor.
+   * @param[out] buf The buffer, it must be valid until the callback is called.
+   * @param[in] size The bytes to read.
+   * @param[in] offset The offset in the file.
+   * @param[in] done The callback.
+   *
+   * @note This is a thread-safe function. It blocks if the maximum number of requests are in flight.
+   */
+  void Read(int fd, void* buf, size_t size, uint64_t offset, Callback done);
+  /**
+   * @brief Writes a file at an offset. Short writes are continued by the ring, the callback gets the whole size or
+   * an error.
+   *
+   * @param[in] fd The file descriptor.
+   * @param[in] buf The data, it must be valid until the callback is called.
+   * @param[in] size The bytes to write.
+   * @param[in] offset The offset in the file.
+   * @param[in] done The callback.
+   *
+   * @note This is a thread-safe function. It blocks if the maximum number of requests are in flight.
+   */
+  void Write(int fd, const void* buf, size_t size, uint64_t offset, Callback done);
+
+ private:
+  struct Request {
+    bool write = false;
+    int fd = -1;
+    struct iovec iov;
+    uint64_t offset = 0;
+    int64_t done_bytes = 0;
+    Callback done;
+  };
+  void Submit(std::unique_ptr<Request> request);
+  // pushes the request to the submission queue, ``mutex_`` is locked
+  void Push(Request* request);
+  void CompletionLoop();
+  bool Setup(uint32_t entries);
+
+  int ring_fd_ = -1;
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  void* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  // pointers into the rings
+  uint32_t *sq_head_ = nullptr, *sq_tail_ = nullptr, *sq_mask_ = nullptr, *sq_array_ = nullptr;
+  uint32_t *cq_head_ = nullptr, *cq_tail_ = nullptr, *cq_mask_ = nullptr;
+  void* cqes_ = nullptr;
+  uint32_t max_inflight_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  uint32_t inflight_ = 0;
+  std::thread thread_;
+};  // class IoRing
+
+/**
+ * @class AsyncFileReader
+ *
+ * @brief AsyncFileReader reads a file sequentially through an IoRing. The blocks after the position are read ahead,
+ * so a read usually copies data already in memory instead of blocking in the system call.
+ *
+ * It is used by one thread, e.g. as the AVIO context of a demuxer.
+ */
+class AsyncFileReader : private NonCopyable {
+ public:
+  /**
+   * @brief Constructor.
+   *
+   * @param[in] ring The ring, nullptr means IoRing::Instance().
+   * @param[in] block_size The size of a block read ahead.
+   * @param[in] depth The number of blocks read ahead.
+   */
+  explicit AsyncFileReader(IoRing* ring = nullptr, size_t block_size = 1 << 20, uint32_t depth = 4);
+  ~AsyncFileReader();
+  /**
+   * @brief Opens a file.
+   *
+   * @return Returns false if the file can not be opened.
+   */
+  bool Open(const std::string& path);
+  /**
+   * @brief Closes the file, waits for the blocks being read.
+   */
+  void Close();
+  /**
+   * @brief Reads from the position.
+   *
+   * @param[out] buf The buffer.
+   * @param[in] size The bytes to read.
+   *
+   * @return Returns the bytes read, 0 at the end of the file, or a negative errno.
+   */
+  int64_t Read(void* buf, size_t size);
+  /**
+   * @brief Moves the position. The blocks read ahead are kept if the position is in them.
+   *
+   * @param[in] offset The offset from the beginning of the file.
+   *
+   * @return Returns the position, or a negative errno.
+   */
+  int64_t Seek(int64_t offset);
+  /**
+   * @brief Gets the position.
+   */
+  int64_t Tell() const { return pos_; }
+  /**
+   * @brief Gets the size of the file when it was opened.
+   */
+  int64_t Size() const { return size_; }
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    uint64_t offset = 0;
+    int64_t result = 0;
+    bool pending = false;
+  };
+  // queues the blocks after the last one until ``depth`` blocks are queued, returns the blocks to submit
+  std::vector<uint32_t> QueueBlocks();
+  void SubmitBlocks(const std::vector<uint32_t>& blocks);
+  // waits for the block at the head and drops it
+  void DropHead(std::unique_lock<std::mutex>* lk);
+
+  IoRing* ring_;
+  const size_t block_size_;
+  const uint32_t depth_;
+  int fd_ = -1;
+  int64_t size_ = 0;
+  int64_t pos_ = 0;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<Block> blocks_;  // a circular queue of ``depth`` blocks
+  uint32_t head_ = 0;          // the block holding the position if ``queued_`` is not 0
+  uint32_t queued_ = 0;
+  uint64_t next_offset_ = 0;   // the offset of the block queued next
+};  // class AsyncFileReader
+
+/**
+ * @class AsyncFileWriter
+ *
+ * @brief AsyncFileWriter writes a file through an IoRing. The data is copied into a buffer, and a full buffer is
+ * written while the next one is filled, so a write blocks only if ``depth`` buffers are being written.
+ *
+ * The errors of the writes are reported by the following calls. It is used by one thread, e.g. as the AVIO context
+ * of a muxer.
+ */
+class AsyncFileWriter : private NonCopyable {
+ public:
+  /**
+   * @brief Constructor.
+   *
+   * @param[in] ring The ring, nullptr means IoRing::Instance().
+   * @param[in] buffer_size The size of a buffer.
+   * @param[in] depth The number of buffers.
+   */
+  explicit AsyncFileWriter(IoRing* ring = nullptr, size_t buffer_size = 1 << 20, uint32_t depth = 4);
+  ~AsyncFileWriter();
+  /**
+   * @brief Creates or truncates a file, the file is closed by Close.
+   *
+   * @return Returns false if the file can not be opened.
+   */
+  bool Open(const std::string& path);
+  /**
+   * @brief Writes a file opened by the caller from its current offset. The file is not closed by Close.
+   *
+   * @return Returns false if the offset of the file can not be got.
+   */
+  bool Open(int fd);
+  /**
+   * @brief Writes the buffered data, waits for the writes and closes the file if it is opened by path.
+   *
+   * @return Returns 0, or the negative errno of a failed write.
+   */
+  int Close();
+  /**
+   * @brief Writes at the position.
+   *
+   * @param[in] data The data.
+   * @param[in] size The bytes to write.
+   *
+   * @return Returns ``size``, or the negative errno of a failed write.
+   */
+  int64_t Write(const void* data, size_t size);
+  /**
+   * @brief Moves the position. The buffered data is written and waited for, so that the writes to the same bytes
+   * are not reordered.
+   *
+   * @param[in] offset The offset from the beginning of the file.
+   *
+   * @return Returns the position, or the negative errno of a failed write.
+   */
+  int64_t Seek(int64_t offset);
+  /**
+   * @brief Writes the buffered data and waits for the writes.
+   *
+   * @return Returns 0, or the negative errno of a failed write.
+   */
+  int Flush();
+  /**
+   * @brief Gets the position.
+   */
+  int64_t Tell() const { return offset_ + used_; }
+  /**
+   * @brief Gets the size of the file, including the buffered data.
+   */
+  int64_t Size() const;
+
+ private:
+  struct Buffer {
+    std::unique_ptr<char[]> data;
+    bool pending = false;
+  };
+  // writes the current buffer and takes a free one
+  void SubmitBuffer();
+  int WaitAll();
+
+  IoRing* ring_;
+  const size_t buffer_size_;
+  int fd_ = -1;
+  bool own_fd_ = false;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<Buffer> buffers_;
+  uint32_t current_ = 0;
+  size_t used_ = 0;        // the bytes in the current buffer
+  int64_t offset_ = 0;     // the offset of the current buffer in the file
+  int64_t end_ = 0;        // the end of the data submitted
+  int error_ = 0;          // the first error, guarded by ``mutex_``
+};  // class AsyncFileWriter
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_ASYNC_IO_HPP_
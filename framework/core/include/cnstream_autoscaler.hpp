@@ -0,0 +1,162 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_AUTOSCALER_HPP_
+#define CNSTREAM_AUTOSCALER_HPP_
+
+/**
+ *  @file cnstream_autoscaler.hpp
+ *
+ *  This file contains a declaration of the Autoscaler class.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_common.hpp"
+#include "cnstream_config.hpp"
+
+namespace cnstream {
+
+/**
+ * @struct AutoscaleSample
+ *
+ * @brief AutoscaleSample is the state of a module sampled by the autoscaler.
+ */
+struct AutoscaleSample {
+  std::string module_name;                ///< The name of the module.
+  std::vector<std::string> next_modules;  ///< The names of the downstream modules.
+  uint32_t parallelism = 1;               ///< The current parallelism.
+  uint32_t min_parallelism = 1;           ///< The minimum parallelism.
+  uint32_t max_parallelism = 1;           ///< The maximum parallelism.
+  double queue_fill_ratio = 0;            ///< The ratio of the filled slots of the active input queues.
+  bool blocking_upstream = false;         ///< Whether an upstream module is waiting for a full input queue.
+  double process_latency_ms = 0;          ///< The average process latency. 0 if profiling is disabled.
+};
+
+/**
+ * @struct AutoscaleDecision
+ *
+ * @brief AutoscaleDecision is a parallelism change made by the autoscaler.
+ */
+struct AutoscaleDecision {
+  std::string module_name;        ///< The name of the module.
+  uint32_t old_parallelism = 0;   ///< The parallelism before scaling.
+  uint32_t new_parallelism = 0;   ///< The parallelism after scaling.
+  std::string reason;             ///< Why the module is scaled.
+  int64_t timestamp_ms = 0;       ///< When the module is scaled, in milliseconds since epoch.
+};
+
+/**
+ * @class Autoscaler
+ *
+ * @brief Autoscaler adjusts the parallelism of modules periodically according to the pressure on their input queues.
+ *
+ * A module is under pressure if its input queues are filled over the high watermark, or an upstream module is
+ * waiting for its full input queue. Each sample, at most one module is scaled:
+ *   - The bottleneck, a module under pressure whose downstream modules are not, gets one more thread. If there are
+ *     several, the one with the largest process latency (then the fullest queues) is chosen.
+ *   - Otherwise, a module whose queues have stayed under the low watermark for ``stable_intervals`` samples loses one
+ *     thread.
+ * A scaled module is not scaled again for ``stable_intervals`` samples.
+ *
+ * Pipeline creates an autoscaler when ``autoscaler_config`` is enabled, see AutoscalerConfig.
+ */
+class Autoscaler : private NonCopyable {
+ public:
+  /**
+   * @brief Gets the states of the modules.
+   */
+  using SampleFunc = std::function<std::vector<AutoscaleSample>()>;
+  /**
+   * @brief Sets the parallelism of a module. Returns true if the module is scaled.
+   */
+  using ScaleFunc = std::function<bool(const std::string& module_name, uint32_t parallelism)>;
+
+  /**
+   * @brief Constructs an autoscaler.
+   *
+   * @param[in] config The configuration of the autoscaler.
+   */
+  explicit Autoscaler(const AutoscalerConfig& config);
+  /**
+   * @brief Stops the autoscaler.
+   */
+  ~Autoscaler();
+  /**
+   * @brief Starts a thread sampling the modules every ``interval_ms`` and scaling them.
+   *
+   * @param[in] sample_func The function getting the states of the modules.
+   * @param[in] scale_func The function to scale a module.
+   *
+   * @return Returns true if the autoscaler is started. Otherwise, returns false.
+   */
+  bool Start(SampleFunc sample_func, ScaleFunc scale_func);
+  /**
+   * @brief Stops the sampling thread.
+   */
+  void Stop();
+  /**
+   * @brief Returns true if the sampling thread is running.
+   */
+  bool IsRunning() const { return running_.load(); }
+  /**
+   * @brief Makes a decision from one sample of the modules.
+   *
+   * @param[in] samples The states of the modules.
+   * @param[out] decision The decision.
+   *
+   * @return Returns true if a module should be scaled. Otherwise, returns false.
+   */
+  bool Decide(const std::vector<AutoscaleSample>& samples, AutoscaleDecision* decision);
+  /**
+   * @brief Gets the latest decisions carried out, at most ``kMaxDecisionNum``, in time order.
+   */
+  std::vector<AutoscaleDecision> GetDecisions() const;
+
+  static constexpr size_t kMaxDecisionNum = 128;
+
+ private:
+  void Loop();
+  bool IsUnderPressure(const AutoscaleSample& sample) const;
+
+  AutoscalerConfig config_;
+  SampleFunc sample_func_;
+  ScaleFunc scale_func_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  std::mutex exit_mtx_;
+  std::condition_variable exit_cond_;
+  // per module states, only used by Decide
+  std::map<std::string, uint32_t> idle_intervals_;
+  std::map<std::string, uint32_t> cooldown_intervals_;
+  mutable std::mutex decision_mtx_;
+  std::deque<AutoscaleDecision> decisions_;
+};  // class Autoscaler
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_AUTOSCALER_HPP_
@@ -0,0 +1,124 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_CHECKPOINT_HPP_
+#define CNSTREAM_CHECKPOINT_HPP_
+
+/**
+ *  @file cnstream_checkpoint.hpp
+ *
+ *  This file contains a declaration of the CheckpointStore class.
+ */
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+/**
+ * @struct StreamCheckpoint
+ *
+ * @brief StreamCheckpoint is the progress of a stream read from a file.
+ */
+struct StreamCheckpoint {
+  std::string source;  ///< The file read by the stream.
+  int64_t pts = -1;    ///< The timestamp of the latest frame passed through all modules, -1 if there is none.
+};
+
+/**
+ * @class CheckpointStore
+ *
+ * @brief CheckpointStore keeps the checkpoints of the streams and saves them to a file, see CheckpointConfig.
+ *
+ * The file has one line for each stream, ``<stream id>\t<source>\t<pts>``. It is written to a temporary file which
+ * is then renamed, so the file is complete even if the process is killed while saving.
+ */
+class CheckpointStore : private NonCopyable {
+ public:
+  /**
+   * @brief Constructs a checkpoint store.
+   *
+   * @param[in] path The file the checkpoints are saved to and loaded from.
+   * @param[in] save_interval_ms The minimum interval between two saves made by Record, 0 means every record.
+   */
+  CheckpointStore(const std::string& path, uint32_t save_interval_ms);
+  /**
+   * @brief Loads the checkpoints saved to the file. It is not an error if the file does not exist.
+   *
+   * @return Returns false if the file can not be read or it is malformed.
+   */
+  bool Load();
+  /**
+   * @brief Saves the checkpoints to the file if they are changed since the latest save.
+   *
+   * @return Returns false if the file can not be written.
+   */
+  bool Save();
+  /**
+   * @brief Starts recording the checkpoints of a stream. It is called by the source modules when a stream is opened.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] source The file read by the stream.
+   *
+   * @return Returns the timestamp of the latest frame processed if the stream was checkpointed reading the same
+   * file. Otherwise, returns -1 and the stream starts from the beginning.
+   */
+  int64_t Resume(const std::string& stream_id, const std::string& source);
+  /**
+   * @brief Records a frame passed through all modules. The streams not started by Resume are ignored.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] pts The timestamp of the frame.
+   */
+  void Record(const std::string& stream_id, int64_t pts);
+  /**
+   * @brief Forgets a stream, so that it starts from the beginning when it is added again.
+   *
+   * @param[in] stream_id The stream identification.
+   */
+  void Remove(const std::string& stream_id);
+  /**
+   * @brief Gets the checkpoint of a stream.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[out] checkpoint The checkpoint.
+   *
+   * @return Returns false if the stream has no checkpoint.
+   */
+  bool Get(const std::string& stream_id, StreamCheckpoint* checkpoint) const;
+
+ private:
+  bool SaveLocked();
+
+  std::string path_;
+  std::chrono::milliseconds save_interval_;
+  std::chrono::steady_clock::time_point last_save_;
+  bool dirty_ = false;  // whether the checkpoints are changed since the latest save
+  mutable std::mutex mtx_;  // guards the members above and below
+  std::map<std::string, StreamCheckpoint> checkpoints_;
+};  // class CheckpointStore
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_CHECKPOINT_HPP_
@@ -21,10 +21,13 @@
 #ifndef CNSTREAM_COLLECTION_HPP_
 #define CNSTREAM_COLLECTION_HPP_
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <map>
+#include <type_traits>
 #include <utility>
 
 #include "cnstream_common.hpp"
@@ -33,6 +36,38 @@
 
 namespace cnstream {
 
+/**
+ * The number of fixed slots in a Collection, see CollectionSlot.
+ */
+constexpr uint32_t kCollectionSlotNum = 8;
+
+/**
+ * @struct CollectionSlot
+ *
+ * @brief CollectionSlot is a well-known tag which owns a fixed slot in every Collection.
+ *
+ * The data in a slot is stored inline in Collection and is accessed without locks. Accessing by CollectionSlot also
+ * skips the lookup of the tag. After the slot is registered by Collection::RegisterSlot, the interfaces taking a string
+ * tag go to the slot as well.
+ *
+ * @code
+ * static constexpr CollectionSlot<std::shared_ptr<MyData>> kMyDataSlot("MyData", 3);
+ * static const bool my_data_slot_registered = Collection::RegisterSlot(kMyDataSlot);
+ *
+ * frame->collection.Add(kMyDataSlot, std::make_shared<MyData>());
+ * std::shared_ptr<MyData> data = frame->collection.Get(kMyDataSlot);
+ * @endcode
+ *
+ * @note Slot 0 to 2 are used by CNDataFrame, CNInferObjs and CNInferData.
+ */
+template <typename ValueT>
+struct CollectionSlot {
+  using ValueType = ValueT;
+  constexpr CollectionSlot(const char* tag, uint32_t index) : tag(tag), index(index) {}
+  const char* tag;  ///< The tag of the data. It must be a string with static storage duration.
+  uint32_t index;   ///< The index of the slot, it must be less than kCollectionSlotNum.
+};
+
 /**
  * @class Collection
  *
@@ -116,6 +151,57 @@ class Collection : public NonCopyable {
    */
   bool HasValue(const std::string& tag);
 
+  /**
+   * @brief Gets the reference to the data in ``slot`` if it exists, otherwise crashes.
+   *
+   * @param[in] slot The slot of the data.
+   *
+   * @return Returns the reference to the data.
+   */
+  template <typename ValueT>
+  ValueT& Get(const CollectionSlot<ValueT>& slot);
+  /**
+   * @brief Adds data to ``slot``. Crashes when there is already a piece of data in ``slot``.
+   *
+   * @param[in] slot The slot of the data.
+   * @param[in] value Value to be add.
+   *
+   * @return Returns the reference to the data.
+   */
+  template <typename ValueT>
+  ValueT& Add(const CollectionSlot<ValueT>& slot, typename CollectionSlot<ValueT>::ValueType value);
+  /**
+   * @brief Adds data to ``slot``, only if there is no piece of data in ``slot``.
+   *
+   * @param[in] slot The slot of the data.
+   * @param[in] value Value to be add.
+   *
+   * @return Returns true if the data is added successfully, otherwise returns false.
+   */
+  template <typename ValueT>
+  bool AddIfNotExists(const CollectionSlot<ValueT>& slot, typename CollectionSlot<ValueT>::ValueType value);
+  /**
+   * @brief Checks whether there is the data in ``slot``.
+   *
+   * @param[in] slot The slot of the data.
+   *
+   * @return Returns true if there is already a piece of data in ``slot``, otherwise returns false.
+   */
+  template <typename ValueT>
+  bool HasValue(const CollectionSlot<ValueT>& slot);
+  /**
+   * @brief Binds the tag of ``slot`` to the slot, so that the data tagged by the tag is stored in the slot.
+   *
+   * @param[in] slot The slot.
+   *
+   * @return Returns true if the slot is registered successfully. Returns false if the index is out of range,
+   *         or the slot has been registered with another tag.
+   *
+   * @note Registers slots before any data is added, e.g. during static initialization.
+   */
+  template <typename ValueT>
+  static bool RegisterSlot(const CollectionSlot<ValueT>& slot) { return RegisterSlot(slot.tag, slot.index); }
+
 #if !defined(_LIBCPP_NO_RTTI)
   /**
    * @brief Gets type information for data tagged by `tag`.
@@ -138,16 +224,61 @@ class Collection : public NonCopyable {
 #endif
 
  private:
+  friend class CNFrameInfoPool;
+  /**
+   * @brief Removes all data except the ones ``keep`` returns true for. It is used to recycle frames.
+   *
+   * @param[in] keep Called with the tag and the data. Returns true to keep the data.
+   *
+   * @return No return value.
+   */
+  void RetainIf(const std::function<bool(const std::string& tag, cnstream::any* value)>& keep);
   void Add(const std::string& tag, std::unique_ptr<cnstream::any>&& value);
   bool AddIfNotExists(const std::string& tag, std::unique_ptr<cnstream::any>&& value);
 
+  static bool RegisterSlot(const char* tag, uint32_t index);
+  // returns the index of the slot registered with tag, or -1.
+  static int FindSlot(const std::string& tag);
+  static void CheckSlotIndex(uint32_t index, const char* tag);
+  bool AddToSlot(uint32_t index, const char* tag, cnstream::any&& value, bool crash_if_exists);
+  template <typename ValueT>
+  ValueT& GetFromSlot(uint32_t index, const char* tag);
+
  private:
+  enum SlotState { kSlotEmpty = 0, kSlotWriting, kSlotReady };
+  struct Slot {
+    std::atomic<int> state{kSlotEmpty};
+    cnstream::any value;
+  };
+  Slot slots_[kCollectionSlotNum];
   std::map<std::string, std::unique_ptr<cnstream::any>> data_;
   std::mutex data_mtx_;
 };  // class Collection
 
+template <typename ValueT>
+ValueT& Collection::GetFromSlot(uint32_t index, const char* tag) {
+  Slot& slot = slots_[index];
+  if (kSlotReady != slot.state.load(std::memory_order_acquire)) {
+    LOGF(COLLECTION) << "No data tagged by [" << tag << "] has been added.";
+  }
+  auto value = any_cast<typename std::decay<ValueT>::type>(&slot.value);
+  if (!value) {
+#if !defined(_LIBCPP_NO_RTTI)
+    LOGF(COLLECTION) << "The type of data tagged by [" << tag << "]  is ["
+                     << slot.value.type().name()
+                     << "]. Expect type is [" << typeid(ValueT).name() << "].";
+#else
+    LOGF(COLLECTION) << "The type of data tagged by [" << tag << "] is not the "
+                        "expected data type.";
+#endif
+  }
+  return *value;
+}
+
 template <typename ValueT>
 ValueT& Collection::Get(const std::string& tag) {
+  const int slot_idx = FindSlot(tag);
+  if (slot_idx >= 0) return GetFromSlot<ValueT>(slot_idx, tag.c_str());
   std::lock_guard<std::mutex> lk(data_mtx_);
   auto iter = data_.find(tag);
   if (data_.end() == iter) {
@@ -172,26 +303,66 @@ ValueT& Collection::Get(const std::string& tag) {
 
 template <typename ValueT> inline
 ValueT& Collection::Add(const std::string& tag, const ValueT& value) {
+  const int slot_idx = FindSlot(tag);
+  if (slot_idx >= 0) {
+    AddToSlot(slot_idx, tag.c_str(), cnstream::any(value), true);
+    return GetFromSlot<ValueT>(slot_idx, tag.c_str());
+  }
   Add(tag, std::unique_ptr<cnstream::any>(new cnstream::any(value)));
   return Get<ValueT>(tag);
 }
 
 template <typename ValueT> inline
 ValueT& Collection::Add(const std::string& tag, ValueT&& value) {
+  const int slot_idx = FindSlot(tag);
+  if (slot_idx >= 0) {
+    AddToSlot(slot_idx, tag.c_str(), cnstream::any(std::forward<ValueT>(value)), true);
+    return GetFromSlot<ValueT>(slot_idx, tag.c_str());
+  }
   Add(tag, std::unique_ptr<cnstream::any>(new cnstream::any(std::forward<ValueT>(value))));
   return Get<ValueT>(tag);
 }
 
 template <typename ValueT> inline
 bool Collection::AddIfNotExists(const std::string& tag, const ValueT& value) {
+  const int slot_idx = FindSlot(tag);
+  if (slot_idx >= 0) return AddToSlot(slot_idx, tag.c_str(), cnstream::any(value), false);
   return AddIfNotExists(tag, std::unique_ptr<cnstream::any>(new cnstream::any(value)));
 }
 
 template <typename ValueT> inline
 bool Collection::AddIfNotExists(const std::string& tag, ValueT&& value) {
+  const int slot_idx = FindSlot(tag);
+  if (slot_idx >= 0) return AddToSlot(slot_idx, tag.c_str(), cnstream::any(std::forward<ValueT>(value)), false);
   return AddIfNotExists(tag, std::unique_ptr<cnstream::any>(new cnstream::any(std::forward<ValueT>(value))));
 }
 
+template <typename ValueT> inline
+ValueT& Collection::Get(const CollectionSlot<ValueT>& slot) {
+  CheckSlotIndex(slot.index, slot.tag);
+  return GetFromSlot<ValueT>(slot.index, slot.tag);
+}
+
+template <typename ValueT> inline
+ValueT& Collection::Add(const CollectionSlot<ValueT>& slot, typename CollectionSlot<ValueT>::ValueType value) {
+  CheckSlotIndex(slot.index, slot.tag);
+  AddToSlot(slot.index, slot.tag, cnstream::any(std::move(value)), true);
+  return GetFromSlot<ValueT>(slot.index, slot.tag);
+}
+
+template <typename ValueT> inline
+bool Collection::AddIfNotExists(const CollectionSlot<ValueT>& slot,
+                                typename CollectionSlot<ValueT>::ValueType value) {
+  CheckSlotIndex(slot.index, slot.tag);
+  return AddToSlot(slot.index, slot.tag, cnstream::any(std::move(value)), false);
+}
+
+template <typename ValueT> inline
+bool Collection::HasValue(const CollectionSlot<ValueT>& slot) {
+  CheckSlotIndex(slot.index, slot.tag);
+  return kSlotReady == slots_[slot.index].state.load(std::memory_order_acquire);
+}
+
 #if !defined(_LIBCPP_NO_RTTI)
 template <typename ValueT> inline
 bool Collection::TaggedIsOfType(const std::string& tag) {
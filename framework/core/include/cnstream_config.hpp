@@ -96,17 +96,60 @@ struct CNConfigBase {
  * {
  *   "profiler_config" : {
  *     "enable_profiling" : true,
- *     "enable_tracing" : true
+ *     "enable_tracing" : true,
+ *     "enable_latency_breakdown" : true
+ *   }
+ * }
+ * @endcode
+ *
+ * With ``enable_latency_breakdown``, every frame carries the times it is enqueued, dequeued and done by each module,
+ * see CNFrameInfo::GetModuleTimes, and PipelineProfile::latency_breakdowns tells how long the frames of each stream
+ * wait in the input queue of each module and where the critical path of the frames is. It takes effect only if
+ * ``enable_profiling`` is true.
+ *
+ * With ``enable_perf_counters``, the cycles, instructions, last level cache misses and context switches of the threads
+ * calling Module::Process are sampled around the calls and added to ModuleProfile::counters, see PerfCounters, to tell
+ * whether a slow module is CPU-bound, missing caches or waiting. It takes effect only if ``enable_profiling`` is true.
+ *
+ * With ``trace_file``, trace events are streamed into the file by a background thread as well, so that a long run is
+ * traced completely with bounded memory, see TraceFileWriter for the format. ``trace_event_capacity`` only limits the
+ * events cached for PipelineTracer::GetTrace then, and it can be small. The events are flushed into the file about
+ * every 100 milliseconds and the file is closed when the pipeline is destroyed. It takes effect only if
+ * ``enable_tracing`` is true.
+ *
+ * Tracing every frame is expensive, so the frames traced can be sampled, see TraceSampler:
+ *
+ * @code {.json}
+ * {
+ *   "profiler_config" : {
+ *     "enable_profiling" : true,
+ *     "enable_tracing" : true,
+ *     "trace_sample_interval" : 100,
+ *     "trace_streams" : ["camera_0"],
+ *     "trace_latency_threshold" : 50,
+ *     "trace_burst_duration" : 2000
  *   }
  * }
  * @endcode
  *
+ * One in ``trace_sample_interval`` frames of each stream and all frames of ``trace_streams`` are traced. If the process
+ * time of a module exceeds ``trace_latency_threshold`` milliseconds, all frames are traced in the next
+ * ``trace_burst_duration`` milliseconds, so the slow periods are traced completely. The threshold only takes effect if
+ * ``enable_profiling`` is true and ``trace_sample_interval`` is not 1.
+ *
  * @note It will not take effect when the profiler configuration is in the subgraph configuration.
  **/
 struct ProfilerConfig : public CNConfigBase {
   bool enable_profiling = false;           ///< Whether to enable profiling.
   bool enable_tracing = false;             ///< Whether to enable tracing.
   size_t trace_event_capacity = 100000;    ///< The maximum number of cached trace events.
+  bool enable_latency_breakdown = false;   ///< Whether to break the latency of frames down by modules.
+  bool enable_perf_counters = false;       ///< Whether to sample the hardware counters around Process calls.
+  std::string trace_file = "";             ///< The file to stream trace events into, empty to disable streaming.
+  uint32_t trace_sample_interval = 1;      ///< Traces 1 in N frames of each stream, 0 to trace trace_streams only.
+  std::vector<std::string> trace_streams;  ///< The streams of which all frames are traced.
+  double trace_latency_threshold = 0;      ///< The process time to trace all frames in milliseconds, 0 to disable.
+  double trace_burst_duration = 1000;      ///< The duration to trace all frames after the threshold is exceeded in ms.
 
   /**
    * @brief Parses members from JSON string.
@@ -118,6 +161,509 @@ struct ProfilerConfig : public CNConfigBase {
   bool ParseByJSONStr(const std::string &jstr) override;
 };  // struct ProfilerConfig
 
+/**
+ * @struct SchedulerConfig
+ *
+ * @brief SchedulerConfig is a structure for the configuration of module execution.
+ *
+ * By default, the pipeline creates ``parallelism`` threads for each module except the head modules, and each
+ * thread processes the data of one input queue. When ``work_stealing`` is enabled, the data of all modules is
+ * processed by a pool of ``thread_num`` worker threads instead. An idle worker steals work from busy workers,
+ * and the data in one input queue is still processed in order.
+ *
+ * The modules are opened one by one when the pipeline starts. When ``parallel_open`` is enabled, every module is
+ * opened on its own thread as soon as the modules listed in its CNModuleConfig::openAfter have been opened, so that
+ * e.g. the models of several inferencers are loaded at the same time.
+ *
+ * @code {.json}
+ * {
+ *   "scheduler_config" : {
+ *     "work_stealing" : true,
+ *     "thread_num" : 8,
+ *     "parallel_open" : true
+ *   }
+ * }
+ * @endcode
+ *
+ * @note It will not take effect when the scheduler configuration is in the subgraph configuration.
+ * @note With work stealing, a module may be called on different threads. Modules which rely on thread local
+ *       states, should use the default mode.
+ * @note With ``parallel_open``, Module::Open of each module is called on a thread exiting after the call.
+ **/
+struct SchedulerConfig : public CNConfigBase {
+  bool work_stealing = false;  ///< Whether to process data by a work stealing thread pool.
+  uint32_t thread_num = 0;     ///< The number of worker threads. 0 means the number of hardware threads.
+  bool parallel_open = false;  ///< Whether to open the modules concurrently when the pipeline starts.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct SchedulerConfig
+
+/**
+ * @struct FramePoolConfig
+ *
+ * @brief FramePoolConfig is a structure for the configuration of the frame pool of a pipeline.
+ *
+ * When the frame pool is enabled, the source modules get frames from the pool of the pipeline, and frames are
+ * recycled to the pool instead of being deleted. At most ``capacity`` idle frames are kept by the pool.
+ * If ``max_frames`` is not 0, the sources block until a frame is released when ``max_frames`` frames are in use.
+ *
+ * @code {.json}
+ * {
+ *   "frame_pool_config" : {
+ *     "enable" : true,
+ *     "capacity" : 256,
+ *     "max_frames" : 512
+ *   }
+ * }
+ * @endcode
+ *
+ * @note It will not take effect when the frame pool configuration is in the subgraph configuration.
+ * @see CNFrameInfoPool
+ **/
+struct FramePoolConfig : public CNConfigBase {
+  bool enable = false;      ///< Whether to create a frame pool for the pipeline.
+  uint32_t capacity = 256;  ///< The maximum number of idle frames kept by the pool.
+  uint32_t max_frames = 0;  ///< The maximum number of frames in use, EOS frames excluded. 0 means no limit.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct FramePoolConfig
+
+/**
+ * @struct AutoscalerConfig
+ *
+ * @brief AutoscalerConfig is a structure for the configuration of the autoscaler of a pipeline.
+ *
+ * When the autoscaler is enabled, the pipeline samples the input queues of the modules every ``interval_ms``.
+ * A module whose input queues are filled over ``high_watermark`` (or whose upstream modules are blocked by its full
+ * queues) and whose downstream modules are not under pressure, is the bottleneck and gets one more thread. A module
+ * whose input queues are filled under ``low_watermark`` for ``stable_intervals`` samples, loses one thread.
+ * Only modules with a scaling range, see CNModuleConfig::minParallelism and CNModuleConfig::maxParallelism, are
+ * scaled.
+ *
+ * @code {.json}
+ * {
+ *   "autoscaler_config" : {
+ *     "enable" : true,
+ *     "interval_ms" : 1000,
+ *     "high_watermark" : 0.8,
+ *     "low_watermark" : 0.1,
+ *     "stable_intervals" : 5
+ *   }
+ * }
+ * @endcode
+ *
+ * @note It will not take effect when the autoscaler configuration is in the subgraph configuration,
+ *       or in work stealing mode.
+ * @see Autoscaler
+ **/
+struct AutoscalerConfig : public CNConfigBase {
+  bool enable = false;            ///< Whether to scale the parallelism of modules at runtime.
+  uint32_t interval_ms = 1000;    ///< The sampling interval.
+  double high_watermark = 0.8;    ///< The ratio of filled input queues to add a thread to a module.
+  double low_watermark = 0.1;     ///< The ratio of filled input queues to remove a thread from a module.
+  uint32_t stable_intervals = 5;  ///< The number of samples a module keeps idle before scaling down.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct AutoscalerConfig
+
+/**
+ * @struct MemoryBudgetConfig
+ *
+ * @brief MemoryBudgetConfig is a structure for the memory budgets of a pipeline.
+ *
+ * When the memory budget is enabled, the memory held by frames, decoders and the buffers allocated by
+ * ``cnCpuMemAlloc`` and ``cnMluMemAlloc`` is charged to the pipeline and to the stream it belongs to. A source module
+ * stops sending the frames of a stream while the stream or the pipeline holds more memory than its budget, until the
+ * downstream modules release memory or ``max_wait_ms`` passes. Budgets are in megabytes, 0 means unlimited.
+ *
+ * @code {.json}
+ * {
+ *   "memory_budget_config" : {
+ *     "enable" : true,
+ *     "host_mb" : 4096,
+ *     "device_mb" : 8192,
+ *     "stream_host_mb" : 256,
+ *     "stream_device_mb" : 512,
+ *     "max_wait_ms" : 1000
+ *   }
+ * }
+ * @endcode
+ *
+ * @note It will not take effect when the memory budget configuration is in the subgraph configuration.
+ * @see MemoryAccountant
+ **/
+struct MemoryBudgetConfig : public CNConfigBase {
+  bool enable = false;            ///< Whether to track memory and apply the budgets.
+  uint32_t host_mb = 0;           ///< The host memory budget of the pipeline.
+  uint32_t device_mb = 0;         ///< The MLU memory budget of the pipeline.
+  uint32_t stream_host_mb = 0;    ///< The host memory budget of each stream.
+  uint32_t stream_device_mb = 0;  ///< The MLU memory budget of each stream.
+  uint32_t max_wait_ms = 1000;    ///< The maximum time a source waits for memory before sending a frame anyway.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct MemoryBudgetConfig
+
+/**
+ * @struct MetricsConfig
+ *
+ * @brief MetricsConfig is a structure for the metrics endpoint of a pipeline.
+ *
+ * When the endpoint is enabled, the running pipeline serves its metrics in the OpenMetrics text format over HTTP at
+ * ``path`` on ``port`` of all interfaces, so that they can be scraped by Prometheus. See Pipeline::GetMetrics for the
+ * metrics. The frame rates, latencies and frame counters are exported only if profiling is enabled, see
+ * ProfilerConfig.
+ *
+ * @code {.json}
+ * {
+ *   "metrics_config" : {
+ *     "enable" : true,
+ *     "port" : 9464,
+ *     "path" : "/metrics"
+ *   }
+ * }
+ * @endcode
+ *
+ * @note It will not take effect when the metrics configuration is in the subgraph configuration.
+ * @see MetricsExporter
+ **/
+struct MetricsConfig : public CNConfigBase {
+  bool enable = false;             ///< Whether to serve the metrics over HTTP.
+  uint32_t port = 9464;            ///< The TCP port, 0 means any free port, see MetricsExporter::GetPort.
+  std::string path = "/metrics";   ///< The path of the metrics.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct MetricsConfig
+
+/**
+ * @struct AdmissionConfig
+ *
+ * @brief AdmissionConfig is a structure for the admission control of the frames sent by the source modules.
+ *
+ * When admission control is enabled, the pipeline samples the input queues of the modules and the frames completed
+ * every ``interval_ms``. The pipeline is overloaded if the input queues of a module are filled over
+ * ``high_watermark``, or an upstream module is waiting for a full input queue. Once overloaded, the capacity of the
+ * pipeline is set to ``decrease_ratio`` of the measured frame rate, and it grows by ``increase_ratio`` each sample
+ * the pipeline is not overloaded, until it covers the frame rates of all streams.
+ *
+ * While the capacity is limited, it is shared by the streams in proportion to their weights (max-min fair: a stream
+ * sending less than its share leaves the rest to the others), and each stream is given at least ``min_fps``. A source
+ * module drops the frames of a stream sent over its share, see SourceModule::SendData. The frames of a stream may
+ * exceed its share for ``burst_ms``.
+ *
+ * @code {.json}
+ * {
+ *   "admission_config" : {
+ *     "enable" : true,
+ *     "interval_ms" : 1000,
+ *     "high_watermark" : 0.8,
+ *     "decrease_ratio" : 0.9,
+ *     "increase_ratio" : 1.05,
+ *     "min_fps" : 1.0,
+ *     "burst_ms" : 200
+ *   }
+ * }
+ * @endcode
+ *
+ * @note It will not take effect when the admission configuration is in the subgraph configuration.
+ * @see AdmissionController Pipeline::SetStreamWeight
+ **/
+struct AdmissionConfig : public CNConfigBase {
+  bool enable = false;           ///< Whether to control the frame rates of the streams.
+  uint32_t interval_ms = 1000;   ///< The sampling interval.
+  double high_watermark = 0.8;   ///< The ratio of filled input queues marking the pipeline overloaded.
+  double decrease_ratio = 0.9;   ///< The ratio of the measured frame rate the capacity is set to once overloaded.
+  double increase_ratio = 1.05;  ///< The ratio the capacity grows by each sample the pipeline is not overloaded.
+  double min_fps = 1.0;          ///< The frame rate every stream is given at least.
+  uint32_t burst_ms = 200;       ///< How long the frames of a stream may exceed its share.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct AdmissionConfig
+
+/**
+ * @struct CheckpointConfig
+ *
+ * @brief CheckpointConfig is a structure for the checkpoints of the streams, so that a long offline job resumes
+ * where it stopped after a crash or a restart.
+ *
+ * When checkpoints are enabled, the pipeline records the timestamp of the latest frame passed through all modules for
+ * each stream opened by a file source, and saves them to ``path`` at most every ``save_interval_ms``, 0 means after
+ * every frame. When the same stream id is added again with the same file, the source seeks to the key frame before
+ * the checkpoint and skips the frames already processed.
+ *
+ * The frames completed after the latest save are processed again after a crash. Set ``save_interval_ms`` to 0 to
+ * process each frame exactly once, at the cost of writing the file for every frame.
+ *
+ * @code {.json}
+ * {
+ *   "checkpoint_config" : {
+ *     "enable" : true,
+ *     "path" : "/var/lib/cnstream/checkpoints.txt",
+ *     "save_interval_ms" : 1000
+ *   }
+ * }
+ * @endcode
+ *
+ * @note It will not take effect when the checkpoint configuration is in the subgraph configuration.
+ * @see CheckpointStore
+ **/
+struct CheckpointConfig : public CNConfigBase {
+  bool enable = false;               ///< Whether to record the checkpoints of the streams.
+  std::string path;                  ///< The file the checkpoints are saved to and loaded from.
+  uint32_t save_interval_ms = 1000;  ///< The minimum interval between two saves.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct CheckpointConfig
+
+/**
+ * @brief Actions of a degradation step, see DegradationConfig.
+ */
+enum class DegradationAction {
+  SKIP_FRAMES = 0,   ///< The modules process one of every ``interval`` frames of a stream, the others bypass them.
+  BYPASS = 1,        ///< All frames bypass the modules, e.g. the secondary inferencers.
+  SCALE_OUTPUT = 2,  ///< The modules scale down the frames they output by ``scale``, see Module::SetOutputScale.
+};
+
+/**
+ * @struct DegradationStep
+ *
+ * @brief DegradationStep is one step of the degradation ladder of a pipeline, see DegradationConfig.
+ */
+struct DegradationStep {
+  DegradationAction action = DegradationAction::SKIP_FRAMES;  ///< The action of the step.
+  std::vector<std::string> modules;  ///< The names of the modules the action is applied to.
+  uint32_t interval = 2;             ///< For SKIP_FRAMES, one of every ``interval`` frames is processed.
+  /**
+   * For SKIP_FRAMES and BYPASS, the streams whose priority is not greater than it are degraded. The streams have
+   * priority 0 unless it is set by Pipeline::SetStreamPriority.
+   */
+  int max_priority = 0;
+  double scale = 0.5;  ///< For SCALE_OUTPUT, the ratio of the width and the height of the frames output.
+};
+
+/**
+ * @struct DegradationConfig
+ *
+ * @brief DegradationConfig is a structure for the graceful degradation of an overloaded pipeline.
+ *
+ * When degradation is enabled, the pipeline samples the input queues of the modules every ``interval_ms``. A sample
+ * is overloaded if the input queues of a module are filled over ``high_watermark``, an upstream module is waiting for
+ * a full input queue, or the queues keep growing over ``low_watermark``. After ``escalate_samples`` overloaded
+ * samples in a row, the next step of ``steps`` is applied, e.g. lower the frame rate of the detector for the low
+ * priority streams, then bypass the secondary inferencers, then reduce the resolution. After ``recover_samples``
+ * samples in a row with the queues filled under ``low_watermark``, the latest step applied is undone.
+ *
+ * An event of type EventType::EVENT_DEGRADATION is posted each time a step is applied or undone.
+ *
+ * @code {.json}
+ * {
+ *   "degradation_config" : {
+ *     "enable" : true,
+ *     "interval_ms" : 1000,
+ *     "high_watermark" : 0.8,
+ *     "low_watermark" : 0.3,
+ *     "escalate_samples" : 3,
+ *     "recover_samples" : 5,
+ *     "steps" : [
+ *       {"action" : "skip_frames", "modules" : ["detector"], "interval" : 2, "max_priority" : 0},
+ *       {"action" : "bypass", "modules" : ["classifier"]},
+ *       {"action" : "scale_output", "modules" : ["source"], "scale" : 0.5}
+ *     ]
+ *   }
+ * }
+ * @endcode
+ *
+ * @note It will not take effect when the degradation configuration is in the subgraph configuration.
+ * @see DegradationController Pipeline::SetStreamPriority
+ **/
+struct DegradationConfig : public CNConfigBase {
+  bool enable = false;            ///< Whether to degrade the pipeline under overload.
+  uint32_t interval_ms = 1000;    ///< The sampling interval.
+  double high_watermark = 0.8;    ///< The ratio of filled input queues marking a sample overloaded.
+  double low_watermark = 0.3;     ///< The ratio of filled input queues under which the load has dropped.
+  uint32_t escalate_samples = 3;  ///< The overloaded samples in a row applying the next step.
+  uint32_t recover_samples = 5;   ///< The samples in a row under ``low_watermark`` undoing the latest step.
+  std::vector<DegradationStep> steps;  ///< The degradation ladder, applied in order and undone in reverse order.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct DegradationConfig
+
+/**
+ * @struct CpuIsolationConfig
+ *
+ * @brief CpuIsolationConfig is a structure for the CPU isolation between pipelines running in the same process.
+ *
+ * When CPU isolation is enabled, the threads of the pipeline are tagged as they start: the task threads of the
+ * modules, the threads of the source handlers and the decoder threads. A tagged thread is given the ``nice`` value,
+ * and it is moved into ``cgroup`` if it is set. The ``cgroup`` must be a writable cgroup v2 directory of type
+ * ``threaded`` (its ``cgroup.threads`` is written), or a cgroup v1 cpu directory (its ``tasks`` is written). If
+ * ``cpu_weight`` is not 0, it is written to the ``cpu.weight`` of the cgroup (cgroup v2) or converted to its
+ * ``cpu.shares`` (cgroup v1, 100 is 1024 shares) when the pipeline starts, so the pipelines in sibling cgroups share
+ * the CPUs in proportion to their weights.
+ *
+ * The CPU time consumed by the tagged threads is reported by the profiler, see PipelineProfile::cpu_usage.
+ *
+ * @code {.json}
+ * {
+ *   "cpu_isolation_config" : {
+ *     "enable" : true,
+ *     "nice" : 5,
+ *     "cgroup" : "/sys/fs/cgroup/cnstream/pipeline0",
+ *     "cpu_weight" : 50
+ *   }
+ * }
+ * @endcode
+ *
+ * @note It will not take effect when the CPU isolation configuration is in the subgraph configuration.
+ * @see Pipeline::TagCurrentThread
+ **/
+struct CpuIsolationConfig : public CNConfigBase {
+  bool enable = false;      ///< Whether to tag the threads of the pipeline.
+  int nice = 0;             ///< The nice value of the threads, in [-20, 19]. Lower values need CAP_SYS_NICE.
+  std::string cgroup = "";  ///< The cgroup the threads are moved into, not moved if it is empty.
+  uint32_t cpu_weight = 0;  ///< The CPU weight of the cgroup, in [1, 10000]. 0 keeps the weight of the cgroup.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct CpuIsolationConfig
+
+/**
+ * @brief Implementations of the input data queues (conveyors) of a module.
+ */
+enum class InputQueueType {
+  MUTEX = 0,      ///< A queue guarded by a mutex and a condition variable. It is the default implementation.
+  LOCK_FREE = 1,  ///< A bounded lock-free ring buffer with preallocated slots.
+};
+
+/**
+ * @brief Policies applied when an input data queue of a module is full.
+ *
+ * @note EOS data is never dropped.
+ */
+enum class QueueFullPolicy {
+  BLOCK = 0,        ///< The upstream module waits until the queue is not full. It is the default policy.
+  DROP_OLDEST = 1,  ///< The oldest data in the queue is dropped to make room for the new data.
+  DROP_NEWEST = 2,  ///< The new data is dropped.
+};
+
+/**
+ * @brief Policies of fusing a module into the execution stage of its upstream module.
+ *
+ * A fused module has no input queues and no threads of its own. Its ``Process`` is called right after its upstream
+ * module, on the same thread. A module can be fused only if it has a single upstream module, which is not a head
+ * module and has no other downstream modules, and its ``max_batch_size`` is 1 and it is not scaled.
+ */
+enum class FusePolicy {
+  AUTO = 0,    ///< The module is fused if it is marked fusable, see Module::IsFusable. It is the default policy.
+  ALWAYS = 1,  ///< The module is fused whenever it can be fused.
+  NEVER = 2,   ///< The module is never fused.
+};
+
+/**
+ * @struct CircuitBreakerConfig
+ *
+ * @brief CircuitBreakerConfig is a structure for the circuit breaker of a module which is not critical, e.g. a module
+ * of a branch sending the results to a remote server, so that a slow or failing module does not stall the pipeline.
+ *
+ * A frame fails in the module if ``Module::Process`` returns an error, takes longer than ``max_latency_ms``, or the
+ * frame finds the input queue of the module full. A frame failed by an error is transmitted to the downstream modules
+ * as if it was processed, instead of stopping the stream. Once ``failure_threshold`` frames fail in a row, the
+ * breaker opens and the frames bypass the module, they are marked passed by the module without being processed. The
+ * breaker lets one frame in as a probe every ``open_ms``, it closes if the probe is processed in time.
+ *
+ * An event of type EventType::EVENT_CIRCUIT_BREAKER is posted each time the state of the breaker changes.
+ *
+ * @code {.json}
+ * {
+ *   "circuit_breaker" : {
+ *     "enable" : true,
+ *     "failure_threshold" : 5,
+ *     "max_latency_ms" : 0,
+ *     "open_ms" : 5000
+ *   }
+ * }
+ * @endcode
+ *
+ * @note The EOS always goes through the module. The frames queued before the breaker opens are still processed by
+ * the module, the frames bypassing it may reach the downstream modules before them.
+ **/
+struct CircuitBreakerConfig : public CNConfigBase {
+  bool enable = false;             ///< Whether the module has a circuit breaker.
+  uint32_t failure_threshold = 5;  ///< The number of frames failed in a row opening the breaker.
+  uint32_t max_latency_ms = 0;     ///< A frame processed longer than it fails. 0 means the latency is not checked.
+  uint32_t open_ms = 5000;         ///< How long the frames bypass the module before a probe is let in.
+
+  /**
+   * @brief Parses members from JSON string.
+   *
+   * @param[in] jstr JSON configuration string.
+   *
+   * @return Returns true if the JSON string has been parsed successfully. Otherwise, returns false.
+   */
+  bool ParseByJSONStr(const std::string &jstr) override;
+};  // struct CircuitBreakerConfig
+
 /**
  * @struct CNModuleConfig
  *
@@ -129,9 +675,23 @@ struct ProfilerConfig : public CNConfigBase {
  *   "name": {
  *     "parallelism": 3,
  *     "max_input_queue_size": 20,
+ *     "queue_type": "mutex" or "lock_free",
+ *     "queue_full_policy": "block" or "drop_oldest" or "drop_newest",
+ *     "rebalance_streams": false,
+ *     "stream_parallel": false,
+ *     "ordered_output": true,
+ *     "max_batch_size": 1,
+ *     "batch_timeout_us": 0,
+ *     "cpu_affinity": "0-3,8" or [0, 1, 2, 3, 8],
+ *     "numa_node": -1,
+ *     "min_parallelism": 1,
+ *     "max_parallelism": 8,
+ *     "fuse": "auto" or "always" or "never",
+ *     "circuit_breaker": {"enable": true, "failure_threshold": 5, "max_latency_ms": 0, "open_ms": 5000},
  *     "class_name": "cnstream::Inferencer",
  *     "next_modules": ["module_name/subgraph:subgraph_name",
  *                      "module_name/subgraph:subgraph_name", ...],
+ *     "open_after": ["module_name", ...],
  *     "custom_params" : {
  *       "param_name" : "param_value",
  *       "param_name" : "param_value",
@@ -147,8 +707,69 @@ struct CNModuleConfig : public CNConfigBase {
       parameters;   ///< The key-value pairs. The pipeline passes this value to the CNModuleConfig::name module.
   int parallelism;  ///< Module parallelism. It is equal to module thread number or the data queue of input data.
   int maxInputQueueSize;          ///< The maximum size of the input data queues.
+  InputQueueType queueType = InputQueueType::MUTEX;  ///< The implementation of the input data queues.
+  QueueFullPolicy queueFullPolicy = QueueFullPolicy::BLOCK;  ///< The policy applied when an input queue is full.
+  /**
+   * Whether to move streams to less loaded input queues. By default, the data of a stream is always pushed to
+   * the input queue ``stream_index % parallelism``. If it is true, the pipeline maps streams to input queues by load,
+   * and moves a stream after its data in the old queue has been processed. It takes no effect in work stealing mode.
+   */
+  bool rebalanceStreams = false;
+  /**
+   * Whether the data of one stream is processed by several threads of the module at the same time. By default, the
+   * data of a stream is pushed to one input queue and processed by one thread, which limits a high frame rate stream
+   * to one thread per module. If it is true, the data is spread over the input queues, and ``Module::Process`` must
+   * be thread-safe for the data of one stream, including the EOS, which may be processed while the earlier data of
+   * the stream is still being processed. The stream is not rebalanced, scaled or fused.
+   */
+  bool streamParallel = false;
+  /**
+   * Whether the data of a stream processed in parallel is transmitted to the downstream modules in the order it
+   * entered the module. Otherwise, the data is transmitted as soon as it is processed, only the EOS waits for the
+   * other data of the stream. It takes effect only if ``streamParallel`` is true.
+   */
+  bool orderedOutput = true;
+  /**
+   * The maximum number of data passed to Module::ProcessBatch at one time. If it is greater than 1, the pipeline pops
+   * up to ``maxBatchSize`` data from an input queue at once and calls Module::ProcessBatch instead of Module::Process.
+   */
+  uint32_t maxBatchSize = 1;
+  /**
+   * How long to wait for a full batch, in microseconds, after the first data of a batch is popped. 0 means the
+   * data already in the queue is processed as a batch without waiting.
+   */
+  uint32_t batchTimeoutUs = 0;
+  /**
+   * The cpus the threads of this module are bound to. It takes precedence over ``numaNode``.
+   */
+  std::vector<int> cpuAffinity;
+  /**
+   * The NUMA node the threads of this module are bound to. -1 means that the node is chosen automatically: if the
+   * host has more than one NUMA node and the module has a ``device_id`` parameter, the threads are bound to the node
+   * local to that MLU device. Otherwise, the threads are not bound.
+   */
+  int numaNode = -1;
+  /**
+   * The scaling range of ``parallelism`` used by the autoscaler, see AutoscalerConfig. 0 means ``parallelism``.
+   * The module is scaled only if the range has more than one value. The input queues of a scaled module are
+   * always rebalanced, see ``rebalanceStreams``.
+   */
+  int minParallelism = 0;
+  int maxParallelism = 0;  ///< See ``minParallelism``.
+  /**
+   * Whether the module is fused into the execution stage of its upstream module, see FusePolicy. The ``parallelism``,
+   * input queue and cpu settings of a fused module take no effect, it runs on the threads of the upstream module.
+   */
+  FusePolicy fusePolicy = FusePolicy::AUTO;
+  CircuitBreakerConfig circuitBreaker;  ///< The circuit breaker of the module, see CircuitBreakerConfig.
   std::string className;          ///< The class name of the module.
   std::set<std::string> next;     ///< The name of the downstream modules/subgraphs.
+  /**
+   * The names of the modules in the same graph which must be opened before this module, e.g. the module whose Open
+   * sets up a device or a shared resource used by this module. See SchedulerConfig::parallel_open. The modules
+   * opened one by one are opened in an order respecting it as well.
+   */
+  std::set<std::string> openAfter;
 
   /**
    * @brief Parses members except ``CNModuleConfig::name`` from the JSON file.
@@ -206,6 +827,15 @@ struct CNSubgraphConfig : public CNConfigBase {
  *     "enable_profiling" : true,
  *     "enable_tracing" : true
  *   },
+ *   "scheduler_config" : {
+ *     "work_stealing" : false
+ *   },
+ *   "frame_pool_config" : {
+ *     "enable" : false
+ *   },
+ *   "autoscaler_config" : {
+ *     "enable" : false
+ *   },
  *   "module1": {
  *     "parallelism": 3,
  *     "max_input_queue_size": 20,
@@ -226,6 +856,15 @@ struct CNSubgraphConfig : public CNConfigBase {
 struct CNGraphConfig : public CNConfigBase {
   std::string name = "";                            ///< Graph name.
   ProfilerConfig profiler_config;                   ///< Configuration of profiler.
+  SchedulerConfig scheduler_config;                 ///< Configuration of scheduler.
+  FramePoolConfig frame_pool_config;                ///< Configuration of frame pool.
+  AutoscalerConfig autoscaler_config;               ///< Configuration of autoscaler.
+  MemoryBudgetConfig memory_budget_config;          ///< Configuration of memory budget.
+  MetricsConfig metrics_config;                     ///< Configuration of metrics endpoint.
+  AdmissionConfig admission_config;                 ///< Configuration of admission control.
+  CheckpointConfig checkpoint_config;               ///< Configuration of stream checkpoints.
+  DegradationConfig degradation_config;             ///< Configuration of graceful degradation.
+  CpuIsolationConfig cpu_isolation_config;          ///< Configuration of CPU isolation.
   std::vector<CNModuleConfig> module_configs;       ///< Configurations of modules.
   std::vector<CNSubgraphConfig> subgraph_configs;   ///< Configurations of subgraphs.
 
@@ -0,0 +1,168 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_DEGRADATION_HPP_
+#define CNSTREAM_DEGRADATION_HPP_
+
+/**
+ *  @file cnstream_degradation.hpp
+ *
+ *  This file contains a declaration of the DegradationController class.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "cnstream_common.hpp"
+#include "cnstream_config.hpp"
+
+namespace cnstream {
+
+/**
+ * @struct DegradationSample
+ *
+ * @brief DegradationSample is the state of a pipeline sampled by the degradation controller.
+ */
+struct DegradationSample {
+  double queue_fill_ratio = 0;      ///< The largest ratio of the filled input queues of the modules.
+  bool blocking_upstream = false;   ///< Whether an upstream module is waiting for a full input queue.
+};
+
+/**
+ * @class DegradationController
+ *
+ * @brief DegradationController applies the degradation ladder of a pipeline step by step under sustained overload,
+ * and undoes the steps as the load drops. See DegradationConfig.
+ *
+ * The controller decides the level, the number of steps applied, the steps are carried out by the pipeline. It also
+ * keeps the priorities of the streams and decides which frames skip the degraded modules.
+ *
+ * Pipeline creates a degradation controller when ``degradation_config`` is enabled.
+ */
+class DegradationController : private NonCopyable {
+ public:
+  /**
+   * @brief Gets the state of the pipeline.
+   */
+  using SampleFunc = std::function<DegradationSample()>;
+  /**
+   * @brief Applies or undoes a step. ``level`` is the level after the change.
+   */
+  using ApplyFunc = std::function<void(uint32_t level, const DegradationStep& step, bool apply)>;
+
+  /**
+   * @brief Constructs a degradation controller.
+   *
+   * @param[in] config The configuration of the degradation.
+   * @param[in] apply_func The function applying or undoing a step.
+   */
+  DegradationController(const DegradationConfig& config, ApplyFunc apply_func);
+  /**
+   * @brief Stops the degradation controller.
+   */
+  ~DegradationController();
+  /**
+   * @brief Starts a thread sampling the pipeline every ``interval_ms``.
+   *
+   * @param[in] sample_func The function getting the state of the pipeline.
+   *
+   * @return Returns true if the controller is started. Otherwise, returns false.
+   */
+  bool Start(SampleFunc sample_func);
+  /**
+   * @brief Stops the sampling thread and undoes all steps applied.
+   */
+  void Stop();
+  /**
+   * @brief Updates the level from one sample of the pipeline.
+   *
+   * @param[in] sample The state of the pipeline.
+   */
+  void Update(const DegradationSample& sample);
+  /**
+   * @brief Applies or undoes the steps until the level is reached, e.g. by an operator. The level keeps being updated
+   * by the samples afterwards.
+   *
+   * @param[in] level The number of steps applied, it is capped by the number of steps.
+   */
+  void SetLevel(uint32_t level);
+  /**
+   * @brief Gets the number of steps applied.
+   */
+  uint32_t GetLevel() const { return level_.load(); }
+  /**
+   * @brief Sets the priority of a stream. The streams with higher priorities than ``max_priority`` of a step are not
+   * degraded by it. The default priority is 0.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] priority The priority.
+   */
+  void SetStreamPriority(const std::string& stream_id, int priority);
+  /**
+   * @brief Forgets a stream, e.g. after its EOS.
+   *
+   * @param[in] stream_id The stream identification.
+   */
+  void RemoveStream(const std::string& stream_id);
+  /**
+   * @brief Checks whether a frame of a stream bypasses a degraded module. It is called for each frame sent to the
+   * module while it is degraded.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] module_id The identification of the module.
+   * @param[in] interval One of every ``interval`` frames is processed by the module, 0 means none.
+   * @param[in] max_priority The streams whose priority is greater than it are not degraded.
+   *
+   * @return Returns true if the frame bypasses the module.
+   */
+  bool Bypass(const std::string& stream_id, uint32_t module_id, uint32_t interval, int max_priority);
+
+ private:
+  struct StreamState {
+    int priority = 0;
+    std::map<uint32_t, uint64_t> frames;  // the frames sent to each degraded module
+  };
+  void Loop();
+  // applies or undoes one step, called with level_mtx_ locked
+  void Step(bool apply);
+
+  DegradationConfig config_;
+  ApplyFunc apply_func_;
+  SampleFunc sample_func_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  std::mutex exit_mtx_;
+  std::condition_variable exit_cond_;
+  std::mutex level_mtx_;  // guards the level and the counters of the samples
+  std::atomic<uint32_t> level_{0};
+  uint32_t overloaded_samples_ = 0;
+  uint32_t relieved_samples_ = 0;
+  double last_fill_ratio_ = 0;
+  std::mutex mtx_;  // guards the streams
+  std::map<std::string, StreamState> streams_;
+};  // class DegradationController
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_DEGRADATION_HPP_
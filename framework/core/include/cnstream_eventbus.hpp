@@ -34,6 +34,7 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "cnstream_common.hpp"
 #include "util/cnstream_queue.hpp"
@@ -48,13 +49,16 @@ class Pipeline;
  * @brief Enumeration variables describing the type of event.
  */
 enum class EventType {
-  EVENT_INVALID,      /*!< An invalid event type. */
-  EVENT_ERROR,        /*!< An error event. */
-  EVENT_WARNING,      /*!< A warning event. */
-  EVENT_EOS,          /*!< An EOS event. */
-  EVENT_STOP,         /*!< A stop event. */
-  EVENT_STREAM_ERROR, /*!< A stream error event. */
-  EVENT_TYPE_END      /*!< Reserved for users custom events. */
+  EVENT_INVALID,         /*!< An invalid event type. */
+  EVENT_ERROR,           /*!< An error event. */
+  EVENT_WARNING,         /*!< A warning event. */
+  EVENT_EOS,             /*!< An EOS event. */
+  EVENT_STOP,            /*!< A stop event. */
+  EVENT_STREAM_ERROR,    /*!< A stream error event. */
+  EVENT_CONTROL,         /*!< A control message from outside of the pipeline, e.g. adding or removing a stream. */
+  EVENT_CIRCUIT_BREAKER, /*!< The circuit breaker of a module changes its state, see CircuitBreakerConfig. */
+  EVENT_DEGRADATION,     /*!< A degradation step of the pipeline is applied or undone, see DegradationConfig. */
+  EVENT_TYPE_END         /*!< Reserved for users custom events. */
 };
 
 /**
@@ -80,6 +84,17 @@ struct Event {
   std::string message;        ///< More detailed messages describing the event.
   std::string module_name;    ///< The module that posts this event.
   std::thread::id thread_id;  ///< The thread ID from which the event is posted.
+  uint32_t coalesced = 0;     ///< The number of the same events merged into this one, see EventBus.
+};
+
+/**
+ * @struct EventFilter
+ *
+ * @brief EventFilter selects the events passed to a bus watcher.
+ */
+struct EventFilter {
+  std::vector<EventType> types;  ///< The event types. Empty means all types.
+  std::string stream_id;         ///< The stream. Empty means all streams.
 };
 
 /**
@@ -95,6 +110,10 @@ using BusWatcher = std::function<EventHandleFlag(const Event &)>;
  * @class EventBus
  *
  * @brief EventBus is a class that transmits events from modules to a pipeline.
+ *
+ * Events are posted to a lock-free queue and dispatched to the bus watchers in batches. The error and EOS events of
+ * the same stream and module in one batch are coalesced into the first one, whose ``coalesced`` counts the others, so
+ * that a burst of stream errors does not back up the bus.
  */
 class EventBus : private NonCopyable {
  public:
@@ -112,7 +131,7 @@ class EventBus : private NonCopyable {
    */
   bool Start();
   /**
-   * @brief Stops an event bus thread.
+   * @brief Stops an event bus thread. The events posted before are dispatched before the thread exits.
    *
    * @return No return values.
    */
@@ -125,6 +144,15 @@ class EventBus : private NonCopyable {
    * @return The number of bus watchers that has been added to this event bus.
    */
   uint32_t AddBusWatch(BusWatcher func);
+  /**
+   * @brief Adds a watcher which only handles the events selected by a filter.
+   *
+   * @param[in] func The bus watcher to be added.
+   * @param[in] filter The filter of the events.
+   *
+   * @return The number of bus watchers that has been added to this event bus.
+   */
+  uint32_t AddBusWatch(BusWatcher func, const EventFilter &filter);
 
   /**
    * @brief Posts an event to a bus.
@@ -173,10 +201,14 @@ class EventBus : private NonCopyable {
   bool IsRunning();
 
   void EventLoop();
+  // merges the error and EOS events of the same stream and module
+  static void CoalesceEvents(std::vector<Event> *events);
+  // passes the events to the watchers, returns false if a watcher stops the bus
+  bool DispatchEvents(std::vector<Event> *batch);
 
  private:
   mutable std::mutex watcher_mtx_;
-  ThreadSafeQueue<Event> queue_;
+  MpscQueue<Event> queue_;
 #ifdef UNIT_TEST
   ThreadSafeQueue<Event> test_eventq_;
   bool unit_test = true;
@@ -21,6 +21,9 @@
 #ifndef CNSTREAM_FRAME_HPP_
 #define CNSTREAM_FRAME_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 #include <map>
@@ -28,6 +31,7 @@
 
 #include "cnstream_collection.hpp"
 #include "cnstream_common.hpp"
+#include "private/cnstream_module_mask.hpp"
 #include "util/cnstream_any.hpp"
 
 /**
@@ -39,6 +43,7 @@ namespace cnstream {
 
 class Module;
 class Pipeline;
+struct RouteTable;
 
 /**
  * @enum CNFrameFlag
@@ -139,6 +144,130 @@ CNS_IGNORE_DEPRECATED_POP
    */
   uint32_t GetStreamIndex() const { return channel_idx; }
 
+  /**
+   * @brief Gets the sequence number of the frame in its stream. The pipeline numbers the frames of a stream 0, 1,
+   *        2... in the order they are created, so unlike the timestamp it is unique and dense even if the pts of the
+   *        stream are duplicated or missing. The profilers of the modules key the frames by it.
+   *
+   * @return The sequence number, or -1 if the frame has not entered a pipeline or it is an EOS frame.
+   */
+  int64_t GetSequence() const { return sequence_; }
+
+  /**
+   * @brief Gets the time when the frame is created, which is the time it enters the pipeline.
+   *
+   * @return The creation time on the steady clock.
+   */
+  std::chrono::steady_clock::time_point GetCreateTime() const { return create_time_; }
+
+  /**
+   * @brief Gets how long the frame has been in the pipeline.
+   *
+   * @return The time elapsed since the frame is created. unit[ms].
+   */
+  double GetElapsedTime() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - create_time_).count();
+  }
+
+  /**
+   * @brief Gets the deadline of the frame. A frame is dropped by the first module about to process it after the
+   *        deadline, see Pipeline::SetStreamMaxLatency.
+   *
+   * @return The deadline on the steady clock, or ``time_point::max()`` if the frame never expires.
+   */
+  std::chrono::steady_clock::time_point GetDeadline() const { return deadline_; }
+
+  /**
+   * @brief Sets the deadline of the frame, e.g. by a source module from the time the data arrives. The pipeline
+   *        does not override a deadline set before the frame is transmitted by the source module.
+   *
+   * @param[in] deadline The deadline on the steady clock.
+   */
+  void SetDeadline(std::chrono::steady_clock::time_point deadline) { deadline_ = deadline; }
+
+  /**
+   * @brief A function releasing the pixel data stored in the collection of a frame.
+   */
+  using PixelReleaser = std::function<void(CNFrameInfo* frame)>;
+
+  /**
+   * @brief Registers a function releasing the pixel data of frames. The library defining the data registers it, e.g.
+   *        the planes of CNDataFrame are released by the function registered by the cnstream_va library.
+   *
+   * @param[in] releaser The function. It should keep the other data, e.g. the width and height of the frame.
+   *
+   * @return Returns false if the function is empty.
+   */
+  static bool RegisterPixelReleaser(const PixelReleaser& releaser);
+
+  /**
+   * @brief Releases the pixel data of this frame by the registered functions, so that the buffers are returned, e.g.
+   *        to the decoders, before the frame is released. The pipeline calls it once none of the modules left on the
+   *        route of the frame needs the pixels, see Module::NeedsPixels.
+   *
+   * @return Returns false if the pixel data has been released.
+   */
+  bool ReleasePixels();
+
+  /**
+   * @brief Checks whether the pixel data of this frame has been released by ReleasePixels.
+   *
+   * @return Returns true if the pixel data has been released.
+   */
+  bool IsPixelReleased() const { return pixel_released_.load(); }
+
+  /**
+   * @brief The copies of the pixel data kept for the modules reading them on host or on device.
+   */
+  enum class PixelCopy {
+    HOST = 0,  ///< The copy on host, see Module::NeedsHostPixels.
+    DEVICE     ///< The copy on device, see Module::NeedsDevicePixels.
+  };
+
+  /**
+   * @brief A function releasing a copy of the pixel data stored in the collection of a frame.
+   */
+  using PixelCopyReleaser = std::function<void(CNFrameInfo* frame, PixelCopy copy)>;
+
+  /**
+   * @brief Registers a function releasing a copy of the pixel data of frames, see RegisterPixelReleaser.
+   *
+   * @param[in] releaser The function. It should keep the pixel data if it has only one copy.
+   *
+   * @return Returns false if the function is empty.
+   */
+  static bool RegisterPixelCopyReleaser(const PixelCopyReleaser& releaser);
+
+  /**
+   * @brief Releases a copy of the pixel data of this frame by the registered functions, e.g. the copy on host after
+   *        the last module reading the pixels on host while the frame still goes to the modules reading them on
+   *        device. The pipeline calls it once none of the modules left on the route of the frame needs the copy.
+   *
+   * @param[in] copy The copy to release.
+   *
+   * @return Returns false if the copy or the pixel data has been released.
+   */
+  bool ReleasePixelCopy(PixelCopy copy);
+
+  /**
+   * @brief The times when a frame passes through a module, in nanoseconds of ``std::chrono::steady_clock``. They are
+   *        0 if the frame has not reached the point yet.
+   */
+  struct ModuleTimes {
+    int64_t enqueue = 0;  ///< The time when the frame is pushed into the input queue of the module.
+    int64_t dequeue = 0;  ///< The time when the module starts to process the frame.
+    int64_t done = 0;     ///< The time when the module transmits the frame.
+  };
+
+  /**
+   * @brief Gets the times when this frame passes through each module. They are recorded only if
+   *        ProfilerConfig::enable_profiling is true, and ProfilerConfig::enable_latency_breakdown is true or
+   *        ProfilerConfig::trace_latency_threshold takes effect.
+   *
+   * @return The times indexed by Module::GetId(), empty if they are not recorded.
+   */
+  const std::vector<ModuleTimes>& GetModuleTimes() const { return module_times_; }
+
   std::string stream_id;  /*!< The data stream aliases where this frame is located to. */
   int64_t timestamp = -1; /*!< The time stamp of this frame. */
   size_t flags = 0;       /*!< The mask for this frame, ``CNFrameFlag``. */
@@ -155,14 +284,26 @@ CNS_IGNORE_DEPRECATED_POP
    * The below methods and members are used by the framework.
    */
   friend class Pipeline;
+  friend class CNFrameInfoPool;
+  void Init(const std::string& stream_id, bool eos, std::shared_ptr<CNFrameInfo> payload);
+  void MarkEosReached();
+  void Reset();  // resets members except collection to the initial values, used by CNFrameInfoPool
   mutable uint32_t channel_idx = INVALID_STREAM_IDX;        ///< The index of the channel, stream_index
-  void SetModulesMask(uint64_t mask);
-  uint64_t GetModulesMask();
-  uint64_t MarkPassed(Module* current);  // return changed mask
+  int64_t sequence_ = -1;
+  std::chrono::steady_clock::time_point create_time_;
+  std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+  void SetModulesMask(const ModuleMask& mask);
+  ModuleMask GetModulesMask();
+  ModuleMask MarkPassed(Module* current);  // return changed mask
 
-  std::mutex mask_lock_;
   /* Identifies which modules have processed this data */
-  uint64_t modules_mask_ = 0;
+  AtomicModuleMask modules_mask_;
+  std::atomic<bool> pixel_released_{false};
+  std::atomic<uint32_t> pixel_copies_released_{0};  // bit i is set if PixelCopy i has been released
+  // every module writes its own element, the size is fixed before the frame enters the pipeline
+  std::vector<ModuleTimes> module_times_;
+  // the routes taken when the frame enters the pipeline, the branches attached later are not taken.
+  std::shared_ptr<const RouteTable> routes_;
 };
 
 /*!
@@ -0,0 +1,154 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+#ifndef CNSTREAM_FRAME_POOL_HPP_
+#define CNSTREAM_FRAME_POOL_HPP_
+
+/**
+ *  @file cnstream_frame_pool.hpp
+ *
+ *  This file contains a declaration of the CNFrameInfoPool class.
+ */
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "cnstream_common.hpp"
+#include "cnstream_frame.hpp"
+#include "util/cnstream_any.hpp"
+
+namespace cnstream {
+
+/**
+ * @class CNFrameInfoPool
+ *
+ * @brief CNFrameInfoPool hands out recycled CNFrameInfo instances to save the memory allocations for each frame.
+ *
+ * A frame goes back to the pool when the last ``shared_ptr`` to it is released. The members of the frame are reset,
+ * and the data in the collection is removed, except the data whose tag is registered with a recycler and the
+ * recycler resets it successfully. If the pool is destroyed, the frames still in use are deleted when released.
+ *
+ * If ``max_frames`` is set, at most ``max_frames`` frames (EOS frames excluded) are in use at the same time, and
+ * ``Create`` returns NULL when the limit is reached. Sources call ``WaitForIdle`` to block until a frame is released.
+ *
+ * Pipeline creates a pool when ``frame_pool_config`` is enabled, see FramePoolConfig.
+ */
+class CNFrameInfoPool : private NonCopyable {
+ public:
+  /**
+   * @brief Resets the data in the collection of a recycled frame.
+   *
+   * @param[in] value The data to reset.
+   *
+   * @return Returns true if the data is reset and could be kept in the collection, otherwise returns false.
+   */
+  using Recycler = std::function<bool(cnstream::any* value)>;
+
+  /**
+   * @brief Constructs a pool.
+   *
+   * @param[in] capacity The maximum number of idle frames kept by the pool.
+   * @param[in] max_frames The maximum number of frames in use. 0 means no limit.
+   */
+  explicit CNFrameInfoPool(size_t capacity, size_t max_frames = 0);
+  /**
+   * @brief Destructs the pool and deletes the idle frames.
+   */
+  ~CNFrameInfoPool();
+  /**
+   * @brief Gets a frame from the pool, or creates a new one when there is no idle frame.
+   *
+   * The parameters are the same as CNFrameInfo::Create.
+   *
+   * @return Returns ``shared_ptr`` of ``CNFrameInfo`` if this function has run successfully. Otherwise, returns NULL.
+   *         NULL is also returned for non-EOS frames when ``max_frames`` frames are in use.
+   */
+  std::shared_ptr<CNFrameInfo> Create(const std::string& stream_id, bool eos = false,
+                                      std::shared_ptr<CNFrameInfo> payload = nullptr);
+  /**
+   * @brief Registers a recycler for the data tagged by ``tag``.
+   *
+   * @param[in] tag The tag of the data in CNFrameInfo::collection.
+   * @param[in] recycler The recycler.
+   *
+   * @return No return value.
+   */
+  void RegisterRecycler(const std::string& tag, Recycler recycler);
+  /**
+   * @brief Registers a recycler for the data of type ``std::shared_ptr<ValueT>``.
+   *
+   * The object is destructed and constructed by default in place, so that its memory is reused. Only the object
+   * not shared with others is recycled.
+   *
+   * @param[in] tag The tag of the data in CNFrameInfo::collection.
+   *
+   * @return No return value.
+   */
+  template <typename ValueT>
+  void RegisterRecycler(const std::string& tag);
+  /**
+   * @brief Gets the maximum number of idle frames kept by the pool.
+   */
+  size_t GetCapacity() const { return capacity_; }
+  /**
+   * @brief Gets the number of idle frames in the pool.
+   */
+  size_t GetIdleNumber() const;
+  /**
+   * @brief Gets the maximum number of frames in use. 0 means no limit.
+   */
+  size_t GetMaxFrames() const { return max_frames_; }
+  /**
+   * @brief Gets the number of frames in use, EOS frames excluded. It is always 0 if ``max_frames`` is 0.
+   */
+  size_t GetInUseNumber() const;
+  /**
+   * @brief Waits until a frame could be created, i.e. the number of frames in use is less than ``max_frames``.
+   *
+   * The waiting thread is woken up when a frame is released, it does not poll.
+   *
+   * @param[in] timeout_ms The maximum time to wait in milliseconds.
+   *
+   * @return Returns true if a frame could be created. Returns false on timeout.
+   */
+  bool WaitForIdle(uint32_t timeout_ms) const;
+
+ private:
+  struct Impl;
+  const size_t capacity_;
+  const size_t max_frames_;
+  std::shared_ptr<Impl> impl_;  // shared with the deleters of frames
+};  // class CNFrameInfoPool
+
+template <typename ValueT>
+void CNFrameInfoPool::RegisterRecycler(const std::string& tag) {
+  RegisterRecycler(tag, [](cnstream::any* value) {
+    auto ptr = any_cast<std::shared_ptr<ValueT>>(value);
+    if (!ptr || !*ptr || ptr->use_count() != 1) return false;
+    ValueT* obj = ptr->get();
+    obj->~ValueT();
+    new (obj) ValueT();
+    return true;
+  });
+}
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_FRAME_POOL_HPP_
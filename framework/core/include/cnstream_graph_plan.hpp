@@ -0,0 +1,162 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_GRAPH_PLAN_HPP_
+#define CNSTREAM_GRAPH_PLAN_HPP_
+
+/**
+ * @file cnstream_graph_plan.hpp
+ *
+ * This file contains a declaration of the CNGraphPlan struct and the CNGraphPlanCache class.
+ */
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_config.hpp"
+#include "private/cnstream_common_pri.hpp"
+
+namespace cnstream {
+
+/**
+ * @struct CNGraphPlan
+ *
+ * @brief CNGraphPlan is a graph configuration compiled into an immutable plan. The subgraphs are expanded, the graph
+ * is checked and sorted once, and the plan is used to build any number of pipelines by Pipeline::BuildPipeline
+ * without parsing the configuration files or running the graph algorithms again.
+ *
+ * @see CNGraphPlanCache
+ */
+struct CNGraphPlan {
+  /**
+   * @brief A module of the expanded graph.
+   */
+  struct Node {
+    std::string name;               ///< The name with the subgraph prefixes, e.g. "subgraph/module".
+    std::vector<uint32_t> parents;  ///< The indices of the parent nodes, empty for the head nodes.
+    std::vector<uint32_t> routes;   ///< The indices of the nodes reached from a head node, including itself.
+  };  // struct Node
+
+  uint64_t hash = 0;     ///< The hash of the JSON configuration, 0 if the plan is not compiled from JSON.
+  CNGraphConfig config;  ///< The configuration of the root graph.
+  std::map<std::string, CNGraphConfig> subgraph_configs;  ///< The parsed subgraphs, keyed by the config path.
+  std::vector<Node> nodes;  ///< The nodes in DFS order, the order in which the modules are created.
+  std::vector<uint32_t> topo_order;  ///< The indices of the nodes in topological order.
+
+  /**
+   * @brief Compiles a graph configuration.
+   *
+   * @param[in] config The graph configuration, the subgraph configuration files are parsed.
+   * @param[in] hash The hash of the configuration, see CNGraphPlan::Hash.
+   *
+   * @return Returns the plan, nullptr if the graph is not valid.
+   */
+  static std::shared_ptr<const CNGraphPlan> Compile(const CNGraphConfig& config, uint64_t hash = 0);
+  /**
+   * @brief Hashes a JSON configuration (FNV-1a) together with the directory its relative paths are resolved in.
+   *
+   * @param[in] jstr The configuration in JSON format.
+   * @param[in] config_root_dir The directory of the configuration file, see CNConfigBase::config_root_dir.
+   *
+   * @return Returns the hash.
+   */
+  static uint64_t Hash(const std::string& jstr, const std::string& config_root_dir);
+};  // struct CNGraphPlan
+
+/**
+ * @class CNGraphPlanCache
+ *
+ * @brief CNGraphPlanCache keeps the plans compiled from JSON configurations, keyed by the hash of the configuration.
+ * The least recently used plans are evicted once the capacity is reached. The plans are shared by the pipelines, they
+ * are never modified.
+ *
+ * @note The subgraph configuration files are read only when a plan is compiled, so that the changes of them are
+ *       seen after CNGraphPlanCache::Clear is called.
+ */
+class CNGraphPlanCache : public NonCopyable {
+ public:
+  /**
+   * @brief Gets the process-wide cache.
+   *
+   * @return The cache instance.
+   */
+  static CNGraphPlanCache& Instance();
+  /**
+   * @brief Gets the plan of a JSON configuration, compiles it if it is not cached.
+   *
+   * @param[in] jstr The configuration in JSON format.
+   * @param[in] config_root_dir The directory the relative paths in the configuration are relative to.
+   *
+   * @return Returns the plan, nullptr if the configuration fails to be parsed or compiled.
+   */
+  std::shared_ptr<const CNGraphPlan> GetByJSONStr(const std::string& jstr, const std::string& config_root_dir = "");
+  /**
+   * @brief Gets the plan of a JSON configuration file, compiles it if the content of the file is not cached.
+   *
+   * @param[in] config_file The configuration file.
+   *
+   * @return Returns the plan, nullptr if the file fails to be read, parsed or compiled.
+   */
+  std::shared_ptr<const CNGraphPlan> GetByJSONFile(const std::string& config_file);
+  /**
+   * @brief Sets the max number of plans cached, 64 by default. The least recently used plans are evicted at once.
+   *
+   * @param[in] capacity The capacity, 0 disables caching.
+   *
+   * @return No return value.
+   */
+  void SetCapacity(size_t capacity);
+  /**
+   * @brief Gets the number of plans cached.
+   *
+   * @return Returns the number of plans.
+   */
+  size_t Size() const;
+  /**
+   * @brief Removes all plans. The plans held by the callers are still valid.
+   *
+   * @return No return value.
+   */
+  void Clear();
+
+ private:
+  CNGraphPlanCache() = default;
+  void Evict();
+
+  struct Entry {
+    uint64_t hash;
+    std::string key;  // config_root_dir + '\0' + JSON, compared on hash hits
+    std::shared_ptr<const CNGraphPlan> plan;
+  };
+  mutable std::mutex mutex_;
+  size_t capacity_ = 64;
+  std::list<Entry> entries_;  // the most recently used first
+  std::multimap<uint64_t, std::list<Entry>::iterator> index_;
+};  // class CNGraphPlanCache
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_GRAPH_PLAN_HPP_
@@ -20,6 +20,8 @@
 #include <gflags/gflags.h>
 #include <time.h>
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <streambuf>
 #include <ostream>
@@ -53,6 +55,16 @@ DECLARE_bool(log_to_stderr);
  */
 DECLARE_bool(log_to_file);
 
+/**
+ * @brief Log messages are written by a background thread, default false
+ *
+ * The threads logging only copy their messages to their own lock-free buffers, the prefixes are formatted and the
+ * messages are written to stderr and the log file by one thread in batches. The messages are dropped and counted if
+ * the buffer of a thread is full, see GetDroppedLogCount. It takes effect from InitCNStreamLogging to
+ * ShutdownCNStreamLogging, the sinks are still called by the threads logging.
+ */
+DECLARE_bool(log_async);
+
 #define STR(src) #src
 
 #define LOGF(category) \
@@ -94,8 +106,81 @@ DECLARE_bool(log_to_file);
 #define LOGA_IF(category, condition)                                                     \
   !(condition) ? (void) 0 : cnstream::LogMessageVoidify() & LOGA(category)
 
+/**
+ * @brief Rate-limited logs, for the messages which may be logged for every frame, e.g. decoding errors.
+ *
+ * The limit is kept for each call site, shared by all threads and streams. The first message logged after some are
+ * suppressed starts with the number of the suppressed ones.
+ *
+ * Usage:
+ *   LOGW_EVERY_N(SOURCE, 100) << "...";       // the 1st, 101st, 201st... messages
+ *   LOGW_EVERY_T(SOURCE, 1) << "...";         // at most one message every second
+ *   LOGW_RATE_LIMITED(SOURCE, 10, 5) << "...";  // 10 messages per second, up to 5 at once
+ */
+#define CNSTREAM_LOG_LIMITED(log_macro, category, limiter_ctor)                                                  \
+  for (int64_t cnstream_log_suppressed = [&]() -> cnstream::LogRateLimiter& {                                    \
+         static cnstream::LogRateLimiter limiter limiter_ctor;                                                   \
+         return limiter;                                                                                         \
+       }().Allow();                                                                                               \
+       cnstream_log_suppressed >= 0; cnstream_log_suppressed = -1)                                               \
+    log_macro(category) << cnstream::LogSuppressed{cnstream_log_suppressed}
+
+#define LOGE_EVERY_N(category, n) CNSTREAM_LOG_LIMITED(LOGE, category, (static_cast<uint64_t>(n)))
+#define LOGW_EVERY_N(category, n) CNSTREAM_LOG_LIMITED(LOGW, category, (static_cast<uint64_t>(n)))
+#define LOGI_EVERY_N(category, n) CNSTREAM_LOG_LIMITED(LOGI, category, (static_cast<uint64_t>(n)))
+#define LOGD_EVERY_N(category, n) CNSTREAM_LOG_LIMITED(LOGD, category, (static_cast<uint64_t>(n)))
+
+#define LOGE_EVERY_T(category, seconds) CNSTREAM_LOG_LIMITED(LOGE, category, (1.0 / (seconds), 1))
+#define LOGW_EVERY_T(category, seconds) CNSTREAM_LOG_LIMITED(LOGW, category, (1.0 / (seconds), 1))
+#define LOGI_EVERY_T(category, seconds) CNSTREAM_LOG_LIMITED(LOGI, category, (1.0 / (seconds), 1))
+#define LOGD_EVERY_T(category, seconds) CNSTREAM_LOG_LIMITED(LOGD, category, (1.0 / (seconds), 1))
+
+#define LOGE_RATE_LIMITED(category, rate, burst) CNSTREAM_LOG_LIMITED(LOGE, category, (rate, burst))
+#define LOGW_RATE_LIMITED(category, rate, burst) CNSTREAM_LOG_LIMITED(LOGW, category, (rate, burst))
+#define LOGI_RATE_LIMITED(category, rate, burst) CNSTREAM_LOG_LIMITED(LOGI, category, (rate, burst))
+#define LOGD_RATE_LIMITED(category, rate, burst) CNSTREAM_LOG_LIMITED(LOGD, category, (rate, burst))
+
 namespace cnstream {
 
+/**
+ * @brief LogRateLimiter decides which messages of a call site are logged, see LOGW_EVERY_N etc. It is lock-free.
+ */
+class LogRateLimiter {
+ public:
+  /**
+   * @brief Logs one of every n messages.
+   */
+  explicit LogRateLimiter(uint64_t n) : every_n_(n ? n : 1) {}
+  /**
+   * @brief Logs rate messages per second, and burst messages at once. It is a token bucket refilled at rate, holding
+   * burst tokens at most.
+   */
+  LogRateLimiter(double rate, uint32_t burst);
+  /**
+   * @brief Checks whether a message is logged.
+   *
+   * @return Returns the number of the messages suppressed since the latest one logged, or -1 if the message is
+   * suppressed.
+   */
+  int64_t Allow();
+
+ private:
+  uint64_t every_n_ = 0;  // 0 if it is a token bucket
+  int64_t interval_ns_ = 0;
+  int64_t tolerance_ns_ = 0;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<int64_t> tat_{0};  // the theoretical arrival time of the next message, see Allow
+  std::atomic<uint64_t> suppressed_{0};
+};  // class LogRateLimiter
+
+/**
+ * @brief Writes the number of the suppressed messages before a rate-limited message, nothing if it is 0.
+ */
+struct LogSuppressed {
+  int64_t num;
+};
+std::ostream& operator<<(std::ostream& os, const LogSuppressed& suppressed);
+
 /**
  * @brief log severity
  * 0, FATAL
@@ -180,6 +265,8 @@ class LogMessage {
   LogMessage& operator=(const LogMessage&) = delete;
   void Flush();
   void SendToLog();
+  // formats the prefix of a message deferred to the log writer on this thread, see FLAGS_log_async
+  void FormatDeferredPrefix();
   LogMessageData* data_;
   LogMessageData* allocated_;
   static const size_t MaxLogMsgLen;
@@ -193,6 +280,11 @@ void RemoveLogSink(LogSink* log_sink);
 
 void ShutdownCNStreamLogging();
 
+/**
+ * @brief Gets the number of the messages dropped as the log buffers are full, see FLAGS_log_async.
+ */
+uint64_t GetDroppedLogCount();
+
 }  // namespace cnstream
 
 #endif  // CNSTREAM_CORE_LOGGING_HPP_
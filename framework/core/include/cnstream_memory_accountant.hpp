@@ -0,0 +1,318 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_MEMORY_ACCOUNTANT_HPP_
+#define CNSTREAM_MEMORY_ACCOUNTANT_HPP_
+
+/**
+ *  @file cnstream_memory_accountant.hpp
+ *
+ *  This file contains a declaration of the MemoryAccountant class.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Types of the memory tracked by the memory accountant.
+ */
+enum class MemoryType {
+  HOST = 0,    ///< Host memory, including page-locked memory.
+  DEVICE = 1,  ///< MLU memory.
+};
+
+/**
+ * @struct MemoryUsage
+ *
+ * @brief MemoryUsage is the memory held by a pipeline, a stream or the whole process.
+ */
+struct MemoryUsage {
+  int64_t host_bytes = 0;         ///< The host memory currently held.
+  int64_t device_bytes = 0;       ///< The MLU memory currently held.
+  int64_t peak_host_bytes = 0;    ///< The high-water mark of host_bytes.
+  int64_t peak_device_bytes = 0;  ///< The high-water mark of device_bytes.
+};
+
+class MemoryAccount;
+
+/**
+ * @class MemoryOwner
+ *
+ * @brief MemoryOwner identifies the pipeline and the stream which memory is charged to.
+ *
+ * Each thread has a current owner. The pipeline sets it to the stream of the data being processed, and source
+ * handlers set it to their stream, see SourceHandler::BindMemoryOwner. An empty owner charges the process only.
+ */
+class MemoryOwner {
+ public:
+  /**
+   * @brief Constructs an empty owner.
+   *
+   * @return No return value.
+   */
+  MemoryOwner() = default;
+  /**
+   * @brief Gets the current owner of the calling thread.
+   *
+   * @return Returns the current owner.
+   */
+  static MemoryOwner Current();
+  /**
+   * @brief Sets the current owner of the calling thread.
+   *
+   * @param[in] owner The owner which memory allocated by the calling thread is charged to.
+   *
+   * @return No return value.
+   */
+  static void SetCurrent(const MemoryOwner& owner);
+  /**
+   * @brief Checks whether the owner is empty.
+   *
+   * @return Returns true if the owner belongs to no pipeline.
+   */
+  bool Empty() const { return nullptr == pipeline_; }
+
+ private:
+  friend class MemoryAccountant;
+  friend class MemoryCharge;
+  std::shared_ptr<MemoryAccount> pipeline_ = nullptr;
+  std::shared_ptr<MemoryAccount> stream_ = nullptr;
+};  // class MemoryOwner
+
+/**
+ * @class MemoryCharge
+ *
+ * @brief MemoryCharge records an allocation in the memory accountant until it is released or destructed.
+ *
+ * Nothing is recorded if the accountant is disabled when the charge is made.
+ */
+class MemoryCharge {
+ public:
+  /**
+   * @brief Constructs an empty charge.
+   *
+   * @return No return value.
+   */
+  MemoryCharge() = default;
+  /**
+   * @brief Charges memory to an owner and to the process.
+   *
+   * @param[in] type The memory type.
+   * @param[in] bytes The size of the memory.
+   * @param[in] owner The owner, the current owner of the calling thread by default.
+   *
+   * @return No return value.
+   */
+  MemoryCharge(MemoryType type, size_t bytes, const MemoryOwner& owner = MemoryOwner::Current());
+  /**
+   * @brief Releases the charge.
+   *
+   * @return No return value.
+   */
+  ~MemoryCharge() { Release(); }
+  /**
+   * @brief Takes over the charge of another object.
+   *
+   * @param[in] other The charge to be moved.
+   *
+   * @return No return value.
+   */
+  MemoryCharge(MemoryCharge&& other) noexcept;
+  /**
+   * @brief Releases the current charge and takes over the charge of another object.
+   *
+   * @param[in] other The charge to be moved.
+   *
+   * @return Returns a lvalue reference to the current instance.
+   */
+  MemoryCharge& operator=(MemoryCharge&& other) noexcept;
+  /**
+   * @brief Gives the charged memory back to its owner. The charge is empty afterwards.
+   *
+   * @return No return value.
+   */
+  void Release();
+  /**
+   * @brief Gets the charged size.
+   *
+   * @return Returns the charged size, 0 if the charge is empty.
+   */
+  size_t GetBytes() const { return bytes_; }
+
+ private:
+  MemoryCharge(const MemoryCharge&) = delete;
+  MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+  MemoryType type_ = MemoryType::HOST;
+  size_t bytes_ = 0;
+  MemoryOwner owner_;
+};  // class MemoryCharge
+
+/**
+ * @class MemoryAccountant
+ *
+ * @brief MemoryAccountant tracks the memory held by frames, decoders and other buffers of each pipeline and stream.
+ *
+ * Budgets can be set for a pipeline and for each of its streams. A source waits in SourceModule::SendData while its
+ * stream or its pipeline is over budget, so that the downstream modules release memory before the next allocations
+ * fail. The accountant is disabled by default, it is enabled by the pipeline if MemoryBudgetConfig or profiling is
+ * enabled.
+ *
+ * @see MemoryBudgetConfig
+ */
+class MemoryAccountant : public NonCopyable {
+ public:
+  /**
+   * @brief Gets the process-wide accountant.
+   *
+   * @return The accountant instance.
+   */
+  static MemoryAccountant& Instance();
+  /**
+   * @brief Enables or disables the accounting. Charges made before are still released.
+   *
+   * @param[in] enable Whether to record allocations.
+   *
+   * @return No return value.
+   */
+  void SetEnable(bool enable) { enable_.store(enable); }
+  /**
+   * @brief Checks whether the accounting is enabled.
+   *
+   * @return Returns true if allocations are recorded.
+   */
+  bool IsEnabled() const { return enable_.load(std::memory_order_relaxed); }
+  /**
+   * @brief Gets the owner of a stream, accounts are created on first use.
+   *
+   * @param[in] pipeline_name The name of the pipeline.
+   * @param[in] stream_id The stream identifier, empty means the pipeline itself.
+   *
+   * @return Returns the owner.
+   */
+  MemoryOwner GetOwner(const std::string& pipeline_name, const std::string& stream_id = "");
+  /**
+   * @brief Sets the budget of a pipeline.
+   *
+   * @param[in] pipeline_name The name of the pipeline.
+   * @param[in] type The memory type.
+   * @param[in] bytes The budget, 0 means unlimited.
+   *
+   * @return No return value.
+   */
+  void SetBudget(const std::string& pipeline_name, MemoryType type, size_t bytes);
+  /**
+   * @brief Sets the budget of each stream of a pipeline.
+   *
+   * @param[in] pipeline_name The name of the pipeline.
+   * @param[in] type The memory type.
+   * @param[in] bytes The budget, 0 means unlimited.
+   *
+   * @return No return value.
+   */
+  void SetStreamBudget(const std::string& pipeline_name, MemoryType type, size_t bytes);
+  /**
+   * @brief Checks whether the stream or the pipeline of the owner holds more memory than its budget.
+   *
+   * @param[in] owner The owner.
+   *
+   * @return Returns true if a budget is exceeded. Returns false for an empty owner.
+   */
+  bool IsOverBudget(const MemoryOwner& owner) const;
+  /**
+   * @brief Waits until the owner is within its budgets.
+   *
+   * @param[in] owner The owner.
+   * @param[in] timeout_ms The maximum time to wait.
+   *
+   * @return Returns true if the owner is within its budgets, false if timed out.
+   */
+  bool WaitForBudget(const MemoryOwner& owner, uint32_t timeout_ms);
+  /**
+   * @brief Gets the memory held by a pipeline.
+   *
+   * @param[in] pipeline_name The name of the pipeline.
+   *
+   * @return Returns the usage, all zeros if the pipeline has no account.
+   */
+  MemoryUsage GetUsage(const std::string& pipeline_name) const;
+  /**
+   * @brief Gets the memory held by each stream of a pipeline.
+   *
+   * @param[in] pipeline_name The name of the pipeline.
+   *
+   * @return Returns the usages of the streams, indexed by stream identifier.
+   */
+  std::map<std::string, MemoryUsage> GetStreamUsages(const std::string& pipeline_name) const;
+  /**
+   * @brief Gets the memory held by the whole process.
+   *
+   * @return Returns the usage.
+   */
+  MemoryUsage GetTotalUsage() const;
+  /**
+   * @brief Removes the account of a stream. Memory still held by the stream is credited to the removed account when
+   * it is released, the next charge of the same stream identifier creates a new account.
+   *
+   * @param[in] pipeline_name The name of the pipeline.
+   * @param[in] stream_id The stream identifier.
+   *
+   * @return No return value.
+   */
+  void RemoveStream(const std::string& pipeline_name, const std::string& stream_id);
+  /**
+   * @brief Removes the accounts of a pipeline and its streams.
+   *
+   * @param[in] pipeline_name The name of the pipeline.
+   *
+   * @return No return value.
+   */
+  void RemovePipeline(const std::string& pipeline_name);
+
+ private:
+  friend class MemoryCharge;
+  MemoryAccountant();
+  void Charge(MemoryType type, int64_t bytes, const MemoryOwner& owner);
+  void Discharge(MemoryType type, int64_t bytes, const MemoryOwner& owner);
+
+  struct PipelineAccounts {
+    std::shared_ptr<MemoryAccount> account;
+    std::map<std::string, std::shared_ptr<MemoryAccount>> streams;
+  };
+  std::atomic<bool> enable_{false};
+  std::shared_ptr<MemoryAccount> total_;
+  mutable std::mutex mutex_;
+  std::map<std::string, PipelineAccounts> pipelines_;
+  std::mutex wait_mtx_;
+  std::condition_variable wait_cond_;
+  std::atomic<int> waiter_num_{0};
+};  // class MemoryAccountant
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_MEMORY_ACCOUNTANT_HPP_
@@ -0,0 +1,153 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_METRICS_EXPORTER_HPP_
+#define CNSTREAM_METRICS_EXPORTER_HPP_
+
+/**
+ *  @file cnstream_metrics_exporter.hpp
+ *
+ *  This file contains the declarations of the OpenMetricsWriter and the MetricsExporter class.
+ */
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cnstream_common.hpp"
+#include "cnstream_config.hpp"
+
+namespace cnstream {
+
+/**
+ * @class OpenMetricsWriter
+ *
+ * @brief OpenMetricsWriter writes metrics in the OpenMetrics text format.
+ *
+ * A metric family is started by AddFamily and followed by its samples, the samples of a family must not be
+ * interleaved with the ones of another family. Counter samples are named with the ``_total`` suffix, summary samples
+ * with a ``quantile`` label and the ``_sum`` and ``_count`` suffixes.
+ */
+class OpenMetricsWriter {
+ public:
+  /**
+   * @brief The label names and values of a sample.
+   */
+  using Labels = std::vector<std::pair<std::string, std::string>>;
+
+  /**
+   * @brief Starts a metric family.
+   *
+   * @param[in] name The name of the family, e.g. "cnstream_frames" for the samples named "cnstream_frames_total".
+   * @param[in] type The type of the family, e.g. "counter", "gauge" or "summary".
+   * @param[in] help The description of the family.
+   * @param[in] unit The unit of the family, it should be the suffix of the name. Empty if the family has no unit.
+   */
+  void AddFamily(const std::string& name, const std::string& type, const std::string& help,
+                 const std::string& unit = "");
+  /**
+   * @brief Adds a sample of the current family.
+   *
+   * @param[in] name The name of the sample.
+   * @param[in] labels The labels of the sample.
+   * @param[in] value The value.
+   */
+  void AddSample(const std::string& name, const Labels& labels, double value);
+  /**
+   * @brief Gets the text ending with "# EOF". The writer is reset.
+   */
+  std::string Finish();
+
+ private:
+  std::string text_;
+};  // class OpenMetricsWriter
+
+/**
+ * @class MetricsExporter
+ *
+ * @brief MetricsExporter serves the metrics of a pipeline over HTTP, so that they can be scraped by Prometheus.
+ *
+ * A thread accepts the connections and answers one request on each of them. ``GET`` (and ``HEAD``) requests of the
+ * configured path are answered with the text collected for the request, the others are answered with 404 or 405.
+ * The metrics are collected only when they are scraped.
+ *
+ * Pipeline creates an exporter while it is running when ``metrics_config`` is enabled, see MetricsConfig.
+ */
+class MetricsExporter : private NonCopyable {
+ public:
+  /**
+   * @brief Gets the metrics in the OpenMetrics text format.
+   */
+  using CollectFunc = std::function<std::string()>;
+
+  /**
+   * @brief The content type of the responses.
+   */
+  static constexpr char kContentType[] = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+  /**
+   * @brief Constructs an exporter.
+   *
+   * @param[in] config The configuration of the exporter.
+   */
+  explicit MetricsExporter(const MetricsConfig& config);
+  /**
+   * @brief Stops the exporter.
+   */
+  ~MetricsExporter();
+  /**
+   * @brief Listens on the port and starts the serving thread.
+   *
+   * @param[in] collect_func The function collecting the metrics.
+   *
+   * @return Returns true if the exporter is started. Otherwise, returns false, e.g. the port is in use.
+   */
+  bool Start(CollectFunc collect_func);
+  /**
+   * @brief Stops the serving thread and closes the port.
+   */
+  void Stop();
+  /**
+   * @brief Returns true if the serving thread is running.
+   */
+  bool IsRunning() const { return running_.load(); }
+  /**
+   * @brief Gets the port listened on, it is useful when MetricsConfig::port is 0. Returns 0 if not running.
+   */
+  uint16_t GetPort() const { return port_; }
+
+ private:
+  void Loop();
+  void Serve(int fd);
+
+  MetricsConfig config_;
+  CollectFunc collect_func_;
+  std::atomic<bool> running_{false};
+  int listen_fd_ = -1;
+  uint16_t port_ = 0;
+  std::thread thread_;
+};  // class MetricsExporter
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_METRICS_EXPORTER_HPP_
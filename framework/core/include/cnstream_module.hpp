@@ -27,13 +27,17 @@
 #include <unistd.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <typeinfo>
 #include <map>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -145,6 +149,20 @@ class Module : private NonCopyable {
    */
   virtual int Process(std::shared_ptr<CNFrameInfo> data) = 0;
 
+  /**
+   * @brief Processes a batch of data. It is called instead of ``Process`` when ``max_batch_size`` of
+   *        this module is greater than 1.
+   *
+   * @param[in] data_vec The data to be processed by the module. EOS frames are never in a batch.
+   *
+   * @retval >=0: The data is processed successfully.
+   * @retval <0: Pipeline will post an event with the EVENT_ERROR event type and the return number.
+   *
+   * @note The default implementation calls ``Process`` for each data in order and returns the first
+   *       negative return value. Override it to make use of batched hardware.
+   */
+  virtual int ProcessBatch(std::vector<std::shared_ptr<CNFrameInfo>>& data_vec);  // NOLINT
+
   /**
    * @brief Notifies flow-EOS arriving, the module should reset internal status if needed.
    *
@@ -154,6 +172,96 @@ class Module : private NonCopyable {
    */
   virtual void OnEos(const std::string &stream_id) {}
 
+  /**
+   * @brief Notifies that a stream has been added to a source module upstream of this module while the pipeline is
+   *        running. It is called by the framework on the thread adding the stream, usually before the first frame
+   *        of the stream arrives.
+   *
+   * @param[in] stream_id The stream identification.
+   *
+   * @note Modules override it to prepare the context of the stream ahead, see StreamContextPool. The source module
+   *       waits for it, so it should not block long.
+   */
+  virtual void OnStreamAdded(const std::string &stream_id) {}
+
+  /**
+   * @brief Notifies that the data is routed to this module. It is called by the framework on the thread of the
+   *        upstream module, before the data is pushed into the input queue of this module.
+   *
+   * @param[in] data The data routed to this module. EOS frames are not notified.
+   *
+   * @note Modules that need the frame on host (or device) override it to start an asynchronous copy,
+   *       so that the copy is done while the data is waiting in the queue. It should not block.
+   */
+  virtual void Prefetch(const std::shared_ptr<CNFrameInfo> &data) {}
+
+  /**
+   * @brief Gets the frame resolution this module works on. Source modules may decode frames to this resolution
+   *        directly when this module is their first consumer.
+   *
+   * @param[out] width The preferred frame width.
+   * @param[out] height The preferred frame height.
+   *
+   * @return Returns false if this module has no preference, e.g. it needs the frames in the original resolution.
+   *
+   * @note It is called after the module has been opened.
+   */
+  virtual bool GetPreferredFrameSize(uint32_t *width, uint32_t *height) const { return false; }
+
+  /**
+   * @brief Checks whether this module reads the pixels of frames. When no module left on the route of a frame needs
+   *        the pixels, the pipeline releases them early and passes the metadata only, see CNFrameInfo::ReleasePixels.
+   *
+   * @return Returns true by default. Modules working on the inference results only should return false.
+   *
+   * @note It is called after the module has been opened.
+   */
+  virtual bool NeedsPixels() const { return true; }
+
+  /**
+   * @brief Checks whether this module reads the pixels of frames on host. When no module left on the route of a frame
+   *        reads the pixels on host, the pipeline releases the copy on host if the pixels are synchronized to device
+   *        as well, see CNFrameInfo::ReleasePixelCopy.
+   *
+   * @return Returns true by default. It takes effect only if NeedsPixels returns true.
+   *
+   * @note It is called after the module has been opened.
+   */
+  virtual bool NeedsHostPixels() const { return true; }
+
+  /**
+   * @brief Checks whether this module reads the pixels of frames on device, see NeedsHostPixels.
+   *
+   * @return Returns true by default. It takes effect only if NeedsPixels returns true.
+   *
+   * @note It is called after the module has been opened.
+   */
+  virtual bool NeedsDevicePixels() const { return true; }
+
+  /**
+   * @brief Checks whether this module is light enough to run on the thread of its upstream module. A fusable module
+   *        is fused into the execution stage of its upstream module when possible, see FusePolicy.
+   *
+   * @return Returns false by default. Modules whose ``Process`` is short and never blocks, e.g. filters, may return
+   *         true.
+   *
+   * @note It is called before the module is opened.
+   */
+  virtual bool IsFusable() const { return false; }
+
+  /**
+   * @brief Scales the frames this module outputs, e.g. a source module decodes the frames to a lower resolution when
+   *        the pipeline is degraded, see DegradationConfig.
+   *
+   * @param[in] scale The ratio of the width and the height of the frames output, 1 restores the original size.
+   *
+   * @return Returns false by default, the module does not support scaling its output.
+   *
+   * @note It is called by the pipeline on its own thread while the module is running. The frames output afterwards
+   *       are scaled, it may take effect on new streams only.
+   */
+  virtual bool SetOutputScale(double scale) { return false; }
+
   /**
    * @brief Gets the name of this module.
    *
@@ -192,6 +300,17 @@ class Module : private NonCopyable {
    * @return Returns true if the data has been transmitted successfully. Otherwise, returns false.
    */
   bool TransmitData(std::shared_ptr<CNFrameInfo> data);
+  /**
+   * @brief Transmits a batch of data to the following stages in order. The data routed to the same conveyor is
+   * pushed together, see Pipeline::ProvideDataBatch.
+   *
+   * Valid when the module has permission to transmit data by itself.
+   *
+   * @param[in] data_vec The information of the frames.
+   *
+   * @return Returns true if the data has been transmitted successfully. Otherwise, returns false.
+   */
+  bool TransmitDataBatch(const std::vector<std::shared_ptr<CNFrameInfo>>& data_vec);
 
   /**
    * @brief Checks parameters for a module, including parameter name, type, value, validity, and so on.
@@ -202,6 +321,31 @@ class Module : private NonCopyable {
    */
   virtual bool CheckParamSet(const ModuleParamSet &paramSet) const { return true; }
 
+  /**
+   * @brief Checks the parameters overridden for a stream, see SetStreamParams.
+   *
+   * @param[in] params The parameters overridden.
+   *
+   * @return Returns true if the parameters can be overridden per stream. By default only empty parameters are
+   *         accepted, the modules supporting the overrides override it.
+   */
+  virtual bool CheckStreamParams(const ModuleParamSet &params) const { return params.empty(); }
+
+  /**
+   * @brief Overrides the parameters of this module for a stream, e.g. the threshold of a group of cameras, so that
+   *        streams with different settings share the module and its batches. It is called by the pipeline when the
+   *        stream is added or its overrides change, and with empty parameters when the stream is removed, see
+   *        Pipeline::SetStreamParams.
+   *
+   * @param[in] stream_index The stream index, see CNFrameInfo::GetStreamIndex. Modules look up the overrides of a
+   *                         frame by it, see StreamParamTable.
+   * @param[in] params The parameters overridden, checked by CheckStreamParams. Empty to restore the parameters of
+   *                   the module.
+   *
+   * @note It is called after the module has been opened, and concurrently with Process.
+   */
+  virtual void SetStreamParams(uint32_t stream_index, const ModuleParamSet &params) {}
+
   /**
    * @brief Gets the pipeline this module belongs to.
    *
@@ -216,6 +360,19 @@ class Module : private NonCopyable {
    */
   ModuleProfiler* GetProfiler();
 
+  /**
+   * @brief Binds the calling thread to the cpus assigned to this module.
+   *
+   * The cpus are assigned by the pipeline according to CNModuleConfig::cpuAffinity and CNModuleConfig::numaNode.
+   * The pipeline binds the threads calling ``Process``. Modules call this function in the threads created by
+   * themselves, e.g., decoding threads.
+   *
+   * The thread is tagged by the pipeline as well, see Pipeline::TagCurrentThread.
+   *
+   * @return Returns true if the thread is bound. Returns false if no cpus are assigned or binding fails.
+   */
+  bool BindThreadToCpus() const;
+
   /**
    * @brief Checks if this module has permission to transmit data by itself.
    *
@@ -264,11 +421,23 @@ class Module : private NonCopyable {
    */
   int DoProcess(std::shared_ptr<CNFrameInfo> data);
 
+  /**
+   * @brief Processes a batch of data without EOS frames. This function is called by a pipeline.
+   *
+   * @param[in] data_vec The frames of the batch.
+   *
+   * @return Returns 0 or the return value of ``ProcessBatch`` for modules with ``hasTransmit_`` set.
+   * Returns a negative value if the batch fails to be processed.
+   */
+  int DoProcessBatch(std::vector<std::shared_ptr<CNFrameInfo>>& data_vec);  // NOLINT
+
   Pipeline *container_ = nullptr;  ///< The container.
-  RwLock container_lock_;
+  BiasedRwLock container_lock_;
 
   std::string name_;                      ///< The name of the module.
   std::atomic<bool> hasTransmit_{false};  ///< Whether it has permission to transmit data.
+  std::vector<int> cpu_affinity_;         ///< The cpus assigned to this module. Empty means not bound.
+  int numa_node_ = -1;                    ///< The NUMA node of the assigned cpus.
 
 #ifdef UNIT_TEST
  public:  // NOLINT
@@ -277,7 +446,7 @@ class Module : private NonCopyable {
 #endif
 
   IModuleObserver *observer_ = nullptr;
-  RwLock observer_lock_;
+  BiasedRwLock observer_lock_;
   void NotifyObserver(std::shared_ptr<CNFrameInfo> data) {
     RwLockReadGuard guard(observer_lock_);
     if (observer_) {
@@ -285,6 +454,9 @@ class Module : private NonCopyable {
     }
   }
   int DoTransmitData(std::shared_ptr<CNFrameInfo> data);
+  /* called with container_lock_ locked, the EOS of a removed stream resets its removed flag */
+  void OnTransmitEos(const std::shared_ptr<CNFrameInfo>& data);
+  bool CheckDataRemoved(const std::shared_ptr<CNFrameInfo>& data);
 
   size_t GetId();
   size_t id_ = INVALID_MODULE_ID;
@@ -309,6 +481,84 @@ class ModuleEx : public Module {
   explicit ModuleEx(const std::string &name) : Module(name) { hasTransmit_.store(true); }
 };
 
+/**
+ * @class ModuleAsync
+ *
+ * @brief ModuleAsync is the base class of the modules completing the data asynchronously, e.g., the modules waiting
+ * on network or disk I/O.
+ *
+ * ``ProcessAsync`` starts the work on the data and returns, the module calls the completion later on any thread, so
+ * that a few threads handle many frames in flight. The framework transmits the data of each stream in the order it is
+ * processed whatever order it completes in, and transmits the EOS of a stream, after calling ``OnEos``, when the data
+ * before it is transmitted. At most ``max_inflight`` frames are processed but not transmitted yet, ``Process`` blocks
+ * until one of them is transmitted beyond that, which holds the data back in the input queues of the module.
+ *
+ * The data failing to complete is handled by the pipeline as if ``Process`` returned the error, e.g., an EVENT_ERROR
+ * event is posted. The data of the removed streams is transmitted without being processed.
+ *
+ * @note Every completion must be called once and only once, e.g. when the I/O times out or is cancelled by ``Close``,
+ * otherwise the stream stalls.
+ */
+class ModuleAsync : public ModuleEx {
+ public:
+  /**
+   * @brief Completes the data with the return value. 0 means the data is processed successfully, a negative value
+   * means it failed.
+   */
+  using Completion = std::function<void(int ret)>;
+  /**
+   * @brief Constructor.
+   *
+   * @param[in] name The name of a module. Modules defined in a pipeline must have different names.
+   * @param[in] max_inflight The max number of frames processed but not transmitted yet. 0 means no limit.
+   */
+  explicit ModuleAsync(const std::string &name, uint32_t max_inflight = 64)
+      : ModuleEx(name), max_inflight_(max_inflight) {}
+  /**
+   * @brief Starts processing the data by ``ProcessAsync``, blocks while the module has ``max_inflight`` frames in
+   * flight.
+   *
+   * @param[in] data A pointer to the information of the frame.
+   *
+   * @return Returns 1, the data is transmitted by the framework as it completes.
+   */
+  int Process(std::shared_ptr<CNFrameInfo> data) final;
+  /**
+   * @brief Gets the number of frames processed but not transmitted yet.
+   */
+  uint32_t GetInflightNum() const;
+
+ protected:
+  /**
+   * @brief Starts processing the data, the EOS frames are not passed to it.
+   *
+   * @param[in] data A pointer to the information of the frame.
+   * @param[in] done The completion of the data. It may be called before this function returns.
+   */
+  virtual void ProcessAsync(std::shared_ptr<CNFrameInfo> data, Completion done) = 0;
+
+ private:
+  struct InflightData {
+    std::shared_ptr<CNFrameInfo> data;
+    bool done = false;
+    int ret = 0;
+  };
+  struct InflightStream {
+    std::deque<InflightData> queue;  // in the order of processing
+    bool draining = false;           // a thread is transmitting the data of the stream
+  };
+  void Complete(const std::string &stream_id, InflightData *inflight, int ret);
+  // transmits the completed data at the front of the stream, on one thread at a time
+  void Drain(const std::string &stream_id);
+
+  const uint32_t max_inflight_;
+  mutable std::mutex inflight_mutex_;
+  std::condition_variable inflight_cond_;
+  uint32_t inflight_num_ = 0;
+  // the elements of a deque keep their addresses as it grows and shrinks at the ends, the completions point to them
+  std::unordered_map<std::string, InflightStream> inflight_streams_;
+};
+
 }  // namespace cnstream
 
 #endif  // CNSTREAM_MODULE_HPP_
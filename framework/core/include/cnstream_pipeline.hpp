@@ -28,6 +28,7 @@
  */
 
 #include <atomic>
+#include <condition_variable>
 #include <future>
 #include <iostream>
 #include <memory>
@@ -39,11 +40,20 @@
 #include <utility>
 #include <vector>
 
+#include "cnstream_admission.hpp"
+#include "cnstream_autoscaler.hpp"
+#include "cnstream_checkpoint.hpp"
 #include "cnstream_common.hpp"
 #include "cnstream_config.hpp"
+#include "cnstream_degradation.hpp"
 #include "cnstream_eventbus.hpp"
+#include "cnstream_frame_pool.hpp"
+#include "cnstream_graph_plan.hpp"
+#include "cnstream_memory_accountant.hpp"
+#include "cnstream_metrics_exporter.hpp"
 #include "cnstream_module.hpp"
 #include "cnstream_source.hpp"
+#include "private/cnstream_module_mask.hpp"
 #include "util/cnstream_rwlock.hpp"
 #include "profiler/pipeline_profiler.hpp"
 
@@ -51,9 +61,14 @@ namespace cnstream {
 
 class Connector;
 struct NodeContext;
+struct PipelineBranch;
+struct RouteTable;
 template<typename T>
 class CNGraph;
 class IdxManager;
+class WorkStealingScheduler;
+class TraceSampler;
+class CpuIsolation;
 
 /**
  * @enum StreamMsgType
@@ -167,6 +182,15 @@ class Pipeline : private NonCopyable {
    * @return Returns true if this function has run successfully. Otherwise, returns false.
    */
   bool BuildPipeline(const CNGraphConfig& graph_config);
+  /**
+   * @brief Builds a pipeline by a compiled graph plan. The subgraph configuration files are not parsed, and the
+   * order and the masks of the modules are taken from the plan.
+   *
+   * @param[in] plan The plan, see CNGraphPlan::Compile and CNGraphPlanCache.
+   *
+   * @return Returns true if this function has run successfully. Otherwise, returns false.
+   */
+  bool BuildPipeline(const CNGraphPlan& plan);
   /**
    * @brief Builds a pipeline from a JSON file.
    * You can learn to write a configuration file by looking at the description of CNGraphConfig.
@@ -191,6 +215,9 @@ class Pipeline : private NonCopyable {
   /**
    * @brief Stops data transmissions in a pipeline.
    *
+   * The events posted before stopping are dispatched, and the stream messages are passed to the observer before
+   * returning, unless it is called by the observer.
+   *
    * @return Returns true if this function has run successfully. Otherwise, returns false.
    */
   bool Stop();
@@ -224,6 +251,37 @@ class Pipeline : private NonCopyable {
    *         added to the current pipeline.
    */
   CNModuleConfig GetModuleConfig(const std::string& module_name) const;
+  /**
+   * @brief Attaches a branch of modules to a running pipeline. The frames transmitted by the module named
+   *        ``module_name`` are transmitted to the first module of the branch as well.
+   *
+   * The branch has its own connectors and threads (or conveyor jobs in work stealing mode), so the modules in the
+   * pipeline are not stopped. The modules of the branch are opened before the branch is attached. Only the frames
+   * entering the pipeline after this call pass through the branch, the frames in flight keep their routes.
+   *
+   * @param[in] module_name The module the branch is attached to. The name can be specified by two ways, see
+   *                        Pipeline::GetModule for detail. It must be a module in the graph, not in another branch.
+   * @param[in] module_configs The modules of the branch. The first one is the head of the branch and the name of the
+   *                           branch, the others are reached from it by CNModuleConfig::next. The names must be
+   *                           unique in the pipeline.
+   *
+   * @return Returns true if the branch is attached. Returns false if the pipeline is not running, the configurations
+   *         are not valid or one of the modules fails to open.
+   *
+   * @note The modules of a branch are not profiled, and they are not scaled by the autoscaler.
+   */
+  bool AttachBranch(const std::string& module_name, const std::vector<CNModuleConfig>& module_configs);
+  /**
+   * @brief Detaches a branch attached by Pipeline::AttachBranch, and closes its modules.
+   *
+   * The frames entering the pipeline after this call do not pass through the branch. The function blocks until the
+   * frames routed to the branch are released.
+   *
+   * @param[in] branch_name The name of the first module of the branch.
+   *
+   * @return Returns true if the branch is detached. Returns false if there is no branch named ``branch_name``.
+   */
+  bool DetachBranch(const std::string& branch_name);
   /**
    * @brief Checks if profiling is enabled.
    *
@@ -251,12 +309,230 @@ class Pipeline : private NonCopyable {
    * @see Module::Process.
    */
   bool ProvideData(const Module* module, std::shared_ptr<CNFrameInfo> data);
+  /**
+   * @brief Provides a batch of data for the pipeline, e.g. a burst of frames of a source module. The data is
+   * transmitted as by ProvideData in order, but the data routed to the same conveyor is pushed together, so the
+   * conveyor is locked once for the batch.
+   *
+   * @param[in] module The module that provides data.
+   * @param[in] data_vec The data that is transmitted to the pipeline.
+   *
+   * @return Returns true if this function has run successfully. Returns false if the module
+   *         is not added in the pipeline or the pipeline has been stopped, no data is transmitted.
+   *
+   * @see ProvideData, SourceModule::SendDataBatch.
+   */
+  bool ProvideDataBatch(const Module* module, const std::vector<std::shared_ptr<CNFrameInfo>>& data_vec);
+  /**
+   * @brief Reports that a module failed to process data it completes asynchronously, see ModuleAsync. The data is
+   * handled as if ``Process`` of the module returned ``ret``.
+   *
+   * @param[in] module The module that failed to process the data.
+   * @param[in] data The data failed.
+   * @param[in] ret The negative return number.
+   */
+  void ReportProcessFailed(const Module* module, const std::shared_ptr<CNFrameInfo>& data, int ret);
   /**
    * @brief Gets the event bus in the pipeline.
    *
    * @return Returns the event bus.
    */
   EventBus* GetEventBus() const;
+  /**
+   * @brief Gets the frame pool of the pipeline.
+   *
+   * @return Returns the frame pool. Returns NULL if the frame pool is not enabled.
+   *
+   * @see FramePoolConfig
+   */
+  CNFrameInfoPool* GetFramePool() const;
+  /**
+   * @brief Gets the parallelism changes made by the autoscaler.
+   *
+   * @return Returns the latest decisions in time order. Returns an empty vector if no module is scaled.
+   *
+   * @see AutoscalerConfig
+   */
+  std::vector<AutoscaleDecision> GetAutoscaleDecisions() const;
+  /**
+   * @brief Gets the load of the modules, the same states sampled by the autoscaler. The head modules are not included.
+   *
+   * It is used to tell how busy the pipeline is, e.g. a module whose input queues are full or which is blocking its
+   * upstream modules can not take more streams.
+   *
+   * @return Returns the states of the modules. Returns an empty vector if the pipeline is not running.
+   *
+   * @see AutoscaleSample
+   */
+  std::vector<AutoscaleSample> GetModuleStates();
+  /**
+   * @brief Sets the weight of a stream for the admission control. When the pipeline is overloaded, a stream with a
+   * larger weight keeps a larger share of the frame rate. The default weight is 1.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] weight The weight, must be greater than 0.
+   *
+   * @return Returns false if the admission control is not enabled or the weight is not valid.
+   *
+   * @see AdmissionConfig
+   */
+  bool SetStreamWeight(const std::string& stream_id, double weight);
+  /**
+   * @brief Gets the states of the streams kept by the admission control.
+   *
+   * @return Returns the states keyed by the stream identification. Returns an empty map if the admission control is
+   * not enabled.
+   *
+   * @see AdmissionConfig
+   */
+  std::map<std::string, AdmissionStreamState> GetAdmissionStates() const;
+  /**
+   * @brief Tags the calling thread as a thread of this pipeline. It is given the nice value and moved into the cgroup
+   * of CpuIsolationConfig, and its CPU time is reported in PipelineProfile::cpu_usage.
+   *
+   * The pipeline tags the threads calling ``Process`` and the workers of the scheduler, and Module::BindThreadToCpus
+   * tags the threads created by the modules, e.g., decoding threads.
+   *
+   * @return Returns false if the thread is not isolated, e.g. the cgroup is not writable, or neither the CPU
+   * isolation nor the profiling is enabled.
+   *
+   * @see CpuIsolationConfig
+   */
+  bool TagCurrentThread();
+  /**
+   * @brief Sets the priority of a stream for the degradation. The degradation steps skip the streams whose priority
+   * is greater than their ``max_priority``. The default priority is 0.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] priority The priority.
+   *
+   * @return Returns false if the degradation is not enabled.
+   *
+   * @see DegradationConfig
+   */
+  bool SetStreamPriority(const std::string& stream_id, int priority);
+  /**
+   * @brief Gets the degradation level, the number of degradation steps applied.
+   *
+   * @return Returns the level. Returns 0 if the degradation is not enabled.
+   *
+   * @see DegradationConfig
+   */
+  uint32_t GetDegradationLevel() const;
+  /**
+   * @brief Applies or undoes the degradation steps until the level is reached, e.g. to degrade the pipeline ahead of a
+   * known burst. The level keeps being adjusted by the load afterwards.
+   *
+   * @param[in] level The number of degradation steps applied, it is capped by the number of steps.
+   *
+   * @return Returns false if the degradation is not enabled.
+   *
+   * @see DegradationConfig
+   */
+  bool SetDegradationLevel(uint32_t level);
+  /**
+   * @brief Sets the maximum latency of the frames of a stream. A frame staying in the pipeline longer than it since
+   * it is created is dropped by the first module about to process it, so that the pipeline catches up with the live
+   * stream after a stall instead of processing stale frames. The dropped frames are counted as ``late`` by the
+   * profilers, see FrameAccounting.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] max_latency_ms The maximum latency in milliseconds. 0 means no limit, it is the default.
+   *
+   * @return Returns false if ``max_latency_ms`` is negative.
+   *
+   * @see CNFrameInfo::GetDeadline
+   */
+  bool SetStreamMaxLatency(const std::string& stream_id, int64_t max_latency_ms);
+  /**
+   * @brief The parameters of modules overridden for a stream, keyed by the module name.
+   */
+  using StreamParamOverrides = std::map<std::string, ModuleParamSet>;
+  /**
+   * @brief Overrides the parameters of modules for a stream, e.g. the ``threshold`` or ``infer_interval`` of an
+   * Inferencer, so that streams with different settings share one pipeline, with full batches going into one set of
+   * engines. The overrides replace the ones set before for the stream, and are merged over the overrides of the tag
+   * of the stream, see SetStreamTag.
+   *
+   * The overrides are kept by the stream identification. They are applied to the modules when an index is assigned to
+   * the stream, i.e. when the stream is added to a source module, and take effect at once if the stream is added
+   * already. The modules look them up by the stream index of the frames, see Module::SetStreamParams.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] params The overrides keyed by the module name, the ones not in it are removed.
+   *
+   * @return Returns false if a module is not found or rejects its overrides, see Module::CheckStreamParams. The
+   * overrides set before are kept then.
+   */
+  bool SetStreamParams(const std::string& stream_id, const StreamParamOverrides& params);
+  /**
+   * @brief Overrides the parameters of modules for the streams having a tag, e.g. a group of cameras, see
+   * SetStreamParams.
+   *
+   * @param[in] tag The tag of the streams.
+   * @param[in] params The overrides keyed by the module name, the ones not in it are removed.
+   *
+   * @return Returns false if a module is not found or rejects its overrides.
+   */
+  bool SetStreamTagParams(const std::string& tag, const StreamParamOverrides& params);
+  /**
+   * @brief Sets the tag of a stream, the stream takes the overrides of the tag, see SetStreamTagParams.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] tag The tag, empty to untag the stream.
+   *
+   * @return Returns false if a module rejects the overrides of the tag merged with the ones of the stream.
+   */
+  bool SetStreamTag(const std::string& stream_id, const std::string& tag);
+  /**
+   * @brief Gets the checkpoints of the streams.
+   *
+   * @return Returns the checkpoint store. Returns NULL if the checkpoints are not enabled.
+   *
+   * @see CheckpointConfig
+   */
+  CheckpointStore* GetCheckpointStore() const;
+  /**
+   * @brief Gets the metrics of the pipeline in the OpenMetrics text format, the text served by the metrics exporter.
+   *
+   * All samples are labeled with ``pipeline``, the ones of a module with ``module`` as well:
+   *   - ``cnstream_module_parallelism``, ``cnstream_module_queue_depth``, ``cnstream_module_queue_capacity``: the
+   *     threads and the input queues of the modules except the head modules.
+   *   - ``cnstream_module_queue_push_failures``: the failed pushes of the producers waiting for the full queues.
+   *   - ``cnstream_frames_total``, ``cnstream_dropped_frames_total``, ``cnstream_ongoing_frames``, ``cnstream_fps`` and
+   *     the summary ``cnstream_latency_seconds`` with the 0.5, 0.99 and 0.999 quantiles, labeled with ``process``
+   *     (see PipelineProfiler), if profiling is enabled. The ones of the whole pipeline are labeled with ``OVERALL``.
+   *   - ``cnstream_module_events_total``: the counters of the modules labeled with ``name``, see
+   *     ModuleProfiler::AddCounter. The hardware counters are among them, see ProfilerConfig::enable_perf_counters.
+   *   - ``cnstream_module_received_frames_total``, ``cnstream_module_dropped_frames_total`` labeled with ``reason``
+   *     and ``cnstream_module_stalled_seconds_total``: the frame accounting of the modules, see FrameAccounting.
+   *   - ``cnstream_device_utilization_ratio``: the utilization of the devices labeled with ``device`` and ``type``
+   *     (core, memory or codec), if PipelineProfiler::SetDeviceUtilizationSampler is called.
+   *   - ``cnstream_memory_bytes``, ``cnstream_memory_peak_bytes`` and ``cnstream_stream_memory_bytes``: the memory held
+   *     by the pipeline and its streams (including the buffers of the decoders), labeled with ``type`` (host or
+   *     device), if the memory accountant is enabled.
+   *   - ``cnstream_admission_capacity_fps``, ``cnstream_stream_allowed_fps`` and
+   *     ``cnstream_stream_rejected_frames_total`` (the latter two labeled with ``stream``), if the admission control
+   *     is enabled. A negative frame rate means no limit.
+   *   - ``cnstream_degradation_level``: the number of degradation steps applied, if the degradation is enabled.
+   *   - ``cnstream_frame_pool_frames`` labeled with ``state`` (idle or in_use), if the frame pool is enabled.
+   *   - ``cnstream_memory_pool_bytes`` labeled with ``pool``, ``device``, ``channel`` and ``state`` (in_use or
+   *     cached), ``cnstream_memory_pool_allocs_total`` and ``cnstream_memory_pool_hits_total``: the caching memory
+   *     pools shared by the process.
+   *
+   * @return Returns the text ending with "# EOF".
+   *
+   * @see MetricsConfig
+   */
+  std::string GetMetrics();
+  /**
+   * @brief Gets the metrics exporter of the pipeline.
+   *
+   * @return Returns the exporter. Returns NULL if the pipeline is not running or the exporter is not enabled.
+   *
+   * @see MetricsConfig
+   */
+  MetricsExporter* GetMetricsExporter() const;
   /**
    * @brief Binds the stream message observer with a pipeline to receive stream message from this pipeline.
    *
@@ -305,6 +581,15 @@ class Pipeline : private NonCopyable {
    * @return Returns true if it's leaf node, otherwise returns false.
    **/
   bool IsLeafNode(const std::string& module_name) const;
+  /**
+   * @brief Checks if module is fused into the execution stage of its upstream module, see FusePolicy.
+   * The module name can be specified by two ways, see Pipeline::GetModule for detail.
+   *
+   * @param[in] module_name module name.
+   *
+   * @return Returns true if the module runs on the threads of its upstream module, otherwise returns false.
+   **/
+  bool IsFusedNode(const std::string& module_name) const;
 
   /**
    * @brief Registers a callback to be called after the frame process is done.
@@ -319,21 +604,81 @@ class Pipeline : private NonCopyable {
 
  private:
   /** called by BuildPipeline **/
+  bool InitPipeline(const CNGraphPlan* plan);
   bool CreateModules();
-  void GenerateModulesMask();
+  void GenerateModulesMask(const CNGraphPlan* plan);
+  /* decides the modules run on the threads of their upstream modules, see FusePolicy */
+  void FuseModules();
   bool CreateConnectors();
+  void InitLatencyBreakdown();
 
   /* ------Internal methods------ */
-  bool PassedByAllModules(uint64_t mask) const;
+  /* opens the modules as the pipeline starts, see SchedulerConfig::parallel_open */
+  bool OpenModules();
+  /* publishes the routes of the graph and the branches, see RouteTable. Called with branch_mutex_ locked. */
+  void UpdateRoutes();
+  void CloseBranch(PipelineBranch* branch);
   void OnProcessStart(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data);
   void OnProcessEnd(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data);
   void OnProcessFailed(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data, int ret);
   void OnDataInvalid(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data);
   void OnEos(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data);
   void OnPassThrough(const std::shared_ptr<CNFrameInfo>& data);
-
-  void TransmitData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data);
+  /* calls Module::DoProcess or Module::DoProcessBatch, see ProfilerConfig::enable_perf_counters */
+  int ProcessData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data);
+  int ProcessData(NodeContext* context, std::vector<std::shared_ptr<CNFrameInfo>>* data_vec);
+
+  /* a data routed to a conveyor, the data of a batch is pushed together, see ProvideDataBatch */
+  struct ConveyorPush {
+    NodeContext* context;
+    int conveyor_idx;
+    std::shared_ptr<CNFrameInfo> data;
+  };
+  bool CheckProvidedData(const Module* module, const std::shared_ptr<CNFrameInfo>& data);
+  /* the data pushed to the conveyors is collected by ``pushes`` if it is not nullptr, see PushData */
+  void TransmitData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data,
+                    std::vector<ConveyorPush>* pushes = nullptr);
+  /* transmits the data to the next nodes, see ReorderBuffer for the modules processing a stream in parallel */
+  void ForwardData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data,
+                   std::vector<ConveyorPush>* pushes = nullptr);
+  /* marks the data passed by the node and transmits it to the next nodes of the node */
+  void RouteData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data,
+                 std::vector<ConveyorPush>* pushes = nullptr);
+  /* pushes the data to a conveyor of the node, waits or drops the data if it is full, see QueueFullPolicy */
+  void PushData(NodeContext* context, int conveyor_idx, const std::shared_ptr<CNFrameInfo>& data,
+                ModuleProfiler* profiler);
+  /* pushes the data collected for a batch, each conveyor is locked once */
+  void PushData(std::vector<ConveyorPush>* pushes);
+  /* the data is dropped or failed, it is never transmitted by the module */
+  void DiscardData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data);
+  /* see CircuitBreakerConfig */
+  void CreateCircuitBreaker(NodeContext* context, const CNModuleConfig& config);
+  /* drops the data before it is processed if its deadline has passed, see SetStreamMaxLatency */
+  bool DropExpiredData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data);
+  int64_t GetStreamMaxLatency(const std::shared_ptr<CNFrameInfo>& data);
   void TaskLoop(NodeContext* context, uint32_t conveyor_idx);
+  /* see CNModuleConfig::maxBatchSize */
+  void ProcessDataBatch(NodeContext* context, std::vector<std::shared_ptr<CNFrameInfo>>* data_vec);
+  /* used in work stealing mode, see SchedulerConfig */
+  void ScheduleConveyor(NodeContext* context, uint32_t conveyor_idx);
+  void ConveyorTask(NodeContext* context, uint32_t conveyor_idx);
+  /* used by the autoscaler, see AutoscalerConfig */
+  std::vector<AutoscaleSample> SampleModules();
+  bool ScaleModule(const std::string& module_name, uint32_t parallelism);
+  void StartTaskLoop(NodeContext* context, uint32_t conveyor_idx);
+  bool RetireTaskLoop(NodeContext* context, uint32_t conveyor_idx);
+  /* used by source modules, see Module::OnStreamAdded */
+  void NotifyStreamAdded(Module* source, const std::string& stream_id);
+  /* used by source modules, see MemoryBudgetConfig */
+  MemoryOwner GetMemoryOwner(const std::string& stream_id);
+  void WaitForMemoryBudget(const std::string& stream_id);
+  /* used by source modules, see AdmissionConfig */
+  bool Admit(Module* source, const std::string& stream_id);
+  AdmissionSample SampleAdmission();
+  /* see DegradationConfig */
+  bool InitDegradation();
+  DegradationSample SampleDegradation();
+  void ApplyDegradation(uint32_t level, const DegradationStep& step, bool apply);
   EventHandleFlag DefaultBusWatch(const Event& event);
   void UpdateByStreamMsg(const StreamMsg& msg);
   void StreamMsgHandleFunc();
@@ -348,14 +693,46 @@ class Pipeline : private NonCopyable {
 
   std::unique_ptr<IdxManager> idxManager_ = nullptr;
   std::vector<std::thread> threads_;
+  std::unique_ptr<WorkStealingScheduler> scheduler_;
+  std::unique_ptr<CNFrameInfoPool> frame_pool_;
+  std::unique_ptr<Autoscaler> autoscaler_;
+  std::unique_ptr<AdmissionController> admission_;
+  std::atomic<uint64_t> completed_frames_{0};  // the frames passed through the pipeline, used by admission_
+  std::unique_ptr<DegradationController> degradation_;
+  std::unique_ptr<CpuIsolation> cpu_isolation_;  // created if the cpu isolation or the profiling is enabled
+  // the next sequence numbers of the frames, indexed by the stream index, see CNFrameInfo::GetSequence
+  std::unique_ptr<std::atomic<int64_t>[]> stream_sequences_;
+  // see SetStreamMaxLatency, the latencies are cached by the stream index, -1 means not cached.
+  std::mutex max_latency_mtx_;
+  std::map<std::string, int64_t> max_latencies_;
+  std::unique_ptr<std::atomic<int64_t>[]> stream_max_latencies_;
+  // see SetStreamParams, the overrides keyed by the stream id and by the tag, and the tags keyed by the stream id
+  mutable std::mutex stream_params_mtx_;
+  std::map<std::string, StreamParamOverrides> stream_params_;
+  std::map<std::string, StreamParamOverrides> tag_params_;
+  std::map<std::string, std::string> stream_tags_;
+  std::unique_ptr<CheckpointStore> checkpoint_;
+  std::unique_ptr<MetricsExporter> metrics_exporter_;
+  std::mutex autoscale_mtx_;  // guards the task threads of scaled modules
+  bool memory_accounting_ = false;  // whether memory is charged to the streams, see MemoryAccountant
+  size_t module_times_size_ = 0;  // the size of CNFrameInfo::module_times_, 0 if the module times are not recorded
+  TraceSampler* trace_trigger_ = nullptr;  // the sampler told the process times of modules, see TraceSampler
+  bool perf_counters_ = false;  // whether the hardware counters are sampled around Process calls
 
   // message observer members
   ThreadSafeQueue<StreamMsg> msgq_;
   std::thread smsg_thread_;
   StreamMsgObserver* smsg_observer_ = nullptr;
   std::atomic<bool> exit_msg_loop_{false};
-
-  uint64_t all_modules_mask_ = 0;
+  uint32_t pending_msg_num_ = 0;  // the messages not handled yet, Stop waits for them
+  std::mutex msg_mtx_;
+  std::condition_variable msg_cond_;
+
+  ModuleMask all_modules_mask_;
+  // the routes of the frames entering the pipeline, read and written by std::atomic_load and std::atomic_store
+  std::shared_ptr<const RouteTable> routes_;
+  mutable std::mutex branch_mutex_;  // guards branches_ and the updates of routes_
+  std::map<std::string, std::shared_ptr<PipelineBranch>> branches_;  // see AttachBranch, keyed by the branch name
   std::unique_ptr<PipelineProfiler> profiler_;
 
   std::function<void(std::shared_ptr<CNFrameInfo>)> frame_done_cb_ = NULL;
@@ -369,17 +746,52 @@ class Pipeline : private NonCopyable {
 
   uint32_t GetStreamIndex(const std::string& stream_id) {
     if (idxManager_) {
-      return idxManager_->GetStreamIndex(stream_id);
+      bool assigned = false;
+      const uint32_t stream_idx = idxManager_->GetStreamIndex(stream_id, &assigned);
+      if (assigned) OnStreamIndexAssigned(stream_id, stream_idx);
+      return stream_idx;
     }
     return INVALID_STREAM_IDX;
   }
 
   void ReturnStreamIndex(const std::string& stream_id) {
     if (idxManager_) {
+      OnStreamIndexReturned(stream_id);
       idxManager_->ReturnStreamIndex(stream_id);
     }
   }
 
+  /**
+   * Stream parameter overrides helpers, see SetStreamParams. The overrides of a stream are applied to the modules
+   * when the stream gets its index, and removed from the modules before the index is returned.
+   */
+  void OnStreamIndexAssigned(const std::string& stream_id, uint32_t stream_idx);
+  void OnStreamIndexReturned(const std::string& stream_id);
+  // the overrides of a stream merged over the ones of its tag, stream_params_mtx_ is held
+  StreamParamOverrides ResolveStreamParams(const std::string& stream_id) const;
+  // checks that the modules exist and accept the overrides
+  bool CheckStreamParams(const StreamParamOverrides& params) const;
+  // sets the overrides of the modules in params or in old, stream_params_mtx_ is held
+  void ApplyStreamParams(uint32_t stream_idx, const StreamParamOverrides& old, const StreamParamOverrides& params);
+  // updates the overrides of the streams with an index after the stored overrides change from old
+  void UpdateStreamParams(const std::map<std::string, StreamParamOverrides>& old);
+
+  /**
+   * Stream removal helpers for Module and SourceModule instances. The streams which got their indexes from the
+   * pipeline are checked by the indexes in StreamStateTable, the others by the stream ids, see IsStreamRemoved.
+   */
+  void SetStreamRemoved(const std::string& stream_id, bool removed) {
+    // the modules check the removed streams by the stream ids as well
+    cnstream::SetStreamRemoved(stream_id, removed);
+    if (idxManager_) idxManager_->SetStreamRemoved(stream_id, removed);
+  }
+
+  bool IsStreamRemoved(const std::shared_ptr<CNFrameInfo>& data) const {
+    const uint64_t state = idxManager_ ? idxManager_->GetStreamState(data->GetStreamIndex()) : 0;
+    if (state & StreamStateTable::kAssigned) return state & StreamStateTable::kRemoved;
+    return cnstream::IsStreamRemoved(data->stream_id);
+  }
+
   size_t GetModuleIdx() {
     if (idxManager_) {
       return idxManager_->GetModuleIdx();
@@ -424,6 +836,18 @@ inline EventBus* Pipeline::GetEventBus() const {
   return event_bus_.get();
 }
 
+inline CNFrameInfoPool* Pipeline::GetFramePool() const {
+  return frame_pool_.get();
+}
+
+inline CheckpointStore* Pipeline::GetCheckpointStore() const {
+  return checkpoint_.get();
+}
+
+inline MetricsExporter* Pipeline::GetMetricsExporter() const {
+  return metrics_exporter_.get();
+}
+
 inline void Pipeline::SetStreamMsgObserver(StreamMsgObserver* observer) {
   smsg_observer_ = observer;
 }
@@ -448,10 +872,6 @@ inline PipelineTracer* Pipeline::GetTracer() const {
   return IsTracingEnabled() ? profiler_->GetTracer() : nullptr;
 }
 
-inline bool Pipeline::PassedByAllModules(uint64_t mask) const {
-  return mask == all_modules_mask_;
-}
-
 inline void Pipeline::RegisterFrameDoneCallBack(const std::function<void(std::shared_ptr<CNFrameInfo>)>& callback) {
   frame_done_cb_ = callback;
 }
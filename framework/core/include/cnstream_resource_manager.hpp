@@ -0,0 +1,187 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_RESOURCE_MANAGER_HPP_
+#define CNSTREAM_RESOURCE_MANAGER_HPP_
+
+/**
+ *  @file cnstream_resource_manager.hpp
+ *
+ *  This file contains a declaration of the DeviceResourceManager class.
+ */
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+/*! The video decoder channels of a device, taken by each MLU video decoder. */
+static constexpr char kRESOURCE_VIDEO_DECODER[] = "video_decoder";
+/*! The jpeg decoder channels of a device, taken by each MLU jpeg decoder. */
+static constexpr char kRESOURCE_JPEG_DECODER[]  = "jpeg_decoder";
+
+class DeviceResourceManager;
+
+/**
+ * @class ResourceLease
+ *
+ * @brief ResourceLease is one unit of a device resource held by a pipeline. The unit is returned when the lease is
+ * destroyed.
+ */
+class ResourceLease : private NonCopyable {
+ public:
+  /**
+   * @brief Returns the unit to the DeviceResourceManager.
+   */
+  ~ResourceLease();
+  /**
+   * @brief Gets the name of the pipeline holding the lease.
+   */
+  const std::string& GetPipelineName() const { return pipeline_name_; }
+  /**
+   * @brief Gets the device identification.
+   */
+  int GetDeviceId() const { return device_id_; }
+  /**
+   * @brief Gets the kind of the resource, e.g. kRESOURCE_VIDEO_DECODER.
+   */
+  const std::string& GetKind() const { return kind_; }
+
+ private:
+  friend class DeviceResourceManager;
+  ResourceLease(const std::string& pipeline_name, int device_id, const std::string& kind)
+      : pipeline_name_(pipeline_name), device_id_(device_id), kind_(kind) {}
+  std::string pipeline_name_;
+  int device_id_;
+  std::string kind_;
+};  // class ResourceLease
+
+/**
+ * @struct ResourceUsage
+ *
+ * @brief ResourceUsage is the state of a kind of resource of a device.
+ */
+struct ResourceUsage {
+  int device_id = 0;       ///< The device identification.
+  std::string kind;        ///< The kind of the resource, e.g. kRESOURCE_VIDEO_DECODER.
+  uint32_t capacity = 0;   ///< The units of the device, 0 means unlimited.
+  uint32_t in_use = 0;     ///< The units held by all pipelines.
+  /// The units held and the units waited for by each pipeline, keyed by the pipeline name.
+  std::map<std::string, std::pair<uint32_t, uint32_t>> pipelines;
+};
+
+/**
+ * @class DeviceResourceManager
+ *
+ * @brief DeviceResourceManager arbitrates the limited resources of the devices, e.g. the codec channels, between
+ * the pipelines of the process, instead of each pipeline over-subscribing the device.
+ *
+ * A resource is counted in units, a module takes one unit for each instance it creates, see Acquire. When the units
+ * run out, the pipelines waiting for them are served by weighted fairness: a returned unit goes to the waiting
+ * pipeline holding the fewest units for its weight. The resources are unlimited until their capacities are set by
+ * the application.
+ *
+ * The models and the memory are shared in the same process-wide way by the model cache and the shared sessions of
+ * Inferencer2, and the MemoryAccountant.
+ */
+class DeviceResourceManager : private NonCopyable {
+ public:
+  /**
+   * @brief Gets the process-wide manager.
+   *
+   * @return The manager instance.
+   */
+  static DeviceResourceManager& Instance();
+  /**
+   * @brief Sets the units of a resource of a device. The units held beyond a reduced capacity are kept until they are
+   * returned.
+   *
+   * @param[in] device_id The device identification.
+   * @param[in] kind The kind of the resource, e.g. kRESOURCE_VIDEO_DECODER.
+   * @param[in] capacity The units, 0 means unlimited.
+   *
+   * @return No return value.
+   */
+  void SetCapacity(int device_id, const std::string& kind, uint32_t capacity);
+  /**
+   * @brief Gets the units of a resource of a device, 0 means unlimited.
+   */
+  uint32_t GetCapacity(int device_id, const std::string& kind) const;
+  /**
+   * @brief Sets the weight of a pipeline. A pipeline with a larger weight is served first when the pipelines wait for
+   * the same resource. The default weight is 1.
+   *
+   * @param[in] pipeline_name The name of the pipeline.
+   * @param[in] weight The weight, must be greater than 0.
+   *
+   * @return Returns false if the weight is not valid.
+   */
+  bool SetWeight(const std::string& pipeline_name, double weight);
+  /**
+   * @brief Takes one unit of a resource of a device for a pipeline.
+   *
+   * @param[in] pipeline_name The name of the pipeline, empty for the modules out of pipelines.
+   * @param[in] device_id The device identification.
+   * @param[in] kind The kind of the resource, e.g. kRESOURCE_VIDEO_DECODER.
+   * @param[in] timeout_ms The maximum time to wait for a unit.
+   *
+   * @return Returns the lease of the unit, or nullptr if no unit is available before the timeout.
+   */
+  std::unique_ptr<ResourceLease> Acquire(const std::string& pipeline_name, int device_id, const std::string& kind,
+                                         uint32_t timeout_ms);
+  /**
+   * @brief Gets the states of the resources which have been set or acquired.
+   */
+  std::vector<ResourceUsage> GetUsages() const;
+
+ private:
+  friend class ResourceLease;
+  struct PipelineState {
+    uint32_t held = 0;
+    uint32_t waiting = 0;
+  };
+  struct Resource {
+    uint32_t capacity = 0;
+    uint32_t in_use = 0;
+    std::map<std::string, PipelineState> pipelines;
+  };
+  using ResourceKey = std::pair<int, std::string>;
+
+  DeviceResourceManager() = default;
+  // whether a unit could be granted to the pipeline now, called with mtx_ locked
+  bool CanGrant(const Resource& resource, const std::string& pipeline_name) const;
+  double GetWeight(const std::string& pipeline_name) const;
+  void Release(const ResourceLease& lease);
+
+  mutable std::mutex mtx_;  // guards the members below
+  std::condition_variable cond_;
+  std::map<ResourceKey, Resource> resources_;
+  std::map<std::string, double> weights_;
+};  // class DeviceResourceManager
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_RESOURCE_MANAGER_HPP_
@@ -28,13 +28,19 @@
  */
 
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <list>
 #include <memory>
 #include <string>
 #include <map>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "cnstream_common.hpp"
+#include "cnstream_memory_accountant.hpp"
 #include "cnstream_module.hpp"
 
 namespace cnstream {
@@ -69,6 +75,17 @@ class SourceModule : public Module {
    * @retval Returns 0 for success, otherwise returns -1.
    */
   int AddSource(std::shared_ptr<SourceHandler> handler);
+  /**
+   * @brief Adds several streams to DataSource module at once. This function should be called after pipeline starts.
+   *
+   * The source map is locked once for all streams instead of once per stream. A stream is skipped if its handler is
+   * null, its stream identifier is duplicated, the maximum number of streams is reached or it fails to be opened.
+   *
+   * @param[in] handlers The source handlers.
+   *
+   * @return Returns the number of streams added.
+   */
+  int AddSources(const std::vector<std::shared_ptr<SourceHandler>> &handlers);
   /**
    * @brief Destructs a source module.
    *
@@ -100,7 +117,8 @@ class SourceModule : public Module {
    * @retval 0: success (always success by now).
    *
    * @note If ``force`` sets to true, the stream will be removed immediately, otherwise the stream will be removed after
-   * all cached frames are processed.
+   * all cached frames are processed. The EOS of a stream removed by force overtakes the frames in the input queues of
+   * the modules, which are dropped, unless the queues are lock free (see InputQueueType).
    */
   int RemoveSource(const std::string &stream_id, bool force = false);
   /**
@@ -114,6 +132,47 @@ class SourceModule : public Module {
    * all cached frames are processed.
    */
   int RemoveSources(bool force = false);
+  /**
+   * @brief Called once a stream is removed by RemoveSourcesAsync.
+   */
+  using SourceRemovedCallback = std::function<void(const std::string &stream_id)>;
+  /**
+   * @brief Removes several streams from DataSource module at once. This function should be called before pipeline
+   * stops.
+   *
+   * All streams are closed first, then the EOS of all of them are waited for at the same time, so the time taken
+   * does not grow with the number of streams.
+   *
+   * @param[in] stream_ids The stream identifications.
+   * @param[in] force The flag describing the removing behaviour.
+   *
+   * @retval 0: success (always success by now).
+   *
+   * @see RemoveSource
+   */
+  int RemoveSources(const std::vector<std::string> &stream_ids, bool force = false);
+  /**
+   * @brief Removes several streams like RemoveSources without waiting. The streams are removed by another thread.
+   *
+   * @param[in] stream_ids The stream identifications.
+   * @param[in] callback Called by the removing thread with each stream once it is removed, in the order of the EOS
+   *                     reached. It could be empty.
+   * @param[in] force The flag describing the removing behaviour.
+   *
+   * @retval 0: success (always success by now).
+   *
+   * @note RemoveSources(bool) and the destructor wait for the streams being removed.
+   */
+  int RemoveSourcesAsync(const std::vector<std::string> &stream_ids, SourceRemovedCallback callback,
+                         bool force = false);
+  /**
+   * @brief Gets the owner which memory allocated for a stream is charged to.
+   *
+   * @param[in] stream_id The stream identification.
+   *
+   * @return Returns the owner. Returns an empty owner if memory accounting is not enabled by the pipeline.
+   */
+  MemoryOwner GetMemoryOwner(const std::string &stream_id);
 
 #ifdef UNIT_TEST
  public:  // NOLINT
@@ -138,14 +197,63 @@ class SourceModule : public Module {
    * @return No return value.
    */
   void ReturnStreamIndex(const std::string &stream_id);
+  /**
+   * @brief Creates a frame. The frame is got from the frame pool of the pipeline if the pool is enabled.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] eos The flag marking the frame is end of stream.
+   * @param[in] payload The payload of ``CNFameInfo``.
+   *
+   * @return Returns the frame if this function has run successfully. Otherwise, returns NULL.
+   */
+  std::shared_ptr<CNFrameInfo> CreateFrameInfo(const std::string &stream_id, bool eos,
+                                               std::shared_ptr<CNFrameInfo> payload);
+  /**
+   * @brief Waits until a frame could be created after ``CreateFrameInfo`` returned NULL.
+   *
+   * If the frame pool of the pipeline limits the frames in use, the calling thread blocks until a frame is released,
+   * see FramePoolConfig. Otherwise ``CreateFrameInfo`` fails only when memory is exhausted, and the calling thread
+   * sleeps for ``timeout_ms`` before retrying.
+   *
+   * @param[in] timeout_ms The maximum time to wait in milliseconds.
+   *
+   * @return Returns true if a frame could be created. Returns false on timeout.
+   */
+  bool WaitForFrame(uint32_t timeout_ms);
   /**
    * @brief Transmits data to next stage(s) of the pipeline.
    *
    * @param[in] data The data to be transmitted.
    *
    * @return Returns true if data is transmitted successfully, othersize returns false.
+   *
+   * @note If the memory budget is enabled, the calling thread waits while the stream is over budget,
+   * see MemoryBudgetConfig.
    */
   bool SendData(std::shared_ptr<CNFrameInfo> data);
+  /**
+   * @brief Transmits a burst of data to next stage(s) of the pipeline in order, e.g. the frames of an image set. The
+   * data is checked as by SendData, the frames of removed streams and the frames over the shares of their streams
+   * are dropped. The data left is routed in one call, see Pipeline::ProvideDataBatch.
+   *
+   * @param[in] data_vec The data to be transmitted.
+   *
+   * @return Returns true if data is transmitted successfully. Returns false if all the data is dropped or the data
+   *         fails to be transmitted.
+   *
+   * @note If the memory budget is enabled, the calling thread waits while a stream is over budget,
+   * see MemoryBudgetConfig.
+   */
+  bool SendDataBatch(const std::vector<std::shared_ptr<CNFrameInfo>>& data_vec);
+  /**
+   * @brief Called when a stream is removed or fails to be opened, so that the module releases the state it keeps for
+   * the stream. It is called with the streams locked, it must not add or remove streams.
+   *
+   * @param[in] stream_id The stream identifier.
+   *
+   * @return No return value.
+   */
+  virtual void OnSourceClosed(const std::string &stream_id) {}
 
  private:
   int Process(std::shared_ptr<CNFrameInfo> data) override {
@@ -153,9 +261,15 @@ class SourceModule : public Module {
     LOGE(CORE) << "As a source module, Process() should not be invoked\n";
     return 0;
   }
+  // marks the stream removed in the pipeline, see Pipeline::SetStreamRemoved
+  void SetStreamRemoved(const std::string &stream_id, bool removed);
+  void DoRemoveSources(const std::vector<std::string> &stream_ids, bool force, const SourceRemovedCallback &callback);
+  void WaitRemoving();
 
   std::mutex mutex_;
   std::map<std::string /*stream_id*/, std::shared_ptr<SourceHandler>> source_map_;
+  std::mutex removing_mutex_;
+  std::list<std::future<void>> removing_;  // the streams removed by RemoveSourcesAsync
 };
 
 /**
@@ -212,6 +326,12 @@ class SourceHandler : private NonCopyable {
    * @return Returns the name of stream.
    */
   std::string GetStreamId() const { return stream_id_; }
+  /**
+   * @brief Gets the index of the stream.
+   *
+   * @return Returns the index of the stream, INVALID_STREAM_IDX if the handler belongs to no module.
+   */
+  uint32_t GetStreamIndex() const { return stream_index_; }
   /**
    * @brief Creates the context of ``CNFameInfo`` .
    *
@@ -221,12 +341,27 @@ class SourceHandler : private NonCopyable {
    * @return Returns the context of ``CNFameInfo`` .
    */
   std::shared_ptr<CNFrameInfo> CreateFrameInfo(bool eos = false, std::shared_ptr<CNFrameInfo> payload = nullptr) {
-    std::shared_ptr<CNFrameInfo> data = CNFrameInfo::Create(stream_id_, eos, payload);
+    std::shared_ptr<CNFrameInfo> data = module_ ? module_->CreateFrameInfo(stream_id_, eos, payload)
+                                                : CNFrameInfo::Create(stream_id_, eos, payload);
     if (data) {
       data->SetStreamIndex(stream_index_);
     }
     return data;
   }
+  /**
+   * @brief Waits until a frame could be created after ``CreateFrameInfo`` returned NULL.
+   *
+   * @param[in] timeout_ms The maximum time to wait in milliseconds.
+   *
+   * @return Returns true if a frame could be created. Returns false on timeout.
+   *
+   * @see SourceModule::WaitForFrame
+   */
+  bool WaitForFrame(uint32_t timeout_ms) {
+    if (module_) return module_->WaitForFrame(timeout_ms);
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+    return false;
+  }
   /**
    * @brief Sends data to next module.
    *
@@ -240,6 +375,58 @@ class SourceHandler : private NonCopyable {
     }
     return false;
   }
+  /**
+   * @brief Sends a burst of data to next module in order.
+   *
+   * @param[in] data_vec The data need to be sent to next modules.
+   *
+   * @return Returns true if send data successfully, otherwise returns false.
+   *
+   * @see SourceModule::SendDataBatch
+   */
+  bool SendDataBatch(const std::vector<std::shared_ptr<CNFrameInfo>>& data_vec) {
+    if (this->module_) {
+      return this->module_->SendDataBatch(data_vec);
+    }
+    return false;
+  }
+  /**
+   * @brief Charges the memory allocated by the calling thread to the stream. It should be called by the threads
+   * reading and decoding the stream.
+   *
+   * @return No return value.
+   */
+  void BindMemoryOwner() {
+    if (module_) MemoryOwner::SetCurrent(module_->GetMemoryOwner(stream_id_));
+  }
+  /**
+   * @brief Records frames of the stream produced by the source module, e.g. decoded, before they are dropped or
+   * sent. Nothing is recorded if profiling is disabled.
+   *
+   * @param[in] frames The number of frames.
+   *
+   * @return No return value.
+   *
+   * @see ModuleProfiler::RecordReceived
+   */
+  void RecordReceived(uint64_t frames = 1) {
+    ModuleProfiler *profiler = module_ ? module_->GetProfiler() : nullptr;
+    if (profiler) profiler->RecordReceived(stream_id_, frames);
+  }
+  /**
+   * @brief Records frames of the stream dropped by the source module. Nothing is recorded if profiling is disabled.
+   *
+   * @param[in] reason Why the frames are dropped, e.g. kDROP_REASON_INTERVAL.
+   * @param[in] frames The number of frames.
+   *
+   * @return No return value.
+   *
+   * @see ModuleProfiler::RecordDropped
+   */
+  void RecordDropped(const std::string &reason, uint64_t frames = 1) {
+    ModuleProfiler *profiler = module_ ? module_->GetProfiler() : nullptr;
+    if (profiler) profiler->RecordDropped(stream_id_, reason, frames);
+  }
 
  protected:
   SourceModule *module_ = nullptr;
@@ -0,0 +1,292 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_STATIC_PIPELINE_HPP_
+#define CNSTREAM_STATIC_PIPELINE_HPP_
+
+/**
+ * @file cnstream_static_pipeline.hpp
+ *
+ * This file contains a declaration of the StaticPipeline class template.
+ */
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cnstream_common.hpp"
+#include "cnstream_config.hpp"
+#include "cnstream_frame.hpp"
+#include "cnstream_module.hpp"
+#include "profiler/module_profiler.hpp"
+
+namespace cnstream {
+
+/**
+ * @class StaticPipeline
+ *
+ * @brief StaticPipeline runs a chain of modules fixed at compile time, e.g., source -> inferencer -> tracker -> kafka
+ * on the devices whose graphs never change.
+ *
+ * The frames go through the stages in order on the thread providing them, without the dynamic machinery of Pipeline:
+ * the modules are not created by reflection, and there are no connectors, module masks or routes. The stages are
+ * called by qualified names, not virtually, so that their ``Process`` is inlined when the module classes are defined
+ * in the including translation unit and marked final. The adjacent stages are always fused.
+ *
+ * A stage not transmitting data by itself is called by ``Process``, or ``OnEos`` for the EOS frames, and the frame
+ * goes on to the next stage if it returns 0. A stage transmitting data by itself, e.g., a source module or a
+ * ModuleEx, gets all frames and transmits them to the next stage through its observer. The frames transmitted by
+ * the last stage are passed to the callback set by ``SetFrameDoneCallback``.
+ *
+ * The profilers of the stages, enabled by ``EnableProfiling``, record the process of each stage as Pipeline does.
+ *
+ * @tparam Stages The module classes of the stages in order.
+ *
+ * Example:
+ * @code
+ *   StaticPipeline<DataSource, Inferencer, Tracker, Kafka> pipeline(
+ *       std::make_shared<DataSource>("source"), std::make_shared<Inferencer>("infer"),
+ *       std::make_shared<Tracker>("track"), std::make_shared<Kafka>("kafka"));
+ *   pipeline.Open({source_params, infer_params, track_params, kafka_params});
+ *   pipeline.GetStage<0>()->AddSource(handler);
+ * @endcode
+ *
+ * @note The stream removal and the circuit breakers of Pipeline are not supported.
+ */
+template <typename... Stages>
+class StaticPipeline : private NonCopyable {
+ public:
+  static constexpr size_t kStageNum = sizeof...(Stages);
+  static_assert(kStageNum > 0, "StaticPipeline requires at least one stage");
+
+  template <size_t I>
+  using StageType = typename std::tuple_element<I, std::tuple<Stages...>>::type;
+  /**
+   * @brief Notified of the frames going through all stages.
+   */
+  using FrameDoneCallback = std::function<void(const std::shared_ptr<CNFrameInfo> &data)>;
+  /**
+   * @brief Notified of the frames failed by a stage, with the stage and the return number of ``Process``.
+   */
+  using ErrorCallback = std::function<void(Module *stage, const std::shared_ptr<CNFrameInfo> &data, int ret)>;
+
+  /**
+   * @brief Constructs a static pipeline with the modules of the stages.
+   *
+   * @param[in] stages The modules in order. The observers of the modules transmitting data by themselves are set.
+   */
+  explicit StaticPipeline(std::shared_ptr<Stages>... stages) : stages_(std::move(stages)...) {
+    SetObservers<0>();
+  }
+  ~StaticPipeline() { Close(); }
+
+  /**
+   * @brief Opens the modules in order.
+   *
+   * @param[in] params The parameters of each stage.
+   *
+   * @return Returns true if all modules are opened. Otherwise, the modules opened are closed and returns false.
+   */
+  bool Open(const std::vector<ModuleParamSet> &params) {
+    if (params.size() != kStageNum) {
+      LOGE(CORE) << "[StaticPipeline] " << kStageNum << " parameter sets are required, but got " << params.size();
+      return false;
+    }
+    if (!OpenStage<0>(params)) return false;
+    opened_ = true;
+    return true;
+  }
+  /**
+   * @brief Closes the modules in order, the sources stop providing data first.
+   */
+  void Close() {
+    if (!opened_) return;
+    opened_ = false;
+    CloseStage<0>();
+  }
+  /**
+   * @brief Processes a frame by all stages from the first one on the calling thread.
+   *
+   * It is used when the first stage is not a source.
+   *
+   * @param[in] data A pointer to the information of the frame.
+   */
+  void ProvideData(const std::shared_ptr<CNFrameInfo> &data) { Run<0>(data); }
+  /**
+   * @brief Gets the module of a stage.
+   */
+  template <size_t I>
+  StageType<I> *GetStage() const {
+    return std::get<I>(stages_).get();
+  }
+  /**
+   * @brief Sets the callback of the frames going through all stages. It should be set before the frames come.
+   */
+  void SetFrameDoneCallback(FrameDoneCallback callback) { done_callback_ = std::move(callback); }
+  /**
+   * @brief Sets the callback of the frames failed. It should be set before the frames come.
+   */
+  void SetErrorCallback(ErrorCallback callback) { error_callback_ = std::move(callback); }
+  /**
+   * @brief Creates the profilers of the stages, recording ``kPROCESS_PROFILER_NAME``. It should be called before the
+   * frames come.
+   *
+   * @param[in] config The configuration of the profilers.
+   */
+  void EnableProfiling(const ProfilerConfig &config) {
+    profilers_.clear();
+    CreateProfilers<0>(config);
+  }
+  /**
+   * @brief Gets the profiler of a stage.
+   *
+   * @return Returns nullptr if profiling is not enabled.
+   */
+  ModuleProfiler *GetProfiler(size_t stage) const {
+    return stage < profilers_.size() ? profilers_[stage].get() : nullptr;
+  }
+
+ private:
+  template <size_t I>
+  class StageObserver : public IModuleObserver {
+   public:
+    explicit StageObserver(StaticPipeline *pipeline) : pipeline_(pipeline) {}
+    void notify(std::shared_ptr<CNFrameInfo> data) override {
+      pipeline_->EndProfile(I, data);
+      pipeline_->template Run<I + 1>(data);
+    }
+
+   private:
+    StaticPipeline *pipeline_;
+  };
+
+  template <size_t I>
+  typename std::enable_if<(I < kStageNum)>::type SetObservers() {
+    StageType<I> *stage = GetStage<I>();
+    if (stage->HasTransmit()) {
+      observers_.emplace_back(new StageObserver<I>(this));
+      stage->SetObserver(observers_.back().get());
+    }
+    SetObservers<I + 1>();
+  }
+  template <size_t I>
+  typename std::enable_if<(I == kStageNum)>::type SetObservers() {}
+
+  template <size_t I>
+  typename std::enable_if<(I < kStageNum)>::type CreateProfilers(const ProfilerConfig &config) {
+    profilers_.emplace_back(new ModuleProfiler(config, GetStage<I>()->GetName(), nullptr));
+    profilers_.back()->RegisterProcessName(kPROCESS_PROFILER_NAME);
+    CreateProfilers<I + 1>(config);
+  }
+  template <size_t I>
+  typename std::enable_if<(I == kStageNum)>::type CreateProfilers(const ProfilerConfig &config) {}
+
+  template <size_t I>
+  typename std::enable_if<(I < kStageNum), bool>::type OpenStage(const std::vector<ModuleParamSet> &params) {
+    StageType<I> *stage = GetStage<I>();
+    if (!stage->Open(params[I])) {
+      LOGE(CORE) << "[StaticPipeline] " << stage->GetName() << " open failed";
+      CloseStage<0, I>();
+      return false;
+    }
+    return OpenStage<I + 1>(params);
+  }
+  template <size_t I>
+  typename std::enable_if<(I == kStageNum), bool>::type OpenStage(const std::vector<ModuleParamSet> &params) {
+    return true;
+  }
+
+  // closes the stages in [I, End)
+  template <size_t I, size_t End = kStageNum>
+  typename std::enable_if<(I < End)>::type CloseStage() {
+    GetStage<I>()->Close();
+    CloseStage<I + 1, End>();
+  }
+  template <size_t I, size_t End = kStageNum>
+  typename std::enable_if<(I == End)>::type CloseStage() {}
+
+  void StartProfile(size_t stage, const std::shared_ptr<CNFrameInfo> &data) {
+    if (stage < profilers_.size() && !data->IsEos()) {
+      profilers_[stage]->RecordProcessStart(kPROCESS_PROFILER_NAME, data->GetStreamIndex(), data->stream_id,
+                                            data->timestamp);
+    }
+  }
+  void EndProfile(size_t stage, const std::shared_ptr<CNFrameInfo> &data) {
+    if (stage < profilers_.size() && !data->IsEos()) {
+      profilers_[stage]->RecordProcessEnd(kPROCESS_PROFILER_NAME, data->GetStreamIndex(), data->stream_id,
+                                          data->timestamp);
+    }
+  }
+
+  template <size_t I>
+  typename std::enable_if<(I < kStageNum)>::type Run(const std::shared_ptr<CNFrameInfo> &data) {
+    using Stage = StageType<I>;
+    Stage *stage = GetStage<I>();
+    StartProfile(I, data);
+    if (stage->HasTransmit()) {
+      // the stage transmits the frame to the next one through StageObserver
+      int ret = stage->Stage::Process(data);
+      if (ret < 0) Fail(I, stage, data, ret);
+      return;
+    }
+    if (data->IsEos()) {
+      stage->Stage::OnEos(data->stream_id);
+    } else {
+      int ret = stage->Stage::Process(data);
+      if (ret != 0) {
+        Fail(I, stage, data, ret);
+        return;
+      }
+    }
+    EndProfile(I, data);
+    Run<I + 1>(data);
+  }
+  template <size_t I>
+  typename std::enable_if<(I == kStageNum)>::type Run(const std::shared_ptr<CNFrameInfo> &data) {
+    if (done_callback_) done_callback_(data);
+  }
+
+  void Fail(size_t index, Module *stage, const std::shared_ptr<CNFrameInfo> &data, int ret) {
+    EndProfile(index, data);
+    if (error_callback_) {
+      error_callback_(stage, data, ret);
+    } else {
+      LOGE(CORE) << "[StaticPipeline] [" << stage->GetName() << "] [" << data->stream_id
+                 << "] process failed, return number: " << ret;
+    }
+  }
+
+  std::tuple<std::shared_ptr<Stages>...> stages_;
+  std::vector<std::unique_ptr<IModuleObserver>> observers_;
+  std::vector<std::unique_ptr<ModuleProfiler>> profilers_;
+  FrameDoneCallback done_callback_;
+  ErrorCallback error_callback_;
+  bool opened_ = false;
+};  // class StaticPipeline
+
+template <typename... Stages>
+constexpr size_t StaticPipeline<Stages...>::kStageNum;
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_STATIC_PIPELINE_HPP_
@@ -0,0 +1,102 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_AFFINITY_HPP_
+#define CNSTREAM_AFFINITY_HPP_
+
+#include <string>
+#include <vector>
+
+/**
+ *  @file cnstream_affinity.hpp
+ *
+ *  This file contains helpers to bind threads to cpus and NUMA nodes.
+ */
+namespace cnstream {
+
+/**
+ * @brief Parses a cpu list, e.g., "0-3,8,10-11".
+ *
+ * @param[in] cpu_list The cpu list string in the format of ``/sys/devices/system/node/node0/cpulist``.
+ * @param[out] cpus The cpu ids, in ascending order without duplicates.
+ *
+ * @return Returns true if the string is parsed successfully. Otherwise, returns false.
+ */
+bool ParseCpuList(const std::string& cpu_list, std::vector<int>* cpus);
+
+/**
+ * @brief Gets the number of NUMA nodes of the host.
+ *
+ * @return Returns the number of NUMA nodes. Returns 1 if the information is not available.
+ */
+int GetNumaNodeNum();
+
+/**
+ * @brief Gets the cpus of a NUMA node.
+ *
+ * @param[in] numa_node The NUMA node.
+ *
+ * @return Returns the cpu ids of the node. Returns an empty vector if the node does not exist.
+ */
+std::vector<int> GetNumaNodeCpus(int numa_node);
+
+/**
+ * @brief Gets the NUMA node local to a MLU device.
+ *
+ * The MLU devices are ordered by their PCI addresses, the same order used by the driver to number devices.
+ *
+ * @param[in] device_id The device ordinal.
+ *
+ * @return Returns the NUMA node of the PCIe root the device is attached to. Returns -1 if it is unknown.
+ */
+int GetMluNumaNode(int device_id);
+
+/**
+ * @brief Binds the calling thread to cpus.
+ *
+ * @param[in] cpus The cpu ids.
+ * @param[in] numa_node The NUMA node of the cpus, -1 if the cpus do not belong to one node. Host memory allocated
+ *                      by cnCpuMemAlloc in this thread is placed on this node.
+ *
+ * @return Returns true if the thread is bound successfully. Otherwise, returns false.
+ */
+bool SetCurrentThreadAffinity(const std::vector<int>& cpus, int numa_node = -1);
+
+/**
+ * @brief Gets the NUMA node the calling thread is bound to by SetCurrentThreadAffinity.
+ *
+ * @return Returns the NUMA node, or -1 if the thread is not bound to one node.
+ */
+int GetCurrentThreadNumaNode();
+
+/**
+ * @brief Sets the preferred NUMA node of a memory range.
+ *
+ * @param[in] addr The start address, aligned to the page size.
+ * @param[in] size The size of the range.
+ * @param[in] numa_node The NUMA node.
+ *
+ * @return Returns true if the policy is applied. Otherwise, returns false.
+ */
+bool SetMemoryNumaNode(void* addr, size_t size, int numa_node);
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_AFFINITY_HPP_
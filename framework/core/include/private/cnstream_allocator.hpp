@@ -21,8 +21,15 @@
 #define CNSTREAM_ALLOCATOR_HPP_
 
 #include <atomic>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <new>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "cnstream_common.hpp"
 #include "cnstream_logging.hpp"
 #include "util/cnstream_queue.hpp"
@@ -83,9 +90,19 @@ class MluDeviceGuard : public NonCopyable {
  * @return The shared pointer to the allocated memory.
  *
  * @note Because of CNCodec's constraints, the given size will be aligned up to 4096 inside this
- *       function before doing allocation.
+ *       function before doing allocation. If the calling thread is bound to a NUMA node by
+ *       SetCurrentThreadAffinity, the memory is allocated on that node.
  */
 std::shared_ptr<void> cnCpuMemAlloc(size_t size);
+/*!
+ * @brief Allocates CPU memory with the given size on a NUMA node.
+ *
+ * @param[in] size The size needs to be allocated.
+ * @param[in] numa_node The preferred NUMA node, -1 means the default memory policy.
+ *
+ * @return The shared pointer to the allocated memory.
+ */
+std::shared_ptr<void> cnCpuMemAlloc(size_t size, int numa_node);
 /*!
  * @brief Allocates MLU memory with the given size at specific device .
  *
@@ -98,6 +115,339 @@ std::shared_ptr<void> cnCpuMemAlloc(size_t size);
  *       function before doing allocation.
  */
 std::shared_ptr<void> cnMluMemAlloc(size_t size, int device_id);
+/*!
+ * @brief Allocates MLU memory with the given size at specific device and DDR channel.
+ *
+ * @param[in] size The size needs to be allocated.
+ * @param[in] device_id The device ordinal.
+ * @param[in] ddr_chn The DDR channel, -1 means the default channel.
+ *
+ * @return The shared pointer to the allocated memory.
+ *
+ * @note The memory is taken from MluMemoryPool, and is given back to the pool when the last
+ *       reference is released.
+ */
+std::shared_ptr<void> cnMluMemAlloc(size_t size, int device_id, int ddr_chn);
+
+/*!
+ * @struct MemoryPoolStats
+ *
+ * @brief MemoryPoolStats holds the statistics of a memory pool, for MluMemoryPool they are of one device and
+ * DDR channel.
+ */
+struct MemoryPoolStats {
+  size_t in_use_bytes = 0;       ///< The bytes currently handed out to users.
+  size_t cached_bytes = 0;       ///< The bytes of idle blocks kept by the pool.
+  size_t peak_in_use_bytes = 0;  ///< The high-water mark of in_use_bytes.
+  size_t peak_total_bytes = 0;   ///< The high-water mark of in_use_bytes + cached_bytes, the memory footprint.
+  uint64_t alloc_num = 0;        ///< The number of Alloc calls.
+  uint64_t hit_num = 0;          ///< The number of Alloc calls served by a cached block.
+  uint64_t device_alloc_num = 0;  ///< The number of allocations done by the driver.
+  uint64_t device_free_num = 0;   ///< The number of frees done by the driver.
+};
+
+/*!
+ * @class CachingMemoryPool
+ *
+ * @brief CachingMemoryPool is the base class of the size-class caching allocators.
+ *
+ * The requested size is rounded up to a size class, a freed block is kept in the pool and returned by the next
+ * allocation of the same class, unless the idle bytes of its sub-pool would exceed the cache limit.
+ */
+class CachingMemoryPool : public NonCopyable {
+ public:
+  /*!
+   * @brief Destructs an object.
+   *
+   * @return No return value.
+   */
+  virtual ~CachingMemoryPool() = default;
+  /*!
+   * @brief Sets the maximum idle bytes cached for each sub-pool.
+   *
+   * @param[in] bytes The cache limit, 0 disables caching.
+   *
+   * @return No return value.
+   */
+  void SetCacheLimit(size_t bytes);
+  /*!
+   * @brief Gets the maximum idle bytes cached for each sub-pool.
+   *
+   * @return Returns the cache limit.
+   */
+  size_t GetCacheLimit() const;
+  /*!
+   * @brief Gets the size class of the given size.
+   *
+   * Sizes are aligned to 4KB, rounded up to a power of two up to 64KB, and to a quarter of a power of two above.
+   *
+   * @param[in] size The requested size.
+   *
+   * @return Returns the size of the block which will be allocated.
+   */
+  static size_t GetSizeClass(size_t size);
+  /*!
+   * @brief Gets the statistics of all sub-pools used so far.
+   *
+   * @return Returns the statistics keyed by the sub-pool, (device id, DDR channel) for MluMemoryPool, (-1, -1) for
+   *         HostMemoryPool and (NUMA node, -1) for HugePageMemoryPool.
+   */
+  std::map<std::pair<int, int>, MemoryPoolStats> GetAllStats() const;
+
+ protected:
+  /* (device id, DDR channel) */
+  using PoolKey = std::pair<int, int>;
+  explicit CachingMemoryPool(size_t cache_limit) : cache_limit_(cache_limit) {}
+  void* AllocBlock(size_t size, const PoolKey& key);
+  // returns false if ptr is not allocated by the pool
+  bool FreeBlock(void* ptr);
+  // releases the cached blocks of the device, -1 means all devices
+  void ReleaseCachedBlocks(int device_id);
+  MemoryPoolStats GetPoolStats(const PoolKey& key) const;
+  virtual void* RawAlloc(size_t size, const PoolKey& key) = 0;
+  virtual void RawFree(void* ptr, size_t size, const PoolKey& key) = 0;
+
+ private:
+  struct SubPool {
+    std::map<size_t, std::vector<void*>> free_blocks;
+    MemoryPoolStats stats;
+  };
+  struct Block {
+    PoolKey key;
+    size_t size;
+  };
+  // moves the cached blocks of the pool out until its cached bytes are not larger than limit
+  void TakeCachedBlocks(SubPool* pool, size_t limit, std::vector<std::pair<void*, Block>>* blocks);
+
+  mutable std::mutex mutex_;
+  size_t cache_limit_ = 0;
+  std::map<PoolKey, SubPool> pools_;
+  std::unordered_map<void*, Block> blocks_;
+};  // class CachingMemoryPool
+
+/*!
+ * @class MluMemoryPool
+ *
+ * @brief MluMemoryPool is a size-class caching allocator of MLU memory shared by the whole process.
+ *
+ * Blocks are cached per device and per DDR channel.
+ */
+class MluMemoryPool : public CachingMemoryPool {
+ public:
+  /*!
+   * @brief Gets the process-wide pool.
+   *
+   * @return The pool instance.
+   */
+  static MluMemoryPool& Instance();
+  /*!
+   * @brief Allocates MLU memory.
+   *
+   * @param[in] size The size needs to be allocated.
+   * @param[in] device_id The device ordinal.
+   * @param[in] ddr_chn The DDR channel, -1 means the default channel.
+   *
+   * @return Returns the device pointer, or nullptr if the device is out of memory.
+   */
+  void* Alloc(size_t size, int device_id, int ddr_chn = -1);
+  /*!
+   * @brief Gives the memory allocated by Alloc back to the pool.
+   *
+   * @param[in] ptr The device pointer.
+   *
+   * @return No return value.
+   */
+  void Free(void* ptr);
+  /*!
+   * @brief Frees the cached blocks.
+   *
+   * @param[in] device_id The device ordinal, -1 means all devices.
+   *
+   * @return No return value.
+   */
+  void ReleaseCache(int device_id = -1);
+  /*!
+   * @brief Gets the statistics of a device and DDR channel.
+   *
+   * @param[in] device_id The device ordinal.
+   * @param[in] ddr_chn The DDR channel.
+   *
+   * @return Returns the statistics.
+   */
+  MemoryPoolStats GetStats(int device_id, int ddr_chn = -1) const;
+
+  static constexpr size_t kDefaultCacheLimit = 512 << 20;
+
+ private:
+  MluMemoryPool() : CachingMemoryPool(kDefaultCacheLimit) {}
+  void* RawAlloc(size_t size, const PoolKey& key) override;
+  void RawFree(void* ptr, size_t size, const PoolKey& key) override;
+};  // class MluMemoryPool
+
+/*!
+ * @class HostMemoryPool
+ *
+ * @brief HostMemoryPool is a size-class caching allocator of page-locked host memory shared by the whole process.
+ *
+ * Copies between page-locked memory and MLU run at full PCIe bandwidth. The pool is disabled by default, it can be
+ * enabled by SetEnable or by setting the environment variable CNSTREAM_PINNED_HOST_MEMORY to true.
+ */
+class HostMemoryPool : public CachingMemoryPool {
+ public:
+  /*!
+   * @brief Gets the process-wide pool.
+   *
+   * @return The pool instance.
+   */
+  static HostMemoryPool& Instance();
+  /*!
+   * @brief Enables or disables the pool. The memory allocated before is still given back by Free.
+   *
+   * @param[in] enable Whether to use the pool.
+   *
+   * @return No return value.
+   */
+  void SetEnable(bool enable) { enable_.store(enable); }
+  /*!
+   * @brief Checks whether the pool is enabled, users fall back to pageable memory if not.
+   *
+   * @return Returns true if the pool is enabled.
+   */
+  bool IsEnabled() const { return enable_.load(); }
+  /*!
+   * @brief Allocates page-locked host memory.
+   *
+   * @param[in] size The size needs to be allocated.
+   *
+   * @return Returns the host pointer, or nullptr if the allocation failed.
+   */
+  void* Alloc(size_t size);
+  /*!
+   * @brief Gives the memory allocated by Alloc back to the pool.
+   *
+   * @param[in] ptr The host pointer.
+   *
+   * @return No return value.
+   */
+  void Free(void* ptr);
+  /*!
+   * @brief Frees the cached blocks.
+   *
+   * @return No return value.
+   */
+  void ReleaseCache();
+  /*!
+   * @brief Gets the statistics.
+   *
+   * @return Returns the statistics.
+   */
+  MemoryPoolStats GetStats() const;
+
+  static constexpr size_t kDefaultCacheLimit = 256 << 20;
+
+ private:
+  HostMemoryPool();
+  void* RawAlloc(size_t size, const PoolKey& key) override;
+  void RawFree(void* ptr, size_t size, const PoolKey& key) override;
+
+  std::atomic<bool> enable_{false};
+};  // class HostMemoryPool
+
+/*!
+ * @class HugePageMemoryPool
+ *
+ * @brief HugePageMemoryPool is a size-class caching allocator of host memory backed by 2MB huge pages.
+ *
+ * Large frame buffers touch many pages, with 2MB pages far fewer TLB entries are needed. Blocks smaller than a huge
+ * page are carved out of 2MB arenas, larger blocks are mapped separately. If no huge pages are reserved by the system
+ * (vm.nr_hugepages), the memory is mapped with regular pages and transparent huge pages are requested instead.
+ * Blocks are cached per NUMA node. Arenas are never given back to the system, the carved blocks are reused.
+ *
+ * The pool is disabled by default, it can be enabled by SetEnable or by setting the environment variable
+ * CNSTREAM_HUGE_PAGE_MEMORY to true. It is used by ``cnCpuMemAlloc`` and by the CPU data of ``CNSyncedMemory``.
+ */
+class HugePageMemoryPool : public CachingMemoryPool {
+ public:
+  /*!
+   * @brief Gets the process-wide pool.
+   *
+   * @return The pool instance.
+   */
+  static HugePageMemoryPool& Instance();
+  /*!
+   * @brief Enables or disables the pool. The memory allocated before is still given back by Free.
+   *
+   * @param[in] enable Whether to use the pool.
+   *
+   * @return No return value.
+   */
+  void SetEnable(bool enable) { enable_.store(enable); }
+  /*!
+   * @brief Checks whether the pool is enabled, users fall back to their own allocation if not.
+   *
+   * @return Returns true if the pool is enabled.
+   */
+  bool IsEnabled() const { return enable_.load(); }
+  /*!
+   * @brief Allocates host memory.
+   *
+   * @param[in] size The size needs to be allocated.
+   * @param[in] numa_node The preferred NUMA node, -1 means the default memory policy.
+   *
+   * @return Returns the host pointer, or nullptr if the allocation failed.
+   */
+  void* Alloc(size_t size, int numa_node = -1);
+  /*!
+   * @brief Gives the memory allocated by Alloc back to the pool.
+   *
+   * @param[in] ptr The host pointer.
+   *
+   * @return No return value.
+   */
+  void Free(void* ptr);
+  /*!
+   * @brief Frees the cached blocks. Blocks carved out of arenas are kept for reuse.
+   *
+   * @return No return value.
+   */
+  void ReleaseCache();
+  /*!
+   * @brief Gets the statistics of a NUMA node.
+   *
+   * @param[in] numa_node The NUMA node, -1 means the memory allocated with the default memory policy.
+   *
+   * @return Returns the statistics.
+   */
+  MemoryPoolStats GetStats(int numa_node = -1) const;
+  /*!
+   * @brief Gets the bytes currently mapped with huge pages. The other mapped bytes fell back to regular pages.
+   *
+   * @return Returns the bytes mapped with huge pages.
+   */
+  size_t GetHugePageBytes() const { return huge_page_bytes_.load(); }
+
+  static constexpr size_t kHugePageSize = 2 << 20;
+  static constexpr size_t kDefaultCacheLimit = 1024 << 20;
+
+ private:
+  HugePageMemoryPool();
+  void* RawAlloc(size_t size, const PoolKey& key) override;
+  void RawFree(void* ptr, size_t size, const PoolKey& key) override;
+  // maps a region of multiple huge pages, falls back to regular pages
+  void* MapRegion(size_t size, int numa_node);
+  void UnmapRegion(void* ptr, size_t size);
+
+  struct Arena {
+    char* base = nullptr;
+    size_t used = kHugePageSize;
+  };
+  std::atomic<bool> enable_{false};
+  std::atomic<size_t> huge_page_bytes_{0};
+  std::mutex arena_mutex_;
+  std::map<int, Arena> arenas_;  // the arena being carved of each NUMA node
+  std::map<std::pair<PoolKey, size_t>, std::vector<void*>> carved_blocks_;  // carved blocks freed by the cache
+  std::set<void*> huge_page_regions_;  // regions mapped with huge pages
+};  // class HugePageMemoryPool
 
 
 }  // namespace cnstream
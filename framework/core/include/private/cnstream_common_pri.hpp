@@ -24,6 +24,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -116,7 +117,22 @@ class NonCopyable {
 
 constexpr size_t INVALID_MODULE_ID = (size_t)(-1);
 constexpr uint32_t INVALID_STREAM_IDX = (uint32_t)(-1);
-static constexpr uint32_t MAX_STREAM_NUM = 128; /*!< The streams at most allowed. */
+
+/**
+ * The limits of a pipeline. They could be changed at configure time, e.g. cmake -DCNS_MAX_MODULE_NUM=256.
+ * The framework and the applications linking it must be built with the same values.
+ */
+#ifndef CNS_MAX_MODULE_NUM
+#define CNS_MAX_MODULE_NUM 64
+#endif
+#ifndef CNS_MAX_STREAM_NUM
+#define CNS_MAX_STREAM_NUM 128
+#endif
+static_assert(CNS_MAX_MODULE_NUM > 0, "CNS_MAX_MODULE_NUM must be positive");
+static_assert(CNS_MAX_STREAM_NUM > 0, "CNS_MAX_STREAM_NUM must be positive");
+
+static constexpr uint32_t MAX_MODULE_NUM = CNS_MAX_MODULE_NUM; /*!< The modules at most allowed. */
+static constexpr uint32_t MAX_STREAM_NUM = CNS_MAX_STREAM_NUM; /*!< The streams at most allowed. */
 
 #define CNS_JSON_DIR_PARAM_NAME "json_file_dir"
 
@@ -124,6 +140,43 @@ static constexpr uint32_t MAX_STREAM_NUM = 128; /*!< The streams at most allowed
  * @brief Profiler configuration title in JSON configuration file.
  **/
 static constexpr char kProfilerConfigName[] = "profiler_config";
+/**
+ * @brief Scheduler configuration title in JSON configuration file.
+ **/
+static constexpr char kSchedulerConfigName[] = "scheduler_config";
+/**
+ * @brief Frame pool configuration title in JSON configuration file.
+ **/
+static constexpr char kFramePoolConfigName[] = "frame_pool_config";
+/**
+ * @brief Autoscaler configuration title in JSON configuration file.
+ **/
+static constexpr char kAutoscalerConfigName[] = "autoscaler_config";
+/**
+ * @brief Memory budget configuration title in JSON configuration file.
+ **/
+static constexpr char kMemoryBudgetConfigName[] = "memory_budget_config";
+/**
+ * @brief Metrics configuration title in JSON configuration file.
+ **/
+static constexpr char kMetricsConfigName[] = "metrics_config";
+/**
+ * @brief Admission configuration title in JSON configuration file.
+ **/
+static constexpr char kAdmissionConfigName[] = "admission_config";
+
+/**
+ * @brief Checkpoint configuration title in JSON configuration file.
+ **/
+static constexpr char kCheckpointConfigName[] = "checkpoint_config";
+/**
+ * @brief Degradation configuration title in JSON configuration file.
+ **/
+static constexpr char kDegradationConfigName[] = "degradation_config";
+/**
+ * @brief CPU isolation configuration title in JSON configuration file.
+ **/
+static constexpr char kCpuIsolationConfigName[] = "cpu_isolation_config";
 /**
  * @brief Subgraph node item prefix.
  **/
@@ -154,6 +207,19 @@ inline bool IsSubgraphItem(const std::string &item_name) {
  * @note It's used for removing sources forcedly.
  */
 bool CheckStreamEosReached(const std::string &stream_id, bool sync = true);
+/**
+ * @brief Waits for the EOS of several streams at the same time.
+ *
+ * @param[in] stream_ids The identifiers of the streams.
+ * @param[in] reached Called with each stream once its EOS is reached, or it has no EOS to be waited for, like
+ *                    CheckStreamEosReached in synchronized mode.
+ *
+ * @return No return value.
+ *
+ * @note It's used for removing sources forcedly.
+ */
+void WaitStreamsEosReached(const std::vector<std::string> &stream_ids,
+                           const std::function<void(const std::string &stream_id)> &reached);
 /**
  * @brief Checks one stream whether reaches EOS.
  *
@@ -0,0 +1,149 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+#ifndef CNSTREAM_MODULE_MASK_HPP_
+#define CNSTREAM_MODULE_MASK_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "cnstream_common_pri.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief A fixed size bitset with one bit for each module id of a pipeline.
+ *
+ * The size is decided by CNS_MAX_MODULE_NUM at compile time. With the default value, the mask is a single
+ * uint64_t and every operation is one or two instructions.
+ */
+class ModuleMask {
+ public:
+  static constexpr size_t kWordNum = (MAX_MODULE_NUM + 63) / 64;
+
+  ModuleMask() {
+    for (size_t i = 0; i < kWordNum; ++i) words_[i] = 0;
+  }
+  void Set(size_t id) { words_[id >> 6] |= (uint64_t)1 << (id & 63); }
+  void Reset(size_t id) { words_[id >> 6] &= ~((uint64_t)1 << (id & 63)); }
+  bool Test(size_t id) const { return words_[id >> 6] & ((uint64_t)1 << (id & 63)); }
+  bool Any() const {
+    for (size_t i = 0; i < kWordNum; ++i) {
+      if (words_[i]) return true;
+    }
+    return false;
+  }
+  /**
+   * @brief Checks whether all bits set in ``other`` are also set in this mask.
+   */
+  bool Contains(const ModuleMask& other) const {
+    for (size_t i = 0; i < kWordNum; ++i) {
+      if ((words_[i] & other.words_[i]) != other.words_[i]) return false;
+    }
+    return true;
+  }
+  ModuleMask& operator|=(const ModuleMask& other) {
+    for (size_t i = 0; i < kWordNum; ++i) words_[i] |= other.words_[i];
+    return *this;
+  }
+  ModuleMask operator^(const ModuleMask& other) const {
+    ModuleMask ret;
+    for (size_t i = 0; i < kWordNum; ++i) ret.words_[i] = words_[i] ^ other.words_[i];
+    return ret;
+  }
+  bool operator==(const ModuleMask& other) const {
+    for (size_t i = 0; i < kWordNum; ++i) {
+      if (words_[i] != other.words_[i]) return false;
+    }
+    return true;
+  }
+  bool operator!=(const ModuleMask& other) const { return !(*this == other); }
+
+ private:
+  friend class AtomicModuleMask;
+  uint64_t words_[kWordNum];
+};  // class ModuleMask
+
+/**
+ * @brief A ModuleMask that could be updated by several threads at the same time.
+ *
+ * When the mask fits in one word, all operations are plain atomic operations. Otherwise a spin lock is used
+ * to keep ``FetchSet`` linearizable, so that exactly one of the concurrent callers gets the mask with all bits set.
+ */
+class AtomicModuleMask {
+ public:
+  AtomicModuleMask() {
+    for (size_t i = 0; i < ModuleMask::kWordNum; ++i) words_[i].store(0, std::memory_order_relaxed);
+  }
+
+  void Store(const ModuleMask& mask) {
+    Lock();
+    for (size_t i = 0; i < ModuleMask::kWordNum; ++i) words_[i].store(mask.words_[i], std::memory_order_release);
+    Unlock();
+  }
+
+  ModuleMask Load() {
+    ModuleMask ret;
+    Lock();
+    for (size_t i = 0; i < ModuleMask::kWordNum; ++i) ret.words_[i] = words_[i].load(std::memory_order_acquire);
+    Unlock();
+    return ret;
+  }
+
+  /**
+   * @brief Sets the bit of ``id``.
+   *
+   * @return Returns the mask right after the bit is set.
+   */
+  ModuleMask FetchSet(size_t id) {
+    const size_t word_idx = id >> 6;
+    const uint64_t bit = (uint64_t)1 << (id & 63);
+    ModuleMask ret;
+    if (ModuleMask::kWordNum == 1) {
+      ret.words_[0] = words_[0].fetch_or(bit, std::memory_order_acq_rel) | bit;
+      return ret;
+    }
+    Lock();
+    const uint64_t old = words_[word_idx].load(std::memory_order_relaxed);
+    words_[word_idx].store(old | bit, std::memory_order_relaxed);
+    for (size_t i = 0; i < ModuleMask::kWordNum; ++i) ret.words_[i] = words_[i].load(std::memory_order_relaxed);
+    Unlock();
+    return ret;
+  }
+
+ private:
+  void Lock() {
+    if (ModuleMask::kWordNum == 1) return;
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+      while (locked_.load(std::memory_order_relaxed)) {}
+    }
+  }
+  void Unlock() {
+    if (ModuleMask::kWordNum == 1) return;
+    locked_.store(false, std::memory_order_release);
+  }
+
+  std::atomic<uint64_t> words_[ModuleMask::kWordNum];
+  std::atomic<bool> locked_{false};
+};  // class AtomicModuleMask
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_MODULE_MASK_HPP_
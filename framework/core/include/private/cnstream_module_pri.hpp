@@ -216,6 +216,52 @@ class ModuleCreator {
 template <typename T>
 typename ModuleCreator<T>::Register ModuleCreator<T>::register_;
 
+/**
+ * @brief The states of the streams of a pipeline indexed by the stream index.
+ *
+ * The state of an index is one word, the generation of the index in the high bits, whether the index is assigned to
+ * a stream and whether the stream is removed in the low bits. The generation is increased every time the index is
+ * assigned, so that a removal racing with the reuse of the index does not mark the new stream. Reading a state is
+ * a single relaxed load.
+ */
+class StreamStateTable {
+ public:
+  static constexpr uint64_t kRemoved = 1;
+  static constexpr uint64_t kAssigned = 2;
+  static constexpr uint64_t kGeneration = 4;
+
+  StreamStateTable() {
+    for (auto& state : states_) state.store(0, std::memory_order_relaxed);
+  }
+  StreamStateTable(const StreamStateTable&) = delete;
+  StreamStateTable& operator=(const StreamStateTable&) = delete;
+  // assigns the index to a new stream which is not removed, returns the state
+  uint64_t Assign(uint32_t idx) {
+    uint64_t state = states_[idx].load(std::memory_order_relaxed);
+    uint64_t assigned;
+    do {
+      assigned = (state & ~(kGeneration - 1)) + kGeneration + kAssigned;
+    } while (!states_[idx].compare_exchange_weak(state, assigned, std::memory_order_relaxed));
+    return assigned;
+  }
+  void Unassign(uint32_t idx) { states_[idx].fetch_and(~(kAssigned | kRemoved), std::memory_order_relaxed); }
+  // sets the removed flag if the index is still in the generation of ``state``, returns false otherwise
+  bool SetRemoved(uint32_t idx, uint64_t state, bool removed) {
+    uint64_t current = states_[idx].load(std::memory_order_relaxed);
+    do {
+      if ((current | kRemoved) != (state | kRemoved)) return false;
+    } while (!states_[idx].compare_exchange_weak(current, removed ? current | kRemoved : current & ~kRemoved,
+                                                  std::memory_order_relaxed));
+    return true;
+  }
+  uint64_t Load(uint32_t idx) const {
+    return idx < MAX_STREAM_NUM ? states_[idx].load(std::memory_order_relaxed) : 0;
+  }
+
+ private:
+  std::atomic<uint64_t> states_[MAX_STREAM_NUM];
+};  // class StreamStateTable
+
 /**
  * @brief ModuleId&StreamIdx manager for pipeline. Allocates and deallocates id for Pipeline modules & streams.
  */
@@ -224,16 +270,24 @@ class IdxManager {
   IdxManager() = default;
   IdxManager(const IdxManager&) = delete;
   IdxManager& operator=(const IdxManager&) = delete;
-  uint32_t GetStreamIndex(const std::string& stream_id);
+  // assigned is set to true if the index is assigned to the stream by this call
+  uint32_t GetStreamIndex(const std::string& stream_id, bool* assigned = nullptr);
+  // returns INVALID_STREAM_IDX if no index is assigned to the stream
+  uint32_t FindStreamIndex(const std::string& stream_id);
   void ReturnStreamIndex(const std::string& stream_id);
   size_t GetModuleIdx();
   void ReturnModuleIdx(size_t id_);
+  // marks the stream removed or not, returns false if no index is assigned to the stream
+  bool SetStreamRemoved(const std::string& stream_id, bool removed);
+  // gets the state of the stream index, see StreamStateTable
+  uint64_t GetStreamState(uint32_t stream_idx) const { return stream_states.Load(stream_idx); }
 
  private:
   std::mutex id_lock;
   std::map<std::string, uint32_t> stream_idx_map;
   std::bitset<MAX_STREAM_NUM> stream_bitset;
-  uint64_t module_id_mask_ = 0;
+  std::bitset<MAX_MODULE_NUM> module_id_bitset;
+  StreamStateTable stream_states;
 };  // class IdxManager
 
 }  // namespace cnstream
@@ -0,0 +1,68 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_PARALLEL_HPP_
+#define CNSTREAM_PARALLEL_HPP_
+
+#include <functional>
+
+/**
+ *  @file cnstream_parallel.hpp
+ *
+ *  This file contains helpers to split row-wise work, e.g. color conversion of large frames, into bands
+ *  running on a small process-wide worker pool.
+ */
+namespace cnstream {
+
+/**
+ * @brief Splits the rows [0, total) into bands and processes them concurrently.
+ *
+ * The calling thread processes the first band itself, and returns after all bands are done. Calls from
+ * the pool threads, and ranges shorter than two bands, are processed on the calling thread directly.
+ *
+ * @param[in] total The number of rows.
+ * @param[in] min_band The minimum number of rows of a band.
+ * @param[in] align The boundaries of bands are multiples of it, e.g. 2 for YUV420 frames.
+ * @param[in] func The function called with [begin, end) of each band. It is called concurrently.
+ *
+ * @return No return value.
+ */
+void ParallelFor(int total, int min_band, int align, const std::function<void(int begin, int end)>& func);
+
+/**
+ * @brief Sets the maximum number of pool threads used by each ParallelFor call.
+ *
+ * @param[in] thread_num The number of threads, 0 means all bands are processed on the calling thread.
+ *                       It is limited by the size of the pool.
+ *
+ * @return No return value.
+ */
+void SetParallelThreadNum(int thread_num);
+
+/**
+ * @brief Gets the maximum number of pool threads used by each ParallelFor call.
+ *
+ * @return Returns the number of threads.
+ */
+int GetParallelThreadNum();
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_PARALLEL_HPP_
@@ -0,0 +1,125 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_LATENCY_BREAKDOWN_PROFILER_HPP_
+#define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_LATENCY_BREAKDOWN_PROFILER_HPP_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_common.hpp"
+#include "cnstream_frame.hpp"
+#include "profiler/profile.hpp"
+
+/*!
+ *  @file latency_breakdown_profiler.hpp
+ *
+ *  This file contains a declaration of the LatencyBreakdownProfiler class.
+ */
+namespace cnstream {
+
+/*!
+ * @brief A module of the pipeline seen by LatencyBreakdownProfiler.
+ */
+struct LatencyBreakdownNode {
+  uint32_t module_id = 0;            /*!< The id of the module, see Module::GetId(). */
+  std::string module_name;           /*!< The name of the module. */
+  std::vector<uint32_t> parent_ids;  /*!< The ids of the parent modules, empty for the head modules. */
+};  // struct LatencyBreakdownNode
+
+/*!
+ * @class LatencyBreakdownProfiler
+ *
+ * @brief LatencyBreakdownProfiler breaks the latency of frames down into the queue wait and the process time of each
+ * module by the times carried by the frames, see CNFrameInfo::GetModuleTimes, and finds the critical path of every
+ * frame. It is used by PipelineProfiler.
+ *
+ * @see cnstream::StreamLatencyBreakdown.
+ *
+ * @note This class is thread safe.
+ */
+class LatencyBreakdownProfiler : private NonCopyable {
+ public:
+  /*!
+   * @brief Constructs a LatencyBreakdownProfiler object.
+   *
+   * @param[in] nodes All modules of the pipeline in topological order.
+   *
+   * @return No return value.
+   */
+  explicit LatencyBreakdownProfiler(const std::vector<LatencyBreakdownNode>& nodes);
+
+  /*!
+   * @brief Adds a frame passed through all modules.
+   *
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] times The times of the frame indexed by module id, see CNFrameInfo::GetModuleTimes.
+   *
+   * @return No return value.
+   */
+  void AddFrame(const std::string& stream_name, const std::vector<CNFrameInfo::ModuleTimes>& times);
+
+  /*!
+   * @brief Clears the statistics of the stream named by ``stream_name``, as the end of the stream is reached.
+   *
+   * @param[in] stream_name The name of the stream.
+   *
+   * @return No return value.
+   */
+  void OnStreamEos(const std::string& stream_name);
+
+  /*!
+   * @brief Gets the latency breakdowns of the streams since they start.
+   *
+   * @return Returns the breakdowns ordered by stream name.
+   */
+  std::vector<StreamLatencyBreakdown> GetBreakdowns() const;
+
+ private:
+  struct ModuleStats {
+    uint64_t frames = 0;
+    int64_t total_wait = 0;
+    int64_t maximum_wait = 0;
+    int64_t total_process = 0;
+    int64_t maximum_process = 0;
+    uint64_t critical_frames = 0;
+    int64_t critical_wait = 0;
+    int64_t critical_process = 0;
+  };  // struct ModuleStats
+
+  struct StreamStats {
+    uint64_t frames = 0;
+    int64_t total_latency = 0;
+    std::vector<ModuleStats> modules;
+  };  // struct StreamStats
+
+  std::vector<LatencyBreakdownNode> nodes_;
+  // node index of each module id, -1 for the ids not in the pipeline
+  std::vector<int> node_indexes_;
+  mutable std::mutex lk_;
+  std::map<std::string, StreamStats> streams_;
+};  // class LatencyBreakdownProfiler
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_LATENCY_BREAKDOWN_PROFILER_HPP_
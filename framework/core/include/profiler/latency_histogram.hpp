@@ -0,0 +1,155 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_LATENCY_HISTOGRAM_HPP_
+#define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_LATENCY_HISTOGRAM_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/*!
+ *  @file latency_histogram.hpp
+ *
+ *  This file contains a declaration of the LatencyHistogram class.
+ */
+namespace cnstream {
+
+/*!
+ * @class LatencyHistogram
+ *
+ * @brief LatencyHistogram counts latencies in log-linear buckets to estimate percentiles, like an HDR histogram.
+ *
+ * Latencies are counted in microseconds. Values below 32us have a bucket each, every power of two above is split
+ * into 16 buckets, so that a percentile is within 1/32 of the real value, up to 2^32us (about 71 minutes). Larger
+ * values are counted in the last bucket. The memory is fixed and histograms of the same layout can be merged.
+ *
+ * Record and Merge are lock-free and can be called concurrently, Percentile reads a snapshot of the counters that may
+ * be torn by the concurrent writers.
+ */
+class LatencyHistogram {
+  using Duration = std::chrono::duration<double, std::milli>;
+
+ public:
+  static constexpr uint32_t kSubBucketBits = 4;                                   /*!< log2 of buckets per octave. */
+  static constexpr uint32_t kLinearBuckets = 2u << kSubBucketBits;                 /*!< Buckets of one microsecond. */
+  static constexpr uint32_t kMaxBits = 32;                                        /*!< log2 of the largest value. */
+  static constexpr uint32_t kBucketCount =
+      kLinearBuckets + (kMaxBits - kSubBucketBits - 1) * (1u << kSubBucketBits);  /*!< The number of buckets. */
+
+  LatencyHistogram();
+  /*!
+   * @brief Constructs a LatencyHistogram object with a snapshot of the counters of another one.
+   *
+   * @param[in] other Another object.
+   *
+   * @return No return value.
+   */
+  LatencyHistogram(const LatencyHistogram& other);
+  /*!
+   * @brief Replaces the counters with a snapshot of the counters of another one.
+   *
+   * @param[in] other Another object.
+   *
+   * @return Returns a lvalue reference to the current instance.
+   */
+  LatencyHistogram& operator=(const LatencyHistogram& other);
+
+  /*!
+   * @brief Counts a latency.
+   *
+   * @param[in] latency The latency. Negative latencies are counted as zero.
+   *
+   * @return No return value.
+   */
+  void Record(const Duration& latency);
+
+  /*!
+   * @brief Adds the counters of another histogram to this one.
+   *
+   * @param[in] other Another histogram.
+   *
+   * @return No return value.
+   */
+  void Merge(const LatencyHistogram& other);
+
+  /*!
+   * @brief Gets a percentile of the latencies counted.
+   *
+   * @param[in] quantile The quantile in [0, 1], e.g. 0.99 for p99.
+   *
+   * @return Returns the percentile in milliseconds, the middle of the bucket it falls into. Returns 0 if nothing is
+   *         counted.
+   */
+  double Percentile(double quantile) const;
+
+  /*!
+   * @brief Gets the number of latencies counted.
+   *
+   * @return Returns the number of latencies counted.
+   */
+  uint64_t Count() const;
+
+  /*!
+   * @brief Clears the counters.
+   *
+   * @return No return value.
+   */
+  void Reset();
+
+  /*!
+   * @brief Gets the bucket of a value.
+   *
+   * @param[in] us The value in microseconds.
+   *
+   * @return Returns the index of the bucket.
+   */
+  static uint32_t BucketIndex(uint64_t us);
+
+  /*!
+   * @brief Gets the range of a bucket.
+   *
+   * @param[in] index The index of the bucket.
+   * @param[out] lower The smallest value of the bucket in microseconds.
+   * @param[out] upper The value after the largest one of the bucket in microseconds.
+   *
+   * @return No return value.
+   */
+  static void BucketRange(uint32_t index, uint64_t* lower, uint64_t* upper);
+
+ private:
+  std::atomic<uint64_t> counts_[kBucketCount];
+  std::atomic<uint64_t> total_;
+};  // class LatencyHistogram
+
+inline void LatencyHistogram::Record(const Duration& latency) {
+  double us = latency.count() * 1e3;
+  uint64_t value = us > 0 ? (us >= 1.8e19 ? UINT64_MAX : static_cast<uint64_t>(us)) : 0;
+  counts_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  total_.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::Count() const {
+  return total_.load(std::memory_order_relaxed);
+}
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_LATENCY_HISTOGRAM_HPP_
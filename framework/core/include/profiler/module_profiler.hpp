@@ -22,11 +22,13 @@
 #define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_MODULE_PROFILER_HPP_
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <map>
 
 #include "cnstream_common.hpp"
 #include "cnstream_config.hpp"
+#include "profiler/perf_counters.hpp"
 #include "profiler/process_profiler.hpp"
 #include "profiler/profile.hpp"
 #include "profiler/trace.hpp"
@@ -41,6 +43,34 @@ namespace cnstream {
 static constexpr char kPROCESS_PROFILER_NAME[] = "PROCESS";
 static constexpr char kINPUT_PROFILER_NAME[]   = "INPUT_QUEUE";
 
+/*! The frames dropped by the input queue of a module as it is full, see QueueFullPolicy. */
+static constexpr char kDROP_REASON_QUEUE_FULL[]   = "queue_full";
+/*! The frames skipped by an interval, e.g. the ``interval`` of the sources and the ``infer_interval``. */
+static constexpr char kDROP_REASON_INTERVAL[]     = "interval";
+/*! The frames skipped by a filter, e.g. a FrameFilter. */
+static constexpr char kDROP_REASON_FILTER[]       = "filter";
+/*! The frames skipped as they are too late. */
+static constexpr char kDROP_REASON_LATE[]         = "late";
+/*! The frames lost as the data is corrupt, e.g. reported by the decoders. */
+static constexpr char kDROP_REASON_CORRUPT_DATA[] = "corrupt_data";
+/*! The frames dropped to keep a target frame rate, e.g. by the encoders. */
+static constexpr char kDROP_REASON_RATE_CONTROL[] = "rate_control";
+/*! The frames lost as the data could not be read, e.g. by ImageSetHandler. */
+static constexpr char kDROP_REASON_READ_ERROR[]   = "read_error";
+/*! The frames rejected by the admission control of an overloaded pipeline, see AdmissionConfig. */
+static constexpr char kDROP_REASON_ADMISSION[]    = "admission";
+/*! The frames dropped from the input queues as their stream is removed by force, see SourceModule::RemoveSource. */
+static constexpr char kDROP_REASON_REMOVED[]      = "removed";
+/*! The frames bypassing a module as its circuit breaker is open, see CircuitBreakerConfig. */
+static constexpr char kDROP_REASON_BYPASSED[]     = "bypassed";
+/*! The frames skipping a module as the pipeline is degraded, see DegradationConfig. */
+static constexpr char kDROP_REASON_DEGRADED[]     = "degraded";
+/*! The frames not inferred as their results are cached, e.g. by the ``result_cache_size`` of Inferencer2. */
+static constexpr char kDROP_REASON_CACHED[]       = "cached";
+/*! The frames of the low priority streams skipped before decoding as the decoders are saturated, see the
+ *  ``decode_priority`` of DataSource. */
+static constexpr char kDROP_REASON_DECODE_PRESSURE[] = "decode_pressure";
+
 class PipelineTracer;
 
 /*!
@@ -106,6 +136,38 @@ class ModuleProfiler : private NonCopyable {
    */
   bool RecordProcessEnd(const std::string& process_name, const RecordKey& key);
 
+  /*!
+   * @brief Records the start of a process named ``process_name`` for a frame of a stream identified by its index.
+   *
+   * @param[in] process_name The name of the process. It should be registed by ``RegisterProcessName``.
+   * @param[in] stream_index The index of the stream, usually ``CNFrameInfo::GetStreamIndex()``.
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] timestamp The timestamp of the frame, unique in the stream.
+   *
+   * @return Returns true if recording is successful. Returns false if the process named by ``process_name`` is not
+   *         registered by ``RegisterProcessName``.
+   *
+   * @see cnstream::ProcessProfiler::RecordStart(uint32_t, const std::string&, int64_t)
+   */
+  bool RecordProcessStart(const std::string& process_name, uint32_t stream_index, const std::string& stream_name,
+                          int64_t timestamp);
+
+  /*!
+   * @brief Records the end of a process named ``process_name`` for a frame of a stream identified by its index.
+   *
+   * @param[in] process_name The name of the process. It should be registed by ``RegisterProcessName``.
+   * @param[in] stream_index The index of the stream, usually ``CNFrameInfo::GetStreamIndex()``.
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] timestamp The timestamp of the frame, unique in the stream.
+   *
+   * @return Returns true if record successfully. Returns false if the process named by ``process_name`` has not been
+   *         registered by ``RegisterProcessName``.
+   *
+   * @see cnstream::ProcessProfiler::RecordEnd(uint32_t, const std::string&, int64_t)
+   */
+  bool RecordProcessEnd(const std::string& process_name, uint32_t stream_index, const std::string& stream_name,
+                        int64_t timestamp);
+
   /*!
    * @brief Clears profiling data of the stream named by ``stream_name``, as the end of the stream is reached.
    *
@@ -115,6 +177,89 @@ class ModuleProfiler : private NonCopyable {
    */
   void OnStreamEos(const std::string& stream_name);
 
+  /*!
+   * @brief Records the input queue (conveyor) of the stream named by ``stream_name``.
+   *
+   * It is called by the pipeline when a stream is mapped to a new conveyor. See CNModuleConfig::rebalanceStreams.
+   *
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] conveyor_idx The index of the conveyor.
+   *
+   * @return No return value.
+   */
+  void RecordConveyorIdx(const std::string& stream_name, int conveyor_idx);
+
+  /*!
+   * @brief Adds ``value`` to the counter named by ``counter_name``. The counter is created if it does not exist.
+   *
+   * Modules use counters to report statistics which are not latencies, e.g. the hits and lookups of a cache,
+   * and they are reported in ModuleProfile::counters. Counters are not cleared at the end of streams.
+   *
+   * @param[in] counter_name The name of the counter.
+   * @param[in] value The value added to the counter.
+   *
+   * @return No return value.
+   */
+  void AddCounter(const std::string& counter_name, uint64_t value);
+
+  /*!
+   * @brief Adds the hardware counters of a Process call to the counters ``perf_cycles``, ``perf_instructions``,
+   *        ``perf_llc_misses`` and ``perf_context_switches``, and counts the call in ``perf_samples``. It is called
+   *        by the pipeline when ProfilerConfig::enable_perf_counters is true.
+   *
+   * @param[in] values The increments of the counters of the thread during the call, see PerfCounters.
+   *
+   * @return No return value.
+   */
+  void AddPerfCounters(const PerfCounterValues& values);
+
+  /*!
+   * @brief Records frames of the stream named by ``stream_name`` received by the module. The pipeline records the
+   *        frames pushed into the input queue, the source modules record the frames they produce, e.g. decode.
+   *
+   * The frame accounting of a stream is reported in ModuleProfile::stream_frame_accountings until the end of the
+   * stream, and it is added to ModuleProfile::frame_accounting.
+   *
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] frames The number of frames.
+   *
+   * @return No return value.
+   */
+  void RecordReceived(const std::string& stream_name, uint64_t frames = 1);
+
+  /*!
+   * @brief Records frames of the stream named by ``stream_name`` dropped by the module.
+   *
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] reason Why the frames are dropped, e.g. kDROP_REASON_INTERVAL.
+   * @param[in] frames The number of frames.
+   *
+   * @return No return value.
+   */
+  void RecordDropped(const std::string& stream_name, const std::string& reason, uint64_t frames = 1);
+
+  /*!
+   * @brief Records the time a frame of the stream named by ``stream_name`` waited for the full input queue of the
+   *        module. It is called by the pipeline.
+   *
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] stalled The time waited. (unit:ms)
+   *
+   * @return No return value.
+   */
+  void RecordStalled(const std::string& stream_name, double stalled);
+
+  /*!
+   * @brief Records the call of Module::Open when the pipeline starts. It is called by the pipeline, and it is
+   *        reported in ModuleProfile::open_begin and ModuleProfile::open_time.
+   *
+   * @param[in] begin When Module::Open was called, relative to the start of the pipeline. (unit:ms)
+   * @param[in] time The time spent in Module::Open. (unit:ms)
+   *
+   * @return No return value.
+   */
+  void RecordOpen(double begin, double time);
+
   /*!
    * @brief Gets the name of the module.
    *
@@ -142,11 +287,26 @@ class ModuleProfiler : private NonCopyable {
   // Gets process profiler by ``process_name``.
   ProcessProfiler* GetProcessProfiler(const std::string& process_name);
 
+  struct FrameCounts {
+    uint64_t received = 0;
+    std::map<std::string, uint64_t> dropped;
+    double stalled = 0;
+  };
+  // Fills the frame accounting of the profile, stats_mutex_ should be held.
+  void FillFrameAccounting(ModuleProfile* profile) const;
+
  private:
   ProfilerConfig config_;
   std::string module_name_ = "";
   PipelineTracer* tracer_ = nullptr;
   std::map<std::string, std::unique_ptr<ProcessProfiler>> process_profilers_;
+  std::mutex stats_mutex_;
+  std::map<std::string, int> stream_conveyors_;
+  std::map<std::string, uint64_t> counters_;
+  FrameCounts frame_counts_;
+  std::map<std::string, FrameCounts> stream_frame_counts_;
+  double open_begin_ = 0;
+  double open_time_ = 0;
 };  // class ModuleProfiler
 
 inline std::string ModuleProfiler::GetName() const {
@@ -0,0 +1,120 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PERF_COUNTERS_HPP_
+#define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PERF_COUNTERS_HPP_
+
+#include <cstdint>
+
+#include "cnstream_common.hpp"
+
+/*!
+ *  @file perf_counters.hpp
+ *
+ *  This file contains a declaration of the PerfCounters class.
+ */
+namespace cnstream {
+
+/*!
+ * @struct PerfCounterValues
+ *
+ * @brief PerfCounterValues is a structure holding the values of the counters of a thread.
+ */
+struct PerfCounterValues {
+  uint64_t cycles = 0;            /*!< The CPU cycles in user space. */
+  uint64_t instructions = 0;      /*!< The instructions retired in user space. */
+  uint64_t llc_misses = 0;        /*!< The last level cache misses in user space. */
+  uint64_t context_switches = 0;  /*!< The voluntary and involuntary context switches. */
+};  // struct PerfCounterValues
+
+/*!
+ * @brief Gets the increments of the counters from ``start`` to ``end``.
+ *
+ * @param[in] end The values read later.
+ * @param[in] start The values read earlier.
+ *
+ * @return Returns the increments.
+ */
+inline PerfCounterValues operator-(const PerfCounterValues& end, const PerfCounterValues& start) {
+  PerfCounterValues values;
+  values.cycles = end.cycles - start.cycles;
+  values.instructions = end.instructions - start.instructions;
+  values.llc_misses = end.llc_misses - start.llc_misses;
+  values.context_switches = end.context_switches - start.context_switches;
+  return values;
+}
+
+/*!
+ * @class PerfCounters
+ *
+ * @brief PerfCounters reads the hardware counters of the calling thread.
+ *
+ * The cycles, instructions and last level cache misses are counted by a perf_event group of the thread in user
+ * space only, so that it works with ``kernel.perf_event_paranoid`` up to 2. They are read by one system call. The
+ * context switches are read from ``getrusage``. The hardware counters are 0 if perf events are not supported, e.g.
+ * in a virtual machine without a PMU or a container forbidding ``perf_event_open``.
+ */
+class PerfCounters : private NonCopyable {
+ public:
+  /*!
+   * @brief Gets the counters of the calling thread, they are opened by the first call of the thread.
+   *
+   * @return Returns the counters of the thread.
+   */
+  static PerfCounters* ThreadInstance();
+
+  /*!
+   * @brief Destructs a PerfCounters object. The perf events are closed.
+   *
+   * @return No return value.
+   */
+  ~PerfCounters();
+
+  /*!
+   * @brief Reads the counters. It should be called by the thread owning the counters.
+   *
+   * @param[out] values The values of the counters since they are opened.
+   *
+   * @return Returns false if the hardware counters are not supported, they are 0 then.
+   */
+  bool Read(PerfCounterValues* values) const;
+
+  /*!
+   * @brief Checks whether the hardware counters are supported.
+   *
+   * @return Returns true if the perf events are opened.
+   */
+  bool IsHardwareSupported() const { return group_fd_ >= 0; }
+
+ private:
+  PerfCounters();
+
+  int group_fd_ = -1;
+  // the index of each counter in the values read from the group, -1 if it fails to be opened
+  int cycles_index_ = -1;
+  int instructions_index_ = -1;
+  int llc_misses_index_ = -1;
+  int fds_[3] = {-1, -1, -1};
+  int fd_num_ = 0;
+};  // class PerfCounters
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PERF_COUNTERS_HPP_
@@ -21,13 +21,18 @@
 #ifndef CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PIPELINE_PROFILER_HPP_
 #define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PIPELINE_PROFILER_HPP_
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <map>
 
 #include "cnstream_common.hpp"
 #include "cnstream_config.hpp"
+#include "cnstream_frame.hpp"
+#include "profiler/latency_breakdown_profiler.hpp"
 #include "profiler/process_profiler.hpp"
 #include "profiler/profile.hpp"
 #include "profiler/trace.hpp"
@@ -44,6 +49,18 @@ class ModuleProfiler;
 
 static constexpr char kOVERALL_PROCESS_NAME[] = "OVERALL";
 
+/*!
+ * @brief The function reading the utilization of the devices, e.g. by CNDev. It is called by
+ *        PipelineProfiler::GetProfile to fill PipelineProfile::device_utilizations.
+ */
+using DeviceUtilizationSampler = std::function<std::vector<DeviceUtilization>()>;
+
+/*!
+ * @brief The function reading the CPU usage of the threads of the pipeline. It is called by
+ *        PipelineProfiler::GetProfile to fill PipelineProfile::cpu_usage.
+ */
+using CpuUsageSampler = std::function<CpuUsage()>;
+
 /*!
  * @class PipelineProfiler
  *
@@ -110,6 +127,8 @@ class PipelineProfiler : private NonCopyable {
   /*!
    * @brief Gets profiling results of the pipeline during the execution of the program.
    *
+   * The memory usage is filled if the memory accountant is enabled, see MemoryBudgetConfig.
+   *
    * @return Returns the profiling results.
    */
   PipelineProfile GetProfile();
@@ -166,6 +185,28 @@ class PipelineProfiler : private NonCopyable {
    */
   void RecordOutput(const RecordKey& key);
 
+  /*!
+   * @brief Records the time when the data of a stream identified by its index enters the pipeline.
+   *
+   * @param[in] stream_index The index of the stream, usually ``CNFrameInfo::GetStreamIndex()``.
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] timestamp The timestamp of the frame, unique in the stream.
+   *
+   * @return No return value.
+   */
+  void RecordInput(uint32_t stream_index, const std::string& stream_name, int64_t timestamp);
+
+  /*!
+   * @brief Records the time when the data of a stream identified by its index exits the pipeline.
+   *
+   * @param[in] stream_index The index of the stream, usually ``CNFrameInfo::GetStreamIndex()``.
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] timestamp The timestamp of the frame, unique in the stream.
+   *
+   * @return No return value.
+   */
+  void RecordOutput(uint32_t stream_index, const std::string& stream_name, int64_t timestamp);
+
   /*!
    * @brief Clears profiling data of the stream named by ``stream_name``, as the end of the stream is reached.
    *
@@ -175,13 +216,91 @@ class PipelineProfiler : private NonCopyable {
    */
   void OnStreamEos(const std::string& stream_name);
 
+  /*!
+   * @brief Starts to break the latency of frames down by modules. It takes effect only if
+   *        ``config.enable_latency_breakdown`` is true.
+   *
+   * @param[in] nodes All modules of the pipeline in topological order.
+   *
+   * @return No return value.
+   */
+  void InitLatencyBreakdown(const std::vector<LatencyBreakdownNode>& nodes);
+
+  /*!
+   * @brief Checks whether the latency of frames is broken down by modules.
+   *
+   * @return Returns true if InitLatencyBreakdown has taken effect.
+   */
+  bool IsLatencyBreakdownEnabled() const;
+
+  /*!
+   * @brief Records the times when a frame passes through the modules, as the frame exits the pipeline.
+   *
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] times The times of the frame, see CNFrameInfo::GetModuleTimes.
+   *
+   * @return No return value.
+   */
+  void RecordModuleTimes(const std::string& stream_name, const std::vector<CNFrameInfo::ModuleTimes>& times);
+
+  /*!
+   * @brief Sets the function reading the utilization of the devices. The framework does not depend on the device
+   *        management library, so the utilization is read by the function provided by the application.
+   *
+   * @param[in] sampler The function, nullptr to clear it.
+   *
+   * @return No return value.
+   */
+  void SetDeviceUtilizationSampler(DeviceUtilizationSampler sampler);
+
+  /*!
+   * @brief Reads the live utilization of the devices, e.g. to place new streams on the least loaded device.
+   *
+   * @return Returns the utilization of the devices, or an empty vector if no sampler is set.
+   */
+  std::vector<DeviceUtilization> SampleDeviceUtilizations() const;
+
+  /*!
+   * @brief Sets the function reading the CPU usage of the threads of the pipeline. It is set by the pipeline.
+   *
+   * @param[in] sampler The function, nullptr to clear it.
+   *
+   * @return No return value.
+   */
+  void SetCpuUsageSampler(CpuUsageSampler sampler);
+
+  /*!
+   * @brief Records the time spent opening all modules when the pipeline starts. It is called by the pipeline, and
+   *        it is reported in PipelineProfile::startup_time.
+   *
+   * @param[in] startup_time The time. (unit:ms)
+   *
+   * @return No return value.
+   */
+  void RecordStartup(double startup_time) { startup_time_.store(startup_time); }
+
  private:
+  // fills the live memory usage of the pipeline, see MemoryAccountant
+  void GetMemoryUsage(PipelineProfile* profile) const;
+
+  // fills the live utilization of the devices, see SetDeviceUtilizationSampler
+  void GetDeviceUtilizations(PipelineProfile* profile) const;
+
+  // fills the live cpu usage of the pipeline, see SetCpuUsageSampler
+  void GetCpuUsage(PipelineProfile* profile) const;
+
   ProfilerConfig config_;
   std::string pipeline_name_;
   std::map<std::string, std::unique_ptr<ModuleProfiler>> module_profilers_;
   std::unique_ptr<ProcessProfiler> overall_profiler_;
   std::unique_ptr<PipelineTracer> tracer_;
+  std::unique_ptr<LatencyBreakdownProfiler> latency_breakdown_profiler_;
   std::vector<std::string> sorted_module_names_;
+  DeviceUtilizationSampler device_sampler_;
+  mutable std::mutex device_sampler_mtx_;
+  CpuUsageSampler cpu_sampler_;
+  mutable std::mutex cpu_sampler_mtx_;
+  std::atomic<double> startup_time_{0};
 };  // class PipelineProfiler
 
 inline std::string PipelineProfiler::GetName() const {
@@ -212,8 +331,26 @@ inline void PipelineProfiler::RecordOutput(const RecordKey& key) {
   overall_profiler_->RecordEnd(key);
 }
 
+inline void PipelineProfiler::RecordInput(uint32_t stream_index, const std::string& stream_name, int64_t timestamp) {
+  overall_profiler_->RecordStart(stream_index, stream_name, timestamp);
+}
+
+inline void PipelineProfiler::RecordOutput(uint32_t stream_index, const std::string& stream_name, int64_t timestamp) {
+  overall_profiler_->RecordEnd(stream_index, stream_name, timestamp);
+}
+
 inline void PipelineProfiler::OnStreamEos(const std::string& stream_name) {
   overall_profiler_->OnStreamEos(stream_name);
+  if (latency_breakdown_profiler_) latency_breakdown_profiler_->OnStreamEos(stream_name);
+}
+
+inline bool PipelineProfiler::IsLatencyBreakdownEnabled() const {
+  return latency_breakdown_profiler_ != nullptr;
+}
+
+inline void PipelineProfiler::RecordModuleTimes(const std::string& stream_name,
+                                                const std::vector<CNFrameInfo::ModuleTimes>& times) {
+  if (latency_breakdown_profiler_) latency_breakdown_profiler_->AddFrame(stream_name, times);
 }
 
 }  // namespace cnstream
@@ -24,9 +24,11 @@
 #include <chrono>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "cnstream_common.hpp"
 #include "profiler/trace.hpp"
+#include "profiler/trace_sampler.hpp"
 
 /*!
  *  @file pipeline_tracer.hpp
@@ -38,6 +40,8 @@ namespace cnstream {
 template<typename T>
 class CircularBuffer;
 
+class TraceFileWriter;
+
 /*!
  * @class PipelineTracer
  *
@@ -108,8 +112,66 @@ class PipelineTracer : private NonCopyable {
    */
   PipelineTrace GetTraceAfter(const Time& start, const Duration& duration) const;
 
+  /*!
+   * @brief Streams the events recorded afterwards into a file as well, see TraceFileWriter.
+   *
+   * @param[in] path The path of the file.
+   *
+   * @return Returns false if the file fails to be created.
+   *
+   * @note It should be called before any event is recorded.
+   */
+  bool StartStreaming(const std::string& path);
+
+  /*!
+   * @brief Stops streaming and closes the file.
+   *
+   * @return No return value.
+   */
+  void StopStreaming();
+
+  /*!
+   * @brief Gets the writer streaming events into the file.
+   *
+   * @return Returns the writer, nullptr if StartStreaming is never called successfully.
+   */
+  TraceFileWriter* GetTraceFileWriter() const { return file_writer_.get(); }
+
+  /*!
+   * @brief Samples the frames traced, see TraceSampler.
+   *
+   * @param[in] sampler The sampler, nullptr to trace all frames.
+   *
+   * @return No return value.
+   *
+   * @note It should be called before any event is recorded.
+   */
+  void SetSampler(std::unique_ptr<TraceSampler> sampler) { sampler_ = std::move(sampler); }
+
+  /*!
+   * @brief Gets the sampler of the frames traced.
+   *
+   * @return Returns the sampler, nullptr if all frames are traced.
+   */
+  TraceSampler* GetSampler() const { return sampler_.get(); }
+
+  /*!
+   * @brief Checks whether the events of a frame should be recorded. The recorders check it before building events.
+   *
+   * @param[in] stream_name The name of the stream.
+   * @param[in] timestamp The timestamp of the frame.
+   * @param[in] now The time of the event.
+   *
+   * @return Returns true if the frame is traced.
+   */
+  bool IsSampled(const std::string& stream_name, int64_t timestamp, const Time& now) const {
+    return !sampler_ || sampler_->IsSampled(stream_name, timestamp, now);
+  }
+
  private:
   CircularBuffer<TraceEvent>* buffer_ = nullptr;
+  std::unique_ptr<TraceFileWriter> file_writer_;
+  std::unique_ptr<TraceSampler> sampler_;
 };  // class PipelineTracer
 
 inline PipelineTrace PipelineTracer::GetTraceBefore(const Time& end, const Duration& duration) const {
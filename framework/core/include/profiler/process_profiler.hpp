@@ -22,12 +22,16 @@
 #define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PROCESS_PROFILER_HPP_
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <map>
 #include <vector>
 
 #include "cnstream_common.hpp"
 #include "cnstream_config.hpp"
+#include "profiler/latency_histogram.hpp"
 #include "profiler/pipeline_tracer.hpp"
 #include "profiler/profile.hpp"
 #include "profiler/stream_profiler.hpp"
@@ -47,6 +51,9 @@ class RecordPolicy;
  *
  * @brief ProcessProfiler is the profiler for a process. A process can be a function call or a piece of code.
  *
+ * Records are keyed by a stream index and a timestamp. They are put into a buffer of the calling thread without
+ * locking and are counted lazily, when a profile is read, the end of a stream is reached or the buffer is full.
+ *
  * @note This class is thread safe.
  */
 class ProcessProfiler : private NonCopyable {
@@ -115,6 +122,35 @@ class ProcessProfiler : private NonCopyable {
    */
   void RecordEnd(const RecordKey& key);
 
+  /*!
+   * @brief Records the start of the process for a frame of a stream identified by its index.
+   *
+   * It is cheaper than RecordStart(const RecordKey&), the name of the stream is only read for the first record of
+   * the stream and for tracing.
+   *
+   * @param[in] stream_index The index of the stream, usually ``CNFrameInfo::GetStreamIndex()``.
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] timestamp The timestamp of the frame, unique in the stream.
+   *
+   * @return No return value.
+   *
+   * @note The records of a stream should be keyed by the index or by RecordKey, not both.
+   */
+  void RecordStart(uint32_t stream_index, const std::string& stream_name, int64_t timestamp);
+
+  /*!
+   * @brief Records the end of the process for a frame of a stream identified by its index.
+   *
+   * @param[in] stream_index The index of the stream, usually ``CNFrameInfo::GetStreamIndex()``.
+   * @param[in] stream_name The name of the stream, usually the ``CNFrameInfo::stream_id``.
+   * @param[in] timestamp The timestamp of the frame, unique in the stream.
+   *
+   * @return No return value.
+   *
+   * @see RecordStart(uint32_t, const std::string&, int64_t)
+   */
+  void RecordEnd(uint32_t stream_index, const std::string& stream_name, int64_t timestamp);
+
   /*!
    * @brief Gets the name of the process.
    *
@@ -148,6 +184,31 @@ class ProcessProfiler : private NonCopyable {
   void OnStreamEos(const std::string& stream_name);
 
  private:
+  class RecordBuffer;
+  struct StreamSlot;
+  // A record of a thread, the stream is identified by the index of its slot.
+  struct Record {
+    uint32_t slot;
+    TraceEvent::Type type;
+    int64_t timestamp;
+    Time time;
+  };
+
+  // Gets the slot of a stream by its index, names the slot by the first record of the stream.
+  uint32_t GetSlot(uint32_t stream_index, const std::string& stream_name);
+
+  // Gets the slot of a stream by its name, a free one is taken for a new stream.
+  uint32_t GetSlot(const std::string& stream_name);
+
+  // Records the time of now, puts the record into the buffer of the calling thread.
+  void AddRecord(uint32_t slot, const std::string& stream_name, int64_t timestamp, TraceEvent::Type type);
+
+  // Gets the buffer of the calling thread, it is created by the first record of the thread.
+  RecordBuffer* GetThreadBuffer();
+
+  // Counts the records in the buffers of all threads in time order. Called with lk_ locked.
+  void FlushRecords();
+
   // Records start time, called by RecordStart(const RecordKey&).
   void RecordStart(const RecordKey& key, const Time& time);
 
@@ -158,15 +219,16 @@ class ProcessProfiler : private NonCopyable {
   void AddPhysicalTime(const Time& now);
 
   // Statistics latency during profiling.
-  void AddLatency(const std::string& stream_name, const Duration& latency);
+  void AddLatency(StreamProfiler* stream_profiler, const Duration& latency);
 
   // Statistics the number of dropped datas during profiling.
-  void AddDropped(const std::string& stream_name, uint64_t dropped);
+  void AddDropped(StreamProfiler* stream_profiler, uint64_t dropped);
 
   // Tell this profiler the stream named by ``stream_name`` is going to be profiled.
   // Prepares resources that needed by profiler for profiling the stream named by ``stream_name``.
   // Called when the first record of the stream named by ``stream_name`` arrives.
-  void OnStreamStart(const std::string& stream_name);
+  // Returns the stream profiler created for the stream.
+  StreamProfiler* OnStreamStart(const std::string& stream_name);
 
   // Gets profiling results for streams.
   std::vector<StreamProfiler> GetStreamProfilers();
@@ -192,6 +254,8 @@ class ProcessProfiler : private NonCopyable {
   Duration total_latency_        = Duration::zero();
   Duration maximum_latency_      = Duration::zero();
   Duration minimum_latency_      = Duration::max();
+  // The latencies counted for percentiles.
+  LatencyHistogram latency_histogram_;
   // Physical time used for the process named by ``process_name``.
   Duration total_phy_time_       = Duration::zero();
   std::string module_name_       = "";
@@ -202,6 +266,16 @@ class ProcessProfiler : private NonCopyable {
   TraceEvent::Level trace_level_;
   // Stream profilers for each stream.
   std::map<std::string, StreamProfiler> stream_profilers_;
+  // The identification of this profiler, the buffers of threads are looked up by it.
+  const uint64_t id_;
+  // Streams recorded by index take the slot of the index, the others take a free slot after them.
+  std::unique_ptr<StreamSlot[]> slots_;
+  std::map<std::string, uint32_t> slot_indexes_;
+  std::mutex slots_lk_;
+  // The buffers of the threads recording, they are read with lk_ locked.
+  std::vector<std::shared_ptr<RecordBuffer>> buffers_;
+  std::mutex buffers_lk_;
+  std::vector<Record> flushing_records_;
 };  // class ProcessProfiler
 
 inline ProcessProfiler& ProcessProfiler::SetModuleName(const std::string& module_name) {
@@ -218,17 +292,18 @@ inline std::string ProcessProfiler::GetName() const {
   return process_name_;
 }
 
-inline void ProcessProfiler::AddLatency(const std::string& stream_name, const Duration& latency) {
+inline void ProcessProfiler::AddLatency(StreamProfiler* stream_profiler, const Duration& latency) {
   total_latency_ += latency;
   maximum_latency_ = std::max(latency, maximum_latency_);
   minimum_latency_ = std::min(latency, minimum_latency_);
+  latency_histogram_.Record(latency);
   latency_add_times_++;
-  stream_profilers_.find(stream_name)->second.AddLatency(latency);
+  stream_profiler->AddLatency(latency);
 }
 
-inline void ProcessProfiler::AddDropped(const std::string& stream_name, uint64_t dropped) {
+inline void ProcessProfiler::AddDropped(StreamProfiler* stream_profiler, uint64_t dropped) {
   dropped_ += dropped;
-  stream_profilers_.find(stream_name)->second.AddDropped(dropped);
+  stream_profiler->AddDropped(dropped);
 }
 
 inline void ProcessProfiler::Tracing(const RecordKey& key, const Time& time, const TraceEvent::Type& type) {
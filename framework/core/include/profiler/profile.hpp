@@ -21,14 +21,18 @@
 #ifndef CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PROFILE_HPP_
 #define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PROFILE_HPP_
 
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "cnstream_memory_accountant.hpp"
+
 /*!
  *  @file profile.hpp
  *
- *  This file contains the declarations of the StreamProfile, ProcessProfile, ModuleProfile and PipelineProfile struct.
+ *  This file contains the declarations of the StreamProfile, ProcessProfile, FrameAccounting, ModuleProfile,
+ *  StreamLatencyBreakdown and PipelineProfile struct.
  */
 namespace cnstream {
 
@@ -45,6 +49,9 @@ struct StreamProfile {
   double latency = 0.0;            /*!< The average latency. (unit:ms) */
   double maximum_latency = 0.0;    /*!< The maximum latency. (unit:ms) */
   double minimum_latency = 0.0;    /*!< The minimum latency. (unit:ms) */
+  double latency_p50 = 0.0;        /*!< The median latency. (unit:ms) */
+  double latency_p99 = 0.0;        /*!< The 99th percentile latency. (unit:ms) */
+  double latency_p999 = 0.0;       /*!< The 99.9th percentile latency. (unit:ms) */
   double fps = 0.0;                /*!< The throughput. */
 
   /*!
@@ -94,6 +101,9 @@ struct StreamProfile {
     latency = it.latency;
     maximum_latency = it.maximum_latency;
     minimum_latency = it.minimum_latency;
+    latency_p50 = it.latency_p50;
+    latency_p99 = it.latency_p99;
+    latency_p999 = it.latency_p999;
     fps = it.fps;
     return *this;
   }
@@ -113,6 +123,9 @@ struct ProcessProfile {
   double latency = 0.0;                        /*!< The average latency. (unit:ms) */
   double maximum_latency = 0.0;                /*!< The maximum latency. (unit:ms) */
   double minimum_latency = 0.0;                /*!< The minimum latency. (unit:ms) */
+  double latency_p50 = 0.0;                    /*!< The median latency. (unit:ms) */
+  double latency_p99 = 0.0;                    /*!< The 99th percentile latency. (unit:ms) */
+  double latency_p999 = 0.0;                   /*!< The 99.9th percentile latency. (unit:ms) */
   double fps = 0.0;                            /*!< The throughput. */
   std::vector<StreamProfile> stream_profiles;  /*!< The stream profiles. */
 
@@ -165,11 +178,32 @@ struct ProcessProfile {
     latency = it.latency;
     maximum_latency = it.maximum_latency;
     minimum_latency = it.minimum_latency;
+    latency_p50 = it.latency_p50;
+    latency_p99 = it.latency_p99;
+    latency_p999 = it.latency_p999;
     fps = it.fps;
     return *this;
   }
 };  // struct ProcessProfile
 
+/*!
+ * @struct FrameAccounting
+ *
+ * @brief The FrameAccounting is a structure describing where the frames of a stream entering a module get lost or
+ *        delayed, see ModuleProfiler::RecordReceived, ModuleProfiler::RecordDropped and ModuleProfiler::RecordStalled.
+ *
+ * Frames dropped by policies, e.g. the intervals and the filters, and frames dropped for lack of capacity, e.g. by
+ * full input queues, are told apart by the reasons.
+ */
+struct FrameAccounting {
+  std::string stream_name;  /*!< The stream name, empty for the sum of all streams of the module. */
+  uint64_t received = 0;    /*!< The frames received by the module. */
+  uint64_t dropped = 0;     /*!< The frames dropped by the module, the sum of ``dropped_by_reason``. */
+  /*! The dropped frames of each reason, e.g. ``queue_full``. See kDROP_REASON_QUEUE_FULL for the common reasons. */
+  std::vector<std::pair<std::string, uint64_t>> dropped_by_reason;
+  double stalled = 0.0;     /*!< The time the frames waited for the full input queue of the module. (unit:ms) */
+};  // struct FrameAccounting
+
 /*!
  * @struct ModuleProfile
  *
@@ -178,6 +212,15 @@ struct ProcessProfile {
 struct ModuleProfile {
   std::string module_name;                       /*!< The module name. */
   std::vector<ProcessProfile> process_profiles;  /*!< The process profiles. */
+  /*! The input queue (conveyor) index of each stream. It is recorded only when CNModuleConfig::rebalanceStreams is true. */
+  std::vector<std::pair<std::string, int>> stream_conveyors;
+  /*! The counters accumulated by the module, e.g. cache hits. See ModuleProfiler::AddCounter. */
+  std::vector<std::pair<std::string, uint64_t>> counters;
+  FrameAccounting frame_accounting;  /*!< The frame accounting of all streams since the start. */
+  /*! The frame accounting of the streams not reaching the end yet. */
+  std::vector<FrameAccounting> stream_frame_accountings;
+  double open_begin = 0.0;  /*!< When Module::Open was called, relative to the start of the pipeline. (unit:ms) */
+  double open_time = 0.0;   /*!< The time spent in Module::Open when the pipeline started. (unit:ms) */
 
   /*!
    * @brief Constructs a ModuleProfile object with default constructor.
@@ -221,10 +264,74 @@ struct ModuleProfile {
   inline ModuleProfile& operator=(ModuleProfile&& it) {
     module_name = std::move(it.module_name);
     process_profiles = std::move(it.process_profiles);
+    stream_conveyors = std::move(it.stream_conveyors);
+    counters = std::move(it.counters);
+    frame_accounting = std::move(it.frame_accounting);
+    stream_frame_accountings = std::move(it.stream_frame_accountings);
+    open_begin = it.open_begin;
+    open_time = it.open_time;
     return *this;
   }
 };  // struct ModuleProfile
 
+/*!
+ * @struct ModuleLatencyBreakdown
+ *
+ * @brief The ModuleLatencyBreakdown is a structure describing how long the frames of a stream stay in a module.
+ *
+ * The queue wait is the time from being pushed into the input queue of the module to being processed, the process
+ * time is the time from being processed to being transmitted. The critical path of a frame is the chain of modules
+ * ending at the module transmitting the frame last, in which every module got the frame from the parent transmitting
+ * it last, so that the latency of the frame is the sum of the queue waits and the process times on the path.
+ */
+struct ModuleLatencyBreakdown {
+  std::string module_name;           /*!< The module name. */
+  uint64_t frames = 0;               /*!< The number of frames passed through the module. */
+  double queue_wait = 0.0;           /*!< The average queue wait. (unit:ms) */
+  double maximum_queue_wait = 0.0;   /*!< The maximum queue wait. (unit:ms) */
+  double process = 0.0;              /*!< The average process time. (unit:ms) */
+  double maximum_process = 0.0;      /*!< The maximum process time. (unit:ms) */
+  uint64_t critical_frames = 0;      /*!< The number of frames whose critical path contains the module. */
+  double critical_queue_wait = 0.0;  /*!< The average queue wait of the frames on the critical path. (unit:ms) */
+  double critical_process = 0.0;     /*!< The average process time of the frames on the critical path. (unit:ms) */
+};  // struct ModuleLatencyBreakdown
+
+/*!
+ * @struct StreamLatencyBreakdown
+ *
+ * @brief The StreamLatencyBreakdown is a structure describing where the latency of the frames of a stream comes from.
+ */
+struct StreamLatencyBreakdown {
+  std::string stream_name;                      /*!< The stream name. */
+  uint64_t frames = 0;                          /*!< The number of frames passed through the pipeline. */
+  double latency = 0.0;                         /*!< The average latency. (unit:ms) */
+  /*! The module whose input queue takes the most time on the critical paths, empty if no frame waits. */
+  std::string bottleneck_module;
+  std::vector<ModuleLatencyBreakdown> modules;  /*!< The breakdowns of all modules in topological order. */
+};  // struct StreamLatencyBreakdown
+
+/*!
+ * @struct DeviceUtilization
+ *
+ * @brief The DeviceUtilization is a structure describing the utilization of a device, e.g. an MLU.
+ */
+struct DeviceUtilization {
+  int device_id = 0;                /*!< The device identification. */
+  double core_utilization = -1.0;   /*!< The average utilization of the cores in percent, -1 if it is unknown. */
+  double memory_utilization = -1.0; /*!< The memory used in percent of the total memory, -1 if it is unknown. */
+  double codec_utilization = -1.0;  /*!< The average utilization of the codecs in percent, -1 if it is unknown. */
+};  // struct DeviceUtilization
+
+/*!
+ * @struct CpuUsage
+ *
+ * @brief The CpuUsage is a structure describing the CPU time consumed by the threads of a pipeline.
+ */
+struct CpuUsage {
+  double cpu_time = 0.0;    /*!< The CPU time consumed by the threads since they were tagged. (unit:ms) */
+  uint32_t thread_num = 0;  /*!< The number of live threads tagged, see Pipeline::TagCurrentThread. */
+};  // struct CpuUsage
+
 /*!
  * @struct PipelineProfile
  *
@@ -234,6 +341,17 @@ struct PipelineProfile {
   std::string pipeline_name;                   /*!< The pipeline name. */
   std::vector<ModuleProfile> module_profiles;  /*!< The module profiles. */
   ProcessProfile overall_profile;              /*!< The profile of the whole pipeline. */
+  MemoryUsage memory_usage;                    /*!< The memory held by the pipeline, see MemoryAccountant. */
+  std::map<std::string, MemoryUsage> stream_memory_usages;  /*!< The memory held by each stream. */
+  /*! The latency breakdowns of streams since they start, filled by PipelineProfiler::GetProfile() only if
+      ProfilerConfig::enable_latency_breakdown is true. */
+  std::vector<StreamLatencyBreakdown> latency_breakdowns;
+  /*! The utilization of the devices when the profile is got, see PipelineProfiler::SetDeviceUtilizationSampler. */
+  std::vector<DeviceUtilization> device_utilizations;
+  /*! The CPU usage of the threads of the pipeline when the profile is got, see PipelineProfiler::SetCpuUsageSampler. */
+  CpuUsage cpu_usage;
+  /*! The time spent opening all modules when the pipeline started, see ModuleProfile::open_time. (unit:ms) */
+  double startup_time = 0.0;
 
   /*!
    * @brief Constructs a PipelineProfile object with default constructor.
@@ -278,6 +396,12 @@ struct PipelineProfile {
     pipeline_name = std::move(it.pipeline_name);
     module_profiles = std::move(it.module_profiles);
     overall_profile = std::move(it.overall_profile);
+    memory_usage = it.memory_usage;
+    stream_memory_usages = std::move(it.stream_memory_usages);
+    latency_breakdowns = std::move(it.latency_breakdowns);
+    device_utilizations = std::move(it.device_utilizations);
+    cpu_usage = it.cpu_usage;
+    startup_time = it.startup_time;
     return *this;
   }
 };  // struct PipelineProfile
@@ -0,0 +1,129 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PROFILE_SNAPSHOT_HPP_
+#define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PROFILE_SNAPSHOT_HPP_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cnstream_common.hpp"
+#include "profiler/profile.hpp"
+
+/*!
+ *  @file profile_snapshot.hpp
+ *
+ *  This file contains the declarations of the ProfileDelta struct and the ProfileSnapshotter class.
+ */
+namespace cnstream {
+
+class PipelineProfiler;
+
+/*!
+ * @struct ProfileDelta
+ *
+ * @brief The ProfileDelta is a structure describing the counters of a pipeline changed since the last snapshot, in
+ *        a flat form. See ProfileSnapshotter.
+ */
+struct ProfileDelta {
+  /*! Whether the key table is rebuilt. If it is true, the keys got before are discarded and ``new_keys`` holds
+      all keys. */
+  bool reset = false;
+  /*! The keys appended to the key table, the index of a key is its position in the table. */
+  std::vector<std::string> new_keys;
+  std::vector<uint32_t> indices;  /*!< The indices of the changed counters in the key table. */
+  std::vector<double> values;     /*!< The new values of the changed counters, in the order of ``indices``. */
+};  // struct ProfileDelta
+
+/*!
+ * @class ProfileSnapshotter
+ *
+ * @brief ProfileSnapshotter flattens the PipelineProfile into counters named by paths, e.g.
+ *        ``modules/<module>/<process>/fps`` and ``overall/streams/<stream>/latency``, and returns only the counters
+ *        changed since the last snapshot. It is meant for the dashboards polling the profile of large pipelines, which
+ *        would otherwise convert the whole profile each time.
+ *
+ * The key table only grows, the counters of removed streams keep their last values. It is rebuilt once the keys
+ * missing from the profile outnumber the present ones.
+ *
+ * @note This class is thread safe.
+ */
+class ProfileSnapshotter : private NonCopyable {
+ public:
+  /*!
+   * @brief Constructs a ProfileSnapshotter object.
+   *
+   * @param[in] profiler The profiler of the pipeline, it must outlive the snapshotter.
+   *
+   * @return No return value.
+   */
+  explicit ProfileSnapshotter(PipelineProfiler* profiler);
+
+  /*!
+   * @brief Gets the profile of the pipeline by PipelineProfiler::GetProfile and returns the counters changed since
+   *        the last snapshot. The first snapshot returns all counters.
+   *
+   * @return Returns the changed counters.
+   */
+  ProfileDelta GetDelta();
+
+  /*!
+   * @brief Returns the counters of a profile changed since the last snapshot.
+   *
+   * @param[in] profile The profile.
+   *
+   * @return Returns the changed counters.
+   */
+  ProfileDelta GetDelta(const PipelineProfile& profile);
+
+  /*!
+   * @brief Discards the key table, the next snapshot returns all counters.
+   *
+   * @return No return value.
+   */
+  void Reset();
+
+  /*!
+   * @brief Flattens a profile into counters named by paths. The names of the pipeline, the processes and the
+   *        bottleneck modules are not counters and are skipped.
+   *
+   * @param[in] profile The profile.
+   * @param[out] counters The counters.
+   *
+   * @return No return value.
+   */
+  static void Flatten(const PipelineProfile& profile, std::vector<std::pair<std::string, double>>* counters);
+
+ private:
+  PipelineProfiler* profiler_ = nullptr;
+  std::mutex mtx_;  // guards the members below
+  std::unordered_map<std::string, uint32_t> indices_;
+  std::vector<double> values_;
+  std::vector<uint64_t> generations_;  // the latest snapshot each key is present in
+  uint64_t generation_ = 0;
+  std::vector<std::pair<std::string, double>> counters_;  // reused to flatten the profiles
+};  // class ProfileSnapshotter
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_PROFILE_SNAPSHOT_HPP_
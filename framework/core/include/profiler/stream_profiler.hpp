@@ -25,6 +25,7 @@
 #include <chrono>
 #include <string>
 
+#include "profiler/latency_histogram.hpp"
 #include "profiler/profile.hpp"
 
 /*!
@@ -56,7 +57,7 @@ class StreamProfiler {
   explicit StreamProfiler(const std::string& stream_name);
 
   /*!
-   * @brief Accumulates latency to total latency.
+   * @brief Accumulates latency to total latency and counts it in the latency histogram.
    *
    * @param[in] latency The latency to be added. The latency will be accumulated to total latency.
    *
@@ -103,6 +104,13 @@ class StreamProfiler {
    */
   StreamProfile GetProfile();
 
+  /*!
+   * @brief Gets the histogram of the latencies added.
+   *
+   * @return Returns the histogram of the latencies added.
+   */
+  const LatencyHistogram& GetLatencyHistogram() const;
+
  private:
   std::string stream_name_ = "";
   uint64_t completed_ = 0;
@@ -112,6 +120,7 @@ class StreamProfiler {
   Duration maximum_latency_      = Duration::zero();
   Duration minimum_latency_      = Duration::max();
   Duration total_phy_time_ = Duration::zero();
+  LatencyHistogram latency_histogram_;
 };  // class StreamProfiler
 
 inline StreamProfiler& StreamProfiler::AddLatency(const Duration& latency) {
@@ -119,6 +128,7 @@ inline StreamProfiler& StreamProfiler::AddLatency(const Duration& latency) {
   total_latency_ += latency;
   maximum_latency_ = std::max(latency, maximum_latency_);
   minimum_latency_ = std::min(latency, minimum_latency_);
+  latency_histogram_.Record(latency);
   return *this;
 }
 
@@ -141,6 +151,10 @@ inline std::string StreamProfiler::GetName() const {
   return stream_name_;
 }
 
+inline const LatencyHistogram& StreamProfiler::GetLatencyHistogram() const {
+  return latency_histogram_;
+}
+
 }  // namespace cnstream
 
 #endif  // CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_STREAM_PROFILER_HPP_
@@ -51,7 +51,8 @@ using Time = Clock::time_point;
 
 /*!
  * Defines an alias for the std::pair<std::string, int64_t>. RecordKey now denotes a pair of the stream name
- * ``CNFrameInfo::stream_id`` and pts ``CNFrameInfo::timestamp``.
+ * ``CNFrameInfo::stream_id`` and pts ``CNFrameInfo::timestamp``. The records of modules made by the pipeline use
+ * ``CNFrameInfo::GetSequence()`` instead of the pts.
  */
 using RecordKey = std::pair<std::string, int64_t>;
 
@@ -0,0 +1,237 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_TRACE_FILE_HPP_
+#define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_TRACE_FILE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cnstream_common.hpp"
+#include "profiler/trace.hpp"
+
+/*!
+ *  @file trace_file.hpp
+ *
+ *  This file contains declarations of the TraceFileWriter class and the TraceFileReader class.
+ */
+namespace cnstream {
+
+/*!
+ * @class TraceFileWriter
+ *
+ * @brief TraceFileWriter streams trace events into a file in the background, so that the trace of a long run is not
+ * limited by the events cached in memory.
+ *
+ * Events are put into a bounded buffer of the recording thread, without locks and without waiting. A background
+ * thread drains the buffers of all threads periodically, sorts the events drained by time and appends them to the
+ * file. Events are dropped and counted when the buffer of a thread is full, so the memory used is bounded by the
+ * number of recording threads times ``kBufferCapacity`` events.
+ *
+ * The file is compact binary. Unsigned integers are LEB128 varints, signed ones are zigzag encoded first. A string is
+ * defined once and referenced by its identification afterwards:
+ *
+ * @verbatim
+ * file    := magic(u32 "CNTR") version(u32) record*
+ * record  := string | event | dropped
+ * string  := 1 id length bytes[length]      ids start from 1, 0 references the empty string
+ * event   := 2 flags stream_id pts(signed) module_id process_id time_delta(signed)
+ * dropped := 3 count                        the number of events dropped since the last dropped record
+ * @endverbatim
+ *
+ * ``flags`` is ``level << 1 | (type == END)``. ``time_delta`` is the time from the previous event in nanoseconds, the
+ * time of the first event is from the epoch of the steady clock. Events are in time order within a drain, the ones
+ * recorded around the drain may come slightly out of order.
+ *
+ * The file is read by TraceFileReader, or converted to the chrome tracing format by
+ * ``python/samples/trace_converter.py``.
+ */
+class TraceFileWriter : private NonCopyable {
+ public:
+  static constexpr uint32_t kMagic = 0x52544E43;   /*!< "CNTR" in little-endian. */
+  static constexpr uint32_t kVersion = 1;          /*!< The version of the format. */
+  static constexpr size_t kBufferCapacity = 4096;  /*!< The max number of events buffered by a thread. */
+
+  /*!
+   * @brief Constructs a TraceFileWriter object.
+   *
+   * @return No return value.
+   */
+  TraceFileWriter();
+  /*!
+   * @brief Destructs a TraceFileWriter object. The file is closed.
+   *
+   * @return No return value.
+   */
+  ~TraceFileWriter();
+
+  /*!
+   * @brief Creates the file and starts the background thread. An existing file is truncated.
+   *
+   * @param[in] path The path of the file.
+   * @param[in] flush_interval_ms The interval to drain the buffers into the file in milliseconds.
+   *
+   * @return Returns false if the file fails to be created or the writer is opened already.
+   */
+  bool Open(const std::string& path, uint32_t flush_interval_ms = 100);
+
+  /*!
+   * @brief Drains the events buffered, stops the background thread and closes the file.
+   *
+   * @return No return value.
+   *
+   * @note Events written while closing may be lost.
+   */
+  void Close();
+
+  /*!
+   * @brief Checks whether the file is opened.
+   *
+   * @return Returns true if the file is opened.
+   */
+  bool IsOpened() const { return opened_.load(std::memory_order_acquire); }
+
+  /*!
+   * @brief Writes an event. It can be called by any thread and never blocks, except for the first call of a thread.
+   *
+   * @param[in] event The trace event.
+   *
+   * @return No return value. The event is ignored if the file is not opened.
+   */
+  void Write(const TraceEvent& event);
+
+  /*!
+   * @brief Gets the number of events written into the file.
+   *
+   * @return Returns the number of events written.
+   */
+  uint64_t GetWrittenNumber() const { return written_.load(std::memory_order_relaxed); }
+
+  /*!
+   * @brief Gets the number of events dropped as the buffers of the recording threads are full.
+   *
+   * @return Returns the number of events dropped.
+   */
+  uint64_t GetDroppedNumber() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  class EventBuffer;
+
+  // Gets the buffer of the calling thread, it is created by the first event of the thread.
+  EventBuffer* GetThreadBuffer();
+
+  // The background thread.
+  void Loop(uint32_t flush_interval_ms);
+
+  // Drains the buffers of all threads into the file. Called by the background thread.
+  void Drain();
+
+  // Gets the identification of a string, the string is defined in ``out`` the first time.
+  uint64_t StringId(const std::string& str, std::string* out);
+
+  // The identification of this writer, the buffers of threads are looked up by it.
+  const uint64_t id_;
+  std::atomic<bool> opened_{false};
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> dropped_{0};
+  FILE* file_ = nullptr;
+  std::thread thread_;
+  bool running_ = false;
+  std::mutex running_lk_;
+  std::condition_variable running_cond_;
+  // The buffers of the threads writing, they are drained with buffers_lk_ locked.
+  std::vector<std::shared_ptr<EventBuffer>> buffers_;
+  std::mutex buffers_lk_;
+  // The states below are only used by the background thread.
+  std::unordered_map<std::string, uint64_t> strings_;
+  int64_t last_time_ = 0;
+  uint64_t dropped_written_ = 0;
+  std::vector<TraceEvent> draining_events_;
+};  // class TraceFileWriter
+
+/*!
+ * @class TraceFileReader
+ *
+ * @brief TraceFileReader reads the events of a file written by TraceFileWriter one by one.
+ */
+class TraceFileReader : private NonCopyable {
+ public:
+  /*!
+   * @brief Destructs a TraceFileReader object. The file is closed.
+   *
+   * @return No return value.
+   */
+  ~TraceFileReader();
+
+  /*!
+   * @brief Opens a file written by TraceFileWriter.
+   *
+   * @param[in] path The path of the file.
+   *
+   * @return Returns false if the file fails to be opened or it is not a trace file of TraceFileWriter::kVersion.
+   */
+  bool Open(const std::string& path);
+
+  /*!
+   * @brief Closes the file.
+   *
+   * @return No return value.
+   */
+  void Close();
+
+  /*!
+   * @brief Reads the next event.
+   *
+   * @param[out] event The event read.
+   *
+   * @return Returns false at the end of the file. A record truncated, e.g. by a crash of the writer, ends the file
+   *         as well.
+   */
+  bool Next(TraceEvent* event);
+
+  /*!
+   * @brief Gets the number of events dropped by the writer before the events read.
+   *
+   * @return Returns the number of events dropped.
+   */
+  uint64_t GetDroppedNumber() const { return dropped_; }
+
+ private:
+  bool ReadVarint(uint64_t* value);
+  bool ReadSignedVarint(int64_t* value);
+  bool Lookup(uint64_t id, std::string* str) const;
+
+  FILE* file_ = nullptr;
+  std::vector<std::string> strings_;
+  int64_t last_time_ = 0;
+  uint64_t dropped_ = 0;
+};  // class TraceFileReader
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_TRACE_FILE_HPP_
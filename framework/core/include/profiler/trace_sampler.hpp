@@ -0,0 +1,133 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_TRACE_SAMPLER_HPP_
+#define CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_TRACE_SAMPLER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+#include "cnstream_common.hpp"
+#include "cnstream_config.hpp"
+#include "profiler/trace.hpp"
+
+/*!
+ *  @file trace_sampler.hpp
+ *
+ *  This file contains a declaration of the TraceSampler class.
+ */
+namespace cnstream {
+
+/*!
+ * @class TraceSampler
+ *
+ * @brief TraceSampler decides which frames are traced, to bound the overhead of tracing.
+ *
+ * A frame is traced if any of the following is true:
+ *
+ * - The frame is one of the 1-in-``trace_sample_interval`` frames of its stream. Frames are picked by a hash of the
+ *   stream name and the timestamp, so every module agrees on the frames traced without sharing any state.
+ * - The stream is one of ``trace_streams``.
+ * - A full tracing window is open. A window of ``trace_burst_duration`` milliseconds is opened, or extended, when the
+ *   process time of a module exceeds ``trace_latency_threshold`` milliseconds, see OnProcessTime.
+ *
+ * See ProfilerConfig for the options.
+ */
+class TraceSampler : private NonCopyable {
+ public:
+  /*!
+   * @brief Constructs a TraceSampler object.
+   *
+   * @param[in] config The profiler configuration.
+   *
+   * @return No return value.
+   */
+  explicit TraceSampler(const ProfilerConfig& config);
+
+  /*!
+   * @brief Checks whether the options of a profiler configuration need a sampler, i.e. not all frames are traced.
+   *
+   * @param[in] config The profiler configuration.
+   *
+   * @return Returns true if the frames should be sampled.
+   */
+  static bool IsNeeded(const ProfilerConfig& config);
+
+  /*!
+   * @brief Checks whether a frame is traced. It is thread-safe and lock-free.
+   *
+   * @param[in] stream_name The name of the stream.
+   * @param[in] timestamp The timestamp of the frame.
+   * @param[in] now The time of the event of the frame.
+   *
+   * @return Returns true if the frame is traced.
+   */
+  bool IsSampled(const std::string& stream_name, int64_t timestamp, const Time& now) const;
+
+  /*!
+   * @brief Reports the process time of a frame in a module. A full tracing window is opened if it exceeds the
+   *        threshold. It is thread-safe.
+   *
+   * @param[in] module_name The name of the module.
+   * @param[in] process_time The process time.
+   * @param[in] now The time when the frame is done.
+   *
+   * @return No return value.
+   */
+  void OnProcessTime(const std::string& module_name, const Duration& process_time, const Time& now);
+
+  /*!
+   * @brief Checks whether process times are reported to open full tracing windows.
+   *
+   * @return Returns true if ``trace_latency_threshold`` is positive.
+   */
+  bool IsTriggerEnabled() const { return latency_threshold_ > Duration::zero(); }
+
+  /*!
+   * @brief Checks whether a full tracing window is open.
+   *
+   * @param[in] now The time to check.
+   *
+   * @return Returns true if all frames are traced at ``now``.
+   */
+  bool IsBursting(const Time& now) const;
+
+  /*!
+   * @brief Gets the number of full tracing windows opened.
+   *
+   * @return Returns the number of windows, a window extended is counted once.
+   */
+  uint64_t GetBurstNumber() const { return bursts_.load(std::memory_order_relaxed); }
+
+ private:
+  uint32_t sample_interval_;
+  std::unordered_set<std::string> streams_;
+  Duration latency_threshold_;
+  Clock::duration burst_duration_;
+  // The end of the full tracing window, the time since the epoch of Clock.
+  std::atomic<Clock::rep> burst_end_;
+  std::atomic<uint64_t> bursts_{0};
+};  // class TraceSampler
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_FRAMEWORK_CORE_INCLUDE_PROFILER_TRACE_SAMPLER_HPP_
@@ -65,6 +65,12 @@ class bad_any_cast : public std::bad_cast {
   const char* what() const noexcept override { return "bad any cast"; }
 };
 
+// thrown when an any holding a move-only value is copied
+class bad_any_copy : public std::exception {
+ public:
+  const char* what() const noexcept override { return "bad any copy, the value is move-only"; }
+};
+
 
 template <class _Alloc>
 class __allocator_destructor {
@@ -107,6 +113,11 @@ namespace __any_imp {
                                           std::alignment_of<_Buffer>::value % std::alignment_of<_Tp>::value == 0 &&
                                           std::is_nothrow_move_constructible<_Tp>::value>;
 
+  // the data of frames are stored as shared_ptr, they must never be allocated on heap.
+  static_assert(_IsSmallObject<std::shared_ptr<void>>::value, "shared_ptr must be stored in place by any");
+  static_assert(_IsSmallObject<std::unique_ptr<void, void (*)(void*)>>::value,
+                "unique_ptr must be stored in place by any");
+
   enum class _Action {
     _Destroy,
     _Copy,
@@ -129,12 +140,14 @@ namespace __any_imp {
 
   template <class _Tp>
   bool __compare_typeid(std::type_info const* __id, const void* __fallback_id) {
+    // the address of the fallback id is unique in most cases, typeid is only compared if it fails,
+    // e.g. the value is added in another shared library built with hidden visibility.
+    if (__fallback_id == __any_imp::__get_fallback_typeid<_Tp>())
+      return true;
 #if !defined(_LIBCPP_NO_RTTI)
     if (__id && *__id == typeid(_Tp))
       return true;
 #endif
-    if (!__id && __fallback_id == __any_imp::__get_fallback_typeid<_Tp>())
-      return true;
     return false;
   }
 
@@ -158,24 +171,23 @@ class any final {
     if (__other.__h) __other.__call(_Action::_Move, this);
   }
 
-  template <class _ValueType, class _Tp = decay_t<_ValueType>, 
-            class = enable_if_t< !std::is_same<_Tp, any>::value && 
-                                 !__is_inplace_type<_ValueType>::value && 
-                                 std::is_copy_constructible<_Tp>::value>>
+  // move-only values are supported, copying the any holding them throws bad_any_copy.
+  template <class _ValueType, class _Tp = decay_t<_ValueType>,
+            class = enable_if_t< !std::is_same<_Tp, any>::value &&
+                                 !__is_inplace_type<_ValueType>::value &&
+                                 std::is_constructible<_Tp, _ValueType>::value>>
   any(_ValueType && __value);
 
   
   template <class _ValueType, class ..._Args,
             class _Tp = decay_t<_ValueType>,
-            class = enable_if_t<std::is_constructible<_Tp, _Args...>::value &&
-                                std::is_copy_constructible<_Tp>::value>>
+            class = enable_if_t<std::is_constructible<_Tp, _Args...>::value>>
   explicit any(in_place_type_t<_ValueType>, _Args&&... __args);
 
   template <class _ValueType, class _Up, class ..._Args,
     class _Tp = decay_t<_ValueType>,
     class = enable_if_t<
-        std::is_constructible<_Tp, std::initializer_list<_Up>&, _Args...>::value &&
-        std::is_copy_constructible<_Tp>::value>>
+        std::is_constructible<_Tp, std::initializer_list<_Up>&, _Args...>::value>>
   explicit any(in_place_type_t<_ValueType>, std::initializer_list<_Up>, _Args&&... __args);
 
   ~any() { this->reset(); }
@@ -191,25 +203,23 @@ class any final {
     return *this;
   }
 
-  template <class _ValueType, 
-            class _Tp = decay_t<_ValueType>, 
-            class = enable_if_t< !std::is_same<_Tp, any>::value && 
-                                 std::is_copy_constructible<_Tp>::value>>
+  template <class _ValueType,
+            class _Tp = decay_t<_ValueType>,
+            class = enable_if_t< !std::is_same<_Tp, any>::value &&
+                                 std::is_constructible<_Tp, _ValueType>::value>>
   any & operator=(_ValueType && __rhs);
 
   template <class _ValueType,
             class ..._Args,
             class _Tp = decay_t<_ValueType>,
-            class = enable_if_t< std::is_constructible<_Tp, _Args...>::value &&
-                                 std::is_copy_constructible<_Tp>::value>>
+            class = enable_if_t< std::is_constructible<_Tp, _Args...>::value>>
   _Tp& emplace(_Args&&... args);
 
   template <class _ValueType,
             class _Up,
             class ..._Args,
             class _Tp = decay_t<_ValueType>,
-            class = enable_if_t<std::is_constructible<_Tp, std::initializer_list<_Up>&, _Args...>::value &&
-                    std::is_copy_constructible<_Tp>::value>>
+            class = enable_if_t<std::is_constructible<_Tp, std::initializer_list<_Up>&, _Args...>::value>>
   _Tp& emplace(std::initializer_list<_Up>, _Args&&...);
 
   // 6.3.3 any modifiers
@@ -313,6 +323,10 @@ namespace __any_imp {
     return *__ret;
   }
 
+  static void* __get_if_owner(any & __this) {
+    return __this.__h == &_SmallHandler::__handle ? static_cast<void*>(&__this.__s.__buf) : nullptr;
+  }
+
   private:
     static void __destroy(any & __this) {
       _Tp & __value = *static_cast<_Tp *>(static_cast<void*>(&__this.__s.__buf));
@@ -321,10 +335,18 @@ namespace __any_imp {
     }
 
     static void __copy(any const & __this, any & __dest) {
+      __copy(__this, __dest, std::is_copy_constructible<_Tp>());
+    }
+
+    static void __copy(any const & __this, any & __dest, std::true_type /* copyable */) {
       _SmallHandler::__create(__dest, *static_cast<_Tp const *>(
             static_cast<void const *>(&__this.__s.__buf)));
     }
 
+    static void __copy(any const &, any &, std::false_type /* move-only */) {
+      throw bad_any_copy();
+    }
+
     static void __move(any & __this, any & __dest) {
       _SmallHandler::__create(__dest, std::move(
           *static_cast<_Tp*>(static_cast<void*>(&__this.__s.__buf))));
@@ -383,6 +405,10 @@ namespace __any_imp {
       return *__ret;
     }
 
+    static void* __get_if_owner(any & __this) {
+      return __this.__h == &_LargeHandler::__handle ? __this.__s.__ptr : nullptr;
+    }
+
   private:
     static void __destroy(any & __this) {
       delete static_cast<_Tp*>(__this.__s.__ptr);
@@ -390,9 +416,17 @@ namespace __any_imp {
     }
 
     static void __copy(any const & __this, any & __dest) {
+      __copy(__this, __dest, std::is_copy_constructible<_Tp>());
+    }
+
+    static void __copy(any const & __this, any & __dest, std::true_type /* copyable */) {
       _LargeHandler::__create(__dest, *static_cast<_Tp const *>(__this.__s.__ptr));
     }
 
+    static void __copy(any const &, any &, std::false_type /* move-only */) {
+      throw bad_any_copy();
+    }
+
     static void __move(any & __this, any & __dest) {
       __dest.__s.__ptr = __this.__s.__ptr;
       __dest.__h = &_LargeHandler::__handle;
@@ -520,13 +554,32 @@ _RetType __pointer_or_func_cast(void*, /*IsFunction*/std::true_type) noexcept {
   return nullptr;
 }
 
+namespace __any_imp {
+  // returns the value if it is stored by the handler of _Tp, no type ids are compared.
+  // nullptr is returned if the value is stored in another shared library, type ids will be compared then.
+  template <class _Tp>
+  void* __fast_get(any & __any, std::true_type /* storable */) {
+    return _Handler<_Tp>::__get_if_owner(__any);
+  }
+
+  template <class _Tp>
+  void* __fast_get(any &, std::false_type /* function or array */) {
+    return nullptr;
+  }
+}  // namespace __any_imp
+
 template <class _ValueType>
 add_pointer_t<_ValueType> any_cast(any * __any) {
   using __any_imp::_Action;
   static_assert(!std::is_reference<_ValueType>::value,
                 "_ValueType may not be a reference.");
   typedef typename std::add_pointer<_ValueType>::type _ReturnType;
+  typedef typename std::remove_cv<_ValueType>::type _StoredType;
+  typedef std::integral_constant<bool, !std::is_function<_StoredType>::value && !std::is_array<_StoredType>::value &&
+                                       std::is_move_constructible<_StoredType>::value> _IsStorable;
   if (__any && __any->__h) {
+    void *__v = __any_imp::__fast_get<_StoredType>(*__any, _IsStorable());
+    if (__v) return static_cast<_ReturnType>(__v);
     void *__p = __any->__call(_Action::_Get, nullptr,
 #if !defined(_LIBCPP_NO_RTTI)
                         &typeid(_ValueType),
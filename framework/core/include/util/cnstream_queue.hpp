@@ -21,9 +21,12 @@
 #ifndef CNSTREAM_THREADSAFE_QUEUE_HPP_
 #define CNSTREAM_THREADSAFE_QUEUE_HPP_
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <utility>
 
 namespace cnstream {
 
@@ -98,6 +101,82 @@ void ThreadSafeQueue<T>::Push(const T& new_value) {
   notempty_cond_.notify_one();
 }
 
+/**
+ * @brief MpscQueue is a lock-free queue for multiple producers and a single consumer, e.g. the event bus.
+ *
+ * Push never blocks and may be called from any thread. TryPop and WaitAndTryPop must be called from one thread.
+ * An element is visible to the consumer once its producer has linked it, so an element pushed later by another thread
+ * may be popped first.
+ */
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(new Node), tail_(head_.load()) {}
+  ~MpscQueue() {
+    Node* node = tail_;
+    while (node) {
+      Node* next = node->next.load();
+      delete node;
+      node = next;
+    }
+  }
+  MpscQueue(const MpscQueue& other) = delete;
+  MpscQueue& operator=(const MpscQueue& other) = delete;
+
+  bool TryPop(T& value);
+
+  bool WaitAndTryPop(T& value, const std::chrono::microseconds rel_time);
+
+  void Push(T new_value);
+
+  bool Empty() const { return tail_->next.load() == nullptr; }
+
+ private:
+  struct Node {
+    T value;
+    std::atomic<Node*> next{nullptr};
+  };
+  std::atomic<Node*> head_;  // the latest element pushed
+  Node* tail_;               // the dummy node before the oldest element, owned by the consumer
+  std::atomic<bool> waiting_{false};
+  std::mutex wait_m_;
+  std::condition_variable notempty_cond_;
+};
+
+template <typename T>
+bool MpscQueue<T>::TryPop(T& value) {
+  Node* next = tail_->next.load(std::memory_order_acquire);
+  if (!next) return false;
+  value = std::move(next->value);
+  delete tail_;
+  tail_ = next;
+  return true;
+}
+
+template <typename T>
+bool MpscQueue<T>::WaitAndTryPop(T& value, const std::chrono::microseconds rel_time) {
+  if (TryPop(value)) return true;
+  std::unique_lock<std::mutex> lk(wait_m_);
+  waiting_.store(true);
+  notempty_cond_.wait_for(lk, rel_time, [this] { return tail_->next.load() != nullptr; });
+  waiting_.store(false);
+  lk.unlock();
+  return TryPop(value);
+}
+
+template <typename T>
+void MpscQueue<T>::Push(T new_value) {
+  Node* node = new Node;
+  node->value = std::move(new_value);
+  Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node);
+  // the consumer checks the queue with wait_m_ locked before it sleeps, so the notification is never lost
+  if (waiting_.load()) {
+    { std::lock_guard<std::mutex> lk(wait_m_); }
+    notempty_cond_.notify_one();
+  }
+}
+
 }  // namespace cnstream
 
 #endif  // CNSTREAM_THREADSAFE_QUEUE_HPP_
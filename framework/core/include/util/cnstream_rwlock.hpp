@@ -21,7 +21,11 @@
 #define CNSTREAM_RWLOCK_H_
 
 #include <pthread.h>  // for pthread_rwlock_t
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 namespace cnstream {
@@ -39,22 +43,118 @@ class RwLock {
   pthread_rwlock_t rwlock;
 };
 
+/**
+ * @brief BiasedRwLock is a read-write lock for the data read on every frame and rarely written, e.g. the container
+ * and the observer of a module.
+ *
+ * Each reader only writes its own slot of the lock, so readers on different cores do not bounce a shared cache line.
+ * A writer blocks new readers and waits for the slots to drain, so writing is much slower than with RwLock. A thread
+ * may take the read lock again while holding it, even if a writer is waiting.
+ */
+class BiasedRwLock {
+ public:
+  BiasedRwLock() = default;
+  BiasedRwLock(const BiasedRwLock&) = delete;
+  BiasedRwLock& operator=(const BiasedRwLock&) = delete;
+
+  void rdlock() {
+    HeldLock* held = FindHeld(true);
+    if (held && held->depth++ > 0) {
+      // nested, no writer holds the lock as this thread is counted in a slot
+      Slot().readers.fetch_add(1);
+      return;
+    }
+    std::atomic<int32_t>& readers = Slot().readers;
+    readers.fetch_add(1);
+    if (held && !writer_.load()) return;
+    readers.fetch_sub(1);
+    // a writer holds or waits for the lock, or the nesting is not tracked as the thread holds too many locks
+    std::lock_guard<std::mutex> lk(writer_mtx_);
+    readers.fetch_add(1);
+  }
+  void rdunlock() {
+    HeldLock* held = FindHeld(false);
+    if (held && --held->depth == 0) held->lock = nullptr;
+    Slot().readers.fetch_sub(1);
+  }
+  void wrlock() {
+    writer_mtx_.lock();
+    writer_.store(true);
+    for (auto& slot : slots_) {
+      while (slot.readers.load() != 0) std::this_thread::yield();
+    }
+  }
+  void wrunlock() {
+    writer_.store(false);
+    writer_mtx_.unlock();
+  }
+
+ private:
+  static constexpr uint32_t kSlotNum = 32;
+  static constexpr uint32_t kMaxHeldLocks = 16;
+  // the counters of two slots are never in the same cache line
+  struct ReaderSlot {
+    std::atomic<int32_t> readers{0};
+    char padding[64 - sizeof(std::atomic<int32_t>)];
+  };
+  struct HeldLock {
+    const BiasedRwLock* lock;
+    uint32_t depth;
+  };
+  ReaderSlot& Slot() {
+    static std::atomic<uint32_t> next_slot{0};
+    static thread_local uint32_t slot = next_slot.fetch_add(1) % kSlotNum;
+    return slots_[slot];
+  }
+  // the read locks held by this thread. It is trivially destructible, so it is valid until the thread exits.
+  HeldLock* FindHeld(bool insert) {
+    static thread_local HeldLock held[kMaxHeldLocks];
+    HeldLock* empty = nullptr;
+    for (auto& it : held) {
+      if (it.lock == this) return &it;
+      if (!it.lock && !empty) empty = &it;
+    }
+    if (insert && empty) *empty = {this, 0};
+    return insert ? empty : nullptr;
+  }
+
+  ReaderSlot slots_[kSlotNum];
+  std::atomic<bool> writer_{false};
+  std::mutex writer_mtx_;
+};
+
 class RwLockWriteGuard {
  public:
-  explicit RwLockWriteGuard(RwLock& lock) : lock_(lock) { lock_.wrlock(); }
-  ~RwLockWriteGuard() { lock_.unlock(); }
+  explicit RwLockWriteGuard(RwLock& lock) : lock_(&lock) { lock_->wrlock(); }
+  explicit RwLockWriteGuard(BiasedRwLock& lock) : biased_lock_(&lock) { biased_lock_->wrlock(); }
+  ~RwLockWriteGuard() {
+    if (lock_) {
+      lock_->unlock();
+    } else {
+      biased_lock_->wrunlock();
+    }
+  }
 
  private:
-  RwLock& lock_;
+  RwLock* lock_ = nullptr;
+  BiasedRwLock* biased_lock_ = nullptr;
 };
 
 class RwLockReadGuard {
  public:
-  explicit RwLockReadGuard(RwLock& lock) : lock_(lock) { lock_.rdlock(); }
-  ~RwLockReadGuard() { lock_.unlock(); }
+  explicit RwLockReadGuard(RwLock& lock) : lock_(&lock) { lock_->rdlock(); }
+  explicit RwLockReadGuard(BiasedRwLock& lock) : biased_lock_(&lock) { biased_lock_->rdlock(); }
+  ~RwLockReadGuard() {
+    if (lock_) {
+      lock_->unlock();
+    } else {
+      biased_lock_->rdunlock();
+    }
+  }
 
  private:
-  RwLock& lock_;
+  RwLock* lock_ = nullptr;
+  BiasedRwLock* biased_lock_ = nullptr;
 };
 
 } /* namespace cnstream */
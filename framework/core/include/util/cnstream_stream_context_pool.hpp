@@ -0,0 +1,216 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_STREAM_CONTEXT_POOL_HPP_
+#define CNSTREAM_STREAM_CONTEXT_POOL_HPP_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @class StreamContextPool
+ *
+ * @brief StreamContextPool holds the per-stream contexts of a module, e.g. the tracker of a stream.
+ *
+ * The contexts are created ahead in Module::Open and kept idle in the pool, so that the first frames of streams added
+ * at the same time do not pay the creation together. A context is bound to a stream when the stream is added, see
+ * Module::OnStreamAdded, or when its first frame arrives, and it is reset and put back into the pool at the end of
+ * the stream. At most ``warm_num`` contexts are kept idle, a context is created when the pool is empty.
+ *
+ * @note It is thread-safe. The creator and the recycler are called without holding the lock of the pool.
+ */
+template <typename T>
+class StreamContextPool {
+ public:
+  using Creator = std::function<std::unique_ptr<T>()>;
+  /** Resets a released context for another stream. Returns false to delete the context instead of reusing it. */
+  using Recycler = std::function<bool(T*)>;
+
+  StreamContextPool() = default;
+  StreamContextPool(const StreamContextPool&) = delete;
+  StreamContextPool& operator=(const StreamContextPool&) = delete;
+
+  /**
+   * @brief Sets how the contexts are created and recycled, and creates ``warm_num`` idle contexts. The contexts
+   *        created before are deleted.
+   *
+   * @param[in] warm_num The number of contexts created ahead and kept idle.
+   * @param[in] creator Creates a context, returns nullptr on failure.
+   * @param[in] recycler Resets a released context, nullptr if the contexts are reused as they are.
+   *
+   * @return Returns false if a context fails to be created.
+   */
+  bool Init(uint32_t warm_num, Creator creator, Recycler recycler = nullptr);
+
+  /**
+   * @brief Gets the context bound to a stream, an idle context is bound to the stream if it has none.
+   *
+   * @param[in] stream_id The stream identification.
+   *
+   * @return Returns the context, nullptr if it fails to be created.
+   */
+  T* Acquire(const std::string& stream_id);
+
+  /**
+   * @brief Gets the context bound to a stream.
+   *
+   * @param[in] stream_id The stream identification.
+   *
+   * @return Returns the context, nullptr if the stream has none.
+   */
+  T* Find(const std::string& stream_id) const;
+
+  /**
+   * @brief Unbinds the context of a stream at the end of the stream. It is recycled into the pool, or deleted if
+   *        ``warm_num`` contexts are idle already.
+   *
+   * @param[in] stream_id The stream identification.
+   *
+   * @return No return value.
+   */
+  void Release(const std::string& stream_id);
+
+  /**
+   * @brief Deletes all contexts, e.g. in Module::Close.
+   *
+   * @return No return value.
+   */
+  void Clear();
+
+  /**
+   * @brief Gets the number of idle contexts.
+   *
+   * @return Returns the number of idle contexts.
+   */
+  size_t IdleNum() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return idle_.size();
+  }
+
+  /**
+   * @brief Gets the number of contexts bound to streams.
+   *
+   * @return Returns the number of streams having a context.
+   */
+  size_t StreamNum() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return streams_.size();
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  uint32_t warm_num_ = 0;
+  Creator creator_;
+  Recycler recycler_;
+  std::vector<std::unique_ptr<T>> idle_;
+  std::map<std::string, std::unique_ptr<T>> streams_;
+};  // class StreamContextPool
+
+template <typename T>
+bool StreamContextPool<T>::Init(uint32_t warm_num, Creator creator, Recycler recycler) {
+  Clear();
+  std::vector<std::unique_ptr<T>> idle;
+  for (uint32_t i = 0; i < warm_num; ++i) {
+    std::unique_ptr<T> ctx = creator ? creator() : nullptr;
+    if (!ctx) return false;
+    idle.push_back(std::move(ctx));
+  }
+  std::lock_guard<std::mutex> lk(mutex_);
+  warm_num_ = warm_num;
+  creator_ = std::move(creator);
+  recycler_ = std::move(recycler);
+  idle_ = std::move(idle);
+  return true;
+}
+
+template <typename T>
+T* StreamContextPool<T>::Acquire(const std::string& stream_id) {
+  Creator creator;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto search = streams_.find(stream_id);
+    if (search != streams_.end()) return search->second.get();
+    if (!idle_.empty()) {
+      T* ctx = idle_.back().get();
+      streams_[stream_id] = std::move(idle_.back());
+      idle_.pop_back();
+      return ctx;
+    }
+    creator = creator_;
+  }
+  std::unique_ptr<T> ctx = creator ? creator() : nullptr;
+  if (!ctx) return nullptr;
+  std::lock_guard<std::mutex> lk(mutex_);
+  std::unique_ptr<T>& bound = streams_[stream_id];
+  // the stream may have got a context from another thread meanwhile
+  if (!bound) {
+    bound = std::move(ctx);
+  } else if (idle_.size() < warm_num_) {
+    idle_.push_back(std::move(ctx));
+  }
+  return bound.get();
+}
+
+template <typename T>
+T* StreamContextPool<T>::Find(const std::string& stream_id) const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto search = streams_.find(stream_id);
+  return search == streams_.end() ? nullptr : search->second.get();
+}
+
+template <typename T>
+void StreamContextPool<T>::Release(const std::string& stream_id) {
+  std::unique_ptr<T> ctx;
+  Recycler recycler;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto search = streams_.find(stream_id);
+    if (search == streams_.end()) return;
+    ctx = std::move(search->second);
+    streams_.erase(search);
+    if (idle_.size() >= warm_num_) return;
+    recycler = recycler_;
+  }
+  if (recycler && !recycler(ctx.get())) return;
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (idle_.size() < warm_num_) idle_.push_back(std::move(ctx));
+}
+
+template <typename T>
+void StreamContextPool<T>::Clear() {
+  std::vector<std::unique_ptr<T>> idle;
+  std::map<std::string, std::unique_ptr<T>> streams;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    idle.swap(idle_);
+    streams.swap(streams_);
+  }
+}
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_STREAM_CONTEXT_POOL_HPP_
@@ -0,0 +1,98 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_STREAM_PARAM_TABLE_HPP_
+#define CNSTREAM_STREAM_PARAM_TABLE_HPP_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+/**
+ * @class StreamParamTable
+ *
+ * @brief StreamParamTable holds the parameters of a module overridden per stream, indexed by the stream index, see
+ * Module::SetStreamParams.
+ *
+ * The overrides of a frame are looked up in O(1) by CNFrameInfo::GetStreamIndex. The lookup returns at once without
+ * touching the table while no stream has overrides.
+ *
+ * @note It is thread-safe. A module keeps the overrides it gets while processing a frame, they are replaced but not
+ *       modified.
+ */
+template <typename T>
+class StreamParamTable {
+ public:
+  StreamParamTable() : params_(GetMaxStreamNumber()) {}
+  StreamParamTable(const StreamParamTable&) = delete;
+  StreamParamTable& operator=(const StreamParamTable&) = delete;
+
+  /**
+   * @brief Sets the overrides of a stream.
+   *
+   * @param[in] stream_index The stream index.
+   * @param[in] params The overrides, nullptr to remove the overrides of the stream.
+   *
+   * @return Returns false if the stream index is out of range.
+   */
+  bool Set(uint32_t stream_index, std::shared_ptr<const T> params) {
+    if (stream_index >= params_.size()) return false;
+    const bool set = params != nullptr;
+    std::shared_ptr<const T> old = std::atomic_exchange(&params_[stream_index], std::move(params));
+    if (set && !old) {
+      num_.fetch_add(1);
+    } else if (!set && old) {
+      num_.fetch_sub(1);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Gets the overrides of a stream.
+   *
+   * @param[in] stream_index The stream index.
+   *
+   * @return Returns the overrides, nullptr if the stream has none.
+   */
+  std::shared_ptr<const T> Get(uint32_t stream_index) const {
+    if (num_.load() == 0 || stream_index >= params_.size()) return nullptr;
+    return std::atomic_load(&params_[stream_index]);
+  }
+
+  /**
+   * @brief Gets the number of streams having overrides.
+   *
+   * @return Returns the number of streams.
+   */
+  uint32_t StreamNum() const { return num_.load(); }
+
+ private:
+  std::vector<std::shared_ptr<const T>> params_;
+  std::atomic<uint32_t> num_{0};
+};  // class StreamParamTable
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_STREAM_PARAM_TABLE_HPP_
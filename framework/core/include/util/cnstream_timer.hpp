@@ -95,6 +95,7 @@
 #include <algorithm>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <mutex>
 #include <set>
@@ -269,9 +270,10 @@ class Timer {
           // Remove time event
           time_events.erase(time_events.begin());
 
-          // Invoke the handler
+          // Invoke the handler. It is copied as events may be reallocated by add() while the lock is released.
+          handler_t handler = events[te.ref].handler;
           lock.unlock();
-          events[te.ref].handler(te.ref);
+          handler(te.ref);
           lock.lock();
 
           if (events[te.ref].valid && events[te.ref].period.count() > 0) {
@@ -292,6 +294,263 @@ class Timer {
   }
 };
 
+/// Timer wheel
+/****************************************************************************
+  TimerWheel is a hierarchical timer wheel, and TimerWheel::Instance() is the
+  timer service shared by the timer users of the process, e.g. the batching
+  timeouts of the inferencers, the frame pacing and the liveness checks of the
+  source modules. One thread serves all of them.
+
+  Scheduling and cancelling a task are O(1). The tasks are one-shot, a task
+  reschedules itself to run periodically. The tasks run in the thread of the
+  wheel one by one, so they must be short, e.g. notifying a condition variable
+  or submitting a job to a thread pool.
+
+  Samples are as follows:
+
+  TimerWheel::TaskId id = TimerWheel::Instance().Schedule(std::chrono::milliseconds(100), [] { ... });
+  TimerWheel::Instance().Cancel(id);
+
+  ***************************************************************************/
+
+class TimerWheel {
+ public:
+  /**
+   * @brief The identification of a task, 0 is never used. Ids of the finished tasks are not reused soon, so it is safe
+   * to cancel a task twice.
+   */
+  using TaskId = uint64_t;
+
+  /**
+   * @brief Gets the timer wheel shared by the process.
+   */
+  static TimerWheel &Instance() {
+    static TimerWheel wheel;
+    return wheel;
+  }
+
+  /**
+   * @brief Starts a timer wheel.
+   *
+   * @param tick The resolution of the wheel. A task runs at the first tick after its time.
+   */
+  explicit TimerWheel(duration tick = milliseconds(1)) : tick_(std::max(tick, duration(1))), start_(clock::now()) {
+    for (auto &slot : slots_) slot = kNil;
+    worker_ = std::thread([this] { Run(); });
+  }
+
+  ~TimerWheel() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    done_ = true;
+    lk.unlock();
+    cond_.notify_all();
+    worker_.join();
+  }
+
+  TimerWheel(const TimerWheel &) = delete;
+  TimerWheel &operator=(const TimerWheel &) = delete;
+
+  /**
+   * @brief Schedules a task.
+   *
+   * @param when The time at which the task runs.
+   * @param task The task.
+   *
+   * @return Returns the identification of the task.
+   */
+  TaskId Schedule(const timestamp &when, std::function<void()> task) {
+    const int64_t elapsed = std::chrono::duration_cast<duration>(when - start_).count();
+    const uint64_t expire = elapsed <= 0 ? 0 : (elapsed + tick_.count() - 1) / tick_.count();
+    std::unique_lock<std::mutex> lk(mtx_);
+    // the wheel is not advanced while it is empty
+    if (size_ == 0) current_ = std::max(current_, Now());
+    uint32_t index;
+    if (free_nodes_.empty()) {
+      index = static_cast<uint32_t>(nodes_.size());
+      nodes_.emplace_back();
+    } else {
+      index = free_nodes_.back();
+      free_nodes_.pop_back();
+    }
+    Node &node = nodes_[index];
+    node.expire = expire;
+    node.task = std::move(task);
+    const TaskId id = static_cast<TaskId>(node.generation) << 32 | (index + 1);
+    Link(index, current_ + 1);
+    ++size_;
+    const bool notify = expire < wake_tick_;
+    lk.unlock();
+    if (notify) cond_.notify_all();
+    return id;
+  }
+
+  /**
+   * @brief Schedules a task to run after a delay.
+   */
+  template <class Rep, class Period>
+  TaskId Schedule(const std::chrono::duration<Rep, Period> &delay, std::function<void()> task) {
+    return Schedule(clock::now() + std::chrono::duration_cast<duration>(delay), std::move(task));
+  }
+
+  /**
+   * @brief Cancels a task. It does not wait for the task if the task is running.
+   *
+   * @return Returns true if the task is cancelled before it runs. Otherwise, returns false.
+   */
+  bool Cancel(TaskId id) {
+    const uint64_t index = (id & 0xffffffff) - 1;
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (index >= nodes_.size() || nodes_[index].generation != id >> 32 || nodes_[index].slot == kNil) return false;
+    Unlink(static_cast<uint32_t>(index));
+    Free(static_cast<uint32_t>(index));
+    --size_;
+    return true;
+  }
+
+  /**
+   * @brief Gets the number of the tasks scheduled.
+   */
+  size_t Size() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return size_;
+  }
+
+ private:
+  static constexpr uint32_t kNil = 0xffffffff;
+  static constexpr uint32_t kLevels = 4;
+  static constexpr uint32_t kSlotBits = 8;
+  static constexpr uint32_t kSlots = 1 << kSlotBits;
+
+  struct Node {
+    uint64_t expire = 0;  // in ticks
+    std::function<void()> task;
+    uint32_t generation = 0;
+    uint32_t slot = kNil;  // the list the node is linked in
+    uint32_t prev = kNil;
+    uint32_t next = kNil;
+  };
+
+  uint64_t Now() const {
+    return std::chrono::duration_cast<duration>(clock::now() - start_).count() / tick_.count();
+  }
+
+  // links a node to the slot of its expire tick, the farther the expire tick is, the coarser the level is.
+  void Link(uint32_t index, uint64_t min_tick) {
+    Node &node = nodes_[index];
+    const uint64_t expire = std::max(node.expire, min_tick);
+    uint64_t delta = expire - current_;
+    uint32_t level = 0;
+    while (level + 1 < kLevels && delta >= (1ULL << (kSlotBits * (level + 1)))) ++level;
+    // beyond the last level, the node is cascaded again when its slot comes
+    const uint64_t max_delta = (1ULL << (kSlotBits * kLevels)) - 1;
+    const uint64_t tick = delta > max_delta ? current_ + max_delta : expire;
+    node.slot = level * kSlots + ((tick >> (kSlotBits * level)) & (kSlots - 1));
+    node.prev = kNil;
+    node.next = slots_[node.slot];
+    if (node.next != kNil) nodes_[node.next].prev = index;
+    slots_[node.slot] = index;
+  }
+
+  void Unlink(uint32_t index) {
+    Node &node = nodes_[index];
+    if (node.prev != kNil) {
+      nodes_[node.prev].next = node.next;
+    } else {
+      slots_[node.slot] = node.next;
+    }
+    if (node.next != kNil) nodes_[node.next].prev = node.prev;
+    node.slot = kNil;
+  }
+
+  void Free(uint32_t index) {
+    Node &node = nodes_[index];
+    node.task = nullptr;
+    ++node.generation;
+    free_nodes_.push_back(index);
+  }
+
+  // moves the nodes of a slot to the finer levels
+  void Cascade(uint32_t level) {
+    const uint32_t slot = level * kSlots + ((current_ >> (kSlotBits * level)) & (kSlots - 1));
+    uint32_t index = slots_[slot];
+    slots_[slot] = kNil;
+    while (index != kNil) {
+      const uint32_t next = nodes_[index].next;
+      Link(index, current_);
+      index = next;
+    }
+  }
+
+  // advances the wheel by one tick and takes the tasks expired
+  void Advance(std::vector<std::function<void()>> *ready) {
+    ++current_;
+    for (uint32_t level = 1; level < kLevels; ++level) {
+      if ((current_ & ((1ULL << (kSlotBits * level)) - 1)) != 0) break;
+      Cascade(level);
+    }
+    const uint32_t slot = current_ & (kSlots - 1);
+    uint32_t index = slots_[slot];
+    slots_[slot] = kNil;
+    while (index != kNil) {
+      const uint32_t next = nodes_[index].next;
+      if (nodes_[index].expire > current_) {
+        Link(index, current_ + 1);  // linked by the clamped tick of the last level
+      } else {
+        nodes_[index].slot = kNil;
+        ready->push_back(std::move(nodes_[index].task));
+        Free(index);
+        --size_;
+      }
+      index = next;
+    }
+  }
+
+  // the next tick whose level 0 slot is not empty, or the next tick cascading the nodes of the other levels
+  uint64_t NextWakeTick() const {
+    const uint64_t boundary = (current_ | (kSlots - 1)) + 1;
+    for (uint64_t tick = current_ + 1; tick < boundary; ++tick) {
+      if (slots_[tick & (kSlots - 1)] != kNil) return tick;
+    }
+    return boundary;
+  }
+
+  void Run() {
+    std::vector<std::function<void()>> ready;
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!done_) {
+      if (size_ == 0) {
+        wake_tick_ = UINT64_MAX;
+        cond_.wait(lk, [this] { return done_ || size_ > 0; });
+        continue;
+      }
+      const uint64_t now = Now();
+      while (current_ < now && size_ > 0) Advance(&ready);
+      if (ready.empty()) {
+        wake_tick_ = NextWakeTick();
+        cond_.wait_until(lk, start_ + tick_ * wake_tick_);
+        continue;
+      }
+      lk.unlock();
+      for (auto &task : ready) task();
+      ready.clear();
+      lk.lock();
+    }
+  }
+
+  const duration tick_;
+  const timestamp start_;
+  mutable std::mutex mtx_;
+  std::condition_variable cond_;
+  std::thread worker_;
+  bool done_ = false;
+  uint64_t current_ = 0;  // the ticks elapsed since start_
+  uint64_t wake_tick_ = UINT64_MAX;  // the tick the worker waits for
+  size_t size_ = 0;
+  uint32_t slots_[kLevels * kSlots];
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_nodes_;
+};  // class TimerWheel
+
 /// Timestamp utilities
 /****************************************************************************
   class TimeStamp provides a way to generate unique timestamps which based on
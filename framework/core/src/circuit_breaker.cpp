@@ -0,0 +1,86 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "circuit_breaker.hpp"
+
+#include <string>
+#include <utility>
+
+namespace cnstream {
+
+CircuitBreaker::CircuitBreaker(const CircuitBreakerConfig& config, StateFunc state_func)
+    : config_(config), state_func_(std::move(state_func)) {}
+
+bool CircuitBreaker::Allow(Clock::time_point now) {
+  if (state_.load(std::memory_order_relaxed) == CircuitState::CLOSED) return true;
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (state_.load() == CircuitState::CLOSED) return true;
+  if (now < probe_time_) return false;
+  probe_time_ = now + std::chrono::milliseconds(config_.open_ms);
+  if (state_.load() == CircuitState::OPEN) SetState(CircuitState::HALF_OPEN, "a probe is let in");
+  return true;
+}
+
+void CircuitBreaker::OnProcessed(Clock::duration latency, Clock::time_point now) {
+  const auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(latency).count();
+  if (config_.max_latency_ms > 0 && latency_ms > config_.max_latency_ms) {
+    OnFailed("took " + std::to_string(latency_ms) + " ms", now);
+    return;
+  }
+  if (state_.load(std::memory_order_relaxed) == CircuitState::CLOSED && failures_ == 0) return;
+  std::lock_guard<std::mutex> lk(mtx_);
+  switch (state_.load()) {
+    case CircuitState::CLOSED:
+      failures_ = 0;
+      break;
+    case CircuitState::HALF_OPEN:
+      SetState(CircuitState::CLOSED, "the probe is processed in time");
+      break;
+    default:
+      // the frames queued before the breaker opened, the module is probed only after open_ms
+      break;
+  }
+}
+
+void CircuitBreaker::OnFailed(const std::string& reason, Clock::time_point now) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  switch (state_.load()) {
+    case CircuitState::CLOSED:
+      if (++failures_ < config_.failure_threshold) return;
+      probe_time_ = now + std::chrono::milliseconds(config_.open_ms);
+      SetState(CircuitState::OPEN,
+               std::to_string(failures_.load()) + " frames failed in a row, the last one " + reason);
+      break;
+    case CircuitState::HALF_OPEN:
+      probe_time_ = now + std::chrono::milliseconds(config_.open_ms);
+      SetState(CircuitState::OPEN, "the probe failed, it " + reason);
+      break;
+    default:
+      break;
+  }
+}
+
+void CircuitBreaker::SetState(CircuitState state, const std::string& reason) {
+  failures_ = 0;
+  state_.store(state);
+  if (state_func_) state_func_(state, reason);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,85 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_CIRCUIT_BREAKER_HPP_
+#define MODULES_CORE_INCLUDE_CIRCUIT_BREAKER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "cnstream_common.hpp"
+#include "cnstream_config.hpp"
+
+namespace cnstream {
+
+enum class CircuitState {
+  CLOSED = 0,  // the frames are processed by the module
+  OPEN,        // the frames bypass the module
+  HALF_OPEN,   // a probe is let in, the other frames bypass the module
+};
+
+/**
+ * @brief The circuit breaker of a module, see CircuitBreakerConfig.
+ *
+ * It is checked for each frame before the frame is pushed to the module, and told the results of the frames processed
+ * by the module. The state changes are reported by the function passed to the constructor, which is called with the
+ * lock of the breaker held, so the changes are reported in order. It must not call the breaker.
+ */
+class CircuitBreaker : private NonCopyable {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using StateFunc = std::function<void(CircuitState state, const std::string& reason)>;
+
+  CircuitBreaker(const CircuitBreakerConfig& config, StateFunc state_func);
+  /**
+   * @brief Whether a frame is processed by the module, otherwise it bypasses the module. Once the breaker has been
+   * open for ``open_ms``, one frame is let in as a probe. Another one is let in if the probe is not reported in
+   * ``open_ms``, e.g. it is dropped before being processed.
+   */
+  bool Allow(Clock::time_point now);
+  /**
+   * @brief Reports a frame processed by the module. It fails if it took longer than ``max_latency_ms``.
+   */
+  void OnProcessed(Clock::duration latency, Clock::time_point now);
+  /**
+   * @brief Reports a frame failed in the module, e.g. an error is returned or the input queue is full. The reason
+   * completes "the frame ...", e.g. "returned -1".
+   */
+  void OnFailed(const std::string& reason, Clock::time_point now);
+  CircuitState GetState() const { return state_.load(); }
+
+ private:
+  // called with mtx_ locked
+  void SetState(CircuitState state, const std::string& reason);
+
+  const CircuitBreakerConfig config_;
+  const StateFunc state_func_;
+  std::mutex mtx_;
+  std::atomic<CircuitState> state_{CircuitState::CLOSED};  // modified with mtx_ locked
+  std::atomic<uint32_t> failures_{0};  // the frames failed in a row, modified with mtx_ locked
+  Clock::time_point probe_time_;  // when the next probe is let in
+};  // class CircuitBreaker
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_CIRCUIT_BREAKER_HPP_
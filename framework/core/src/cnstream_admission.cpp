@@ -0,0 +1,195 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_admission.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+AdmissionController::AdmissionController(const AdmissionConfig& config) : config_(config) {}
+
+AdmissionController::~AdmissionController() {
+  Stop();
+}
+
+bool AdmissionController::Start(SampleFunc sample_func) {
+  if (running_.load()) return true;
+  if (!sample_func) {
+    LOGE(CORE) << "AdmissionController::Start() sample_func must be set.";
+    return false;
+  }
+  sample_func_ = std::move(sample_func);
+  running_.store(true);
+  thread_ = std::thread(&AdmissionController::Loop, this);
+  return true;
+}
+
+void AdmissionController::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(exit_mtx_);
+    if (!running_.load()) return;
+    running_.store(false);
+  }
+  exit_cond_.notify_all();
+  if (thread_.joinable()) thread_.join();
+  std::lock_guard<std::mutex> lk(mtx_);
+  capacity_ = -1;
+  for (auto& it : streams_) it.second.state.allowed_fps = -1;
+}
+
+double AdmissionController::DefaultShare(double weight) const {
+  double total_weight = 0;
+  for (const auto& it : streams_) total_weight += it.second.state.weight;
+  return std::max(capacity_ * weight / total_weight, config_.min_fps);
+}
+
+bool AdmissionController::Admit(const std::string& stream_id, std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto ret = streams_.emplace(stream_id, StreamState());
+  StreamState& stream = ret.first->second;
+  if (ret.second) {
+    stream.state.allowed_fps = capacity_ < 0 ? -1 : DefaultShare(stream.state.weight);
+    stream.tokens = std::max(1.0, stream.state.allowed_fps * config_.burst_ms / 1000);
+    stream.refill_time = now;
+  }
+  ++stream.offered;
+  const double allowed_fps = stream.state.allowed_fps;
+  if (allowed_fps >= 0) {
+    const double burst = std::max(1.0, allowed_fps * config_.burst_ms / 1000);
+    const double elapsed_s = std::chrono::duration<double>(now - stream.refill_time).count();
+    stream.tokens = std::min(burst, stream.tokens + allowed_fps * std::max(elapsed_s, 0.0));
+    stream.refill_time = now;
+    if (stream.tokens < 1) {
+      ++stream.state.rejected;
+      return false;
+    }
+    stream.tokens -= 1;
+  }
+  ++stream.state.admitted;
+  return true;
+}
+
+bool AdmissionController::SetWeight(const std::string& stream_id, double weight) {
+  if (!(weight > 0)) {
+    LOGE(CORE) << "[AdmissionController] [" << stream_id << "]: weight must be greater than 0, but got " << weight;
+    return false;
+  }
+  std::lock_guard<std::mutex> lk(mtx_);
+  streams_[stream_id].state.weight = weight;
+  return true;
+}
+
+void AdmissionController::RemoveStream(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  streams_.erase(stream_id);
+}
+
+void AdmissionController::Update(bool overloaded, double completed_fps, double elapsed_s) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  double offered_fps = 0;
+  for (auto& it : streams_) {
+    StreamState& stream = it.second;
+    stream.state.offered_fps = elapsed_s > 0 ? stream.offered / elapsed_s : 0;
+    stream.offered = 0;
+    offered_fps += stream.state.offered_fps;
+  }
+
+  const double old_capacity = capacity_;
+  if (overloaded) {
+    // multiplicative decrease, the queues are drained as the pipeline completes more than it admits
+    capacity_ = (capacity_ < 0 ? completed_fps : std::min(capacity_, completed_fps)) * config_.decrease_ratio;
+  } else if (capacity_ >= 0) {
+    capacity_ = std::max(capacity_ * config_.increase_ratio, config_.min_fps * streams_.size());
+    if (capacity_ >= offered_fps) capacity_ = -1;  // all streams are covered
+  }
+  if (capacity_ < 0) {
+    for (auto& it : streams_) it.second.state.allowed_fps = -1;
+    if (old_capacity >= 0) LOGI(CORE) << "[AdmissionController] The frame rates of the streams are not limited.";
+    return;
+  }
+  if (old_capacity < 0) {
+    LOGI(CORE) << "[AdmissionController] Pipeline overloaded, the streams share " << capacity_ << " fps.";
+  }
+
+  // weighted max-min fairness, the streams sending less than their shares leave the rest to the others.
+  std::vector<StreamState*> active;
+  double weights = 0;
+  for (auto& it : streams_) {
+    StreamState& stream = it.second;
+    if (stream.state.offered_fps > 0) {
+      active.push_back(&stream);
+      weights += stream.state.weight;
+    }
+  }
+  std::sort(active.begin(), active.end(), [](const StreamState* a, const StreamState* b) {
+    return a->state.offered_fps / a->state.weight < b->state.offered_fps / b->state.weight;
+  });
+  double remaining = capacity_;
+  for (StreamState* stream : active) {
+    const double share = std::max(remaining * stream->state.weight / weights, 0.0);
+    stream->state.allowed_fps = std::max(share, config_.min_fps);
+    remaining -= std::min(stream->state.offered_fps, share);
+    weights -= stream->state.weight;
+  }
+  for (auto& it : streams_) {
+    if (it.second.state.offered_fps <= 0) it.second.state.allowed_fps = DefaultShare(it.second.state.weight);
+  }
+}
+
+double AdmissionController::GetCapacity() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return capacity_;
+}
+
+std::map<std::string, AdmissionStreamState> AdmissionController::GetStreamStates() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::map<std::string, AdmissionStreamState> states;
+  for (const auto& it : streams_) states[it.first] = it.second.state;
+  return states;
+}
+
+void AdmissionController::Loop() {
+  const std::chrono::milliseconds interval(config_.interval_ms);
+  auto last_time = std::chrono::steady_clock::now();
+  uint64_t last_completed = sample_func_().completed_frames;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(exit_mtx_);
+      if (exit_cond_.wait_for(lk, interval, [this] { return !running_.load(); })) break;
+    }
+    const AdmissionSample sample = sample_func_();
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed_s = std::chrono::duration<double>(now - last_time).count();
+    const double completed_fps = (sample.completed_frames - last_completed) / elapsed_s;
+    last_time = now;
+    last_completed = sample.completed_frames;
+    Update(sample.overloaded, completed_fps, elapsed_s);
+  }
+}
+
+}  // namespace cnstream
@@ -0,0 +1,169 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "private/cnstream_affinity.hpp"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+static const char* kNumaNodeDir = "/sys/devices/system/node";
+static const char* kPciDeviceDir = "/sys/bus/pci/devices";
+static const char* kCambriconVendorId = "0xcabc";
+// see linux/mempolicy.h
+static constexpr int kMpolPreferred = 1;
+static constexpr int kMaxNumaNodeNum = 1024;
+
+static thread_local int g_thread_numa_node = -1;
+
+static bool ReadFirstLine(const std::string& path, std::string* line) {
+  std::ifstream ifs(path);
+  if (!ifs.is_open()) return false;
+  std::getline(ifs, *line);
+  return true;
+}
+
+static bool ParseCpuId(const std::string& str, int* cpu) {
+  if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos) return false;
+  *cpu = std::atoi(str.c_str());
+  return true;
+}
+
+bool ParseCpuList(const std::string& cpu_list, std::vector<int>* cpus) {
+  cpus->clear();
+  size_t start = 0;
+  while (start <= cpu_list.size()) {
+    size_t end = cpu_list.find(',', start);
+    if (end == std::string::npos) end = cpu_list.size();
+    std::string item = cpu_list.substr(start, end - start);
+    item.erase(0, item.find_first_not_of(" \n"));
+    item.erase(item.find_last_not_of(" \n") + 1);
+    size_t dash = item.find('-');
+    int first = 0, last = 0;
+    if (dash == std::string::npos) {
+      if (!ParseCpuId(item, &first)) return false;
+      last = first;
+    } else if (!ParseCpuId(item.substr(0, dash), &first) || !ParseCpuId(item.substr(dash + 1), &last) ||
+               first > last) {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) cpus->push_back(cpu);
+    start = end + 1;
+  }
+  std::sort(cpus->begin(), cpus->end());
+  cpus->erase(std::unique(cpus->begin(), cpus->end()), cpus->end());
+  return !cpus->empty();
+}
+
+int GetNumaNodeNum() {
+  DIR* dir = opendir(kNumaNodeDir);
+  if (!dir) return 1;
+  int num = 0;
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.compare(0, 4, "node") == 0 && name.size() > 4 &&
+        name.find_first_not_of("0123456789", 4) == std::string::npos) {
+      ++num;
+    }
+  }
+  closedir(dir);
+  return std::max(num, 1);
+}
+
+std::vector<int> GetNumaNodeCpus(int numa_node) {
+  std::vector<int> cpus;
+  std::string line;
+  if (numa_node < 0 ||
+      !ReadFirstLine(std::string(kNumaNodeDir) + "/node" + std::to_string(numa_node) + "/cpulist", &line) ||
+      !ParseCpuList(line, &cpus)) {
+    cpus.clear();
+  }
+  return cpus;
+}
+
+int GetMluNumaNode(int device_id) {
+  if (device_id < 0) return -1;
+  std::vector<std::string> mlu_devices;
+  DIR* dir = opendir(kPciDeviceDir);
+  if (!dir) return -1;
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name[0] == '.') continue;
+    std::string vendor;
+    if (ReadFirstLine(std::string(kPciDeviceDir) + "/" + name + "/vendor", &vendor) &&
+        vendor.compare(0, 6, kCambriconVendorId) == 0) {
+      mlu_devices.push_back(name);
+    }
+  }
+  closedir(dir);
+  if (static_cast<size_t>(device_id) >= mlu_devices.size()) return -1;
+  std::sort(mlu_devices.begin(), mlu_devices.end());
+  std::string line;
+  if (!ReadFirstLine(std::string(kPciDeviceDir) + "/" + mlu_devices[device_id] + "/numa_node", &line)) return -1;
+  return std::atoi(line.c_str());
+}
+
+bool SetCurrentThreadAffinity(const std::vector<int>& cpus, int numa_node) {
+  if (cpus.empty()) return false;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      LOGE(CORE) << "Invalid cpu id " << cpu;
+      return false;
+    }
+    CPU_SET(cpu, &cpu_set);
+  }
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (ret != 0) {
+    LOGW(CORE) << "Set thread affinity failed, error code: " << ret;
+    return false;
+  }
+  g_thread_numa_node = numa_node;
+  return true;
+}
+
+int GetCurrentThreadNumaNode() { return g_thread_numa_node; }
+
+bool SetMemoryNumaNode(void* addr, size_t size, int numa_node) {
+  if (!addr || numa_node < 0 || numa_node >= kMaxNumaNodeNum) return false;
+#ifdef SYS_mbind
+  constexpr int kBitsPerWord = 8 * sizeof(unsigned long);  // NOLINT
+  unsigned long nodemask[kMaxNumaNodeNum / kBitsPerWord] = {0};  // NOLINT
+  nodemask[numa_node / kBitsPerWord] |= 1UL << (numa_node % kBitsPerWord);
+  return 0 == syscall(SYS_mbind, addr, size, kMpolPreferred, nodemask, kMaxNumaNodeNum + 1, 0);
+#else
+  return false;
+#endif
+}
+
+}  // namespace cnstream
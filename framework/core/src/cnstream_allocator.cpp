@@ -19,10 +19,17 @@
  *************************************************************************/
 #include "private/cnstream_allocator.hpp"
 
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
 #include <exception>
 #include <memory>
 
 #include "cnrt.h"
+#include "cnstream_memory_accountant.hpp"
+#include "private/cnstream_affinity.hpp"
 
 namespace cnstream {
 
@@ -65,30 +72,43 @@ class MemoryAllocator : public NonCopyable {
   virtual ~MemoryAllocator() = default;
   virtual void *alloc(size_t size, int timeout_ms = 0) = 0;
   virtual void free(void *p) = 0;
+  virtual MemoryType memory_type() const = 0;
   int device_id() const { return device_id_; }
   void set_device_id(int device_id) { device_id_ = device_id; }
+  // each allocation has its own allocator, the charge is released with the allocator.
+  void charge(size_t size) { charge_ = MemoryCharge(memory_type(), size); }
 
  protected:
   int device_id_ = -1;
   std::mutex mutex_;
+  MemoryCharge charge_;
 };
 
 class CpuAllocator : public MemoryAllocator {
  public:
-  CpuAllocator() : MemoryAllocator(-1) {}
+  explicit CpuAllocator(int numa_node = -1) : MemoryAllocator(-1), numa_node_(numa_node) {}
   ~CpuAllocator() = default;
 
   void *alloc(size_t size, int timeout_ms = 0) override;
   void free(void *p) override;
+  MemoryType memory_type() const override { return MemoryType::HOST; }
+
+ private:
+  int numa_node_ = -1;
+  bool huge_page_ = false;
 };
 
 class MluAllocator : public MemoryAllocator {
  public:
-  explicit MluAllocator(int device_id = 0) : MemoryAllocator(device_id) {}
+  explicit MluAllocator(int device_id = 0, int ddr_chn = -1) : MemoryAllocator(device_id), ddr_chn_(ddr_chn) {}
   ~MluAllocator() = default;
 
   void *alloc(size_t size, int timeout_ms = 0) override;
   void free(void *p) override;
+  MemoryType memory_type() const override { return MemoryType::DEVICE; }
+
+ private:
+  int ddr_chn_ = -1;
 };
 
 // helper funcs
@@ -105,50 +125,392 @@ class CnAllocDeleter final {
 std::shared_ptr<void> cnMemAlloc(size_t size, std::shared_ptr<MemoryAllocator> allocator) {
   if (allocator) {
     std::shared_ptr<void> ds(allocator->alloc(size), CnAllocDeleter(allocator));
+    if (ds) allocator->charge(size);
     return ds;
   }
   return nullptr;
 }
 
 std::shared_ptr<void> cnCpuMemAlloc(size_t size) {
-  std::shared_ptr<MemoryAllocator> allocator = std::make_shared<CpuAllocator>();
+  return cnCpuMemAlloc(size, GetCurrentThreadNumaNode());
+}
+
+std::shared_ptr<void> cnCpuMemAlloc(size_t size, int numa_node) {
+  std::shared_ptr<MemoryAllocator> allocator = std::make_shared<CpuAllocator>(numa_node);
   return cnMemAlloc(size, allocator);
 }
 
 std::shared_ptr<void> cnMluMemAlloc(size_t size, int device_id) {
-  std::shared_ptr<MemoryAllocator> allocator = std::make_shared<MluAllocator>(device_id);
+  return cnMluMemAlloc(size, device_id, -1);
+}
+
+std::shared_ptr<void> cnMluMemAlloc(size_t size, int device_id, int ddr_chn) {
+  std::shared_ptr<MemoryAllocator> allocator = std::make_shared<MluAllocator>(device_id, ddr_chn);
   return cnMemAlloc(size, allocator);
 }
 
 // cpu Var-size allocator
 void *CpuAllocator::alloc(size_t size, int timeout_ms) {
+  HugePageMemoryPool &huge_page_pool = HugePageMemoryPool::Instance();
+  if (huge_page_pool.IsEnabled()) {
+    void *ptr = huge_page_pool.Alloc(size, numa_node_);
+    if (ptr) {
+      huge_page_ = true;
+      return ptr;
+    }
+  }
   size_t alloc_size = (size + 4095) & (~0xFFF);  // Align 4096
-  return static_cast<void *>(new (std::nothrow) unsigned char[alloc_size]);
+  if (numa_node_ < 0) {
+    return static_cast<void *>(new (std::nothrow) unsigned char[alloc_size]);
+  }
+  // page aligned, so that the memory policy only applies to the pages of this buffer.
+  void *ptr = nullptr;
+  if (posix_memalign(&ptr, 4096, alloc_size) != 0) return nullptr;
+  if (!SetMemoryNumaNode(ptr, alloc_size, numa_node_)) {
+    LOGW(CORE) << "Allocate cpu memory on NUMA node " << numa_node_ << " failed, use default policy.";
+  }
+  return ptr;
 }
 
 void CpuAllocator::free(void *p) {
+  if (huge_page_) {
+    HugePageMemoryPool::Instance().Free(p);
+    return;
+  }
+  if (numa_node_ >= 0) {
+    ::free(p);
+    return;
+  }
   unsigned char *ptr = static_cast<unsigned char *>(p);
   delete[] ptr;
 }
 
-// mlu var-size allocator
+// mlu var-size allocator, memory comes from the shared pool
 void *MluAllocator::alloc(size_t size, int timeout_ms) {
-  size_t alloc_size = (size + 4095) & (~0xFFF);  // Align 4096
+  return MluMemoryPool::Instance().Alloc(size, device_id_, ddr_chn_);
+}
+
+void MluAllocator::free(void *p) {
+  MluMemoryPool::Instance().Free(p);
+}
+
+size_t CachingMemoryPool::GetSizeClass(size_t size) {
+  size_t aligned = (std::max(size, static_cast<size_t>(1)) + 4095) & (~0xFFF);  // Align 4096
+  size_t pow2 = 4096;
+  while (pow2 < aligned) pow2 <<= 1;
+  if (pow2 <= 64 * 1024) return pow2;
+  // quarter steps between two powers of two, the waste is less than 25%
+  size_t step = pow2 >> 3;
+  return (aligned + step - 1) / step * step;
+}
+
+static void UpdatePeak(MemoryPoolStats *stats) {
+  stats->peak_in_use_bytes = std::max(stats->peak_in_use_bytes, stats->in_use_bytes);
+  stats->peak_total_bytes = std::max(stats->peak_total_bytes, stats->in_use_bytes + stats->cached_bytes);
+}
+
+void *CachingMemoryPool::AllocBlock(size_t size, const PoolKey &key) {
+  const size_t block_size = GetSizeClass(size);
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    SubPool &pool = pools_[key];
+    pool.stats.alloc_num++;
+    auto iter = pool.free_blocks.find(block_size);
+    if (iter != pool.free_blocks.end() && !iter->second.empty()) {
+      void *ptr = iter->second.back();
+      iter->second.pop_back();
+      pool.stats.cached_bytes -= block_size;
+      pool.stats.in_use_bytes += block_size;
+      pool.stats.hit_num++;
+      UpdatePeak(&pool.stats);
+      return ptr;
+    }
+  }
+
+  // driver allocation is slow, do not hold the lock
+  void *ptr = RawAlloc(block_size, key);
+  if (!ptr) {
+    // cached blocks of other size classes may be the reason of out of memory
+    LOGW(CORE) << "Allocate " << block_size << " bytes on device " << key.first << " failed, release cache and retry.";
+    ReleaseCachedBlocks(key.first);
+    ptr = RawAlloc(block_size, key);
+    if (!ptr) {
+      LOGE(CORE) << "Allocate " << block_size << " bytes on device " << key.first << " failed.";
+      return nullptr;
+    }
+  }
 
   std::lock_guard<std::mutex> lk(mutex_);
-  MluDeviceGuard guard(device_id_);
-  void *mlu_ptr;
-  if (cnrtMalloc(&mlu_ptr, alloc_size) != CNRT_RET_SUCCESS) {
-    return nullptr;
+  SubPool &pool = pools_[key];
+  blocks_[ptr] = Block{key, block_size};
+  pool.stats.in_use_bytes += block_size;
+  pool.stats.device_alloc_num++;
+  UpdatePeak(&pool.stats);
+  return ptr;
+}
+
+bool CachingMemoryPool::FreeBlock(void *ptr) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  auto iter = blocks_.find(ptr);
+  if (iter == blocks_.end()) return false;
+  const Block block = iter->second;
+  SubPool &pool = pools_[block.key];
+  pool.stats.in_use_bytes -= block.size;
+  if (pool.stats.cached_bytes + block.size <= cache_limit_) {
+    pool.free_blocks[block.size].push_back(ptr);
+    pool.stats.cached_bytes += block.size;
+    return true;
   }
+  blocks_.erase(iter);
+  pool.stats.device_free_num++;
+  lk.unlock();
+  RawFree(ptr, block.size, block.key);
+  return true;
+}
 
-  return mlu_ptr;
+void CachingMemoryPool::TakeCachedBlocks(SubPool *pool, size_t limit,
+                                         std::vector<std::pair<void *, Block>> *blocks) {
+  // release the largest blocks first
+  for (auto iter = pool->free_blocks.rbegin(); iter != pool->free_blocks.rend() && pool->stats.cached_bytes > limit;
+       ++iter) {
+    std::vector<void *> &ptrs = iter->second;
+    while (!ptrs.empty() && pool->stats.cached_bytes > limit) {
+      void *ptr = ptrs.back();
+      ptrs.pop_back();
+      auto block_iter = blocks_.find(ptr);
+      blocks->emplace_back(ptr, block_iter->second);
+      blocks_.erase(block_iter);
+      pool->stats.cached_bytes -= iter->first;
+      pool->stats.device_free_num++;
+    }
+  }
 }
 
-void MluAllocator::free(void *p) {
+void CachingMemoryPool::SetCacheLimit(size_t bytes) {
+  std::vector<std::pair<void *, Block>> blocks;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    cache_limit_ = bytes;
+    for (auto &it : pools_) TakeCachedBlocks(&it.second, cache_limit_, &blocks);
+  }
+  for (auto &it : blocks) RawFree(it.first, it.second.size, it.second.key);
+}
+
+size_t CachingMemoryPool::GetCacheLimit() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return cache_limit_;
+}
+
+void CachingMemoryPool::ReleaseCachedBlocks(int device_id) {
+  std::vector<std::pair<void *, Block>> blocks;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (auto &it : pools_) {
+      if (device_id < 0 || it.first.first == device_id) TakeCachedBlocks(&it.second, 0, &blocks);
+    }
+  }
+  for (auto &it : blocks) RawFree(it.first, it.second.size, it.second.key);
+}
+
+MemoryPoolStats CachingMemoryPool::GetPoolStats(const PoolKey &key) const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = pools_.find(key);
+  if (iter == pools_.end()) return MemoryPoolStats();
+  return iter->second.stats;
+}
+
+std::map<std::pair<int, int>, MemoryPoolStats> CachingMemoryPool::GetAllStats() const {
+  std::map<std::pair<int, int>, MemoryPoolStats> stats;
   std::lock_guard<std::mutex> lk(mutex_);
-  MluDeviceGuard guard(device_id_);
-  cnrtFree(p);
+  for (const auto& it : pools_) stats.emplace(it.first, it.second.stats);
+  return stats;
 }
 
+constexpr size_t MluMemoryPool::kDefaultCacheLimit;
+
+MluMemoryPool &MluMemoryPool::Instance() {
+  // never destructed, blocks may be given back by static objects at exit.
+  static MluMemoryPool *pool = new MluMemoryPool;
+  return *pool;
+}
+
+void *MluMemoryPool::RawAlloc(size_t size, const PoolKey &key) {
+  MluDeviceGuard guard(key.first);
+#if (CNRT_MAJOR_VERSION < 5)
+  if (key.second >= 0) cnrtSetCurrentChannel(static_cast<cnrtChannelType_t>(key.second));
+#endif
+  void *mlu_ptr = nullptr;
+  if (cnrtMalloc(&mlu_ptr, size) != CNRT_RET_SUCCESS) {
+    return nullptr;
+  }
+  return mlu_ptr;
+}
+
+void MluMemoryPool::RawFree(void *ptr, size_t size, const PoolKey &key) {
+  MluDeviceGuard guard(key.first);
+#if (CNRT_MAJOR_VERSION < 5)
+  if (key.second >= 0) cnrtSetCurrentChannel(static_cast<cnrtChannelType_t>(key.second));
+#endif
+  cnrtFree(ptr);
+}
+
+void *MluMemoryPool::Alloc(size_t size, int device_id, int ddr_chn) {
+  return AllocBlock(size, PoolKey(device_id, ddr_chn));
+}
+
+void MluMemoryPool::Free(void *ptr) {
+  if (!ptr) return;
+  if (!FreeBlock(ptr)) {
+    LOGE(CORE) << "MluMemoryPool: " << ptr << " is not allocated by the pool.";
+  }
+}
+
+void MluMemoryPool::ReleaseCache(int device_id) { ReleaseCachedBlocks(device_id); }
+
+MemoryPoolStats MluMemoryPool::GetStats(int device_id, int ddr_chn) const {
+  return GetPoolStats(PoolKey(device_id, ddr_chn));
+}
+
+constexpr size_t HostMemoryPool::kDefaultCacheLimit;
+
+HostMemoryPool &HostMemoryPool::Instance() {
+  // never destructed, blocks may be given back by static objects at exit.
+  static HostMemoryPool *pool = new HostMemoryPool;
+  return *pool;
+}
+
+HostMemoryPool::HostMemoryPool() : CachingMemoryPool(kDefaultCacheLimit) {
+  const char *env = getenv("CNSTREAM_PINNED_HOST_MEMORY");
+  enable_ = env && memchr("tTyY1", env[0], 5) != nullptr;
+}
+
+void *HostMemoryPool::RawAlloc(size_t size, const PoolKey &key) {
+  void *ptr = nullptr;
+#if (CNRT_MAJOR_VERSION < 5)
+  if (cnrtMallocHost(&ptr, size, CNRT_MEMTYPE_LOCKED) != CNRT_RET_SUCCESS) return nullptr;
+#else
+  if (cnrtHostMalloc(&ptr, size) != CNRT_RET_SUCCESS) return nullptr;
+#endif
+  return ptr;
+}
+
+void HostMemoryPool::RawFree(void *ptr, size_t size, const PoolKey &key) { cnrtFreeHost(ptr); }
+
+void *HostMemoryPool::Alloc(size_t size) { return AllocBlock(size, PoolKey(-1, -1)); }
+
+void HostMemoryPool::Free(void *ptr) {
+  if (!ptr) return;
+  if (!FreeBlock(ptr)) {
+    LOGE(CORE) << "HostMemoryPool: " << ptr << " is not allocated by the pool.";
+  }
+}
+
+void HostMemoryPool::ReleaseCache() { ReleaseCachedBlocks(-1); }
+
+MemoryPoolStats HostMemoryPool::GetStats() const { return GetPoolStats(PoolKey(-1, -1)); }
+
+constexpr size_t HugePageMemoryPool::kHugePageSize;
+constexpr size_t HugePageMemoryPool::kDefaultCacheLimit;
+
+HugePageMemoryPool &HugePageMemoryPool::Instance() {
+  // never destructed, blocks may be given back by static objects at exit.
+  static HugePageMemoryPool *pool = new HugePageMemoryPool;
+  return *pool;
+}
+
+HugePageMemoryPool::HugePageMemoryPool() : CachingMemoryPool(kDefaultCacheLimit) {
+  const char *env = getenv("CNSTREAM_HUGE_PAGE_MEMORY");
+  enable_ = env && memchr("tTyY1", env[0], 5) != nullptr;
+}
+
+static size_t AlignHugePage(size_t size) {
+  return (size + HugePageMemoryPool::kHugePageSize - 1) & ~(HugePageMemoryPool::kHugePageSize - 1);
+}
+
+void *HugePageMemoryPool::MapRegion(size_t size, int numa_node) {
+  bool huge_page = true;
+  void *ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+  if (ptr == MAP_FAILED) {
+    static std::once_flag warn_flag;
+    std::call_once(warn_flag, [] {
+      LOGW(CORE) << "HugePageMemoryPool: no huge pages reserved, fall back to regular pages. "
+                 << "Set vm.nr_hugepages to use huge pages.";
+    });
+    huge_page = false;
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return nullptr;
+#ifdef MADV_HUGEPAGE
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+  }
+  // the pages are not touched yet, so the policy decides where they are placed.
+  if (numa_node >= 0 && !SetMemoryNumaNode(ptr, size, numa_node)) {
+    LOGW(CORE) << "HugePageMemoryPool: allocate memory on NUMA node " << numa_node << " failed, use default policy.";
+  }
+  if (huge_page) {
+    std::lock_guard<std::mutex> lk(arena_mutex_);
+    huge_page_regions_.insert(ptr);
+    huge_page_bytes_ += size;
+  }
+  return ptr;
+}
+
+void HugePageMemoryPool::UnmapRegion(void *ptr, size_t size) {
+  {
+    std::lock_guard<std::mutex> lk(arena_mutex_);
+    if (huge_page_regions_.erase(ptr)) huge_page_bytes_ -= size;
+  }
+  munmap(ptr, size);
+}
+
+void *HugePageMemoryPool::RawAlloc(size_t size, const PoolKey &key) {
+  if (size >= kHugePageSize) return MapRegion(AlignHugePage(size), key.first);
+  std::unique_lock<std::mutex> lk(arena_mutex_);
+  auto carved_iter = carved_blocks_.find(std::make_pair(key, size));
+  if (carved_iter != carved_blocks_.end() && !carved_iter->second.empty()) {
+    void *ptr = carved_iter->second.back();
+    carved_iter->second.pop_back();
+    return ptr;
+  }
+  Arena &arena = arenas_[key.first];
+  if (arena.used + size > kHugePageSize) {
+    lk.unlock();
+    char *base = static_cast<char *>(MapRegion(kHugePageSize, key.first));
+    if (!base) return nullptr;
+    lk.lock();
+    // the rest of the old arena is wasted, at most one size class.
+    arena.base = base;
+    arena.used = 0;
+  }
+  void *ptr = arena.base + arena.used;
+  arena.used += size;
+  return ptr;
+}
+
+void HugePageMemoryPool::RawFree(void *ptr, size_t size, const PoolKey &key) {
+  if (size >= kHugePageSize) {
+    UnmapRegion(ptr, AlignHugePage(size));
+    return;
+  }
+  // carved blocks can not be unmapped alone, keep them for the next allocation of the same size.
+  std::lock_guard<std::mutex> lk(arena_mutex_);
+  carved_blocks_[std::make_pair(key, size)].push_back(ptr);
+}
+
+void *HugePageMemoryPool::Alloc(size_t size, int numa_node) { return AllocBlock(size, PoolKey(numa_node, -1)); }
+
+void HugePageMemoryPool::Free(void *ptr) {
+  if (!ptr) return;
+  if (!FreeBlock(ptr)) {
+    LOGE(CORE) << "HugePageMemoryPool: " << ptr << " is not allocated by the pool.";
+  }
+}
+
+void HugePageMemoryPool::ReleaseCache() { ReleaseCachedBlocks(-1); }
+
+MemoryPoolStats HugePageMemoryPool::GetStats(int numa_node) const { return GetPoolStats(PoolKey(numa_node, -1)); }
+
 }  // namespace cnstream
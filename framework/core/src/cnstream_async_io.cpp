@@ -0,0 +1,472 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_async_io.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+IoRing::IoRing(uint32_t entries, bool enable) {
+  if (enable && !Setup(entries)) {
+    LOGW(CORE) << "IoRing: io_uring is not available (" << strerror(errno) << "), the file I/O is synchronous.";
+  }
+  if (IsAsync()) thread_ = std::thread(&IoRing::CompletionLoop, this);
+}
+
+IoRing::~IoRing() {
+  if (!IsAsync()) return;
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    cond_.wait(lk, [this] { return inflight_ == 0; });
+    Push(nullptr);
+  }
+  thread_.join();
+  munmap(sqes_, sqes_size_);
+  munmap(cq_ring_, cq_ring_size_);
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+}
+
+IoRing& IoRing::Instance() {
+  // never destructed, files may be closed by static objects at exit.
+  static IoRing* ring = [] {
+    const char* env = getenv("CNSTREAM_IO_URING");
+    return new IoRing(256, !env || memchr("fFnN0", env[0], 5) == nullptr);
+  }();
+  return *ring;
+}
+
+bool IoRing::Setup(uint32_t entries) {
+#ifdef __NR_io_uring_setup
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (fd < 0) return false;
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+    int err = errno;
+    if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_size_);
+    if (cq_ring_ != MAP_FAILED) munmap(cq_ring_, cq_ring_size_);
+    if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+    close(fd);
+    errno = err;
+    return false;
+  }
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+  // a submission entry is consumed by io_uring_enter at once, the completion queue never overflows.
+  max_inflight_ = std::min(params.sq_entries, params.cq_entries);
+  ring_fd_ = fd;
+  return true;
+#else
+  errno = ENOSYS;
+  return false;
+#endif
+}
+
+void IoRing::Read(int fd, void* buf, size_t size, uint64_t offset, Callback done) {
+  std::unique_ptr<Request> request(new Request);
+  request->fd = fd;
+  request->iov.iov_base = buf;
+  request->iov.iov_len = size;
+  request->offset = offset;
+  request->done = std::move(done);
+  Submit(std::move(request));
+}
+
+void IoRing::Write(int fd, const void* buf, size_t size, uint64_t offset, Callback done) {
+  std::unique_ptr<Request> request(new Request);
+  request->write = true;
+  request->fd = fd;
+  request->iov.iov_base = const_cast<void*>(buf);
+  request->iov.iov_len = size;
+  request->offset = offset;
+  request->done = std::move(done);
+  Submit(std::move(request));
+}
+
+// Advances a request by a result, returns true if it is done.
+static bool Advance(struct iovec* iov, uint64_t* offset, int64_t* done_bytes, int64_t result) {
+  if (result <= 0) return true;
+  iov->iov_base = static_cast<char*>(iov->iov_base) + result;
+  iov->iov_len -= result;
+  *offset += result;
+  *done_bytes += result;
+  return iov->iov_len == 0;
+}
+
+// Gets the result passed to the callback of a done request.
+static int64_t Result(bool write, const struct iovec& iov, int64_t done_bytes, int64_t result) {
+  if (result < 0) return result;
+  // no progress in a write, e.g. the disk is full
+  if (write && iov.iov_len != 0) return -EIO;
+  return done_bytes;
+}
+
+void IoRing::Submit(std::unique_ptr<Request> request) {
+  if (!IsAsync()) {
+    int64_t result = 0;
+    while (true) {
+      char* base = static_cast<char*>(request->iov.iov_base);
+      result = request->write ? pwrite(request->fd, base, request->iov.iov_len, request->offset)
+                              : pread(request->fd, base, request->iov.iov_len, request->offset);
+      if (result < 0 && errno == EINTR) continue;
+      if (result < 0) result = -errno;
+      if (Advance(&request->iov, &request->offset, &request->done_bytes, result)) break;
+    }
+    request->done(Result(request->write, request->iov, request->done_bytes, result));
+    return;
+  }
+  std::unique_lock<std::mutex> lk(mutex_);
+  cond_.wait(lk, [this] { return inflight_ < max_inflight_; });
+  ++inflight_;
+  Push(request.release());
+}
+
+void IoRing::Push(Request* request) {
+#ifdef __NR_io_uring_setup
+  // the tail is only written under ``mutex_``
+  const uint32_t tail = *sq_tail_;
+  const uint32_t index = tail & *sq_mask_;
+  struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(sqes_) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  if (request) {
+    sqe->opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = request->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&request->iov);
+    sqe->len = 1;
+    sqe->off = request->offset;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+  } else {
+    sqe->opcode = IORING_OP_NOP;  // wakes up the completion thread to stop
+  }
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  while (syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0) < 0) {
+    if (errno != EINTR && errno != EAGAIN) {
+      LOGE(CORE) << "IoRing: submit failed, " << strerror(errno);
+      break;
+    }
+  }
+#endif
+}
+
+void IoRing::CompletionLoop() {
+#ifdef __NR_io_uring_setup
+  const struct io_uring_cqe* cqes = static_cast<const struct io_uring_cqe*>(cqes_);
+  while (true) {
+    // the head is only written by this thread
+    const uint32_t head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      if (syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+        LOGE(CORE) << "IoRing: wait for completions failed, " << strerror(errno);
+      }
+      continue;
+    }
+    const struct io_uring_cqe& cqe = cqes[head & *cq_mask_];
+    Request* request = reinterpret_cast<Request*>(cqe.user_data);
+    const int64_t result = cqe.res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    if (!request) break;  // stopped by the destructor
+    if (result == -EINTR || result == -EAGAIN ||
+        !Advance(&request->iov, &request->offset, &request->done_bytes, result)) {
+      // continued without counting it again
+      std::lock_guard<std::mutex> lk(mutex_);
+      Push(request);
+      continue;
+    }
+    request->done(Result(request->write, request->iov, request->done_bytes, result));
+    delete request;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      --inflight_;
+    }
+    cond_.notify_all();
+  }
+#endif
+}
+
+AsyncFileReader::AsyncFileReader(IoRing* ring, size_t block_size, uint32_t depth)
+    : ring_(ring ? ring : &IoRing::Instance()), block_size_(block_size), depth_(std::max(depth, 1u)) {}
+
+AsyncFileReader::~AsyncFileReader() { Close(); }
+
+bool AsyncFileReader::Open(const std::string& path) {
+  Close();
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  fd_ = fd;
+  size_ = st.st_size;
+  pos_ = 0;
+  blocks_.resize(depth_);
+  for (Block& block : blocks_) block.data.reset(new char[block_size_]);
+  head_ = 0;
+  queued_ = 0;
+  next_offset_ = 0;
+  return true;
+}
+
+void AsyncFileReader::Close() {
+  if (fd_ < 0) return;
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (queued_) DropHead(&lk);
+  }
+  close(fd_);
+  fd_ = -1;
+  blocks_.clear();
+}
+
+std::vector<uint32_t> AsyncFileReader::QueueBlocks() {
+  std::vector<uint32_t> blocks;
+  while (queued_ < depth_ && static_cast<int64_t>(next_offset_) < size_) {
+    const uint32_t index = (head_ + queued_) % depth_;
+    Block& block = blocks_[index];
+    block.offset = next_offset_;
+    block.result = 0;
+    block.pending = true;
+    next_offset_ += block_size_;
+    ++queued_;
+    blocks.push_back(index);
+  }
+  return blocks;
+}
+
+void AsyncFileReader::SubmitBlocks(const std::vector<uint32_t>& blocks) {
+  // not locked, the callback is called in place by a synchronous ring
+  for (uint32_t index : blocks) {
+    Block& block = blocks_[index];
+    const size_t size = std::min<int64_t>(block_size_, size_ - block.offset);
+    ring_->Read(fd_, block.data.get(), size, block.offset, [this, index](int64_t result) {
+      std::lock_guard<std::mutex> lk(mutex_);
+      blocks_[index].result = result;
+      blocks_[index].pending = false;
+      cond_.notify_all();
+    });
+  }
+}
+
+void AsyncFileReader::DropHead(std::unique_lock<std::mutex>* lk) {
+  Block& block = blocks_[head_];
+  cond_.wait(*lk, [&block] { return !block.pending; });
+  head_ = (head_ + 1) % depth_;
+  --queued_;
+}
+
+int64_t AsyncFileReader::Read(void* buf, size_t size) {
+  if (fd_ < 0) return -EBADF;
+  char* dst = static_cast<char*>(buf);
+  size_t copied = 0;
+  while (copied < size && pos_ < size_) {
+    std::vector<uint32_t> blocks;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      if (queued_ == 0) {
+        next_offset_ = pos_;
+      } else {
+        Block& block = blocks_[head_];
+        cond_.wait(lk, [&block] { return !block.pending; });
+        if (block.result < 0) return copied ? static_cast<int64_t>(copied) : block.result;
+        const int64_t end = block.offset + block.result;
+        if (pos_ < end) {
+          const size_t n = std::min<int64_t>(size - copied, end - pos_);
+          memcpy(dst + copied, block.data.get() + (pos_ - block.offset), n);
+          copied += n;
+          pos_ += n;
+        }
+        if (pos_ >= end) {
+          // a short block means the file is truncated after it is opened
+          if (end < std::min<int64_t>(block.offset + block_size_, size_)) size_ = end;
+          DropHead(&lk);
+        }
+      }
+      blocks = QueueBlocks();
+    }
+    SubmitBlocks(blocks);
+  }
+  return copied;
+}
+
+int64_t AsyncFileReader::Seek(int64_t offset) {
+  if (fd_ < 0) return -EBADF;
+  if (offset < 0) return -EINVAL;
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (queued_) {
+    if (offset < static_cast<int64_t>(blocks_[head_].offset) || offset >= static_cast<int64_t>(next_offset_)) {
+      while (queued_) DropHead(&lk);
+    } else {
+      while (offset >= static_cast<int64_t>(blocks_[head_].offset + block_size_)) DropHead(&lk);
+    }
+  }
+  pos_ = offset;
+  return pos_;
+}
+
+AsyncFileWriter::AsyncFileWriter(IoRing* ring, size_t buffer_size, uint32_t depth)
+    : ring_(ring ? ring : &IoRing::Instance()), buffer_size_(buffer_size) {
+  buffers_.resize(std::max(depth, 1u));
+}
+
+AsyncFileWriter::~AsyncFileWriter() { Close(); }
+
+bool AsyncFileWriter::Open(const std::string& path) {
+  Close();
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  if (!Open(fd)) {
+    close(fd);
+    return false;
+  }
+  own_fd_ = true;
+  return true;
+}
+
+bool AsyncFileWriter::Open(int fd) {
+  Close();
+  struct stat st;
+  const off_t offset = lseek(fd, 0, SEEK_CUR);
+  if (offset < 0 || fstat(fd, &st) != 0) return false;
+  fd_ = fd;
+  own_fd_ = false;
+  for (Buffer& buffer : buffers_) {
+    if (!buffer.data) buffer.data.reset(new char[buffer_size_]);
+  }
+  current_ = 0;
+  used_ = 0;
+  offset_ = offset;
+  end_ = st.st_size;
+  error_ = 0;
+  return true;
+}
+
+int AsyncFileWriter::Close() {
+  if (fd_ < 0) return 0;
+  int ret = Flush();
+  if (own_fd_ && close(fd_) != 0 && !ret) ret = -errno;
+  fd_ = -1;
+  return ret;
+}
+
+int64_t AsyncFileWriter::Write(const void* data, size_t size) {
+  if (fd_ < 0) return -EBADF;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (error_) return error_;
+  }
+  const char* src = static_cast<const char*>(data);
+  size_t left = size;
+  while (left) {
+    const size_t n = std::min(left, buffer_size_ - used_);
+    memcpy(buffers_[current_].data.get() + used_, src, n);
+    used_ += n;
+    src += n;
+    left -= n;
+    if (used_ == buffer_size_) SubmitBuffer();
+  }
+  return size;
+}
+
+void AsyncFileWriter::SubmitBuffer() {
+  if (!used_) return;
+  const uint32_t index = current_;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    buffers_[index].pending = true;
+  }
+  const size_t size = used_;
+  const int64_t offset = offset_;
+  end_ = std::max(end_, offset + static_cast<int64_t>(size));
+  offset_ += size;
+  used_ = 0;
+  current_ = (current_ + 1) % buffers_.size();
+  // not locked, the callback is called in place by a synchronous ring
+  ring_->Write(fd_, buffers_[index].data.get(), size, offset, [this, index](int64_t result) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    buffers_[index].pending = false;
+    if (result < 0 && !error_) error_ = static_cast<int>(result);
+    cond_.notify_all();
+  });
+  std::unique_lock<std::mutex> lk(mutex_);
+  cond_.wait(lk, [this] { return !buffers_[current_].pending; });
+}
+
+int AsyncFileWriter::WaitAll() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  cond_.wait(lk, [this] {
+    return std::none_of(buffers_.begin(), buffers_.end(), [](const Buffer& buffer) { return buffer.pending; });
+  });
+  return error_;
+}
+
+int AsyncFileWriter::Flush() {
+  if (fd_ < 0) return -EBADF;
+  SubmitBuffer();
+  return WaitAll();
+}
+
+int64_t AsyncFileWriter::Seek(int64_t offset) {
+  if (fd_ < 0) return -EBADF;
+  if (offset < 0) return -EINVAL;
+  if (offset == Tell()) return offset;
+  int ret = Flush();
+  if (ret) return ret;
+  offset_ = offset;
+  return offset_;
+}
+
+int64_t AsyncFileWriter::Size() const { return std::max(end_, Tell()); }
+
+}  // namespace cnstream
@@ -0,0 +1,157 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_autoscaler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+constexpr size_t Autoscaler::kMaxDecisionNum;
+
+Autoscaler::Autoscaler(const AutoscalerConfig& config) : config_(config) {}
+
+Autoscaler::~Autoscaler() {
+  Stop();
+}
+
+bool Autoscaler::Start(SampleFunc sample_func, ScaleFunc scale_func) {
+  if (running_.load()) return true;
+  if (!sample_func || !scale_func) {
+    LOGE(CORE) << "Autoscaler::Start() sample_func and scale_func must be set.";
+    return false;
+  }
+  sample_func_ = std::move(sample_func);
+  scale_func_ = std::move(scale_func);
+  idle_intervals_.clear();
+  cooldown_intervals_.clear();
+  running_.store(true);
+  thread_ = std::thread(&Autoscaler::Loop, this);
+  return true;
+}
+
+void Autoscaler::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(exit_mtx_);
+    if (!running_.load()) return;
+    running_.store(false);
+  }
+  exit_cond_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+bool Autoscaler::IsUnderPressure(const AutoscaleSample& sample) const {
+  return sample.blocking_upstream || sample.queue_fill_ratio >= config_.high_watermark;
+}
+
+bool Autoscaler::Decide(const std::vector<AutoscaleSample>& samples, AutoscaleDecision* decision) {
+  std::set<std::string> pressured;
+  for (const auto& sample : samples) {
+    if (IsUnderPressure(sample)) pressured.insert(sample.module_name);
+    uint32_t& cooldown = cooldown_intervals_[sample.module_name];
+    if (cooldown) cooldown--;
+    uint32_t& idle = idle_intervals_[sample.module_name];
+    if (!sample.blocking_upstream && sample.queue_fill_ratio <= config_.low_watermark) {
+      idle++;
+    } else {
+      idle = 0;
+    }
+  }
+
+  // scale up the bottleneck. The queues of the upstream modules of a bottleneck are full as well.
+  const AutoscaleSample* selected = nullptr;
+  for (const auto& sample : samples) {
+    if (!pressured.count(sample.module_name) || sample.parallelism >= sample.max_parallelism ||
+        cooldown_intervals_[sample.module_name]) {
+      continue;
+    }
+    bool blocked_by_downstream = std::any_of(sample.next_modules.begin(), sample.next_modules.end(),
+                                             [&](const std::string& next) { return pressured.count(next) > 0; });
+    if (blocked_by_downstream) continue;
+    if (!selected || sample.process_latency_ms > selected->process_latency_ms ||
+        (sample.process_latency_ms == selected->process_latency_ms &&
+         sample.queue_fill_ratio > selected->queue_fill_ratio)) {
+      selected = &sample;
+    }
+  }
+  std::ostringstream reason;
+  if (selected) {
+    decision->new_parallelism = selected->parallelism + 1;
+    reason << (selected->blocking_upstream ? "upstream blocked, " : "") << "input queues "
+           << static_cast<int>(selected->queue_fill_ratio * 100) << "% filled";
+  } else {
+    // scale down the most idle module
+    for (const auto& sample : samples) {
+      if (sample.parallelism <= sample.min_parallelism || cooldown_intervals_[sample.module_name] ||
+          idle_intervals_[sample.module_name] < std::max(config_.stable_intervals, 1u)) {
+        continue;
+      }
+      if (!selected || sample.queue_fill_ratio < selected->queue_fill_ratio) selected = &sample;
+    }
+    if (!selected) return false;
+    decision->new_parallelism = selected->parallelism - 1;
+    reason << "input queues " << static_cast<int>(selected->queue_fill_ratio * 100) << "% filled for "
+           << idle_intervals_[selected->module_name] << " samples";
+  }
+  decision->module_name = selected->module_name;
+  decision->old_parallelism = selected->parallelism;
+  decision->reason = reason.str();
+  decision->timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  idle_intervals_[selected->module_name] = 0;
+  cooldown_intervals_[selected->module_name] = config_.stable_intervals;
+  return true;
+}
+
+std::vector<AutoscaleDecision> Autoscaler::GetDecisions() const {
+  std::lock_guard<std::mutex> lk(decision_mtx_);
+  return std::vector<AutoscaleDecision>(decisions_.begin(), decisions_.end());
+}
+
+void Autoscaler::Loop() {
+  const std::chrono::milliseconds interval(config_.interval_ms);
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(exit_mtx_);
+      if (exit_cond_.wait_for(lk, interval, [this] { return !running_.load(); })) break;
+    }
+    AutoscaleDecision decision;
+    if (!Decide(sample_func_(), &decision)) continue;
+    if (!scale_func_(decision.module_name, decision.new_parallelism)) {
+      LOGW(CORE) << "[Autoscaler] Scale module [" << decision.module_name << "] from " << decision.old_parallelism
+                 << " to " << decision.new_parallelism << " failed.";
+      continue;
+    }
+    LOGI(CORE) << "[Autoscaler] Scale module [" << decision.module_name << "] from " << decision.old_parallelism
+               << " to " << decision.new_parallelism << " threads: " << decision.reason;
+    std::lock_guard<std::mutex> lk(decision_mtx_);
+    decisions_.push_back(decision);
+    if (decisions_.size() > kMaxDecisionNum) decisions_.pop_front();
+  }
+}
+
+}  // namespace cnstream
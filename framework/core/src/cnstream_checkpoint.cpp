@@ -0,0 +1,124 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_checkpoint.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+CheckpointStore::CheckpointStore(const std::string& path, uint32_t save_interval_ms)
+    : path_(path), save_interval_(save_interval_ms), last_save_(std::chrono::steady_clock::now()) {}
+
+bool CheckpointStore::Load() {
+  std::ifstream ifs(path_);
+  if (!ifs.is_open()) return true;  // nothing saved yet
+  std::map<std::string, StreamCheckpoint> checkpoints;
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (line.empty()) continue;
+    const size_t first_tab = line.find('\t');
+    const size_t last_tab = line.rfind('\t');
+    if (first_tab == std::string::npos || first_tab == last_tab) {
+      LOGE(CORE) << "[CheckpointStore] Malformed checkpoint [" << line << "] in " << path_;
+      return false;
+    }
+    StreamCheckpoint checkpoint;
+    checkpoint.source = line.substr(first_tab + 1, last_tab - first_tab - 1);
+    std::istringstream pts(line.substr(last_tab + 1));
+    if (!(pts >> checkpoint.pts)) {
+      LOGE(CORE) << "[CheckpointStore] Malformed checkpoint [" << line << "] in " << path_;
+      return false;
+    }
+    checkpoints[line.substr(0, first_tab)] = checkpoint;
+  }
+  std::lock_guard<std::mutex> lk(mtx_);
+  checkpoints_.swap(checkpoints);
+  LOGI(CORE) << "[CheckpointStore] Loaded " << checkpoints_.size() << " checkpoints from " << path_;
+  return true;
+}
+
+bool CheckpointStore::Save() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!dirty_) return true;
+  return SaveLocked();
+}
+
+bool CheckpointStore::SaveLocked() {
+  last_save_ = std::chrono::steady_clock::now();
+  dirty_ = false;
+  const std::string tmp_path = path_ + ".tmp";
+  {
+    std::ofstream ofs(tmp_path, std::ios::trunc);
+    for (const auto& it : checkpoints_) {
+      ofs << it.first << '\t' << it.second.source << '\t' << it.second.pts << '\n';
+    }
+    if (!ofs.good()) {
+      LOGE(CORE) << "[CheckpointStore] Failed to write " << tmp_path;
+      return false;
+    }
+  }
+  if (0 != std::rename(tmp_path.c_str(), path_.c_str())) {
+    LOGE(CORE) << "[CheckpointStore] Failed to rename " << tmp_path << " to " << path_;
+    return false;
+  }
+  return true;
+}
+
+int64_t CheckpointStore::Resume(const std::string& stream_id, const std::string& source) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  StreamCheckpoint& checkpoint = checkpoints_[stream_id];
+  if (checkpoint.source == source) return checkpoint.pts;
+  checkpoint.source = source;
+  checkpoint.pts = -1;
+  dirty_ = true;
+  return -1;
+}
+
+void CheckpointStore::Record(const std::string& stream_id, int64_t pts) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto iter = checkpoints_.find(stream_id);
+  if (iter == checkpoints_.end()) return;
+  iter->second.pts = pts;
+  dirty_ = true;
+  if (std::chrono::steady_clock::now() - last_save_ >= save_interval_) SaveLocked();
+}
+
+void CheckpointStore::Remove(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (checkpoints_.erase(stream_id)) dirty_ = true;
+}
+
+bool CheckpointStore::Get(const std::string& stream_id, StreamCheckpoint* checkpoint) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto iter = checkpoints_.find(stream_id);
+  if (iter == checkpoints_.end()) return false;
+  *checkpoint = iter->second;
+  return true;
+}
+
+}  // namespace cnstream
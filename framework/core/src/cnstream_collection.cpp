@@ -20,12 +20,75 @@
 
 #include "cnstream_collection.hpp"
 
+#include <string.h>
+
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
 namespace cnstream {
 
+// tags of the registered slots, they are written only by RegisterSlot.
+static std::mutex s_slot_register_mtx;
+static std::atomic<const char*> s_slot_tags[kCollectionSlotNum];
+static size_t s_slot_tag_lens[kCollectionSlotNum];
+
+bool Collection::RegisterSlot(const char* tag, uint32_t index) {
+  if (!tag || index >= kCollectionSlotNum) {
+    LOGE(COLLECTION) << "Register slot failed, invalid tag or slot index [" << index << "].";
+    return false;
+  }
+  std::lock_guard<std::mutex> lk(s_slot_register_mtx);
+  const char* registered_tag = s_slot_tags[index].load(std::memory_order_relaxed);
+  if (registered_tag) {
+    if (0 == strcmp(registered_tag, tag)) return true;
+    LOGE(COLLECTION) << "Register slot failed, slot [" << index << "] has been registered with tag ["
+                     << registered_tag << "], current tag is [" << tag << "].";
+    return false;
+  }
+  const int slot_idx = FindSlot(tag);
+  if (slot_idx >= 0) {
+    LOGE(COLLECTION) << "Register slot failed, tag [" << tag << "] has been registered with slot [" << slot_idx << "].";
+    return false;
+  }
+  s_slot_tag_lens[index] = strlen(tag);
+  s_slot_tags[index].store(tag, std::memory_order_release);
+  return true;
+}
+
+int Collection::FindSlot(const std::string& tag) {
+  for (uint32_t i = 0; i < kCollectionSlotNum; ++i) {
+    const char* slot_tag = s_slot_tags[i].load(std::memory_order_acquire);
+    if (slot_tag && s_slot_tag_lens[i] == tag.size() && 0 == memcmp(slot_tag, tag.data(), tag.size())) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void Collection::CheckSlotIndex(uint32_t index, const char* tag) {
+  if (index >= kCollectionSlotNum) {
+    LOGF(COLLECTION) << "The slot index [" << index << "] of tag [" << tag << "] is out of range.";
+  }
+}
+
+bool Collection::AddToSlot(uint32_t index, const char* tag, cnstream::any&& value, bool crash_if_exists) {
+  Slot& slot = slots_[index];
+  int expected = kSlotEmpty;
+  if (!slot.state.compare_exchange_strong(expected, kSlotWriting, std::memory_order_acquire)) {
+    if (crash_if_exists) {
+      LOGF(COLLECTION) << "Data tagged by [" << tag << "] had been added.";
+    }
+    LOGD(COLLECTION) << "Data tagged by [" << tag << "] had been added. Current data will not be added.";
+    return false;
+  }
+  slot.value = std::move(value);
+  slot.state.store(kSlotReady, std::memory_order_release);
+  return true;
+}
+
 void Collection::Add(const std::string& tag, std::unique_ptr<cnstream::any>&& value) {
   std::lock_guard<std::mutex> lk(data_mtx_);
   if (data_.end() != data_.find(tag)) {
@@ -51,12 +114,40 @@ bool Collection::AddIfNotExists(const std::string& tag, std::unique_ptr<cnstream
 }
 
 bool Collection::HasValue(const std::string& tag) {
+  const int slot_idx = FindSlot(tag);
+  if (slot_idx >= 0) return kSlotReady == slots_[slot_idx].state.load(std::memory_order_acquire);
   std::lock_guard<std::mutex> lk(data_mtx_);
   return data_.end() != data_.find(tag);
 }
 
+void Collection::RetainIf(const std::function<bool(const std::string& tag, cnstream::any* value)>& keep) {
+  for (uint32_t i = 0; i < kCollectionSlotNum; ++i) {
+    Slot& slot = slots_[i];
+    if (kSlotReady != slot.state.load(std::memory_order_acquire)) continue;
+    const char* slot_tag = s_slot_tags[i].load(std::memory_order_acquire);
+    if (keep && slot_tag && keep(slot_tag, &slot.value)) continue;
+    slot.value.reset();
+    slot.state.store(kSlotEmpty, std::memory_order_release);
+  }
+  std::lock_guard<std::mutex> lk(data_mtx_);
+  for (auto iter = data_.begin(); iter != data_.end();) {
+    if (keep && keep(iter->first, iter->second.get())) {
+      ++iter;
+    } else {
+      iter = data_.erase(iter);
+    }
+  }
+}
+
 #if !defined(_LIBCPP_NO_RTTI)
 const std::type_info& Collection::Type(const std::string& tag) {
+  const int slot_idx = FindSlot(tag);
+  if (slot_idx >= 0) {
+    if (kSlotReady != slots_[slot_idx].state.load(std::memory_order_acquire)) {
+      LOGF(COLLECTION) << "No data tagged by [" << tag << "] was been added.";
+    }
+    return slots_[slot_idx].value.type();
+  }
   std::lock_guard<std::mutex> lk(data_mtx_);
   auto iter = data_.find(tag);
   if (data_.end() == iter) {
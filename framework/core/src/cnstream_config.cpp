@@ -30,12 +30,14 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "cnstream_config.hpp"
+#include "private/cnstream_affinity.hpp"
 
 namespace cnstream {
 
@@ -44,6 +46,51 @@ bool IsProfilerItem(const std::string& item_name) {
   return kProfilerConfigName == item_name;
 }
 
+static inline
+bool IsSchedulerItem(const std::string& item_name) {
+  return kSchedulerConfigName == item_name;
+}
+
+static inline
+bool IsFramePoolItem(const std::string& item_name) {
+  return kFramePoolConfigName == item_name;
+}
+
+static inline
+bool IsAutoscalerItem(const std::string& item_name) {
+  return kAutoscalerConfigName == item_name;
+}
+
+static inline
+bool IsMemoryBudgetItem(const std::string& item_name) {
+  return kMemoryBudgetConfigName == item_name;
+}
+
+static inline
+bool IsMetricsItem(const std::string& item_name) {
+  return kMetricsConfigName == item_name;
+}
+
+static inline
+bool IsAdmissionItem(const std::string& item_name) {
+  return kAdmissionConfigName == item_name;
+}
+
+static inline
+bool IsCheckpointItem(const std::string& item_name) {
+  return kCheckpointConfigName == item_name;
+}
+
+static inline
+bool IsDegradationItem(const std::string& item_name) {
+  return kDegradationConfigName == item_name;
+}
+
+static inline
+bool IsCpuIsolationItem(const std::string& item_name) {
+  return kCpuIsolationConfigName == item_name;
+}
+
 static inline
 std::string GetPathDir(const std::string& path) {
   auto slash_pos = path.rfind("/");
@@ -89,10 +136,65 @@ bool ProfilerConfig::ParseByJSONStr(const std::string& jstr) {
         return false;
       }
     } else if ("trace_event_capacity" == iter->name) {
-      if (iter->value.IsUint64()) {
+      if (iter->value.IsUint64() && iter->value.GetUint64() > 0) {
         this->trace_event_capacity = iter->value.GetUint64();
       } else {
-        LOGE(CORE) << "trace_event_capacity must be uint64 type.";
+        LOGE(CORE) << "trace_event_capacity must be positive uint64 type.";
+        return false;
+      }
+    } else if ("enable_latency_breakdown" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable_latency_breakdown = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable_latency_breakdown must be boolean type.";
+        return false;
+      }
+    } else if ("enable_perf_counters" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable_perf_counters = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable_perf_counters must be boolean type.";
+        return false;
+      }
+    } else if ("trace_file" == iter->name) {
+      if (iter->value.IsString()) {
+        this->trace_file = iter->value.GetString();
+      } else {
+        LOGE(CORE) << "trace_file must be string type.";
+        return false;
+      }
+    } else if ("trace_sample_interval" == iter->name) {
+      if (iter->value.IsUint()) {
+        this->trace_sample_interval = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "trace_sample_interval must be uint32 type.";
+        return false;
+      }
+    } else if ("trace_streams" == iter->name) {
+      if (!iter->value.IsArray()) {
+        LOGE(CORE) << "trace_streams must be array type.";
+        return false;
+      }
+      this->trace_streams.clear();
+      for (const auto& stream : iter->value.GetArray()) {
+        if (!stream.IsString()) {
+          LOGE(CORE) << "trace_streams must be an array of strings.";
+          return false;
+        }
+        this->trace_streams.push_back(stream.GetString());
+      }
+    } else if ("trace_latency_threshold" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() >= 0) {
+        this->trace_latency_threshold = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "trace_latency_threshold must be non-negative number type.";
+        return false;
+      }
+    } else if ("trace_burst_duration" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() > 0) {
+        this->trace_burst_duration = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "trace_burst_duration must be positive number type.";
         return false;
       }
     } else {
@@ -104,6 +206,562 @@ bool ProfilerConfig::ParseByJSONStr(const std::string& jstr) {
   return true;
 }
 
+bool SchedulerConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse scheduler configuration failed. Error code [" << std::to_string(doc.GetParseError()) << "]"
+               << " Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    if ("work_stealing" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->work_stealing = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "work_stealing must be boolean type.";
+        return false;
+      }
+    } else if ("thread_num" == iter->name) {
+      if (iter->value.IsUint()) {
+        this->thread_num = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "thread_num must be uint type.";
+        return false;
+      }
+    } else if ("parallel_open" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->parallel_open = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "parallel_open must be boolean type.";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for scheduler_config.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool FramePoolConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse frame pool configuration failed. Error code [" << std::to_string(doc.GetParseError()) << "]"
+               << " Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    if ("enable" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable must be boolean type.";
+        return false;
+      }
+    } else if ("capacity" == iter->name) {
+      if (iter->value.IsUint()) {
+        this->capacity = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "capacity must be uint type.";
+        return false;
+      }
+    } else if ("max_frames" == iter->name) {
+      if (iter->value.IsUint()) {
+        this->max_frames = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "max_frames must be uint type.";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for frame_pool_config.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool AutoscalerConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse autoscaler configuration failed. Error code [" << std::to_string(doc.GetParseError()) << "]"
+               << " Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    if ("enable" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable must be boolean type.";
+        return false;
+      }
+    } else if ("interval_ms" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() > 0) {
+        this->interval_ms = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "interval_ms must be uint type and greater than 0.";
+        return false;
+      }
+    } else if ("high_watermark" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() > 0 && iter->value.GetDouble() <= 1) {
+        this->high_watermark = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "high_watermark must be a number in (0, 1].";
+        return false;
+      }
+    } else if ("low_watermark" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() >= 0 && iter->value.GetDouble() < 1) {
+        this->low_watermark = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "low_watermark must be a number in [0, 1).";
+        return false;
+      }
+    } else if ("stable_intervals" == iter->name) {
+      if (iter->value.IsUint()) {
+        this->stable_intervals = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "stable_intervals must be uint type.";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for autoscaler_config.";
+      return false;
+    }
+  }
+
+  if (this->low_watermark >= this->high_watermark) {
+    LOGE(CORE) << "low_watermark must be less than high_watermark.";
+    return false;
+  }
+  return true;
+}
+
+bool MemoryBudgetConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse memory budget configuration failed. Error code [" << std::to_string(doc.GetParseError())
+               << "] Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  const std::map<std::string, uint32_t*> uint_items = {
+    {"host_mb", &this->host_mb},
+    {"device_mb", &this->device_mb},
+    {"stream_host_mb", &this->stream_host_mb},
+    {"stream_device_mb", &this->stream_device_mb},
+    {"max_wait_ms", &this->max_wait_ms}
+  };
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    const std::string name = iter->name.GetString();
+    auto uint_item = uint_items.find(name);
+    if ("enable" == name) {
+      if (iter->value.IsBool()) {
+        this->enable = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable must be boolean type.";
+        return false;
+      }
+    } else if (uint_item != uint_items.end()) {
+      if (iter->value.IsUint()) {
+        *uint_item->second = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << name << " must be uint type.";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << name << "] for memory_budget_config.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool MetricsConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse metrics configuration failed. Error code [" << std::to_string(doc.GetParseError()) << "]"
+               << " Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    if ("enable" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable must be boolean type.";
+        return false;
+      }
+    } else if ("port" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() <= 65535) {
+        this->port = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "port must be uint type and not greater than 65535.";
+        return false;
+      }
+    } else if ("path" == iter->name) {
+      if (iter->value.IsString() && iter->value.GetString()[0] == '/') {
+        this->path = iter->value.GetString();
+      } else {
+        LOGE(CORE) << "path must be a string starting with '/'.";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for metrics_config.";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool AdmissionConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse admission configuration failed. Error code [" << std::to_string(doc.GetParseError()) << "]"
+               << " Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    if ("enable" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable must be boolean type.";
+        return false;
+      }
+    } else if ("interval_ms" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() > 0) {
+        this->interval_ms = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "interval_ms must be uint type and greater than 0.";
+        return false;
+      }
+    } else if ("high_watermark" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() > 0 && iter->value.GetDouble() <= 1) {
+        this->high_watermark = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "high_watermark must be a number in (0, 1].";
+        return false;
+      }
+    } else if ("decrease_ratio" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() > 0 && iter->value.GetDouble() <= 1) {
+        this->decrease_ratio = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "decrease_ratio must be a number in (0, 1].";
+        return false;
+      }
+    } else if ("increase_ratio" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() > 1) {
+        this->increase_ratio = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "increase_ratio must be a number greater than 1.";
+        return false;
+      }
+    } else if ("min_fps" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() >= 0) {
+        this->min_fps = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "min_fps must be a number not less than 0.";
+        return false;
+      }
+    } else if ("burst_ms" == iter->name) {
+      if (iter->value.IsUint()) {
+        this->burst_ms = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "burst_ms must be uint type.";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for admission_config.";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CheckpointConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse checkpoint configuration failed. Error code [" << std::to_string(doc.GetParseError()) << "]"
+               << " Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    if ("enable" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable must be boolean type.";
+        return false;
+      }
+    } else if ("path" == iter->name) {
+      if (iter->value.IsString()) {
+        this->path = iter->value.GetString();
+      } else {
+        LOGE(CORE) << "path must be string type.";
+        return false;
+      }
+    } else if ("save_interval_ms" == iter->name) {
+      if (iter->value.IsUint()) {
+        this->save_interval_ms = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "save_interval_ms must be uint type.";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for checkpoint_config.";
+      return false;
+    }
+  }
+  if (this->enable && this->path.empty()) {
+    LOGE(CORE) << "path must be set when checkpoints are enabled.";
+    return false;
+  }
+  return true;
+}
+
+static bool ParseDegradationStep(const rapidjson::Value& value, DegradationStep* step) {
+  if (!value.IsObject()) {
+    LOGE(CORE) << "A degradation step must be an object.";
+    return false;
+  }
+  bool has_action = false;
+  for (rapidjson::Value::ConstMemberIterator iter = value.MemberBegin(); iter != value.MemberEnd(); ++iter) {
+    if ("action" == iter->name) {
+      const std::string action = iter->value.IsString() ? iter->value.GetString() : "";
+      if ("skip_frames" == action) {
+        step->action = DegradationAction::SKIP_FRAMES;
+      } else if ("bypass" == action) {
+        step->action = DegradationAction::BYPASS;
+      } else if ("scale_output" == action) {
+        step->action = DegradationAction::SCALE_OUTPUT;
+      } else {
+        LOGE(CORE) << "action must be skip_frames, bypass or scale_output.";
+        return false;
+      }
+      has_action = true;
+    } else if ("modules" == iter->name) {
+      if (!iter->value.IsArray()) {
+        LOGE(CORE) << "modules must be an array of module names.";
+        return false;
+      }
+      step->modules.clear();
+      for (const auto& module : iter->value.GetArray()) {
+        if (!module.IsString()) {
+          LOGE(CORE) << "modules must be an array of module names.";
+          return false;
+        }
+        step->modules.push_back(module.GetString());
+      }
+    } else if ("interval" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() > 1) {
+        step->interval = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "interval must be uint type and greater than 1.";
+        return false;
+      }
+    } else if ("max_priority" == iter->name) {
+      if (iter->value.IsInt()) {
+        step->max_priority = iter->value.GetInt();
+      } else {
+        LOGE(CORE) << "max_priority must be int type.";
+        return false;
+      }
+    } else if ("scale" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() > 0 && iter->value.GetDouble() < 1) {
+        step->scale = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "scale must be a number in (0, 1).";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for a degradation step.";
+      return false;
+    }
+  }
+  if (!has_action || step->modules.empty()) {
+    LOGE(CORE) << "action and modules must be set for a degradation step.";
+    return false;
+  }
+  return true;
+}
+
+bool DegradationConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse degradation configuration failed. Error code [" << std::to_string(doc.GetParseError())
+               << "] Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    if ("enable" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable must be boolean type.";
+        return false;
+      }
+    } else if ("interval_ms" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() > 0) {
+        this->interval_ms = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "interval_ms must be uint type and greater than 0.";
+        return false;
+      }
+    } else if ("high_watermark" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() > 0 && iter->value.GetDouble() <= 1) {
+        this->high_watermark = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "high_watermark must be a number in (0, 1].";
+        return false;
+      }
+    } else if ("low_watermark" == iter->name) {
+      if (iter->value.IsNumber() && iter->value.GetDouble() >= 0 && iter->value.GetDouble() < 1) {
+        this->low_watermark = iter->value.GetDouble();
+      } else {
+        LOGE(CORE) << "low_watermark must be a number in [0, 1).";
+        return false;
+      }
+    } else if ("escalate_samples" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() > 0) {
+        this->escalate_samples = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "escalate_samples must be uint type and greater than 0.";
+        return false;
+      }
+    } else if ("recover_samples" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() > 0) {
+        this->recover_samples = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "recover_samples must be uint type and greater than 0.";
+        return false;
+      }
+    } else if ("steps" == iter->name) {
+      if (!iter->value.IsArray()) {
+        LOGE(CORE) << "steps must be an array.";
+        return false;
+      }
+      this->steps.clear();
+      for (const auto& value : iter->value.GetArray()) {
+        DegradationStep step;
+        if (!ParseDegradationStep(value, &step)) return false;
+        this->steps.push_back(std::move(step));
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for degradation_config.";
+      return false;
+    }
+  }
+  if (this->low_watermark >= this->high_watermark) {
+    LOGE(CORE) << "low_watermark must be less than high_watermark.";
+    return false;
+  }
+  return true;
+}
+
+bool CpuIsolationConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse cpu isolation configuration failed. Error code [" << std::to_string(doc.GetParseError())
+               << "] Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    if ("enable" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable must be boolean type.";
+        return false;
+      }
+    } else if ("nice" == iter->name) {
+      if (iter->value.IsInt() && iter->value.GetInt() >= -20 && iter->value.GetInt() <= 19) {
+        this->nice = iter->value.GetInt();
+      } else {
+        LOGE(CORE) << "nice must be an integer in [-20, 19].";
+        return false;
+      }
+    } else if ("cgroup" == iter->name) {
+      if (iter->value.IsString()) {
+        this->cgroup = iter->value.GetString();
+      } else {
+        LOGE(CORE) << "cgroup must be string type.";
+        return false;
+      }
+    } else if ("cpu_weight" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() <= 10000) {
+        this->cpu_weight = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "cpu_weight must be uint type and not greater than 10000.";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for cpu_isolation_config.";
+      return false;
+    }
+  }
+  if (this->cpu_weight && this->cgroup.empty()) {
+    LOGE(CORE) << "cpu_weight is set, but cgroup is not set.";
+    return false;
+  }
+  return true;
+}
+
+bool CircuitBreakerConfig::ParseByJSONStr(const std::string& jstr) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
+    LOGE(CORE) << "Parse circuit breaker configuration failed. Error code [" << std::to_string(doc.GetParseError())
+               << "] Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << jstr;
+    return false;
+  }
+
+  for (rapidjson::Document::ConstMemberIterator iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+    if ("enable" == iter->name) {
+      if (iter->value.IsBool()) {
+        this->enable = iter->value.GetBool();
+      } else {
+        LOGE(CORE) << "enable must be boolean type.";
+        return false;
+      }
+    } else if ("failure_threshold" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() > 0) {
+        this->failure_threshold = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "failure_threshold must be uint type and greater than 0.";
+        return false;
+      }
+    } else if ("max_latency_ms" == iter->name) {
+      if (iter->value.IsUint()) {
+        this->max_latency_ms = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "max_latency_ms must be uint type.";
+        return false;
+      }
+    } else if ("open_ms" == iter->name) {
+      if (iter->value.IsUint() && iter->value.GetUint() > 0) {
+        this->open_ms = iter->value.GetUint();
+      } else {
+        LOGE(CORE) << "open_ms must be uint type and greater than 0.";
+        return false;
+      }
+    } else {
+      LOGE(CORE) << "Unknown parameter named [" << iter->name.GetString() << "] for circuit_breaker.";
+      return false;
+    }
+  }
+  return true;
+}
+
 bool CNModuleConfig::ParseByJSONStr(const std::string& jstr) {
   rapidjson::Document doc;
   if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError()) {
@@ -149,6 +807,195 @@ bool CNModuleConfig::ParseByJSONStr(const std::string& jstr) {
     this->maxInputQueueSize = 20;
   }
 
+  // queueType
+  if (end != doc.FindMember("queue_type")) {
+    if (!doc["queue_type"].IsString()) {
+      LOGE(CORE) << "queue_type must be string type.";
+      return false;
+    }
+    const std::string queue_type = doc["queue_type"].GetString();
+    if (queue_type == "mutex") {
+      this->queueType = InputQueueType::MUTEX;
+    } else if (queue_type == "lock_free") {
+      this->queueType = InputQueueType::LOCK_FREE;
+    } else {
+      LOGE(CORE) << "queue_type must be \"mutex\" or \"lock_free\", but got \"" << queue_type << "\".";
+      return false;
+    }
+  } else {
+    this->queueType = InputQueueType::MUTEX;
+  }
+
+  // queueFullPolicy
+  if (end != doc.FindMember("queue_full_policy")) {
+    if (!doc["queue_full_policy"].IsString()) {
+      LOGE(CORE) << "queue_full_policy must be string type.";
+      return false;
+    }
+    const std::string policy = doc["queue_full_policy"].GetString();
+    if (policy == "block") {
+      this->queueFullPolicy = QueueFullPolicy::BLOCK;
+    } else if (policy == "drop_oldest") {
+      this->queueFullPolicy = QueueFullPolicy::DROP_OLDEST;
+    } else if (policy == "drop_newest") {
+      this->queueFullPolicy = QueueFullPolicy::DROP_NEWEST;
+    } else {
+      LOGE(CORE) << "queue_full_policy must be \"block\", \"drop_oldest\" or \"drop_newest\", but got \""
+                 << policy << "\".";
+      return false;
+    }
+  } else {
+    this->queueFullPolicy = QueueFullPolicy::BLOCK;
+  }
+
+  // rebalanceStreams
+  if (end != doc.FindMember("rebalance_streams")) {
+    if (!doc["rebalance_streams"].IsBool()) {
+      LOGE(CORE) << "rebalance_streams must be boolean type.";
+      return false;
+    }
+    this->rebalanceStreams = doc["rebalance_streams"].GetBool();
+  } else {
+    this->rebalanceStreams = false;
+  }
+
+  // streamParallel
+  if (end != doc.FindMember("stream_parallel")) {
+    if (!doc["stream_parallel"].IsBool()) {
+      LOGE(CORE) << "stream_parallel must be boolean type.";
+      return false;
+    }
+    this->streamParallel = doc["stream_parallel"].GetBool();
+  } else {
+    this->streamParallel = false;
+  }
+
+  // orderedOutput
+  if (end != doc.FindMember("ordered_output")) {
+    if (!doc["ordered_output"].IsBool()) {
+      LOGE(CORE) << "ordered_output must be boolean type.";
+      return false;
+    }
+    this->orderedOutput = doc["ordered_output"].GetBool();
+  } else {
+    this->orderedOutput = true;
+  }
+
+  // maxBatchSize
+  if (end != doc.FindMember("max_batch_size")) {
+    if (!doc["max_batch_size"].IsUint() || doc["max_batch_size"].GetUint() == 0) {
+      LOGE(CORE) << "max_batch_size must be uint type and greater than 0.";
+      return false;
+    }
+    this->maxBatchSize = doc["max_batch_size"].GetUint();
+  } else {
+    this->maxBatchSize = 1;
+  }
+
+  // batchTimeoutUs
+  if (end != doc.FindMember("batch_timeout_us")) {
+    if (!doc["batch_timeout_us"].IsUint()) {
+      LOGE(CORE) << "batch_timeout_us must be uint type.";
+      return false;
+    }
+    this->batchTimeoutUs = doc["batch_timeout_us"].GetUint();
+  } else {
+    this->batchTimeoutUs = 0;
+  }
+
+  // cpuAffinity
+  this->cpuAffinity.clear();
+  if (end != doc.FindMember("cpu_affinity")) {
+    if (doc["cpu_affinity"].IsString()) {
+      if (!ParseCpuList(doc["cpu_affinity"].GetString(), &this->cpuAffinity)) {
+        LOGE(CORE) << "cpu_affinity must be a cpu list, e.g. \"0-3,8\".";
+        return false;
+      }
+    } else if (doc["cpu_affinity"].IsArray()) {
+      auto values = doc["cpu_affinity"].GetArray();
+      for (auto iter = values.begin(); iter != values.end(); ++iter) {
+        if (!iter->IsUint()) {
+          LOGE(CORE) << "cpu_affinity must be an array of uint.";
+          return false;
+        }
+        this->cpuAffinity.push_back(iter->GetUint());
+      }
+    } else {
+      LOGE(CORE) << "cpu_affinity must be string or array type.";
+      return false;
+    }
+  }
+
+  // numaNode
+  if (end != doc.FindMember("numa_node")) {
+    if (!doc["numa_node"].IsInt() || doc["numa_node"].GetInt() < -1) {
+      LOGE(CORE) << "numa_node must be an int not less than -1.";
+      return false;
+    }
+    this->numaNode = doc["numa_node"].GetInt();
+  } else {
+    this->numaNode = -1;
+  }
+
+  // minParallelism
+  if (end != doc.FindMember("min_parallelism")) {
+    if (!doc["min_parallelism"].IsUint()) {
+      LOGE(CORE) << "min_parallelism must be uint type.";
+      return false;
+    }
+    this->minParallelism = doc["min_parallelism"].GetUint();
+  } else {
+    this->minParallelism = 0;
+  }
+
+  // maxParallelism
+  if (end != doc.FindMember("max_parallelism")) {
+    if (!doc["max_parallelism"].IsUint()) {
+      LOGE(CORE) << "max_parallelism must be uint type.";
+      return false;
+    }
+    this->maxParallelism = doc["max_parallelism"].GetUint();
+  } else {
+    this->maxParallelism = 0;
+  }
+
+  // fusePolicy
+  if (end != doc.FindMember("fuse")) {
+    if (!doc["fuse"].IsString()) {
+      LOGE(CORE) << "fuse must be string type.";
+      return false;
+    }
+    const std::string policy = doc["fuse"].GetString();
+    if (policy == "auto") {
+      this->fusePolicy = FusePolicy::AUTO;
+    } else if (policy == "always") {
+      this->fusePolicy = FusePolicy::ALWAYS;
+    } else if (policy == "never") {
+      this->fusePolicy = FusePolicy::NEVER;
+    } else {
+      LOGE(CORE) << "fuse must be \"auto\", \"always\" or \"never\", but got \"" << policy << "\".";
+      return false;
+    }
+  } else {
+    this->fusePolicy = FusePolicy::AUTO;
+  }
+
+  // circuitBreaker
+  this->circuitBreaker = CircuitBreakerConfig();
+  if (end != doc.FindMember("circuit_breaker")) {
+    if (!doc["circuit_breaker"].IsObject()) {
+      LOGE(CORE) << "circuit_breaker must be an object.";
+      return false;
+    }
+    rapidjson::StringBuffer sbuf;
+    rapidjson::Writer<rapidjson::StringBuffer> jwriter(sbuf);
+    doc["circuit_breaker"].Accept(jwriter);
+    if (!this->circuitBreaker.ParseByJSONStr(sbuf.GetString())) {
+      LOGE(CORE) << "Parse circuit_breaker failed.";
+      return false;
+    }
+  }
+
   // next
   if (end != doc.FindMember("next_modules")) {
     if (!doc["next_modules"].IsArray()) {
@@ -167,6 +1014,23 @@ bool CNModuleConfig::ParseByJSONStr(const std::string& jstr) {
     this->next = {};
   }
 
+  // openAfter
+  this->openAfter.clear();
+  if (end != doc.FindMember("open_after")) {
+    if (!doc["open_after"].IsArray()) {
+      LOGE(CORE) << "open_after must be array type.";
+      return false;
+    }
+    auto values = doc["open_after"].GetArray();
+    for (auto iter = values.begin(); iter != values.end(); ++iter) {
+      if (!iter->IsString()) {
+        LOGE(CORE) << "open_after must be an array of strings.";
+        return false;
+      }
+      this->openAfter.insert(iter->GetString());
+    }
+  }
+
   // custom parameters
   if (end != doc.FindMember("custom_params")) {
     rapidjson::Value& custom_params = doc["custom_params"];
@@ -268,6 +1132,60 @@ bool CNGraphConfig::ParseByJSONStr(const std::string& json_str) {
         LOGE(CORE) << "Parse profiler config failed.";
         return false;
       }
+    } else if (IsSchedulerItem(item_name)) {
+      // parse if scheduler config
+      if (!scheduler_config.ParseByJSONStr(item_value)) {
+        LOGE(CORE) << "Parse scheduler config failed.";
+        return false;
+      }
+    } else if (IsFramePoolItem(item_name)) {
+      // parse if frame pool config
+      if (!frame_pool_config.ParseByJSONStr(item_value)) {
+        LOGE(CORE) << "Parse frame pool config failed.";
+        return false;
+      }
+    } else if (IsAutoscalerItem(item_name)) {
+      // parse if autoscaler config
+      if (!autoscaler_config.ParseByJSONStr(item_value)) {
+        LOGE(CORE) << "Parse autoscaler config failed.";
+        return false;
+      }
+    } else if (IsMemoryBudgetItem(item_name)) {
+      // parse if memory budget config
+      if (!memory_budget_config.ParseByJSONStr(item_value)) {
+        LOGE(CORE) << "Parse memory budget config failed.";
+        return false;
+      }
+    } else if (IsMetricsItem(item_name)) {
+      // parse if metrics config
+      if (!metrics_config.ParseByJSONStr(item_value)) {
+        LOGE(CORE) << "Parse metrics config failed.";
+        return false;
+      }
+    } else if (IsAdmissionItem(item_name)) {
+      // parse if admission config
+      if (!admission_config.ParseByJSONStr(item_value)) {
+        LOGE(CORE) << "Parse admission config failed.";
+        return false;
+      }
+    } else if (IsCheckpointItem(item_name)) {
+      // parse if checkpoint config
+      if (!checkpoint_config.ParseByJSONStr(item_value)) {
+        LOGE(CORE) << "Parse checkpoint config failed.";
+        return false;
+      }
+    } else if (IsDegradationItem(item_name)) {
+      // parse if degradation config
+      if (!degradation_config.ParseByJSONStr(item_value)) {
+        LOGE(CORE) << "Parse degradation config failed.";
+        return false;
+      }
+    } else if (IsCpuIsolationItem(item_name)) {
+      // parse if cpu isolation config
+      if (!cpu_isolation_config.ParseByJSONStr(item_value)) {
+        LOGE(CORE) << "Parse cpu isolation config failed.";
+        return false;
+      }
     } else if (IsSubgraphItem(item_name)) {
       // parse if subgraph config
       CNSubgraphConfig subgraph_config;
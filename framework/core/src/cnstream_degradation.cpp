@@ -0,0 +1,123 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_degradation.hpp"
+
+#include <chrono>
+#include <string>
+#include <utility>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+DegradationController::DegradationController(const DegradationConfig& config, ApplyFunc apply_func)
+    : config_(config), apply_func_(std::move(apply_func)) {}
+
+DegradationController::~DegradationController() {
+  Stop();
+}
+
+bool DegradationController::Start(SampleFunc sample_func) {
+  if (running_.load()) return true;
+  if (!sample_func) {
+    LOGE(CORE) << "DegradationController::Start() sample_func must be set.";
+    return false;
+  }
+  sample_func_ = std::move(sample_func);
+  running_.store(true);
+  thread_ = std::thread(&DegradationController::Loop, this);
+  return true;
+}
+
+void DegradationController::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(exit_mtx_);
+    running_.store(false);
+  }
+  exit_cond_.notify_all();
+  if (thread_.joinable()) thread_.join();
+  SetLevel(0);
+}
+
+void DegradationController::Step(bool apply) {
+  const uint32_t level = level_.load();
+  const uint32_t new_level = apply ? level + 1 : level - 1;
+  const DegradationStep& step = config_.steps[apply ? level : new_level];
+  if (apply_func_) apply_func_(new_level, step, apply);
+  level_.store(new_level);
+  overloaded_samples_ = relieved_samples_ = 0;
+}
+
+void DegradationController::Update(const DegradationSample& sample) {
+  std::lock_guard<std::mutex> lk(level_mtx_);
+  // the queues keep growing before they are full
+  const bool growing = sample.queue_fill_ratio > last_fill_ratio_ && sample.queue_fill_ratio > config_.low_watermark;
+  last_fill_ratio_ = sample.queue_fill_ratio;
+  const bool overloaded = sample.blocking_upstream || sample.queue_fill_ratio >= config_.high_watermark || growing;
+  const bool relieved = !sample.blocking_upstream && sample.queue_fill_ratio <= config_.low_watermark;
+  overloaded_samples_ = overloaded ? overloaded_samples_ + 1 : 0;
+  relieved_samples_ = relieved ? relieved_samples_ + 1 : 0;
+  if (overloaded_samples_ >= config_.escalate_samples && level_.load() < config_.steps.size()) {
+    Step(true);
+  } else if (relieved_samples_ >= config_.recover_samples && level_.load() > 0) {
+    Step(false);
+  }
+}
+
+void DegradationController::SetLevel(uint32_t level) {
+  std::lock_guard<std::mutex> lk(level_mtx_);
+  if (level > config_.steps.size()) level = config_.steps.size();
+  while (level_.load() < level) Step(true);
+  while (level_.load() > level) Step(false);
+}
+
+void DegradationController::SetStreamPriority(const std::string& stream_id, int priority) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  streams_[stream_id].priority = priority;
+}
+
+void DegradationController::RemoveStream(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  streams_.erase(stream_id);
+}
+
+bool DegradationController::Bypass(const std::string& stream_id, uint32_t module_id, uint32_t interval,
+                                   int max_priority) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  StreamState& stream = streams_[stream_id];
+  if (stream.priority > max_priority) return false;
+  if (interval == 0) return true;
+  // the first frame of every interval is processed
+  return stream.frames[module_id]++ % interval != 0;
+}
+
+void DegradationController::Loop() {
+  const std::chrono::milliseconds interval(config_.interval_ms);
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(exit_mtx_);
+      if (exit_cond_.wait_for(lk, interval, [this] { return !running_.load(); })) break;
+    }
+    Update(sample_func_());
+  }
+}
+
+}  // namespace cnstream
@@ -20,10 +20,12 @@
 
 #include "cnstream_eventbus.hpp"
 
+#include <algorithm>
 #include <list>
 #include <memory>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "cnstream_pipeline.hpp"
 
@@ -59,6 +61,17 @@ uint32_t EventBus::AddBusWatch(BusWatcher func) {
   return bus_watchers_.size();
 }
 
+uint32_t EventBus::AddBusWatch(BusWatcher func, const EventFilter &filter) {
+  return AddBusWatch([func, filter](const Event &event) {
+    if (!filter.types.empty() &&
+        std::find(filter.types.begin(), filter.types.end(), event.type) == filter.types.end()) {
+      return EventHandleFlag::EVENT_HANDLE_NULL;
+    }
+    if (!filter.stream_id.empty() && filter.stream_id != event.stream_id) return EventHandleFlag::EVENT_HANDLE_NULL;
+    return func(event);
+  });
+}
+
 void EventBus::ClearAllWatchers() {
   std::lock_guard<std::mutex> lk(watcher_mtx_);
   bus_watchers_.clear();
@@ -75,13 +88,13 @@ bool EventBus::PostEvent(Event event) {
     return false;
   }
   // LOGI(CORE) << "Receieve event from [" << event.module->GetName() << "] :" << event.message;
-  queue_.Push(event);
 #ifdef UNIT_TEST
   if (unit_test) {
     test_eventq_.Push(event);
     unit_test = false;
   }
 #endif
+  queue_.Push(std::move(event));
   return true;
 }
 
@@ -89,20 +102,68 @@ Event EventBus::PollEvent() {
   Event event;
   event.type = EventType::EVENT_INVALID;
   while (running_.load()) {
-    if (queue_.WaitAndTryPop(event, std::chrono::milliseconds(100))) {
-      break;
-    }
+    // the event popped is not replaced by the stop event, it is dispatched
+    if (queue_.WaitAndTryPop(event, std::chrono::milliseconds(100))) return event;
   }
-  if (!running_.load()) event.type = EventType::EVENT_STOP;
+  event.type = EventType::EVENT_STOP;
   return event;
 }
 
-void EventBus::EventLoop() {
+void EventBus::CoalesceEvents(std::vector<Event> *events) {
+  auto coalescable = [](const Event &event) {
+    return event.type == EventType::EVENT_ERROR || event.type == EventType::EVENT_STREAM_ERROR ||
+           event.type == EventType::EVENT_EOS;
+  };
+  std::vector<Event> &batch = *events;
+  size_t size = 0;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    size_t j = 0;
+    if (coalescable(batch[i])) {
+      for (; j < size; ++j) {
+        if (batch[j].type == batch[i].type && batch[j].stream_id == batch[i].stream_id &&
+            batch[j].module_name == batch[i].module_name) {
+          break;
+        }
+      }
+    } else {
+      j = size;
+    }
+    if (j < size) {
+      batch[j].coalesced += batch[i].coalesced + 1;
+    } else {
+      if (i != size) batch[size] = std::move(batch[i]);
+      ++size;
+    }
+  }
+  batch.resize(size);
+}
+
+bool EventBus::DispatchEvents(std::vector<Event> *batch) {
   const std::list<BusWatcher> &kWatchers = GetBusWatchers();
   EventHandleFlag flag = EventHandleFlag::EVENT_HANDLE_NULL;
+  CoalesceEvents(batch);
+
+  std::unique_lock<std::mutex> lk(watcher_mtx_);
+  for (const Event &e : *batch) {
+    for (auto &watcher : kWatchers) {
+      flag = watcher(e);
+      if (flag == EventHandleFlag::EVENT_HANDLE_INTERCEPTION || flag == EventHandleFlag::EVENT_HANDLE_STOP) {
+        break;
+      }
+    }
+    if (flag == EventHandleFlag::EVENT_HANDLE_STOP) return false;
+  }
+  return true;
+}
+
+void EventBus::EventLoop() {
+  static constexpr size_t kMaxBatchSize = 256;
+  std::vector<Event> batch;
+  batch.reserve(kMaxBatchSize);
 
   // start loop
-  while (IsRunning()) {
+  bool dispatching = true;
+  while (dispatching && IsRunning()) {
     Event event = PollEvent();
     if (event.type == EventType::EVENT_INVALID) {
       LOGI(CORE) << "[EventLoop] event type is invalid";
@@ -111,16 +172,18 @@ void EventBus::EventLoop() {
       LOGI(CORE) << "[EventLoop] Get stop event";
       break;
     }
-    std::unique_lock<std::mutex> lk(watcher_mtx_);
-    for (auto &watcher : kWatchers) {
-      flag = watcher(event);
-      if (flag == EventHandleFlag::EVENT_HANDLE_INTERCEPTION || flag == EventHandleFlag::EVENT_HANDLE_STOP) {
-        break;
-      }
-    }
-    if (flag == EventHandleFlag::EVENT_HANDLE_STOP) {
-      break;
-    }
+    batch.clear();
+    batch.push_back(std::move(event));
+    while (batch.size() < kMaxBatchSize && queue_.TryPop(event)) batch.push_back(std::move(event));
+    dispatching = DispatchEvents(&batch);
+  }
+  // the events posted before stopping are dispatched, e.g. an error posted right before the EOS of a stream
+  Event event;
+  while (dispatching && queue_.TryPop(event)) {
+    batch.clear();
+    batch.push_back(std::move(event));
+    while (batch.size() < kMaxBatchSize && queue_.TryPop(event)) batch.push_back(std::move(event));
+    dispatching = DispatchEvents(&batch);
   }
   LOGI(CORE) << "Event bus exit.";
 }
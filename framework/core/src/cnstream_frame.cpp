@@ -20,9 +20,13 @@
 
 #include "cnstream_frame.hpp"
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 #include <map>
+#include <utility>
+#include <vector>
 
 #include "cnstream_module.hpp"
 
@@ -33,6 +37,19 @@ static std::map<std::string, std::atomic<bool>> s_stream_eos_map_;
 
 static std::mutex s_remove_lock_;
 static std::map<std::string, bool> s_stream_removed_map_;
+static std::atomic<uint32_t> s_removed_num_{0};  // the streams removed in s_stream_removed_map_
+
+static std::mutex s_releaser_lock_;
+static std::vector<CNFrameInfo::PixelReleaser>& PixelReleasers() {
+  // constructed on first use, the releasers are registered by the static initializers of other libraries
+  static std::vector<CNFrameInfo::PixelReleaser> releasers;
+  return releasers;
+}
+
+static std::vector<CNFrameInfo::PixelCopyReleaser>& PixelCopyReleasers() {
+  static std::vector<CNFrameInfo::PixelCopyReleaser> releasers;
+  return releasers;
+}
 
 bool CheckStreamEosReached(const std::string &stream_id, bool sync) {
   if (sync) {
@@ -64,10 +81,36 @@ bool CheckStreamEosReached(const std::string &stream_id, bool sync) {
   }
 }
 
+void WaitStreamsEosReached(const std::vector<std::string> &stream_ids,
+                           const std::function<void(const std::string &stream_id)> &reached) {
+  std::vector<std::string> pending = stream_ids;
+  std::vector<std::string> done;
+  while (!pending.empty()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    {
+      std::lock_guard<std::mutex> guard(s_eos_lock_);
+      for (auto it = pending.begin(); it != pending.end();) {
+        auto iter = s_stream_eos_map_.find(*it);
+        if (iter != s_stream_eos_map_.end() && iter->second != true) {
+          ++it;
+          continue;
+        }
+        if (iter != s_stream_eos_map_.end()) s_stream_eos_map_.erase(iter);
+        done.push_back(std::move(*it));
+        it = pending.erase(it);
+      }
+    }
+    // out of the lock, the callback may check other streams
+    for (const auto &stream_id : done) reached(stream_id);
+    done.clear();
+  }
+}
+
 void SetStreamRemoved(const std::string &stream_id, bool value) {
   std::lock_guard<std::mutex> guard(s_remove_lock_);
   auto iter = s_stream_removed_map_.find(stream_id);
   if (iter != s_stream_removed_map_.end()) {
+    if (iter->second) s_removed_num_.fetch_sub(1, std::memory_order_relaxed);
     if (value != true) {
       s_stream_removed_map_.erase(iter);
       return;
@@ -76,15 +119,18 @@ void SetStreamRemoved(const std::string &stream_id, bool value) {
   } else {
     s_stream_removed_map_[stream_id] = value;
   }
+  if (value) s_removed_num_.fetch_add(1, std::memory_order_relaxed);
   // LOGI(CORE) << "_____SetStreamRemoved " << stream_id << ":" << s_stream_removed_map_[stream_id];
 }
 
 bool IsStreamRemoved(const std::string &stream_id) {
+  // no stream is being removed most of the time
+  if (!s_removed_num_.load(std::memory_order_relaxed)) return false;
   std::lock_guard<std::mutex> guard(s_remove_lock_);
   auto iter = s_stream_removed_map_.find(stream_id);
   if (iter != s_stream_removed_map_.end()) {
     // LOGI(CORE) << "_____IsStreamRemoved " << stream_id << ":" << s_stream_removed_map_[stream_id];
-    return s_stream_removed_map_[stream_id];
+    return iter->second;
   }
   return false;
 }
@@ -100,46 +146,94 @@ std::shared_ptr<CNFrameInfo> CNFrameInfo::Create(const std::string& stream_id, b
     LOGE(CORE) << "CNFrameInfo::Create() new CNFrameInfo failed.";
     return nullptr;
   }
-  ptr->stream_id = stream_id;
-  ptr->payload = payload;
+  ptr->Init(stream_id, eos, payload);
+  return ptr;
+}
+
+void CNFrameInfo::Init(const std::string& stream_id, bool eos, std::shared_ptr<CNFrameInfo> payload) {
+  this->stream_id = stream_id;
+  this->payload = payload;
+  create_time_ = std::chrono::steady_clock::now();
   if (eos) {
-    ptr->flags |= static_cast<size_t>(cnstream::CNFrameFlag::CN_FRAME_FLAG_EOS);
-    if (!ptr->payload) {
+    this->flags |= static_cast<size_t>(cnstream::CNFrameFlag::CN_FRAME_FLAG_EOS);
+    if (!this->payload) {
       std::lock_guard<std::mutex> guard(s_eos_lock_);
       s_stream_eos_map_[stream_id] = false;
     }
-    return ptr;
   }
+}
 
-  return ptr;
+void CNFrameInfo::MarkEosReached() {
+  if (this->IsEos() && !this->payload) {
+    std::lock_guard<std::mutex> guard(s_eos_lock_);
+    s_stream_eos_map_[stream_id] = true;
+  }
 }
 
 CNS_IGNORE_DEPRECATED_PUSH
 CNFrameInfo::~CNFrameInfo() {
-  if (this->IsEos()) {
-    if (!this->payload) {
-      std::lock_guard<std::mutex> guard(s_eos_lock_);
-      s_stream_eos_map_[stream_id] = true;
-    }
-    return;
+  MarkEosReached();
+}
+
+void CNFrameInfo::Reset() {
+  stream_id.clear();
+  timestamp = -1;
+  flags = 0;
+  {
+    std::lock_guard<std::mutex> guard(datas_lock_);
+    datas.clear();
   }
+  payload.reset();
+  channel_idx = INVALID_STREAM_IDX;
+  sequence_ = -1;
+  deadline_ = std::chrono::steady_clock::time_point::max();
+  modules_mask_.Store(ModuleMask());
+  pixel_released_.store(false);
+  pixel_copies_released_.store(0);
+  module_times_.clear();
+  routes_.reset();
 }
 CNS_IGNORE_DEPRECATED_POP
 
-void CNFrameInfo::SetModulesMask(uint64_t mask) {
-  std::lock_guard<std::mutex> lk(mask_lock_);
-  modules_mask_ = mask;
+void CNFrameInfo::SetModulesMask(const ModuleMask& mask) {
+  modules_mask_.Store(mask);
+}
+
+ModuleMask CNFrameInfo::GetModulesMask() {
+  return modules_mask_.Load();
+}
+
+ModuleMask CNFrameInfo::MarkPassed(Module* module) {
+  return modules_mask_.FetchSet(module->GetId());
+}
+
+bool CNFrameInfo::RegisterPixelReleaser(const PixelReleaser& releaser) {
+  if (!releaser) return false;
+  std::lock_guard<std::mutex> guard(s_releaser_lock_);
+  PixelReleasers().push_back(releaser);
+  return true;
+}
+
+bool CNFrameInfo::ReleasePixels() {
+  if (pixel_released_.exchange(true)) return false;
+  std::lock_guard<std::mutex> guard(s_releaser_lock_);
+  for (const auto& releaser : PixelReleasers()) releaser(this);
+  return true;
 }
 
-uint64_t CNFrameInfo::GetModulesMask() {
-  std::lock_guard<std::mutex> lk(mask_lock_);
-  return modules_mask_;
+bool CNFrameInfo::RegisterPixelCopyReleaser(const PixelCopyReleaser& releaser) {
+  if (!releaser) return false;
+  std::lock_guard<std::mutex> guard(s_releaser_lock_);
+  PixelCopyReleasers().push_back(releaser);
+  return true;
 }
 
-uint64_t CNFrameInfo::MarkPassed(Module* module) {
-  std::lock_guard<std::mutex> lk(mask_lock_);
-  modules_mask_ |= (uint64_t)1 << module->GetId();
-  return modules_mask_;
+bool CNFrameInfo::ReleasePixelCopy(PixelCopy copy) {
+  const uint32_t bit = 1u << static_cast<int>(copy);
+  if (pixel_released_.load() || (pixel_copies_released_.fetch_or(bit) & bit)) return false;
+  std::lock_guard<std::mutex> guard(s_releaser_lock_);
+  for (const auto& releaser : PixelCopyReleasers()) releaser(this, copy);
+  return true;
 }
 
 }  // namespace cnstream
@@ -0,0 +1,162 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_frame_pool.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+#include "util/cnstream_rwlock.hpp"
+
+namespace cnstream {
+
+struct CNFrameInfoPool::Impl {
+  Impl(size_t capacity, size_t max_frames) : capacity(capacity), max_frames(max_frames) {
+    idle_frames.reserve(capacity);
+  }
+  ~Impl() {
+    for (auto frame : idle_frames) delete frame;
+  }
+
+  void Recycle(CNFrameInfo* frame, bool counted) {
+    // the same as what the destructor does, it must be done before the frame is reused.
+    frame->MarkEosReached();
+    {
+      RwLockReadGuard guard(recycler_lock);
+      frame->collection.RetainIf([this] (const std::string& tag, cnstream::any* value) {
+        auto iter = recyclers.find(tag);
+        return iter != recyclers.end() && iter->second(value);
+      });
+    }
+    frame->Reset();
+    std::unique_lock<std::mutex> lk(idle_mutex);
+    bool notify = false;
+    if (counted) {
+      --in_use;
+      notify = waiters > 0;
+    }
+    if (idle_frames.size() < capacity) {
+      idle_frames.push_back(frame);
+      frame = nullptr;
+    }
+    lk.unlock();
+    if (notify) idle_cond.notify_all();
+    delete frame;
+  }
+
+  const size_t capacity;
+  const size_t max_frames;
+  std::mutex idle_mutex;
+  std::condition_variable idle_cond;
+  std::vector<CNFrameInfo*> idle_frames;
+  size_t in_use = 0;   // frames counted against max_frames, guarded by idle_mutex
+  size_t waiters = 0;  // threads in WaitForIdle, guarded by idle_mutex
+  BiasedRwLock recycler_lock;
+  std::map<std::string, Recycler> recyclers;
+};  // struct CNFrameInfoPool::Impl
+
+CNFrameInfoPool::CNFrameInfoPool(size_t capacity, size_t max_frames) : capacity_(capacity), max_frames_(max_frames) {
+  impl_ = std::make_shared<Impl>(capacity, max_frames);
+}
+
+CNFrameInfoPool::~CNFrameInfoPool() {
+  impl_.reset();
+}
+
+std::shared_ptr<CNFrameInfo> CNFrameInfoPool::Create(const std::string& stream_id, bool eos,
+                                                     std::shared_ptr<CNFrameInfo> payload) {
+  if (stream_id == "") {
+    LOGE(CORE) << "CNFrameInfoPool::Create() stream_id is empty string.";
+    return nullptr;
+  }
+  CNFrameInfo* frame = nullptr;
+  // eos frames are never limited, otherwise streams could not be closed while frames are held by the pipeline.
+  const bool counted = max_frames_ > 0 && !eos;
+  {
+    std::lock_guard<std::mutex> lk(impl_->idle_mutex);
+    if (counted) {
+      if (impl_->in_use >= max_frames_) return nullptr;
+      ++impl_->in_use;
+    }
+    if (!impl_->idle_frames.empty()) {
+      frame = impl_->idle_frames.back();
+      impl_->idle_frames.pop_back();
+    }
+  }
+  if (!frame) {
+    frame = new (std::nothrow) CNFrameInfo();
+    if (!frame) {
+      LOGE(CORE) << "CNFrameInfoPool::Create() new CNFrameInfo failed.";
+      if (counted) {
+        std::lock_guard<std::mutex> lk(impl_->idle_mutex);
+        --impl_->in_use;
+      }
+      return nullptr;
+    }
+  }
+  std::weak_ptr<Impl> weak_impl = impl_;
+  std::shared_ptr<CNFrameInfo> ptr(frame, [weak_impl, counted] (CNFrameInfo* frame) {
+    auto impl = weak_impl.lock();
+    if (impl) {
+      impl->Recycle(frame, counted);
+    } else {
+      delete frame;
+    }
+  });
+  ptr->Init(stream_id, eos, payload);
+  return ptr;
+}
+
+void CNFrameInfoPool::RegisterRecycler(const std::string& tag, Recycler recycler) {
+  RwLockWriteGuard guard(impl_->recycler_lock);
+  if (recycler) {
+    impl_->recyclers[tag] = std::move(recycler);
+  } else {
+    impl_->recyclers.erase(tag);
+  }
+}
+
+size_t CNFrameInfoPool::GetIdleNumber() const {
+  std::lock_guard<std::mutex> lk(impl_->idle_mutex);
+  return impl_->idle_frames.size();
+}
+
+size_t CNFrameInfoPool::GetInUseNumber() const {
+  std::lock_guard<std::mutex> lk(impl_->idle_mutex);
+  return impl_->in_use;
+}
+
+bool CNFrameInfoPool::WaitForIdle(uint32_t timeout_ms) const {
+  if (max_frames_ == 0) return true;
+  std::unique_lock<std::mutex> lk(impl_->idle_mutex);
+  ++impl_->waiters;
+  bool ret = impl_->idle_cond.wait_for(lk, std::chrono::milliseconds(timeout_ms),
+                                       [this] { return impl_->in_use < max_frames_; });
+  --impl_->waiters;
+  return ret;
+}
+
+}  // namespace cnstream
@@ -39,6 +39,7 @@
 #include <vector>
 
 #include "cnstream_config.hpp"
+#include "cnstream_graph_plan.hpp"
 #include "cnstream_logging.hpp"
 
 namespace cnstream {
@@ -342,6 +343,16 @@ class CNGraph {
    * -case4: When failed to parse subgraph configuration file.
    */
   bool Init();
+  /**
+   * @brief Initializes the current graph by a compiled plan. The configurations of the subgraphs are taken from the
+   * plan instead of the files, and the graph is not checked again.
+   *
+   * @param[in] plan The plan, see CNGraphPlan::Compile.
+   * @param[in] name The name of the graph, it replaces the name in the configuration of the plan.
+   *
+   * @return Returns true for success. Returns false if a subgraph is not found in the plan.
+   */
+  bool Init(const CNGraphPlan& plan, const std::string& name);
   /**
    * @brief Determines whether it is an empty graph.
    *
@@ -407,6 +418,10 @@ class CNGraph {
    */
   DFSIterator DFSEnd() const;
   std::vector<std::string> TopoSort() const;
+  /**
+   * @brief Gets the parsed configurations of all subgraphs, including the nested ones, keyed by the config path.
+   */
+  void GetSubgraphConfigs(std::map<std::string, CNGraphConfig>* configs) const;
 
  private:
   DFSIterator DFSBeginFrom(const CNNode* node) const;
@@ -432,6 +447,7 @@ class CNGraph {
   CNGraphConfig config_;
   DAGAlgorithm dag_algorithm_;
   const CNGraph* parent_graph_ = nullptr;
+  const CNGraphPlan* plan_ = nullptr;  // set during Init by a plan
 };  // class CNGraph
 
 inline
@@ -640,6 +656,16 @@ bool CNGraph<T>::Init(CNGraphConfig&& config) {
   return Init();
 }
 
+template<typename T> inline
+bool CNGraph<T>::Init(const CNGraphPlan& plan, const std::string& name) {
+  config_ = plan.config;
+  config_.name = name;
+  plan_ = &plan;
+  const bool ret = Init();
+  plan_ = nullptr;
+  return ret;
+}
+
 template<typename T>
 bool CNGraph<T>::Init() {
   Clear();
@@ -662,7 +688,7 @@ bool CNGraph<T>::Init() {
           + "], wrong name : " << subgraph_config.name;
       return false;
     }
-    if (parent_graph_) {
+    if (parent_graph_ && !plan_) {
       // Current graph is a subgraph of other graphs
       auto real_path = __help_functions__::GetRealPath(subgraph_config.config_path);
       if (real_path.empty()) return false;
@@ -679,7 +705,8 @@ bool CNGraph<T>::Init() {
 
   FindHeadsAndTails();
 
-  // check circle
+  // check circle, the graph of a plan is checked as the plan is compiled
+  if (plan_) return true;
   auto topo_result = dag_algorithm_.TopoSort();
   if (topo_result.second.size()) {
     LOGE(CORE) << GetLogPrefix() + "Ring detected.";
@@ -826,6 +853,15 @@ std::vector<std::string> CNGraph<T>::TopoSort() const {
   return results;
 }
 
+template<typename T>
+void CNGraph<T>::GetSubgraphConfigs(std::map<std::string, CNGraphConfig>* configs) const {
+  for (const auto& it : subgraph_node_map_) {
+    const auto& subgraph = std::get<2>(it.second);
+    configs->emplace(std::get<1>(it.second).config_path, subgraph->GetConfig());
+    subgraph->GetSubgraphConfigs(configs);
+  }
+}
+
 template<typename T> inline
 typename CNGraph<T>::DFSIterator CNGraph<T>::DFSBeginFrom(const CNNode* node) const {
   // be carefully, make sure current graph is the root graph of this node when calling this function.
@@ -887,14 +923,24 @@ bool CNGraph<T>::AddVertex(const CNSubgraphConfig& config) {
     return false;
   }
   CNGraphConfig graph_config;
-  if (!graph_config.ParseByJSONFile(config.config_path)) {
+  if (plan_) {
+    auto iter = plan_->subgraph_configs.find(config.config_path);
+    if (iter == plan_->subgraph_configs.end()) {
+      LOGE(CORE) << GetLogPrefix() << "Subgraph is not found in the plan. subgraph name: " << config.name;
+      return false;
+    }
+    graph_config = iter->second;
+  } else if (!graph_config.ParseByJSONFile(config.config_path)) {
     LOGE(CORE) << GetLogPrefix() << "Parse subgraph config file failed. subgraph name: " << config.name;
     return false;
   }
   graph_config.name = __help_functions__::NameIgnoreSubgraphPrefix(config.name);
   auto subgraph = std::make_shared<CNGraph<T>>(graph_config);
   subgraph->parent_graph_ = this;
-  if (!subgraph->Init()) {
+  subgraph->plan_ = plan_;
+  const bool subgraph_inited = subgraph->Init();
+  subgraph->plan_ = nullptr;
+  if (!subgraph_inited) {
     LOGE(CORE) << GetLogPrefix() + "Init subgraph[" + config.name + "] failed.";
     return false;
   }
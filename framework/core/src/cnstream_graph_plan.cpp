@@ -0,0 +1,174 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_graph_plan.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_graph.hpp"
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+// the nodes of the graph compiled carry no data
+struct PlanNodeData {};
+
+std::shared_ptr<const CNGraphPlan> CNGraphPlan::Compile(const CNGraphConfig& config, uint64_t hash) {
+  CNGraph<PlanNodeData> graph;
+  if (!graph.Init(config)) {
+    LOGE(CORE) << "Compile graph plan failed, graph [" << config.name << "] is not valid.";
+    return nullptr;
+  }
+  std::shared_ptr<CNGraphPlan> plan = std::make_shared<CNGraphPlan>();
+  plan->hash = hash;
+  plan->config = config;
+  graph.GetSubgraphConfigs(&plan->subgraph_configs);
+
+  // the names are relative to the root graph, which is renamed by the pipelines
+  const size_t prefix_size = graph.GetFullName().size() + 1;
+  std::map<std::string, uint32_t> indices;  // by the full names
+  for (auto node = graph.DFSBegin(); node != graph.DFSEnd(); ++node) {
+    const std::string full_name = node->GetFullName();
+    indices[full_name] = static_cast<uint32_t>(plan->nodes.size());
+    Node plan_node;
+    plan_node.name = full_name.substr(prefix_size);
+    plan->nodes.push_back(std::move(plan_node));
+  }
+  uint32_t idx = 0;
+  for (auto node = graph.DFSBegin(); node != graph.DFSEnd(); ++node, ++idx) {
+    for (const auto& next : node->GetNext()) plan->nodes[indices[next->GetFullName()]].parents.push_back(idx);
+  }
+  for (const auto& head : graph.GetHeads()) {
+    Node& plan_node = plan->nodes[indices[head->GetFullName()]];
+    for (auto iter = head->DFSBegin(); iter != head->DFSEnd(); ++iter) {
+      plan_node.routes.push_back(indices[iter->GetFullName()]);
+    }
+  }
+  for (const auto& name : graph.TopoSort()) plan->topo_order.push_back(indices[name]);
+  return plan;
+}
+
+uint64_t CNGraphPlan::Hash(const std::string& jstr, const std::string& config_root_dir) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  auto update = [&hash](const std::string& str) {
+    for (unsigned char c : str) hash = (hash ^ c) * 1099511628211ULL;
+  };
+  update(config_root_dir);
+  hash *= 1099511628211ULL;  // a zero byte between the directory and the JSON
+  update(jstr);
+  return hash;
+}
+
+CNGraphPlanCache& CNGraphPlanCache::Instance() {
+  static CNGraphPlanCache instance;
+  return instance;
+}
+
+std::shared_ptr<const CNGraphPlan> CNGraphPlanCache::GetByJSONStr(const std::string& jstr,
+                                                                  const std::string& config_root_dir) {
+  const uint64_t hash = CNGraphPlan::Hash(jstr, config_root_dir);
+  const std::string key = config_root_dir + '\0' + jstr;
+  auto find = [&]() -> std::shared_ptr<const CNGraphPlan> {
+    auto range = index_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second->key != key) continue;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->plan;
+    }
+    return nullptr;
+  };
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::shared_ptr<const CNGraphPlan> plan = find();
+    if (plan) return plan;
+  }
+
+  // compiled without the lock, the subgraph files may be slow to read
+  CNGraphConfig config;
+  config.config_root_dir = config_root_dir;
+  if (!config.ParseByJSONStr(jstr)) {
+    LOGE(CORE) << "Parse graph config failed.";
+    return nullptr;
+  }
+  std::shared_ptr<const CNGraphPlan> plan = CNGraphPlan::Compile(config, hash);
+  if (!plan) return nullptr;
+
+  std::lock_guard<std::mutex> lk(mutex_);
+  std::shared_ptr<const CNGraphPlan> cached = find();  // compiled by another thread at the same time
+  if (cached) return cached;
+  if (capacity_ == 0) return plan;
+  entries_.push_front(Entry{hash, key, plan});
+  index_.emplace(hash, entries_.begin());
+  Evict();
+  return plan;
+}
+
+std::shared_ptr<const CNGraphPlan> CNGraphPlanCache::GetByJSONFile(const std::string& config_file) {
+  std::ifstream ifs(config_file);
+  if (!ifs.is_open()) {
+    LOGE(CORE) << "Config file open failed :" << config_file;
+    return nullptr;
+  }
+  std::string jstr((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  // the same directory as CNConfigBase::ParseByJSONFile
+  const auto slash_pos = config_file.rfind("/");
+  return GetByJSONStr(jstr, slash_pos == std::string::npos ? "" : config_file.substr(0, slash_pos) + "/");
+}
+
+void CNGraphPlanCache::SetCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  capacity_ = capacity;
+  Evict();
+}
+
+size_t CNGraphPlanCache::Size() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return entries_.size();
+}
+
+void CNGraphPlanCache::Clear() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  index_.clear();
+  entries_.clear();
+}
+
+void CNGraphPlanCache::Evict() {
+  // called with mutex_ locked
+  while (entries_.size() > capacity_) {
+    auto last = std::prev(entries_.end());
+    auto range = index_.equal_range(last->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == last) {
+        index_.erase(it);
+        break;
+      }
+    }
+    entries_.pop_back();
+  }
+}
+
+}  // namespace cnstream
@@ -28,6 +28,8 @@
 #include <assert.h>
 #include <errno.h>
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -75,6 +77,9 @@ CNSTREAM_DEFINE_ENV_bool(log_to_stderr, true, "log messages go to stderr");
 
 CNSTREAM_DEFINE_ENV_bool(log_to_file, false, "log messages go to log file");
 
+CNSTREAM_DEFINE_ENV_bool(log_async, false, "log messages are written by a background thread, "
+                         "and are dropped if its buffers are full");
+
 static bool g_init_cnstream_logging = false;
 
 inline static bool IsInitCNStreamLogging() {
@@ -325,6 +330,9 @@ struct LogMessage::LogMessageData {
   const char* filename_;        // basename of file that called LOG
   const char* category_;        // Which category call is.
   bool has_been_flushed_;       // false => data has not been flushed
+  bool deferred_;               // true => the prefix is formatted by the log writer, see FLAGS_log_async
+  bool has_tm_time_;            // false => tm_time_ is not filled yet, it is filled for sinks only if deferred_
+  uint32_t tid_;                // Thread of creation of LogMessage
 
  private:
   LogMessageData(const LogMessageData&) = delete;
@@ -613,6 +621,10 @@ inline void LogDestination::RemoveLogSink(LogSink* sink) {
 
 inline void LogDestination::LogToSinks(LogMessage::LogMessageData* data) {
   RwLockReadGuard lk(sink_lock_);
+  if (!sinks_.empty() && !data->has_tm_time_) {
+    localtime_r(&data->timestamp_, &data->tm_time_);
+    data->has_tm_time_ = true;
+  }
   for (int i = sinks_.size() - 1; i >= 0; i--) {
     sinks_[i]->Send(data->severity_, data->category_,
                     data->filename_, data->line_,
@@ -636,6 +648,263 @@ inline void LogDestination::LogToFile(const char* message, size_t message_len, b
 }
 // end LogDestination
 
+// AsyncLogger, see FLAGS_log_async
+static constexpr LogSeverity kLogBufferDropSeverity = LogSeverity::LOG_WARNING;
+
+/**
+ * @brief The fields of a log message recorded by the caller thread, the prefix is formatted by the writer thread.
+ *
+ * The category and the filename point to string literals, see LOGI etc.
+ */
+struct LogRecord {
+  const char* category;
+  const char* filename;
+  int64_t timestamp;
+  int32_t usecs;
+  int32_t line;
+  uint32_t tid;
+  uint32_t message_len;  // kPaddingLen marks the unused end of the buffer
+  LogSeverity severity;
+};  // struct LogRecord
+
+/**
+ * @brief LogBuffer is a lock-free ring buffer of the log records of one thread, written by the thread and read by
+ * the writer thread only.
+ *
+ * A record is stored as a LogRecord followed by the message, aligned to 8 bytes. A record never wraps around, the end
+ * of the buffer is skipped if the record does not fit in it.
+ */
+class LogBuffer {
+ public:
+  static constexpr size_t kCapacity = 64 * 1024;
+  static constexpr uint32_t kPaddingLen = UINT32_MAX;
+
+  // returns false and counts the message as dropped if the buffer is full
+  bool Push(const LogRecord& record, const char* message) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    const size_t size = RecordSize(record.message_len);
+    const size_t pos = head % kCapacity;
+    const size_t contiguous = kCapacity - pos;
+    const size_t padding = contiguous < size ? contiguous : 0;
+    if (kCapacity - (head - tail) < padding + size) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (padding >= sizeof(LogRecord)) {
+      LogRecord pad = record;
+      pad.message_len = kPaddingLen;
+      memcpy(data_ + pos, &pad, sizeof(pad));
+    }
+    char* dst = data_ + (head + padding) % kCapacity;
+    memcpy(dst, &record, sizeof(record));
+    memcpy(dst + sizeof(record), message, record.message_len);
+    head_.store(head + padding + size, std::memory_order_release);
+    return true;
+  }
+
+  // calls func(record, message) for the records pushed, returns the number of the records
+  template <typename Func>
+  size_t Drain(Func func) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = head_.load(std::memory_order_acquire);
+    size_t num = 0;
+    while (tail != head) {
+      const size_t pos = tail % kCapacity;
+      const size_t contiguous = kCapacity - pos;
+      LogRecord record;
+      if (contiguous < sizeof(LogRecord)) {
+        tail += contiguous;
+        continue;
+      }
+      memcpy(&record, data_ + pos, sizeof(record));
+      if (kPaddingLen == record.message_len) {
+        tail += contiguous;
+        continue;
+      }
+      func(record, data_ + pos + sizeof(record));
+      tail += RecordSize(record.message_len);
+      ++num;
+    }
+    tail_.store(tail, std::memory_order_release);
+    return num;
+  }
+
+  uint64_t GetDroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+  std::atomic<bool> orphaned{false};  // the thread has exited
+
+ private:
+  static size_t RecordSize(size_t message_len) { return (sizeof(LogRecord) + message_len + 7) & ~size_t(7); }
+
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  std::atomic<uint64_t> dropped_{0};
+  alignas(8) char data_[kCapacity];
+};  // class LogBuffer
+
+// the buffer of the calling thread, released by the writer once the thread exits and the buffer is drained.
+struct ThreadLogBuffer {
+  ~ThreadLogBuffer() {
+    if (buffer) buffer->orphaned.store(true);
+  }
+  std::shared_ptr<LogBuffer> buffer;
+};  // struct ThreadLogBuffer
+
+static thread_local ThreadLogBuffer thread_log_buffer;
+
+static void AppendLogLine(const LogRecord& record, const char* message, std::string* line) {
+  const time_t timestamp = static_cast<time_t>(record.timestamp);
+  struct ::tm tm_time;
+  localtime_r(&timestamp, &tm_time);
+  char prefix[256];
+  int len = snprintf(prefix, sizeof(prefix), "CNSTREAM %s %c%02d%02d %02d:%02d:%02d.%06d %5u"
+#ifdef DEBUG
+                     " %s:%d"
+#endif
+                     "] ",
+                     record.category, LogSeverityNames[static_cast<int>(record.severity)][0], 1 + tm_time.tm_mon,
+                     tm_time.tm_mday, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec, record.usecs, record.tid
+#ifdef DEBUG
+                     , record.filename, record.line
+#endif
+                     );  // NOLINT
+  line->append(prefix, std::min(std::max(len, 0), static_cast<int>(sizeof(prefix)) - 1));
+  line->append(message, record.message_len);
+}
+
+/**
+ * @brief AsyncLogger moves the formatting of the prefixes and the writes to stderr and the log file off the threads
+ * logging. The messages are written by one thread in batches.
+ */
+class AsyncLogger : public NonCopyable {
+ public:
+  static AsyncLogger& Instance() {
+    static AsyncLogger instance;
+    return instance;
+  }
+  void Start() {
+    std::lock_guard<std::mutex> lk(start_mutex_);
+    if (running_.load()) return;
+    running_.store(true);
+    writer_ = std::thread(&AsyncLogger::WriteLoop, this);
+  }
+  // the messages pushed before are written
+  void Stop() {
+    std::lock_guard<std::mutex> lk(start_mutex_);
+    if (!running_.load()) return;
+    running_.store(false);
+    if (writer_.joinable()) writer_.join();
+  }
+  bool IsRunning() const { return running_.load(std::memory_order_relaxed); }
+  bool Push(const LogMessage::LogMessageData& data) {
+    if (!IsRunning()) return false;
+    if (!thread_log_buffer.buffer) {
+      thread_log_buffer.buffer = std::make_shared<LogBuffer>();
+      std::lock_guard<std::mutex> lk(buffers_mutex_);
+      buffers_.push_back(thread_log_buffer.buffer);
+    }
+    LogRecord record;
+    record.category = data.category_;
+    record.filename = data.filename_;
+    record.timestamp = data.timestamp_;
+    record.usecs = data.usecs_;
+    record.line = data.line_;
+    record.tid = data.tid_;
+    record.message_len = static_cast<uint32_t>(data.num_chars_to_log_ - data.num_prefix_chars_);
+    record.severity = data.severity_;
+    // a message dropped is not written in another way, the thread logging is never blocked
+    thread_log_buffer.buffer->Push(record, data.message_buf_ + data.num_prefix_chars_);
+    return true;
+  }
+  uint64_t GetDroppedCount() {
+    std::lock_guard<std::mutex> lk(buffers_mutex_);
+    uint64_t dropped = released_dropped_;
+    for (const auto& buffer : buffers_) dropped += buffer->GetDroppedCount();
+    return dropped;
+  }
+
+ private:
+  AsyncLogger() = default;
+  ~AsyncLogger() { Stop(); }
+
+  void WriteLoop() {
+    while (running_.load()) {
+      if (!WriteBatch()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    WriteBatch();
+  }
+  // returns false if there is nothing to write
+  bool WriteBatch() {
+    std::vector<std::shared_ptr<LogBuffer>> buffers;
+    {
+      std::lock_guard<std::mutex> lk(buffers_mutex_);
+      buffers = buffers_;
+    }
+    std::string plain;
+    std::string colored;
+    auto append = [&](const LogRecord& record, const char* message) {
+      const size_t begin = plain.size();
+      AppendLogLine(record, message, &plain);
+      if (!FLAGS_log_to_stderr) return;
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
+      colored.append(plain, begin, std::string::npos);
+#else
+      const LogColor color = SeverityToColor(record.severity);
+      if (LogColor::COLOR_DEFAULT == color) {
+        colored.append(plain, begin, std::string::npos);
+      } else {
+        colored.append("\033[0;3").append(GetAnsiColorCode(color)).append("m");
+        colored.append(plain, begin, std::string::npos);
+        colored.append("\033[m");
+      }
+#endif
+    };
+    size_t num = 0;
+    for (const auto& buffer : buffers) {
+      const bool orphaned = buffer->orphaned.load();
+      num += buffer->Drain(append);
+      if (orphaned) {
+        // nothing is pushed once the thread exits
+        std::lock_guard<std::mutex> lk(buffers_mutex_);
+        released_dropped_ += buffer->GetDroppedCount();
+        buffers_.erase(std::remove(buffers_.begin(), buffers_.end(), buffer), buffers_.end());
+      }
+    }
+    const uint64_t dropped = GetDroppedCount();
+    if (dropped > reported_dropped_) {
+      std::string message = std::to_string(dropped - reported_dropped_) +
+                            " log messages are dropped as the log buffers are full.\n";
+      reported_dropped_ = dropped;
+      const double now = GetTimeStamp();
+      LogRecord record;
+      record.category = "CORE";
+      record.filename = const_basename(__FILE__);
+      record.timestamp = static_cast<int64_t>(now);
+      record.usecs = static_cast<int32_t>((now - record.timestamp) * 1000000);
+      record.line = __LINE__;
+      record.tid = static_cast<uint32_t>(GetTID());
+      record.message_len = static_cast<uint32_t>(message.size());
+      record.severity = kLogBufferDropSeverity;
+      append(record, message.data());
+      ++num;
+    }
+    if (!num) return false;
+    if (FLAGS_log_to_stderr) fwrite(colored.data(), colored.size(), 1, stderr);
+    LogDestination::LogToFile(plain.data(), plain.size(), false);
+    return true;
+  }
+
+  std::atomic<bool> running_{false};
+  std::mutex start_mutex_;  // serializes Start and Stop
+  std::thread writer_;
+  std::mutex buffers_mutex_;  // guards the members below
+  std::vector<std::shared_ptr<LogBuffer>> buffers_;
+  uint64_t released_dropped_ = 0;  // the messages dropped by the buffers released
+  uint64_t reported_dropped_ = 0;  // used by the writer thread only
+};  // class AsyncLogger
+// end AsyncLogger
+
 static thread_local bool thread_msg_data_available = true;
 static thread_local std::aligned_storage<sizeof(LogMessage::LogMessageData),
                          alignof(LogMessage::LogMessageData)>::type thread_msg_data;
@@ -669,18 +938,27 @@ void LogMessage::Init(const char* category, const char* file, int line, LogSever
     data_ = allocated_;
   }
 
-  stream().fill('0');
   data_->severity_ = severity;
   data_->line_ = line;
   double now = GetTimeStamp();
   data_->timestamp_ = static_cast<time_t>(now);
-  localtime_r(&data_->timestamp_, &data_->tm_time_);
   data_->usecs_ = static_cast<int32_t>((now - data_->timestamp_) * 1000000);
 
   data_->num_chars_to_log_ = 0;
   data_->filename_ = const_basename(file);
   data_->category_ = category;
   data_->has_been_flushed_ = false;
+  static thread_local uint32_t tid = static_cast<uint32_t>(GetTID());
+  data_->tid_ = tid;
+  data_->deferred_ = AsyncLogger::Instance().IsRunning();
+  data_->has_tm_time_ = !data_->deferred_;
+  if (data_->deferred_) {
+    data_->num_prefix_chars_ = 0;
+    return;
+  }
+
+  localtime_r(&data_->timestamp_, &data_->tm_time_);
+  stream().fill('0');
 
   stream() << "CNSTREAM " << data_->category_ << ' '
            << LogSeverityNames[static_cast<int>(severity)][0]
@@ -688,7 +966,7 @@ void LogMessage::Init(const char* category, const char* file, int line, LogSever
            << std::setw(2) << 1 + data_->tm_time_.tm_mon << std::setw(2) << data_->tm_time_.tm_mday << ' '
            << std::setw(2) << data_->tm_time_.tm_hour << ':' << std::setw(2) << data_->tm_time_.tm_min << ':'
            << std::setw(2) << data_->tm_time_.tm_sec << "." << std::setw(6) << data_->usecs_ << ' ' << std::setfill(' ')
-           << std::setw(5) << static_cast<unsigned int>(GetTID())
+           << std::setw(5) << data_->tid_
 #ifdef DEBUG
            << ' ' << data_->filename_ << ':' << data_->line_
 #endif
@@ -707,7 +985,8 @@ void LogMessage::Flush() {
   }
   data_->num_chars_to_log_ = data_->stream_.pcount();
 
-  bool append_newline = (data_->message_buf_[data_->num_chars_to_log_ - 1] != '\n');
+  // the message is empty if its prefix is deferred, see FLAGS_log_async
+  bool append_newline = !data_->num_chars_to_log_ || data_->message_buf_[data_->num_chars_to_log_ - 1] != '\n';
   if (append_newline) {
     data_->message_buf_[data_->num_chars_to_log_++] = '\n';
   }
@@ -727,6 +1006,17 @@ void LogMessage::SendToLog() {
     }
   }
 
+  if (data_->deferred_) {
+    // the sinks are still called on this thread
+    if (data_->severity_ != LogSeverity::LOG_FATAL && AsyncLogger::Instance().Push(*data_)) {
+      LogDestination::LogToSinks(data_);
+      return;
+    }
+    // the messages before a fatal one are written first
+    if (data_->severity_ == LogSeverity::LOG_FATAL) AsyncLogger::Instance().Stop();
+    FormatDeferredPrefix();
+  }
+
   LogDestination::LogToStderr(data_->severity_, data_->message_buf_, data_->num_chars_to_log_);
   LogDestination::LogToSinks(data_);
   LogDestination::LogToFile(data_->message_buf_, data_->num_chars_to_log_, false);
@@ -737,9 +1027,64 @@ void LogMessage::SendToLog() {
   }
 }
 
+void LogMessage::FormatDeferredPrefix() {
+  LogRecord record;
+  record.category = data_->category_;
+  record.filename = data_->filename_;
+  record.timestamp = data_->timestamp_;
+  record.usecs = data_->usecs_;
+  record.line = data_->line_;
+  record.tid = data_->tid_;
+  record.message_len = static_cast<uint32_t>(data_->num_chars_to_log_);
+  record.severity = data_->severity_;
+  std::string line;
+  AppendLogLine(record, data_->message_buf_, &line);
+  const size_t len = std::min(line.size(), MaxLogMsgLen);
+  memcpy(data_->message_buf_, line.data(), len);
+  data_->message_buf_[len - 1] = '\n';
+  data_->message_buf_[len] = '\0';
+  data_->num_prefix_chars_ = line.size() - data_->num_chars_to_log_;
+  data_->num_chars_to_log_ = len;
+  data_->deferred_ = false;
+}
+
+LogRateLimiter::LogRateLimiter(double rate, uint32_t burst) {
+  interval_ns_ = rate > 0 ? static_cast<int64_t>(1e9 / rate) : 0;
+  tolerance_ns_ = interval_ns_ * (std::max(burst, 1u) - 1);
+}
+
+int64_t LogRateLimiter::Allow() {
+  if (every_n_) {
+    const uint64_t count = count_.fetch_add(1, std::memory_order_relaxed);
+    if (count % every_n_) return -1;
+    return count ? static_cast<int64_t>(every_n_ - 1) : 0;
+  }
+  // GCRA, the token bucket kept as the time the bucket is full again
+  const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  int64_t tat = tat_.load(std::memory_order_relaxed);
+  do {
+    if (std::max(tat, now) - now > tolerance_ns_) {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+      return -1;
+    }
+  } while (!tat_.compare_exchange_weak(tat, std::max(tat, now) + interval_ns_, std::memory_order_relaxed));
+  return static_cast<int64_t>(suppressed_.exchange(0, std::memory_order_relaxed));
+}
+
+std::ostream& operator<<(std::ostream& os, const LogSuppressed& suppressed) {
+  if (suppressed.num > 0) os << "[" << suppressed.num << " similar messages suppressed] ";
+  return os;
+}
+
 void InitCNStreamLogging(const char* log_dir) {
   LogDestination::CreateLogDestination(log_dir);
   g_init_cnstream_logging = true;
+  if (FLAGS_log_async) AsyncLogger::Instance().Start();
+}
+
+uint64_t GetDroppedLogCount() {
+  return AsyncLogger::Instance().GetDroppedCount();
 }
 
 void AddLogSink(LogSink* log_sink) {
@@ -751,6 +1096,7 @@ void RemoveLogSink(LogSink* log_sink) {
 }
 
 void ShutdownCNStreamLogging() {
+  AsyncLogger::Instance().Stop();
   LogDestination::DeleteLogDestination();
   g_init_cnstream_logging = false;
 }
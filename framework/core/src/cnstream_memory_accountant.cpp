@@ -0,0 +1,211 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_memory_accountant.hpp"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace cnstream {
+
+/* The counters of a pipeline, a stream or the process. Budgets are only used by pipeline accounts. */
+class MemoryAccount {
+ public:
+  MemoryAccount() {
+    for (int i = 0; i < kTypeNum; ++i) {
+      bytes[i].store(0);
+      peak[i].store(0);
+      budget[i].store(0);
+      stream_budget[i].store(0);
+    }
+  }
+  void Add(MemoryType type, int64_t size) {
+    const int idx = static_cast<int>(type);
+    const int64_t cur = bytes[idx].fetch_add(size) + size;
+    int64_t old_peak = peak[idx].load();
+    while (cur > old_peak && !peak[idx].compare_exchange_weak(old_peak, cur)) {}
+  }
+  void Sub(MemoryType type, int64_t size) { bytes[static_cast<int>(type)].fetch_sub(size); }
+  MemoryUsage GetUsage() const {
+    MemoryUsage usage;
+    usage.host_bytes = bytes[static_cast<int>(MemoryType::HOST)].load();
+    usage.device_bytes = bytes[static_cast<int>(MemoryType::DEVICE)].load();
+    usage.peak_host_bytes = peak[static_cast<int>(MemoryType::HOST)].load();
+    usage.peak_device_bytes = peak[static_cast<int>(MemoryType::DEVICE)].load();
+    return usage;
+  }
+
+  static constexpr int kTypeNum = 2;
+  std::atomic<int64_t> bytes[kTypeNum];
+  std::atomic<int64_t> peak[kTypeNum];
+  std::atomic<int64_t> budget[kTypeNum];
+  std::atomic<int64_t> stream_budget[kTypeNum];
+};  // class MemoryAccount
+
+static thread_local MemoryOwner current_owner;
+
+MemoryOwner MemoryOwner::Current() {
+  return current_owner;
+}
+
+void MemoryOwner::SetCurrent(const MemoryOwner& owner) {
+  current_owner = owner;
+}
+
+MemoryCharge::MemoryCharge(MemoryType type, size_t bytes, const MemoryOwner& owner) : type_(type) {
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  if (!accountant.IsEnabled() || 0 == bytes) return;
+  bytes_ = bytes;
+  owner_ = owner;
+  accountant.Charge(type_, static_cast<int64_t>(bytes_), owner_);
+}
+
+MemoryCharge::MemoryCharge(MemoryCharge&& other) noexcept
+    : type_(other.type_), bytes_(other.bytes_), owner_(std::move(other.owner_)) {
+  other.bytes_ = 0;
+  other.owner_ = MemoryOwner();
+}
+
+MemoryCharge& MemoryCharge::operator=(MemoryCharge&& other) noexcept {
+  if (this != &other) {
+    Release();
+    type_ = other.type_;
+    bytes_ = other.bytes_;
+    owner_ = std::move(other.owner_);
+    other.bytes_ = 0;
+    other.owner_ = MemoryOwner();
+  }
+  return *this;
+}
+
+void MemoryCharge::Release() {
+  if (0 == bytes_) return;
+  MemoryAccountant::Instance().Discharge(type_, static_cast<int64_t>(bytes_), owner_);
+  bytes_ = 0;
+  owner_ = MemoryOwner();
+}
+
+MemoryAccountant& MemoryAccountant::Instance() {
+  // never destructed, charges may be released by static objects at exit.
+  static MemoryAccountant* instance = new MemoryAccountant();
+  return *instance;
+}
+
+MemoryAccountant::MemoryAccountant() : total_(std::make_shared<MemoryAccount>()) {}
+
+void MemoryAccountant::Charge(MemoryType type, int64_t bytes, const MemoryOwner& owner) {
+  total_->Add(type, bytes);
+  if (owner.pipeline_) owner.pipeline_->Add(type, bytes);
+  if (owner.stream_) owner.stream_->Add(type, bytes);
+}
+
+void MemoryAccountant::Discharge(MemoryType type, int64_t bytes, const MemoryOwner& owner) {
+  total_->Sub(type, bytes);
+  if (owner.pipeline_) owner.pipeline_->Sub(type, bytes);
+  if (owner.stream_) owner.stream_->Sub(type, bytes);
+  // pairs with WaitForBudget, the waiter either sees the new usage or is notified.
+  if (waiter_num_.load() > 0) {
+    std::lock_guard<std::mutex> lk(wait_mtx_);
+    wait_cond_.notify_all();
+  }
+}
+
+MemoryOwner MemoryAccountant::GetOwner(const std::string& pipeline_name, const std::string& stream_id) {
+  MemoryOwner owner;
+  std::lock_guard<std::mutex> lk(mutex_);
+  PipelineAccounts& accounts = pipelines_[pipeline_name];
+  if (!accounts.account) accounts.account = std::make_shared<MemoryAccount>();
+  owner.pipeline_ = accounts.account;
+  if (!stream_id.empty()) {
+    std::shared_ptr<MemoryAccount>& stream_account = accounts.streams[stream_id];
+    if (!stream_account) stream_account = std::make_shared<MemoryAccount>();
+    owner.stream_ = stream_account;
+  }
+  return owner;
+}
+
+void MemoryAccountant::SetBudget(const std::string& pipeline_name, MemoryType type, size_t bytes) {
+  MemoryOwner owner = GetOwner(pipeline_name);
+  owner.pipeline_->budget[static_cast<int>(type)].store(static_cast<int64_t>(bytes));
+}
+
+void MemoryAccountant::SetStreamBudget(const std::string& pipeline_name, MemoryType type, size_t bytes) {
+  MemoryOwner owner = GetOwner(pipeline_name);
+  owner.pipeline_->stream_budget[static_cast<int>(type)].store(static_cast<int64_t>(bytes));
+}
+
+bool MemoryAccountant::IsOverBudget(const MemoryOwner& owner) const {
+  if (!owner.pipeline_) return false;
+  for (int idx = 0; idx < MemoryAccount::kTypeNum; ++idx) {
+    const int64_t budget = owner.pipeline_->budget[idx].load();
+    if (budget > 0 && owner.pipeline_->bytes[idx].load() > budget) return true;
+    const int64_t stream_budget = owner.pipeline_->stream_budget[idx].load();
+    if (owner.stream_ && stream_budget > 0 && owner.stream_->bytes[idx].load() > stream_budget) return true;
+  }
+  return false;
+}
+
+bool MemoryAccountant::WaitForBudget(const MemoryOwner& owner, uint32_t timeout_ms) {
+  if (!IsOverBudget(owner)) return true;
+  waiter_num_++;
+  bool within_budget = false;
+  {
+    std::unique_lock<std::mutex> lk(wait_mtx_);
+    within_budget = wait_cond_.wait_for(lk, std::chrono::milliseconds(timeout_ms),
+                                        [&] { return !IsOverBudget(owner); });
+  }
+  waiter_num_--;
+  return within_budget;
+}
+
+MemoryUsage MemoryAccountant::GetUsage(const std::string& pipeline_name) const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = pipelines_.find(pipeline_name);
+  if (iter == pipelines_.end() || !iter->second.account) return {};
+  return iter->second.account->GetUsage();
+}
+
+std::map<std::string, MemoryUsage> MemoryAccountant::GetStreamUsages(const std::string& pipeline_name) const {
+  std::map<std::string, MemoryUsage> usages;
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = pipelines_.find(pipeline_name);
+  if (iter == pipelines_.end()) return usages;
+  for (const auto& stream : iter->second.streams) usages[stream.first] = stream.second->GetUsage();
+  return usages;
+}
+
+MemoryUsage MemoryAccountant::GetTotalUsage() const {
+  return total_->GetUsage();
+}
+
+void MemoryAccountant::RemoveStream(const std::string& pipeline_name, const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = pipelines_.find(pipeline_name);
+  if (iter != pipelines_.end()) iter->second.streams.erase(stream_id);
+}
+
+void MemoryAccountant::RemovePipeline(const std::string& pipeline_name) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  pipelines_.erase(pipeline_name);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,224 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_metrics_exporter.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+constexpr char MetricsExporter::kContentType[];
+
+// requests larger than it are not ours
+static constexpr size_t kMaxRequestSize = 8192;
+static constexpr int kRequestTimeoutMs = 1000;
+// how often the serving thread checks whether the exporter is stopped
+static constexpr int kPollIntervalMs = 100;
+
+static void AppendEscaped(const std::string& str, bool quote, std::string* out) {
+  for (char c : str) {
+    if (c == '\\') {
+      out->append("\\\\");
+    } else if (c == '\n') {
+      out->append("\\n");
+    } else if (c == '"' && quote) {
+      out->append("\\\"");
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+static void AppendValue(double value, std::string* out) {
+  if (std::isnan(value)) {
+    out->append("NaN");
+  } else if (std::isinf(value)) {
+    out->append(value > 0 ? "+Inf" : "-Inf");
+  } else {
+    char buffer[32];
+    // integers up to 2^53, e.g. counters, are written exactly without an exponent
+    if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+      snprintf(buffer, sizeof(buffer), "%.0f", value);
+    } else {
+      snprintf(buffer, sizeof(buffer), "%.9g", value);
+    }
+    out->append(buffer);
+  }
+}
+
+void OpenMetricsWriter::AddFamily(const std::string& name, const std::string& type, const std::string& help,
+                                  const std::string& unit) {
+  text_ += "# TYPE " + name + " " + type + "\n";
+  if (!unit.empty()) text_ += "# UNIT " + name + " " + unit + "\n";
+  text_ += "# HELP " + name + " ";
+  AppendEscaped(help, false, &text_);
+  text_ += "\n";
+}
+
+void OpenMetricsWriter::AddSample(const std::string& name, const Labels& labels, double value) {
+  text_ += name;
+  if (!labels.empty()) {
+    text_ += "{";
+    for (size_t i = 0; i < labels.size(); ++i) {
+      if (i) text_ += ",";
+      text_ += labels[i].first + "=\"";
+      AppendEscaped(labels[i].second, true, &text_);
+      text_ += "\"";
+    }
+    text_ += "}";
+  }
+  text_ += " ";
+  AppendValue(value, &text_);
+  text_ += "\n";
+}
+
+std::string OpenMetricsWriter::Finish() {
+  std::string text;
+  text.swap(text_);
+  text += "# EOF\n";
+  return text;
+}
+
+MetricsExporter::MetricsExporter(const MetricsConfig& config) : config_(config) {}
+
+MetricsExporter::~MetricsExporter() {
+  Stop();
+}
+
+bool MetricsExporter::Start(CollectFunc collect_func) {
+  if (running_.load()) return true;
+  if (!collect_func) {
+    LOGE(CORE) << "MetricsExporter::Start() collect_func must be set.";
+    return false;
+  }
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    LOGE(CORE) << "MetricsExporter::Start() create socket failed, " << strerror(errno);
+    return false;
+  }
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(static_cast<uint16_t>(config_.port));
+  socklen_t addr_len = sizeof(addr);
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 16) != 0 ||
+      getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len) != 0) {
+    LOGE(CORE) << "MetricsExporter::Start() listen on port " << config_.port << " failed, " << strerror(errno);
+    close(fd);
+    return false;
+  }
+  collect_func_ = std::move(collect_func);
+  listen_fd_ = fd;
+  port_ = ntohs(addr.sin_port);
+  running_.store(true);
+  thread_ = std::thread(&MetricsExporter::Loop, this);
+  LOGI(CORE) << "Serving metrics at http://0.0.0.0:" << port_ << config_.path;
+  return true;
+}
+
+void MetricsExporter::Stop() {
+  if (!running_.exchange(false)) return;
+  if (thread_.joinable()) thread_.join();
+  close(listen_fd_);
+  listen_fd_ = -1;
+  port_ = 0;
+}
+
+void MetricsExporter::Loop() {
+  while (running_.load()) {
+    struct pollfd pfd = {listen_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, kPollIntervalMs) <= 0) continue;
+    int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) continue;
+    Serve(fd);
+    close(fd);
+  }
+}
+
+static bool ReadRequest(int fd, std::string* request) {
+  char buffer[1024];
+  while (request->find("\r\n\r\n") == std::string::npos) {
+    if (request->size() > kMaxRequestSize) return false;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, kRequestTimeoutMs) <= 0) return false;
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) return false;
+    request->append(buffer, n);
+  }
+  return true;
+}
+
+static void WriteAll(int fd, const std::string& data) {
+  size_t offset = 0;
+  while (offset < data.size()) {
+    ssize_t n = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return;
+    offset += n;
+  }
+}
+
+void MetricsExporter::Serve(int fd) {
+  std::string request;
+  if (!ReadRequest(fd, &request)) return;
+  // request line: method SP target SP version
+  const size_t method_end = request.find(' ');
+  const size_t target_end = method_end == std::string::npos ? method_end : request.find(' ', method_end + 1);
+  if (target_end == std::string::npos) return;
+  const std::string method = request.substr(0, method_end);
+  std::string target = request.substr(method_end + 1, target_end - method_end - 1);
+  target = target.substr(0, target.find('?'));
+
+  std::string status = "200 OK", content_type = kContentType, body;
+  if (method != "GET" && method != "HEAD") {
+    status = "405 Method Not Allowed";
+  } else if (target != config_.path) {
+    status = "404 Not Found";
+  } else {
+    body = collect_func_();
+  }
+  if (status[0] != '2') {
+    content_type = "text/plain; charset=utf-8";
+    body = status + "\n";
+  }
+  std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + content_type + "\r\nContent-Length: " +
+                         std::to_string(body.size()) + "\r\nConnection: close\r\n";
+  if (status[0] == '4' && status[2] == '5') response += "Allow: GET, HEAD\r\n";
+  response += "\r\n";
+  if (method != "HEAD") response += body;
+  WriteAll(fd, response);
+}
+
+}  // namespace cnstream
@@ -19,12 +19,16 @@
  *************************************************************************/
 #include "cnstream_module.hpp"
 
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <map>
+#include <vector>
 
 #include "cnstream_pipeline.hpp"
+#include "private/cnstream_affinity.hpp"
 #include "profiler/pipeline_profiler.hpp"
 
 namespace cnstream {
@@ -78,12 +82,20 @@ bool Module::PostEvent(Event e) {
   }
 }
 
-int Module::DoTransmitData(std::shared_ptr<CNFrameInfo> data) {
-  if (data->IsEos() && data->payload && IsStreamRemoved(data->stream_id)) {
+void Module::OnTransmitEos(const std::shared_ptr<CNFrameInfo>& data) {
+  if (data->IsEos() && data->payload) {
     // FIMXE
-    SetStreamRemoved(data->stream_id, false);
+    if (container_ && container_->IsStreamRemoved(data)) {
+      container_->SetStreamRemoved(data->stream_id, false);
+    } else if (!container_ && IsStreamRemoved(data->stream_id)) {
+      SetStreamRemoved(data->stream_id, false);
+    }
   }
+}
+
+int Module::DoTransmitData(std::shared_ptr<CNFrameInfo> data) {
   RwLockReadGuard guard(container_lock_);
+  OnTransmitEos(data);
   if (container_) {
     return container_->ProvideData(this, data);
   } else {
@@ -92,15 +104,25 @@ int Module::DoTransmitData(std::shared_ptr<CNFrameInfo> data) {
   }
 }
 
-int Module::DoProcess(std::shared_ptr<CNFrameInfo> data) {
-  bool removed = IsStreamRemoved(data->stream_id);
+bool Module::CheckDataRemoved(const std::shared_ptr<CNFrameInfo>& data) {
+  RwLockReadGuard guard(container_lock_);
+  bool removed = container_ ? container_->IsStreamRemoved(data) : IsStreamRemoved(data->stream_id);
   if (!removed) {
-    // For the case that module is implemented by a pipeline
+    // For the case that module is implemented by a pipeline, the payload belongs to the outer pipeline
     if (data->payload && IsStreamRemoved(data->payload->stream_id)) {
-      SetStreamRemoved(data->stream_id, true);
+      if (container_) {
+        container_->SetStreamRemoved(data->stream_id, true);
+      } else {
+        SetStreamRemoved(data->stream_id, true);
+      }
       removed = true;
     }
   }
+  return removed;
+}
+
+int Module::DoProcess(std::shared_ptr<CNFrameInfo> data) {
+  bool removed = CheckDataRemoved(data);
 
   if (!HasTransmit()) {
     if (!data->IsEos()) {
@@ -124,6 +146,40 @@ int Module::DoProcess(std::shared_ptr<CNFrameInfo> data) {
   return -1;
 }
 
+bool Module::BindThreadToCpus() const {
+  if (container_) container_->TagCurrentThread();
+  if (cpu_affinity_.empty()) return false;
+  return SetCurrentThreadAffinity(cpu_affinity_, numa_node_);
+}
+
+int Module::ProcessBatch(std::vector<std::shared_ptr<CNFrameInfo>>& data_vec) {  // NOLINT
+  for (auto& data : data_vec) {
+    int ret = Process(data);
+    if (ret < 0) return ret;
+  }
+  return 0;
+}
+
+int Module::DoProcessBatch(std::vector<std::shared_ptr<CNFrameInfo>>& data_vec) {  // NOLINT
+  std::vector<std::shared_ptr<CNFrameInfo>> batch;
+  batch.reserve(data_vec.size());
+  for (auto& data : data_vec) {
+    if (CheckDataRemoved(data)) {
+      if (!HasTransmit()) continue;
+      data->flags |= static_cast<size_t>(CNFrameFlag::CN_FRAME_FLAG_REMOVED);
+    }
+    batch.push_back(data);
+  }
+
+  int ret = batch.empty() ? 0 : ProcessBatch(batch);
+  if (HasTransmit()) return ret;
+  if (ret != 0) return ret;
+  for (auto& data : data_vec) {
+    DoTransmitData(data);
+  }
+  return 0;
+}
+
 bool Module::TransmitData(std::shared_ptr<CNFrameInfo> data) {
   if (!HasTransmit()) {
     return true;
@@ -134,6 +190,17 @@ bool Module::TransmitData(std::shared_ptr<CNFrameInfo> data) {
   return false;
 }
 
+bool Module::TransmitDataBatch(const std::vector<std::shared_ptr<CNFrameInfo>>& data_vec) {
+  if (!HasTransmit()) {
+    return true;
+  }
+  RwLockReadGuard guard(container_lock_);
+  for (const auto& data : data_vec) OnTransmitEos(data);
+  if (container_) return container_->ProvideDataBatch(this, data_vec);
+  for (const auto& data : data_vec) NotifyObserver(data);
+  return true;
+}
+
 ModuleProfiler* Module::GetProfiler() {
   RwLockReadGuard guard(container_lock_);
   if (container_ && container_->GetProfiler())
@@ -141,6 +208,90 @@ ModuleProfiler* Module::GetProfiler() {
   return nullptr;
 }
 
+int ModuleAsync::Process(std::shared_ptr<CNFrameInfo> data) {
+  if (!data) return -1;
+  const std::string stream_id = data->stream_id;
+  // the eos and the data of removed streams are completed right away
+  const bool eos = data->IsEos();
+  const bool done = eos || data->IsRemoved();
+  InflightData* inflight;
+  {
+    std::unique_lock<std::mutex> lk(inflight_mutex_);
+    if (!eos) {
+      if (max_inflight_ > 0) inflight_cond_.wait(lk, [this] { return inflight_num_ < max_inflight_; });
+      ++inflight_num_;
+    }
+    std::deque<InflightData>& queue = inflight_streams_[stream_id].queue;
+    queue.emplace_back();
+    inflight = &queue.back();
+    inflight->data = data;
+    inflight->done = done;
+  }
+  if (done) {
+    Drain(stream_id);
+  } else {
+    ProcessAsync(std::move(data), [this, stream_id, inflight](int ret) { Complete(stream_id, inflight, ret); });
+  }
+  return 1;
+}
+
+uint32_t ModuleAsync::GetInflightNum() const {
+  std::lock_guard<std::mutex> lk(inflight_mutex_);
+  return inflight_num_;
+}
+
+void ModuleAsync::Complete(const std::string& stream_id, InflightData* inflight, int ret) {
+  {
+    std::lock_guard<std::mutex> lk(inflight_mutex_);
+    inflight->done = true;
+    inflight->ret = ret;
+  }
+  Drain(stream_id);
+}
+
+void ModuleAsync::Drain(const std::string& stream_id) {
+  std::unique_lock<std::mutex> lk(inflight_mutex_);
+  auto search = inflight_streams_.find(stream_id);
+  if (search == inflight_streams_.end() || search->second.draining) return;
+  // the references to the elements of an unordered_map are kept when it rehashes, its iterators are not
+  InflightStream& stream = search->second;
+  stream.draining = true;
+  std::vector<InflightData> ready;
+  while (true) {
+    while (!stream.queue.empty() && stream.queue.front().done) {
+      ready.push_back(std::move(stream.queue.front()));
+      stream.queue.pop_front();
+    }
+    if (ready.empty()) break;
+    lk.unlock();
+    uint32_t completed = 0;
+    for (auto& it : ready) {
+      if (it.data->IsEos()) {
+        OnEos(stream_id);
+        TransmitData(it.data);
+        continue;
+      }
+      ++completed;
+      if (it.ret >= 0) {
+        TransmitData(it.data);
+        continue;
+      }
+      RwLockReadGuard guard(container_lock_);
+      if (container_) {
+        container_->ReportProcessFailed(this, it.data, it.ret);
+      } else {
+        LOGE(CORE) << "[" << GetName() << "] [" << stream_id << "] process failed, return number: " << it.ret;
+      }
+    }
+    ready.clear();
+    lk.lock();
+    inflight_num_ -= completed;
+    inflight_cond_.notify_all();
+  }
+  stream.draining = false;
+  if (stream.queue.empty()) inflight_streams_.erase(stream_id);
+}
+
 ModuleFactory* ModuleFactory::factory_ = nullptr;
 
 }  // namespace cnstream
@@ -0,0 +1,129 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "private/cnstream_parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace cnstream {
+
+namespace {
+
+thread_local bool tls_in_parallel_pool = false;
+
+class ParallelPool {
+ public:
+  static ParallelPool& Instance() {
+    // never destructed, the threads wait until the process exits.
+    static ParallelPool* pool = new ParallelPool;
+    return *pool;
+  }
+
+  void Submit(const std::function<void()>& task) {
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      tasks_.push(task);
+    }
+    cond_.notify_one();
+  }
+
+  int GetSize() const { return static_cast<int>(threads_.size()); }
+  std::atomic<int> thread_num{0};
+
+ private:
+  ParallelPool() {
+    // a small pool, the module threads are the main source of parallelism.
+    const int hw = static_cast<int>(std::thread::hardware_concurrency());
+    const int size = std::max(1, std::min(4, hw / 2));
+    for (int i = 0; i < size; ++i) threads_.emplace_back(&ParallelPool::Loop, this);
+    thread_num = size;
+  }
+
+  void Loop() {
+    tls_in_parallel_pool = true;
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lk(mtx_);
+        cond_.wait(lk, [this] { return !tasks_.empty(); });
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+      task();
+    }
+  }
+
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  std::queue<std::function<void()>> tasks_;
+  std::vector<std::thread> threads_;
+};  // class ParallelPool
+
+}  // namespace
+
+void ParallelFor(int total, int min_band, int align, const std::function<void(int begin, int end)>& func) {
+  if (total <= 0) return;
+  min_band = std::max(min_band, 1);
+  align = std::max(align, 1);
+  int band_num = total / min_band;
+  if (band_num >= 2 && !tls_in_parallel_pool) {
+    band_num = std::min(band_num, ParallelPool::Instance().thread_num.load() + 1);
+  }
+  if (band_num < 2 || tls_in_parallel_pool) {
+    func(0, total);
+    return;
+  }
+  const int band = ((total + band_num - 1) / band_num + align - 1) / align * align;
+
+  std::mutex mtx;
+  std::condition_variable cond;
+  int remaining = 0;
+  for (int begin = band; begin < total; begin += band) {
+    const int end = std::min(total, begin + band);
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      remaining++;
+    }
+    ParallelPool::Instance().Submit([&, begin, end] {
+      func(begin, end);
+      std::lock_guard<std::mutex> lk(mtx);
+      if (--remaining == 0) cond.notify_one();
+    });
+  }
+  func(0, std::min(total, band));
+  std::unique_lock<std::mutex> lk(mtx);
+  cond.wait(lk, [&] { return remaining == 0; });
+}
+
+void SetParallelThreadNum(int thread_num) {
+  ParallelPool& pool = ParallelPool::Instance();
+  pool.thread_num = std::max(0, std::min(thread_num, pool.GetSize()));
+}
+
+int GetParallelThreadNum() { return ParallelPool::Instance().thread_num.load(); }
+
+}  // namespace cnstream
@@ -21,13 +21,18 @@
 #include <assert.h>
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <map>
 #include <utility>
 #include <vector>
@@ -35,26 +40,111 @@
 #include "cnstream_graph.hpp"
 #include "cnstream_module.hpp"
 #include "cnstream_pipeline.hpp"
+#include "circuit_breaker.hpp"
 #include "connector.hpp"
 #include "conveyor.hpp"
+#include "cpu_isolation.hpp"
+#include "reorder_buffer.hpp"
+#include "work_stealing_scheduler.hpp"
+#include "private/cnstream_affinity.hpp"
+#include "private/cnstream_allocator.hpp"
 #include "profiler/module_profiler.hpp"
+#include "profiler/perf_counters.hpp"
 #include "profiler/pipeline_profiler.hpp"
+#include "profiler/pipeline_tracer.hpp"
 #include "util/cnstream_queue.hpp"
 
 namespace cnstream {
 
+/**
+ * @brief The degradation of a module, see DegradationConfig.
+ */
+struct DegradeSetting {
+  std::atomic<uint32_t> interval{1};  // one of every interval frames is processed, 0 means none
+  std::atomic<int> max_priority{0};   // the streams with higher priorities are not degraded
+};
+
 /**
  * @brief The node context used by pipeline.
  */
 struct NodeContext {
   std::shared_ptr<Module> module;
   std::shared_ptr<Connector> connector;
-  uint64_t parent_nodes_mask = 0;
-  uint64_t route_mask = 0;  // for head nodes
+  ModuleMask parent_nodes_mask;
+  ModuleMask route_mask;  // for head nodes
   // for gets node instance by a module, see Module::context_;
   std::weak_ptr<CNGraph<NodeContext>::CNNode> node;
+  // for work stealing mode, marks whether the job of each conveyor is queued or running.
+  std::unique_ptr<std::atomic<bool>[]> conveyor_scheduled;
+  uint32_t affinity_base = 0;  // affinity of the first conveyor
+  // for batch processing, see CNModuleConfig::maxBatchSize
+  uint32_t max_batch_size = 1;
+  std::chrono::microseconds batch_timeout{0};
+  // for autoscaling, see AutoscalerConfig. The task threads of a scaled module are indexed by conveyor.
+  bool autoscaled = false;
+  uint32_t parallelism = 1;
+  uint32_t min_parallelism = 1;
+  uint32_t max_parallelism = 1;
+  std::vector<std::thread> task_threads;
+  std::vector<bool> task_running;
+  QueueFullPolicy queue_full_policy = QueueFullPolicy::BLOCK;
+  // a fused node has no connector, it is processed on the thread transmitting data from its parent, see FusePolicy
+  bool fused = false;
+  // restores the order of the data of a stream processed in parallel, see CNModuleConfig::streamParallel
+  std::unique_ptr<ReorderBuffer> reorder;
+  // lets the frames bypass the module while it is slow or failing, see CNModuleConfig::circuitBreaker
+  std::unique_ptr<CircuitBreaker> breaker;
+  // lets the frames skip the module while the pipeline is degraded, see DegradationConfig
+  std::unique_ptr<DegradeSetting> degrade;
+};
+
+/**
+ * @brief A branch of modules attached to a running pipeline, see Pipeline::AttachBranch.
+ */
+struct PipelineBranch {
+  std::string name;  // the name of the head module
+  NodeContext* at = nullptr;  // the node of the graph which the branch is attached to
+  std::vector<CNModuleConfig> configs;
+  std::vector<std::unique_ptr<NodeContext>> nodes;  // in the order of configs, the first one is the head
+  std::vector<std::vector<size_t>> next;  // the indices of the next nodes of each node
+  std::vector<std::thread> threads;
+  bool detached = false;  // guarded by Pipeline::branch_mutex_, the branch is not routed once it is detached
+  std::mutex close_mutex;  // Pipeline::Stop and Pipeline::DetachBranch may close the branch at the same time
+  bool closed = false;
+  // the number of route tables including the branch, they are kept by the frames in flight. Pipeline::DetachBranch
+  // waits for them to be released.
+  uint32_t route_num = 0;
+  std::mutex route_mutex;
+  std::condition_variable route_cond;
 };
 
+/**
+ * @brief The routes of the frames. A frame keeps the table published when it enters the pipeline, the branches in it
+ * are kept alive until the frames are released.
+ */
+struct RouteTable {
+  ~RouteTable() {
+    for (const auto& branch : branches) {
+      std::lock_guard<std::mutex> lk(branch->route_mutex);
+      if (0 == --branch->route_num) branch->route_cond.notify_all();
+    }
+  }
+  ModuleMask all_modules_mask;
+  // modules reading the pixels or observed, see Module::NeedsPixels
+  ModuleMask pixel_modules_mask;
+  // modules reading the copy of the pixels on host or on device or observed, see Module::NeedsHostPixels
+  ModuleMask host_pixel_modules_mask;
+  ModuleMask device_pixel_modules_mask;
+  // indexed by the module id of head nodes, the modules reached from the head
+  std::vector<ModuleMask> route_masks;
+  // indexed by the module id, the nodes the frames are transmitted to
+  std::vector<std::vector<NodeContext*>> next_nodes;
+  std::vector<std::shared_ptr<PipelineBranch>> branches;
+};
+
+// the maximum number of data processed by one conveyor job in work stealing mode
+static constexpr int kMaxDataNumPerConveyorTask = 8;
+
 Pipeline::Pipeline(const std::string& name) : name_(name) {
   // stream message handle thread
   exit_msg_loop_ = false;
@@ -69,6 +159,10 @@ Pipeline::Pipeline(const std::string& name) : name_(name) {
 
   graph_.reset(new (std::nothrow) CNGraph<NodeContext>());
   LOGF_IF(CORE, nullptr == graph_) << "Pipeline::Pipeline() failed to alloc CNGraph";
+
+  stream_sequences_.reset(new std::atomic<int64_t>[MAX_STREAM_NUM]());
+  stream_max_latencies_.reset(new std::atomic<int64_t>[MAX_STREAM_NUM]);
+  for (uint32_t i = 0; i < MAX_STREAM_NUM; ++i) stream_max_latencies_[i].store(-1);
 }
 
 Pipeline::~Pipeline() {
@@ -77,9 +171,12 @@ Pipeline::~Pipeline() {
   if (smsg_thread_.joinable()) {
     smsg_thread_.join();
   }
+  degradation_.reset();  // undoes the steps applied to the modules
   event_bus_.reset();
   graph_.reset();  // must release before idxManager_;
   idxManager_.reset();
+  frame_pool_.reset();
+  if (memory_accounting_) MemoryAccountant::Instance().RemovePipeline(GetName());
 }
 
 bool Pipeline::BuildPipeline(const CNGraphConfig& graph_config) {
@@ -89,58 +186,293 @@ bool Pipeline::BuildPipeline(const CNGraphConfig& graph_config) {
     LOGE(CORE) << "Init graph failed.";
     return false;
   }
+  sorted_module_names_.clear();
+  return InitPipeline(nullptr);
+}
+
+bool Pipeline::BuildPipeline(const CNGraphPlan& plan) {
+  if (!graph_->Init(plan, GetName())) {
+    LOGE(CORE) << "Init graph by plan failed.";
+    return false;
+  }
+  sorted_module_names_.clear();
+  for (uint32_t idx : plan.topo_order) sorted_module_names_.push_back(GetName() + "/" + plan.nodes[idx].name);
+  return InitPipeline(&plan);
+}
+
+bool Pipeline::InitPipeline(const CNGraphPlan* plan) {
   // create modules by config
   if (!CreateModules()) {
     LOGE(CORE) << "Create modules failed.";
     return false;
   }
+  const FramePoolConfig& frame_pool_config = graph_->GetConfig().frame_pool_config;
+  if (frame_pool_config.enable) {
+    frame_pool_.reset(new (std::nothrow) CNFrameInfoPool(frame_pool_config.capacity,
+                                                          frame_pool_config.max_frames));
+    LOGF_IF(CORE, nullptr == frame_pool_) << "Pipeline::BuildPipeline() failed to alloc CNFrameInfoPool";
+  } else {
+    frame_pool_.reset();
+  }
+  const MemoryBudgetConfig& memory_budget_config = graph_->GetConfig().memory_budget_config;
+  memory_accounting_ = memory_budget_config.enable || IsProfilingEnabled();
+  if (memory_accounting_) {
+    MemoryAccountant& accountant = MemoryAccountant::Instance();
+    accountant.SetEnable(true);
+    const size_t mb = 1 << 20;
+    const bool enable = memory_budget_config.enable;
+    accountant.SetBudget(GetName(), MemoryType::HOST, enable ? memory_budget_config.host_mb * mb : 0);
+    accountant.SetBudget(GetName(), MemoryType::DEVICE, enable ? memory_budget_config.device_mb * mb : 0);
+    accountant.SetStreamBudget(GetName(), MemoryType::HOST, enable ? memory_budget_config.stream_host_mb * mb : 0);
+    accountant.SetStreamBudget(GetName(), MemoryType::DEVICE, enable ? memory_budget_config.stream_device_mb * mb : 0);
+  }
+  const AdmissionConfig& admission_config = graph_->GetConfig().admission_config;
+  if (admission_config.enable) {
+    admission_.reset(new (std::nothrow) AdmissionController(admission_config));
+    LOGF_IF(CORE, nullptr == admission_) << "Pipeline::BuildPipeline() failed to alloc AdmissionController";
+  } else {
+    admission_.reset();
+  }
+  const CheckpointConfig& checkpoint_config = graph_->GetConfig().checkpoint_config;
+  if (checkpoint_config.enable) {
+    checkpoint_.reset(new (std::nothrow) CheckpointStore(checkpoint_config.path, checkpoint_config.save_interval_ms));
+    LOGF_IF(CORE, nullptr == checkpoint_) << "Pipeline::BuildPipeline() failed to alloc CheckpointStore";
+    if (!checkpoint_->Load()) {
+      LOGE(CORE) << "Load checkpoints from " << checkpoint_config.path << " failed.";
+      return false;
+    }
+  } else {
+    checkpoint_.reset();
+  }
+  const CpuIsolationConfig& cpu_isolation_config = graph_->GetConfig().cpu_isolation_config;
+  if (cpu_isolation_config.enable || IsProfilingEnabled()) {
+    cpu_isolation_.reset(new (std::nothrow) CpuIsolation(cpu_isolation_config));
+    LOGF_IF(CORE, nullptr == cpu_isolation_) << "Pipeline::BuildPipeline() failed to alloc CpuIsolation";
+    CpuIsolation* cpu_isolation = cpu_isolation_.get();
+    profiler_->SetCpuUsageSampler([cpu_isolation] { return cpu_isolation->GetUsage(); });
+  } else {
+    cpu_isolation_.reset();
+    profiler_->SetCpuUsageSampler(nullptr);
+  }
   // generate parant mask for all nodes and route mask for head nodes.
-  GenerateModulesMask();
+  GenerateModulesMask(plan);
+  FuseModules();
+  if (!InitDegradation()) return false;
+  InitLatencyBreakdown();
+  perf_counters_ = IsProfilingEnabled() && profiler_->GetConfig().enable_perf_counters;
   // create connectors for all nodes beside head nodes.
   // This call must after GenerateModulesMask called,
   // then we can determine witch are the head nodes.
   return CreateConnectors();
 }
 
+bool Pipeline::OpenModules() {
+  struct OpenTask {
+    std::shared_ptr<Module> module;
+    const ModuleParamSet* params = nullptr;
+    std::vector<size_t> deps;  // see CNModuleConfig::openAfter
+    bool done = false;
+    bool opened = false;
+    double begin = 0;
+    double time = 0;
+  };
+  std::vector<OpenTask> tasks;
+  std::map<std::string, size_t> task_indices;
+  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
+    task_indices[node->GetFullName()] = tasks.size();
+    OpenTask task;
+    task.module = node->data.module;
+    task.params = &node->GetConfig().parameters;
+    tasks.push_back(std::move(task));
+  }
+  size_t idx = 0;
+  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node, ++idx) {
+    // the names in open_after are relative to the graph of the module
+    const std::string full_name = node->GetFullName();
+    const std::string prefix = full_name.substr(0, full_name.size() - node->GetName().size());
+    for (const auto& name : node->GetConfig().openAfter) {
+      auto iter = task_indices.find(prefix + name);
+      if (iter == task_indices.end() || iter->second == idx) {
+        LOGE(CORE) << "Module [" << full_name << "] is opened after [" << name
+                   << "], which is not another module in the same graph.";
+        return false;
+      }
+      tasks[idx].deps.push_back(iter->second);
+    }
+  }
+
+  // the modules are ordered by DFS, except that the dependencies of a module are moved before it
+  std::vector<size_t> order;
+  std::vector<bool> ordered(tasks.size(), false);
+  while (order.size() < tasks.size()) {
+    size_t next = tasks.size();
+    for (size_t i = 0; i < tasks.size() && next == tasks.size(); ++i) {
+      if (ordered[i]) continue;
+      const auto& deps = tasks[i].deps;
+      if (std::all_of(deps.begin(), deps.end(), [&](size_t dep) { return ordered[dep]; })) next = i;
+    }
+    if (next == tasks.size()) {
+      LOGE(CORE) << "Pipeline[" << GetName() << "] The open_after of modules forms a cycle.";
+      return false;
+    }
+    ordered[next] = true;
+    order.push_back(next);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  auto open = [&start](OpenTask* task) {
+    const auto begin = std::chrono::steady_clock::now();
+    task->opened = task->module->Open(*task->params);
+    const auto end = std::chrono::steady_clock::now();
+    task->begin = std::chrono::duration<double, std::milli>(begin - start).count();
+    task->time = std::chrono::duration<double, std::milli>(end - begin).count();
+    if (!task->opened) LOGE(CORE) << task->module->GetName() << " open failed!";
+  };
+  if (!graph_->GetConfig().scheduler_config.parallel_open) {
+    for (size_t i : order) {
+      open(&tasks[i]);
+      if (!tasks[i].opened) break;
+    }
+  } else {
+    // every module waits for its dependencies on its own thread, a failure stops the modules not opened yet
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool failed = false;
+    std::vector<std::thread> threads;
+    for (auto& it : tasks) {
+      OpenTask* task = &it;
+      threads.emplace_back([&, task]() {
+        {
+          std::unique_lock<std::mutex> lk(mtx);
+          cond.wait(lk, [&]() {
+            return failed || std::all_of(task->deps.begin(), task->deps.end(),
+                                         [&](size_t dep) { return tasks[dep].done; });
+          });
+          if (failed) return;
+        }
+        open(task);
+        {
+          std::lock_guard<std::mutex> lk(mtx);
+          task->done = true;
+          if (!task->opened) failed = true;
+        }
+        cond.notify_all();
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+  const double startup_time =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  if (!std::all_of(tasks.begin(), tasks.end(), [](const OpenTask& task) { return task.opened; })) {
+    for (size_t i : order) {
+      if (tasks[i].opened) tasks[i].module->Close();
+    }
+    return false;
+  }
+  if (profiler_) {
+    profiler_->RecordStartup(startup_time);
+    for (const auto& task : tasks) {
+      ModuleProfiler* module_profiler = profiler_->GetModuleProfiler(task.module->GetName());
+      if (module_profiler) module_profiler->RecordOpen(task.begin, task.time);
+    }
+  }
+  LOGI(CORE) << "Pipeline[" << GetName() << "] " << tasks.size() << " modules opened in " << startup_time << " ms";
+  return true;
+}
+
 bool Pipeline::Start() {
   if (IsRunning()) {
     LOGW(CORE) << "Pipeline is running, the Pipeline::Start function is called multiple times.";
     return false;
   }
 
+  // before opening modules, which may start threads. The pipeline runs without the weight if it is not written.
+  if (cpu_isolation_) cpu_isolation_->Apply();
   // open modules
-  bool open_module_failed = false;
-  std::vector<std::shared_ptr<Module>> opened_modules;
-  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
-    if (!node->data.module->Open(node->GetConfig().parameters)) {
-      LOGE(CORE) << node->data.module->GetName() << " open failed!";
-      open_module_failed = true;
-      break;
-    }
-    opened_modules.push_back(node->data.module);
-  }
-  if (open_module_failed) {
-    for (auto it : opened_modules) it->Close();
-    return false;
+  if (!OpenModules()) return false;
+
+
+  {
+    std::lock_guard<std::mutex> lk(branch_mutex_);
+    UpdateRoutes();
   }
 
   running_.store(true);
   event_bus_->Start();
 
+  {
+    // the overrides of the streams added before the modules are opened
+    std::lock_guard<std::mutex> lk(stream_params_mtx_);
+    std::map<std::string, StreamParamOverrides> streams;
+    for (const auto& it : stream_params_) streams[it.first];
+    for (const auto& it : stream_tags_) streams[it.first];
+    UpdateStreamParams(streams);
+  }
+
   // start data transmit
   for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
-    if (!node->data.parent_nodes_mask) continue;  // head node
+    if (!node->data.connector) continue;  // head node or fused node
     node->data.connector->Start();
+    if (node->data.reorder) node->data.reorder->Clear();
   }
 
-  // create process threads
-  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
-    if (!node->data.parent_nodes_mask) continue;  // head node
-    const auto& config = node->GetConfig();
-    for (int conveyor_idx = 0; conveyor_idx < config.parallelism; ++conveyor_idx) {
-      threads_.push_back(std::thread(&Pipeline::TaskLoop, this, &node->data, conveyor_idx));
+  const SchedulerConfig& scheduler_config = graph_->GetConfig().scheduler_config;
+  if (scheduler_config.work_stealing) {
+    // conveyors are processed by jobs of the scheduler
+    scheduler_.reset(new (std::nothrow) WorkStealingScheduler(scheduler_config.thread_num));
+    LOGF_IF(CORE, nullptr == scheduler_) << "Pipeline::Start() failed to alloc WorkStealingScheduler";
+    uint32_t affinity = 0;
+    for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
+      if (!node->data.connector) continue;  // head node or fused node
+      const int parallelism = node->GetConfig().parallelism;
+      node->data.conveyor_scheduled.reset(new std::atomic<bool>[parallelism]);
+      for (int conveyor_idx = 0; conveyor_idx < parallelism; ++conveyor_idx) {
+        node->data.conveyor_scheduled[conveyor_idx].store(false);
+      }
+      node->data.affinity_base = affinity;
+      affinity += parallelism;
+    }
+    scheduler_->Start([this] { TagCurrentThread(); });
+    LOGI(CORE) << "Pipeline[" << GetName() << "] " << "Work stealing scheduler started with "
+               << scheduler_->GetThreadNum() << " threads";
+  } else {
+    // create process threads
+    bool autoscaled = false;
+    for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
+      if (!node->data.connector) continue;  // head node or fused node
+      const auto& config = node->GetConfig();
+      if (node->data.autoscaled) {
+        autoscaled = true;
+        std::lock_guard<std::mutex> lk(autoscale_mtx_);
+        node->data.parallelism = config.parallelism;
+        node->data.connector->SetActiveConveyorNum(config.parallelism);
+        node->data.task_threads.resize(node->data.max_parallelism);
+        node->data.task_running.assign(node->data.max_parallelism, false);
+        for (int conveyor_idx = 0; conveyor_idx < config.parallelism; ++conveyor_idx) {
+          StartTaskLoop(&node->data, conveyor_idx);
+        }
+        continue;
+      }
+      for (int conveyor_idx = 0; conveyor_idx < config.parallelism; ++conveyor_idx) {
+        threads_.push_back(std::thread(&Pipeline::TaskLoop, this, &node->data, conveyor_idx));
+      }
+    }
+    if (autoscaled) {
+      autoscaler_.reset(new (std::nothrow) Autoscaler(graph_->GetConfig().autoscaler_config));
+      LOGF_IF(CORE, nullptr == autoscaler_) << "Pipeline::Start() failed to alloc Autoscaler";
+      autoscaler_->Start(std::bind(&Pipeline::SampleModules, this),
+                         std::bind(&Pipeline::ScaleModule, this, std::placeholders::_1, std::placeholders::_2));
     }
   }
+  if (admission_) admission_->Start(std::bind(&Pipeline::SampleAdmission, this));
+  if (degradation_) degradation_->Start(std::bind(&Pipeline::SampleDegradation, this));
+  if (graph_->GetConfig().metrics_config.enable) {
+    // the pipeline runs without the metrics if the port is not available
+    metrics_exporter_.reset(new (std::nothrow) MetricsExporter(graph_->GetConfig().metrics_config));
+    LOGF_IF(CORE, nullptr == metrics_exporter_) << "Pipeline::Start() failed to alloc MetricsExporter";
+    if (!metrics_exporter_->Start(std::bind(&Pipeline::GetMetrics, this))) metrics_exporter_.reset();
+  }
   LOGI(CORE) << "Pipeline[" << GetName() << "] " << "Start";
   return true;
 }
@@ -148,9 +480,13 @@ bool Pipeline::Start() {
 bool Pipeline::Stop() {
   if (!IsRunning()) return true;
 
+  if (autoscaler_) autoscaler_->Stop();
+  if (admission_) admission_->Stop();
+  if (degradation_) degradation_->Stop();
+  metrics_exporter_.reset();
+
   // stop data transmit
   for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
-    if (!node->data.parent_nodes_mask) continue;  // head node
     auto connector = node->data.connector;
     if (connector) {
       // push data will be rejected after Stop()
@@ -159,17 +495,56 @@ bool Pipeline::Stop() {
       connector->EmptyDataQueue();
     }
   }
+  {
+    std::lock_guard<std::mutex> lk(branch_mutex_);
+    for (const auto& it : branches_) {
+      for (const auto& context : it.second->nodes) context->connector->Stop();
+    }
+  }
   running_.store(false);
   for (std::thread& it : threads_) {
     if (it.joinable()) it.join();
   }
   threads_.clear();
+  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
+    for (std::thread& it : node->data.task_threads) {
+      if (it.joinable()) it.join();
+    }
+    node->data.task_threads.clear();
+    node->data.task_running.clear();
+  }
+  // the branches are closed before the scheduler stops, their conveyor jobs may be queued. No branch is attached
+  // once the pipeline is not running.
+  std::map<std::string, std::shared_ptr<PipelineBranch>> branches;
+  {
+    std::lock_guard<std::mutex> lk(branch_mutex_);
+    branches.swap(branches_);
+    std::atomic_store(&routes_, std::shared_ptr<const RouteTable>());
+  }
+  for (const auto& it : branches) {
+    {
+      // DetachBranch does not wait for the frames in flight once the pipeline is not running
+      std::lock_guard<std::mutex> lk(it.second->route_mutex);
+      it.second->route_cond.notify_all();
+    }
+    CloseBranch(it.second.get());
+  }
+  if (scheduler_) {
+    scheduler_->Stop();
+    scheduler_.reset();
+  }
   event_bus_->Stop();
+  // the messages of the events dispatched above are passed to the observer, e.g. an error before the EOS
+  if (std::this_thread::get_id() != smsg_thread_.get_id()) {
+    std::unique_lock<std::mutex> lk(msg_mtx_);
+    msg_cond_.wait(lk, [this] { return 0 == pending_msg_num_; });
+  }
 
   // close modules
   for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
     node->data.module->Close();
   }
+  if (checkpoint_) checkpoint_->Save();
 
   // clear callback function, important! Especially for the case of using the python api,
   // the callback function will manage the life cycle of a python object.
@@ -179,19 +554,353 @@ bool Pipeline::Stop() {
   return true;
 }
 
+/* Gets the cpus assigned to a module, see CNModuleConfig::cpuAffinity and CNModuleConfig::numaNode.
+ * Returns the NUMA node of the cpus, or -1. */
+static int GetModuleCpus(const CNModuleConfig& config, std::vector<int>* cpus) {
+  cpus->clear();
+  if (!config.cpuAffinity.empty()) {
+    *cpus = config.cpuAffinity;
+    return -1;
+  }
+  int numa_node = config.numaNode;
+  if (numa_node < 0 && GetNumaNodeNum() > 1) {
+    auto iter = config.parameters.find("device_id");
+    if (iter != config.parameters.end()) {
+      numa_node = GetMluNumaNode(std::atoi(iter->second.c_str()));
+    }
+  }
+  if (numa_node < 0) return -1;
+  *cpus = GetNumaNodeCpus(numa_node);
+  if (cpus->empty()) {
+    LOGW(CORE) << "[" << config.name << "]: NUMA node " << numa_node << " has no cpus, threads are not bound.";
+    return -1;
+  }
+  LOGI(CORE) << "[" << config.name << "]: threads are bound to NUMA node " << numa_node;
+  return numa_node;
+}
+
 Module* Pipeline::GetModule(const std::string& module_name) const {
   auto node = graph_->GetNodeByName(module_name);
   if (node.get()) return node->data.module.get();
+  std::lock_guard<std::mutex> lk(branch_mutex_);
+  for (const auto& it : branches_) {
+    const PipelineBranch& branch = *it.second;
+    for (size_t i = 0; i < branch.nodes.size(); ++i) {
+      const auto& module = branch.nodes[i]->module;
+      if (branch.configs[i].name == module_name || module->GetName() == module_name) return module.get();
+    }
+  }
   return nullptr;
 }
 
 CNModuleConfig Pipeline::GetModuleConfig(const std::string& module_name) const {
   auto node = graph_->GetNodeByName(module_name);
   if (node.get()) return node->GetConfig();
+  std::lock_guard<std::mutex> lk(branch_mutex_);
+  for (const auto& it : branches_) {
+    const PipelineBranch& branch = *it.second;
+    for (size_t i = 0; i < branch.nodes.size(); ++i) {
+      if (branch.configs[i].name == module_name || branch.nodes[i]->module->GetName() == module_name) {
+        return branch.configs[i];
+      }
+    }
+  }
   return {};
 }
 
+bool Pipeline::AttachBranch(const std::string& module_name, const std::vector<CNModuleConfig>& module_configs) {
+  if (!IsRunning()) {
+    LOGE(CORE) << "Pipeline[" << GetName() << "] Attach branch failed, pipeline is not running.";
+    return false;
+  }
+  if (module_configs.empty()) {
+    LOGE(CORE) << "Pipeline[" << GetName() << "] Attach branch failed, the branch has no modules.";
+    return false;
+  }
+  auto at = graph_->GetNodeByName(module_name);
+  if (!at.get()) {
+    LOGE(CORE) << "Pipeline[" << GetName() << "] Attach branch failed, module [" << module_name
+               << "] is not a module in the graph.";
+    return false;
+  }
+
+  std::shared_ptr<PipelineBranch> branch = std::make_shared<PipelineBranch>();
+  branch->name = module_configs[0].name;
+  branch->at = &at->data;
+  branch->configs = module_configs;
+  std::map<std::string, size_t> indices;
+  for (size_t i = 0; i < module_configs.size(); ++i) {
+    const CNModuleConfig& config = module_configs[i];
+    if (config.name.empty() || !indices.emplace(config.name, i).second || GetModule(config.name) ||
+        GetModule(GetName() + "/" + config.name)) {
+      LOGE(CORE) << "Pipeline[" << GetName() << "] Attach branch failed, module name [" << config.name
+                 << "] is empty or not unique in the pipeline.";
+      return false;
+    }
+    if (config.parallelism <= 0 || config.maxInputQueueSize <= 0) {
+      LOGE(CORE) << "Module [" << config.name << "]: parallelism or max_input_queue_size is not valid, "
+                 "parallelism[" << config.parallelism << "], "
+                 "max_input_queue_size[" << config.maxInputQueueSize << "].";
+      return false;
+    }
+    if (config.queueType == InputQueueType::LOCK_FREE && config.queueFullPolicy == QueueFullPolicy::DROP_OLDEST) {
+      LOGE(CORE) << "Module [" << config.name << "]: queue_full_policy [drop_oldest] is not supported by "
+                 "queue_type [lock_free].";
+      return false;
+    }
+  }
+  // the modules are reached from the head without cycles
+  std::vector<size_t> in_degrees(module_configs.size(), 0);
+  branch->next.resize(module_configs.size());
+  for (size_t i = 0; i < module_configs.size(); ++i) {
+    for (const auto& name : module_configs[i].next) {
+      auto iter = indices.find(name);
+      if (iter == indices.end() || iter->second == 0) {
+        LOGE(CORE) << "Pipeline[" << GetName() << "] Attach branch failed, the next module [" << name << "] of ["
+                   << module_configs[i].name << "] is not a module in the branch except the head.";
+        return false;
+      }
+      branch->next[i].push_back(iter->second);
+      ++in_degrees[iter->second];
+    }
+  }
+  std::vector<size_t> sorted = {0};
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    for (size_t next : branch->next[sorted[i]]) {
+      if (--in_degrees[next] == 0) sorted.push_back(next);
+    }
+  }
+  if (sorted.size() != module_configs.size()) {
+    LOGE(CORE) << "Pipeline[" << GetName() << "] Attach branch failed, the modules of branch [" << branch->name
+               << "] are not all reached from the head, or they form a cycle.";
+    return false;
+  }
+
+  // create modules
+  for (size_t i = 0; i < module_configs.size(); ++i) {
+    const CNModuleConfig& config = module_configs[i];
+    Module* module = ModuleFactory::Instance()->Create(config.className, GetName() + "/" + config.name);
+    if (!module) {
+      LOGE(CORE) << "Create module failed, module name : [" << config.name
+          << "], class name : [" << config.className << "].";
+      return false;
+    }
+    std::unique_ptr<NodeContext> context(new NodeContext());
+    context->module = std::shared_ptr<Module>(module);
+    module->context_ = context.get();
+    module->SetContainer(this);
+    if (module->GetId() == INVALID_MODULE_ID) {
+      LOGE(CORE) << "Create module failed, module name : [" << config.name << "], the number of modules exceeds "
+          << GetMaxModuleNumber() << ". Rebuild with a larger CNS_MAX_MODULE_NUM.";
+      return false;
+    }
+    module->numa_node_ = GetModuleCpus(config, &module->cpu_affinity_);
+    context->parallelism = context->min_parallelism = context->max_parallelism = config.parallelism;
+    context->connector = std::make_shared<Connector>(config.parallelism, config.maxInputQueueSize, config.queueType);
+    context->max_batch_size = std::max<uint32_t>(config.maxBatchSize, 1);
+    context->batch_timeout = std::chrono::microseconds(config.batchTimeoutUs);
+    context->queue_full_policy = config.queueFullPolicy;
+    if (config.streamParallel) context->reorder.reset(new ReorderBuffer(MAX_STREAM_NUM, config.orderedOutput));
+    CreateCircuitBreaker(context.get(), config);
+    branch->nodes.push_back(std::move(context));
+  }
+  branch->nodes[0]->parent_nodes_mask.Set(branch->at->module->GetId());
+  for (size_t i = 0; i < branch->next.size(); ++i) {
+    for (size_t next : branch->next[i]) branch->nodes[next]->parent_nodes_mask.Set(branch->nodes[i]->module->GetId());
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(branch_mutex_);
+    if (!IsRunning() || branches_.count(branch->name)) {
+      LOGE(CORE) << "Pipeline[" << GetName() << "] Attach branch failed, pipeline is stopped or branch ["
+                 << branch->name << "] is attached by another call.";
+      return false;
+    }
+    // the branch is not routed until its modules are opened, the modules may get their configurations in Open.
+    branch->detached = true;
+    branches_[branch->name] = branch;
+  }
+  // Stop closes the branch after the modules are opened
+  std::lock_guard<std::mutex> close_lk(branch->close_mutex);
+  auto remove_branch = [this, &branch]() {
+    std::lock_guard<std::mutex> lk(branch_mutex_);
+    auto iter = branches_.find(branch->name);
+    if (iter != branches_.end() && iter->second == branch) branches_.erase(iter);
+    branch->closed = true;
+  };
+  // open modules, the downstream modules first
+  for (auto iter = sorted.rbegin(); iter != sorted.rend(); ++iter) {
+    if (branch->nodes[*iter]->module->Open(module_configs[*iter].parameters)) continue;
+    LOGE(CORE) << branch->nodes[*iter]->module->GetName() << " open failed!";
+    for (auto opened = sorted.rbegin(); opened != iter; ++opened) branch->nodes[*opened]->module->Close();
+    remove_branch();
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lk(branch_mutex_);
+  auto iter = branches_.find(branch->name);
+  if (iter == branches_.end() || iter->second != branch) {
+    LOGE(CORE) << "Pipeline[" << GetName() << "] Attach branch failed, pipeline is stopped.";
+    for (const auto& context : branch->nodes) context->module->Close();
+    branch->closed = true;
+    return false;
+  }
+  for (const auto& context : branch->nodes) context->connector->Start();
+  if (scheduler_) {
+    // the conveyors share the affinities of the scheduler workers with the modules in the graph
+    uint32_t affinity = 0;
+    for (const auto& context : branch->nodes) {
+      const uint32_t parallelism = context->parallelism;
+      context->conveyor_scheduled.reset(new std::atomic<bool>[parallelism]);
+      for (uint32_t conveyor_idx = 0; conveyor_idx < parallelism; ++conveyor_idx) {
+        context->conveyor_scheduled[conveyor_idx].store(false);
+      }
+      context->affinity_base = affinity;
+      affinity += parallelism;
+    }
+  } else {
+    for (const auto& context : branch->nodes) {
+      for (uint32_t conveyor_idx = 0; conveyor_idx < context->parallelism; ++conveyor_idx) {
+        branch->threads.push_back(std::thread(&Pipeline::TaskLoop, this, context.get(), conveyor_idx));
+      }
+    }
+  }
+  branch->detached = false;
+  UpdateRoutes();
+  LOGI(CORE) << "Pipeline[" << GetName() << "] Branch [" << branch->name << "] is attached to [" << module_name << "]";
+  return true;
+}
+
+bool Pipeline::DetachBranch(const std::string& branch_name) {
+  std::shared_ptr<PipelineBranch> branch;
+  {
+    std::lock_guard<std::mutex> lk(branch_mutex_);
+    auto iter = branches_.find(branch_name);
+    if (iter == branches_.end() || iter->second->detached) {
+      LOGE(CORE) << "Pipeline[" << GetName() << "] Detach branch failed, there is no branch named [" << branch_name
+                 << "].";
+      return false;
+    }
+    branch = iter->second;
+    branch->detached = true;
+    UpdateRoutes();
+  }
+  // the routes held by the frames in flight include the branch, it is closed after they are released.
+  {
+    std::unique_lock<std::mutex> lk(branch->route_mutex);
+    branch->route_cond.wait(lk, [&] { return 0 == branch->route_num || !IsRunning(); });
+  }
+  CloseBranch(branch.get());
+  {
+    std::lock_guard<std::mutex> lk(branch_mutex_);
+    auto iter = branches_.find(branch_name);
+    if (iter != branches_.end() && iter->second == branch) branches_.erase(iter);
+  }
+  LOGI(CORE) << "Pipeline[" << GetName() << "] Branch [" << branch_name << "] is detached";
+  return true;
+}
+
+void Pipeline::CloseBranch(PipelineBranch* branch) {
+  std::lock_guard<std::mutex> lk(branch->close_mutex);
+  if (branch->closed) return;
+  branch->closed = true;
+  for (const auto& context : branch->nodes) {
+    context->connector->Stop();
+    context->connector->EmptyDataQueue();
+  }
+  for (std::thread& it : branch->threads) {
+    if (it.joinable()) it.join();
+  }
+  branch->threads.clear();
+  for (const auto& context : branch->nodes) {
+    if (!context->conveyor_scheduled) continue;
+    for (uint32_t conveyor_idx = 0; conveyor_idx < context->parallelism; ++conveyor_idx) {
+      while (context->conveyor_scheduled[conveyor_idx].load()) std::this_thread::yield();
+    }
+    context->conveyor_scheduled.reset();
+  }
+  for (const auto& context : branch->nodes) {
+    context->module->Close();
+    // the frames released after the pipeline may hold the branch
+    ReturnModuleIdx(context->module->GetId());
+    context->module->SetContainer(nullptr);
+  }
+}
+
+void Pipeline::UpdateRoutes() {
+  std::shared_ptr<RouteTable> routes = std::make_shared<RouteTable>();
+  routes->all_modules_mask = all_modules_mask_;
+  auto add_node = [&routes](NodeContext* context) {
+    const size_t id = context->module->GetId();
+    if (routes->next_nodes.size() <= id) {
+      routes->next_nodes.resize(id + 1);
+      routes->route_masks.resize(id + 1);
+    }
+    // the pixels of a frame are released once it has passed all modules reading them. the observers and the frame
+    // done callback may read the pixels as well, so that the pixels are kept for them.
+    const auto& module = context->module;
+    bool observed = false;
+    {
+      RwLockReadGuard guard(module->observer_lock_);
+      observed = module->observer_ != nullptr;
+    }
+    if (observed || module->NeedsPixels()) {
+      routes->pixel_modules_mask.Set(id);
+      if (observed || module->NeedsHostPixels()) routes->host_pixel_modules_mask.Set(id);
+      if (observed || module->NeedsDevicePixels()) routes->device_pixel_modules_mask.Set(id);
+    }
+    routes->route_masks[id] = context->route_mask;
+    return id;
+  };
+  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
+    const size_t id = add_node(&node->data);
+    for (const auto& next : node->GetNext()) routes->next_nodes[id].push_back(&next->data);
+  }
+  for (const auto& it : branches_) {
+    const PipelineBranch& branch = *it.second;
+    if (branch.detached) continue;
+    ModuleMask branch_mask;
+    for (size_t i = 0; i < branch.nodes.size(); ++i) add_node(branch.nodes[i].get());
+    for (size_t i = 0; i < branch.nodes.size(); ++i) {
+      branch_mask.Set(branch.nodes[i]->module->GetId());
+      for (size_t next : branch.next[i]) {
+        routes->next_nodes[branch.nodes[i]->module->GetId()].push_back(branch.nodes[next].get());
+      }
+    }
+    const size_t at_id = branch.at->module->GetId();
+    routes->next_nodes[at_id].push_back(branch.nodes[0].get());
+    routes->all_modules_mask |= branch_mask;
+    // the frames of the heads reaching the node pass through the branch, the others skip it
+    for (auto& route_mask : routes->route_masks) {
+      if (route_mask.Test(at_id)) route_mask |= branch_mask;
+    }
+    {
+      std::lock_guard<std::mutex> lk(it.second->route_mutex);
+      it.second->route_num++;
+    }
+    routes->branches.push_back(it.second);
+  }
+  std::atomic_store(&routes_, std::shared_ptr<const RouteTable>(std::move(routes)));
+}
+
 bool Pipeline::ProvideData(const Module* module, std::shared_ptr<CNFrameInfo> data) {
+  if (!CheckProvidedData(module, data)) return false;
+  TransmitData(module->context_, data);
+  return true;
+}
+
+bool Pipeline::ProvideDataBatch(const Module* module, const std::vector<std::shared_ptr<CNFrameInfo>>& data_vec) {
+  for (const auto& data : data_vec) {
+    if (!CheckProvidedData(module, data)) return false;
+  }
+  std::vector<ConveyorPush> pushes;
+  pushes.reserve(data_vec.size());
+  for (const auto& data : data_vec) TransmitData(module->context_, data, &pushes);
+  PushData(&pushes);
+  return true;
+}
+
+bool Pipeline::CheckProvidedData(const Module* module, const std::shared_ptr<CNFrameInfo>& data) {
   // check running.
   if (!IsRunning()) {
     LOGE(CORE) << "[" << module->GetName() << "]" << " Provide data to pipeline [" << GetName() << "] failed, "
@@ -206,32 +915,55 @@ bool Pipeline::ProvideData(const Module* module, std::shared_ptr<CNFrameInfo> da
     return false;
   }
   // data can only created by root nodes.
-  if (!data->GetModulesMask() && module->context_->parent_nodes_mask) {
+  if (!data->GetModulesMask().Any() && module->context_->parent_nodes_mask.Any()) {
     LOGE(CORE) << "Provide data to pipeline [" << GetName() << "] failed, "
         << "Data created by module named [" << module->GetName() << "]. "
         << "Data can be provided to pipeline only when the data is created by root nodes.";
     return false;
   }
-  TransmitData(module->context_, data);
   return true;
 }
 
+void Pipeline::ReportProcessFailed(const Module* module, const std::shared_ptr<CNFrameInfo>& data, int ret) {
+  if (!module || module->GetContainer() != this || !module->context_) return;
+  OnProcessFailed(module->context_, data, ret);
+}
+
+void Pipeline::NotifyStreamAdded(Module* source, const std::string& stream_id) {
+  if (!IsRunning() || !source->context_) return;
+  auto node = source->context_->node.lock();
+  if (!node) return;
+  for (auto iter = node->DFSBegin(); iter != node->DFSEnd(); ++iter) {
+    if (iter->data.module.get() != source) iter->data.module->OnStreamAdded(stream_id);
+  }
+}
+
 bool Pipeline::IsRootNode(const std::string& module_name) const {
   auto module = GetModule(module_name);
   if (!module) return false;
-  return !module->context_->parent_nodes_mask;
+  return !module->context_->parent_nodes_mask.Any();
 }
 
 bool Pipeline::IsLeafNode(const std::string& module_name) const {
   auto module = GetModule(module_name);
   if (!module) return false;
-  return module->context_->node.lock()->GetNext().empty();
+  auto node = module->context_->node.lock();
+  if (node) return node->GetNext().empty();
+  // a module of a branch
+  std::shared_ptr<const RouteTable> routes = std::atomic_load(&routes_);
+  return !routes || module->GetId() >= routes->next_nodes.size() || routes->next_nodes[module->GetId()].empty();
+}
+
+bool Pipeline::IsFusedNode(const std::string& module_name) const {
+  auto module = GetModule(module_name);
+  if (!module) return false;
+  return module->context_->fused;
 }
 
 bool Pipeline::CreateModules() {
   std::vector<std::shared_ptr<Module>> modules;  // used to init profiler
 
-  all_modules_mask_ = 0;
+  all_modules_mask_ = ModuleMask();
   for (auto node_iter = graph_->DFSBegin(); node_iter != graph_->DFSEnd(); ++node_iter) {
     const CNModuleConfig& config = node_iter->GetConfig();
     // use GetFullName with a graph name prefix to create modules to prevent nodes with the same name in subgraphs.
@@ -243,12 +975,18 @@ bool Pipeline::CreateModules() {
     }
     module->context_ = &node_iter->data;
     node_iter->data.node = *node_iter;
-    node_iter->data.parent_nodes_mask = 0;
-    node_iter->data.route_mask = 0;
+    node_iter->data.parent_nodes_mask = ModuleMask();
+    node_iter->data.route_mask = ModuleMask();
     node_iter->data.module = std::shared_ptr<Module>(module);
     node_iter->data.module->SetContainer(this);
+    if (node_iter->data.module->GetId() == INVALID_MODULE_ID) {
+      LOGE(CORE) << "Create module failed, module name : [" << config.name << "], the number of modules exceeds "
+          << GetMaxModuleNumber() << ". Rebuild with a larger CNS_MAX_MODULE_NUM.";
+      return false;
+    }
+    module->numa_node_ = GetModuleCpus(config, &module->cpu_affinity_);
     modules.push_back(node_iter->data.module);
-    all_modules_mask_ |= 1UL << node_iter->data.module->GetId();
+    all_modules_mask_.Set(node_iter->data.module->GetId());
   }
 
   profiler_.reset(new PipelineProfiler(graph_->GetConfig().profiler_config, GetName(), modules,
@@ -263,12 +1001,25 @@ std::vector<std::string> Pipeline::GetSortedModuleNames() {
   return sorted_module_names_;
 }
 
-void Pipeline::GenerateModulesMask() {
+void Pipeline::GenerateModulesMask(const CNGraphPlan* plan) {
+  if (plan) {
+    // the modules are created in the order of the nodes of the plan
+    std::vector<NodeContext*> contexts;
+    for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) contexts.push_back(&node->data);
+    for (size_t idx = 0; idx < contexts.size(); ++idx) {
+      for (uint32_t parent : plan->nodes[idx].parents) {
+        contexts[idx]->parent_nodes_mask.Set(contexts[parent]->module->GetId());
+      }
+      for (uint32_t route : plan->nodes[idx].routes) contexts[idx]->route_mask.Set(contexts[route]->module->GetId());
+    }
+    return;
+  }
+
   // parent mask helps to determine whether the data has passed all the parent nodes.
   for (auto cur_node = graph_->DFSBegin(); cur_node != graph_->DFSEnd(); ++cur_node) {
     const auto& next_nodes = cur_node->GetNext();
     for (const auto& next : next_nodes) {
-      next->data.parent_nodes_mask |= 1UL << cur_node->data.module->GetId();
+      next->data.parent_nodes_mask.Set(cur_node->data.module->GetId());
     }
   }
 
@@ -276,14 +1027,78 @@ void Pipeline::GenerateModulesMask() {
   // consider the case of multiple head nodes. (multiple source modules)
   for (auto head : graph_->GetHeads()) {
     for (auto iter = head->DFSBegin(); iter != head->DFSEnd(); ++iter) {
-      head->data.route_mask |= 1UL << iter->data.module->GetId();
+      head->data.route_mask.Set(iter->data.module->GetId());
+    }
+  }
+}
+
+void Pipeline::FuseModules() {
+  const CNGraphConfig& graph_config = graph_->GetConfig();
+  std::map<const NodeContext*, std::vector<const CNGraph<NodeContext>::CNNode*>> parents;
+  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
+    node->data.fused = false;
+    for (const auto& next : node->GetNext()) parents[&next->data].push_back((*node).get());
+  }
+  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
+    const CNModuleConfig& config = node->GetConfig();
+    if (config.fusePolicy == FusePolicy::NEVER) continue;
+    if (config.fusePolicy == FusePolicy::AUTO && !node->data.module->IsFusable()) continue;
+    const auto& node_parents = parents[&node->data];
+    // the data of the stage is transmitted to the module only, and the module can not be fed by the data of
+    // a source module, which is provided on the threads of the source.
+    bool fusable = node_parents.size() == 1 && node_parents[0]->data.parent_nodes_mask.Any() &&
+                   node_parents[0]->GetNext().size() == 1 && config.maxBatchSize <= 1 && !config.streamParallel;
+    if (fusable && graph_config.autoscaler_config.enable && !graph_config.scheduler_config.work_stealing) {
+      const int min_parallelism = config.minParallelism > 0 ? config.minParallelism : config.parallelism;
+      const int max_parallelism = config.maxParallelism > 0 ? config.maxParallelism : config.parallelism;
+      fusable = min_parallelism >= max_parallelism;
+    }
+    if (!fusable) {
+      if (config.fusePolicy == FusePolicy::ALWAYS) {
+        LOGW(CORE) << "Module [" << config.name << "]: it can not be fused, it must have a single upstream module "
+                   "which is not a head module and has no other downstream modules, and it must not be batched, "
+                   "scaled or stream parallel.";
+      }
+      continue;
+    }
+    node->data.fused = true;
+    LOGI(CORE) << "Module [" << config.name << "]: fused into the stage of [" << node_parents[0]->GetName() << "]";
+  }
+}
+
+void Pipeline::InitLatencyBreakdown() {
+  module_times_size_ = 0;
+  trace_trigger_ = nullptr;
+  if (!IsProfilingEnabled()) return;
+  // the module times are recorded for the sampler of traces as well, to time the process of each module
+  TraceSampler* sampler = IsTracingEnabled() ? profiler_->GetTracer()->GetSampler() : nullptr;
+  if (sampler && sampler->IsTriggerEnabled()) trace_trigger_ = sampler;
+  const bool breakdown = profiler_->GetConfig().enable_latency_breakdown;
+  if (!breakdown && !trace_trigger_) return;
+  std::map<std::string, LatencyBreakdownNode> nodes;
+  for (auto cur_node = graph_->DFSBegin(); cur_node != graph_->DFSEnd(); ++cur_node) {
+    const auto& module = cur_node->data.module;
+    LatencyBreakdownNode& node = nodes[module->GetName()];
+    node.module_id = module->GetId();
+    node.module_name = module->GetName();
+    for (const auto& next : cur_node->GetNext()) {
+      nodes[next->data.module->GetName()].parent_ids.push_back(module->GetId());
     }
+    module_times_size_ = std::max<size_t>(module_times_size_, module->GetId() + 1);
+  }
+  std::vector<LatencyBreakdownNode> sorted_nodes;
+  for (const auto& name : GetSortedModuleNames()) {
+    auto iter = nodes.find(name);
+    if (iter != nodes.end()) sorted_nodes.push_back(std::move(iter->second));
   }
+  if (breakdown) profiler_->InitLatencyBreakdown(sorted_nodes);
 }
 
 bool Pipeline::CreateConnectors() {
   for (auto node_iter = graph_->DFSBegin(); node_iter != graph_->DFSEnd(); ++node_iter) {
-    if (node_iter->data.parent_nodes_mask)  {  // not a head node
+    // the frames bypass a module before they are pushed to it, a fused module may have a breaker as well
+    if (node_iter->data.parent_nodes_mask.Any()) CreateCircuitBreaker(&node_iter->data, node_iter->GetConfig());
+    if (node_iter->data.parent_nodes_mask.Any() && !node_iter->data.fused)  {  // not a head node or a fused node
       const auto &config = node_iter->GetConfig();
       // check if parallelism and max_input_queue_size is valid.
       if (config.parallelism <= 0 || config.maxInputQueueSize <= 0) {
@@ -292,36 +1107,105 @@ bool Pipeline::CreateConnectors() {
                    "max_input_queue_size[" << config.maxInputQueueSize << "].";
         return false;
       }
-      node_iter->data.connector = std::make_shared<Connector>(config.parallelism, config.maxInputQueueSize);
+      if (config.queueType == InputQueueType::LOCK_FREE && config.queueFullPolicy == QueueFullPolicy::DROP_OLDEST) {
+        LOGE(CORE) << "Module [" << config.name << "]: queue_full_policy [drop_oldest] is not supported by "
+                   "queue_type [lock_free].";
+        return false;
+      }
+      const uint32_t min_parallelism = config.minParallelism > 0 ? config.minParallelism : config.parallelism;
+      const uint32_t max_parallelism = config.maxParallelism > 0 ? config.maxParallelism : config.parallelism;
+      if (min_parallelism > static_cast<uint32_t>(config.parallelism) ||
+          max_parallelism < static_cast<uint32_t>(config.parallelism)) {
+        LOGE(CORE) << "Module [" << config.name << "]: parallelism must be in [min_parallelism, max_parallelism], "
+                   "parallelism[" << config.parallelism << "], min_parallelism[" << config.minParallelism << "], "
+                   "max_parallelism[" << config.maxParallelism << "].";
+        return false;
+      }
+      node_iter->data.parallelism = config.parallelism;
+      node_iter->data.min_parallelism = min_parallelism;
+      node_iter->data.max_parallelism = max_parallelism;
+      node_iter->data.autoscaled = graph_->GetConfig().autoscaler_config.enable &&
+                                   !graph_->GetConfig().scheduler_config.work_stealing &&
+                                   min_parallelism < max_parallelism && !config.streamParallel;
+      // a scaled module owns a conveyor for each thread it may have
+      node_iter->data.connector = std::make_shared<Connector>(
+          node_iter->data.autoscaled ? max_parallelism : config.parallelism, config.maxInputQueueSize,
+          config.queueType);
+      node_iter->data.max_batch_size = std::max<uint32_t>(config.maxBatchSize, 1);
+      node_iter->data.batch_timeout = std::chrono::microseconds(config.batchTimeoutUs);
+      node_iter->data.queue_full_policy = config.queueFullPolicy;
+      // conveyors are not bound to threads in work stealing mode, there is no need to rebalance streams.
+      // streams are moved away from the conveyors retired by the autoscaler.
+      node_iter->data.connector->EnableStreamRebalance(node_iter->data.autoscaled || (config.rebalanceStreams &&
+                                                       !graph_->GetConfig().scheduler_config.work_stealing &&
+                                                       !config.streamParallel));
+      node_iter->data.reorder.reset(config.streamParallel ? new ReorderBuffer(MAX_STREAM_NUM, config.orderedOutput)
+                                                          : nullptr);
     }
   }
   return true;
 }
 
+static inline int64_t SteadyNs(std::chrono::steady_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+// the frames are keyed by the sequence number in the records of modules. The frames without a stream index are not
+// numbered, they are keyed by the timestamp.
+static inline int64_t RecordId(const std::shared_ptr<CNFrameInfo>& data) {
+  return data->GetSequence() >= 0 ? data->GetSequence() : data->timestamp;
+}
+
 static inline
-bool PassedByAllParentNodes(NodeContext* context, uint64_t data_mask) {
-  uint64_t parent_masks = context->parent_nodes_mask;
-  return (data_mask & parent_masks) == parent_masks;
+bool PassedByAllParentNodes(NodeContext* context, const ModuleMask& data_mask) {
+  return data_mask.Contains(context->parent_nodes_mask);
 }
 
 void Pipeline::OnProcessStart(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data) {
   if (data->IsEos()) return;
-  if (IsProfilingEnabled()) {
-    auto record_key = std::make_pair(data->stream_id, data->timestamp);
-    auto profiler = context->module->GetProfiler();
-    profiler->RecordProcessEnd(kINPUT_PROFILER_NAME, record_key);
-    profiler->RecordProcessStart(kPROCESS_PROFILER_NAME, record_key);
+  // memory allocated by the module for the data is charged to the stream
+  if (memory_accounting_) MemoryOwner::SetCurrent(MemoryAccountant::Instance().GetOwner(GetName(), data->stream_id));
+  // the modules of branches are not profiled
+  ModuleProfiler* profiler = IsProfilingEnabled() ? context->module->GetProfiler() : nullptr;
+  if (profiler) {
+    profiler->RecordProcessEnd(kINPUT_PROFILER_NAME, data->GetStreamIndex(), data->stream_id, RecordId(data));
+    profiler->RecordProcessStart(kPROCESS_PROFILER_NAME, data->GetStreamIndex(), data->stream_id, RecordId(data));
+    const uint32_t id = context->module->GetId();
+    if (id < data->module_times_.size()) data->module_times_[id].dequeue = SteadyNs(std::chrono::steady_clock::now());
   }
 }
 
 void Pipeline::OnProcessEnd(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data) {
-  if (IsProfilingEnabled())
-    context->module->GetProfiler()->RecordProcessEnd(kPROCESS_PROFILER_NAME,
-        std::make_pair(data->stream_id, data->timestamp));
+  ModuleProfiler* profiler = IsProfilingEnabled() ? context->module->GetProfiler() : nullptr;
+  if (profiler) {
+    const uint32_t id = context->module->GetId();
+    if (id < data->module_times_.size()) {
+      auto now = std::chrono::steady_clock::now();
+      CNFrameInfo::ModuleTimes& times = data->module_times_[id];
+      times.done = SteadyNs(now);
+      // told before the end is recorded, so that the end of the slow frame is traced as well
+      if (trace_trigger_) {
+        trace_trigger_->OnProcessTime(context->module->GetName(),
+                                      std::chrono::nanoseconds(times.done - times.dequeue), now);
+      }
+    }
+    profiler->RecordProcessEnd(kPROCESS_PROFILER_NAME, data->GetStreamIndex(), data->stream_id, RecordId(data));
+  }
   context->module->NotifyObserver(data);
 }
 
 void Pipeline::OnProcessFailed(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data, int ret) {
+  if (context->breaker && !data->IsEos()) {
+    // the module is not critical, the frame goes on as if it was processed
+    context->breaker->OnFailed("returned " + std::to_string(ret), std::chrono::steady_clock::now());
+    LOGW_EVERY_T(CORE, 1) << "[" << context->module->GetName() << "] [" << data->stream_id
+                          << "] process failed, return number: " << ret << ", pts: " << data->timestamp;
+    TransmitData(context, data);
+    return;
+  }
+  // the data leaves the current module
+  if (context->connector) context->connector->ReleaseConveyor(data->GetStreamIndex(), data->IsEos());
+  DiscardData(context, data);
   auto module_name = context->module->GetName();
   Event e;
   e.type = EventType::EVENT_ERROR;
@@ -347,8 +1231,9 @@ void Pipeline::OnDataInvalid(NodeContext* context, const std::shared_ptr<CNFrame
 void Pipeline::OnEos(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data) {
   auto module = context->module;
   module->NotifyObserver(data);
-  if (IsProfilingEnabled())
-    module->GetProfiler()->OnStreamEos(data->stream_id);
+  ModuleProfiler* profiler = IsProfilingEnabled() ? module->GetProfiler() : nullptr;
+  if (profiler)
+    profiler->OnStreamEos(data->stream_id);
   LOGI(CORE) << "[" << module->GetName() << "]"
       << " [" << data->stream_id << "] got eos.";
   // eos message
@@ -361,41 +1246,283 @@ void Pipeline::OnEos(NodeContext* context, const std::shared_ptr<CNFrameInfo>& d
 }
 
 void Pipeline::OnPassThrough(const std::shared_ptr<CNFrameInfo>& data) {
+  // the frames kept by the callback do not keep the branches detached later
+  data->routes_.reset();
   if (frame_done_cb_) frame_done_cb_(data);  // To notify the frame is processed by all modules
+  // the checkpoint is recorded after the callback, the frame is not processed again once it is recorded.
+  if (checkpoint_ && !data->IsEos()) checkpoint_->Record(data->stream_id, data->timestamp);
   if (data->IsEos()) {
     StreamMsg msg;
     msg.type = StreamMsgType::EOS_MSG;
     msg.stream_id = data->stream_id;
     UpdateByStreamMsg(msg);
     if (IsProfilingEnabled()) profiler_->OnStreamEos(data->stream_id);
+    // the stream index may be taken by another stream
+    if (data->GetStreamIndex() < MAX_STREAM_NUM) {
+      stream_sequences_[data->GetStreamIndex()].store(0);
+      stream_max_latencies_[data->GetStreamIndex()].store(-1);
+    }
+    if (memory_accounting_) MemoryAccountant::Instance().RemoveStream(GetName(), data->stream_id);
+    if (admission_) admission_->RemoveStream(data->stream_id);
+    if (degradation_) degradation_->RemoveStream(data->stream_id);
   } else {
-    if (IsProfilingEnabled()) profiler_->RecordOutput(
-        std::make_pair(data->stream_id, data->timestamp));
+    ++completed_frames_;
+    if (IsProfilingEnabled()) {
+      profiler_->RecordOutput(data->GetStreamIndex(), data->stream_id, data->timestamp);
+      if (!data->module_times_.empty()) profiler_->RecordModuleTimes(data->stream_id, data->module_times_);
+    }
+  }
+}
+
+void Pipeline::TransmitData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data,
+                            std::vector<ConveyorPush>* pushes) {
+  if (context->reorder && context->reorder->IsTracked(data)) {
+    context->reorder->Complete(data, [this, context, pushes](const std::shared_ptr<CNFrameInfo>& ready) {
+      ForwardData(context, ready, pushes);
+    });
+    return;
   }
+  ForwardData(context, data, pushes);
+}
+
+void Pipeline::DiscardData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data) {
+  if (!context->reorder) return;
+  // the data after it may be waiting
+  context->reorder->Discard(data, [this, context](const std::shared_ptr<CNFrameInfo>& ready) {
+    ForwardData(context, ready);
+  });
 }
 
-void Pipeline::TransmitData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data) {
+void Pipeline::CreateCircuitBreaker(NodeContext* context, const CNModuleConfig& config) {
+  if (!config.circuitBreaker.enable) {
+    context->breaker.reset();
+    return;
+  }
+  const std::string module_name = context->module->GetName();
+  auto state_func = [this, module_name](CircuitState state, const std::string& reason) {
+    static const char* names[] = {"closed", "open", "half open"};
+    Event e;
+    e.type = EventType::EVENT_CIRCUIT_BREAKER;
+    e.module_name = module_name;
+    e.message = std::string("circuit breaker ") + names[static_cast<int>(state)] + ", " + reason;
+    e.thread_id = std::this_thread::get_id();
+    event_bus_->PostEvent(e);
+  };
+  context->breaker.reset(new CircuitBreaker(config.circuitBreaker, state_func));
+}
+
+bool Pipeline::DropExpiredData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data) {
+  if (data->IsEos() || data->GetDeadline() == std::chrono::steady_clock::time_point::max() ||
+      std::chrono::steady_clock::now() < data->GetDeadline()) {
+    return false;
+  }
+  // the data leaves the current module
+  if (context->connector) context->connector->ReleaseConveyor(data->GetStreamIndex(), false);
+  DiscardData(context, data);
+  ModuleProfiler* profiler = IsProfilingEnabled() ? context->module->GetProfiler() : nullptr;
+  if (profiler) profiler->RecordDropped(data->stream_id, kDROP_REASON_LATE);
+  LOGD_EVERY_T(CORE, 1) << "[" << context->module->GetName() << "] [" << data->stream_id << "] drops late frame, pts: "
+                        << data->timestamp;
+  return true;
+}
+
+int64_t Pipeline::GetStreamMaxLatency(const std::shared_ptr<CNFrameInfo>& data) {
+  std::atomic<int64_t>& cached = stream_max_latencies_[data->GetStreamIndex()];
+  int64_t max_latency_ms = cached.load(std::memory_order_relaxed);
+  if (max_latency_ms >= 0) return max_latency_ms;
+  std::lock_guard<std::mutex> lk(max_latency_mtx_);
+  auto iter = max_latencies_.find(data->stream_id);
+  max_latency_ms = iter == max_latencies_.end() ? 0 : iter->second;
+  cached.store(max_latency_ms, std::memory_order_relaxed);
+  return max_latency_ms;
+}
+
+bool Pipeline::SetStreamMaxLatency(const std::string& stream_id, int64_t max_latency_ms) {
+  if (max_latency_ms < 0) {
+    LOGE(CORE) << "[" << GetName() << "] SetStreamMaxLatency() failed, max_latency_ms must not be negative, but got "
+               << max_latency_ms;
+    return false;
+  }
+  std::lock_guard<std::mutex> lk(max_latency_mtx_);
+  if (max_latency_ms > 0) {
+    max_latencies_[stream_id] = max_latency_ms;
+  } else {
+    max_latencies_.erase(stream_id);
+  }
+  // the latency is cached again by the next frame of each stream
+  for (uint32_t i = 0; i < MAX_STREAM_NUM; ++i) stream_max_latencies_[i].store(-1);
+  return true;
+}
+
+Pipeline::StreamParamOverrides Pipeline::ResolveStreamParams(const std::string& stream_id) const {
+  StreamParamOverrides params;
+  auto tag = stream_tags_.find(stream_id);
+  if (tag != stream_tags_.end()) {
+    auto search = tag_params_.find(tag->second);
+    if (search != tag_params_.end()) params = search->second;
+  }
+  auto search = stream_params_.find(stream_id);
+  if (search != stream_params_.end()) {
+    for (const auto& it : search->second) {
+      for (const auto& param : it.second) params[it.first][param.first] = param.second;
+    }
+  }
+  return params;
+}
+
+bool Pipeline::CheckStreamParams(const StreamParamOverrides& params) const {
+  for (const auto& it : params) {
+    const Module* module = GetModule(it.first);
+    if (!module) {
+      LOGE(CORE) << "[" << GetName() << "] Override parameters failed, module [" << it.first << "] is not found.";
+      return false;
+    }
+    if (!module->CheckStreamParams(it.second)) {
+      LOGE(CORE) << "[" << GetName() << "] Module [" << it.first << "] can not override the parameters per stream.";
+      return false;
+    }
+  }
+  return true;
+}
+
+void Pipeline::ApplyStreamParams(uint32_t stream_idx, const StreamParamOverrides& old,
+                                 const StreamParamOverrides& params) {
+  for (const auto& it : params) {
+    Module* module = GetModule(it.first);
+    if (module) module->SetStreamParams(stream_idx, it.second);
+  }
+  for (const auto& it : old) {
+    if (params.count(it.first)) continue;
+    Module* module = GetModule(it.first);
+    if (module) module->SetStreamParams(stream_idx, ModuleParamSet());
+  }
+}
+
+void Pipeline::UpdateStreamParams(const std::map<std::string, StreamParamOverrides>& old) {
+  if (!IsRunning()) return;  // the overrides are applied when the streams are added
+  for (const auto& it : old) {
+    const uint32_t stream_idx = idxManager_->FindStreamIndex(it.first);
+    if (stream_idx != INVALID_STREAM_IDX) ApplyStreamParams(stream_idx, it.second, ResolveStreamParams(it.first));
+  }
+}
+
+bool Pipeline::SetStreamParams(const std::string& stream_id, const StreamParamOverrides& params) {
+  std::lock_guard<std::mutex> lk(stream_params_mtx_);
+  std::map<std::string, StreamParamOverrides> old = {{stream_id, ResolveStreamParams(stream_id)}};
+  StreamParamOverrides prev = std::move(stream_params_[stream_id]);
+  stream_params_[stream_id] = params;
+  const bool valid = CheckStreamParams(ResolveStreamParams(stream_id));
+  if (!valid) stream_params_[stream_id] = std::move(prev);
+  if (stream_params_[stream_id].empty()) stream_params_.erase(stream_id);
+  if (!valid) return false;
+  UpdateStreamParams(old);
+  return true;
+}
+
+bool Pipeline::SetStreamTagParams(const std::string& tag, const StreamParamOverrides& params) {
+  std::lock_guard<std::mutex> lk(stream_params_mtx_);
+  std::map<std::string, StreamParamOverrides> old;
+  for (const auto& it : stream_tags_) {
+    if (it.second == tag) old[it.first] = ResolveStreamParams(it.first);
+  }
+  if (!CheckStreamParams(params)) return false;
+  StreamParamOverrides prev = std::move(tag_params_[tag]);
+  tag_params_[tag] = params;
+  bool valid = true;
+  for (const auto& it : old) valid = valid && CheckStreamParams(ResolveStreamParams(it.first));
+  if (!valid) tag_params_[tag] = std::move(prev);
+  if (tag_params_[tag].empty()) tag_params_.erase(tag);
+  if (!valid) return false;
+  UpdateStreamParams(old);
+  return true;
+}
+
+bool Pipeline::SetStreamTag(const std::string& stream_id, const std::string& tag) {
+  std::lock_guard<std::mutex> lk(stream_params_mtx_);
+  std::map<std::string, StreamParamOverrides> old = {{stream_id, ResolveStreamParams(stream_id)}};
+  std::string prev = stream_tags_[stream_id];
+  stream_tags_[stream_id] = tag;
+  const bool valid = CheckStreamParams(ResolveStreamParams(stream_id));
+  if (!valid) stream_tags_[stream_id] = prev;
+  if (stream_tags_[stream_id].empty()) stream_tags_.erase(stream_id);
+  if (!valid) return false;
+  UpdateStreamParams(old);
+  return true;
+}
+
+void Pipeline::OnStreamIndexAssigned(const std::string& stream_id, uint32_t stream_idx) {
+  if (!IsRunning()) return;  // the modules are not opened, the overrides are applied by Start
+  std::lock_guard<std::mutex> lk(stream_params_mtx_);
+  const StreamParamOverrides params = ResolveStreamParams(stream_id);
+  if (!params.empty()) ApplyStreamParams(stream_idx, {}, params);
+}
+
+void Pipeline::OnStreamIndexReturned(const std::string& stream_id) {
+  const uint32_t stream_idx = idxManager_->FindStreamIndex(stream_id);
+  if (stream_idx == INVALID_STREAM_IDX || !IsRunning()) return;
+  std::lock_guard<std::mutex> lk(stream_params_mtx_);
+  const StreamParamOverrides params = ResolveStreamParams(stream_id);
+  if (!params.empty()) ApplyStreamParams(stream_idx, params, {});
+}
+
+void Pipeline::ForwardData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data,
+                           std::vector<ConveyorPush>* pushes) {
+  // the data leaves the current module
+  if (context->connector) context->connector->ReleaseConveyor(data->GetStreamIndex(), data->IsEos());
   if (data->IsInvalid()) {
     OnDataInvalid(context, data);
     return;
   }
-  if (!context->parent_nodes_mask) {
+  if (!context->parent_nodes_mask.Any()) {
     // root node
+    data->routes_ = std::atomic_load(&routes_);
+    if (!data->routes_) return;  // the pipeline is stopped
+    if (!data->IsEos() && data->GetStreamIndex() < MAX_STREAM_NUM) {
+      data->sequence_ = stream_sequences_[data->GetStreamIndex()].fetch_add(1, std::memory_order_relaxed);
+      const int64_t max_latency_ms = GetStreamMaxLatency(data);
+      if (max_latency_ms > 0 && data->deadline_ == std::chrono::steady_clock::time_point::max()) {
+        data->deadline_ = data->GetCreateTime() + std::chrono::milliseconds(max_latency_ms);
+      }
+    }
     // set mask to 1 for never touched modules, for case which has multiple source modules.
-    data->SetModulesMask(all_modules_mask_ ^ context->route_mask);
+    const uint32_t id = context->module->GetId();
+    data->SetModulesMask(data->routes_->all_modules_mask ^ data->routes_->route_masks[id]);
+    if (module_times_size_ && !data->IsEos()) {
+      // the frame is taken by the source module as soon as it is created
+      data->module_times_.assign(module_times_size_, CNFrameInfo::ModuleTimes());
+      CNFrameInfo::ModuleTimes& times = data->module_times_[context->module->GetId()];
+      times.enqueue = times.dequeue = SteadyNs(data->GetCreateTime());
+    }
   }
   if (data->IsEos()) {
     OnEos(context, data);
   } else {
     OnProcessEnd(context, data);
-    if (IsStreamRemoved(data->stream_id))
+    if (IsStreamRemoved(data))
       return;
   }
+  RouteData(context, data, pushes);
+}
 
-  auto node = context->node.lock();
+void Pipeline::RouteData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data,
+                         std::vector<ConveyorPush>* pushes) {
+  // the routes are kept by the frame, as the frame may be released by the next modules
+  std::shared_ptr<const RouteTable> routes = data->routes_ ? data->routes_ : std::atomic_load(&routes_);
+  if (!routes) return;  // the pipeline is stopped
   auto module = context->module;
-  const uint64_t cur_mask = data->MarkPassed(module.get());
-  const bool passed_by_all_modules = PassedByAllModules(cur_mask);
+  const ModuleMask cur_mask = data->MarkPassed(module.get());
+  const bool passed_by_all_modules = cur_mask == routes->all_modules_mask;
+  if (!data->IsEos() && !frame_done_cb_ && !data->IsPixelReleased()) {
+    if (cur_mask.Contains(routes->pixel_modules_mask)) {
+      data->ReleasePixels();
+    } else {
+      // the modules left read the pixels on one side only, the copy on the other side is released
+      if (cur_mask.Contains(routes->host_pixel_modules_mask)) data->ReleasePixelCopy(CNFrameInfo::PixelCopy::HOST);
+      if (cur_mask.Contains(routes->device_pixel_modules_mask)) {
+        data->ReleasePixelCopy(CNFrameInfo::PixelCopy::DEVICE);
+      }
+    }
+  }
 
   if (passed_by_all_modules) {
     OnPassThrough(data);
@@ -403,47 +1530,762 @@ void Pipeline::TransmitData(NodeContext* context, const std::shared_ptr<CNFrameI
   }
 
   // transmit to next nodes
-  for (auto next_node : node->GetNext()) {
-    if (!PassedByAllParentNodes(&next_node->data, cur_mask)) continue;
-    auto next_module = next_node->data.module;
-    auto connector = next_node->data.connector;
+  for (NodeContext* next_context : routes->next_nodes[module->GetId()]) {
+    if (!PassedByAllParentNodes(next_context, cur_mask)) continue;
+    auto next_module = next_context->module;
+    auto connector = next_context->connector;
     // push data to conveyor only after data passed by all parent nodes.
-    if (IsProfilingEnabled() && !data->IsEos())
-      next_module->GetProfiler()->RecordProcessStart(kINPUT_PROFILER_NAME,
-          std::make_pair(data->stream_id, data->timestamp));
-    const int conveyor_idx = data->GetStreamIndex() % connector->GetConveyorCount();
-    while (!connector->IsStopped() && connector->PushDataBufferToConveyor(conveyor_idx, data) == false) {
-      if (connector->GetFailTime(conveyor_idx) % 50 == 0) {
-        // Show infomation when conveyor is full in every second
-        LOGD(CORE) << "[" << next_module->GetName() << " " << conveyor_idx << "] " << "Input buffer is full";
-      }
-      std::this_thread::sleep_for(std::chrono::milliseconds(20));
-    }  // while try push
+    ModuleProfiler* next_profiler = IsProfilingEnabled() ? next_module->GetProfiler() : nullptr;
+    if (next_context->breaker && !data->IsEos() && !next_context->breaker->Allow(std::chrono::steady_clock::now())) {
+      // the breaker of the module is open, the frame is marked passed by it without being processed
+      if (next_profiler) {
+        next_profiler->RecordReceived(data->stream_id);
+        next_profiler->RecordDropped(data->stream_id, kDROP_REASON_BYPASSED);
+      }
+      RouteData(next_context, data, pushes);
+      continue;
+    }
+    if (next_context->degrade && !data->IsEos()) {
+      const uint32_t interval = next_context->degrade->interval.load();
+      if (interval != 1 && degradation_->Bypass(data->stream_id, next_module->GetId(), interval,
+                                                next_context->degrade->max_priority.load())) {
+        // the module is degraded, the frame is marked passed by it without being processed
+        if (next_profiler) {
+          next_profiler->RecordReceived(data->stream_id);
+          next_profiler->RecordDropped(data->stream_id, kDROP_REASON_DEGRADED);
+        }
+        RouteData(next_context, data, pushes);
+        continue;
+      }
+    }
+    if (next_profiler && !data->IsEos()) {
+      next_profiler->RecordProcessStart(kINPUT_PROFILER_NAME, data->GetStreamIndex(), data->stream_id,
+                                        RecordId(data));
+      const uint32_t id = next_module->GetId();
+      if (id < data->module_times_.size()) data->module_times_[id].enqueue = SteadyNs(std::chrono::steady_clock::now());
+    }
+    if (next_context->fused) {
+      // the fused module is processed right away on this thread, it transmits the data to its next nodes in turn.
+      if (next_profiler && !data->IsEos()) next_profiler->RecordReceived(data->stream_id);
+      if (DropExpiredData(next_context, data)) continue;
+      OnProcessStart(next_context, data);
+      int ret = ProcessData(next_context, data);
+      if (ret < 0)
+        OnProcessFailed(next_context, data, ret);
+      continue;
+    }
+    if (!data->IsEos()) next_module->Prefetch(data);
+    bool remapped = false;
+    int conveyor_idx;
+    if (next_context->reorder && next_context->reorder->IsTracked(data)) {
+      // the data of a stream is spread over the conveyors, see CNModuleConfig::streamParallel
+      next_context->reorder->Enter(data);
+      conveyor_idx = connector->SelectConveyor();
+    } else {
+      // the stream is not moved while the data of it acquired in the same batch is not pushed yet.
+      const uint32_t stream_idx = data->GetStreamIndex();
+      const bool movable = !pushes || std::none_of(pushes->begin(), pushes->end(), [&](const ConveyorPush& push) {
+        return push.context == next_context && push.data->GetStreamIndex() == stream_idx;
+      });
+      conveyor_idx = connector->AcquireConveyor(stream_idx, &remapped, movable);
+    }
+    if (remapped && next_profiler)
+      next_profiler->RecordConveyorIdx(data->stream_id, conveyor_idx);
+    if (next_profiler && !data->IsEos()) next_profiler->RecordReceived(data->stream_id);
+    std::vector<std::shared_ptr<CNFrameInfo>> dropped;
+    if (data->IsEos() && IsStreamRemoved(data) && connector->PushEosToConveyor(conveyor_idx, data, &dropped)) {
+      // the stream is removed by force, its EOS overtakes the data queued instead of waiting behind it.
+      for (const auto& it : dropped) {
+        DiscardData(next_context, it);
+        if (next_profiler) next_profiler->RecordDropped(it->stream_id, kDROP_REASON_REMOVED);
+      }
+      if (scheduler_ && !connector->IsStopped()) ScheduleConveyor(next_context, conveyor_idx);
+      continue;
+    }
+    if (pushes) {
+      // pushed together with the other data of the batch
+      pushes->push_back({next_context, conveyor_idx, data});
+      continue;
+    }
+    PushData(next_context, conveyor_idx, data, next_profiler);
   }  // loop next nodes
 }
 
+void Pipeline::PushData(NodeContext* next_context, int conveyor_idx, const std::shared_ptr<CNFrameInfo>& data,
+                        ModuleProfiler* next_profiler) {
+  auto next_module = next_context->module;
+  auto connector = next_context->connector;
+  const QueueFullPolicy policy = next_context->queue_full_policy;
+  std::chrono::steady_clock::time_point stall_start;
+  bool stalled = false;
+  bool full = false;
+  while (!connector->IsStopped() && connector->PushDataBufferToConveyor(conveyor_idx, data) == false) {
+    LOGD_EVERY_T(CORE, 1) << "[" << next_module->GetName() << " " << conveyor_idx << "] " << "Input buffer is full";
+    if (next_context->breaker && !data->IsEos() && !full) {
+      next_context->breaker->OnFailed("found the input queue full", std::chrono::steady_clock::now());
+      full = true;
+    }
+    // EOS is never dropped.
+    if (QueueFullPolicy::DROP_NEWEST == policy && !data->IsEos()) {
+      connector->ReleaseConveyor(data->GetStreamIndex(), false);
+      DiscardData(next_context, data);
+      if (next_profiler) next_profiler->RecordDropped(data->stream_id, kDROP_REASON_QUEUE_FULL);
+      break;
+    }
+    if (QueueFullPolicy::DROP_OLDEST == policy) {
+      std::shared_ptr<CNFrameInfo> dropped = connector->DropOldestDataBufferFromConveyor(conveyor_idx);
+      if (dropped) {
+        DiscardData(next_context, dropped);
+        if (next_profiler) next_profiler->RecordDropped(dropped->stream_id, kDROP_REASON_QUEUE_FULL);
+        continue;
+      }
+    }
+    if (next_profiler && !stalled) {
+      stall_start = std::chrono::steady_clock::now();
+      stalled = true;
+    }
+    // wait until the downstream module pops data. A worker of the scheduler runs other jobs instead,
+    // otherwise all workers may be blocked and no one processes the downstream module.
+    if (!scheduler_ || !scheduler_->HelpOnce()) connector->WaitConveyorNotFull(conveyor_idx);
+  }  // while try push
+  if (stalled) {
+    std::chrono::duration<double, std::milli> stall = std::chrono::steady_clock::now() - stall_start;
+    next_profiler->RecordStalled(data->stream_id, stall.count());
+  }
+  if (scheduler_ && !connector->IsStopped()) ScheduleConveyor(next_context, conveyor_idx);
+}
+
+void Pipeline::PushData(std::vector<ConveyorPush>* pushes) {
+  // the order of the data of a conveyor is kept
+  std::stable_sort(pushes->begin(), pushes->end(), [](const ConveyorPush& a, const ConveyorPush& b) {
+    return a.context != b.context ? a.context < b.context : a.conveyor_idx < b.conveyor_idx;
+  });
+  std::vector<std::shared_ptr<CNFrameInfo>> group;
+  for (auto begin = pushes->begin(); begin != pushes->end();) {
+    NodeContext* next_context = begin->context;
+    const int conveyor_idx = begin->conveyor_idx;
+    group.clear();
+    auto end = begin;
+    for (; end != pushes->end() && end->context == next_context && end->conveyor_idx == conveyor_idx; ++end) {
+      group.push_back(std::move(end->data));
+    }
+    begin = end;
+    auto connector = next_context->connector;
+    if (connector->IsStopped()) continue;
+    const size_t pushed = connector->PushDataBuffersToConveyor(conveyor_idx, group);
+    if (pushed && scheduler_) ScheduleConveyor(next_context, conveyor_idx);
+    // the conveyor is full, the data left is pushed one by one as it is popped
+    ModuleProfiler* next_profiler =
+        pushed < group.size() && IsProfilingEnabled() ? next_context->module->GetProfiler() : nullptr;
+    for (size_t i = pushed; i < group.size(); ++i) PushData(next_context, conveyor_idx, group[i], next_profiler);
+  }
+}
+
+void Pipeline::ScheduleConveyor(NodeContext* context, uint32_t conveyor_idx) {
+  // pairs with the fence in ConveyorTask, the data pushed is either seen by the running job or a new job is submitted.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (context->conveyor_scheduled[conveyor_idx].exchange(true)) return;
+  scheduler_->Submit(context->affinity_base + conveyor_idx,
+                     std::bind(&Pipeline::ConveyorTask, this, context, conveyor_idx));
+}
+
+void Pipeline::ConveyorTask(NodeContext* context, uint32_t conveyor_idx) {
+  auto connector = context->connector;
+  // only one job of a conveyor is queued or running at one time, so the data of a conveyor is processed in order.
+  for (int i = 0; i < kMaxDataNumPerConveyorTask && !connector->IsStopped(); ++i) {
+    if (context->max_batch_size > 1) {
+      // never waits for a full batch here, a worker should not be blocked by one conveyor.
+      std::vector<std::shared_ptr<CNFrameInfo>> data_vec;
+      while (data_vec.size() < context->max_batch_size) {
+        std::shared_ptr<CNFrameInfo> data = connector->TryPopDataBufferFromConveyor(conveyor_idx);
+        if (data == nullptr) break;
+        data_vec.push_back(data);
+        if (data->IsEos()) break;
+      }
+      if (data_vec.empty()) break;
+      ProcessDataBatch(context, &data_vec);
+      continue;
+    }
+    std::shared_ptr<CNFrameInfo> data = connector->TryPopDataBufferFromConveyor(conveyor_idx);
+    if (data == nullptr) break;
+    if (DropExpiredData(context, data)) continue;
+    OnProcessStart(context, data);
+    int ret = ProcessData(context, data);
+    if (ret < 0)
+      OnProcessFailed(context, data, ret);
+  }
+  context->conveyor_scheduled[conveyor_idx].store(false);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!connector->IsStopped() && !connector->IsConveyorEmpty(conveyor_idx)) ScheduleConveyor(context, conveyor_idx);
+}
+
+int Pipeline::ProcessData(NodeContext* context, const std::shared_ptr<CNFrameInfo>& data) {
+  // the latency is told to the circuit breaker, the failures are reported by OnProcessFailed
+  const bool timed = context->breaker && !data->IsEos();
+  const auto process_start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+  int ret;
+  if (!perf_counters_) {
+    ret = context->module->DoProcess(data);
+  } else {
+    PerfCounters* counters = PerfCounters::ThreadInstance();
+    PerfCounterValues start, end;
+    counters->Read(&start);
+    ret = context->module->DoProcess(data);
+    counters->Read(&end);
+    ModuleProfiler* profiler = context->module->GetProfiler();
+    if (profiler) profiler->AddPerfCounters(end - start);
+  }
+  if (timed && ret >= 0) {
+    const auto process_end = std::chrono::steady_clock::now();
+    context->breaker->OnProcessed(process_end - process_start, process_end);
+  }
+  return ret;
+}
+
+int Pipeline::ProcessData(NodeContext* context, std::vector<std::shared_ptr<CNFrameInfo>>* data_vec) {
+  const bool timed = context->breaker != nullptr;
+  const auto process_start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+  int ret;
+  if (!perf_counters_) {
+    ret = context->module->DoProcessBatch(*data_vec);
+  } else {
+    PerfCounters* counters = PerfCounters::ThreadInstance();
+    PerfCounterValues start, end;
+    counters->Read(&start);
+    ret = context->module->DoProcessBatch(*data_vec);
+    counters->Read(&end);
+    ModuleProfiler* profiler = context->module->GetProfiler();
+    if (profiler) profiler->AddPerfCounters(end - start);
+  }
+  if (timed && ret >= 0) {
+    const auto process_end = std::chrono::steady_clock::now();
+    context->breaker->OnProcessed(process_end - process_start, process_end);
+  }
+  return ret;
+}
+
+void Pipeline::ProcessDataBatch(NodeContext* context, std::vector<std::shared_ptr<CNFrameInfo>>* data_vec) {
+  auto expired = [&](const std::shared_ptr<CNFrameInfo>& data) { return DropExpiredData(context, data); };
+  data_vec->erase(std::remove_if(data_vec->begin(), data_vec->end(), expired), data_vec->end());
+  if (data_vec->empty()) return;
+  // an eos frame is always the last one of a batch, it is processed alone after the others.
+  std::shared_ptr<CNFrameInfo> eos_data = nullptr;
+  if (data_vec->back()->IsEos()) {
+    eos_data = data_vec->back();
+    data_vec->pop_back();
+  }
+  if (!data_vec->empty()) {
+    for (const auto& data : *data_vec) OnProcessStart(context, data);
+    int ret = ProcessData(context, data_vec);
+    if (ret < 0) {
+      OnProcessFailed(context, data_vec->front(), ret);
+      for (size_t i = 1; i < data_vec->size(); ++i) {
+        const auto& data = (*data_vec)[i];
+        if (context->breaker) {
+          TransmitData(context, data);
+          continue;
+        }
+        // the data leaves the current module
+        if (context->connector) context->connector->ReleaseConveyor(data->GetStreamIndex(), data->IsEos());
+        DiscardData(context, data);
+      }
+    }
+  }
+  if (eos_data) {
+    int ret = ProcessData(context, eos_data);
+    if (ret < 0)
+      OnProcessFailed(context, eos_data, ret);
+  }
+}
+
 void Pipeline::TaskLoop(NodeContext* context, uint32_t conveyor_idx) {
   auto module = context->module;
   auto connector = context->connector;
   auto node_name = module->GetName();
+  module->BindThreadToCpus();
+
+  if (context->max_batch_size > 1) {
+    while (!connector->IsStopped()) {
+      // the thread exits when its conveyor is retired by the autoscaler, it is checked before blocking in popping data
+      if (context->autoscaled && RetireTaskLoop(context, conveyor_idx)) return;
+      std::vector<std::shared_ptr<CNFrameInfo>> data_vec = connector->PopDataBuffersFromConveyor(
+          conveyor_idx, context->max_batch_size, context->batch_timeout);
+      if (connector->IsStopped()) break;
+      if (data_vec.empty()) continue;
+      ProcessDataBatch(context, &data_vec);
+    }
+    return;
+  }
 
   // process loop
   while (1) {
     std::shared_ptr<CNFrameInfo> data = nullptr;
     // pull data from conveyor
-    while (!connector->IsStopped() && data == nullptr)
+    while (!connector->IsStopped() && data == nullptr) {
+      // the thread exits when its conveyor is retired by the autoscaler. The connector wakes up the blocked pop
+      // once the conveyor might be retired.
+      if (context->autoscaled && RetireTaskLoop(context, conveyor_idx)) return;
       data = connector->PopDataBufferFromConveyor(conveyor_idx);
+    }
     if (connector->IsStopped())
       break;
-    if (data == nullptr)
+    if (data == nullptr || DropExpiredData(context, data))
       continue;
     OnProcessStart(context, data);
-    int ret = module->DoProcess(data);
+    int ret = ProcessData(context, data);
     if (ret < 0)
       OnProcessFailed(context, data, ret);
   }  // while process loop
 }
 
+void Pipeline::StartTaskLoop(NodeContext* context, uint32_t conveyor_idx) {
+  // called with autoscale_mtx_ locked. The old thread of the conveyor has exited.
+  if (context->task_running[conveyor_idx]) return;
+  if (context->task_threads[conveyor_idx].joinable()) context->task_threads[conveyor_idx].join();
+  context->task_threads[conveyor_idx] = std::thread(&Pipeline::TaskLoop, this, context, conveyor_idx);
+  context->task_running[conveyor_idx] = true;
+}
+
+bool Pipeline::RetireTaskLoop(NodeContext* context, uint32_t conveyor_idx) {
+  if (conveyor_idx < context->connector->GetActiveConveyorNum()) return false;
+  std::lock_guard<std::mutex> lk(autoscale_mtx_);
+  if (!context->connector->IsConveyorRetired(conveyor_idx)) return false;
+  context->task_running[conveyor_idx] = false;
+  return true;
+}
+
+std::vector<AutoscaleSample> Pipeline::SampleModules() {
+  std::vector<AutoscaleSample> samples;
+  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
+    if (!node->data.connector) continue;  // head node or fused node
+    const NodeContext& context = node->data;
+    AutoscaleSample sample;
+    sample.module_name = context.module->GetName();
+    for (const auto& next : node->GetNext()) sample.next_modules.push_back(next->data.module->GetName());
+    const size_t active_num = context.connector->GetActiveConveyorNum();
+    sample.parallelism = static_cast<uint32_t>(active_num);
+    sample.min_parallelism = context.autoscaled ? context.min_parallelism : sample.parallelism;
+    sample.max_parallelism = context.autoscaled ? context.max_parallelism : sample.parallelism;
+    size_t data_num = 0;
+    for (size_t conveyor_idx = 0; conveyor_idx < active_num; ++conveyor_idx) {
+      data_num += context.connector->GetConveyorSize(conveyor_idx);
+      // the fail time is reset once a push succeeds, so it is not 0 only if a producer is waiting.
+      if (context.connector->GetFailTime(conveyor_idx)) sample.blocking_upstream = true;
+    }
+    sample.queue_fill_ratio = static_cast<double>(data_num) / (active_num * context.connector->GetConveyorCapacity());
+    if (IsProfilingEnabled()) {
+      ModuleProfile profile = context.module->GetProfiler()->GetProfile();
+      for (const auto& process_profile : profile.process_profiles) {
+        if (process_profile.process_name == kPROCESS_PROFILER_NAME) sample.process_latency_ms = process_profile.latency;
+      }
+    }
+    samples.push_back(std::move(sample));
+  }
+  return samples;
+}
+
+bool Pipeline::ScaleModule(const std::string& module_name, uint32_t parallelism) {
+  auto node = graph_->GetNodeByName(module_name);
+  if (!node.get()) {
+    // the module name is the full name of the node
+    for (auto iter = graph_->DFSBegin(); iter != graph_->DFSEnd(); ++iter) {
+      if (iter->data.module->GetName() == module_name) node = *iter;
+    }
+  }
+  if (!node.get() || !node->data.autoscaled || !IsRunning()) return false;
+  NodeContext* context = &node->data;
+  if (parallelism < context->min_parallelism || parallelism > context->max_parallelism) return false;
+  std::lock_guard<std::mutex> lk(autoscale_mtx_);
+  context->connector->SetActiveConveyorNum(parallelism);
+  // threads of retired conveyors exit after the data in their conveyors is processed, see RetireTaskLoop.
+  for (uint32_t conveyor_idx = context->parallelism; conveyor_idx < parallelism; ++conveyor_idx) {
+    StartTaskLoop(context, conveyor_idx);
+  }
+  context->parallelism = parallelism;
+  return true;
+}
+
+MemoryOwner Pipeline::GetMemoryOwner(const std::string& stream_id) {
+  if (!memory_accounting_) return {};
+  return MemoryAccountant::Instance().GetOwner(GetName(), stream_id);
+}
+
+void Pipeline::WaitForMemoryBudget(const std::string& stream_id) {
+  const MemoryBudgetConfig& config = graph_->GetConfig().memory_budget_config;
+  if (!config.enable) return;
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  if (accountant.WaitForBudget(accountant.GetOwner(GetName(), stream_id), config.max_wait_ms)) return;
+  LOGW(CORE) << "[" << GetName() << "] [" << stream_id << "]: Memory budget is still exceeded after "
+             << config.max_wait_ms << "ms, the frame is sent anyway.";
+}
+
+bool Pipeline::Admit(Module* source, const std::string& stream_id) {
+  if (!admission_ || admission_->Admit(stream_id)) return true;
+  if (IsProfilingEnabled()) {
+    ModuleProfiler* profiler = profiler_->GetModuleProfiler(source->GetName());
+    if (profiler) profiler->RecordDropped(stream_id, kDROP_REASON_ADMISSION);
+  }
+  return false;
+}
+
+AdmissionSample Pipeline::SampleAdmission() {
+  const double high_watermark = graph_->GetConfig().admission_config.high_watermark;
+  AdmissionSample sample;
+  for (const auto& module_sample : SampleModules()) {
+    if (module_sample.blocking_upstream || module_sample.queue_fill_ratio >= high_watermark) sample.overloaded = true;
+  }
+  sample.completed_frames = completed_frames_.load();
+  return sample;
+}
+
+bool Pipeline::SetStreamWeight(const std::string& stream_id, double weight) {
+  if (!admission_) {
+    LOGE(CORE) << "[" << GetName() << "] SetStreamWeight() failed, admission control is not enabled.";
+    return false;
+  }
+  return admission_->SetWeight(stream_id, weight);
+}
+
+std::map<std::string, AdmissionStreamState> Pipeline::GetAdmissionStates() const {
+  if (!admission_) return {};
+  return admission_->GetStreamStates();
+}
+
+bool Pipeline::TagCurrentThread() {
+  if (!cpu_isolation_) return false;
+  return cpu_isolation_->TagCurrentThread();
+}
+
+bool Pipeline::InitDegradation() {
+  const DegradationConfig& config = graph_->GetConfig().degradation_config;
+  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) node->data.degrade.reset();
+  if (!config.enable) {
+    degradation_.reset();
+    return true;
+  }
+  for (const DegradationStep& step : config.steps) {
+    for (const std::string& name : step.modules) {
+      auto node = graph_->GetNodeByName(name);
+      if (!node.get()) {
+        LOGE(CORE) << "[" << GetName() << "] Module [" << name << "] of a degradation step is not found.";
+        return false;
+      }
+      if (DegradationAction::SCALE_OUTPUT == step.action) continue;
+      if (!node->data.parent_nodes_mask.Any()) {
+        LOGE(CORE) << "[" << GetName() << "] Module [" << name << "] of a degradation step is a head module, "
+                   "its frames can not be skipped.";
+        return false;
+      }
+      if (!node->data.degrade) node->data.degrade.reset(new DegradeSetting());
+    }
+  }
+  degradation_.reset(new (std::nothrow) DegradationController(config,
+      std::bind(&Pipeline::ApplyDegradation, this, std::placeholders::_1, std::placeholders::_2,
+                std::placeholders::_3)));
+  LOGF_IF(CORE, nullptr == degradation_) << "Pipeline::BuildPipeline() failed to alloc DegradationController";
+  return true;
+}
+
+DegradationSample Pipeline::SampleDegradation() {
+  DegradationSample sample;
+  for (const auto& module_sample : SampleModules()) {
+    sample.queue_fill_ratio = std::max(sample.queue_fill_ratio, module_sample.queue_fill_ratio);
+    if (module_sample.blocking_upstream) sample.blocking_upstream = true;
+  }
+  return sample;
+}
+
+void Pipeline::ApplyDegradation(uint32_t level, const DegradationStep& step, bool apply) {
+  static const char* names[] = {"skip_frames", "bypass", "scale_output"};
+  const std::vector<DegradationStep>& steps = graph_->GetConfig().degradation_config.steps;
+  const bool scale_output = DegradationAction::SCALE_OUTPUT == step.action;
+  for (const std::string& name : step.modules) {
+    // a module may be degraded by several steps, the latest one applied takes effect
+    uint32_t interval = 1;
+    int max_priority = 0;
+    double scale = 1.0;
+    for (uint32_t i = 0; i < level && i < steps.size(); ++i) {
+      const DegradationStep& applied = steps[i];
+      if (scale_output != (DegradationAction::SCALE_OUTPUT == applied.action) ||
+          std::find(applied.modules.begin(), applied.modules.end(), name) == applied.modules.end()) {
+        continue;
+      }
+      interval = DegradationAction::BYPASS == applied.action ? 0 : applied.interval;
+      max_priority = applied.max_priority;
+      scale = applied.scale;
+    }
+    auto node = graph_->GetNodeByName(name);
+    if (!node.get()) continue;
+    if (scale_output) {
+      if (!node->data.module->SetOutputScale(scale)) {
+        LOGW(CORE) << "[" << GetName() << "] Module [" << name << "] does not support scaling its output.";
+      }
+    } else if (node->data.degrade) {
+      node->data.degrade->max_priority.store(max_priority);
+      node->data.degrade->interval.store(interval);
+    }
+  }
+  std::string modules;
+  for (const std::string& name : step.modules) modules += (modules.empty() ? "" : ", ") + name;
+  Event e;
+  e.type = EventType::EVENT_DEGRADATION;
+  e.module_name = GetName();
+  e.message = "degradation level " + std::to_string(level) + ", " + (apply ? "applied " : "undone ") +
+              names[static_cast<int>(step.action)] + " of [" + modules + "]";
+  e.thread_id = std::this_thread::get_id();
+  event_bus_->PostEvent(e);
+}
+
+bool Pipeline::SetStreamPriority(const std::string& stream_id, int priority) {
+  if (!degradation_) {
+    LOGE(CORE) << "[" << GetName() << "] SetStreamPriority() failed, degradation is not enabled.";
+    return false;
+  }
+  degradation_->SetStreamPriority(stream_id, priority);
+  return true;
+}
+
+uint32_t Pipeline::GetDegradationLevel() const {
+  return degradation_ ? degradation_->GetLevel() : 0;
+}
+
+bool Pipeline::SetDegradationLevel(uint32_t level) {
+  if (!degradation_) {
+    LOGE(CORE) << "[" << GetName() << "] SetDegradationLevel() failed, degradation is not enabled.";
+    return false;
+  }
+  degradation_->SetLevel(level);
+  return true;
+}
+
+std::vector<AutoscaleDecision> Pipeline::GetAutoscaleDecisions() const {
+  if (!autoscaler_) return {};
+  return autoscaler_->GetDecisions();
+}
+
+std::vector<AutoscaleSample> Pipeline::GetModuleStates() {
+  if (!IsRunning()) return {};
+  return SampleModules();
+}
+
+std::string Pipeline::GetMetrics() {
+  OpenMetricsWriter writer;
+  using Labels = OpenMetricsWriter::Labels;
+  const std::string& pipeline_name = GetName();
+
+  std::vector<const NodeContext*> queued_modules;
+  for (auto node = graph_->DFSBegin(); node != graph_->DFSEnd(); ++node) {
+    if (node->data.connector) queued_modules.push_back(&node->data);
+  }
+  auto queue_family = [&](const std::string& name, const std::string& help,
+                          std::function<double(const NodeContext&)> value) {
+    writer.AddFamily(name, "gauge", help);
+    for (const NodeContext* context : queued_modules) {
+      writer.AddSample(name, Labels{{"pipeline", pipeline_name}, {"module", context->module->GetName()}},
+                       value(*context));
+    }
+  };
+  queue_family("cnstream_module_parallelism", "The number of threads processing the module.",
+               [](const NodeContext& context) { return context.connector->GetActiveConveyorNum(); });
+  queue_family("cnstream_module_queue_depth", "The number of data in the input queues of the module.",
+               [](const NodeContext& context) {
+                 size_t depth = 0;
+                 for (size_t i = 0; i < context.connector->GetConveyorCount(); ++i) {
+                   depth += context.connector->GetConveyorSize(i);
+                 }
+                 return depth;
+               });
+  queue_family("cnstream_module_queue_capacity", "The capacity of the active input queues of the module.",
+               [](const NodeContext& context) {
+                 return context.connector->GetActiveConveyorNum() * context.connector->GetConveyorCapacity();
+               });
+  queue_family("cnstream_module_queue_push_failures",
+               "The failed pushes of the producers waiting for the full input queues of the module.",
+               [](const NodeContext& context) {
+                 uint64_t failures = 0;
+                 for (size_t i = 0; i < context.connector->GetConveyorCount(); ++i) {
+                   failures += context.connector->GetFailTime(i);
+                 }
+                 return static_cast<double>(failures);
+               });
+
+  if (IsProfilingEnabled()) {
+    PipelineProfile profile = profiler_->GetProfile();
+    // (labels, process profile) of every process of the modules and of the whole pipeline
+    std::vector<std::pair<Labels, const ProcessProfile*>> processes;
+    for (const auto& module_profile : profile.module_profiles) {
+      for (const auto& process_profile : module_profile.process_profiles) {
+        processes.emplace_back(Labels{{"pipeline", pipeline_name}, {"module", module_profile.module_name},
+                                      {"process", process_profile.process_name}}, &process_profile);
+      }
+    }
+    processes.emplace_back(Labels{{"pipeline", pipeline_name}, {"process", kOVERALL_PROCESS_NAME}},
+                           &profile.overall_profile);
+    auto process_family = [&](const std::string& name, const std::string& type, const std::string& help,
+                              std::function<double(const ProcessProfile&)> value) {
+      writer.AddFamily(name, type, help);
+      const std::string sample_name = type == "counter" ? name + "_total" : name;
+      for (const auto& process : processes) writer.AddSample(sample_name, process.first, value(*process.second));
+    };
+    process_family("cnstream_frames", "counter", "The frames completed.",
+                   [](const ProcessProfile& p) { return p.completed; });
+    process_family("cnstream_dropped_frames", "counter", "The frames dropped.",
+                   [](const ProcessProfile& p) { return p.dropped; });
+    process_family("cnstream_ongoing_frames", "gauge", "The frames being processed.",
+                   [](const ProcessProfile& p) { return p.ongoing; });
+    process_family("cnstream_fps", "gauge", "The average throughput since the start.",
+                   [](const ProcessProfile& p) { return std::max(p.fps, 0.0); });
+    writer.AddFamily("cnstream_latency_seconds", "summary", "The latency of the frames completed.", "seconds");
+    for (const auto& process : processes) {
+      const ProcessProfile& p = *process.second;
+      if (p.completed) {
+        const std::pair<const char*, double> quantiles[] = {
+            {"0.5", p.latency_p50}, {"0.99", p.latency_p99}, {"0.999", p.latency_p999}};
+        for (const auto& quantile : quantiles) {
+          Labels labels = process.first;
+          labels.emplace_back("quantile", quantile.first);
+          writer.AddSample("cnstream_latency_seconds", labels, quantile.second / 1e3);
+        }
+      }
+      writer.AddSample("cnstream_latency_seconds_sum", process.first, std::max(p.latency, 0.0) * p.completed / 1e3);
+      writer.AddSample("cnstream_latency_seconds_count", process.first, p.completed);
+    }
+    writer.AddFamily("cnstream_module_events", "counter", "The counters accumulated by the modules.");
+    for (const auto& module_profile : profile.module_profiles) {
+      for (const auto& counter : module_profile.counters) {
+        writer.AddSample("cnstream_module_events_total", Labels{{"pipeline", pipeline_name},
+                         {"module", module_profile.module_name}, {"name", counter.first}}, counter.second);
+      }
+    }
+    auto module_labels = [&](const ModuleProfile& module_profile) {
+      return Labels{{"pipeline", pipeline_name}, {"module", module_profile.module_name}};
+    };
+    writer.AddFamily("cnstream_module_received_frames", "counter", "The frames received by the modules.");
+    for (const auto& module_profile : profile.module_profiles) {
+      writer.AddSample("cnstream_module_received_frames_total", module_labels(module_profile),
+                       module_profile.frame_accounting.received);
+    }
+    writer.AddFamily("cnstream_module_dropped_frames", "counter", "The frames dropped by the modules.");
+    for (const auto& module_profile : profile.module_profiles) {
+      for (const auto& dropped : module_profile.frame_accounting.dropped_by_reason) {
+        Labels labels = module_labels(module_profile);
+        labels.emplace_back("reason", dropped.first);
+        writer.AddSample("cnstream_module_dropped_frames_total", labels, dropped.second);
+      }
+    }
+    writer.AddFamily("cnstream_module_stalled_seconds", "counter", "The time frames waited for the full input queues.",
+                     "seconds");
+    for (const auto& module_profile : profile.module_profiles) {
+      writer.AddSample("cnstream_module_stalled_seconds_total", module_labels(module_profile),
+                       module_profile.frame_accounting.stalled / 1e3);
+    }
+    if (!profile.device_utilizations.empty()) {
+      writer.AddFamily("cnstream_device_utilization_ratio", "gauge", "The utilization of the devices.", "ratio");
+      for (const auto& device : profile.device_utilizations) {
+        const std::pair<const char*, double> utilizations[] = {
+            {"core", device.core_utilization}, {"memory", device.memory_utilization},
+            {"codec", device.codec_utilization}};
+        for (const auto& utilization : utilizations) {
+          if (utilization.second < 0) continue;
+          writer.AddSample("cnstream_device_utilization_ratio", Labels{{"pipeline", pipeline_name},
+                           {"device", std::to_string(device.device_id)}, {"type", utilization.first}},
+                           utilization.second / 100);
+        }
+      }
+    }
+    writer.AddFamily("cnstream_pipeline_cpu_seconds", "counter", "The CPU time consumed by the pipeline threads.",
+                     "seconds");
+    writer.AddSample("cnstream_pipeline_cpu_seconds_total", Labels{{"pipeline", pipeline_name}},
+                     profile.cpu_usage.cpu_time / 1e3);
+    writer.AddFamily("cnstream_pipeline_threads", "gauge", "The live threads of the pipeline.");
+    writer.AddSample("cnstream_pipeline_threads", Labels{{"pipeline", pipeline_name}}, profile.cpu_usage.thread_num);
+  }
+
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  if (accountant.IsEnabled()) {
+    const MemoryUsage usage = accountant.GetUsage(pipeline_name);
+    writer.AddFamily("cnstream_memory_bytes", "gauge", "The memory held by the pipeline.", "bytes");
+    writer.AddSample("cnstream_memory_bytes", Labels{{"pipeline", pipeline_name}, {"type", "host"}}, usage.host_bytes);
+    writer.AddSample("cnstream_memory_bytes", Labels{{"pipeline", pipeline_name}, {"type", "device"}},
+                     usage.device_bytes);
+    writer.AddFamily("cnstream_memory_peak_bytes", "gauge", "The peak memory held by the pipeline.", "bytes");
+    writer.AddSample("cnstream_memory_peak_bytes", Labels{{"pipeline", pipeline_name}, {"type", "host"}},
+                     usage.peak_host_bytes);
+    writer.AddSample("cnstream_memory_peak_bytes", Labels{{"pipeline", pipeline_name}, {"type", "device"}},
+                     usage.peak_device_bytes);
+    writer.AddFamily("cnstream_stream_memory_bytes", "gauge", "The memory held by the streams.", "bytes");
+    for (const auto& it : accountant.GetStreamUsages(pipeline_name)) {
+      writer.AddSample("cnstream_stream_memory_bytes",
+                       Labels{{"pipeline", pipeline_name}, {"stream", it.first}, {"type", "host"}},
+                       it.second.host_bytes);
+      writer.AddSample("cnstream_stream_memory_bytes",
+                       Labels{{"pipeline", pipeline_name}, {"stream", it.first}, {"type", "device"}},
+                       it.second.device_bytes);
+    }
+  }
+
+  if (admission_) {
+    writer.AddFamily("cnstream_admission_capacity_fps", "gauge", "The frame rate shared by the streams admitted.");
+    writer.AddSample("cnstream_admission_capacity_fps", Labels{{"pipeline", pipeline_name}},
+                     admission_->GetCapacity());
+    const std::map<std::string, AdmissionStreamState> states = admission_->GetStreamStates();
+    writer.AddFamily("cnstream_stream_allowed_fps", "gauge", "The frame rate admitted for the streams.");
+    for (const auto& it : states) {
+      writer.AddSample("cnstream_stream_allowed_fps", Labels{{"pipeline", pipeline_name}, {"stream", it.first}},
+                       it.second.allowed_fps);
+    }
+    writer.AddFamily("cnstream_stream_rejected_frames", "counter", "The frames of the streams rejected by admission.");
+    for (const auto& it : states) {
+      writer.AddSample("cnstream_stream_rejected_frames_total",
+                       Labels{{"pipeline", pipeline_name}, {"stream", it.first}}, it.second.rejected);
+    }
+  }
+
+  if (degradation_) {
+    writer.AddFamily("cnstream_degradation_level", "gauge", "The number of degradation steps applied.");
+    writer.AddSample("cnstream_degradation_level", Labels{{"pipeline", pipeline_name}}, degradation_->GetLevel());
+  }
+
+  if (frame_pool_) {
+    writer.AddFamily("cnstream_frame_pool_frames", "gauge", "The frames of the frame pool.");
+    writer.AddSample("cnstream_frame_pool_frames", Labels{{"pipeline", pipeline_name}, {"state", "idle"}},
+                     frame_pool_->GetIdleNumber());
+    writer.AddSample("cnstream_frame_pool_frames", Labels{{"pipeline", pipeline_name}, {"state", "in_use"}},
+                     frame_pool_->GetInUseNumber());
+  }
+
+  // the pools are shared by the process, (name, sub-pool, statistics)
+  std::vector<std::tuple<std::string, std::pair<int, int>, MemoryPoolStats>> pools;
+  for (const auto& it : MluMemoryPool::Instance().GetAllStats()) pools.emplace_back("mlu", it.first, it.second);
+  for (const auto& it : HostMemoryPool::Instance().GetAllStats()) pools.emplace_back("host", it.first, it.second);
+  for (const auto& it : HugePageMemoryPool::Instance().GetAllStats()) {
+    pools.emplace_back("huge_page", it.first, it.second);
+  }
+  auto pool_labels = [&](const std::tuple<std::string, std::pair<int, int>, MemoryPoolStats>& pool) {
+    return Labels{{"pipeline", pipeline_name}, {"pool", std::get<0>(pool)},
+                  {"device", std::to_string(std::get<1>(pool).first)},
+                  {"channel", std::to_string(std::get<1>(pool).second)}};
+  };
+  writer.AddFamily("cnstream_memory_pool_bytes", "gauge", "The memory of the caching memory pools.", "bytes");
+  for (const auto& pool : pools) {
+    Labels labels = pool_labels(pool);
+    labels.emplace_back("state", "in_use");
+    writer.AddSample("cnstream_memory_pool_bytes", labels, std::get<2>(pool).in_use_bytes);
+    labels.back().second = "cached";
+    writer.AddSample("cnstream_memory_pool_bytes", labels, std::get<2>(pool).cached_bytes);
+  }
+  writer.AddFamily("cnstream_memory_pool_allocs", "counter", "The allocations of the caching memory pools.");
+  for (const auto& pool : pools) {
+    writer.AddSample("cnstream_memory_pool_allocs_total", pool_labels(pool), std::get<2>(pool).alloc_num);
+  }
+  writer.AddFamily("cnstream_memory_pool_hits", "counter",
+                   "The allocations of the caching memory pools served by cached blocks.");
+  for (const auto& pool : pools) {
+    writer.AddSample("cnstream_memory_pool_hits_total", pool_labels(pool), std::get<2>(pool).hit_num);
+  }
+  return writer.Finish();
+}
+
 EventHandleFlag Pipeline::DefaultBusWatch(const Event& event) {
   StreamMsg smsg;
   EventHandleFlag ret;
@@ -478,10 +2320,20 @@ EventHandleFlag Pipeline::DefaultBusWatch(const Event& event) {
       smsg.stream_id = event.stream_id;
       UpdateByStreamMsg(smsg);
       LOGD(CORE) << "Pipeline received stream error from module " + event.module_name
-                 << " of stream " << event.stream_id;
+                 << " of stream " << event.stream_id << ", " << event.coalesced << " more coalesced";
       ret = EventHandleFlag::EVENT_HANDLE_SYNCED;
       break;
     }
+    case EventType::EVENT_CIRCUIT_BREAKER:
+    case EventType::EVENT_DEGRADATION:
+      LOGW(CORE) << "[" << event.module_name << "]: " << event.message;
+      ret = EventHandleFlag::EVENT_HANDLE_SYNCED;
+      break;
+    case EventType::EVENT_CONTROL:
+      // control messages are handled by the bus watchers of applications
+      LOGD(CORE) << "Pipeline received control message from module " << event.module_name << ": " << event.message;
+      ret = EventHandleFlag::EVENT_HANDLE_NULL;
+      break;
     case EventType::EVENT_INVALID:
       LOGE(CORE) << "[" << event.module_name << "]: "
                  << event.message;
@@ -495,6 +2347,10 @@ EventHandleFlag Pipeline::DefaultBusWatch(const Event& event) {
 void Pipeline::UpdateByStreamMsg(const StreamMsg& msg) {
   LOGD(CORE) << "[" << GetName() << "] "
              << "stream: " << msg.stream_id << " got message: " << static_cast<std::size_t>(msg.type);
+  {
+    std::lock_guard<std::mutex> lk(msg_mtx_);
+    pending_msg_num_++;
+  }
   msgq_.Push(msg);
 }
 
@@ -532,18 +2388,18 @@ void Pipeline::StreamMsgHandleFunc() {
       default:
         break;
     }
+    std::lock_guard<std::mutex> lk(msg_mtx_);
+    if (0 == --pending_msg_num_) msg_cond_.notify_all();
   }
 }
 
 uint32_t GetMaxStreamNumber() { return MAX_STREAM_NUM; }
 
-uint32_t GetMaxModuleNumber() {
-  /*maxModuleIdNum is sizeof(module_id_mask_) * 8  (bytes->bits)*/
-  return sizeof(uint64_t) * 8;
-}
+uint32_t GetMaxModuleNumber() { return MAX_MODULE_NUM; }
 
-uint32_t IdxManager::GetStreamIndex(const std::string& stream_id) {
+uint32_t IdxManager::GetStreamIndex(const std::string& stream_id, bool* assigned) {
   std::lock_guard<std::mutex> guard(id_lock);
+  if (assigned) *assigned = false;
   auto search = stream_idx_map.find(stream_id);
   if (search != stream_idx_map.end()) {
     return search->second;
@@ -553,12 +2409,20 @@ uint32_t IdxManager::GetStreamIndex(const std::string& stream_id) {
     if (!stream_bitset[i]) {
       stream_bitset.set(i);
       stream_idx_map[stream_id] = i;
+      stream_states.Assign(i);
+      if (assigned) *assigned = true;
       return i;
     }
   }
   return INVALID_STREAM_IDX;
 }
 
+uint32_t IdxManager::FindStreamIndex(const std::string& stream_id) {
+  std::lock_guard<std::mutex> guard(id_lock);
+  auto search = stream_idx_map.find(stream_id);
+  return search == stream_idx_map.end() ? INVALID_STREAM_IDX : search->second;
+}
+
 void IdxManager::ReturnStreamIndex(const std::string& stream_id) {
   std::lock_guard<std::mutex> guard(id_lock);
   auto search = stream_idx_map.find(stream_id);
@@ -571,13 +2435,27 @@ void IdxManager::ReturnStreamIndex(const std::string& stream_id) {
   }
   stream_bitset.reset(stream_idx);
   stream_idx_map.erase(search);
+  stream_states.Unassign(stream_idx);
+}
+
+bool IdxManager::SetStreamRemoved(const std::string& stream_id, bool removed) {
+  uint32_t stream_idx;
+  uint64_t state;
+  {
+    std::lock_guard<std::mutex> guard(id_lock);
+    auto search = stream_idx_map.find(stream_id);
+    if (search == stream_idx_map.end()) return false;
+    stream_idx = search->second;
+    state = stream_states.Load(stream_idx);
+  }
+  return stream_states.SetRemoved(stream_idx, state, removed);
 }
 
 size_t IdxManager::GetModuleIdx() {
   std::lock_guard<std::mutex>  guard(id_lock);
   for (size_t i = 0; i < GetMaxModuleNumber(); i++) {
-    if (!(module_id_mask_ & ((uint64_t)1 << i))) {
-      module_id_mask_ |= (uint64_t)1 << i;
+    if (!module_id_bitset[i]) {
+      module_id_bitset.set(i);
       return i;
     }
   }
@@ -589,7 +2467,7 @@ void IdxManager::ReturnModuleIdx(size_t id_) {
   if (id_ >= GetMaxModuleNumber()) {
     return;
   }
-  module_id_mask_ &= ~(1 << id_);
+  module_id_bitset.reset(id_);
 }
 
 }  // namespace cnstream
@@ -0,0 +1,151 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_resource_manager.hpp"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+ResourceLease::~ResourceLease() {
+  DeviceResourceManager::Instance().Release(*this);
+}
+
+DeviceResourceManager& DeviceResourceManager::Instance() {
+  // never destroyed, the leases may be returned by static objects at exit
+  static DeviceResourceManager* instance = new DeviceResourceManager;
+  return *instance;
+}
+
+void DeviceResourceManager::SetCapacity(int device_id, const std::string& kind, uint32_t capacity) {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    resources_[ResourceKey(device_id, kind)].capacity = capacity;
+  }
+  LOGI(CORE) << "[DeviceResourceManager] Capacity of " << kind << " on device " << device_id << " is set to "
+             << (capacity ? std::to_string(capacity) : std::string("unlimited"));
+  cond_.notify_all();
+}
+
+uint32_t DeviceResourceManager::GetCapacity(int device_id, const std::string& kind) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = resources_.find(ResourceKey(device_id, kind));
+  return it == resources_.end() ? 0 : it->second.capacity;
+}
+
+bool DeviceResourceManager::SetWeight(const std::string& pipeline_name, double weight) {
+  if (!(weight > 0)) {
+    LOGE(CORE) << "[DeviceResourceManager] [" << pipeline_name << "]: weight must be greater than 0, but got "
+               << weight;
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    weights_[pipeline_name] = weight;
+  }
+  cond_.notify_all();
+  return true;
+}
+
+double DeviceResourceManager::GetWeight(const std::string& pipeline_name) const {
+  auto it = weights_.find(pipeline_name);
+  return it == weights_.end() ? 1 : it->second;
+}
+
+bool DeviceResourceManager::CanGrant(const Resource& resource, const std::string& pipeline_name) const {
+  if (!resource.capacity) return true;
+  if (resource.in_use >= resource.capacity) return false;
+  // the free units go first to the waiting pipelines holding fewer units for their weights
+  const uint32_t free_units = resource.capacity - resource.in_use;
+  const double share = resource.pipelines.at(pipeline_name).held / GetWeight(pipeline_name);
+  uint32_t ahead = 0;
+  for (const auto& it : resource.pipelines) {
+    if (it.first == pipeline_name || !it.second.waiting) continue;
+    const double other_share = it.second.held / GetWeight(it.first);
+    if (other_share < share || (other_share == share && it.first < pipeline_name)) ahead += it.second.waiting;
+  }
+  return ahead < free_units;
+}
+
+std::unique_ptr<ResourceLease> DeviceResourceManager::Acquire(const std::string& pipeline_name, int device_id,
+                                                              const std::string& kind, uint32_t timeout_ms) {
+  std::unique_lock<std::mutex> lk(mtx_);
+  Resource& resource = resources_[ResourceKey(device_id, kind)];
+  PipelineState& state = resource.pipelines[pipeline_name];
+  ++state.waiting;
+  const bool granted = cond_.wait_for(lk, std::chrono::milliseconds(timeout_ms),
+                                      [&] { return CanGrant(resource, pipeline_name); });
+  --state.waiting;
+  if (!granted) {
+    const uint32_t in_use = resource.in_use, capacity = resource.capacity;
+    if (!state.held && !state.waiting) resource.pipelines.erase(pipeline_name);
+    lk.unlock();
+    // a unit may be left to the pipelines behind this one
+    cond_.notify_all();
+    LOGW(CORE) << "[DeviceResourceManager] [" << pipeline_name << "]: no " << kind << " available on device "
+               << device_id << " in " << timeout_ms << " ms, " << in_use << " of " << capacity << " in use.";
+    return nullptr;
+  }
+  ++state.held;
+  ++resource.in_use;
+  return std::unique_ptr<ResourceLease>(new ResourceLease(pipeline_name, device_id, kind));
+}
+
+void DeviceResourceManager::Release(const ResourceLease& lease) {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    Resource& resource = resources_[ResourceKey(lease.device_id_, lease.kind_)];
+    auto it = resource.pipelines.find(lease.pipeline_name_);
+    if (it == resource.pipelines.end() || !it->second.held || !resource.in_use) {
+      LOGE(CORE) << "[DeviceResourceManager] [" << lease.pipeline_name_ << "]: releases " << lease.kind_
+                 << " on device " << lease.device_id_ << " which is not held.";
+      return;
+    }
+    --it->second.held;
+    --resource.in_use;
+    if (!it->second.held && !it->second.waiting) resource.pipelines.erase(it);
+  }
+  cond_.notify_all();
+}
+
+std::vector<ResourceUsage> DeviceResourceManager::GetUsages() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::vector<ResourceUsage> usages;
+  for (const auto& it : resources_) {
+    ResourceUsage usage;
+    usage.device_id = it.first.first;
+    usage.kind = it.first.second;
+    usage.capacity = it.second.capacity;
+    usage.in_use = it.second.in_use;
+    for (const auto& pipeline : it.second.pipelines) {
+      usage.pipelines[pipeline.first] = std::make_pair(pipeline.second.held, pipeline.second.waiting);
+    }
+    usages.push_back(usage);
+  }
+  return usages;
+}
+
+}  // namespace cnstream
@@ -18,15 +18,19 @@
  * THE SOFTWARE.
  *************************************************************************/
 #include <bitset>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
 #include <map>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "cnstream_source.hpp"
 #include "cnstream_eventbus.hpp"
 #include "cnstream_pipeline.hpp"
+#include "private/cnstream_common_pri.hpp"
 #include "profiler/module_profiler.hpp"
 
 
@@ -89,6 +93,24 @@ void SourceModule::ReturnStreamIndex(const std::string &stream_id) {
 #endif
 }
 
+std::shared_ptr<CNFrameInfo> SourceModule::CreateFrameInfo(const std::string &stream_id, bool eos,
+                                                           std::shared_ptr<CNFrameInfo> payload) {
+  RwLockReadGuard guard(container_lock_);
+  CNFrameInfoPool* pool = container_ ? container_->GetFramePool() : nullptr;
+  if (pool) return pool->Create(stream_id, eos, payload);
+  return CNFrameInfo::Create(stream_id, eos, payload);
+}
+
+bool SourceModule::WaitForFrame(uint32_t timeout_ms) {
+  {
+    RwLockReadGuard guard(container_lock_);
+    CNFrameInfoPool* pool = container_ ? container_->GetFramePool() : nullptr;
+    if (pool && pool->GetMaxFrames()) return pool->WaitForIdle(timeout_ms);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+  return false;
+}
+
 int SourceModule::AddSource(std::shared_ptr<SourceHandler> handler) {
   if (!handler) {
     LOGE(CORE) << "handler is null";
@@ -111,13 +133,59 @@ int SourceModule::AddSource(std::shared_ptr<SourceHandler> handler) {
   LOGI(CORE) << "[" << handler->GetStreamId() << "]: " << "Stream opening...";
   if (handler->Open() != true) {
     LOGE(CORE) << "[" << stream_id << "]: " << "stream Open failed";
+    OnSourceClosed(stream_id);
     return -1;
   }
   source_map_[stream_id] = handler;
+  lock.unlock();
+  {
+    RwLockReadGuard guard(container_lock_);
+    if (container_) container_->NotifyStreamAdded(this, stream_id);
+  }
   LOGI(CORE) << "Add stream success, stream id : [" << stream_id << "]";
   return 0;
 }
 
+int SourceModule::AddSources(const std::vector<std::shared_ptr<SourceHandler>> &handlers) {
+  std::vector<std::string> added;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const auto &handler : handlers) {
+      if (!handler) {
+        LOGE(CORE) << "handler is null";
+        continue;
+      }
+      std::string stream_id = handler->GetStreamId();
+      if (source_map_.find(stream_id) != source_map_.end()) {
+        LOGE(CORE) << "[" << stream_id << "]: " << "Duplicate stream_id";
+        continue;
+      }
+      if (source_map_.size() >= GetMaxStreamNumber()) {
+        LOGW(CORE) << "[" << stream_id << "]: "
+                   << " doesn't add to pipeline because of maximum limitation: " << GetMaxStreamNumber();
+        continue;
+      }
+      SetStreamRemoved(stream_id, false);
+      LOGI(CORE) << "[" << stream_id << "]: " << "Stream opening...";
+      if (handler->Open() != true) {
+        LOGE(CORE) << "[" << stream_id << "]: " << "stream Open failed";
+        OnSourceClosed(stream_id);
+        continue;
+      }
+      source_map_[stream_id] = handler;
+      added.push_back(stream_id);
+    }
+  }
+  {
+    RwLockReadGuard guard(container_lock_);
+    if (container_) {
+      for (const auto &stream_id : added) container_->NotifyStreamAdded(this, stream_id);
+    }
+  }
+  LOGI(CORE) << "Add " << added.size() << " of " << handlers.size() << " streams success";
+  return static_cast<int>(added.size());
+}
+
 int SourceModule::RemoveSource(std::shared_ptr<SourceHandler> handler, bool force) {
   if (!handler) {
     return -1;
@@ -168,6 +236,7 @@ int SourceModule::RemoveSource(const std::string &stream_id, bool force) {
 }
 
 int SourceModule::RemoveSources(bool force) {
+  WaitRemoving();
   {
     std::unique_lock<std::mutex> lock(mutex_);
     for (auto &iter : source_map_) {
@@ -188,17 +257,133 @@ int SourceModule::RemoveSources(bool force) {
     for (auto &iter : source_map_) {
       CheckStreamEosReached(iter.first, force);
       SetStreamRemoved(iter.first, false);
+      OnSourceClosed(iter.first);
     }
     source_map_.clear();
   }
   return 0;
 }
 
+int SourceModule::RemoveSources(const std::vector<std::string> &stream_ids, bool force) {
+  DoRemoveSources(stream_ids, force, nullptr);
+  return 0;
+}
+
+int SourceModule::RemoveSourcesAsync(const std::vector<std::string> &stream_ids, SourceRemovedCallback callback,
+                                     bool force) {
+  std::lock_guard<std::mutex> lock(removing_mutex_);
+  // forgets the removals finished
+  for (auto it = removing_.begin(); it != removing_.end();) {
+    if (it->wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      it = removing_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  removing_.push_back(std::async(std::launch::async, [this, stream_ids, callback, force] {
+    DoRemoveSources(stream_ids, force, callback);
+  }));
+  return 0;
+}
+
+void SourceModule::DoRemoveSources(const std::vector<std::string> &stream_ids, bool force,
+                                   const SourceRemovedCallback &callback) {
+  LOGI(CORE) << "Begin to remove " << stream_ids.size() << " streams";
+  for (const auto &stream_id : stream_ids) SetStreamRemoved(stream_id, force);
+  std::vector<std::string> closed;
+  // Close handlers first, stops all of them before closing like RemoveSources(bool) does
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<SourceHandler *> handlers;
+    for (const auto &stream_id : stream_ids) {
+      auto iter = source_map_.find(stream_id);
+      if (iter == source_map_.end()) {
+        LOGW(CORE) << "stream named [" << stream_id << "] does not exist\n";
+        continue;
+      }
+      handlers.push_back(iter->second.get());
+      closed.push_back(stream_id);
+    }
+    for (auto handler : handlers) handler->Stop();
+    for (auto handler : handlers) handler->Close();
+  }
+  auto removed = [&](const std::string &stream_id) {
+    SetStreamRemoved(stream_id, false);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      source_map_.erase(stream_id);
+      OnSourceClosed(stream_id);
+    }
+    LOGI(CORE) << "Finish removing stream, stream id : [" << stream_id << "]";
+    if (callback) callback(stream_id);
+  };
+  if (force) {
+    // waits for the eos of all streams at the same time
+    WaitStreamsEosReached(closed, removed);
+  } else {
+    for (const auto &stream_id : closed) {
+      CheckStreamEosReached(stream_id, false);
+      removed(stream_id);
+    }
+  }
+}
+
+void SourceModule::WaitRemoving() {
+  while (true) {
+    std::list<std::future<void>> removing;
+    {
+      std::lock_guard<std::mutex> lock(removing_mutex_);
+      if (removing_.empty()) return;
+      removing.swap(removing_);
+    }
+    // the callbacks may remove more streams
+    for (auto &future : removing) future.wait();
+  }
+}
+
+void SourceModule::SetStreamRemoved(const std::string &stream_id, bool removed) {
+  RwLockReadGuard guard(container_lock_);
+  if (container_) {
+    container_->SetStreamRemoved(stream_id, removed);
+  } else {
+    cnstream::SetStreamRemoved(stream_id, removed);
+  }
+}
+
+MemoryOwner SourceModule::GetMemoryOwner(const std::string &stream_id) {
+  RwLockReadGuard guard(container_lock_);
+  if (container_) return container_->GetMemoryOwner(stream_id);
+  return {};
+}
+
 bool SourceModule::SendData(std::shared_ptr<CNFrameInfo> data) {
-  if (!data->IsEos() && IsStreamRemoved(data->stream_id)) {
-    return false;
+  if (!data->IsEos()) {
+    RwLockReadGuard guard(container_lock_);
+    if (container_ ? container_->IsStreamRemoved(data) : IsStreamRemoved(data->stream_id)) return false;
+    // the frames exceeding the share of the stream are dropped before entering an overloaded pipeline.
+    if (container_ && !container_->Admit(this, data->stream_id)) return false;
+    // backpressure, downstream modules release memory before the source allocates more.
+    if (container_) container_->WaitForMemoryBudget(data->stream_id);
   }
   return this->TransmitData(data);
 }
 
+bool SourceModule::SendDataBatch(const std::vector<std::shared_ptr<CNFrameInfo>>& data_vec) {
+  std::vector<std::shared_ptr<CNFrameInfo>> batch;
+  batch.reserve(data_vec.size());
+  {
+    RwLockReadGuard guard(container_lock_);
+    for (const auto& data : data_vec) {
+      if (!data->IsEos()) {
+        if (container_ ? container_->IsStreamRemoved(data) : IsStreamRemoved(data->stream_id)) continue;
+        if (container_ && !container_->Admit(this, data->stream_id)) continue;
+        if (container_) container_->WaitForMemoryBudget(data->stream_id);
+      }
+      batch.push_back(data);
+    }
+  }
+  if (batch.empty()) return false;
+  return this->TransmitDataBatch(batch);
+}
+
 }  // namespace cnstream
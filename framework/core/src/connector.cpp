@@ -20,7 +20,9 @@
 
 #include "connector.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <vector>
 
 #include "conveyor.hpp"
@@ -28,15 +30,22 @@
 
 namespace cnstream {
 
-Connector::Connector(const size_t conveyor_count, size_t conveyor_capacity) {
+Connector::Connector(const size_t conveyor_count, size_t conveyor_capacity, InputQueueType queue_type)
+    : queue_type_(queue_type) {
   conveyor_capacity_ = conveyor_capacity;
   conveyors_.reserve(conveyor_count);
   fail_times_.reserve(conveyor_count);
   for (size_t i = 0; i < conveyor_count; ++i) {
-    Conveyor* conveyor = new (std::nothrow) Conveyor(conveyor_capacity);
+    Conveyor* conveyor = nullptr;
+    if (InputQueueType::LOCK_FREE == queue_type) {
+      conveyor = new (std::nothrow) LockFreeConveyor(conveyor_capacity);
+    } else {
+      conveyor = new (std::nothrow) Conveyor(conveyor_capacity);
+    }
     LOGF_IF(CORE, nullptr == conveyor) << "Connector::Connector()  new Conveyor failed.";
     conveyors_.push_back(conveyor);
   }
+  active_conveyor_num_.store(conveyor_count);
 }
 
 Connector::~Connector() {
@@ -73,10 +82,192 @@ CNFrameInfoPtr Connector::PopDataBufferFromConveyor(int conveyor_idx) {
   return GetConveyor(conveyor_idx)->PopDataBuffer();
 }
 
+CNFrameInfoPtr Connector::TryPopDataBufferFromConveyor(int conveyor_idx) {
+  return GetConveyor(conveyor_idx)->TryPopDataBuffer();
+}
+
+std::vector<CNFrameInfoPtr> Connector::PopDataBuffersFromConveyor(int conveyor_idx, size_t max_num,
+                                                                  std::chrono::microseconds timeout) {
+  return GetConveyor(conveyor_idx)->PopDataBuffers(max_num, timeout);
+}
+
 bool Connector::PushDataBufferToConveyor(int conveyor_idx, CNFrameInfoPtr data) {
   return GetConveyor(conveyor_idx)->PushDataBuffer(data);
 }
 
+size_t Connector::PushDataBuffersToConveyor(int conveyor_idx, const std::vector<CNFrameInfoPtr>& data) {
+  return GetConveyor(conveyor_idx)->PushDataBuffers(data);
+}
+
+bool Connector::WaitConveyorNotFull(int conveyor_idx) {
+  return GetConveyor(conveyor_idx)->WaitNotFull();
+}
+
+CNFrameInfoPtr Connector::DropOldestDataBufferFromConveyor(int conveyor_idx) {
+  CNFrameInfoPtr data = GetConveyor(conveyor_idx)->DropOldestDataBuffer();
+  if (data) ReleaseConveyor(data->GetStreamIndex(), data->IsEos());
+  return data;
+}
+
+bool Connector::PushEosToConveyor(int conveyor_idx, CNFrameInfoPtr data, std::vector<CNFrameInfoPtr>* dropped) {
+  if (queue_type_ == InputQueueType::LOCK_FREE) return false;
+  // the data of the stream may be in any conveyor, e.g. it is being moved, see CNModuleConfig::streamParallel
+  for (Conveyor* conveyor : conveyors_) {
+    for (auto& it : conveyor->DropStreamDataBuffers(data->stream_id)) {
+      ReleaseConveyor(it->GetStreamIndex(), false);
+      dropped->push_back(std::move(it));
+    }
+  }
+  return GetConveyor(conveyor_idx)->PushPriorityDataBuffer(std::move(data));
+}
+
+// check whether to rebalance a stream every kRebalanceInterval data of the stream
+static constexpr uint32_t kRebalanceInterval = 50;
+static constexpr uint32_t kMaxRebalanceInterval = 50 * 64;
+// the maximum time waiting for the data of a stream in the old conveyor to be processed
+static constexpr std::chrono::milliseconds kMigrateTimeout{100};
+
+void Connector::EnableStreamRebalance(bool enable) {
+  std::lock_guard<std::mutex> lk(route_mutex_);
+  rebalance_ = enable && conveyors_.size() > 1;
+  routes_.assign(rebalance_ ? MAX_STREAM_NUM : 0, StreamRoute());
+  conveyor_stream_nums_.assign(conveyors_.size(), 0);
+}
+
+int Connector::SelectConveyorForNewStream() const {
+  int selected = 0;
+  size_t selected_size = GetConveyorSize(0);
+  for (int idx = 1; idx < static_cast<int>(active_conveyor_num_.load()); ++idx) {
+    size_t size = GetConveyorSize(idx);
+    if (conveyor_stream_nums_[idx] < conveyor_stream_nums_[selected] ||
+        (conveyor_stream_nums_[idx] == conveyor_stream_nums_[selected] && size < selected_size)) {
+      selected = idx;
+      selected_size = size;
+    }
+  }
+  return selected;
+}
+
+bool Connector::MigrateStream(StreamRoute* route, std::unique_lock<std::mutex>* lk, bool force) {
+  int target = 0;
+  size_t target_size = GetConveyorSize(0);
+  for (int idx = 1; idx < static_cast<int>(active_conveyor_num_.load()); ++idx) {
+    size_t size = GetConveyorSize(idx);
+    if (size < target_size) {
+      target = idx;
+      target_size = size;
+    }
+  }
+  const size_t threshold = std::max<size_t>(2, conveyor_capacity_ / 4);
+  if (target == route->conveyor_idx) return false;
+  if (!force && GetConveyorSize(route->conveyor_idx) < target_size + threshold) return false;
+  // drain the data of this stream in the old conveyor first to keep order.
+  route->migrating = true;
+  route_cond_.wait_for(*lk, kMigrateTimeout, [&] { return route->inflight == 0 || IsStopped(); });
+  route->migrating = false;
+  route_cond_.notify_all();
+  if (route->inflight != 0 || route->conveyor_idx < 0) return false;
+  if (0 == --conveyor_stream_nums_[route->conveyor_idx]) WakeRetiredConveyor(route->conveyor_idx);
+  conveyor_stream_nums_[target]++;
+  route->conveyor_idx = target;
+  return true;
+}
+
+int Connector::AcquireConveyor(uint32_t stream_idx, bool* remapped, bool movable) {
+  if (remapped) *remapped = false;
+  if (!rebalance_ || stream_idx >= routes_.size()) return stream_idx % conveyors_.size();
+  std::unique_lock<std::mutex> lk(route_mutex_);
+  StreamRoute* route = &routes_[stream_idx];
+  // another producer is moving this stream
+  route_cond_.wait(lk, [&] { return !route->migrating; });
+  if (route->conveyor_idx < 0) {
+    route->conveyor_idx = SelectConveyorForNewStream();
+    route->check_cnt = 0;
+    route->check_interval = kRebalanceInterval;
+    conveyor_stream_nums_[route->conveyor_idx]++;
+    if (remapped) *remapped = true;
+  } else if (!movable) {
+    // checked on the next movable data of the stream
+    if (route->check_cnt < route->check_interval) route->check_cnt++;
+  } else if (route->conveyor_idx >= static_cast<int>(active_conveyor_num_.load())) {
+    // the conveyor is retired by the autoscaler, moves the stream as soon as its data there is processed.
+    if ((0 == route->inflight || ++route->check_cnt >= kRebalanceInterval) && !IsStopped()) {
+      route->check_cnt = 0;
+      if (MigrateStream(route, &lk, true) && remapped) *remapped = true;
+    }
+  } else if (++route->check_cnt >= route->check_interval && !IsStopped()) {
+    route->check_cnt = 0;
+    if (MigrateStream(route, &lk)) {
+      route->check_interval = kRebalanceInterval;
+      if (remapped) *remapped = true;
+    } else {
+      // backs off when the stream can not be moved, e.g. the module never releases the data.
+      route->check_interval = std::min(route->check_interval * 2, kMaxRebalanceInterval);
+    }
+  }
+  route->inflight++;
+  return route->conveyor_idx;
+}
+
+void Connector::ReleaseConveyor(uint32_t stream_idx, bool eos) {
+  if (!rebalance_ || stream_idx >= routes_.size()) return;
+  std::lock_guard<std::mutex> lk(route_mutex_);
+  StreamRoute* route = &routes_[stream_idx];
+  if (route->inflight) route->inflight--;
+  if (0 == route->inflight) {
+    if (eos && route->conveyor_idx >= 0 && !route->migrating) {
+      // the stream is over, the stream index might be reused by a new stream.
+      if (0 == --conveyor_stream_nums_[route->conveyor_idx]) WakeRetiredConveyor(route->conveyor_idx);
+      route->conveyor_idx = -1;
+    }
+    if (route->migrating) route_cond_.notify_all();
+  }
+}
+
+int Connector::GetStreamConveyorIdx(uint32_t stream_idx) {
+  if (!rebalance_) return static_cast<int>(stream_idx % conveyors_.size());
+  if (stream_idx >= routes_.size()) return -1;
+  std::lock_guard<std::mutex> lk(route_mutex_);
+  return routes_[stream_idx].conveyor_idx;
+}
+
+int Connector::SelectConveyor() {
+  const size_t num = active_conveyor_num_.load();
+  const size_t start = next_conveyor_.fetch_add(1, std::memory_order_relaxed) % num;
+  int selected = static_cast<int>(start);
+  size_t selected_size = GetConveyorSize(selected);
+  for (size_t i = 1; i < num && selected_size > 0; ++i) {
+    const int idx = static_cast<int>((start + i) % num);
+    const size_t size = GetConveyorSize(idx);
+    if (size < selected_size) {
+      selected = idx;
+      selected_size = size;
+    }
+  }
+  return selected;
+}
+
+void Connector::SetActiveConveyorNum(size_t num) {
+  std::lock_guard<std::mutex> lk(route_mutex_);
+  if (!rebalance_) {
+    LOGW(CORE) << "The number of active conveyors can not be changed without stream rebalance.";
+    return;
+  }
+  active_conveyor_num_.store(std::max<size_t>(1, std::min(num, conveyors_.size())));
+  for (size_t idx = active_conveyor_num_.load(); idx < conveyors_.size(); ++idx) conveyors_[idx]->Wake();
+}
+
+void Connector::WakeRetiredConveyor(int conveyor_idx) {
+  // the consumer blocked in popping data checks whether the conveyor is retired, see IsConveyorRetired
+  if (conveyor_idx >= static_cast<int>(active_conveyor_num_.load())) conveyors_[conveyor_idx]->Wake();
+}
+
+bool Connector::IsConveyorRetired(int conveyor_idx) {
+  if (conveyor_idx < static_cast<int>(active_conveyor_num_.load()) || !IsConveyorEmpty(conveyor_idx)) return false;
+  std::lock_guard<std::mutex> lk(route_mutex_);
+  return conveyor_idx >= static_cast<int>(active_conveyor_num_.load()) && 0 == conveyor_stream_nums_[conveyor_idx];
+}
+
 uint64_t Connector::GetFailTime(int conveyor_idx) const {
   return GetConveyor(conveyor_idx)->GetFailTime();
 }
@@ -87,10 +278,14 @@ bool Connector::IsStopped() {
 
 void Connector::Start() {
   stop_.store(false);
+  // all data is cleared when stopped
+  EnableStreamRebalance(rebalance_);
 }
 
 void Connector::Stop() {
   stop_.store(true);
+  // the consumers blocked in popping data check the stop flag
+  for (Conveyor* conveyor : conveyors_) conveyor->Wake();
 }
 
 Conveyor* Connector::GetConveyorByIdx(int idx) const {
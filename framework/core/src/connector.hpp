@@ -22,9 +22,12 @@
 #define MODULES_CORE_INCLUDE_CONNECTOR_HPP_
 
 #include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <vector>
 
+#include "cnstream_config.hpp"
 #include "cnstream_frame.hpp"
 
 namespace cnstream {
@@ -58,8 +61,10 @@ class Connector : private NonCopyable {
    * @param
    *   [conveyor_count]: the conveyor num of this connector.
    *   [conveyor_capacity]: the maximum buffer number of a conveyor.
+   *   [queue_type]: the implementation of conveyors.
    */
-  explicit Connector(const size_t conveyor_count, size_t conveyor_capacity = 20);
+  explicit Connector(const size_t conveyor_count, size_t conveyor_capacity = 20,
+                     InputQueueType queue_type = InputQueueType::MUTEX);
   ~Connector();
 
   const size_t GetConveyorCount() const;
@@ -70,7 +75,86 @@ class Connector : private NonCopyable {
   uint64_t GetFailTime(int conveyor_idx) const;
 
   CNFrameInfoPtr PopDataBufferFromConveyor(int conveyor_idx);
+  /**
+   * @brief Pops data without waiting. Returns nullptr if the conveyor is empty.
+   */
+  CNFrameInfoPtr TryPopDataBufferFromConveyor(int conveyor_idx);
+  std::vector<CNFrameInfoPtr> PopDataBuffersFromConveyor(int conveyor_idx, size_t max_num,
+                                                         std::chrono::microseconds timeout);
   bool PushDataBufferToConveyor(int conveyor_idx, CNFrameInfoPtr data);
+  /**
+   * @brief Pushes the data in order as long as the conveyor is not full. Returns the number of data pushed, see
+   * Conveyor::PushDataBuffers.
+   */
+  size_t PushDataBuffersToConveyor(int conveyor_idx, const std::vector<CNFrameInfoPtr>& data);
+  /**
+   * @brief Waits until the conveyor is not full or timeout. Returns true if the conveyor is not full.
+   */
+  bool WaitConveyorNotFull(int conveyor_idx);
+  /**
+   * @brief Drops the oldest data which is not EOS in the conveyor. Returns the dropped data, nullptr if no data is
+   * dropped.
+   */
+  CNFrameInfoPtr DropOldestDataBufferFromConveyor(int conveyor_idx);
+  /**
+   * @brief Pushes the EOS of a stream removed by force ahead of the data in the conveyor, it is never blocked by a
+   * full conveyor. The data of the stream which is not processed yet is dropped from all conveyors and returned by
+   * ``dropped``, see Conveyor::PushPriorityDataBuffer.
+   *
+   * @return Returns false if the conveyors do not support it, e.g. lock free conveyors. Nothing is done.
+   */
+  bool PushEosToConveyor(int conveyor_idx, CNFrameInfoPtr data, std::vector<CNFrameInfoPtr>* dropped);
+
+  /**
+   * @brief Enables moving streams to less loaded conveyors. See CNModuleConfig::rebalanceStreams.
+   */
+  void EnableStreamRebalance(bool enable);
+  bool IsStreamRebalanceEnabled() const { return rebalance_; }
+  /**
+   * @brief Gets the conveyor to push the data of a stream to.
+   *
+   * When stream rebalance is disabled, returns ``stream_idx % conveyor_count``.
+   * Otherwise, a new stream is mapped to the conveyor with the least streams, and a stream is moved to a less
+   * loaded conveyor when the queue depth of its conveyor is much larger. Before moving, it waits for the data of
+   * the stream in the old conveyor to be processed, so the data of a stream is still processed in order.
+   * Each call must be paired with a call of ReleaseConveyor when the data leaves the downstream module.
+   *
+   * @param[in] stream_idx The stream index.
+   * @param[out] remapped Set to true if the stream is mapped to a new conveyor. It can be nullptr.
+   * @param[in] movable Whether the stream can be moved. It must be false if the caller holds data of the stream
+   *                    acquired but not pushed yet, the data would never be processed while waiting to move.
+   *
+   * @return Returns the conveyor index.
+   */
+  int AcquireConveyor(uint32_t stream_idx, bool* remapped = nullptr, bool movable = true);
+  /**
+   * @brief Marks that one data of a stream has left the downstream module, or has been dropped.
+   */
+  void ReleaseConveyor(uint32_t stream_idx, bool eos);
+  /**
+   * @brief Gets the conveyor index of a stream. Returns -1 if the stream is not mapped.
+   */
+  int GetStreamConveyorIdx(uint32_t stream_idx);
+  /**
+   * @brief Gets the conveyor to push data to regardless of its stream, used when the data of a stream is processed
+   * by several threads, see CNModuleConfig::streamParallel. The conveyors are taken in turn, and the least loaded one
+   * from there is selected.
+   */
+  int SelectConveyor();
+
+  /**
+   * @brief Sets the number of conveyors new data is pushed to, used by the autoscaler.
+   *
+   * Only the first ``num`` conveyors are used. Streams mapped to the other conveyors are moved once their data in
+   * those conveyors has been processed. It requires stream rebalance to be enabled. The consumers of the other
+   * conveyors are woken up once those conveyors might be retired, see IsConveyorRetired.
+   */
+  void SetActiveConveyorNum(size_t num);
+  size_t GetActiveConveyorNum() const { return active_conveyor_num_.load(); }
+  /**
+   * @brief Returns true if a conveyor is no longer active, is empty, and no stream is mapped to it.
+   */
+  bool IsConveyorRetired(int conveyor_idx);
 
   void Start();
   void Stop();
@@ -82,9 +166,29 @@ class Connector : private NonCopyable {
   Conveyor* GetConveyor(int conveyor_idx) const;
 
   std::vector<Conveyor*> conveyors_;
+  const InputQueueType queue_type_;
   size_t conveyor_capacity_ = 20;
   std::vector<uint64_t> fail_times_;
   std::atomic<bool> stop_{false};
+  std::atomic<uint32_t> next_conveyor_{0};  // see SelectConveyor
+
+  // stream to conveyor mapping, used when stream rebalance is enabled
+  struct StreamRoute {
+    int conveyor_idx = -1;
+    uint32_t inflight = 0;       // the number of data in the conveyor or being processed
+    uint32_t check_cnt = 0;      // the number of data since the last rebalance check
+    uint32_t check_interval = 0;
+    bool migrating = false;
+  };
+  int SelectConveyorForNewStream() const;
+  bool MigrateStream(StreamRoute* route, std::unique_lock<std::mutex>* lk, bool force = false);
+  void WakeRetiredConveyor(int conveyor_idx);  // called with route_mutex_ locked when no stream is mapped to it
+  bool rebalance_ = false;
+  std::atomic<size_t> active_conveyor_num_{0};
+  std::vector<StreamRoute> routes_;
+  std::vector<uint32_t> conveyor_stream_nums_;
+  std::mutex route_mutex_;
+  std::condition_variable route_cond_;
 };  // class Connector
 
 }  // namespace cnstream
@@ -20,8 +20,10 @@
 
 #include "conveyor.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -34,13 +36,20 @@ Conveyor::Conveyor(size_t max_size) : max_size_(max_size) {
 
 uint32_t Conveyor::GetBufferSize() {
   std::unique_lock<std::mutex> lk(data_mutex_);
-  return dataq_.size();
+  return dataq_.size() + priorityq_.size();
+}
+
+CNFrameInfoPtr Conveyor::PopFront() {
+  std::deque<CNFrameInfoPtr>& queue = priorityq_.empty() ? dataq_ : priorityq_;
+  CNFrameInfoPtr data = std::move(queue.front());
+  queue.pop_front();
+  return data;
 }
 
 bool Conveyor::PushDataBuffer(CNFrameInfoPtr data) {
   std::unique_lock<std::mutex> lk(data_mutex_);
   if (dataq_.size() < max_size_) {
-    dataq_.push(data);
+    dataq_.push_back(data);
     notempty_cond_.notify_one();
     fail_time_ = 0;
     return true;
@@ -49,32 +58,310 @@ bool Conveyor::PushDataBuffer(CNFrameInfoPtr data) {
   return false;
 }
 
+size_t Conveyor::PushDataBuffers(const std::vector<CNFrameInfoPtr>& data) {
+  std::unique_lock<std::mutex> lk(data_mutex_);
+  const size_t num = std::min(data.size(), max_size_ - std::min(max_size_, dataq_.size()));
+  dataq_.insert(dataq_.end(), data.begin(), data.begin() + num);
+  // the data not pushed is pushed one by one, it is counted as failed then
+  if (num) fail_time_ = 0;
+  if (num == 1) {
+    notempty_cond_.notify_one();
+  } else if (num > 1) {
+    notempty_cond_.notify_all();
+  }
+  return num;
+}
+
 uint64_t Conveyor::GetFailTime() {
   std::unique_lock<std::mutex> lk(data_mutex_);
   return fail_time_;
 }
 
+bool Conveyor::WaitNotEmpty(std::unique_lock<std::mutex>* lk) {
+  notempty_waiters_++;
+  notempty_cond_.wait(*lk, [&] { return !Empty() || wakeups_ > 0; });
+  notempty_waiters_--;
+  if (!Empty()) return true;
+  wakeups_--;
+  return false;
+}
+
 CNFrameInfoPtr Conveyor::PopDataBuffer() {
+  std::unique_lock<std::mutex> lk(data_mutex_);
+  if (!WaitNotEmpty(&lk)) return nullptr;
+  CNFrameInfoPtr data = PopFront();
+  if (notfull_waiters_) notfull_cond_.notify_one();
+  return data;
+}
+
+CNFrameInfoPtr Conveyor::TryPopDataBuffer() {
   std::unique_lock<std::mutex> lk(data_mutex_);
   CNFrameInfoPtr data = nullptr;
-  if (notempty_cond_.wait_for(lk, rel_time_, [&] { return !dataq_.empty(); })) {
-    data = dataq_.front();
-    dataq_.pop();
-    return data;
+  if (!Empty()) {
+    data = PopFront();
+    if (notfull_waiters_) notfull_cond_.notify_one();
   }
   return data;
 }
 
+std::vector<CNFrameInfoPtr> Conveyor::PopDataBuffers(size_t max_num, std::chrono::microseconds timeout) {
+  std::unique_lock<std::mutex> lk(data_mutex_);
+  std::vector<CNFrameInfoPtr> vec_data;
+  if (!WaitNotEmpty(&lk)) return vec_data;
+  if (!priorityq_.empty()) {
+    // an eos frame is processed alone
+    vec_data.push_back(PopFront());
+    return vec_data;
+  }
+  if (timeout.count() > 0) {
+    // an eos frame ends the batch, there is no need to wait for more data.
+    notempty_cond_.wait_for(lk, timeout, [&] {
+      const size_t num = std::min(dataq_.size(), max_num);
+      return num == max_num || !priorityq_.empty() ||
+             std::any_of(dataq_.begin(), dataq_.begin() + num, [](const CNFrameInfoPtr& data) {
+               return data->IsEos();
+             });
+    });
+  }
+  vec_data.reserve(std::min(dataq_.size(), max_num));
+  while (!dataq_.empty() && vec_data.size() < max_num) {
+    const bool eos = dataq_.front()->IsEos();
+    vec_data.push_back(std::move(dataq_.front()));
+    dataq_.pop_front();
+    if (eos) break;
+  }
+  if (notfull_waiters_) notfull_cond_.notify_all();
+  return vec_data;
+}
+
 std::vector<CNFrameInfoPtr> Conveyor::PopAllDataBuffer() {
   std::unique_lock<std::mutex> lk(data_mutex_);
+  std::vector<CNFrameInfoPtr> vec_data;
+  while (!Empty()) vec_data.push_back(PopFront());
+  if (notfull_waiters_) notfull_cond_.notify_all();
+  return vec_data;
+}
+
+bool Conveyor::WaitNotFull() {
+  std::unique_lock<std::mutex> lk(data_mutex_);
+  notfull_waiters_++;
+  bool ret = notfull_cond_.wait_for(lk, rel_time_, [&] { return dataq_.size() < max_size_; });
+  notfull_waiters_--;
+  return ret;
+}
+
+CNFrameInfoPtr Conveyor::DropOldestDataBuffer() {
+  std::unique_lock<std::mutex> lk(data_mutex_);
+  auto iter = std::find_if(dataq_.begin(), dataq_.end(),
+                           [](const CNFrameInfoPtr& data) { return !data->IsEos(); });
+  if (iter == dataq_.end()) return nullptr;
+  CNFrameInfoPtr data = *iter;
+  dataq_.erase(iter);
+  return data;
+}
+
+bool Conveyor::PushPriorityDataBuffer(CNFrameInfoPtr data) {
+  std::unique_lock<std::mutex> lk(data_mutex_);
+  priorityq_.push_back(std::move(data));
+  notempty_cond_.notify_one();
+  return true;
+}
+
+std::vector<CNFrameInfoPtr> Conveyor::DropStreamDataBuffers(const std::string& stream_id) {
+  std::unique_lock<std::mutex> lk(data_mutex_);
+  std::vector<CNFrameInfoPtr> dropped;
+  auto iter = std::remove_if(dataq_.begin(), dataq_.end(), [&](const CNFrameInfoPtr& data) {
+    if (data->IsEos() || data->stream_id != stream_id) return false;
+    dropped.push_back(data);
+    return true;
+  });
+  dataq_.erase(iter, dataq_.end());
+  if (!dropped.empty() && notfull_waiters_) notfull_cond_.notify_all();
+  return dropped;
+}
+
+void Conveyor::Wake() {
+  std::lock_guard<std::mutex> lk(data_mutex_);
+  wakeups_ = std::max<uint32_t>(notempty_waiters_, 1);
+  notempty_cond_.notify_all();
+}
+
+LockFreeConveyor::LockFreeConveyor(size_t max_size)
+    : Conveyor(max_size), capacity_(std::max<size_t>(max_size, 1)) {
+  slots_.reset(new Slot[capacity_]);
+  for (size_t i = 0; i < capacity_; ++i) {
+    slots_[i].seq.store(i, std::memory_order_relaxed);
+  }
+}
+
+uint32_t LockFreeConveyor::GetBufferSize() {
+  const size_t head = dequeue_pos_.load(std::memory_order_acquire);
+  const size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+  return tail > head ? std::min(tail - head, capacity_) : 0;
+}
+
+bool LockFreeConveyor::TryPush(CNFrameInfoPtr* data) {
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot* slot = &slots_[pos % capacity_];
+    const size_t seq = slot->seq.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        slot->data = std::move(*data);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // the slot has not been consumed yet, queue is full
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool LockFreeConveyor::TryPop(CNFrameInfoPtr* data) {
+  size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot* slot = &slots_[pos % capacity_];
+    const size_t seq = slot->seq.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        *data = std::move(slot->data);
+        slot->data = nullptr;
+        slot->seq.store(pos + capacity_, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // the slot has not been produced yet, queue is empty
+      return false;
+    } else {
+      pos = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool LockFreeConveyor::PushDataBuffer(CNFrameInfoPtr data) {
+  if (!TryPush(&data)) {
+    fail_time_.fetch_add(1);
+    return false;
+  }
+  fail_time_.store(0);
+  // pairs with the fence in PopDataBuffer, makes sure a parked consumer is either seen here or sees the data.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiters_.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lk(wait_mutex_);
+    notempty_cond_.notify_one();
+  }
+  return true;
+}
+
+size_t LockFreeConveyor::PushDataBuffers(const std::vector<CNFrameInfoPtr>& data) {
+  size_t num = 0;
+  while (num < data.size()) {
+    CNFrameInfoPtr item = data[num];
+    if (!TryPush(&item)) break;
+    ++num;
+  }
+  if (!num) return 0;
+  fail_time_.store(0);
+  // the consumers are notified once for all the data, see PushDataBuffer
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiters_.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lk(wait_mutex_);
+    if (num == 1) {
+      notempty_cond_.notify_one();
+    } else {
+      notempty_cond_.notify_all();
+    }
+  }
+  return num;
+}
+
+uint64_t LockFreeConveyor::GetFailTime() {
+  return fail_time_.load();
+}
+
+void LockFreeConveyor::NotifyNotFull() {
+  // pairs with the fence in WaitNotFull
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (notfull_waiters_.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lk(wait_mutex_);
+    notfull_cond_.notify_one();
+  }
+}
+
+CNFrameInfoPtr LockFreeConveyor::PopDataBuffer() {
+  CNFrameInfoPtr data = nullptr;
+  if (!TryPop(&data)) {
+    // queue is empty, park until data is pushed or woken up
+    std::unique_lock<std::mutex> lk(wait_mutex_);
+    waiters_.fetch_add(1, std::memory_order_relaxed);
+    notempty_waiters_++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    notempty_cond_.wait(lk, [&] { return TryPop(&data) || wakeups_ > 0; });
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    notempty_waiters_--;
+    if (!data) wakeups_--;
+  }
+  if (data) NotifyNotFull();
+  return data;
+}
+
+CNFrameInfoPtr LockFreeConveyor::TryPopDataBuffer() {
+  CNFrameInfoPtr data = nullptr;
+  if (TryPop(&data)) NotifyNotFull();
+  return data;
+}
+
+std::vector<CNFrameInfoPtr> LockFreeConveyor::PopDataBuffers(size_t max_num, std::chrono::microseconds timeout) {
+  std::vector<CNFrameInfoPtr> vec_data;
+  CNFrameInfoPtr data = PopDataBuffer();
+  if (!data) return vec_data;
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    const bool eos = data->IsEos();
+    vec_data.push_back(std::move(data));
+    if (eos || vec_data.size() >= max_num) break;
+    if (!TryPop(&data)) {
+      if (timeout.count() <= 0) break;
+      std::unique_lock<std::mutex> lk(wait_mutex_);
+      waiters_.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const bool popped = notempty_cond_.wait_until(lk, deadline, [&] { return TryPop(&data); });
+      waiters_.fetch_sub(1, std::memory_order_relaxed);
+      if (!popped) break;
+    }
+    NotifyNotFull();
+  }
+  return vec_data;
+}
+
+std::vector<CNFrameInfoPtr> LockFreeConveyor::PopAllDataBuffer() {
   std::vector<CNFrameInfoPtr> vec_data;
   CNFrameInfoPtr data = nullptr;
-  while (!dataq_.empty()) {
-    data = dataq_.front();
-    dataq_.pop();
+  while (TryPop(&data)) {
     vec_data.push_back(data);
+    NotifyNotFull();
   }
   return vec_data;
 }
 
+void LockFreeConveyor::Wake() {
+  std::lock_guard<std::mutex> lk(wait_mutex_);
+  wakeups_ = std::max<uint32_t>(notempty_waiters_, 1);
+  notempty_cond_.notify_all();
+}
+
+bool LockFreeConveyor::WaitNotFull() {
+  std::unique_lock<std::mutex> lk(wait_mutex_);
+  notfull_waiters_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  bool ret = notfull_cond_.wait_for(lk, rel_time_, [&] { return GetBufferSize() < capacity_; });
+  notfull_waiters_.fetch_sub(1, std::memory_order_relaxed);
+  return ret;
+}
+
 }  // namespace cnstream
@@ -21,10 +21,13 @@
 #ifndef MODULES_CORE_INCLUDE_CONVEYOR_HPP_
 #define MODULES_CORE_INCLUDE_CONVEYOR_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <string>
 #include <vector>
-#include <queue>
-#include <condition_variable>
 
 #include "cnstream_frame.hpp"
 
@@ -43,17 +46,65 @@ class Connector;
  *
  * The capacity of buffer queue could be set in configuration json file (see README for more information of
  * configuration json file). If there is no element in buffer queue, the downstream node will wait to pop and
- * be blocked. On contrary, if the queue is full, the upstream node will wait to push and be blocked.
+ * be blocked. On contrary, if the queue is full, the upstream node will wait to push and be blocked, and it is
+ * woken up as soon as the downstream node pops data (see WaitNotFull).
+ *
+ * The EOS of a stream removed by force is pushed to a priority lane regardless of the capacity, and it is popped
+ * before the data in the buffer queue (see PushPriorityDataBuffer).
  */
 class Conveyor : private NonCopyable {
  public:
   Conveyor(size_t max_size);
-  ~Conveyor() = default;
-  bool PushDataBuffer(CNFrameInfoPtr data);
-  CNFrameInfoPtr PopDataBuffer();
-  std::vector<CNFrameInfoPtr> PopAllDataBuffer();
-  uint32_t GetBufferSize();
-  uint64_t GetFailTime();
+  virtual ~Conveyor() = default;
+  virtual bool PushDataBuffer(CNFrameInfoPtr data);
+  /**
+   * @brief Pushes the data in order as long as the buffer queue is not full, the queue is locked once.
+   * @return the number of data pushed, the data after them is not pushed.
+   */
+  virtual size_t PushDataBuffers(const std::vector<CNFrameInfoPtr>& data);
+  /**
+   * @brief Pops data, blocks until data is pushed or the conveyor is woken up by Wake.
+   * @return the data, or nullptr if the conveyor is woken up while it is empty.
+   */
+  virtual CNFrameInfoPtr PopDataBuffer();
+  /**
+   * @brief Pops data without waiting. Returns nullptr if the buffer queue is empty.
+   */
+  virtual CNFrameInfoPtr TryPopDataBuffer();
+  /*
+   * Pops at most max_num data. Blocks until the first one is pushed like PopDataBuffer, then waits up to timeout
+   * for more data, and stops right after an eos frame. Returns no data if the conveyor is woken up while it is empty.
+   */
+  virtual std::vector<CNFrameInfoPtr> PopDataBuffers(size_t max_num, std::chrono::microseconds timeout);
+  virtual std::vector<CNFrameInfoPtr> PopAllDataBuffer();
+  virtual uint32_t GetBufferSize();
+  virtual uint64_t GetFailTime();
+  /**
+   * @brief Waits until the buffer queue is not full or timeout (20ms).
+   * @return true if the buffer queue is not full.
+   */
+  virtual bool WaitNotFull();
+  /**
+   * @brief Drops the oldest data which is not EOS in the buffer queue.
+   * @return the dropped data, or nullptr if no data is dropped.
+   */
+  virtual CNFrameInfoPtr DropOldestDataBuffer();
+  /**
+   * @brief Pushes data to the priority lane, it is popped before the data in the buffer queue. The capacity is not
+   * checked, the data is never blocked.
+   * @return false if the priority lane is not supported.
+   */
+  virtual bool PushPriorityDataBuffer(CNFrameInfoPtr data);
+  /**
+   * @brief Drops the data of a stream which is not EOS in the buffer queue.
+   * @return the dropped data.
+   */
+  virtual std::vector<CNFrameInfoPtr> DropStreamDataBuffers(const std::string& stream_id);
+  /**
+   * @brief Wakes up the consumers blocked in popping data, e.g. the conveyor is stopped. They return without data.
+   * If no consumer is blocked, the next pop on the empty conveyor returns at once.
+   */
+  virtual void Wake();
 
 #ifdef UNIT_TEST
  public:  // NOLINT
@@ -62,14 +113,87 @@ class Conveyor : private NonCopyable {
 #endif
 
  private:
-  std::queue<CNFrameInfoPtr> dataq_;
+  CNFrameInfoPtr PopFront();  // called with data_mutex_ locked, the priority lane first
+  bool WaitNotEmpty(std::unique_lock<std::mutex>* lk);  // returns false if woken up while empty, see Wake
+  bool Empty() const { return dataq_.empty() && priorityq_.empty(); }
+
+  std::deque<CNFrameInfoPtr> dataq_;
+  std::deque<CNFrameInfoPtr> priorityq_;
   size_t max_size_;
   uint64_t fail_time_ = 0;
+  uint32_t notfull_waiters_ = 0;
+  uint32_t notempty_waiters_ = 0;
+  uint32_t wakeups_ = 0;  // the number of blocked pops to return without data, see Wake
   std::mutex data_mutex_;
   std::condition_variable notempty_cond_;
+  std::condition_variable notfull_cond_;
   const std::chrono::milliseconds rel_time_{20};
 };  // class Conveyor
 
+/**
+ * @brief LockFreeConveyor is a Conveyor based on a bounded multi-producer multi-consumer ring buffer.
+ *
+ * All slots are allocated when the conveyor is constructed. Producers and consumers claim slots with
+ * atomic operations only, so no lock is taken as long as the queue is neither empty nor full.
+ * A consumer waits on a condition variable only when the queue is empty, and a producer waits only when the
+ * queue is full. Each side notifies the other one only when there is a waiter.
+ *
+ * @note DropOldestDataBuffer, DropStreamDataBuffers and the priority lane are not supported, as the data can not be
+ * inspected before being popped.
+ */
+class LockFreeConveyor : public Conveyor {
+ public:
+  explicit LockFreeConveyor(size_t max_size);
+  ~LockFreeConveyor() = default;
+  bool PushDataBuffer(CNFrameInfoPtr data) override;
+  size_t PushDataBuffers(const std::vector<CNFrameInfoPtr>& data) override;
+  CNFrameInfoPtr PopDataBuffer() override;
+  CNFrameInfoPtr TryPopDataBuffer() override;
+  std::vector<CNFrameInfoPtr> PopDataBuffers(size_t max_num, std::chrono::microseconds timeout) override;
+  std::vector<CNFrameInfoPtr> PopAllDataBuffer() override;
+  uint32_t GetBufferSize() override;
+  uint64_t GetFailTime() override;
+  bool WaitNotFull() override;
+  CNFrameInfoPtr DropOldestDataBuffer() override { return nullptr; }
+  bool PushPriorityDataBuffer(CNFrameInfoPtr data) override { return false; }
+  std::vector<CNFrameInfoPtr> DropStreamDataBuffers(const std::string& stream_id) override { return {}; }
+  void Wake() override;
+
+#ifdef UNIT_TEST
+ public:  // NOLINT
+#else
+ private:  // NOLINT
+#endif
+  bool TryPush(CNFrameInfoPtr* data);
+  bool TryPop(CNFrameInfoPtr* data);
+  void NotifyNotFull();
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    CNFrameInfoPtr data;
+  };
+  static constexpr size_t kCacheLineSize = 64;
+  std::unique_ptr<Slot[]> slots_;
+  const size_t capacity_;
+  // keep the positions of producers and consumers on different cache lines
+  char pad0_[kCacheLineSize];
+  std::atomic<size_t> enqueue_pos_{0};
+  char pad1_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeue_pos_{0};
+  char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+  std::atomic<uint64_t> fail_time_{0};
+  std::atomic<uint32_t> waiters_{0};
+  std::atomic<uint32_t> notfull_waiters_{0};
+  // guarded by wait_mutex_, see Wake
+  uint32_t notempty_waiters_ = 0;
+  uint32_t wakeups_ = 0;
+  std::mutex wait_mutex_;
+  std::condition_variable notempty_cond_;
+  std::condition_variable notfull_cond_;
+  const std::chrono::milliseconds rel_time_{20};
+};  // class LockFreeConveyor
+
 }  // namespace cnstream
 
 #endif  // MODULES_CORE_INCLUDE_CONVEYOR_HPP_
@@ -0,0 +1,158 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cpu_isolation.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+namespace {
+
+uint64_t GetCpuTimeNs(clockid_t clock) {
+  struct timespec ts;
+  if (clock_gettime(clock, &ts) != 0) return 0;
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// returns the errno, 0 if the value is written
+int WriteFile(const std::string& path, const std::string& value) {
+  int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) return errno;
+  int ret = 0;
+  if (write(fd, value.c_str(), value.size()) != static_cast<ssize_t>(value.size())) ret = errno ? errno : EIO;
+  close(fd);
+  return ret;
+}
+
+}  // namespace
+
+struct CpuIsolation::State {
+  std::mutex mtx;
+  std::map<const void*, std::pair<clockid_t, uint64_t>> threads;  // the cpu clock and the base time of live threads
+  uint64_t exited_ns = 0;  // the cpu time of the threads which have exited
+};
+
+namespace {
+
+// accounts the cpu time of the calling thread to a pipeline until the thread exits or is tagged again
+class ThreadTag {
+ public:
+  explicit ThreadTag(std::shared_ptr<CpuIsolation::State> state) : state_(std::move(state)) {
+    clockid_t clock;
+    if (pthread_getcpuclockid(pthread_self(), &clock) != 0) clock = CLOCK_THREAD_CPUTIME_ID;
+    std::lock_guard<std::mutex> lk(state_->mtx);
+    state_->threads[this] = std::make_pair(clock, GetCpuTimeNs(CLOCK_THREAD_CPUTIME_ID));
+  }
+  ~ThreadTag() {
+    const uint64_t now = GetCpuTimeNs(CLOCK_THREAD_CPUTIME_ID);
+    std::lock_guard<std::mutex> lk(state_->mtx);
+    auto it = state_->threads.find(this);
+    state_->exited_ns += now - std::min(now, it->second.second);
+    state_->threads.erase(it);
+  }
+  const CpuIsolation::State* GetState() const { return state_.get(); }
+
+ private:
+  std::shared_ptr<CpuIsolation::State> state_;
+};  // class ThreadTag
+
+thread_local std::unique_ptr<ThreadTag> tls_tag;
+
+}  // namespace
+
+CpuIsolation::CpuIsolation(const CpuIsolationConfig& config) : config_(config), state_(std::make_shared<State>()) {}
+
+CpuIsolation::~CpuIsolation() = default;
+
+bool CpuIsolation::Apply() {
+  if (!config_.enable || config_.cgroup.empty() || !config_.cpu_weight) return true;
+  // cgroup v2 takes the weight in [1, 10000], cgroup v1 takes the shares, 1024 by default
+  int err = WriteFile(config_.cgroup + "/cpu.weight", std::to_string(config_.cpu_weight));
+  if (ENOENT == err) {
+    err = WriteFile(config_.cgroup + "/cpu.shares", std::to_string(std::max(config_.cpu_weight * 1024 / 100, 2u)));
+  }
+  if (err) {
+    LOGE(CORE) << "[CpuIsolation] Write the cpu weight of cgroup [" << config_.cgroup << "] failed: " << strerror(err);
+    return false;
+  }
+  return true;
+}
+
+bool CpuIsolation::MoveToCgroup(const std::string& tid) {
+  // cgroup v2 moves a thread by cgroup.threads, the cgroup must be threaded. cgroup v1 moves it by tasks.
+  int err = WriteFile(config_.cgroup + "/cgroup.threads", tid);
+  if (ENOENT == err) err = WriteFile(config_.cgroup + "/tasks", tid);
+  if (err) {
+    WarnOnce("move threads into cgroup [" + config_.cgroup + "] failed: " + strerror(err));
+    return false;
+  }
+  return true;
+}
+
+void CpuIsolation::WarnOnce(const std::string& message) {
+  if (!warned_.exchange(true)) LOGW(CORE) << "[CpuIsolation] " << message << ". The threads are not isolated.";
+}
+
+bool CpuIsolation::TagCurrentThread() {
+  if (tls_tag && tls_tag->GetState() == state_.get()) return true;
+  tls_tag.reset(new ThreadTag(state_));
+  if (!config_.enable) return true;
+  const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+  bool ret = true;
+  // on linux, the nice value is per thread
+  if (config_.nice && setpriority(PRIO_PROCESS, tid, config_.nice) != 0) {
+    WarnOnce("set nice value " + std::to_string(config_.nice) + " failed: " + strerror(errno));
+    ret = false;
+  }
+  if (!config_.cgroup.empty() && !MoveToCgroup(std::to_string(tid))) ret = false;
+  return ret;
+}
+
+CpuUsage CpuIsolation::GetUsage() const {
+  std::lock_guard<std::mutex> lk(state_->mtx);
+  uint64_t cpu_ns = state_->exited_ns;
+  for (const auto& it : state_->threads) {
+    const uint64_t now = GetCpuTimeNs(it.second.first);
+    cpu_ns += now - std::min(now, it.second.second);
+  }
+  CpuUsage usage;
+  usage.cpu_time = cpu_ns / 1e6;
+  usage.thread_num = static_cast<uint32_t>(state_->threads.size());
+  return usage;
+}
+
+}  // namespace cnstream
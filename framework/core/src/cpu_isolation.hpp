@@ -0,0 +1,78 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_CPU_ISOLATION_HPP_
+#define MODULES_CORE_INCLUDE_CPU_ISOLATION_HPP_
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "cnstream_common.hpp"
+#include "cnstream_config.hpp"
+#include "profiler/profile.hpp"
+
+namespace cnstream {
+
+/**
+ * @class CpuIsolation
+ *
+ * @brief CpuIsolation tags the threads of a pipeline, see CpuIsolationConfig.
+ *
+ * A tagged thread is given the nice value and moved into the cgroup of the pipeline if the isolation is enabled.
+ * Either way, its CPU time is accounted to the pipeline, including the time of the threads which have exited.
+ */
+class CpuIsolation : private NonCopyable {
+ public:
+  explicit CpuIsolation(const CpuIsolationConfig& config);
+  ~CpuIsolation();
+  /**
+   * @brief Writes the CPU weight of the cgroup, if CpuIsolationConfig::cpu_weight is set.
+   *
+   * @return Returns false if the weight is not written.
+   */
+  bool Apply();
+  /**
+   * @brief Tags the calling thread. A thread is tagged by one CpuIsolation at a time, tagging it again by another one
+   * moves its CPU time accounted from then on.
+   *
+   * @return Returns false if the nice value is not set or the thread is not moved into the cgroup. The CPU time of
+   * the thread is accounted anyway.
+   */
+  bool TagCurrentThread();
+  /**
+   * @brief Gets the CPU time consumed by the tagged threads since they were tagged.
+   */
+  CpuUsage GetUsage() const;
+
+  struct State;
+
+ private:
+  bool MoveToCgroup(const std::string& tid);
+  void WarnOnce(const std::string& message);
+
+  CpuIsolationConfig config_;
+  std::shared_ptr<State> state_;
+  std::atomic<bool> warned_{false};
+};  // class CpuIsolation
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_CPU_ISOLATION_HPP_
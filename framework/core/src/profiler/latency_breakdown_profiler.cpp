@@ -0,0 +1,137 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "profiler/latency_breakdown_profiler.hpp"
+
+namespace cnstream {
+
+static inline double NsToMs(int64_t ns) { return ns / 1e6; }
+
+LatencyBreakdownProfiler::LatencyBreakdownProfiler(const std::vector<LatencyBreakdownNode>& nodes) : nodes_(nodes) {
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const uint32_t id = nodes_[i].module_id;
+    if (id >= node_indexes_.size()) node_indexes_.resize(id + 1, -1);
+    node_indexes_[id] = static_cast<int>(i);
+  }
+}
+
+void LatencyBreakdownProfiler::AddFrame(const std::string& stream_name,
+                                        const std::vector<CNFrameInfo::ModuleTimes>& times) {
+  // the modules not reached by the frame, e.g. the ones after another source module, have no times
+  auto reached = [&](uint32_t id) { return id < times.size() && times[id].done != 0; };
+  int last = -1;
+  int64_t first_enqueue = INT64_MAX;
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const uint32_t id = nodes_[i].module_id;
+    if (!reached(id)) continue;
+    if (last < 0 || times[id].done > times[nodes_[last].module_id].done) last = static_cast<int>(i);
+    first_enqueue = std::min(first_enqueue, times[id].enqueue);
+  }
+  if (last < 0) return;
+
+  // every module gets the frame from the parent transmitting it last, walk back from the module transmitting it last
+  std::vector<bool> critical(nodes_.size(), false);
+  for (int cur = last; cur >= 0;) {
+    critical[cur] = true;
+    int next = -1;
+    for (uint32_t parent : nodes_[cur].parent_ids) {
+      if (!reached(parent) || parent >= node_indexes_.size() || node_indexes_[parent] < 0) continue;
+      if (next < 0 || times[parent].done > times[nodes_[next].module_id].done) next = node_indexes_[parent];
+    }
+    cur = next;
+  }
+
+  std::lock_guard<std::mutex> lk(lk_);
+  StreamStats& stream = streams_[stream_name];
+  if (stream.modules.empty()) stream.modules.resize(nodes_.size());
+  stream.frames++;
+  stream.total_latency += times[nodes_[last].module_id].done - first_enqueue;
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const uint32_t id = nodes_[i].module_id;
+    if (!reached(id)) continue;
+    const CNFrameInfo::ModuleTimes& t = times[id];
+    const int64_t wait = std::max<int64_t>(t.dequeue - t.enqueue, 0);
+    const int64_t process = std::max<int64_t>(t.done - t.dequeue, 0);
+    ModuleStats& stats = stream.modules[i];
+    stats.frames++;
+    stats.total_wait += wait;
+    stats.maximum_wait = std::max(stats.maximum_wait, wait);
+    stats.total_process += process;
+    stats.maximum_process = std::max(stats.maximum_process, process);
+    if (critical[i]) {
+      stats.critical_frames++;
+      stats.critical_wait += wait;
+      stats.critical_process += process;
+    }
+  }
+}
+
+void LatencyBreakdownProfiler::OnStreamEos(const std::string& stream_name) {
+  std::lock_guard<std::mutex> lk(lk_);
+  streams_.erase(stream_name);
+}
+
+std::vector<StreamLatencyBreakdown> LatencyBreakdownProfiler::GetBreakdowns() const {
+  std::vector<StreamLatencyBreakdown> breakdowns;
+  std::lock_guard<std::mutex> lk(lk_);
+  breakdowns.reserve(streams_.size());
+  for (const auto& it : streams_) {
+    const StreamStats& stream = it.second;
+    StreamLatencyBreakdown breakdown;
+    breakdown.stream_name = it.first;
+    breakdown.frames = stream.frames;
+    breakdown.latency = stream.frames ? NsToMs(stream.total_latency) / stream.frames : 0.0;
+    int64_t bottleneck_wait = 0;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      const ModuleStats& stats = stream.modules[i];
+      ModuleLatencyBreakdown module;
+      module.module_name = nodes_[i].module_name;
+      module.frames = stats.frames;
+      if (stats.frames) {
+        module.queue_wait = NsToMs(stats.total_wait) / stats.frames;
+        module.process = NsToMs(stats.total_process) / stats.frames;
+      }
+      module.maximum_queue_wait = NsToMs(stats.maximum_wait);
+      module.maximum_process = NsToMs(stats.maximum_process);
+      module.critical_frames = stats.critical_frames;
+      if (stats.critical_frames) {
+        module.critical_queue_wait = NsToMs(stats.critical_wait) / stats.critical_frames;
+        module.critical_process = NsToMs(stats.critical_process) / stats.critical_frames;
+      }
+      if (stats.critical_wait > bottleneck_wait) {
+        bottleneck_wait = stats.critical_wait;
+        breakdown.bottleneck_module = module.module_name;
+      }
+      breakdown.modules.push_back(std::move(module));
+    }
+    breakdowns.push_back(std::move(breakdown));
+  }
+  return breakdowns;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,109 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+
+#include "profiler/latency_histogram.hpp"
+
+namespace cnstream {
+
+constexpr uint32_t LatencyHistogram::kSubBucketBits;
+constexpr uint32_t LatencyHistogram::kLinearBuckets;
+constexpr uint32_t LatencyHistogram::kMaxBits;
+constexpr uint32_t LatencyHistogram::kBucketCount;
+
+LatencyHistogram::LatencyHistogram() {
+  Reset();
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other) {
+  *this = other;
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other) {
+  if (this == &other) return *this;
+  for (uint32_t i = 0; i < kBucketCount; ++i)
+    counts_[i].store(other.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  total_.store(other.total_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  return *this;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  if (this == &other) return;
+  for (uint32_t i = 0; i < kBucketCount; ++i) {
+    uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+    if (count) counts_[i].fetch_add(count, std::memory_order_relaxed);
+  }
+  total_.fetch_add(other.total_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+double LatencyHistogram::Percentile(double quantile) const {
+  // the total is summed from the snapshot of the buckets, it may differ from total_ while recording
+  uint64_t counts[kBucketCount];
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < kBucketCount; ++i) {
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (!total) return 0;
+  quantile = std::min(std::max(quantile, 0.0), 1.0);
+  uint64_t rank = static_cast<uint64_t>(std::ceil(quantile * total));
+  rank = std::min(std::max(rank, static_cast<uint64_t>(1)), total);
+  uint64_t seen = 0;
+  uint32_t index = 0;
+  for (; index < kBucketCount - 1; ++index) {
+    seen += counts[index];
+    if (seen >= rank) break;
+  }
+  uint64_t lower = 0, upper = 0;
+  BucketRange(index, &lower, &upper);
+  return (lower + upper) / 2.0 / 1e3;
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& count : counts_) count.store(0, std::memory_order_relaxed);
+  total_.store(0, std::memory_order_relaxed);
+}
+
+uint32_t LatencyHistogram::BucketIndex(uint64_t us) {
+  if (us < kLinearBuckets) return static_cast<uint32_t>(us);
+  uint32_t msb = 63 - static_cast<uint32_t>(__builtin_clzll(us));
+  if (msb >= kMaxBits) return kBucketCount - 1;
+  uint32_t shift = msb - kSubBucketBits;
+  uint32_t sub = static_cast<uint32_t>(us >> shift) & ((1u << kSubBucketBits) - 1);
+  return kLinearBuckets + (msb - kSubBucketBits - 1) * (1u << kSubBucketBits) + sub;
+}
+
+void LatencyHistogram::BucketRange(uint32_t index, uint64_t* lower, uint64_t* upper) {
+  index = std::min(index, kBucketCount - 1);
+  if (index < kLinearBuckets) {
+    *lower = index;
+    *upper = index + 1;
+    return;
+  }
+  uint32_t k = index - kLinearBuckets;
+  uint32_t shift = k / (1u << kSubBucketBits) + 1;
+  uint64_t sub = k % (1u << kSubBucketBits);
+  *lower = ((1ull << kSubBucketBits) + sub) << shift;
+  *upper = *lower + (1ull << shift);
+}
+
+}  // namespace cnstream
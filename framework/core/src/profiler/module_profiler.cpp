@@ -55,9 +55,93 @@ bool ModuleProfiler::RecordProcessEnd(const std::string& process_name, const Rec
   return true;
 }
 
+bool ModuleProfiler::RecordProcessStart(const std::string& process_name, uint32_t stream_index,
+                                        const std::string& stream_name, int64_t timestamp) {
+  ProcessProfiler* process_profiler = GetProcessProfiler(process_name);
+  if (!process_profiler) return false;
+  process_profiler->RecordStart(stream_index, stream_name, timestamp);
+  return true;
+}
+
+bool ModuleProfiler::RecordProcessEnd(const std::string& process_name, uint32_t stream_index,
+                                      const std::string& stream_name, int64_t timestamp) {
+  ProcessProfiler* process_profiler = GetProcessProfiler(process_name);
+  if (!process_profiler) return false;
+  process_profiler->RecordEnd(stream_index, stream_name, timestamp);
+  return true;
+}
+
 void ModuleProfiler::OnStreamEos(const std::string& stream_name) {
   for (auto& it : process_profilers_)
     it.second->OnStreamEos(stream_name);
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  stream_conveyors_.erase(stream_name);
+  stream_frame_counts_.erase(stream_name);
+}
+
+void ModuleProfiler::RecordConveyorIdx(const std::string& stream_name, int conveyor_idx) {
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  stream_conveyors_[stream_name] = conveyor_idx;
+}
+
+void ModuleProfiler::AddCounter(const std::string& counter_name, uint64_t value) {
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  counters_[counter_name] += value;
+}
+
+void ModuleProfiler::AddPerfCounters(const PerfCounterValues& values) {
+  static const std::string kSamples = "perf_samples", kCycles = "perf_cycles", kInstructions = "perf_instructions",
+                           kLlcMisses = "perf_llc_misses", kContextSwitches = "perf_context_switches";
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  counters_[kSamples] += 1;
+  counters_[kCycles] += values.cycles;
+  counters_[kInstructions] += values.instructions;
+  counters_[kLlcMisses] += values.llc_misses;
+  counters_[kContextSwitches] += values.context_switches;
+}
+
+void ModuleProfiler::RecordReceived(const std::string& stream_name, uint64_t frames) {
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  frame_counts_.received += frames;
+  stream_frame_counts_[stream_name].received += frames;
+}
+
+void ModuleProfiler::RecordDropped(const std::string& stream_name, const std::string& reason, uint64_t frames) {
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  frame_counts_.dropped[reason] += frames;
+  stream_frame_counts_[stream_name].dropped[reason] += frames;
+}
+
+void ModuleProfiler::RecordStalled(const std::string& stream_name, double stalled) {
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  frame_counts_.stalled += stalled;
+  stream_frame_counts_[stream_name].stalled += stalled;
+}
+
+void ModuleProfiler::RecordOpen(double begin, double time) {
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  open_begin_ = begin;
+  open_time_ = time;
+}
+
+static FrameAccounting ToFrameAccounting(const std::string& stream_name, uint64_t received,
+                                         const std::map<std::string, uint64_t>& dropped, double stalled) {
+  FrameAccounting accounting;
+  accounting.stream_name = stream_name;
+  accounting.received = received;
+  accounting.dropped_by_reason.assign(dropped.begin(), dropped.end());
+  for (const auto& it : dropped) accounting.dropped += it.second;
+  accounting.stalled = stalled;
+  return accounting;
+}
+
+void ModuleProfiler::FillFrameAccounting(ModuleProfile* profile) const {
+  profile->frame_accounting = ToFrameAccounting("", frame_counts_.received, frame_counts_.dropped,
+                                                frame_counts_.stalled);
+  for (const auto& it : stream_frame_counts_) {
+    profile->stream_frame_accountings.emplace_back(
+        ToFrameAccounting(it.first, it.second.received, it.second.dropped, it.second.stalled));
+  }
 }
 
 ModuleProfile ModuleProfiler::GetProfile() {
@@ -65,12 +149,26 @@ ModuleProfile ModuleProfiler::GetProfile() {
   profile.module_name = GetName();
   for (const auto& it : process_profilers_)
     profile.process_profiles.emplace_back(it.second->GetProfile());
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  profile.stream_conveyors.assign(stream_conveyors_.begin(), stream_conveyors_.end());
+  profile.counters.assign(counters_.begin(), counters_.end());
+  FillFrameAccounting(&profile);
+  profile.open_begin = open_begin_;
+  profile.open_time = open_time_;
   return profile;
 }
 
 ModuleProfile ModuleProfiler::GetProfile(const ModuleTrace& trace) {
   ModuleProfile profile;
   profile.module_name = GetName();
+  {
+    std::lock_guard<std::mutex> lk(stats_mutex_);
+    profile.stream_conveyors.assign(stream_conveyors_.begin(), stream_conveyors_.end());
+    profile.counters.assign(counters_.begin(), counters_.end());
+    FillFrameAccounting(&profile);
+    profile.open_begin = open_begin_;
+    profile.open_time = open_time_;
+  }
   for (const auto& process_trace : trace) {
     ProcessProfiler* process_profiler = GetProcessProfiler(process_trace.first);
     if (process_profiler)
@@ -80,9 +178,8 @@ ModuleProfile ModuleProfiler::GetProfile(const ModuleTrace& trace) {
 }
 
 ProcessProfiler* ModuleProfiler::GetProcessProfiler(const std::string& process_name) {
-  if (process_profilers_.find(process_name) == process_profilers_.end())
-    return nullptr;
-  return process_profilers_[process_name].get();
+  auto it = process_profilers_.find(process_name);
+  return it == process_profilers_.end() ? nullptr : it->second.get();
 }
 
 }  // namespace cnstream
@@ -0,0 +1,96 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "cnstream_logging.hpp"
+#include "profiler/perf_counters.hpp"
+
+namespace cnstream {
+
+static int OpenPerfEvent(uint64_t config, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+
+PerfCounters* PerfCounters::ThreadInstance() {
+  static thread_local PerfCounters counters;
+  return &counters;
+}
+
+PerfCounters::PerfCounters() {
+  int* indexes[] = {&cycles_index_, &instructions_index_, &llc_misses_index_};
+  const uint64_t configs[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+  int error = 0;
+  for (int i = 0; i < 3; ++i) {
+    int fd = OpenPerfEvent(configs[i], group_fd_);
+    if (fd < 0) {
+      error = errno;
+      continue;
+    }
+    if (group_fd_ < 0) group_fd_ = fd;
+    *indexes[i] = fd_num_;
+    fds_[fd_num_++] = fd;
+  }
+  if (error) {
+    static std::atomic<bool> warned{false};
+    if (!warned.exchange(true)) {
+      LOGW(PROFILER) << "Open hardware counters failed, " << strerror(error) << ". Check kernel.perf_event_paranoid.";
+    }
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (int i = 0; i < fd_num_; ++i) close(fds_[i]);
+}
+
+bool PerfCounters::Read(PerfCounterValues* values) const {
+  *values = PerfCounterValues();
+  struct rusage usage;
+  if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+    values->context_switches = static_cast<uint64_t>(usage.ru_nvcsw + usage.ru_nivcsw);
+  }
+  if (group_fd_ < 0) return false;
+  // read_format PERF_FORMAT_GROUP: nr followed by the values in the order the events are opened
+  uint64_t data[1 + 3];
+  ssize_t size = read(group_fd_, data, sizeof(uint64_t) * (1 + fd_num_));
+  if (size < static_cast<ssize_t>(sizeof(uint64_t)) || data[0] != static_cast<uint64_t>(fd_num_)) return false;
+  if (cycles_index_ >= 0) values->cycles = data[1 + cycles_index_];
+  if (instructions_index_ >= 0) values->instructions = data[1 + instructions_index_];
+  if (llc_misses_index_ >= 0) values->llc_misses = data[1 + llc_misses_index_];
+  return true;
+}
+
+}  // namespace cnstream
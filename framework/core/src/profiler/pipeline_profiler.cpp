@@ -21,9 +21,11 @@
 #include <chrono>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "cnstream_logging.hpp"
+#include "cnstream_memory_accountant.hpp"
 #include "cnstream_module.hpp"
 #include "cnstream_pipeline.hpp"
 #include "profiler/module_profiler.hpp"
@@ -36,8 +38,12 @@ PipelineProfiler::PipelineProfiler(const ProfilerConfig& config,
                                    const std::string& pipeline_name,
                                    const std::vector<std::shared_ptr<Module>>& modules,
                                    const std::vector<std::string>& sorted_module_names)
-    : config_(config), pipeline_name_(pipeline_name), tracer_(new PipelineTracer()),
+    : config_(config), pipeline_name_(pipeline_name), tracer_(new PipelineTracer(config.trace_event_capacity)),
     sorted_module_names_(sorted_module_names) {
+  if (config_.enable_tracing && !config_.trace_file.empty() && !tracer_->StartStreaming(config_.trace_file)) {
+    LOGE(PROFILER) << "Stream trace events into [" << config_.trace_file << "] failed, only cached in memory.";
+  }
+  if (TraceSampler::IsNeeded(config_)) tracer_->SetSampler(std::unique_ptr<TraceSampler>(new TraceSampler(config_)));
   for (const auto& module : modules) {
     auto name = module->GetName();
     module_profilers_.emplace(name, std::unique_ptr<ModuleProfiler>(new ModuleProfiler(config, name, tracer_.get())));
@@ -57,6 +63,44 @@ ModuleProfiler* PipelineProfiler::GetModuleProfiler(const std::string& module_na
   return nullptr;
 }
 
+void PipelineProfiler::InitLatencyBreakdown(const std::vector<LatencyBreakdownNode>& nodes) {
+  if (!config_.enable_profiling || !config_.enable_latency_breakdown) return;
+  latency_breakdown_profiler_.reset(new LatencyBreakdownProfiler(nodes));
+}
+
+void PipelineProfiler::GetMemoryUsage(PipelineProfile* profile) const {
+  // the memory usage is always the live one, it is not recorded by the tracer.
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  if (!accountant.IsEnabled()) return;
+  profile->memory_usage = accountant.GetUsage(GetName());
+  profile->stream_memory_usages = accountant.GetStreamUsages(GetName());
+}
+
+void PipelineProfiler::SetDeviceUtilizationSampler(DeviceUtilizationSampler sampler) {
+  std::lock_guard<std::mutex> lk(device_sampler_mtx_);
+  device_sampler_ = std::move(sampler);
+}
+
+std::vector<DeviceUtilization> PipelineProfiler::SampleDeviceUtilizations() const {
+  std::lock_guard<std::mutex> lk(device_sampler_mtx_);
+  if (device_sampler_) return device_sampler_();
+  return {};
+}
+
+void PipelineProfiler::GetDeviceUtilizations(PipelineProfile* profile) const {
+  profile->device_utilizations = SampleDeviceUtilizations();
+}
+
+void PipelineProfiler::SetCpuUsageSampler(CpuUsageSampler sampler) {
+  std::lock_guard<std::mutex> lk(cpu_sampler_mtx_);
+  cpu_sampler_ = std::move(sampler);
+}
+
+void PipelineProfiler::GetCpuUsage(PipelineProfile* profile) const {
+  std::lock_guard<std::mutex> lk(cpu_sampler_mtx_);
+  if (cpu_sampler_) profile->cpu_usage = cpu_sampler_();
+}
+
 PipelineProfile PipelineProfiler::GetProfile() {
   PipelineProfile profile;
   profile.pipeline_name = GetName();
@@ -67,6 +111,11 @@ PipelineProfile PipelineProfiler::GetProfile() {
     }
   }
   profile.overall_profile = overall_profiler_->GetProfile();
+  GetMemoryUsage(&profile);
+  GetDeviceUtilizations(&profile);
+  GetCpuUsage(&profile);
+  profile.startup_time = startup_time_.load();
+  if (latency_breakdown_profiler_) profile.latency_breakdowns = latency_breakdown_profiler_->GetBreakdowns();
   return profile;
 }
 
@@ -96,6 +145,10 @@ PipelineProfile PipelineProfiler::GetProfile(const Time& start, const Time& end)
       break;
     }
   }
+  GetMemoryUsage(&profile);
+  GetDeviceUtilizations(&profile);
+  GetCpuUsage(&profile);
+  profile.startup_time = startup_time_.load();
   return profile;
 }
 
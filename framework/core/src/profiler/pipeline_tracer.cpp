@@ -1,10 +1,12 @@
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "circular_buffer.hpp"
 #include "profiler/pipeline_tracer.hpp"
 #include "profiler/trace.hpp"
+#include "profiler/trace_file.hpp"
 
 namespace cnstream {
 
@@ -16,10 +18,12 @@ PipelineTracer::~PipelineTracer() {
 }
 
 void PipelineTracer::RecordEvent(const TraceEvent& event) {
+  if (file_writer_) file_writer_->Write(event);
   buffer_->push_back(event);
 }
 
 void PipelineTracer::RecordEvent(TraceEvent&& event) {
+  if (file_writer_) file_writer_->Write(event);
   buffer_->push_back(std::forward<TraceEvent>(event));
 }
 
@@ -43,4 +47,15 @@ PipelineTrace PipelineTracer::GetTrace(const Time& start, const Time& end) const
   return trace;
 }
 
+bool PipelineTracer::StartStreaming(const std::string& path) {
+  std::unique_ptr<TraceFileWriter> writer(new TraceFileWriter());
+  if (!writer->Open(path)) return false;
+  file_writer_ = std::move(writer);
+  return true;
+}
+
+void PipelineTracer::StopStreaming() {
+  if (file_writer_) file_writer_->Close();
+}
+
 }  // namespace cnstream
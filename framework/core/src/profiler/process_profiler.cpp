@@ -18,13 +18,17 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <list>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
 #include <utility>
 
+#include "cnstream_logging.hpp"
 #include "profiler/process_profiler.hpp"
 #include "profiler/stream_profiler.hpp"
 #include "profiler/trace.hpp"
@@ -186,10 +190,55 @@ void RecordPolicy::RemoveStreamMaxDpbSize(const std::string& stream_name) {
 }
 
 
+/**
+ * RecordBuffer is a ring of records written by one thread and read by the profiler with its lock held.
+ **/
+class ProcessProfiler::RecordBuffer {
+ public:
+  static constexpr uint64_t kCapacity = 1024;
+
+  // Called by the owner thread. Returns false if the buffer is full.
+  bool Push(const Record& record) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= kCapacity) return false;
+    records_[head % kCapacity] = record;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called by one reader at a time.
+  void PopAll(std::vector<Record>* records) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    for (; tail < head; ++tail) records->push_back(records_[tail % kCapacity]);
+    tail_.store(tail, std::memory_order_release);
+  }
+
+ private:
+  Record records_[kCapacity];
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+};  // class ProcessProfiler::RecordBuffer
+
+struct ProcessProfiler::StreamSlot {
+  std::atomic<bool> named{false};
+  std::string name;
+};  // struct ProcessProfiler::StreamSlot
+
+// Slots [0, MAX_STREAM_NUM) are taken by stream indexes, the others by the streams recorded by name.
+static constexpr uint32_t kSlotCount = 2 * MAX_STREAM_NUM;
+static constexpr uint32_t kInvalidSlot = ~0u;
+
+static uint64_t NextProfilerId() {
+  static std::atomic<uint64_t> id{0};
+  return ++id;
+}
+
 ProcessProfiler::ProcessProfiler(const ProfilerConfig& config,
                                  const std::string& process_name,
                                  PipelineTracer* tracer)
-    : config_(config), process_name_(process_name), tracer_(tracer), record_policy_(new RecordPolicy()) {
+    : config_(config), process_name_(process_name), tracer_(tracer), record_policy_(new RecordPolicy()),
+      id_(NextProfilerId()), slots_(new StreamSlot[kSlotCount]) {
   if (!tracer) config_.enable_tracing = false;
 }
 
@@ -199,10 +248,132 @@ ProcessProfiler::~ProcessProfiler() {
 
 void ProcessProfiler::RecordStart(const RecordKey& key) {
   if (!config_.enable_tracing && !config_.enable_profiling) return;
-  std::lock_guard<std::mutex>  lk(lk_);
+  AddRecord(config_.enable_profiling ? GetSlot(key.first) : kInvalidSlot, key.first, key.second,
+            TraceEvent::Type::START);
+}
+
+void ProcessProfiler::RecordEnd(const RecordKey& key) {
+  if (!config_.enable_tracing && !config_.enable_profiling) return;
+  AddRecord(config_.enable_profiling ? GetSlot(key.first) : kInvalidSlot, key.first, key.second,
+            TraceEvent::Type::END);
+}
+
+void ProcessProfiler::RecordStart(uint32_t stream_index, const std::string& stream_name, int64_t timestamp) {
+  if (!config_.enable_tracing && !config_.enable_profiling) return;
+  AddRecord(config_.enable_profiling ? GetSlot(stream_index, stream_name) : kInvalidSlot, stream_name, timestamp,
+            TraceEvent::Type::START);
+}
+
+void ProcessProfiler::RecordEnd(uint32_t stream_index, const std::string& stream_name, int64_t timestamp) {
+  if (!config_.enable_tracing && !config_.enable_profiling) return;
+  AddRecord(config_.enable_profiling ? GetSlot(stream_index, stream_name) : kInvalidSlot, stream_name, timestamp,
+            TraceEvent::Type::END);
+}
+
+uint32_t ProcessProfiler::GetSlot(uint32_t stream_index, const std::string& stream_name) {
+  if (stream_index >= MAX_STREAM_NUM) return GetSlot(stream_name);
+  StreamSlot& slot = slots_[stream_index];
+  if (!slot.named.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lk(slots_lk_);
+    if (!slot.named.load(std::memory_order_relaxed)) {
+      slot.name = stream_name;
+      slot_indexes_[stream_name] = stream_index;
+      slot.named.store(true, std::memory_order_release);
+    }
+  }
+  return stream_index;
+}
+
+uint32_t ProcessProfiler::GetSlot(const std::string& stream_name) {
+  std::lock_guard<std::mutex> lk(slots_lk_);
+  auto it = slot_indexes_.find(stream_name);
+  if (it != slot_indexes_.end()) return it->second;
+  for (uint32_t index = MAX_STREAM_NUM; index < kSlotCount; ++index) {
+    StreamSlot& slot = slots_[index];
+    if (slot.named.load(std::memory_order_relaxed)) continue;
+    slot.name = stream_name;
+    slot_indexes_[stream_name] = index;
+    slot.named.store(true, std::memory_order_release);
+    return index;
+  }
+  LOGW(PROFILER) << "[" << process_name_ << "] Too many streams, records of " << stream_name << " are ignored.";
+  return kInvalidSlot;
+}
+
+void ProcessProfiler::AddRecord(uint32_t slot, const std::string& stream_name, int64_t timestamp,
+                                TraceEvent::Type type) {
   Time now = Clock::now();
-  if (config_.enable_tracing) Tracing(key, now, TraceEvent::Type::START);
-  if (config_.enable_profiling) RecordStart(key, now);
+  if (config_.enable_tracing && tracer_->IsSampled(stream_name, timestamp, now)) {
+    Tracing(std::make_pair(stream_name, timestamp), now, type);
+  }
+  if (kInvalidSlot == slot) return;
+  RecordBuffer* buffer = GetThreadBuffer();
+  while (!buffer->Push({slot, type, timestamp, now})) {
+    std::lock_guard<std::mutex> lk(lk_);
+    FlushRecords();
+  }
+}
+
+ProcessProfiler::RecordBuffer* ProcessProfiler::GetThreadBuffer() {
+  // the buffers of a thread are keyed by the identifications of profilers, which are never reused
+  using ThreadBuffer = std::pair<uint64_t, std::shared_ptr<RecordBuffer>>;
+  struct ThreadBuffers {
+    uint64_t last_id = 0;
+    RecordBuffer* last_buffer = nullptr;
+    std::vector<ThreadBuffer> buffers;
+  };
+  static thread_local ThreadBuffers thread_buffers;
+  if (thread_buffers.last_id == id_) return thread_buffers.last_buffer;
+  auto& buffers = thread_buffers.buffers;
+  const uint64_t id = id_;
+  auto it = std::find_if(buffers.begin(), buffers.end(), [id](const ThreadBuffer& buffer) {
+    return buffer.first == id;
+  });
+  if (it == buffers.end()) {
+    // the buffers only referenced by this thread belong to profilers destroyed
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const ThreadBuffer& buffer) {
+      return buffer.second.use_count() == 1;
+    }), buffers.end());
+    std::shared_ptr<RecordBuffer> buffer = std::make_shared<RecordBuffer>();
+    {
+      std::lock_guard<std::mutex> lk(buffers_lk_);
+      buffers_.push_back(buffer);
+    }
+    it = buffers.emplace(buffers.end(), id_, buffer);
+  }
+  thread_buffers.last_id = id_;
+  thread_buffers.last_buffer = it->second.get();
+  return thread_buffers.last_buffer;
+}
+
+void ProcessProfiler::FlushRecords() {
+  std::vector<std::shared_ptr<RecordBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lk(buffers_lk_);
+    buffers = buffers_;
+  }
+  flushing_records_.clear();
+  for (auto& buffer : buffers) buffer->PopAll(&flushing_records_);
+  if (flushing_records_.empty()) return;
+  std::stable_sort(flushing_records_.begin(), flushing_records_.end(),
+                   [](const Record& lhs, const Record& rhs) { return lhs.time < rhs.time; });
+  // the keys are built once for each stream
+  std::vector<RecordKey> keys(kSlotCount);
+  {
+    std::lock_guard<std::mutex> lk(slots_lk_);
+    for (const auto& record : flushing_records_)
+      if (keys[record.slot].first.empty()) keys[record.slot].first = slots_[record.slot].name;
+  }
+  for (const auto& record : flushing_records_) {
+    RecordKey& key = keys[record.slot];
+    key.second = record.timestamp;
+    // a record may be put into a buffer after a later one of another thread has been counted
+    Time time = std::max(record.time, last_record_time_);
+    if (TraceEvent::Type::START == record.type)
+      RecordStart(key, time);
+    else
+      RecordEnd(key, time);
+  }
 }
 
 void ProcessProfiler::RecordStart(const RecordKey& key, const Time& time) {
@@ -218,18 +389,11 @@ void ProcessProfiler::RecordStart(const RecordKey& key, const Time& time) {
   ongoing_++;
 }
 
-void ProcessProfiler::RecordEnd(const RecordKey& key) {
-  if (!config_.enable_tracing && !config_.enable_profiling) return;
-  std::lock_guard<std::mutex>  lk(lk_);
-  Time now = Clock::now();
-  if (config_.enable_tracing) Tracing(key, now, TraceEvent::Type::END);
-  if (config_.enable_profiling) RecordEnd(key, now);
-}
-
 void ProcessProfiler::RecordEnd(const RecordKey& key, const Time& time) {
   const std::string& stream_name = key.first;
-  if (stream_profilers_.find(stream_name) == stream_profilers_.end())
-    OnStreamStart(stream_name);
+  auto stream_profiler_iter = stream_profilers_.find(stream_name);
+  StreamProfiler* stream_profiler = stream_profiler_iter == stream_profilers_.end() ?
+                                    OnStreamStart(stream_name) : &stream_profiler_iter->second;
 
   RecordPolicy::StartRecordIter start_record;
   if (!record_policy_->FindStartRecord(key, &start_record)) {
@@ -239,14 +403,14 @@ void ProcessProfiler::RecordEnd(const RecordKey& key, const Time& time) {
     if (ongoing_)
       AddPhysicalTime(time);
     Duration latency = time - start_record->second;
-    AddLatency(stream_name, latency);
+    AddLatency(stream_profiler, latency);
 
     uint64_t remove_counter = record_policy_->RemoveThisAndOtherUselessRecords(stream_name, &start_record);
     ongoing_ -= remove_counter;
-    AddDropped(stream_name, remove_counter - 1);
+    AddDropped(stream_profiler, remove_counter - 1);
   }
   last_record_time_ = time;
-  stream_profilers_.find(stream_name)->second.AddCompleted();
+  stream_profiler->AddCompleted();
   completed_++;
 }
 
@@ -254,6 +418,7 @@ ProcessProfile ProcessProfiler::GetProfile() {
   ProcessProfile profile;
   profile.process_name = GetName();
   std::lock_guard<std::mutex>  lk(lk_);
+  FlushRecords();
   profile.completed = completed_;
   profile.dropped = dropped_;
   profile.counter = profile.completed + profile.dropped;
@@ -268,6 +433,13 @@ ProcessProfile ProcessProfiler::GetProfile() {
     profile.latency = total_latency_ms / latency_add_times_;
     profile.maximum_latency = maximum_latency_.count();
     profile.minimum_latency = minimum_latency_.count();
+    auto percentile = [&](double quantile) {
+      return std::min(std::max(latency_histogram_.Percentile(quantile), profile.minimum_latency),
+                      profile.maximum_latency);
+    };
+    profile.latency_p50 = percentile(0.5);
+    profile.latency_p99 = percentile(0.99);
+    profile.latency_p999 = percentile(0.999);
   }
   auto stream_profilers = GetStreamProfilers();
   for (auto& it : stream_profilers) profile.stream_profiles.emplace_back(it.GetProfile());
@@ -288,10 +460,22 @@ ProcessProfile ProcessProfiler::GetProfile(const ProcessTrace& trace) const {
 void ProcessProfiler::OnStreamEos(const std::string& stream_name) {
   if (!config_.enable_tracing && !config_.enable_profiling) return;
   std::lock_guard<std::mutex>  lk(lk_);
-  if (stream_profilers_.find(stream_name) == stream_profilers_.end()) return;
+  FlushRecords();
+  {
+    // the slot is free for the next stream
+    std::lock_guard<std::mutex> slots_lk(slots_lk_);
+    auto it = slot_indexes_.find(stream_name);
+    if (it != slot_indexes_.end()) {
+      slots_[it->second].name.clear();
+      slots_[it->second].named.store(false, std::memory_order_release);
+      slot_indexes_.erase(it);
+    }
+  }
+  auto stream_profiler = stream_profilers_.find(stream_name);
+  if (stream_profiler == stream_profilers_.end()) return;
   uint64_t number_remaining = 0;
   record_policy_->OnStreamEos(stream_name, &number_remaining);
-  AddDropped(stream_name, number_remaining);
+  AddDropped(&stream_profiler->second, number_remaining);
   ongoing_ -= number_remaining;
   stream_profilers_.erase(stream_name);
 }
@@ -305,9 +489,10 @@ void ProcessProfiler::AddPhysicalTime(const Time& now) {
   }
 }
 
-void ProcessProfiler::OnStreamStart(const std::string& stream_name) {
-  stream_profilers_.emplace(stream_name, StreamProfiler(stream_name));
+StreamProfiler* ProcessProfiler::OnStreamStart(const std::string& stream_name) {
+  auto stream_profiler = stream_profilers_.emplace(stream_name, StreamProfiler(stream_name)).first;
   record_policy_->OnStreamStart(stream_name);
+  return &stream_profiler->second;
 }
 
 std::vector<StreamProfiler> ProcessProfiler::GetStreamProfilers() {
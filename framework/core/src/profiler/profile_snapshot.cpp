@@ -0,0 +1,190 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "profiler/profile_snapshot.hpp"
+
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "profiler/pipeline_profiler.hpp"
+
+namespace cnstream {
+
+namespace {
+
+using Counters = std::vector<std::pair<std::string, double>>;
+
+void FlattenProcess(const std::string& prefix, const ProcessProfile& profile, Counters* counters) {
+  counters->emplace_back(prefix + "counter", profile.counter);
+  counters->emplace_back(prefix + "completed", profile.completed);
+  counters->emplace_back(prefix + "dropped", profile.dropped);
+  counters->emplace_back(prefix + "ongoing", profile.ongoing);
+  counters->emplace_back(prefix + "latency", profile.latency);
+  counters->emplace_back(prefix + "maximum_latency", profile.maximum_latency);
+  counters->emplace_back(prefix + "minimum_latency", profile.minimum_latency);
+  counters->emplace_back(prefix + "latency_p50", profile.latency_p50);
+  counters->emplace_back(prefix + "latency_p99", profile.latency_p99);
+  counters->emplace_back(prefix + "latency_p999", profile.latency_p999);
+  counters->emplace_back(prefix + "fps", profile.fps);
+  for (const auto& stream : profile.stream_profiles) {
+    const std::string stream_prefix = prefix + "streams/" + stream.stream_name + "/";
+    counters->emplace_back(stream_prefix + "counter", stream.counter);
+    counters->emplace_back(stream_prefix + "completed", stream.completed);
+    counters->emplace_back(stream_prefix + "dropped", stream.dropped);
+    counters->emplace_back(stream_prefix + "latency", stream.latency);
+    counters->emplace_back(stream_prefix + "maximum_latency", stream.maximum_latency);
+    counters->emplace_back(stream_prefix + "minimum_latency", stream.minimum_latency);
+    counters->emplace_back(stream_prefix + "latency_p50", stream.latency_p50);
+    counters->emplace_back(stream_prefix + "latency_p99", stream.latency_p99);
+    counters->emplace_back(stream_prefix + "latency_p999", stream.latency_p999);
+    counters->emplace_back(stream_prefix + "fps", stream.fps);
+  }
+}
+
+void FlattenFrameAccounting(const std::string& prefix, const FrameAccounting& accounting, Counters* counters) {
+  counters->emplace_back(prefix + "received", accounting.received);
+  counters->emplace_back(prefix + "dropped", accounting.dropped);
+  counters->emplace_back(prefix + "stalled", accounting.stalled);
+  for (const auto& reason : accounting.dropped_by_reason) {
+    counters->emplace_back(prefix + "dropped_by_reason/" + reason.first, reason.second);
+  }
+}
+
+void FlattenMemory(const std::string& prefix, const MemoryUsage& usage, Counters* counters) {
+  counters->emplace_back(prefix + "host_bytes", usage.host_bytes);
+  counters->emplace_back(prefix + "device_bytes", usage.device_bytes);
+  counters->emplace_back(prefix + "peak_host_bytes", usage.peak_host_bytes);
+  counters->emplace_back(prefix + "peak_device_bytes", usage.peak_device_bytes);
+}
+
+inline bool SameValue(double a, double b) {
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+}  // namespace
+
+void ProfileSnapshotter::Flatten(const PipelineProfile& profile, Counters* counters) {
+  for (const auto& module : profile.module_profiles) {
+    const std::string prefix = "modules/" + module.module_name + "/";
+    for (const auto& process : module.process_profiles) {
+      FlattenProcess(prefix + process.process_name + "/", process, counters);
+    }
+    for (const auto& conveyor : module.stream_conveyors) {
+      counters->emplace_back(prefix + "conveyors/" + conveyor.first, conveyor.second);
+    }
+    for (const auto& counter : module.counters) {
+      counters->emplace_back(prefix + "counters/" + counter.first, counter.second);
+    }
+    FlattenFrameAccounting(prefix + "frames/", module.frame_accounting, counters);
+    for (const auto& accounting : module.stream_frame_accountings) {
+      FlattenFrameAccounting(prefix + "frames/streams/" + accounting.stream_name + "/", accounting, counters);
+    }
+    counters->emplace_back(prefix + "open_begin", module.open_begin);
+    counters->emplace_back(prefix + "open_time", module.open_time);
+  }
+  FlattenProcess("overall/", profile.overall_profile, counters);
+  FlattenMemory("memory/", profile.memory_usage, counters);
+  for (const auto& usage : profile.stream_memory_usages) {
+    FlattenMemory("memory/streams/" + usage.first + "/", usage.second, counters);
+  }
+  for (const auto& breakdown : profile.latency_breakdowns) {
+    const std::string prefix = "latency_breakdowns/" + breakdown.stream_name + "/";
+    counters->emplace_back(prefix + "frames", breakdown.frames);
+    counters->emplace_back(prefix + "latency", breakdown.latency);
+    for (const auto& module : breakdown.modules) {
+      const std::string module_prefix = prefix + "modules/" + module.module_name + "/";
+      counters->emplace_back(module_prefix + "frames", module.frames);
+      counters->emplace_back(module_prefix + "queue_wait", module.queue_wait);
+      counters->emplace_back(module_prefix + "maximum_queue_wait", module.maximum_queue_wait);
+      counters->emplace_back(module_prefix + "process", module.process);
+      counters->emplace_back(module_prefix + "maximum_process", module.maximum_process);
+      counters->emplace_back(module_prefix + "critical_frames", module.critical_frames);
+      counters->emplace_back(module_prefix + "critical_queue_wait", module.critical_queue_wait);
+      counters->emplace_back(module_prefix + "critical_process", module.critical_process);
+    }
+  }
+  for (const auto& device : profile.device_utilizations) {
+    const std::string prefix = "devices/" + std::to_string(device.device_id) + "/";
+    counters->emplace_back(prefix + "core_utilization", device.core_utilization);
+    counters->emplace_back(prefix + "memory_utilization", device.memory_utilization);
+    counters->emplace_back(prefix + "codec_utilization", device.codec_utilization);
+  }
+  counters->emplace_back("cpu/cpu_time", profile.cpu_usage.cpu_time);
+  counters->emplace_back("cpu/threads", profile.cpu_usage.thread_num);
+  counters->emplace_back("startup_time", profile.startup_time);
+}
+
+ProfileSnapshotter::ProfileSnapshotter(PipelineProfiler* profiler) : profiler_(profiler) {}
+
+ProfileDelta ProfileSnapshotter::GetDelta() {
+  return GetDelta(profiler_->GetProfile());
+}
+
+ProfileDelta ProfileSnapshotter::GetDelta(const PipelineProfile& profile) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  counters_.clear();
+  Flatten(profile, &counters_);
+  ProfileDelta delta;
+  while (true) {
+    delta.reset = values_.empty();
+    ++generation_;
+    size_t present = 0;
+    for (const auto& counter : counters_) {
+      auto ret = indices_.emplace(counter.first, static_cast<uint32_t>(values_.size()));
+      const uint32_t index = ret.first->second;
+      if (ret.second) {
+        delta.new_keys.push_back(counter.first);
+        values_.push_back(counter.second);
+        generations_.push_back(generation_);
+      } else if (generations_[index] == generation_) {
+        continue;  // the key is duplicated, e.g. by a stream named like a counter
+      } else {
+        generations_[index] = generation_;
+        if (SameValue(values_[index], counter.second)) {
+          ++present;
+          continue;
+        }
+        values_[index] = counter.second;
+      }
+      ++present;
+      delta.indices.push_back(index);
+      delta.values.push_back(counter.second);
+    }
+    if (values_.size() - present <= present) break;
+    // the keys of the removed streams outnumber the present ones, rebuild the key table
+    indices_.clear();
+    values_.clear();
+    generations_.clear();
+    delta = ProfileDelta();
+  }
+  return delta;
+}
+
+void ProfileSnapshotter::Reset() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  indices_.clear();
+  values_.clear();
+  generations_.clear();
+}
+
+}  // namespace cnstream
@@ -18,6 +18,7 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <algorithm>
 #include <string>
 #include <utility>
 
@@ -44,6 +45,14 @@ StreamProfile StreamProfiler::GetProfile() {
     profile.latency = total_latency_ms / latency_add_times_;
     profile.maximum_latency = maximum_latency_.count();
     profile.minimum_latency = minimum_latency_.count();
+    // the middle of a bucket may be out of the range of the latencies
+    auto percentile = [&](double quantile) {
+      return std::min(std::max(latency_histogram_.Percentile(quantile), profile.minimum_latency),
+                      profile.maximum_latency);
+    };
+    profile.latency_p50 = percentile(0.5);
+    profile.latency_p99 = percentile(0.99);
+    profile.latency_p999 = percentile(0.999);
   }
   return profile;
 }
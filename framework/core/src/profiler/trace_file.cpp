@@ -0,0 +1,340 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+#include "profiler/trace_file.hpp"
+
+namespace cnstream {
+
+constexpr uint32_t TraceFileWriter::kMagic;
+constexpr uint32_t TraceFileWriter::kVersion;
+constexpr size_t TraceFileWriter::kBufferCapacity;
+
+enum TraceRecordTag : uint8_t { kStringRecord = 1, kEventRecord = 2, kDroppedRecord = 3 };
+
+class TraceFileWriter::EventBuffer {
+ public:
+  EventBuffer() : events_(new TraceEvent[kBufferCapacity]) {}
+
+  // Called by the owner thread. Returns false if the buffer is full.
+  bool Push(const TraceEvent& event) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= kBufferCapacity) return false;
+    // the strings assigned reuse the storage of the event taken out before
+    events_[head % kBufferCapacity] = event;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called by one reader at a time.
+  void PopAll(std::vector<TraceEvent>* events) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    for (; tail < head; ++tail) events->push_back(events_[tail % kBufferCapacity]);
+    tail_.store(tail, std::memory_order_release);
+  }
+
+ private:
+  std::unique_ptr<TraceEvent[]> events_;
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+};  // class TraceFileWriter::EventBuffer
+
+static uint64_t NextWriterId() {
+  static std::atomic<uint64_t> id{0};
+  return ++id;
+}
+
+static void PutVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+static void PutSignedVarint(int64_t value, std::string* out) {
+  PutVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63), out);
+}
+
+static int64_t ToNs(const Time& time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+TraceFileWriter::TraceFileWriter() : id_(NextWriterId()) {}
+
+TraceFileWriter::~TraceFileWriter() { Close(); }
+
+bool TraceFileWriter::Open(const std::string& path, uint32_t flush_interval_ms) {
+  if (IsOpened()) {
+    LOGE(PROFILER) << "TraceFileWriter::Open() the writer is opened already";
+    return false;
+  }
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_) {
+    LOGE(PROFILER) << "TraceFileWriter::Open() open " << path << " failed, " << strerror(errno);
+    return false;
+  }
+  const uint32_t header[2] = {kMagic, kVersion};
+  if (fwrite(header, sizeof(header), 1, file_) != 1) {
+    LOGE(PROFILER) << "TraceFileWriter::Open() write " << path << " failed, " << strerror(errno);
+    fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+  strings_.clear();
+  last_time_ = 0;
+  dropped_written_ = dropped_.load();
+  running_ = true;
+  thread_ = std::thread(&TraceFileWriter::Loop, this, std::max(flush_interval_ms, 1u));
+  opened_.store(true, std::memory_order_release);
+  return true;
+}
+
+void TraceFileWriter::Close() {
+  if (!IsOpened()) return;
+  opened_.store(false, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lk(running_lk_);
+    running_ = false;
+  }
+  running_cond_.notify_one();
+  if (thread_.joinable()) thread_.join();
+  fclose(file_);
+  file_ = nullptr;
+}
+
+void TraceFileWriter::Write(const TraceEvent& event) {
+  if (!IsOpened()) return;
+  if (!GetThreadBuffer()->Push(event)) dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+TraceFileWriter::EventBuffer* TraceFileWriter::GetThreadBuffer() {
+  // the buffers of a thread are keyed by the identifications of writers, which are never reused
+  using ThreadBuffer = std::pair<uint64_t, std::shared_ptr<EventBuffer>>;
+  struct ThreadBuffers {
+    uint64_t last_id = 0;
+    EventBuffer* last_buffer = nullptr;
+    std::vector<ThreadBuffer> buffers;
+  };
+  static thread_local ThreadBuffers thread_buffers;
+  if (thread_buffers.last_id == id_) return thread_buffers.last_buffer;
+  auto& buffers = thread_buffers.buffers;
+  const uint64_t id = id_;
+  auto it = std::find_if(buffers.begin(), buffers.end(), [id](const ThreadBuffer& buffer) {
+    return buffer.first == id;
+  });
+  if (it == buffers.end()) {
+    // the buffers only referenced by this thread belong to writers destroyed
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const ThreadBuffer& buffer) {
+      return buffer.second.use_count() == 1;
+    }), buffers.end());
+    std::shared_ptr<EventBuffer> buffer = std::make_shared<EventBuffer>();
+    {
+      std::lock_guard<std::mutex> lk(buffers_lk_);
+      buffers_.push_back(buffer);
+    }
+    it = buffers.emplace(buffers.end(), id_, buffer);
+  }
+  thread_buffers.last_id = id_;
+  thread_buffers.last_buffer = it->second.get();
+  return thread_buffers.last_buffer;
+}
+
+void TraceFileWriter::Loop(uint32_t flush_interval_ms) {
+  bool running = true;
+  while (running) {
+    {
+      std::unique_lock<std::mutex> lk(running_lk_);
+      running = !running_cond_.wait_for(lk, std::chrono::milliseconds(flush_interval_ms), [this] {
+        return !running_;
+      });
+    }
+    // the last drain takes the events written before closing
+    Drain();
+  }
+}
+
+void TraceFileWriter::Drain() {
+  draining_events_.clear();
+  {
+    std::lock_guard<std::mutex> lk(buffers_lk_);
+    // the buffers only referenced by the writer belong to threads exited, no event is written to them after this
+    // drain. A thread may write and exit while draining, its buffer is removed by the next drain.
+    auto exited = std::partition(buffers_.begin(), buffers_.end(), [](const std::shared_ptr<EventBuffer>& buffer) {
+      return buffer.use_count() != 1;
+    });
+    for (const auto& buffer : buffers_) buffer->PopAll(&draining_events_);
+    buffers_.erase(exited, buffers_.end());
+  }
+  std::stable_sort(draining_events_.begin(), draining_events_.end(), [](const TraceEvent& a, const TraceEvent& b) {
+    return a.time < b.time;
+  });
+
+  std::string out;
+  uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+  if (dropped != dropped_written_) {
+    out.push_back(static_cast<char>(kDroppedRecord));
+    PutVarint(dropped - dropped_written_, &out);
+    dropped_written_ = dropped;
+  }
+  for (const TraceEvent& event : draining_events_) {
+    uint64_t stream_id = StringId(event.key.first, &out);
+    uint64_t module_id = StringId(event.module_name, &out);
+    uint64_t process_id = StringId(event.process_name, &out);
+    int64_t time = ToNs(event.time);
+    out.push_back(static_cast<char>(kEventRecord));
+    PutVarint(static_cast<uint64_t>(event.level) << 1 | (event.type == TraceEvent::Type::END ? 1 : 0), &out);
+    PutVarint(stream_id, &out);
+    PutSignedVarint(event.key.second, &out);
+    PutVarint(module_id, &out);
+    PutVarint(process_id, &out);
+    PutSignedVarint(time - last_time_, &out);
+    last_time_ = time;
+  }
+  if (out.empty()) return;
+  if (fwrite(out.data(), out.size(), 1, file_) != 1 || fflush(file_) != 0) {
+    LOGE(PROFILER) << "TraceFileWriter::Drain() write " << draining_events_.size() << " events failed, "
+                   << strerror(errno);
+    return;
+  }
+  written_.fetch_add(draining_events_.size(), std::memory_order_relaxed);
+}
+
+uint64_t TraceFileWriter::StringId(const std::string& str, std::string* out) {
+  if (str.empty()) return 0;
+  auto it = strings_.find(str);
+  if (it != strings_.end()) return it->second;
+  uint64_t id = strings_.size() + 1;
+  strings_.emplace(str, id);
+  out->push_back(static_cast<char>(kStringRecord));
+  PutVarint(id, out);
+  PutVarint(str.size(), out);
+  out->append(str);
+  return id;
+}
+
+TraceFileReader::~TraceFileReader() { Close(); }
+
+bool TraceFileReader::Open(const std::string& path) {
+  Close();
+  file_ = fopen(path.c_str(), "rb");
+  if (!file_) {
+    LOGE(PROFILER) << "TraceFileReader::Open() open " << path << " failed, " << strerror(errno);
+    return false;
+  }
+  uint32_t header[2] = {0, 0};
+  if (fread(header, sizeof(header), 1, file_) != 1 || header[0] != TraceFileWriter::kMagic ||
+      header[1] != TraceFileWriter::kVersion) {
+    LOGE(PROFILER) << "TraceFileReader::Open() " << path << " is not a trace file of version "
+                   << TraceFileWriter::kVersion;
+    Close();
+    return false;
+  }
+  strings_.assign(1, std::string());
+  last_time_ = 0;
+  dropped_ = 0;
+  return true;
+}
+
+void TraceFileReader::Close() {
+  if (!file_) return;
+  fclose(file_);
+  file_ = nullptr;
+}
+
+bool TraceFileReader::Next(TraceEvent* event) {
+  if (!file_ || !event) return false;
+  int tag;
+  while ((tag = fgetc(file_)) != EOF) {
+    if (kStringRecord == tag) {
+      uint64_t id, size;
+      if (!ReadVarint(&id) || !ReadVarint(&size) || id != strings_.size()) return false;
+      std::string str(size, '\0');
+      if (size && fread(&str[0], size, 1, file_) != 1) return false;
+      strings_.push_back(std::move(str));
+    } else if (kDroppedRecord == tag) {
+      uint64_t count;
+      if (!ReadVarint(&count)) return false;
+      dropped_ += count;
+    } else if (kEventRecord == tag) {
+      uint64_t flags, stream_id, module_id, process_id;
+      int64_t pts, time_delta;
+      if (!ReadVarint(&flags) || !ReadVarint(&stream_id) || !ReadSignedVarint(&pts) || !ReadVarint(&module_id) ||
+          !ReadVarint(&process_id) || !ReadSignedVarint(&time_delta)) {
+        return false;
+      }
+      if (!Lookup(stream_id, &event->key.first) || !Lookup(module_id, &event->module_name) ||
+          !Lookup(process_id, &event->process_name)) {
+        return false;
+      }
+      event->key.second = pts;
+      event->level = static_cast<TraceEvent::Level>(flags >> 1);
+      event->type = flags & 1 ? TraceEvent::Type::END : TraceEvent::Type::START;
+      last_time_ += time_delta;
+      event->time = Time(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(last_time_)));
+      return true;
+    } else {
+      LOGE(PROFILER) << "TraceFileReader::Next() unknown record " << tag;
+      return false;
+    }
+  }
+  return false;
+}
+
+bool TraceFileReader::ReadVarint(uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = fgetc(file_);
+    if (EOF == byte) return false;
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+bool TraceFileReader::ReadSignedVarint(int64_t* value) {
+  uint64_t zigzag;
+  if (!ReadVarint(&zigzag)) return false;
+  *value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+  return true;
+}
+
+bool TraceFileReader::Lookup(uint64_t id, std::string* str) const {
+  if (id >= strings_.size()) return false;
+  *str = strings_[id];
+  return true;
+}
+
+}  // namespace cnstream
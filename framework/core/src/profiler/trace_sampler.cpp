@@ -0,0 +1,78 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+
+#include "cnstream_logging.hpp"
+#include "profiler/trace_sampler.hpp"
+
+namespace cnstream {
+
+// the finalizer of splitmix64, spreads the timestamps regularly spaced over the intervals
+static inline uint64_t MixBits(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+TraceSampler::TraceSampler(const ProfilerConfig& config)
+    : sample_interval_(config.trace_sample_interval),
+      streams_(config.trace_streams.begin(), config.trace_streams.end()),
+      latency_threshold_(config.trace_latency_threshold),
+      burst_duration_(std::chrono::duration_cast<Clock::duration>(Duration(config.trace_burst_duration))),
+      burst_end_(std::numeric_limits<Clock::rep>::min()) {}
+
+bool TraceSampler::IsNeeded(const ProfilerConfig& config) {
+  return config.enable_tracing && config.trace_sample_interval != 1;
+}
+
+bool TraceSampler::IsSampled(const std::string& stream_name, int64_t timestamp, const Time& now) const {
+  if (IsBursting(now)) return true;
+  if (!streams_.empty() && streams_.count(stream_name)) return true;
+  if (!sample_interval_) return false;
+  uint64_t hash = std::hash<std::string>()(stream_name) ^ static_cast<uint64_t>(timestamp);
+  return MixBits(hash) % sample_interval_ == 0;
+}
+
+void TraceSampler::OnProcessTime(const std::string& module_name, const Duration& process_time, const Time& now) {
+  if (!IsTriggerEnabled() || process_time <= latency_threshold_) return;
+  const Clock::rep end = (now + burst_duration_).time_since_epoch().count();
+  Clock::rep current = burst_end_.load(std::memory_order_relaxed);
+  while (current < end) {
+    if (!burst_end_.compare_exchange_weak(current, end, std::memory_order_relaxed)) continue;
+    if (current < now.time_since_epoch().count()) {
+      bursts_.fetch_add(1, std::memory_order_relaxed);
+      LOGI(PROFILER) << "The process time of module [" << module_name << "] is " << process_time.count()
+                     << "ms, trace all frames for " << Duration(burst_duration_).count() << "ms.";
+    }
+    break;
+  }
+}
+
+bool TraceSampler::IsBursting(const Time& now) const {
+  return now.time_since_epoch().count() < burst_end_.load(std::memory_order_relaxed);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,98 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "reorder_buffer.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <memory>
+
+namespace cnstream {
+
+// the EOS is keyed after all data of its stream
+static inline int64_t ReorderKey(const std::shared_ptr<CNFrameInfo>& data) {
+  return data->IsEos() ? std::numeric_limits<int64_t>::max() : data->GetSequence();
+}
+
+ReorderBuffer::ReorderBuffer(uint32_t stream_num, bool ordered)
+    : stream_num_(stream_num), ordered_(ordered), streams_(new Stream[stream_num]) {}
+
+void ReorderBuffer::Enter(const std::shared_ptr<CNFrameInfo>& data) {
+  if (!IsTracked(data)) return;
+  Stream& stream = streams_[data->GetStreamIndex()];
+  const int64_t key = ReorderKey(data);
+  std::lock_guard<std::mutex> lk(stream.mutex);
+  // the data usually enters in order, from the back
+  auto iter = stream.entries.end();
+  while (iter != stream.entries.begin() && std::prev(iter)->key > key) --iter;
+  stream.entries.insert(iter, Entry{key, false, nullptr});
+}
+
+void ReorderBuffer::Finish(const std::shared_ptr<CNFrameInfo>& data, bool forward, const OutputFunc& output) {
+  if (!IsTracked(data)) return;
+  Stream& stream = streams_[data->GetStreamIndex()];
+  const int64_t key = ReorderKey(data);
+  std::unique_lock<std::mutex> lk(stream.mutex);
+  auto iter = std::lower_bound(stream.entries.begin(), stream.entries.end(), key,
+                               [](const Entry& entry, int64_t value) { return entry.key < value; });
+  // the data has not entered, e.g. the buffer is cleared, or it is finished already.
+  if (iter == stream.entries.end() || iter->key != key || iter->done) return;
+  if (!ordered_ && !data->IsEos()) {
+    stream.entries.erase(iter);
+    if (forward) {
+      stream.outputs++;
+      lk.unlock();
+      output(data);
+      lk.lock();
+      stream.outputs--;
+    }
+  } else {
+    iter->done = true;
+    if (forward) iter->data = data;
+  }
+  if (stream.draining) return;
+  stream.draining = true;
+  // out of order, only the EOS is left in the buffer once it is done, it waits for the data being output.
+  while (!stream.entries.empty() && stream.entries.front().done && 0 == stream.outputs) {
+    std::shared_ptr<CNFrameInfo> ready = std::move(stream.entries.front().data);
+    stream.entries.pop_front();
+    if (!ready) continue;
+    lk.unlock();
+    output(ready);
+    lk.lock();
+  }
+  stream.draining = false;
+}
+
+size_t ReorderBuffer::GetSize(uint32_t stream_idx) const {
+  if (stream_idx >= stream_num_) return 0;
+  std::lock_guard<std::mutex> lk(streams_[stream_idx].mutex);
+  return streams_[stream_idx].entries.size();
+}
+
+void ReorderBuffer::Clear() {
+  for (uint32_t stream_idx = 0; stream_idx < stream_num_; ++stream_idx) {
+    std::lock_guard<std::mutex> lk(streams_[stream_idx].mutex);
+    streams_[stream_idx].entries.clear();
+  }
+}
+
+}  // namespace cnstream
@@ -0,0 +1,104 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CORE_INCLUDE_REORDER_BUFFER_HPP_
+#define MODULES_CORE_INCLUDE_REORDER_BUFFER_HPP_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "cnstream_common.hpp"
+#include "cnstream_frame.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Restores the order of the data of each stream processed by several threads of one module at the same
+ * time, see CNModuleConfig::streamParallel.
+ *
+ * The data enters the buffer before it is pushed to an input queue of the module, and completes when the module
+ * transmits it. The data of a stream is kept by its sequence number, see CNFrameInfo::GetSequence, and output in
+ * that order. The EOS of a stream is always output after the other data of the stream.
+ *
+ * Only one thread outputs the data of a stream at one time. A thread completing data while another one is outputting
+ * the stream returns right away, the data is output by the other thread.
+ */
+class ReorderBuffer : private NonCopyable {
+ public:
+  using OutputFunc = std::function<void(const std::shared_ptr<CNFrameInfo>&)>;
+  /**
+   * @param
+   *   [stream_num]: the number of stream indices, the data of the streams with larger indices is not kept.
+   *   [ordered]: whether to output the data in order. Otherwise, the data is output as soon as it completes, and
+   *              only the EOS waits for the other data of the stream.
+   */
+  ReorderBuffer(uint32_t stream_num, bool ordered);
+  /**
+   * @brief Whether the data is kept by the buffer, the data must have a stream index and a sequence number.
+   */
+  bool IsTracked(const std::shared_ptr<CNFrameInfo>& data) const {
+    return data->GetStreamIndex() < stream_num_ && (data->IsEos() || data->GetSequence() >= 0);
+  }
+  /**
+   * @brief Records that the data enters the module.
+   */
+  void Enter(const std::shared_ptr<CNFrameInfo>& data);
+  /**
+   * @brief Records that the module has processed the data, and outputs the data ready by ``output``.
+   */
+  void Complete(const std::shared_ptr<CNFrameInfo>& data, const OutputFunc& output) { Finish(data, true, output); }
+  /**
+   * @brief Records that the data is dropped or failed to be processed. It is not output, the data after it is output
+   * by ``output`` if it is ready.
+   */
+  void Discard(const std::shared_ptr<CNFrameInfo>& data, const OutputFunc& output) { Finish(data, false, output); }
+  /**
+   * @brief Gets the number of data of a stream in the buffer, entered but not output yet.
+   */
+  size_t GetSize(uint32_t stream_idx) const;
+  /**
+   * @brief Forgets all data, e.g. when the pipeline is stopped.
+   */
+  void Clear();
+
+ private:
+  struct Entry {
+    int64_t key;
+    bool done;
+    std::shared_ptr<CNFrameInfo> data;  // nullptr if the data is discarded
+  };
+  struct Stream {
+    mutable std::mutex mutex;
+    std::deque<Entry> entries;  // sorted by key
+    bool draining = false;      // a thread is outputting the stream
+    uint32_t outputs = 0;       // the data being output out of order
+  };
+  void Finish(const std::shared_ptr<CNFrameInfo>& data, bool forward, const OutputFunc& output);
+
+  const uint32_t stream_num_;
+  const bool ordered_;
+  std::unique_ptr<Stream[]> streams_;
+};  // class ReorderBuffer
+
+}  // namespace cnstream
+
+#endif  // MODULES_CORE_INCLUDE_REORDER_BUFFER_HPP_
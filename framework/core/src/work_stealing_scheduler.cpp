@@ -0,0 +1,148 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "work_stealing_scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+namespace {
+// worker information of the calling thread
+thread_local const WorkStealingScheduler* tls_scheduler = nullptr;
+thread_local uint32_t tls_worker_idx = 0;
+thread_local uint32_t tls_help_depth = 0;
+constexpr uint32_t kMaxHelpDepth = 4;
+}  // namespace
+
+WorkStealingScheduler::WorkStealingScheduler(uint32_t thread_num)
+    : thread_num_(thread_num ? thread_num : std::max(std::thread::hardware_concurrency(), 1u)) {
+  queues_.reserve(thread_num_);
+  for (uint32_t i = 0; i < thread_num_; ++i) {
+    queues_.emplace_back(new (std::nothrow) JobQueue);
+    LOGF_IF(CORE, nullptr == queues_.back()) << "WorkStealingScheduler::WorkStealingScheduler() new JobQueue failed.";
+  }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() {
+  Stop();
+}
+
+void WorkStealingScheduler::Start(std::function<void()> init_func) {
+  if (running_.exchange(true)) return;
+  init_func_ = std::move(init_func);
+  for (uint32_t i = 0; i < thread_num_; ++i) {
+    threads_.emplace_back(&WorkStealingScheduler::WorkerLoop, this, i);
+  }
+}
+
+void WorkStealingScheduler::Stop() {
+  if (!running_.exchange(false)) return;
+  {
+    std::lock_guard<std::mutex> lk(wait_mutex_);
+    wait_cond_.notify_all();
+  }
+  for (auto& it : threads_) {
+    if (it.joinable()) it.join();
+  }
+  threads_.clear();
+  for (auto& queue : queues_) {
+    std::lock_guard<std::mutex> lk(queue->mutex);
+    queue->jobs.clear();
+  }
+  pending_num_.store(0);
+}
+
+void WorkStealingScheduler::Submit(uint32_t affinity, Job job) {
+  JobQueue* queue = queues_[affinity % thread_num_].get();
+  pending_num_.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lk(queue->mutex);
+    queue->jobs.push_back(std::move(job));
+  }
+  if (sleeper_num_.load() > 0) {
+    std::lock_guard<std::mutex> lk(wait_mutex_);
+    wait_cond_.notify_one();
+  }
+}
+
+bool WorkStealingScheduler::PopJob(uint32_t worker_idx, Job* job) {
+  // own queue first, in submission order
+  {
+    JobQueue* queue = queues_[worker_idx].get();
+    std::lock_guard<std::mutex> lk(queue->mutex);
+    if (!queue->jobs.empty()) {
+      *job = std::move(queue->jobs.front());
+      queue->jobs.pop_front();
+      pending_num_.fetch_sub(1);
+      return true;
+    }
+  }
+  // steal from the tail of the others
+  for (uint32_t i = 1; i < thread_num_; ++i) {
+    JobQueue* queue = queues_[(worker_idx + i) % thread_num_].get();
+    std::lock_guard<std::mutex> lk(queue->mutex);
+    if (!queue->jobs.empty()) {
+      *job = std::move(queue->jobs.back());
+      queue->jobs.pop_back();
+      pending_num_.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WorkStealingScheduler::HelpOnce() {
+  if (tls_scheduler != this || tls_help_depth >= kMaxHelpDepth || !running_.load()) return false;
+  Job job;
+  if (!PopJob(tls_worker_idx, &job)) return false;
+  tls_help_depth++;
+  job();
+  tls_help_depth--;
+  return true;
+}
+
+void WorkStealingScheduler::WorkerLoop(uint32_t worker_idx) {
+  tls_scheduler = this;
+  tls_worker_idx = worker_idx;
+  if (init_func_) init_func_();
+  Job job;
+  while (running_.load()) {
+    if (PopJob(worker_idx, &job)) {
+      job();
+      job = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lk(wait_mutex_);
+    sleeper_num_.fetch_add(1);
+    wait_cond_.wait_for(lk, rel_time_, [this] { return pending_num_.load() > 0 || !running_.load(); });
+    sleeper_num_.fetch_sub(1);
+  }
+  tls_scheduler = nullptr;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,112 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_WORK_STEALING_SCHEDULER_HPP_
+#define CNSTREAM_WORK_STEALING_SCHEDULER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cnstream_common.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief WorkStealingScheduler is a thread pool, in which every worker has its own job queue.
+ *
+ * A job is submitted to the queue of the worker selected by an affinity value, so that jobs with the same
+ * affinity tend to run on the same thread. An idle worker steals jobs from the queues of the other workers.
+ *
+ * The scheduler does not serialize jobs, callers who need ordering have to make sure that a job is not
+ * submitted again before the previous one finishes (see Pipeline for the conveyor jobs).
+ */
+class WorkStealingScheduler : private NonCopyable {
+ public:
+  using Job = std::function<void()>;
+  /**
+   * @brief Constructor.
+   * @param
+   *   [thread_num]: the number of worker threads. 0 means the number of hardware threads.
+   */
+  explicit WorkStealingScheduler(uint32_t thread_num);
+  ~WorkStealingScheduler();
+
+  /**
+   * @brief Starts the workers.
+   * @param
+   *   [init_func]: called by each worker before it runs jobs, e.g. to tag the thread. It could be nullptr.
+   */
+  void Start(std::function<void()> init_func = nullptr);
+  /**
+   * @brief Stops all workers. Jobs not started yet are discarded.
+   */
+  void Stop();
+  bool IsRunning() const { return running_.load(); }
+  uint32_t GetThreadNum() const { return thread_num_; }
+
+  /**
+   * @brief Submits a job to the queue of worker ``affinity % thread_num``.
+   */
+  void Submit(uint32_t affinity, Job job);
+  /**
+   * @brief Runs one pending job on the calling thread.
+   *
+   * It is used by a worker which has to wait for other jobs, e.g. the downstream queue is full.
+   *
+   * @return Returns false if the calling thread is not a worker of this scheduler, there is no pending job,
+   * or the nesting depth is too deep.
+   */
+  bool HelpOnce();
+
+#ifdef UNIT_TEST
+ public:  // NOLINT
+#else
+ private:  // NOLINT
+#endif
+  bool PopJob(uint32_t worker_idx, Job* job);
+  void WorkerLoop(uint32_t worker_idx);
+
+ private:
+  struct JobQueue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+  const uint32_t thread_num_;
+  std::vector<std::unique_ptr<JobQueue>> queues_;
+  std::vector<std::thread> threads_;
+  std::function<void()> init_func_;
+  std::atomic<bool> running_{false};
+  std::atomic<uint64_t> pending_num_{0};
+  std::atomic<uint32_t> sleeper_num_{0};
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cond_;
+  const std::chrono::milliseconds rel_time_{20};
+};  // class WorkStealingScheduler
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_WORK_STEALING_SCHEDULER_HPP_
@@ -0,0 +1,168 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "cnstream_admission.hpp"
+
+namespace cnstream {
+
+using Clock = std::chrono::steady_clock;
+
+// sends frames of a stream at fps for one second starting from start, returns the frames admitted
+static int SendFrames(AdmissionController* controller, const std::string& stream_id, int fps, Clock::time_point start) {
+  int admitted = 0;
+  for (int i = 0; i < fps; ++i) {
+    if (controller->Admit(stream_id, start + std::chrono::microseconds(1000000 * i / fps))) ++admitted;
+  }
+  return admitted;
+}
+
+TEST(CoreAdmission, NoLimitByDefault) {
+  AdmissionController controller(AdmissionConfig{});
+  const auto start = Clock::now();
+  EXPECT_EQ(SendFrames(&controller, "stream_0", 100, start), 100);
+  controller.Update(false, 100, 1);
+  EXPECT_LT(controller.GetCapacity(), 0);
+  EXPECT_EQ(SendFrames(&controller, "stream_0", 100, start + std::chrono::seconds(1)), 100);
+  auto states = controller.GetStreamStates();
+  ASSERT_EQ(states.size(), 1u);
+  EXPECT_DOUBLE_EQ(states["stream_0"].offered_fps, 100);
+  EXPECT_EQ(states["stream_0"].admitted, 200u);
+  EXPECT_EQ(states["stream_0"].rejected, 0u);
+}
+
+TEST(CoreAdmission, FairShares) {
+  AdmissionConfig config;
+  config.decrease_ratio = 1;
+  config.min_fps = 0;
+  AdmissionController controller(config);
+  auto start = Clock::now();
+  // stream_0 sends far more than the others
+  SendFrames(&controller, "stream_0", 200, start);
+  SendFrames(&controller, "stream_1", 50, start);
+  SendFrames(&controller, "stream_2", 10, start);
+  controller.Update(true, 90, 1);
+  EXPECT_DOUBLE_EQ(controller.GetCapacity(), 90);
+  auto states = controller.GetStreamStates();
+  // stream_2 keeps its frame rate, the rest is shared by stream_0 and stream_1
+  EXPECT_NEAR(states["stream_0"].allowed_fps, 40, 1e-6);
+  EXPECT_NEAR(states["stream_1"].allowed_fps, 40, 1e-6);
+  EXPECT_GE(states["stream_2"].allowed_fps, 10);
+
+  start += std::chrono::seconds(1);
+  EXPECT_NEAR(SendFrames(&controller, "stream_0", 200, start), 40, 9);
+  EXPECT_NEAR(SendFrames(&controller, "stream_1", 50, start), 40, 9);
+  EXPECT_EQ(SendFrames(&controller, "stream_2", 10, start), 10);
+}
+
+TEST(CoreAdmission, Weights) {
+  AdmissionConfig config;
+  config.decrease_ratio = 1;
+  config.min_fps = 0;
+  AdmissionController controller(config);
+  EXPECT_FALSE(controller.SetWeight("stream_0", 0));
+  EXPECT_TRUE(controller.SetWeight("stream_0", 3));
+  const auto start = Clock::now();
+  SendFrames(&controller, "stream_0", 100, start);
+  SendFrames(&controller, "stream_1", 100, start);
+  controller.Update(true, 80, 1);
+  auto states = controller.GetStreamStates();
+  EXPECT_NEAR(states["stream_0"].allowed_fps, 60, 1e-6);
+  EXPECT_NEAR(states["stream_1"].allowed_fps, 20, 1e-6);
+}
+
+TEST(CoreAdmission, MinFps) {
+  AdmissionConfig config;
+  config.min_fps = 5;
+  AdmissionController controller(config);
+  const auto start = Clock::now();
+  SendFrames(&controller, "stream_0", 100, start);
+  SendFrames(&controller, "stream_1", 100, start);
+  controller.Update(true, 0, 1);
+  EXPECT_DOUBLE_EQ(controller.GetCapacity(), 0);
+  for (const auto& it : controller.GetStreamStates()) EXPECT_DOUBLE_EQ(it.second.allowed_fps, 5);
+  // a new stream gets the minimum as well
+  EXPECT_TRUE(controller.Admit("stream_2", start + std::chrono::seconds(1)));
+  EXPECT_DOUBLE_EQ(controller.GetStreamStates()["stream_2"].allowed_fps, 5);
+}
+
+TEST(CoreAdmission, Recover) {
+  AdmissionConfig config;
+  config.decrease_ratio = 0.5;
+  config.increase_ratio = 2;
+  AdmissionController controller(config);
+  auto start = Clock::now();
+  SendFrames(&controller, "stream_0", 100, start);
+  controller.Update(true, 100, 1);
+  EXPECT_DOUBLE_EQ(controller.GetCapacity(), 50);
+  // overloaded again, the capacity is limited by the frames completed
+  start += std::chrono::seconds(1);
+  SendFrames(&controller, "stream_0", 100, start);
+  controller.Update(true, 40, 1);
+  EXPECT_DOUBLE_EQ(controller.GetCapacity(), 20);
+  start += std::chrono::seconds(1);
+  SendFrames(&controller, "stream_0", 100, start);
+  controller.Update(false, 20, 1);
+  EXPECT_DOUBLE_EQ(controller.GetCapacity(), 40);
+  // no limit once the capacity covers the frames sent
+  start += std::chrono::seconds(1);
+  SendFrames(&controller, "stream_0", 50, start);
+  controller.Update(false, 40, 1);
+  EXPECT_LT(controller.GetCapacity(), 0);
+  EXPECT_LT(controller.GetStreamStates()["stream_0"].allowed_fps, 0);
+}
+
+TEST(CoreAdmission, RemoveStream) {
+  AdmissionController controller(AdmissionConfig{});
+  EXPECT_TRUE(controller.Admit("stream_0"));
+  EXPECT_EQ(controller.GetStreamStates().size(), 1u);
+  controller.RemoveStream("stream_0");
+  EXPECT_TRUE(controller.GetStreamStates().empty());
+}
+
+TEST(CoreAdmission, StartStop) {
+  AdmissionConfig config;
+  config.interval_ms = 10;
+  AdmissionController controller(config);
+  EXPECT_FALSE(controller.Start(nullptr));
+  std::atomic<int> samples{0};
+  ASSERT_TRUE(controller.Start([&samples]() {
+    ++samples;
+    AdmissionSample sample;
+    sample.overloaded = true;
+    return sample;
+  }));
+  for (int i = 0; i < 100 && samples.load() < 3; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_GE(samples.load(), 3);
+  EXPECT_GE(controller.GetCapacity(), 0);
+  controller.Stop();
+  // no limit once stopped
+  EXPECT_LT(controller.GetCapacity(), 0);
+  EXPECT_TRUE(controller.Admit("stream_0"));
+}
+
+}  // namespace cnstream
@@ -0,0 +1,85 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sched.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "private/cnstream_affinity.hpp"
+#include "private/cnstream_allocator.hpp"
+
+namespace cnstream {
+
+TEST(CoreAffinity, ParseCpuList) {
+  std::vector<int> cpus;
+  EXPECT_TRUE(ParseCpuList("0-3,8,10-11", &cpus));
+  EXPECT_EQ(cpus, std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_TRUE(ParseCpuList("5,1-2,2\n", &cpus));
+  EXPECT_EQ(cpus, std::vector<int>({1, 2, 5}));
+  EXPECT_FALSE(ParseCpuList("", &cpus));
+  EXPECT_FALSE(ParseCpuList("3-1", &cpus));
+  EXPECT_FALSE(ParseCpuList("a", &cpus));
+  EXPECT_FALSE(ParseCpuList("1,,2", &cpus));
+  EXPECT_FALSE(ParseCpuList("-1", &cpus));
+}
+
+TEST(CoreAffinity, NumaNode) {
+  EXPECT_GE(GetNumaNodeNum(), 1);
+  EXPECT_TRUE(GetNumaNodeCpus(-1).empty());
+  EXPECT_TRUE(GetNumaNodeCpus(100000).empty());
+  EXPECT_EQ(GetMluNumaNode(-1), -1);
+  EXPECT_EQ(GetMluNumaNode(100000), -1);
+}
+
+TEST(CoreAffinity, SetCurrentThreadAffinity) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  ASSERT_EQ(sched_getaffinity(0, sizeof(cpu_set), &cpu_set), 0);
+  int allowed_cpu = 0;
+  while (!CPU_ISSET(allowed_cpu, &cpu_set)) ++allowed_cpu;
+
+  std::thread th([&] {
+    EXPECT_EQ(GetCurrentThreadNumaNode(), -1);
+    EXPECT_FALSE(SetCurrentThreadAffinity({}));
+    EXPECT_FALSE(SetCurrentThreadAffinity({-1}));
+    ASSERT_TRUE(SetCurrentThreadAffinity({allowed_cpu}, 0));
+    EXPECT_EQ(GetCurrentThreadNumaNode(), 0);
+    EXPECT_EQ(sched_getcpu(), allowed_cpu);
+    // host memory is allocated on the node of the thread
+    std::shared_ptr<void> data = cnCpuMemAlloc(4096 * 3);
+    EXPECT_NE(data, nullptr);
+  });
+  th.join();
+  // other threads are not affected
+  EXPECT_EQ(GetCurrentThreadNumaNode(), -1);
+}
+
+TEST(CoreAffinity, CpuMemAllocOnNumaNode) {
+  std::shared_ptr<void> data = cnCpuMemAlloc(100, 0);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data.get()) % 4096, 0u);
+  EXPECT_FALSE(SetMemoryNumaNode(nullptr, 4096, 0));
+  EXPECT_FALSE(SetMemoryNumaNode(data.get(), 4096, -1));
+}
+
+}  // namespace cnstream
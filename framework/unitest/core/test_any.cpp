@@ -0,0 +1,98 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "util/cnstream_any.hpp"
+
+namespace cnstream {
+
+namespace any_test {
+struct LargeValue {
+  std::array<int, 16> data;
+};
+
+struct LargeMoveOnlyValue {
+  std::unique_ptr<int> ptr;
+  std::array<int, 16> data;
+};
+
+template <class T>
+bool IsStoredInPlace(const any& value) {
+  auto ptr = reinterpret_cast<const char*>(any_cast<T>(&value));
+  auto begin = reinterpret_cast<const char*>(&value);
+  return ptr >= begin && ptr < begin + sizeof(value);
+}
+}  // namespace any_test
+
+TEST(CoreAny, SharedPtrStoredInPlace) {
+  any value = std::make_shared<int>(1);
+  EXPECT_TRUE(any_test::IsStoredInPlace<std::shared_ptr<int>>(value));
+  any other = value;
+  EXPECT_EQ(any_cast<std::shared_ptr<int>>(other).use_count(), 3);
+  any large = any_test::LargeValue();
+  EXPECT_FALSE(any_test::IsStoredInPlace<any_test::LargeValue>(large));
+}
+
+TEST(CoreAny, Cast) {
+  any value = std::make_shared<int>(1);
+  EXPECT_NE(any_cast<std::shared_ptr<int>>(&value), nullptr);
+  EXPECT_NE(any_cast<const std::shared_ptr<int>>(&value), nullptr);
+  const any& const_value = value;
+  EXPECT_NE(any_cast<std::shared_ptr<int>>(&const_value), nullptr);
+  EXPECT_EQ(*any_cast<const std::shared_ptr<int>&>(const_value), 1);
+  EXPECT_EQ(any_cast<std::shared_ptr<float>>(&value), nullptr);
+  EXPECT_EQ(any_cast<int>(&value), nullptr);
+  EXPECT_THROW(any_cast<int>(value), bad_any_cast);
+  EXPECT_EQ(value.type(), typeid(std::shared_ptr<int>));
+
+  any large = any_test::LargeValue();
+  EXPECT_NE(any_cast<any_test::LargeValue>(&large), nullptr);
+  EXPECT_EQ(any_cast<std::shared_ptr<int>>(&large), nullptr);
+
+  any empty;
+  EXPECT_EQ(any_cast<int>(&empty), nullptr);
+}
+
+TEST(CoreAny, MoveOnly) {
+  any value = std::unique_ptr<int>(new int(1));
+  EXPECT_TRUE(any_test::IsStoredInPlace<std::unique_ptr<int>>(value));
+  int* raw = any_cast<std::unique_ptr<int>&>(value).get();
+  any moved = std::move(value);
+  EXPECT_FALSE(value.has_value());
+  EXPECT_EQ(any_cast<std::unique_ptr<int>&>(moved).get(), raw);
+  EXPECT_THROW(any copied(moved), bad_any_copy);
+  std::unique_ptr<int> out = any_cast<std::unique_ptr<int>>(std::move(moved));
+  EXPECT_EQ(out.get(), raw);
+
+  any large;
+  large.emplace<any_test::LargeMoveOnlyValue>();
+  any_cast<any_test::LargeMoveOnlyValue&>(large).ptr.reset(new int(2));
+  any large_moved = std::move(large);
+  EXPECT_EQ(*any_cast<any_test::LargeMoveOnlyValue&>(large_moved).ptr, 2);
+  EXPECT_THROW(any copied(large_moved), bad_any_copy);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,179 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_async_io.hpp"
+
+namespace cnstream {
+
+static std::string TempPath() {
+  char path[] = "/tmp/cnstream_async_io_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd >= 0) close(fd);
+  return path;
+}
+
+static std::vector<char> Pattern(size_t size) {
+  std::vector<char> data(size);
+  for (size_t i = 0; i < size; ++i) data[i] = static_cast<char>(i * 7 + i / 251);
+  return data;
+}
+
+static std::vector<char> ReadAll(const std::string& path) {
+  std::ifstream ifs(path, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+static void TestReader(IoRing* ring) {
+  const std::string path = TempPath();
+  const std::vector<char> data = Pattern(10000);
+  {
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(data.data(), data.size());
+  }
+  AsyncFileReader reader(ring, 1000, 3);
+  EXPECT_FALSE(reader.Open(path + ".not_exist"));
+  ASSERT_TRUE(reader.Open(path));
+  EXPECT_EQ(reader.Size(), 10000);
+
+  std::vector<char> buf(10000);
+  EXPECT_EQ(reader.Read(buf.data(), 2500), 2500);
+  EXPECT_EQ(reader.Read(buf.data() + 2500, 7600), 7500);
+  EXPECT_EQ(buf, data);
+  EXPECT_EQ(reader.Read(buf.data(), 100), 0);
+
+  // backwards, into the blocks read ahead and beyond them
+  for (int64_t offset : {5500, 5900, 6100, 100, 9999}) {
+    ASSERT_EQ(reader.Seek(offset), offset);
+    char c[2] = {0};
+    EXPECT_EQ(reader.Read(c, 2), offset < 9999 ? 2 : 1);
+    EXPECT_EQ(c[0], data[offset]);
+    EXPECT_EQ(reader.Tell(), std::min<int64_t>(offset + 2, 10000));
+  }
+  EXPECT_EQ(reader.Seek(-1), -EINVAL);
+  reader.Close();
+  EXPECT_EQ(reader.Read(buf.data(), 1), -EBADF);
+  remove(path.c_str());
+}
+
+static void TestWriter(IoRing* ring) {
+  const std::string path = TempPath();
+  const std::vector<char> data = Pattern(10000);
+  AsyncFileWriter writer(ring, 1000, 3);
+  ASSERT_TRUE(writer.Open(path));
+  for (size_t offset = 0; offset < data.size(); offset += 300) {
+    const size_t size = std::min<size_t>(300, data.size() - offset);
+    ASSERT_EQ(writer.Write(data.data() + offset, size), static_cast<int64_t>(size));
+  }
+  EXPECT_EQ(writer.Size(), 10000);
+  // rewrites a header, e.g. the moov atom of a fast start mp4
+  ASSERT_EQ(writer.Seek(10), 10);
+  EXPECT_EQ(writer.Write("abcd", 4), 4);
+  EXPECT_EQ(writer.Tell(), 14);
+  EXPECT_EQ(writer.Size(), 10000);
+  ASSERT_EQ(writer.Seek(writer.Size()), 10000);
+  EXPECT_EQ(writer.Write("xy", 2), 2);
+  EXPECT_EQ(writer.Close(), 0);
+
+  std::vector<char> expected = data;
+  std::copy_n("abcd", 4, expected.begin() + 10);
+  expected.push_back('x');
+  expected.push_back('y');
+  EXPECT_EQ(ReadAll(path), expected);
+  EXPECT_EQ(writer.Write("z", 1), -EBADF);
+  remove(path.c_str());
+}
+
+TEST(CoreAsyncIo, Reader) {
+  IoRing ring(8);
+  TestReader(&ring);
+}
+
+TEST(CoreAsyncIo, ReaderSync) {
+  IoRing ring(8, false);
+  EXPECT_FALSE(ring.IsAsync());
+  TestReader(&ring);
+}
+
+TEST(CoreAsyncIo, Writer) {
+  IoRing ring(8);
+  TestWriter(&ring);
+}
+
+TEST(CoreAsyncIo, WriterSync) {
+  IoRing ring(8, false);
+  TestWriter(&ring);
+}
+
+TEST(CoreAsyncIo, WriterOfCallerFd) {
+  const std::string path = TempPath();
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  ASSERT_EQ(fwrite("head", 1, 4, file), 4u);
+  fflush(file);
+  {
+    AsyncFileWriter writer(nullptr, 16, 2);
+    ASSERT_TRUE(writer.Open(fileno(file)));
+    EXPECT_EQ(writer.Tell(), 4);
+    EXPECT_EQ(writer.Write("0123456789abcdefghij", 20), 20);
+    EXPECT_EQ(writer.Size(), 24);
+    EXPECT_EQ(writer.Close(), 0);
+  }
+  // not closed by the writer
+  EXPECT_EQ(fclose(file), 0);
+  const std::vector<char> content = ReadAll(path);
+  EXPECT_EQ(std::string(content.begin(), content.end()), "head0123456789abcdefghij");
+  remove(path.c_str());
+}
+
+TEST(CoreAsyncIo, ManyRequests) {
+  IoRing ring(4);
+  const std::string path = TempPath();
+  const std::vector<char> data = Pattern(64 * 100);
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  std::atomic<int> done{0};
+  std::atomic<int> failed{0};
+  // more requests than the ring holds, the submissions wait for the completions
+  for (int i = 0; i < 100; ++i) {
+    ring.Write(fileno(file), data.data() + i * 64, 64, i * 64, [&](int64_t result) {
+      if (result != 64) ++failed;
+      ++done;
+    });
+  }
+  while (done.load() < 100) std::this_thread::yield();
+  EXPECT_EQ(failed.load(), 0);
+  EXPECT_EQ(fclose(file), 0);
+  EXPECT_EQ(ReadAll(path), data);
+  remove(path.c_str());
+}
+
+}  // namespace cnstream
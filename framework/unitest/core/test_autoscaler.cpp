@@ -0,0 +1,140 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_autoscaler.hpp"
+
+namespace cnstream {
+
+static AutoscaleSample MakeSample(const std::string& name, const std::vector<std::string>& next, uint32_t parallelism,
+                                  uint32_t min_parallelism, uint32_t max_parallelism, double fill_ratio) {
+  AutoscaleSample sample;
+  sample.module_name = name;
+  sample.next_modules = next;
+  sample.parallelism = parallelism;
+  sample.min_parallelism = min_parallelism;
+  sample.max_parallelism = max_parallelism;
+  sample.queue_fill_ratio = fill_ratio;
+  return sample;
+}
+
+TEST(CoreAutoscaler, ScaleUpBottleneck) {
+  AutoscalerConfig config;
+  config.stable_intervals = 2;
+  Autoscaler autoscaler(config);
+  AutoscaleDecision decision;
+  // modulea is blocked by moduleb, moduleb is the bottleneck
+  std::vector<AutoscaleSample> samples = {MakeSample("modulea", {"moduleb"}, 1, 1, 4, 1.0),
+                                          MakeSample("moduleb", {"modulec"}, 1, 1, 4, 0.9),
+                                          MakeSample("modulec", {}, 1, 1, 4, 0.2)};
+  ASSERT_TRUE(autoscaler.Decide(samples, &decision));
+  EXPECT_EQ(decision.module_name, "moduleb");
+  EXPECT_EQ(decision.old_parallelism, 1u);
+  EXPECT_EQ(decision.new_parallelism, 2u);
+  EXPECT_FALSE(decision.reason.empty());
+  // cooldown
+  samples[1].parallelism = 2;
+  EXPECT_FALSE(autoscaler.Decide(samples, &decision));
+  ASSERT_TRUE(autoscaler.Decide(samples, &decision));
+  EXPECT_EQ(decision.module_name, "moduleb");
+  EXPECT_EQ(decision.new_parallelism, 3u);
+  // the upper bound
+  samples[1].parallelism = 4;
+  for (int i = 0; i < 4; ++i) EXPECT_FALSE(autoscaler.Decide(samples, &decision));
+  // blocked upstream makes a module under pressure
+  samples = {MakeSample("modulea", {"moduleb"}, 1, 1, 4, 0.1), MakeSample("moduleb", {}, 1, 1, 4, 0.5)};
+  samples[1].blocking_upstream = true;
+  ASSERT_TRUE(autoscaler.Decide(samples, &decision));
+  EXPECT_EQ(decision.module_name, "moduleb");
+}
+
+TEST(CoreAutoscaler, PreferLargerLatency) {
+  Autoscaler autoscaler(AutoscalerConfig{});
+  std::vector<AutoscaleSample> samples = {MakeSample("modulea", {}, 1, 1, 4, 0.9),
+                                          MakeSample("moduleb", {}, 1, 1, 4, 1.0)};
+  samples[0].process_latency_ms = 20;
+  samples[1].process_latency_ms = 10;
+  AutoscaleDecision decision;
+  ASSERT_TRUE(autoscaler.Decide(samples, &decision));
+  EXPECT_EQ(decision.module_name, "modulea");
+}
+
+TEST(CoreAutoscaler, ScaleDownIdle) {
+  AutoscalerConfig config;
+  config.stable_intervals = 3;
+  Autoscaler autoscaler(config);
+  std::vector<AutoscaleSample> samples = {MakeSample("modulea", {}, 3, 2, 4, 0.0),
+                                          MakeSample("moduleb", {}, 1, 1, 4, 0.0)};
+  AutoscaleDecision decision;
+  EXPECT_FALSE(autoscaler.Decide(samples, &decision));
+  EXPECT_FALSE(autoscaler.Decide(samples, &decision));
+  ASSERT_TRUE(autoscaler.Decide(samples, &decision));
+  EXPECT_EQ(decision.module_name, "modulea");
+  EXPECT_EQ(decision.new_parallelism, 2u);
+  // the lower bound
+  samples[0].parallelism = 2;
+  for (int i = 0; i < 10; ++i) EXPECT_FALSE(autoscaler.Decide(samples, &decision));
+  // a busy sample resets the idle count
+  samples[0].parallelism = 3;
+  samples[0].queue_fill_ratio = 0.5;
+  EXPECT_FALSE(autoscaler.Decide(samples, &decision));
+  samples[0].queue_fill_ratio = 0;
+  EXPECT_FALSE(autoscaler.Decide(samples, &decision));
+  EXPECT_FALSE(autoscaler.Decide(samples, &decision));
+  EXPECT_TRUE(autoscaler.Decide(samples, &decision));
+}
+
+TEST(CoreAutoscaler, StartStop) {
+  AutoscalerConfig config;
+  config.interval_ms = 5;
+  config.stable_intervals = 0;
+  Autoscaler autoscaler(config);
+  EXPECT_FALSE(autoscaler.Start(nullptr, nullptr));
+  std::atomic<uint32_t> parallelism{1};
+  auto sample_func = [&] {
+    return std::vector<AutoscaleSample>{MakeSample("modulea", {}, parallelism.load(), 1, 3, 1.0)};
+  };
+  auto scale_func = [&](const std::string& name, uint32_t value) {
+    EXPECT_EQ(name, "modulea");
+    parallelism = value;
+    return true;
+  };
+  ASSERT_TRUE(autoscaler.Start(sample_func, scale_func));
+  EXPECT_TRUE(autoscaler.IsRunning());
+  for (int retry = 0; retry < 200 && parallelism.load() < 3; ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  autoscaler.Stop();
+  EXPECT_FALSE(autoscaler.IsRunning());
+  EXPECT_EQ(parallelism.load(), 3u);
+  auto decisions = autoscaler.GetDecisions();
+  ASSERT_EQ(decisions.size(), 2u);
+  EXPECT_EQ(decisions[0].new_parallelism, 2u);
+  EXPECT_EQ(decisions[1].new_parallelism, 3u);
+}
+
+}  // namespace cnstream
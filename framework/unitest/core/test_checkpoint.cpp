@@ -0,0 +1,109 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "cnstream_checkpoint.hpp"
+
+namespace cnstream {
+
+static std::string CheckpointPath(const std::string& name) {
+  return "/tmp/cnstream_test_" + name + "_" + std::to_string(getpid()) + ".txt";
+}
+
+TEST(CoreCheckpoint, RecordAndResume) {
+  const std::string path = CheckpointPath("checkpoint");
+  std::remove(path.c_str());
+  {
+    CheckpointStore store(path, 0);
+    EXPECT_TRUE(store.Load());  // no file yet
+    EXPECT_EQ(store.Resume("stream_0", "a.mp4"), -1);
+    // streams not resumed are not recorded
+    store.Record("stream_1", 100);
+    StreamCheckpoint checkpoint;
+    EXPECT_FALSE(store.Get("stream_1", &checkpoint));
+    store.Record("stream_0", 3000);
+    store.Record("stream_0", 6000);
+    ASSERT_TRUE(store.Get("stream_0", &checkpoint));
+    EXPECT_EQ(checkpoint.source, "a.mp4");
+    EXPECT_EQ(checkpoint.pts, 6000);
+  }
+  {
+    // restarted, saved by the latest record
+    CheckpointStore store(path, 0);
+    ASSERT_TRUE(store.Load());
+    EXPECT_EQ(store.Resume("stream_0", "a.mp4"), 6000);
+    // another file starts from the beginning
+    EXPECT_EQ(store.Resume("stream_0", "b.mp4"), -1);
+    store.Remove("stream_0");
+    EXPECT_TRUE(store.Save());
+  }
+  {
+    CheckpointStore store(path, 0);
+    ASSERT_TRUE(store.Load());
+    StreamCheckpoint checkpoint;
+    EXPECT_FALSE(store.Get("stream_0", &checkpoint));
+  }
+  std::remove(path.c_str());
+}
+
+TEST(CoreCheckpoint, SaveInterval) {
+  const std::string path = CheckpointPath("checkpoint_interval");
+  std::remove(path.c_str());
+  CheckpointStore store(path, 3600 * 1000);
+  store.Resume("stream_0", "a.mp4");
+  store.Record("stream_0", 3000);
+  {
+    CheckpointStore other(path, 0);
+    ASSERT_TRUE(other.Load());
+    StreamCheckpoint checkpoint;
+    EXPECT_FALSE(other.Get("stream_0", &checkpoint));  // not saved yet
+  }
+  EXPECT_TRUE(store.Save());
+  {
+    CheckpointStore other(path, 0);
+    ASSERT_TRUE(other.Load());
+    EXPECT_EQ(other.Resume("stream_0", "a.mp4"), 3000);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(CoreCheckpoint, Malformed) {
+  const std::string path = CheckpointPath("checkpoint_malformed");
+  {
+    std::ofstream ofs(path);
+    ofs << "stream_0\ta.mp4\tnot_a_pts\n";
+  }
+  CheckpointStore store(path, 0);
+  EXPECT_FALSE(store.Load());
+  {
+    std::ofstream ofs(path);
+    ofs << "stream_0 a.mp4 100\n";
+  }
+  EXPECT_FALSE(store.Load());
+  std::remove(path.c_str());
+}
+
+}  // namespace cnstream
@@ -19,8 +19,11 @@
  *************************************************************************/
 
 #include <gtest/gtest.h>
+#include <memory>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "cnstream_collection.hpp"
 
@@ -223,3 +226,76 @@ TEST(CoreCollection, TaggedIsOfType) {
 }
 #endif
 
+static const char test_slot_tag[] = "test_slot_tag";
+static const char test_unregistered_slot_tag[] = "test_unregistered_slot_tag";
+static constexpr cnstream::CollectionSlot<std::shared_ptr<collection_test::TestStructA>> test_slot(test_slot_tag, 7);
+static constexpr cnstream::CollectionSlot<collection_test::TestStructB> test_unregistered_slot(
+    test_unregistered_slot_tag, 6);
+static const bool test_slot_registered = cnstream::Collection::RegisterSlot(test_slot);
+
+TEST(CoreCollection, RegisterSlot) {
+  EXPECT_TRUE(test_slot_registered);
+  // register again
+  EXPECT_TRUE(cnstream::Collection::RegisterSlot(test_slot));
+  // slot used by another tag
+  EXPECT_FALSE(cnstream::Collection::RegisterSlot(
+      cnstream::CollectionSlot<int>(test_tag0, test_slot.index)));
+  // tag registered with another slot
+  EXPECT_FALSE(cnstream::Collection::RegisterSlot(cnstream::CollectionSlot<int>(test_slot_tag, 5)));
+  // index out of range
+  EXPECT_FALSE(cnstream::Collection::RegisterSlot(
+      cnstream::CollectionSlot<int>(test_tag1, cnstream::kCollectionSlotNum)));
+}
+
+TEST(CoreCollection, Slot) {
+  cnstream::Collection collection;
+  EXPECT_FALSE(collection.HasValue(test_slot));
+  auto value = std::make_shared<collection_test::TestStructA>(value_a);
+  EXPECT_EQ(collection.Add(test_slot, value), value);
+  EXPECT_TRUE(collection.HasValue(test_slot));
+  EXPECT_EQ(collection.Get(test_slot), value);
+  EXPECT_FALSE(collection.AddIfNotExists(test_slot, value));
+  EXPECT_DEATH(collection.Add(test_slot, value), "");
+
+  // a slot not registered is still usable by slot
+  EXPECT_FALSE(collection.HasValue(test_unregistered_slot));
+  EXPECT_TRUE(collection.AddIfNotExists(test_unregistered_slot, value_b));
+  EXPECT_EQ(collection.Get(test_unregistered_slot), value_b);
+  EXPECT_FALSE(collection.HasValue(test_unregistered_slot_tag));
+
+  cnstream::Collection empty_collection;
+  EXPECT_DEATH(empty_collection.Get(test_slot), "");
+}
+
+TEST(CoreCollection, StringTagOfRegisteredSlot) {
+  cnstream::Collection collection;
+  auto value = std::make_shared<collection_test::TestStructA>(value_a);
+  // string tag interfaces go to the slot
+  collection.Add(test_slot_tag, value);
+  EXPECT_TRUE(collection.HasValue(test_slot));
+  EXPECT_EQ(collection.Get(test_slot), value);
+  EXPECT_EQ(collection.Get<std::shared_ptr<collection_test::TestStructA>>(test_slot_tag), value);
+  EXPECT_TRUE(collection.HasValue(test_slot_tag));
+  EXPECT_FALSE(collection.AddIfNotExists(test_slot_tag, value));
+#if !defined(_LIBCPP_NO_RTTI)
+  EXPECT_TRUE(collection.TaggedIsOfType<std::shared_ptr<collection_test::TestStructA>>(test_slot_tag));
+  // wrong type
+  EXPECT_DEATH(collection.Get<collection_test::TestStructA>(test_slot_tag), "");
+#endif
+}
+
+TEST(CoreCollection, SlotGetFromThreads) {
+  cnstream::Collection collection;
+  auto value = std::make_shared<collection_test::TestStructA>(value_a);
+  std::vector<std::thread> threads;
+  std::atomic<int> got{0};
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      while (!collection.HasValue(test_slot)) std::this_thread::yield();
+      if (collection.Get(test_slot) == value) got++;
+    });
+  }
+  collection.Add(test_slot, value);
+  for (auto& it : threads) it.join();
+  EXPECT_EQ(got.load(), 4);
+}
@@ -22,6 +22,7 @@
 #include <stdio.h>
 
 #include <fstream>
+#include <set>
 #include <string>
 
 #include "cnstream_config.hpp"
@@ -51,7 +52,9 @@ TEST(CoreConfig, ProfilerConfig) {
   std::string wrong_jstr2 = "{ \"enable_profiling\": true, \"enable_tracing\": \"ss\", \"trace_event_capacity\": 1}";
   std::string wrong_jstr3 = "{ \"enable_profiling\": true, \"enable_tracing\": true, \"trace_event_capacity\": \"f\"}";
   std::string wrong_jstr4 = "{ \"enable_profiling\": true, \"abc\": true}";
+  std::string wrong_jstr5 = "{ \"enable_profiling\": true, \"enable_latency_breakdown\": 1}";
   EXPECT_FALSE(config.ParseByJSONStr(wrong_jstr0));
+  EXPECT_FALSE(config.ParseByJSONStr(wrong_jstr5));
   EXPECT_FALSE(config.ParseByJSONStr(wrong_jstr1));
   EXPECT_FALSE(config.ParseByJSONStr(wrong_jstr2));
   EXPECT_FALSE(config.ParseByJSONStr(wrong_jstr3));
@@ -61,6 +64,31 @@ TEST(CoreConfig, ProfilerConfig) {
   EXPECT_TRUE(config.enable_profiling);
   EXPECT_TRUE(config.enable_tracing);
   EXPECT_EQ(1, config.trace_event_capacity);
+  EXPECT_FALSE(config.enable_latency_breakdown);
+  EXPECT_TRUE(config.ParseByJSONStr("{ \"enable_profiling\": true, \"enable_latency_breakdown\": true}"));
+  EXPECT_TRUE(config.enable_latency_breakdown);
+  EXPECT_FALSE(config.enable_perf_counters);
+  EXPECT_FALSE(config.ParseByJSONStr("{ \"enable_perf_counters\": 1}"));
+  EXPECT_TRUE(config.ParseByJSONStr("{ \"enable_profiling\": true, \"enable_perf_counters\": true}"));
+  EXPECT_TRUE(config.enable_perf_counters);
+  EXPECT_FALSE(config.ParseByJSONStr("{ \"enable_tracing\": true, \"trace_event_capacity\": 0}"));
+  EXPECT_TRUE(config.trace_file.empty());
+  EXPECT_FALSE(config.ParseByJSONStr("{ \"enable_tracing\": true, \"trace_file\": 1}"));
+  EXPECT_TRUE(config.ParseByJSONStr("{ \"enable_tracing\": true, \"trace_file\": \"pipeline.cntrace\"}"));
+  EXPECT_EQ("pipeline.cntrace", config.trace_file);
+  EXPECT_EQ(1u, config.trace_sample_interval);
+  EXPECT_FALSE(config.ParseByJSONStr("{ \"trace_sample_interval\": -1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{ \"trace_streams\": \"stream0\"}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{ \"trace_streams\": [0]}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{ \"trace_latency_threshold\": -1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{ \"trace_burst_duration\": 0}"));
+  EXPECT_TRUE(config.ParseByJSONStr("{ \"trace_sample_interval\": 100, \"trace_streams\": [\"stream0\"], "
+                                    "\"trace_latency_threshold\": 50, \"trace_burst_duration\": 2000.5}"));
+  EXPECT_EQ(100u, config.trace_sample_interval);
+  ASSERT_EQ(1u, config.trace_streams.size());
+  EXPECT_EQ("stream0", config.trace_streams[0]);
+  EXPECT_DOUBLE_EQ(50, config.trace_latency_threshold);
+  EXPECT_DOUBLE_EQ(2000.5, config.trace_burst_duration);
 }
 
 TEST(CoreConfig, CNModuleConfig) {
@@ -106,6 +134,7 @@ TEST(CoreConfig, CNModuleConfig) {
   EXPECT_EQ(config.className, "test_class_name");
   EXPECT_EQ(config.parallelism, 15);
   EXPECT_EQ(config.maxInputQueueSize, 30);
+  EXPECT_EQ(config.queueType, InputQueueType::MUTEX);
   EXPECT_EQ(config.next.size(), 2);
   EXPECT_NE(config.next.find("next_module1"), config.next.end());
   EXPECT_NE(config.next.find("next_module2"), config.next.end());
@@ -113,6 +142,416 @@ TEST(CoreConfig, CNModuleConfig) {
   EXPECT_EQ(config.parameters["param1"], "20");
   EXPECT_EQ(config.parameters["param2"], "param2_value");
   EXPECT_EQ(config.config_root_dir, config.parameters[CNS_JSON_DIR_PARAM_NAME]);
+  // case10: queue_type
+  jstr = "{\"class_name\" : \"test_class_name\", \"queue_type\" : \"lock_free\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.queueType, InputQueueType::LOCK_FREE);
+  jstr = "{\"class_name\" : \"test_class_name\", \"queue_type\" : \"unknown\"}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  jstr = "{\"class_name\" : \"test_class_name\", \"queue_type\" : 1}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  // case11: queue_full_policy
+  jstr = "{\"class_name\" : \"test_class_name\", \"queue_full_policy\" : \"drop_oldest\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.queueFullPolicy, QueueFullPolicy::DROP_OLDEST);
+  jstr = "{\"class_name\" : \"test_class_name\", \"queue_full_policy\" : \"drop_newest\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.queueFullPolicy, QueueFullPolicy::DROP_NEWEST);
+  jstr = "{\"class_name\" : \"test_class_name\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.queueFullPolicy, QueueFullPolicy::BLOCK);
+  jstr = "{\"class_name\" : \"test_class_name\", \"queue_full_policy\" : \"drop\"}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  // case12: rebalance_streams
+  jstr = "{\"class_name\" : \"test_class_name\", \"rebalance_streams\" : true}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_TRUE(config.rebalanceStreams);
+  jstr = "{\"class_name\" : \"test_class_name\", \"rebalance_streams\" : 1}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  // stream_parallel and ordered_output
+  jstr = "{\"class_name\" : \"test_class_name\", \"stream_parallel\" : true, \"ordered_output\" : false}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_TRUE(config.streamParallel);
+  EXPECT_FALSE(config.orderedOutput);
+  jstr = "{\"class_name\" : \"test_class_name\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_FALSE(config.streamParallel);
+  EXPECT_TRUE(config.orderedOutput);
+  jstr = "{\"class_name\" : \"test_class_name\", \"ordered_output\" : 1}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  // case13: max_batch_size and batch_timeout_us
+  jstr = "{\"class_name\" : \"test_class_name\", \"max_batch_size\" : 8, \"batch_timeout_us\" : 2000}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.maxBatchSize, 8u);
+  EXPECT_EQ(config.batchTimeoutUs, 2000u);
+  jstr = "{\"class_name\" : \"test_class_name\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.maxBatchSize, 1u);
+  EXPECT_EQ(config.batchTimeoutUs, 0u);
+  jstr = "{\"class_name\" : \"test_class_name\", \"max_batch_size\" : 0}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  jstr = "{\"class_name\" : \"test_class_name\", \"batch_timeout_us\" : -1}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  // case14: cpu_affinity and numa_node
+  jstr = "{\"class_name\" : \"test_class_name\", \"cpu_affinity\" : \"0-2,5\", \"numa_node\" : 1}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.cpuAffinity, std::vector<int>({0, 1, 2, 5}));
+  EXPECT_EQ(config.numaNode, 1);
+  jstr = "{\"class_name\" : \"test_class_name\", \"cpu_affinity\" : [3, 1]}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.cpuAffinity, std::vector<int>({3, 1}));
+  EXPECT_EQ(config.numaNode, -1);
+  jstr = "{\"class_name\" : \"test_class_name\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_TRUE(config.cpuAffinity.empty());
+  jstr = "{\"class_name\" : \"test_class_name\", \"cpu_affinity\" : \"1-\"}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  jstr = "{\"class_name\" : \"test_class_name\", \"cpu_affinity\" : [-1]}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  jstr = "{\"class_name\" : \"test_class_name\", \"numa_node\" : -2}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  // case15: min_parallelism and max_parallelism
+  jstr = "{\"class_name\" : \"test_class_name\", \"min_parallelism\" : 1, \"max_parallelism\" : 4}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.minParallelism, 1);
+  EXPECT_EQ(config.maxParallelism, 4);
+  jstr = "{\"class_name\" : \"test_class_name\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.minParallelism, 0);
+  EXPECT_EQ(config.maxParallelism, 0);
+  jstr = "{\"class_name\" : \"test_class_name\", \"max_parallelism\" : -1}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  // case16: open_after
+  jstr = "{\"class_name\" : \"test_class_name\", \"open_after\" : [\"module1\", \"module2\"]}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.openAfter, std::set<std::string>({"module1", "module2"}));
+  jstr = "{\"class_name\" : \"test_class_name\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_TRUE(config.openAfter.empty());
+  jstr = "{\"class_name\" : \"test_class_name\", \"open_after\" : \"module1\"}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  jstr = "{\"class_name\" : \"test_class_name\", \"open_after\" : [1]}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  // case17: fuse
+  jstr = "{\"class_name\" : \"test_class_name\", \"fuse\" : \"always\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.fusePolicy, FusePolicy::ALWAYS);
+  jstr = "{\"class_name\" : \"test_class_name\", \"fuse\" : \"never\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.fusePolicy, FusePolicy::NEVER);
+  jstr = "{\"class_name\" : \"test_class_name\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_EQ(config.fusePolicy, FusePolicy::AUTO);
+  jstr = "{\"class_name\" : \"test_class_name\", \"fuse\" : true}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  jstr = "{\"class_name\" : \"test_class_name\", \"fuse\" : \"sometimes\"}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  // case18: circuit_breaker
+  jstr = "{\"class_name\" : \"test_class_name\", \"circuit_breaker\" : {\"enable\" : true, "
+         "\"failure_threshold\" : 3, \"max_latency_ms\" : 100, \"open_ms\" : 1000}}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_TRUE(config.circuitBreaker.enable);
+  EXPECT_EQ(config.circuitBreaker.failure_threshold, 3u);
+  EXPECT_EQ(config.circuitBreaker.max_latency_ms, 100u);
+  EXPECT_EQ(config.circuitBreaker.open_ms, 1000u);
+  jstr = "{\"class_name\" : \"test_class_name\"}";
+  EXPECT_TRUE(config.ParseByJSONStr(jstr));
+  EXPECT_FALSE(config.circuitBreaker.enable);
+  EXPECT_EQ(config.circuitBreaker.failure_threshold, 5u);
+  jstr = "{\"class_name\" : \"test_class_name\", \"circuit_breaker\" : true}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  jstr = "{\"class_name\" : \"test_class_name\", \"circuit_breaker\" : {\"failure_threshold\" : 0}}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  jstr = "{\"class_name\" : \"test_class_name\", \"circuit_breaker\" : {\"open_ms\" : 0}}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+  jstr = "{\"class_name\" : \"test_class_name\", \"circuit_breaker\" : {\"unknown\" : 1}}";
+  EXPECT_FALSE(config.ParseByJSONStr(jstr));
+}
+
+TEST(CoreConfig, SchedulerConfig) {
+  SchedulerConfig config;
+  EXPECT_FALSE(config.work_stealing);
+  EXPECT_EQ(config.thread_num, 0u);
+  // case1: wrong json format
+  EXPECT_FALSE(config.ParseByJSONStr("{,}"));
+  // case2: wrong type
+  EXPECT_FALSE(config.ParseByJSONStr("{\"work_stealing\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"thread_num\" : -1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"parallel_open\" : 1}"));
+  // case3: unknown parameter
+  EXPECT_FALSE(config.ParseByJSONStr("{\"unknown\" : 1}"));
+  // case4: success
+  EXPECT_TRUE(config.ParseByJSONStr("{\"work_stealing\" : true, \"thread_num\" : 8}"));
+  EXPECT_TRUE(config.work_stealing);
+  EXPECT_EQ(config.thread_num, 8u);
+  EXPECT_FALSE(config.parallel_open);
+  EXPECT_TRUE(config.ParseByJSONStr("{\"parallel_open\" : true}"));
+  EXPECT_TRUE(config.parallel_open);
+}
+
+TEST(CoreConfig, FramePoolConfig) {
+  FramePoolConfig config;
+  EXPECT_FALSE(config.enable);
+  EXPECT_EQ(config.capacity, 256u);
+  EXPECT_EQ(config.max_frames, 0u);
+  // case1: wrong json format
+  EXPECT_FALSE(config.ParseByJSONStr("{,}"));
+  // case2: wrong type
+  EXPECT_FALSE(config.ParseByJSONStr("{\"enable\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"capacity\" : -1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"max_frames\" : \"8\"}"));
+  // case3: unknown parameter
+  EXPECT_FALSE(config.ParseByJSONStr("{\"unknown\" : 1}"));
+  // case4: success
+  EXPECT_TRUE(config.ParseByJSONStr("{\"enable\" : true, \"capacity\" : 16}"));
+  EXPECT_TRUE(config.enable);
+  EXPECT_EQ(config.capacity, 16u);
+  EXPECT_TRUE(config.ParseByJSONStr("{\"max_frames\" : 32}"));
+  EXPECT_EQ(config.max_frames, 32u);
+  // case5: graph config
+  CNGraphConfig graph_config;
+  EXPECT_TRUE(graph_config.ParseByJSONStr("{\"frame_pool_config\" : {\"enable\" : true}}"));
+  EXPECT_TRUE(graph_config.frame_pool_config.enable);
+  EXPECT_FALSE(graph_config.ParseByJSONStr("{\"frame_pool_config\" : {\"enable\" : \"true\"}}"));
+}
+
+TEST(CoreConfig, AutoscalerConfig) {
+  AutoscalerConfig config;
+  EXPECT_FALSE(config.enable);
+  EXPECT_EQ(config.interval_ms, 1000u);
+  // case1: wrong json format
+  EXPECT_FALSE(config.ParseByJSONStr("{,}"));
+  // case2: wrong type or value
+  EXPECT_FALSE(config.ParseByJSONStr("{\"enable\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"interval_ms\" : 0}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"high_watermark\" : 1.5}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"low_watermark\" : -0.1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"stable_intervals\" : -1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"high_watermark\" : 0.5, \"low_watermark\" : 0.6}"));
+  // case3: unknown parameter
+  EXPECT_FALSE(config.ParseByJSONStr("{\"unknown\" : 1}"));
+  // case4: success
+  config = AutoscalerConfig();
+  EXPECT_TRUE(config.ParseByJSONStr("{\"enable\" : true, \"interval_ms\" : 100, \"high_watermark\" : 0.9,"
+                                    "\"low_watermark\" : 0, \"stable_intervals\" : 2}"));
+  EXPECT_TRUE(config.enable);
+  EXPECT_EQ(config.interval_ms, 100u);
+  EXPECT_DOUBLE_EQ(config.high_watermark, 0.9);
+  EXPECT_DOUBLE_EQ(config.low_watermark, 0);
+  EXPECT_EQ(config.stable_intervals, 2u);
+  // case5: graph config
+  CNGraphConfig graph_config;
+  EXPECT_TRUE(graph_config.ParseByJSONStr("{\"autoscaler_config\" : {\"enable\" : true}}"));
+  EXPECT_TRUE(graph_config.autoscaler_config.enable);
+  EXPECT_FALSE(graph_config.ParseByJSONStr("{\"autoscaler_config\" : {\"enable\" : \"true\"}}"));
+}
+
+TEST(CoreConfig, MemoryBudgetConfig) {
+  MemoryBudgetConfig config;
+  EXPECT_FALSE(config.enable);
+  EXPECT_EQ(config.host_mb, 0u);
+  EXPECT_EQ(config.max_wait_ms, 1000u);
+  // case1: wrong json format
+  EXPECT_FALSE(config.ParseByJSONStr("{,}"));
+  // case2: wrong type
+  EXPECT_FALSE(config.ParseByJSONStr("{\"enable\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"device_mb\" : -1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"stream_host_mb\" : \"256\"}"));
+  // case3: unknown parameter
+  EXPECT_FALSE(config.ParseByJSONStr("{\"unknown\" : 1}"));
+  // case4: success
+  config = MemoryBudgetConfig();
+  EXPECT_TRUE(config.ParseByJSONStr("{\"enable\" : true, \"host_mb\" : 1024, \"device_mb\" : 2048,"
+                                    "\"stream_host_mb\" : 64, \"stream_device_mb\" : 128, \"max_wait_ms\" : 10}"));
+  EXPECT_TRUE(config.enable);
+  EXPECT_EQ(config.host_mb, 1024u);
+  EXPECT_EQ(config.device_mb, 2048u);
+  EXPECT_EQ(config.stream_host_mb, 64u);
+  EXPECT_EQ(config.stream_device_mb, 128u);
+  EXPECT_EQ(config.max_wait_ms, 10u);
+  // case5: graph config
+  CNGraphConfig graph_config;
+  EXPECT_TRUE(graph_config.ParseByJSONStr("{\"memory_budget_config\" : {\"enable\" : true}}"));
+  EXPECT_TRUE(graph_config.memory_budget_config.enable);
+  EXPECT_FALSE(graph_config.ParseByJSONStr("{\"memory_budget_config\" : {\"enable\" : \"true\"}}"));
+}
+
+TEST(CoreConfig, MetricsConfig) {
+  MetricsConfig config;
+  EXPECT_FALSE(config.enable);
+  EXPECT_EQ(config.port, 9464u);
+  EXPECT_EQ(config.path, "/metrics");
+  // case1: wrong json format
+  EXPECT_FALSE(config.ParseByJSONStr("{,}"));
+  // case2: wrong type or value
+  EXPECT_FALSE(config.ParseByJSONStr("{\"enable\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"port\" : 65536}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"port\" : -1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"path\" : \"metrics\"}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"path\" : 1}"));
+  // case3: unknown parameter
+  EXPECT_FALSE(config.ParseByJSONStr("{\"unknown\" : 1}"));
+  // case4: success
+  config = MetricsConfig();
+  EXPECT_TRUE(config.ParseByJSONStr("{\"enable\" : true, \"port\" : 0, \"path\" : \"/cnstream\"}"));
+  EXPECT_TRUE(config.enable);
+  EXPECT_EQ(config.port, 0u);
+  EXPECT_EQ(config.path, "/cnstream");
+  // case5: graph config
+  CNGraphConfig graph_config;
+  EXPECT_TRUE(graph_config.ParseByJSONStr("{\"metrics_config\" : {\"enable\" : true}}"));
+  EXPECT_TRUE(graph_config.metrics_config.enable);
+  EXPECT_FALSE(graph_config.ParseByJSONStr("{\"metrics_config\" : {\"port\" : \"9464\"}}"));
+}
+
+TEST(CoreConfig, AdmissionConfig) {
+  AdmissionConfig config;
+  EXPECT_FALSE(config.enable);
+  EXPECT_EQ(config.interval_ms, 1000u);
+  // case1: wrong json format
+  EXPECT_FALSE(config.ParseByJSONStr("{,}"));
+  // case2: wrong type or value
+  EXPECT_FALSE(config.ParseByJSONStr("{\"enable\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"interval_ms\" : 0}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"high_watermark\" : 1.5}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"decrease_ratio\" : 0}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"increase_ratio\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"min_fps\" : -1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"burst_ms\" : -1}"));
+  // case3: unknown parameter
+  EXPECT_FALSE(config.ParseByJSONStr("{\"unknown\" : 1}"));
+  // case4: success
+  config = AdmissionConfig();
+  EXPECT_TRUE(config.ParseByJSONStr("{\"enable\" : true, \"interval_ms\" : 500, \"high_watermark\" : 0.5,"
+                                    "\"decrease_ratio\" : 0.8, \"increase_ratio\" : 1.1, \"min_fps\" : 2,"
+                                    "\"burst_ms\" : 100}"));
+  EXPECT_TRUE(config.enable);
+  EXPECT_EQ(config.interval_ms, 500u);
+  EXPECT_DOUBLE_EQ(config.high_watermark, 0.5);
+  EXPECT_DOUBLE_EQ(config.decrease_ratio, 0.8);
+  EXPECT_DOUBLE_EQ(config.increase_ratio, 1.1);
+  EXPECT_DOUBLE_EQ(config.min_fps, 2);
+  EXPECT_EQ(config.burst_ms, 100u);
+  // case5: graph config
+  CNGraphConfig graph_config;
+  EXPECT_TRUE(graph_config.ParseByJSONStr("{\"admission_config\" : {\"enable\" : true}}"));
+  EXPECT_TRUE(graph_config.admission_config.enable);
+  EXPECT_FALSE(graph_config.ParseByJSONStr("{\"admission_config\" : {\"min_fps\" : \"1\"}}"));
+}
+
+TEST(CoreConfig, DegradationConfig) {
+  DegradationConfig config;
+  EXPECT_FALSE(config.enable);
+  EXPECT_TRUE(config.steps.empty());
+  // case1: wrong json format
+  EXPECT_FALSE(config.ParseByJSONStr("{,}"));
+  // case2: wrong type or value
+  EXPECT_FALSE(config.ParseByJSONStr("{\"enable\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"interval_ms\" : 0}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"high_watermark\" : 1.5}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"high_watermark\" : 0.5, \"low_watermark\" : 0.6}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"escalate_samples\" : 0}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"steps\" : {}}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"steps\" : [{\"action\" : \"drop\", \"modules\" : [\"a\"]}]}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"steps\" : [{\"action\" : \"bypass\"}]}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"steps\" : [{\"action\" : \"skip_frames\", \"modules\" : [\"a\"],"
+                                     "\"interval\" : 1}]}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"steps\" : [{\"action\" : \"scale_output\", \"modules\" : [\"a\"],"
+                                     "\"scale\" : 1}]}"));
+  // case3: unknown parameter
+  EXPECT_FALSE(config.ParseByJSONStr("{\"unknown\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"steps\" : [{\"action\" : \"bypass\", \"modules\" : [\"a\"],"
+                                     "\"unknown\" : 1}]}"));
+  // case4: success
+  config = DegradationConfig();
+  EXPECT_TRUE(config.ParseByJSONStr("{\"enable\" : true, \"interval_ms\" : 500, \"high_watermark\" : 0.7,"
+                                    "\"low_watermark\" : 0.2, \"escalate_samples\" : 2, \"recover_samples\" : 4,"
+                                    "\"steps\" : [{\"action\" : \"skip_frames\", \"modules\" : [\"detector\"],"
+                                    "\"interval\" : 3, \"max_priority\" : 1},"
+                                    "{\"action\" : \"bypass\", \"modules\" : [\"classifier\", \"tracker\"]},"
+                                    "{\"action\" : \"scale_output\", \"modules\" : [\"source\"], \"scale\" : 0.25}]}"));
+  EXPECT_TRUE(config.enable);
+  EXPECT_EQ(config.interval_ms, 500u);
+  EXPECT_DOUBLE_EQ(config.high_watermark, 0.7);
+  EXPECT_DOUBLE_EQ(config.low_watermark, 0.2);
+  EXPECT_EQ(config.escalate_samples, 2u);
+  EXPECT_EQ(config.recover_samples, 4u);
+  ASSERT_EQ(config.steps.size(), 3u);
+  EXPECT_EQ(config.steps[0].action, DegradationAction::SKIP_FRAMES);
+  EXPECT_EQ(config.steps[0].interval, 3u);
+  EXPECT_EQ(config.steps[0].max_priority, 1);
+  EXPECT_EQ(config.steps[1].action, DegradationAction::BYPASS);
+  EXPECT_EQ(config.steps[1].modules, std::vector<std::string>({"classifier", "tracker"}));
+  EXPECT_EQ(config.steps[2].action, DegradationAction::SCALE_OUTPUT);
+  EXPECT_DOUBLE_EQ(config.steps[2].scale, 0.25);
+  // case5: graph config
+  CNGraphConfig graph_config;
+  EXPECT_TRUE(graph_config.ParseByJSONStr("{\"degradation_config\" : {\"enable\" : true}}"));
+  EXPECT_TRUE(graph_config.degradation_config.enable);
+  EXPECT_FALSE(graph_config.ParseByJSONStr("{\"degradation_config\" : {\"steps\" : 1}}"));
+}
+
+TEST(CoreConfig, CpuIsolationConfig) {
+  CpuIsolationConfig config;
+  EXPECT_FALSE(config.enable);
+  EXPECT_EQ(config.nice, 0);
+  EXPECT_TRUE(config.cgroup.empty());
+  EXPECT_EQ(config.cpu_weight, 0u);
+  // case1: wrong json format
+  EXPECT_FALSE(config.ParseByJSONStr("{,}"));
+  // case2: wrong type or value
+  EXPECT_FALSE(config.ParseByJSONStr("{\"enable\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"nice\" : 20}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"nice\" : -21}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"cgroup\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"cgroup\" : \"/sys/fs/cgroup/a\", \"cpu_weight\" : 10001}"));
+  // case3: the weight of no cgroup
+  config = CpuIsolationConfig();
+  EXPECT_FALSE(config.ParseByJSONStr("{\"cpu_weight\" : 100}"));
+  // case4: unknown parameter
+  EXPECT_FALSE(config.ParseByJSONStr("{\"weight\" : 100}"));
+  // case5: success
+  config = CpuIsolationConfig();
+  EXPECT_TRUE(config.ParseByJSONStr("{\"enable\" : true, \"nice\" : -5, \"cgroup\" : \"/sys/fs/cgroup/a\","
+                                    "\"cpu_weight\" : 50}"));
+  EXPECT_TRUE(config.enable);
+  EXPECT_EQ(config.nice, -5);
+  EXPECT_EQ(config.cgroup, "/sys/fs/cgroup/a");
+  EXPECT_EQ(config.cpu_weight, 50u);
+  // case6: graph config
+  CNGraphConfig graph_config;
+  EXPECT_TRUE(graph_config.ParseByJSONStr("{\"cpu_isolation_config\" : {\"enable\" : true, \"nice\" : 3}}"));
+  EXPECT_TRUE(graph_config.cpu_isolation_config.enable);
+  EXPECT_EQ(graph_config.cpu_isolation_config.nice, 3);
+  EXPECT_FALSE(graph_config.ParseByJSONStr("{\"cpu_isolation_config\" : {\"nice\" : \"3\"}}"));
+}
+
+TEST(CoreConfig, CheckpointConfig) {
+  CheckpointConfig config;
+  EXPECT_FALSE(config.enable);
+  EXPECT_EQ(config.save_interval_ms, 1000u);
+  // case1: wrong json format
+  EXPECT_FALSE(config.ParseByJSONStr("{,}"));
+  // case2: wrong type or value
+  EXPECT_FALSE(config.ParseByJSONStr("{\"enable\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"path\" : 1}"));
+  EXPECT_FALSE(config.ParseByJSONStr("{\"save_interval_ms\" : -1}"));
+  // case3: unknown parameter
+  EXPECT_FALSE(config.ParseByJSONStr("{\"unknown\" : 1}"));
+  // case4: enabled without path
+  config = CheckpointConfig();
+  EXPECT_FALSE(config.ParseByJSONStr("{\"enable\" : true}"));
+  // case5: success
+  config = CheckpointConfig();
+  EXPECT_TRUE(config.ParseByJSONStr("{\"enable\" : true, \"path\" : \"checkpoints.txt\", \"save_interval_ms\" : 0}"));
+  EXPECT_TRUE(config.enable);
+  EXPECT_EQ(config.path, "checkpoints.txt");
+  EXPECT_EQ(config.save_interval_ms, 0u);
+  // case6: graph config
+  CNGraphConfig graph_config;
+  EXPECT_TRUE(graph_config.ParseByJSONStr("{\"checkpoint_config\" : {\"enable\" : true, \"path\" : \"a.txt\"}}"));
+  EXPECT_TRUE(graph_config.checkpoint_config.enable);
+  EXPECT_FALSE(graph_config.ParseByJSONStr("{\"checkpoint_config\" : {\"path\" : 1}}"));
 }
 
 TEST(CoreConfig, CNSubgraphConfig) {
@@ -19,8 +19,10 @@
  *************************************************************************/
 
 #include <gtest/gtest.h>
+#include <chrono>
 #include <ctime>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include "cnstream_frame.hpp"
@@ -57,6 +59,47 @@ TEST(CoreConnector, PushPopDataBuffer) {
   EXPECT_EQ(data.get(), out_data.get());
 }
 
+TEST(CoreConnector, PushEosToConveyor) {
+  Connector connector(2, 2);
+  CNFrameInfoPtr data1 = CNFrameInfo::Create("stream_id_0");
+  CNFrameInfoPtr data2 = CNFrameInfo::Create("stream_id_0");
+  CNFrameInfoPtr data3 = CNFrameInfo::Create("stream_id_1");
+  CNFrameInfoPtr eos = CNFrameInfo::Create("stream_id_0", true);
+  EXPECT_TRUE(connector.PushDataBufferToConveyor(0, data1));
+  EXPECT_TRUE(connector.PushDataBufferToConveyor(0, data3));
+  EXPECT_TRUE(connector.PushDataBufferToConveyor(1, data2));
+  // the data of the stream in all conveyors is dropped
+  std::vector<CNFrameInfoPtr> dropped;
+  EXPECT_TRUE(connector.PushEosToConveyor(0, eos, &dropped));
+  EXPECT_EQ(dropped.size(), 2u);
+  EXPECT_TRUE(connector.IsConveyorEmpty(1));
+  EXPECT_EQ(connector.PopDataBufferFromConveyor(0), eos);
+  EXPECT_EQ(connector.PopDataBufferFromConveyor(0), data3);
+
+  Connector lock_free_connector(1, 2, InputQueueType::LOCK_FREE);
+  EXPECT_TRUE(lock_free_connector.PushDataBufferToConveyor(0, data1));
+  dropped.clear();
+  EXPECT_FALSE(lock_free_connector.PushEosToConveyor(0, eos, &dropped));
+  EXPECT_TRUE(dropped.empty());
+  EXPECT_EQ(lock_free_connector.GetConveyorSize(0), 1u);
+}
+
+TEST(CoreConnector, LockFreeConveyor) {
+  size_t conveyor_count = 2;
+  size_t conveyor_capacity = 2;
+  Connector connector(conveyor_count, conveyor_capacity, InputQueueType::LOCK_FREE);
+  CNFrameInfoPtr data = CNFrameInfo::Create("stream_id_0");
+  EXPECT_TRUE(connector.PushDataBufferToConveyor(1, data));
+  EXPECT_TRUE(connector.PushDataBufferToConveyor(1, data));
+  EXPECT_TRUE(connector.IsConveyorFull(1));
+  EXPECT_FALSE(connector.PushDataBufferToConveyor(1, data));
+  EXPECT_EQ(connector.GetFailTime(1), 1u);
+  EXPECT_TRUE(connector.IsConveyorEmpty(0));
+  EXPECT_EQ(data.get(), connector.PopDataBufferFromConveyor(1).get());
+  connector.EmptyDataQueue();
+  EXPECT_TRUE(connector.IsConveyorEmpty(1));
+}
+
 TEST(CoreConnector, StartStop) {
   size_t conveyor_count = 10;
   Connector connector(conveyor_count);
@@ -66,6 +109,136 @@ TEST(CoreConnector, StartStop) {
   EXPECT_TRUE(connector.IsStopped());
 }
 
+TEST(CoreConnector, StopWakesConsumers) {
+  for (InputQueueType queue_type : {InputQueueType::MUTEX, InputQueueType::LOCK_FREE}) {
+    Connector connector(2, 2, queue_type);
+    connector.Start();
+    std::vector<std::thread> consumers;
+    for (int conveyor_idx = 0; conveyor_idx < 2; ++conveyor_idx) {
+      consumers.emplace_back([&, conveyor_idx] {
+        EXPECT_EQ(connector.PopDataBufferFromConveyor(conveyor_idx), nullptr);
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    connector.Stop();
+    for (auto& it : consumers) it.join();
+  }
+}
+
+TEST(CoreConnector, StreamRebalance) {
+  Connector connector(3, 20);
+  // case1: rebalance disabled
+  EXPECT_FALSE(connector.IsStreamRebalanceEnabled());
+  EXPECT_EQ(connector.AcquireConveyor(4), 1);
+  connector.EnableStreamRebalance(true);
+  EXPECT_TRUE(connector.IsStreamRebalanceEnabled());
+  // case2: new streams are spread over conveyors
+  std::vector<int> stream_nums(3, 0);
+  for (uint32_t stream_idx = 0; stream_idx < 6; ++stream_idx) {
+    bool remapped = false;
+    int conveyor_idx = connector.AcquireConveyor(stream_idx, &remapped);
+    EXPECT_TRUE(remapped);
+    EXPECT_EQ(conveyor_idx, connector.GetStreamConveyorIdx(stream_idx));
+    stream_nums[conveyor_idx]++;
+    connector.ReleaseConveyor(stream_idx, false);
+  }
+  for (auto num : stream_nums) EXPECT_EQ(num, 2);
+  // case3: eos unmaps the stream
+  connector.AcquireConveyor(5);
+  connector.ReleaseConveyor(5, true);
+  EXPECT_EQ(connector.GetStreamConveyorIdx(5), -1);
+}
+
+TEST(CoreConnector, StreamMigration) {
+  Connector connector(2, 20);
+  connector.EnableStreamRebalance(true);
+  EXPECT_EQ(connector.AcquireConveyor(0), 0);
+  EXPECT_EQ(connector.AcquireConveyor(1), 1);
+  EXPECT_EQ(connector.AcquireConveyor(2), 0);
+  // stream 2 fills conveyor 0
+  for (int i = 0; i < 10; ++i) {
+    CNFrameInfoPtr data = CNFrameInfo::Create("stream_id_2");
+    data->SetStreamIndex(2);
+    if (i) connector.AcquireConveyor(2);
+    EXPECT_TRUE(connector.PushDataBufferToConveyor(0, data));
+  }
+  // stream 0 has no data in conveyors, it will be moved to conveyor 1 at the next check
+  connector.ReleaseConveyor(0, false);
+  bool remapped = false;
+  int conveyor_idx = 0;
+  // not moved while it is not movable, the check is left to the next movable data
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(connector.AcquireConveyor(0, &remapped, false), 0);
+    EXPECT_FALSE(remapped);
+    connector.ReleaseConveyor(0, false);
+  }
+  conveyor_idx = connector.AcquireConveyor(0, &remapped);
+  connector.ReleaseConveyor(0, false);
+  EXPECT_TRUE(remapped);
+  EXPECT_EQ(conveyor_idx, 1);
+  EXPECT_EQ(connector.GetStreamConveyorIdx(0), 1);
+}
+
+TEST(CoreConnector, ActiveConveyorNum) {
+  Connector connector(3, 20);
+  EXPECT_EQ(connector.GetActiveConveyorNum(), 3u);
+  // needs stream rebalance
+  connector.SetActiveConveyorNum(1);
+  EXPECT_EQ(connector.GetActiveConveyorNum(), 3u);
+  connector.EnableStreamRebalance(true);
+  connector.SetActiveConveyorNum(0);
+  EXPECT_EQ(connector.GetActiveConveyorNum(), 1u);
+  connector.SetActiveConveyorNum(5);
+  EXPECT_EQ(connector.GetActiveConveyorNum(), 3u);
+  for (uint32_t stream_idx = 0; stream_idx < 3; ++stream_idx) {
+    EXPECT_EQ(connector.AcquireConveyor(stream_idx), static_cast<int>(stream_idx));
+    connector.ReleaseConveyor(stream_idx, false);
+  }
+  // stream 2 has data in conveyor 2
+  CNFrameInfoPtr data = CNFrameInfo::Create("stream_id_2");
+  data->SetStreamIndex(2);
+  EXPECT_EQ(connector.AcquireConveyor(2), 2);
+  EXPECT_TRUE(connector.PushDataBufferToConveyor(2, data));
+  connector.SetActiveConveyorNum(2);
+  EXPECT_FALSE(connector.IsConveyorRetired(1));
+  EXPECT_FALSE(connector.IsConveyorRetired(2));
+  // new streams are mapped to active conveyors
+  EXPECT_LT(connector.AcquireConveyor(3), 2);
+  connector.ReleaseConveyor(3, false);
+  // stream 2 is moved after its data is processed
+  EXPECT_EQ(connector.PopDataBufferFromConveyor(2), data);
+  connector.ReleaseConveyor(2, false);
+  bool remapped = false;
+  EXPECT_LT(connector.AcquireConveyor(2, &remapped), 2);
+  EXPECT_TRUE(remapped);
+  connector.ReleaseConveyor(2, false);
+  EXPECT_TRUE(connector.IsConveyorRetired(2));
+}
+
+TEST(CoreConnector, WakeRetiredConveyor) {
+  Connector connector(2, 20);
+  connector.EnableStreamRebalance(true);
+  // the consumer of a conveyor is woken up once the conveyor might be retired
+  std::thread consumer([&] { EXPECT_EQ(connector.PopDataBufferFromConveyor(1), nullptr); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  connector.SetActiveConveyorNum(1);
+  consumer.join();
+  EXPECT_TRUE(connector.IsConveyorRetired(1));
+  // the last stream of a retired conveyor is over
+  connector.SetActiveConveyorNum(2);
+  EXPECT_EQ(connector.AcquireConveyor(0), 0);
+  EXPECT_EQ(connector.AcquireConveyor(1), 1);
+  connector.SetActiveConveyorNum(1);
+  // no consumer was blocked, the next pop returns at once
+  EXPECT_EQ(connector.PopDataBufferFromConveyor(1), nullptr);
+  consumer = std::thread([&] { EXPECT_EQ(connector.PopDataBufferFromConveyor(1), nullptr); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_FALSE(connector.IsConveyorRetired(1));
+  connector.ReleaseConveyor(1, true);
+  consumer.join();
+  EXPECT_TRUE(connector.IsConveyorRetired(1));
+}
+
 TEST(CoreConnector, GetConveyorSize) {
   size_t conveyor_count = 1;
   Connector connector(conveyor_count);
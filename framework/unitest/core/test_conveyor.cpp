@@ -20,6 +20,7 @@
 
 #include "cnstream_logging.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <ctime>
 #include <memory>
@@ -39,7 +40,8 @@ const char* kind[80];
 
 void ThreadFuncPushDataBuf(Conveyor* conveyor, CNFrameInfoPtr data, int id) {
   kind[id] = "pushDataBuf";
-  conveyor->PushDataBuffer(data);
+  // the conveyor is full, a pop thread might never get data
+  if (!conveyor->PushDataBuffer(data)) conveyor->Wake();
   flag[id]++;
 }
 
@@ -163,4 +165,256 @@ TEST(CoreConveyor, PopAllData) {
   delete conveyor;
 }
 
+TEST(CoreConveyor, WaitNotFull) {
+  Conveyor conveyor(1);
+  EXPECT_TRUE(conveyor.WaitNotFull());
+  EXPECT_TRUE(conveyor.PushDataBuffer(CNFrameInfo::Create(std::to_string(0))));
+  // timeout
+  EXPECT_FALSE(conveyor.WaitNotFull());
+  std::thread consumer([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    conveyor.PopDataBuffer();
+  });
+  EXPECT_TRUE(conveyor.WaitNotFull());
+  consumer.join();
+}
+
+TEST(CoreConveyor, DropOldestDataBuffer) {
+  Conveyor conveyor(3);
+  EXPECT_FALSE(conveyor.DropOldestDataBuffer());
+  CNFrameInfoPtr eos = CNFrameInfo::Create(std::to_string(0), true);
+  CNFrameInfoPtr data1 = CNFrameInfo::Create(std::to_string(1));
+  CNFrameInfoPtr data2 = CNFrameInfo::Create(std::to_string(1));
+  conveyor.PushDataBuffer(eos);
+  conveyor.PushDataBuffer(data1);
+  conveyor.PushDataBuffer(data2);
+  // eos is never dropped
+  EXPECT_TRUE(conveyor.DropOldestDataBuffer());
+  EXPECT_EQ(conveyor.GetBufferSize(), 2u);
+  EXPECT_EQ(conveyor.PopDataBuffer(), eos);
+  EXPECT_EQ(conveyor.PopDataBuffer(), data2);
+}
+
+static void TestPopDataBuffers(Conveyor* conveyor) {
+  std::vector<CNFrameInfoPtr> sdata_vec;
+  for (int i = 0; i < 5; ++i) sdata_vec.push_back(CNFrameInfo::Create(std::to_string(0)));
+  sdata_vec.push_back(CNFrameInfo::Create(std::to_string(0), true));
+  for (int i = 0; i < 2; ++i) sdata_vec.push_back(CNFrameInfo::Create(std::to_string(0)));
+  for (auto& data : sdata_vec) EXPECT_TRUE(conveyor->PushDataBuffer(data));
+  // enough data, no wait
+  auto rdata_vec = conveyor->PopDataBuffers(4, std::chrono::microseconds(0));
+  ASSERT_EQ(rdata_vec.size(), 4u);
+  for (size_t i = 0; i < 4; ++i) EXPECT_EQ(rdata_vec[i], sdata_vec[i]);
+  // a batch ends with an eos frame
+  rdata_vec = conveyor->PopDataBuffers(4, std::chrono::microseconds(100000));
+  ASSERT_EQ(rdata_vec.size(), 2u);
+  EXPECT_EQ(rdata_vec[0], sdata_vec[4]);
+  EXPECT_TRUE(rdata_vec[1]->IsEos());
+  // not enough data, returns after timeout
+  auto start = std::chrono::steady_clock::now();
+  rdata_vec = conveyor->PopDataBuffers(4, std::chrono::microseconds(10000));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::microseconds(10000));
+  ASSERT_EQ(rdata_vec.size(), 2u);
+  EXPECT_EQ(rdata_vec[1], sdata_vec[7]);
+  EXPECT_EQ(conveyor->GetBufferSize(), 0u);
+  // empty, blocks until woken up
+  std::thread waker([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    conveyor->Wake();
+  });
+  EXPECT_TRUE(conveyor->PopDataBuffers(4, std::chrono::microseconds(0)).empty());
+  waker.join();
+}
+
+static void TestPopDataBufferBlocking(Conveyor* conveyor) {
+  CNFrameInfoPtr data = CNFrameInfo::Create(std::to_string(0));
+  // blocks until data is pushed
+  std::thread producer([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    conveyor->PushDataBuffer(data);
+  });
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(conveyor->PopDataBuffer(), data);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+  producer.join();
+  // all blocked consumers return without data when woken up
+  std::atomic<int> popped{0};
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < 3; ++i) {
+    consumers.emplace_back([&] {
+      EXPECT_EQ(conveyor->PopDataBuffer(), nullptr);
+      popped++;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(popped.load(), 0);
+  conveyor->Wake();
+  for (auto& it : consumers) it.join();
+  EXPECT_EQ(popped.load(), 3);
+  // the next pop returns at once if no consumer is blocked, only once
+  conveyor->Wake();
+  EXPECT_EQ(conveyor->PopDataBuffer(), nullptr);
+  EXPECT_TRUE(conveyor->PushDataBuffer(data));
+  EXPECT_EQ(conveyor->PopDataBuffer(), data);
+}
+
+TEST(CoreConveyor, PopDataBufferBlocking) {
+  Conveyor conveyor(2);
+  TestPopDataBufferBlocking(&conveyor);
+}
+
+TEST(CoreLockFreeConveyor, PopDataBufferBlocking) {
+  LockFreeConveyor conveyor(2);
+  TestPopDataBufferBlocking(&conveyor);
+}
+
+TEST(CoreConveyor, PriorityDataBuffer) {
+  Conveyor conveyor(2);
+  CNFrameInfoPtr data1 = CNFrameInfo::Create("stream_0");
+  CNFrameInfoPtr data2 = CNFrameInfo::Create("stream_1");
+  CNFrameInfoPtr eos = CNFrameInfo::Create("stream_0", true);
+  ASSERT_TRUE(conveyor.PushDataBuffer(data1));
+  ASSERT_TRUE(conveyor.PushDataBuffer(data2));
+  // the capacity is not checked
+  EXPECT_TRUE(conveyor.PushPriorityDataBuffer(eos));
+  EXPECT_EQ(conveyor.GetBufferSize(), 3u);
+  std::vector<CNFrameInfoPtr> dropped = conveyor.DropStreamDataBuffers("stream_0");
+  ASSERT_EQ(dropped.size(), 1u);
+  EXPECT_EQ(dropped[0], data1);
+  // the eos is popped first and alone
+  std::vector<CNFrameInfoPtr> vec_data = conveyor.PopDataBuffers(4, std::chrono::microseconds(0));
+  ASSERT_EQ(vec_data.size(), 1u);
+  EXPECT_EQ(vec_data[0], eos);
+  EXPECT_EQ(conveyor.PopDataBuffer(), data2);
+  EXPECT_EQ(conveyor.GetBufferSize(), 0u);
+
+  LockFreeConveyor lock_free_conveyor(2);
+  EXPECT_FALSE(lock_free_conveyor.PushPriorityDataBuffer(eos));
+}
+
+static void TestPushDataBuffers(Conveyor* conveyor) {
+  std::vector<CNFrameInfoPtr> data;
+  for (int i = 0; i < 4; ++i) data.push_back(CNFrameInfo::Create(std::to_string(i)));
+  EXPECT_EQ(conveyor->PushDataBuffers(data), 4u);
+  // the data after the queue is full is not pushed
+  EXPECT_EQ(conveyor->PushDataBuffers(data), 2u);
+  EXPECT_EQ(conveyor->PushDataBuffers(data), 0u);
+  EXPECT_EQ(conveyor->GetBufferSize(), 6u);
+  for (int i = 0; i < 6; ++i) EXPECT_EQ(conveyor->PopDataBuffer(), data[i % 4]);
+  EXPECT_EQ(conveyor->PushDataBuffers({}), 0u);
+}
+
+TEST(CoreConveyor, PushDataBuffers) {
+  Conveyor conveyor(6);
+  TestPushDataBuffers(&conveyor);
+}
+
+TEST(CoreLockFreeConveyor, PushDataBuffers) {
+  LockFreeConveyor conveyor(6);
+  TestPushDataBuffers(&conveyor);
+}
+
+TEST(CoreConveyor, PopDataBuffers) {
+  Conveyor conveyor(10);
+  TestPopDataBuffers(&conveyor);
+}
+
+TEST(CoreLockFreeConveyor, PopDataBuffers) {
+  LockFreeConveyor conveyor(10);
+  TestPopDataBuffers(&conveyor);
+}
+
+TEST(CoreLockFreeConveyor, PushPopInOrder) {
+  size_t max_size = 10;
+  LockFreeConveyor conveyor(max_size);
+  std::vector<CNFrameInfoPtr> sdata_vec;
+  for (uint32_t i = 0; i < max_size; i++) {
+    sdata_vec.push_back(CNFrameInfo::Create(std::to_string(i)));
+    EXPECT_TRUE(conveyor.PushDataBuffer(sdata_vec.back()));
+    EXPECT_EQ(conveyor.GetBufferSize(), i + 1);
+  }
+  // queue is full
+  EXPECT_FALSE(conveyor.PushDataBuffer(CNFrameInfo::Create(std::to_string(0))));
+  EXPECT_FALSE(conveyor.PushDataBuffer(CNFrameInfo::Create(std::to_string(0))));
+  EXPECT_EQ(conveyor.GetFailTime(), 2u);
+  for (uint32_t i = 0; i < max_size; i++) {
+    EXPECT_EQ(conveyor.PopDataBuffer(), sdata_vec[i]);
+  }
+  EXPECT_EQ(conveyor.GetBufferSize(), 0u);
+  // queue is empty, pop returns nullptr once woken up
+  conveyor.Wake();
+  EXPECT_EQ(conveyor.PopDataBuffer(), nullptr);
+  EXPECT_TRUE(conveyor.PushDataBuffer(sdata_vec[0]));
+  EXPECT_EQ(conveyor.GetFailTime(), 0u);
+  EXPECT_FALSE(conveyor.DropOldestDataBuffer());
+}
+
+TEST(CoreLockFreeConveyor, WaitNotFull) {
+  LockFreeConveyor conveyor(1);
+  EXPECT_TRUE(conveyor.WaitNotFull());
+  EXPECT_TRUE(conveyor.PushDataBuffer(CNFrameInfo::Create(std::to_string(0))));
+  // timeout
+  EXPECT_FALSE(conveyor.WaitNotFull());
+  std::thread consumer([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    conveyor.PopDataBuffer();
+  });
+  EXPECT_TRUE(conveyor.WaitNotFull());
+  consumer.join();
+}
+
+TEST(CoreLockFreeConveyor, PopAllData) {
+  size_t max_size = 10;
+  LockFreeConveyor conveyor(max_size);
+  std::vector<CNFrameInfoPtr> sdata_vec;
+  // wrap around the ring buffer
+  for (uint32_t i = 0; i < max_size / 2; i++) {
+    conveyor.PushDataBuffer(CNFrameInfo::Create(std::to_string(0)));
+    conveyor.PopDataBuffer();
+  }
+  for (uint32_t i = 0; i < max_size + 1; i++) {
+    CNFrameInfoPtr sdata = CNFrameInfo::Create(std::to_string(0));
+    sdata_vec.push_back(sdata);
+    conveyor.PushDataBuffer(sdata);
+  }
+  std::vector<CNFrameInfoPtr> rdata_vec = conveyor.PopAllDataBuffer();
+  ASSERT_EQ(rdata_vec.size(), max_size);
+  for (uint32_t i = 0; i < max_size; i++) {
+    EXPECT_EQ(sdata_vec[i], rdata_vec[i]);
+  }
+  EXPECT_EQ(conveyor.GetBufferSize(), 0u);
+}
+
+TEST(CoreLockFreeConveyor, MultiProducerMultiConsumer) {
+  const int producer_num = 4, consumer_num = 4, data_num_per_producer = 2000;
+  LockFreeConveyor conveyor(16);
+  CNFrameInfoPtr data = CNFrameInfo::Create(std::to_string(0));
+  std::atomic<int> pop_cnt{0};
+  std::atomic<int> consumer_exited{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < producer_num; ++i) {
+    threads.emplace_back([&] {
+      for (int n = 0; n < data_num_per_producer; ++n) {
+        while (!conveyor.PushDataBuffer(data)) std::this_thread::yield();
+      }
+    });
+  }
+  for (int i = 0; i < consumer_num; ++i) {
+    threads.emplace_back([&] {
+      while (pop_cnt.load() < producer_num * data_num_per_producer) {
+        if (conveyor.PopDataBuffer()) pop_cnt++;
+      }
+      consumer_exited++;
+    });
+  }
+  // the consumers left are blocked once all data is popped
+  while (consumer_exited.load() < consumer_num) {
+    if (pop_cnt.load() == producer_num * data_num_per_producer) conveyor.Wake();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  for (auto &it : threads) it.join();
+  EXPECT_EQ(pop_cnt.load(), producer_num * data_num_per_producer);
+  EXPECT_EQ(conveyor.GetBufferSize(), 0u);
+}
+
 }  // namespace cnstream
@@ -0,0 +1,140 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "cpu_isolation.hpp"
+
+namespace cnstream {
+
+static std::chrono::nanoseconds ThreadCpuTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+// spins until the calling thread has run for the duration, the wall time is longer on a loaded cpu
+static void Spin(std::chrono::milliseconds duration) {
+  volatile uint64_t n = 0;
+  const auto end = ThreadCpuTime() + duration;
+  while (ThreadCpuTime() < end) ++n;
+}
+
+TEST(CoreCpuIsolation, AccountThreads) {
+  CpuIsolation isolation{CpuIsolationConfig()};
+  EXPECT_EQ(isolation.GetUsage().thread_num, 0u);
+  EXPECT_DOUBLE_EQ(isolation.GetUsage().cpu_time, 0);
+
+  std::atomic<bool> tagged{false}, exit{false};
+  std::thread live([&] {
+    EXPECT_TRUE(isolation.TagCurrentThread());
+    EXPECT_TRUE(isolation.TagCurrentThread());  // tagged once
+    Spin(std::chrono::milliseconds(50));
+    tagged.store(true);
+    while (!exit.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  while (!tagged.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  CpuUsage usage = isolation.GetUsage();
+  EXPECT_EQ(usage.thread_num, 1u);
+  EXPECT_GT(usage.cpu_time, 20);
+
+  // the cpu time of the threads exited is kept
+  std::thread([&] {
+    isolation.TagCurrentThread();
+    Spin(std::chrono::milliseconds(50));
+  }).join();
+  EXPECT_EQ(isolation.GetUsage().thread_num, 1u);
+  EXPECT_GT(isolation.GetUsage().cpu_time, usage.cpu_time + 20);
+
+  exit.store(true);
+  live.join();
+  usage = isolation.GetUsage();
+  EXPECT_EQ(usage.thread_num, 0u);
+  EXPECT_GT(usage.cpu_time, 40);
+  EXPECT_DOUBLE_EQ(isolation.GetUsage().cpu_time, usage.cpu_time);
+}
+
+TEST(CoreCpuIsolation, TagAgain) {
+  CpuIsolation first{CpuIsolationConfig()};
+  CpuIsolation second{CpuIsolationConfig()};
+  std::thread([&] {
+    first.TagCurrentThread();
+    Spin(std::chrono::milliseconds(30));
+    second.TagCurrentThread();
+    EXPECT_EQ(first.GetUsage().thread_num, 0u);
+    EXPECT_EQ(second.GetUsage().thread_num, 1u);
+  }).join();
+  EXPECT_GT(first.GetUsage().cpu_time, 10);
+  EXPECT_LT(second.GetUsage().cpu_time, first.GetUsage().cpu_time);
+}
+
+TEST(CoreCpuIsolation, Isolate) {
+  // a fake cgroup v1 directory
+  char dir[] = "/tmp/cnstream_cgroup_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  const std::string cgroup = dir;
+  std::ofstream(cgroup + "/tasks").close();
+  std::ofstream(cgroup + "/cpu.shares").close();
+
+  CpuIsolationConfig config;
+  config.enable = true;
+  config.nice = 1;
+  config.cgroup = cgroup;
+  config.cpu_weight = 50;
+  CpuIsolation isolation(config);
+  EXPECT_TRUE(isolation.Apply());
+  std::string value;
+  std::ifstream(cgroup + "/cpu.shares") >> value;
+  EXPECT_EQ(value, "512");
+
+  std::thread([&] {
+    EXPECT_TRUE(isolation.TagCurrentThread());
+    const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    EXPECT_EQ(getpriority(PRIO_PROCESS, tid), getpriority(PRIO_PROCESS, getpid()) + 1);
+    std::string tasks;
+    std::ifstream(cgroup + "/tasks") >> tasks;
+    EXPECT_EQ(tasks, std::to_string(tid));
+  }).join();
+
+  // not writable
+  config.cgroup = cgroup + "/none";
+  CpuIsolation failed(config);
+  EXPECT_FALSE(failed.Apply());
+  std::thread([&] { EXPECT_FALSE(failed.TagCurrentThread()); }).join();
+  EXPECT_EQ(failed.GetUsage().thread_num, 0u);
+
+  std::remove((cgroup + "/tasks").c_str());
+  std::remove((cgroup + "/cpu.shares").c_str());
+  rmdir(dir);
+}
+
+}  // namespace cnstream
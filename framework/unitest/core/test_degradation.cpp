@@ -0,0 +1,125 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_degradation.hpp"
+
+namespace cnstream {
+
+static DegradationConfig TestConfig() {
+  DegradationConfig config;
+  config.enable = true;
+  config.escalate_samples = 2;
+  config.recover_samples = 3;
+  DegradationStep skip;
+  skip.action = DegradationAction::SKIP_FRAMES;
+  skip.modules = {"detector"};
+  DegradationStep bypass;
+  bypass.action = DegradationAction::BYPASS;
+  bypass.modules = {"classifier"};
+  config.steps = {skip, bypass};
+  return config;
+}
+
+TEST(CoreDegradation, EscalateAndRecover) {
+  std::vector<std::pair<uint32_t, bool>> changes;
+  DegradationController controller(TestConfig(), [&](uint32_t level, const DegradationStep& step, bool apply) {
+    changes.emplace_back(level, apply);
+  });
+  DegradationSample overloaded;
+  overloaded.queue_fill_ratio = 0.9;
+  DegradationSample idle;
+  // a single overloaded sample is not enough
+  controller.Update(overloaded);
+  controller.Update(idle);
+  controller.Update(overloaded);
+  EXPECT_EQ(controller.GetLevel(), 0u);
+  controller.Update(overloaded);
+  EXPECT_EQ(controller.GetLevel(), 1u);
+  controller.Update(overloaded);
+  controller.Update(overloaded);
+  EXPECT_EQ(controller.GetLevel(), 2u);
+  // no more steps
+  controller.Update(overloaded);
+  controller.Update(overloaded);
+  EXPECT_EQ(controller.GetLevel(), 2u);
+  // the steps are undone one by one
+  for (int i = 0; i < 3; ++i) controller.Update(idle);
+  EXPECT_EQ(controller.GetLevel(), 1u);
+  for (int i = 0; i < 3; ++i) controller.Update(idle);
+  EXPECT_EQ(controller.GetLevel(), 0u);
+  std::vector<std::pair<uint32_t, bool>> expected = {{1, true}, {2, true}, {1, false}, {0, false}};
+  EXPECT_EQ(changes, expected);
+}
+
+TEST(CoreDegradation, GrowingQueuesAndBlocking) {
+  DegradationController controller(TestConfig(), nullptr);
+  DegradationSample sample;
+  // the queues keep growing before they are full
+  sample.queue_fill_ratio = 0.4;
+  controller.Update(sample);
+  sample.queue_fill_ratio = 0.5;
+  controller.Update(sample);
+  EXPECT_EQ(controller.GetLevel(), 1u);
+  // a stable fill between the watermarks neither escalates nor recovers
+  for (int i = 0; i < 5; ++i) controller.Update(sample);
+  EXPECT_EQ(controller.GetLevel(), 1u);
+  // an upstream module blocked by a full queue
+  sample.queue_fill_ratio = 0;
+  sample.blocking_upstream = true;
+  controller.Update(sample);
+  controller.Update(sample);
+  EXPECT_EQ(controller.GetLevel(), 2u);
+}
+
+TEST(CoreDegradation, SetLevel) {
+  std::vector<std::string> modules;
+  DegradationController controller(TestConfig(), [&](uint32_t level, const DegradationStep& step, bool apply) {
+    modules.push_back((apply ? "+" : "-") + step.modules[0]);
+  });
+  controller.SetLevel(5);
+  EXPECT_EQ(controller.GetLevel(), 2u);
+  controller.Stop();
+  EXPECT_EQ(controller.GetLevel(), 0u);
+  std::vector<std::string> expected = {"+detector", "+classifier", "-classifier", "-detector"};
+  EXPECT_EQ(modules, expected);
+}
+
+TEST(CoreDegradation, Bypass) {
+  DegradationController controller(TestConfig(), nullptr);
+  controller.SetStreamPriority("important", 1);
+  int processed = 0;
+  for (int i = 0; i < 10; ++i) {
+    if (!controller.Bypass("normal", 0, 3, 0)) ++processed;
+    // the streams with higher priorities are not degraded
+    EXPECT_FALSE(controller.Bypass("important", 0, 3, 0));
+    EXPECT_TRUE(controller.Bypass("normal", 1, 0, 0));
+  }
+  EXPECT_EQ(processed, 4);
+  // a step with a higher max_priority degrades them as well
+  EXPECT_TRUE(controller.Bypass("important", 0, 0, 1));
+}
+
+}  // namespace cnstream
@@ -20,9 +20,11 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <chrono>
 #include <ctime>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "cnstream_eventbus.hpp"
@@ -91,6 +93,34 @@ TEST(CoreEventBus, PollEvent) {
   pipe.Stop();
 }
 
+TEST(CoreEventBus, DispatchEventsBeforeStop) {
+  Pipeline pipe("pipe");
+  auto bus = pipe.GetEventBus();
+  bus->ClearAllWatchers();
+  std::vector<std::string> messages;
+  bus->AddBusWatch([&](const Event &event) {
+    // the other events are posted while the first one is handled
+    if (messages.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    messages.push_back(event.message);
+    return EventHandleFlag::EVENT_HANDLE_SYNCED;
+  });
+  ASSERT_TRUE(pipe.Start());
+  Event event;
+  event.type = EventType::EVENT_WARNING;
+  event.stream_id = "test_stream";
+  event.module_name = "pipe";
+  event.message = "first";
+  ASSERT_TRUE(bus->PostEvent(event));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  event.message = "second";
+  ASSERT_TRUE(bus->PostEvent(event));
+  event.type = EventType::EVENT_ERROR;
+  event.message = "error before stop";
+  ASSERT_TRUE(bus->PostEvent(event));
+  pipe.Stop();
+  EXPECT_EQ(messages, std::vector<std::string>({"first", "second", "error before stop"}));
+}
+
 TEST(CoreEventBus, ClearAllBusWatchers) {
   Pipeline pipe("pipe");
   auto bus = pipe.GetEventBus();
@@ -101,4 +131,75 @@ TEST(CoreEventBus, ClearAllBusWatchers) {
   EXPECT_EQ(bus->GetBusWatchers().size(), uint32_t(0));
 }
 
+TEST(CoreEventBus, FilterAndCoalesce) {
+  Pipeline pipe("pipe");
+  auto bus = pipe.GetEventBus();
+  bus->ClearAllWatchers();
+  std::atomic<int> stream_errors{0}, calls{0}, warnings{0};
+  EventFilter filter;
+  filter.types = {EventType::EVENT_STREAM_ERROR};
+  filter.stream_id = "stream_0";
+  bus->AddBusWatch([&](const Event &event) {
+    EXPECT_EQ(event.type, EventType::EVENT_STREAM_ERROR);
+    EXPECT_EQ(event.stream_id, "stream_0");
+    stream_errors += event.coalesced + 1;
+    ++calls;
+    return EventHandleFlag::EVENT_HANDLE_SYNCED;
+  }, filter);
+  filter.types = {EventType::EVENT_WARNING};
+  filter.stream_id.clear();
+  bus->AddBusWatch([&](const Event &event) {
+    EXPECT_EQ(event.coalesced, 0u);
+    ++warnings;
+    return EventHandleFlag::EVENT_HANDLE_SYNCED;
+  }, filter);
+  pipe.Start();
+
+  auto post = [&]() {
+    Event event;
+    event.module_name = "pipe";
+    event.thread_id = std::this_thread::get_id();
+    for (int i = 0; i < 1000; ++i) {
+      event.type = EventType::EVENT_STREAM_ERROR;
+      event.stream_id = "stream_" + std::to_string(i % 2);
+      bus->PostEvent(event);
+      if (i % 100 == 0) {
+        event.type = EventType::EVENT_WARNING;
+        bus->PostEvent(event);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) threads.emplace_back(post);
+  for (auto &thread : threads) thread.join();
+  for (int i = 0; i < 100 && (stream_errors < 2000 || warnings < 40); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(stream_errors.load(), 2000);
+  EXPECT_EQ(warnings.load(), 40);
+  EXPECT_LE(calls.load(), 2000);
+  pipe.Stop();
+}
+
+TEST(CoreEventBus, CoalesceEvents) {
+  std::vector<Event> events(5);
+  const EventType types[] = {EventType::EVENT_EOS, EventType::EVENT_WARNING, EventType::EVENT_EOS,
+                             EventType::EVENT_WARNING, EventType::EVENT_STREAM_ERROR};
+  for (size_t i = 0; i < events.size(); ++i) {
+    events[i].type = types[i];
+    events[i].stream_id = "stream";
+    events[i].module_name = "module";
+  }
+  events[4].coalesced = 2;
+  events.push_back(events[4]);
+  EventBus::CoalesceEvents(&events);
+  ASSERT_EQ(events.size(), 4u);
+  EXPECT_EQ(events[0].type, EventType::EVENT_EOS);
+  EXPECT_EQ(events[0].coalesced, 1u);
+  EXPECT_EQ(events[1].type, EventType::EVENT_WARNING);
+  EXPECT_EQ(events[2].type, EventType::EVENT_WARNING);
+  EXPECT_EQ(events[3].type, EventType::EVENT_STREAM_ERROR);
+  EXPECT_EQ(events[3].coalesced, 5u);
+}
+
 }  // namespace cnstream
@@ -0,0 +1,199 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_frame_pool.hpp"
+
+namespace cnstream {
+
+struct TestPoolData {
+  int value = 0;
+  std::vector<int> buffer;
+};
+
+TEST(CoreFramePool, RecycleFrame) {
+  CNFrameInfoPool pool(2);
+  EXPECT_EQ(pool.GetCapacity(), 2u);
+  EXPECT_EQ(pool.Create(""), nullptr);
+  auto frame = pool.Create("stream_0");
+  ASSERT_NE(frame, nullptr);
+  CNFrameInfo* raw_frame = frame.get();
+  frame->timestamp = 100;
+  frame->SetStreamIndex(3);
+  frame->collection.Add("user_tag", 1);
+  EXPECT_EQ(pool.GetIdleNumber(), 0u);
+  frame.reset();
+  EXPECT_EQ(pool.GetIdleNumber(), 1u);
+
+  frame = pool.Create("stream_1");
+  EXPECT_EQ(frame.get(), raw_frame);
+  EXPECT_EQ(pool.GetIdleNumber(), 0u);
+  EXPECT_EQ(frame->stream_id, "stream_1");
+  EXPECT_EQ(frame->timestamp, -1);
+  EXPECT_EQ(frame->GetStreamIndex(), INVALID_STREAM_IDX);
+  EXPECT_FALSE(frame->IsEos());
+  // data without recycler is removed
+  EXPECT_FALSE(frame->collection.HasValue("user_tag"));
+}
+
+TEST(CoreFramePool, CreateTime) {
+  CNFrameInfoPool pool(1);
+  auto before = std::chrono::steady_clock::now();
+  auto frame = pool.Create("stream_0");
+  ASSERT_NE(frame, nullptr);
+  auto create_time = frame->GetCreateTime();
+  EXPECT_GE(create_time, before);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_GE(frame->GetElapsedTime(), 10);
+  frame.reset();
+  // recycled frames get a new creation time
+  frame = pool.Create("stream_0");
+  EXPECT_GT(frame->GetCreateTime(), create_time);
+  EXPECT_LT(frame->GetElapsedTime(), 10);
+}
+
+TEST(CoreFramePool, Capacity) {
+  CNFrameInfoPool pool(2);
+  std::vector<std::shared_ptr<CNFrameInfo>> frames;
+  for (int i = 0; i < 4; ++i) frames.push_back(pool.Create("stream_0"));
+  frames.clear();
+  EXPECT_EQ(pool.GetIdleNumber(), 2u);
+}
+
+TEST(CoreFramePool, Recycler) {
+  CNFrameInfoPool pool(4);
+  pool.RegisterRecycler<TestPoolData>("pool_data");
+  auto frame = pool.Create("stream_0");
+  auto data = std::make_shared<TestPoolData>();
+  data->value = 10;
+  data->buffer.resize(10);
+  TestPoolData* raw_data = data.get();
+  frame->collection.Add("pool_data", data);
+  data.reset();
+  frame.reset();
+
+  frame = pool.Create("stream_0");
+  ASSERT_TRUE(frame->collection.HasValue("pool_data"));
+  auto recycled = frame->collection.Get<std::shared_ptr<TestPoolData>>("pool_data");
+  EXPECT_EQ(recycled.get(), raw_data);
+  EXPECT_EQ(recycled->value, 0);
+  EXPECT_TRUE(recycled->buffer.empty());
+
+  // data still used by others is not recycled
+  frame.reset();
+  frame = pool.Create("stream_0");
+  EXPECT_FALSE(frame->collection.HasValue("pool_data"));
+  EXPECT_EQ(recycled->value, 0);
+
+  // data with a recycler returning false is removed
+  pool.RegisterRecycler("user_tag", [] (cnstream::any*) { return false; });
+  frame->collection.Add("user_tag", 1);
+  frame.reset();
+  frame = pool.Create("stream_0");
+  EXPECT_FALSE(frame->collection.HasValue("user_tag"));
+}
+
+TEST(CoreFramePool, RecycleSlot) {
+  static constexpr CollectionSlot<std::shared_ptr<TestPoolData>> pool_slot("pool_slot_data", 5);
+  ASSERT_TRUE(Collection::RegisterSlot(pool_slot));
+  CNFrameInfoPool pool(4);
+  pool.RegisterRecycler<TestPoolData>(pool_slot.tag);
+  auto frame = pool.Create("stream_0");
+  frame->collection.Add(pool_slot, std::make_shared<TestPoolData>());
+  frame->collection.Get(pool_slot)->value = 10;
+  TestPoolData* raw_data = frame->collection.Get(pool_slot).get();
+  frame.reset();
+  frame = pool.Create("stream_0");
+  ASSERT_TRUE(frame->collection.HasValue(pool_slot));
+  EXPECT_EQ(frame->collection.Get(pool_slot).get(), raw_data);
+  EXPECT_EQ(frame->collection.Get(pool_slot)->value, 0);
+  // the slot is emptied when the recycler is removed
+  pool.RegisterRecycler(pool_slot.tag, nullptr);
+  frame.reset();
+  frame = pool.Create("stream_0");
+  EXPECT_FALSE(frame->collection.HasValue(pool_slot));
+}
+
+TEST(CoreFramePool, EosFrame) {
+  CNFrameInfoPool pool(4);
+  const std::string stream_id = "frame_pool_eos_stream";
+  auto frame = pool.Create(stream_id, true);
+  ASSERT_NE(frame, nullptr);
+  EXPECT_TRUE(frame->IsEos());
+  EXPECT_FALSE(CheckStreamEosReached(stream_id, false));
+  frame.reset();
+  EXPECT_TRUE(CheckStreamEosReached(stream_id, false));
+  frame = pool.Create(stream_id);
+  EXPECT_FALSE(frame->IsEos());
+}
+
+TEST(CoreFramePool, MaxFrames) {
+  CNFrameInfoPool pool(1, 2);
+  EXPECT_EQ(pool.GetMaxFrames(), 2u);
+  auto frame0 = pool.Create("stream_0");
+  auto frame1 = pool.Create("stream_0");
+  ASSERT_NE(frame0, nullptr);
+  ASSERT_NE(frame1, nullptr);
+  EXPECT_EQ(pool.GetInUseNumber(), 2u);
+  EXPECT_EQ(pool.Create("stream_0"), nullptr);
+  // eos frames are not limited
+  EXPECT_NE(pool.Create("stream_0", true), nullptr);
+  EXPECT_FALSE(pool.WaitForIdle(10));
+
+  // the waiting thread is woken up by the release of a frame
+  std::thread releaser([&frame0] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    frame0.reset();
+  });
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(pool.WaitForIdle(5000));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  releaser.join();
+  EXPECT_EQ(pool.GetInUseNumber(), 1u);
+  EXPECT_NE(pool.Create("stream_0"), nullptr);
+
+  // frames deleted instead of recycled are released as well
+  frame1.reset();
+  EXPECT_EQ(pool.GetInUseNumber(), 0u);
+  CNFrameInfoPool unlimited(1);
+  EXPECT_TRUE(unlimited.WaitForIdle(0));
+}
+
+TEST(CoreFramePool, DestroyPoolBeforeFrames) {
+  std::shared_ptr<CNFrameInfo> frame;
+  {
+    CNFrameInfoPool pool(4);
+    frame = pool.Create("stream_0");
+    pool.Create("stream_0");
+    EXPECT_EQ(pool.GetIdleNumber(), 1u);
+  }
+  // the frame is deleted instead of recycled
+  frame.reset();
+}
+
+}  // namespace cnstream
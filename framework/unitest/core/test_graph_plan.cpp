@@ -0,0 +1,200 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cnstream_graph_plan.hpp"
+#include "cnstream_pipeline.hpp"
+#include "test_base.hpp"
+
+namespace cnstream {
+
+class TGPTestModule : public Module, public ModuleCreator<TGPTestModule> {
+ public:
+  explicit TGPTestModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {return 0;}
+};  // class TGPTestModule
+
+static const char* kTGPModule = "  \"class_name\" : \"cnstream::TGPTestModule\",\n"
+                                "  \"parallelism\" : 1,\n"
+                                "  \"max_input_queue_size\" : 4";
+
+// a -> subgraph:sub (0 -> 1) and b -> subgraph:sub
+static std::string TGPRootConfig(const std::string& subgraph_path) {
+  return std::string("{\n") +
+    "\"a\" : {\n" + kTGPModule + ",\n  \"next_modules\" : [\"subgraph:sub\"]\n},\n"
+    "\"b\" : {\n" + kTGPModule + ",\n  \"next_modules\" : [\"subgraph:sub\"]\n},\n"
+    "\"subgraph:sub\" : {\n  \"config_path\" : \"" + subgraph_path + "\"\n}\n"
+  "}\n";
+}
+
+static std::pair<int, std::string> TGPCreateSubgraph() {
+  auto file = CreateTempFile("graph_plan_subgraph");
+  std::ofstream ofs(file.second);
+  ofs << "{\n"
+    "\"0\" : {\n" << kTGPModule << ",\n  \"next_modules\" : [\"1\"]\n},\n"
+    "\"1\" : {\n" << kTGPModule << "\n}\n"
+  "}\n";
+  ofs.close();
+  return file;
+}
+
+TEST(CoreGraphPlan, Compile) {
+  auto subgraph = TGPCreateSubgraph();
+  CNGraphConfig config;
+  config.name = "graph";
+  ASSERT_TRUE(config.ParseByJSONStr(TGPRootConfig(subgraph.second)));
+  auto plan = CNGraphPlan::Compile(config, 1);
+  unlink(subgraph.second.c_str());
+  close(subgraph.first);
+  ASSERT_NE(nullptr, plan);
+  EXPECT_EQ(1u, plan->hash);
+  EXPECT_EQ(1u, plan->subgraph_configs.count(subgraph.second));
+  std::vector<std::string> names;
+  for (const auto& node : plan->nodes) names.push_back(node.name);
+  ASSERT_EQ(4u, names.size());
+  auto index = [&names](const std::string& name) {
+    return static_cast<uint32_t>(std::find(names.begin(), names.end(), name) - names.begin());
+  };
+  const uint32_t a = index("a"), b = index("b"), sub0 = index("sub/0"), sub1 = index("sub/1");
+  ASSERT_TRUE(a < 4 && b < 4 && sub0 < 4 && sub1 < 4);
+  EXPECT_TRUE(plan->nodes[a].parents.empty());
+  EXPECT_EQ(std::vector<uint32_t>({a, sub0, sub1}), plan->nodes[a].routes);
+  EXPECT_EQ(3u, plan->nodes[b].routes.size());
+  std::vector<uint32_t> parents = plan->nodes[sub0].parents;
+  std::sort(parents.begin(), parents.end());
+  EXPECT_EQ(std::vector<uint32_t>({std::min(a, b), std::max(a, b)}), parents);
+  EXPECT_EQ(std::vector<uint32_t>({sub0}), plan->nodes[sub1].parents);
+  EXPECT_TRUE(plan->nodes[sub1].routes.empty());
+  ASSERT_EQ(4u, plan->topo_order.size());
+  EXPECT_EQ(sub1, plan->topo_order.back());
+
+  // invalid graphs are not compiled
+  CNGraphConfig ring;
+  ring.name = "ring";
+  CNModuleConfig module0, module1;
+  module0.name = "0";
+  module0.next = {"1"};
+  module1.name = "1";
+  module1.next = {"0"};
+  ring.module_configs = {module0, module1};
+  EXPECT_EQ(nullptr, CNGraphPlan::Compile(ring));
+}
+
+TEST(CoreGraphPlan, Hash) {
+  EXPECT_EQ(CNGraphPlan::Hash("{}", "dir/"), CNGraphPlan::Hash("{}", "dir/"));
+  EXPECT_NE(CNGraphPlan::Hash("{}", "dir/"), CNGraphPlan::Hash("{}", "other/"));
+  EXPECT_NE(CNGraphPlan::Hash("{}", "dir/"), CNGraphPlan::Hash("{ }", "dir/"));
+  EXPECT_NE(CNGraphPlan::Hash("a{}", ""), CNGraphPlan::Hash("{}", "a"));
+}
+
+TEST(CoreGraphPlan, Cache) {
+  CNGraphPlanCache& cache = CNGraphPlanCache::Instance();
+  cache.Clear();
+  auto subgraph = TGPCreateSubgraph();
+  const std::string jstr = TGPRootConfig(subgraph.second);
+  auto plan = cache.GetByJSONStr(jstr);
+  ASSERT_NE(nullptr, plan);
+  EXPECT_EQ(CNGraphPlan::Hash(jstr, ""), plan->hash);
+  EXPECT_EQ(1u, cache.Size());
+  // the subgraph is not read again
+  unlink(subgraph.second.c_str());
+  close(subgraph.first);
+  EXPECT_EQ(plan, cache.GetByJSONStr(jstr));
+  EXPECT_EQ(nullptr, cache.GetByJSONStr(jstr, "other/"));
+  EXPECT_EQ(nullptr, cache.GetByJSONStr("{"));
+  EXPECT_EQ(1u, cache.Size());
+  EXPECT_EQ(nullptr, cache.GetByJSONFile("not_exist.json"));
+
+  // the least recently used plans are evicted
+  auto config_file = CreateTempFile("graph_plan_root");
+  std::ofstream ofs(config_file.second);
+  ofs << "{\n\"c\" : {\n" << kTGPModule << "\n}\n}\n";
+  ofs.close();
+  auto file_plan = cache.GetByJSONFile(config_file.second);
+  ASSERT_NE(nullptr, file_plan);
+  EXPECT_EQ(2u, cache.Size());
+  EXPECT_EQ(plan, cache.GetByJSONStr(jstr));
+  cache.SetCapacity(1);
+  EXPECT_EQ(1u, cache.Size());
+  EXPECT_EQ(plan, cache.GetByJSONStr(jstr));
+  auto recompiled = cache.GetByJSONFile(config_file.second);
+  ASSERT_NE(nullptr, recompiled);
+  EXPECT_NE(file_plan, recompiled);
+  EXPECT_EQ(nullptr, cache.GetByJSONStr(jstr));  // evicted, the subgraph is removed
+  cache.SetCapacity(0);
+  EXPECT_EQ(0u, cache.Size());
+  EXPECT_NE(nullptr, cache.GetByJSONFile(config_file.second));
+  EXPECT_EQ(0u, cache.Size());
+  cache.SetCapacity(64);
+  unlink(config_file.second.c_str());
+  close(config_file.first);
+}
+
+TEST(CoreGraphPlan, BuildPipeline) {
+  auto subgraph = TGPCreateSubgraph();
+  CNGraphConfig config;
+  ASSERT_TRUE(config.ParseByJSONStr(TGPRootConfig(subgraph.second)));
+  auto plan = CNGraphPlan::Compile(config);
+  unlink(subgraph.second.c_str());
+  close(subgraph.first);
+  ASSERT_NE(nullptr, plan);
+
+  // pipelines with different names share the plan
+  for (const std::string name : {"pipeline0", "pipeline1"}) {
+    Pipeline pipeline(name);
+    ASSERT_TRUE(pipeline.BuildPipeline(*plan));
+    ASSERT_NE(nullptr, pipeline.GetModule("a"));
+    EXPECT_EQ(name + "/sub/1", pipeline.GetModule("1")->GetName());
+    EXPECT_TRUE(pipeline.IsRootNode("b"));
+    EXPECT_TRUE(pipeline.IsLeafNode(name + "/sub/1"));
+    std::atomic<int> done{0};
+    pipeline.RegisterFrameDoneCallBack([&done](std::shared_ptr<CNFrameInfo> data) { ++done; });
+    ASSERT_TRUE(pipeline.Start());
+    const int frame_num = 10;
+    for (const std::string head : {"a", "b"}) {
+      for (int i = 0; i < frame_num; ++i) {
+        auto data = CNFrameInfo::Create(head);
+        data->SetStreamIndex(0);
+        EXPECT_TRUE(pipeline.ProvideData(pipeline.GetModule(head), data));
+      }
+    }
+    for (int retry = 0; retry < 500 && done < 2 * frame_num; ++retry) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(2 * frame_num, done.load());
+    pipeline.Stop();
+  }
+}
+
+}  // namespace cnstream
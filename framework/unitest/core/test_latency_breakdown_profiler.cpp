@@ -0,0 +1,133 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "profiler/latency_breakdown_profiler.hpp"
+
+namespace cnstream {
+
+static constexpr int64_t kMs = 1000000;
+// times of the steady clock are far from 0
+static constexpr int64_t kBase = 1000000 * kMs;
+
+// a -> b -> d, a -> c -> d
+static std::vector<LatencyBreakdownNode> DiamondNodes() {
+  std::vector<LatencyBreakdownNode> nodes(4);
+  const char* names[] = {"a", "b", "c", "d"};
+  for (uint32_t i = 0; i < 4; ++i) {
+    nodes[i].module_id = i;
+    nodes[i].module_name = names[i];
+  }
+  nodes[1].parent_ids = {0};
+  nodes[2].parent_ids = {0};
+  nodes[3].parent_ids = {1, 2};
+  return nodes;
+}
+
+static CNFrameInfo::ModuleTimes MakeTimes(int64_t enqueue_ms, int64_t dequeue_ms, int64_t done_ms) {
+  CNFrameInfo::ModuleTimes times;
+  times.enqueue = kBase + enqueue_ms * kMs;
+  times.dequeue = kBase + dequeue_ms * kMs;
+  times.done = kBase + done_ms * kMs;
+  return times;
+}
+
+TEST(CoreLatencyBreakdownProfiler, CriticalPath) {
+  LatencyBreakdownProfiler profiler(DiamondNodes());
+  EXPECT_TRUE(profiler.GetBreakdowns().empty());
+  // d gets the frame from c, c waits 4ms
+  profiler.AddFrame("stream0", {MakeTimes(0, 0, 1), MakeTimes(1, 2, 3), MakeTimes(1, 5, 9), MakeTimes(9, 10, 12)});
+  auto breakdowns = profiler.GetBreakdowns();
+  ASSERT_EQ(1u, breakdowns.size());
+  EXPECT_EQ("stream0", breakdowns[0].stream_name);
+  EXPECT_EQ(1u, breakdowns[0].frames);
+  EXPECT_DOUBLE_EQ(12, breakdowns[0].latency);
+  EXPECT_EQ("c", breakdowns[0].bottleneck_module);
+  ASSERT_EQ(4u, breakdowns[0].modules.size());
+  const auto& b = breakdowns[0].modules[1];
+  EXPECT_EQ("b", b.module_name);
+  EXPECT_EQ(1u, b.frames);
+  EXPECT_DOUBLE_EQ(1, b.queue_wait);
+  EXPECT_DOUBLE_EQ(1, b.process);
+  EXPECT_EQ(0u, b.critical_frames);
+  const auto& c = breakdowns[0].modules[2];
+  EXPECT_EQ(1u, c.critical_frames);
+  EXPECT_DOUBLE_EQ(4, c.critical_queue_wait);
+  EXPECT_DOUBLE_EQ(4, c.critical_process);
+
+  // d gets the frame from b, b waits 9ms
+  profiler.AddFrame("stream0", {MakeTimes(0, 0, 1), MakeTimes(1, 10, 11), MakeTimes(1, 2, 3), MakeTimes(11, 11, 12)});
+  breakdowns = profiler.GetBreakdowns();
+  ASSERT_EQ(1u, breakdowns.size());
+  EXPECT_EQ(2u, breakdowns[0].frames);
+  EXPECT_EQ("b", breakdowns[0].bottleneck_module);
+  const auto& modules = breakdowns[0].modules;
+  EXPECT_EQ(2u, modules[0].critical_frames);
+  EXPECT_EQ(1u, modules[1].critical_frames);
+  EXPECT_EQ(1u, modules[2].critical_frames);
+  EXPECT_EQ(2u, modules[3].critical_frames);
+  EXPECT_DOUBLE_EQ(5, modules[1].queue_wait);
+  EXPECT_DOUBLE_EQ(9, modules[1].maximum_queue_wait);
+  EXPECT_DOUBLE_EQ(9, modules[1].critical_queue_wait);
+  EXPECT_DOUBLE_EQ(0.5, modules[3].queue_wait);
+  EXPECT_DOUBLE_EQ(2, modules[3].maximum_process);
+}
+
+TEST(CoreLatencyBreakdownProfiler, ModulesNotReached) {
+  LatencyBreakdownProfiler profiler(DiamondNodes());
+  // c and d are not reached, the times of d are missing
+  profiler.AddFrame("stream0", {MakeTimes(0, 0, 1), MakeTimes(2, 3, 5), CNFrameInfo::ModuleTimes()});
+  // no module is reached
+  profiler.AddFrame("stream0", {});
+  auto breakdowns = profiler.GetBreakdowns();
+  ASSERT_EQ(1u, breakdowns.size());
+  EXPECT_EQ(1u, breakdowns[0].frames);
+  EXPECT_DOUBLE_EQ(5, breakdowns[0].latency);
+  EXPECT_EQ("b", breakdowns[0].bottleneck_module);
+  EXPECT_EQ(1u, breakdowns[0].modules[1].critical_frames);
+  EXPECT_EQ(0u, breakdowns[0].modules[2].frames);
+  EXPECT_EQ(0u, breakdowns[0].modules[3].frames);
+  EXPECT_DOUBLE_EQ(0, breakdowns[0].modules[3].queue_wait);
+}
+
+TEST(CoreLatencyBreakdownProfiler, OnStreamEos) {
+  LatencyBreakdownProfiler profiler(DiamondNodes());
+  const std::vector<CNFrameInfo::ModuleTimes> times = {MakeTimes(0, 0, 1), MakeTimes(1, 1, 2), MakeTimes(1, 1, 2),
+                                                       MakeTimes(2, 2, 3)};
+  profiler.AddFrame("stream0", times);
+  profiler.AddFrame("stream1", times);
+  profiler.AddFrame("stream1", times);
+  auto breakdowns = profiler.GetBreakdowns();
+  ASSERT_EQ(2u, breakdowns.size());
+  EXPECT_EQ(1u, breakdowns[0].frames);
+  EXPECT_EQ(2u, breakdowns[1].frames);
+  // no frame waits
+  EXPECT_TRUE(breakdowns[1].bottleneck_module.empty());
+  profiler.OnStreamEos("stream0");
+  breakdowns = profiler.GetBreakdowns();
+  ASSERT_EQ(1u, breakdowns.size());
+  EXPECT_EQ("stream1", breakdowns[0].stream_name);
+}
+
+}  // namespace cnstream
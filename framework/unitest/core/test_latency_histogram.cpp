@@ -0,0 +1,105 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "profiler/latency_histogram.hpp"
+#include "profiler/stream_profiler.hpp"
+
+namespace cnstream {
+
+using Ms = std::chrono::duration<double, std::milli>;
+
+TEST(CoreLatencyHistogram, BucketIndexAndRange) {
+  uint32_t last = 0;
+  for (uint64_t us = 0; us < (1ull << 20); us += 7) {
+    uint32_t index = LatencyHistogram::BucketIndex(us);
+    ASSERT_GE(index, last);
+    uint64_t lower = 0, upper = 0;
+    LatencyHistogram::BucketRange(index, &lower, &upper);
+    ASSERT_LE(lower, us);
+    ASSERT_GT(upper, us);
+    // the bucket is at most 1/16 of its values
+    ASSERT_LE((upper - lower) * 16, lower < 32 ? 16 : lower);
+    last = index;
+  }
+  EXPECT_EQ(LatencyHistogram::kBucketCount - 1, LatencyHistogram::BucketIndex(UINT64_MAX));
+}
+
+TEST(CoreLatencyHistogram, Percentile) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.Percentile(0.5));
+  for (int i = 1; i <= 1000; ++i) histogram.Record(Ms(i));
+  EXPECT_EQ(1000u, histogram.Count());
+  EXPECT_NEAR(500, histogram.Percentile(0.5), 500 / 32.0);
+  EXPECT_NEAR(990, histogram.Percentile(0.99), 990 / 32.0);
+  EXPECT_NEAR(999, histogram.Percentile(0.999), 999 / 32.0);
+  EXPECT_NEAR(1, histogram.Percentile(0), 1 / 32.0);
+  histogram.Record(Ms(-1));
+  EXPECT_EQ(0.0005, histogram.Percentile(0));
+  histogram.Reset();
+  EXPECT_EQ(0u, histogram.Count());
+  EXPECT_EQ(0, histogram.Percentile(0.99));
+}
+
+TEST(CoreLatencyHistogram, MergeAndCopy) {
+  LatencyHistogram fast, slow;
+  for (int i = 0; i < 990; ++i) fast.Record(Ms(1));
+  for (int i = 0; i < 10; ++i) slow.Record(Ms(100));
+  LatencyHistogram merged(fast);
+  merged.Merge(slow);
+  EXPECT_EQ(990u, fast.Count());
+  EXPECT_EQ(1000u, merged.Count());
+  EXPECT_NEAR(1, merged.Percentile(0.99), 1 / 32.0);
+  EXPECT_NEAR(100, merged.Percentile(0.999), 100 / 32.0);
+  fast = merged;
+  EXPECT_EQ(1000u, fast.Count());
+}
+
+TEST(CoreLatencyHistogram, ConcurrentRecord) {
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram] {
+      for (int i = 0; i < 10000; ++i) histogram.Record(Ms(i % 10));
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(40000u, histogram.Count());
+}
+
+TEST(CoreLatencyHistogram, StreamProfilerPercentiles) {
+  StreamProfiler profiler("profiler");
+  for (int i = 0; i < 995; ++i) profiler.AddLatency(Ms(2)).AddCompleted();
+  for (int i = 0; i < 5; ++i) profiler.AddLatency(Ms(300)).AddCompleted();
+  StreamProfile profile = profiler.GetProfile();
+  EXPECT_NEAR(2, profile.latency_p50, 2 / 32.0);
+  EXPECT_NEAR(2, profile.latency_p99, 2 / 32.0);
+  // in the bucket of the largest latency, bounded by the maximum
+  EXPECT_NEAR(300, profile.latency_p999, 300 / 32.0);
+  EXPECT_LE(profile.latency_p999, profile.maximum_latency);
+  EXPECT_EQ(1000u, profiler.GetLatencyHistogram().Count());
+}
+
+}  // namespace cnstream
@@ -20,8 +20,10 @@
 
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "cnstream_logging.hpp"
 
@@ -74,3 +76,67 @@ TEST(CoreLog, LogSink) {
   cnstream::RemoveLogSink(&mysink);
   cnstream::RemoveLogSink(&mysink1);
 }
+
+TEST(CoreLog, AsyncLogging) {
+  const bool log_to_stderr = FLAGS_log_to_stderr;
+  FLAGS_log_to_stderr = false;
+  FLAGS_log_to_file = true;
+  FLAGS_log_async = true;
+  InitCNStreamLogging("/tmp");
+  std::thread([]() { LOGI(CoreLog) << "Async log from another thread"; }).join();
+  LOGI(CoreLog) << "Async log";
+  // the messages are dropped instead of blocking the thread logging
+  std::string longlog(1000, '=');
+  for (int i = 0; i < 10000; ++i) LOGI(CoreLog) << longlog;
+  EXPECT_GT(cnstream::GetDroppedLogCount(), 0u);
+  ShutdownCNStreamLogging();
+  FLAGS_log_async = false;
+  FLAGS_log_to_file = false;
+  FLAGS_log_to_stderr = log_to_stderr;
+
+  std::ifstream ifs("/tmp/CNSTREAM.log");
+  ASSERT_TRUE(ifs.is_open());
+  std::string line;
+  int found = 0;
+  bool drop_reported = false;
+  while (std::getline(ifs, line)) {
+    if (line.find("Async log") != std::string::npos) {
+      EXPECT_EQ(line.find("CNSTREAM CoreLog I"), 0u);
+      ++found;
+    }
+    if (line.find("log messages are dropped") != std::string::npos) drop_reported = true;
+  }
+  EXPECT_EQ(found, 2);
+  EXPECT_TRUE(drop_reported);
+}
+
+TEST(CoreLog, RateLimited) {
+  cnstream::LogRateLimiter limiter(1e-3, 2);
+  EXPECT_EQ(limiter.Allow(), 0);
+  EXPECT_EQ(limiter.Allow(), 0);
+  EXPECT_EQ(limiter.Allow(), -1);
+  EXPECT_EQ(limiter.Allow(), -1);
+
+  cnstream::LogRateLimiter every_n(3);
+  std::vector<int64_t> allowed;
+  for (int i = 0; i < 7; ++i) allowed.push_back(every_n.Allow());
+  EXPECT_EQ(allowed, std::vector<int64_t>({0, -1, -1, 2, -1, -1, 2}));
+
+  class CountLogSink : public cnstream::LogSink {
+   public:
+    void Send(cnstream::LogSeverity severity, const char* category, const char* filename, int line,
+              const struct ::tm* tm_time, int32_t usecs, const char* message, size_t message_len) override {
+      messages.emplace_back(message, message_len);
+    }
+    std::vector<std::string> messages;
+  };
+  CountLogSink sink;
+  cnstream::AddLogSink(&sink);
+  for (int i = 0; i < 10; ++i) LOGI_EVERY_N(CoreLog, 4) << "every 4";
+  for (int i = 0; i < 10; ++i) LOGI_EVERY_T(CoreLog, 3600) << "every hour";
+  cnstream::RemoveLogSink(&sink);
+  ASSERT_EQ(sink.messages.size(), 4u);
+  EXPECT_EQ(sink.messages[0].find("every 4"), 0u);
+  EXPECT_EQ(sink.messages[1].find("[3 similar messages suppressed] every 4"), 0u);
+  EXPECT_EQ(sink.messages[3].find("every hour"), 0u);
+}
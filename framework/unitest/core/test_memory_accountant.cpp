@@ -0,0 +1,134 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "cnstream_memory_accountant.hpp"
+#include "private/cnstream_allocator.hpp"
+
+namespace cnstream {
+
+class CoreMemoryAccountant : public testing::Test {
+ protected:
+  void SetUp() override {
+    enabled_ = MemoryAccountant::Instance().IsEnabled();
+    MemoryAccountant::Instance().SetEnable(true);
+  }
+  void TearDown() override {
+    MemoryAccountant::Instance().RemovePipeline(kPipeline);
+    MemoryAccountant::Instance().SetEnable(enabled_);
+    MemoryOwner::SetCurrent(MemoryOwner());
+  }
+  const std::string kPipeline = "test_memory_accountant_pipeline";
+  bool enabled_ = false;
+};
+
+TEST_F(CoreMemoryAccountant, ChargeAndRelease) {
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  MemoryOwner owner = accountant.GetOwner(kPipeline, "stream_0");
+  EXPECT_FALSE(owner.Empty());
+  {
+    MemoryCharge host(MemoryType::HOST, 100, owner);
+    MemoryCharge device(MemoryType::DEVICE, 200, owner);
+    EXPECT_EQ(host.GetBytes(), 100u);
+    MemoryUsage usage = accountant.GetUsage(kPipeline);
+    EXPECT_EQ(usage.host_bytes, 100);
+    EXPECT_EQ(usage.device_bytes, 200);
+    auto stream_usages = accountant.GetStreamUsages(kPipeline);
+    ASSERT_EQ(stream_usages.count("stream_0"), 1u);
+    EXPECT_EQ(stream_usages["stream_0"].host_bytes, 100);
+    // moved charges are released once
+    MemoryCharge moved(std::move(host));
+    EXPECT_EQ(host.GetBytes(), 0u);
+    moved.Release();
+    EXPECT_EQ(accountant.GetUsage(kPipeline).host_bytes, 0);
+  }
+  MemoryUsage usage = accountant.GetUsage(kPipeline);
+  EXPECT_EQ(usage.device_bytes, 0);
+  EXPECT_EQ(usage.peak_host_bytes, 100);
+  EXPECT_EQ(usage.peak_device_bytes, 200);
+}
+
+TEST_F(CoreMemoryAccountant, CurrentOwner) {
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  EXPECT_TRUE(MemoryOwner::Current().Empty());
+  MemoryOwner::SetCurrent(accountant.GetOwner(kPipeline, "stream_0"));
+  std::shared_ptr<void> data = cnCpuMemAlloc(4096);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(accountant.GetUsage(kPipeline).host_bytes, 4096);
+  EXPECT_EQ(accountant.GetStreamUsages(kPipeline)["stream_0"].host_bytes, 4096);
+  // the memory is credited to the owner at allocation, whichever thread frees it
+  MemoryOwner::SetCurrent(MemoryOwner());
+  std::thread([&data] { data.reset(); }).join();
+  EXPECT_EQ(accountant.GetUsage(kPipeline).host_bytes, 0);
+}
+
+TEST_F(CoreMemoryAccountant, Disabled) {
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  MemoryOwner owner = accountant.GetOwner(kPipeline, "stream_0");
+  accountant.SetEnable(false);
+  MemoryCharge charge(MemoryType::HOST, 100, owner);
+  EXPECT_EQ(charge.GetBytes(), 0u);
+  EXPECT_EQ(accountant.GetUsage(kPipeline).host_bytes, 0);
+}
+
+TEST_F(CoreMemoryAccountant, Budget) {
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  accountant.SetBudget(kPipeline, MemoryType::DEVICE, 1000);
+  accountant.SetStreamBudget(kPipeline, MemoryType::HOST, 100);
+  MemoryOwner stream_0 = accountant.GetOwner(kPipeline, "stream_0");
+  MemoryOwner stream_1 = accountant.GetOwner(kPipeline, "stream_1");
+  EXPECT_FALSE(accountant.IsOverBudget(MemoryOwner()));
+
+  MemoryCharge host(MemoryType::HOST, 101, stream_0);
+  EXPECT_TRUE(accountant.IsOverBudget(stream_0));
+  EXPECT_FALSE(accountant.IsOverBudget(stream_1));
+  host.Release();
+  EXPECT_FALSE(accountant.IsOverBudget(stream_0));
+
+  // the pipeline budget applies to all streams
+  MemoryCharge device(MemoryType::DEVICE, 1001, stream_0);
+  EXPECT_TRUE(accountant.IsOverBudget(stream_1));
+  EXPECT_FALSE(accountant.WaitForBudget(stream_1, 10));
+  std::thread releaser([&device] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    device.Release();
+  });
+  EXPECT_TRUE(accountant.WaitForBudget(stream_1, 5000));
+  releaser.join();
+}
+
+TEST_F(CoreMemoryAccountant, RemoveStream) {
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  MemoryCharge charge(MemoryType::HOST, 100, accountant.GetOwner(kPipeline, "stream_0"));
+  accountant.RemoveStream(kPipeline, "stream_0");
+  EXPECT_EQ(accountant.GetStreamUsages(kPipeline).count("stream_0"), 0u);
+  EXPECT_EQ(accountant.GetUsage(kPipeline).host_bytes, 100);
+  charge.Release();
+  EXPECT_EQ(accountant.GetUsage(kPipeline).host_bytes, 0);
+}
+
+}  // namespace cnstream
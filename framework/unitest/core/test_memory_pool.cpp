@@ -0,0 +1,233 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "private/cnstream_allocator.hpp"
+
+namespace cnstream {
+
+TEST(CoreMluMemoryPool, SizeClass) {
+  EXPECT_EQ(MluMemoryPool::GetSizeClass(0), 4096u);
+  EXPECT_EQ(MluMemoryPool::GetSizeClass(1), 4096u);
+  EXPECT_EQ(MluMemoryPool::GetSizeClass(4097), 8192u);
+  EXPECT_EQ(MluMemoryPool::GetSizeClass(40 << 10), 64u << 10);
+  EXPECT_EQ(MluMemoryPool::GetSizeClass(64 << 10), 64u << 10);
+  EXPECT_EQ(MluMemoryPool::GetSizeClass((64 << 10) + 1), 80u << 10);
+  EXPECT_EQ(MluMemoryPool::GetSizeClass(1 << 20), 1u << 20);
+  EXPECT_EQ(MluMemoryPool::GetSizeClass((1 << 20) + 1), 1280u << 10);
+  // 1920x1080 nv12
+  size_t size = 1920 * 1080 * 3 / 2;
+  size_t block_size = MluMemoryPool::GetSizeClass(size);
+  EXPECT_GE(block_size, size);
+  EXPECT_LT(block_size, size + size / 4);
+}
+
+TEST(CoreMluMemoryPool, ReuseBlocks) {
+  MluMemoryPool& pool = MluMemoryPool::Instance();
+  pool.ReleaseCache();
+  MemoryPoolStats start = pool.GetStats(0);
+  void* ptr = pool.Alloc(100 << 10, 0);
+  ASSERT_NE(ptr, nullptr);
+  MemoryPoolStats stats = pool.GetStats(0);
+  EXPECT_EQ(stats.in_use_bytes - start.in_use_bytes, MluMemoryPool::GetSizeClass(100 << 10));
+  EXPECT_EQ(stats.device_alloc_num - start.device_alloc_num, 1u);
+  pool.Free(ptr);
+  stats = pool.GetStats(0);
+  EXPECT_EQ(stats.in_use_bytes, start.in_use_bytes);
+  EXPECT_EQ(stats.cached_bytes, MluMemoryPool::GetSizeClass(100 << 10));
+  // same size class, the cached block is returned
+  void* ptr2 = pool.Alloc(110 << 10, 0);
+  EXPECT_EQ(ptr2, ptr);
+  stats = pool.GetStats(0);
+  EXPECT_EQ(stats.hit_num - start.hit_num, 1u);
+  EXPECT_EQ(stats.device_alloc_num - start.device_alloc_num, 1u);
+  EXPECT_EQ(stats.cached_bytes, 0u);
+  pool.Free(ptr2);
+  pool.ReleaseCache(0);
+  stats = pool.GetStats(0);
+  EXPECT_EQ(stats.cached_bytes, 0u);
+  EXPECT_EQ(stats.device_free_num - start.device_free_num, 1u);
+}
+
+TEST(CoreMluMemoryPool, CacheLimit) {
+  MluMemoryPool& pool = MluMemoryPool::Instance();
+  pool.ReleaseCache();
+  size_t limit = pool.GetCacheLimit();
+  const size_t block_size = 64 << 10;
+  pool.SetCacheLimit(2 * block_size);
+  EXPECT_EQ(pool.GetCacheLimit(), 2 * block_size);
+  MemoryPoolStats start = pool.GetStats(0);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 4; ++i) {
+    ptrs.push_back(pool.Alloc(block_size, 0));
+    ASSERT_NE(ptrs.back(), nullptr);
+  }
+  MemoryPoolStats stats = pool.GetStats(0);
+  EXPECT_GE(stats.peak_in_use_bytes, start.in_use_bytes + 4 * block_size);
+  for (auto ptr : ptrs) pool.Free(ptr);
+  stats = pool.GetStats(0);
+  // only two blocks are cached, the others are given back to the device
+  EXPECT_EQ(stats.cached_bytes, 2 * block_size);
+  EXPECT_EQ(stats.device_free_num - start.device_free_num, 2u);
+  EXPECT_GE(stats.peak_total_bytes, stats.peak_in_use_bytes);
+  pool.SetCacheLimit(block_size);
+  EXPECT_EQ(pool.GetStats(0).cached_bytes, block_size);
+  pool.SetCacheLimit(0);
+  EXPECT_EQ(pool.GetStats(0).cached_bytes, 0u);
+  pool.SetCacheLimit(limit);
+}
+
+TEST(CoreMluMemoryPool, SharedPtrAlloc) {
+  MluMemoryPool& pool = MluMemoryPool::Instance();
+  pool.ReleaseCache();
+  MemoryPoolStats start = pool.GetStats(0);
+  void* raw = nullptr;
+  {
+    std::shared_ptr<void> data = cnMluMemAlloc(1 << 20, 0);
+    ASSERT_NE(data, nullptr);
+    raw = data.get();
+    EXPECT_EQ(pool.GetStats(0).in_use_bytes - start.in_use_bytes, 1u << 20);
+  }
+  EXPECT_EQ(pool.GetStats(0).in_use_bytes, start.in_use_bytes);
+  std::shared_ptr<void> data = cnMluMemAlloc(1 << 20, 0);
+  EXPECT_EQ(data.get(), raw);
+  data.reset();
+  // not allocated by the pool, ignored
+  int value = 0;
+  pool.Free(&value);
+  pool.Free(nullptr);
+  pool.ReleaseCache();
+}
+
+TEST(CoreHostMemoryPool, ReuseBlocks) {
+  HostMemoryPool& pool = HostMemoryPool::Instance();
+  bool enable = pool.IsEnabled();
+  pool.SetEnable(true);
+  EXPECT_TRUE(pool.IsEnabled());
+  pool.ReleaseCache();
+  MemoryPoolStats start = pool.GetStats();
+  // 1920x1080 nv12 frame
+  const size_t size = 1920 * 1080 * 3 / 2;
+  void* ptr = pool.Alloc(size);
+  ASSERT_NE(ptr, nullptr);
+  memset(ptr, 0, size);
+  EXPECT_EQ(pool.GetStats().in_use_bytes - start.in_use_bytes, HostMemoryPool::GetSizeClass(size));
+  pool.Free(ptr);
+  EXPECT_EQ(pool.GetStats().cached_bytes, HostMemoryPool::GetSizeClass(size));
+  void* ptr2 = pool.Alloc(size);
+  EXPECT_EQ(ptr2, ptr);
+  EXPECT_EQ(pool.GetStats().hit_num - start.hit_num, 1u);
+  pool.Free(ptr2);
+  pool.ReleaseCache();
+  EXPECT_EQ(pool.GetStats().cached_bytes, 0u);
+  EXPECT_EQ(pool.GetStats().device_free_num - start.device_free_num, 1u);
+  pool.SetEnable(enable);
+}
+
+TEST(CoreHugePageMemoryPool, CarveSmallBlocks) {
+  HugePageMemoryPool& pool = HugePageMemoryPool::Instance();
+  pool.ReleaseCache();
+  const size_t size = 256 << 10;
+  std::vector<char*> ptrs;
+  for (int i = 0; i < 4; ++i) {
+    char* ptr = static_cast<char*>(pool.Alloc(size));
+    ASSERT_NE(ptr, nullptr);
+    memset(ptr, i + 1, size);
+    ptrs.push_back(ptr);
+  }
+  // blocks carved out of arenas do not overlap
+  std::vector<char*> sorted = ptrs;
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t i = 1; i < sorted.size(); ++i) {
+    EXPECT_GE(sorted[i] - sorted[i - 1], static_cast<std::ptrdiff_t>(size));
+  }
+  for (size_t i = 0; i < ptrs.size(); ++i) {
+    EXPECT_EQ(ptrs[i][0], static_cast<char>(i + 1));
+    EXPECT_EQ(ptrs[i][size - 1], static_cast<char>(i + 1));
+  }
+  std::set<char*> freed(ptrs.begin(), ptrs.end());
+  for (auto ptr : ptrs) pool.Free(ptr);
+  // carved blocks are kept after the cache is released
+  pool.ReleaseCache();
+  EXPECT_EQ(pool.GetStats().cached_bytes, 0u);
+  for (int i = 0; i < 4; ++i) {
+    char* ptr = static_cast<char*>(pool.Alloc(size));
+    EXPECT_TRUE(freed.count(ptr));
+    ptrs[i] = ptr;
+  }
+  for (auto ptr : ptrs) pool.Free(ptr);
+  pool.ReleaseCache();
+}
+
+TEST(CoreHugePageMemoryPool, LargeBlocks) {
+  HugePageMemoryPool& pool = HugePageMemoryPool::Instance();
+  pool.ReleaseCache();
+  MemoryPoolStats start = pool.GetStats();
+  // 3840x2160 nv12 frame
+  const size_t size = 3840 * 2160 * 3 / 2;
+  char* ptr = static_cast<char*>(pool.Alloc(size));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 4096, 0u);
+  memset(ptr, 1, size);
+  EXPECT_EQ(ptr[size - 1], 1);
+  EXPECT_EQ(pool.GetStats().in_use_bytes - start.in_use_bytes, HugePageMemoryPool::GetSizeClass(size));
+  pool.Free(ptr);
+  EXPECT_EQ(pool.Alloc(size), ptr);
+  pool.Free(ptr);
+  pool.ReleaseCache();
+  EXPECT_EQ(pool.GetStats().device_free_num - start.device_free_num, 1u);
+  int value = 0;
+  pool.Free(&value);
+}
+
+TEST(CoreHugePageMemoryPool, CpuMemAlloc) {
+  HugePageMemoryPool& pool = HugePageMemoryPool::Instance();
+  bool enable = pool.IsEnabled();
+  pool.SetEnable(true);
+  pool.ReleaseCache();
+  MemoryPoolStats start = pool.GetStats();
+  const size_t size = 1920 * 1080 * 3 / 2;
+  {
+    std::shared_ptr<void> data = cnCpuMemAlloc(size, -1);
+    ASSERT_NE(data, nullptr);
+    memset(data.get(), 0, size);
+    EXPECT_EQ(pool.GetStats().in_use_bytes - start.in_use_bytes, HugePageMemoryPool::GetSizeClass(size));
+  }
+  EXPECT_EQ(pool.GetStats().in_use_bytes, start.in_use_bytes);
+  pool.SetEnable(false);
+  {
+    std::shared_ptr<void> data = cnCpuMemAlloc(size, -1);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(pool.GetStats().in_use_bytes, start.in_use_bytes);
+  }
+  pool.ReleaseCache();
+  pool.SetEnable(enable);
+}
+
+}  // namespace cnstream
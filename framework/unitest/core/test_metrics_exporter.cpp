@@ -0,0 +1,117 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+
+#include "cnstream_metrics_exporter.hpp"
+
+namespace cnstream {
+
+// sends a request to the exporter on the local host, returns the response
+static std::string HttpRequest(uint16_t port, const std::string& request) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return "";
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  std::string response;
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 &&
+      send(fd, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size())) {
+    char buffer[1024];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) response.append(buffer, n);
+  }
+  close(fd);
+  return response;
+}
+
+TEST(CoreOpenMetricsWriter, Format) {
+  OpenMetricsWriter writer;
+  writer.AddFamily("cnstream_frames", "counter", "The frames\ncompleted.");
+  writer.AddSample("cnstream_frames_total", {{"module", "a\"b\\c\nd"}, {"process", "PROCESS"}}, 1234567890123);
+  writer.AddFamily("cnstream_latency_seconds", "summary", "The latency.", "seconds");
+  writer.AddSample("cnstream_latency_seconds", {{"quantile", "0.5"}}, 0.0125);
+  writer.AddSample("cnstream_latency_seconds_count", {}, 0);
+  EXPECT_EQ(writer.Finish(),
+            "# TYPE cnstream_frames counter\n"
+            "# HELP cnstream_frames The frames\\ncompleted.\n"
+            "cnstream_frames_total{module=\"a\\\"b\\\\c\\nd\",process=\"PROCESS\"} 1234567890123\n"
+            "# TYPE cnstream_latency_seconds summary\n"
+            "# UNIT cnstream_latency_seconds seconds\n"
+            "# HELP cnstream_latency_seconds The latency.\n"
+            "cnstream_latency_seconds{quantile=\"0.5\"} 0.0125\n"
+            "cnstream_latency_seconds_count 0\n"
+            "# EOF\n");
+  // the writer is reset
+  EXPECT_EQ(writer.Finish(), "# EOF\n");
+}
+
+TEST(CoreMetricsExporter, Serve) {
+  MetricsConfig config;
+  config.port = 0;
+  MetricsExporter exporter(config);
+  EXPECT_FALSE(exporter.Start(nullptr));
+  int collect_num = 0;
+  ASSERT_TRUE(exporter.Start([&] {
+    collect_num++;
+    return std::string("cnstream_up 1\n# EOF\n");
+  }));
+  EXPECT_TRUE(exporter.IsRunning());
+  const uint16_t port = exporter.GetPort();
+  ASSERT_NE(port, 0);
+
+  std::string response = HttpRequest(port, "GET /metrics?x=1 HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  EXPECT_EQ(response.find("HTTP/1.1 200 OK\r\n"), 0u);
+  EXPECT_NE(response.find(std::string("Content-Type: ") + MetricsExporter::kContentType), std::string::npos);
+  EXPECT_NE(response.find("Content-Length: 20\r\n"), std::string::npos);
+  EXPECT_EQ(response.substr(response.size() - 20), "cnstream_up 1\n# EOF\n");
+  EXPECT_EQ(collect_num, 1);
+
+  response = HttpRequest(port, "HEAD /metrics HTTP/1.1\r\n\r\n");
+  EXPECT_EQ(response.find("HTTP/1.1 200 OK\r\n"), 0u);
+  EXPECT_EQ(response.find("cnstream_up"), std::string::npos);
+  EXPECT_EQ(HttpRequest(port, "GET / HTTP/1.1\r\n\r\n").find("HTTP/1.1 404 Not Found\r\n"), 0u);
+  response = HttpRequest(port, "POST /metrics HTTP/1.1\r\n\r\n");
+  EXPECT_EQ(response.find("HTTP/1.1 405 Method Not Allowed\r\n"), 0u);
+  EXPECT_NE(response.find("Allow: GET, HEAD\r\n"), std::string::npos);
+  EXPECT_EQ(collect_num, 2);
+
+  // the port is in use
+  config.port = port;
+  MetricsExporter another(config);
+  EXPECT_FALSE(another.Start([] { return std::string(); }));
+
+  exporter.Stop();
+  EXPECT_FALSE(exporter.IsRunning());
+  EXPECT_EQ(exporter.GetPort(), 0);
+  EXPECT_TRUE(HttpRequest(port, "GET /metrics HTTP/1.1\r\n\r\n").empty());
+}
+
+}  // namespace cnstream
@@ -20,11 +20,15 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <map>
 #include <vector>
 
@@ -82,4 +86,106 @@ TEST(CoreModule, postevent) {
   pipe.Stop();
 }
 
+class TestModuleAsync : public ModuleAsync {
+ public:
+  explicit TestModuleAsync(uint32_t max_inflight) : ModuleAsync("test-module-async", max_inflight) {}
+  bool Open(ModuleParamSet set) { return true; }
+  void Close() {}
+  void OnEos(const std::string &stream_id) override { eos_streams.push_back(stream_id); }
+  void ProcessAsync(std::shared_ptr<CNFrameInfo> data, Completion done) override {
+    std::lock_guard<std::mutex> lk(mutex);
+    completions.push_back(std::move(done));
+  }
+  void Complete(size_t i, int ret) {
+    Completion done;
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      done = completions[i];
+    }
+    done(ret);
+  }
+  size_t GetCompletionNum() {
+    std::lock_guard<std::mutex> lk(mutex);
+    return completions.size();
+  }
+  std::mutex mutex;
+  std::vector<Completion> completions;
+  std::vector<std::string> eos_streams;
+};
+
+class TestAsyncObserver : public IModuleObserver {
+ public:
+  void notify(std::shared_ptr<CNFrameInfo> data) override {
+    std::lock_guard<std::mutex> lk(mutex);
+    frames.push_back(data);
+  }
+  std::mutex mutex;
+  std::vector<std::shared_ptr<CNFrameInfo>> frames;
+};
+
+TEST(CoreModule, AsyncOrder) {
+  TestModuleAsync module(0);
+  TestAsyncObserver observer;
+  module.SetObserver(&observer);
+  std::vector<std::shared_ptr<CNFrameInfo>> frames;
+  for (int i = 0; i < 3; ++i) {
+    frames.push_back(CNFrameInfo::Create("0"));
+    EXPECT_EQ(module.Process(frames.back()), 1);
+  }
+  auto other = CNFrameInfo::Create("1");
+  EXPECT_EQ(module.Process(other), 1);
+  auto eos = CNFrameInfo::Create("0", true);
+  EXPECT_EQ(module.Process(eos), 1);
+  EXPECT_EQ(module.GetInflightNum(), 4u);
+
+  // the data of a stream waits for the data before it, the streams are independent
+  module.Complete(2, 0);
+  module.Complete(1, 0);
+  module.Complete(3, 0);
+  ASSERT_EQ(observer.frames.size(), 1u);
+  EXPECT_EQ(observer.frames[0], other);
+  EXPECT_TRUE(module.eos_streams.empty());
+  module.Complete(0, 0);
+  ASSERT_EQ(observer.frames.size(), 5u);
+  for (int i = 0; i < 3; ++i) EXPECT_EQ(observer.frames[i + 1], frames[i]);
+  EXPECT_EQ(observer.frames[4], eos);
+  ASSERT_EQ(module.eos_streams.size(), 1u);
+  EXPECT_EQ(module.eos_streams[0], "0");
+  EXPECT_EQ(module.GetInflightNum(), 0u);
+
+  // the failed data is not transmitted, the data after it goes on
+  EXPECT_EQ(module.Process(CNFrameInfo::Create("0")), 1);
+  EXPECT_EQ(module.Process(CNFrameInfo::Create("0")), 1);
+  module.Complete(5, 0);
+  module.Complete(4, -1);
+  EXPECT_EQ(observer.frames.size(), 6u);
+  EXPECT_EQ(module.GetInflightNum(), 0u);
+}
+
+TEST(CoreModule, AsyncMaxInflight) {
+  TestModuleAsync module(2);
+  TestAsyncObserver observer;
+  module.SetObserver(&observer);
+  EXPECT_EQ(module.Process(CNFrameInfo::Create("0")), 1);
+  EXPECT_EQ(module.Process(CNFrameInfo::Create("0")), 1);
+  std::atomic<bool> processed{false};
+  std::thread th([&] {
+    module.Process(CNFrameInfo::Create("0"));
+    processed.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(processed.load());
+  // the completed data waiting for the data before it is still in flight
+  module.Complete(1, 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(processed.load());
+  module.Complete(0, 0);
+  th.join();
+  EXPECT_TRUE(processed.load());
+  ASSERT_EQ(module.GetCompletionNum(), 3u);
+  module.Complete(2, 0);
+  EXPECT_EQ(observer.frames.size(), 3u);
+  EXPECT_EQ(module.GetInflightNum(), 0u);
+}
+
 }  // namespace cnstream
@@ -0,0 +1,149 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "cnstream_pipeline.hpp"
+#include "private/cnstream_module_mask.hpp"
+#include "private/cnstream_module_pri.hpp"
+
+namespace cnstream {
+
+TEST(CoreModuleMask, SetAndTest) {
+  ModuleMask mask;
+  EXPECT_FALSE(mask.Any());
+  const size_t max_id = GetMaxModuleNumber() - 1;
+  mask.Set(0);
+  mask.Set(max_id);
+  EXPECT_TRUE(mask.Any());
+  EXPECT_TRUE(mask.Test(0));
+  EXPECT_TRUE(mask.Test(max_id));
+  for (size_t id = 1; id < max_id; ++id) EXPECT_FALSE(mask.Test(id));
+  mask.Reset(max_id);
+  EXPECT_FALSE(mask.Test(max_id));
+  mask.Reset(0);
+  EXPECT_FALSE(mask.Any());
+}
+
+TEST(CoreModuleMask, Operators) {
+  const size_t max_id = GetMaxModuleNumber() - 1;
+  ModuleMask parents, data;
+  parents.Set(1);
+  parents.Set(max_id);
+  data.Set(1);
+  EXPECT_FALSE(data.Contains(parents));
+  data.Set(max_id);
+  data.Set(2);
+  EXPECT_TRUE(data.Contains(parents));
+  EXPECT_FALSE(parents.Contains(data));
+  EXPECT_NE(data, parents);
+  ModuleMask diff = data ^ parents;
+  EXPECT_TRUE(diff.Test(2));
+  EXPECT_FALSE(diff.Test(1));
+  EXPECT_FALSE(diff.Test(max_id));
+  diff |= parents;
+  EXPECT_EQ(diff, data);
+}
+
+TEST(CoreModuleMask, AtomicFetchSetFromThreads) {
+  const size_t module_num = GetMaxModuleNumber();
+  ModuleMask all;
+  for (size_t id = 0; id < module_num; ++id) all.Set(id);
+  for (int round = 0; round < 100; ++round) {
+    AtomicModuleMask mask;
+    std::atomic<int> full_cnt{0};
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < module_num; ++id) {
+      threads.emplace_back([&, id] {
+        if (mask.FetchSet(id) == all) full_cnt++;
+      });
+    }
+    for (auto& it : threads) it.join();
+    // exactly one thread sees all bits set, that is how a merge node gets the data only once.
+    EXPECT_EQ(full_cnt.load(), 1);
+    EXPECT_EQ(mask.Load(), all);
+  }
+}
+
+TEST(CoreModuleMask, AtomicStoreAndLoad) {
+  ModuleMask mask;
+  mask.Set(GetMaxModuleNumber() - 1);
+  AtomicModuleMask atomic_mask;
+  EXPECT_FALSE(atomic_mask.Load().Any());
+  atomic_mask.Store(mask);
+  EXPECT_EQ(atomic_mask.Load(), mask);
+}
+
+TEST(CoreModuleMask, ModuleIdxUpToMaxNumber) {
+  IdxManager manager;
+  const size_t module_num = GetMaxModuleNumber();
+  for (size_t id = 0; id < module_num; ++id) {
+    EXPECT_EQ(manager.GetModuleIdx(), id);
+  }
+  EXPECT_EQ(manager.GetModuleIdx(), INVALID_MODULE_ID);
+  // returned ids could be reused, including the high ones.
+  manager.ReturnModuleIdx(module_num - 1);
+  EXPECT_EQ(manager.GetModuleIdx(), module_num - 1);
+  manager.ReturnModuleIdx(0);
+  EXPECT_EQ(manager.GetModuleIdx(), 0u);
+  EXPECT_EQ(manager.GetModuleIdx(), INVALID_MODULE_ID);
+}
+
+TEST(CoreIdxManager, StreamRemoved) {
+  IdxManager manager;
+  EXPECT_FALSE(manager.SetStreamRemoved("stream0", true));
+  const uint32_t idx = manager.GetStreamIndex("stream0");
+  ASSERT_EQ(idx, 0u);
+  const uint64_t state = manager.GetStreamState(idx);
+  EXPECT_TRUE(state & StreamStateTable::kAssigned);
+  EXPECT_FALSE(state & StreamStateTable::kRemoved);
+  EXPECT_TRUE(manager.SetStreamRemoved("stream0", true));
+  EXPECT_TRUE(manager.GetStreamState(idx) & StreamStateTable::kRemoved);
+  EXPECT_TRUE(manager.SetStreamRemoved("stream0", false));
+  EXPECT_FALSE(manager.GetStreamState(idx) & StreamStateTable::kRemoved);
+  EXPECT_TRUE(manager.SetStreamRemoved("stream0", true));
+  // the removed flag is not inherited by the next stream of the index
+  manager.ReturnStreamIndex("stream0");
+  EXPECT_EQ(manager.GetStreamState(idx) & (StreamStateTable::kAssigned | StreamStateTable::kRemoved), 0u);
+  EXPECT_EQ(manager.GetStreamIndex("stream1"), idx);
+  const uint64_t next_state = manager.GetStreamState(idx);
+  EXPECT_FALSE(next_state & StreamStateTable::kRemoved);
+  EXPECT_GT(next_state, state);
+  EXPECT_EQ(manager.GetStreamState(INVALID_STREAM_IDX), 0u);
+}
+
+TEST(CoreIdxManager, StreamStateGeneration) {
+  StreamStateTable table;
+  const uint64_t state = table.Assign(1);
+  EXPECT_TRUE(table.SetRemoved(1, state, true));
+  EXPECT_TRUE(table.SetRemoved(1, state | StreamStateTable::kRemoved, false));
+  table.Unassign(1);
+  table.Assign(1);
+  // the index is assigned again, the removal of the former stream is ignored
+  EXPECT_FALSE(table.SetRemoved(1, state, true));
+  EXPECT_FALSE(table.Load(1) & StreamStateTable::kRemoved);
+  EXPECT_EQ(table.Load(0), 0u);
+}
+
+}  // namespace cnstream
@@ -20,6 +20,7 @@
 
 #include <gtest/gtest.h>
 
+#include <map>
 #include <string>
 #include <utility>
 
@@ -95,6 +96,81 @@ TEST(CoreModuleProfiler, OnStreamEos) {
     }
 }
 
+TEST(CoreModuleProfiler, AddCounter) {
+  PipelineTracer tracer;
+  ProfilerConfig config;
+  config.enable_profiling = true;
+  const std::string module_name = "module";
+  ModuleProfiler profiler(config, module_name, &tracer);
+  profiler.AddCounter("hits", 3);
+  profiler.AddCounter("lookups", 4);
+  profiler.AddCounter("hits", 5);
+  profiler.OnStreamEos("stream0");
+  ModuleProfile profile = profiler.GetProfile();
+  ASSERT_EQ(profile.counters.size(), 2);
+  EXPECT_EQ(profile.counters[0], std::make_pair(std::string("hits"), static_cast<uint64_t>(8)));
+  EXPECT_EQ(profile.counters[1], std::make_pair(std::string("lookups"), static_cast<uint64_t>(4)));
+  profile = profiler.GetProfile(ModuleTrace());
+  EXPECT_EQ(profile.counters.size(), 2);
+}
+
+TEST(CoreModuleProfiler, AddPerfCounters) {
+  PipelineTracer tracer;
+  ProfilerConfig config;
+  config.enable_profiling = true;
+  ModuleProfiler profiler(config, "module", &tracer);
+  PerfCounterValues values;
+  values.cycles = 1000;
+  values.instructions = 2000;
+  values.llc_misses = 3;
+  values.context_switches = 1;
+  profiler.AddPerfCounters(values);
+  profiler.AddPerfCounters(values);
+  std::map<std::string, uint64_t> counters;
+  for (const auto& counter : profiler.GetProfile().counters) counters.insert(counter);
+  EXPECT_EQ(2u, counters["perf_samples"]);
+  EXPECT_EQ(2000u, counters["perf_cycles"]);
+  EXPECT_EQ(4000u, counters["perf_instructions"]);
+  EXPECT_EQ(6u, counters["perf_llc_misses"]);
+  EXPECT_EQ(2u, counters["perf_context_switches"]);
+}
+
+TEST(CoreModuleProfiler, FrameAccounting) {
+  PipelineTracer tracer;
+  ProfilerConfig config;
+  config.enable_profiling = true;
+  ModuleProfiler profiler(config, "module", &tracer);
+  profiler.RecordReceived("stream0", 10);
+  profiler.RecordReceived("stream1");
+  profiler.RecordDropped("stream0", kDROP_REASON_INTERVAL, 5);
+  profiler.RecordDropped("stream0", kDROP_REASON_QUEUE_FULL);
+  profiler.RecordDropped("stream1", kDROP_REASON_QUEUE_FULL);
+  profiler.RecordStalled("stream0", 1.5);
+  profiler.RecordStalled("stream1", 2);
+  ModuleProfile profile = profiler.GetProfile();
+  EXPECT_TRUE(profile.frame_accounting.stream_name.empty());
+  EXPECT_EQ(profile.frame_accounting.received, 11u);
+  EXPECT_EQ(profile.frame_accounting.dropped, 7u);
+  ASSERT_EQ(profile.frame_accounting.dropped_by_reason.size(), 2u);
+  EXPECT_EQ(profile.frame_accounting.dropped_by_reason[0],
+            std::make_pair(std::string(kDROP_REASON_INTERVAL), static_cast<uint64_t>(5)));
+  EXPECT_EQ(profile.frame_accounting.dropped_by_reason[1],
+            std::make_pair(std::string(kDROP_REASON_QUEUE_FULL), static_cast<uint64_t>(2)));
+  EXPECT_DOUBLE_EQ(profile.frame_accounting.stalled, 3.5);
+  ASSERT_EQ(profile.stream_frame_accountings.size(), 2u);
+  EXPECT_EQ(profile.stream_frame_accountings[0].stream_name, "stream0");
+  EXPECT_EQ(profile.stream_frame_accountings[0].received, 10u);
+  EXPECT_EQ(profile.stream_frame_accountings[0].dropped, 6u);
+  EXPECT_DOUBLE_EQ(profile.stream_frame_accountings[0].stalled, 1.5);
+  EXPECT_EQ(profile.stream_frame_accountings[1].dropped, 1u);
+  // the accounting of a stream is removed at its end, the total is kept
+  profiler.OnStreamEos("stream0");
+  profile = profiler.GetProfile(ModuleTrace());
+  EXPECT_EQ(profile.frame_accounting.received, 11u);
+  ASSERT_EQ(profile.stream_frame_accountings.size(), 1u);
+  EXPECT_EQ(profile.stream_frame_accountings[0].stream_name, "stream1");
+}
+
 TEST(CoreModuleProfiler, GetName) {
   PipelineTracer tracer;
   ProfilerConfig config;
@@ -0,0 +1,88 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "private/cnstream_parallel.hpp"
+
+namespace cnstream {
+
+TEST(CoreParallel, CoverAllRows) {
+  const int total = 2161;
+  std::vector<std::atomic<int>> visited(total);
+  for (auto& it : visited) it = 0;
+  std::mutex mtx;
+  std::set<std::thread::id> threads;
+  std::vector<std::pair<int, int>> bands;
+  ParallelFor(total, 256, 2, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) visited[i]++;
+    std::lock_guard<std::mutex> lk(mtx);
+    threads.insert(std::this_thread::get_id());
+    bands.emplace_back(begin, end);
+  });
+  for (int i = 0; i < total; ++i) EXPECT_EQ(visited[i].load(), 1);
+  for (const auto& band : bands) EXPECT_EQ(band.first % 2, 0);
+  EXPECT_EQ(static_cast<int>(bands.size()), std::min(total / 256, GetParallelThreadNum() + 1));
+  EXPECT_LE(threads.size(), bands.size());
+}
+
+TEST(CoreParallel, RunOnCallingThread) {
+  int calls = 0;
+  // shorter than two bands
+  ParallelFor(300, 256, 2, [&](int begin, int end) {
+    EXPECT_EQ(begin, 0);
+    EXPECT_EQ(end, 300);
+    calls++;
+  });
+  EXPECT_EQ(calls, 1);
+  ParallelFor(0, 256, 2, [&](int begin, int end) { calls++; });
+  EXPECT_EQ(calls, 1);
+
+  int thread_num = GetParallelThreadNum();
+  SetParallelThreadNum(0);
+  EXPECT_EQ(GetParallelThreadNum(), 0);
+  ParallelFor(4096, 256, 2, [&](int begin, int end) {
+    EXPECT_EQ(end - begin, 4096);
+    calls++;
+  });
+  EXPECT_EQ(calls, 2);
+  SetParallelThreadNum(thread_num);
+  EXPECT_EQ(GetParallelThreadNum(), thread_num);
+}
+
+TEST(CoreParallel, Nested) {
+  std::atomic<int> rows{0};
+  ParallelFor(1024, 128, 1, [&](int begin, int end) {
+    // nested calls in the pool threads run inline, never deadlock
+    ParallelFor(end - begin, 16, 1, [&](int b, int e) { rows += e - b; });
+  });
+  EXPECT_EQ(rows.load(), 1024);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,77 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "profiler/perf_counters.hpp"
+
+namespace cnstream {
+
+TEST(CorePerfCounters, Subtract) {
+  PerfCounterValues start, end;
+  start.cycles = 10;
+  start.instructions = 20;
+  start.llc_misses = 1;
+  start.context_switches = 2;
+  end.cycles = 110;
+  end.instructions = 220;
+  end.llc_misses = 4;
+  end.context_switches = 3;
+  PerfCounterValues values = end - start;
+  EXPECT_EQ(100u, values.cycles);
+  EXPECT_EQ(200u, values.instructions);
+  EXPECT_EQ(3u, values.llc_misses);
+  EXPECT_EQ(1u, values.context_switches);
+}
+
+TEST(CorePerfCounters, Read) {
+  PerfCounters* counters = PerfCounters::ThreadInstance();
+  ASSERT_NE(counters, nullptr);
+  EXPECT_EQ(counters, PerfCounters::ThreadInstance());
+  PerfCounterValues start, end;
+  EXPECT_EQ(counters->IsHardwareSupported(), counters->Read(&start));
+  // sleeping switches the context
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  volatile uint64_t sum = 0;
+  for (int i = 0; i < 100000; ++i) sum += i;
+  EXPECT_EQ(counters->IsHardwareSupported(), counters->Read(&end));
+  PerfCounterValues values = end - start;
+  EXPECT_GE(values.context_switches, 1u);
+  if (counters->IsHardwareSupported()) {
+    EXPECT_GT(values.cycles, 0u);
+    EXPECT_GT(values.instructions, 100000u);
+  } else {
+    EXPECT_EQ(0u, end.cycles);
+    EXPECT_EQ(0u, end.instructions);
+  }
+}
+
+TEST(CorePerfCounters, PerThread) {
+  PerfCounters* counters = PerfCounters::ThreadInstance();
+  PerfCounters* other = nullptr;
+  std::thread thread([&other] { other = PerfCounters::ThreadInstance(); });
+  thread.join();
+  EXPECT_NE(counters, other);
+}
+
+}  // namespace cnstream
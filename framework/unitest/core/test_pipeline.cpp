@@ -20,16 +20,25 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "cnstream_frame.hpp"
 #include "cnstream_pipeline.hpp"
 #include "test_base.hpp"
+#include "util/cnstream_stream_param_table.hpp"
 
 static constexpr char kCNDataFrameTag[] = "CNDataFrame";
 
@@ -105,6 +114,11 @@ TEST(CorePipeline, BuildPipelineByGraphConfig) {
   graph_config.module_configs[1] = config2;
   graph_config.module_configs[1].maxInputQueueSize = 0;
   EXPECT_FALSE(pipeline.BuildPipeline(graph_config));
+  // case5: drop_oldest policy is not supported by lock free queue
+  graph_config.module_configs[1] = config2;
+  graph_config.module_configs[1].queueType = InputQueueType::LOCK_FREE;
+  graph_config.module_configs[1].queueFullPolicy = QueueFullPolicy::DROP_OLDEST;
+  EXPECT_FALSE(pipeline.BuildPipeline(graph_config));
 }
 
 TEST(CorePipeline, BuildPipelineByJSONFile) {
@@ -278,6 +292,18 @@ TEST(CorePipeline, IsProfilingEnabled) {
   EXPECT_FALSE(pipeline.IsProfilingEnabled());
 }
 
+TEST(CorePipeline, GetFramePool) {
+  Pipeline pipeline("test_pipeline");
+  CNGraphConfig graph_config;
+  EXPECT_TRUE(pipeline.BuildPipeline(graph_config));
+  EXPECT_EQ(pipeline.GetFramePool(), nullptr);
+  graph_config.frame_pool_config.enable = true;
+  graph_config.frame_pool_config.capacity = 8;
+  EXPECT_TRUE(pipeline.BuildPipeline(graph_config));
+  ASSERT_NE(pipeline.GetFramePool(), nullptr);
+  EXPECT_EQ(pipeline.GetFramePool()->GetCapacity(), 8u);
+}
+
 TEST(CorePipeline, IsTracingEnabled) {
   // case1: true
   Pipeline pipeline("test_pipeline");
@@ -324,6 +350,1927 @@ TEST(CorePipeline, ProvideData) {
   pipeline.Stop();
 }
 
+class TPOrderRecordModule : public Module, public ModuleCreator<TPOrderRecordModule> {
+ public:
+  explicit TPOrderRecordModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    timestamps_[frame_info->stream_id].push_back(frame_info->timestamp);
+    sequences_[frame_info->stream_id].push_back(frame_info->GetSequence());
+    return 0;
+  }
+  static std::mutex mtx_;
+  static std::map<std::string, std::vector<int64_t>> timestamps_;
+  static std::map<std::string, std::vector<int64_t>> sequences_;
+};  // class TPOrderRecordModule
+
+std::mutex TPOrderRecordModule::mtx_;
+std::map<std::string, std::vector<int64_t>> TPOrderRecordModule::timestamps_;
+std::map<std::string, std::vector<int64_t>> TPOrderRecordModule::sequences_;
+
+TEST(CorePipeline, WorkStealingKeepsStreamOrder) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPTestModule";
+  config2.parallelism = 2;
+  config2.maxInputQueueSize = 2;
+  config2.next = {"modulec"};
+  CNModuleConfig config3;
+  config3.name = "modulec";
+  config3.className = "cnstream::TPOrderRecordModule";
+  config3.parallelism = 3;
+  config3.maxInputQueueSize = 2;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2, config3};
+  graph_config.scheduler_config.work_stealing = true;
+  graph_config.scheduler_config.thread_num = 2;
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  TPOrderRecordModule::timestamps_.clear();
+  TPOrderRecordModule::sequences_.clear();
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  const int stream_num = 4, frame_num = 100;
+  for (int i = 0; i < frame_num; ++i) {
+    for (int stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+      auto data = CNFrameInfo::Create(std::to_string(stream_idx));
+      data->SetStreamIndex(stream_idx);
+      data->timestamp = i;
+      EXPECT_TRUE(pipeline.ProvideData(module, data));
+    }
+  }
+  // wait for all data processed
+  for (int retry = 0; retry < 500; ++retry) {
+    size_t processed = 0;
+    {
+      std::lock_guard<std::mutex> lk(TPOrderRecordModule::mtx_);
+      for (const auto& it : TPOrderRecordModule::timestamps_) processed += it.second.size();
+    }
+    if (processed == static_cast<size_t>(stream_num * frame_num)) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  ASSERT_EQ(TPOrderRecordModule::timestamps_.size(), static_cast<size_t>(stream_num));
+  for (const auto& it : TPOrderRecordModule::timestamps_) {
+    ASSERT_EQ(it.second.size(), static_cast<size_t>(frame_num));
+    for (int i = 0; i < frame_num; ++i) EXPECT_EQ(it.second[i], i);
+  }
+  // the frames are numbered per stream in the order they enter the pipeline
+  for (const auto& it : TPOrderRecordModule::sequences_) {
+    ASSERT_EQ(it.second.size(), static_cast<size_t>(frame_num));
+    for (int i = 0; i < frame_num; ++i) EXPECT_EQ(it.second[i], i);
+  }
+}
+
+TEST(CorePipeline, ProvideDataBatch) {
+  for (bool work_stealing : {false, true}) {
+    Pipeline pipeline("test_pipeline");
+    CNModuleConfig config1;
+    config1.name = "modulea";
+    config1.className = "cnstream::TPTestModule";
+    config1.parallelism = 1;
+    config1.maxInputQueueSize = 20;
+    config1.next = {"moduleb"};
+    CNModuleConfig config2;
+    config2.name = "moduleb";
+    config2.className = "cnstream::TPOrderRecordModule";
+    config2.parallelism = 2;
+    // smaller than the batches, the frames left are pushed as the conveyors are popped
+    config2.maxInputQueueSize = 3;
+    CNGraphConfig graph_config;
+    graph_config.module_configs = {config1, config2};
+    graph_config.scheduler_config.work_stealing = work_stealing;
+    graph_config.scheduler_config.thread_num = 2;
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    TPOrderRecordModule::timestamps_.clear();
+    auto module = pipeline.GetModule("modulea");
+    std::vector<std::shared_ptr<CNFrameInfo>> batch = {CNFrameInfo::Create("0")};
+    EXPECT_FALSE(pipeline.ProvideDataBatch(module, batch));
+    ASSERT_TRUE(pipeline.Start());
+    EXPECT_FALSE(pipeline.ProvideDataBatch(pipeline.GetModule("moduleb"), batch));
+    const int stream_num = 2, frame_num = 60, batch_size = 8;
+    for (int i = 0; i < frame_num; i += batch_size) {
+      batch.clear();
+      for (int j = i; j < std::min(i + batch_size, frame_num); ++j) {
+        for (int stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+          auto data = CNFrameInfo::Create(std::to_string(stream_idx));
+          data->SetStreamIndex(stream_idx);
+          data->timestamp = j;
+          batch.push_back(data);
+        }
+      }
+      EXPECT_TRUE(pipeline.ProvideDataBatch(module, batch));
+    }
+    for (int retry = 0; retry < 500; ++retry) {
+      size_t processed = 0;
+      {
+        std::lock_guard<std::mutex> lk(TPOrderRecordModule::mtx_);
+        for (const auto& it : TPOrderRecordModule::timestamps_) processed += it.second.size();
+      }
+      if (processed == static_cast<size_t>(stream_num * frame_num)) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    pipeline.Stop();
+    ASSERT_EQ(TPOrderRecordModule::timestamps_.size(), static_cast<size_t>(stream_num));
+    for (const auto& it : TPOrderRecordModule::timestamps_) {
+      ASSERT_EQ(it.second.size(), static_cast<size_t>(frame_num));
+      for (int i = 0; i < frame_num; ++i) EXPECT_EQ(it.second[i], i);
+    }
+  }
+}
+
+class TPBurstRecordModule : public Module, public ModuleCreator<TPBurstRecordModule> {
+ public:
+  explicit TPBurstRecordModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::lock_guard<std::mutex> lk(mtx_);
+    timestamps_.push_back(frame_info->timestamp);
+    threads_.insert(std::this_thread::get_id());
+    return 0;
+  }
+  static std::mutex mtx_;
+  static std::vector<int64_t> timestamps_;
+  static std::set<std::thread::id> threads_;
+};  // class TPBurstRecordModule
+
+std::mutex TPBurstRecordModule::mtx_;
+std::vector<int64_t> TPBurstRecordModule::timestamps_;
+std::set<std::thread::id> TPBurstRecordModule::threads_;
+
+TEST(CorePipeline, ProvideDataBatchRebalance) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPBurstRecordModule";
+  config2.parallelism = 2;
+  config2.maxInputQueueSize = 8;
+  config2.rebalanceStreams = true;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  TPBurstRecordModule::timestamps_.clear();
+  TPBurstRecordModule::threads_.clear();
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  // the stream is checked for rebalance in the middle of the second burst, it is moved at the start of the third one
+  const int frame_num = 200, burst_size = 40;
+  for (int i = 0; i < frame_num; i += burst_size) {
+    std::vector<std::shared_ptr<CNFrameInfo>> burst;
+    for (int j = i; j < i + burst_size; ++j) {
+      auto data = CNFrameInfo::Create("0");
+      data->SetStreamIndex(0);
+      data->timestamp = j;
+      burst.push_back(data);
+    }
+    EXPECT_TRUE(pipeline.ProvideDataBatch(module, burst));
+  }
+  for (int retry = 0; retry < 500; ++retry) {
+    {
+      std::lock_guard<std::mutex> lk(TPBurstRecordModule::mtx_);
+      if (TPBurstRecordModule::timestamps_.size() == static_cast<size_t>(frame_num)) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  ASSERT_EQ(TPBurstRecordModule::timestamps_.size(), static_cast<size_t>(frame_num));
+  for (int i = 0; i < frame_num; ++i) EXPECT_EQ(TPBurstRecordModule::timestamps_[i], i);
+  EXPECT_EQ(TPBurstRecordModule::threads_.size(), 2u);
+}
+
+TEST(CorePipeline, AttachBranch) {
+  for (bool work_stealing : {false, true}) {
+    Pipeline pipeline("test_pipeline");
+    CNModuleConfig config1;
+    config1.name = "modulea";
+    config1.className = "cnstream::TPTestModule";
+    config1.parallelism = 1;
+    config1.maxInputQueueSize = 20;
+    config1.next = {"moduleb"};
+    CNModuleConfig config2;
+    config2.name = "moduleb";
+    config2.className = "cnstream::TPTestModule";
+    config2.parallelism = 2;
+    config2.maxInputQueueSize = 20;
+    CNGraphConfig graph_config;
+    graph_config.module_configs = {config1, config2};
+    graph_config.scheduler_config.work_stealing = work_stealing;
+    graph_config.scheduler_config.thread_num = 2;
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    std::atomic<int> done{0};
+    pipeline.RegisterFrameDoneCallBack([&done](std::shared_ptr<CNFrameInfo> data) { ++done; });
+    TPOrderRecordModule::timestamps_.clear();
+
+    CNModuleConfig branch_head;
+    branch_head.name = "branch_head";
+    branch_head.className = "cnstream::TPTestModule";
+    branch_head.parallelism = 2;
+    branch_head.maxInputQueueSize = 4;
+    branch_head.next = {"branch_record"};
+    CNModuleConfig branch_record;
+    branch_record.name = "branch_record";
+    branch_record.className = "cnstream::TPOrderRecordModule";
+    branch_record.parallelism = 1;
+    branch_record.maxInputQueueSize = 4;
+    // case1: the pipeline is not running
+    EXPECT_FALSE(pipeline.AttachBranch("modulea", {branch_head, branch_record}));
+    ASSERT_TRUE(pipeline.Start());
+    // case2: invalid branches
+    EXPECT_FALSE(pipeline.AttachBranch("wrong_module_name", {branch_head, branch_record}));
+    EXPECT_FALSE(pipeline.AttachBranch("modulea", {branch_head}));  // the next module is not in the branch
+    CNModuleConfig duplicated = branch_record;
+    duplicated.name = "moduleb";
+    EXPECT_FALSE(pipeline.AttachBranch("modulea", {branch_head, duplicated}));
+    CNModuleConfig cycle = branch_record;
+    cycle.next = {"branch_head"};
+    EXPECT_FALSE(pipeline.AttachBranch("modulea", {branch_head, cycle}));
+    EXPECT_FALSE(pipeline.DetachBranch("branch_head"));
+
+    auto module = pipeline.GetModule("modulea");
+    auto provide = [&](const std::string& stream_id, int frame_num) {
+      for (int i = 0; i < frame_num; ++i) {
+        auto data = CNFrameInfo::Create(stream_id);
+        data->SetStreamIndex(0);
+        data->timestamp = i;
+        EXPECT_TRUE(pipeline.ProvideData(module, data));
+      }
+    };
+    auto wait_done = [&done](int num) {
+      for (int retry = 0; retry < 500 && done < num; ++retry) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      EXPECT_EQ(num, done.load());
+    };
+    const int frame_num = 50;
+    provide("before", frame_num);
+    // case3: the frames provided after the branch is attached pass through it, the frames in flight do not.
+    ASSERT_TRUE(pipeline.AttachBranch("modulea", {branch_head, branch_record}));
+    EXPECT_FALSE(pipeline.AttachBranch("moduleb", {branch_head, branch_record}));
+    EXPECT_NE(nullptr, pipeline.GetModule("branch_head"));
+    EXPECT_EQ(2, pipeline.GetModuleConfig("branch_head").parallelism);
+    EXPECT_FALSE(pipeline.IsLeafNode("branch_head"));
+    EXPECT_TRUE(pipeline.IsLeafNode("branch_record"));
+    provide("attached", frame_num);
+    wait_done(2 * frame_num);
+    // case4: the frames provided after the branch is detached do not pass through it.
+    EXPECT_TRUE(pipeline.DetachBranch("branch_head"));
+    EXPECT_FALSE(pipeline.DetachBranch("branch_head"));
+    EXPECT_EQ(nullptr, pipeline.GetModule("branch_record"));
+    provide("detached", frame_num);
+    wait_done(3 * frame_num);
+    // case5: the branch is closed by Stop
+    ASSERT_TRUE(pipeline.AttachBranch("moduleb", {branch_head, branch_record}));
+    provide("stopped", frame_num);
+    pipeline.Stop();
+    EXPECT_EQ(nullptr, pipeline.GetModule("branch_head"));
+
+    std::lock_guard<std::mutex> lk(TPOrderRecordModule::mtx_);
+    EXPECT_EQ(0u, TPOrderRecordModule::timestamps_.count("before"));
+    EXPECT_EQ(0u, TPOrderRecordModule::timestamps_.count("detached"));
+    const auto& timestamps = TPOrderRecordModule::timestamps_["attached"];
+    ASSERT_EQ(static_cast<size_t>(frame_num), timestamps.size());
+    for (int i = 0; i < frame_num; ++i) EXPECT_EQ(i, timestamps[i]);
+  }
+}
+
+class TPBlockModule : public Module, public ModuleCreator<TPBlockModule> {
+ public:
+  explicit TPBlockModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    std::unique_lock<std::mutex> lk(mtx_);
+    entered_ = true;
+    cond_.notify_all();
+    cond_.wait(lk, [] { return released_; });
+    return 0;
+  }
+  static std::mutex mtx_;
+  static std::condition_variable cond_;
+  static bool entered_;
+  static bool released_;
+};  // class TPBlockModule
+
+std::mutex TPBlockModule::mtx_;
+std::condition_variable TPBlockModule::cond_;
+bool TPBlockModule::entered_ = false;
+bool TPBlockModule::released_ = false;
+
+TEST(CorePipeline, DetachBranchWaitsForFrames) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1};
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  TPBlockModule::entered_ = false;
+  TPBlockModule::released_ = false;
+  ASSERT_TRUE(pipeline.Start());
+  CNModuleConfig branch_block;
+  branch_block.name = "branch_block";
+  branch_block.className = "cnstream::TPBlockModule";
+  branch_block.parallelism = 1;
+  branch_block.maxInputQueueSize = 4;
+  ASSERT_TRUE(pipeline.AttachBranch("modulea", {branch_block}));
+  auto data = CNFrameInfo::Create("0");
+  data->SetStreamIndex(0);
+  EXPECT_TRUE(pipeline.ProvideData(pipeline.GetModule("modulea"), data));
+  data.reset();
+  {
+    std::unique_lock<std::mutex> lk(TPBlockModule::mtx_);
+    TPBlockModule::cond_.wait(lk, [] { return TPBlockModule::entered_; });
+  }
+  // the frame in the branch keeps it attached
+  std::atomic<bool> detached{false};
+  std::thread detach([&] {
+    EXPECT_TRUE(pipeline.DetachBranch("branch_block"));
+    detached = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(detached.load());
+  {
+    std::lock_guard<std::mutex> lk(TPBlockModule::mtx_);
+    TPBlockModule::released_ = true;
+  }
+  TPBlockModule::cond_.notify_all();
+  detach.join();
+  EXPECT_EQ(nullptr, pipeline.GetModule("branch_block"));
+  pipeline.Stop();
+}
+
+class TPThreadRecordModule : public Module, public ModuleCreator<TPThreadRecordModule> {
+ public:
+  explicit TPThreadRecordModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    threads_[GetName()][frame_info->stream_id].push_back(std::this_thread::get_id());
+    return 0;
+  }
+  static std::mutex mtx_;
+  // module name -> stream id -> the threads processing the frames in order
+  static std::map<std::string, std::map<std::string, std::vector<std::thread::id>>> threads_;
+};  // class TPThreadRecordModule
+
+std::mutex TPThreadRecordModule::mtx_;
+std::map<std::string, std::map<std::string, std::vector<std::thread::id>>> TPThreadRecordModule::threads_;
+
+class TPFusableModule : public TPThreadRecordModule, public ModuleCreator<TPFusableModule> {
+ public:
+  explicit TPFusableModule(const std::string& name) : TPThreadRecordModule(name) {}
+  bool IsFusable() const override { return true; }
+};  // class TPFusableModule
+
+TEST(CorePipeline, FuseModules) {
+  for (bool work_stealing : {false, true}) {
+    Pipeline pipeline("test_pipeline");
+    CNModuleConfig config1;
+    config1.name = "modulea";
+    config1.className = "cnstream::TPTestModule";
+    config1.parallelism = 1;
+    config1.maxInputQueueSize = 20;
+    config1.next = {"moduleb"};
+    CNModuleConfig config2;
+    config2.name = "moduleb";
+    config2.className = "cnstream::TPThreadRecordModule";
+    config2.parallelism = 2;
+    config2.maxInputQueueSize = 4;
+    config2.fusePolicy = FusePolicy::ALWAYS;  // the upstream module is a head module
+    config2.next = {"modulec"};
+    CNModuleConfig config3;
+    config3.name = "modulec";
+    config3.className = "cnstream::TPFusableModule";
+    config3.parallelism = 3;
+    config3.maxInputQueueSize = 4;
+    config3.next = {"moduled"};
+    CNModuleConfig config4;
+    config4.name = "moduled";
+    config4.className = "cnstream::TPThreadRecordModule";
+    config4.parallelism = 1;
+    config4.maxInputQueueSize = 4;
+    config4.fusePolicy = FusePolicy::ALWAYS;
+    config4.next = {"modulee"};
+    CNModuleConfig config5;
+    config5.name = "modulee";
+    config5.className = "cnstream::TPFusableModule";
+    config5.parallelism = 1;
+    config5.maxInputQueueSize = 4;
+    config5.fusePolicy = FusePolicy::NEVER;
+    CNGraphConfig graph_config;
+    graph_config.module_configs = {config1, config2, config3, config4, config5};
+    graph_config.scheduler_config.work_stealing = work_stealing;
+    graph_config.scheduler_config.thread_num = 2;
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    EXPECT_FALSE(pipeline.IsFusedNode("modulea"));
+    EXPECT_FALSE(pipeline.IsFusedNode("moduleb"));
+    EXPECT_TRUE(pipeline.IsFusedNode("modulec"));
+    EXPECT_TRUE(pipeline.IsFusedNode("moduled"));
+    EXPECT_FALSE(pipeline.IsFusedNode("modulee"));
+    std::atomic<int> done{0};
+    pipeline.RegisterFrameDoneCallBack([&done](std::shared_ptr<CNFrameInfo> data) { ++done; });
+    TPThreadRecordModule::threads_.clear();
+    ASSERT_TRUE(pipeline.Start());
+
+    auto module = pipeline.GetModule("modulea");
+    const int stream_num = 4, frame_num = 50;
+    for (int i = 0; i < frame_num; ++i) {
+      for (int stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+        auto data = CNFrameInfo::Create(std::to_string(stream_idx));
+        data->SetStreamIndex(stream_idx);
+        data->timestamp = i;
+        EXPECT_TRUE(pipeline.ProvideData(module, data));
+      }
+    }
+    for (int retry = 0; retry < 500 && done < stream_num * frame_num; ++retry) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    pipeline.Stop();
+    EXPECT_EQ(stream_num * frame_num, done.load());
+
+    // the fused modules process every frame on the thread of the stage, right after moduleb
+    std::lock_guard<std::mutex> lk(TPThreadRecordModule::mtx_);
+    auto& threads = TPThreadRecordModule::threads_;
+    for (int stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+      const std::string stream_id = std::to_string(stream_idx);
+      const auto& stage_threads = threads[pipeline.GetModule("moduleb")->GetName()][stream_id];
+      ASSERT_EQ(static_cast<size_t>(frame_num), stage_threads.size());
+      EXPECT_EQ(stage_threads, threads[pipeline.GetModule("modulec")->GetName()][stream_id]);
+      EXPECT_EQ(stage_threads, threads[pipeline.GetModule("moduled")->GetName()][stream_id]);
+      EXPECT_EQ(static_cast<size_t>(frame_num), threads[pipeline.GetModule("modulee")->GetName()][stream_id].size());
+    }
+  }
+}
+
+class TPBatchRecordModule : public Module, public ModuleCreator<TPBatchRecordModule> {
+ public:
+  explicit TPBatchRecordModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override { return -1; }
+  int ProcessBatch(std::vector<std::shared_ptr<CNFrameInfo>>& data_vec) override {  // NOLINT
+    std::lock_guard<std::mutex> lk(mtx_);
+    max_batch_size_ = std::max(max_batch_size_, data_vec.size());
+    for (const auto& data : data_vec) {
+      EXPECT_FALSE(data->IsEos());
+      timestamps_[data->stream_id].push_back(data->timestamp);
+    }
+    return 0;
+  }
+  static std::mutex mtx_;
+  static size_t max_batch_size_;
+  static std::map<std::string, std::vector<int64_t>> timestamps_;
+};  // class TPBatchRecordModule
+
+std::mutex TPBatchRecordModule::mtx_;
+size_t TPBatchRecordModule::max_batch_size_ = 0;
+std::map<std::string, std::vector<int64_t>> TPBatchRecordModule::timestamps_;
+
+TEST(CorePipeline, ProcessBatch) {
+  for (bool work_stealing : {false, true}) {
+    Pipeline pipeline("test_pipeline");
+    CNModuleConfig config1;
+    config1.name = "modulea";
+    config1.className = "cnstream::TPTestModule";
+    config1.parallelism = 1;
+    config1.maxInputQueueSize = 20;
+    config1.next = {"moduleb"};
+    CNModuleConfig config2;
+    config2.name = "moduleb";
+    config2.className = "cnstream::TPBatchRecordModule";
+    config2.parallelism = 2;
+    config2.maxInputQueueSize = 20;
+    config2.maxBatchSize = 4;
+    config2.batchTimeoutUs = 1000;
+    CNGraphConfig graph_config;
+    graph_config.module_configs = {config1, config2};
+    graph_config.scheduler_config.work_stealing = work_stealing;
+    graph_config.scheduler_config.thread_num = 2;
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    TPBatchRecordModule::timestamps_.clear();
+    TPBatchRecordModule::max_batch_size_ = 0;
+    ASSERT_TRUE(pipeline.Start());
+    auto module = pipeline.GetModule("modulea");
+    const int stream_num = 2, frame_num = 100;
+    for (int i = 0; i < frame_num; ++i) {
+      for (int stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+        auto data = CNFrameInfo::Create(std::to_string(stream_idx));
+        data->SetStreamIndex(stream_idx);
+        data->timestamp = i;
+        EXPECT_TRUE(pipeline.ProvideData(module, data));
+      }
+    }
+    for (int retry = 0; retry < 500; ++retry) {
+      size_t processed = 0;
+      {
+        std::lock_guard<std::mutex> lk(TPBatchRecordModule::mtx_);
+        for (const auto& it : TPBatchRecordModule::timestamps_) processed += it.second.size();
+      }
+      if (processed == static_cast<size_t>(stream_num * frame_num)) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    pipeline.Stop();
+    EXPECT_LE(TPBatchRecordModule::max_batch_size_, 4u);
+    ASSERT_EQ(TPBatchRecordModule::timestamps_.size(), static_cast<size_t>(stream_num));
+    for (const auto& it : TPBatchRecordModule::timestamps_) {
+      ASSERT_EQ(it.second.size(), static_cast<size_t>(frame_num));
+      for (int i = 0; i < frame_num; ++i) EXPECT_EQ(it.second[i], i);
+    }
+  }
+}
+
+class TPJitterModule : public Module, public ModuleCreator<TPJitterModule> {
+ public:
+  explicit TPJitterModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    // the later frames may be processed first
+    std::this_thread::sleep_for(std::chrono::milliseconds(2 - frame_info->timestamp % 3));
+    std::lock_guard<std::mutex> lk(mtx_);
+    threads_[frame_info->stream_id].insert(std::this_thread::get_id());
+    return 0;
+  }
+  static std::mutex mtx_;
+  static std::map<std::string, std::set<std::thread::id>> threads_;
+};  // class TPJitterModule
+
+std::mutex TPJitterModule::mtx_;
+std::map<std::string, std::set<std::thread::id>> TPJitterModule::threads_;
+
+TEST(CorePipeline, StreamParallel) {
+  for (bool work_stealing : {false, true}) {
+    Pipeline pipeline("test_pipeline");
+    CNModuleConfig config1;
+    config1.name = "modulea";
+    config1.className = "cnstream::TPTestModule";
+    config1.parallelism = 1;
+    config1.maxInputQueueSize = 20;
+    config1.next = {"moduleb"};
+    CNModuleConfig config2;
+    config2.name = "moduleb";
+    config2.className = "cnstream::TPJitterModule";
+    config2.parallelism = 3;
+    config2.maxInputQueueSize = 4;
+    config2.streamParallel = true;
+    config2.next = {"modulec"};
+    CNModuleConfig config3;
+    config3.name = "modulec";
+    config3.className = "cnstream::TPOrderRecordModule";
+    config3.parallelism = 1;
+    config3.maxInputQueueSize = 20;
+    CNGraphConfig graph_config;
+    graph_config.module_configs = {config1, config2, config3};
+    graph_config.scheduler_config.work_stealing = work_stealing;
+    graph_config.scheduler_config.thread_num = 3;
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    TPJitterModule::threads_.clear();
+    TPOrderRecordModule::timestamps_.clear();
+    ASSERT_TRUE(pipeline.Start());
+    auto module = pipeline.GetModule("modulea");
+    const int stream_num = 2, frame_num = 60;
+    for (int i = 0; i < frame_num; ++i) {
+      for (int stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+        auto data = CNFrameInfo::Create(std::to_string(stream_idx));
+        data->SetStreamIndex(stream_idx);
+        data->timestamp = i;
+        EXPECT_TRUE(pipeline.ProvideData(module, data));
+      }
+    }
+    for (int retry = 0; retry < 500; ++retry) {
+      size_t processed = 0;
+      {
+        std::lock_guard<std::mutex> lk(TPOrderRecordModule::mtx_);
+        for (const auto& it : TPOrderRecordModule::timestamps_) processed += it.second.size();
+      }
+      if (processed == static_cast<size_t>(stream_num * frame_num)) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    pipeline.Stop();
+    // each stream is processed by all threads of the module, and transmitted in order
+    if (!work_stealing) {
+      ASSERT_EQ(TPJitterModule::threads_.size(), static_cast<size_t>(stream_num));
+      for (const auto& it : TPJitterModule::threads_) EXPECT_EQ(it.second.size(), 3u);
+    }
+    ASSERT_EQ(TPOrderRecordModule::timestamps_.size(), static_cast<size_t>(stream_num));
+    for (const auto& it : TPOrderRecordModule::timestamps_) {
+      ASSERT_EQ(it.second.size(), static_cast<size_t>(frame_num));
+      for (int i = 0; i < frame_num; ++i) EXPECT_EQ(it.second[i], i);
+    }
+  }
+}
+
+class TPPrefetchModule : public Module, public ModuleCreator<TPPrefetchModule> {
+ public:
+  explicit TPPrefetchModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  void Prefetch(const std::shared_ptr<CNFrameInfo>& data) override {
+    EXPECT_FALSE(data->IsEos());
+    std::lock_guard<std::mutex> lk(mtx_);
+    prefetched_.insert(data.get());
+  }
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    // the data has been prefetched before it is processed
+    EXPECT_EQ(prefetched_.erase(frame_info.get()), 1u);
+    processed_num_++;
+    return 0;
+  }
+  static std::mutex mtx_;
+  static std::set<CNFrameInfo*> prefetched_;
+  static int processed_num_;
+};  // class TPPrefetchModule
+
+std::mutex TPPrefetchModule::mtx_;
+std::set<CNFrameInfo*> TPPrefetchModule::prefetched_;
+int TPPrefetchModule::processed_num_ = 0;
+
+TEST(CorePipeline, Prefetch) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPPrefetchModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  TPPrefetchModule::prefetched_.clear();
+  TPPrefetchModule::processed_num_ = 0;
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  const int frame_num = 50;
+  std::vector<std::shared_ptr<CNFrameInfo>> frames;
+  for (int i = 0; i < frame_num; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    data->SetStreamIndex(0);
+    data->timestamp = i;
+    frames.push_back(data);
+    EXPECT_TRUE(pipeline.ProvideData(module, data));
+  }
+  for (int retry = 0; retry < 500; ++retry) {
+    {
+      std::lock_guard<std::mutex> lk(TPPrefetchModule::mtx_);
+      if (TPPrefetchModule::processed_num_ == frame_num) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  EXPECT_EQ(TPPrefetchModule::processed_num_, frame_num);
+  EXPECT_TRUE(TPPrefetchModule::prefetched_.empty());
+}
+
+class TPPixelRecordModule : public Module, public ModuleCreator<TPPixelRecordModule> {
+ public:
+  explicit TPPixelRecordModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {
+    needs_pixels_ = params["needs_pixels"] == "true";
+    return true;
+  }
+  void Close() override {}
+  bool NeedsPixels() const override { return needs_pixels_; }
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    // the pixels are kept for the modules reading them only
+    if (frame_info->IsPixelReleased() == needs_pixels_) wrong_num_++;
+    processed_num_++;
+    return 0;
+  }
+  static std::mutex mtx_;
+  static int processed_num_;
+  static int wrong_num_;
+
+ private:
+  bool needs_pixels_ = true;
+};  // class TPPixelRecordModule
+
+std::mutex TPPixelRecordModule::mtx_;
+int TPPixelRecordModule::processed_num_ = 0;
+int TPPixelRecordModule::wrong_num_ = 0;
+static std::atomic<int> s_released_num{0};
+static const bool s_pixel_releaser_registered =
+    CNFrameInfo::RegisterPixelReleaser([](CNFrameInfo* frame) { s_released_num++; });
+
+TEST(CorePipeline, ReleasePixels) {
+  ASSERT_TRUE(s_pixel_releaser_registered);
+  EXPECT_FALSE(CNFrameInfo::RegisterPixelReleaser(nullptr));
+  auto frame = CNFrameInfo::Create("0");
+  int released_num = s_released_num;
+  EXPECT_FALSE(frame->IsPixelReleased());
+  EXPECT_TRUE(frame->ReleasePixels());
+  EXPECT_FALSE(frame->ReleasePixels());
+  EXPECT_TRUE(frame->IsPixelReleased());
+  EXPECT_EQ(s_released_num, released_num + 1);
+
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPPixelRecordModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  config2.parameters = {{"needs_pixels", "true"}};
+  config2.next = {"modulec"};
+  CNModuleConfig config3 = config2;
+  config3.name = "modulec";
+  config3.parameters = {{"needs_pixels", "false"}};
+  config3.next = {};
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2, config3};
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  TPPixelRecordModule::processed_num_ = 0;
+  TPPixelRecordModule::wrong_num_ = 0;
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  const int frame_num = 20;
+  released_num = s_released_num;
+  for (int i = 0; i < frame_num; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    data->SetStreamIndex(0);
+    data->timestamp = i;
+    EXPECT_TRUE(pipeline.ProvideData(module, data));
+  }
+  for (int retry = 0; retry < 500; ++retry) {
+    {
+      std::lock_guard<std::mutex> lk(TPPixelRecordModule::mtx_);
+      if (TPPixelRecordModule::processed_num_ == 2 * frame_num) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  EXPECT_EQ(TPPixelRecordModule::processed_num_, 2 * frame_num);
+  EXPECT_EQ(TPPixelRecordModule::wrong_num_, 0);
+  EXPECT_EQ(s_released_num, released_num + frame_num);
+}
+
+static std::atomic<int> s_host_released_num{0};
+static std::atomic<int> s_device_released_num{0};
+static const bool s_pixel_copy_releaser_registered =
+    CNFrameInfo::RegisterPixelCopyReleaser([](CNFrameInfo* frame, CNFrameInfo::PixelCopy copy) {
+      if (copy == CNFrameInfo::PixelCopy::HOST) {
+        s_host_released_num++;
+      } else {
+        s_device_released_num++;
+      }
+    });
+
+class TPPixelCopyModule : public Module, public ModuleCreator<TPPixelCopyModule> {
+ public:
+  explicit TPPixelCopyModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {
+    host_ = params["side"] == "host";
+    return true;
+  }
+  void Close() override {}
+  bool NeedsHostPixels() const override { return host_; }
+  bool NeedsDevicePixels() const override { return !host_; }
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    // the copy on host is released once the modules reading it have been passed
+    if (!host_ && s_host_released_num.load() <= host_released_num_++) wrong_num_++;
+    return 0;
+  }
+  static std::atomic<int> host_released_num_;
+  static std::atomic<int> wrong_num_;
+
+ private:
+  bool host_ = true;
+};  // class TPPixelCopyModule
+
+std::atomic<int> TPPixelCopyModule::host_released_num_{0};
+std::atomic<int> TPPixelCopyModule::wrong_num_{0};
+
+TEST(CorePipeline, ReleasePixelCopy) {
+  ASSERT_TRUE(s_pixel_copy_releaser_registered);
+  EXPECT_FALSE(CNFrameInfo::RegisterPixelCopyReleaser(nullptr));
+  auto frame = CNFrameInfo::Create("0");
+  int host_released_num = s_host_released_num;
+  EXPECT_TRUE(frame->ReleasePixelCopy(CNFrameInfo::PixelCopy::HOST));
+  EXPECT_FALSE(frame->ReleasePixelCopy(CNFrameInfo::PixelCopy::HOST));
+  EXPECT_EQ(s_host_released_num, host_released_num + 1);
+  // the copies are gone with the pixels
+  EXPECT_TRUE(frame->ReleasePixels());
+  EXPECT_FALSE(frame->ReleasePixelCopy(CNFrameInfo::PixelCopy::DEVICE));
+
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPPixelCopyModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  config2.parameters = {{"side", "host"}};
+  config2.next = {"modulec"};
+  CNModuleConfig config3 = config2;
+  config3.name = "modulec";
+  config3.parameters = {{"side", "device"}};
+  config3.next = {};
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2, config3};
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  const int frame_num = 20;
+  host_released_num = s_host_released_num;
+  const int device_released_num = s_device_released_num;
+  const int released_num = s_released_num;
+  TPPixelCopyModule::host_released_num_ = host_released_num;
+  TPPixelCopyModule::wrong_num_ = 0;
+  for (int i = 0; i < frame_num; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    data->SetStreamIndex(0);
+    data->timestamp = i;
+    EXPECT_TRUE(pipeline.ProvideData(module, data));
+  }
+  for (int retry = 0; retry < 500 && s_released_num != released_num + frame_num; ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  EXPECT_EQ(TPPixelCopyModule::wrong_num_, 0);
+  EXPECT_EQ(s_host_released_num, host_released_num + frame_num);
+  // the pixels are released as a whole after the last module
+  EXPECT_EQ(s_device_released_num, device_released_num);
+  EXPECT_EQ(s_released_num, released_num + frame_num);
+}
+
+class TPSlowRecordModule : public Module, public ModuleCreator<TPSlowRecordModule> {
+ public:
+  explicit TPSlowRecordModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    std::lock_guard<std::mutex> lk(mtx_);
+    timestamps_[frame_info->stream_id].push_back(frame_info->timestamp);
+    return 0;
+  }
+  static std::mutex mtx_;
+  static std::map<std::string, std::vector<int64_t>> timestamps_;
+};  // class TPSlowRecordModule
+
+std::mutex TPSlowRecordModule::mtx_;
+std::map<std::string, std::vector<int64_t>> TPSlowRecordModule::timestamps_;
+
+TEST(CorePipeline, Autoscale) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPSlowRecordModule";
+  config2.parallelism = 1;
+  config2.minParallelism = 1;
+  config2.maxParallelism = 3;
+  config2.maxInputQueueSize = 4;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  graph_config.autoscaler_config.enable = true;
+  graph_config.autoscaler_config.interval_ms = 20;
+  graph_config.autoscaler_config.stable_intervals = 2;
+  // parallelism out of range
+  graph_config.module_configs[1].minParallelism = 2;
+  EXPECT_FALSE(pipeline.BuildPipeline(graph_config));
+  graph_config.module_configs[1].minParallelism = 1;
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  TPSlowRecordModule::timestamps_.clear();
+  EXPECT_TRUE(pipeline.GetModuleStates().empty());
+  ASSERT_TRUE(pipeline.Start());
+  auto states = pipeline.GetModuleStates();
+  ASSERT_EQ(states.size(), 1u);
+  EXPECT_EQ(states[0].module_name, pipeline.GetModule("moduleb")->GetName());
+  EXPECT_EQ(states[0].parallelism, 1u);
+  EXPECT_EQ(states[0].max_parallelism, 3u);
+  auto module = pipeline.GetModule("modulea");
+  const int stream_num = 4, frame_num = 100;
+  for (int i = 0; i < frame_num; ++i) {
+    for (int stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+      auto data = CNFrameInfo::Create(std::to_string(stream_idx));
+      data->SetStreamIndex(stream_idx);
+      data->timestamp = i;
+      EXPECT_TRUE(pipeline.ProvideData(module, data));
+    }
+  }
+  // wait for all data processed and the module scaled down
+  auto scaled_down = [&] {
+    auto decisions = pipeline.GetAutoscaleDecisions();
+    return !decisions.empty() && decisions.back().new_parallelism < decisions.back().old_parallelism;
+  };
+  for (int retry = 0; retry < 500 && !scaled_down(); ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto decisions = pipeline.GetAutoscaleDecisions();
+  pipeline.Stop();
+  ASSERT_FALSE(decisions.empty());
+  EXPECT_EQ(decisions.front().module_name, pipeline.GetModule("moduleb")->GetName());
+  EXPECT_EQ(decisions.front().old_parallelism, 1u);
+  EXPECT_EQ(decisions.front().new_parallelism, 2u);
+  EXPECT_TRUE(scaled_down());
+  ASSERT_EQ(TPSlowRecordModule::timestamps_.size(), static_cast<size_t>(stream_num));
+  for (const auto& it : TPSlowRecordModule::timestamps_) {
+    ASSERT_EQ(it.second.size(), static_cast<size_t>(frame_num));
+    for (int i = 0; i < frame_num; ++i) EXPECT_EQ(it.second[i], i);
+  }
+}
+
+class TPFailFirstModule : public Module, public ModuleCreator<TPFailFirstModule> {
+ public:
+  explicit TPFailFirstModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    if (0 == frame_info->timestamp) return -1;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::lock_guard<std::mutex> lk(mtx_);
+    timestamps_.push_back(frame_info->timestamp);
+    threads_.insert(std::this_thread::get_id());
+    return 0;
+  }
+  static std::mutex mtx_;
+  static std::vector<int64_t> timestamps_;
+  static std::set<std::thread::id> threads_;
+};  // class TPFailFirstModule
+
+std::mutex TPFailFirstModule::mtx_;
+std::vector<int64_t> TPFailFirstModule::timestamps_;
+std::set<std::thread::id> TPFailFirstModule::threads_;
+
+TEST(CorePipeline, MigrateStreamAfterFailure) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPFailFirstModule";
+  config2.parallelism = 2;
+  config2.maxInputQueueSize = 8;
+  config2.rebalanceStreams = true;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  TPFailFirstModule::timestamps_.clear();
+  TPFailFirstModule::threads_.clear();
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  // the first frame fails, the stream is still moved to the idle conveyor once its queue is full
+  const int frame_num = 200;
+  for (int i = 0; i < frame_num; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    data->SetStreamIndex(0);
+    data->timestamp = i;
+    EXPECT_TRUE(pipeline.ProvideData(module, data));
+  }
+  for (int retry = 0; retry < 500; ++retry) {
+    {
+      std::lock_guard<std::mutex> lk(TPFailFirstModule::mtx_);
+      if (TPFailFirstModule::timestamps_.size() == static_cast<size_t>(frame_num - 1)) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  ASSERT_EQ(TPFailFirstModule::timestamps_.size(), static_cast<size_t>(frame_num - 1));
+  for (int i = 1; i < frame_num; ++i) EXPECT_EQ(TPFailFirstModule::timestamps_[i - 1], i);
+  EXPECT_EQ(TPFailFirstModule::threads_.size(), 2u);
+}
+
+class TPFailBatchModule : public Module, public ModuleCreator<TPFailBatchModule> {
+ public:
+  explicit TPFailBatchModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override { return -1; }
+  int ProcessBatch(std::vector<std::shared_ptr<CNFrameInfo>>& data_vec) override {  // NOLINT
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    if (failing_) return -1;
+    std::lock_guard<std::mutex> lk(mtx_);
+    threads_.insert(std::this_thread::get_id());
+    processed_ += data_vec.size();
+    return 0;
+  }
+  static std::atomic<bool> failing_;
+  static std::mutex mtx_;
+  static std::set<std::thread::id> threads_;
+  static size_t processed_;
+};  // class TPFailBatchModule
+
+std::atomic<bool> TPFailBatchModule::failing_{false};
+std::mutex TPFailBatchModule::mtx_;
+std::set<std::thread::id> TPFailBatchModule::threads_;
+size_t TPFailBatchModule::processed_ = 0;
+
+TEST(CorePipeline, AutoscaleAfterFailedBatches) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPFailBatchModule";
+  config2.parallelism = 2;
+  config2.minParallelism = 1;
+  config2.maxParallelism = 2;
+  config2.maxInputQueueSize = 8;
+  config2.maxBatchSize = 4;
+  config2.batchTimeoutUs = 1000;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  graph_config.autoscaler_config.enable = true;
+  graph_config.autoscaler_config.interval_ms = 20;
+  graph_config.autoscaler_config.stable_intervals = 2;
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  TPFailBatchModule::failing_ = true;
+  TPFailBatchModule::threads_.clear();
+  TPFailBatchModule::processed_ = 0;
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  const int stream_num = 4, frame_num = 50;
+  auto send = [&](int begin) {
+    for (int i = begin; i < begin + frame_num; ++i) {
+      for (int stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+        auto data = CNFrameInfo::Create(std::to_string(stream_idx));
+        data->SetStreamIndex(stream_idx);
+        data->timestamp = i;
+        EXPECT_TRUE(pipeline.ProvideData(module, data));
+      }
+    }
+  };
+  // the streams are spread over both conveyors and all the batches fail
+  send(0);
+  auto scaled_down = [&] {
+    auto decisions = pipeline.GetAutoscaleDecisions();
+    return !decisions.empty() && decisions.back().new_parallelism < decisions.back().old_parallelism;
+  };
+  for (int retry = 0; retry < 500 && !scaled_down(); ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_TRUE(scaled_down());
+  // the streams of the retired conveyor are moved, the remaining thread processes all the frames
+  TPFailBatchModule::failing_ = false;
+  send(frame_num);
+  for (int retry = 0; retry < 500; ++retry) {
+    {
+      std::lock_guard<std::mutex> lk(TPFailBatchModule::mtx_);
+      if (TPFailBatchModule::processed_ == static_cast<size_t>(stream_num * frame_num)) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  EXPECT_EQ(TPFailBatchModule::processed_, static_cast<size_t>(stream_num * frame_num));
+  EXPECT_EQ(TPFailBatchModule::threads_.size(), 1u);
+}
+
+TEST(CorePipeline, LatencyBreakdown) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPSlowRecordModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  config2.next = {"modulec"};
+  CNModuleConfig config3 = config1;
+  config3.name = "modulec";
+  config3.next = {};
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2, config3};
+  graph_config.profiler_config.enable_profiling = true;
+  graph_config.profiler_config.enable_latency_breakdown = true;
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  std::mutex mtx;
+  int ordered_num = 0, done_num = 0;
+  pipeline.RegisterFrameDoneCallBack([&](std::shared_ptr<CNFrameInfo> data) {
+    if (data->IsEos()) return;
+    bool ordered = true;
+    for (const char* name : {"modulea", "moduleb", "modulec"}) {
+      const auto& times = data->GetModuleTimes().at(pipeline.GetModule(name)->GetId());
+      ordered = ordered && times.enqueue > 0 && times.enqueue <= times.dequeue && times.dequeue <= times.done;
+    }
+    std::lock_guard<std::mutex> lk(mtx);
+    ordered_num += ordered;
+    done_num++;
+  });
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  const int frame_num = 20;
+  for (int i = 0; i < frame_num; ++i) {
+    auto data = CNFrameInfo::Create("latency_breakdown");
+    data->SetStreamIndex(0);
+    data->timestamp = i;
+    EXPECT_TRUE(pipeline.ProvideData(module, data));
+  }
+  for (int retry = 0; retry < 500; ++retry) {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      if (done_num == frame_num) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto profile = pipeline.GetProfiler()->GetProfile();
+  pipeline.Stop();
+  EXPECT_EQ(ordered_num, frame_num);
+  ASSERT_EQ(profile.latency_breakdowns.size(), 1u);
+  const auto& breakdown = profile.latency_breakdowns[0];
+  EXPECT_EQ(breakdown.stream_name, "latency_breakdown");
+  EXPECT_EQ(breakdown.frames, static_cast<uint64_t>(frame_num));
+  // the frames are provided at once and queued by the slow module
+  EXPECT_EQ(breakdown.bottleneck_module, pipeline.GetModule("moduleb")->GetName());
+  ASSERT_EQ(breakdown.modules.size(), 3u);
+  EXPECT_EQ(breakdown.modules[1].module_name, pipeline.GetModule("moduleb")->GetName());
+  EXPECT_EQ(breakdown.modules[1].critical_frames, static_cast<uint64_t>(frame_num));
+  EXPECT_GE(breakdown.modules[1].process, 2.0);
+  EXPECT_GT(breakdown.modules[1].maximum_queue_wait, breakdown.modules[2].maximum_queue_wait);
+  EXPECT_GE(breakdown.latency, breakdown.modules[1].queue_wait + breakdown.modules[1].process);
+
+  // the times are not recorded if the latency is not broken down
+  graph_config.profiler_config.enable_latency_breakdown = false;
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  EXPECT_TRUE(pipeline.GetProfiler()->GetProfile().latency_breakdowns.empty());
+}
+
+TEST(CorePipeline, TraceSampling) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPSlowRecordModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  config2.next = {"modulec"};
+  CNModuleConfig config3 = config1;
+  config3.name = "modulec";
+  config3.next = {};
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2, config3};
+  graph_config.profiler_config.enable_profiling = true;
+  graph_config.profiler_config.enable_tracing = true;
+  // no frame is traced until moduleb takes more than 1ms
+  graph_config.profiler_config.trace_sample_interval = 0;
+  graph_config.profiler_config.trace_latency_threshold = 1;
+  graph_config.profiler_config.trace_burst_duration = 60 * 1000;
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  TraceSampler* sampler = pipeline.GetTracer()->GetSampler();
+  ASSERT_NE(nullptr, sampler);
+  EXPECT_TRUE(pipeline.GetTracer()->GetTrace(Time::min(), Time::max()).module_traces.empty());
+  std::atomic<int> done_num{0};
+  pipeline.RegisterFrameDoneCallBack([&](std::shared_ptr<CNFrameInfo> data) {
+    if (!data->IsEos()) done_num++;
+  });
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  const int frame_num = 5;
+  for (int i = 0; i < frame_num; ++i) {
+    auto data = CNFrameInfo::Create("trace_sampling");
+    data->SetStreamIndex(0);
+    data->timestamp = i;
+    EXPECT_TRUE(pipeline.ProvideData(module, data));
+  }
+  for (int retry = 0; retry < 500 && done_num < frame_num; ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  EXPECT_EQ(frame_num, done_num);
+  // the window is opened once and extended by the other frames
+  EXPECT_EQ(1u, sampler->GetBurstNumber());
+  EXPECT_TRUE(sampler->IsBursting(Clock::now()));
+  PipelineTrace trace = pipeline.GetTracer()->GetTrace(Time::min(), Time::max());
+  EXPECT_TRUE(trace.module_traces.count(pipeline.GetModule("modulec")->GetName()));
+
+  // all frames are traced without sampling
+  graph_config.profiler_config.trace_sample_interval = 1;
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  EXPECT_EQ(nullptr, pipeline.GetTracer()->GetSampler());
+}
+
+TEST(CorePipeline, Metrics) {
+  Pipeline pipeline("test_pipeline");
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2 = config1;
+  config2.name = "moduleb";
+  config2.parallelism = 2;
+  config2.next = {};
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  graph_config.metrics_config.enable = true;
+  graph_config.metrics_config.port = 0;
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  // the frames are not counted without profiling
+  std::string metrics = pipeline.GetMetrics();
+  EXPECT_EQ(metrics.find("cnstream_frames_total"), std::string::npos);
+  EXPECT_EQ(pipeline.GetMetricsExporter(), nullptr);
+
+  graph_config.profiler_config.enable_profiling = true;
+  graph_config.profiler_config.enable_perf_counters = true;
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  pipeline.GetProfiler()->SetDeviceUtilizationSampler([] {
+    DeviceUtilization device;
+    device.device_id = 1;
+    device.core_utilization = 50;
+    return std::vector<DeviceUtilization>{device};
+  });
+  std::mutex mtx;
+  int done_num = 0;
+  pipeline.RegisterFrameDoneCallBack([&](std::shared_ptr<CNFrameInfo> data) {
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!data->IsEos()) done_num++;
+  });
+  ASSERT_TRUE(pipeline.Start());
+  ASSERT_NE(pipeline.GetMetricsExporter(), nullptr);
+  EXPECT_NE(pipeline.GetMetricsExporter()->GetPort(), 0);
+  auto module = pipeline.GetModule("modulea");
+  const int frame_num = 10;
+  for (int i = 0; i < frame_num; ++i) {
+    auto data = CNFrameInfo::Create("metrics");
+    data->SetStreamIndex(0);
+    data->timestamp = i;
+    EXPECT_TRUE(pipeline.ProvideData(module, data));
+  }
+  for (int retry = 0; retry < 500; ++retry) {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      if (done_num == frame_num) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  metrics = pipeline.GetMetrics();
+  pipeline.Stop();
+  EXPECT_EQ(pipeline.GetMetricsExporter(), nullptr);
+  const std::string moduleb = pipeline.GetModule("moduleb")->GetName();
+  EXPECT_NE(metrics.find("# TYPE cnstream_module_parallelism gauge\n"), std::string::npos);
+  EXPECT_NE(metrics.find("cnstream_module_parallelism{pipeline=\"test_pipeline\",module=\"" + moduleb + "\"} 2\n"),
+            std::string::npos);
+  EXPECT_NE(metrics.find("cnstream_module_queue_capacity{pipeline=\"test_pipeline\",module=\"" + moduleb +
+                         "\"} 40\n"), std::string::npos);
+  EXPECT_NE(metrics.find("cnstream_frames_total{pipeline=\"test_pipeline\",process=\"OVERALL\"} 10\n"),
+            std::string::npos);
+  EXPECT_NE(metrics.find("cnstream_latency_seconds_count{pipeline=\"test_pipeline\",process=\"OVERALL\"} 10\n"),
+            std::string::npos);
+  EXPECT_NE(metrics.find(",quantile=\"0.99\"}"), std::string::npos);
+  EXPECT_NE(metrics.find("# TYPE cnstream_memory_bytes gauge\n"), std::string::npos);
+  EXPECT_NE(metrics.find("# TYPE cnstream_memory_pool_bytes gauge\n"), std::string::npos);
+  // the last frames may be done before their samples are added
+  EXPECT_NE(metrics.find("cnstream_module_events_total{pipeline=\"test_pipeline\",module=\"" + moduleb +
+                         "\",name=\"perf_samples\"} "), std::string::npos);
+  EXPECT_NE(metrics.find("cnstream_module_received_frames_total{pipeline=\"test_pipeline\",module=\"" + moduleb +
+                         "\"} 10\n"), std::string::npos);
+  EXPECT_NE(metrics.find("# TYPE cnstream_module_stalled_seconds counter\n"), std::string::npos);
+  EXPECT_NE(metrics.find("cnstream_device_utilization_ratio{pipeline=\"test_pipeline\",device=\"1\",type=\"core\"} "
+                         "0.5\n"), std::string::npos);
+  EXPECT_EQ(metrics.find("type=\"memory\""), std::string::npos);
+  EXPECT_EQ(metrics.substr(metrics.size() - 6), "# EOF\n");
+}
+
+static FrameAccounting GetFrameAccounting(Pipeline* pipeline, const std::string& module_name) {
+  for (const auto& module_profile : pipeline->GetProfiler()->GetProfile().module_profiles) {
+    if (module_profile.module_name == module_name) return module_profile.frame_accounting;
+  }
+  return FrameAccounting();
+}
+
+TEST(CorePipeline, FrameAccounting) {
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPSlowRecordModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 1;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  graph_config.profiler_config.enable_profiling = true;
+  const uint64_t frame_num = 20;
+  for (QueueFullPolicy policy : {QueueFullPolicy::DROP_NEWEST, QueueFullPolicy::BLOCK}) {
+    graph_config.module_configs[1].queueFullPolicy = policy;
+    Pipeline pipeline("test_pipeline");
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    std::atomic<uint64_t> done_num{0};
+    pipeline.RegisterFrameDoneCallBack([&](std::shared_ptr<CNFrameInfo> data) {
+      if (!data->IsEos()) done_num++;
+    });
+    ASSERT_TRUE(pipeline.Start());
+    auto module = pipeline.GetModule("modulea");
+    const std::string moduleb = pipeline.GetModule("moduleb")->GetName();
+    for (uint64_t i = 0; i < frame_num; ++i) {
+      auto data = CNFrameInfo::Create("accounting");
+      data->SetStreamIndex(0);
+      data->timestamp = i;
+      EXPECT_TRUE(pipeline.ProvideData(module, data));
+    }
+    FrameAccounting accounting;
+    for (int retry = 0; retry < 500; ++retry) {
+      accounting = GetFrameAccounting(&pipeline, moduleb);
+      if (accounting.received == frame_num && done_num + accounting.dropped == frame_num) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::vector<FrameAccounting> stream_accountings;
+    for (const auto& module_profile : pipeline.GetProfiler()->GetProfile().module_profiles) {
+      if (module_profile.module_name == moduleb) stream_accountings = module_profile.stream_frame_accountings;
+    }
+    pipeline.Stop();
+    EXPECT_EQ(accounting.received, frame_num);
+    EXPECT_EQ(done_num + accounting.dropped, frame_num);
+    ASSERT_EQ(stream_accountings.size(), 1u);
+    EXPECT_EQ(stream_accountings[0].stream_name, "accounting");
+    EXPECT_EQ(stream_accountings[0].received, frame_num);
+    if (policy == QueueFullPolicy::DROP_NEWEST) {
+      // the slow module can not keep up with the frames
+      EXPECT_GT(accounting.dropped, 0u);
+      ASSERT_EQ(accounting.dropped_by_reason.size(), 1u);
+      EXPECT_EQ(accounting.dropped_by_reason[0].first, kDROP_REASON_QUEUE_FULL);
+      EXPECT_EQ(accounting.dropped_by_reason[0].second, accounting.dropped);
+    } else {
+      EXPECT_EQ(accounting.dropped, 0u);
+      EXPECT_GT(accounting.stalled, 0);
+    }
+  }
+}
+
+TEST(CorePipeline, DropLateFrames) {
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPSlowRecordModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  graph_config.profiler_config.enable_profiling = true;
+  Pipeline pipeline("test_pipeline");
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  EXPECT_FALSE(pipeline.SetStreamMaxLatency("late", -1));
+  EXPECT_TRUE(pipeline.SetStreamMaxLatency("late", 5));
+  std::atomic<uint64_t> done_num{0};
+  pipeline.RegisterFrameDoneCallBack([&](std::shared_ptr<CNFrameInfo> data) {
+    if (!data->IsEos()) done_num++;
+  });
+  TPSlowRecordModule::timestamps_.clear();
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  const std::string moduleb = pipeline.GetModule("moduleb")->GetName();
+  const uint64_t frame_num = 20;
+  for (uint64_t i = 0; i < frame_num; ++i) {
+    auto data = CNFrameInfo::Create("late");
+    data->SetStreamIndex(0);
+    data->timestamp = i;
+    EXPECT_TRUE(pipeline.ProvideData(module, data));
+  }
+  FrameAccounting accounting;
+  for (int retry = 0; retry < 500; ++retry) {
+    accounting = GetFrameAccounting(&pipeline, moduleb);
+    if (accounting.received == frame_num && done_num + accounting.dropped == frame_num) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  // the frames waiting behind the slow module expire, they are dropped before being processed
+  EXPECT_EQ(done_num + accounting.dropped, frame_num);
+  EXPECT_GT(accounting.dropped, 0u);
+  ASSERT_EQ(accounting.dropped_by_reason.size(), 1u);
+  EXPECT_EQ(accounting.dropped_by_reason[0].first, kDROP_REASON_LATE);
+  EXPECT_EQ(TPSlowRecordModule::timestamps_["late"].size(), done_num.load());
+}
+
+class TPFlakyModule : public Module, public ModuleCreator<TPFlakyModule> {
+ public:
+  explicit TPFlakyModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {
+    if (!frame_info->IsEos()) ++processed_;
+    return failing_ && !frame_info->IsEos() ? -1 : 0;
+  }
+  static std::atomic<bool> failing_;
+  static std::atomic<int> processed_;
+};  // class TPFlakyModule
+
+std::atomic<bool> TPFlakyModule::failing_{false};
+std::atomic<int> TPFlakyModule::processed_{0};
+
+TEST(CorePipeline, CircuitBreaker) {
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPFlakyModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  config2.circuitBreaker.enable = true;
+  config2.circuitBreaker.failure_threshold = 3;
+  config2.circuitBreaker.open_ms = 100;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  graph_config.profiler_config.enable_profiling = true;
+  Pipeline pipeline("test_pipeline");
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  std::mutex mtx;
+  std::vector<std::string> messages;
+  pipeline.GetEventBus()->AddBusWatch([&](const Event& event) {
+    std::lock_guard<std::mutex> lk(mtx);
+    messages.push_back(event.message);
+    return EventHandleFlag::EVENT_HANDLE_SYNCED;
+  }, EventFilter{{EventType::EVENT_CIRCUIT_BREAKER}, ""});
+  std::atomic<uint64_t> done_num{0};
+  pipeline.RegisterFrameDoneCallBack([&](std::shared_ptr<CNFrameInfo> data) {
+    if (!data->IsEos()) done_num++;
+  });
+  TPFlakyModule::failing_ = true;
+  TPFlakyModule::processed_ = 0;
+  ASSERT_TRUE(pipeline.Start());
+  auto module = pipeline.GetModule("modulea");
+  const std::string moduleb = pipeline.GetModule("moduleb")->GetName();
+  // the frames are sent one by one, so that the breaker is checked after the previous frame is processed
+  auto send = [&](uint64_t frame_num) {
+    for (uint64_t i = 0; i < frame_num; ++i) {
+      const uint64_t expected = done_num + 1;
+      auto data = CNFrameInfo::Create("breaker");
+      data->SetStreamIndex(0);
+      data->timestamp = i;
+      EXPECT_TRUE(pipeline.ProvideData(module, data));
+      for (int retry = 0; retry < 500 && done_num < expected; ++retry) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      ASSERT_EQ(done_num, expected);
+    }
+  };
+  // the failed frames go on, the breaker opens after 3 failures and the other frames bypass the module
+  send(10);
+  EXPECT_EQ(TPFlakyModule::processed_, 3);
+  // a probe is let in after open_ms, the breaker closes as the module recovers
+  TPFlakyModule::failing_ = false;
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  send(5);
+  EXPECT_EQ(TPFlakyModule::processed_, 8);
+  for (int retry = 0; retry < 500; ++retry) {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      if (messages.size() >= 3u) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  FrameAccounting accounting = GetFrameAccounting(&pipeline, moduleb);
+  pipeline.Stop();
+  ASSERT_EQ(messages.size(), 3u);
+  EXPECT_EQ(messages[0].find("circuit breaker open"), 0u);
+  EXPECT_EQ(messages[1].find("circuit breaker half open"), 0u);
+  EXPECT_EQ(messages[2].find("circuit breaker closed"), 0u);
+  EXPECT_EQ(accounting.received, 15u);
+  EXPECT_EQ(accounting.dropped, 7u);
+  ASSERT_EQ(accounting.dropped_by_reason.size(), 1u);
+  EXPECT_EQ(accounting.dropped_by_reason[0].first, kDROP_REASON_BYPASSED);
+}
+
+TEST(CorePipeline, Degradation) {
+  CNModuleConfig config1;
+  config1.name = "modulea";
+  config1.className = "cnstream::TPTestModule";
+  config1.parallelism = 1;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"moduleb"};
+  CNModuleConfig config2;
+  config2.name = "moduleb";
+  config2.className = "cnstream::TPFlakyModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  graph_config.profiler_config.enable_profiling = true;
+  graph_config.degradation_config.enable = true;
+  graph_config.degradation_config.interval_ms = 100000;  // the level is set by hand
+  DegradationStep step;
+  step.modules = {"moduleb"};
+  step.action = DegradationAction::SKIP_FRAMES;
+  step.interval = 2;
+  graph_config.degradation_config.steps.push_back(step);
+  step.action = DegradationAction::BYPASS;
+  graph_config.degradation_config.steps.push_back(step);
+  {
+    // the frames of a head module can not be skipped
+    CNGraphConfig head_config = graph_config;
+    head_config.degradation_config.steps[0].modules = {"modulea"};
+    Pipeline pipeline("test_pipeline");
+    EXPECT_FALSE(pipeline.BuildPipeline(head_config));
+    head_config.degradation_config.steps[0].modules = {"unknown"};
+    EXPECT_FALSE(pipeline.BuildPipeline(head_config));
+  }
+  Pipeline pipeline("test_pipeline");
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  std::mutex mtx;
+  std::vector<std::string> messages;
+  pipeline.GetEventBus()->AddBusWatch([&](const Event& event) {
+    std::lock_guard<std::mutex> lk(mtx);
+    messages.push_back(event.message);
+    return EventHandleFlag::EVENT_HANDLE_SYNCED;
+  }, EventFilter{{EventType::EVENT_DEGRADATION}, ""});
+  std::atomic<uint64_t> done_num{0};
+  pipeline.RegisterFrameDoneCallBack([&](std::shared_ptr<CNFrameInfo> data) {
+    if (!data->IsEos()) done_num++;
+  });
+  TPFlakyModule::failing_ = false;
+  TPFlakyModule::processed_ = 0;
+  ASSERT_TRUE(pipeline.Start());
+  EXPECT_TRUE(pipeline.SetStreamPriority("important", 1));
+  auto module = pipeline.GetModule("modulea");
+  const std::string moduleb = pipeline.GetModule("moduleb")->GetName();
+  auto send = [&](const std::string& stream_id, uint32_t stream_index, uint64_t frame_num) {
+    for (uint64_t i = 0; i < frame_num; ++i) {
+      const uint64_t expected = done_num + 1;
+      auto data = CNFrameInfo::Create(stream_id);
+      data->SetStreamIndex(stream_index);
+      data->timestamp = i;
+      EXPECT_TRUE(pipeline.ProvideData(module, data));
+      for (int retry = 0; retry < 500 && done_num < expected; ++retry) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      ASSERT_EQ(done_num, expected);
+    }
+  };
+  // one of every 2 frames of the streams with priority 0 is processed
+  EXPECT_TRUE(pipeline.SetDegradationLevel(1));
+  EXPECT_EQ(pipeline.GetDegradationLevel(), 1u);
+  send("normal", 0, 10);
+  EXPECT_EQ(TPFlakyModule::processed_, 5);
+  send("important", 1, 10);
+  EXPECT_EQ(TPFlakyModule::processed_, 15);
+  // all frames of the streams with priority 0 bypass the module
+  EXPECT_TRUE(pipeline.SetDegradationLevel(2));
+  send("normal", 0, 10);
+  EXPECT_EQ(TPFlakyModule::processed_, 15);
+  // the steps are undone
+  EXPECT_TRUE(pipeline.SetDegradationLevel(0));
+  send("normal", 0, 10);
+  EXPECT_EQ(TPFlakyModule::processed_, 25);
+  FrameAccounting accounting = GetFrameAccounting(&pipeline, moduleb);
+  for (int retry = 0; retry < 500; ++retry) {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      if (messages.size() >= 4u) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pipeline.Stop();
+  ASSERT_EQ(messages.size(), 4u);
+  EXPECT_EQ(messages[0], "degradation level 1, applied skip_frames of [moduleb]");
+  EXPECT_EQ(messages[1], "degradation level 2, applied bypass of [moduleb]");
+  EXPECT_EQ(messages[2], "degradation level 1, undone bypass of [moduleb]");
+  EXPECT_EQ(messages[3], "degradation level 0, undone skip_frames of [moduleb]");
+  EXPECT_EQ(accounting.received, 40u);
+  EXPECT_EQ(accounting.dropped, 15u);
+  ASSERT_EQ(accounting.dropped_by_reason.size(), 1u);
+  EXPECT_EQ(accounting.dropped_by_reason[0].first, kDROP_REASON_DEGRADED);
+}
+
+class TPSlowOpenModule : public Module, public ModuleCreator<TPSlowOpenModule> {
+ public:
+  explicit TPSlowOpenModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    return params.find("fail") == params.end();
+  }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {return 0;}
+};  // class TPSlowOpenModule
+
+TEST(CorePipeline, ParallelOpen) {
+  CNGraphConfig graph_config;
+  for (const std::string name : {"modulea", "moduleb", "modulec"}) {
+    CNModuleConfig config;
+    config.name = name;
+    config.className = "cnstream::TPSlowOpenModule";
+    config.parallelism = 1;
+    config.maxInputQueueSize = 20;
+    graph_config.module_configs.push_back(config);
+  }
+  graph_config.module_configs[0].next = {"moduleb", "modulec"};
+  graph_config.profiler_config.enable_profiling = true;
+  auto get_profiles = [](Pipeline* pipeline) {
+    std::map<std::string, ModuleProfile> profiles;
+    for (const auto& profile : pipeline->GetProfiler()->GetProfile().module_profiles) {
+      profiles[profile.module_name] = profile;
+    }
+    return profiles;
+  };
+  // case1: opened one by one
+  {
+    Pipeline pipeline("test_pipeline");
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    ASSERT_TRUE(pipeline.Start());
+    EXPECT_GE(pipeline.GetProfiler()->GetProfile().startup_time, 300);
+    pipeline.Stop();
+  }
+  graph_config.scheduler_config.parallel_open = true;
+  // case2: opened at the same time
+  {
+    Pipeline pipeline("test_pipeline");
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    ASSERT_TRUE(pipeline.Start());
+    const double startup_time = pipeline.GetProfiler()->GetProfile().startup_time;
+    EXPECT_GE(startup_time, 100);
+    EXPECT_LT(startup_time, 300);
+    auto profiles = get_profiles(&pipeline);
+    ASSERT_EQ(profiles.size(), 3u);
+    for (const auto& it : profiles) {
+      EXPECT_GE(it.second.open_time, 100);
+      EXPECT_LE(it.second.open_begin + it.second.open_time, startup_time);
+    }
+    pipeline.Stop();
+  }
+  // case3: modulea is opened after modulec
+  graph_config.module_configs[0].openAfter = {"modulec"};
+  {
+    Pipeline pipeline("test_pipeline");
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    ASSERT_TRUE(pipeline.Start());
+    auto profiles = get_profiles(&pipeline);
+    const ModuleProfile& modulea = profiles[pipeline.GetModule("modulea")->GetName()];
+    const ModuleProfile& moduleb = profiles[pipeline.GetModule("moduleb")->GetName()];
+    const ModuleProfile& modulec = profiles[pipeline.GetModule("modulec")->GetName()];
+    EXPECT_GE(modulea.open_begin, modulec.open_begin + modulec.open_time);
+    EXPECT_LT(moduleb.open_begin, modulec.open_time);
+    pipeline.Stop();
+  }
+  // case4: open failed, the modules depending on it are not opened
+  graph_config.module_configs[2].parameters["fail"] = "true";
+  {
+    Pipeline pipeline("test_pipeline");
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    EXPECT_FALSE(pipeline.Start());
+    EXPECT_FALSE(pipeline.IsRunning());
+  }
+  graph_config.module_configs[2].parameters.clear();
+  // case5: unknown module or cycle
+  for (const std::string name : {"moduled", "modulea"}) {
+    graph_config.module_configs[2].openAfter = {name};
+    Pipeline pipeline("test_pipeline");
+    ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+    EXPECT_FALSE(pipeline.Start());
+  }
+}
+
+class TPTestSource : public SourceModule, public ModuleCreator<TPTestSource> {
+ public:
+  explicit TPTestSource(const std::string& name) : SourceModule(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override { RemoveSources(); }
+};  // class TPTestSource
+
+class TPTestSourceHandler : public SourceHandler {
+ public:
+  TPTestSourceHandler(SourceModule* module, const std::string& stream_id) : SourceHandler(module, stream_id) {}
+  bool Open() override {return true;}
+  void Close() override {}
+};  // class TPTestSourceHandler
+
+class TPStreamAddedModule : public Module, public ModuleCreator<TPStreamAddedModule> {
+ public:
+  explicit TPStreamAddedModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {return 0;}
+  void OnStreamAdded(const std::string& stream_id) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    streams_.push_back(stream_id);
+  }
+  std::mutex mtx_;
+  std::vector<std::string> streams_;
+};  // class TPStreamAddedModule
+
+TEST(CorePipeline, NotifyStreamAdded) {
+  CNModuleConfig config1;
+  config1.name = "source";
+  config1.className = "cnstream::TPTestSource";
+  config1.parallelism = 0;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"modulea"};
+  CNModuleConfig config2;
+  config2.name = "modulea";
+  config2.className = "cnstream::TPStreamAddedModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  Pipeline pipeline("test_pipeline");
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  auto source = dynamic_cast<SourceModule*>(pipeline.GetModule("source"));
+  auto module = dynamic_cast<TPStreamAddedModule*>(pipeline.GetModule("modulea"));
+  ASSERT_TRUE(source && module);
+  // the modules are notified only while the pipeline is running
+  EXPECT_EQ(source->AddSource(std::make_shared<TPTestSourceHandler>(source, "stream0")), 0);
+  EXPECT_TRUE(module->streams_.empty());
+  EXPECT_EQ(source->RemoveSource("stream0"), 0);
+  ASSERT_TRUE(pipeline.Start());
+  EXPECT_EQ(source->AddSource(std::make_shared<TPTestSourceHandler>(source, "stream1")), 0);
+  EXPECT_EQ(module->streams_, std::vector<std::string>({"stream1"}));
+  pipeline.Stop();
+}
+
+class TPStreamParamModule : public Module, public ModuleCreator<TPStreamParamModule> {
+ public:
+  explicit TPStreamParamModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {return true;}
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> frame_info) override {return 0;}
+  bool CheckStreamParams(const ModuleParamSet& params) const override {
+    for (const auto& it : params) {
+      if (it.first != "threshold") return false;
+    }
+    return true;
+  }
+  void SetStreamParams(uint32_t stream_index, const ModuleParamSet& params) override {
+    auto search = params.find("threshold");
+    table_.Set(stream_index, search == params.end() ? nullptr : std::make_shared<const std::string>(search->second));
+  }
+  std::string GetThreshold(uint32_t stream_index) const {
+    std::shared_ptr<const std::string> threshold = table_.Get(stream_index);
+    return threshold ? *threshold : "";
+  }
+  StreamParamTable<std::string> table_;
+};  // class TPStreamParamModule
+
+TEST(CorePipeline, StreamParams) {
+  CNModuleConfig config1;
+  config1.name = "source";
+  config1.className = "cnstream::TPTestSource";
+  config1.parallelism = 0;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"modulea"};
+  CNModuleConfig config2;
+  config2.name = "modulea";
+  config2.className = "cnstream::TPStreamParamModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  Pipeline pipeline("test_pipeline");
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  auto source = dynamic_cast<SourceModule*>(pipeline.GetModule("source"));
+  auto module = dynamic_cast<TPStreamParamModule*>(pipeline.GetModule("modulea"));
+  ASSERT_TRUE(source && module);
+  // unknown modules and parameters not overridable are rejected
+  EXPECT_FALSE(pipeline.SetStreamParams("stream0", {{"unknown", {{"threshold", "0.5"}}}}));
+  EXPECT_FALSE(pipeline.SetStreamParams("stream0", {{"modulea", {{"interval", "2"}}}}));
+  EXPECT_FALSE(pipeline.SetStreamParams("stream0", {{"source", {{"threshold", "0.5"}}}}));
+  EXPECT_TRUE(pipeline.SetStreamParams("stream0", {{"modulea", {{"threshold", "0.5"}}}}));
+  EXPECT_TRUE(pipeline.SetStreamTagParams("group", {{"modulea", {{"threshold", "0.3"}}}}));
+  EXPECT_TRUE(pipeline.SetStreamTag("stream1", "group"));
+  ASSERT_TRUE(pipeline.Start());
+  EXPECT_EQ(module->table_.StreamNum(), 0u);
+
+  // applied when the streams are added
+  EXPECT_EQ(source->AddSource(std::make_shared<TPTestSourceHandler>(source, "stream0")), 0);
+  EXPECT_EQ(source->AddSource(std::make_shared<TPTestSourceHandler>(source, "stream1")), 0);
+  EXPECT_EQ(source->AddSource(std::make_shared<TPTestSourceHandler>(source, "stream2")), 0);
+  const uint32_t idx0 = source->GetSourceHandler("stream0")->GetStreamIndex();
+  const uint32_t idx1 = source->GetSourceHandler("stream1")->GetStreamIndex();
+  const uint32_t idx2 = source->GetSourceHandler("stream2")->GetStreamIndex();
+  EXPECT_EQ(module->GetThreshold(idx0), "0.5");
+  EXPECT_EQ(module->GetThreshold(idx1), "0.3");
+  EXPECT_EQ(module->GetThreshold(idx2), "");
+
+  // the overrides of a stream are merged over the ones of its tag, and take effect at once
+  EXPECT_TRUE(pipeline.SetStreamParams("stream1", {{"modulea", {{"threshold", "0.7"}}}}));
+  EXPECT_EQ(module->GetThreshold(idx1), "0.7");
+  EXPECT_TRUE(pipeline.SetStreamParams("stream1", {}));
+  EXPECT_EQ(module->GetThreshold(idx1), "0.3");
+  EXPECT_TRUE(pipeline.SetStreamTag("stream2", "group"));
+  EXPECT_TRUE(pipeline.SetStreamTagParams("group", {{"modulea", {{"threshold", "0.4"}}}}));
+  EXPECT_EQ(module->GetThreshold(idx1), "0.4");
+  EXPECT_EQ(module->GetThreshold(idx2), "0.4");
+  EXPECT_FALSE(pipeline.SetStreamTagParams("group", {{"modulea", {{"interval", "2"}}}}));
+  EXPECT_EQ(module->GetThreshold(idx2), "0.4");
+  EXPECT_TRUE(pipeline.SetStreamTag("stream2", ""));
+  EXPECT_EQ(module->GetThreshold(idx2), "");
+
+  // removed with the streams
+  EXPECT_EQ(source->RemoveSource("stream0"), 0);
+  EXPECT_EQ(module->GetThreshold(idx0), "");
+  EXPECT_EQ(module->table_.StreamNum(), 1u);
+  pipeline.Stop();
+}
+
+TEST(CorePipeline, BulkSources) {
+  CNModuleConfig config1;
+  config1.name = "source";
+  config1.className = "cnstream::TPTestSource";
+  config1.parallelism = 0;
+  config1.maxInputQueueSize = 20;
+  config1.next = {"modulea"};
+  CNModuleConfig config2;
+  config2.name = "modulea";
+  config2.className = "cnstream::TPStreamAddedModule";
+  config2.parallelism = 1;
+  config2.maxInputQueueSize = 20;
+  CNGraphConfig graph_config;
+  graph_config.module_configs = {config1, config2};
+  Pipeline pipeline("test_pipeline");
+  ASSERT_TRUE(pipeline.BuildPipeline(graph_config));
+  auto source = dynamic_cast<SourceModule*>(pipeline.GetModule("source"));
+  auto module = dynamic_cast<TPStreamAddedModule*>(pipeline.GetModule("modulea"));
+  ASSERT_TRUE(source && module);
+  ASSERT_TRUE(pipeline.Start());
+  std::vector<std::string> stream_ids = {"stream0", "stream1", "stream2", "stream3"};
+  std::vector<std::shared_ptr<SourceHandler>> handlers;
+  for (const auto& stream_id : stream_ids) handlers.push_back(std::make_shared<TPTestSourceHandler>(source, stream_id));
+  // null and duplicated handlers are skipped
+  handlers.push_back(nullptr);
+  handlers.push_back(handlers[0]);
+  EXPECT_EQ(source->AddSources(handlers), 4);
+  EXPECT_EQ(module->streams_, stream_ids);
+  // unknown streams are ignored
+  EXPECT_EQ(source->RemoveSources(std::vector<std::string>({"stream0", "stream1", "unknown"})), 0);
+  EXPECT_EQ(source->GetSourceHandler("stream0"), nullptr);
+  EXPECT_EQ(source->GetSourceHandler("stream1"), nullptr);
+  EXPECT_NE(source->GetSourceHandler("stream2"), nullptr);
+
+  std::mutex mtx;
+  std::condition_variable cond;
+  std::vector<std::string> removed;
+  EXPECT_EQ(source->RemoveSourcesAsync({"stream2", "stream3"}, [&](const std::string& stream_id) {
+    std::lock_guard<std::mutex> lk(mtx);
+    removed.push_back(stream_id);
+    cond.notify_one();
+  }, true), 0);
+  {
+    std::unique_lock<std::mutex> lk(mtx);
+    EXPECT_TRUE(cond.wait_for(lk, std::chrono::seconds(5), [&] { return removed.size() == 2; }));
+  }
+  std::sort(removed.begin(), removed.end());
+  EXPECT_EQ(removed, std::vector<std::string>({"stream2", "stream3"}));
+  EXPECT_EQ(source->GetSourceHandler("stream2"), nullptr);
+  EXPECT_EQ(source->GetSourceHandler("stream3"), nullptr);
+  pipeline.Stop();
+}
+
 TEST(CorePipeline, GetEventBus) {
   Pipeline pipeline("test_pipeline");
   EXPECT_NE(nullptr, pipeline.GetEventBus());
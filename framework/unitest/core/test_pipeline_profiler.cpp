@@ -117,6 +117,35 @@ TEST(CorePipelineProfiler, GetProfile) {
   EXPECT_EQ(profile.overall_profile.completed, 2);
 }
 
+TEST(CorePipelineProfiler, DeviceUtilization) {
+  ProfilerConfig config;
+  config.enable_tracing = true;
+  config.enable_profiling = true;
+  auto modules = CreateModules();
+  PipelineProfiler profiler(config, "test_pipeline", modules, GetModuleNames(modules));
+  EXPECT_TRUE(profiler.GetProfile().device_utilizations.empty());
+  int samples = 0;
+  profiler.SetDeviceUtilizationSampler([&samples] {
+    DeviceUtilization device;
+    device.core_utilization = ++samples;
+    return std::vector<DeviceUtilization>{device, device};
+  });
+  PipelineProfile profile = profiler.GetProfile();
+  ASSERT_EQ(2u, profile.device_utilizations.size());
+  EXPECT_EQ(1.0, profile.device_utilizations[0].core_utilization);
+  EXPECT_EQ(-1.0, profile.device_utilizations[0].codec_utilization);
+  // sampled live by the over time profiles as well
+  profile = profiler.GetProfile(Time::min(), Time::max());
+  ASSERT_EQ(2u, profile.device_utilizations.size());
+  EXPECT_EQ(2.0, profile.device_utilizations[0].core_utilization);
+  std::vector<DeviceUtilization> devices = profiler.SampleDeviceUtilizations();
+  ASSERT_EQ(2u, devices.size());
+  EXPECT_EQ(3.0, devices[0].core_utilization);
+  profiler.SetDeviceUtilizationSampler(nullptr);
+  EXPECT_TRUE(profiler.GetProfile().device_utilizations.empty());
+  EXPECT_TRUE(profiler.SampleDeviceUtilizations().empty());
+}
+
 TEST(CorePipelineProfiler, GetProfile_Disable_Tracing) {
   ProfilerConfig config;
   config.enable_tracing = false;
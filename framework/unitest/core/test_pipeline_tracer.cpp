@@ -19,11 +19,14 @@
  *************************************************************************/
 
 #include <gtest/gtest.h>
+#include <unistd.h>
 
+#include <cstdio>
 #include <string>
 #include <utility>
 
 #include "profiler/pipeline_tracer.hpp"
+#include "profiler/trace_file.hpp"
 
 namespace cnstream {
 
@@ -113,4 +116,35 @@ TEST(CorePipelineTracer, GetTrace) {
 }
 
 
+TEST(CorePipelineTracer, Streaming) {
+  const std::string path = "/tmp/cnstream_test_tracer_" + std::to_string(getpid()) + ".cntrace";
+  PipelineTracer tracer(1);
+  EXPECT_EQ(nullptr, tracer.GetTraceFileWriter());
+  EXPECT_FALSE(tracer.StartStreaming("/not_exist_dir/trace.cntrace"));
+  ASSERT_TRUE(tracer.StartStreaming(path));
+  ASSERT_NE(nullptr, tracer.GetTraceFileWriter());
+  TraceEvent event(std::make_pair(std::string("stream0"), 0));
+  event.SetLevel(TraceEvent::Level::MODULE).SetModuleName("module").SetProcessName("process").SetTime(Clock::now());
+  for (int i = 0; i < 10; ++i) {
+    event.key.second = i;
+    tracer.RecordEvent(event);
+  }
+  tracer.StopStreaming();
+  EXPECT_EQ(10u, tracer.GetTraceFileWriter()->GetWrittenNumber());
+  // only the last event is cached in memory
+  PipelineTrace trace = tracer.GetTrace(Time::min(), Time::max());
+  EXPECT_EQ(1u, trace.module_traces["module"]["process"].size());
+
+  TraceFileReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  TraceEvent read_event;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(reader.Next(&read_event));
+    EXPECT_EQ(i, read_event.key.second);
+    EXPECT_EQ(event.time, read_event.time);
+  }
+  EXPECT_FALSE(reader.Next(&read_event));
+  std::remove(path.c_str());
+}
+
 }  // namespace cnstream
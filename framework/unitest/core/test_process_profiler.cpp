@@ -21,7 +21,9 @@
 #include <gtest/gtest.h>
 
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "profiler/process_profiler.hpp"
 
@@ -317,4 +319,59 @@ TEST(CoreProcessProfiler, NullTracer) {
   profiler.RecordStart(key);
 }
 
+TEST(CoreProcessProfiler, RecordByStreamIndex) {
+  ProfilerConfig config;
+  config.enable_profiling = true;
+  ProcessProfiler profiler(config, "profiler", nullptr);
+  profiler.RecordStart(3, "stream3", 100);
+  profiler.RecordStart(5, "stream5", 100);
+  profiler.RecordEnd(3, "stream3", 100);
+  // the records keyed by name are counted as the stream of the same name
+  profiler.RecordEnd(std::make_pair("stream5", 100));
+  ProcessProfile profile = profiler.GetProfile();
+  EXPECT_EQ(profile.completed, 2u);
+  EXPECT_EQ(profile.ongoing, 0);
+  ASSERT_EQ(profile.stream_profiles.size(), 2u);
+  EXPECT_EQ(profile.stream_profiles[0].stream_name, "stream3");
+  EXPECT_EQ(profile.stream_profiles[0].completed, 1u);
+  EXPECT_EQ(profile.stream_profiles[1].stream_name, "stream5");
+  EXPECT_EQ(profile.stream_profiles[1].completed, 1u);
+
+  // the index is taken by another stream after the end of the stream
+  profiler.OnStreamEos("stream3");
+  profiler.RecordStart(3, "stream3_new", 200);
+  profiler.RecordEnd(3, "stream3_new", 200);
+  profile = profiler.GetProfile();
+  ASSERT_EQ(profile.stream_profiles.size(), 2u);
+  EXPECT_EQ(profile.stream_profiles[0].stream_name, "stream3_new");
+  EXPECT_EQ(profile.stream_profiles[0].completed, 1u);
+}
+
+TEST(CoreProcessProfiler, RecordInThreads) {
+  ProfilerConfig config;
+  config.enable_profiling = true;
+  ProcessProfiler profiler(config, "profiler", nullptr);
+  constexpr int kThreadNum = 4;
+  // more than a buffer of a thread holds
+  constexpr int kFrameNum = 3000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadNum; ++i) {
+    threads.emplace_back([&profiler, i] {
+      const std::string stream_name = "stream" + std::to_string(i);
+      for (int frame = 0; frame < kFrameNum; ++frame) {
+        profiler.RecordStart(i, stream_name, frame);
+        profiler.RecordEnd(i, stream_name, frame);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  ProcessProfile profile = profiler.GetProfile();
+  EXPECT_EQ(profile.completed, static_cast<uint64_t>(kThreadNum * kFrameNum));
+  EXPECT_EQ(profile.dropped, 0);
+  EXPECT_EQ(profile.ongoing, 0);
+  ASSERT_EQ(profile.stream_profiles.size(), static_cast<size_t>(kThreadNum));
+  for (const auto& stream_profile : profile.stream_profiles)
+    EXPECT_EQ(stream_profile.completed, static_cast<uint64_t>(kFrameNum));
+}
+
 }  // namespace cnstream
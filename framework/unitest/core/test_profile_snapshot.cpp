@@ -0,0 +1,134 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_module.hpp"
+#include "profiler/module_profiler.hpp"
+#include "profiler/pipeline_profiler.hpp"
+#include "profiler/profile_snapshot.hpp"
+
+namespace cnstream {
+
+static std::map<std::string, double> ApplyDelta(const ProfileDelta& delta, std::vector<std::string>* keys) {
+  if (delta.reset) keys->clear();
+  keys->insert(keys->end(), delta.new_keys.begin(), delta.new_keys.end());
+  std::map<std::string, double> changed;
+  EXPECT_EQ(delta.indices.size(), delta.values.size());
+  for (size_t i = 0; i < delta.indices.size(); ++i) {
+    EXPECT_LT(delta.indices[i], keys->size());
+    changed[(*keys)[delta.indices[i]]] = delta.values[i];
+  }
+  return changed;
+}
+
+static PipelineProfile CreateProfile(const std::vector<std::string>& streams, uint64_t completed) {
+  PipelineProfile profile;
+  profile.pipeline_name = "pipeline";
+  ModuleProfile module_profile;
+  module_profile.module_name = "module";
+  ProcessProfile process_profile;
+  process_profile.process_name = "process";
+  process_profile.completed = completed * streams.size();
+  for (const auto& stream : streams) {
+    StreamProfile stream_profile;
+    stream_profile.stream_name = stream;
+    stream_profile.completed = completed;
+    process_profile.stream_profiles.push_back(stream_profile);
+  }
+  module_profile.process_profiles.push_back(process_profile);
+  module_profile.counters.emplace_back("hits", 3);
+  profile.module_profiles.push_back(module_profile);
+  return profile;
+}
+
+TEST(CoreProfileSnapshot, Flatten) {
+  std::vector<std::pair<std::string, double>> counters;
+  ProfileSnapshotter::Flatten(CreateProfile({"stream0"}, 5), &counters);
+  std::map<std::string, double> values(counters.begin(), counters.end());
+  EXPECT_EQ(values.size(), counters.size());
+  EXPECT_EQ(values["modules/module/process/completed"], 5);
+  EXPECT_EQ(values["modules/module/process/streams/stream0/completed"], 5);
+  EXPECT_EQ(values["modules/module/counters/hits"], 3);
+  EXPECT_EQ(values.count("overall/fps"), 1u);
+  EXPECT_EQ(values.count("memory/host_bytes"), 1u);
+}
+
+TEST(CoreProfileSnapshot, GetDelta) {
+  ProfilerConfig config;
+  config.enable_profiling = true;
+  PipelineProfiler profiler(config, "pipeline", {}, {});
+  ProfileSnapshotter snapshotter(&profiler);
+  std::vector<std::string> keys;
+
+  // the first snapshot returns all counters
+  ProfileDelta delta = snapshotter.GetDelta(CreateProfile({"stream0", "stream1"}, 1));
+  EXPECT_TRUE(delta.reset);
+  std::vector<std::pair<std::string, double>> counters;
+  ProfileSnapshotter::Flatten(CreateProfile({"stream0", "stream1"}, 1), &counters);
+  EXPECT_EQ(ApplyDelta(delta, &keys).size(), counters.size());
+  EXPECT_EQ(keys.size(), counters.size());
+
+  // nothing changed
+  delta = snapshotter.GetDelta(CreateProfile({"stream0", "stream1"}, 1));
+  EXPECT_FALSE(delta.reset);
+  EXPECT_TRUE(delta.new_keys.empty());
+  EXPECT_TRUE(ApplyDelta(delta, &keys).empty());
+
+  // only the completed counters changed
+  delta = snapshotter.GetDelta(CreateProfile({"stream0", "stream1"}, 2));
+  auto changed = ApplyDelta(delta, &keys);
+  EXPECT_EQ(changed.size(), 3u);
+  EXPECT_EQ(changed["modules/module/process/completed"], 4);
+  EXPECT_EQ(changed["modules/module/process/streams/stream1/completed"], 2);
+
+  // the new streams append their keys
+  const std::vector<std::string> streams = {"stream0", "stream1", "stream2", "stream3", "stream4", "stream5"};
+  delta = snapshotter.GetDelta(CreateProfile(streams, 2));
+  EXPECT_FALSE(delta.reset);
+  EXPECT_EQ(delta.new_keys.size(), 40u);
+  changed = ApplyDelta(delta, &keys);
+  EXPECT_EQ(changed["modules/module/process/completed"], 12);
+  EXPECT_EQ(changed.count("modules/module/process/streams/stream2/fps"), 1u);
+
+  // the removed streams keep their keys until they outnumber the present ones
+  delta = snapshotter.GetDelta(CreateProfile({"stream0", "stream1"}, 2));
+  EXPECT_FALSE(delta.reset);
+  EXPECT_TRUE(delta.new_keys.empty());
+  EXPECT_EQ(ApplyDelta(delta, &keys).size(), 1u);
+  delta = snapshotter.GetDelta(CreateProfile({}, 2));
+  EXPECT_TRUE(delta.reset);
+  changed = ApplyDelta(delta, &keys);
+  EXPECT_EQ(keys.size(), changed.size());
+  for (const auto& key : keys) EXPECT_EQ(key.find("streams/stream"), std::string::npos);
+
+  snapshotter.Reset();
+  delta = snapshotter.GetDelta();
+  EXPECT_TRUE(delta.reset);
+  EXPECT_FALSE(delta.new_keys.empty());
+}
+
+}  // namespace cnstream
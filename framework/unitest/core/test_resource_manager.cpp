@@ -0,0 +1,136 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_resource_manager.hpp"
+
+namespace cnstream {
+
+// each test uses its own kind, the manager is shared by the process
+static ResourceUsage GetUsage(int device_id, const std::string& kind) {
+  for (const auto& usage : DeviceResourceManager::Instance().GetUsages()) {
+    if (usage.device_id == device_id && usage.kind == kind) return usage;
+  }
+  return ResourceUsage();
+}
+
+TEST(CoreResourceManager, UnlimitedByDefault) {
+  DeviceResourceManager& manager = DeviceResourceManager::Instance();
+  const std::string kind = "test_unlimited";
+  EXPECT_EQ(manager.GetCapacity(0, kind), 0u);
+  std::vector<std::unique_ptr<ResourceLease>> leases;
+  for (int i = 0; i < 16; ++i) {
+    leases.push_back(manager.Acquire("pipeline", 0, kind, 0));
+    ASSERT_NE(leases.back(), nullptr);
+  }
+  EXPECT_EQ(GetUsage(0, kind).in_use, 16u);
+  leases.clear();
+  EXPECT_EQ(GetUsage(0, kind).in_use, 0u);
+  EXPECT_TRUE(GetUsage(0, kind).pipelines.empty());
+}
+
+TEST(CoreResourceManager, Capacity) {
+  DeviceResourceManager& manager = DeviceResourceManager::Instance();
+  const std::string kind = "test_capacity";
+  manager.SetCapacity(0, kind, 2);
+  EXPECT_EQ(manager.GetCapacity(0, kind), 2u);
+  EXPECT_EQ(manager.GetCapacity(1, kind), 0u);
+  auto lease0 = manager.Acquire("pipeline_0", 0, kind, 0);
+  auto lease1 = manager.Acquire("pipeline_1", 0, kind, 0);
+  ASSERT_NE(lease0, nullptr);
+  ASSERT_NE(lease1, nullptr);
+  EXPECT_EQ(lease1->GetPipelineName(), "pipeline_1");
+  EXPECT_EQ(lease1->GetDeviceId(), 0);
+  EXPECT_EQ(lease1->GetKind(), kind);
+  EXPECT_EQ(manager.Acquire("pipeline_0", 0, kind, 10), nullptr);
+  // other devices are not limited
+  EXPECT_NE(manager.Acquire("pipeline_0", 1, kind, 0), nullptr);
+
+  ResourceUsage usage = GetUsage(0, kind);
+  EXPECT_EQ(usage.capacity, 2u);
+  EXPECT_EQ(usage.in_use, 2u);
+  EXPECT_EQ(usage.pipelines["pipeline_0"].first, 1u);
+  EXPECT_EQ(usage.pipelines["pipeline_0"].second, 0u);
+
+  // a waiting pipeline takes the unit once it is returned
+  auto waiter = std::async(std::launch::async, [&] { return manager.Acquire("pipeline_0", 0, kind, 5000); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  lease1.reset();
+  auto lease2 = waiter.get();
+  ASSERT_NE(lease2, nullptr);
+  EXPECT_EQ(GetUsage(0, kind).pipelines["pipeline_0"].first, 2u);
+
+  // a larger capacity wakes up the waiting pipelines
+  waiter = std::async(std::launch::async, [&] { return manager.Acquire("pipeline_1", 0, kind, 5000); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  manager.SetCapacity(0, kind, 3);
+  EXPECT_NE(waiter.get(), nullptr);
+}
+
+TEST(CoreResourceManager, FairShares) {
+  DeviceResourceManager& manager = DeviceResourceManager::Instance();
+  const std::string kind = "test_fair_shares";
+  manager.SetCapacity(0, kind, 3);
+  // pipeline_0 holds all units, pipeline_0 and pipeline_1 both wait for one
+  std::vector<std::unique_ptr<ResourceLease>> leases;
+  for (int i = 0; i < 3; ++i) leases.push_back(manager.Acquire("pipeline_0", 0, kind, 0));
+  auto waiter0 = std::async(std::launch::async, [&] { return manager.Acquire("pipeline_0", 0, kind, 200); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto waiter1 = std::async(std::launch::async, [&] { return manager.Acquire("pipeline_1", 0, kind, 5000); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(GetUsage(0, kind).pipelines["pipeline_0"].second, 1u);
+  EXPECT_EQ(GetUsage(0, kind).pipelines["pipeline_1"].second, 1u);
+  // the returned unit goes to pipeline_1 holding none, though pipeline_0 waits longer
+  leases.pop_back();
+  auto lease1 = waiter1.get();
+  ASSERT_NE(lease1, nullptr);
+  EXPECT_EQ(lease1->GetPipelineName(), "pipeline_1");
+  EXPECT_EQ(waiter0.get(), nullptr);
+}
+
+TEST(CoreResourceManager, Weights) {
+  DeviceResourceManager& manager = DeviceResourceManager::Instance();
+  const std::string kind = "test_weights";
+  EXPECT_FALSE(manager.SetWeight("heavy", 0));
+  EXPECT_TRUE(manager.SetWeight("heavy", 4));
+  manager.SetCapacity(0, kind, 4);
+  std::vector<std::unique_ptr<ResourceLease>> heavy;
+  for (int i = 0; i < 3; ++i) heavy.push_back(manager.Acquire("heavy", 0, kind, 0));
+  auto light = manager.Acquire("light", 0, kind, 0);
+  auto light_waiter = std::async(std::launch::async, [&] { return manager.Acquire("light", 0, kind, 200); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto heavy_waiter = std::async(std::launch::async, [&] { return manager.Acquire("heavy", 0, kind, 5000); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  // heavy then holds 2 units (0.5 per weight), fewer than light holding 1 unit (1 per weight)
+  heavy.pop_back();
+  auto lease = heavy_waiter.get();
+  EXPECT_NE(lease, nullptr);
+  EXPECT_EQ(light_waiter.get(), nullptr);
+}
+
+}  // namespace cnstream
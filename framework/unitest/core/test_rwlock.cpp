@@ -0,0 +1,84 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "util/cnstream_rwlock.hpp"
+
+namespace cnstream {
+
+TEST(CoreRwLock, BiasedRwLock) {
+  BiasedRwLock lock;
+  int64_t a = 0, b = 0;
+  std::atomic<bool> stop{false};
+  std::atomic<int> mismatch{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 8; ++i) {
+    readers.emplace_back([&]() {
+      while (!stop.load()) {
+        RwLockReadGuard guard(lock);
+        if (a != b) ++mismatch;
+      }
+    });
+  }
+  std::thread writer([&]() {
+    for (int i = 0; i < 100; ++i) {
+      RwLockWriteGuard guard(lock);
+      ++a;
+      std::this_thread::yield();
+      ++b;
+    }
+  });
+  writer.join();
+  stop.store(true);
+  for (auto& reader : readers) reader.join();
+  EXPECT_EQ(mismatch.load(), 0);
+  EXPECT_EQ(a, 100);
+}
+
+TEST(CoreRwLock, BiasedRwLockNestedRead) {
+  BiasedRwLock lock;
+  std::atomic<bool> writing{false}, written{false};
+  std::thread writer;
+  {
+    RwLockReadGuard guard(lock);
+    writer = std::thread([&]() {
+      writing.store(true);
+      RwLockWriteGuard guard(lock);
+      written.store(true);
+    });
+    while (!writing.load()) std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    // the writer waits for this thread, taking the read lock again must not wait for the writer
+    RwLockReadGuard nested_guard(lock);
+    EXPECT_FALSE(written.load());
+  }
+  writer.join();
+  EXPECT_TRUE(written.load());
+  // the lock is released by all the guards
+  RwLockWriteGuard guard(lock);
+}
+
+}  // namespace cnstream
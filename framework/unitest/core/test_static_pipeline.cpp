@@ -0,0 +1,151 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_static_pipeline.hpp"
+
+namespace cnstream {
+
+static constexpr char kStageOrderTag[] = "StageOrder";
+
+static void RecordStage(const std::shared_ptr<CNFrameInfo> &data, int stage) {
+  if (!data->collection.HasValue(kStageOrderTag)) data->collection.Add(kStageOrderTag, std::vector<int>());
+  data->collection.Get<std::vector<int>>(kStageOrderTag).push_back(stage);
+}
+
+class StaticStage final : public Module {
+ public:
+  explicit StaticStage(const std::string &name, int index) : Module(name), index_(index) {}
+  bool Open(ModuleParamSet params) override {
+    fail_timestamp_ = params.count("fail_timestamp") ? std::stoll(params["fail_timestamp"]) : -1;
+    return !params.count("fail_open");
+  }
+  void Close() override { ++close_count; }
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    if (data->timestamp == fail_timestamp_) return -1;
+    RecordStage(data, index_);
+    return 0;
+  }
+  void OnEos(const std::string &stream_id) override { eos_streams.push_back(stream_id); }
+  int close_count = 0;
+  std::vector<std::string> eos_streams;
+
+ private:
+  int index_;
+  int64_t fail_timestamp_ = -1;
+};
+
+class StaticTransmitStage final : public ModuleEx {
+ public:
+  explicit StaticTransmitStage(const std::string &name, int index) : ModuleEx(name), index_(index) {}
+  bool Open(ModuleParamSet params) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    if (!data->IsEos()) RecordStage(data, index_);
+    TransmitData(data);
+    return 1;
+  }
+
+ private:
+  int index_;
+};
+
+TEST(CoreStaticPipeline, ProcessInOrder) {
+  using Chain = StaticPipeline<StaticStage, StaticTransmitStage, StaticStage>;
+  Chain pipeline(std::make_shared<StaticStage>("stage0", 0), std::make_shared<StaticTransmitStage>("stage1", 1),
+                 std::make_shared<StaticStage>("stage2", 2));
+  EXPECT_EQ(Chain::kStageNum, 3u);
+  EXPECT_FALSE(pipeline.Open({ModuleParamSet(), ModuleParamSet()}));
+  ModuleParamSet fail_params;
+  fail_params["fail_timestamp"] = "1";
+  ASSERT_TRUE(pipeline.Open({ModuleParamSet(), ModuleParamSet(), fail_params}));
+
+  std::vector<std::shared_ptr<CNFrameInfo>> done;
+  pipeline.SetFrameDoneCallback([&](const std::shared_ptr<CNFrameInfo> &data) { done.push_back(data); });
+  std::vector<std::string> failed;
+  pipeline.SetErrorCallback([&](Module *stage, const std::shared_ptr<CNFrameInfo> &data, int ret) {
+    EXPECT_EQ(ret, -1);
+    failed.push_back(stage->GetName());
+  });
+  ProfilerConfig config;
+  config.enable_profiling = true;
+  pipeline.EnableProfiling(config);
+
+  for (int64_t i = 0; i < 3; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    data->timestamp = i;
+    pipeline.ProvideData(data);
+  }
+  pipeline.ProvideData(CNFrameInfo::Create("0", true));
+
+  ASSERT_EQ(done.size(), 3u);
+  EXPECT_EQ(done[0]->timestamp, 0);
+  EXPECT_EQ(done[1]->timestamp, 2);
+  EXPECT_TRUE(done[2]->IsEos());
+  EXPECT_EQ(done[0]->collection.Get<std::vector<int>>(kStageOrderTag), std::vector<int>({0, 1, 2}));
+  ASSERT_EQ(failed.size(), 1u);
+  EXPECT_EQ(failed[0], "stage2");
+  ASSERT_EQ(pipeline.GetStage<2>()->eos_streams.size(), 1u);
+  EXPECT_EQ(pipeline.GetStage<0>()->eos_streams.size(), 1u);
+
+  ModuleProfile profile = pipeline.GetProfiler(1)->GetProfile();
+  EXPECT_EQ(profile.module_name, "stage1");
+  ASSERT_EQ(profile.process_profiles.size(), 1u);
+  EXPECT_EQ(profile.process_profiles[0].completed, 3u);
+  EXPECT_EQ(pipeline.GetProfiler(3), nullptr);
+
+  pipeline.Close();
+  pipeline.Close();
+  EXPECT_EQ(pipeline.GetStage<0>()->close_count, 1);
+}
+
+TEST(CoreStaticPipeline, TransmitFromSource) {
+  StaticPipeline<StaticTransmitStage, StaticStage> pipeline(std::make_shared<StaticTransmitStage>("source", 0),
+                                                            std::make_shared<StaticStage>("sink", 1));
+  ASSERT_TRUE(pipeline.Open({ModuleParamSet(), ModuleParamSet()}));
+  std::vector<std::shared_ptr<CNFrameInfo>> done;
+  pipeline.SetFrameDoneCallback([&](const std::shared_ptr<CNFrameInfo> &data) { done.push_back(data); });
+  // the frames transmitted by the first stage, e.g. a source module, go on to the next stages
+  auto data = CNFrameInfo::Create("0");
+  data->timestamp = 0;
+  EXPECT_TRUE(pipeline.GetStage<0>()->TransmitData(data));
+  ASSERT_EQ(done.size(), 1u);
+  EXPECT_EQ(done[0]->collection.Get<std::vector<int>>(kStageOrderTag), std::vector<int>({1}));
+}
+
+TEST(CoreStaticPipeline, OpenFailed) {
+  StaticPipeline<StaticStage, StaticStage, StaticStage> pipeline(
+      std::make_shared<StaticStage>("stage0", 0), std::make_shared<StaticStage>("stage1", 1),
+      std::make_shared<StaticStage>("stage2", 2));
+  ModuleParamSet fail_params;
+  fail_params["fail_open"] = "true";
+  EXPECT_FALSE(pipeline.Open({ModuleParamSet(), fail_params, ModuleParamSet()}));
+  // the stages opened are closed
+  EXPECT_EQ(pipeline.GetStage<0>()->close_count, 1);
+  EXPECT_EQ(pipeline.GetStage<1>()->close_count, 0);
+  EXPECT_EQ(pipeline.GetStage<2>()->close_count, 0);
+}
+
+}  // namespace cnstream
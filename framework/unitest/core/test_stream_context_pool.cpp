@@ -0,0 +1,122 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/cnstream_stream_context_pool.hpp"
+
+namespace cnstream {
+
+struct TestStreamContext {
+  int value = 0;
+};
+
+TEST(CoreStreamContextPool, AcquireRelease) {
+  StreamContextPool<TestStreamContext> pool;
+  int created = 0, recycled = 0;
+  auto creator = [&]() {
+    ++created;
+    return std::unique_ptr<TestStreamContext>(new TestStreamContext);
+  };
+  auto recycler = [&](TestStreamContext* ctx) {
+    ++recycled;
+    ctx->value = 0;
+    return true;
+  };
+  ASSERT_TRUE(pool.Init(2, creator, recycler));
+  EXPECT_EQ(created, 2);
+  EXPECT_EQ(pool.IdleNum(), 2u);
+  // the warm contexts are handed out first, then new ones are created
+  TestStreamContext* ctx0 = pool.Acquire("0");
+  ASSERT_NE(ctx0, nullptr);
+  EXPECT_EQ(pool.Acquire("0"), ctx0);
+  EXPECT_EQ(pool.Find("0"), ctx0);
+  EXPECT_EQ(pool.Find("1"), nullptr);
+  ctx0->value = 1;
+  EXPECT_NE(pool.Acquire("1"), nullptr);
+  EXPECT_NE(pool.Acquire("2"), nullptr);
+  EXPECT_EQ(created, 3);
+  EXPECT_EQ(pool.IdleNum(), 0u);
+  EXPECT_EQ(pool.StreamNum(), 3u);
+  // at most 2 contexts are kept idle
+  pool.Release("0");
+  pool.Release("1");
+  pool.Release("2");
+  pool.Release("3");
+  EXPECT_EQ(recycled, 2);
+  EXPECT_EQ(pool.IdleNum(), 2u);
+  EXPECT_EQ(pool.StreamNum(), 0u);
+  TestStreamContext* ctx3 = pool.Acquire("3");
+  ASSERT_NE(ctx3, nullptr);
+  EXPECT_EQ(ctx3->value, 0);
+  EXPECT_EQ(created, 3);
+  pool.Clear();
+  EXPECT_EQ(pool.IdleNum(), 0u);
+  EXPECT_EQ(pool.StreamNum(), 0u);
+}
+
+TEST(CoreStreamContextPool, InitFailed) {
+  StreamContextPool<TestStreamContext> pool;
+  EXPECT_FALSE(pool.Init(1, []() { return std::unique_ptr<TestStreamContext>(); }));
+  EXPECT_FALSE(pool.Init(1, nullptr));
+  EXPECT_TRUE(pool.Init(0, nullptr));
+  EXPECT_EQ(pool.Acquire("0"), nullptr);
+}
+
+TEST(CoreStreamContextPool, RecycleRejected) {
+  StreamContextPool<TestStreamContext> pool;
+  ASSERT_TRUE(pool.Init(1, []() { return std::unique_ptr<TestStreamContext>(new TestStreamContext); },
+                        [](TestStreamContext* ctx) { return false; }));
+  EXPECT_NE(pool.Acquire("0"), nullptr);
+  pool.Release("0");
+  EXPECT_EQ(pool.IdleNum(), 0u);
+}
+
+TEST(CoreStreamContextPool, Concurrent) {
+  StreamContextPool<TestStreamContext> pool;
+  std::atomic<int> created{0};
+  ASSERT_TRUE(pool.Init(4, [&]() {
+    ++created;
+    return std::unique_ptr<TestStreamContext>(new TestStreamContext);
+  }));
+  // every stream gets one context however many threads acquire it
+  std::vector<std::thread> threads;
+  std::vector<TestStreamContext*> contexts(8, nullptr);
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&pool, &contexts, i]() {
+      for (int n = 0; n < 100; ++n) {
+        TestStreamContext* ctx = pool.Acquire(std::to_string(n % 8));
+        if (n % 8 == i) contexts[i] = ctx;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(pool.StreamNum(), 8u);
+  for (int i = 0; i < 8; ++i) EXPECT_EQ(contexts[i], pool.Find(std::to_string(i)));
+  EXPECT_LE(pool.IdleNum(), 4u);
+}
+
+}  // namespace cnstream
@@ -141,4 +141,32 @@ bool TestThreadsafeQueue() {
 
 TEST(CoreThreadSafeQueue, ThreadsafeQueue) { EXPECT_EQ(true, TestThreadsafeQueue()); }
 
+TEST(CoreThreadSafeQueue, MpscQueue) {
+  MpscQueue<int> queue;
+  int value = -1;
+  EXPECT_FALSE(queue.TryPop(value));
+  EXPECT_FALSE(queue.WaitAndTryPop(value, std::chrono::microseconds(100)));
+  EXPECT_TRUE(queue.Empty());
+
+  constexpr int kProducers = 4, kPerProducer = 10000;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&queue, p]() {
+      for (int i = 0; i < kPerProducer; ++i) queue.Push(p * kPerProducer + i);
+    });
+  }
+  // the elements of each producer are popped in order
+  std::vector<int> last(kProducers, -1);
+  int popped = 0;
+  while (popped < kProducers * kPerProducer) {
+    ASSERT_TRUE(queue.WaitAndTryPop(value, std::chrono::seconds(5)));
+    EXPECT_GT(value % kPerProducer, last[value / kPerProducer]);
+    last[value / kPerProducer] = value % kPerProducer;
+    ++popped;
+  }
+  for (auto& producer : producers) producer.join();
+  EXPECT_TRUE(queue.Empty());
+  queue.Push(1);  // released by the destructor
+}
+
 }  // namespace cnstream
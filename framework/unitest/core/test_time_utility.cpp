@@ -22,7 +22,9 @@
 #include <atomic>
 #include <chrono>
 #include <future>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "util/cnstream_timer.hpp"
 
@@ -94,4 +96,64 @@ TEST(TimeUtilityTest, TickTockClockTest) {
   EXPECT_DOUBLE_EQ(avg_duration, 0.0);
 }
 
+TEST(TimeUtilityTest, TimerWheel) {
+  TimerWheel wheel;
+  std::mutex mtx;
+  std::vector<int> order;
+  std::promise<void> done;
+  const auto start = steady_clock::now();
+  for (int delay : {30, 10, 20}) {
+    wheel.Schedule(milliseconds(delay), [&, delay]() {
+      EXPECT_GE(steady_clock::now() - start, milliseconds(delay));
+      std::lock_guard<std::mutex> lk(mtx);
+      order.push_back(delay);
+      if (order.size() == 3) done.set_value();
+    });
+  }
+  std::atomic<bool> cancelled_run{false};
+  TimerWheel::TaskId id = wheel.Schedule(milliseconds(20), [&]() { cancelled_run = true; });
+  EXPECT_NE(id, 0u);
+  EXPECT_EQ(wheel.Size(), 4u);
+  EXPECT_TRUE(wheel.Cancel(id));
+  EXPECT_FALSE(wheel.Cancel(id));
+  done.get_future().get();
+  EXPECT_EQ(order, std::vector<int>({10, 20, 30}));
+  EXPECT_FALSE(cancelled_run);
+  EXPECT_EQ(wheel.Size(), 0u);
+}
+
+TEST(TimeUtilityTest, TimerWheelLevels) {
+  // 10us ticks, the tasks are linked in the first three levels of the wheel
+  TimerWheel wheel(microseconds(10));
+  std::promise<void> done;
+  std::atomic<int> count{0};
+  const auto start = steady_clock::now();
+  for (int delay : {1, 5, 700}) {
+    wheel.Schedule(milliseconds(delay), [&, delay]() {
+      const auto elapsed = steady_clock::now() - start;
+      EXPECT_GE(elapsed, milliseconds(delay));
+      EXPECT_LT(elapsed, milliseconds(delay + 100));
+      if (++count == 4) done.set_value();
+    });
+  }
+  // scheduled by a task
+  wheel.Schedule(milliseconds(2), [&]() {
+    wheel.Schedule(milliseconds(3), [&]() {
+      EXPECT_GE(steady_clock::now() - start, milliseconds(5));
+      if (++count == 4) done.set_value();
+    });
+  });
+  done.get_future().get();
+
+  std::atomic<int> run{0};
+  std::vector<TimerWheel::TaskId> ids;
+  for (int i = 0; i < 10000; ++i) ids.push_back(wheel.Schedule(microseconds(i * 5), [&]() { ++run; }));
+  int cancelled = 0;
+  for (size_t i = 0; i < ids.size(); i += 2) cancelled += wheel.Cancel(ids[i]);
+  while (wheel.Size() > 0) std::this_thread::sleep_for(milliseconds(5));
+  std::this_thread::sleep_for(milliseconds(5));
+  EXPECT_EQ(run + cancelled, 10000);
+  EXPECT_GT(cancelled, 0);
+}
+
 }  // namespace cnstream
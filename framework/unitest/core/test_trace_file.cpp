@@ -0,0 +1,204 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiler/trace_file.hpp"
+
+namespace cnstream {
+
+static std::string TraceFilePath(const std::string& name) {
+  return "/tmp/cnstream_test_" + name + "_" + std::to_string(getpid()) + ".cntrace";
+}
+
+static TraceEvent MakeEvent(const std::string& stream_name, int64_t pts, const std::string& module_name,
+                            const std::string& process_name, TraceEvent::Type type, const Time& time) {
+  TraceEvent event(std::make_pair(stream_name, pts));
+  event.SetModuleName(module_name).SetProcessName(process_name).SetType(type).SetTime(time)
+       .SetLevel(module_name.empty() ? TraceEvent::Level::PIPELINE : TraceEvent::Level::MODULE);
+  return event;
+}
+
+TEST(CoreTraceFile, WriteAndRead) {
+  const std::string path = TraceFilePath("write_and_read");
+  const Time start = Clock::now();
+  constexpr int kThreadNum = 4;
+  constexpr int kEventNum = 1000;
+  TraceFileWriter writer;
+  ASSERT_TRUE(writer.Open(path, 10));
+  EXPECT_FALSE(writer.Open(path));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreadNum; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kEventNum; ++i) {
+        Time time = start + std::chrono::microseconds(i * kThreadNum + t);
+        writer.Write(MakeEvent("stream" + std::to_string(t), i - 10, t % 2 ? "module" : "", "process",
+                               i % 2 ? TraceEvent::Type::END : TraceEvent::Type::START, time));
+        if (i % 100 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  writer.Close();
+  EXPECT_FALSE(writer.IsOpened());
+  EXPECT_EQ(0u, writer.GetDroppedNumber());
+  EXPECT_EQ(static_cast<uint64_t>(kThreadNum * kEventNum), writer.GetWrittenNumber());
+  writer.Write(MakeEvent("stream0", 0, "", "process", TraceEvent::Type::START, start));
+
+  TraceFileReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  std::vector<int> next_pts(kThreadNum, -10);
+  TraceEvent event;
+  int count = 0;
+  while (reader.Next(&event)) {
+    ++count;
+    int t = event.key.first.back() - '0';
+    ASSERT_TRUE(t >= 0 && t < kThreadNum);
+    // the events of a thread keep their order
+    EXPECT_EQ(next_pts[t]++, event.key.second);
+    int i = static_cast<int>(event.key.second + 10);
+    EXPECT_EQ(start + std::chrono::microseconds(i * kThreadNum + t), event.time);
+    EXPECT_EQ(t % 2 ? "module" : "", event.module_name);
+    EXPECT_EQ(t % 2 ? TraceEvent::Level::MODULE : TraceEvent::Level::PIPELINE, event.level);
+    EXPECT_EQ("process", event.process_name);
+    EXPECT_EQ(i % 2 ? TraceEvent::Type::END : TraceEvent::Type::START, event.type);
+  }
+  EXPECT_EQ(kThreadNum * kEventNum, count);
+  EXPECT_EQ(0u, reader.GetDroppedNumber());
+  reader.Close();
+  EXPECT_FALSE(reader.Next(&event));
+  std::remove(path.c_str());
+}
+
+TEST(CoreTraceFile, ThreadsExitWhileDraining) {
+  const std::string path = TraceFilePath("threads_exit");
+  constexpr int kRoundNum = 100;
+  constexpr int kThreadNum = 4;
+  constexpr int kEventNum = 100;
+  constexpr int kHeavyEventNum = 2000;
+  TraceFileWriter writer;
+  ASSERT_TRUE(writer.Open(path, 1));
+  uint64_t total = 0;
+  for (int round = 0; round < kRoundNum; ++round) {
+    std::atomic<int> registered{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    // the buffers of these threads are drained first, they write and exit while the heavy buffers are drained
+    for (int t = 0; t < kThreadNum; ++t) {
+      threads.emplace_back([&] {
+        writer.Write(MakeEvent("stream", 0, "module", "process", TraceEvent::Type::START, Clock::now()));
+        registered++;
+        while (!go.load()) std::this_thread::yield();
+        for (int i = 1; i <= kEventNum; ++i) {
+          writer.Write(MakeEvent("stream", i, "module", "process", TraceEvent::Type::START, Clock::now()));
+        }
+      });
+    }
+    while (registered.load() < kThreadNum) std::this_thread::yield();
+    for (int t = 0; t < kThreadNum; ++t) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < kHeavyEventNum; ++i) {
+          writer.Write(MakeEvent("heavy_stream", i, "module", "process", TraceEvent::Type::END, Clock::now()));
+        }
+        go.store(true);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    total += kThreadNum * (kEventNum + 1 + kHeavyEventNum);
+  }
+  writer.Close();
+  EXPECT_EQ(total, writer.GetWrittenNumber() + writer.GetDroppedNumber());
+
+  TraceFileReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  TraceEvent event;
+  uint64_t count = 0;
+  while (reader.Next(&event)) ++count;
+  EXPECT_EQ(writer.GetWrittenNumber(), count);
+  EXPECT_EQ(writer.GetDroppedNumber(), reader.GetDroppedNumber());
+  std::remove(path.c_str());
+}
+
+TEST(CoreTraceFile, DropWhenBufferIsFull) {
+  const std::string path = TraceFilePath("drop");
+  const uint64_t total = 3 * TraceFileWriter::kBufferCapacity;
+  TraceFileWriter writer;
+  // the buffer is not drained before the events are written
+  ASSERT_TRUE(writer.Open(path, 60 * 1000));
+  for (uint64_t i = 0; i < total; ++i) {
+    writer.Write(MakeEvent("stream", i, "module", "process", TraceEvent::Type::START, Clock::now()));
+  }
+  writer.Close();
+  EXPECT_EQ(total, writer.GetWrittenNumber() + writer.GetDroppedNumber());
+  EXPECT_GE(writer.GetDroppedNumber(), total - TraceFileWriter::kBufferCapacity);
+
+  TraceFileReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  TraceEvent event;
+  uint64_t count = 0;
+  while (reader.Next(&event)) ++count;
+  EXPECT_EQ(writer.GetWrittenNumber(), count);
+  EXPECT_EQ(writer.GetDroppedNumber(), reader.GetDroppedNumber());
+  std::remove(path.c_str());
+}
+
+TEST(CoreTraceFile, ReadInvalidFile) {
+  TraceFileReader reader;
+  EXPECT_FALSE(reader.Open("/tmp/cnstream_test_not_exist.cntrace"));
+  const std::string path = TraceFilePath("invalid");
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  fputs("not a trace file", file);
+  fclose(file);
+  EXPECT_FALSE(reader.Open(path));
+
+  // a truncated record ends the file
+  TraceFileWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  writer.Write(MakeEvent("stream", 0, "module", "process", TraceEvent::Type::START, Clock::now()));
+  writer.Write(MakeEvent("stream", 1, "module", "process", TraceEvent::Type::START, Clock::now()));
+  writer.Close();
+  FILE* in = fopen(path.c_str(), "rb");
+  ASSERT_NE(nullptr, in);
+  std::string content;
+  int c;
+  while ((c = fgetc(in)) != EOF) content.push_back(static_cast<char>(c));
+  fclose(in);
+  file = fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  fwrite(content.data(), content.size() - 1, 1, file);
+  fclose(file);
+  ASSERT_TRUE(reader.Open(path));
+  TraceEvent event;
+  EXPECT_TRUE(reader.Next(&event));
+  EXPECT_EQ(0, event.key.second);
+  EXPECT_FALSE(reader.Next(&event));
+  std::remove(path.c_str());
+}
+
+}  // namespace cnstream
@@ -0,0 +1,101 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+#include "profiler/trace_sampler.hpp"
+
+namespace cnstream {
+
+TEST(CoreTraceSampler, IsNeeded) {
+  ProfilerConfig config;
+  config.trace_sample_interval = 10;
+  EXPECT_FALSE(TraceSampler::IsNeeded(config));
+  config.enable_tracing = true;
+  EXPECT_TRUE(TraceSampler::IsNeeded(config));
+  config.trace_sample_interval = 1;
+  EXPECT_FALSE(TraceSampler::IsNeeded(config));
+}
+
+TEST(CoreTraceSampler, Interval) {
+  ProfilerConfig config;
+  config.trace_sample_interval = 10;
+  TraceSampler sampler(config);
+  const Time now = Clock::now();
+  const int frame_num = 10000;
+  int sampled = 0;
+  for (int i = 0; i < frame_num; ++i) {
+    // the timestamps are regularly spaced, e.g. 40ms in 90kHz
+    bool first = sampler.IsSampled("stream0", i * 3600, now);
+    // the decision only depends on the frame
+    EXPECT_EQ(first, sampler.IsSampled("stream0", i * 3600, now + std::chrono::seconds(1)));
+    sampled += first;
+  }
+  EXPECT_GT(sampled, frame_num / 10 * 8 / 10);
+  EXPECT_LT(sampled, frame_num / 10 * 12 / 10);
+}
+
+TEST(CoreTraceSampler, Streams) {
+  ProfilerConfig config;
+  config.trace_sample_interval = 0;
+  config.trace_streams = {"stream0"};
+  TraceSampler sampler(config);
+  const Time now = Clock::now();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(sampler.IsSampled("stream0", i, now));
+    EXPECT_FALSE(sampler.IsSampled("stream1", i, now));
+  }
+}
+
+TEST(CoreTraceSampler, Burst) {
+  ProfilerConfig config;
+  config.trace_sample_interval = 0;
+  TraceSampler sampler(config);
+  const Time now = Clock::now();
+  EXPECT_FALSE(sampler.IsTriggerEnabled());
+  sampler.OnProcessTime("module", Duration(1000), now);
+  EXPECT_FALSE(sampler.IsBursting(now));
+
+  config.trace_latency_threshold = 10;
+  config.trace_burst_duration = 100;
+  TraceSampler trigger(config);
+  EXPECT_TRUE(trigger.IsTriggerEnabled());
+  trigger.OnProcessTime("module", Duration(10), now);
+  EXPECT_FALSE(trigger.IsSampled("stream0", 0, now));
+  EXPECT_EQ(0u, trigger.GetBurstNumber());
+
+  trigger.OnProcessTime("module", Duration(20), now);
+  EXPECT_EQ(1u, trigger.GetBurstNumber());
+  EXPECT_TRUE(trigger.IsSampled("stream0", 0, now + std::chrono::milliseconds(50)));
+  // the window is extended by a slow frame in it
+  trigger.OnProcessTime("module", Duration(20), now + std::chrono::milliseconds(50));
+  EXPECT_EQ(1u, trigger.GetBurstNumber());
+  EXPECT_TRUE(trigger.IsBursting(now + std::chrono::milliseconds(120)));
+  EXPECT_FALSE(trigger.IsBursting(now + std::chrono::milliseconds(150)));
+  EXPECT_FALSE(trigger.IsSampled("stream0", 0, now + std::chrono::milliseconds(150)));
+  // a new window
+  trigger.OnProcessTime("module", Duration(20), now + std::chrono::milliseconds(200));
+  EXPECT_EQ(2u, trigger.GetBurstNumber());
+}
+
+}  // namespace cnstream
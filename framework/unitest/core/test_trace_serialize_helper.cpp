@@ -116,6 +116,10 @@ TEST(CoreTraceSerializeHelper, ToFile) {
   const std::string jstr = "[{\"name\":\"process\",\"id\":0,\"cat\":\"stream0\",\"ts\":200}]";
   EXPECT_TRUE(TraceSerializeHelper::DeserializeFromJSONStr(jstr, &helper));
   EXPECT_TRUE(helper.ToFile(test_filename));
+  TraceSerializeHelper read_helper;
+  EXPECT_TRUE(TraceSerializeHelper::DeserializeFromJSONFile(test_filename, &read_helper));
+  EXPECT_EQ(read_helper.ToJsonStr(), jstr);
+  remove(test_filename.c_str());
 }
 
 TEST(CoreTraceSerializeHelper, Reset) {
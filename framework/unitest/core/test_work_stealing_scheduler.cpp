@@ -0,0 +1,94 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "work_stealing_scheduler.hpp"
+
+namespace cnstream {
+
+TEST(CoreWorkStealingScheduler, RunJobs) {
+  WorkStealingScheduler scheduler(4);
+  EXPECT_EQ(scheduler.GetThreadNum(), 4u);
+  scheduler.Start();
+  EXPECT_TRUE(scheduler.IsRunning());
+  std::atomic<int> cnt{0};
+  const int job_num = 1000;
+  for (int i = 0; i < job_num; ++i) {
+    scheduler.Submit(i, [&] { cnt++; });
+  }
+  for (int retry = 0; retry < 200 && cnt.load() < job_num; ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(cnt.load(), job_num);
+  scheduler.Stop();
+  EXPECT_FALSE(scheduler.IsRunning());
+}
+
+TEST(CoreWorkStealingScheduler, StealJobs) {
+  WorkStealingScheduler scheduler(4);
+  scheduler.Start();
+  std::atomic<int> running{0}, max_running{0}, cnt{0};
+  // all jobs are submitted to worker 0, the others have to steal them
+  for (int i = 0; i < 8; ++i) {
+    scheduler.Submit(0, [&] {
+      int cur = ++running;
+      int expected = max_running.load();
+      while (cur > expected && !max_running.compare_exchange_weak(expected, cur)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      running--;
+      cnt++;
+    });
+  }
+  for (int retry = 0; retry < 200 && cnt.load() < 8; ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(cnt.load(), 8);
+  EXPECT_GT(max_running.load(), 1);
+  scheduler.Stop();
+}
+
+TEST(CoreWorkStealingScheduler, HelpOnce) {
+  WorkStealingScheduler scheduler(1);
+  // not a worker thread
+  EXPECT_FALSE(scheduler.HelpOnce());
+  scheduler.Start();
+  std::atomic<bool> inner_done{false}, helped{false};
+  scheduler.Submit(0, [&] {
+    // the only worker waits for the second job, it has to run the job by itself.
+    while (!inner_done.load()) {
+      if (scheduler.HelpOnce()) helped = true;
+    }
+  });
+  scheduler.Submit(0, [&] { inner_done = true; });
+  for (int retry = 0; retry < 200 && !inner_done.load(); ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_TRUE(inner_done.load());
+  EXPECT_TRUE(helped.load());
+  scheduler.Stop();
+}
+
+}  // namespace cnstream
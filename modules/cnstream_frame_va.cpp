@@ -28,6 +28,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <map>
@@ -39,10 +40,33 @@
 
 #include "cnstream_logging.hpp"
 #include "cnstream_module.hpp"
+#include "private/cnstream_parallel.hpp"
 
 namespace cnstream {
 
+static const bool s_frame_va_slots_registered = Collection::RegisterSlot(kCNDataFrameSlot) &&
+                                                Collection::RegisterSlot(kCNInferObjsSlot) &&
+                                                Collection::RegisterSlot(kCNInferDataSlot);
+
+static const bool s_frame_va_pixel_releaser_registered = CNFrameInfo::RegisterPixelReleaser([](CNFrameInfo* frame) {
+  if (frame->collection.HasValue(kCNDataFrameSlot)) frame->collection.Get(kCNDataFrameSlot)->ReleasePixels();
+});
+
+static const bool s_frame_va_pixel_copy_releaser_registered = CNFrameInfo::RegisterPixelCopyReleaser(
+    [](CNFrameInfo* frame, CNFrameInfo::PixelCopy copy) {
+      if (!frame->collection.HasValue(kCNDataFrameSlot)) return;
+      CNDataFramePtr frame_data = frame->collection.Get(kCNDataFrameSlot);
+      if (copy == CNFrameInfo::PixelCopy::HOST) {
+        frame_data->ReleaseHostPixels();
+      } else {
+        frame_data->ReleaseDevicePixels();
+      }
+    });
+
 namespace color_cvt {
+// frames higher than two bands, e.g. 1080p and 4K, are converted on multiple threads
+static constexpr int kMinConvertBandRows = 360;
+
 static
 cv::Mat BGRToBGR(const CNDataFrame& frame) {
   const cv::Mat bgr(frame.height, frame.stride[0], CV_8UC3, const_cast<void*>(frame.data[0]->GetCpuData()));
@@ -53,8 +77,9 @@ static
 cv::Mat RGBToBGR(const CNDataFrame& frame) {
   const cv::Mat rgb(frame.height, frame.stride[0], CV_8UC3, const_cast<void*>(frame.data[0]->GetCpuData()));
   cv::Mat bgr;
-  cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
-  return bgr(cv::Rect(0, 0, frame.width, frame.height)).clone();
+  // cvtColor writes a new mat, no more clone is needed
+  cv::cvtColor(rgb(cv::Rect(0, 0, frame.width, frame.height)), bgr, cv::COLOR_RGB2BGR);
+  return bgr;
 }
 
 static
@@ -73,13 +98,19 @@ cv::Mat YUV420SPToBGR(const CNDataFrame& frame, bool nv21) {
   cv::Mat bgr(height, width, CV_8UC3);
   uint8_t* dst_bgr24 = bgr.data;
   int dst_stride = width * 3;
-  // kYvuH709Constants make it to BGR
-  if (nv21)
-    libyuv::NV21ToRGB24Matrix(y_plane, y_stride, uv_plane, uv_stride,
-                              dst_bgr24, dst_stride, &libyuv::kYvuH709Constants, width, height);
-  else
-    libyuv::NV12ToRGB24Matrix(y_plane, y_stride, uv_plane, uv_stride,
-                              dst_bgr24, dst_stride, &libyuv::kYvuH709Constants, width, height);
+  // large frames are converted in bands of even rows on the shared pool
+  ParallelFor(height, kMinConvertBandRows, 2, [&](int begin, int end) {
+    const uint8_t* y = y_plane + begin * y_stride;
+    const uint8_t* uv = uv_plane + begin / 2 * uv_stride;
+    uint8_t* dst = dst_bgr24 + begin * dst_stride;
+    // kYvuH709Constants make it to BGR
+    if (nv21)
+      libyuv::NV21ToRGB24Matrix(y, y_stride, uv, uv_stride, dst, dst_stride, &libyuv::kYvuH709Constants, width,
+                                end - begin);
+    else
+      libyuv::NV12ToRGB24Matrix(y, y_stride, uv, uv_stride, dst, dst_stride, &libyuv::kYvuH709Constants, width,
+                                end - begin);
+  });
   return bgr;
 }
 
@@ -111,9 +142,67 @@ cv::Mat FrameToImageBGR(const CNDataFrame& frame) {
   return cv::Mat();
 }
 
+/* Gets the planes of a YUV420SP frame cut to even width and height. */
+static
+void YUV420SPPlanes(const CNDataFrame& frame, cv::Mat* y_mat, cv::Mat* uv_mat) {
+  uint8_t* y_plane = reinterpret_cast<uint8_t*>(const_cast<void*>(frame.data[0]->GetCpuData()));
+  uint8_t* uv_plane = reinterpret_cast<uint8_t*>(const_cast<void*>(frame.data[1]->GetCpuData()));
+  const int frame_w = frame.width & (~1), frame_h = frame.height & (~1);
+  *y_mat = cv::Mat(frame_h, frame_w, CV_8UC1, y_plane, frame.stride[0]);
+  *uv_mat = cv::Mat(frame_h / 2, frame_w / 2, CV_8UC2, uv_plane, frame.stride[1]);
+}
+
+/* Converts the region of the planes of a YUV420SP frame, or a level of its pyramid. The planes are scaled to the view
+ * size before the color conversion, the region is aligned to even coordinates. */
+static
+cv::Mat YUV420SPToView(const cv::Mat& y_mat, const cv::Mat& uv_mat, bool nv21, const cv::Rect& roi,
+                       const cv::Size& size) {
+  const int frame_w = y_mat.cols, frame_h = y_mat.rows;
+  const int x0 = roi.x & (~1), y0 = roi.y & (~1);
+  const int x1 = std::min((roi.x + roi.width + 1) & (~1), frame_w);
+  const int y1 = std::min((roi.y + roi.height + 1) & (~1), frame_h);
+  const cv::Mat y_roi = y_mat(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+  const cv::Mat uv_roi = uv_mat(cv::Rect(x0 / 2, y0 / 2, (x1 - x0) / 2, (y1 - y0) / 2));
+
+  // NV12 needs even width and height, the odd column or row is cut at last
+  const cv::Size even_size((size.width + 1) & (~1), (size.height + 1) & (~1));
+  cv::Mat y_dst = y_roi, uv_dst = uv_roi;
+  if (even_size != y_roi.size()) {
+    cv::resize(y_roi, y_dst, even_size, 0, 0, cv::INTER_LINEAR);
+    cv::resize(uv_roi, uv_dst, cv::Size(even_size.width / 2, even_size.height / 2), 0, 0, cv::INTER_LINEAR);
+  }
+  cv::Mat bgr(even_size, CV_8UC3);
+  ParallelFor(even_size.height, kMinConvertBandRows, 2, [&](int begin, int end) {
+    const uint8_t* y = y_dst.ptr<uint8_t>(begin);
+    const uint8_t* uv = uv_dst.ptr<uint8_t>(begin / 2);
+    uint8_t* dst = bgr.ptr<uint8_t>(begin);
+    // kYvuH709Constants make it to BGR
+    if (nv21)
+      libyuv::NV21ToRGB24Matrix(y, static_cast<int>(y_dst.step), uv, static_cast<int>(uv_dst.step), dst,
+                                static_cast<int>(bgr.step), &libyuv::kYvuH709Constants, even_size.width, end - begin);
+    else
+      libyuv::NV12ToRGB24Matrix(y, static_cast<int>(y_dst.step), uv, static_cast<int>(uv_dst.step), dst,
+                                static_cast<int>(bgr.step), &libyuv::kYvuH709Constants, even_size.width, end - begin);
+  });
+  return bgr(cv::Rect(0, 0, size.width, size.height));
+}
+
 }  // namespace color_cvt
 
 cv::Mat CNDataFrame::ImageBGR() {
+  std::lock_guard<std::mutex> lk(mtx);
+  if (!bgr_mat.empty()) {
+    return bgr_mat;
+  }
+  if (fmt == CNDataFormat::CN_PIXEL_FORMAT_BGR24 && stride[0] == width && data[0]) {
+    // already BGR and continuous, share the cpu data
+    return cv::Mat(height, width, CV_8UC3, const_cast<void*>(data[0]->GetCpuData()));
+  }
+  bgr_mat = color_cvt::FrameToImageBGR(*this);
+  return bgr_mat;
+}
+
+cv::Mat CNDataFrame::ImageBGRMutable() {
   std::lock_guard<std::mutex> lk(mtx);
   if (!bgr_mat.empty()) {
     return bgr_mat;
@@ -122,6 +211,111 @@ cv::Mat CNDataFrame::ImageBGR() {
   return bgr_mat;
 }
 
+cv::Mat CNDataFrame::ImageView(CNDataFormat view_fmt, int view_width, int view_height, cv::Rect roi) {
+  if (view_fmt != CNDataFormat::CN_PIXEL_FORMAT_BGR24 && view_fmt != CNDataFormat::CN_PIXEL_FORMAT_RGB24) {
+    LOGE(FRAME) << "ImageView: unsupported view format. fmt[" << static_cast<int>(view_fmt) << "]";
+    return cv::Mat();
+  }
+  if (roi.area() <= 0) roi = cv::Rect(0, 0, width, height);
+  roi &= cv::Rect(0, 0, width, height);
+  if (roi.area() <= 0 || view_width < 0 || view_height < 0) {
+    LOGE(FRAME) << "ImageView: invalid region or size.";
+    return cv::Mat();
+  }
+  const cv::Size size(view_width ? view_width : roi.width, view_height ? view_height : roi.height);
+
+  std::lock_guard<std::mutex> lk(mtx);
+  const ImageViewKey key(static_cast<int>(view_fmt), size.width, size.height, roi.x, roi.y, roi.width, roi.height);
+  auto iter = image_views_.find(key);
+  if (iter != image_views_.end()) return iter->second;
+
+  cv::Mat view;
+  bool is_rgb = false;
+  const bool is_yuv = fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 ||
+                      fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21;
+  if (bgr_mat.empty() && is_yuv) {
+    const bool nv21 = fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21;
+    // the smallest level of the pyramid keeping the region at least as large as the view
+    const CNFramePyramidLevel* level = nullptr;
+    for (auto it = pyramid_.rbegin(); it != pyramid_.rend() && !level; ++it) {
+      if (static_cast<int64_t>(roi.width) * it->width >= static_cast<int64_t>(size.width) * width &&
+          static_cast<int64_t>(roi.height) * it->height >= static_cast<int64_t>(size.height) * height) {
+        level = &*it;
+      }
+    }
+    if (level) {
+      const double sx = 1.0 * level->width / width, sy = 1.0 * level->height / height;
+      const int x0 = static_cast<int>(roi.x * sx), y0 = static_cast<int>(roi.y * sy);
+      const int x1 = std::min(static_cast<int>(std::ceil((roi.x + roi.width) * sx)), level->width);
+      const int y1 = std::min(static_cast<int>(std::ceil((roi.y + roi.height) * sy)), level->height);
+      view = color_cvt::YUV420SPToView(level->y, level->uv, nv21, cv::Rect(x0, y0, x1 - x0, y1 - y0), size);
+    } else {
+      cv::Mat y_mat, uv_mat;
+      color_cvt::YUV420SPPlanes(*this, &y_mat, &uv_mat);
+      view = color_cvt::YUV420SPToView(y_mat, uv_mat, nv21, roi, size);
+    }
+  } else {
+    cv::Mat src;
+    if (!bgr_mat.empty()) {
+      src = bgr_mat;
+    } else if (fmt == CNDataFormat::CN_PIXEL_FORMAT_BGR24 || fmt == CNDataFormat::CN_PIXEL_FORMAT_RGB24) {
+      src = cv::Mat(height, width, CV_8UC3, const_cast<void*>(data[0]->GetCpuData()), stride[0] * 3);
+      is_rgb = fmt == CNDataFormat::CN_PIXEL_FORMAT_RGB24;
+    } else {
+      LOGE(FRAME) << "ImageView: unsupported pixel format. fmt[" << static_cast<int>(fmt) << "]";
+      return cv::Mat();
+    }
+    roi &= cv::Rect(0, 0, src.cols, src.rows);
+    if (size != roi.size()) {
+      cv::resize(src(roi), view, size, 0, 0, cv::INTER_LINEAR);
+    } else {
+      view = src(roi).clone();
+    }
+  }
+  if (is_rgb != (view_fmt == CNDataFormat::CN_PIXEL_FORMAT_RGB24)) {
+    cv::cvtColor(view, view, is_rgb ? cv::COLOR_RGB2BGR : cv::COLOR_BGR2RGB);
+  }
+  image_views_[key] = view;
+  return view;
+}
+
+bool CNDataFrame::BuildPyramid(int levels) {
+  if (levels <= 0) return false;
+  if (fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 && fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21) {
+    LOGE(FRAME) << "BuildPyramid: unsupported pixel format. fmt[" << static_cast<int>(fmt) << "]";
+    return false;
+  }
+  std::lock_guard<std::mutex> lk(mtx);
+  pyramid_.clear();
+  if (!data[0] || !data[1]) return false;
+  cv::Mat y_mat, uv_mat;
+  color_cvt::YUV420SPPlanes(*this, &y_mat, &uv_mat);
+  for (int i = 0; i < levels; ++i) {
+    CNFramePyramidLevel level;
+    level.width = (y_mat.cols / 2) & (~1);
+    level.height = (y_mat.rows / 2) & (~1);
+    if (level.width < 2 || level.height < 2) break;
+    // INTER_AREA averages the 2x2 blocks
+    cv::resize(y_mat, level.y, cv::Size(level.width, level.height), 0, 0, cv::INTER_AREA);
+    cv::resize(uv_mat, level.uv, cv::Size(level.width / 2, level.height / 2), 0, 0, cv::INTER_AREA);
+    y_mat = level.y;
+    uv_mat = level.uv;
+    pyramid_.push_back(std::move(level));
+  }
+  return !pyramid_.empty();
+}
+
+bool CNDataFrame::GetPyramidLevel(int min_width, int min_height, CNFramePyramidLevel* level) {
+  std::lock_guard<std::mutex> lk(mtx);
+  for (auto it = pyramid_.rbegin(); it != pyramid_.rend(); ++it) {
+    if (it->width >= min_width && it->height >= min_height) {
+      if (level) *level = *it;
+      return true;
+    }
+  }
+  return false;
+}
+
 size_t CNDataFrame::GetPlaneBytes(int plane_idx) const {
   if (plane_idx < 0 || plane_idx >= GetPlanes()) return 0;
   switch (fmt) {
@@ -297,87 +491,492 @@ void CNDataFrame::CopyToSyncMemOnDevice(int device_id) {
   dst_device_id = device_id;
 }
 
-bool CNInferObject::AddAttribute(const std::string& key, const CNInferAttr& value) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
-  if (attributes_.find(key) != attributes_.end()) return false;
+/* The queue used by prefetch when no queue is given, one for each device. It lives as long as the process. */
+static cnrtQueue_t GetPrefetchQueue(int dev_id, int ddr_chn) {
+  static std::mutex mtx;
+  static std::map<int, cnrtQueue_t> queues;
+  std::lock_guard<std::mutex> lk(mtx);
+  auto iter = queues.find(dev_id);
+  if (iter != queues.end()) return iter->second;
+  cnrtQueue_t queue = nullptr;
+  CALL_CNRT_BY_CONTEXT(cnrtCreateQueue(&queue), dev_id, ddr_chn);
+  queues[dev_id] = queue;
+  return queue;
+}
 
-  attributes_.insert(std::make_pair(key, value));
+void CNDataFrame::PrefetchToCpu(cnrtQueue_t queue) {
+  if (HasBGRImage()) return;
+  for (int i = 0; i < GetPlanes(); ++i) {
+    if (!data[i] || data[i]->GetHead() != CNSyncedMemory::SyncedHead::HEAD_AT_MLU) continue;
+    cnrtQueue_t q = queue ? queue : GetPrefetchQueue(data[i]->GetMluDevId(), data[i]->GetMluDdrChnId());
+    data[i]->PrefetchToCpu(q);
+  }
+}
+
+void CNDataFrame::PrefetchToMlu(cnrtQueue_t queue) {
+  for (int i = 0; i < GetPlanes(); ++i) {
+    if (!data[i] || data[i]->GetHead() != CNSyncedMemory::SyncedHead::HEAD_AT_CPU) continue;
+    if (data[i]->GetMluDevId() < 0) continue;
+    cnrtQueue_t q = queue ? queue : GetPrefetchQueue(data[i]->GetMluDevId(), data[i]->GetMluDdrChnId());
+    data[i]->PrefetchToMlu(q);
+  }
+}
+
+// the pixels released while they are pinned
+struct CNDataFrame::PinnedPixels {
+  std::vector<std::unique_ptr<CNSyncedMemory>> planes;
+  std::vector<std::shared_ptr<void>> buffers;
+  std::vector<std::unique_ptr<IDataDeallocator>> deallocators;
+};
+
+void CNDataFrame::ReleasePixels() {
+  std::unique_ptr<IDataDeallocator> deallocator;
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    image_views_.clear();
+    pyramid_.clear();
+    bgr_mat.release();
+    std::shared_ptr<PinnedPixels> pinned = pinned_pixels_.lock();
+    if (pinned) {
+      // the planes are shared, they are freed with the last pin
+      for (int i = 0; i < CN_MAX_PLANES; ++i) {
+        if (data[i]) pinned->planes.push_back(std::move(data[i]));
+      }
+      if (mlu_data) pinned->buffers.push_back(std::move(mlu_data));
+      if (cpu_data) pinned->buffers.push_back(std::move(cpu_data));
+      if (deAllocator_) pinned->deallocators.push_back(std::move(deAllocator_));
+    }
+    for (int i = 0; i < CN_MAX_PLANES; ++i) data[i].reset();
+    mlu_data.reset();
+    cpu_data.reset();
+    deallocator = std::move(deAllocator_);
+  }
+  // the decoder buffer is given back out of the lock
+  deallocator.reset();
+}
+
+bool CNDataFrame::ReleaseHostPixels() {
+  std::lock_guard<std::mutex> lk(mtx);
+  // the pinned arrays share the planes on CPU
+  if (pinned_pixels_.lock() || !data[0]) return false;
+  const int planes = GetPlanes();
+  for (int i = 0; i < planes; ++i) {
+    if (!data[i] || data[i]->GetHead() != CNSyncedMemory::SyncedHead::SYNCED) return false;
+  }
+  image_views_.clear();
+  pyramid_.clear();
+  bgr_mat.release();
+  bool released = true;
+  for (int i = 0; i < planes; ++i) released = data[i]->ReleaseCpuMirror() && released;
+  // a plane modified meanwhile still points to the buffer
+  if (released) cpu_data.reset();
+  return released;
+}
+
+bool CNDataFrame::ReleaseDevicePixels() {
+  std::unique_ptr<IDataDeallocator> deallocator;
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!data[0]) return false;
+    const int planes = GetPlanes();
+    for (int i = 0; i < planes; ++i) {
+      if (!data[i] || data[i]->GetHead() != CNSyncedMemory::SyncedHead::SYNCED) return false;
+    }
+    bool released = true;
+    for (int i = 0; i < planes; ++i) released = data[i]->ReleaseMluMirror() && released;
+    if (!released) return false;
+    mlu_data.reset();
+    deallocator = std::move(deAllocator_);
+  }
+  // the decoder buffer is given back out of the lock
+  deallocator.reset();
   return true;
 }
 
-bool CNInferObject::AddAttribute(const std::pair<std::string, CNInferAttr>& attribute) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
-  if (attributes_.find(attribute.first) != attributes_.end()) return false;
+std::shared_ptr<void> CNDataFrame::PinPixels() {
+  std::lock_guard<std::mutex> lk(mtx);
+  std::shared_ptr<PinnedPixels> pinned = pinned_pixels_.lock();
+  if (!pinned) {
+    pinned = std::make_shared<PinnedPixels>();
+    pinned_pixels_ = pinned;
+  }
+  return pinned;
+}
+
+constexpr size_t InferObjArena::kFirstChunkSize;
+constexpr size_t InferObjArena::kMaxChunkSize;
+
+InferObjArena::~InferObjArena() {
+  for (char* chunk : chunks_) delete[] chunk;
+}
+
+void* InferObjArena::Allocate(size_t bytes, size_t align) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  size_t offset = (offset_ + align - 1) & ~(align - 1);
+  if (chunks_.empty() || offset + bytes > chunk_size_) {
+    // the chunks grow with the objects of the frame, large allocations take a chunk of their own
+    chunk_size_ = std::max(chunk_size_ ? std::min(chunk_size_ * 2, kMaxChunkSize) : kFirstChunkSize, bytes);
+    chunks_.push_back(new char[chunk_size_]);
+    capacity_ += chunk_size_;
+    offset = 0;
+  }
+  offset_ = offset + bytes;
+  return chunks_.back() + offset;
+}
+
+size_t InferObjArena::GetCapacity() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return capacity_;
+}
 
-  attributes_.insert(attribute);
+void CNInferData::Add(size_t module_id, std::shared_ptr<InferData> data) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  for (auto& it : datas_) {
+    if (it.first == module_id) {
+      it.second.push_back(std::move(data));
+      return;
+    }
+  }
+  datas_.emplace_back(module_id, std::vector<std::shared_ptr<InferData>>{std::move(data)});
+}
+
+std::vector<std::shared_ptr<InferData>> CNInferData::Get(size_t module_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  for (const auto& it : datas_) {
+    if (it.first == module_id) return it.second;
+  }
+  return {};
+}
+
+CNInferObjectPtr CNInferObjs::CreateObject() {
+  std::call_once(arena_flag_, [this] { arena_ = std::make_shared<InferObjArena>(); });
+  return std::allocate_shared<CNInferObject>(InferObjArenaAllocator<CNInferObject>(arena_));
+}
+
+CNInferObjsSnapshot CNInferObjs::GetSnapshot() {
+  CNInferObjsSnapshot snapshot = std::atomic_load(&snapshot_);
+  if (snapshot) return snapshot;
+  std::lock_guard<std::mutex> lk(mutex_);
+  snapshot = std::atomic_load(&snapshot_);
+  if (!snapshot) {
+    snapshot = std::make_shared<const std::vector<CNInferObjectPtr>>(objs_);
+    std::atomic_store(&snapshot_, snapshot);
+  }
+  return snapshot;
+}
+
+void CNInferObjs::Append(const std::vector<CNInferObjectPtr>& objs) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  objs_.insert(objs_.end(), objs.begin(), objs.end());
+  std::atomic_store(&snapshot_, std::make_shared<const std::vector<CNInferObjectPtr>>(objs_));
+  version_.fetch_add(1, std::memory_order_release);
+}
+
+CNInferObjectPtr CNInferObjs::Modify(const CNInferObjectPtr& obj, const std::function<void(CNInferObject*)>& writer) {
+  CNInferObjectPtr clone = CreateObject();
+  obj->CopyTo(clone.get());
+  writer(clone.get());
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = std::find(objs_.begin(), objs_.end(), obj);
+  if (iter == objs_.end()) return nullptr;
+  *iter = clone;
+  std::atomic_store(&snapshot_, std::make_shared<const std::vector<CNInferObjectPtr>>(objs_));
+  version_.fetch_add(1, std::memory_order_release);
+  return clone;
+}
+
+void CNInferObjs::Publish() {
+  std::atomic_store(&snapshot_, CNInferObjsSnapshot());
+  version_.fetch_add(1, std::memory_order_release);
+}
+
+// the items of objects are kept sorted by key
+template <typename T>
+static typename std::vector<std::pair<std::string, T>>::iterator FindKey(std::vector<std::pair<std::string, T>>* items,
+                                                                          const std::string& key) {
+  return std::lower_bound(items->begin(), items->end(), key,
+                          [](const std::pair<std::string, T>& item, const std::string& k) { return item.first < k; });
+}
+
+template <typename T>
+static bool InsertKey(std::vector<std::pair<std::string, T>>* items, const std::string& key, const T& value) {
+  auto iter = FindKey(items, key);
+  if (iter != items->end() && iter->first == key) return false;
+  items->emplace(iter, key, value);
   return true;
 }
 
-CNInferAttr CNInferObject::GetAttribute(const std::string& key) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
-  if (attributes_.find(key) != attributes_.end()) return attributes_[key];
+template <typename T>
+static const T* GetKey(std::vector<std::pair<std::string, T>>* items, const std::string& key) {
+  auto iter = FindKey(items, key);
+  return iter != items->end() && iter->first == key ? &iter->second : nullptr;
+}
 
-  return CNInferAttr();
+bool CNInferObject::AddAttribute(const std::string& key, const CNInferAttr& value) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return InsertKey(&attributes_, key, value);
 }
 
-bool CNInferObject::AddExtraAttribute(const std::string& key, const std::string& value) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
-  if (extra_attributes_.find(key) != extra_attributes_.end()) return false;
+bool CNInferObject::AddAttribute(const std::pair<std::string, CNInferAttr>& attribute) {
+  return AddAttribute(attribute.first, attribute.second);
+}
+
+CNInferAttr CNInferObject::GetAttribute(const std::string& key) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  const CNInferAttr* attribute = GetKey(&attributes_, key);
+  return attribute ? *attribute : CNInferAttr();
+}
+
+CNInferAttrs CNInferObject::GetAttributes() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return attributes_;
+}
 
-  extra_attributes_.insert(std::make_pair(key, value));
+bool CNInferObject::RemoveAttribute(const std::string& key) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = FindKey(&attributes_, key);
+  if (iter != attributes_.end() && iter->first == key) attributes_.erase(iter);
   return true;
 }
 
+bool CNInferObject::AddExtraAttribute(const std::string& key, const std::string& value) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return InsertKey(&extra_attributes_, key, value);
+}
+
 bool CNInferObject::AddExtraAttributes(const std::vector<std::pair<std::string, std::string>>& attributes) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
+  std::lock_guard<std::mutex> lk(mutex_);
   bool ret = true;
   for (auto& attribute : attributes) {
-    ret &= AddExtraAttribute(attribute.first, attribute.second);
+    ret &= InsertKey(&extra_attributes_, attribute.first, attribute.second);
   }
   return ret;
 }
 
 std::string CNInferObject::GetExtraAttribute(const std::string& key) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
-  if (extra_attributes_.find(key) != extra_attributes_.end()) {
-    return extra_attributes_[key];
-  }
-  return "";
+  std::lock_guard<std::mutex> lk(mutex_);
+  const std::string* attribute = GetKey(&extra_attributes_, key);
+  return attribute ? *attribute : "";
 }
 
 bool CNInferObject::RemoveExtraAttribute(const std::string& key) {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
-  if (extra_attributes_.find(key) != extra_attributes_.end()) {
-    extra_attributes_.erase(key);
-  }
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = FindKey(&extra_attributes_, key);
+  if (iter != extra_attributes_.end() && iter->first == key) extra_attributes_.erase(iter);
   return true;
 }
 
 StringPairs CNInferObject::GetExtraAttributes() {
-  std::lock_guard<std::mutex> lk(attribute_mutex_);
-  return StringPairs(extra_attributes_.begin(), extra_attributes_.end());
+  std::lock_guard<std::mutex> lk(mutex_);
+  return extra_attributes_;
 }
 
-bool CNInferObject::AddFeature(const std::string& key, const CNInferFeature& feature) {
-  std::lock_guard<std::mutex> lk(feature_mutex_);
-  if (features_.find(key) != features_.end()) {
-    return false;
+// IEEE-754 half precision, rounded to nearest even
+static uint16_t FloatToHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  const uint32_t abs = bits & 0x7FFFFFFF;
+  if (abs >= 0x7F800000) return sign | (abs > 0x7F800000 ? 0x7E00 : 0x7C00);  // nan or inf
+  if (abs >= 0x477FF000) return sign | 0x7C00;  // overflows to inf
+  if (abs < 0x38800000) {
+    // subnormal, the implicit bit is shifted into the mantissa
+    if (abs < 0x33000000) return sign;
+    const uint32_t exp = abs >> 23;
+    const uint32_t mant = (abs & 0x7FFFFF) | 0x800000;
+    const uint32_t shift = 126 - exp;
+    uint32_t half = mant >> shift;
+    const uint32_t rest = mant & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1))) ++half;
+    return sign | static_cast<uint16_t>(half);
   }
-  features_.insert(std::make_pair(key, feature));
-  return true;
+  uint32_t half = ((abs - 0x38000000) >> 13);
+  const uint32_t rest = abs & 0x1FFF;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) ++half;
+  return sign | static_cast<uint16_t>(half);
+}
+
+static float HalfToFloat(uint16_t half) {
+  const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+  uint32_t exp = (half >> 10) & 0x1F;
+  uint32_t mant = half & 0x3FF;
+  uint32_t bits;
+  if (exp == 0x1F) {
+    bits = sign | 0x7F800000 | (mant << 13);
+  } else if (exp == 0) {
+    if (mant == 0) {
+      bits = sign;
+    } else {
+      // subnormal, normalized in single precision
+      exp = 113;
+      while (!(mant & 0x400)) {
+        mant <<= 1;
+        --exp;
+      }
+      bits = sign | (exp << 23) | ((mant & 0x3FF) << 13);
+    }
+  } else {
+    bits = sign | ((exp + 112) << 23) | (mant << 13);
+  }
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+CNInferQuantizedFeature CNInferQuantizedFeature::Quantize(const float* feature, size_t dimension,
+                                                          CNFeaturePrecision precision) {
+  CNInferQuantizedFeature quantized;
+  quantized.precision = precision;
+  quantized.dimension = static_cast<uint32_t>(dimension);
+  switch (precision) {
+    case CNFeaturePrecision::FP16: {
+      quantized.data.resize(dimension * sizeof(uint16_t));
+      uint16_t* dst = reinterpret_cast<uint16_t*>(quantized.data.data());
+      for (size_t i = 0; i < dimension; ++i) dst[i] = FloatToHalf(feature[i]);
+      break;
+    }
+    case CNFeaturePrecision::INT8: {
+      float max_abs = 0;
+      for (size_t i = 0; i < dimension; ++i) max_abs = std::max(max_abs, std::abs(feature[i]));
+      quantized.scale = max_abs > 0 ? max_abs / 127 : 1;
+      quantized.data.resize(dimension);
+      int8_t* dst = reinterpret_cast<int8_t*>(quantized.data.data());
+      for (size_t i = 0; i < dimension; ++i) {
+        dst[i] = static_cast<int8_t>(std::lround(std::max(-127.f, std::min(127.f, feature[i] / quantized.scale))));
+      }
+      break;
+    }
+    default:
+      quantized.precision = CNFeaturePrecision::FP32;
+      quantized.data.resize(dimension * sizeof(float));
+      if (dimension) memcpy(quantized.data.data(), feature, dimension * sizeof(float));
+      break;
+  }
+  return quantized;
+}
+
+void CNInferQuantizedFeature::Dequantize(float* out) const {
+  switch (precision) {
+    case CNFeaturePrecision::FP16: {
+      const uint16_t* src = reinterpret_cast<const uint16_t*>(data.data());
+      for (uint32_t i = 0; i < dimension; ++i) out[i] = HalfToFloat(src[i]);
+      break;
+    }
+    case CNFeaturePrecision::INT8: {
+      const int8_t* src = reinterpret_cast<const int8_t*>(data.data());
+      for (uint32_t i = 0; i < dimension; ++i) out[i] = src[i] * scale;
+      break;
+    }
+    default:
+      if (dimension) memcpy(out, data.data(), dimension * sizeof(float));
+      break;
+  }
+}
+
+CNInferFeature CNInferQuantizedFeature::Dequantize() const {
+  CNInferFeature feature(dimension);
+  Dequantize(feature.data());
+  return feature;
+}
+
+bool CNInferObject::AddFeature(const std::string& key, const CNInferFeature& feature) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (GetKey(&quantized_features_, key)) return false;
+  return InsertKey(&features_, key, feature);
+}
+
+bool CNInferObject::AddFeature(const std::string& key, const CNInferFeature& feature, CNFeaturePrecision precision) {
+  if (precision == CNFeaturePrecision::FP32) return AddFeature(key, feature);
+  // quantized out of the lock
+  CNInferQuantizedFeature quantized = CNInferQuantizedFeature::Quantize(feature.data(), feature.size(), precision);
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (GetKey(&features_, key)) return false;
+  return InsertKey(&quantized_features_, key, quantized);
+}
+
+bool CNInferObject::AddFeature(const std::string& key, const CNInferQuantizedFeature& feature) {
+  if (feature.precision == CNFeaturePrecision::FP32) return AddFeature(key, feature.Dequantize());
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (GetKey(&features_, key)) return false;
+  return InsertKey(&quantized_features_, key, feature);
 }
 
 CNInferFeature CNInferObject::GetFeature(const std::string& key) {
-  std::lock_guard<std::mutex> lk(feature_mutex_);
-  if (features_.find(key) != features_.end()) {
-    return features_[key];
+  std::lock_guard<std::mutex> lk(mutex_);
+  const CNInferFeature* feature = GetKey(&features_, key);
+  if (feature) return *feature;
+  const CNInferQuantizedFeature* quantized = GetKey(&quantized_features_, key);
+  return quantized ? quantized->Dequantize() : CNInferFeature();
+}
+
+bool CNInferObject::VisitFeature(const std::string& key,
+                                 const std::function<void(const CNInferFeature&)>& visitor) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  const CNInferFeature* feature = GetKey(&features_, key);
+  if (feature) {
+    visitor(*feature);
+    return true;
   }
-  return CNInferFeature();
+  const CNInferQuantizedFeature* quantized = GetKey(&quantized_features_, key);
+  if (!quantized) return false;
+  visitor(quantized->Dequantize());
+  return true;
 }
 
 CNInferFeatures CNInferObject::GetFeatures() {
-  std::lock_guard<std::mutex> lk(feature_mutex_);
-  return CNInferFeatures(features_.begin(), features_.end());
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (quantized_features_.empty()) return features_;
+  CNInferFeatures features = features_;
+  for (const auto& it : quantized_features_) features.emplace_back(it.first, it.second.Dequantize());
+  std::sort(features.begin(), features.end(),
+            [](const std::pair<std::string, CNInferFeature>& a, const std::pair<std::string, CNInferFeature>& b) {
+              return a.first < b.first;
+            });
+  return features;
+}
+
+bool CNInferObject::VisitQuantizedFeature(const std::string& key,
+                                          const std::function<void(const CNInferQuantizedFeature&)>& visitor) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  const CNInferQuantizedFeature* quantized = GetKey(&quantized_features_, key);
+  if (!quantized) return false;
+  visitor(*quantized);
+  return true;
+}
+
+void CNInferObject::VisitQuantizedFeatures(const std::function<void(const CNInferQuantizedFeatures&)>& visitor) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  visitor(quantized_features_);
+}
+
+void CNInferObject::Visit(
+    const std::function<void(const CNInferAttrs&, const StringPairs&, const CNInferFeatures&)>& visitor) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  visitor(attributes_, extra_attributes_, features_);
+}
+
+void CNInferObject::CopyTo(CNInferObject* dst) {
+  if (dst == this) return;
+  CNInferAttrs attributes;
+  StringPairs extra_attributes;
+  CNInferFeatures features;
+  CNInferQuantizedFeatures quantized_features;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    attributes = attributes_;
+    extra_attributes = extra_attributes_;
+    features = features_;
+    quantized_features = quantized_features_;
+  }
+  dst->id = id;
+  dst->track_id = track_id;
+  dst->score = score;
+  dst->bbox = bbox;
+  std::lock_guard<std::mutex> lk(dst->mutex_);
+  dst->attributes_ = std::move(attributes);
+  dst->extra_attributes_ = std::move(extra_attributes);
+  dst->features_ = std::move(features);
+  dst->quantized_features_ = std::move(quantized_features);
 }
 
 }  // namespace cnstream
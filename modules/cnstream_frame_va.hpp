@@ -32,10 +32,13 @@
 #include <opencv2/imgcodecs/imgcodecs.hpp>
 #endif
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <map>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -103,6 +106,18 @@ inline int CNGetPlanes(CNDataFormat fmt) {
   return 0;
 }
 
+/**
+ * @struct CNFramePyramidLevel
+ *
+ * @brief CNFramePyramidLevel is a downscaled copy of a YUV420SP frame on CPU, see CNDataFrame::BuildPyramid.
+ */
+struct CNFramePyramidLevel {
+  int width = 0;   ///< The width of the level, even.
+  int height = 0;  ///< The height of the level, even.
+  cv::Mat y;       ///< The luma plane, CV_8UC1 of height x width.
+  cv::Mat uv;      ///< The interleaved chroma plane in the order of the frame format, CV_8UC2 of the half size.
+};
+
 /**
  * @class CNDataFrame
  *
@@ -166,11 +181,22 @@ class CNDataFrame : public NonCopyable {
   /**
    * @brief Converts data to the BGR format.
    *
-   * @return Returns data with OpenCV mat type.
+   * @return Returns data with OpenCV mat type. It should not be modified, use ImageBGRMutable() instead.
    *
-   * @note This function is called after CNDataFrame::CopyToSyncMem() is invoked.
+   * @note This function is called after CNDataFrame::CopyToSyncMem() is invoked. If the frame is BGR24 and
+   *       its stride equals to its width, no conversion is done, the returned mat shares the CPU data of the frame.
+   *       Once ImageBGRMutable() is called, the image returned by ImageBGRMutable() is returned.
    */
   cv::Mat ImageBGR();
+  /**
+   * @brief Converts data to the BGR format, the image is a copy of the frame data which can be modified, e.g. by Osd.
+   *
+   * @return Returns data with OpenCV mat type.
+   *
+   * @note This function is called after CNDataFrame::CopyToSyncMem() is invoked. The image is converted once and
+   *       cached, the following calls and ImageBGR() return the same image.
+   */
+  cv::Mat ImageBGRMutable();
   /**
    * @brief Checks whether there is BGR image stored.
    *
@@ -181,6 +207,60 @@ class CNDataFrame : public NonCopyable {
     if (bgr_mat.empty()) return false;
     return true;
   }
+  /**
+   * @brief Gets a view of the frame in the given format, size and region.
+   *
+   * The view is converted on the first call and is cached in the frame until the frame is released, the following
+   * calls with the same arguments return the cached view. Only the region is converted, and YUV frames are scaled
+   * before the color conversion, so a downscaled image or a crop is much cheaper than ImageBGR.
+   *
+   * @param[in] view_fmt The format of the view, CN_PIXEL_FORMAT_BGR24 or CN_PIXEL_FORMAT_RGB24.
+   * @param[in] view_width The width of the view, 0 means the width of the region.
+   * @param[in] view_height The height of the view, 0 means the height of the region.
+   * @param[in] roi The region of the frame, an empty rect means the whole frame. For YUV frames it is aligned to
+   *            even coordinates.
+   *
+   * @return Returns the view, or an empty mat if the arguments are invalid. The view is shared by the callers and
+   *         should not be modified.
+   *
+   * @note This function is called after CNDataFrame::CopyToSyncMem() is invoked.
+   */
+  cv::Mat ImageView(CNDataFormat view_fmt, int view_width = 0, int view_height = 0, cv::Rect roi = cv::Rect());
+  /**
+   * @brief Builds the pyramid of a YUV420SP frame, the levels of 1/2, 1/4, ... of the frame size. Each level is
+   * scaled from the one before it by averaging 2x2 blocks, so the full resolution planes are read once.
+   *
+   * Once built, ImageView converts the views from the smallest level keeping the region at least as large as the
+   * view, e.g. a detector input or a preview reads a quarter of the pixels, while the crops at full resolution are
+   * read from the frame. It is called by DataSource, see the ``pyramid_levels`` param.
+   *
+   * @param[in] levels The max number of levels. The levels smaller than 2x2 are not built.
+   *
+   * @return Returns false if no level is built, e.g. the frame is not YUV420SP or has no pixels.
+   *
+   * @note This function is called after CNDataFrame::CopyToSyncMem() is invoked. The pyramid is released with the
+   *       pixels, see ReleasePixels.
+   */
+  bool BuildPyramid(int levels);
+  /**
+   * @brief Gets the smallest level of the pyramid at least as large as the given size.
+   *
+   * @param[in] min_width The min width of the level.
+   * @param[in] min_height The min height of the level.
+   * @param[out] level The level, its planes are shared and should not be modified.
+   *
+   * @return Returns false if no level is small enough, the frame itself should be used.
+   */
+  bool GetPyramidLevel(int min_width, int min_height, CNFramePyramidLevel *level);
+  /**
+   * @brief Gets the levels of the pyramid from the largest one.
+   *
+   * @return Returns the levels, empty if the pyramid is not built. Their planes are shared and should not be modified.
+   */
+  std::vector<CNFramePyramidLevel> GetPyramid() {
+    std::lock_guard<std::mutex> lk(mtx);
+    return pyramid_;
+  }
 
   /**
    * @brief Synchronizes source data to specific device, and resets ctx.dev_id to device_id when synced, for
@@ -189,11 +269,83 @@ class CNDataFrame : public NonCopyable {
    * @return No return value.
    */
   void CopyToSyncMemOnDevice(int device_id);
+  /**
+   * @brief Starts copying the planes to CPU asynchronously, e.g. when the frame is routed to a module
+   * processing it on CPU.
+   *
+   * @param[in] queue The MLU queue the copies are enqueued on. If it is nullptr, a queue shared by the frames
+   *            on the same device is used.
+   *
+   * @return No return value.
+   *
+   * @see CNSyncedMemory::PrefetchToCpu
+   */
+  void PrefetchToCpu(cnrtQueue_t queue = nullptr);
+  /**
+   * @brief Starts copying the planes to MLU asynchronously.
+   *
+   * @param[in] queue The MLU queue the copies are enqueued on. If it is nullptr, a queue shared by the frames
+   *            on the same device is used.
+   *
+   * @return No return value.
+   *
+   * @see CNSyncedMemory::PrefetchToMlu
+   */
+  void PrefetchToMlu(cnrtQueue_t queue = nullptr);
+  /**
+   * @brief Releases the pixels of the frame, including the planes, the cached BGR image and views, and the decoder
+   * buffer, while the other fields are kept. It is called by the pipeline through CNFrameInfo::ReleasePixels once
+   * no module left on the route of the frame needs the pixels.
+   *
+   * @return No return value.
+   *
+   * @see Module::NeedsPixels
+   */
+  void ReleasePixels();
+  /**
+   * @brief Releases the copy of the pixels on CPU, including the cached BGR image, views and pyramid, if the planes
+   * are synchronized to MLU as well. It is called by the pipeline through CNFrameInfo::ReleasePixelCopy once no
+   * module left on the route of the frame reads the pixels on CPU. The pixels are copied to CPU again if they are
+   * read on CPU later.
+   *
+   * @return Returns false if the pixels are pinned or not all planes are synchronized, nothing is released.
+   *
+   * @see Module::NeedsHostPixels
+   */
+  bool ReleaseHostPixels();
+  /**
+   * @brief Releases the copy of the pixels on MLU, including the decoder buffer, if the planes are synchronized to
+   * CPU as well, see ReleaseHostPixels.
+   *
+   * @return Returns false if not all planes are synchronized, nothing is released.
+   *
+   * @see Module::NeedsDevicePixels
+   */
+  bool ReleaseDevicePixels();
+  /**
+   * @brief Pins the pixels of the frame, e.g. for the arrays sharing the planes of the frame in python. The pixels
+   * released by ReleasePixels are freed only after all handles returned are released.
+   *
+   * @return Returns the handle keeping the pixels.
+   */
+  std::shared_ptr<void> PinPixels();
+  /**
+   * @brief Checks whether the pixels of the frame are held.
+   *
+   * @return Returns false if the pixels are released or not set.
+   */
+  bool HasPixels() {
+    std::lock_guard<std::mutex> lk(mtx);
+    return data[0] != nullptr;
+  }
 
   std::shared_ptr<void> cpu_data = nullptr;            /*!< A shared pointer to the CPU data. */
   std::shared_ptr<void> mlu_data = nullptr;            /*!< A shared pointer to the MLU data. */
   std::unique_ptr<CNSyncedMemory> data[CN_MAX_PLANES]; /*!< Synchronizes data helper. */
   uint64_t frame_id = -1;                              /*!< The frame index that incremented from 0. */
+  float activity = -1; /*!< The activity of the frame in [0, 1] scored in the compressed domain by the decoder, the
+                            ratio of the frame area not covered by static blocks. -1 means unknown, e.g. key frames,
+                            or the motion vectors are not exported, see the ``motion_activity`` param of DataSource. */
 
   CNDataFormat fmt;                                         /*!< The format of the frame. */
   int width;                                                /*!< The width of the frame. */
@@ -206,6 +358,12 @@ class CNDataFrame : public NonCopyable {
  private:
   std::mutex mtx;
   cv::Mat bgr_mat; /*!< A Mat stores BGR image. */
+  /* (format, width, height, roi x, roi y, roi width, roi height) */
+  using ImageViewKey = std::tuple<int, int, int, int, int, int, int>;
+  std::map<ImageViewKey, cv::Mat> image_views_; /*!< The views converted by ImageView. */
+  std::vector<CNFramePyramidLevel> pyramid_;    /*!< The downscaled levels from the largest one, see BuildPyramid. */
+  struct PinnedPixels;
+  std::weak_ptr<PinnedPixels> pinned_pixels_; /*!< Keeps the pixels released while pinned, see PinPixels. */
 };                 // class CNDataFrame
 
 /**
@@ -232,6 +390,12 @@ typedef struct {
   float score = 0;  ///< The label score of the classification.
 } CNInferAttr;
 
+/**
+ * Defines an alias for std::vector<std::pair<std::string, CNInferAttr>>. CNInferAttrs contains all the classification
+ * properties of one object.
+ */
+using CNInferAttrs = std::vector<std::pair<std::string, CNInferAttr>>;
+
 /**
  *  Defines an alias for std::vector<float>. CNInferFeature contains one kind of inference feature.
  */
@@ -243,6 +407,58 @@ using CNInferFeature = std::vector<float>;
  */
 using CNInferFeatures = std::vector<std::pair<std::string, CNInferFeature>>;
 
+/**
+ * @enum CNFeaturePrecision
+ *
+ * @brief The precision a feature is stored in, see CNInferObject::AddFeature.
+ */
+enum class CNFeaturePrecision : uint8_t {
+  FP32 = 0,  ///< Single precision floats.
+  FP16 = 1,  ///< IEEE-754 half precision floats.
+  INT8 = 2,  ///< Signed 8-bit integers, multiplied by CNInferQuantizedFeature::scale.
+};
+
+/**
+ * @struct CNInferQuantizedFeature
+ *
+ * @brief CNInferQuantizedFeature is a feature stored in half precision or 8-bit integers, it takes a half or a quarter
+ * of the memory of a CNInferFeature.
+ *
+ * For INT8, the values are scaled by ``max(abs(value)) / 127``, so that the largest one is 127 or -127.
+ */
+struct CNInferQuantizedFeature {
+  CNFeaturePrecision precision = CNFeaturePrecision::FP32;  ///< The precision of the values.
+  float scale = 1;            ///< The scale of INT8 values, value = scale * data[i].
+  uint32_t dimension = 0;     ///< The number of values.
+  std::vector<uint8_t> data;  ///< The values in native byte order, floats, halves or 8-bit integers.
+
+  /**
+   * @brief Quantizes a feature.
+   *
+   * @param[in] feature The feature.
+   * @param[in] dimension The number of values of the feature.
+   * @param[in] precision The precision the feature is stored in.
+   *
+   * @return Returns the quantized feature.
+   */
+  static CNInferQuantizedFeature Quantize(const float *feature, size_t dimension, CNFeaturePrecision precision);
+  /**
+   * @brief Restores the values of the feature.
+   *
+   * @param[out] out The values, it has ``dimension`` floats.
+   */
+  void Dequantize(float *out) const;
+  /**
+   * @brief Restores the values of the feature.
+   */
+  CNInferFeature Dequantize() const;
+};
+
+/**
+ * Defines an alias for std::vector<std::pair<std::string, CNInferQuantizedFeature>>.
+ */
+using CNInferQuantizedFeatures = std::vector<std::pair<std::string, CNInferQuantizedFeature>>;
+
 /**
  * Defines an alias for std::vector<std::pair<std::string, std::string>>.
  */
@@ -252,6 +468,9 @@ using StringPairs = std::vector<std::pair<std::string, std::string>>;
  * @class CNInferObject
  *
  * @brief CNInferObject is a class holding the information of an object.
+ *
+ * The attributes, extended attributes and features are kept in vectors sorted by key and guarded by one mutex.
+ * Objects usually have a few of them, so that lookups in the flat vectors are cheaper than in maps.
  */
 class CNInferObject {
  public:
@@ -271,7 +490,7 @@ CNS_IGNORE_DEPRECATED_PUSH
 CNS_IGNORE_DEPRECATED_POP
   std::string id;           ///< The ID of the classification (label value).
   std::string track_id;     ///< The tracking result.
-  float score;              ///< The label score.
+  float score = 0;          ///< The label score.
   CNInferBoundingBox bbox;  ///< The object normalized coordinates.
   CNS_DEPRECATED std::map<int, any> datas;  ///< (Deprecated) User-defined structured information.
   Collection collection;    ///< User-defined structured information.
@@ -313,6 +532,26 @@ CNS_IGNORE_DEPRECATED_POP
    */
   CNInferAttr GetAttribute(const std::string& key);
 
+  /**
+   * @brief Gets all attributes of an object.
+   *
+   * @return Returns all attributes.
+   *
+   * @note This is a thread-safe function.
+   */
+  CNInferAttrs GetAttributes();
+
+  /**
+   * @brief Removes an attribute by key, e.g. so that it is set again by a later inference.
+   *
+   * @param[in] key The key of an attribute you want to remove. See AddAttribute.
+   *
+   * @return Return true.
+   *
+   * @note This is a thread-safe function.
+   */
+  bool RemoveAttribute(const std::string& key);
+
   /**
    * @brief Adds the key of the extended attribute to a specified object.
    *
@@ -382,6 +621,35 @@ CNS_IGNORE_DEPRECATED_POP
    */
   bool AddFeature(const std::string &key, const CNInferFeature &feature);
 
+  /**
+   * @brief Adds a feature stored in a lower precision. The feature is still got by GetFeature, VisitFeature and
+   * GetFeatures as floats, and by VisitQuantizedFeature in the stored form.
+   *
+   * @param[in] key The Key of feature you want to add the feature to. See GetFeature.
+   * @param[in] feature The value of the feature.
+   * @param[in] precision The precision the feature is stored in. FP32 is the same as AddFeature(key, feature).
+   *
+   * @return Returns true if the feature is added successfully. Returns false if the feature
+   *         identified by the key already exists.
+   *
+   * @note This is a thread-safe function.
+   */
+  bool AddFeature(const std::string &key, const CNInferFeature &feature, CNFeaturePrecision precision);
+
+  /**
+   * @brief Adds a feature already quantized, e.g. decoded from a message. A FP32 feature is added as AddFeature(key,
+   * feature) does.
+   *
+   * @param[in] key The Key of feature you want to add the feature to. See GetFeature.
+   * @param[in] feature The quantized feature.
+   *
+   * @return Returns true if the feature is added successfully. Returns false if the feature
+   *         identified by the key already exists.
+   *
+   * @note This is a thread-safe function.
+   */
+  bool AddFeature(const std::string &key, const CNInferQuantizedFeature &feature);
+
   /**
    * @brief Gets an feature by key.
    *
@@ -394,6 +662,19 @@ CNS_IGNORE_DEPRECATED_POP
    */
   CNInferFeature GetFeature(const std::string &key);
 
+  /**
+   * @brief Visits a feature by key without copying it.
+   *
+   * @param[in] key The key of an feature you want to query. See AddFeature.
+   * @param[in] visitor The function called with the feature.
+   *
+   * @return Returns false if the feature identified by the key is not exists, the visitor is not called then.
+   *
+   * @note This is a thread-safe function. This object is locked while the visitor is called, the visitor
+   *       must not access the attributes or features of this object.
+   */
+  bool VisitFeature(const std::string &key, const std::function<void(const CNInferFeature &)> &visitor);
+
   /**
    * @brief Gets the features of an object.
    *
@@ -403,12 +684,56 @@ CNS_IGNORE_DEPRECATED_POP
    */
   CNInferFeatures GetFeatures();
 
+  /**
+   * @brief Visits a feature stored in a lower precision by key without copying it, e.g. to compute distances on the
+   * quantized values.
+   *
+   * @param[in] key The key of an feature you want to query. See AddFeature.
+   * @param[in] visitor The function called with the feature.
+   *
+   * @return Returns false if the feature identified by the key is not exists or it is stored in FP32, the visitor is
+   *         not called then.
+   *
+   * @note This is a thread-safe function. This object is locked while the visitor is called, the visitor
+   *       must not access the attributes or features of this object.
+   */
+  bool VisitQuantizedFeature(const std::string &key,
+                             const std::function<void(const CNInferQuantizedFeature &)> &visitor);
+
+  /**
+   * @brief Visits the features stored in a lower precision without copying them, sorted by key.
+   *
+   * @note This is a thread-safe function, see VisitQuantizedFeature.
+   */
+  void VisitQuantizedFeatures(const std::function<void(const CNInferQuantizedFeatures &)> &visitor);
+
+  /**
+   * @brief Visits all attributes, extended attributes and features of an object without copying them.
+   *
+   * @param[in] visitor The function called with the attributes, extended attributes and features, all sorted by key.
+   *                    The features stored in a lower precision are not visited, see VisitQuantizedFeatures.
+   *
+   * @note This is a thread-safe function. This object is locked while the visitor is called, the visitor
+   *       must not access the attributes or features of this object.
+   */
+  void Visit(const std::function<void(const CNInferAttrs &, const StringPairs &, const CNInferFeatures &)> &visitor);
+
+  /**
+   * @brief Copies the inference results, i.e. the id, track id, score, bounding box, attributes, extended attributes
+   * and features, to another object. The collection is not copied.
+   *
+   * @param[out] dst The object copied to.
+   *
+   * @note This is a thread-safe function.
+   */
+  void CopyTo(CNInferObject *dst);
+
  private:
-  std::map<std::string, CNInferAttr> attributes_;
-  std::map<std::string, std::string> extra_attributes_;
-  std::map<std::string, CNInferFeature> features_;
-  std::mutex attribute_mutex_;
-  std::mutex feature_mutex_;
+  CNInferAttrs attributes_;      // sorted by key
+  StringPairs extra_attributes_;  // sorted by key
+  CNInferFeatures features_;      // sorted by key
+  CNInferQuantizedFeatures quantized_features_;  // sorted by key, the keys are not in features_
+  std::mutex mutex_;
 };
 
 /*!
@@ -417,44 +742,211 @@ CNS_IGNORE_DEPRECATED_POP
  */
 using CNInferObjectPtr = std::shared_ptr<CNInferObject>;
 
+/*!
+ * Defines an alias for an immutable version of the objects of a frame, see CNInferObjs::GetSnapshot.
+ */
+using CNInferObjsSnapshot = std::shared_ptr<const std::vector<CNInferObjectPtr>>;
+
+/**
+ * @class InferObjArena
+ *
+ * @brief InferObjArena is a bump allocator of the objects of one frame. Memory is carved from chunks in order and
+ * never given back one by one, all the chunks are freed at once with the arena.
+ */
+class InferObjArena : public NonCopyable {
+ public:
+  InferObjArena() = default;
+  ~InferObjArena();
+  /**
+   * @brief Allocates memory from the arena.
+   *
+   * @param[in] bytes The size of the memory.
+   * @param[in] align The alignment of the memory, a power of 2 not greater than alignof(std::max_align_t).
+   *
+   * @return Returns the memory, it is valid until the arena is destroyed.
+   *
+   * @note This is a thread-safe function.
+   */
+  void* Allocate(size_t bytes, size_t align);
+  /**
+   * @brief Gets the bytes of the chunks allocated from the system.
+   */
+  size_t GetCapacity();
+
+ private:
+  static constexpr size_t kFirstChunkSize = 16 << 10;
+  static constexpr size_t kMaxChunkSize = 256 << 10;
+  std::mutex mutex_;
+  std::vector<char*> chunks_;
+  size_t chunk_size_ = 0;  // the size of the last chunk
+  size_t offset_ = 0;      // the offset of the free memory in the last chunk
+  size_t capacity_ = 0;
+};
+
+/**
+ * @brief InferObjArenaAllocator is an allocator of the standard library allocating from an InferObjArena. The
+ * allocators hold the arena, so that it lives until the memory allocated by them is not used any more, e.g. the
+ * control blocks of std::allocate_shared keep the arena of the objects.
+ */
+template <typename T>
+class InferObjArenaAllocator {
+ public:
+  using value_type = T;
+  explicit InferObjArenaAllocator(std::shared_ptr<InferObjArena> arena) : arena_(std::move(arena)) {}
+  template <typename U>
+  InferObjArenaAllocator(const InferObjArenaAllocator<U>& other) : arena_(other.arena_) {}  // NOLINT
+  T* allocate(size_t n) { return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T))); }
+  void deallocate(T*, size_t) {}
+  template <typename U>
+  struct rebind {
+    using other = InferObjArenaAllocator<U>;
+  };
+  template <typename U>
+  bool operator==(const InferObjArenaAllocator<U>& other) const { return arena_ == other.arena_; }
+  template <typename U>
+  bool operator!=(const InferObjArenaAllocator<U>& other) const { return arena_ != other.arena_; }
+
+ private:
+  template <typename U>
+  friend class InferObjArenaAllocator;
+  std::shared_ptr<InferObjArena> arena_;
+};
+
 /**
  * @struct CNInferObjs
  *
  * @brief CNInferObjs is a structure holding inference results.
+ *
+ * The objects can be read from versioned snapshots, so that parallel branches of a pipeline do not serialize on
+ * ``mutex_``. A snapshot is never changed. Append() and Modify() copy the vector of objects on write and publish a new
+ * version, an object is cloned by Modify() instead of being changed in place, the readers of older snapshots keep
+ * the former object. Writers changing ``objs_`` directly have to call Publish() after the change.
  */
 struct CNInferObjs : public NonCopyable {
+  /**
+   * @brief Creates an object from the arena of the frame. The object and its reference count take one allocation
+   * from the arena instead of the heap, the arena is freed when the frame and all its objects are released.
+   *
+   * The object is not added to ``objs_``.
+   *
+   * @return Returns the object.
+   *
+   * @note This is a thread-safe function.
+   */
+  CNInferObjectPtr CreateObject();
+
+  /**
+   * @brief Gets the latest snapshot of the objects. It does not lock ``mutex_`` unless the snapshot has to be made
+   * after a change published by Publish().
+   *
+   * @return Returns the snapshot, it is never changed.
+   *
+   * @note This is a thread-safe function. It must not be called with ``mutex_`` locked.
+   */
+  CNInferObjsSnapshot GetSnapshot();
+
+  /**
+   * @brief Appends objects and publishes a new snapshot.
+   *
+   * @param[in] objs The objects to be appended.
+   *
+   * @note This is a thread-safe function.
+   */
+  void Append(const std::vector<CNInferObjectPtr> &objs);
+
+  /**
+   * @brief Changes an object on a clone of it, the clone replaces the object in ``objs_`` and a new snapshot is
+   * published. The snapshots taken before keep the former object.
+   *
+   * @param[in] obj The object to be changed.
+   * @param[in] writer The function changing the clone. The collection of the object is not cloned.
+   *
+   * @return Returns the clone, or nullptr if the object is not one of ``objs_``.
+   *
+   * @note This is a thread-safe function.
+   */
+  CNInferObjectPtr Modify(const CNInferObjectPtr &obj, const std::function<void(CNInferObject *)> &writer);
+
+  /**
+   * @brief Publishes the changes of ``objs_`` made directly, the next snapshot is made from ``objs_``.
+   *
+   * @note This is a thread-safe function, it can be called with ``mutex_`` locked or not.
+   */
+  void Publish();
+
+  /**
+   * @brief Gets the version of the objects, increased by each change published.
+   */
+  uint64_t GetVersion() const { return version_.load(std::memory_order_acquire); }
+
   std::vector<std::shared_ptr<CNInferObject>> objs_;  /// The objects storing inference results.
   std::mutex mutex_;   /// mutex of CNInferObjs
+
+ private:
+  std::once_flag arena_flag_;
+  std::shared_ptr<InferObjArena> arena_;
+  // read and written by std::atomic_load/std::atomic_store, null once a change is published by Publish()
+  std::shared_ptr<const std::vector<CNInferObjectPtr>> snapshot_;
+  std::atomic<uint64_t> version_{0};
 };
 
 /**
  * @struct InferData
  *
  * @brief InferData is a structure holding the information of raw inference input & outputs.
+ *
+ * The tensors are CNSyncedMemory, their memory is taken from the size-class caching pools (MluMemoryPool, and
+ * HostMemoryPool if it is enabled) and given back when the frame is released. The input is kept on the MLU, it is
+ * copied to the CPU only when CNSyncedMemory::GetCpuData is called.
  */
 struct InferData {
   // infer input
-  CNDataFormat input_fmt_;               /*!< The input image's pixel format.*/
-  int input_width_;                      /*!< The input image's width.*/
-  int input_height_;                     /*!< The input image's height. */
-  std::shared_ptr<void> input_cpu_addr_; /*!< The input data's CPU address.*/
-  size_t input_size_;                    /*!< The input data's size. */
+  CNDataFormat input_fmt_;                  /*!< The input image's pixel format.*/
+  int input_width_;                         /*!< The input image's width.*/
+  int input_height_;                        /*!< The input image's height. */
+  std::shared_ptr<CNSyncedMemory> input_;   /*!< The input data, of ``input_size_`` bytes. */
+  size_t input_size_;                       /*!< The input data's size. */
 
   // infer output
-  std::vector<std::shared_ptr<void>> output_cpu_addr_; /*!< The corresponding inference outputs to the input data. */
-  std::vector<size_t> output_sizes_;                   /*!< The inference outputs' sizes.*/
-  size_t output_num_;                                  /*!< The inference output count.*/
+  std::vector<std::shared_ptr<CNSyncedMemory>> outputs_;  /*!< The outputs of float, ``output_sizes_`` of each. */
+  std::vector<size_t> output_sizes_;                      /*!< The inference outputs' sizes.*/
+  size_t output_num_;                                     /*!< The inference output count.*/
 };
 
 /**
  * @struct CNInferData
  *
- * @brief CNInferData is a structure holding a map between module name and InferData.
+ * @brief CNInferData is a structure holding the InferData of a frame saved by the modules, see the
+ * ``saving_infer_input`` parameter of the Inferencer module.
+ *
+ * The data is kept by the module identification, see Module::GetId. A frame is passed through a few modules saving
+ * the data, so they are searched linearly.
  */
 struct CNInferData : public NonCopyable {
-  std::map<std::string, std::vector<std::shared_ptr<InferData>>> datas_map_;
-  /*!< The map between module name and InferData.*/
+  /**
+   * @brief Adds the data of a module.
+   *
+   * @param[in] module_id The identification of the module.
+   * @param[in] data The data.
+   *
+   * @note This is a thread-safe function.
+   */
+  void Add(size_t module_id, std::shared_ptr<InferData> data);
+  /**
+   * @brief Gets the data of a module, in the order they are added.
+   *
+   * @param[in] module_id The identification of the module.
+   *
+   * @return Returns the data, or an empty vector if the module saves no data.
+   *
+   * @note This is a thread-safe function.
+   */
+  std::vector<std::shared_ptr<InferData>> Get(size_t module_id);
+
   std::mutex mutex_; /*!< Inference data mutex.*/
+
+ private:
+  std::vector<std::pair<size_t, std::vector<std::shared_ptr<InferData>>>> datas_;
 };
 
 /*!
@@ -521,6 +1013,11 @@ static constexpr char kCNDataFrameTag[] = "CNDataFrame"; /*!< value type in CNFr
 static constexpr char kCNInferObjsTag[] = "CNInferObjs"; /*!< value type in CNFrameInfo::Collection : CNInferObjsPtr. */
 static constexpr char kCNInferDataTag[] = "CNInferData"; /*!< value type in CNFrameInfo::Collection : CNInferDataPtr. */
 
+// Fixed slots of the tags above, they are registered by the library. See CollectionSlot.
+static constexpr CollectionSlot<CNDataFramePtr> kCNDataFrameSlot(kCNDataFrameTag, 0);
+static constexpr CollectionSlot<CNInferObjsPtr> kCNInferObjsSlot(kCNInferObjsTag, 1);
+static constexpr CollectionSlot<CNInferDataPtr> kCNInferDataSlot(kCNInferDataTag, 2);
+
 }  // namespace cnstream
 
 #endif  // CNSTREAM_FRAME_VA_HPP_
@@ -0,0 +1,309 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+#include "cnstream_infer_objs_codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+constexpr uint32_t InferObjsCodec::kMagic;
+constexpr uint8_t InferObjsCodec::kVersion;
+
+namespace {
+
+// Rough size of an object without attributes, used to reserve the buffer once per message.
+constexpr size_t kObjectSizeHint = 64;
+
+class Writer {
+ public:
+  explicit Writer(std::string* out) : out_(out) {}
+
+  template <typename T>
+  void Put(T value) {
+    typename std::make_unsigned<T>::type bits = static_cast<typename std::make_unsigned<T>::type>(value);
+    char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      bytes[i] = static_cast<char>(bits & 0xFF);
+      bits = static_cast<decltype(bits)>(bits >> 8);
+    }
+    out_->append(bytes, sizeof(T));
+  }
+  void PutFloat(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    Put(bits);
+  }
+  template <typename LenT>
+  void PutString(const std::string& str) {
+    size_t len = std::min<size_t>(str.size(), std::numeric_limits<LenT>::max());
+    Put(static_cast<LenT>(len));
+    out_->append(str.data(), len);
+  }
+  void PutBytes(const uint8_t* bytes, size_t size) { out_->append(reinterpret_cast<const char*>(bytes), size); }
+
+ private:
+  std::string* out_;
+};  // class Writer
+
+class Reader {
+ public:
+  Reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  template <typename T>
+  bool Get(T* value) {
+    if (size_ - pos_ < sizeof(T)) return false;
+    typename std::make_unsigned<T>::type bits = 0;
+    for (size_t i = sizeof(T); i > 0; --i) {
+      bits = static_cast<decltype(bits)>((bits << 8) | data_[pos_ + i - 1]);
+    }
+    *value = static_cast<T>(bits);
+    pos_ += sizeof(T);
+    return true;
+  }
+  bool GetFloat(float* value) {
+    uint32_t bits;
+    if (!Get(&bits)) return false;
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+  }
+  template <typename LenT>
+  bool GetString(std::string* str) {
+    LenT len;
+    if (!Get(&len) || size_ - pos_ < len) return false;
+    str->assign(reinterpret_cast<const char*>(data_ + pos_), len);
+    pos_ += len;
+    return true;
+  }
+  bool GetBytes(uint8_t* bytes, size_t size) {
+    if (size_ - pos_ < size) return false;
+    memcpy(bytes, data_ + pos_, size);
+    pos_ += size;
+    return true;
+  }
+  size_t Position() const { return pos_; }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_ = 0;
+};  // class Reader
+
+template <typename T>
+uint16_t CountOf(const T& items) {
+  return static_cast<uint16_t>(std::min<size_t>(items.size(), std::numeric_limits<uint16_t>::max()));
+}
+
+void EncodeObject(CNInferObject* obj, uint8_t flags, Writer* writer) {
+  writer->PutString<uint16_t>(obj->id);
+  writer->PutString<uint16_t>(obj->track_id);
+  writer->PutFloat(obj->score);
+  writer->PutFloat(obj->bbox.x);
+  writer->PutFloat(obj->bbox.y);
+  writer->PutFloat(obj->bbox.w);
+  writer->PutFloat(obj->bbox.h);
+  obj->Visit([&](const CNInferAttrs& attributes, const StringPairs& extra_attributes,
+                 const CNInferFeatures& features) {
+    uint16_t count = CountOf(attributes);
+    writer->Put(count);
+    for (uint16_t i = 0; i < count; ++i) {
+      writer->PutString<uint16_t>(attributes[i].first);
+      writer->Put(static_cast<int32_t>(attributes[i].second.id));
+      writer->Put(static_cast<int32_t>(attributes[i].second.value));
+      writer->PutFloat(attributes[i].second.score);
+    }
+    count = flags & InferObjsCodec::EXTRA_ATTRIBUTES ? CountOf(extra_attributes) : 0;
+    writer->Put(count);
+    for (uint16_t i = 0; i < count; ++i) {
+      writer->PutString<uint16_t>(extra_attributes[i].first);
+      writer->PutString<uint32_t>(extra_attributes[i].second);
+    }
+    count = flags & InferObjsCodec::FEATURES ? CountOf(features) : 0;
+    writer->Put(count);
+    for (uint16_t i = 0; i < count; ++i) {
+      writer->PutString<uint16_t>(features[i].first);
+      writer->Put(static_cast<uint32_t>(features[i].second.size()));
+      for (float value : features[i].second) writer->PutFloat(value);
+    }
+  });
+  uint16_t count = 0;
+  if (flags & InferObjsCodec::FEATURES) {
+    obj->VisitQuantizedFeatures([&](const CNInferQuantizedFeatures& features) {
+      count = CountOf(features);
+      writer->Put(count);
+      for (uint16_t i = 0; i < count; ++i) {
+        const CNInferQuantizedFeature& feature = features[i].second;
+        writer->PutString<uint16_t>(features[i].first);
+        writer->Put(feature.dimension);
+        writer->Put(static_cast<uint8_t>(feature.precision));
+        writer->PutFloat(feature.scale);
+        if (feature.precision == CNFeaturePrecision::FP16) {
+          const uint16_t* values = reinterpret_cast<const uint16_t*>(feature.data.data());
+          for (uint32_t j = 0; j < feature.dimension; ++j) writer->Put(values[j]);
+        } else {
+          writer->PutBytes(feature.data.data(), feature.data.size());
+        }
+      }
+    });
+  } else {
+    writer->Put(count);
+  }
+}
+
+bool DecodeObject(Reader* reader, uint8_t version, CNInferObject* obj) {
+  if (!reader->GetString<uint16_t>(&obj->id) || !reader->GetString<uint16_t>(&obj->track_id) ||
+      !reader->GetFloat(&obj->score) || !reader->GetFloat(&obj->bbox.x) || !reader->GetFloat(&obj->bbox.y) ||
+      !reader->GetFloat(&obj->bbox.w) || !reader->GetFloat(&obj->bbox.h)) {
+    return false;
+  }
+  uint16_t count;
+  if (!reader->Get(&count)) return false;
+  for (uint16_t i = 0; i < count; ++i) {
+    std::string key;
+    int32_t id, value;
+    CNInferAttr attribute;
+    if (!reader->GetString<uint16_t>(&key) || !reader->Get(&id) || !reader->Get(&value) ||
+        !reader->GetFloat(&attribute.score)) {
+      return false;
+    }
+    attribute.id = id;
+    attribute.value = value;
+    obj->AddAttribute(key, attribute);
+  }
+  if (!reader->Get(&count)) return false;
+  for (uint16_t i = 0; i < count; ++i) {
+    std::string key, value;
+    if (!reader->GetString<uint16_t>(&key) || !reader->GetString<uint32_t>(&value)) return false;
+    obj->AddExtraAttribute(key, value);
+  }
+  if (!reader->Get(&count)) return false;
+  for (uint16_t i = 0; i < count; ++i) {
+    std::string key;
+    uint32_t dimension;
+    if (!reader->GetString<uint16_t>(&key) || !reader->Get(&dimension)) return false;
+    CNInferFeature feature(dimension);
+    for (auto& value : feature) {
+      if (!reader->GetFloat(&value)) return false;
+    }
+    obj->AddFeature(key, feature);
+  }
+  if (version < 2) return true;
+  if (!reader->Get(&count)) return false;
+  for (uint16_t i = 0; i < count; ++i) {
+    std::string key;
+    uint8_t precision;
+    CNInferQuantizedFeature feature;
+    if (!reader->GetString<uint16_t>(&key) || !reader->Get(&feature.dimension) || !reader->Get(&precision) ||
+        !reader->GetFloat(&feature.scale)) {
+      return false;
+    }
+    feature.precision = static_cast<CNFeaturePrecision>(precision);
+    if (feature.precision == CNFeaturePrecision::FP16) {
+      feature.data.resize(feature.dimension * sizeof(uint16_t));
+      uint16_t* values = reinterpret_cast<uint16_t*>(feature.data.data());
+      for (uint32_t j = 0; j < feature.dimension; ++j) {
+        if (!reader->Get(&values[j])) return false;
+      }
+    } else if (feature.precision == CNFeaturePrecision::INT8) {
+      feature.data.resize(feature.dimension);
+      if (!reader->GetBytes(feature.data.data(), feature.data.size())) return false;
+    } else {
+      return false;  // FP32 features are written as plain features
+    }
+    obj->AddFeature(key, feature);
+  }
+  return true;
+}
+
+}  // namespace
+
+void InferObjsCodec::Encode(const std::string& stream_id, uint64_t frame_id, int64_t timestamp,
+                            const CNObjsVec& objs, uint8_t flags, std::string* out) {
+  out->reserve(out->size() + 32 + stream_id.size() + objs.size() * kObjectSizeHint);
+  Writer writer(out);
+  writer.Put(kMagic);
+  writer.Put(kVersion);
+  writer.Put(flags);
+  writer.Put(static_cast<uint16_t>(0));
+  writer.PutString<uint16_t>(stream_id);
+  writer.Put(frame_id);
+  writer.Put(timestamp);
+  writer.Put(static_cast<uint32_t>(objs.size()));
+  for (const auto& obj : objs) EncodeObject(obj.get(), flags, &writer);
+}
+
+bool InferObjsCodec::Encode(const CNFrameInfoPtr& data, uint8_t flags, std::string* out) {
+  if (!data || !out || data->IsEos()) return false;
+  uint64_t frame_id = 0;
+  if (data->collection.HasValue(kCNDataFrameSlot)) {
+    frame_id = data->collection.Get(kCNDataFrameSlot)->frame_id;
+  }
+  if (!data->collection.HasValue(kCNInferObjsSlot)) {
+    Encode(data->stream_id, frame_id, data->timestamp, CNObjsVec(), flags, out);
+    return true;
+  }
+  CNInferObjsSnapshot objs = data->collection.Get(kCNInferObjsSlot)->GetSnapshot();
+  Encode(data->stream_id, frame_id, data->timestamp, *objs, flags, out);
+  return true;
+}
+
+bool InferObjsCodec::Decode(const void* data, size_t size, Frame* frame, size_t* consumed) {
+  if (!data || !frame) return false;
+  Reader reader(static_cast<const uint8_t*>(data), size);
+  uint32_t magic = 0;
+  uint8_t version = 0;
+  uint16_t reserved;
+  if (!reader.Get(&magic) || magic != kMagic) {
+    LOGE(FRAME) << "InferObjsCodec::Decode() not an inference objects message";
+    return false;
+  }
+  if (!reader.Get(&version) || version < 1 || version > kVersion) {
+    LOGE(FRAME) << "InferObjsCodec::Decode() unsupported version " << static_cast<int>(version);
+    return false;
+  }
+  uint32_t obj_count;
+  if (!reader.Get(&frame->flags) || !reader.Get(&reserved) || !reader.GetString<uint16_t>(&frame->stream_id) ||
+      !reader.Get(&frame->frame_id) || !reader.Get(&frame->timestamp) || !reader.Get(&obj_count)) {
+    LOGE(FRAME) << "InferObjsCodec::Decode() message header is truncated";
+    return false;
+  }
+  frame->objs.clear();
+  frame->objs.reserve(std::min<size_t>(obj_count, size / kObjectSizeHint + 1));
+  for (uint32_t i = 0; i < obj_count; ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    if (!DecodeObject(&reader, version, obj.get())) {
+      LOGE(FRAME) << "InferObjsCodec::Decode() object " << i << " is truncated";
+      return false;
+    }
+    frame->objs.push_back(std::move(obj));
+  }
+  if (consumed) *consumed = reader.Position();
+  return true;
+}
+
+}  // namespace cnstream
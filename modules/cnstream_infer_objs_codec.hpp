@@ -0,0 +1,131 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_INFER_OBJS_CODEC_HPP_
+#define CNSTREAM_INFER_OBJS_CODEC_HPP_
+
+/**
+ *  @file cnstream_infer_objs_codec.hpp
+ *
+ *  This file contains a declaration of the InferObjsCodec class, a compact binary encoding of inference results.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+/**
+ * @class InferObjsCodec
+ *
+ * @brief InferObjsCodec encodes the inference objects of a frame into a compact binary message and decodes it back.
+ *
+ * It is an alternative to JSON for sinks sending results out of the process, e.g. Kafka handlers. All values are
+ * little-endian, strings are prefixed by their length and floats are stored as IEEE-754 single precision:
+ *
+ * @verbatim
+ * message   := magic(u32 "CNIO") version(u8) flags(u8) reserved(u16) stream_id(str16) frame_id(u64)
+ *              timestamp(i64) object_count(u32) object*
+ * object    := id(str16) track_id(str16) score(f32) x(f32) y(f32) w(f32) h(f32)
+ *              attr_count(u16) attribute* extra_count(u16) extra* feature_count(u16) feature*
+ *              qfeature_count(u16) qfeature*
+ * attribute := key(str16) id(i32) value(i32) score(f32)
+ * extra     := key(str16) value(str32)
+ * feature   := key(str16) dimension(u32) f32*dimension
+ * qfeature  := key(str16) dimension(u32) precision(u8) scale(f32) (u16*dimension | i8*dimension)
+ * @endverbatim
+ *
+ * The extended attributes and features are only written when the corresponding flags are set, their counts are
+ * zero otherwise. The features stored in a lower precision (see CNInferObject::AddFeature) are written as they are
+ * stored, half precision (precision 1) or 8-bit integers scaled by ``scale`` (precision 2). Messages of version 1
+ * have no qfeature_count and are still decoded. The python decoder in python/samples/infer_objs_decoder.py reads the
+ * same format.
+ */
+class InferObjsCodec {
+ public:
+  static constexpr uint32_t kMagic = 0x4F494E43;  ///< "CNIO" in little-endian.
+  static constexpr uint8_t kVersion = 2;          ///< The version of the format.
+
+  /**
+   * @brief The optional parts of the objects to be encoded.
+   */
+  enum Flags : uint8_t {
+    EXTRA_ATTRIBUTES = 1 << 0,  ///< Encodes the extended attributes.
+    FEATURES = 1 << 1,          ///< Encodes the features.
+  };
+
+  /**
+   * @brief The decoded message.
+   */
+  struct Frame {
+    std::string stream_id;  ///< The stream identification.
+    uint64_t frame_id = 0;  ///< The frame id, 0 if the frame has no CNDataFrame.
+    int64_t timestamp = 0;  ///< The timestamp of the frame.
+    uint8_t flags = 0;      ///< The flags the message is encoded with.
+    CNObjsVec objs;         ///< The decoded objects.
+  };
+
+  /**
+   * @brief Encodes the objects and appends the message to a buffer.
+   *
+   * The values are written to the buffer directly, callers reuse one buffer to avoid allocations.
+   *
+   * @param[in] stream_id The stream identification.
+   * @param[in] frame_id The frame id.
+   * @param[in] timestamp The timestamp of the frame.
+   * @param[in] objs The objects to be encoded.
+   * @param[in] flags Bitwise OR of Flags.
+   * @param[out] out The buffer the message is appended to.
+   *
+   * @return No return value.
+   */
+  static void Encode(const std::string &stream_id, uint64_t frame_id, int64_t timestamp, const CNObjsVec &objs,
+                     uint8_t flags, std::string *out);
+
+  /**
+   * @brief Encodes the inference objects of a frame and appends the message to a buffer.
+   *
+   * @param[in] data The frame. The frame without inference objects is encoded with no object.
+   * @param[in] flags Bitwise OR of Flags.
+   * @param[out] out The buffer the message is appended to.
+   *
+   * @return Returns false if the frame is an EOS frame or the buffer is null.
+   */
+  static bool Encode(const CNFrameInfoPtr &data, uint8_t flags, std::string *out);
+
+  /**
+   * @brief Decodes a message.
+   *
+   * @param[in] data The message.
+   * @param[in] size The size of the data, it may contain more than one message.
+   * @param[out] frame The decoded message.
+   * @param[out] consumed The number of bytes of the decoded message, could be nullptr.
+   *
+   * @return Returns false if the data is truncated or it is not a message of a supported version.
+   */
+  static bool Decode(const void *data, size_t size, Frame *frame, size_t *consumed = nullptr);
+};  // class InferObjsCodec
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_INFER_OBJS_CODEC_HPP_
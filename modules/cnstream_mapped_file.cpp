@@ -0,0 +1,105 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+namespace {
+
+std::mutex g_mapped_mutex;
+// keyed by device, inode, size and modification time, so a file replaced or rewritten is mapped again
+std::map<std::string, std::weak_ptr<MappedFile>> g_mapped_files;
+
+std::string GetFileKey(const struct stat &st) {
+  std::ostringstream ss;
+  ss << st.st_dev << ":" << st.st_ino << ":" << st.st_size << ":" << st.st_mtim.tv_sec << "." << st.st_mtim.tv_nsec;
+  return ss.str();
+}
+
+}  // namespace
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOGE(CORE) << "[MappedFile] Open " << path << " failed, " << strerror(errno);
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    LOGE(CORE) << "[MappedFile] " << path << " is not a regular file or is empty.";
+    close(fd);
+    return nullptr;
+  }
+  const std::string key = GetFileKey(st);
+
+  std::lock_guard<std::mutex> lk(g_mapped_mutex);
+  auto iter = g_mapped_files.find(key);
+  if (iter != g_mapped_files.end()) {
+    std::shared_ptr<MappedFile> file = iter->second.lock();
+    if (file) {
+      close(fd);
+      return file;
+    }
+  }
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping keeps the file referenced
+  if (data == MAP_FAILED) {
+    LOGE(CORE) << "[MappedFile] Map " << path << " failed, " << strerror(errno);
+    return nullptr;
+  }
+  // the loaders read the whole file once
+  madvise(data, st.st_size, MADV_WILLNEED);
+  std::shared_ptr<MappedFile> file(new MappedFile());
+  file->data_ = data;
+  file->size_ = st.st_size;
+  file->path_ = path;
+  g_mapped_files[key] = file;
+  // drop the keys of the files unmapped
+  for (auto it = g_mapped_files.begin(); it != g_mapped_files.end();) {
+    if (it->second.expired()) {
+      it = g_mapped_files.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return file;
+}
+
+MappedFile::~MappedFile() {
+  if (data_) munmap(data_, size_);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,77 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_MAPPED_FILE_HPP_
+#define CNSTREAM_MAPPED_FILE_HPP_
+
+/**
+ *  @file cnstream_mapped_file.hpp
+ *
+ *  This file contains a declaration of the MappedFile class.
+ */
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace cnstream {
+
+/**
+ * @class MappedFile
+ *
+ * @brief MappedFile is a file memory-mapped read-only, used to load the models from memory instead of reading them
+ * into a private buffer.
+ *
+ * The pages of a shared read-only mapping are the pages of the page cache, so the processes loading the same model
+ * share one copy of it in host memory, and a model loaded again is not read from the disk. In a process, the
+ * pipelines opening a file while it is mapped get the same mapping.
+ */
+class MappedFile {
+ public:
+  /**
+   * @brief Maps a file, or gets the mapping of it if it is mapped in the process and not modified since.
+   *
+   * @param[in] path The path of the file.
+   *
+   * @return Returns the mapping, or nullptr if the file could not be mapped.
+   */
+  static std::shared_ptr<MappedFile> Open(const std::string &path);
+  ~MappedFile();
+
+  /**
+   * @brief Returns the content of the file. It is read-only, the pointer is not const only because the model loaders
+   * take ``void *``.
+   */
+  void *Data() const { return data_; }
+  size_t Size() const { return size_; }
+  const std::string &Path() const { return path_; }
+
+ private:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  void *data_ = nullptr;
+  size_t size_ = 0;
+  std::string path_;
+};  // class MappedFile
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_MAPPED_FILE_HPP_
@@ -0,0 +1,267 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_obj_predicate.hpp"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+namespace {
+
+// the kernels are written once on top of these primitives, kLanes objects are evaluated at a time.
+#if defined(__SSE__)
+
+constexpr size_t kLanes = 4;
+using Vec = __m128;
+using Mask = __m128;
+inline Vec Load(const float *p) { return _mm_loadu_ps(p); }
+inline Vec Set1(float v) { return _mm_set1_ps(v); }
+inline Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+inline Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+inline Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+inline Mask Gt(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+inline Mask Lt(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+inline Mask Ge(Vec a, Vec b) { return _mm_cmpge_ps(a, b); }
+inline Mask Le(Vec a, Vec b) { return _mm_cmple_ps(a, b); }
+inline Mask And(Mask a, Mask b) { return _mm_and_ps(a, b); }
+inline Mask Xor(Mask a, Mask b) { return _mm_xor_ps(a, b); }
+inline Mask None() { return _mm_setzero_ps(); }
+inline int Bits(Mask m) { return _mm_movemask_ps(m); }
+
+#elif defined(__ARM_NEON)
+
+constexpr size_t kLanes = 4;
+using Vec = float32x4_t;
+using Mask = uint32x4_t;
+inline Vec Load(const float *p) { return vld1q_f32(p); }
+inline Vec Set1(float v) { return vdupq_n_f32(v); }
+inline Vec Add(Vec a, Vec b) { return vaddq_f32(a, b); }
+inline Vec Sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+inline Vec Mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+inline Mask Gt(Vec a, Vec b) { return vcgtq_f32(a, b); }
+inline Mask Lt(Vec a, Vec b) { return vcltq_f32(a, b); }
+inline Mask Ge(Vec a, Vec b) { return vcgeq_f32(a, b); }
+inline Mask Le(Vec a, Vec b) { return vcleq_f32(a, b); }
+inline Mask And(Mask a, Mask b) { return vandq_u32(a, b); }
+inline Mask Xor(Mask a, Mask b) { return veorq_u32(a, b); }
+inline Mask None() { return vdupq_n_u32(0); }
+inline int Bits(Mask m) {
+  uint32_t lanes[4];
+  vst1q_u32(lanes, m);
+  return (lanes[0] & 1) | (lanes[1] & 2) | (lanes[2] & 4) | (lanes[3] & 8);
+}
+
+#else
+
+constexpr size_t kLanes = 1;
+using Vec = float;
+using Mask = bool;
+inline Vec Load(const float *p) { return *p; }
+inline Vec Set1(float v) { return v; }
+inline Vec Add(Vec a, Vec b) { return a + b; }
+inline Vec Sub(Vec a, Vec b) { return a - b; }
+inline Vec Mul(Vec a, Vec b) { return a * b; }
+inline Mask Gt(Vec a, Vec b) { return a > b; }
+inline Mask Lt(Vec a, Vec b) { return a < b; }
+inline Mask Ge(Vec a, Vec b) { return a >= b; }
+inline Mask Le(Vec a, Vec b) { return a <= b; }
+inline Mask And(Mask a, Mask b) { return a && b; }
+inline Mask Xor(Mask a, Mask b) { return a != b; }
+inline Mask None() { return false; }
+inline int Bits(Mask m) { return m ? 1 : 0; }
+
+#endif
+
+inline void Select(Mask m, uint8_t *selected) {
+  const int bits = Bits(m);
+  for (size_t k = 0; k < kLanes; ++k) selected[k] &= (bits >> k) & 1;
+}
+
+// the scalar versions evaluate one object, for the tails and ObjPredicate::Evaluate(const CNInferObject &)
+inline bool InArea(float w, float h, float min_area, float max_area) {
+  return w * h >= min_area && w * h <= max_area;
+}
+
+template <typename Edge>
+inline bool InPolygon(const std::vector<Edge> &edges, float cx, float cy) {
+  bool inside = false;
+  for (const Edge &e : edges) {
+    if (((e.y > cy) != (e.y_end > cy)) && cx < e.x + e.slope * (cy - e.y)) inside = !inside;
+  }
+  return inside;
+}
+
+void SelectScore(const float *scores, float min_score, size_t n, uint8_t *selected) {
+  size_t i = 0;
+  const Vec vmin = Set1(min_score);
+  for (; i + kLanes <= n; i += kLanes) Select(Gt(Load(scores + i), vmin), selected + i);
+  for (; i < n; ++i) selected[i] &= scores[i] > min_score;
+}
+
+void SelectArea(const float *w, const float *h, float min_area, float max_area, size_t n, uint8_t *selected) {
+  size_t i = 0;
+  const Vec vmin = Set1(min_area), vmax = Set1(max_area);
+  for (; i + kLanes <= n; i += kLanes) {
+    const Vec area = Mul(Load(w + i), Load(h + i));
+    Select(And(Ge(area, vmin), Le(area, vmax)), selected + i);
+  }
+  for (; i < n; ++i) selected[i] &= InArea(w[i], h[i], min_area, max_area);
+}
+
+// ray casting from the centers of the bounding boxes, the objects are tested against one edge at a time
+template <typename Edge>
+void SelectRoi(const ObjsSnapshot &objs, const std::vector<Edge> &edges, uint8_t *selected) {
+  const size_t n = objs.Size();
+  const Vec half = Set1(0.5f);
+  size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    const Vec cx = Add(Load(objs.x.data() + i), Mul(Load(objs.w.data() + i), half));
+    const Vec cy = Add(Load(objs.y.data() + i), Mul(Load(objs.h.data() + i), half));
+    Mask inside = None();
+    for (const Edge &e : edges) {
+      const Mask crossed = Xor(Gt(Set1(e.y), cy), Gt(Set1(e.y_end), cy));
+      const Vec x = Add(Set1(e.x), Mul(Set1(e.slope), Sub(cy, Set1(e.y))));
+      inside = Xor(inside, And(crossed, Lt(cx, x)));
+    }
+    Select(inside, selected + i);
+  }
+  for (; i < n; ++i) {
+    selected[i] &= InPolygon(edges, objs.x[i] + objs.w[i] * 0.5f, objs.y[i] + objs.h[i] * 0.5f);
+  }
+}
+
+int32_t ParseLabel(const std::string &id) {
+  if (id.empty()) return -1;
+  char *end = nullptr;
+  const long label = std::strtol(id.c_str(), &end, 10);  // NOLINT
+  if (*end != '\0' || label < 0 || label > std::numeric_limits<int32_t>::max()) return -1;
+  return static_cast<int32_t>(label);
+}
+
+}  // namespace
+
+void ObjsSnapshot::Reset(const CNObjsVec &objs) {
+  const size_t n = objs.size();
+  labels.resize(n);
+  scores.resize(n);
+  x.resize(n);
+  y.resize(n);
+  w.resize(n);
+  h.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    const CNInferObject &obj = *objs[i];
+    labels[i] = ParseLabel(obj.id);
+    scores[i] = obj.score;
+    x[i] = obj.bbox.x;
+    y[i] = obj.bbox.y;
+    w[i] = obj.bbox.w;
+    h[i] = obj.bbox.h;
+  }
+}
+
+ObjPredicate &ObjPredicate::SetLabels(const std::vector<int> &labels) {
+  labels_.clear();
+  for (int label : labels) {
+    if (label < 0) continue;
+    const size_t word = static_cast<size_t>(label) / 64;
+    if (labels_.size() <= word) labels_.resize(word + 1, 0);
+    labels_[word] |= uint64_t(1) << (label % 64);
+  }
+  has_labels_ = true;
+  return *this;
+}
+
+ObjPredicate &ObjPredicate::SetMinScore(float min_score) {
+  has_min_score_ = true;
+  min_score_ = min_score;
+  return *this;
+}
+
+ObjPredicate &ObjPredicate::SetAreaRange(float min_area, float max_area) {
+  has_area_ = true;
+  min_area_ = min_area;
+  max_area_ = max_area;
+  return *this;
+}
+
+ObjPredicate &ObjPredicate::SetRoi(const std::vector<std::pair<float, float>> &polygon) {
+  roi_.clear();
+  has_roi_ = true;  // a degenerate polygon contains nothing
+  if (polygon.size() < 3) return *this;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+    const std::pair<float, float> &a = polygon[i], &b = polygon[j];
+    if (a.second == b.second) continue;
+    roi_.push_back(Edge{a.first, a.second, b.second, (b.first - a.first) / (b.second - a.second)});
+  }
+  return *this;
+}
+
+bool ObjPredicate::Empty() const {
+  return !has_labels_ && !has_min_score_ && !has_area_ && !has_roi_;
+}
+
+bool ObjPredicate::InLabels(int32_t label) const {
+  if (label < 0 || static_cast<size_t>(label) / 64 >= labels_.size()) return false;
+  return (labels_[label / 64] >> (label % 64)) & 1;
+}
+
+void ObjPredicate::Evaluate(const ObjsSnapshot &objs, std::vector<uint8_t> *selected) const {
+  const size_t n = objs.Size();
+  selected->assign(n, 1);
+  uint8_t *out = selected->data();
+  // the cheap conditions first
+  if (has_labels_) {
+    for (size_t i = 0; i < n; ++i) out[i] = InLabels(objs.labels[i]);
+  }
+  if (has_min_score_) SelectScore(objs.scores.data(), min_score_, n, out);
+  if (has_area_) SelectArea(objs.w.data(), objs.h.data(), min_area_, max_area_, n, out);
+  if (has_roi_) SelectRoi(objs, roi_, out);
+}
+
+bool ObjPredicate::Evaluate(const CNInferObject &obj) const {
+  if (has_labels_ && !InLabels(ParseLabel(obj.id))) return false;
+  if (has_min_score_ && !(obj.score > min_score_)) return false;
+  if (has_area_ && !InArea(obj.bbox.w, obj.bbox.h, min_area_, max_area_)) return false;
+  return !has_roi_ || InPolygon(roi_, obj.bbox.x + obj.bbox.w * 0.5f, obj.bbox.y + obj.bbox.h * 0.5f);
+}
+
+bool PredicateObjFilter::Filter(const CNFrameInfoPtr &finfo, const CNInferObjectPtr &obj) {
+  return predicate_.Evaluate(*obj);
+}
+
+void PredicateObjFilter::FilterObjects(const CNFrameInfoPtr &finfo, const CNObjsVec &objs,
+                                       std::vector<uint8_t> *selected) {
+  ObjsSnapshot snapshot;
+  snapshot.Reset(objs);
+  predicate_.Evaluate(snapshot, selected);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,164 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_OBJ_PREDICATE_HPP_
+#define CNSTREAM_OBJ_PREDICATE_HPP_
+
+/**
+ *  @file cnstream_obj_predicate.hpp
+ *
+ *  This file contains a declaration of the ObjsSnapshot struct, and the ObjPredicate and PredicateObjFilter class.
+ */
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_frame_va.hpp"
+#include "obj_filter.hpp"
+
+namespace cnstream {
+
+/**
+ * @struct ObjsSnapshot
+ *
+ * @brief ObjsSnapshot is a structure of arrays holding the labels, scores and bounding boxes of the objects of a
+ * frame, so that a predicate is evaluated on all objects together.
+ */
+struct ObjsSnapshot {
+  std::vector<int32_t> labels;  ///< The labels parsed from CNInferObject::id, -1 if the id is not a number.
+  std::vector<float> scores;    ///< The scores.
+  std::vector<float> x;         ///< The normalized left of the bounding boxes.
+  std::vector<float> y;         ///< The normalized top of the bounding boxes.
+  std::vector<float> w;         ///< The normalized width of the bounding boxes.
+  std::vector<float> h;         ///< The normalized height of the bounding boxes.
+
+  /**
+   * @brief Takes a snapshot of the objects. The arrays are reused, callers keep one snapshot to avoid allocations.
+   *
+   * @param[in] objs The objects.
+   *
+   * @return No return value.
+   */
+  void Reset(const CNObjsVec &objs);
+  /**
+   * @brief Gets the number of objects.
+   */
+  size_t Size() const { return scores.size(); }
+};
+
+/**
+ * @class ObjPredicate
+ *
+ * @brief ObjPredicate is a conjunction of conditions on the labels, scores and bounding boxes of objects. An object
+ * satisfies the predicate if it satisfies all conditions set, an empty predicate is satisfied by all objects.
+ *
+ * The conditions are evaluated on an ObjsSnapshot with SSE or NEON, before any work is done for each object.
+ *
+ * @code
+ * ObjPredicate predicate;
+ * predicate.SetLabels({2, 5, 7}).SetMinScore(0.5).SetRoi({{0, 0.5}, {1, 0.5}, {1, 1}, {0, 1}});
+ * @endcode
+ */
+class ObjPredicate {
+ public:
+  /**
+   * @brief Keeps the objects whose label is one of ``labels``.
+   */
+  ObjPredicate &SetLabels(const std::vector<int> &labels);
+  /**
+   * @brief Keeps the objects whose score is greater than ``min_score``.
+   */
+  ObjPredicate &SetMinScore(float min_score);
+  /**
+   * @brief Keeps the objects whose normalized area (w * h) is in [``min_area``, ``max_area``].
+   */
+  ObjPredicate &SetAreaRange(float min_area, float max_area);
+  /**
+   * @brief Keeps the objects whose bounding box center is in the region of interest.
+   *
+   * @param[in] polygon The normalized vertices (x, y) of the region, a polygon with at least 3 vertices.
+   */
+  ObjPredicate &SetRoi(const std::vector<std::pair<float, float>> &polygon);
+  /**
+   * @brief Checks whether no condition is set.
+   */
+  bool Empty() const;
+  /**
+   * @brief Evaluates the predicate on all objects of a snapshot.
+   *
+   * @param[in] objs The snapshot of the objects.
+   * @param[out] selected Whether each object satisfies the predicate, 1 or 0, in the order of the objects.
+   *
+   * @return No return value.
+   */
+  void Evaluate(const ObjsSnapshot &objs, std::vector<uint8_t> *selected) const;
+  /**
+   * @brief Evaluates the predicate on one object.
+   *
+   * @param[in] obj The object.
+   *
+   * @return Returns true if the object satisfies the predicate.
+   */
+  bool Evaluate(const CNInferObject &obj) const;
+
+ private:
+  struct Edge {
+    float x, y;   // the vertex the edge starts from
+    float y_end;  // the y of the other vertex
+    float slope;  // dx / dy, horizontal edges are left out as a horizontal ray never crosses them
+  };
+  bool InLabels(int32_t label) const;
+
+  std::vector<uint64_t> labels_;  // a bitset of the labels
+  bool has_labels_ = false;
+  bool has_min_score_ = false;
+  float min_score_ = 0;
+  bool has_area_ = false;
+  float min_area_ = 0;
+  float max_area_ = 0;
+  bool has_roi_ = false;
+  std::vector<Edge> roi_;
+};  // class ObjPredicate
+
+/**
+ * @class PredicateObjFilter
+ *
+ * @brief PredicateObjFilter is the base class of the object filters working on the labels, scores and bounding boxes
+ * only. Derived classes set the predicate, e.g. in the constructor, and all objects of a frame are filtered together.
+ */
+class PredicateObjFilter : public ObjFilter {
+ public:
+  /**
+   * @brief Filters an object by the predicate.
+   */
+  bool Filter(const CNFrameInfoPtr &finfo, const CNInferObjectPtr &obj) override;
+  /**
+   * @brief Filters all objects of the frame by the predicate.
+   */
+  void FilterObjects(const CNFrameInfoPtr &finfo, const CNObjsVec &objs, std::vector<uint8_t> *selected) override;
+
+ protected:
+  ObjPredicate predicate_;  ///< The predicate the objects have to satisfy.
+};  // class PredicateObjFilter
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_OBJ_PREDICATE_HPP_
@@ -33,19 +33,37 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cnstream_common.hpp"
 #include "cnstream_syncmem.hpp"
+#include "private/cnstream_affinity.hpp"
+#include "private/cnstream_allocator.hpp"
 
 namespace cnstream {
 
+using HostMemorySource = CNSyncedMemory::HostMemorySource;
+
 /**
- * Allocates data on a host.
+ * Allocates data on a host. Page-locked memory is taken from the host memory pool if it is enabled, otherwise
+ * huge-page backed memory is taken from the huge page memory pool if it is enabled.
  *
  * @param ptr Outputs data pointer.
  * @param size The size of the data to be allocated.
+ * @param source Outputs where the data comes from.
+ * @param charge Outputs the charge of the data in the memory accountant.
  */
-static void CNStreamMallocHost(void** ptr, size_t size) {
-  void* __ptr = malloc(size);
+static void CNStreamMallocHost(void** ptr, size_t size, HostMemorySource* source, MemoryCharge* charge) {
+  void* __ptr = nullptr;
+  *source = HostMemorySource::MALLOC;
+  if (HostMemoryPool::Instance().IsEnabled()) {
+    __ptr = HostMemoryPool::Instance().Alloc(size);
+    if (__ptr) *source = HostMemorySource::PINNED_POOL;
+  }
+  if (nullptr == __ptr && HugePageMemoryPool::Instance().IsEnabled()) {
+    __ptr = HugePageMemoryPool::Instance().Alloc(size, GetCurrentThreadNumaNode());
+    if (__ptr) *source = HostMemorySource::HUGE_PAGE_POOL;
+  }
+  if (nullptr == __ptr) __ptr = malloc(size);
   LOGF_IF(FRAME, nullptr == __ptr) << "Malloc memory on CPU failed, malloc size:" << size;
   *ptr = __ptr;
+  *charge = MemoryCharge(MemoryType::HOST, size);
 }
 
 
@@ -53,9 +71,36 @@ static void CNStreamMallocHost(void** ptr, size_t size) {
  * Frees the data allocated by ``CNStreamMallocHost``.
  *
  * @param ptr The data address to be freed.
+ * @param source Where the data comes from.
  */
-static void CNStreamFreeHost(void* ptr) {
-  free(ptr);
+static void CNStreamFreeHost(void* ptr, HostMemorySource source) {
+  switch (source) {
+    case HostMemorySource::PINNED_POOL:
+      HostMemoryPool::Instance().Free(ptr);
+      break;
+    case HostMemorySource::HUGE_PAGE_POOL:
+      HugePageMemoryPool::Instance().Free(ptr);
+      break;
+    default:
+      free(ptr);
+      break;
+  }
+}
+
+/**
+ * Allocates data on a device from the shared MLU memory pool.
+ *
+ * @param ptr Outputs data pointer.
+ * @param size The size of the data to be allocated.
+ * @param dev_id The device ordinal.
+ * @param ddr_chn The DDR channel.
+ * @param charge Outputs the charge of the data in the memory accountant.
+ */
+static void CNStreamMallocDevice(void** ptr, size_t size, int dev_id, int ddr_chn, MemoryCharge* charge) {
+  void* __ptr = MluMemoryPool::Instance().Alloc(size, dev_id, ddr_chn);
+  LOGF_IF(FRAME, nullptr == __ptr) << "Malloc memory on MLU failed, malloc size:" << size;
+  *ptr = __ptr;
+  *charge = MemoryCharge(MemoryType::DEVICE, size);
 }
 
 CNSyncedMemory::CNSyncedMemory(size_t size) : size_(size) {}
@@ -66,27 +111,35 @@ CNSyncedMemory::CNSyncedMemory(size_t size, int mlu_dev_id, int mlu_ddr_chn)
 CNSyncedMemory::~CNSyncedMemory() {
   std::lock_guard<std::mutex> lock(mutex_);
   if (0 == size_) return;
+  WaitPrefetch();
+  if (notifier_) cnrtDestroyNotifier(&notifier_);
   if (cpu_ptr_ && own_cpu_data_) {
-    free(cpu_ptr_);
+    CNStreamFreeHost(cpu_ptr_, cpu_data_source_);
   }
   if (mlu_ptr_ && own_mlu_data_) {
-    // set device id before call cnrt functions, or CNRT_RET_ERR_EXISTS will be returned from cnrt function
-    CALL_CNRT_BY_CONTEXT(cnrtFree(mlu_ptr_), dev_id_, ddr_chn_);
+    MluMemoryPool::Instance().Free(mlu_ptr_);
   }
 }
 
+inline void CNSyncedMemory::WaitPrefetch() {
+  if (!prefetching_) return;
+  CNS_CNRT_CHECK(cnrtWaitNotifier(notifier_));
+  prefetching_ = false;
+}
+
 inline void CNSyncedMemory::ToCpu() {
   if (0 == size_) return;
+  WaitPrefetch();
   switch (head_) {
     case SyncedHead::UNINITIALIZED:
-      CNStreamMallocHost(&cpu_ptr_, size_);
+      CNStreamMallocHost(&cpu_ptr_, size_, &cpu_data_source_, &cpu_charge_);
       memset(cpu_ptr_, 0, size_);
       head_ = SyncedHead::HEAD_AT_CPU;
       own_cpu_data_ = true;
       break;
     case SyncedHead::HEAD_AT_MLU:
       if (NULL == cpu_ptr_) {
-        CNStreamMallocHost(&cpu_ptr_, size_);
+        CNStreamMallocHost(&cpu_ptr_, size_, &cpu_data_source_, &cpu_charge_);
         own_cpu_data_ = true;
       }
       CALL_CNRT_BY_CONTEXT(cnrtMemcpy(cpu_ptr_, mlu_ptr_, size_, CNRT_MEM_TRANS_DIR_DEV2HOST), dev_id_, ddr_chn_);
@@ -100,15 +153,16 @@ inline void CNSyncedMemory::ToCpu() {
 
 inline void CNSyncedMemory::ToMlu() {
   if (0 == size_) return;
+  WaitPrefetch();
   switch (head_) {
     case SyncedHead::UNINITIALIZED:
-      CALL_CNRT_BY_CONTEXT(cnrtMalloc(&mlu_ptr_, size_), dev_id_, ddr_chn_);
+      CNStreamMallocDevice(&mlu_ptr_, size_, dev_id_, ddr_chn_, &mlu_charge_);
       head_ = SyncedHead::HEAD_AT_MLU;
       own_mlu_data_ = true;
       break;
     case SyncedHead::HEAD_AT_CPU:
       if (NULL == mlu_ptr_) {
-        CALL_CNRT_BY_CONTEXT(cnrtMalloc(&mlu_ptr_, size_), dev_id_, ddr_chn_);
+        CNStreamMallocDevice(&mlu_ptr_, size_, dev_id_, ddr_chn_, &mlu_charge_);
         own_mlu_data_ = true;
       }
       CALL_CNRT_BY_CONTEXT(cnrtMemcpy(mlu_ptr_, cpu_ptr_, size_, CNRT_MEM_TRANS_DIR_HOST2DEV), dev_id_, ddr_chn_);
@@ -131,10 +185,13 @@ void CNSyncedMemory::SetCpuData(void* data) {
   std::lock_guard<std::mutex> lock(mutex_);
   if (0 == size_) return;
   LOGF_IF(FRAME, NULL == data) << "data is NULL.";
+  WaitPrefetch();
   if (own_cpu_data_) {
-    CNStreamFreeHost(cpu_ptr_);
+    CNStreamFreeHost(cpu_ptr_, cpu_data_source_);
+    cpu_charge_.Release();
   }
   cpu_ptr_ = data;
+  cpu_data_source_ = HostMemorySource::MALLOC;
   head_ = SyncedHead::HEAD_AT_CPU;
   own_cpu_data_ = false;
 }
@@ -149,8 +206,10 @@ void CNSyncedMemory::SetMluData(void* data) {
   std::lock_guard<std::mutex> lock(mutex_);
   if (0 == size_) return;
   LOGF_IF(FRAME, nullptr == data) << "data is NULL.";
+  WaitPrefetch();
   if (own_mlu_data_) {
-    CALL_CNRT_BY_CONTEXT(cnrtFree(mlu_ptr_), dev_id_, ddr_chn_);
+    MluMemoryPool::Instance().Free(mlu_ptr_);
+    mlu_charge_.Release();
   }
   mlu_ptr_ = data;
   head_ = SyncedHead::HEAD_AT_MLU;
@@ -194,4 +253,73 @@ void* CNSyncedMemory::GetMutableMluData() {
   return mlu_ptr_;
 }
 
+bool CNSyncedMemory::PrefetchToCpu(cnrtQueue_t queue) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (0 == size_ || prefetching_ || SyncedHead::HEAD_AT_MLU != head_) return true;
+  if (!queue) {
+    LOGE(FRAME) << "PrefetchToCpu: queue is null.";
+    return false;
+  }
+  if (NULL == cpu_ptr_) {
+    CNStreamMallocHost(&cpu_ptr_, size_, &cpu_data_source_, &cpu_charge_);
+    own_cpu_data_ = true;
+  }
+  if (!notifier_) CNS_CNRT_CHECK(cnrtCreateNotifier(&notifier_));
+  CALL_CNRT_BY_CONTEXT(cnrtMemcpyAsync(cpu_ptr_, mlu_ptr_, size_, queue, CNRT_MEM_TRANS_DIR_DEV2HOST), dev_id_,
+                       ddr_chn_);
+  CNS_CNRT_CHECK(cnrtPlaceNotifier(notifier_, queue));
+  head_ = SyncedHead::SYNCED;
+  prefetching_ = true;
+  return true;
+}
+
+bool CNSyncedMemory::PrefetchToMlu(cnrtQueue_t queue) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (0 == size_ || prefetching_ || SyncedHead::HEAD_AT_CPU != head_) return true;
+  if (!queue) {
+    LOGE(FRAME) << "PrefetchToMlu: queue is null.";
+    return false;
+  }
+  if (NULL == mlu_ptr_) {
+    CNStreamMallocDevice(&mlu_ptr_, size_, dev_id_, ddr_chn_, &mlu_charge_);
+    own_mlu_data_ = true;
+  }
+  if (!notifier_) CNS_CNRT_CHECK(cnrtCreateNotifier(&notifier_));
+  CALL_CNRT_BY_CONTEXT(cnrtMemcpyAsync(mlu_ptr_, cpu_ptr_, size_, queue, CNRT_MEM_TRANS_DIR_HOST2DEV), dev_id_,
+                       ddr_chn_);
+  CNS_CNRT_CHECK(cnrtPlaceNotifier(notifier_, queue));
+  head_ = SyncedHead::SYNCED;
+  prefetching_ = true;
+  return true;
+}
+
+bool CNSyncedMemory::ReleaseCpuMirror() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (0 == size_ || SyncedHead::SYNCED != head_) return false;
+  WaitPrefetch();
+  if (own_cpu_data_) {
+    CNStreamFreeHost(cpu_ptr_, cpu_data_source_);
+    cpu_charge_.Release();
+  }
+  cpu_ptr_ = nullptr;
+  cpu_data_source_ = HostMemorySource::MALLOC;
+  own_cpu_data_ = false;
+  head_ = SyncedHead::HEAD_AT_MLU;
+  return true;
+}
+
+bool CNSyncedMemory::ReleaseMluMirror() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (0 == size_ || SyncedHead::SYNCED != head_) return false;
+  WaitPrefetch();
+  if (own_mlu_data_) {
+    MluMemoryPool::Instance().Free(mlu_ptr_);
+    mlu_charge_.Release();
+  }
+  mlu_ptr_ = nullptr;
+  own_mlu_data_ = false;
+  head_ = SyncedHead::HEAD_AT_CPU;
+  return true;
+}
+
 }  // namespace cnstream
@@ -42,6 +42,7 @@
 #include "cnrt.h"
 #include "cnstream_common.hpp"
 #include "cnstream_logging.hpp"
+#include "cnstream_memory_accountant.hpp"
 
 #define CNS_CNRT_CHECK(__EXPRESSION__)                                                                        \
   do {                                                                                                        \
@@ -76,6 +77,15 @@ namespace cnstream {
  */
 class CNSyncedMemory : private NonCopyable {
  public:
+  /**
+   * @brief Where the CPU data allocated by ``CNSyncedMemory`` comes from.
+   */
+  enum class HostMemorySource {
+    MALLOC = 0,      ///< Allocated by malloc, or set by users.
+    PINNED_POOL,     ///< Page-locked memory from ``HostMemoryPool``.
+    HUGE_PAGE_POOL   ///< Huge-page backed memory from ``HugePageMemoryPool``.
+  };
+
   /**
    * @brief Constructor to construct synchronized memory object.
    *
@@ -171,6 +181,47 @@ class CNSyncedMemory : private NonCopyable {
    * @return Returns the MLU data pointer.
    */
   void* GetMutableMluData();
+  /**
+   * @brief Starts copying the data to CPU asynchronously on the given queue.
+   *
+   * @param[in] queue The MLU queue the copy is enqueued on.
+   *
+   * @return Returns true if the copy is enqueued or CPU data is already the latest, otherwise returns false.
+   *
+   * @note The following getters and setters wait only until the copy is done. Page-locked memory (see
+   *       ``HostMemoryPool``) is needed for the copy to be really asynchronous.
+   */
+  bool PrefetchToCpu(cnrtQueue_t queue);
+  /**
+   * @brief Starts copying the data to MLU asynchronously on the given queue.
+   *
+   * @param[in] queue The MLU queue the copy is enqueued on.
+   *
+   * @return Returns true if the copy is enqueued or MLU data is already the latest, otherwise returns false.
+   *
+   * @note The following getters and setters wait only until the copy is done.
+   */
+  bool PrefetchToMlu(cnrtQueue_t queue);
+  /**
+   * @brief Releases the copy of the synchronized data on CPU, e.g. when no consumer left reads the data on CPU. The
+   *        data is kept on MLU, and is copied to CPU again if it is read on CPU later.
+   *
+   * @return Returns true if the copy on CPU is released. Returns false if the data is not synchronized to both CPU
+   *         and MLU, the only copy of the data is kept.
+   *
+   * @note The CPU data set by ``SetCpuData`` is not freed, its owner frees it.
+   */
+  bool ReleaseCpuMirror();
+  /**
+   * @brief Releases the copy of the synchronized data on MLU, e.g. when no consumer left reads the data on MLU. The
+   *        data is kept on CPU, and is copied to MLU again if it is read on MLU later.
+   *
+   * @return Returns true if the copy on MLU is released. Returns false if the data is not synchronized to both CPU
+   *         and MLU, the only copy of the data is kept.
+   *
+   * @note The MLU data set by ``SetMluData`` is not freed, its owner frees it.
+   */
+  bool ReleaseMluMirror();
   /**
    * @enum SyncedHead
    *
@@ -215,9 +266,18 @@ class CNSyncedMemory : private NonCopyable {
    * Synchronizes the memory data to MLU.
    */
   void ToMlu();
+  /**
+   * Waits until the prefetch copy is done.
+   */
+  void WaitPrefetch();
 
   void* cpu_ptr_ = nullptr;  ///< CPU data pointer.
   void* mlu_ptr_ = nullptr;  ///< MLU data pointer.
+  HostMemorySource cpu_data_source_ = HostMemorySource::MALLOC;  ///< Where CPU data comes from.
+  MemoryCharge cpu_charge_;       ///< The charge of the CPU data allocated by ``SyncedMemory``.
+  MemoryCharge mlu_charge_;       ///< The charge of the MLU data allocated by ``SyncedMemory``.
+  cnrtNotifier_t notifier_ = nullptr;  ///< Placed after the prefetch copy.
+  bool prefetching_ = false;           ///< Whether a prefetch copy is not waited yet.
   SyncedHead head_ = SyncedHead::UNINITIALIZED;  ///< Identifies which device data is synchronized on.
   size_t size_ = 0;                  ///< The data size.
 
@@ -0,0 +1,135 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_COLUMNAR_BATCH_HPP_
+#define MODULES_COLUMNAR_BATCH_HPP_
+
+/**
+ *  @file columnar_batch.hpp
+ *
+ *  This file contains a declaration of the ColumnarBatch struct.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @struct ColumnarBatch
+ *
+ * @brief ColumnarBatch holds the objects of many frames in columns, one row per object.
+ *
+ * A batch is serialized into a self-describing chunk, and a file written by ColumnarSink is a sequence of chunks. The
+ * columns of a chunk are stored one after another, so that readers load a column as an array without parsing rows,
+ * e.g. numpy.frombuffer in python, see python/samples/columnar_reader.py.
+ *
+ * The layout of a chunk (native endian, every header and column starts at a multiple of 8 bytes):
+ *
+ * @verbatim
+ * chunk   := magic(u32 "CNCB") version(u32) rows(u32) column_count(u32) chunk_size(u64) column * column_count
+ * column  := name(char[16], '\0' padded) type(u32) reserved(u32) data_size(u64) data padding to 8 bytes
+ * INT32   := i32 * rows
+ * INT64   := i64 * rows
+ * FLOAT32 := f32 * rows
+ * DICT    := entry_count(u32) (size(u32) bytes) * entry_count padding to 4 bytes u32 * rows, the indices of entries
+ * @endverbatim
+ *
+ * The columns are stream_id (DICT), frame_id, pts, track_id (INT64), label (INT32), score, x, y, w, h (FLOAT32). The
+ * track id and the label are -1 if they are not numbers, the bounding box is normalized as CNInferBoundingBox.
+ * Readers should skip unknown columns, new columns may be added in the same version.
+ */
+struct ColumnarBatch {
+  static constexpr uint32_t kMagic = 0x42434E43;  ///< "CNCB" in little-endian.
+  static constexpr uint32_t kVersion = 1;         ///< The version of the layout.
+
+  /**
+   * @brief The types of columns.
+   */
+  enum ColumnType : uint32_t {
+    INT32 = 1,    ///< 32-bit signed integers.
+    INT64 = 2,    ///< 64-bit signed integers.
+    FLOAT32 = 3,  ///< 32-bit floats.
+    DICT = 4,     ///< Strings encoded by a dictionary of the chunk.
+  };
+
+  /**
+   * @brief Appends a row.
+   *
+   * @return No return value.
+   */
+  void Append(const std::string &stream_id, int64_t frame_id, int64_t pts, int64_t track_id, int32_t label,
+              float score, float x, float y, float w, float h);
+
+  /**
+   * @brief Gets the number of rows.
+   *
+   * @return Returns the number of rows.
+   */
+  size_t Rows() const { return frame_id.size(); }
+
+  /**
+   * @brief Removes all rows. The memory of the columns is kept for the following rows.
+   *
+   * @return No return value.
+   */
+  void Clear();
+
+  /**
+   * @brief Serializes the batch into a chunk.
+   *
+   * @param[out] out The chunk is appended to it.
+   *
+   * @return No return value.
+   */
+  void Serialize(std::string *out) const;
+
+  /**
+   * @brief Parses a chunk, the rows are appended to this batch.
+   *
+   * @param[in] data The data starting with a chunk.
+   * @param[in] size The size of the data.
+   * @param[out] consumed The size of the chunk, could be nullptr.
+   *
+   * @return Returns false if the data does not start with a complete chunk of this version.
+   */
+  bool Parse(const void *data, size_t size, size_t *consumed = nullptr);
+
+  std::vector<std::string> stream_dict;  ///< The stream identifications of the batch.
+  std::vector<uint32_t> stream_index;    ///< The stream of each row, an index of stream_dict.
+  std::vector<int64_t> frame_id;         ///< The frame index of each row.
+  std::vector<int64_t> pts;              ///< The timestamp of each row.
+  std::vector<int64_t> track_id;         ///< The track id of each row.
+  std::vector<int32_t> label;            ///< The label of each row.
+  std::vector<float> score;              ///< The score of each row.
+  std::vector<float> x;                  ///< The left of the bounding box of each row.
+  std::vector<float> y;                  ///< The top of the bounding box of each row.
+  std::vector<float> w;                  ///< The width of the bounding box of each row.
+  std::vector<float> h;                  ///< The height of the bounding box of each row.
+
+ private:
+  std::unordered_map<std::string, uint32_t> stream_lookup_;
+};  // struct ColumnarBatch
+
+}  // namespace cnstream
+
+#endif  // MODULES_COLUMNAR_BATCH_HPP_
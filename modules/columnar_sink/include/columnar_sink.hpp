@@ -0,0 +1,148 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_COLUMNAR_SINK_HPP_
+#define MODULES_COLUMNAR_SINK_HPP_
+
+/**
+ *  @file columnar_sink.hpp
+ *
+ *  This file contains a declaration of the ColumnarSink class.
+ */
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_async_io.hpp"
+#include "cnstream_frame_va.hpp"
+#include "cnstream_module.hpp"
+#include "columnar_batch.hpp"
+
+namespace cnstream {
+
+/**
+ * @class ColumnarSink
+ *
+ * @brief ColumnarSink exports the objects of frames into a file of columnar chunks for offline analytics.
+ *
+ * The objects of all streams are collected into a ColumnarBatch, one row per object. A full batch is handed to a
+ * background thread which serializes it and writes it as one chunk, so that the module threads only copy a few
+ * fields per object. Frames without objects produce no rows. See ColumnarBatch for the layout of the chunks.
+ *
+ * The results are not dropped: when the writer falls behind by max_pending_batches batches, Process waits for it,
+ * which slows the pipeline down to the speed of the disk.
+ */
+class ColumnarSink : public Module, public ModuleCreator<ColumnarSink> {
+ public:
+  /**
+   * @brief Constructs a ColumnarSink object.
+   *
+   * @param[in] name The name of this module.
+   *
+   * @return No return value.
+   */
+  explicit ColumnarSink(const std::string &name);
+
+  /**
+   * @brief Destructs a ColumnarSink object.
+   *
+   * @return No return value.
+   */
+  ~ColumnarSink();
+
+  /**
+   * @brief Opens the output file and starts the writer thread.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the file is opened successfully.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Writes the rows left, stops the writer thread and closes the file.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+
+  /**
+   * @brief Appends the objects of a frame to the current batch.
+   *
+   * @param[in] data The frame.
+   *
+   * @return Returns 0.
+   */
+  int Process(std::shared_ptr<CNFrameInfo> data) override;
+
+  /**
+   * @brief Hands the current batch to the writer, so that the rows of a finished stream are not kept in memory.
+   *
+   * @param[in] stream_id The stream identification.
+   *
+   * @return No return value.
+   */
+  void OnEos(const std::string &stream_id) override;
+
+  /**
+   * @brief Checks the parameters of this module.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool CheckParamSet(const ModuleParamSet &paramSet) const override;
+
+  /**
+   * @brief The pixels are never read by this module.
+   *
+   * @return Returns false.
+   */
+  bool NeedsPixels() const override { return false; }
+
+ private:
+  void Submit(std::unique_lock<std::mutex> *lk);
+  void WriterLoop();
+
+  std::string output_file_;
+  size_t batch_rows_ = 65536;
+  size_t max_pending_batches_ = 4;
+  AsyncFileWriter file_;  // the chunks are written by the io ring, the writer does not wait for the disk
+
+  std::mutex mutex_;
+  std::condition_variable writer_cond_;  // notifies the writer of pending batches or stopping
+  std::condition_variable space_cond_;   // notifies Process of free batches
+  std::unique_ptr<ColumnarBatch> batch_;
+  std::deque<std::unique_ptr<ColumnarBatch>> pending_;
+  std::vector<std::unique_ptr<ColumnarBatch>> free_;  // written batches reused to avoid allocations
+  bool stop_ = false;
+  bool write_failed_ = false;
+  uint64_t rows_written_ = 0;
+  uint64_t bytes_written_ = 0;
+  std::thread writer_;
+};  // class ColumnarSink
+
+}  // namespace cnstream
+
+#endif  // MODULES_COLUMNAR_SINK_HPP_
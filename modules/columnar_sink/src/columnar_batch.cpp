@@ -0,0 +1,248 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "columnar_batch.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+constexpr uint32_t ColumnarBatch::kMagic;
+constexpr uint32_t ColumnarBatch::kVersion;
+
+namespace {
+
+struct ChunkHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t rows;
+  uint32_t column_count;
+  uint64_t chunk_size;
+};  // struct ChunkHeader
+
+struct ColumnHeader {
+  char name[16];
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t data_size;
+};  // struct ColumnHeader
+
+static_assert(sizeof(ChunkHeader) == 24, "the layout of the chunk is shared with readers in other languages");
+static_assert(sizeof(ColumnHeader) == 32, "the layout of the column is shared with readers in other languages");
+
+constexpr uint32_t kColumnCount = 10;
+
+inline size_t Align(size_t size, size_t alignment) { return (size + alignment - 1) & ~(alignment - 1); }
+
+void Pad(std::string *out, size_t alignment) { out->resize(Align(out->size(), alignment), '\0'); }
+
+template <typename T>
+void AppendPod(std::string *out, const T &value) {
+  out->append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+// writes the header with a placeholder of the size, returns the offset of the header
+size_t BeginColumn(std::string *out, const char *name, uint32_t type) {
+  ColumnHeader header;
+  memset(&header, 0, sizeof(header));
+  strncpy(header.name, name, sizeof(header.name) - 1);
+  header.type = type;
+  size_t offset = out->size();
+  AppendPod(out, header);
+  return offset;
+}
+
+void EndColumn(std::string *out, size_t offset) {
+  uint64_t data_size = out->size() - offset - sizeof(ColumnHeader);
+  memcpy(&(*out)[offset + offsetof(ColumnHeader, data_size)], &data_size, sizeof(data_size));
+  Pad(out, 8);
+}
+
+template <typename T>
+void AppendColumn(std::string *out, const char *name, uint32_t type, const std::vector<T> &values) {
+  size_t offset = BeginColumn(out, name, type);
+  out->append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+  EndColumn(out, offset);
+}
+
+template <typename T>
+bool ReadColumn(const char *data, uint64_t size, uint32_t rows, std::vector<T> *values) {
+  if (size != static_cast<uint64_t>(rows) * sizeof(T)) return false;
+  size_t base = values->size();
+  values->resize(base + rows);
+  if (rows) memcpy(&(*values)[base], data, size);
+  return true;
+}
+
+}  // namespace
+
+void ColumnarBatch::Append(const std::string &stream_id, int64_t frame, int64_t timestamp, int64_t track,
+                           int32_t label_value, float score_value, float left, float top, float width, float height) {
+  auto iter = stream_lookup_.find(stream_id);
+  if (iter == stream_lookup_.end()) {
+    iter = stream_lookup_.emplace(stream_id, static_cast<uint32_t>(stream_dict.size())).first;
+    stream_dict.push_back(stream_id);
+  }
+  stream_index.push_back(iter->second);
+  frame_id.push_back(frame);
+  pts.push_back(timestamp);
+  track_id.push_back(track);
+  label.push_back(label_value);
+  score.push_back(score_value);
+  x.push_back(left);
+  y.push_back(top);
+  w.push_back(width);
+  h.push_back(height);
+}
+
+void ColumnarBatch::Clear() {
+  stream_dict.clear();
+  stream_lookup_.clear();
+  stream_index.clear();
+  frame_id.clear();
+  pts.clear();
+  track_id.clear();
+  label.clear();
+  score.clear();
+  x.clear();
+  y.clear();
+  w.clear();
+  h.clear();
+}
+
+void ColumnarBatch::Serialize(std::string *out) const {
+  // the size of a chunk is a multiple of 8, so that the chunks following it are aligned as well
+  const size_t chunk_offset = out->size();
+  ChunkHeader header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.rows = static_cast<uint32_t>(Rows());
+  header.column_count = kColumnCount;
+  header.chunk_size = 0;
+  AppendPod(out, header);
+
+  size_t offset = BeginColumn(out, "stream_id", DICT);
+  AppendPod(out, static_cast<uint32_t>(stream_dict.size()));
+  for (const auto &entry : stream_dict) {
+    AppendPod(out, static_cast<uint32_t>(entry.size()));
+    out->append(entry);
+  }
+  Pad(out, 4);
+  out->append(reinterpret_cast<const char *>(stream_index.data()), stream_index.size() * sizeof(uint32_t));
+  EndColumn(out, offset);
+  AppendColumn(out, "frame_id", INT64, frame_id);
+  AppendColumn(out, "pts", INT64, pts);
+  AppendColumn(out, "track_id", INT64, track_id);
+  AppendColumn(out, "label", INT32, label);
+  AppendColumn(out, "score", FLOAT32, score);
+  AppendColumn(out, "x", FLOAT32, x);
+  AppendColumn(out, "y", FLOAT32, y);
+  AppendColumn(out, "w", FLOAT32, w);
+  AppendColumn(out, "h", FLOAT32, h);
+
+  uint64_t chunk_size = out->size() - chunk_offset;
+  memcpy(&(*out)[chunk_offset + offsetof(ChunkHeader, chunk_size)], &chunk_size, sizeof(chunk_size));
+}
+
+bool ColumnarBatch::Parse(const void *data, size_t size, size_t *consumed) {
+  const char *base = static_cast<const char *>(data);
+  ChunkHeader header;
+  if (size < sizeof(header)) return false;
+  memcpy(&header, base, sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion || header.chunk_size > size ||
+      header.chunk_size < sizeof(header)) {
+    return false;
+  }
+  // the rows are parsed into a temporary batch, so that this one is not changed by a broken chunk
+  ColumnarBatch parsed;
+  std::vector<std::string> dict;
+  std::vector<uint32_t> indices;
+  size_t pos = sizeof(header);
+  for (uint32_t i = 0; i < header.column_count; ++i) {
+    ColumnHeader column;
+    if (header.chunk_size - pos < sizeof(column)) return false;
+    memcpy(&column, base + pos, sizeof(column));
+    pos += sizeof(column);
+    if (column.data_size > header.chunk_size - pos) return false;
+    const char *column_data = base + pos;
+    const std::string name(column.name, strnlen(column.name, sizeof(column.name)));
+    bool valid = true;
+    if (name == "stream_id" && column.type == DICT) {
+      size_t offset = 0;
+      uint32_t entry_count = 0;
+      valid = column.data_size >= sizeof(entry_count);
+      if (valid) memcpy(&entry_count, column_data, sizeof(entry_count));
+      offset += sizeof(entry_count);
+      for (uint32_t e = 0; valid && e < entry_count; ++e) {
+        uint32_t entry_size = 0;
+        valid = column.data_size - offset >= sizeof(entry_size);
+        if (!valid) break;
+        memcpy(&entry_size, column_data + offset, sizeof(entry_size));
+        offset += sizeof(entry_size);
+        valid = column.data_size - offset >= entry_size;
+        if (valid) dict.emplace_back(column_data + offset, entry_size);
+        offset += entry_size;
+      }
+      offset = Align(offset, 4);
+      valid = valid && offset <= column.data_size &&
+              ReadColumn(column_data + offset, column.data_size - offset, header.rows, &indices);
+      for (size_t r = 0; valid && r < indices.size(); ++r) valid = indices[r] < dict.size();
+    } else if (name == "frame_id" && column.type == INT64) {
+      valid = ReadColumn(column_data, column.data_size, header.rows, &parsed.frame_id);
+    } else if (name == "pts" && column.type == INT64) {
+      valid = ReadColumn(column_data, column.data_size, header.rows, &parsed.pts);
+    } else if (name == "track_id" && column.type == INT64) {
+      valid = ReadColumn(column_data, column.data_size, header.rows, &parsed.track_id);
+    } else if (name == "label" && column.type == INT32) {
+      valid = ReadColumn(column_data, column.data_size, header.rows, &parsed.label);
+    } else if (name == "score" && column.type == FLOAT32) {
+      valid = ReadColumn(column_data, column.data_size, header.rows, &parsed.score);
+    } else if (name == "x" && column.type == FLOAT32) {
+      valid = ReadColumn(column_data, column.data_size, header.rows, &parsed.x);
+    } else if (name == "y" && column.type == FLOAT32) {
+      valid = ReadColumn(column_data, column.data_size, header.rows, &parsed.y);
+    } else if (name == "w" && column.type == FLOAT32) {
+      valid = ReadColumn(column_data, column.data_size, header.rows, &parsed.w);
+    } else if (name == "h" && column.type == FLOAT32) {
+      valid = ReadColumn(column_data, column.data_size, header.rows, &parsed.h);
+    }
+    if (!valid) return false;
+    pos = Align(pos + column.data_size, 8);
+    if (pos > header.chunk_size) pos = header.chunk_size;
+  }
+  const size_t rows = header.rows;
+  if (indices.size() != rows || parsed.frame_id.size() != rows || parsed.pts.size() != rows ||
+      parsed.track_id.size() != rows || parsed.label.size() != rows || parsed.score.size() != rows ||
+      parsed.x.size() != rows || parsed.y.size() != rows || parsed.w.size() != rows || parsed.h.size() != rows) {
+    return false;
+  }
+  for (size_t r = 0; r < rows; ++r) {
+    Append(dict[indices[r]], parsed.frame_id[r], parsed.pts[r], parsed.track_id[r], parsed.label[r], parsed.score[r],
+           parsed.x[r], parsed.y[r], parsed.w[r], parsed.h[r]);
+  }
+  if (consumed) *consumed = header.chunk_size;
+  return true;
+}
+
+}  // namespace cnstream
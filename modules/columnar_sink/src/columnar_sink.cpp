@@ -0,0 +1,214 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "columnar_sink.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+namespace {
+
+struct Row {
+  int64_t track_id;
+  int32_t label;
+  float score;
+  CNInferBoundingBox bbox;
+};  // struct Row
+
+int64_t ParseNumber(const std::string &value) {
+  if (value.empty()) return -1;
+  char *end = nullptr;
+  errno = 0;
+  long long number = strtoll(value.c_str(), &end, 10);  // NOLINT
+  return (errno || *end != '\0') ? -1 : static_cast<int64_t>(number);
+}
+
+}  // namespace
+
+ColumnarSink::ColumnarSink(const std::string &name) : Module(name) {
+  param_register_.SetModuleDesc("ColumnarSink is a module which exports the objects of frames into a file of columnar"
+      " chunks for offline analytics. Rows are collected into large batches and written on a background thread.");
+  param_register_.Register("output_file", "The path of the output file, it is replaced if it exists."
+      " Default is columnar_results.cncb.");
+  param_register_.Register("batch_rows", "The number of objects written as one chunk. Default is 65536.");
+  param_register_.Register("max_pending_batches", "The max number of batches waiting for the writer, Process waits"
+      " when it is reached. Default is 4.");
+}
+
+ColumnarSink::~ColumnarSink() { Close(); }
+
+bool ColumnarSink::Open(ModuleParamSet paramSet) {
+  if (!CheckParamSet(paramSet)) return false;
+  Close();
+  auto get = [&paramSet](const std::string &key, const std::string &default_value) {
+    return paramSet.find(key) != paramSet.end() ? paramSet[key] : default_value;
+  };
+  output_file_ = get("output_file", "columnar_results.cncb");
+  batch_rows_ = std::stoul(get("batch_rows", "65536"));
+  max_pending_batches_ = std::stoul(get("max_pending_batches", "4"));
+
+  if (!file_.Open(output_file_)) {
+    LOGE(ColumnarSink) << "[" << GetName() << "] Open " << output_file_ << " failed, " << strerror(errno);
+    return false;
+  }
+  std::lock_guard<std::mutex> lk(mutex_);
+  batch_.reset(new ColumnarBatch);
+  pending_.clear();
+  stop_ = false;
+  write_failed_ = false;
+  rows_written_ = 0;
+  bytes_written_ = 0;
+  writer_ = std::thread(&ColumnarSink::WriterLoop, this);
+  return true;
+}
+
+void ColumnarSink::Close() {
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (!writer_.joinable()) return;
+    if (batch_ && batch_->Rows()) Submit(&lk);
+    stop_ = true;
+  }
+  writer_cond_.notify_all();
+  space_cond_.notify_all();
+  writer_.join();
+  int ret = file_.Close();
+  if (ret != 0 && !write_failed_) {
+    LOGE(ColumnarSink) << "[" << GetName() << "] Write " << output_file_ << " failed, " << strerror(-ret);
+  }
+  batch_.reset();
+  free_.clear();
+  LOGI(ColumnarSink) << "[" << GetName() << "] " << rows_written_ << " rows, " << bytes_written_ << " bytes are"
+                     << " written to " << output_file_;
+}
+
+int ColumnarSink::Process(std::shared_ptr<CNFrameInfo> data) {
+  if (!data || data->IsEos() || data->IsRemoved() || !data->collection.HasValue(kCNInferObjsSlot)) return 0;
+  int64_t frame_id = -1;
+  if (data->collection.HasValue(kCNDataFrameSlot)) {
+    frame_id = static_cast<int64_t>(data->collection.Get(kCNDataFrameSlot)->frame_id);
+  }
+  // the fields are parsed before locking, only appending to the batch is serialized
+  std::vector<Row> rows;
+  {
+    CNInferObjsSnapshot objs = data->collection.Get(kCNInferObjsSlot)->GetSnapshot();
+    rows.reserve(objs->size());
+    for (const auto &obj : *objs) {
+      rows.push_back({ParseNumber(obj->track_id), static_cast<int32_t>(ParseNumber(obj->id)), obj->score, obj->bbox});
+    }
+  }
+  if (rows.empty()) return 0;
+
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (!batch_) return 0;
+  for (const auto &row : rows) {
+    batch_->Append(data->stream_id, frame_id, data->timestamp, row.track_id, row.label, row.score, row.bbox.x,
+                   row.bbox.y, row.bbox.w, row.bbox.h);
+  }
+  if (batch_->Rows() >= batch_rows_) Submit(&lk);
+  return 0;
+}
+
+void ColumnarSink::OnEos(const std::string &stream_id) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (batch_ && batch_->Rows()) Submit(&lk);
+}
+
+void ColumnarSink::Submit(std::unique_lock<std::mutex> *lk) {
+  space_cond_.wait(*lk, [this] { return pending_.size() < max_pending_batches_ || stop_; });
+  pending_.push_back(std::move(batch_));
+  if (!free_.empty()) {
+    batch_ = std::move(free_.back());
+    free_.pop_back();
+  } else {
+    batch_.reset(new ColumnarBatch);
+  }
+  writer_cond_.notify_one();
+}
+
+void ColumnarSink::WriterLoop() {
+  std::string buffer;  // reused by chunks to avoid allocations
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (true) {
+    writer_cond_.wait(lk, [this] { return !pending_.empty() || stop_; });
+    // the pending batches are written before stopping
+    if (pending_.empty()) break;
+    std::unique_ptr<ColumnarBatch> batch = std::move(pending_.front());
+    pending_.pop_front();
+    lk.unlock();
+
+    buffer.clear();
+    batch->Serialize(&buffer);
+    const int64_t ret = file_.Write(buffer.data(), buffer.size());
+    const size_t rows = batch->Rows();
+    batch->Clear();
+
+    lk.lock();
+    if (ret >= 0) {
+      rows_written_ += rows;
+      bytes_written_ += buffer.size();
+    } else if (!write_failed_) {
+      write_failed_ = true;
+      LOGE(ColumnarSink) << "[" << GetName() << "] Write " << output_file_ << " failed, " << strerror(-ret);
+    }
+    free_.push_back(std::move(batch));
+    space_cond_.notify_all();
+  }
+}
+
+bool ColumnarSink::CheckParamSet(const ModuleParamSet &paramSet) const {
+  ParametersChecker checker;
+  for (auto &it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOGW(ColumnarSink) << "[" << GetName() << "] Unknown param: " << it.first;
+    }
+  }
+  std::string err_msg;
+  if (!checker.IsNum({"batch_rows", "max_pending_batches"}, paramSet, err_msg, true)) {
+    LOGE(ColumnarSink) << "[" << GetName() << "] " << err_msg;
+    return false;
+  }
+  auto positive = [&paramSet](const std::string &key, int max_value) {
+    return paramSet.find(key) == paramSet.end() ||
+           (std::stoi(paramSet.at(key)) > 0 && std::stoi(paramSet.at(key)) <= max_value);
+  };
+  if (!positive("batch_rows", 1 << 24) || !positive("max_pending_batches", 64)) {
+    LOGE(ColumnarSink) << "[" << GetName() << "] [batch_rows] should be in [1, 16777216], [max_pending_batches]"
+                       << " should be in [1, 64]";
+    return false;
+  }
+  if (paramSet.find("output_file") != paramSet.end() && paramSet.at("output_file").empty()) {
+    LOGE(ColumnarSink) << "[" << GetName() << "] [output_file] should not be empty";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace cnstream
@@ -7,6 +7,7 @@
 #include <mutex>
 #include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "cnstream_logging.hpp"
@@ -75,13 +76,6 @@ bool SDLVideoPlayer::Init(int max_chn) {
     LOGE(DISPLAYER) << "Create SDL renderer failed." << SDL_GetError();
     return false;
   }
-  LOGI(DISPLAYER) << "before create texture";
-  int pixelf = SDL_PIXELFORMAT_BGR24;
-  texture_ = SDL_CreateTexture(renderer_, pixelf, SDL_TEXTUREACCESS_STREAMING, window_w_, window_h_);
-  if (nullptr == texture_) {
-    LOGE(DISPLAYER) << "Create SDL texture failed." << SDL_GetError();
-    return false;
-  }
   max_chn_ = max_chn;
   int square = std::ceil(std::sqrt(max_chn));
   rows_ = cols_ = square;
@@ -95,6 +89,8 @@ bool SDLVideoPlayer::Init(int max_chn) {
   flags_.resize(max_chn_, 2);
   ticker_.resize(max_chn_);
   fps_.resize(max_chn_, 0);
+  textures_.resize(max_chn_, nullptr);
+  redraw_ = true;
   for (int i = 0; i < max_chn_; ++i) {
     data_queues_[i].second = std::make_shared<std::mutex>();
   }
@@ -103,10 +99,10 @@ bool SDLVideoPlayer::Init(int max_chn) {
 
 void SDLVideoPlayer::Destroy() {
   Stop();
-  if (texture_) {
-    SDL_DestroyTexture(texture_);
-    texture_ = nullptr;
+  for (auto &texture : textures_) {
+    if (texture) SDL_DestroyTexture(texture);
   }
+  textures_.clear();
   if (renderer_) {
     SDL_DestroyRenderer(renderer_);
     renderer_ = nullptr;
@@ -147,6 +143,8 @@ void SDLVideoPlayer::EventLoop(const std::function<void()>& quit_callback) {
         if (SDL_WINDOWEVENT_CLOSE == event.window.event) {
           LOGI(DISPLAYER) << "Get SDL Close Window EVENT";
           if (quit_callback) quit_callback();
+        } else if (SDL_WINDOWEVENT_EXPOSED == event.window.event) {
+          redraw_ = true;
         }
         break;
       case SDL_QUIT:
@@ -164,42 +162,91 @@ void SDLVideoPlayer::Stop() {
   SDL_WaitThread(refresh_th_, &value);
 }
 
+bool SDLVideoPlayer::UpdateTexture(UpdateData* data) {
+  std::string fps_info = CalcFps(*data);
+  uint32_t format = SDL_PIXELFORMAT_BGR24;
+  int width = data->img.cols, height = data->img.rows;
+  cv::Mat canvas = data->img;
+  cv::Scalar font_color(255, 0, 0);
+  if (data->img.empty()) {
+    format = data->nv21 ? SDL_PIXELFORMAT_NV21 : SDL_PIXELFORMAT_NV12;
+    width = data->width;
+    height = data->height;
+    // draw on the luma plane, the texture is scaled to the tile by the renderer
+    canvas = cv::Mat(height, width, CV_8UC1, data->yuv.data());
+    font_color = cv::Scalar(255);
+  }
+  if (!fps_info.empty()) {
+    cv::Point font_point(0.6 * width, 0.1 * height);
+    double font_scale = 0.5 * width / chn_w_;
+    cv::putText(canvas, fps_info, font_point, CV_FONT_HERSHEY_SIMPLEX, font_scale, font_color);
+  }
+
+  SDL_Texture*& texture = textures_[data->chn_idx];
+  if (texture) {
+    uint32_t texture_format;
+    int texture_w, texture_h;
+    SDL_QueryTexture(texture, &texture_format, NULL, &texture_w, &texture_h);
+    if (texture_format != format || texture_w != width || texture_h != height) {
+      SDL_DestroyTexture(texture);
+      texture = nullptr;
+    }
+  }
+  if (!texture) {
+    texture = SDL_CreateTexture(renderer_, format, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (nullptr == texture) {
+      LOGE(DISPLAYER) << "Create SDL texture failed." << SDL_GetError();
+      return false;
+    }
+  }
+  int ret = 0;
+  if (data->img.empty()) {
+    ret = SDL_UpdateTexture(texture, NULL, data->yuv.data(), width);
+  } else {
+    ret = SDL_UpdateTexture(texture, NULL, data->img.data, data->img.step);
+  }
+  if (ret != 0) {
+    LOGE(DISPLAYER) << "Update SDL texture failed." << SDL_GetError();
+    return false;
+  }
+  return true;
+}
+
 void SDLVideoPlayer::Refresh() {
   auto datas = PopDataBatch();
-  uint8_t* texture_data = nullptr;
-  int pitch = 0;
-  SDL_LockTexture(texture_, NULL, reinterpret_cast<void**>(&texture_data), &pitch);
+  // the renderer keeps the last frame of each channel, nothing to do if no channel has a new frame
+  if (datas.empty() && !redraw_) return;
   for (auto& it : datas) {
-    std::string fps_info = CalcFps(it);
-    cv::Point font_point(0.6 * chn_w_, 0.1 * chn_h_);
-    cv::putText(it.img, fps_info, font_point, CV_FONT_HERSHEY_SIMPLEX, 0.5, cvScalar(255, 0, 0));
-
-    auto len = it.img.cols * 3;
-    int x = GetXByChnId(it.chn_idx);
-    int y = GetYByChnId(it.chn_idx);
-    for (int c = 0; c < it.img.rows; ++c) {
-      auto dst_ptr = texture_data + pitch * (y + c) + 3 * x;
-      memcpy(dst_ptr, it.img.data + c * len, len);
-    }
+    UpdateTexture(&it);
+  }
+  SDL_RenderClear(renderer_);
+  for (int chn_idx = 0; chn_idx < max_chn_; ++chn_idx) {
+    if (!textures_[chn_idx]) continue;
+    SDL_Rect rect = {GetXByChnId(chn_idx), GetYByChnId(chn_idx), chn_w_, chn_h_};
+    SDL_RenderCopy(renderer_, textures_[chn_idx], NULL, &rect);
   }
-  SDL_UnlockTexture(texture_);
-  SDL_RenderCopy(renderer_, texture_, NULL, NULL);
   SDL_RenderPresent(renderer_);
+  redraw_ = false;
 }
 
 void SDLVideoPlayer::SetFullScreen() { SDL_SetWindowFullscreen(window_, SDL_WINDOW_FULLSCREEN); }
 
-bool SDLVideoPlayer::FeedData(const UpdateData& data) {
+bool SDLVideoPlayer::FeedData(UpdateData data) {
   if (data.chn_idx < 0 || data.chn_idx >= max_chn_) return false;
 
   std::shared_ptr<std::mutex> pmtx = data_queues_[data.chn_idx].second;
   std::queue<UpdateData>& q = data_queues_[data.chn_idx].first;
-  cv::Size show_size(chn_w_, chn_h_);
-  auto t = data;
-  cv::resize(t.img, t.img, show_size);
+  auto t = std::move(data);
+  if (!t.img.empty()) {
+    // BGR images are uploaded in the tile size, yuv planes are scaled by the renderer
+    cv::Size show_size(chn_w_, chn_h_);
+    cv::resize(t.img, t.img, show_size);
+  } else if (t.yuv.size() < static_cast<size_t>(t.width) * t.height * 3 / 2 || t.width % 2 || t.height % 2) {
+    return false;
+  }
   std::lock_guard<std::mutex> lk(*pmtx);
   if (q.size() > 10) q.pop();
-  q.push(t);
+  q.push(std::move(t));
   return true;
 }
 
@@ -209,7 +256,7 @@ std::vector<UpdateData> SDLVideoPlayer::PopDataBatch() {
     auto pmtx = q.second;
     std::lock_guard<std::mutex> lk(*pmtx);
     if (!q.first.empty()) {
-      ret.push_back(q.first.front());
+      ret.push_back(std::move(q.first.front()));
       q.first.pop();
     }
   }
@@ -21,13 +21,18 @@
 namespace cnstream {
 
 struct UpdateData {
-  cv::Mat img;
+  cv::Mat img;  // BGR image, empty if the frame is shown from its yuv planes
+  // NV12 (or NV21) planes of width x height, the Y plane followed by the interleaved UV plane without padding
+  std::vector<uint8_t> yuv;
+  bool nv21 = false;
+  int width = 0;
+  int height = 0;
   int chn_idx = -1;
   uint32_t pts = ~(0);
   std::string stream_id;
 };  // struct UpdateData
 
-class SDLVideoPlayer {  // BGR
+class SDLVideoPlayer {  // BGR or NV12/NV21
  public:
   SDLVideoPlayer();
   ~SDLVideoPlayer();
@@ -36,7 +41,7 @@ class SDLVideoPlayer {  // BGR
   void Refresh();
   void SetFullScreen();
 
-  bool FeedData(const UpdateData &data);
+  bool FeedData(UpdateData data);
   std::string CalcFps(const UpdateData &data);
 
   void EventLoop(const std::function<void()> &quit_callback);
@@ -51,13 +56,13 @@ class SDLVideoPlayer {  // BGR
   inline bool running() const { return running_; }
   inline SDL_Window *window() const { return window_; }
   inline SDL_Renderer *renderer() const { return renderer_; }
-  inline SDL_Texture *texture() const { return texture_; }
 
   inline void SetModuleName(std::string module_name) { module_name_ = module_name; }
 
  private:
   void Stop();
   std::vector<UpdateData> PopDataBatch();
+  bool UpdateTexture(UpdateData *data);
   int GetRowIdByChnId(int chn_id) { return chn_id / cols_; }
   int GetColIdByChnId(int chn_id) { return chn_id % cols_; }
   int GetXByChnId(int chn_id) { return chn_w_ * GetColIdByChnId(chn_id); }
@@ -77,7 +82,9 @@ class SDLVideoPlayer {  // BGR
   std::vector<std::pair<std::queue<UpdateData>, std::shared_ptr<std::mutex>>> data_queues_;
   SDL_Window *window_ = nullptr;
   SDL_Renderer *renderer_ = nullptr;
-  SDL_Texture *texture_ = nullptr;
+  bool redraw_ = true;
+  // one streaming texture per channel, in the format and the size of the frames of the channel
+  std::vector<SDL_Texture *> textures_;
   SDL_Thread *refresh_th_ = nullptr;
   std::string module_name_;
 };  // class SDLVideoPlayer
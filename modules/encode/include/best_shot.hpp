@@ -0,0 +1,177 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_ENCODE_INCLUDE_BEST_SHOT_HPP_
+#define MODULES_ENCODE_INCLUDE_BEST_SHOT_HPP_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_module.hpp"
+#include "cnstream_frame_va.hpp"
+#include "private/cnstream_param.hpp"
+
+namespace cnstream {
+
+struct BestShotCandidate;
+struct BestShotContext;
+struct VideoPacket;
+class VideoStream;
+
+/**
+ * @brief The best shot of a track, a JPEG image of the object cropped from the frame it looks best in.
+ */
+struct BestShotImage {
+  std::string stream_id;       ///< The stream the object is in.
+  std::string track_id;        ///< The track id of the object.
+  std::string label;           ///< The label of the object, see CNInferObject::id.
+  float score = 0;             ///< The score of the object.
+  CNInferBoundingBox bbox;     ///< The normalized bounding box of the object in the frame.
+  uint64_t frame_id = 0;       ///< The frame index the object is cropped from.
+  int64_t timestamp = 0;       ///< The timestamp of the frame.
+  int width = 0;               ///< The width of the image.
+  int height = 0;              ///< The height of the image.
+  std::string jpeg;            ///< The JPEG data.
+  std::string file_name;       ///< The file the image is written to, empty if it is not written.
+};
+
+using BestShotImagePtr = std::shared_ptr<BestShotImage>;
+using BestShotImages = std::vector<BestShotImagePtr>;
+
+/*!< value type in CNFrameInfo::Collection : BestShotImages, the best shots finished before the frame. */
+static constexpr char kBestShotImagesTag[] = "BestShotImages";
+
+struct BestShotParam {
+  int device_id = 0;                // mlu device id, -1 :disable mlu
+  bool mlu_encoder = true;          // whether use mlu encoding, default is true
+  int width = 224;                  // Width of the images
+  int height = 224;                 // Height of the images
+  int jpeg_quality = 80;            // JPEG quality from 1 to 100
+  float padding = 0.1f;             // Padding around objects in ratio of their sizes
+  float min_score = 0.5f;           // Objects with lower scores are not cropped
+  int min_size = 32;                // Objects narrower or lower in pixels are not cropped
+  int lost_frames = 25;             // A track is finished after not seen in lost_frames frames
+  int max_track_frames = 0;         // A track is finished after max_track_frames frames, 0 means no limit
+  std::string output_dir = "";      // Directory the images are written to, empty means no file is written
+};
+
+/**
+ * @brief BestShot is a module to pick the best shot of each track.
+ *
+ * The objects of each track are scored by their detection scores and sizes, those cut by the frame border are
+ * scored lower. Whenever an object is better than the best one of its track, it is cropped with padding, grown to
+ * the aspect ratio of the images, resized and encoded to JPEG at once, so that no frame is held. Frames decoded on
+ * MLU are cropped, resized and encoded on MLU with the hardware JPEG encoder if the mlu encoder is used. The crops
+ * of all streams are encoded by one encoder, several of them are in flight at the same time.
+ *
+ * When a track is lost for ``lost_frames`` frames, lives for ``max_track_frames`` frames or the stream ends, the
+ * latest JPEG of it is the best shot. The best shots are:
+ *   - written to ``output_dir`` as ``<stream_id>_<track_id>_<frame_id>.jpg``, if it is set,
+ *   - notified by the callback set by SetBestShotCallback, and
+ *   - added to the next frame of the stream in the collection tagged by kBestShotImagesTag, so that the downstream
+ *     modules handle them, e.g. the Kafka module with BestShotKafkaHandler. The ones finished by the end of the
+ *     stream are only written and notified, since no frame follows.
+ *
+ * The objects are required to be tracked, those without track ids are ignored.
+ */
+class BestShot : public Module, public ModuleCreator<BestShot> {
+ public:
+  /**
+   * @brief Notified of each best shot on the encoding thread or the threads of the module. It should not block.
+   */
+  using BestShotCallback = std::function<void(const BestShotImagePtr &image)>;
+
+  /**
+   * @brief BestShot constructor
+   *
+   * @param  name : module name
+   */
+  explicit BestShot(const std::string &name);
+  /**
+   * @brief BestShot destructor
+   */
+  ~BestShot();
+
+  /**
+   * @brief Called by pipeline when pipeline start.
+   *
+   * @param paramSet : parameter set
+   *
+   * @return true if module open succeed, otherwise false.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Called by pipeline when pipeline stop.
+   */
+  void Close() override;
+
+  /**
+   * @brief Updates the tracks with the objects of a frame, crops the better ones and attaches the best shots
+   *        finished.
+   *
+   * @param data : data to be processed
+   *
+   * @return whether process succeed
+   * @retval 0: succeed and do no intercept data
+   * @retval <0: failed
+   */
+  int Process(CNFrameInfoPtr data) override;
+
+  /**
+   * @brief Finishes the tracks of the stream and waits for the best shots being encoded.
+   *
+   * @param stream_id : the stream id
+   */
+  void OnEos(const std::string &stream_id) override;
+
+  /**
+   * @brief Sets the callback of the best shots. It should be set before the pipeline starts.
+   *
+   * @param callback : the callback
+   */
+  void SetBestShotCallback(BestShotCallback callback);
+
+ private:
+  std::shared_ptr<BestShotContext> GetContext(const CNFrameInfoPtr &data);
+  bool OpenEncoder(const CNDataFramePtr &frame);
+  bool Crop(const std::shared_ptr<BestShotContext> &ctx, const CNFrameInfoPtr &data,
+            const BestShotCandidate &candidate);
+  void OnPacket(const VideoPacket *packet);
+  void Finish(BestShotContext *ctx, const std::string &track_id);
+  void Emit(BestShotContext *ctx, const BestShotImagePtr &image);
+
+  std::unique_ptr<ModuleParamsHelper<BestShotParam>> param_helper_ = nullptr;
+  std::mutex ctx_lock_;
+  std::map<std::string, std::shared_ptr<BestShotContext>> contexts_;
+  BestShotCallback callback_ = nullptr;
+  std::mutex encoder_lock_;  // guards the encoder, the crops of all streams are encoded by it
+  std::unique_ptr<VideoStream> encoder_;
+  bool mlu_frame_ = false;   // whether the encoder takes NV12 or NV21 frames in MLU memory
+};  // class BestShot
+
+}  // namespace cnstream
+
+#endif  // MODULES_ENCODE_INCLUDE_BEST_SHOT_HPP_
@@ -0,0 +1,163 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_ENCODE_INCLUDE_CLIP_RECORDER_HPP_
+#define MODULES_ENCODE_INCLUDE_CLIP_RECORDER_HPP_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_module.hpp"
+#include "cnstream_frame_va.hpp"
+#include "obj_filter.hpp"
+#include "private/cnstream_param.hpp"
+
+namespace cnstream {
+
+struct ClipRecorderContext;
+struct VideoPacket;
+class ClipWriter;
+
+struct ClipRecorderParam {
+  int device_id = 0;                 // mlu device id, -1 :disable mlu
+  bool mlu_encoder = true;           // whether use mlu encoding, default is true
+  int dst_width = 0;                 // Target width, preferred size same with input
+  int dst_height = 0;                // Target height, preferred size same with input
+  double frame_rate = 0;             // Target fps
+  int bit_rate = 4000000;            // Target bit rate
+  int gop_size = 10;                 // Target gop
+  std::string file_name = "";        // File name of clips, the stream id and the clip index are appended
+  bool share_encoder = false;        // Share the encoder with other modules encoding the same stream in the same way
+  double pre_seconds = 10;           // Seconds of video before the event in a clip
+  double post_seconds = 10;          // Seconds of video after the event in a clip
+  int max_buffer_size = 64;          // Max MB of packets buffered per stream
+  std::string obj_filter_name = "";  // Class name of the ObjFilter triggering clips
+};
+
+/**
+ * @brief ClipRecorder is a module to write video clips around events.
+ *
+ * The encoded bitstream of each stream is kept in memory in whole GOPs covering ``pre_seconds``, nothing is written
+ * until a trigger fires. Then a clip starting at the key frame before ``pre_seconds`` ago and ending ``post_seconds``
+ * after the event is written to a container file on a writing thread. An event during a clip extends it.
+ *
+ * A trigger fires on a frame when:
+ *   - the trigger set by SetTrigger returns true, or
+ *   - an object of the frame is passed by the ObjFilter named ``obj_filter_name``, if no trigger is set, or
+ *   - Trigger is called with the stream id, e.g. by an external alarm.
+ *
+ * With ``share_encoder``, the frames are encoded once for ClipRecorder and the Encode and RtspSink modules encoding
+ * the same stream with the same parameters, see VideoStreamBus.
+ */
+class ClipRecorder : public Module, public ModuleCreator<ClipRecorder> {
+ public:
+  /**
+   * @brief Decides whether a frame triggers a clip. It is called on the threads of the module.
+   */
+  using TriggerFunc = std::function<bool(const CNFrameInfoPtr &data)>;
+  /**
+   * @brief Notified on the writing thread after a clip is closed, success is false if it fails to be written.
+   */
+  using ClipCallback = std::function<void(const std::string &stream_id, const std::string &file_name, bool success)>;
+
+  /**
+   * @brief ClipRecorder constructor
+   *
+   * @param  name : module name
+   */
+  explicit ClipRecorder(const std::string &name);
+  /**
+   * @brief ClipRecorder destructor
+   */
+  ~ClipRecorder();
+
+  /**
+   * @brief Called by pipeline when pipeline start.
+   *
+   * @param paramSet : parameter set
+   *
+   * @return true if module open succeed, otherwise false.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Called by pipeline when pipeline stop. The clips being written are closed.
+   */
+  void Close() override;
+
+  /**
+   * @brief Buffers the bitstream of each frame and checks the trigger.
+   *
+   * @param data : data to be processed
+   *
+   * @return whether process succeed
+   * @retval 0: succeed and do no intercept data
+   * @retval <0: failed
+   */
+  int Process(CNFrameInfoPtr data) override;
+
+  void OnEos(const std::string &stream_id) override;
+
+  /**
+   * @brief Sets the trigger deciding clips by frames. It replaces ``obj_filter_name`` and should be set before the
+   *        pipeline starts.
+   *
+   * @param trigger : the trigger, nullptr to use ``obj_filter_name``
+   */
+  void SetTrigger(TriggerFunc trigger);
+
+  /**
+   * @brief Sets the callback of the clips written. It should be set before the pipeline starts.
+   *
+   * @param callback : the callback
+   */
+  void SetClipCallback(ClipCallback callback);
+
+  /**
+   * @brief Triggers a clip of a stream at the latest encoded frame.
+   *
+   * @param stream_id : the stream id
+   *
+   * @return false if the stream is not being recorded.
+   */
+  bool Trigger(const std::string &stream_id);
+
+ private:
+  ClipRecorderContext *GetContext(CNFrameInfoPtr data);
+  bool IsTriggered(const CNFrameInfoPtr &data);
+  void OnPacket(ClipRecorderContext *ctx, const VideoPacket *packet);
+  void CloseContext(ClipRecorderContext *ctx, bool wait_finish);
+
+  std::unique_ptr<ModuleParamsHelper<ClipRecorderParam>> param_helper_ = nullptr;
+  std::mutex ctx_lock_;
+  std::map<std::string, ClipRecorderContext *> contexts_;
+  TriggerFunc trigger_ = nullptr;
+  ClipCallback clip_callback_ = nullptr;
+  std::unique_ptr<ObjFilter> obj_filter_ = nullptr;
+  std::unique_ptr<ClipWriter> writer_ = nullptr;
+};  // class ClipRecorder
+
+}  // namespace cnstream
+
+#endif  // MODULES_ENCODE_INCLUDE_CLIP_RECORDER_HPP_
@@ -53,6 +53,18 @@ struct EncodeParam {
   int tile_rows = 0;                 // Grids in vertically of video tiling, only support cpu input
   bool resample = false;             // Resample frame with canvas, only support cpu input
   std::string file_name = "";        // File name to encode to
+  bool share_encoder = false;        // Share the encoder with other modules encoding the same stream in the same way
+  int segment_duration = 0;          // Roll over the container file every segment_duration seconds, 0 means never
+  int segment_size = 0;              // Roll over the container file every segment_size MB, 0 means never
+  int write_buffer_size = 0;         // MB buffered for writing container files asynchronously, 0 means synchronously
+  int cpu_encoder_threads = 0;       // Threads shared by the cpu encoders of the process, 0 means cpu cores
+  std::string preset = "superfast";  // Preset of the cpu encoder
+  std::string tune = "zerolatency";  // Tune of the cpu encoder, empty for none
+  std::string rate_control = "abr";  // Rate control of the cpu encoder, abr, cbr or crf
+  int crf = 23;                      // Constant rate factor of the crf rate control
+  bool overload_downscale = true;    // Encode at half resolution when the cpu encoder threads are overloaded
+  int roi_qp_offset = 0;             // QP offset of the detected objects, negative for higher quality
+  int background_qp_offset = 0;      // QP offset of the rest of the frame when there are objects
 };
 
 /**
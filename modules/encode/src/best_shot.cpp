@@ -0,0 +1,386 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "best_shot.hpp"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "best_shot_selector.hpp"
+#include "encode_common.hpp"
+
+namespace cnstream {
+
+struct BestShotContext {
+  std::string stream_id;
+  std::unique_ptr<BestShotSelector> selector = nullptr;  // only accessed by the module thread of the stream
+  int64_t frame_index = 0;
+  std::mutex mtx;  // guards the members below, they are accessed by the encoding thread and the module threads
+  std::condition_variable cond;
+  struct Track {
+    BestShotImagePtr image = nullptr;  // the latest one encoded
+    int in_flight = 0;
+    bool finished = false;
+  };
+  std::map<std::string, Track> tracks;
+  int in_flight = 0;
+  BestShotImages ready;
+};
+
+// Passed with a crop through the encoder as the user data
+struct PendingShot {
+  std::shared_ptr<BestShotContext> ctx;
+  BestShotImagePtr image;
+};
+
+BestShot::BestShot(const std::string &name) : Module(name) {
+  param_register_.SetModuleDesc("BestShot is a module to pick the best shot of each track, which is cropped from"
+                                " the frame and encoded to JPEG.");
+  param_helper_.reset(new (std::nothrow) ModuleParamsHelper<BestShotParam>(name));
+  auto encoder_type_parser = [](const ModuleParamSet &param_set, const std::string &param_name,
+                                const std::string &value, void *result) -> bool {
+    if (value == "cpu") {
+      *static_cast<bool *>(result) = false;
+    } else if (value == "mlu") {
+      *static_cast<bool *>(result) = true;
+    } else {
+      LOGE(BestShot) << "[ModuleParamParser] [" << param_name << "]: " << value << " failed"
+                     << "\". Choose from \"mlu\", \"cpu\".";
+      return false;
+    }
+    return true;
+  };
+
+  static const std::vector<ModuleParamDesc> regist_param = {
+      {"device_id", "0", "Which MLU device will be used.", PARAM_OPTIONAL, OFFSET(BestShotParam, device_id),
+       ModuleParamParser<int>::Parser, "int"},
+      {"encoder_type", "mlu", "Selection for encoder type. It should be 'mlu' or 'cpu'. With 'mlu', frames decoded on"
+       " MLU are cropped and resized on MLU as well.", PARAM_OPTIONAL,
+       OFFSET(BestShotParam, mlu_encoder), encoder_type_parser, "bool"},
+      {"width", "224", "Width of the images.", PARAM_OPTIONAL, OFFSET(BestShotParam, width),
+       ModuleParamParser<int>::Parser, "int"},
+      {"height", "224", "Height of the images.", PARAM_OPTIONAL, OFFSET(BestShotParam, height),
+       ModuleParamParser<int>::Parser, "int"},
+      {"jpeg_quality", "80", "JPEG quality from 1 to 100.", PARAM_OPTIONAL, OFFSET(BestShotParam, jpeg_quality),
+       ModuleParamParser<int>::Parser, "int"},
+      {"padding", "0.1", "Padding around objects in ratio of their sizes at each side.", PARAM_OPTIONAL,
+       OFFSET(BestShotParam, padding), ModuleParamParser<float>::Parser, "float"},
+      {"min_score", "0.5", "Objects with lower scores are not cropped.", PARAM_OPTIONAL,
+       OFFSET(BestShotParam, min_score), ModuleParamParser<float>::Parser, "float"},
+      {"min_size", "32", "Objects narrower or lower in pixels are not cropped.", PARAM_OPTIONAL,
+       OFFSET(BestShotParam, min_size), ModuleParamParser<int>::Parser, "int"},
+      {"lost_frames", "25", "A track is finished when it is not seen in lost_frames frames.", PARAM_OPTIONAL,
+       OFFSET(BestShotParam, lost_frames), ModuleParamParser<int>::Parser, "int"},
+      {"max_track_frames", "0", "A track is finished max_track_frames frames after it is first seen, so that long"
+       " tracks are reported in time. 0 means no limit.", PARAM_OPTIONAL,
+       OFFSET(BestShotParam, max_track_frames), ModuleParamParser<int>::Parser, "int"},
+      {"output_dir", "", "Directory the images are written to. Empty means no file is written.", PARAM_OPTIONAL,
+       OFFSET(BestShotParam, output_dir), ModuleParamParser<std::string>::Parser, "string"}};
+
+  param_helper_->Register(regist_param, &param_register_);
+}
+
+BestShot::~BestShot() { Close(); }
+
+bool BestShot::Open(ModuleParamSet paramSet) {
+  if (!param_helper_->ParseParams(paramSet)) {
+    LOGE(BestShot) << "[" << GetName() << "] parse parameters failed.";
+    return false;
+  }
+  auto params = param_helper_->GetParams();
+  if (params.mlu_encoder && params.device_id < 0) {
+    LOGE(BestShot) << "Open() device_id is required to be greater than 0, if mlu encoding is used";
+    return false;
+  }
+  if (params.width < 16 || params.height < 16 || params.width > 4096 || params.height > 4096) {
+    LOGE(BestShot) << "Open() width and height should be in [16, 4096]";
+    return false;
+  }
+  if (params.jpeg_quality < 1 || params.jpeg_quality > 100 || params.padding < 0 || params.lost_frames <= 0 ||
+      params.max_track_frames < 0) {
+    LOGE(BestShot) << "Open() jpeg_quality should be in [1, 100], padding and max_track_frames should not be"
+                   << " negative, lost_frames should be positive";
+    return false;
+  }
+  if (!params.output_dir.empty()) {
+    struct stat st;
+    if (stat(params.output_dir.c_str(), &st) != 0 && mkdir(params.output_dir.c_str(), 0777) != 0) {
+      LOGE(BestShot) << "Open() create output_dir " << params.output_dir << " failed";
+      return false;
+    }
+  }
+  return true;
+}
+
+void BestShot::Close() {
+  {
+    std::lock_guard<std::mutex> lk(ctx_lock_);
+    contexts_.clear();
+  }
+  std::lock_guard<std::mutex> lk(encoder_lock_);
+  // waits for the crops in flight, so that their user data are released by OnPacket
+  if (encoder_) encoder_->Close(true);
+  encoder_.reset();
+}
+
+void BestShot::SetBestShotCallback(BestShotCallback callback) { callback_ = std::move(callback); }
+
+std::shared_ptr<BestShotContext> BestShot::GetContext(const CNFrameInfoPtr &data) {
+  std::lock_guard<std::mutex> lk(ctx_lock_);
+  auto search = contexts_.find(data->stream_id);
+  if (search != contexts_.end()) return search->second;
+  auto params = param_helper_->GetParams();
+  BestShotSelector::Param sparam;
+  sparam.min_score = params.min_score;
+  sparam.min_size = params.min_size;
+  sparam.lost_frames = params.lost_frames;
+  sparam.max_track_frames = params.max_track_frames;
+  auto ctx = std::make_shared<BestShotContext>();
+  ctx->stream_id = data->stream_id;
+  ctx->selector.reset(new BestShotSelector(sparam));
+  contexts_[data->stream_id] = ctx;
+  return ctx;
+}
+
+bool BestShot::OpenEncoder(const CNDataFramePtr &frame) {
+  std::lock_guard<std::mutex> lk(encoder_lock_);
+  if (encoder_) return true;
+  auto params = param_helper_->GetParams();
+  VideoStream::Param sparam;
+  sparam.width = params.width;
+  sparam.height = params.height;
+  sparam.tile_cols = 1;
+  sparam.tile_rows = 1;
+  sparam.resample = false;
+  sparam.frame_rate = 30;
+  sparam.time_base = 90000;
+  sparam.bit_rate = 4000000;
+  sparam.gop_size = 1;
+  sparam.jpeg_quality = params.jpeg_quality;
+  VideoPixelFormat pixel_format =
+      frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 ? VideoPixelFormat::NV12 : VideoPixelFormat::NV21;
+  sparam.pixel_format = params.mlu_encoder ? pixel_format : VideoPixelFormat::I420;
+  sparam.codec_type = VideoCodecType::JPEG;
+  sparam.mlu_encoder = params.mlu_encoder;
+  sparam.device_id = params.device_id;
+  sparam.mlu_input = false;
+
+  std::unique_ptr<VideoStream> encoder(new VideoStream(sparam));
+  VideoStream *raw_encoder = encoder.get();
+  encoder->SetEventCallback([this, raw_encoder](VideoStream::Event event) {
+    if (event == VideoStream::Event::EVENT_DATA) {
+      VideoPacket packet;
+      memset(&packet, 0, sizeof(VideoPacket));
+      int size = raw_encoder->GetPacket(&packet);
+      if (size <= 0) return;
+      std::unique_ptr<uint8_t[]> data(new uint8_t[size]);
+      packet.data = data.get();
+      packet.size = size;
+      size = raw_encoder->GetPacket(&packet);
+      packet.size = size > 0 ? size : 0;
+      OnPacket(&packet);
+    } else if (event == VideoStream::Event::EVENT_ERROR) {
+      LOGE(BestShot) << "EventCallback() EVENT_ERROR";
+      PostEvent(EventType::EVENT_ERROR, "best shot receives error event");
+    }
+  });
+  if (!encoder->Open()) {
+    LOGE(BestShot) << "OpenEncoder() open JPEG encoder failed";
+    return false;
+  }
+  mlu_frame_ = params.mlu_encoder && IsMluFrameAvailable(frame, params.device_id);
+  encoder_ = std::move(encoder);
+  return true;
+}
+
+bool BestShot::Crop(const std::shared_ptr<BestShotContext> &ctx, const CNFrameInfoPtr &data,
+                    const BestShotCandidate &candidate) {
+  auto params = param_helper_->GetParams();
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+  int x, y, w, h;
+  GetBestShotCrop(candidate.bbox, frame->width, frame->height, params.width, params.height, params.padding, &x, &y,
+                  &w, &h);
+
+  BestShotImagePtr image = std::make_shared<BestShotImage>();
+  image->stream_id = data->stream_id;
+  image->track_id = candidate.track_id;
+  image->label = candidate.label;
+  image->score = candidate.score;
+  image->bbox = candidate.bbox;
+  image->frame_id = frame->frame_id;
+  image->timestamp = data->timestamp;
+  image->width = params.width;
+  image->height = params.height;
+  PendingShot *shot = new PendingShot{ctx, image};
+  {
+    std::lock_guard<std::mutex> lk(ctx->mtx);
+    ++ctx->in_flight;
+    ++ctx->tracks[candidate.track_id].in_flight;
+  }
+
+  bool updated = false;
+  {
+    std::lock_guard<std::mutex> lk(encoder_lock_);
+    if (!encoder_) {
+      updated = false;
+    } else if (mlu_frame_ && IsMluFrameAvailable(frame, params.device_id)) {
+      // the crop is a view of the planes, it is resized into the frame of the encoder on MLU
+      VideoStream::Buffer buffer;
+      GetMluFrameBuffer(frame, &buffer);
+      buffer.data[0] += y * buffer.stride[0] + x;
+      buffer.data[1] += y / 2 * buffer.stride[1] + x;
+      buffer.width = w;
+      buffer.height = h;
+      updated = encoder_->Update(&buffer, data->timestamp, data->stream_id, shot);
+    } else {
+      cv::Mat bgr = frame->ImageBGR();
+      updated = encoder_->Update(bgr(cv::Rect(x, y, w, h)).clone(), VideoStream::ColorFormat::BGR, data->timestamp,
+                                 data->stream_id, shot);
+    }
+  }
+  if (!updated) {
+    delete shot;
+    std::lock_guard<std::mutex> lk(ctx->mtx);
+    --ctx->in_flight;
+    --ctx->tracks[candidate.track_id].in_flight;
+    ctx->cond.notify_all();
+  }
+  return updated;
+}
+
+void BestShot::OnPacket(const VideoPacket *packet) {
+  std::unique_ptr<PendingShot> shot(static_cast<PendingShot *>(packet->user_data));
+  if (!shot) return;
+  BestShotContext *ctx = shot->ctx.get();
+  std::lock_guard<std::mutex> lk(ctx->mtx);
+  --ctx->in_flight;
+  ctx->cond.notify_all();
+  auto search = ctx->tracks.find(shot->image->track_id);
+  if (search == ctx->tracks.end()) return;
+  BestShotContext::Track &track = search->second;
+  --track.in_flight;
+  if (packet->data && packet->size) {
+    shot->image->jpeg.assign(reinterpret_cast<const char *>(packet->data), packet->size);
+    track.image = shot->image;
+  } else {
+    LOGW(BestShot) << "OnPacket() encode best shot of track [" << shot->image->track_id << "] in stream ["
+                   << ctx->stream_id << "] failed";
+  }
+  if (track.finished && !track.in_flight) {
+    if (track.image) Emit(ctx, track.image);
+    ctx->tracks.erase(search);
+  }
+}
+
+void BestShot::Finish(BestShotContext *ctx, const std::string &track_id) {
+  auto search = ctx->tracks.find(track_id);
+  if (search == ctx->tracks.end()) return;
+  // emitted after the crops in flight are encoded, the last one is the best
+  search->second.finished = true;
+  if (search->second.in_flight) return;
+  if (search->second.image) Emit(ctx, search->second.image);
+  ctx->tracks.erase(search);
+}
+
+void BestShot::Emit(BestShotContext *ctx, const BestShotImagePtr &image) {
+  auto params = param_helper_->GetParams();
+  if (!params.output_dir.empty()) {
+    std::string file_name = params.output_dir + "/" + image->stream_id + "_" + image->track_id + "_" +
+                            std::to_string(image->frame_id) + ".jpg";
+    std::ofstream file(file_name, std::ios::binary);
+    if (file.good() && file.write(image->jpeg.data(), image->jpeg.size())) {
+      image->file_name = file_name;
+    } else {
+      LOGE(BestShot) << "Emit() write " << file_name << " failed";
+    }
+  }
+  if (callback_) callback_(image);
+  ctx->ready.push_back(image);
+}
+
+int BestShot::Process(CNFrameInfoPtr data) {
+  if (nullptr == data) return -1;
+  if (data->IsEos() || data->IsRemoved()) return 0;
+
+  std::shared_ptr<BestShotContext> ctx = GetContext(data);
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+  std::vector<CNInferObjectPtr> objs;
+  if (data->collection.HasValue(kCNInferObjsSlot)) {
+    CNInferObjsPtr objs_holder = data->collection.Get(kCNInferObjsSlot);
+    std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+    objs = objs_holder->objs_;
+  }
+  std::vector<BestShotCandidate> improved;
+  std::vector<std::string> finished;
+  ctx->selector->Update(ctx->frame_index++, frame->width, frame->height, objs, &improved, &finished);
+  if (!improved.empty() && !OpenEncoder(frame)) return -1;
+  for (const auto &candidate : improved) {
+    if (!Crop(ctx, data, candidate)) {
+      LOGW(BestShot) << "Process() crop track [" << candidate.track_id << "] of stream [" << data->stream_id
+                     << "] failed";
+    }
+  }
+
+  BestShotImages ready;
+  {
+    std::lock_guard<std::mutex> lk(ctx->mtx);
+    for (const auto &track_id : finished) Finish(ctx.get(), track_id);
+    ready.swap(ctx->ready);
+  }
+  if (!ready.empty()) data->collection.Add(kBestShotImagesTag, std::move(ready));
+  return 0;
+}
+
+void BestShot::OnEos(const std::string &stream_id) {
+  std::shared_ptr<BestShotContext> ctx;
+  {
+    std::lock_guard<std::mutex> lk(ctx_lock_);
+    auto search = contexts_.find(stream_id);
+    if (search == contexts_.end()) return;
+    ctx = search->second;
+    contexts_.erase(search);
+  }
+  std::vector<std::string> finished;
+  ctx->selector->Flush(&finished);
+  std::unique_lock<std::mutex> lk(ctx->mtx);
+  for (const auto &track_id : finished) Finish(ctx.get(), track_id);
+  if (!IsStreamRemoved(stream_id) &&
+      !ctx->cond.wait_for(lk, std::chrono::seconds(3), [&ctx] { return ctx->in_flight == 0; })) {
+    LOGW(BestShot) << "OnEos() " << ctx->in_flight << " best shots of stream [" << stream_id << "] are not encoded";
+  }
+  if (!ctx->ready.empty()) {
+    LOGI(BestShot) << "OnEos() " << ctx->ready.size() << " best shots of stream [" << stream_id
+                   << "] are finished without frames carrying them";
+  }
+  ctx->ready.clear();
+}
+
+}  // namespace cnstream
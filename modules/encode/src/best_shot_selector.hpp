@@ -0,0 +1,162 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_ENCODE_SRC_BEST_SHOT_SELECTOR_HPP_
+#define MODULES_ENCODE_SRC_BEST_SHOT_SELECTOR_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+// An observation of a track chosen to be cropped
+struct BestShotCandidate {
+  std::string track_id;
+  std::string label;
+  float score = 0;
+  float quality = 0;
+  CNInferBoundingBox bbox;  // normalized, in the frame it is observed
+  int64_t frame_index = 0;
+};
+
+// Keeps the best quality observation of each track of a stream and decides when a track is finished. Not thread safe.
+class BestShotSelector {
+ public:
+  struct Param {
+    float min_score = 0.5f;      // observations with lower scores are ignored
+    int min_size = 32;           // observations narrower or lower in pixels are ignored
+    int lost_frames = 25;        // a track is finished when it is not seen in lost_frames frames
+    int max_track_frames = 0;    // a track is finished max_track_frames after it is first seen, 0 means no limit
+    float improve_ratio = 1.1f;  // an observation replaces the best one only if its quality is improve_ratio times
+  };
+
+  explicit BestShotSelector(const Param &param) : param_(param) {}
+
+  // The quality grows with the score and the size in pixels. Objects cut by the frame border are halved, since the
+  // crops are incomplete.
+  static float Quality(const CNInferBoundingBox &bbox, float score, int frame_width, int frame_height) {
+    const float margin = 0.005f;
+    float quality = score * std::sqrt(bbox.w * frame_width * bbox.h * frame_height);
+    if (bbox.x <= margin || bbox.y <= margin || bbox.x + bbox.w >= 1 - margin || bbox.y + bbox.h >= 1 - margin) {
+      quality *= 0.5f;
+    }
+    return quality;
+  }
+
+  // Updates the tracks with the objects of a frame. The observations better than the best ones of their tracks are
+  // appended to improved, the tracks finished are appended to finished. A track is finished once, the objects of it
+  // are ignored after being finished by max_track_frames, until it is lost.
+  void Update(int64_t frame_index, int frame_width, int frame_height, const std::vector<CNInferObjectPtr> &objs,
+              std::vector<BestShotCandidate> *improved, std::vector<std::string> *finished) {
+    for (const auto &obj : objs) {
+      if (!obj || obj->track_id.empty() || obj->track_id == "-1") continue;
+      auto it = tracks_.find(obj->track_id);
+      if (it == tracks_.end()) {
+        it = tracks_.emplace(obj->track_id, Track()).first;
+        it->second.first_frame = frame_index;
+      }
+      Track &track = it->second;
+      track.last_frame = frame_index;
+      if (track.finished) continue;
+      if (obj->score < param_.min_score || obj->bbox.w * frame_width < param_.min_size ||
+          obj->bbox.h * frame_height < param_.min_size) {
+        continue;
+      }
+      float quality = Quality(obj->bbox, obj->score, frame_width, frame_height);
+      if (track.candidates && quality < track.best_quality * param_.improve_ratio) continue;
+      track.best_quality = quality;
+      ++track.candidates;
+      BestShotCandidate candidate;
+      candidate.track_id = obj->track_id;
+      candidate.label = obj->id;
+      candidate.score = obj->score;
+      candidate.quality = quality;
+      candidate.bbox = obj->bbox;
+      candidate.frame_index = frame_index;
+      improved->push_back(candidate);
+    }
+    for (auto it = tracks_.begin(); it != tracks_.end();) {
+      Track &track = it->second;
+      bool lost = frame_index - track.last_frame >= param_.lost_frames;
+      if (!track.finished && (lost || (param_.max_track_frames > 0 &&
+                                       frame_index - track.first_frame >= param_.max_track_frames))) {
+        track.finished = true;
+        if (track.candidates) finished->push_back(it->first);
+      }
+      it = lost ? tracks_.erase(it) : std::next(it);
+    }
+  }
+
+  // Finishes all tracks, e.g. at the end of the stream
+  void Flush(std::vector<std::string> *finished) {
+    for (const auto &it : tracks_) {
+      if (!it.second.finished && it.second.candidates) finished->push_back(it.first);
+    }
+    tracks_.clear();
+  }
+
+  size_t GetTrackCount() const { return tracks_.size(); }
+
+ private:
+  struct Track {
+    int64_t first_frame = 0;
+    int64_t last_frame = 0;
+    float best_quality = 0;
+    int candidates = 0;
+    bool finished = false;
+  };
+
+  Param param_;
+  std::map<std::string, Track> tracks_;
+};  // class BestShotSelector
+
+// Gets the region cropped for an object in pixels. The box is padded by padding of its size at each side and grown
+// to the aspect ratio of the image, so that the object is not distorted. The region is kept in the frame and aligned
+// to 2 pixels for YUV420 frames.
+inline void GetBestShotCrop(const CNInferBoundingBox &bbox, int frame_width, int frame_height, int dst_width,
+                            int dst_height, float padding, int *x, int *y, int *w, int *h) {
+  float bw = bbox.w * frame_width * (1 + 2 * padding);
+  float bh = bbox.h * frame_height * (1 + 2 * padding);
+  float cx = (bbox.x + bbox.w / 2) * frame_width;
+  float cy = (bbox.y + bbox.h / 2) * frame_height;
+  if (bw * dst_height < bh * dst_width) {
+    bw = bh * dst_width / dst_height;
+  } else {
+    bh = bw * dst_height / dst_width;
+  }
+  bw = std::min<float>(bw, frame_width);
+  bh = std::min<float>(bh, frame_height);
+  float left = std::min(std::max(cx - bw / 2, 0.f), frame_width - bw);
+  float top = std::min(std::max(cy - bh / 2, 0.f), frame_height - bh);
+  *x = static_cast<int>(left) & ~1;
+  *y = static_cast<int>(top) & ~1;
+  *w = std::max(2, std::min(static_cast<int>(bw + 0.5f), frame_width - *x) & ~1);
+  *h = std::max(2, std::min(static_cast<int>(bh + 0.5f), frame_height - *y) & ~1);
+}
+
+}  // namespace cnstream
+
+#endif  // MODULES_ENCODE_SRC_BEST_SHOT_SELECTOR_HPP_
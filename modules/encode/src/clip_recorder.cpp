@@ -0,0 +1,421 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "clip_recorder.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cnstream_pipeline.hpp"
+#include "encode_common.hpp"
+#include "video/gop_ring.hpp"
+#include "video/video_sink/video_sink.hpp"
+#include "video/video_stream/video_stream_bus.hpp"
+
+namespace cnstream {
+
+using video::GopRing;
+using video::StoredPacket;
+using video::StoredPacketPtr;
+
+static constexpr int kTimeBase = 90000;
+
+// A clip being written, the sink is only accessed on the writing thread
+struct ClipJob {
+  std::string stream_id;
+  VideoSink::Param param;
+  int64_t end_pts = 0;
+  std::unique_ptr<VideoSink> sink = nullptr;
+  bool failed = false;
+};
+
+struct ClipRecorderContext {
+  std::string stream_id;
+  std::unique_ptr<VideoStreamBus::Subscriber> stream = nullptr;
+  VideoSink::Param sink_param;
+  std::mutex mtx;  // guards the members below, they are accessed by the encoding thread and the module threads
+  std::unique_ptr<GopRing> ring = nullptr;
+  std::shared_ptr<ClipJob> job = nullptr;
+  bool triggered = false;
+  int clip_count = 0;
+};
+
+// Writes clips on a dedicated thread, so that encoding is never stalled by the disk
+class ClipWriter {
+ public:
+  explicit ClipWriter(ClipRecorder::ClipCallback callback) : callback_(std::move(callback)) {
+    thread_ = std::thread(&ClipWriter::Loop, this);
+  }
+  ~ClipWriter() {
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+  }
+
+  void Write(const std::shared_ptr<ClipJob> &job, std::vector<StoredPacketPtr> packets, bool finish) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    tasks_.push_back({job, std::move(packets), finish});
+    cond_.notify_one();
+  }
+
+ private:
+  struct Task {
+    std::shared_ptr<ClipJob> job;
+    std::vector<StoredPacketPtr> packets;
+    bool finish;
+  };
+
+  void Loop() {
+    std::deque<Task> tasks;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lk(mtx_);
+        cond_.wait(lk, [this] { return !tasks_.empty() || !running_; });
+        // the tasks left are written before quitting, so that no clip is truncated
+        if (tasks_.empty()) break;
+        tasks.swap(tasks_);
+      }
+      for (auto &task : tasks) Run(&task);
+      tasks.clear();
+    }
+  }
+
+  void Run(Task *task) {
+    ClipJob *job = task->job.get();
+    if (!job->sink && !job->failed) {
+      job->sink.reset(new VideoSink(job->param));
+      if (VideoSink::SUCCESS != job->sink->Start()) {
+        LOGE(ClipRecorder) << "Start video sink failed, file: " << job->param.file_name;
+        job->failed = true;
+      }
+    }
+    if (!job->failed) {
+      for (const auto &packet : task->packets) {
+        VideoPacket video_packet = packet->ToVideoPacket();
+        if (VideoSink::SUCCESS != job->sink->Write(&video_packet)) {
+          LOGE(ClipRecorder) << "Write clip failed, file: " << job->param.file_name;
+          job->failed = true;
+          break;
+        }
+      }
+    }
+    if (!task->finish) return;
+    if (job->sink) job->sink->Stop();
+    job->sink.reset();
+    if (job->failed) {
+      LOGE(ClipRecorder) << "Clip of stream [" << job->stream_id << "] is not written, file: " << job->param.file_name;
+    } else {
+      LOGI(ClipRecorder) << "Clip of stream [" << job->stream_id << "] is written, file: " << job->param.file_name;
+    }
+    if (callback_) callback_(job->stream_id, job->param.file_name, !job->failed);
+  }
+
+  ClipRecorder::ClipCallback callback_;
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  std::deque<Task> tasks_;
+  bool running_ = true;
+  std::thread thread_;
+};  // class ClipWriter
+
+ClipRecorder::ClipRecorder(const std::string &name) : Module(name) {
+  param_register_.SetModuleDesc("ClipRecorder is a module to write video clips before and after events. The"
+                                " bitstream is buffered in memory and written only when a trigger fires.");
+  param_helper_.reset(new (std::nothrow) ModuleParamsHelper<ClipRecorderParam>(name));
+  auto encoder_type_parser = [](const ModuleParamSet &param_set, const std::string &param_name,
+                                const std::string &value, void *result) -> bool {
+    if (value == "cpu") {
+      *static_cast<bool *>(result) = false;
+    } else if (value == "mlu") {
+      *static_cast<bool *>(result) = true;
+    } else {
+      LOGE(ClipRecorder) << "[ModuleParamParser] [" << param_name << "]: " << value << " failed"
+                         << "\". Choose from \"mlu\", \"cpu\".";
+      return false;
+    }
+    return true;
+  };
+
+  static const std::vector<ModuleParamDesc> regist_param = {
+      {"device_id", "0", "Which MLU device will be used.", PARAM_OPTIONAL, OFFSET(ClipRecorderParam, device_id),
+       ModuleParamParser<int>::Parser, "int"},
+      {"encoder_type", "cpu", "Selection for encoder type. It should be 'mlu' or 'cpu.", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, mlu_encoder), encoder_type_parser, "bool"},
+      {"dst_width", "0", "Output video width. 0 means dst width is same with source", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, dst_width), ModuleParamParser<int>::Parser, "int"},
+      {"dst_height", "0", "Output video height. 0 means dst height is same with source", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, dst_height), ModuleParamParser<int>::Parser, "int"},
+      {"frame_rate", "30", "Frame rate of video encoding.", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, frame_rate), ModuleParamParser<double>::Parser, "double"},
+      {"bit_rate", "4000000", "Bit rate of video encoding.", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, bit_rate), ModuleParamParser<int>::Parser, "int"},
+      {"gop_size", "10", "Group of pictures. Clips start with key frames, so a smaller gop_size makes clips start"
+       " closer to pre_seconds before events.", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, gop_size), ModuleParamParser<int>::Parser, "int"},
+      {"file_name", "clips/clip.mp4",
+       "File name and path of clips, it should be a mp4, mkv or ts file. The final name will be added with stream id"
+       " and clip index, e.g. clips/clip_0_3.mp4", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, file_name), ModuleParamParser<std::string>::Parser, "string"},
+      {"share_encoder", "false",
+       "Share one encoder with the Encode and RtspSink modules in the pipeline, which encode the same stream"
+       " with the same parameters.", PARAM_OPTIONAL, OFFSET(ClipRecorderParam, share_encoder),
+       ModuleParamParser<bool>::Parser, "bool"},
+      {"pre_seconds", "10", "Seconds of video before the event in a clip.", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, pre_seconds), ModuleParamParser<double>::Parser, "double"},
+      {"post_seconds", "10", "Seconds of video after the event in a clip. Events during a clip extend it.",
+       PARAM_OPTIONAL, OFFSET(ClipRecorderParam, post_seconds), ModuleParamParser<double>::Parser, "double"},
+      {"max_buffer_size", "64", "Max MB of bitstream buffered per stream. The oldest GOPs are dropped over it, which"
+       " shortens the video before events.", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, max_buffer_size), ModuleParamParser<int>::Parser, "int"},
+      {"obj_filter_name", "", "Class name of the ObjFilter triggering clips, a clip is triggered by a frame with an"
+       " object passed by the filter. Not used if a trigger is set by SetTrigger.", PARAM_OPTIONAL,
+       OFFSET(ClipRecorderParam, obj_filter_name), ModuleParamParser<std::string>::Parser, "string"}};
+
+  param_helper_->Register(regist_param, &param_register_);
+}
+
+ClipRecorder::~ClipRecorder() { Close(); }
+
+bool ClipRecorder::Open(ModuleParamSet paramSet) {
+  if (!param_helper_->ParseParams(paramSet)) {
+    LOGE(ClipRecorder) << "[" << GetName() << "] parse parameters failed.";
+    return false;
+  }
+  auto params = param_helper_->GetParams();
+  if (params.mlu_encoder && params.device_id < 0) {
+    LOGE(ClipRecorder) << "Open() device_id is required to be greater than 0, if mlu encoding is used";
+    return false;
+  }
+  if (params.pre_seconds < 0 || params.post_seconds < 0 || params.max_buffer_size <= 0 ||
+      params.max_buffer_size >= 4096) {
+    LOGE(ClipRecorder) << "Open() pre_seconds and post_seconds should not be negative, max_buffer_size should be in"
+                       << " [1, 4095]";
+    return false;
+  }
+  std::string ext_name = params.file_name.substr(params.file_name.find_last_of(".") + 1);
+  std::transform(ext_name.begin(), ext_name.end(), ext_name.begin(), ::tolower);
+  if (params.file_name.find_last_of(".") == std::string::npos ||
+      (ext_name != "mp4" && ext_name != "mkv" && ext_name != "ts")) {
+    LOGE(ClipRecorder) << "Open() file_name should be a mp4, mkv or ts file, \"" << params.file_name << "\"";
+    return false;
+  }
+  obj_filter_.reset();
+  if (!params.obj_filter_name.empty()) {
+    obj_filter_.reset(ObjFilter::Create(params.obj_filter_name));
+    if (!obj_filter_) {
+      LOGE(ClipRecorder) << "Open() can not find ObjFilter implementation by name: " << params.obj_filter_name;
+      return false;
+    }
+  }
+  if (!trigger_ && !obj_filter_) {
+    LOGW(ClipRecorder) << "[" << GetName() << "] no trigger is set, clips are only triggered by Trigger()";
+  }
+  writer_.reset(new ClipWriter(clip_callback_));
+  return true;
+}
+
+void ClipRecorder::CloseContext(ClipRecorderContext *ctx, bool wait_finish) {
+  // the stream is closed first, so that no packet comes after the clip is finished
+  if (ctx->stream) ctx->stream->Close(wait_finish);
+  std::lock_guard<std::mutex> lk(ctx->mtx);
+  if (ctx->job && writer_) writer_->Write(ctx->job, {}, true);
+  ctx->job.reset();
+}
+
+void ClipRecorder::Close() {
+  std::lock_guard<std::mutex> lk(ctx_lock_);
+  for (auto &it : contexts_) {
+    CloseContext(it.second, false);
+    delete it.second;
+  }
+  contexts_.clear();
+  writer_.reset();
+}
+
+void ClipRecorder::SetTrigger(TriggerFunc trigger) { trigger_ = std::move(trigger); }
+
+void ClipRecorder::SetClipCallback(ClipCallback callback) { clip_callback_ = std::move(callback); }
+
+bool ClipRecorder::Trigger(const std::string &stream_id) {
+  std::lock_guard<std::mutex> lk(ctx_lock_);
+  auto search = contexts_.find(stream_id);
+  if (search == contexts_.end()) return false;
+  std::lock_guard<std::mutex> ctx_lk(search->second->mtx);
+  search->second->triggered = true;
+  return true;
+}
+
+ClipRecorderContext *ClipRecorder::GetContext(CNFrameInfoPtr data) {
+  std::lock_guard<std::mutex> lk(ctx_lock_);
+  auto search = contexts_.find(data->stream_id);
+  if (search != contexts_.end()) return search->second;
+
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+  auto params = param_helper_->GetParams();
+  std::string file_name = params.file_name;
+  std::transform(file_name.begin(), file_name.end(), file_name.begin(), ::tolower);
+  bool h265 = file_name.find("hevc") != std::string::npos || file_name.find("h265") != std::string::npos;
+
+  // the same as Encode, so that the encoder is shared with it
+  VideoStream::Param sparam;
+  sparam.width = params.dst_width > 0 ? params.dst_width : frame->width;
+  sparam.height = params.dst_height > 0 ? params.dst_height : frame->height;
+  sparam.tile_cols = 1;
+  sparam.tile_rows = 1;
+  sparam.resample = false;
+  sparam.frame_rate = params.frame_rate;
+  sparam.time_base = kTimeBase;
+  sparam.bit_rate = params.bit_rate;
+  sparam.gop_size = params.gop_size;
+  VideoPixelFormat pixel_format =
+      frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 ? VideoPixelFormat::NV12 : VideoPixelFormat::NV21;
+  sparam.pixel_format = params.mlu_encoder ? pixel_format : VideoPixelFormat::I420;
+  sparam.codec_type = h265 ? VideoCodecType::H265 : VideoCodecType::H264;
+  sparam.mlu_encoder = params.mlu_encoder;
+  sparam.device_id = params.device_id;
+  sparam.mlu_input = false;
+
+  std::unique_ptr<ClipRecorderContext> ctx(new ClipRecorderContext);
+  ctx->stream_id = data->stream_id;
+  ctx->ring.reset(new GopRing(static_cast<int64_t>(params.pre_seconds * kTimeBase),
+                              static_cast<size_t>(params.max_buffer_size) << 20));
+  VideoSink::Param &kparam = ctx->sink_param;
+  kparam.width = sparam.width;
+  kparam.height = sparam.height;
+  kparam.frame_rate = sparam.frame_rate;
+  kparam.time_base = sparam.time_base;
+  kparam.bit_rate = sparam.bit_rate;
+  kparam.gop_size = sparam.gop_size;
+  kparam.pixel_format = VideoPixelFormat::I420;
+  kparam.codec_type = sparam.codec_type;
+
+  auto event_callback = [this](VideoStream::Event event) {
+    if (event == VideoStream::Event::EVENT_ERROR) {
+      LOGE(ClipRecorder) << "EventCallback() EVENT_ERROR";
+      PostEvent(EventType::EVENT_ERROR, "clip recorder receives error event");
+    }
+  };
+  std::string channel = (GetContainer() ? GetContainer()->GetName() : "") + "/";
+  channel += (params.share_encoder ? "" : GetName() + "/") + data->stream_id;
+  ClipRecorderContext *raw_ctx = ctx.get();
+  ctx->stream = VideoStreamBus::Subscribe(
+      channel, sparam, [this, raw_ctx](const VideoPacket *packet) { OnPacket(raw_ctx, packet); }, event_callback);
+  if (!ctx->stream) {
+    LOGE(ClipRecorder) << "GetContext() open video stream failed. stream_id [" << data->stream_id << "]";
+    return nullptr;
+  }
+  contexts_[data->stream_id] = ctx.release();
+  return raw_ctx;
+}
+
+void ClipRecorder::OnPacket(ClipRecorderContext *ctx, const VideoPacket *packet) {
+  if (!packet->data || !packet->size) return;
+  auto params = param_helper_->GetParams();
+  StoredPacketPtr stored = std::make_shared<StoredPacket>(*packet);
+  std::lock_guard<std::mutex> lk(ctx->mtx);
+  bool buffered = ctx->ring->Push(stored);
+  int64_t post = static_cast<int64_t>(params.post_seconds * kTimeBase);
+  if (ctx->job && packet->pts > ctx->job->end_pts) {
+    writer_->Write(ctx->job, {}, true);
+    ctx->job.reset();
+  }
+  if (ctx->triggered && buffered) {
+    ctx->triggered = false;
+    if (ctx->job) {
+      ctx->job->end_pts = std::max(ctx->job->end_pts, packet->pts + post);
+    } else {
+      // the clip starts with the buffered GOPs, which include this packet
+      ctx->job = std::make_shared<ClipJob>();
+      ctx->job->stream_id = ctx->stream_id;
+      ctx->job->param = ctx->sink_param;
+      auto dot = params.file_name.find_last_of(".");
+      ctx->job->param.file_name = params.file_name.substr(0, dot) + "_" + ctx->stream_id + "_" +
+                                  std::to_string(ctx->clip_count++) + params.file_name.substr(dot);
+      ctx->job->end_pts = packet->pts + post;
+      int64_t since = packet->pts - static_cast<int64_t>(params.pre_seconds * kTimeBase);
+      writer_->Write(ctx->job, ctx->ring->Since(since), false);
+    }
+    return;
+  }
+  if (ctx->job) writer_->Write(ctx->job, {stored}, false);
+}
+
+bool ClipRecorder::IsTriggered(const CNFrameInfoPtr &data) {
+  if (trigger_) return trigger_(data);
+  if (!obj_filter_ || !data->collection.HasValue(kCNInferObjsSlot)) return false;
+  CNInferObjsPtr objs_holder = data->collection.Get(kCNInferObjsSlot);
+  std::vector<uint8_t> selected;
+  {
+    std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+    obj_filter_->FilterObjects(data, objs_holder->objs_, &selected);
+  }
+  return std::find(selected.begin(), selected.end(), 1) != selected.end();
+}
+
+int ClipRecorder::Process(CNFrameInfoPtr data) {
+  if (nullptr == data) return -1;
+  if (data->IsEos() || data->IsRemoved()) return 0;
+
+  ClipRecorderContext *ctx = GetContext(data);
+  if (!ctx) {
+    LOGE(ClipRecorder) << "Get clip recorder context failed.";
+    return -1;
+  }
+
+  auto params = param_helper_->GetParams();
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+  bool updated = false;
+  if (params.mlu_encoder && IsMluFrameAvailable(frame, params.device_id)) {
+    VideoStream::Buffer buffer;
+    GetMluFrameBuffer(frame, &buffer);
+    updated = ctx->stream->Update(&buffer, data->timestamp, data->stream_id, frame->frame_id);
+  } else {
+    updated = ctx->stream->Update(frame->ImageBGR(), VideoStream::ColorFormat::BGR, data->timestamp,
+                                  data->stream_id, frame->frame_id);
+  }
+  if (!updated) LOGE(ClipRecorder) << "Process() video stream update failed.";
+
+  if (IsTriggered(data)) {
+    std::lock_guard<std::mutex> lk(ctx->mtx);
+    ctx->triggered = true;
+  }
+  return 0;
+}
+
+void ClipRecorder::OnEos(const std::string &stream_id) {
+  std::lock_guard<std::mutex> lk(ctx_lock_);
+  auto search = contexts_.find(stream_id);
+  if (search == contexts_.end()) return;
+  CloseContext(search->second, !IsStreamRemoved(stream_id));
+  delete search->second;
+  contexts_.erase(search);
+}
+
+}  // namespace cnstream
@@ -20,25 +20,45 @@
 #include "encode.hpp"
 
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "cnstream_pipeline.hpp"
+#include "encode_common.hpp"
+#include "video/video_encoder/video_encoder.hpp"
 #include "video/video_sink/video_sink.hpp"
-#include "video/video_stream/video_stream.hpp"
+#include "video/video_stream/video_stream_bus.hpp"
 
 namespace cnstream {
 
 struct EncoderContext {
-  std::unique_ptr<VideoStream> stream = nullptr;
+  std::unique_ptr<VideoStreamBus::Subscriber> stream = nullptr;
   std::unique_ptr<VideoSink> sink = nullptr;
-  std::unique_ptr<uint8_t[]> buffer = nullptr;
-  int buffer_size = 0;
   std::ofstream file;
   int64_t frame_count = 0;
+  std::vector<VideoRoi> rois;  // reused by each frame
 };
 
+// The objects are encoded with roi_qp_offset first, then the whole frame with background_qp_offset, for the first
+// region containing an area applies to it.
+static void GetObjectRois(const CNFrameInfoPtr &data, int roi_qp_offset, int background_qp_offset,
+                          std::vector<VideoRoi> *rois) {
+  rois->clear();
+  if (!data->collection.HasValue(kCNInferObjsSlot)) return;
+  CNInferObjsPtr objs_holder = data->collection.Get(kCNInferObjsSlot);
+  {
+    std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+    for (const auto &obj : objs_holder->objs_) {
+      if (obj->bbox.w <= 0 || obj->bbox.h <= 0) continue;
+      rois->push_back({obj->bbox.x, obj->bbox.y, obj->bbox.w, obj->bbox.h, roi_qp_offset});
+    }
+  }
+  if (!rois->empty() && background_qp_offset) rois->push_back({0, 0, 1, 1, background_qp_offset});
+}
+
 EncoderContext *Encode::GetContext(CNFrameInfoPtr data) {
   auto params = param_helper_->GetParams();
   std::lock_guard<std::mutex> lk(ctx_lock_);
@@ -76,7 +96,7 @@ EncoderContext *Encode::CreateContext(CNFrameInfoPtr data, const std::string &st
     LOGI(Encode) << "CreateContext() the data is an EOS frame";
     return nullptr;
   }
-  CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
   bool with_container = false;
   VideoCodecType codec_type = VideoCodecType::H264;
   auto params = param_helper_->GetParams();
@@ -92,7 +112,7 @@ EncoderContext *Encode::CreateContext(CNFrameInfoPtr data, const std::string &st
   }
   std::string ext_name = file_name.substr(dot + 1);
   file_name = file_name.substr(0, dot);
-  if (ext_name == "mp4" || ext_name == "mkv") {
+  if (ext_name == "mp4" || ext_name == "mkv" || ext_name == "ts") {
     with_container = true;
   } else if (ext_name == "jpg" || ext_name == "jpeg") {
     codec_type = VideoCodecType::JPEG;
@@ -111,15 +131,21 @@ EncoderContext *Encode::CreateContext(CNFrameInfoPtr data, const std::string &st
   sparam.gop_size = params.gop_size;
   VideoPixelFormat pixel_format =
       frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 ? VideoPixelFormat::NV12 : VideoPixelFormat::NV21;
-  sparam.pixel_format = (params.mlu_encoder) ? pixel_format : VideoPixelFormat::I420;
+  sparam.pixel_format = (params.mlu_encoder || params.mlu_input_frame) ? pixel_format : VideoPixelFormat::I420;
   sparam.codec_type = codec_type;
   sparam.mlu_encoder = params.mlu_encoder;
   sparam.device_id = params.device_id;
-  ctx->stream.reset(new VideoStream(sparam));
-  if (!ctx->stream) {
-    LOGE(Encode) << "CreateContext() create video stream failed";
-    delete ctx;
-    return nullptr;
+  sparam.mlu_input = params.mlu_input_frame;
+  sparam.preset = params.preset;
+  sparam.tune = params.tune;
+  sparam.rate_control = params.rate_control;
+  sparam.crf = params.crf;
+  if (!params.mlu_encoder && params.overload_downscale && EncodeThreadBudget::Instance().IsOverloaded()) {
+    // every thread of the budget is taken, a full resolution encoder would fall behind and stall the pipeline
+    sparam.width = sparam.width / 4 * 2;
+    sparam.height = sparam.height / 4 * 2;
+    LOGW(Encode) << "CreateContext() cpu encoders overloaded, stream_id [" << stream_id << "] is encoded at "
+                 << sparam.width << "x" << sparam.height;
   }
 
   if (with_container) {
@@ -133,6 +159,9 @@ EncoderContext *Encode::CreateContext(CNFrameInfoPtr data, const std::string &st
     kparam.pixel_format = VideoPixelFormat::I420;
     kparam.codec_type = sparam.codec_type;
     kparam.file_name = params.file_name.substr(0, dot) + "_" + stream_id + "." + ext_name;
+    kparam.segment_duration = params.segment_duration;
+    kparam.segment_size = static_cast<uint64_t>(params.segment_size) << 20;
+    kparam.buffer_size = static_cast<uint32_t>(params.write_buffer_size) << 20;
     ctx->sink.reset(new VideoSink(kparam));
     if (!ctx->sink) {
       LOGE(Encode) << "CreateContext() create video sink failed";
@@ -145,54 +174,39 @@ EncoderContext *Encode::CreateContext(CNFrameInfoPtr data, const std::string &st
     }
   }
 
-  auto event_callback = [=](EncoderContext *ctx, VideoStream::Event event) {
-    if (!ctx || !ctx->stream || (with_container && !ctx->sink)) return;
-    if (event == VideoStream::Event::EVENT_DATA) {
-      VideoPacket packet;
-      memset(&packet, 0, sizeof(VideoPacket));
-      int ret = ctx->stream->GetPacket(&packet);
-      if (ret < 0) {
-        LOGE(Encode) << "EventCallback() stream get packet size failed, ret=" << ret;
+  // packets are published by the video stream bus, it may be shared with other modules
+  auto packet_callback = [=](EncoderContext *ctx, const VideoPacket *packet) {
+    if (!ctx || (with_container && !ctx->sink)) return;
+    if (with_container) {
+      int ret = ctx->sink->Write(packet);
+      if (ret != VideoSink::SUCCESS) {
+        LOGE(Encode) << "PacketCallback() sink write failed, ret=" << ret;
         return;
       }
-      if (ctx->buffer_size < ret) {
-        ctx->buffer.reset(new uint8_t[ret]);
-        ctx->buffer_size = ret;
-      }
-      packet.data = ctx->buffer.get();
-      packet.size = ctx->buffer_size;
-      ret = ctx->stream->GetPacket(&packet);
-      if (ret <= 0) {
-        LOGE(Encode) << "EventCallback() stream get packet failed, ret=" << ret;
-        return;
+    } else if (codec_type == VideoCodecType::JPEG) {
+      auto jpeg_file_name = file_name + "_" + stream_id + "_" + std::to_string(ctx->frame_count++) + "." + ext_name;
+      std::ofstream file(jpeg_file_name);
+      if (!file.good()) {
+        LOGE(Encode) << "PacketCallback() open " << jpeg_file_name << " failed";
+      } else {
+        file.write(reinterpret_cast<char *>(packet->data), packet->size);
       }
-      if (with_container) {
-        ret = ctx->sink->Write(&packet);
-        if (ret != VideoSink::SUCCESS) {
-          LOGE(Encode) << "EventCallback() sink write failed, ret=" << ret;
+      file.close();
+    } else {
+      if (!ctx->file.is_open()) {
+        auto video_file_name = file_name + "_" + stream_id + "." + ext_name;
+        ctx->file.open(video_file_name);
+        if (!ctx->file.good()) {
+          LOGE(Encode) << "PacketCallback() open " << video_file_name << " failed";
           return;
         }
-      } else if (codec_type == VideoCodecType::JPEG) {
-        auto jpeg_file_name = file_name + "_" + stream_id + "_" + std::to_string(ctx->frame_count++) + "." + ext_name;
-        std::ofstream file(jpeg_file_name);
-        if (!file.good()) {
-          LOGE(Encode) << "EventCallback() open " << jpeg_file_name << " failed";
-        } else {
-          file.write(reinterpret_cast<char *>(packet.data), packet.size);
-        }
-        file.close();
-      } else {
-        if (!ctx->file.is_open()) {
-          auto video_file_name = file_name + "_" + stream_id + "." + ext_name;
-          ctx->file.open(video_file_name);
-          if (!ctx->file.good()) {
-            LOGE(Encode) << "EventCallback() open " << video_file_name << " failed";
-            return;
-          }
-        }
-        if (ctx->file.good()) ctx->file.write(reinterpret_cast<char *>(packet.data), packet.size);
       }
-    } else if (event == VideoStream::Event::EVENT_EOS) {
+      if (ctx->file.good()) ctx->file.write(reinterpret_cast<char *>(packet->data), packet->size);
+    }
+  };
+
+  auto event_callback = [=](VideoStream::Event event) {
+    if (event == VideoStream::Event::EVENT_EOS) {
       LOGI(Encode) << "EventCallback() EVENT_EOS";
     } else if (event == VideoStream::Event::EVENT_ERROR) {
       LOGE(Encode) << "EventCallback() EVENT_ERROR";
@@ -200,13 +214,16 @@ EncoderContext *Encode::CreateContext(CNFrameInfoPtr data, const std::string &st
     }
   };
 
-  if (!ctx->stream->Open()) {
+  std::string channel = (GetContainer() ? GetContainer()->GetName() : "") + "/";
+  channel += (params.share_encoder ? "" : GetName() + "/") + stream_id;
+  ctx->stream = VideoStreamBus::Subscribe(channel, sparam, std::bind(packet_callback, ctx, std::placeholders::_1),
+                                          event_callback);
+  if (!ctx->stream) {
     LOGE(Encode) << "CreateContext() open video stream failed. stream_id [" << stream_id << "]";
     if (ctx->sink) ctx->sink->Stop();
     delete ctx;
     return nullptr;
   }
-  ctx->stream->SetEventCallback(std::bind(event_callback, ctx, std::placeholders::_1));
 
   contexts_[stream_id] = ctx;
   return ctx;
@@ -232,7 +249,9 @@ Encode::Encode(const std::string &name) : Module(name) {
   static const std::vector<ModuleParamDesc> regist_param = {
       {"device_id", "0", "Which MLU device will be used.", PARAM_OPTIONAL, OFFSET(EncodeParam, device_id),
        ModuleParamParser<int>::Parser, "int"},
-      {"input_frame", "cpu", "Selection for the input frame. It should be 'mlu' or 'cpu." , PARAM_OPTIONAL,
+      {"input_frame", "cpu", "Selection for the input frame. It should be 'mlu' or 'cpu."
+       " With 'cpu', frames decoded on MLU and not changed on CPU are still encoded from MLU memory if mlu encoder"
+       " is used.", PARAM_OPTIONAL,
        OFFSET(EncodeParam, mlu_input_frame), input_encoder_type_parser, "bool"},
       {"encoder_type", "cpu", "Selection for encoder type. It should be 'mlu' or 'cpu.", PARAM_OPTIONAL,
        OFFSET(EncodeParam, mlu_encoder), input_encoder_type_parser, "bool"},
@@ -255,6 +274,48 @@ Encode::Encode(const std::string &name) : Module(name) {
       {"file_name", "output/output.mp4",
        "File name and path to store, the final name will be added with stream id or frame count", PARAM_OPTIONAL,
        OFFSET(EncodeParam, file_name), ModuleParamParser<std::string>::Parser, "string"},
+      {"share_encoder", "false",
+       "Share one encoder with the other Encode and RtspSink modules in the pipeline, which encode the same stream"
+       " with the same parameters.", PARAM_OPTIONAL, OFFSET(EncodeParam, share_encoder),
+       ModuleParamParser<bool>::Parser, "bool"},
+      {"segment_duration", "0",
+       "Split the mp4, mkv or ts file into segments of segment_duration seconds. 0 means no time based segmentation."
+       " Segments start with key frames and are named as the file with the segment index appended.",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, segment_duration), ModuleParamParser<int>::Parser, "int"},
+      {"segment_size", "0",
+       "Split the mp4, mkv or ts file into segments of segment_size MB. 0 means no size based segmentation.",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, segment_size), ModuleParamParser<int>::Parser, "int"},
+      {"write_buffer_size", "0",
+       "MB of packets buffered for writing the mp4, mkv or ts file on a dedicated thread, so that a slow disk does not"
+       " stall encoding. Packets are dropped until the next key frame when the buffer is full."
+       " 0 means the file is written on the encoding thread.",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, write_buffer_size), ModuleParamParser<int>::Parser, "int"},
+      {"cpu_encoder_threads", "0",
+       "How many threads are shared by all the cpu encoders of the process. Each encoder takes an even share of them,"
+       " at least 1 and at most 8. 0 means the number of cpu cores.",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, cpu_encoder_threads), ModuleParamParser<int>::Parser, "int"},
+      {"preset", "superfast", "Preset of the cpu encoder, e.g. ultrafast, superfast, veryfast or medium.",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, preset), ModuleParamParser<std::string>::Parser, "string"},
+      {"tune", "zerolatency", "Tune of the cpu encoder, e.g. zerolatency or film. Empty for none.", PARAM_OPTIONAL,
+       OFFSET(EncodeParam, tune), ModuleParamParser<std::string>::Parser, "string"},
+      {"rate_control", "abr",
+       "Rate control of the cpu encoder. It should be 'abr' (average bit rate), 'cbr' (constant bit rate) or 'crf'"
+       " (constant quality, bit_rate is ignored).",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, rate_control), ModuleParamParser<std::string>::Parser, "string"},
+      {"crf", "23", "Constant rate factor of the crf rate control, from 0 to 51. Lower value means better quality.",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, crf), ModuleParamParser<int>::Parser, "int"},
+      {"overload_downscale", "true",
+       "Encode the streams at half resolution with the cpu encoder when there are more cpu encoders than"
+       " cpu_encoder_threads, instead of stalling all of them.",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, overload_downscale), ModuleParamParser<bool>::Parser, "bool"},
+      {"roi_qp_offset", "0",
+       "QP offset of the detected objects with the cpu encoder, from -51 to 51. Negative value means better quality"
+       " on the objects. Not applied to tiled or resampled streams.",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, roi_qp_offset), ModuleParamParser<int>::Parser, "int"},
+      {"background_qp_offset", "0",
+       "QP offset of the rest of the frame when there are detected objects, from -51 to 51. Positive value means"
+       " coarser background and lower bit rate.",
+       PARAM_OPTIONAL, OFFSET(EncodeParam, background_qp_offset), ModuleParamParser<int>::Parser, "int"},
       {"codec_type", "", "Replaced by file_name's extension name.", PARAM_DEPRECATED},
       {"output_dir", "", "Replaced by file_name's path.", PARAM_DEPRECATED},
       {"use_ffmpeg", "", "Always is FFMpeg if doing CPU encoding.", PARAM_DEPRECATED},
@@ -278,10 +339,38 @@ bool Encode::Open(ModuleParamSet paramSet) {
     LOGE(Encode) << "Open() device_id is required to be greater than 0, if mlu encoding is used";
     return false;
   }
+  if (params.segment_duration < 0 || params.segment_size < 0 || params.write_buffer_size < 0 ||
+      params.write_buffer_size >= 4096) {
+    LOGE(Encode) << "Open() segment_duration, segment_size and write_buffer_size should not be negative,"
+                 << " write_buffer_size should be less than 4096";
+    return false;
+  }
+  if (params.rate_control != "abr" && params.rate_control != "cbr" && params.rate_control != "crf") {
+    LOGE(Encode) << "Open() rate_control should be abr, cbr or crf";
+    return false;
+  }
+  if (params.crf < 0 || params.crf > 51 || params.cpu_encoder_threads < 0) {
+    LOGE(Encode) << "Open() crf should be from 0 to 51, cpu_encoder_threads should not be negative";
+    return false;
+  }
+  if (std::abs(params.roi_qp_offset) > 51 || std::abs(params.background_qp_offset) > 51) {
+    LOGE(Encode) << "Open() roi_qp_offset and background_qp_offset should be from -51 to 51";
+    return false;
+  }
+  if ((params.roi_qp_offset || params.background_qp_offset) &&
+      (params.mlu_encoder || params.tile_cols > 1 || params.tile_rows > 1 || params.resample)) {
+    LOGW(Encode) << "Open() roi_qp_offset and background_qp_offset are only applied by the cpu encoder to the streams"
+                 << " not tiled or resampled";
+  }
+  if (paramSet.find("cpu_encoder_threads") != paramSet.end()) {
+    EncodeThreadBudget::Instance().SetTotal(params.cpu_encoder_threads);
+  }
+#ifndef HAVE_CNCV
   if (params.mlu_input_frame && (params.tile_cols > 1 || params.tile_rows > 1)) {
-    LOGE(Encode) << "Open() mlu input tiling is not supported";
+    LOGE(Encode) << "Open() mlu input tiling is not supported. Please install CNCV.";
     return false;
   }
+#endif
   return true;
 }
 
@@ -294,7 +383,6 @@ void Encode::Close() {
     if (ctx) {
       if (ctx->stream) ctx->stream->Close();
       if (ctx->sink) ctx->sink->Stop();
-      ctx->buffer_size = 0;
       ctx->file.close();
       delete ctx;
     }
@@ -317,15 +405,27 @@ int Encode::Process(CNFrameInfoPtr data) {
   }
 
   auto params = param_helper_->GetParams();
-  CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+
+  bool mlu_input_frame = params.mlu_input_frame;
+  if (!mlu_input_frame && params.mlu_encoder && params.tile_cols <= 1 && params.tile_rows <= 1 && !params.resample) {
+    mlu_input_frame = IsMluFrameAvailable(frame, params.device_id);
+  }
+
+  const std::vector<VideoRoi> *rois = nullptr;
+  if ((params.roi_qp_offset || params.background_qp_offset) && !params.mlu_encoder) {
+    GetObjectRois(data, params.roi_qp_offset, params.background_qp_offset, &ctx->rois);
+    rois = &ctx->rois;
+  }
 
-  if (!params.mlu_input_frame) {
-    if (!ctx->stream->Update(frame->ImageBGR(), VideoStream::ColorFormat::BGR, data->timestamp, data->stream_id)) {
+  if (!mlu_input_frame) {
+    if (!ctx->stream->Update(frame->ImageBGR(), VideoStream::ColorFormat::BGR, data->timestamp, data->stream_id,
+                             frame->frame_id, rois)) {
       LOGE(Encode) << "Process() video stream update failed.";
     }
   } else {
 #ifndef HAVE_CNCV
-    if (params.mlu_input_frame && params.mlu_encoder) {
+    if (params.mlu_encoder) {
       LOGE(Encode) << "Process() Encode mlu input frame on mlu is not supported. Please install CNCV.";
       return -1;
     }
@@ -335,17 +435,8 @@ int Encode::Process(CNFrameInfoPtr data) {
       return -1;
     }
     VideoStream::Buffer buffer;
-    memset(&buffer, 0, sizeof(VideoStream::Buffer));
-    buffer.width = frame->width;
-    buffer.height = frame->height;
-    buffer.data[0] = static_cast<uint8_t *>(const_cast<void *>(frame->data[0]->GetMluData()));
-    buffer.data[1] = static_cast<uint8_t *>(const_cast<void *>(frame->data[1]->GetMluData()));
-    buffer.stride[0] = frame->stride[0];
-    buffer.stride[1] = frame->stride[1];
-    buffer.color = frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 ? VideoStream::ColorFormat::YUV_NV12
-                                                                           : VideoStream::ColorFormat::YUV_NV21;
-    buffer.mlu_device_id = frame->dst_device_id;
-    if (!ctx->stream->Update(&buffer, data->timestamp, data->stream_id)) {
+    GetMluFrameBuffer(frame, &buffer);
+    if (!ctx->stream->Update(&buffer, data->timestamp, data->stream_id, frame->frame_id, rois)) {
       LOGE(Encode) << "Process() video stream update failed";
     }
   }
@@ -368,7 +459,6 @@ void Encode::OnEos(const std::string &stream_id) {
       if (ctx) {
         if (ctx->stream) ctx->stream->Close();
         if (ctx->sink) ctx->sink->Stop();
-        ctx->buffer_size = 0;
         ctx->file.close();
         delete ctx;
       }
@@ -381,7 +471,6 @@ void Encode::OnEos(const std::string &stream_id) {
       if (ctx) {
         if (ctx->stream) ctx->stream->Close(!IsStreamRemoved(stream_id));
         if (ctx->sink) ctx->sink->Stop();
-        ctx->buffer_size = 0;
         ctx->file.close();
         delete ctx;
       }
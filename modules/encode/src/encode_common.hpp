@@ -0,0 +1,69 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_ENCODE_SRC_ENCODE_COMMON_HPP_
+#define MODULES_ENCODE_SRC_ENCODE_COMMON_HPP_
+
+#include <cstring>
+
+#include "cnstream_frame_va.hpp"
+#include "video/video_stream/video_stream.hpp"
+
+namespace cnstream {
+
+// Frames decoded on MLU and not touched on CPU are passed to the MLU encoder from MLU memory directly. The frame is
+// resized on MLU if needed, which requires CNCV.
+inline bool IsMluFrameAvailable(const CNDataFramePtr &frame, int device_id) {
+#ifdef HAVE_CNCV
+  if (frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 &&
+      frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21) {
+    return false;
+  }
+  if (frame->ctx.dev_type != DevContext::DevType::MLU || frame->dst_device_id != device_id) return false;
+  // the BGR image may have been modified, e.g. by osd
+  if (frame->HasBGRImage()) return false;
+  for (int i = 0; i < 2; ++i) {
+    if (!frame->data[i]) return false;
+    CNSyncedMemory::SyncedHead head = frame->data[i]->GetHead();
+    if (head != CNSyncedMemory::SyncedHead::HEAD_AT_MLU && head != CNSyncedMemory::SyncedHead::SYNCED) return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Describes the NV12/NV21 planes of a frame in MLU memory for VideoStream::Update
+inline void GetMluFrameBuffer(const CNDataFramePtr &frame, VideoStream::Buffer *buffer) {
+  memset(buffer, 0, sizeof(VideoStream::Buffer));
+  buffer->width = frame->width;
+  buffer->height = frame->height;
+  buffer->data[0] = static_cast<uint8_t *>(const_cast<void *>(frame->data[0]->GetMluData()));
+  buffer->data[1] = static_cast<uint8_t *>(const_cast<void *>(frame->data[1]->GetMluData()));
+  buffer->stride[0] = frame->stride[0];
+  buffer->stride[1] = frame->stride[1];
+  buffer->color = frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 ? VideoStream::ColorFormat::YUV_NV12
+                                                                          : VideoStream::ColorFormat::YUV_NV21;
+  buffer->mlu_device_id = frame->dst_device_id;
+}
+
+}  // namespace cnstream
+
+#endif  // MODULES_ENCODE_SRC_ENCODE_COMMON_HPP_
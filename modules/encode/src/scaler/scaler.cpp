@@ -148,8 +148,7 @@ void ScalerGetCropBuffer(const Scaler::Buffer *src, Scaler::Buffer *dst, const S
 bool Scaler::Process(const Buffer *src, Buffer *dst, const Rect *src_crop, const Rect *dst_crop, int carrier) {
   // do some parameters check
   if (carrier == DEFAULT) carrier = carrier_;
-  if (carrier == AUTO) carrier += 2;
-  if (carrier == CARRIER_MAX) {
+  if (carrier < AUTO || carrier >= CARRIER_MAX) {
     LOGE(Scaler) << "no valid arithmetic operator found";
     return false;
   }
@@ -159,7 +158,11 @@ bool Scaler::Process(const Buffer *src, Buffer *dst, const Rect *src_crop, const
     if (dst->mlu_device_id < 0) {
       ScalerGetCropBuffer(src, &src_buf, src_crop);
       ScalerGetCropBuffer(dst, &dst_buf, dst_crop);
-      if (carrier == OPENCV) {
+      if (carrier == AUTO) {
+        // libyuv is the fastest on every conversion it supports, the others are fallbacks
+        return LibYUVProcess(&src_buf, &dst_buf) || FFmpegProcess(&src_buf, &dst_buf) ||
+               OpenCVProcess(&src_buf, &dst_buf);
+      } else if (carrier == OPENCV) {
         return OpenCVProcess(&src_buf, &dst_buf);
       } else if (carrier == LIBYUV) {
         return LibYUVProcess(&src_buf, &dst_buf);
@@ -179,12 +182,16 @@ bool Scaler::Process(const Buffer *src, Buffer *dst, const Rect *src_crop, const
       LOGE(Scaler) << "dst memory must be same with src (DEVICE)";
       return false;
     }
-    // do resize & crop & color convert on MLU
+    // do resize & crop & color convert on MLU, dst crop is applied by offsetting the device pointers
     src_buf = *src;
-    dst_buf = *dst;
     ScalerFillBufferStride(&src_buf);
-    ScalerFillBufferStride(&dst_buf);
-    return CncvProcess(&src_buf, &dst_buf, src_crop, dst_crop);
+    if (dst_crop) {
+      ScalerGetCropBuffer(dst, &dst_buf, dst_crop);
+    } else {
+      dst_buf = *dst;
+      ScalerFillBufferStride(&dst_buf);
+    }
+    return CncvProcess(&src_buf, &dst_buf, src_crop, nullptr);
   }
   return true;
 }
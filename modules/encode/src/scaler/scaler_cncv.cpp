@@ -36,6 +36,7 @@
 #include <device/mlu_context.h>
 
 #include "cnstream_logging.hpp"
+#include "private/cnstream_allocator.hpp"
 
 #include "scaler.hpp"
 
@@ -121,7 +122,7 @@ class CncvResizeYuvContext : public CncvContext {
     if (mlu_output_) SCALER_CNRT_CHECK(cnrtFree(mlu_output_));
     if (cpu_input_) free(cpu_input_);
     if (cpu_output_) free(cpu_output_);
-    if (workspace_) SCALER_CNRT_CHECK(cnrtFree(workspace_));
+    if (workspace_) MluMemoryPool::Instance().Free(workspace_);
   };
 
  private:
@@ -174,8 +175,9 @@ bool CncvResizeYuvContext::Process(const Buffer &src, Buffer *dst, const Rect &c
                                                   &required_workspace_size));
   if (required_workspace_size != workspace_size_) {
     workspace_size_ = required_workspace_size;
-    if (workspace_) SCALER_CNRT_CHECK(cnrtFree(workspace_));
-    SCALER_CNRT_CHECK(cnrtMalloc(&(workspace_), required_workspace_size));
+    if (workspace_) MluMemoryPool::Instance().Free(workspace_);
+    workspace_ = MluMemoryPool::Instance().Alloc(required_workspace_size, device_id_);
+    LOGF_IF(ScalerCncv, !workspace_) << "Alloc workspace failed, size: " << required_workspace_size;
   }
 
   SCALER_CNCV_CHECK(cncvResizeYuv(handle_, batch_size, &(src_desc_), &(src_roi_), mlu_input_, &(dst_desc_), mlu_output_,
@@ -204,7 +206,7 @@ class CncvResizeRgbxContext : public CncvContext {
     if (mlu_output_) SCALER_CNRT_CHECK(cnrtFree(mlu_output_));
     if (cpu_input_) free(cpu_input_);
     if (cpu_output_) free(cpu_output_);
-    if (workspace_) SCALER_CNRT_CHECK(cnrtFree(workspace_));
+    if (workspace_) MluMemoryPool::Instance().Free(workspace_);
   };
 
  private:
@@ -252,8 +254,9 @@ bool CncvResizeRgbxContext::Process(const Buffer &src, Buffer *dst, const Rect &
   SCALER_CNCV_CHECK(cncvGetResizeRgbxWorkspaceSize(batch_size, &required_workspace_size));
   if (required_workspace_size != workspace_size_) {
     workspace_size_ = required_workspace_size;
-    if (workspace_) SCALER_CNRT_CHECK(cnrtFree(workspace_));
-    SCALER_CNRT_CHECK(cnrtMalloc(&(workspace_), required_workspace_size));
+    if (workspace_) MluMemoryPool::Instance().Free(workspace_);
+    workspace_ = MluMemoryPool::Instance().Alloc(required_workspace_size, device_id_);
+    LOGF_IF(ScalerCncv, !workspace_) << "Alloc workspace failed, size: " << required_workspace_size;
   }
 
   SCALER_CNCV_CHECK(cncvResizeRgbx(handle_, batch_size, src_desc_, &(src_roi_), mlu_input_, dst_desc_,
@@ -357,15 +360,16 @@ bool CncvResizeRgbxToYuvContext::Process(const Buffer &src, Buffer *dst, const R
     }
     resize_output.mlu_device_id = device_id_;
 
-    SCALER_CNRT_CHECK(cnrtMalloc(reinterpret_cast<void**>(&resize_output.data[0]), resize_output.stride[0] *
-                                resize_output.height));
+    resize_output.data[0] = static_cast<uint8_t*>(
+        MluMemoryPool::Instance().Alloc(resize_output.stride[0] * resize_output.height, device_id_));
+    LOGF_IF(ScalerCncv, !resize_output.data[0]) << "Alloc resize output failed";
     if (!resize_rgbx_ctx_->Process(src, &resize_output, crop)) {
       LOGE(CncvResizeRgbxToYuvContext) << "CncvResizeRgbxToYuvContext ResizeRgbx Failed";
     }
     if (!rgbx_to_yuv_ctx_->Process(resize_output, dst, crop)) {
       LOGE(CncvResizeRgbxToYuvContext) << "CncvResizeRgbxToYuvContext RgbxToYuv Failed";
     }
-    SCALER_CNRT_CHECK(cnrtFree(resize_output.data[0]));
+    MluMemoryPool::Instance().Free(resize_output.data[0]);
   } else {
     if (!rgbx_to_yuv_ctx_->Process(src, dst, crop)) {
       LOGE(CncvResizeRgbxToYuvContext) << "CncvResizeRgbxToYuvContext RgbxToYuv Failed";
@@ -18,9 +18,12 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <atomic>
 #include <cstring>
+#include <memory>
 
 #include "cnstream_logging.hpp"
+#include "private/cnstream_parallel.hpp"
 
 #include "libyuv.h"
 
@@ -47,7 +50,11 @@ typedef int (*Planes1To1)(const uint8_t *, int, uint8_t *, int, int, int);
 
 extern void ScalerFillBufferStride(Buffer *buffer);
 
-static int LibYUVConvertColor(const Buffer *src, Buffer *dst) {
+// libyuv names the packed rgb formats by their order in a little-endian word, e.g. libyuv ARGB is BGRA in memory.
+static constexpr int kNoConversion = -2;
+
+// returns kNoConversion if libyuv has no function converting src to dst directly
+static int LibYUVConvertColorDirect(const Buffer *src, Buffer *dst) {
   if (src->color == ColorFormat::YUV_I420) {
     static const Planes3To2 to_yuvsp_map[2] = {
         libyuv::I420ToNV12,
@@ -69,9 +76,16 @@ static int LibYUVConvertColor(const Buffer *src, Buffer *dst) {
       Planes3To1 to_1plane = to_1plane_map[dst->color - ColorFormat::BGR];
       return to_1plane(src->data[0], src->stride[0], src->data[1], src->stride[1], src->data[2], src->stride[2],
                        dst->data[0], dst->stride[0], src->width, src->height);
-    } else if (dst->color == ColorFormat::ARGB) {
-      return libyuv::I420ToARGB(src->data[0], src->stride[0], src->data[1], src->stride[1], src->data[2],
-                                src->stride[2], dst->data[0], dst->stride[0], src->width, src->height);
+    } else {
+      static const Planes3To1 to_4channels_map[4] = {
+          libyuv::I420ToARGB,
+          libyuv::I420ToABGR,
+          libyuv::I420ToRGBA,
+          libyuv::I420ToBGRA,
+      };
+      Planes3To1 to_4channels = to_4channels_map[dst->color - ColorFormat::BGRA];
+      return to_4channels(src->data[0], src->stride[0], src->data[1], src->stride[1], src->data[2], src->stride[2],
+                          dst->data[0], dst->stride[0], src->width, src->height);
     }
   } else if (src->color <= ColorFormat::YUV_NV21) {
     static const Planes2To3 to_i420_map[2] = {
@@ -106,14 +120,22 @@ static int LibYUVConvertColor(const Buffer *src, Buffer *dst) {
       Planes2To1 to_1plane = to_1plane_map[src_color_index][dst_color_index];
       return to_1plane(src->data[0], src->stride[0], src->data[1], src->stride[1], dst->data[0], dst->stride[0],
                        src->width, src->height);
-    } else if (dst->color == ColorFormat::ARGB) {
-      if (src->color == ColorFormat::YUV_NV12) {
-        return libyuv::NV12ToARGB(src->data[0], src->stride[0], src->data[1], src->stride[1], dst->data[0],
-                                  dst->stride[0], src->width, src->height);
-      } else if (src->color == ColorFormat::YUV_NV21) {
-        return libyuv::NV21ToARGB(src->data[0], src->stride[0], src->data[1], src->stride[1], dst->data[0],
-                                  dst->stride[0], src->width, src->height);
-      }
+    } else if (dst->color <= ColorFormat::RGBA) {
+      static const Planes2To1 to_4channels_map[2][2] = {
+          {
+              libyuv::NV12ToARGB,
+              libyuv::NV12ToABGR,
+          },
+          {
+              libyuv::NV21ToARGB,
+              libyuv::NV21ToABGR,
+          },
+      };
+      int src_color_index = src->color - ColorFormat::YUV_NV12;
+      int dst_color_index = dst->color - ColorFormat::BGRA;
+      Planes2To1 to_4channels = to_4channels_map[src_color_index][dst_color_index];
+      return to_4channels(src->data[0], src->stride[0], src->data[1], src->stride[1], dst->data[0], dst->stride[0],
+                          src->width, src->height);
     }
   } else if (src->color <= ColorFormat::RGB) {
     static const Planes1To3 to_i420_map[2] = {
@@ -155,14 +177,14 @@ static int LibYUVConvertColor(const Buffer *src, Buffer *dst) {
       int dst_color_index = dst->color - ColorFormat::BGR;
       Planes1To1 to_1plane = to_1plane_map[src_color_index][dst_color_index];
       return to_1plane(src->data[0], src->stride[0], dst->data[0], dst->stride[0], src->width, src->height);
-    } else if (dst->color == ColorFormat::ARGB) {
+    } else if (dst->color == ColorFormat::BGRA) {
       if (src->color <= ColorFormat::BGR) {
         return libyuv::RGB24ToARGB(src->data[0], src->stride[0], dst->data[0], dst->stride[0], src->width, src->height);
       } else {
         return libyuv::RAWToARGB(src->data[0], src->stride[0], dst->data[0], dst->stride[0], src->width, src->height);
       }
     }
-  } else if (src->color == ColorFormat::ARGB) {
+  } else if (src->color == ColorFormat::BGRA) {
     if (dst->color == ColorFormat::YUV_I420) {
       return libyuv::ARGBToI420(src->data[0], src->stride[0], dst->data[0], dst->stride[0], dst->data[1],
                                 dst->stride[1], dst->data[2], dst->stride[2], src->width, src->height);
@@ -176,9 +198,85 @@ static int LibYUVConvertColor(const Buffer *src, Buffer *dst) {
       return libyuv::ARGBToRGB24(src->data[0], src->stride[0], dst->data[0], dst->stride[0], src->width, src->height);
     } else if (dst->color <= ColorFormat::RGB) {
       return libyuv::ARGBToRAW(src->data[0], src->stride[0], dst->data[0], dst->stride[0], src->width, src->height);
+    } else {
+      static const Planes1To1 to_4channels_map[4] = {
+          libyuv::ARGBCopy,
+          libyuv::ARGBToABGR,
+          libyuv::ARGBToRGBA,
+          libyuv::ARGBToBGRA,
+      };
+      Planes1To1 to_4channels = to_4channels_map[dst->color - ColorFormat::BGRA];
+      return to_4channels(src->data[0], src->stride[0], dst->data[0], dst->stride[0], src->width, src->height);
     }
+  } else if (src->color < ColorFormat::COLOR_MAX) {
+    static const Planes1To3 to_i420_map[3] = {
+        libyuv::ABGRToI420,
+        libyuv::RGBAToI420,
+        libyuv::BGRAToI420,
+    };
+    static const Planes1To1 to_bgra_map[3] = {
+        libyuv::ABGRToARGB,
+        libyuv::RGBAToARGB,
+        libyuv::BGRAToARGB,
+    };
+    int src_color_index = src->color - ColorFormat::RGBA;
+    if (dst->color == ColorFormat::YUV_I420) {
+      Planes1To3 to_i420 = to_i420_map[src_color_index];
+      return to_i420(src->data[0], src->stride[0], dst->data[0], dst->stride[0], dst->data[1], dst->stride[1],
+                     dst->data[2], dst->stride[2], src->width, src->height);
+    } else if (dst->color == ColorFormat::BGRA) {
+      Planes1To1 to_bgra = to_bgra_map[src_color_index];
+      return to_bgra(src->data[0], src->stride[0], dst->data[0], dst->stride[0], src->width, src->height);
+    } else if (dst->color == src->color) {
+      return libyuv::ARGBCopy(src->data[0], src->stride[0], dst->data[0], dst->stride[0], src->width, src->height);
+    }
+  }
+  return kNoConversion;
+}
+
+// the pairs without libyuv function are converted through BGRA
+static int LibYUVConvertColorBand(const Buffer *src, Buffer *dst) {
+  int ret = LibYUVConvertColorDirect(src, dst);
+  if (ret != kNoConversion) return ret;
+  std::unique_ptr<uint8_t[]> data(new uint8_t[src->width * src->height * 4]);
+  Buffer bgra;
+  memset(&bgra, 0, sizeof(Buffer));
+  bgra.width = src->width;
+  bgra.height = src->height;
+  bgra.data[0] = data.get();
+  bgra.stride[0] = src->width * 4;
+  bgra.color = ColorFormat::BGRA;
+  ret = LibYUVConvertColorDirect(src, &bgra);
+  if (ret != 0) return ret;
+  return LibYUVConvertColorDirect(&bgra, dst);
+}
+
+// returns the rows [begin, begin + rows) of the buffer, chroma planes of yuv420 have half rows.
+static Buffer GetBufferBand(const Buffer *buffer, int begin, int rows) {
+  Buffer band = *buffer;
+  band.height = rows;
+  band.data[0] = buffer->data[0] + begin * buffer->stride[0];
+  if (buffer->color == ColorFormat::YUV_I420) {
+    band.data[1] = buffer->data[1] + begin / 2 * buffer->stride[1];
+    band.data[2] = buffer->data[2] + begin / 2 * buffer->stride[2];
+  } else if (buffer->color <= ColorFormat::YUV_NV21) {
+    band.data[1] = buffer->data[1] + begin / 2 * buffer->stride[1];
   }
-  return -1;
+  return band;
+}
+
+// frames higher than two bands are converted on multiple threads
+static constexpr int kMinConvertBandRows = 360;
+
+static int LibYUVConvertColor(const Buffer *src, Buffer *dst) {
+  std::atomic<int> ret{0};
+  ParallelFor(src->height, kMinConvertBandRows, 2, [&](int begin, int end) {
+    Buffer src_band = GetBufferBand(src, begin, end - begin);
+    Buffer dst_band = GetBufferBand(dst, begin, end - begin);
+    int band_ret = LibYUVConvertColorBand(&src_band, &dst_band);
+    if (band_ret != 0) ret = band_ret;
+  });
+  return ret.load();
 }
 
 static int LibYUVProcessI420(const Buffer *src, Buffer *dst) {
@@ -191,7 +289,7 @@ static int LibYUVProcessI420(const Buffer *src, Buffer *dst) {
     uint8_t *argb_src_data = nullptr, *argb_dst_data = nullptr, *dst_data = nullptr;
     uint32_t dst_stride;
     argb_src_data = new uint8_t[src->width * src->height * 4];
-    if (dst->color <= ColorFormat::RGB) {
+    if (dst->color != ColorFormat::BGRA) {
       argb_dst_data = new uint8_t[dst->width * dst->height * 4];
       dst_data = argb_dst_data;
       dst_stride = dst->width * 4;
@@ -217,8 +315,8 @@ static int LibYUVProcessI420(const Buffer *src, Buffer *dst) {
     buffer.stride[0] = dst_stride;
     buffer.width = dst->width;
     buffer.height = dst->height;
-    buffer.color = ColorFormat::ARGB;
-    ret = LibYUVConvertColor(&buffer, dst);
+    buffer.color = ColorFormat::BGRA;
+    if (argb_dst_data) ret = LibYUVConvertColor(&buffer, dst);
     if (argb_src_data) delete[] argb_src_data;
     if (argb_dst_data) delete[] argb_dst_data;
   } else {
@@ -281,7 +379,7 @@ static int LibYUVProcessYUVsp(const Buffer *src, Buffer *dst) {
     uint8_t *argb_src_data = nullptr, *argb_dst_data = nullptr, *dst_data = nullptr;
     uint32_t dst_stride;
     argb_src_data = new uint8_t[src->width * src->height * 4];
-    if (dst->color <= ColorFormat::RGB) {
+    if (dst->color != ColorFormat::BGRA) {
       argb_dst_data = new uint8_t[dst->width * dst->height * 4];
       dst_data = argb_dst_data;
       dst_stride = dst->width * 4;
@@ -312,8 +410,8 @@ static int LibYUVProcessYUVsp(const Buffer *src, Buffer *dst) {
     buffer.stride[0] = dst_stride;
     buffer.width = dst->width;
     buffer.height = dst->height;
-    buffer.color = ColorFormat::ARGB;
-    ret = LibYUVConvertColor(&buffer, dst);
+    buffer.color = ColorFormat::BGRA;
+    if (argb_dst_data) ret = LibYUVConvertColor(&buffer, dst);
     if (argb_src_data) delete[] argb_src_data;
     if (argb_dst_data) delete[] argb_dst_data;
   } else {
@@ -364,13 +462,13 @@ static int LibYUVProcessBGRRGB(const Buffer *src, Buffer *dst) {
   // convert to argb first
   uint8_t *argb_src_data = nullptr, *argb_dst_data = nullptr, *dst_data = nullptr;
   uint32_t dst_stride;
-  if (src->color <= ColorFormat::RGB) {
+  if (src->color != ColorFormat::BGRA) {
     argb_src_data = new uint8_t[src->width * src->height * 4];
     buffer.data[0] = argb_src_data;
     buffer.stride[0] = src->width * 4;
     buffer.width = src->width;
     buffer.height = src->height;
-    buffer.color = ColorFormat::ARGB;
+    buffer.color = ColorFormat::BGRA;
     ret = LibYUVConvertColor(src, &buffer);
     if (ret != 0) {
       if (argb_src_data) delete[] argb_src_data;
@@ -381,7 +479,7 @@ static int LibYUVProcessBGRRGB(const Buffer *src, Buffer *dst) {
     buffer.data[0] = src->data[0];
     buffer.stride[0] = src->stride[0];
   }
-  if (dst->color <= ColorFormat::RGB) {
+  if (dst->color != ColorFormat::BGRA) {
     argb_dst_data = new uint8_t[dst->width * dst->height * 4];
     dst_data = argb_dst_data;
     dst_stride = dst->width * 4;
@@ -400,12 +498,8 @@ static int LibYUVProcessBGRRGB(const Buffer *src, Buffer *dst) {
   buffer.stride[0] = dst_stride;
   buffer.width = dst->width;
   buffer.height = dst->height;
-  if (src->color <= ColorFormat::RGB) {
-    buffer.color = ColorFormat::ARGB;
-  } else {
-    buffer.color = src->color;
-  }
-  ret = LibYUVConvertColor(&buffer, dst);
+  buffer.color = ColorFormat::BGRA;
+  if (argb_dst_data) ret = LibYUVConvertColor(&buffer, dst);
   if (argb_src_data) delete[] argb_src_data;
   if (argb_dst_data) delete[] argb_dst_data;
   return ret;
@@ -414,7 +508,7 @@ static int LibYUVProcessBGRRGB(const Buffer *src, Buffer *dst) {
 bool LibYUVProcess(const Buffer *src, Buffer *dst) {
   if (!src || !dst) return false;
 
-  if (src->color > ColorFormat::RGB || dst->color > ColorFormat::RGB) {
+  if (src->color >= ColorFormat::COLOR_MAX || dst->color >= ColorFormat::COLOR_MAX) {
     LOGE(ScalerLibYUV) << "LibYUVProcess() unsupport color";
     return false;
   }
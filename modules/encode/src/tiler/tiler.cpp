@@ -29,24 +29,61 @@
 #include <memory>
 #include <vector>
 
+#include "cnrt.h"
+#include "device/mlu_context.h"
 #include "cnstream_logging.hpp"
+#include "private/cnstream_allocator.hpp"
 
 namespace cnstream {
 
 static thread_local std::unique_ptr<uint8_t[]> tl_grid_buffer = nullptr;
 static thread_local uint32_t tl_grid_buffer_size = 0;
 
-Tiler::Tiler(uint32_t cols, uint32_t rows, ColorFormat color, uint32_t width, uint32_t height, uint32_t stride)
-    : cols_(cols), rows_(rows), color_(color), width_(width), height_(height), stride_(stride) {
+Tiler::Tiler(uint32_t cols, uint32_t rows, ColorFormat color, uint32_t width, uint32_t height, uint32_t stride,
+             int mlu_device_id)
+    : cols_(cols), rows_(rows), color_(color), width_(width), height_(height), stride_(stride),
+      mlu_device_id_(mlu_device_id) {
   grids_.clear();
   Init();
 }
 
-Tiler::Tiler(const std::vector<Rect> &grids, ColorFormat color, uint32_t width, uint32_t height, uint32_t stride)
-    : grids_(grids), color_(color), width_(width), height_(height), stride_(stride) {
+Tiler::Tiler(const std::vector<Rect> &grids, ColorFormat color, uint32_t width, uint32_t height, uint32_t stride,
+             int mlu_device_id)
+    : grids_(grids), color_(color), width_(width), height_(height), stride_(stride), mlu_device_id_(mlu_device_id) {
   Init();
 }
 
+bool Tiler::InitMluCanvas(uint32_t stride, uint32_t buffer_size) {
+  if (color_ != ColorFormat::YUV_NV12 && color_ != ColorFormat::YUV_NV21) {
+    LOGE(Tiler) << "Tiler::InitMluCanvas() only YUV NV12/NV21 canvas is supported on MLU";
+    return false;
+  }
+  edk::MluContext mlu_ctx;
+  mlu_ctx.SetDeviceId(mlu_device_id_);
+  mlu_ctx.BindDevice();
+  for (int i = 0; i < 2; i++) {
+    mlu_canvas_[i] = cnMluMemAlloc(buffer_size, mlu_device_id_);
+    uint8_t *buffer = static_cast<uint8_t *>(mlu_canvas_[i].get());
+    if (!buffer || CNRT_RET_SUCCESS != cnrtMemset(buffer, 0, stride * height_) ||
+        CNRT_RET_SUCCESS != cnrtMemset(buffer + stride * height_, 0x80, buffer_size / 3)) {
+      LOGE(Tiler) << "Tiler::InitMluCanvas() alloc canvas on MLU " << mlu_device_id_ << " failed";
+      mlu_canvas_[0].reset();
+      mlu_canvas_[1].reset();
+      return false;
+    }
+    memset(canvas_buffers_ + i, 0, sizeof(Buffer));
+    canvas_buffers_[i].data[0] = buffer;
+    canvas_buffers_[i].data[1] = buffer + stride * height_;
+    canvas_buffers_[i].stride[0] = stride;
+    canvas_buffers_[i].stride[1] = stride;
+    canvas_buffers_[i].width = width_;
+    canvas_buffers_[i].height = height_;
+    canvas_buffers_[i].color = color_;
+    canvas_buffers_[i].mlu_device_id = mlu_device_id_;
+  }
+  return true;
+}
+
 void Tiler::Init() {
   uint32_t buffer_size;
   uint32_t stride = stride_ < width_ ? width_ : stride_;
@@ -61,7 +98,12 @@ void Tiler::Init() {
     color_ = ColorFormat::BGR;
     buffer_size = stride * height_ * 3;
   }
-  for (int i = 0; i < 2; i++) {
+  canvas_size_ = buffer_size;
+  if (mlu_device_id_ >= 0 && !InitMluCanvas(stride, buffer_size)) {
+    LOGW(Tiler) << "Tiler::Init() create canvas on MLU failed, use canvas on host";
+    mlu_device_id_ = -1;
+  }
+  for (int i = 0; i < 2 && mlu_device_id_ < 0; i++) {
     memset(canvas_buffers_ + i, 0, sizeof(Buffer));
     uint8_t *buffer = new uint8_t[buffer_size];
     memset(buffer, 0, buffer_size);
@@ -149,7 +191,8 @@ void Tiler::Init() {
 Tiler::~Tiler() {
   std::lock_guard<std::mutex> lk(buf_mtx_);
   for (int i = 0; i < 2; i++) {
-    if (canvas_buffers_[i].data[0]) delete[] canvas_buffers_[i].data[0];
+    if (mlu_device_id_ < 0 && canvas_buffers_[i].data[0]) delete[] canvas_buffers_[i].data[0];
+    mlu_canvas_[i].reset();
   }
   grids_.clear();
   grid_buffer_count_ = 0;
@@ -159,11 +202,27 @@ Tiler::~Tiler() {
 
 bool Tiler::Blit(const Buffer *buffer, int position) {
   if (static_cast<size_t>(position) >= grids_.size()) return false;
+  if (buffer->mlu_device_id >= 0 && mlu_device_id_ < 0) {
+    LOGE(Tiler) << "Tiler::Blit() MLU buffer is not supported by canvas on host";
+    return false;
+  }
   mtx_.lock();
   if (position < 0) position = (last_position_ + 1) % grids_.size();
   last_position_ = position;
 
   Rect *grid = &grids_[position];
+  if (buffer->mlu_device_id >= 0) {
+    mtx_.unlock();
+    // scale src into the grid of canvas on MLU directly, no grid buffer is needed
+    std::lock_guard<std::mutex> lk(buf_mtx_);
+    if (!Scaler::Process(buffer, &canvas_buffers_[canvas_index_], nullptr, grid)) {
+      LOGE(Tiler) << "Tiler::Blit() scaler process src to grid of canvas on MLU failed";
+      return false;
+    }
+    if (!canvas_locked_) canvas_diff_++;
+    return true;
+  }
+
   Buffer grid_buffer;
   memset(&grid_buffer, 0, sizeof(Buffer));
   grid_buffer.width = grid->w;
@@ -207,7 +266,9 @@ bool Tiler::Blit(const Buffer *buffer, int position) {
   }
 
   std::lock_guard<std::mutex> lk(buf_mtx_);
-  if (!Scaler::Process(&grid_buffer, &canvas_buffers_[canvas_index_], nullptr, grid)) {
+  if (mlu_device_id_ >= 0) {
+    if (!UploadGrid(&grid_buffer, grid)) return false;
+  } else if (!Scaler::Process(&grid_buffer, &canvas_buffers_[canvas_index_], nullptr, grid)) {
     LOGE(Tiler) << "Tiler::Blit() scaler process grid to canvas failed";
     return false;
   }
@@ -216,6 +277,41 @@ bool Tiler::Blit(const Buffer *buffer, int position) {
   return true;
 }
 
+bool Tiler::UploadGrid(const Buffer *grid_buffer, const Rect *grid) {
+  uint32_t size = grid_buffer->width * grid_buffer->height * 3 / 2;
+  MluMemoryPool &pool = MluMemoryPool::Instance();
+  void *mlu_data = pool.Alloc(size, mlu_device_id_);
+  if (!mlu_data) {
+    LOGE(Tiler) << "Tiler::UploadGrid() alloc grid buffer on MLU failed";
+    return false;
+  }
+  edk::MluContext mlu_ctx;
+  mlu_ctx.SetDeviceId(mlu_device_id_);
+  mlu_ctx.BindDevice();
+  bool ret = false;
+  if (CNRT_RET_SUCCESS != cnrtMemcpy(mlu_data, grid_buffer->data[0], size, CNRT_MEM_TRANS_DIR_HOST2DEV)) {
+    LOGE(Tiler) << "Tiler::UploadGrid() copy grid buffer to MLU failed";
+  } else {
+    Buffer mlu_grid_buffer = *grid_buffer;
+    mlu_grid_buffer.data[0] = static_cast<uint8_t *>(mlu_data);
+    mlu_grid_buffer.data[1] = mlu_grid_buffer.data[0] + grid_buffer->width * grid_buffer->height;
+    mlu_grid_buffer.mlu_device_id = mlu_device_id_;
+    ret = Scaler::Process(&mlu_grid_buffer, &canvas_buffers_[canvas_index_], nullptr, grid);
+    if (!ret) LOGE(Tiler) << "Tiler::UploadGrid() scaler process grid to canvas on MLU failed";
+  }
+  pool.Free(mlu_data);
+  return ret;
+}
+
+bool Tiler::CopyCanvas(const Buffer *src, Buffer *dst) {
+  if (mlu_device_id_ < 0) return Scaler::Process(src, dst);
+  // both canvases are in one piece of MLU memory with the same layout
+  edk::MluContext mlu_ctx;
+  mlu_ctx.SetDeviceId(mlu_device_id_);
+  mlu_ctx.BindDevice();
+  return CNRT_RET_SUCCESS == cnrtMemcpy(dst->data[0], src->data[0], canvas_size_, CNRT_MEM_TRANS_DIR_DEV2DEV);
+}
+
 Tiler::Buffer *Tiler::GetCanvas(Buffer *buffer) {
   std::lock_guard<std::mutex> lk(buf_mtx_);
   if (!buffer) {
@@ -225,8 +321,8 @@ Tiler::Buffer *Tiler::GetCanvas(Buffer *buffer) {
       if (canvas_diff_ > 0) {
         // LOG(INFO) << "Tiler::GetCanvas() canvas_diff=" << canvas_diff_ << ", need update canvas";
         // TODO(hqw): only copy diff grids
-        if (!Scaler::Process(canvas_buffer, &canvas_buffers_[canvas_index])) {
-          LOGE(Tiler) << "Tiler::GetCanvas() scaler process canvas_buffers_ failed";
+        if (!CopyCanvas(canvas_buffer, &canvas_buffers_[canvas_index])) {
+          LOGE(Tiler) << "Tiler::GetCanvas() copy canvas_buffers_ failed";
         }
         canvas_diff_ = 0;
       }
@@ -257,6 +353,7 @@ void Tiler::DumpCanvas() {
       cv::COLOR_YUV2BGR_NV12,
   };
   static int index = 0;
+  if (mlu_device_id_ >= 0) return;
   for (int i = 0; i < 2; i++) {
     cv::Mat mat;
     Buffer *buffer = &canvas_buffers_[i];
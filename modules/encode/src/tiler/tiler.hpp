@@ -23,6 +23,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -36,23 +37,34 @@ class Tiler {
   using Buffer = Scaler::Buffer;
   using Rect = Scaler::Rect;
 
-  explicit Tiler(uint32_t cols, uint32_t rows, ColorFormat color, uint32_t width, uint32_t height, uint32_t stride = 0);
+  /**
+   * The canvases are allocated in MLU memory when mlu_device_id is not negative. Grids are then scaled into the canvas
+   * by CNCV, and only YUV NV12/NV21 canvases are supported.
+   */
+  explicit Tiler(uint32_t cols, uint32_t rows, ColorFormat color, uint32_t width, uint32_t height, uint32_t stride = 0,
+                 int mlu_device_id = -1);
   explicit Tiler(const std::vector<Rect> &grids, ColorFormat color, uint32_t width, uint32_t height,
-                 uint32_t stride = 0);
+                 uint32_t stride = 0, int mlu_device_id = -1);
   ~Tiler();
 
   bool Blit(const Buffer *buffer, int position);
   Buffer *GetCanvas(Buffer *buffer = nullptr);
   void ReleaseCanvas();
+  int GetMluDeviceId() const { return mlu_device_id_; }
 
  private:
   void Init();
+  bool InitMluCanvas(uint32_t stride, uint32_t buffer_size);
+  bool UploadGrid(const Buffer *grid_buffer, const Rect *grid);
+  bool CopyCanvas(const Buffer *src, Buffer *dst);
   void DumpCanvas();
 
   uint32_t cols_, rows_;
   std::vector<Rect> grids_;
   ColorFormat color_;
   uint32_t width_, height_, stride_;
+  int mlu_device_id_ = -1;
+  uint32_t canvas_size_ = 0;
 
   std::mutex mtx_;
   int last_position_ = 0;
@@ -62,6 +74,7 @@ class Tiler {
   std::atomic<bool> canvas_locked_{false};
   int canvas_diff_ = 0;
   Buffer canvas_buffers_[2];
+  std::shared_ptr<void> mlu_canvas_[2];
 };
 
 }  // namespace cnstream
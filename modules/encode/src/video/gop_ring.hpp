@@ -0,0 +1,125 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef __GOP_RING_HPP__
+#define __GOP_RING_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "video_common.hpp"
+
+namespace cnstream {
+
+namespace video {
+
+// An encoded packet owning its data, shared by the ring and the clips being written
+struct StoredPacket {
+  std::vector<uint8_t> data;
+  int64_t pts, dts;
+  uint32_t flags;
+
+  explicit StoredPacket(const VideoPacket &packet)
+      : data(packet.data, packet.data + packet.size), pts(packet.pts), dts(packet.dts), flags(packet.flags) {}
+
+  VideoPacket ToVideoPacket() const {
+    VideoPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.data = const_cast<uint8_t *>(data.data());
+    packet.size = static_cast<uint32_t>(data.size());
+    packet.pts = pts;
+    packet.dts = dts;
+    packet.flags = flags;
+    return packet;
+  }
+};
+
+using StoredPacketPtr = std::shared_ptr<const StoredPacket>;
+
+/**
+ * GopRing keeps the latest encoded packets of a stream in whole GOPs, so that a clip read out of it always starts at a
+ * key frame. The oldest GOP is dropped once the remaining ones still cover duration (in pts units), or the ring holds
+ * more than max_bytes. The latest GOP is never dropped.
+ */
+class GopRing {
+ public:
+  GopRing(int64_t duration, size_t max_bytes) : duration_(duration), max_bytes_(max_bytes) {}
+
+  // Returns false if the packet is dropped, which happens until the first key frame
+  bool Push(StoredPacketPtr packet) {
+    if (packet->flags & VideoPacket::KEY) {
+      gops_.emplace_back();
+      gops_.back().start_pts = packet->pts;
+    } else if (gops_.empty()) {
+      return false;
+    }
+    gops_.back().packets.push_back(packet);
+    bytes_ += packet->data.size();
+    last_pts_ = packet->pts;
+    while (gops_.size() > 1 && (gops_[1].start_pts <= last_pts_ - duration_ || bytes_ > max_bytes_)) {
+      for (const auto &it : gops_.front().packets) bytes_ -= it->data.size();
+      gops_.pop_front();
+    }
+    return true;
+  }
+
+  // Returns the packets from the start of the GOP containing pts, or from the oldest GOP if pts is older than it
+  std::vector<StoredPacketPtr> Since(int64_t pts) const {
+    std::vector<StoredPacketPtr> packets;
+    size_t first = 0;
+    for (size_t i = 1; i < gops_.size() && gops_[i].start_pts <= pts; ++i) first = i;
+    for (size_t i = first; i < gops_.size(); ++i) {
+      packets.insert(packets.end(), gops_[i].packets.begin(), gops_[i].packets.end());
+    }
+    return packets;
+  }
+
+  void Clear() {
+    gops_.clear();
+    bytes_ = 0;
+  }
+
+  size_t GetBytes() const { return bytes_; }
+  size_t GetGopCount() const { return gops_.size(); }
+  // the pts of the oldest key frame, INVALID_TIMESTAMP if the ring is empty
+  int64_t GetStartPts() const { return gops_.empty() ? INVALID_TIMESTAMP : gops_.front().start_pts; }
+  int64_t GetLastPts() const { return gops_.empty() ? INVALID_TIMESTAMP : last_pts_; }
+
+ private:
+  struct Gop {
+    int64_t start_pts = 0;
+    std::vector<StoredPacketPtr> packets;
+  };
+
+  int64_t duration_;
+  size_t max_bytes_;
+  std::deque<Gop> gops_;
+  size_t bytes_ = 0;
+  int64_t last_pts_ = 0;
+};  // class GopRing
+
+}  // namespace video
+
+}  // namespace cnstream
+
+#endif  // __GOP_RING_HPP__
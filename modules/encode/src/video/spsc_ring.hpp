@@ -0,0 +1,142 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef __SPSC_RING_HPP__
+#define __SPSC_RING_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace cnstream {
+
+namespace video {
+
+/**
+ * SpscRing is a wait-free ring of one producer thread and one consumer thread. The slots are written and read in
+ * place, so the data they own (e.g. packet payloads) is allocated once and reused. The capacity is rounded up to a
+ * power of 2.
+ *
+ * Producer: Back() gets the free slot, Push() publishes it. Consumer: Front() gets the oldest slot, Pop() frees it.
+ */
+template <typename T>
+class SpscRing {
+ public:
+  explicit SpscRing(size_t capacity) {
+    capacity_ = 1;
+    while (capacity_ < capacity) capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    slots_.reset(new T[capacity_]);
+  }
+
+  size_t Capacity() const { return capacity_; }
+  size_t Size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+  bool Empty() const { return Size() == 0; }
+
+  /* Returns the slot to write, or nullptr if the ring is full. Called by the producer. */
+  T *Back() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == capacity_) return nullptr;
+    return &slots_[tail & mask_];
+  }
+  void Push() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+  bool TryPush(const T &value) {
+    T *slot = Back();
+    if (!slot) return false;
+    *slot = value;
+    Push();
+    return true;
+  }
+
+  /* Returns the slot to read, or nullptr if the ring is empty. Called by the consumer. */
+  T *Front() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (tail_.load(std::memory_order_acquire) == head) return nullptr;
+    return &slots_[head & mask_];
+  }
+  void Pop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+  bool TryPop(T *value) {
+    T *slot = Front();
+    if (!slot) return false;
+    *value = *slot;
+    Pop();
+    return true;
+  }
+
+ private:
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  static constexpr size_t kCacheLine = 64;
+  // head_ and tail_ are written by different threads, keep them in different cache lines
+  std::atomic<size_t> head_{0};
+  char head_pad_[kCacheLine - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> tail_{0};
+  char tail_pad_[kCacheLine - sizeof(std::atomic<size_t>)];
+  size_t capacity_;
+  size_t mask_;
+  std::unique_ptr<T[]> slots_;
+};  // SpscRing
+
+/**
+ * RingSignal lets a thread sleep until a ring is ready, e.g. the consumer of an empty ring. Notify() takes the lock
+ * only if a thread is sleeping, so the ring operations stay lock-free while both sides keep up.
+ */
+class RingSignal {
+ public:
+  /* timeout_ms: <0: wait infinitely; >=0: milliseconds of timeout. Returns pred() at the end. */
+  template <typename Predicate>
+  bool Wait(Predicate pred, int timeout_ms = -1) {
+    if (pred()) return true;
+    std::unique_lock<std::mutex> lk(mtx_);
+    waiters_.fetch_add(1);
+    // pairs with the fence in Notify(), either the waiter sees the change or the notifier sees the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ret = true;
+    if (timeout_ms < 0) {
+      cv_.wait(lk, pred);
+    } else {
+      ret = cv_.wait_for(lk, std::chrono::milliseconds(timeout_ms), pred);
+    }
+    waiters_.fetch_sub(1);
+    return ret;
+  }
+
+  void Notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) return;
+    { std::lock_guard<std::mutex> lk(mtx_); }
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::atomic<int> waiters_{0};
+};  // RingSignal
+
+}  // namespace video
+
+}  // namespace cnstream
+
+#endif  // __SPSC_RING_HPP__
@@ -88,6 +88,13 @@ struct VideoPacket {
   void SetFormat(VideoPixelFormat f) { flags |= (f << RAW_FORMAT_SHIFT); }
 };
 
+struct VideoRoi {
+  /// the region normalized to [0, 1] of the frame width and height
+  float x, y, w, h;
+  /// qp offset of the region, negative for higher quality
+  int qp_offset;
+};
+
 struct VideoFrame {
   /// width and height of the frame
   uint32_t width, height;
@@ -103,6 +110,9 @@ struct VideoFrame {
   uint32_t flags;
   /// user data
   void *user_data;
+  /// regions of interest, valid during SendFrame. The first region containing an area applies to it
+  const VideoRoi *rois;
+  uint32_t roi_num;
 
   enum Flags {
     /// end of stream
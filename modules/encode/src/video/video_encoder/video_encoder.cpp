@@ -21,7 +21,9 @@
 
 #include <cnrt.h>
 
+#include <algorithm>
 #include <string>
+#include <thread>
 
 #include "cnstream_logging.hpp"
 
@@ -118,8 +120,51 @@ int VideoEncoder::GetPacket(VideoPacket *packet, PacketInfo *info) {
   return ERROR_FAILED;
 }
 
+int VideoEncoder::SetBitRate(uint32_t bit_rate) {
+  if (encoder_) return encoder_->SetBitRate(bit_rate);
+  return ERROR_FAILED;
+}
+
 void VideoEncoder::SetEventCallback(EventCallback func) {
   if (encoder_) encoder_->SetEventCallback(func);
 }
 
+constexpr int EncodeThreadBudget::kMaxThreadsPerEncoder;
+
+EncodeThreadBudget& EncodeThreadBudget::Instance() {
+  static EncodeThreadBudget budget;
+  return budget;
+}
+
+void EncodeThreadBudget::SetTotal(int total) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  total_ = total > 0 ? total : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+int EncodeThreadBudget::GetTotal() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return total_;
+}
+
+int EncodeThreadBudget::Acquire() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  // the encoders started later get less when the budget is used up, but one thread at least
+  const int share = std::min(total_ / (encoders_ + 1), total_ - used_);
+  const int threads = std::max(1, std::min(share, kMaxThreadsPerEncoder));
+  used_ += threads;
+  ++encoders_;
+  return threads;
+}
+
+void EncodeThreadBudget::Release(int threads) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  used_ -= threads;
+  --encoders_;
+}
+
+bool EncodeThreadBudget::IsOverloaded() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return encoders_ >= total_;
+}
+
 }  // namespace cnstream
@@ -22,6 +22,8 @@
 #define __VIDEO_ENCODER_H__
 
 #include <functional>
+#include <mutex>
+#include <string>
 
 #include "../video_common.hpp"
 
@@ -51,6 +53,13 @@ class VideoEncoder {
     uint32_t input_buffer_count = 6;
     uint32_t output_buffer_size = 0x100000;
     int mlu_device_id = -1;
+    // no B frames and no lookahead, so that each frame is output once it is encoded
+    bool low_latency = false;
+    // options of the FFmpeg encoders, the MLU encoders ignore them
+    std::string preset = "superfast";  // x264/x265 preset
+    std::string tune = "zerolatency";  // x264/x265 tune, empty for none
+    std::string rate_control = "abr";  // "abr", "cbr" or "crf"
+    uint32_t crf = 23;                 // constant rate factor of "crf" rate control, bit_rate is ignored
   };
 
   struct PacketInfo {
@@ -85,6 +94,8 @@ class VideoEncoder {
   int RequestFrameBuffer(VideoFrame *frame, int timeout_ms = -1);
   int SendFrame(const VideoFrame *frame, int timeout_ms = -1);
   int GetPacket(VideoPacket *packet, PacketInfo *info = nullptr);
+  /* changes the target bit rate while encoding, returns ERROR_FAILED if the encoder does not support it */
+  int SetBitRate(uint32_t bit_rate);
 
   void SetEventCallback(EventCallback func);
 
@@ -92,6 +103,30 @@ class VideoEncoder {
   video::VideoEncoderBase *encoder_ = nullptr;
 };  // VideoEncoder
 
+/**
+ * The threads of the FFmpeg encoders of the process. Each encoder takes a fair share of the budget when it is
+ * started, at least one thread, and gives it back when it is stopped.
+ */
+class EncodeThreadBudget {
+ public:
+  static EncodeThreadBudget& Instance();
+  explicit EncodeThreadBudget(int total = 0) { SetTotal(total); }
+  // 0 means the number of cpu cores
+  void SetTotal(int total);
+  int GetTotal() const;
+  int Acquire();
+  void Release(int threads);
+  // there are no fewer encoders than threads, an encoder started now gets a thread shared with others
+  bool IsOverloaded() const;
+
+ private:
+  static constexpr int kMaxThreadsPerEncoder = 8;
+  mutable std::mutex mutex_;
+  int total_ = 1;
+  int used_ = 0;
+  int encoders_ = 0;
+};
+
 }  // namespace cnstream
 
 #endif  // __VIDEO_ENCODER_H__
@@ -20,36 +20,28 @@
 
 #include "video_encoder_base.hpp"
 
+#include <cstring>
+
 #include "cnstream_logging.hpp"
 
 namespace cnstream {
 
 namespace video {
 
+// packets queued at most, besides the bytes limited by output_buffer_size
+static constexpr size_t kOutputPacketCount = 64;
+
 VideoEncoderBase::VideoEncoderBase(const Param &param) : param_(param) {
   if (param_.output_buffer_size < 0x80000) {
     LOGW(VideoEncoderBase) << "VideoEncoderBase() output buffer size must no fewer than 512K bytes";
     param_.output_buffer_size = 0x80000;
   }
-  output_buffer_ = new (std::nothrow) CircularBuffer(param_.output_buffer_size);
-  memset(&truncated_packet_, 0, sizeof(VideoPacket));
-  truncated_buffer_size_ = 0;
-  truncated_size_ = 0;
-  memset(&truncated_info_, 0, sizeof(PacketInfo));
+  output_ring_.reset(new (std::nothrow) SpscRing<OutputSlot>(kOutputPacketCount));
+  memset(&front_info_, 0, sizeof(PacketInfo));
 }
 
 VideoEncoderBase::~VideoEncoderBase() {
-  if (output_buffer_) {
-    delete output_buffer_;
-    output_buffer_ = nullptr;
-  }
-  if (truncated_packet_.data) {
-    delete[] truncated_packet_.data;
-  }
-  memset(&truncated_packet_, 0, sizeof(VideoPacket));
-  truncated_buffer_size_ = 0;
-  truncated_size_ = 0;
-  memset(&truncated_info_, 0, sizeof(PacketInfo));
+  output_ring_.reset();
 }
 
 int VideoEncoderBase::Start() {
@@ -65,154 +57,94 @@ int VideoEncoderBase::Stop() {
 }
 
 bool VideoEncoderBase::PushBuffer(IndexedVideoPacket *packet) {
-  if (state_ != RUNNING || !output_buffer_) return false;
+  if (state_ != RUNNING || !output_ring_) return false;
 
   if (!packet || !packet->packet.data || packet->packet.size <= 0) {
     LOGE(VideoEncoderBase) << "PushBuffer() invalid parameters.";
     return false;
   }
 
-  std::unique_lock<std::mutex> lk(output_mtx_);
-  size_t push_size = packet->packet.size + sizeof(IndexedVideoPacket);
-  output_cv_.wait(
-      lk, [&] { return (state_ != RUNNING || (output_buffer_->Capacity() - output_buffer_->Size()) >= push_size); });
+  const size_t size = packet->packet.size;
+  OutputSlot *slot = nullptr;
+  // a packet larger than the whole buffer is still queued once the ring is empty
+  auto ready = [&]() {
+    if (state_ != RUNNING) return true;
+    slot = output_ring_->Back();
+    return slot && (output_size_ + size <= param_.output_buffer_size || output_ring_->Empty());
+  };
+  // the stop is polled, for the derived encoders change the state without notifying the signal
+  while (!output_signal_.Wait(ready, 100)) {}
   if (state_ != RUNNING) return false;
 
-  size_t written_size = output_buffer_->Write(reinterpret_cast<uint8_t *>(packet), sizeof(IndexedVideoPacket));
-  written_size += output_buffer_->Write(packet->packet.data, packet->packet.size);
+  if (slot->payload_size < size) {
+    slot->payload.reset(new (std::nothrow) uint8_t[size]);
+    slot->payload_size = slot->payload ? size : 0;
+    if (!slot->payload) {
+      LOGE(VideoEncoderBase) << "PushBuffer() alloc payload buffer failed, size=" << size;
+      return false;
+    }
+  }
+  memcpy(slot->payload.get(), packet->packet.data, size);
+  slot->vpacket = *packet;
+  slot->vpacket.packet.data = slot->payload.get();
+  output_size_ += size;
+  output_ring_->Push();
+  return true;
+}
 
-  return (written_size == push_size);
+void VideoEncoderBase::PopPacket(OutputSlot *slot) {
+  output_size_ -= slot->vpacket.packet.size;
+  read_offset_ = 0;
+  memset(&front_info_, 0, sizeof(PacketInfo));
+  output_ring_->Pop();
+  output_signal_.Notify();
 }
 
 int VideoEncoderBase::GetPacket(VideoPacket *packet, PacketInfo *info) {
   if (state_ != RUNNING) return cnstream::VideoEncoder::ERROR_STATE;
-  if (!output_buffer_) return cnstream::VideoEncoder::ERROR_FAILED;
+  if (!output_ring_) return cnstream::VideoEncoder::ERROR_FAILED;
 
+  OutputSlot *slot = output_ring_->Front();
+  if (!slot) return 0;
+  const VideoPacket &front = slot->vpacket.packet;
+  const int remaining = front.size - read_offset_;
   int ret = -1;
-  IndexedVideoPacket vpacket;
 
-  std::unique_lock<std::mutex> lk(output_mtx_);
-  if (truncated_size_ == 0) {
-    if (output_buffer_->Size() <= sizeof(IndexedVideoPacket)) return 0;
-    output_buffer_->Read(reinterpret_cast<uint8_t *>(&vpacket), sizeof(IndexedVideoPacket), true);
-  }
   if (!packet) {
     /* skip packet */
-    if (truncated_size_ > 0) {
-      ret = truncated_size_;
-      truncated_size_ = 0;
-      memset(&truncated_info_, 0, sizeof(PacketInfo));
-      if (info) {
-        memset(info, 0, sizeof(PacketInfo));
-        info->buffer_size = output_buffer_->Size();
-        info->buffer_capacity = output_buffer_->Capacity();
-      }
-    } else {
-      output_buffer_->Read(nullptr, sizeof(IndexedVideoPacket) + vpacket.packet.size);
-      ret = vpacket.packet.size;
-      if (info) {
-        GetPacketInfo(vpacket.index, info);
-        info->buffer_size = output_buffer_->Size();
-        info->buffer_capacity = output_buffer_->Capacity();
-      } else {
-        PacketInfo pi;
-        GetPacketInfo(vpacket.index, &pi);
-      }
-      lk.unlock();
-      output_cv_.notify_one();
+    ret = remaining;
+    if (info) memset(info, 0, sizeof(PacketInfo));
+    if (read_offset_ == 0) {
+      PacketInfo pi;
+      GetPacketInfo(slot->vpacket.index, info ? info : &pi);
     }
+    PopPacket(slot);
   } else if (!packet->data) {
     /* get packet size */
-    if (info) {
-      memset(info, 0, sizeof(PacketInfo));
-      info->buffer_size = output_buffer_->Size();
-      info->buffer_capacity = output_buffer_->Capacity();
-    }
-    if (truncated_size_ > 0) {
-      packet->size = truncated_size_;
-      packet->pts = truncated_packet_.pts;
-      packet->dts = truncated_packet_.dts;
-      packet->flags = truncated_packet_.flags;
-      packet->user_data = truncated_packet_.user_data;
-      return truncated_size_;
-    } else {
-      packet->size = vpacket.packet.size;
-      packet->pts = vpacket.packet.pts;
-      packet->dts = vpacket.packet.dts;
-      packet->flags = vpacket.packet.flags;
-      packet->user_data = vpacket.packet.user_data;
-      return vpacket.packet.size;
-    }
+    if (info) memset(info, 0, sizeof(PacketInfo));
+    packet->size = remaining;
+    packet->pts = front.pts;
+    packet->dts = front.dts;
+    packet->flags = front.flags;
+    packet->user_data = front.user_data;
+    ret = remaining;
   } else {
     /* read out packet data */
-    if (truncated_size_ > 0) {
-      packet->pts = truncated_packet_.pts;
-      packet->dts = truncated_packet_.dts;
-      packet->flags = truncated_packet_.flags;
-      packet->user_data = truncated_packet_.user_data;
-      if (info) {
-        memcpy(info, &truncated_info_, sizeof(PacketInfo));
-        info->buffer_size = output_buffer_->Size();
-        info->buffer_capacity = output_buffer_->Capacity();
-      }
-      if (packet->size < truncated_size_) {
-        memcpy(packet->data, truncated_packet_.data + truncated_packet_.size - truncated_size_, packet->size);
-        truncated_size_ -= packet->size;
-        ret = packet->size;
-      } else {
-        packet->size = truncated_size_;
-        memcpy(packet->data, truncated_packet_.data + truncated_packet_.size - truncated_size_, truncated_size_);
-        ret = truncated_size_;
-        truncated_size_ = 0;
-        memset(&truncated_info_, 0, sizeof(PacketInfo));
-      }
-    } else if (packet->size < vpacket.packet.size) {
-      output_buffer_->Read(reinterpret_cast<uint8_t *>(&vpacket), sizeof(IndexedVideoPacket));
-      if (truncated_buffer_size_ < vpacket.packet.size) {
-        if (truncated_packet_.data) delete[] truncated_packet_.data;
-        truncated_packet_.data = new (std::nothrow) uint8_t[vpacket.packet.size];
-        truncated_buffer_size_ = vpacket.packet.size;
-      }
-      truncated_packet_.size = vpacket.packet.size;
-      truncated_packet_.pts = vpacket.packet.pts;
-      truncated_packet_.dts = vpacket.packet.dts;
-      truncated_packet_.flags = vpacket.packet.flags;
-      truncated_packet_.user_data = vpacket.packet.user_data;
-      output_buffer_->Read(truncated_packet_.data, vpacket.packet.size);
-      packet->pts = truncated_packet_.pts;
-      packet->dts = truncated_packet_.dts;
-      packet->flags = truncated_packet_.flags;
-      packet->user_data = truncated_packet_.user_data;
-      memcpy(packet->data, truncated_packet_.data, packet->size);
-      truncated_size_ = vpacket.packet.size - packet->size;
-      ret = packet->size;
-      GetPacketInfo(vpacket.index, &truncated_info_);
-      if (info) {
-        memcpy(info, &truncated_info_, sizeof(PacketInfo));
-        info->buffer_size = output_buffer_->Size();
-        info->buffer_capacity = output_buffer_->Capacity();
-      }
-      lk.unlock();
-      output_cv_.notify_one();
-    } else {
-      output_buffer_->Read(reinterpret_cast<uint8_t *>(&vpacket), sizeof(IndexedVideoPacket));
-      packet->size = vpacket.packet.size;
-      packet->pts = vpacket.packet.pts;
-      packet->dts = vpacket.packet.dts;
-      packet->flags = vpacket.packet.flags;
-      packet->user_data = vpacket.packet.user_data;
-      ret = output_buffer_->Read(packet->data, packet->size);
-      if (info) {
-        GetPacketInfo(vpacket.index, info);
-        info->buffer_size = output_buffer_->Size();
-        info->buffer_capacity = output_buffer_->Capacity();
-      } else {
-        PacketInfo pi;
-        GetPacketInfo(vpacket.index, &pi);
-      }
-      lk.unlock();
-      output_cv_.notify_one();
-    }
+    if (read_offset_ == 0) GetPacketInfo(slot->vpacket.index, &front_info_);
+    packet->pts = front.pts;
+    packet->dts = front.dts;
+    packet->flags = front.flags;
+    packet->user_data = front.user_data;
+    if (static_cast<int>(packet->size) > remaining) packet->size = remaining;
+    memcpy(packet->data, front.data + read_offset_, packet->size);
+    ret = packet->size;
+    if (info) memcpy(info, &front_info_, sizeof(PacketInfo));
+    read_offset_ += packet->size;
+    if (read_offset_ == front.size) PopPacket(slot);
+  }
+  if (info) {
+    info->buffer_size = output_size_;
+    info->buffer_capacity = param_.output_buffer_size;
   }
   return ret;
 }
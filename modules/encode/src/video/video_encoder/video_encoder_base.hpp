@@ -22,11 +22,11 @@
 #define __VIDEO_ENCODER_BASE_H__
 
 #include <atomic>
-#include <condition_variable>
+#include <memory>
 #include <mutex>
 
 #include "../rw_mutex.hpp"
-#include "../circular_buffer.hpp"
+#include "../spsc_ring.hpp"
 #include "video_encoder.hpp"
 
 namespace cnstream {
@@ -54,6 +54,7 @@ class VideoEncoderBase {
   virtual int RequestFrameBuffer(VideoFrame *frame, int timeout_ms = -1) = 0;
   virtual int SendFrame(const VideoFrame *frame, int timeout_ms = -1) = 0;
   virtual int GetPacket(VideoPacket *packet, PacketInfo *info = nullptr);
+  virtual int SetBitRate(uint32_t bit_rate) { return cnstream::VideoEncoder::ERROR_FAILED; }
 
   void SetEventCallback(EventCallback func) {
     std::lock_guard<std::mutex> lk(cb_mtx_);
@@ -68,6 +69,7 @@ class VideoEncoderBase {
     STOPPING,
   };
 
+  /* Called by the encoder thread only, waits while the output ring is full. */
   bool PushBuffer(IndexedVideoPacket *packet);
   virtual bool GetPacketInfo(int64_t index, PacketInfo *info) = 0;
 
@@ -78,13 +80,21 @@ class VideoEncoderBase {
   EventCallback event_callback_ = nullptr;
 
  private:
-  std::mutex output_mtx_;
-  std::condition_variable output_cv_;
-  CircularBuffer *output_buffer_ = nullptr;
-  VideoPacket truncated_packet_;
-  size_t truncated_buffer_size_ = 0;
-  size_t truncated_size_ = 0;
-  PacketInfo truncated_info_;
+  // an encoded packet with its payload, the payload buffer is kept in the slot and reused by the later packets
+  struct OutputSlot {
+    IndexedVideoPacket vpacket;
+    std::unique_ptr<uint8_t[]> payload;
+    size_t payload_size = 0;
+  };
+  void PopPacket(OutputSlot *slot);
+
+  // packets are pushed by the encoder thread and got by the consumer (one thread at a time) without locks
+  std::unique_ptr<SpscRing<OutputSlot>> output_ring_;
+  RingSignal output_signal_;  // wakes the encoder thread waiting for a free slot
+  std::atomic<size_t> output_size_{0};  // bytes of the packets in the ring, no more than output_buffer_size
+  // the front packet is read out in pieces if the buffer of the consumer is too small
+  size_t read_offset_ = 0;
+  PacketInfo front_info_;
 };  // VideoEncoderBase
 
 }  // namespace video
@@ -22,10 +22,10 @@
 
 #include <algorithm>
 #include <chrono>
-#include <condition_variable>
+#include <cstring>
 #include <list>
 #include <mutex>
-#include <queue>
+#include <string>
 #include <thread>
 #include <unordered_map>
 
@@ -46,6 +46,7 @@ static const char *ct_str[] = {"H264", "H265", "MPEG4", "JPEG"};
 #define SPECIFIC_CODEC
 
 #define VERSION_LAVC_ALLOC_PACKET AV_VERSION_INT(57, 20, 102)
+#define VERSION_LAVU_FRAME_ROI AV_VERSION_INT(56, 25, 100)
 
 struct EncodingInfo {
   int64_t pts, dts;
@@ -55,21 +56,24 @@ struct EncodingInfo {
 
 struct VideoEncoderFFmpegPrivate {
   std::thread thread;
-  std::mutex input_mtx;
-  std::condition_variable data_cv;
-  std::condition_variable free_cv;
-  std::queue<AVFrame *> data_q;
-  std::queue<AVFrame *> free_q;
+  // frames are sent by the pipeline thread (one at a time) to the encoder thread through data_ring, and given back
+  // through free_ring, neither side takes a lock unless it has to sleep
+  std::unique_ptr<SpscRing<AVFrame *>> data_ring;
+  std::unique_ptr<SpscRing<AVFrame *>> free_ring;
+  RingSignal data_signal;  // wakes the encoder thread
+  RingSignal free_signal;  // wakes the pipeline thread waiting for a frame buffer
+  uint32_t frame_buffer_count = 0;  // frame buffers allocated, by the pipeline thread
   std::list<AVFrame *> list;
   std::mutex info_mtx;
   std::unordered_map<int64_t, EncodingInfo> encoding_info;
   std::atomic<bool> eos_got{false};
   std::atomic<bool> eos_sent{false};
-  std::atomic<bool> encoding{false};
   int64_t frame_count = 0;
   int64_t packet_count = 0;
   int64_t data_index = 0;
   uint32_t input_alignment = 32;
+  std::atomic<uint32_t> bit_rate{0};  // target bit rate set while encoding, applied before the next frame
+  int threads = 0;  // taken from EncodeThreadBudget
 
   ::AVPixelFormat pixel_format = AV_PIX_FMT_YUV420P;
   ::AVCodecID codec_id = AV_CODEC_ID_H264;
@@ -81,6 +85,46 @@ struct VideoEncoderFFmpegPrivate {
   SwsContext *sws_ctx = nullptr;
 };
 
+static inline void ReleaseFrame(VideoEncoderFFmpegPrivate *priv, AVFrame *frame) {
+  // never full, the ring holds all frame buffers
+  priv->free_ring->TryPush(frame);
+  priv->free_signal.Notify();
+}
+
+// attaches the regions of interest as frame side data, libx264/libx265 turn them into the qp offsets of the blocks.
+// The frame buffers are reused, so the regions of the last use are removed first.
+static void SetFrameRois(AVFrame *avframe, const VideoFrame *frame) {
+#if LIBAVUTIL_VERSION_INT >= VERSION_LAVU_FRAME_ROI
+  av_frame_remove_side_data(avframe, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+  if (!frame->rois || !frame->roi_num) return;
+  AVFrameSideData *sd = av_frame_new_side_data(avframe, AV_FRAME_DATA_REGIONS_OF_INTEREST,
+                                               frame->roi_num * sizeof(AVRegionOfInterest));
+  if (!sd) return;
+  auto clip = [](float v) { return std::max(0.0f, std::min(v, 1.0f)); };
+  AVRegionOfInterest *rois = reinterpret_cast<AVRegionOfInterest *>(sd->data);
+  for (uint32_t i = 0; i < frame->roi_num; ++i) {
+    const VideoRoi &roi = frame->rois[i];
+    rois[i].self_size = sizeof(AVRegionOfInterest);
+    rois[i].left = clip(roi.x) * avframe->width;
+    rois[i].right = clip(roi.x + roi.w) * avframe->width;
+    rois[i].top = clip(roi.y) * avframe->height;
+    rois[i].bottom = clip(roi.y + roi.h) * avframe->height;
+    // the offset is a fraction of the qp range, which is 51 for 8 bit encoding
+    rois[i].qoffset = av_make_q(std::max(-51, std::min(roi.qp_offset, 51)), 51);
+  }
+#endif
+}
+
+static void CopyFrameRois(AVFrame *dst, const AVFrame *src) {
+#if LIBAVUTIL_VERSION_INT >= VERSION_LAVU_FRAME_ROI
+  av_frame_remove_side_data(dst, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+  AVFrameSideData *sd = av_frame_get_side_data(src, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+  if (!sd) return;
+  AVFrameSideData *dst_sd = av_frame_new_side_data(dst, AV_FRAME_DATA_REGIONS_OF_INTEREST, sd->size);
+  if (dst_sd) memcpy(dst_sd->data, sd->data, sd->size);
+#endif
+}
+
 static inline int64_t CurrentTick() {
   return std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::steady_clock::now().time_since_epoch()).count();
@@ -114,6 +158,10 @@ int VideoEncoderFFmpeg::Start() {
     param_.input_buffer_count = 3;
   }
 
+  priv_->data_ring.reset(new SpscRing<AVFrame *>(param_.input_buffer_count));
+  priv_->free_ring.reset(new SpscRing<AVFrame *>(param_.input_buffer_count));
+  priv_->frame_buffer_count = 0;
+
   param_.width = param_.width % 2 ? param_.width - 1 : param_.width;
   param_.height = param_.height % 2 ? param_.height - 1 : param_.height;
   param_.frame_rate = param_.frame_rate > 0 ? param_.frame_rate : 30;
@@ -121,6 +169,15 @@ int VideoEncoderFFmpeg::Start() {
   param_.time_base = param_.time_base > 0 ? param_.time_base : 1000;
   param_.bit_rate = param_.bit_rate < 0x40000 ? 0x40000 : param_.bit_rate;
   param_.gop_size = param_.gop_size < 8 ? 8 : param_.gop_size;
+  if (param_.rate_control != "abr" && param_.rate_control != "cbr" && param_.rate_control != "crf") {
+    LOGE(VideoEncoderFFmpeg) << "Start() unsupported rate control: " << param_.rate_control;
+    state_ = IDLE;
+    return cnstream::VideoEncoder::ERROR_PARAMETERS;
+  }
+  if (param_.low_latency && param_.tune.find("zerolatency") == std::string::npos) {
+    // zerolatency turns off the lookahead of x264/x265
+    param_.tune = param_.tune.empty() ? "zerolatency" : param_.tune + ",zerolatency";
+  }
 
   switch (param_.pixel_format) {
     case VideoPixelFormat::I420:
@@ -185,11 +242,31 @@ int VideoEncoderFFmpeg::Start() {
   priv_->codec_ctx->bit_rate = param_.bit_rate;
   priv_->codec_ctx->gop_size = param_.gop_size;
   priv_->codec_ctx->pix_fmt = priv_->codec_id == AV_CODEC_ID_MJPEG ? AV_PIX_FMT_YUVJ420P : AV_PIX_FMT_YUV420P;
-  priv_->codec_ctx->max_b_frames = priv_->codec_id == AV_CODEC_ID_MJPEG ? 0 : 1;
+  priv_->codec_ctx->max_b_frames = (priv_->codec_id == AV_CODEC_ID_MJPEG || param_.low_latency) ? 0 : 1;
+  priv_->threads = EncodeThreadBudget::Instance().Acquire();
+  priv_->codec_ctx->thread_count = priv_->threads;
+  // zerolatency encodes each frame at once, which leaves slice threads only
+  priv_->codec_ctx->thread_type =
+      param_.tune.find("zerolatency") != std::string::npos ? FF_THREAD_SLICE : FF_THREAD_FRAME | FF_THREAD_SLICE;
 
   if (!strcmp(priv_->codec->name, "libx264") || !strcmp(priv_->codec->name, "libx265")) {
-    av_dict_set(&priv_->opts, "preset", "superfast", 0);
-    av_dict_set(&priv_->opts, "tune", "zerolatency", 0);
+    if (!param_.preset.empty()) av_dict_set(&priv_->opts, "preset", param_.preset.c_str(), 0);
+    if (!param_.tune.empty()) av_dict_set(&priv_->opts, "tune", param_.tune.c_str(), 0);
+    if (param_.rate_control == "crf") {
+      priv_->codec_ctx->bit_rate = 0;
+      av_dict_set(&priv_->opts, "crf", std::to_string(param_.crf).c_str(), 0);
+    } else if (param_.rate_control == "cbr") {
+      // one second of vbv buffer
+      priv_->codec_ctx->rc_max_rate = param_.bit_rate;
+      priv_->codec_ctx->rc_min_rate = param_.bit_rate;
+      priv_->codec_ctx->rc_buffer_size = param_.bit_rate;
+      if (priv_->codec_id == AV_CODEC_ID_H264) {
+        av_dict_set(&priv_->opts, "nal-hrd", "cbr", 0);
+      } else {
+        std::string kbps = std::to_string(param_.bit_rate / 1000);
+        av_dict_set(&priv_->opts, "x265-params", ("vbv-maxrate=" + kbps + ":vbv-bufsize=" + kbps).c_str(), 0);
+      }
+    }
     if (priv_->codec_id == AV_CODEC_ID_H264) {
       av_dict_set(&priv_->opts, "profile", "high", 0);
       av_dict_set(&priv_->opts, "level", "5.1", 0);
@@ -205,6 +282,8 @@ int VideoEncoderFFmpeg::Start() {
     state_ = IDLE;
     return cnstream::VideoEncoder::ERROR_FAILED;
   }
+  LOGI(VideoEncoderFFmpeg) << "Start() " << priv_->codec->name << " opened, " << priv_->threads << " threads, preset="
+                           << param_.preset << ", tune=" << param_.tune << ", rate control=" << param_.rate_control;
 
   if (priv_->pixel_format != priv_->codec_ctx->pix_fmt &&
       !(priv_->pixel_format == AV_PIX_FMT_YUV420P && priv_->codec_ctx->pix_fmt == AV_PIX_FMT_YUVJ420P)) {
@@ -247,28 +326,17 @@ int VideoEncoderFFmpeg::Stop() {
     // LOGW(VideoEncoderFFmpeg) << "Stop() state != RUNNING";
     return cnstream::VideoEncoder::ERROR_STATE;
   }
-  std::unique_lock<std::mutex> lk(priv_->input_mtx);
   state_ = STOPPING;
-  lk.unlock();
   slk.Unlock();
 
-  priv_->free_cv.notify_all();
-  priv_->data_cv.notify_all();
+  priv_->free_signal.Notify();
+  priv_->data_signal.Notify();
   if (priv_->thread.joinable()) priv_->thread.join();
 
   slk.Lock();
-  lk.lock();
   AVFrame *frame;
-  while (!priv_->data_q.empty()) {
-    frame = priv_->data_q.front();
-    av_frame_free(&frame);
-    priv_->data_q.pop();
-  }
-  while (!priv_->free_q.empty()) {
-    frame = priv_->free_q.front();
-    av_frame_free(&frame);
-    priv_->free_q.pop();
-  }
+  while (priv_->data_ring->TryPop(&frame)) av_frame_free(&frame);
+  while (priv_->free_ring->TryPop(&frame)) av_frame_free(&frame);
   if (!priv_->list.empty()) {
     LOGW(VideoEncoderFFmpeg) << "Stop() " << priv_->list.size() << " frame buffers still outside";
     for (auto &frame : priv_->list) {
@@ -277,6 +345,7 @@ int VideoEncoderFFmpeg::Stop() {
     priv_->list.clear();
   }
 
+  priv_->frame_buffer_count = 0;
   Destroy();
   priv_->eos_got = priv_->eos_sent = false;
   state_ = IDLE;
@@ -296,42 +365,8 @@ int VideoEncoderFFmpeg::RequestFrameBuffer(VideoFrame *frame, int timeout_ms) {
   if (!frame) return cnstream::VideoEncoder::ERROR_PARAMETERS;
 
   AVFrame *avframe = nullptr;
-  std::unique_lock<std::mutex> lk(priv_->input_mtx);
-  if (!priv_->free_q.empty()) {
-    avframe = priv_->free_q.front();
-    priv_->free_q.pop();
-  } else {
-    uint32_t buffer_count = priv_->data_q.size() + (priv_->encoding ? 1 : 0);
-    if (buffer_count >= param_.input_buffer_count) {
-      if (timeout_ms == 0) {
-        return cnstream::VideoEncoder::ERROR_FAILED;
-      } else if (timeout_ms < 0) {
-        priv_->free_cv.wait(lk, [this]() { return (state_ != RUNNING || !priv_->free_q.empty()); });
-      } else {
-        if (false == priv_->free_cv.wait_for(lk, std::chrono::milliseconds(timeout_ms),
-                                             [this]() { return (state_ != RUNNING || !priv_->free_q.empty()); })) {
-          LOGW(VideoEncoderFFmpeg) << "RequestFrameBuffer() wait for " << timeout_ms << " ms timeout";
-          return cnstream::VideoEncoder::ERROR_TIMEOUT;
-        }
-      }
-      if (state_ != RUNNING) return cnstream::VideoEncoder::ERROR_STATE;
-      avframe = priv_->free_q.front();
-      priv_->free_q.pop();
-      // LOGI(VideoEncoderFFmpeg) << "RequestFrameBuffer() use allocated frame";
-    } else {
-      avframe = av_frame_alloc();
-      avframe->width = param_.width;
-      avframe->height = param_.height;
-      avframe->format = priv_->pixel_format;
-      int ret = av_frame_get_buffer(avframe, priv_->input_alignment);
-      if (ret < 0) {
-        LOGE(VideoEncoderFFmpeg) << "RequestFrameBuffer() av_frame_get_buffer failed, ret=" << ret;
-        av_frame_free(&avframe);
-        return cnstream::VideoEncoder::ERROR_FAILED;
-      }
-      // LOGI(VideoEncoderFFmpeg) << "RequestFrameBuffer() alloc new frame(" << total_buffer_count << ")";
-    }
-  }
+  int ret = GetFrameBuffer(&avframe, timeout_ms);
+  if (ret != cnstream::VideoEncoder::SUCCESS) return ret;
 
   frame->width        = avframe->width;
   frame->height       = avframe->height;
@@ -362,13 +397,12 @@ int VideoEncoderFFmpeg::SendFrame(const VideoFrame *frame, int timeout_ms) {
   if (!frame) return cnstream::VideoEncoder::ERROR_PARAMETERS;
 
   AVFrame *avframe = nullptr;
-  std::unique_lock<std::mutex> lk(priv_->input_mtx);
-  if (frame->HasEOS()) {
+  const bool eos = frame->HasEOS();
+  if (eos) {
     LOGI(VideoEncoderFFmpeg) << "SendFrame() Send EOS";
-    priv_->eos_got = true;
     if (!frame->data[0]) {
-      lk.unlock();
-      priv_->data_cv.notify_one();
+      priv_->eos_got = true;
+      priv_->data_signal.Notify();
       return cnstream::VideoEncoder::SUCCESS;
     }
   } else if (!frame->data[0]) {
@@ -390,42 +424,8 @@ int VideoEncoderFFmpeg::SendFrame(const VideoFrame *frame, int timeout_ms) {
     }
   }
   if (!avframe) {
-    if (!priv_->free_q.empty()) {
-      avframe = priv_->free_q.front();
-      priv_->free_q.pop();
-    } else {
-      uint32_t total_buffer_count = priv_->data_q.size() + (priv_->encoding ? 1 : 0);
-      if (total_buffer_count >= param_.input_buffer_count) {
-        if (timeout_ms == 0) {
-          return cnstream::VideoEncoder::ERROR_FAILED;
-        } else if (timeout_ms < 0) {
-          priv_->free_cv.wait(lk, [this]() { return (state_ != RUNNING || !priv_->free_q.empty()); });
-        } else {
-          if (false == priv_->free_cv.wait_for(lk, std::chrono::milliseconds(timeout_ms),
-                                               [this]() { return (state_ != RUNNING || !priv_->free_q.empty()); })) {
-            LOGW(VideoEncoderFFmpeg) << "SendFrame() wait for " << timeout_ms << " ms timeout";
-            return cnstream::VideoEncoder::ERROR_TIMEOUT;
-          }
-        }
-        if (state_ != RUNNING) return cnstream::VideoEncoder::ERROR_STATE;
-        avframe = priv_->free_q.front();
-        priv_->free_q.pop();
-        // LOGI(VideoEncoderFFmpeg) << "SendFrame() use allocated frame";
-      } else {
-        avframe = av_frame_alloc();
-        avframe->width = frame->width;
-        avframe->height = frame->height;
-        avframe->format = priv_->pixel_format;
-        int ret = av_frame_get_buffer(avframe, priv_->input_alignment);
-        if (ret < 0) {
-          LOGE(VideoEncoderFFmpeg) << "SendFrame() av_frame_get_buffer failed, ret=" << ret;
-          av_frame_free(&avframe);
-          return cnstream::VideoEncoder::ERROR_FAILED;
-        }
-        // LOGI(VideoEncoderFFmpeg) << "SendFrame() alloc new frame(" << total_buffer_count << ")";
-      }
-    }
-
+    int ret = GetFrameBuffer(&avframe, timeout_ms);
+    if (ret != cnstream::VideoEncoder::SUCCESS) return ret;
     const uint8_t *data[4] = { frame->data[0], frame->data[1], frame->data[2], nullptr };
     const int linesizes[4] = { static_cast<int>(frame->stride[0]), static_cast<int>(frame->stride[1]),
                                static_cast<int>(frame->stride[2]), 0 };
@@ -437,9 +437,12 @@ int VideoEncoderFFmpeg::SendFrame(const VideoFrame *frame, int timeout_ms) {
   avframe->pkt_pts = avframe->pts;
   avframe->pkt_dts = (frame->dts == INVALID_TIMESTAMP ? AV_NOPTS_VALUE : frame->dts);
   avframe->opaque = frame->user_data;
-  priv_->data_q.push(avframe);
-  lk.unlock();
-  priv_->data_cv.notify_one();
+  SetFrameRois(avframe, frame);
+  // never full, the ring holds all frame buffers
+  priv_->data_ring->TryPush(avframe);
+  // set after the frame is queued, the encoder thread flushes once it finds the ring empty with EOS got
+  if (eos) priv_->eos_got = true;
+  priv_->data_signal.Notify();
 
   LOGT(VideoEncoderFFmpeg) << "SendFrame() pts=" << frame->pts << ", dts=" << frame->dts;
   return cnstream::VideoEncoder::SUCCESS;
@@ -455,6 +458,47 @@ int VideoEncoderFFmpeg::GetPacket(VideoPacket *packet, PacketInfo *info) {
   return VideoEncoderBase::GetPacket(packet, info);
 }
 
+int VideoEncoderFFmpeg::SetBitRate(uint32_t bit_rate) {
+  ReadLockGuard slk(state_mtx_);
+  if (state_ != RUNNING) {
+    LOGW(VideoEncoderFFmpeg) << "SetBitRate() not running";
+    return cnstream::VideoEncoder::ERROR_STATE;
+  }
+  if (strcmp(priv_->codec->name, "libx264")) {
+    LOGW(VideoEncoderFFmpeg) << "SetBitRate() not supported by " << priv_->codec->name;
+    return cnstream::VideoEncoder::ERROR_FAILED;
+  }
+  priv_->bit_rate = bit_rate < 0x40000 ? 0x40000 : bit_rate;
+  return cnstream::VideoEncoder::SUCCESS;
+}
+
+int VideoEncoderFFmpeg::GetFrameBuffer(AVFrame **avframe, int timeout_ms) {
+  if (priv_->free_ring->TryPop(avframe)) return cnstream::VideoEncoder::SUCCESS;
+  if (priv_->frame_buffer_count < param_.input_buffer_count) {
+    AVFrame *frame = av_frame_alloc();
+    frame->width = param_.width;
+    frame->height = param_.height;
+    frame->format = priv_->pixel_format;
+    int ret = av_frame_get_buffer(frame, priv_->input_alignment);
+    if (ret < 0) {
+      LOGE(VideoEncoderFFmpeg) << "GetFrameBuffer() av_frame_get_buffer failed, ret=" << ret;
+      av_frame_free(&frame);
+      return cnstream::VideoEncoder::ERROR_FAILED;
+    }
+    priv_->frame_buffer_count++;
+    *avframe = frame;
+    return cnstream::VideoEncoder::SUCCESS;
+  }
+  if (timeout_ms == 0) return cnstream::VideoEncoder::ERROR_FAILED;
+  if (!priv_->free_signal.Wait([this]() { return (state_ != RUNNING || !priv_->free_ring->Empty()); },
+                               timeout_ms)) {
+    LOGW(VideoEncoderFFmpeg) << "GetFrameBuffer() wait for " << timeout_ms << " ms timeout";
+    return cnstream::VideoEncoder::ERROR_TIMEOUT;
+  }
+  if (state_ != RUNNING || !priv_->free_ring->TryPop(avframe)) return cnstream::VideoEncoder::ERROR_STATE;
+  return cnstream::VideoEncoder::SUCCESS;
+}
+
 bool VideoEncoderFFmpeg::GetPacketInfo(int64_t index, PacketInfo *info) {
   if (!info) return false;
 
@@ -492,6 +536,10 @@ void VideoEncoderFFmpeg::Destroy() {
     av_free(priv_->packet);
     priv_->packet = nullptr;
   }
+  if (priv_->threads) {
+    EncodeThreadBudget::Instance().Release(priv_->threads);
+    priv_->threads = 0;
+  }
 }
 
 void VideoEncoderFFmpeg::Loop() {
@@ -499,43 +547,30 @@ void VideoEncoderFFmpeg::Loop() {
   AVFrame *frame = nullptr;
 
   while (state_ == RUNNING) {
-    std::unique_lock<std::mutex> lk(priv_->input_mtx);
-    priv_->data_cv.wait(
-        lk, [this]() { return (state_ != RUNNING || !priv_->data_q.empty() || (priv_->eos_got && !priv_->eos_sent)); });
+    priv_->data_signal.Wait(
+        [this]() { return (state_ != RUNNING || !priv_->data_ring->Empty() || (priv_->eos_got && !priv_->eos_sent)); });
     if (state_ != RUNNING) break;
 
-    if (!priv_->data_q.empty()) {
-      frame = priv_->data_q.front();
-      priv_->data_q.pop();
-      priv_->encoding = true;
-      lk.unlock();
+    if (priv_->data_ring->TryPop(&frame)) {
       // Color convertion
       if (priv_->sws_ctx) {
         ret = sws_scale(priv_->sws_ctx, frame->data, frame->linesize, 0, frame->height, priv_->frame->data,
                         priv_->frame->linesize);
         if (ret < 0) {
           LOGE(VideoEncoderFFmpeg) << "Loop() sws_scale failed, ret=" << ret;
-          lk.lock();
-          priv_->free_q.push(frame);
-          priv_->encoding = false;
-          lk.unlock();
-          priv_->free_cv.notify_one();
+          ReleaseFrame(priv_.get(), frame);
           continue;
         }
         priv_->frame->pts = frame->pts;
         priv_->frame->pkt_pts = frame->pkt_pts;
         priv_->frame->pkt_dts = frame->pkt_dts;
-        lk.lock();
-        priv_->free_q.push(frame);
-        priv_->encoding = false;
-        lk.unlock();
-        priv_->free_cv.notify_one();
+        CopyFrameRois(priv_->frame, frame);
+        ReleaseFrame(priv_.get(), frame);
         frame = priv_->frame;
       }
     } else {
       if (priv_->eos_sent) break;
       frame = nullptr;
-      lk.unlock();
     }
 
     if (frame) {
@@ -554,6 +589,12 @@ void VideoEncoderFFmpeg::Loop() {
       frame->pts = priv_->data_index++;
       frame->pkt_pts = frame->pts;
       priv_->frame_count++;
+
+      uint32_t bit_rate = priv_->bit_rate.exchange(0);
+      if (bit_rate) {
+        // libx264 reconfigures the rate control when bit_rate changes
+        priv_->codec_ctx->bit_rate = bit_rate;
+      }
     }
 
     do {
@@ -563,13 +604,7 @@ void VideoEncoderFFmpeg::Loop() {
         LOGE(VideoEncoderFFmpeg) << "Loop() avcodec_encode_video2 failed, ret=" << ret;
         break;
       }
-      if (!priv_->sws_ctx && frame != nullptr) {
-        lk.lock();
-        priv_->free_q.push(frame);
-        priv_->encoding = false;
-        lk.unlock();
-        priv_->free_cv.notify_one();
-      }
+      if (!priv_->sws_ctx && frame != nullptr) ReleaseFrame(priv_.get(), frame);
       void *user_data = nullptr;
       if (!ret && got_packet && priv_->packet->size) {
         // find out packet and update encoding info
@@ -610,13 +645,13 @@ void VideoEncoderFFmpeg::Loop() {
         std::lock_guard<std::mutex> cblk(cb_mtx_);
         if (event_callback_) event_callback_(cnstream::VideoEncoder::EVENT_DATA);
       }
-      std::unique_lock<std::mutex> lk(priv_->input_mtx);
-      if (!priv_->data_q.empty() || !priv_->eos_got) {
+      // EOS is read before the ring, SendFrame queues the last frame before setting it
+      const bool eos_got = priv_->eos_got;
+      if (!eos_got || !priv_->data_ring->Empty()) {
         break;
       } else if (ret != 0 || !got_packet) {
         if (priv_->eos_sent) break;
         priv_->eos_sent = true;
-        lk.unlock();
         std::lock_guard<std::mutex> cblk(cb_mtx_);
         LOGI(VideoEncoderFFmpeg) << "Loop() Callback(EVENT_EOS)";
         if (event_callback_) event_callback_(cnstream::VideoEncoder::EVENT_EOS);
@@ -33,12 +33,10 @@ extern "C" {
 }
 #endif
 
-#include <condition_variable>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 
 #include "video_encoder_base.hpp"
@@ -65,11 +63,14 @@ class VideoEncoderFFmpeg : public VideoEncoderBase {
   int RequestFrameBuffer(VideoFrame *frame, int timeout_ms = -1) override;
   int SendFrame(const VideoFrame *frame, int timeout_ms = -1) override;
   int GetPacket(VideoPacket *packet, PacketInfo *info = nullptr) override;
+  int SetBitRate(uint32_t bit_rate) override;
 
  private:
   bool GetPacketInfo(int64_t index, PacketInfo *info) override;
   void Loop();
   void Destroy();
+  // gets a free frame buffer for the pipeline thread, waits for the encoder thread if all buffers are in use
+  int GetFrameBuffer(AVFrame **avframe, int timeout_ms);
 
   std::unique_ptr<VideoEncoderFFmpegPrivate> priv_;
 };  // VideoEncoderFFmpeg
@@ -252,18 +252,20 @@ int VideoEncoderMlu200::Start() {
       priv_->ve_param.uCfg.h264.level = CNVIDEOENC_LEVEL_H264_51;
       priv_->ve_param.uCfg.h264.insertSpsPpsWhenIDR = 1;
       priv_->ve_param.uCfg.h264.IframeInterval = param_.gop_size;
-      priv_->ve_param.uCfg.h264.BFramesNum = 1;
+      priv_->ve_param.uCfg.h264.BFramesNum = param_.low_latency ? 0 : 1;
       priv_->ve_param.uCfg.h264.sliceMode = CNVIDEOENC_SLICE_MODE_SINGLE;
-      priv_->ve_param.uCfg.h264.gopType = CNVIDEOENC_GOP_TYPE_BIDIRECTIONAL;
+      priv_->ve_param.uCfg.h264.gopType =
+          param_.low_latency ? CNVIDEOENC_GOP_TYPE_LOW_DELAY : CNVIDEOENC_GOP_TYPE_BIDIRECTIONAL;
       priv_->ve_param.uCfg.h264.entropyMode = CNVIDEOENC_ENTROPY_MODE_CABAC;
     } else if (param_.codec_type == VideoCodecType::H265) {
       priv_->ve_param.uCfg.h265.profile = CNVIDEOENC_PROFILE_H265_MAIN;
       priv_->ve_param.uCfg.h265.level = CNVIDEOENC_LEVEL_H265_HIGH_51;
       priv_->ve_param.uCfg.h265.insertSpsPpsWhenIDR = 1;
       priv_->ve_param.uCfg.h265.IframeInterval = param_.gop_size;
-      priv_->ve_param.uCfg.h265.BFramesNum = 2;
+      priv_->ve_param.uCfg.h265.BFramesNum = param_.low_latency ? 0 : 2;
       priv_->ve_param.uCfg.h265.sliceMode = CNVIDEOENC_SLICE_MODE_SINGLE;
-      priv_->ve_param.uCfg.h265.gopType = CNVIDEOENC_GOP_TYPE_BIDIRECTIONAL;
+      priv_->ve_param.uCfg.h265.gopType =
+          param_.low_latency ? CNVIDEOENC_GOP_TYPE_LOW_DELAY : CNVIDEOENC_GOP_TYPE_BIDIRECTIONAL;
     }
 
     i32_t ret = cnvideoEncCreate(reinterpret_cast<cnvideoEncoder *>(&priv_->cn_encoder), EncoderEventCallback,
@@ -200,14 +200,15 @@ int VideoEncoderMlu300::Start() {
   if (param_.codec_type == VideoCodecType::H264) {
     priv_->cn_param.coding_attr.profile = CNCODEC_ENC_PROFILE_H264_HIGH;
     priv_->cn_param.coding_attr.level = CNCODEC_ENC_LEVEL_H264_51;
-    priv_->cn_param.coding_attr.frame_interval_p = 2;
+    // the interval of P frames, 1 for no B frames
+    priv_->cn_param.coding_attr.frame_interval_p = param_.low_latency ? 1 : 2;
     priv_->cn_param.coding_attr.codec_attr.h264_attr.enable_repeat_sps_pps = 1;
     priv_->cn_param.coding_attr.codec_attr.h264_attr.idr_period = param_.gop_size;
     priv_->cn_param.coding_attr.codec_attr.h264_attr.entropy_mode = CNCODEC_ENC_ENTROPY_MODE_CABAC;
   } else if (param_.codec_type == VideoCodecType::H265) {
     priv_->cn_param.coding_attr.profile = CNCODEC_ENC_PROFILE_HEVC_MAIN;
     priv_->cn_param.coding_attr.level = CNCODEC_ENC_LEVEL_HEVC_51;
-    priv_->cn_param.coding_attr.frame_interval_p = 3;
+    priv_->cn_param.coding_attr.frame_interval_p = param_.low_latency ? 1 : 3;
     priv_->cn_param.coding_attr.codec_attr.hevc_attr.enable_repeat_sps_pps = 1;
     priv_->cn_param.coding_attr.codec_attr.hevc_attr.idr_period = param_.gop_size;
     priv_->cn_param.coding_attr.codec_attr.hevc_attr.tier = CNCODEC_ENC_TIER_HEVC_HIGHT;
@@ -27,11 +27,24 @@ extern "C" {
 }
 #endif
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "cnstream_async_io.hpp"
 #include "cnstream_logging.hpp"
 
 #include "video_sink.hpp"
@@ -48,6 +61,7 @@ namespace video {
 class VideoSink {
  public:
   using Param = cnstream::VideoSink::Param;
+  using Statistics = cnstream::VideoSink::Statistics;
 
   explicit VideoSink(const cnstream::VideoSink::Param &param);
   ~VideoSink();
@@ -55,12 +69,29 @@ class VideoSink {
   int Start();
   int Stop();
   int Write(const VideoPacket *packet);
+  int GetStatistics(Statistics *statistics);
 
  private:
+  struct BufferedPacket {
+    std::vector<uint8_t> data;
+    int64_t pts, dts;
+    bool key_frame;
+  };
+
   bool IsKeyFrame(const uint8_t *data, int size, bool h264);
   bool ExtractPS(const uint8_t *data, int size, bool h264);
+  bool IsSegmented() const { return param_.segment_duration > 0 || param_.segment_size > 0; }
+  std::string GetSegmentFileName(uint32_t index) const;
+  int OpenSegment();
+  void CloseSegment();
+  void PrepareSegment(uint32_t index);
+  int WritePacket(const uint8_t *data, uint32_t size, int64_t pts, int64_t dts, bool key_frame);
+  void WriteLoop();
+  static int WriteCallback(void *opaque, uint8_t *buf, int buf_size);
+  static int64_t SeekCallback(void *opaque, int64_t offset, int whence);
 
   Param param_;
+  std::string format_;
   std::atomic<bool> started_{false};
   AVFormatContext *ctx_ = nullptr;
   AVPacket *packet_ = nullptr;
@@ -69,10 +100,35 @@ class VideoSink {
   uint8_t *ps_ = nullptr;
   uint32_t ps_size_ = 0;
   int64_t init_timestamp_ = 0;
+
+  // segments, the file of the next segment is opened and preallocated in advance
+  uint32_t segment_index_ = 0;
+  int fd_ = -1;
+  AsyncFileWriter writer_;  // writes fd_ without blocking the muxer
+  int next_fd_ = -1;
+  std::string next_file_name_;
+  uint64_t segment_bytes_ = 0;
+  int64_t segment_start_ = 0;      // timestamp of the first packet in the segment, in param_.time_base
+  int64_t segment_ts_offset_ = 0;  // subtracted from the timestamps in the segment, in the stream time base
+  bool fallocate_warned_ = false;
+
+  // packets are written by write_thread_ if param_.buffer_size is greater than 0
+  std::thread write_thread_;
+  std::mutex queue_mtx_;
+  std::condition_variable queue_cond_;
+  std::deque<BufferedPacket> queue_;
+  size_t queued_bytes_ = 0;
+  bool writing_ = false;
+  bool drop_to_key_frame_ = false;
+  Statistics stats_;  // guarded by queue_mtx_
 };
 
 #define VERSION_LAVC_ALLOC_PACKET AV_VERSION_INT(57, 20, 102)
 #define VERSION_LAVF_AVCPAR AV_VERSION_INT(57, 40, 100)
+#define VERSION_LAVF_AVIO_FREE AV_VERSION_INT(57, 80, 100)
+
+// muxers write through a large buffer, so that the disk is written in big chunks
+static constexpr int kIOBufferSize = 1 << 20;
 
 VideoSink::VideoSink(const Param &param) : param_(param) {
   av_register_all();
@@ -102,20 +158,176 @@ int VideoSink::Start() {
   }
   std::string ext_name = param_.file_name.substr(dot + 1);
   std::transform(ext_name.begin(), ext_name.end(), ext_name.begin(), ::tolower);
-  if (ext_name != "mp4" && ext_name != "mkv" && ext_name != "flv" && ext_name != "avi") {
+  if (ext_name != "mp4" && ext_name != "mkv" && ext_name != "flv" && ext_name != "avi" && ext_name != "ts") {
     LOGE(VideoSink) << "Start() unsupported file type \"" << param_.file_name << "\"";
     return cnstream::VideoSink::ERROR_PARAMETERS;
   }
-  if (ext_name != "mp4" && ext_name != "mkv" && param_.codec_type == VideoCodecType::H265) {
-    LOGE(VideoSink) << "Start() only mp4 and mkv support HEVC video";
+  if (ext_name != "mp4" && ext_name != "mkv" && ext_name != "ts" && param_.codec_type == VideoCodecType::H265) {
+    LOGE(VideoSink) << "Start() only mp4, mkv and ts support HEVC video";
     return cnstream::VideoSink::ERROR_PARAMETERS;
   }
-  std::string format = ext_name;
-  if (ext_name == "mkv") format = "matroska";
+  format_ = ext_name;
+  if (ext_name == "mkv") format_ = "matroska";
+  if (ext_name == "ts") format_ = "mpegts";
+
+  segment_index_ = 0;
+  frame_count_ = 0;
+  stats_ = Statistics();
+  int ret = OpenSegment();
+  if (ret != cnstream::VideoSink::SUCCESS) return ret;
+
+#if LIBAVCODEC_VERSION_INT < VERSION_LAVC_ALLOC_PACKET
+  packet_ = reinterpret_cast<AVPacket *>(av_mallocz(sizeof(AVPacket)));
+#else
+  packet_ = av_packet_alloc();
+#endif
+  av_init_packet(packet_);
+
+  if (param_.buffer_size > 0) {
+    writing_ = true;
+    drop_to_key_frame_ = false;
+    write_thread_ = std::thread(&VideoSink::WriteLoop, this);
+  }
+
+  started_ = true;
+  return cnstream::VideoSink::SUCCESS;
+}
+
+int VideoSink::Stop() {
+  if (!started_) return cnstream::VideoSink::SUCCESS;
+
+  if (write_thread_.joinable()) {
+    // the buffered packets are written before the thread exits
+    {
+      std::lock_guard<std::mutex> lk(queue_mtx_);
+      writing_ = false;
+    }
+    queue_cond_.notify_one();
+    write_thread_.join();
+  }
+
+  CloseSegment();
+  if (next_fd_ >= 0) {
+    close(next_fd_);
+    next_fd_ = -1;
+    unlink(next_file_name_.c_str());
+  }
+  if (packet_) {
+    av_packet_unref(packet_);
+    av_free(packet_);
+    packet_ = nullptr;
+  }
+  if (ps_) delete[] ps_;
+  ps_ = nullptr;
+  ps_size_ = 0;
+
+  LOGI(VideoSink) << "Stop() packets: " << stats_.packets << ", bytes: " << stats_.bytes
+                  << ", segments: " << stats_.segments << ", dropped packets: " << stats_.dropped_packets
+                  << ", max buffered bytes: " << stats_.max_buffered_bytes
+                  << ", max batch write time: " << stats_.max_write_time_us << "us";
 
-  avformat_alloc_output_context2(&ctx_, nullptr, format.c_str(), param_.file_name.c_str());
+  started_ = false;
+
+  return cnstream::VideoSink::SUCCESS;
+}
+
+int VideoSink::Write(const VideoPacket *packet) {
+  if (!started_) {
+    LOGE(VideoSink) << "Write() sink is stopped";
+    return cnstream::VideoSink::ERROR_STATE;
+  }
+  if (!packet || !packet->data || !packet->size) {
+    LOGE(VideoSink) << "Write() invalid parameters";
+    return cnstream::VideoSink::ERROR_PARAMETERS;
+  }
+
+  // bool key_frame = packet->IsKey();
+  bool key_frame = IsKeyFrame(packet->data, packet->size, param_.codec_type == VideoCodecType::H264);
+  if (param_.buffer_size == 0) {
+    return WritePacket(packet->data, packet->size, packet->pts, packet->dts, key_frame);
+  }
+
+  std::lock_guard<std::mutex> lk(queue_mtx_);
+  // the disk can not keep up, drop packets until the next key frame, the encoder is never blocked
+  if (key_frame && queued_bytes_ + packet->size <= param_.buffer_size) drop_to_key_frame_ = false;
+  if (drop_to_key_frame_ || queued_bytes_ + packet->size > param_.buffer_size) {
+    if (!drop_to_key_frame_) {
+      LOGW(VideoSink) << "Write() buffer is full, drop packets until the next key frame. buffered bytes: "
+                      << queued_bytes_;
+    }
+    drop_to_key_frame_ = true;
+    stats_.dropped_packets++;
+    return cnstream::VideoSink::SUCCESS;
+  }
+  BufferedPacket buffered;
+  buffered.data.assign(packet->data, packet->data + packet->size);
+  buffered.pts = packet->pts;
+  buffered.dts = packet->dts;
+  buffered.key_frame = key_frame;
+  queue_.push_back(std::move(buffered));
+  queued_bytes_ += packet->size;
+  stats_.max_buffered_bytes = std::max<uint64_t>(stats_.max_buffered_bytes, queued_bytes_);
+  queue_cond_.notify_one();
+  return cnstream::VideoSink::SUCCESS;
+}
+
+int VideoSink::GetStatistics(Statistics *statistics) {
+  if (!statistics) return cnstream::VideoSink::ERROR_PARAMETERS;
+  std::lock_guard<std::mutex> lk(queue_mtx_);
+  *statistics = stats_;
+  statistics->buffered_bytes = queued_bytes_;
+  return cnstream::VideoSink::SUCCESS;
+}
+
+void VideoSink::WriteLoop() {
+  std::deque<BufferedPacket> batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(queue_mtx_);
+      queue_cond_.wait(lk, [this] { return !queue_.empty() || !writing_; });
+      if (queue_.empty()) break;
+      batch.swap(queue_);
+    }
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (auto &packet : batch) {
+      WritePacket(packet.data.data(), packet.data.size(), packet.pts, packet.dts, packet.key_frame);
+      bytes += packet.data.size();
+    }
+    batch.clear();
+    uint64_t write_time_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lk(queue_mtx_);
+    queued_bytes_ -= bytes;
+    stats_.max_write_time_us = std::max(stats_.max_write_time_us, write_time_us);
+  }
+}
+
+std::string VideoSink::GetSegmentFileName(uint32_t index) const {
+  if (!IsSegmented()) return param_.file_name;
+  auto dot = param_.file_name.find_last_of(".");
+  return param_.file_name.substr(0, dot) + "_" + std::to_string(index) + param_.file_name.substr(dot);
+}
+
+void VideoSink::PrepareSegment(uint32_t index) {
+  next_file_name_ = GetSegmentFileName(index);
+  next_fd_ = open(next_file_name_.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+  if (next_fd_ < 0) return;  // opened again on rolling over, the error is reported then
+
+  uint64_t bytes = param_.segment_size;
+  if (!bytes && param_.bit_rate) bytes = static_cast<uint64_t>(param_.bit_rate) / 8 * param_.segment_duration * 5 / 4;
+  // the size of the file is not changed, the space left is released when the segment is closed
+  if (bytes && fallocate(next_fd_, FALLOC_FL_KEEP_SIZE, 0, bytes) != 0 && !fallocate_warned_) {
+    LOGW(VideoSink) << "PrepareSegment() fallocate \"" << next_file_name_ << "\" failed, errno=" << errno;
+    fallocate_warned_ = true;
+  }
+}
+
+int VideoSink::OpenSegment() {
+  std::string file_name = GetSegmentFileName(segment_index_);
+  avformat_alloc_output_context2(&ctx_, nullptr, format_.c_str(), file_name.c_str());
   if (!ctx_) {
-    LOGE(VideoSink) << "Start() avformat_alloc_output_context2 for \"" << ext_name << "\" failed";
+    LOGE(VideoSink) << "OpenSegment() avformat_alloc_output_context2 for \"" << format_ << "\" failed";
     return cnstream::VideoSink::ERROR_FAILED;
   }
 
@@ -123,13 +335,7 @@ int VideoSink::Start() {
   AVCodec *codec = avcodec_find_decoder(codec_id);
   AVStream *stream = avformat_new_stream(ctx_, codec);
   if (!stream) {
-    LOGE(VideoSink) << "Start() avformat_new_stream failed";
-    avformat_free_context(ctx_);
-    ctx_ = nullptr;
-    return cnstream::VideoSink::ERROR_FAILED;
-  }
-  if (!stream) {
-    LOGE(VideoSink) << "Start() avformat_new_stream failed";
+    LOGE(VideoSink) << "OpenSegment() avformat_new_stream failed";
     avformat_free_context(ctx_);
     ctx_ = nullptr;
     return cnstream::VideoSink::ERROR_FAILED;
@@ -147,6 +353,9 @@ int VideoSink::Start() {
   stream->codec->bit_rate = param_.bit_rate;
   stream->codec->gop_size = param_.gop_size;
   stream->codec->time_base = stream->time_base;
+  // parameter sets are known already if it is not the first segment
+  stream->codec->extradata = ps_;
+  stream->codec->extradata_size = ps_size_;
 #else
   stream->codecpar->codec_type = codec->type;
   stream->codecpar->codec_id = codec->id;
@@ -155,37 +364,46 @@ int VideoSink::Start() {
   stream->codecpar->width = param_.width;
   stream->codecpar->height = param_.height;
   stream->codecpar->bit_rate = param_.bit_rate;
+  stream->codecpar->extradata = ps_;
+  stream->codecpar->extradata_size = ps_size_;
 #endif
   if (!(ctx_->oformat->flags & AVFMT_NOFILE)) {
-    int ret = avio_open(&ctx_->pb, param_.file_name.c_str(), AVIO_FLAG_WRITE);
-    if (ret < 0) {
-      LOGE(VideoSink) << "Start() avio_open \"" << param_.file_name << "\" failed, ret=" << ret;
-      avformat_free_context(ctx_);
-      ctx_ = nullptr;
+    if (next_fd_ >= 0 && next_file_name_ == file_name) {
+      fd_ = next_fd_;
+      next_fd_ = -1;
+    } else {
+      fd_ = open(file_name.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    uint8_t *buffer = fd_ >= 0 && writer_.Open(fd_) ? reinterpret_cast<uint8_t *>(av_malloc(kIOBufferSize)) : nullptr;
+    if (buffer) {
+      ctx_->pb = avio_alloc_context(buffer, kIOBufferSize, 1, this, nullptr, &VideoSink::WriteCallback,
+                                    &VideoSink::SeekCallback);
+      if (!ctx_->pb) av_free(buffer);
+    }
+    if (!ctx_->pb) {
+      LOGE(VideoSink) << "OpenSegment() open \"" << file_name << "\" failed, errno=" << errno;
+      CloseSegment();
       return cnstream::VideoSink::ERROR_FAILED;
     }
   }
 
-  av_dump_format(ctx_, 0, param_.file_name.c_str(), 1);
+  av_dump_format(ctx_, 0, file_name.c_str(), 1);
 
-#if LIBAVCODEC_VERSION_INT < VERSION_LAVC_ALLOC_PACKET
-  packet_ = reinterpret_cast<AVPacket *>(av_mallocz(sizeof(AVPacket)));
-#else
-  packet_ = av_packet_alloc();
-#endif
-  av_init_packet(packet_);
-
-  started_ = true;
+  header_written_ = false;
+  segment_bytes_ = 0;
+  {
+    std::lock_guard<std::mutex> lk(queue_mtx_);
+    stats_.segments++;
+  }
+  if (IsSegmented()) PrepareSegment(segment_index_ + 1);
   return cnstream::VideoSink::SUCCESS;
 }
 
-int VideoSink::Stop() {
-  if (!started_) return cnstream::VideoSink::SUCCESS;
-
+void VideoSink::CloseSegment() {
   if (ctx_) {
     if (header_written_) {
       av_write_trailer(ctx_);
-      LOGI(VideoSink) << "Stop() av_write_trailer ok";
+      LOGI(VideoSink) << "CloseSegment() av_write_trailer ok";
     }
 #if LIBAVFORMAT_VERSION_INT < VERSION_LAVF_AVCPAR
     ctx_->streams[0]->codec->extradata = nullptr;
@@ -195,52 +413,91 @@ int VideoSink::Stop() {
     ctx_->streams[0]->codecpar->extradata_size = 0;
 #endif
     if (ctx_->pb) {
-      avio_close(ctx_->pb);
-      ctx_->pb = nullptr;
+      avio_flush(ctx_->pb);
+      av_freep(&ctx_->pb->buffer);
+#if LIBAVFORMAT_VERSION_INT < VERSION_LAVF_AVIO_FREE
+      av_freep(&ctx_->pb);
+#else
+      avio_context_free(&ctx_->pb);
+#endif
     }
     avformat_free_context(ctx_);
     ctx_ = nullptr;
   }
-  if (packet_) {
-    av_packet_unref(packet_);
-    av_free(packet_);
-    packet_ = nullptr;
+  if (fd_ >= 0) {
+    int ret = writer_.Close();
+    if (ret != 0) LOGE(VideoSink) << "CloseSegment() write failed, errno=" << -ret;
+    // release the preallocated space beyond the end of the file
+    struct stat st;
+    if (fstat(fd_, &st) == 0 && ftruncate(fd_, st.st_size) != 0) {
+      LOGW(VideoSink) << "CloseSegment() ftruncate failed, errno=" << errno;
+    }
+    close(fd_);
+    fd_ = -1;
   }
-  if (ps_) delete[] ps_;
-
-  started_ = false;
-
-  return cnstream::VideoSink::SUCCESS;
+  header_written_ = false;
 }
 
-int VideoSink::Write(const VideoPacket *packet) {
-  if (!started_) {
-    LOGE(VideoSink) << "Write() sink is stopped";
-    return cnstream::VideoSink::ERROR_STATE;
+int VideoSink::WriteCallback(void *opaque, uint8_t *buf, int buf_size) {
+  VideoSink *sink = reinterpret_cast<VideoSink *>(opaque);
+  // the data is written by the io ring, a failed write is reported by the following calls
+  int64_t ret = sink->writer_.Write(buf, buf_size);
+  if (ret < 0) {
+    LOGE(VideoSink) << "WriteCallback() write failed, errno=" << -ret;
+    return AVERROR(-ret);
   }
-  if (!packet || !packet->data || !packet->size) {
-    LOGE(VideoSink) << "Write() invalid parameters";
-    return cnstream::VideoSink::ERROR_PARAMETERS;
+  return buf_size;
+}
+
+int64_t VideoSink::SeekCallback(void *opaque, int64_t offset, int whence) {
+  VideoSink *sink = reinterpret_cast<VideoSink *>(opaque);
+  AsyncFileWriter &writer = sink->writer_;
+  if (whence & AVSEEK_SIZE) return writer.Size();
+  switch (whence & ~AVSEEK_FORCE) {
+    case SEEK_SET: break;
+    case SEEK_CUR: offset += writer.Tell(); break;
+    case SEEK_END: offset += writer.Size(); break;
+    default: return AVERROR(EINVAL);
   }
+  int64_t ret = writer.Seek(offset);
+  return ret < 0 ? AVERROR(-ret) : ret;
+}
 
+int VideoSink::WritePacket(const uint8_t *data, uint32_t size, int64_t pts, int64_t dts, bool key_frame) {
   int ret;
-  AVStream *stream = ctx_->streams[0];
-  AVRational frame_rate = stream->avg_frame_rate;
-  AVRational time_base = stream->time_base;
-
-  if (!ps_ && ExtractPS(packet->data, packet->size, param_.codec_type == VideoCodecType::H264)) {
+  if (!ps_ && ExtractPS(data, size, param_.codec_type == VideoCodecType::H264)) {
     LOGI(VideoSink) << "Write() parameter sets found, size=" << ps_size_;
 #if LIBAVFORMAT_VERSION_INT < VERSION_LAVF_AVCPAR
-    stream->codec->extradata = ps_;
-    stream->codec->extradata_size = ps_size_;
+    ctx_->streams[0]->codec->extradata = ps_;
+    ctx_->streams[0]->codec->extradata_size = ps_size_;
 #else
-    stream->codecpar->extradata = ps_;
-    stream->codecpar->extradata_size = ps_size_;
+    ctx_->streams[0]->codecpar->extradata = ps_;
+    ctx_->streams[0]->codecpar->extradata_size = ps_size_;
 #endif
   }
 
-  // bool key_frame = packet->IsKey();
-  bool key_frame = IsKeyFrame(packet->data, packet->size, param_.codec_type == VideoCodecType::H264);
+  // segments are rolled over on key frames, timestamps are in param_.time_base
+  int64_t timestamp = pts;
+  if (timestamp == INVALID_TIMESTAMP && param_.frame_rate > 0) {
+    timestamp = static_cast<int64_t>(frame_count_ * param_.time_base / param_.frame_rate);
+  }
+  if (IsSegmented() && header_written_ && key_frame) {
+    bool segment_full = param_.segment_size > 0 && segment_bytes_ >= param_.segment_size;
+    bool segment_ended = param_.segment_duration > 0 &&
+                         timestamp - segment_start_ >= static_cast<int64_t>(param_.segment_duration) * param_.time_base;
+    if (segment_full || segment_ended) {
+      CloseSegment();
+      segment_index_++;
+      ret = OpenSegment();
+      if (ret != cnstream::VideoSink::SUCCESS) return ret;
+    }
+  }
+  if (!ctx_) return cnstream::VideoSink::ERROR_FAILED;
+
+  AVStream *stream = ctx_->streams[0];
+  AVRational frame_rate = stream->avg_frame_rate;
+  AVRational time_base = stream->time_base;
+
   if (!header_written_) {
     if (!param_.start_from_key_frame || key_frame) {
       ret = avformat_write_header(ctx_, nullptr);
@@ -249,9 +506,11 @@ int VideoSink::Write(const VideoPacket *packet) {
         return cnstream::VideoSink::ERROR_FAILED;
       }
       header_written_ = true;
-      if (packet->pts != INVALID_TIMESTAMP) {
-        init_timestamp_ = av_rescale_q(packet->pts, (AVRational){1, static_cast<int>(param_.time_base)}, time_base);
+      if (pts != INVALID_TIMESTAMP && segment_index_ == 0) {
+        init_timestamp_ = av_rescale_q(pts, (AVRational){1, static_cast<int>(param_.time_base)}, time_base);
       }
+      segment_start_ = timestamp;
+      segment_ts_offset_ = -1;
       LOGI(VideoSink) << "Write() avformat_write_header ok";
     } else {
       LOGI(VideoSink) << "Write() skip non key frame before writing header";
@@ -259,20 +518,26 @@ int VideoSink::Write(const VideoPacket *packet) {
     }
   }
 
-  av_new_packet(packet_, packet->size);
-  memcpy(packet_->data, packet->data, packet->size);
+  av_new_packet(packet_, size);
+  memcpy(packet_->data, data, size);
 
   // Rescale timestamps
-  if (packet->pts != INVALID_TIMESTAMP) {
-    packet_->pts = av_rescale_q(packet->pts, (AVRational){1, static_cast<int>(param_.time_base)}, time_base);
+  if (pts != INVALID_TIMESTAMP) {
+    packet_->pts = av_rescale_q(pts, (AVRational){1, static_cast<int>(param_.time_base)}, time_base);
   } else {
     packet_->pts = av_rescale_q(frame_count_, (AVRational){frame_rate.den, frame_rate.num}, time_base);
   }
-  if (packet->dts != INVALID_TIMESTAMP) {
-    packet_->dts = av_rescale_q(packet->dts, (AVRational){1, static_cast<int>(param_.time_base)}, time_base);
+  if (dts != INVALID_TIMESTAMP) {
+    packet_->dts = av_rescale_q(dts, (AVRational){1, static_cast<int>(param_.time_base)}, time_base);
   } else {
     packet_->dts = av_rescale_q(frame_count_ - 1, (AVRational){frame_rate.den, frame_rate.num}, time_base);
-    if (packet->pts != INVALID_TIMESTAMP) packet_->dts += init_timestamp_;
+    if (pts != INVALID_TIMESTAMP) packet_->dts += init_timestamp_;
+  }
+  // every segment starts from zero
+  if (IsSegmented()) {
+    if (segment_ts_offset_ < 0) segment_ts_offset_ = std::max<int64_t>(packet_->dts, 0);
+    packet_->pts -= segment_ts_offset_;
+    packet_->dts -= segment_ts_offset_;
   }
   packet_->duration = av_rescale_q(1, (AVRational){frame_rate.den, frame_rate.num}, time_base);
   packet_->pos = -1;
@@ -291,6 +556,10 @@ int VideoSink::Write(const VideoPacket *packet) {
 
   av_packet_unref(packet_);
   frame_count_++;
+  segment_bytes_ += size;
+  std::lock_guard<std::mutex> lk(queue_mtx_);
+  stats_.packets++;
+  stats_.bytes += size;
   return cnstream::VideoSink::SUCCESS;
 }
 
@@ -421,4 +690,9 @@ int VideoSink::Write(const VideoPacket *packet) {
   return ERROR_FAILED;
 }
 
+int VideoSink::GetStatistics(Statistics *statistics) {
+  if (sink_) return sink_->GetStatistics(statistics);
+  return ERROR_FAILED;
+}
+
 }  // namespace cnstream
@@ -48,6 +48,23 @@ class VideoSink {
     VideoPixelFormat pixel_format = VideoPixelFormat::I420;
     VideoCodecType codec_type = VideoCodecType::H264;
     bool start_from_key_frame = true;
+    // segments are rolled over on key frames, after segment_duration seconds or segment_size bytes if not 0.
+    // Segment files are named as file_name with the segment index appended, e.g. "output_0.mp4"
+    uint32_t segment_duration = 0;
+    uint64_t segment_size = 0;
+    // bytes of packets buffered for the writing thread, 0 means packets are written by Write directly.
+    // Packets are dropped until the next key frame when the buffer is full
+    uint32_t buffer_size = 0;
+  };
+
+  struct Statistics {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint32_t segments = 0;
+    uint64_t dropped_packets = 0;
+    uint64_t buffered_bytes = 0;
+    uint64_t max_buffered_bytes = 0;
+    uint64_t max_write_time_us = 0;  // the longest time of writing a batch of packets
   };
 
   explicit VideoSink(const Param &param);
@@ -62,6 +79,7 @@ class VideoSink {
   int Start();
   int Stop();
   int Write(const VideoPacket *packet);
+  int GetStatistics(Statistics *statistics);
 
  private:
   video::VideoSink *sink_ = nullptr;
@@ -26,12 +26,13 @@
 #include <condition_variable>
 #include <functional>
 #include <future>
+#include <iterator>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <map>
+#include <set>
 #include <string>
 #include <thread>
-#include <map>
 #include <utility>
 #include <vector>
 
@@ -89,8 +90,9 @@ class VideoStream {
   bool Open();
   bool Close(bool wait_finish = false);
   bool Update(const cv::Mat &mat, ColorFormat color, int64_t timestamp, const std::string &stream_id,
-              void *user_data = nullptr);
-  bool Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id, void *user_data = nullptr);
+              void *user_data = nullptr, const std::vector<VideoRoi> *rois = nullptr);
+  bool Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id, void *user_data = nullptr,
+              const std::vector<VideoRoi> *rois = nullptr);
   bool Clear(const std::string &stream_id);
 
   void SetEventCallback(EventCallback func) { event_callback_ = func; }
@@ -102,6 +104,13 @@ class VideoStream {
     if (encoder_) return encoder_->GetPacket(packet, info);
     return -1;
   }
+  bool SetBitRate(int bit_rate) {
+    ReadLockGuard slk(state_mtx_);
+    if (state_ != RUNNING || bit_rate <= 0) return false;
+    return encoder_->SetBitRate(bit_rate) == VideoEncoder::SUCCESS;
+  }
+  void SetFrameRate(double frame_rate) { target_frame_rate_ = frame_rate; }
+  uint64_t GetRateDroppedFrames() const { return rate_dropped_frames_; }
 
  private:
   enum State {
@@ -119,6 +128,8 @@ class VideoStream {
 
   const size_t TIMESTAMP_WINDOW_SIZE = 8;
   const size_t QUEUE_SIZE = 20;
+  const size_t PREBUFFER_SIZE = 5;
+  const unsigned RENDER_THREAD_NUM = 4;
   struct StreamContext {
     int64_t ts_init = 0;
     int64_t ts_base = 0;
@@ -133,18 +144,29 @@ class VideoStream {
     std::atomic<uint64_t> frame_count{0};
     std::mutex mutex;
     std::condition_variable full_cv;
-    std::condition_variable empty_cv;
-    std::queue<FrameInfo> queue;
-    std::thread thread;
-    std::atomic<bool> running;
+    // ring of QUEUE_SIZE slots, the slots are reused instead of allocating queue nodes per frame
+    std::vector<FrameInfo> frames;
+    size_t frame_head = 0;
+    size_t frame_num = 0;
+    bool scheduled = false;  // the stream has a render job queued or being rendered
+    std::atomic<bool> running{false};
     int position;
   };
 
   void MatToBuffer(const cv::Mat &mat, ColorFormat color, Buffer *buffer);
-  bool Encode(const cv::Mat &mat, ColorFormat color, int64_t timestamp, void *user_data = nullptr, int timeout_ms = -1);
-  bool Encode(const Buffer *buffer, int64_t timestamp, void *user_data = nullptr, int timeout_ms = -1);
-  void RenderLoop(const std::string &stream_id);
+  bool Encode(const cv::Mat &mat, ColorFormat color, int64_t timestamp, void *user_data = nullptr, int timeout_ms = -1,
+              const std::vector<VideoRoi> *rois = nullptr);
+  bool Encode(const Buffer *buffer, int64_t timestamp, void *user_data = nullptr, int timeout_ms = -1,
+              const std::vector<VideoRoi> *rois = nullptr);
+  // queues a render job of the stream, called with stream.mutex locked
+  void ScheduleRender(StreamContext *stream, int64_t tick);
+  // renders the frame at the head of the stream, returns the tick to render the next one or INVALID_TIMESTAMP
+  int64_t RenderFrame(StreamContext *stream);
+  void RenderWorkerLoop();
+  void StopRenderWorkers();
   void ResampleLoop();
+  // generates the pts of a frame encoded without resampling
+  int64_t NextPts();
 
   int64_t CurrentTick() {
     return std::chrono::duration_cast<std::chrono::microseconds>(
@@ -159,9 +181,22 @@ class VideoStream {
   cv::Mat canvas_;
   ColorFormat canvas_color_ = ColorFormat::BGR;
   int64_t frame_count_ = 0;
+  int64_t pts_tick_start_ = 0;  // the tick of the first frame in low latency mode
+  int64_t last_pts_ = INVALID_TIMESTAMP;
+  std::atomic<double> target_frame_rate_{0};
+  double frame_credit_ = 1;  // frames allowed to encode at the target frame rate, guarded by frame_mtx_
+  std::atomic<uint64_t> rate_dropped_frames_{0};  // frames dropped to encode at the target frame rate
   std::thread resample_thread_;
   std::mutex context_mtx_;
   std::map<std::string, StreamContext> streams_;
+  // the streams are rendered by a few workers instead of a thread per stream, one job per stream keeps the order
+  std::vector<std::thread> render_threads_;
+  std::mutex render_mtx_;
+  std::condition_variable render_cv_;
+  std::condition_variable render_done_cv_;
+  bool render_running_ = false;
+  std::multimap<int64_t, StreamContext *> render_jobs_;  // keyed by the tick to render
+  std::multiset<StreamContext *> rendering_;
   VideoFrame frame_;
   std::mutex frame_mtx_;
   std::atomic<bool> frame_available_{false};
@@ -217,13 +252,36 @@ bool VideoStream::Open() {
     return false;
   }
   if (param_.codec_type == VideoCodecType::AUTO) param_.codec_type = VideoCodecType::H264;
+  if (param_.low_latency && param_.resample && param_.tile_cols <= 1 && param_.tile_rows <= 1) {
+    LOGW(VideoStream) << "Open() resample is disabled in low latency mode";
+    param_.resample = false;
+  }
   param_.frame_rate = param_.frame_rate > 0 ? param_.frame_rate : 25;
   param_.frame_rate = param_.frame_rate <= 60 ? param_.frame_rate : 25;
   param_.time_base = param_.time_base >= 1000 ? param_.time_base : 90000;
 
   if (param_.tile_cols > 1 || param_.tile_rows > 1) {
     ColorFormat color = frame_to_buffer_color_map[param_.pixel_format];
-    tiler_.reset(new (std::nothrow) Tiler(param_.tile_cols, param_.tile_rows, color, param_.width, param_.height));
+    int tiler_device_id = -1;
+    if (param_.mlu_input) {
+#ifndef HAVE_CNCV
+      LOGE(VideoStream) << "Open() tiler mode for MLU input is not supported. Please install CNCV.";
+      state_ = IDLE;
+      return false;
+#endif
+      if (param_.device_id < 0 || color == ColorFormat::YUV_I420) {
+        LOGE(VideoStream) << "Open() tiler mode for MLU input requires device_id and YUV NV12/NV21 format";
+        state_ = IDLE;
+        return false;
+      }
+      tiler_device_id = param_.device_id;
+    }
+    tiler_.reset(new (std::nothrow) Tiler(param_.tile_cols, param_.tile_rows, color, param_.width, param_.height, 0,
+                                          tiler_device_id));
+    if (tiler_ && tiler_->GetMluDeviceId() != tiler_device_id) {
+      LOGE(VideoStream) << "Open() create tiler on MLU " << tiler_device_id << " failed";
+      tiler_.reset();
+    }
     if (!tiler_) {
       LOGE(VideoStream) << "Open() create tiler failed";
       state_ = IDLE;
@@ -238,11 +296,18 @@ bool VideoStream::Open() {
   param.time_base = param_.time_base;
   param.bit_rate = param_.bit_rate;
   param.gop_size = param_.gop_size;
+  param.jpeg_quality = param_.jpeg_quality;
   param.pixel_format = param_.pixel_format;
   param.codec_type = param_.codec_type;
-  param.input_buffer_count = 8;
+  // fewer input buffers in low latency mode, the updates are blocked instead of queueing up when encoding lags
+  param.input_buffer_count = param_.low_latency ? 3 : 8;
   param.output_buffer_size = param_.bit_rate * param_.gop_size * 0.06;
   param.mlu_device_id = param_.mlu_encoder ? param_.device_id : -1;
+  param.preset = param_.preset;
+  param.tune = param_.tune;
+  param.rate_control = param_.rate_control;
+  param.crf = param_.crf;
+  param.low_latency = param_.low_latency;
   encoder_.reset(new (std::nothrow) VideoEncoder(param));
   if (!encoder_) {
     LOGE(VideoStream) << "Open() create video encoder failed";
@@ -268,6 +333,12 @@ bool VideoStream::Open() {
   if (tiler_ || param_.resample) {
     param_.resample = true;
     resample_thread_ = std::thread(&VideoStream::ResampleLoop, this);
+    unsigned render_thread_num = std::min(RENDER_THREAD_NUM,
+                                          static_cast<unsigned>(std::max(param_.tile_cols * param_.tile_rows, 1)));
+    render_running_ = true;
+    for (unsigned i = 0; i < render_thread_num; ++i) {
+      render_threads_.emplace_back(&VideoStream::RenderWorkerLoop, this);
+    }
   }
 
   return true;
@@ -287,12 +358,13 @@ bool VideoStream::Close(bool wait_finish) {
     auto &stream = s.second;
     std::unique_lock<std::mutex> lk(stream.mutex);
     stream.running = false;
-    while (!stream.queue.empty()) stream.queue.pop();
+    for (auto &frame : stream.frames) frame.mat.release();
+    stream.frame_num = 0;
     lk.unlock();
     stream.full_cv.notify_all();
-    stream.empty_cv.notify_all();
-    if (stream.thread.joinable()) stream.thread.join();
   }
+  StopRenderWorkers();
+  for (auto &s : streams_) s.second.scheduled = false;
   clk.unlock();
 
   if (resample_thread_.joinable()) resample_thread_.join();
@@ -333,7 +405,7 @@ bool VideoStream::Close(bool wait_finish) {
 }
 
 bool VideoStream::Update(const cv::Mat &mat, ColorFormat color, int64_t timestamp, const std::string &stream_id,
-                         void *user_data) {
+                         void *user_data, const std::vector<VideoRoi> *rois) {
   ReadLockGuard slk(state_mtx_);
   if (state_ != RUNNING) {
     LOGW(VideoStream) << "Update(mat) not running";
@@ -343,9 +415,7 @@ bool VideoStream::Update(const cv::Mat &mat, ColorFormat color, int64_t timestam
   LOGT(VideoStream) << "Update() timestamp=" << timestamp << ", stream_id=" << stream_id;
 
   if (!param_.resample) {
-    // re-generate timestamp to match frame rate
-    timestamp = frame_count_++ * param_.time_base / param_.frame_rate;
-    return Encode(mat, color, timestamp, user_data);
+    return Encode(mat, color, NextPts(), user_data, -1, rois);
   } else {
     if (timestamp != INVALID_TIMESTAMP) {
       timestamp = timestamp * (1e6 / static_cast<float>(param_.time_base));  // change to unit of microseconds
@@ -357,11 +427,12 @@ bool VideoStream::Update(const cv::Mat &mat, ColorFormat color, int64_t timestam
     }
     StreamContext &stream = streams_[stream_id];
     std::unique_lock<std::mutex> lk(stream.mutex);
-    if (!stream.thread.joinable()) {
+    if (!stream.running) {
       stream.running = true;
       stream.position = streams_.size() - 1;
-      stream.thread = std::thread(&VideoStream::RenderLoop, this, stream_id);
+      stream.render_tick_start = 0;
     }
+    if (stream.frames.empty()) stream.frames.resize(QUEUE_SIZE);
     clk.unlock();
 
     /* rectify pts for loop mode */
@@ -405,34 +476,83 @@ bool VideoStream::Update(const cv::Mat &mat, ColorFormat color, int64_t timestam
     LOGT(VideoStream) << "Update() rectified timestamp=" << timestamp << "("
                       << static_cast<int64_t>(timestamp * param_.time_base / 1e6) << "), stream_id=" << stream_id;
 
-    stream.full_cv.wait(lk, [&]() { return (!stream.running.load() || stream.queue.size() < QUEUE_SIZE); });
+    stream.full_cv.wait(lk, [&]() { return (!stream.running.load() || stream.frame_num < QUEUE_SIZE); });
     if (!stream.running) {
       LOGW(VideoStream) << "Update() stream cleared";
       return false;
     }
-    stream.queue.push((FrameInfo){mat, color, timestamp});
+    FrameInfo &frame = stream.frames[(stream.frame_head + stream.frame_num) % QUEUE_SIZE];
+    frame.mat = mat;
+    frame.color = color;
+    frame.timestamp = timestamp;
+    stream.frame_num++;
     stream.frame_count++;
-    lk.unlock();
-    stream.empty_cv.notify_one();
+    const size_t prebuffer_size = param_.low_latency ? 1 : PREBUFFER_SIZE;
+    if (!stream.scheduled && (stream.render_tick_start || stream.frame_num >= prebuffer_size)) {
+      if (!stream.render_tick_start) {
+        stream.render_tick_start = CurrentTick();
+        LOGI(VideoStream) << "Update() start render for stream id: " << stream_id;
+      }
+      stream.scheduled = true;
+      ScheduleRender(&stream, stream.render_tick_start + stream.frames[stream.frame_head].timestamp);
+    }
   }
 
   return true;
 }
 
-bool VideoStream::Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id, void *user_data) {
+bool VideoStream::Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id, void *user_data,
+                         const std::vector<VideoRoi> *rois) {
   ReadLockGuard slk(state_mtx_);
   if (state_ != RUNNING) {
     LOGW(VideoStream) << "Update(buffer) not running";
     return false;
   }
 
+  if (tiler_ && buffer->mlu_device_id >= 0) {
+    // MLU buffers are only valid during this call, blit them to the canvas at once instead of queueing for render
+    std::unique_lock<std::mutex> clk(context_mtx_);
+    if (!streams_.count(stream_id) && streams_.size() >= static_cast<unsigned>(param_.tile_cols * param_.tile_rows)) {
+      LOGE(VideoStream) << "Update() stream count over tiler grid number, stream_id: " << stream_id;
+      return false;
+    }
+    StreamContext &stream = streams_[stream_id];
+    std::unique_lock<std::mutex> lk(stream.mutex);
+    if (!stream.frame_count) {
+      stream.running = true;
+      stream.position = streams_.size() - 1;
+    }
+    clk.unlock();
+    if (!stream.running) {
+      LOGW(VideoStream) << "Update() stream cleared";
+      return false;
+    }
+    stream.frame_count++;
+    if (!tiler_->Blit(buffer, stream.position)) {
+      LOGE(VideoStream) << "Update() tiler blit in pos: " << stream.position << " failed";
+      return false;
+    }
+    return true;
+  }
   if (param_.resample && buffer->mlu_device_id >= 0) {
-    LOGE(VideoStream) << "Update() not support resample or tiler mode for MLU buffer";
+    LOGE(VideoStream) << "Update() not support resample mode for MLU buffer";
     return false;
   }
-  // re-generate timestamp to match frame rate
-  timestamp = frame_count_++ * param_.time_base / param_.frame_rate;
-  return Encode(buffer, timestamp);
+  return Encode(buffer, NextPts(), user_data, -1, rois);
+}
+
+int64_t VideoStream::NextPts() {
+  if (!param_.low_latency) {
+    // re-generate timestamp to match frame rate
+    return frame_count_++ * param_.time_base / param_.frame_rate;
+  }
+  // the time of update, so that the frames are presented as they come instead of at the frame rate
+  int64_t tick = CurrentTick();
+  if (!frame_count_++) pts_tick_start_ = tick;
+  int64_t pts = (tick - pts_tick_start_) * param_.time_base / 1000000;
+  if (last_pts_ != INVALID_TIMESTAMP && pts <= last_pts_) pts = last_pts_ + 1;
+  last_pts_ = pts;
+  return pts;
 }
 
 bool VideoStream::Clear(const std::string &stream_id) {
@@ -456,11 +576,18 @@ bool VideoStream::Clear(const std::string &stream_id) {
   std::unique_lock<std::mutex> lk(stream.mutex);
   clk.unlock();
   stream.running = false;
-  while (!stream.queue.empty()) stream.queue.pop();
+  for (auto &frame : stream.frames) frame.mat.release();
+  stream.frame_num = 0;
   lk.unlock();
   stream.full_cv.notify_all();
-  stream.empty_cv.notify_all();
-  if (stream.thread.joinable()) stream.thread.join();
+
+  // wait for the frame being rendered and drop the queued job before the context is erased
+  std::unique_lock<std::mutex> rlk(render_mtx_);
+  render_done_cv_.wait(rlk, [&]() { return !rendering_.count(&stream); });
+  for (auto it = render_jobs_.begin(); it != render_jobs_.end();) {
+    it = it->second == &stream ? render_jobs_.erase(it) : std::next(it);
+  }
+  rlk.unlock();
 
   int position = stream.position;
   clk.lock();
@@ -522,17 +649,31 @@ void VideoStream::MatToBuffer(const cv::Mat &mat, ColorFormat color, Scaler::Buf
   }
 }
 
-bool VideoStream::Encode(const cv::Mat &mat, ColorFormat color, int64_t timestamp, void *user_data, int timeout_ms) {
+bool VideoStream::Encode(const cv::Mat &mat, ColorFormat color, int64_t timestamp, void *user_data, int timeout_ms,
+                         const std::vector<VideoRoi> *rois) {
   Buffer buffer;
   memset(&buffer, 0, sizeof(Buffer));
   MatToBuffer(mat, color, &buffer);
-  return Encode(&buffer, timestamp, user_data, timeout_ms);
+  return Encode(&buffer, timestamp, user_data, timeout_ms, rois);
 }
 
-bool VideoStream::Encode(const Buffer *buffer, int64_t timestamp, void *user_data, int timeout_ms) {
+bool VideoStream::Encode(const Buffer *buffer, int64_t timestamp, void *user_data, int timeout_ms,
+                         const std::vector<VideoRoi> *rois) {
   if (!buffer) return false;
 
   std::unique_lock<std::mutex> flk(frame_mtx_);
+  // drop frames evenly to encode at the target frame rate, the timestamps of the encoded frames are kept
+  double frame_rate = target_frame_rate_;
+  if (frame_rate > 0 && frame_rate < param_.frame_rate) {
+    frame_credit_ += frame_rate / param_.frame_rate;
+    if (frame_credit_ < 1) {
+      rate_dropped_frames_++;
+      return true;
+    }
+    frame_credit_ -= 1;
+  } else {
+    frame_credit_ = 1;
+  }
   if (!frame_available_) {
     memset(&frame_, 0, sizeof(VideoFrame));
     if (VideoEncoder::SUCCESS != encoder_->RequestFrameBuffer(&frame_, timeout_ms)) {
@@ -723,7 +864,16 @@ bool VideoStream::Encode(const Buffer *buffer, int64_t timestamp, void *user_dat
       buf.data[1] = frame_.data[1];
       buf.stride[1] = frame_.stride[1];
       buf.mlu_device_id = frame_.GetMluDeviceId();
-      if (!Scaler::Process(buffer, &buf)) {
+      if (buffer->width == frame_.width && buffer->height == frame_.height && buffer->color == buf.color &&
+          buffer->stride[0] == frame_.stride[0] && buffer->stride[1] == frame_.stride[1]) {
+        // e.g. the tiler canvas, copy on device without resizing
+        CALL_CNRT_BY_CONTEXT(cnrtMemcpy(buf.data[0], buffer->data[0], frame_.stride[0] * frame_.height,
+                                        CNRT_MEM_TRANS_DIR_DEV2DEV),
+                             param_.device_id, -1);
+        CALL_CNRT_BY_CONTEXT(cnrtMemcpy(buf.data[1], buffer->data[1], frame_.stride[1] * frame_.height / 2,
+                                        CNRT_MEM_TRANS_DIR_DEV2DEV),
+                             param_.device_id, -1);
+      } else if (!Scaler::Process(buffer, &buf)) {
         LOGE(VideoStream) << "Encode() scaler process 4 failed";
         return false;
       }
@@ -733,6 +883,8 @@ bool VideoStream::Encode(const Buffer *buffer, int64_t timestamp, void *user_dat
   frame_.pts = timestamp;
   frame_.dts = INVALID_TIMESTAMP;
   frame_.user_data = user_data;
+  frame_.rois = rois && !rois->empty() ? rois->data() : nullptr;
+  frame_.roi_num = frame_.rois ? rois->size() : 0;
   flk.lock();
   auto ret = encoder_->SendFrame(&frame_, timeout_ms);
   frame_available_ = false;
@@ -743,57 +895,96 @@ bool VideoStream::Encode(const Buffer *buffer, int64_t timestamp, void *user_dat
   return true;
 }
 
-void VideoStream::RenderLoop(const std::string &stream_id) {
-  int64_t start = 0;
-  bool first = true;
-  std::unique_lock<std::mutex> clk(context_mtx_);
-  if (!streams_.count(stream_id)) {
-    LOGE(VideoStream) << "RenderLoop() context not exist with stream id: " << stream_id;
-    return;
+void VideoStream::ScheduleRender(StreamContext *stream, int64_t tick) {
+  {
+    std::lock_guard<std::mutex> lk(render_mtx_);
+    render_jobs_.emplace(tick, stream);
   }
-  StreamContext &stream = streams_[stream_id];
-  clk.unlock();
+  render_cv_.notify_one();
+}
 
-  while (stream.running) {
-    std::unique_lock<std::mutex> lk(stream.mutex);
-    stream.empty_cv.wait(lk, [&]() {
-      return (!stream.running.load() || (first && stream.queue.size() >= 5) || (!first && !stream.queue.empty()));
-    });
-    if (!stream.running) break;
-
-    if (first && stream.queue.size() < 5) continue;
-    auto frame = stream.queue.front();
-    stream.queue.pop();
-    lk.unlock();
-    stream.full_cv.notify_one();
+int64_t VideoStream::RenderFrame(StreamContext *stream) {
+  std::unique_lock<std::mutex> lk(stream->mutex);
+  if (!stream->running || !stream->frame_num) {
+    stream->scheduled = false;
+    return INVALID_TIMESTAMP;
+  }
+  FrameInfo frame;
+  std::swap(frame, stream->frames[stream->frame_head]);
+  stream->frame_head = (stream->frame_head + 1) % QUEUE_SIZE;
+  stream->frame_num--;
+  LOGT(VideoStream) << "RenderFrame() timestamp=" << frame.timestamp << ", queue size=" << stream->frame_num
+                    << ", rt=" << (stream->render_tick_start + frame.timestamp - CurrentTick());
+  lk.unlock();
+  stream->full_cv.notify_one();
 
-    if (first) {
-      first = false;
-      start = CurrentTick();
-      LOGI(VideoStream) << "RenderLoop() start render for stream id: " << stream_id;
+  if (!tiler_) {
+    std::lock_guard<std::mutex> lk(canvas_mtx_);
+    canvas_ = frame.mat;
+    canvas_color_ = frame.color;
+    start_resample_ = true;
+  } else {
+    Buffer buffer;
+    memset(&buffer, 0, sizeof(Buffer));
+    MatToBuffer(frame.mat, frame.color, &buffer);
+    if (!tiler_->Blit(&buffer, stream->position)) {
+      LOGE(VideoStream) << "RenderFrame() tiler blit in pos: " << stream->position << " failed";
     }
+  }
 
-    int64_t rt = frame.timestamp - (CurrentTick() - start);
-    LOGT(VideoStream) << "RenderLoop() timestamp=" << frame.timestamp << ", queue size=" << stream.queue.size()
-                      << ", rt=" << rt;
-    if (rt > 0) std::this_thread::sleep_for(std::chrono::microseconds(rt));
+  lk.lock();
+  if (!stream->running || !stream->frame_num) {
+    stream->scheduled = false;
+    return INVALID_TIMESTAMP;
+  }
+  return stream->render_tick_start + stream->frames[stream->frame_head].timestamp;
+}
 
-    if (!tiler_) {
-      std::lock_guard<std::mutex> lk(canvas_mtx_);
-      canvas_ = frame.mat;
-      canvas_color_ = frame.color;
-      start_resample_ = true;
-    } else {
-      Buffer buffer;
-      memset(&buffer, 0, sizeof(Buffer));
-      MatToBuffer(frame.mat, frame.color, &buffer);
-      if (!tiler_->Blit(&buffer, stream.position)) {
-        LOGE(VideoStream) << "RenderLoop() tiler blit in pos: " << stream.position << " failed";
-      }
+void VideoStream::RenderWorkerLoop() {
+  std::unique_lock<std::mutex> lk(render_mtx_);
+  while (render_running_) {
+    if (render_jobs_.empty()) {
+      render_cv_.wait(lk);
+      continue;
     }
+    auto job = render_jobs_.begin();
+    int64_t rt = job->first - CurrentTick();
+    if (rt > 0) {
+      render_cv_.wait_for(lk, std::chrono::microseconds(rt));
+      continue;
+    }
+    StreamContext *stream = job->second;
+    render_jobs_.erase(job);
+    auto rendering = rendering_.insert(stream);
+    lk.unlock();
+    int64_t tick = RenderFrame(stream);
+    lk.lock();
+    rendering_.erase(rendering);
+    if (tick != INVALID_TIMESTAMP) {
+      render_jobs_.emplace(tick, stream);
+      // the other workers may wait for a later job
+      render_cv_.notify_one();
+    }
+    render_done_cv_.notify_all();
   }
 }
 
+void VideoStream::StopRenderWorkers() {
+  {
+    std::lock_guard<std::mutex> lk(render_mtx_);
+    render_running_ = false;
+  }
+  render_cv_.notify_all();
+  for (auto &thread : render_threads_) {
+    if (thread.joinable()) thread.join();
+  }
+  render_threads_.clear();
+  std::lock_guard<std::mutex> lk(render_mtx_);
+  render_jobs_.clear();
+  rendering_.clear();
+  render_done_cv_.notify_all();
+}
+
 void VideoStream::ResampleLoop() {
   int64_t delay_us = 0;
   auto start = std::chrono::steady_clock::now();
@@ -876,13 +1067,14 @@ bool VideoStream::Close(bool wait_finish) {
 }
 
 bool VideoStream::Update(const cv::Mat &mat, ColorFormat color, int64_t timestamp, const std::string &stream_id,
-                         void *user_data) {
-  if (stream_) return stream_->Update(mat, color, timestamp, stream_id, user_data);
+                         void *user_data, const std::vector<VideoRoi> *rois) {
+  if (stream_) return stream_->Update(mat, color, timestamp, stream_id, user_data, rois);
   return false;
 }
 
-bool VideoStream::Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id, void *user_data) {
-  if (stream_) return stream_->Update(buffer, timestamp, stream_id, user_data);
+bool VideoStream::Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id, void *user_data,
+                         const std::vector<VideoRoi> *rois) {
+  if (stream_) return stream_->Update(buffer, timestamp, stream_id, user_data, rois);
   return false;
 }
 
@@ -905,4 +1097,18 @@ int VideoStream::GetPacket(VideoPacket *packet, PacketInfo *info) {
   return -1;
 }
 
+bool VideoStream::SetBitRate(int bit_rate) {
+  if (stream_) return stream_->SetBitRate(bit_rate);
+  return false;
+}
+
+void VideoStream::SetFrameRate(double frame_rate) {
+  if (stream_) stream_->SetFrameRate(frame_rate);
+}
+
+uint64_t VideoStream::GetRateDroppedFrames() const {
+  if (stream_) return stream_->GetRateDroppedFrames();
+  return 0;
+}
+
 }  // namespace cnstream
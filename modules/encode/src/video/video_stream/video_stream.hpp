@@ -28,6 +28,7 @@
 #endif
 
 #include <string>
+#include <vector>
 
 #include "tiler/tiler.hpp"
 #include "../video_encoder/video_encoder.hpp"
@@ -56,11 +57,21 @@ class VideoStream {
     int time_base;
     int bit_rate;
     int gop_size;
+    int jpeg_quality = 50;  // quality of JPEG encoding from 1 to 100, only supported by the MLU encoders
     VideoPixelFormat pixel_format = VideoPixelFormat::NV21;
     VideoCodecType codec_type = VideoCodecType::H264;
     bool mlu_encoder = true;
     bool resample = true;
     int device_id = -1;
+    bool mlu_input = false;  // frames are updated in MLU memory, the tiler canvas is then on MLU as well
+    // frames are encoded once they are updated, without pre-buffering or resampling (the tiler canvas is still
+    // encoded at the frame rate), and the encoder outputs each frame at once without B frames or lookahead
+    bool low_latency = false;
+    // options of the cpu encoder, see VideoEncoder::Param
+    std::string preset = "superfast";
+    std::string tune = "zerolatency";
+    std::string rate_control = "abr";
+    int crf = 23;
   };
 
   explicit VideoStream(const Param &param);
@@ -75,14 +86,22 @@ class VideoStream {
 
   bool Open();
   bool Close(bool wait_finish = false);
+  // rois are the regions of interest of the frame, which are ignored if the frame is resampled
   bool Update(const cv::Mat &mat, ColorFormat color, int64_t timestamp, const std::string &stream_id,
-              void *user_data = nullptr);
-  bool Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id, void *user_data = nullptr);
+              void *user_data = nullptr, const std::vector<VideoRoi> *rois = nullptr);
+  bool Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id, void *user_data = nullptr,
+              const std::vector<VideoRoi> *rois = nullptr);
   bool Clear(const std::string &stream_id);
 
   void SetEventCallback(EventCallback func);
   int RequestFrameBuffer(VideoFrame *frame);
   int GetPacket(VideoPacket *packet, PacketInfo *info = nullptr);
+  // changes the target bit rate while encoding, returns false if the encoder does not support it
+  bool SetBitRate(int bit_rate);
+  // drops frames evenly to lower the encoding frame rate below Param::frame_rate, 0 encodes all frames
+  void SetFrameRate(double frame_rate);
+  // gets the frames dropped by SetFrameRate since the stream is opened
+  uint64_t GetRateDroppedFrames() const;
 
  private:
   video::VideoStream *stream_ = nullptr;
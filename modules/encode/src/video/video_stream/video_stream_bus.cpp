@@ -0,0 +1,366 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "video_stream_bus.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+namespace video {
+
+using Subscriber = cnstream::VideoStreamBus::Subscriber;
+
+// Subscribers of one source stream never lag behind each other by so many frames. A smaller frame index beyond it
+// means the source stream is restarted.
+static constexpr int64_t kMaxFrameLag = 256;
+
+struct BusSource {
+  std::mutex mtx;  // serializes updating frames
+  int64_t last_index = -1;
+  std::set<int> subscribers;  // guarded by the sources mutex of channel
+
+  // returns false if the frame has been updated by another subscriber
+  bool Claim(int64_t index, bool shared) {
+    if (index < 0) return true;
+    if (shared && last_index >= 0 && index <= last_index && last_index - index < kMaxFrameLag) return false;
+    last_index = index;
+    return true;
+  }
+};
+
+class BusChannel {
+ public:
+  using Param = cnstream::VideoStream::Param;
+  using Event = cnstream::VideoStream::Event;
+
+  BusChannel(const std::string &key, const Param &param) : key_(key), param_(param) {}
+
+  bool Open();
+  void Close(bool wait_finish);
+
+  const std::string &GetKey() const { return key_; }
+  cnstream::VideoStream *GetStream() const { return stream_.get(); }
+  size_t GetQueueCapacity() const {
+    // same with the output buffer of video encoder
+    return std::max(static_cast<size_t>(param_.bit_rate * param_.gop_size * 0.06), static_cast<size_t>(0x80000));
+  }
+
+  int AddSubscriber(Subscriber *subscriber);
+  void RemoveSubscriber(int id);
+  size_t GetSubscriberCount();
+
+  std::shared_ptr<BusSource> GetSource(const std::string &stream_id, int id);
+  // returns true if the source stream is left by all subscribers who have updated it
+  bool LeaveSource(const std::string &stream_id, int id);
+  void LeaveSources(int id);
+
+ private:
+  void OnEvent(Event event);
+
+  std::string key_;
+  Param param_;
+  std::unique_ptr<cnstream::VideoStream> stream_ = nullptr;
+  std::mutex sub_mtx_;
+  std::map<int, Subscriber *> subscribers_;
+  int next_id_ = 0;
+  std::mutex src_mtx_;
+  std::map<std::string, std::shared_ptr<BusSource>> sources_;
+  // only accessed in the event callback of video stream
+  std::unique_ptr<uint8_t[]> buffer_ = nullptr;
+  int buffer_size_ = 0;
+};  // BusChannel
+
+static std::mutex g_channels_mtx;
+static std::map<std::string, std::shared_ptr<BusChannel>> g_channels;
+
+bool BusChannel::Open() {
+  stream_.reset(new (std::nothrow) cnstream::VideoStream(param_));
+  if (!stream_ || !stream_->Open()) {
+    LOGE(VideoStreamBus) << "Open() open video stream failed, channel: " << key_;
+    stream_.reset();
+    return false;
+  }
+  stream_->SetEventCallback(std::bind(&BusChannel::OnEvent, this, std::placeholders::_1));
+  return true;
+}
+
+void BusChannel::Close(bool wait_finish) {
+  if (stream_) stream_->Close(wait_finish);
+}
+
+int BusChannel::AddSubscriber(Subscriber *subscriber) {
+  std::lock_guard<std::mutex> lk(sub_mtx_);
+  int id = next_id_++;
+  subscribers_[id] = subscriber;
+  return id;
+}
+
+void BusChannel::RemoveSubscriber(int id) {
+  std::lock_guard<std::mutex> lk(sub_mtx_);
+  subscribers_.erase(id);
+}
+
+size_t BusChannel::GetSubscriberCount() {
+  std::lock_guard<std::mutex> lk(sub_mtx_);
+  return subscribers_.size();
+}
+
+std::shared_ptr<BusSource> BusChannel::GetSource(const std::string &stream_id, int id) {
+  std::lock_guard<std::mutex> lk(src_mtx_);
+  auto &source = sources_[stream_id];
+  if (!source) source = std::make_shared<BusSource>();
+  source->subscribers.insert(id);
+  return source;
+}
+
+bool BusChannel::LeaveSource(const std::string &stream_id, int id) {
+  std::lock_guard<std::mutex> lk(src_mtx_);
+  auto search = sources_.find(stream_id);
+  if (search == sources_.end()) return true;
+  search->second->subscribers.erase(id);
+  if (!search->second->subscribers.empty()) return false;
+  sources_.erase(search);
+  return true;
+}
+
+void BusChannel::LeaveSources(int id) {
+  std::set<std::string> cleared;
+  std::unique_lock<std::mutex> lk(src_mtx_);
+  for (auto it = sources_.begin(); it != sources_.end();) {
+    if (it->second->subscribers.erase(id) && it->second->subscribers.empty()) {
+      cleared.insert(it->first);
+      it = sources_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  lk.unlock();
+  if (param_.tile_cols > 1 || param_.tile_rows > 1) {
+    for (auto &stream_id : cleared) stream_->Clear(stream_id);
+  }
+}
+
+void BusChannel::OnEvent(Event event) {
+  if (event == Event::EVENT_DATA) {
+    VideoPacket packet;
+    memset(&packet, 0, sizeof(VideoPacket));
+    int ret = stream_->GetPacket(&packet);
+    if (ret <= 0) {
+      if (ret < 0) LOGE(VideoStreamBus) << "OnEvent() stream get packet size failed, ret=" << ret;
+      return;
+    }
+    if (buffer_size_ < ret) {
+      buffer_.reset(new uint8_t[ret]);
+      buffer_size_ = ret;
+    }
+    packet.data = buffer_.get();
+    packet.size = buffer_size_;
+    ret = stream_->GetPacket(&packet);
+    if (ret <= 0) {
+      LOGE(VideoStreamBus) << "OnEvent() stream get packet failed, ret=" << ret;
+      return;
+    }
+    std::lock_guard<std::mutex> lk(sub_mtx_);
+    for (auto &it : subscribers_) it.second->OnPacket(&packet);
+    for (auto &it : subscribers_) it.second->OnEvent(event);
+  } else {
+    std::lock_guard<std::mutex> lk(sub_mtx_);
+    for (auto &it : subscribers_) it.second->OnEvent(event);
+  }
+}
+
+static std::string GetChannelKey(const std::string &channel, const cnstream::VideoStream::Param &param) {
+  std::ostringstream ss;
+  ss << channel << ":" << param.width << "x" << param.height << ":" << param.tile_cols << "x" << param.tile_rows << ":"
+     << param.frame_rate << ":" << param.time_base << ":" << param.bit_rate << ":" << param.gop_size << ":"
+     << param.jpeg_quality << ":" << param.pixel_format << ":" << param.codec_type << ":" << param.mlu_encoder << ":"
+     << param.resample << ":" << param.device_id << ":" << param.mlu_input << ":" << param.low_latency;
+  if (!param.mlu_encoder) {
+    ss << ":" << param.preset << ":" << param.tune << ":" << param.rate_control << ":" << param.crf;
+  }
+  return ss.str();
+}
+
+}  // namespace video
+
+std::unique_ptr<VideoStreamBus::Subscriber> VideoStreamBus::Subscribe(const std::string &channel, const Param &param,
+                                                                       PacketCallback packet_callback,
+                                                                       EventCallback event_callback) {
+  std::string key = video::GetChannelKey(channel, param);
+  std::unique_ptr<Subscriber> subscriber(new (std::nothrow) Subscriber);
+  if (!subscriber) return nullptr;
+  subscriber->packet_callback_ = packet_callback;
+  subscriber->event_callback_ = event_callback;
+
+  std::lock_guard<std::mutex> lk(video::g_channels_mtx);
+  std::shared_ptr<video::BusChannel> bus_channel;
+  auto search = video::g_channels.find(key);
+  if (search != video::g_channels.end()) {
+    bus_channel = search->second;
+    subscriber->wait_key_frame_ = true;
+    LOGI(VideoStreamBus) << "Subscribe() share video stream of channel: " << key;
+  } else {
+    bus_channel = std::make_shared<video::BusChannel>(key, param);
+    if (!bus_channel->Open()) return nullptr;
+    video::g_channels[key] = bus_channel;
+  }
+  if (!packet_callback) subscriber->queue_.reset(new (std::nothrow) video::CircularBuffer(
+      bus_channel->GetQueueCapacity()));
+  subscriber->channel_ = bus_channel;
+  subscriber->id_ = bus_channel->AddSubscriber(subscriber.get());
+  return subscriber;
+}
+
+VideoStreamBus::Subscriber::~Subscriber() { Close(); }
+
+bool VideoStreamBus::Subscriber::Update(const cv::Mat &mat, ColorFormat color, int64_t timestamp,
+                                        const std::string &stream_id, int64_t frame_index,
+                                        const std::vector<VideoRoi> *rois) {
+  if (!channel_) return false;
+  auto source = channel_->GetSource(stream_id, id_);
+  std::lock_guard<std::mutex> lk(source->mtx);
+  if (!source->Claim(frame_index, channel_->GetSubscriberCount() > 1)) return true;
+  return channel_->GetStream()->Update(mat, color, timestamp, stream_id, nullptr, rois);
+}
+
+bool VideoStreamBus::Subscriber::Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id,
+                                        int64_t frame_index, const std::vector<VideoRoi> *rois) {
+  if (!channel_) return false;
+  auto source = channel_->GetSource(stream_id, id_);
+  std::lock_guard<std::mutex> lk(source->mtx);
+  if (!source->Claim(frame_index, channel_->GetSubscriberCount() > 1)) return true;
+  return channel_->GetStream()->Update(buffer, timestamp, stream_id, nullptr, rois);
+}
+
+bool VideoStreamBus::Subscriber::Clear(const std::string &stream_id) {
+  if (!channel_) return false;
+  if (!channel_->LeaveSource(stream_id, id_)) return true;
+  return channel_->GetStream()->Clear(stream_id);
+}
+
+void VideoStreamBus::Subscriber::Close(bool wait_finish) {
+  if (!channel_) return;
+  std::unique_lock<std::mutex> lk(video::g_channels_mtx);
+  if (channel_->GetSubscriberCount() > 1) {
+    channel_->RemoveSubscriber(id_);
+    lk.unlock();
+    channel_->LeaveSources(id_);
+  } else {
+    // no one can join the channel after it is erased, close the video stream with the events still delivered to us
+    auto search = video::g_channels.find(channel_->GetKey());
+    if (search != video::g_channels.end() && search->second == channel_) video::g_channels.erase(search);
+    lk.unlock();
+    channel_->Close(wait_finish);
+    channel_->RemoveSubscriber(id_);
+  }
+  channel_.reset();
+}
+
+size_t VideoStreamBus::Subscriber::GetSubscriberCount() const {
+  if (!channel_) return 0;
+  return channel_->GetSubscriberCount();
+}
+
+bool VideoStreamBus::Subscriber::SetBitRate(int bit_rate) {
+  if (!channel_ || !channel_->GetStream()) return false;
+  return channel_->GetStream()->SetBitRate(bit_rate);
+}
+
+void VideoStreamBus::Subscriber::SetFrameRate(double frame_rate) {
+  if (channel_ && channel_->GetStream()) channel_->GetStream()->SetFrameRate(frame_rate);
+}
+
+uint64_t VideoStreamBus::Subscriber::GetRateDroppedFrames() const {
+  if (!channel_ || !channel_->GetStream()) return 0;
+  return channel_->GetStream()->GetRateDroppedFrames();
+}
+
+int VideoStreamBus::Subscriber::GetPacket(VideoPacket *packet, PacketInfo *info) {
+  if (!queue_) return -1;
+  std::lock_guard<std::mutex> lk(queue_mtx_);
+  if (info) memset(info, 0, sizeof(PacketInfo));
+  int ret = 0;
+  VideoPacket header;
+  if (queue_->Size() > sizeof(VideoPacket)) {
+    queue_->Read(reinterpret_cast<uint8_t *>(&header), sizeof(VideoPacket), true);
+    ret = header.size;
+    if (!packet) {
+      /* skip packet */
+      queue_->Read(nullptr, sizeof(VideoPacket) + header.size);
+    } else if (!packet->data) {
+      /* get packet size */
+      *packet = header;
+    } else {
+      /* read out packet data, the truncated data is dropped */
+      uint8_t *data = packet->data;
+      uint32_t size = std::min(packet->size, header.size);
+      queue_->Read(nullptr, sizeof(VideoPacket));
+      queue_->Read(data, size);
+      if (size < header.size) queue_->Read(nullptr, header.size - size);
+      *packet = header;
+      packet->data = data;
+      packet->size = size;
+      ret = size;
+    }
+  }
+  if (info) {
+    info->buffer_size = queue_->Size();
+    info->buffer_capacity = queue_->Capacity();
+  }
+  return ret;
+}
+
+void VideoStreamBus::Subscriber::OnPacket(const VideoPacket *packet) {
+  if (wait_key_frame_) {
+    if (!packet->IsKey()) return;
+    wait_key_frame_ = false;
+  }
+  if (packet_callback_) {
+    packet_callback_(packet);
+    return;
+  }
+  if (!queue_) return;
+  std::lock_guard<std::mutex> lk(queue_mtx_);
+  if (queue_->Capacity() - queue_->Size() < sizeof(VideoPacket) + packet->size) {
+    LOGW(VideoStreamBus) << "OnPacket() packet queue is full, drop packets until next key frame";
+    wait_key_frame_ = true;
+    return;
+  }
+  VideoPacket header = *packet;
+  header.data = nullptr;
+  queue_->Write(reinterpret_cast<const uint8_t *>(&header), sizeof(VideoPacket));
+  queue_->Write(packet->data, packet->size);
+}
+
+void VideoStreamBus::Subscriber::OnEvent(Event event) {
+  if (event_callback_) event_callback_(event);
+}
+
+}  // namespace cnstream
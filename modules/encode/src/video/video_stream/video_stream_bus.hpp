@@ -0,0 +1,117 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef __VIDEO_STREAM_BUS_HPP__
+#define __VIDEO_STREAM_BUS_HPP__
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../circular_buffer.hpp"
+#include "video_stream.hpp"
+
+namespace cnstream {
+
+namespace video { class BusChannel; }
+
+/**
+ * VideoStreamBus shares one encoder among the consumers of a channel, e.g. an Encode and a RtspSink module sinking the
+ * same stream. The channel is identified by a name and all the video stream parameters, so that only consumers
+ * asking for the same bitstream share the encoder. The first subscriber opens the video stream, the encoded packets
+ * are published to every subscriber, and the video stream is closed when the last subscriber leaves.
+ */
+class VideoStreamBus {
+ public:
+  using Param = VideoStream::Param;
+  using ColorFormat = VideoStream::ColorFormat;
+  using Buffer = VideoStream::Buffer;
+  using PacketInfo = VideoStream::PacketInfo;
+  using Event = VideoStream::Event;
+  using EventCallback = VideoStream::EventCallback;
+  // packet data is only valid during the call
+  using PacketCallback = std::function<void(const VideoPacket *packet)>;
+
+  class Subscriber {
+   public:
+    ~Subscriber();
+
+    /**
+     * When the channel is shared, frames with frame_index not greater than the last one updated to the source stream
+     * by any subscriber are skipped, so each frame is encoded once no matter how many subscribers update it. A negative
+     * frame_index is always updated. rois are the regions of interest of the frame, see VideoStream::Update.
+     */
+    bool Update(const cv::Mat &mat, ColorFormat color, int64_t timestamp, const std::string &stream_id,
+                int64_t frame_index, const std::vector<VideoRoi> *rois = nullptr);
+    bool Update(const Buffer *buffer, int64_t timestamp, const std::string &stream_id, int64_t frame_index,
+                const std::vector<VideoRoi> *rois = nullptr);
+    // the source stream is cleared after all subscribers who have updated it clear it
+    bool Clear(const std::string &stream_id);
+    // leaves the channel, the video stream is closed if it is the last subscriber
+    void Close(bool wait_finish = false);
+
+    /**
+     * Packets are queued for subscribers without packet callback, and read out with the same semantic as
+     * VideoStream::GetPacket. Packets truncated by a small packet buffer are dropped.
+     */
+    int GetPacket(VideoPacket *packet, PacketInfo *info = nullptr);
+    size_t GetSubscriberCount() const;
+    // changes the encoding of the channel, which applies to all subscribers
+    bool SetBitRate(int bit_rate);
+    void SetFrameRate(double frame_rate);
+    // gets the frames of the channel dropped by SetFrameRate
+    uint64_t GetRateDroppedFrames() const;
+
+   private:
+    friend class VideoStreamBus;
+    friend class video::BusChannel;
+    Subscriber() = default;
+    Subscriber(const Subscriber &) = delete;
+    Subscriber &operator=(const Subscriber &) = delete;
+
+    void OnPacket(const VideoPacket *packet);
+    void OnEvent(Event event);
+
+    int id_ = -1;
+    std::shared_ptr<video::BusChannel> channel_ = nullptr;
+    PacketCallback packet_callback_ = nullptr;
+    EventCallback event_callback_ = nullptr;
+    bool wait_key_frame_ = false;  // joined a running channel, packets before the next key frame are dropped
+    std::mutex queue_mtx_;
+    std::unique_ptr<video::CircularBuffer> queue_ = nullptr;
+  };
+
+  /**
+   * Subscribes to the bitstream of channel encoded with param.
+   *
+   * @param packet_callback Called with each encoded packet. Packets are queued for GetPacket if it is nullptr.
+   * @param event_callback Called with the video stream events, EVENT_DATA is notified after the packet is published.
+   *
+   * @return Returns the subscriber, or nullptr if the video stream of the channel fails to open.
+   */
+  static std::unique_ptr<Subscriber> Subscribe(const std::string &channel, const Param &param,
+                                               PacketCallback packet_callback, EventCallback event_callback);
+};  // VideoStreamBus
+
+}  // namespace cnstream
+
+#endif  // __VIDEO_STREAM_BUS_HPP__
@@ -0,0 +1,181 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_FRAME_SYNC_HPP_
+#define MODULES_FRAME_SYNC_HPP_
+
+/**
+ *  @file frame_sync.hpp
+ *
+ *  This file contains a declaration of the FrameSync class.
+ */
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_module.hpp"
+
+namespace cnstream {
+
+/**
+ * @struct FrameSyncGroup
+ *
+ * @brief FrameSyncGroup is a group of frames taken by the cameras of a stream group at nearly the same time.
+ */
+struct FrameSyncGroup {
+  uint32_t group_index = 0;                          ///< The index of the stream group in ``stream_groups``.
+  uint64_t group_id = 0;                             ///< The sequence number of the group in its stream group.
+  int64_t timestamp = 0;                             ///< The earliest timestamp of the frames.
+  std::vector<std::string> stream_ids;               ///< The streams of the stream group, in the configured order.
+  std::vector<std::weak_ptr<CNFrameInfo>> frames;    ///< The frames, in the order of ``stream_ids``.
+};
+
+using FrameSyncGroupPtr = std::shared_ptr<FrameSyncGroup>;
+
+/*!< value type in CNFrameInfo::Collection : FrameSyncGroupPtr, the group the frame belongs to. */
+static constexpr char kFrameSyncGroupTag[] = "FrameSyncGroup";
+
+/**
+ * @class FrameSync
+ *
+ * @brief FrameSync groups the frames of several cameras by their timestamps, e.g. the two cameras of a stereo rig, so
+ * that the downstream modules process the views of the same moment together.
+ *
+ * The streams are configured into stream groups by ``stream_groups``, e.g. ``"left,right;cam2,cam3,cam4"``. The
+ * frames of a stream group are buffered until every stream has a frame whose timestamp is within ``tolerance`` of
+ * the others. Then one frame of each stream is sent as a group, one after another, each carrying the same
+ * FrameSyncGroup in its collection tagged by kFrameSyncGroupTag. A downstream module with ``max_batch_size`` equal to
+ * the size of the group and ``parallelism`` 1 receives the group in one ProcessBatch call, e.g. to run inference on
+ * the views as one batch.
+ *
+ * The frames are buffered at most ``max_buffered_frames`` per stream. The frames that could never be grouped, i.e.
+ * older than the frames of the other streams by more than ``tolerance``, beyond the buffer limit, or waiting for a
+ * stream which has ended, are handled by ``drop_policy``: ``drop`` discards them and ``pass`` sends them alone
+ * without a FrameSyncGroup. The frames of each stream are always sent in order, the frames of streams not in any
+ * stream group are sent at once.
+ *
+ * The timestamps of the streams of a group are required to come from the same clock and in the same unit, which
+ * ``tolerance`` is in.
+ */
+class FrameSync : public Module, public ModuleCreator<FrameSync> {
+ public:
+  /**
+   * @brief Constructs a FrameSync object.
+   *
+   * @param[in] name The name of this module.
+   *
+   * @return No return value.
+   */
+  explicit FrameSync(const std::string &name);
+
+  /**
+   * @brief Destructs a FrameSync object.
+   *
+   * @return No return value.
+   */
+  ~FrameSync();
+
+  /**
+   * @brief Parses the stream groups.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Releases the frames buffered, they are not sent.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+
+  /**
+   * @brief Buffers a frame of a stream group and sends the groups completed by it.
+   *
+   * @param[in] data The frame.
+   *
+   * @return Returns 1, the frames are sent by this module.
+   */
+  int Process(std::shared_ptr<CNFrameInfo> data) override;
+
+  /**
+   * @brief Checks the parameters of this module.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool CheckParamSet(const ModuleParamSet &paramSet) const override;
+
+  /**
+   * @brief The pixels are never read by this module.
+   *
+   * @return Returns false.
+   */
+  bool NeedsPixels() const override { return false; }
+
+  /**
+   * @brief Gets the number of groups sent since the module is opened.
+   *
+   * @return Returns the number of groups.
+   */
+  uint64_t GetGroupCount() const { return group_count_; }
+
+  /**
+   * @brief Gets the number of frames dropped or sent alone since the module is opened.
+   *
+   * @return Returns the number of frames.
+   */
+  uint64_t GetUnsyncedCount() const { return unsynced_count_; }
+
+ private:
+  struct StreamQueue {
+    std::string stream_id;
+    std::deque<std::shared_ptr<CNFrameInfo>> frames;
+    bool ended = false;  // EOS is received, the frames of the others waiting for this stream are not grouped
+  };
+  struct GroupContext {
+    uint32_t index = 0;
+    uint64_t next_group_id = 0;
+    std::mutex mutex;  // guards the queues, the groups are sent with it locked so that the order of frames is kept
+    std::vector<StreamQueue> queues;
+  };
+  void Flush(GroupContext *group);
+  void Release(const std::shared_ptr<CNFrameInfo> &data);
+
+  int64_t tolerance_ = 40;
+  size_t max_buffered_frames_ = 8;
+  bool drop_unsynced_ = true;
+  std::vector<std::unique_ptr<GroupContext>> groups_;
+  std::unordered_map<std::string, std::pair<GroupContext *, size_t>> stream_map_;  // stream id to group and queue
+  std::atomic<uint64_t> group_count_{0};
+  std::atomic<uint64_t> unsynced_count_{0};
+};  // class FrameSync
+
+}  // namespace cnstream
+
+#endif  // MODULES_FRAME_SYNC_HPP_
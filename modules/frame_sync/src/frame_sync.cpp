@@ -0,0 +1,242 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "frame_sync.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+namespace {
+
+std::vector<std::string> Split(const std::string &value, char delimiter) {
+  std::vector<std::string> items;
+  std::istringstream ss(value);
+  std::string item;
+  while (std::getline(ss, item, delimiter)) {
+    item.erase(0, item.find_first_not_of(" \t"));
+    item.erase(item.find_last_not_of(" \t") + 1);
+    items.push_back(item);
+  }
+  return items;
+}
+
+}  // namespace
+
+FrameSync::FrameSync(const std::string &name) : Module(name) {
+  hasTransmit_.store(true);
+  param_register_.SetModuleDesc("FrameSync is a module which groups the frames of several cameras by their"
+      " timestamps, so that the downstream modules process the views of the same moment together.");
+  param_register_.Register("stream_groups", "The stream groups separated by ';', the streams of a group are separated"
+      " by ',', e.g. \"left,right;cam2,cam3,cam4\". A stream belongs to one group at most.");
+  param_register_.Register("tolerance", "The max difference of the timestamps of the frames in a group, in the unit"
+      " of the timestamps. Default is 40.");
+  param_register_.Register("max_buffered_frames", "The max number of frames buffered for each stream. Default is 8.");
+  param_register_.Register("drop_policy", "How the frames which could not be grouped are handled, drop or pass."
+      " Default is drop.");
+}
+
+FrameSync::~FrameSync() { Close(); }
+
+bool FrameSync::Open(ModuleParamSet paramSet) {
+  if (!CheckParamSet(paramSet)) return false;
+  Close();
+  auto get = [&paramSet](const std::string &key, const std::string &default_value) {
+    return paramSet.find(key) != paramSet.end() ? paramSet[key] : default_value;
+  };
+  tolerance_ = std::stoll(get("tolerance", "40"));
+  max_buffered_frames_ = std::stoul(get("max_buffered_frames", "8"));
+  drop_unsynced_ = get("drop_policy", "drop") == "drop";
+  for (const auto &streams : Split(paramSet["stream_groups"], ';')) {
+    std::unique_ptr<GroupContext> group(new GroupContext);
+    group->index = groups_.size();
+    for (const auto &stream_id : Split(streams, ',')) {
+      stream_map_[stream_id] = std::make_pair(group.get(), group->queues.size());
+      group->queues.emplace_back();
+      group->queues.back().stream_id = stream_id;
+    }
+    groups_.push_back(std::move(group));
+  }
+  group_count_ = 0;
+  unsynced_count_ = 0;
+  return true;
+}
+
+void FrameSync::Close() {
+  for (auto &group : groups_) {
+    std::lock_guard<std::mutex> lk(group->mutex);
+    size_t buffered = 0;
+    for (auto &queue : group->queues) buffered += queue.frames.size();
+    if (buffered) {
+      LOGW(FrameSync) << "[" << GetName() << "] " << buffered << " frames of stream group " << group->index
+                      << " are released without being sent";
+    }
+  }
+  stream_map_.clear();
+  groups_.clear();
+}
+
+int FrameSync::Process(std::shared_ptr<CNFrameInfo> data) {
+  auto it = stream_map_.find(data->stream_id);
+  if (it == stream_map_.end()) {
+    TransmitData(data);
+    return 1;
+  }
+  GroupContext *group = it->second.first;
+  std::lock_guard<std::mutex> lk(group->mutex);
+  StreamQueue &queue = group->queues[it->second.second];
+  if (data->IsEos()) {
+    queue.ended = true;
+    Flush(group);
+    // the frames left are never grouped, they are sent before the EOS
+    while (!queue.frames.empty()) {
+      Release(queue.frames.front());
+      queue.frames.pop_front();
+    }
+    TransmitData(data);
+    return 1;
+  }
+  queue.ended = false;  // the stream may be added again after its EOS
+  queue.frames.push_back(data);
+  Flush(group);
+  return 1;
+}
+
+void FrameSync::Flush(GroupContext *group) {
+  // the timestamps of a stream are increasing, a frame is given up once the head of another stream is later than it
+  // by more than the tolerance, for the other stream has no frame to pair with it anymore.
+  auto &queues = group->queues;
+  while (true) {
+    StreamQueue *oldest = nullptr;
+    int64_t min_ts = 0, max_ts = 0;
+    bool complete = true;
+    bool stream_ended = false;  // a stream without frames has ended, the others could not be grouped
+    for (auto &queue : queues) {
+      if (queue.frames.empty()) {
+        complete = false;
+        stream_ended = stream_ended || queue.ended;
+        continue;
+      }
+      const int64_t ts = queue.frames.front()->timestamp;
+      max_ts = oldest ? std::max(max_ts, ts) : ts;
+      if (!oldest || ts < min_ts) {
+        oldest = &queue;
+        min_ts = ts;
+      }
+    }
+    if (!oldest) return;
+
+    if (complete && max_ts - min_ts <= tolerance_) {
+      FrameSyncGroupPtr sync_group = std::make_shared<FrameSyncGroup>();
+      sync_group->group_index = group->index;
+      sync_group->group_id = group->next_group_id++;
+      sync_group->timestamp = min_ts;
+      std::vector<std::shared_ptr<CNFrameInfo>> frames;
+      frames.reserve(queues.size());
+      for (auto &queue : queues) {
+        frames.push_back(queue.frames.front());
+        queue.frames.pop_front();
+        sync_group->stream_ids.push_back(queue.stream_id);
+        sync_group->frames.push_back(frames.back());
+      }
+      for (auto &frame : frames) {
+        frame->collection.AddIfNotExists(kFrameSyncGroupTag, sync_group);
+        TransmitData(frame);
+      }
+      ++group_count_;
+      continue;
+    }
+    if (complete || stream_ended || max_ts - min_ts > tolerance_) {
+      Release(oldest->frames.front());
+      oldest->frames.pop_front();
+      continue;
+    }
+    // waiting for the streams without frames, as long as the buffers are not full
+    auto full = std::find_if(queues.begin(), queues.end(),
+                             [this](const StreamQueue &queue) { return queue.frames.size() > max_buffered_frames_; });
+    if (full == queues.end()) return;
+    Release(full->frames.front());
+    full->frames.pop_front();
+  }
+}
+
+void FrameSync::Release(const std::shared_ptr<CNFrameInfo> &data) {
+  ++unsynced_count_;
+  if (!drop_unsynced_) TransmitData(data);
+}
+
+bool FrameSync::CheckParamSet(const ModuleParamSet &paramSet) const {
+  ParametersChecker checker;
+  for (auto &it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOGW(FrameSync) << "[" << GetName() << "] Unknown param: " << it.first;
+    }
+  }
+  std::string err_msg;
+  if (!checker.IsNum({"tolerance", "max_buffered_frames"}, paramSet, err_msg, true)) {
+    LOGE(FrameSync) << "[" << GetName() << "] " << err_msg;
+    return false;
+  }
+  if (paramSet.find("max_buffered_frames") != paramSet.end() &&
+      (std::stoi(paramSet.at("max_buffered_frames")) <= 0 || std::stoi(paramSet.at("max_buffered_frames")) > 1024)) {
+    LOGE(FrameSync) << "[" << GetName() << "] [max_buffered_frames] should be in [1, 1024]";
+    return false;
+  }
+  if (paramSet.find("drop_policy") != paramSet.end() && paramSet.at("drop_policy") != "drop" &&
+      paramSet.at("drop_policy") != "pass") {
+    LOGE(FrameSync) << "[" << GetName() << "] [drop_policy] should be drop or pass";
+    return false;
+  }
+  if (paramSet.find("stream_groups") == paramSet.end()) {
+    LOGE(FrameSync) << "[" << GetName() << "] [stream_groups] should be set";
+    return false;
+  }
+  std::set<std::string> streams;
+  for (const auto &group : Split(paramSet.at("stream_groups"), ';')) {
+    std::vector<std::string> stream_ids = Split(group, ',');
+    if (stream_ids.size() < 2) {
+      LOGE(FrameSync) << "[" << GetName() << "] [stream_groups] a stream group should have 2 streams at least: \""
+                      << group << "\"";
+      return false;
+    }
+    for (const auto &stream_id : stream_ids) {
+      if (stream_id.empty() || !streams.insert(stream_id).second) {
+        LOGE(FrameSync) << "[" << GetName() << "] [stream_groups] the stream ids should not be empty or repeated: \""
+                        << stream_id << "\"";
+        return false;
+      }
+    }
+  }
+  if (streams.empty()) {
+    LOGE(FrameSync) << "[" << GetName() << "] [stream_groups] should not be empty";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace cnstream
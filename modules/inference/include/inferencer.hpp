@@ -104,6 +104,28 @@ class Inferencer : public Module, public ModuleCreator<Inferencer> {
    *   use_scaler: Optional. Whether use the scaler to preprocess the input. The scaler will not be used by default.
    *   device_id: Optional. MLU device ordinal number. The default value is 0.
    *   batching_timeout: Optional. The batching timeout. The default value is 3000.0[ms]. type[float]. unit[ms].
+   *   adaptive_batching: Optional. Close partial batches by the estimated arrival rate and compute latency instead of
+                          the fixed batching_timeout, which becomes the upper bound of the wait time. A partial batch
+                          is closed when the next frame is not expected to arrive in time to meet latency_slo. The
+                          batch sizes and wait times are logged when the module is closed. False by default.
+   *   latency_slo: Optional. The latency objective used by adaptive_batching. The default value is 0, which means
+                    batching_timeout is used. type[float]. unit[ms].
+   *   io_buffer_num: Optional. The number of input and output buffers, value range is 1 to 4. With 2 or 3 buffers,
+                      the next batch is preprocessed and copied to device while the previous batches are running on
+                      the device and postprocessing. The default value is 1. type[uint32].
+   *   obj_batching_order: Optional. The order of the objects in one batch, valid when object_infer is true.
+                           none/size/aspect_ratio. With size or aspect_ratio, the objects are preprocessed when the
+                           batch is closed, grouped by size or aspect ratio bucket, so similar crops from many
+                           frames and streams are resized together. The default value is none.
+   *   obj_infer_interval: Optional. Inferring interval of one track (track_id set by Tracker), valid when object_infer
+                           is true. Objects of a track inferred less than obj_infer_interval frames ago are skipped,
+                           the cached attributes, extra attributes and features of the track are copied to them.
+                           New tracks and objects without track_id are always inferred. The default value is 1, which
+                           means all objects are inferred. type[uint32].
+   *   obj_box_growth: Optional. Infers the object again when its box area is (1 + obj_box_growth) times the area at
+                       the last inference of the track. The default value is 0, which means disabled. type[float].
+   *   obj_score_gain: Optional. Infers the object again when its score is obj_score_gain higher than the score at the
+                       last inference of the track. The default value is 0, which means disabled. type[float].
    *   data_order: Optional. Data format. The default format is NHWC.
    *   threshold: Optional. The threshold of the confidence. By default it is 0.
    *   infer_interval: Optional. Process one frame for every ``infer_interval`` frames.
@@ -117,7 +139,8 @@ class Inferencer : public Module, public ModuleCreator<Inferencer> {
    *                             model input image. RGBA32 by default.
    *   mem_on_mlu_for_postproc: Optional. Pass a batch mlu pointer directly to post-processing function without
                                 making d2h copies. see `Postproc` for details.
-   *   saving_infer_input: Optional. Save the data close to inferencing.
+   *   saving_infer_input: Optional. Save the data close to inferencing. The data is kept in CNInferData by the id of
+                           the module, the input stays on the MLU until it is read.
    *   pad_method: Optional. When use mlu preprocessing, set the pad method. set pad_method = "center", image in center;
                               set the pad_method = "origin". image in top left corner.
    *                          if not set this param, the default value is "center"
@@ -153,6 +176,41 @@ class Inferencer : public Module, public ModuleCreator<Inferencer> {
    */
   bool CheckParamSet(const ModuleParamSet &param_set) const override;
 
+  /**
+   * @brief Checks the parameters overridden for a stream. Only ``infer_interval`` and ``threshold`` can be
+   * overridden, the other parameters are bound to the engines shared by the streams.
+   *
+   * @param[in] params The parameters overridden.
+   *
+   * @return Returns true if the parameters can be overridden.
+   *
+   * @see Pipeline::SetStreamParams
+   */
+  bool CheckStreamParams(const ModuleParamSet &params) const override;
+
+  /**
+   * @brief Overrides ``infer_interval`` and ``threshold`` for a stream.
+   *
+   * @param[in] stream_index The stream index.
+   * @param[in] params The parameters overridden, empty to restore the parameters of the module.
+   *
+   * @note The postprocessing filters the results by the ``threshold`` of the module, the overridden threshold removes
+   * the objects detected on the frames of the stream with lower scores. It is not applied when ``object_infer`` is
+   * true, and takes no effect when it is lower than the ``threshold`` of the module.
+   */
+  void SetStreamParams(uint32_t stream_index, const ModuleParamSet &params) override;
+
+  /**
+   * @brief Gets the input resolution of the model, frames in this resolution are not resized by preprocessing.
+   *
+   * @param[out] width The width of the model input.
+   * @param[out] height The height of the model input.
+   *
+   * @return Returns false if the module is not opened or object_infer is true, the objects are cropped from
+   *         frames in the original resolution then.
+   */
+  bool GetPreferredFrameSize(uint32_t *width, uint32_t *height) const override;
+
  private:
   InferParamManager *param_manager_ = nullptr;
   DECLARE_PRIVATE(d_ptr_, Inferencer);
@@ -110,6 +110,32 @@ class Postproc : virtual public ReflexObjectEx<Postproc> {
    */
   virtual int Execute(const std::vector<void*>& net_outputs, const std::shared_ptr<edk::ModelLoader>& model,
                       const std::vector<CNFrameInfoPtr> &packages) { return 0; }
+  /**
+   * @brief Checks whether the frames of a batch are postprocessed by one call of ExecuteBatch, instead of one call
+   * of Execute for each frame.
+   *
+   * @return Returns false by default.
+   */
+  virtual bool IsBatchExecute() const { return false; }
+  /**
+   * @brief Executes postproc on the neural network outputs of a batch.
+   *
+   * @param[in] net_outputs Neural network outputs of the batch, and the data is stored on the host. The outputs of the
+   *                        frames are consecutive, output ``i`` of frame ``b`` starts at
+   *                        ``net_outputs[i] + b * model->OutputShape(i).DataCount()``.
+   * @param[in] model Model information including input shape and output shape.
+   * @param[in,out] packages The frames of the batch.
+   *
+   * @return Returns 0 if successful, otherwise returns -1.
+   *
+   * @note
+   * - This function is called by the Inferencer module instead of Execute when the parameter
+   *   ``mem_on_mlu_for_postproc`` is set to false, ``obj_infer`` is set to false and IsBatchExecute returns true.
+   *   It is called on one thread for the whole batch, the frames of the removed streams are included.
+   *   By default, Execute is called on each frame.
+   */
+  virtual int ExecuteBatch(const std::vector<float*>& net_outputs, const std::shared_ptr<edk::ModelLoader>& model,
+                           const std::vector<CNFrameInfoPtr>& packages);
 
  protected:
   float threshold_ = 0;
@@ -188,6 +214,30 @@ class ObjPostproc : virtual public ReflexObjectEx<ObjPostproc> {
                       const std::vector<std::pair<CNFrameInfoPtr, std::shared_ptr<CNInferObject>>>& obj_infos) {
     return 0;
   }
+  /**
+   * @brief Checks whether the objects of a batch are postprocessed by one call of ExecuteBatch, instead of one call
+   * of Execute for each object.
+   *
+   * @return Returns false by default.
+   */
+  virtual bool IsBatchExecute() const { return false; }
+  /**
+   * @brief Executes post processing on the neural network outputs of a batch.
+   *
+   * @param[in] net_outputs Neural network outputs of the batch, and the data is stored on the host. The outputs of the
+   *                        objects are consecutive, see Postproc::ExecuteBatch.
+   * @param[in] model Model information including input shape and output shape.
+   * @param[in,out] obj_infos The objects of the batch and their frames.
+   *
+   * @return Returns 0 if successful, otherwise returns -1.
+   *
+   * @note
+   * - This function is called by the Inferencer module instead of Execute when the parameter
+   *   ``mem_on_mlu_for_postproc`` is set to false, ``obj_infer`` is set to true and IsBatchExecute returns true.
+   *   By default, Execute is called on each object.
+   */
+  virtual int ExecuteBatch(const std::vector<float*>& net_outputs, const std::shared_ptr<edk::ModelLoader>& model,
+                           const std::vector<std::pair<CNFrameInfoPtr, std::shared_ptr<CNInferObject>>>& obj_infos);
 
  protected:
   float threshold_ = 0;
@@ -0,0 +1,122 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "adaptive_batching.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace cnstream {
+
+std::string BatchingStats::ToString() const {
+  std::ostringstream ss;
+  ss << "batches: " << batch_cnt << ", items: " << item_cnt << ", avg batch size: " << avg_batch_size
+     << ", closed by [full: " << full_cnt << ", timeout: " << timeout_cnt << ", slo: " << slo_cnt
+     << ", flush: " << flush_cnt << "], wait avg/max: " << avg_wait_ms << "/" << max_wait_ms
+     << "ms, arrival interval: " << arrival_interval_ms << "ms, compute: " << compute_ms << "ms, batch sizes: [";
+  for (size_t i = 1; i < batch_size_hist.size(); ++i) {
+    ss << (i > 1 ? " " : "") << i << ":" << batch_size_hist[i];
+  }
+  ss << "]";
+  return ss.str();
+}
+
+AdaptiveBatchingPolicy::AdaptiveBatchingPolicy(uint32_t batchsize, float latency_slo, float max_timeout, float alpha)
+    : batchsize_(std::max(batchsize, 1u)),
+      latency_slo_(std::max(latency_slo, 0.0f)),
+      max_timeout_(std::max(max_timeout, 0.0f)),
+      alpha_(std::min(std::max(alpha, 0.01f), 1.0f)) {
+  stats_.batch_size_hist.resize(batchsize_ + 1, 0);
+}
+
+double AdaptiveBatchingPolicy::Update(double avg, double sample, bool *inited) const {
+  if (!*inited) {
+    *inited = true;
+    return sample;
+  }
+  return alpha_ * sample + (1 - alpha_) * avg;
+}
+
+float AdaptiveBatchingPolicy::OnArrival(uint32_t batched_num, Clock::time_point now) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (has_last_arrival_) {
+    // idle periods (e.g. a paused stream) are not part of the arrival rate.
+    double gap = std::chrono::duration<double, std::milli>(now - last_arrival_).count();
+    arrival_interval_ms_ = Update(arrival_interval_ms_, std::min(gap, static_cast<double>(latency_slo_)),
+                                  &arrival_inited_);
+  }
+  has_last_arrival_ = true;
+  last_arrival_ = now;
+  if (batched_num <= 1) batch_start_ = now;
+
+  deadline_bound_ = false;
+  if (batched_num >= batchsize_) return 0;
+
+  double elapsed = std::chrono::duration<double, std::milli>(now - batch_start_).count();
+  double remaining = latency_slo_ - compute_ms_ - elapsed;
+  if (remaining <= 0) return 0;
+  // the next item is expected too late to join this batch.
+  if (arrival_inited_ && arrival_interval_ms_ > remaining) return 0;
+  if (remaining < max_timeout_) {
+    deadline_bound_ = true;
+    return static_cast<float>(remaining);
+  }
+  return max_timeout_;
+}
+
+void AdaptiveBatchingPolicy::OnBatchClosed(uint32_t batch_size, BatchCloseReason reason, Clock::time_point now) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (0 == batch_size) return;
+  if (BatchCloseReason::TIMEOUT == reason && deadline_bound_) reason = BatchCloseReason::SLO;
+  deadline_bound_ = false;
+  switch (reason) {
+    case BatchCloseReason::FULL: stats_.full_cnt++; break;
+    case BatchCloseReason::TIMEOUT: stats_.timeout_cnt++; break;
+    case BatchCloseReason::SLO: stats_.slo_cnt++; break;
+    case BatchCloseReason::FLUSH: stats_.flush_cnt++; break;
+  }
+  stats_.batch_cnt++;
+  stats_.item_cnt += batch_size;
+  stats_.batch_size_hist[std::min(batch_size, batchsize_)]++;
+  double wait = std::chrono::duration<double, std::milli>(now - batch_start_).count();
+  total_wait_ms_ += wait;
+  stats_.max_wait_ms = std::max(stats_.max_wait_ms, wait);
+}
+
+void AdaptiveBatchingPolicy::OnBatchComputed(double compute_ms) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  compute_ms_ = Update(compute_ms_, compute_ms, &compute_inited_);
+}
+
+BatchingStats AdaptiveBatchingPolicy::GetStats() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  BatchingStats stats = stats_;
+  if (stats.batch_cnt) {
+    stats.avg_batch_size = static_cast<double>(stats.item_cnt) / stats.batch_cnt;
+    stats.avg_wait_ms = total_wait_ms_ / stats.batch_cnt;
+  }
+  stats.arrival_interval_ms = arrival_interval_ms_;
+  stats.compute_ms = compute_ms_;
+  return stats;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,138 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_SRC_ADAPTIVE_BATCHING_HPP_
+#define MODULES_INFERENCE_SRC_ADAPTIVE_BATCHING_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief Why a batch has been sent to the batching done stages.
+ */
+enum class BatchCloseReason {
+  FULL = 0,  ///< The batch is full.
+  TIMEOUT,   ///< No more data arrived before the batching timeout.
+  SLO,       ///< Waiting for more data would break the latency objective.
+  FLUSH,     ///< The batch is flushed by the caller, e.g. at the end of a stream.
+};
+
+/**
+ * @brief Batching metrics of one inference engine.
+ */
+struct BatchingStats {
+  uint64_t batch_cnt = 0;
+  uint64_t item_cnt = 0;
+  uint64_t full_cnt = 0;
+  uint64_t timeout_cnt = 0;
+  uint64_t slo_cnt = 0;
+  uint64_t flush_cnt = 0;
+  double avg_batch_size = 0;
+  double avg_wait_ms = 0;      ///< Wait time of the first item of each batch.
+  double max_wait_ms = 0;
+  double arrival_interval_ms = 0;  ///< Estimated inter-arrival time.
+  double compute_ms = 0;           ///< Estimated time from batch closing to postprocessing done.
+  std::vector<uint64_t> batch_size_hist;  ///< batch_size_hist[n] is the number of batches with n items.
+
+  std::string ToString() const;
+};  // struct BatchingStats
+
+/**
+ * @brief Decides how long a partial batch may wait for more data.
+ *
+ * The policy keeps exponentially weighted moving averages of the inter-arrival time and of the batch compute
+ * latency. A partial batch is closed as soon as the next item is not expected to arrive before
+ * `first item arrival + latency_slo - compute latency`, so that the first item of the batch still meets the latency
+ * objective. The wait time is never longer than `max_timeout`.
+ *
+ * OnArrival and OnBatchClosed are called by the batching thread, OnBatchComputed by the thread finishing the batch.
+ */
+class AdaptiveBatchingPolicy {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @param batchsize The maximum number of items in one batch.
+   * @param latency_slo The latency objective of one item, unit[ms].
+   * @param max_timeout The upper bound of the batching timeout, unit[ms].
+   * @param alpha Weight of new samples in the moving averages, in (0, 1].
+   */
+  AdaptiveBatchingPolicy(uint32_t batchsize, float latency_slo, float max_timeout, float alpha = 0.2f);
+
+  /**
+   * @brief Records the arrival of an item which has been appended to the current batch.
+   *
+   * @param batched_num The number of items in the current batch, including the new one.
+   * @param now The arrival time.
+   *
+   * @return Returns the time to wait for the next item, unit[ms]. Returns 0 when the batch should be closed now.
+   */
+  float OnArrival(uint32_t batched_num, Clock::time_point now = Clock::now());
+
+  /**
+   * @brief Records a closed batch.
+   *
+   * @param batch_size The number of items in the batch.
+   * @param reason The reason reported by the caller. TIMEOUT is reported as SLO when the last timeout has been
+   *               shortened by the latency objective.
+   * @param now The time the batch is closed.
+   */
+  void OnBatchClosed(uint32_t batch_size, BatchCloseReason reason, Clock::time_point now = Clock::now());
+
+  /**
+   * @brief Records the compute latency of a batch, from closing to postprocessing done.
+   *
+   * @param compute_ms The latency, unit[ms].
+   */
+  void OnBatchComputed(double compute_ms);
+
+  BatchingStats GetStats() const;
+
+  float GetLatencySlo() const { return latency_slo_; }
+
+ private:
+  double Update(double avg, double sample, bool *inited) const;
+
+  const uint32_t batchsize_;
+  const float latency_slo_;
+  const float max_timeout_;
+  const float alpha_;
+
+  mutable std::mutex mtx_;
+  bool arrival_inited_ = false;
+  bool compute_inited_ = false;
+  bool has_last_arrival_ = false;
+  bool deadline_bound_ = false;
+  double arrival_interval_ms_ = 0;
+  double compute_ms_ = 0;
+  Clock::time_point last_arrival_;
+  Clock::time_point batch_start_;
+  double total_wait_ms_ = 0;
+  BatchingStats stats_;
+};  // class AdaptiveBatchingPolicy
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_SRC_ADAPTIVE_BATCHING_HPP_
@@ -44,22 +44,34 @@ namespace cnstream {
 std::vector<std::shared_ptr<InferTask>> H2DBatchingDoneStage::BatchingDone(const BatchingDoneInput& finfos) {
   std::vector<InferTaskSptr> tasks;
   InferTaskSptr task;
-  QueuingTicket cpu_input_res_ticket = cpu_input_res_->PickUpNewTicket();
-  QueuingTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
-  task = std::make_shared<InferTask>([cpu_input_res_ticket, mlu_input_res_ticket, this, finfos]() -> int {
+  IOBufferSptr cpu_input_buf = cpu_input_res_->CurrentBuffer();
+  IOBufferSptr mlu_input_buf = mlu_input_res_->CurrentBuffer();
+  QueuingTicket cpu_input_res_ticket = cpu_input_buf->PickUpNewTicket();
+  QueuingTicket mlu_input_res_ticket = mlu_input_buf->PickUpNewTicket();
+  task = std::make_shared<InferTask>([cpu_input_buf, mlu_input_buf, cpu_input_res_ticket, mlu_input_res_ticket,
+                                      this, finfos]() -> int {
     QueuingTicket cir_ticket = cpu_input_res_ticket;
     QueuingTicket mir_ticket = mlu_input_res_ticket;
-    IOResValue cpu_value = this->cpu_input_res_->WaitResourceByTicket(&cir_ticket);
-    IOResValue mlu_value = this->mlu_input_res_->WaitResourceByTicket(&mir_ticket);
+    IOResValue cpu_value = cpu_input_buf->WaitResourceByTicket(&cir_ticket);
+    IOResValue mlu_value = mlu_input_buf->WaitResourceByTicket(&mir_ticket);
+    if (profiler_) {
+      for (auto it : finfos)
+        profiler_->RecordProcessStart("H2D", it.first->GetStreamIndex(), it.first->stream_id, it.first->timestamp);
+    }
     edk::MluMemoryOp mem_op;
     mem_op.SetModel(this->model_);
 
     mem_op.MemcpyInputH2D(mlu_value.ptrs, cpu_value.ptrs);
 
-    this->cpu_input_res_->DeallingDone();
-    this->mlu_input_res_->DeallingDone();
+    if (profiler_) {
+      for (auto it : finfos)
+        profiler_->RecordProcessEnd("H2D", it.first->GetStreamIndex(), it.first->stream_id, it.first->timestamp);
+    }
+    cpu_input_buf->DeallingDone();
+    mlu_input_buf->DeallingDone();
     return 0;
   });
+  task->priority = InferTaskPriority::DEVICE;
   tasks.push_back(task);
   return tasks;
 }
@@ -68,12 +80,13 @@ std::vector<std::shared_ptr<InferTask>> ResizeConvertBatchingDoneStage::Batching
   std::vector<InferTaskSptr> tasks;
   InferTaskSptr task;
   QueuingTicket rcop_res_ticket = rcop_res_->PickUpNewTicket();
-  QueuingTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
-  task = std::make_shared<InferTask>([rcop_res_ticket, mlu_input_res_ticket, this, finfos]() -> int {
+  IOBufferSptr mlu_input_buf = mlu_input_res_->CurrentBuffer();
+  QueuingTicket mlu_input_res_ticket = mlu_input_buf->PickUpNewTicket();
+  task = std::make_shared<InferTask>([rcop_res_ticket, mlu_input_buf, mlu_input_res_ticket, this, finfos]() -> int {
     QueuingTicket rcopr_ticket = rcop_res_ticket;
     QueuingTicket mir_tickett = mlu_input_res_ticket;
     std::shared_ptr<RCOpValue> rcop_value = this->rcop_res_->WaitResourceByTicket(&rcopr_ticket);
-    IOResValue mlu_value = this->mlu_input_res_->WaitResourceByTicket(&mir_tickett);
+    IOResValue mlu_value = mlu_input_buf->WaitResourceByTicket(&mir_tickett);
     LOGF_IF(INFERENCER, mlu_value.datas.size() != 1) << "Internal error, maybe model input num not 1";
 
     std::shared_ptr<CNFrameInfo> info = nullptr;
@@ -81,23 +94,26 @@ std::vector<std::shared_ptr<InferTask>> ResizeConvertBatchingDoneStage::Batching
 
     if (profiler_) {
       for (auto it : finfos)
-        profiler_->RecordProcessStart("RESIZE CONVERT", std::make_pair(it.first->stream_id, it.first->timestamp));
+        profiler_->RecordProcessStart("RESIZE CONVERT", it.first->GetStreamIndex(),
+                                      it.first->stream_id, it.first->timestamp);
     }
     cnrtMemset(mlu_value.datas[0].ptr, 0, mlu_value.datas[0].batch_offset * finfos.size());
 
     bool ret = rcop_value->op.SyncOneOutput(mlu_value.datas[0].ptr);
     if (profiler_) {
       for (auto it : finfos)
-        profiler_->RecordProcessEnd("RESIZE CONVERT", std::make_pair(it.first->stream_id, it.first->timestamp));
+        profiler_->RecordProcessEnd("RESIZE CONVERT", it.first->GetStreamIndex(),
+                                    it.first->stream_id, it.first->timestamp);
     }
     this->rcop_res_->DeallingDone();
-    this->mlu_input_res_->DeallingDone();
+    mlu_input_buf->DeallingDone();
 
     if (!ret) {
       throw CnstreamError("resize convert failed.");
     }
     return 0;
   });
+  task->priority = InferTaskPriority::DEVICE;
   tasks.push_back(task);
   return tasks;
 }
@@ -114,25 +130,33 @@ InferBatchingDoneStage::InferBatchingDoneStage(std::shared_ptr<edk::ModelLoader>
   easyinfer_->Init(model_, dev_id);
 }
 
-InferBatchingDoneStage::~InferBatchingDoneStage() {}
+InferBatchingDoneStage::~InferBatchingDoneStage() {
+  if (saved_output_res_) saved_output_res_->Destroy();
+}
 
 std::shared_ptr<edk::MluTaskQueue> InferBatchingDoneStage::SharedMluQueue() const { return easyinfer_->GetMluQueue(); }
 
 std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(const BatchingDoneInput& finfos) {
   std::vector<InferTaskSptr> tasks;
   InferTaskSptr task;
-  QueuingTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
-  QueuingTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket();
-  task = std::make_shared<InferTask>([mlu_input_res_ticket, mlu_output_res_ticket, this, finfos]() -> int {
+  IOBufferSptr mlu_input_buf = mlu_input_res_->CurrentBuffer();
+  IOBufferSptr mlu_output_buf = mlu_output_res_->CurrentBuffer();
+  QueuingTicket mlu_input_res_ticket = mlu_input_buf->PickUpNewTicket();
+  QueuingTicket mlu_output_res_ticket = mlu_output_buf->PickUpNewTicket();
+  task = std::make_shared<InferTask>([mlu_input_buf, mlu_output_buf, mlu_input_res_ticket, mlu_output_res_ticket,
+                                      this, finfos]() -> int {
     QueuingTicket mir_ticket = mlu_input_res_ticket;
     QueuingTicket mor_ticket = mlu_output_res_ticket;
-    IOResValue mlu_input_value = this->mlu_input_res_->WaitResourceByTicket(&mir_ticket);
-    IOResValue mlu_output_value = this->mlu_output_res_->WaitResourceByTicket(&mor_ticket);
+    IOResValue mlu_input_value = mlu_input_buf->WaitResourceByTicket(&mir_ticket);
+    IOResValue mlu_output_value = mlu_output_buf->WaitResourceByTicket(&mor_ticket);
+    // batches on different buffers may reach here at the same time, but the model runs one batch at a time.
+    std::lock_guard<std::mutex> run_lk(this->run_mutex_);
 
     std::shared_ptr<CNFrameInfo> info = nullptr;
     if (profiler_) {
       for (auto it : finfos)
-        profiler_->RecordProcessStart("RUN MODEL", std::make_pair(it.first->stream_id, it.first->timestamp));
+        profiler_->RecordProcessStart("RUN MODEL", it.first->GetStreamIndex(),
+                                      it.first->stream_id, it.first->timestamp);
     }
     if (!dump_resized_image_dir_.empty()) {
       int batch_offset = mlu_input_value.datas[0].batch_offset;
@@ -143,7 +167,7 @@ std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(con
         cnrtMemcpy(reinterpret_cast<void*>(cpu_input_value.data()), data.ptr, len, CNRT_MEM_TRANS_DIR_DEV2HOST);
         for (int i = 0; i < frame_num; i++) {
           info = finfos[i].first;
-          CNDataFramePtr frame = info->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+          CNDataFramePtr frame = info->collection.Get(kCNDataFrameSlot);
           char* img = reinterpret_cast<char*>(cpu_input_value.data()) + batch_offset * i;
           cv::Mat bgr(data.shape.H(), data.shape.W(), CV_8UC3);
           cv::Mat bgra(data.shape.H(), data.shape.W(), CV_8UC4, img);
@@ -196,10 +220,12 @@ std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(con
     if (saving_infer_input_) {
       int frame_num = finfos.size();
 
-      // alloc cpu memory to save model output
-      CpuOutputResource alloc_cpu_output_mem(this->easyinfer_->Model(), batchsize_);
-      alloc_cpu_output_mem.Init();
-      IOResValue cpu_output_value = alloc_cpu_output_mem.GetDataDirectly();
+      // the cpu outputs are reused by the batches, they are copied into the tensors of the frames below
+      if (!saved_output_res_) {
+        saved_output_res_.reset(new CpuOutputResource(this->easyinfer_->Model(), batchsize_));
+        saved_output_res_->Init();
+      }
+      IOResValue cpu_output_value = saved_output_res_->GetDataDirectly();
       edk::MluMemoryOp mem_op;
       mem_op.SetModel(this->easyinfer_->Model());
       mem_op.MemcpyOutputD2H(cpu_output_value.ptrs, mlu_output_value.ptrs);
@@ -215,47 +241,40 @@ std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(con
           iodata->input_fmt_ = model_input_fmt_;
           iodata->output_num_ = cpu_output_value.datas.size();
 
-          // save model input
-          iodata->input_cpu_addr_ = cnCpuMemAlloc(iodata->input_size_);
-          cnrtMemcpy(iodata->input_cpu_addr_.get(), mlu_input_value.datas[0].Offset(j), iodata->input_size_,
-                     CNRT_MEM_TRANS_DIR_DEV2HOST);
+          // save model input, it stays on the device until it is read
+          iodata->input_ = std::make_shared<CNSyncedMemory>(iodata->input_size_, dev_id_);
+          cnrtMemcpy(iodata->input_->GetMutableMluData(), mlu_input_value.datas[0].Offset(j), iodata->input_size_,
+                     CNRT_MEM_TRANS_DIR_DEV2DEV);
 
           // save model output
           for (size_t k = 0; k < iodata->output_num_; ++k) {
             iodata->output_sizes_.push_back(cpu_output_value.datas[k].shape.DataCount());
-            std::shared_ptr<void> output_cpu_addr = cnCpuMemAlloc(iodata->output_sizes_[k] * sizeof(float*));
-            memcpy(output_cpu_addr.get(),
-                   cpu_output_value.datas[k].Offset(j), sizeof(float*) * iodata->output_sizes_[k]);
-            iodata->output_cpu_addr_.push_back(output_cpu_addr);
+            auto output = std::make_shared<CNSyncedMemory>(iodata->output_sizes_[k] * sizeof(float), dev_id_);
+            memcpy(output->GetMutableCpuData(), cpu_output_value.datas[k].Offset(j),
+                   sizeof(float) * iodata->output_sizes_[k]);
+            iodata->outputs_.push_back(std::move(output));
           }
 
           // save iodata
-          auto data_map = finfos[j].first->collection.Get<CNInferDataPtr>(kCNInferDataTag);
-          std::lock_guard<std::mutex> lk(data_map->mutex_);
-          if (data_map->datas_map_.find(module_name_) != data_map->datas_map_.end()) {
-            data_map->datas_map_[module_name_].push_back(iodata);
-          } else {
-            std::vector<std::shared_ptr<InferData>> vec{iodata};
-            data_map->datas_map_[module_name_] = vec;
-          }
+          finfos[j].first->collection.Get(kCNInferDataSlot)->Add(module_id_, std::move(iodata));
         }
       } else {
         LOGE(INFERENCER) << "Module input num is " << mlu_input_value.datas.size()
                          << " , input num not supports greater than 1!";
       }
-      alloc_cpu_output_mem.Destroy();
     }
 
     if (profiler_) {
       for (auto it : finfos)
-        profiler_->RecordProcessEnd("RUN MODEL", std::make_pair(it.first->stream_id, it.first->timestamp));
+        profiler_->RecordProcessEnd("RUN MODEL", it.first->GetStreamIndex(), it.first->stream_id, it.first->timestamp);
     }
 
-    this->mlu_input_res_->DeallingDone();
-    this->mlu_output_res_->DeallingDone();
+    mlu_input_buf->DeallingDone();
+    mlu_output_buf->DeallingDone();
 
     return 0;
   });
+  task->priority = InferTaskPriority::DEVICE;
   tasks.push_back(task);
   return tasks;
 }
@@ -263,20 +282,32 @@ std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(con
 std::vector<std::shared_ptr<InferTask>> D2HBatchingDoneStage::BatchingDone(const BatchingDoneInput& finfos) {
   std::vector<InferTaskSptr> tasks;
   InferTaskSptr task;
-  QueuingTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket();
-  QueuingTicket cpu_output_res_ticket = cpu_output_res_->PickUpNewTicket();
-  task = std::make_shared<InferTask>([mlu_output_res_ticket, cpu_output_res_ticket, this]() -> int {
+  IOBufferSptr mlu_output_buf = mlu_output_res_->CurrentBuffer();
+  IOBufferSptr cpu_output_buf = cpu_output_res_->CurrentBuffer();
+  QueuingTicket mlu_output_res_ticket = mlu_output_buf->PickUpNewTicket();
+  QueuingTicket cpu_output_res_ticket = cpu_output_buf->PickUpNewTicket();
+  task = std::make_shared<InferTask>([mlu_output_buf, cpu_output_buf, mlu_output_res_ticket, cpu_output_res_ticket,
+                                      this, finfos]() -> int {
     QueuingTicket mor_ticket = mlu_output_res_ticket;
     QueuingTicket cor_ticket = cpu_output_res_ticket;
-    IOResValue mlu_output_value = this->mlu_output_res_->WaitResourceByTicket(&mor_ticket);
-    IOResValue cpu_output_value = this->cpu_output_res_->WaitResourceByTicket(&cor_ticket);
+    IOResValue mlu_output_value = mlu_output_buf->WaitResourceByTicket(&mor_ticket);
+    IOResValue cpu_output_value = cpu_output_buf->WaitResourceByTicket(&cor_ticket);
+    if (profiler_) {
+      for (auto it : finfos)
+        profiler_->RecordProcessStart("D2H", it.first->GetStreamIndex(), it.first->stream_id, it.first->timestamp);
+    }
     edk::MluMemoryOp mem_op;
     mem_op.SetModel(this->model_);
     mem_op.MemcpyOutputD2H(cpu_output_value.ptrs, mlu_output_value.ptrs);
-    this->mlu_output_res_->DeallingDone();
-    this->cpu_output_res_->DeallingDone();
+    if (profiler_) {
+      for (auto it : finfos)
+        profiler_->RecordProcessEnd("D2H", it.first->GetStreamIndex(), it.first->stream_id, it.first->timestamp);
+    }
+    mlu_output_buf->DeallingDone();
+    cpu_output_buf->DeallingDone();
     return 0;
   });
+  task->priority = InferTaskPriority::DEVICE;
   tasks.push_back(task);
   return tasks;
 }
@@ -295,18 +326,52 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
 std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::BatchingDone(
     const BatchingDoneInput& finfos, const std::shared_ptr<CpuOutputResource>& cpu_output_res) {
   std::vector<InferTaskSptr> tasks;
+  IOBufferSptr cpu_output_buf = cpu_output_res->CurrentBuffer();
+  if (postprocessor_->IsBatchExecute()) {
+    // one task for the whole batch, e.g. python postproc takes the GIL once
+    QueuingTicket cpu_output_res_ticket = cpu_output_buf->PickUpNewTicket(false);
+    tasks.push_back(std::make_shared<InferTask>([cpu_output_res_ticket, cpu_output_buf, this, finfos]() -> int {
+      QueuingTicket cor_ticket = cpu_output_res_ticket;
+      IOResValue cpu_output_value = cpu_output_buf->WaitResourceByTicket(&cor_ticket);
+      if (profiler_) {
+        for (auto it : finfos)
+          profiler_->RecordProcessStart("POSTPROC", it.first->GetStreamIndex(), it.first->stream_id,
+                                        it.first->timestamp);
+      }
+      std::vector<float*> net_outputs;
+      for (size_t output_idx = 0; output_idx < cpu_output_value.datas.size(); ++output_idx) {
+        net_outputs.push_back(reinterpret_cast<float*>(cpu_output_value.datas[output_idx].ptr));
+      }
+      std::vector<CNFrameInfoPtr> batched_finfos;
+      for (const auto& it : finfos) batched_finfos.push_back(it.first);
+
+      this->postprocessor_->ExecuteBatch(net_outputs, this->model_, batched_finfos);
+      if (profiler_) {
+        for (auto it : finfos)
+          profiler_->RecordProcessEnd("POSTPROC", it.first->GetStreamIndex(), it.first->stream_id,
+                                      it.first->timestamp);
+      }
+      cpu_output_buf->DeallingDone();
+      return 0;
+    }));
+    return tasks;
+  }
   for (int bidx = 0; bidx < static_cast<int>(finfos.size()); ++bidx) {
     auto finfo = finfos[bidx];
     QueuingTicket cpu_output_res_ticket;
     if (0 == bidx) {
-      cpu_output_res_ticket = cpu_output_res->PickUpNewTicket(true);
+      cpu_output_res_ticket = cpu_output_buf->PickUpNewTicket(true);
     } else {
-      cpu_output_res_ticket = cpu_output_res->PickUpTicket(true);
+      cpu_output_res_ticket = cpu_output_buf->PickUpTicket(true);
     }
     InferTaskSptr task =
-        std::make_shared<InferTask>([cpu_output_res_ticket, cpu_output_res, this, finfo, bidx]() -> int {
+        std::make_shared<InferTask>([cpu_output_res_ticket, cpu_output_buf, this, finfo, bidx]() -> int {
           QueuingTicket cor_ticket = cpu_output_res_ticket;
-          IOResValue cpu_output_value = cpu_output_res->WaitResourceByTicket(&cor_ticket);
+          IOResValue cpu_output_value = cpu_output_buf->WaitResourceByTicket(&cor_ticket);
+          if (profiler_) {
+            profiler_->RecordProcessStart("POSTPROC", finfo.first->GetStreamIndex(),
+                                          finfo.first->stream_id, finfo.first->timestamp);
+          }
           std::vector<float*> net_outputs;
           for (size_t output_idx = 0; output_idx < cpu_output_value.datas.size(); ++output_idx) {
             net_outputs.push_back(reinterpret_cast<float*>(cpu_output_value.datas[output_idx].Offset(bidx)));
@@ -314,7 +379,11 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
           if (!cnstream::IsStreamRemoved(finfo.first->stream_id)) {
             this->postprocessor_->Execute(net_outputs, this->model_, finfo.first);
           }
-          cpu_output_res->DeallingDone();
+          if (profiler_) {
+            profiler_->RecordProcessEnd("POSTPROC", finfo.first->GetStreamIndex(),
+                                        finfo.first->stream_id, finfo.first->timestamp);
+          }
+          cpu_output_buf->DeallingDone();
           return 0;
         });
     tasks.push_back(task);
@@ -324,12 +393,17 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
 
 std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::BatchingDone(
     const BatchingDoneInput& finfos, const std::shared_ptr<MluOutputResource>& mlu_output_res) {
-  QueuingTicket mlu_output_res_ticket = mlu_output_res->PickUpNewTicket(false);
+  IOBufferSptr mlu_output_buf = mlu_output_res->CurrentBuffer();
+  QueuingTicket mlu_output_res_ticket = mlu_output_buf->PickUpNewTicket(false);
 
   std::vector<InferTaskSptr> tasks;
-  InferTaskSptr task = std::make_shared<InferTask>([mlu_output_res_ticket, mlu_output_res, this, finfos]() -> int {
+  InferTaskSptr task = std::make_shared<InferTask>([mlu_output_res_ticket, mlu_output_buf, this, finfos]() -> int {
     QueuingTicket mor_ticket = mlu_output_res_ticket;
-    IOResValue mlu_output_value = mlu_output_res->WaitResourceByTicket(&mor_ticket);
+    IOResValue mlu_output_value = mlu_output_buf->WaitResourceByTicket(&mor_ticket);
+    if (profiler_) {
+      for (auto it : finfos)
+        profiler_->RecordProcessStart("POSTPROC", it.first->GetStreamIndex(), it.first->stream_id, it.first->timestamp);
+    }
     std::vector<void*> net_outputs;
     for (size_t output_idx = 0; output_idx < mlu_output_value.datas.size(); ++output_idx) {
       net_outputs.push_back(mlu_output_value.datas[output_idx].ptr);
@@ -339,7 +413,11 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
     for (const auto& it : finfos) batched_finfos.push_back(it.first);
 
     this->postprocessor_->Execute(net_outputs, this->model_, batched_finfos);
-    mlu_output_res->DeallingDone();
+    if (profiler_) {
+      for (auto it : finfos)
+        profiler_->RecordProcessEnd("POSTPROC", it.first->GetStreamIndex(), it.first->stream_id, it.first->timestamp);
+    }
+    mlu_output_buf->DeallingDone();
     return 0;
   });
   tasks.push_back(task);
@@ -362,19 +440,41 @@ std::vector<std::shared_ptr<InferTask>> ObjPostprocessingBatchingDoneStage::ObjB
     const BatchingDoneInput& finfos, const std::vector<std::shared_ptr<CNInferObject>>& objs,
     const std::shared_ptr<CpuOutputResource>& cpu_output_res) {
   std::vector<InferTaskSptr> tasks;
+  IOBufferSptr cpu_output_buf = cpu_output_res->CurrentBuffer();
+  if (postprocessor_->IsBatchExecute()) {
+    QueuingTicket cpu_output_res_ticket = cpu_output_buf->PickUpNewTicket(false);
+    tasks.push_back(
+        std::make_shared<InferTask>([cpu_output_res_ticket, cpu_output_buf, this, finfos, objs]() -> int {
+          QueuingTicket cor_ticket = cpu_output_res_ticket;
+          IOResValue cpu_output_value = cpu_output_buf->WaitResourceByTicket(&cor_ticket);
+          std::vector<float*> net_outputs;
+          for (size_t output_idx = 0; output_idx < cpu_output_value.datas.size(); ++output_idx) {
+            net_outputs.push_back(reinterpret_cast<float*>(cpu_output_value.datas[output_idx].ptr));
+          }
+          std::vector<std::pair<CNFrameInfoPtr, std::shared_ptr<CNInferObject>>> batched_objs;
+          for (size_t bidx = 0; bidx < finfos.size(); ++bidx) {
+            batched_objs.push_back(std::make_pair(finfos[bidx].first, objs[bidx]));
+          }
+
+          this->postprocessor_->ExecuteBatch(net_outputs, this->model_, batched_objs);
+          cpu_output_buf->DeallingDone();
+          return 0;
+        }));
+    return tasks;
+  }
   for (int bidx = 0; bidx < static_cast<int>(finfos.size()); ++bidx) {
     auto finfo = finfos[bidx];
     auto obj = objs[bidx];
     QueuingTicket cpu_output_res_ticket;
     if (0 == bidx) {
-      cpu_output_res_ticket = cpu_output_res_->PickUpNewTicket(true);
+      cpu_output_res_ticket = cpu_output_buf->PickUpNewTicket(true);
     } else {
-      cpu_output_res_ticket = cpu_output_res_->PickUpTicket(true);
+      cpu_output_res_ticket = cpu_output_buf->PickUpTicket(true);
     }
     InferTaskSptr task =
-        std::make_shared<InferTask>([cpu_output_res_ticket, cpu_output_res, this, finfo, obj, bidx]() -> int {
+        std::make_shared<InferTask>([cpu_output_res_ticket, cpu_output_buf, this, finfo, obj, bidx]() -> int {
           QueuingTicket cor_ticket = cpu_output_res_ticket;
-          IOResValue cpu_output_value = cpu_output_res->WaitResourceByTicket(&cor_ticket);
+          IOResValue cpu_output_value = cpu_output_buf->WaitResourceByTicket(&cor_ticket);
           std::vector<float*> net_outputs;
           for (size_t output_idx = 0; output_idx < cpu_output_value.datas.size(); ++output_idx) {
             net_outputs.push_back(reinterpret_cast<float*>(cpu_output_value.datas[output_idx].Offset(bidx)));
@@ -382,7 +482,7 @@ std::vector<std::shared_ptr<InferTask>> ObjPostprocessingBatchingDoneStage::ObjB
           if (!cnstream::IsStreamRemoved(finfo.first->stream_id)) {
             this->postprocessor_->Execute(net_outputs, this->model_, finfo.first, obj);
           }
-          cpu_output_res->DeallingDone();
+          cpu_output_buf->DeallingDone();
           return 0;
         });
     tasks.push_back(task);
@@ -394,11 +494,12 @@ std::vector<std::shared_ptr<InferTask>> ObjPostprocessingBatchingDoneStage::ObjB
     const BatchingDoneInput& finfos, const std::vector<std::shared_ptr<CNInferObject>>& objs,
     const std::shared_ptr<MluOutputResource>& mlu_output_res) {
   std::vector<InferTaskSptr> tasks;
-  QueuingTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket(false);
+  IOBufferSptr mlu_output_buf = mlu_output_res->CurrentBuffer();
+  QueuingTicket mlu_output_res_ticket = mlu_output_buf->PickUpNewTicket(false);
   InferTaskSptr task =
-      std::make_shared<InferTask>([mlu_output_res_ticket, mlu_output_res, this, finfos, objs]() -> int {
+      std::make_shared<InferTask>([mlu_output_res_ticket, mlu_output_buf, this, finfos, objs]() -> int {
         QueuingTicket mor_ticket = mlu_output_res_ticket;
-        IOResValue mlu_output_value = mlu_output_res->WaitResourceByTicket(&mor_ticket);
+        IOResValue mlu_output_value = mlu_output_buf->WaitResourceByTicket(&mor_ticket);
         std::vector<void*> net_outputs;
         for (size_t output_idx = 0; output_idx < mlu_output_value.datas.size(); ++output_idx) {
           net_outputs.push_back(mlu_output_value.datas[output_idx].ptr);
@@ -412,7 +513,7 @@ std::vector<std::shared_ptr<InferTask>> ObjPostprocessingBatchingDoneStage::ObjB
         }
 
         this->postprocessor_->Execute(net_outputs, this->model_, batched_objs);
-        mlu_output_res->DeallingDone();
+        mlu_output_buf->DeallingDone();
         return 0;
       });
   tasks.push_back(task);
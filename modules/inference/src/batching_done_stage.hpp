@@ -23,6 +23,7 @@
 
 #include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -74,9 +75,9 @@ class BatchingDoneStage {
      dump_resized_image_dir_ = dir;
   }
 
-  void SetSavingInputData(const bool& saving_infer_input, const std::string& module_name) {
+  void SetSavingInputData(const bool& saving_infer_input, size_t module_id) {
     saving_infer_input_ = saving_infer_input;
-    module_name_ = module_name;
+    module_id_ = module_id;
   }
 
   ModuleProfiler* profiler_ = nullptr;
@@ -87,7 +88,7 @@ class BatchingDoneStage {
   int dev_id_ = -1;  // only for EasyInfer::Init
   std::string dump_resized_image_dir_ = "";
   bool saving_infer_input_ = false;
-  std::string module_name_ = "";
+  size_t module_id_ = INVALID_MODULE_ID;  // the data is saved by it, see CNInferData
 };  // class BatchingDoneStage
 
 class H2DBatchingDoneStage : public BatchingDoneStage {
@@ -135,6 +136,8 @@ class InferBatchingDoneStage : public BatchingDoneStage {
   std::shared_ptr<MluInputResource> mlu_input_res_;
   std::shared_ptr<MluOutputResource> mlu_output_res_;
   std::shared_ptr<edk::EasyInfer> easyinfer_;
+  std::mutex run_mutex_;
+  std::unique_ptr<CpuOutputResource> saved_output_res_;  // see SetSavingInputData, guarded by run_mutex_
 };  // class InferBatchingDoneStage
 
 class D2HBatchingDoneStage : public BatchingDoneStage {
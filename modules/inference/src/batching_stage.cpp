@@ -41,13 +41,15 @@ std::shared_ptr<InferTask> IOBatchingStage::Batching(std::shared_ptr<CNFrameInfo
     // in one batch, reserve resource ticket to parallel.
     reserve_ticket = true;
   }
-  QueuingTicket ticket = output_res_->PickUpTicket(reserve_ticket);
+  // all frames of one batch use the same buffer, see IOResource::CurrentBuffer.
+  IOBufferSptr buffer = output_res_->CurrentBuffer();
+  QueuingTicket ticket = buffer->PickUpTicket(reserve_ticket);
   auto bidx = batch_idx_;
-  std::shared_ptr<InferTask> task = std::make_shared<InferTask>([this, ticket, finfo, bidx]() -> int {
+  std::shared_ptr<InferTask> task = std::make_shared<InferTask>([this, buffer, ticket, finfo, bidx]() -> int {
     QueuingTicket t = ticket;
-    IOResValue value = this->output_res_->WaitResourceByTicket(&t);
+    IOResValue value = buffer->WaitResourceByTicket(&t);
     this->ProcessOneFrame(finfo, bidx, value);
-    this->output_res_->DeallingDone();
+    buffer->DeallingDone();
     return 0;
   });
   task->task_msg = "infer task.";
@@ -81,7 +83,7 @@ std::shared_ptr<InferTask> ResizeConvertBatchingStage::Batching(std::shared_ptr<
   if (cnstream::IsStreamRemoved(finfo->stream_id)) {
     return NULL;
   }
-  CNDataFramePtr frame = finfo->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+  CNDataFramePtr frame = finfo->collection.Get(kCNDataFrameSlot);
   if (frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 &&
       frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21) {
     throw CnstreamError("Can not handle this frame with format :" + std::to_string(static_cast<int>(frame->fmt)));
@@ -130,7 +132,7 @@ ScalerBatchingStage::~ScalerBatchingStage() {}
 
 void ScalerBatchingStage::ProcessOneFrame(std::shared_ptr<CNFrameInfo> finfo, uint32_t batch_idx,
                                           const IOResValue& value) {
-  CNDataFramePtr frame = finfo->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+  CNDataFramePtr frame = finfo->collection.Get(kCNDataFrameSlot);
 
   // make sure device_id set
   frame->data[0]->SetMluDevContext(0);
@@ -22,6 +22,7 @@
 #include <cxxutil/exception.h>
 #include <device/mlu_context.h>
 #include <easyinfer/model_loader.h>
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -31,6 +32,7 @@
 #include "batching_stage.hpp"
 #include "cnstream_frame_va.hpp"
 #include "infer_resource.hpp"
+#include "infer_task.hpp"
 #include "infer_thread_pool.hpp"
 #include "obj_batching_stage.hpp"
 #include "obj_filter.hpp"
@@ -47,7 +49,10 @@ InferEngine::InferEngine(int dev_id, std::shared_ptr<edk::ModelLoader> model, st
                          const std::shared_ptr<ObjPostproc>& obj_postprocessor,
                          const std::shared_ptr<ObjFilter>& obj_filter, std::string dump_resized_image_dir,
                          CNDataFormat model_input_pixel_format, bool mem_on_mlu_for_postproc, bool saving_infer_input,
-                         std::string module_name, ModuleProfiler* profiler, int pad_method)
+                         size_t module_id, ModuleProfiler* profiler, int pad_method,
+                         bool adaptive_batching, float latency_slo, uint32_t io_buffer_num,
+                         ObjBatchingOrder obj_batching_order, uint32_t obj_infer_interval, float obj_box_growth,
+                         float obj_score_gain)
     : model_(model),
       preprocessor_(preprocessor),
       postprocessor_(postprocessor),
@@ -60,12 +65,13 @@ InferEngine::InferEngine(int dev_id, std::shared_ptr<edk::ModelLoader> model, st
       obj_preprocessor_(obj_preprocessor),
       obj_postprocessor_(obj_postprocessor),
       obj_filter_(obj_filter),
+      obj_batching_order_(obj_batching_order),
       infer_thread_id_(infer_thread_id),
       dump_resized_image_dir_(dump_resized_image_dir),
       model_input_fmt_(model_input_pixel_format),
       mem_on_mlu_for_postproc_(mem_on_mlu_for_postproc),
       saving_infer_input_(saving_infer_input),
-      module_name_(module_name),
+      module_id_(module_id),
       profiler_(profiler) {
   try {
     edk::MluContext mlu_ctx;
@@ -73,14 +79,16 @@ InferEngine::InferEngine(int dev_id, std::shared_ptr<edk::ModelLoader> model, st
     mlu_ctx.BindDevice();
     tp_ = std::make_shared<InferThreadPool>();
     tp_->SetErrorHandleFunc(error_func);
-    tp_->Init(dev_id, batchsize * 3 + 4);
-    cpu_input_res_ = std::make_shared<CpuInputResource>(model, batchsize);
+    if (io_buffer_num == 0) io_buffer_num = 1;
+    // tasks of every batch in flight may wait for their buffers at the same time.
+    tp_->Init(dev_id, batchsize * 3 * io_buffer_num + 4);
+    cpu_input_res_ = std::make_shared<CpuInputResource>(model, batchsize, io_buffer_num);
     if (!mem_on_mlu_for_postproc_) {
-      cpu_output_res_ = std::make_shared<CpuOutputResource>(model, batchsize);
+      cpu_output_res_ = std::make_shared<CpuOutputResource>(model, batchsize, io_buffer_num);
       cpu_output_res_->Init();
     }
-    mlu_input_res_ = std::make_shared<MluInputResource>(model, batchsize);
-    mlu_output_res_ = std::make_shared<MluOutputResource>(model, batchsize);
+    mlu_input_res_ = std::make_shared<MluInputResource>(model, batchsize, io_buffer_num);
+    mlu_output_res_ = std::make_shared<MluOutputResource>(model, batchsize, io_buffer_num);
     if (mlu_ctx.GetCoreVersion() == edk::CoreVersion::MLU270) {
       use_scaler_ = false;
     }
@@ -92,6 +100,13 @@ InferEngine::InferEngine(int dev_id, std::shared_ptr<edk::ModelLoader> model, st
     mlu_output_res_->Init();
     StageAssemble();
     timeout_helper_.SetTimeout(batching_timeout_);
+    if (batching_by_obj_ && obj_infer_interval > 1) {
+      obj_infer_cache_ = std::make_shared<ObjInferCache>(obj_infer_interval, obj_box_growth, obj_score_gain);
+    }
+    if (adaptive_batching) {
+      if (latency_slo <= 0) latency_slo = batching_timeout_;
+      batching_policy_ = std::make_shared<AdaptiveBatchingPolicy>(batchsize_, latency_slo, batching_timeout_);
+    }
   } catch (CnstreamError& e) {
     if (error_func_) {
       error_func_(e.what());
@@ -151,35 +166,41 @@ InferEngine::ResultWaitingCard InferEngine::FeedData(std::shared_ptr<CNFrameInfo
 
   auto auto_set_done = std::make_shared<AutoSetDone>(ret_promise, finfo);
   if (batching_by_obj_) {
-    if (!finfo->collection.HasValue(kCNInferObjsTag)) {
+    if (!finfo->collection.HasValue(kCNInferObjsSlot)) {
       timeout_helper_.UnlockOperator();
       return card;
     }
-    CNInferObjsPtr objs_holder = finfo->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+    CNInferObjsPtr objs_holder = finfo->collection.Get(kCNInferObjsSlot);
     objs_holder->mutex_.lock();
     CNObjsVec objs = objs_holder->objs_;
     objs_holder->mutex_.unlock();
+    CNDataFramePtr frame = nullptr;
+    if (obj_infer_cache_) {
+      obj_infer_cache_->OnFrame(finfo->stream_id);
+      frame = finfo->collection.Get(kCNDataFrameSlot);
+    }
+    std::vector<uint8_t> selected;
+    if (obj_filter_) obj_filter_->FilterObjects(finfo, objs, &selected);
     for (size_t idx = 0; idx < objs.size(); ++idx) {
       auto& obj = objs[idx];
-      if (obj_filter_) {
-        if (!obj_filter_->Filter(finfo, obj)) continue;
+      if (obj_filter_ && !selected[idx]) continue;
+      if (obj_infer_cache_) {
+        float area = obj->bbox.w * frame->width * obj->bbox.h * frame->height;
+        if (!obj_infer_cache_->Lookup(finfo->stream_id, obj, area, auto_set_done)) continue;
       }
 
-      InferTaskSptr task = obj_batching_stage_->Batching(finfo, obj);
-      tp_->SubmitTask(task);
+      if (obj_batching_order_ == ObjBatchingOrder::NONE) {
+        InferTaskSptr task = obj_batching_stage_->Batching(finfo, obj);
+        tp_->SubmitTask(task);
+      }
 
       batched_finfos_.push_back(std::make_pair(finfo, auto_set_done));
       batched_objs_.push_back(obj);
 
-      if (batched_finfos_.size() == batchsize_) {
-        BatchingDone();
-        timeout_helper_.Reset(NULL);
-      } else {
-        timeout_helper_.Reset([this]() -> void { BatchingDone(); });
-      }
+      OnBatched();
     }
     if (cached_frame_cnt_ >= batchsize_) {
-      BatchingDone();
+      BatchingDone(BatchCloseReason::FULL);
       timeout_helper_.Reset(NULL);
     }
   } else {
@@ -187,17 +208,44 @@ InferEngine::ResultWaitingCard InferEngine::FeedData(std::shared_ptr<CNFrameInfo
     tp_->SubmitTask(task);
 
     batched_finfos_.push_back(std::make_pair(finfo, auto_set_done));
+    OnBatched();
+  }
 
-    if (batched_finfos_.size() == batchsize_) {
-      BatchingDone();
+  timeout_helper_.UnlockOperator();
+  return card;
+}
+
+void InferEngine::OnBatched() {
+  uint32_t batched_num = static_cast<uint32_t>(batched_finfos_.size());
+  if (batching_policy_) {
+    float timeout = batching_policy_->OnArrival(batched_num);
+    if (batched_num >= batchsize_ || timeout <= 0) {
+      BatchingDone(batched_num >= batchsize_ ? BatchCloseReason::FULL : BatchCloseReason::SLO);
       timeout_helper_.Reset(NULL);
     } else {
-      timeout_helper_.Reset([this]() -> void { BatchingDone(); });
+      timeout_helper_.Reset([this]() -> void { BatchingDone(); }, timeout);
     }
+    return;
   }
+  if (batched_num == batchsize_) {
+    BatchingDone(BatchCloseReason::FULL);
+    timeout_helper_.Reset(NULL);
+  } else {
+    timeout_helper_.Reset([this]() -> void { BatchingDone(); });
+  }
+}
 
-  timeout_helper_.UnlockOperator();
-  return card;
+bool InferEngine::GetObjInferCacheStats(uint64_t* inferred, uint64_t* skipped) const {
+  if (!obj_infer_cache_ || !inferred || !skipped) return false;
+  *inferred = obj_infer_cache_->InferredCount();
+  *skipped = obj_infer_cache_->SkippedCount();
+  return true;
+}
+
+bool InferEngine::GetBatchingStats(BatchingStats* stats) const {
+  if (!batching_policy_ || !stats) return false;
+  *stats = batching_policy_->GetStats();
+  return true;
 }
 
 static bool CheckModel(const std::shared_ptr<edk::ModelLoader>& model) {
@@ -256,7 +304,7 @@ void InferEngine::StageAssemble() {
                                                batchsize_, dev_id_, mlu_input_res_, mlu_output_res_);
   batching_done_stages_.push_back(infer_stage);
   infer_stage->SetDumpResizedImageDir(dump_resized_image_dir_);
-  infer_stage->SetSavingInputData(saving_infer_input_, module_name_);
+  infer_stage->SetSavingInputData(saving_infer_input_, module_id_);
 
   if (!mem_on_mlu_for_postproc_) {
     std::shared_ptr<BatchingDoneStage> d2h_stage =
@@ -288,24 +336,90 @@ void InferEngine::StageAssemble() {
   for (auto it : batching_done_stages_) it->profiler_ = profiler_;
 }
 
-void InferEngine::BatchingDone() {
+void InferEngine::BatchingSortedObjs() {
+  std::vector<std::pair<float, float>> sizes;
+  sizes.reserve(batched_objs_.size());
+  for (size_t idx = 0; idx < batched_objs_.size(); ++idx) {
+    CNDataFramePtr frame = batched_finfos_[idx].first->collection.Get(kCNDataFrameSlot);
+    const CNInferBoundingBox& bbox = batched_objs_[idx]->bbox;
+    sizes.emplace_back(bbox.w * frame->width, bbox.h * frame->height);
+  }
+  std::vector<size_t> order = SortObjsForBatching(sizes, obj_batching_order_);
+  BatchingDoneInput sorted_finfos;
+  std::vector<std::shared_ptr<CNInferObject>> sorted_objs;
+  sorted_finfos.reserve(order.size());
+  sorted_objs.reserve(order.size());
+  for (size_t idx : order) {
+    sorted_finfos.push_back(std::move(batched_finfos_[idx]));
+    sorted_objs.push_back(std::move(batched_objs_[idx]));
+  }
+  batched_finfos_ = std::move(sorted_finfos);
+  batched_objs_ = std::move(sorted_objs);
+  // similar crops are adjacent in the batch, the batching done stages see the same order.
+  for (size_t idx = 0; idx < batched_objs_.size(); ++idx) {
+    InferTaskSptr task = obj_batching_stage_->Batching(batched_finfos_[idx].first, batched_objs_[idx]);
+    tp_->SubmitTask(task);
+  }
+}
+
+void InferEngine::BatchingDone(BatchCloseReason reason) {
   cached_frame_cnt_ = 0;
+  if (batching_by_obj_ && obj_batching_order_ != ObjBatchingOrder::NONE && !batched_objs_.empty()) {
+    BatchingSortedObjs();
+  }
   if (batching_by_obj_) {
     obj_batching_stage_->Reset();
   } else {
     batching_stage_->Reset();
   }
   if (!batched_finfos_.empty()) {
+    auto close_time = std::chrono::steady_clock::now();
+    if (batching_policy_) {
+      batching_policy_->OnBatchClosed(static_cast<uint32_t>(batched_finfos_.size()), reason, close_time);
+    }
+    std::vector<InferTaskSptr> last_tasks;
     for (auto& it : batching_done_stages_) {
       auto tasks = it->BatchingDone(batched_finfos_);
       tp_->SubmitTask(tasks);
+      last_tasks = tasks;
     }
     if (batching_by_obj_) {
       auto tasks = obj_postproc_stage_->ObjBatchingDone(batched_finfos_, batched_objs_);
       tp_->SubmitTask(tasks);
+      last_tasks = tasks;
+      if (obj_infer_cache_) {
+        // stores the results for the following objects of the same tracks.
+        std::shared_ptr<ObjInferCache> cache = obj_infer_cache_;
+        BatchingDoneInput finfos = batched_finfos_;
+        std::vector<std::shared_ptr<CNInferObject>> objs = batched_objs_;
+        InferTaskSptr task = std::make_shared<InferTask>([cache, finfos, objs]() -> int {
+          for (size_t idx = 0; idx < objs.size(); ++idx) cache->OnInferred(finfos[idx].first->stream_id, objs[idx]);
+          return 0;
+        });
+        task->task_msg = "obj infer cache task.";
+        task->BindFrontTasks(tasks);
+        tp_->SubmitTask(task);
+      }
       batched_objs_.clear();
     }
+    if (batching_policy_) {
+      // measures the compute latency of this batch, the policy uses it to keep the latency objective.
+      std::shared_ptr<AdaptiveBatchingPolicy> policy = batching_policy_;
+      InferTaskSptr task = std::make_shared<InferTask>([policy, close_time]() -> int {
+        auto dura = std::chrono::steady_clock::now() - close_time;
+        policy->OnBatchComputed(std::chrono::duration<double, std::milli>(dura).count());
+        return 0;
+      });
+      task->task_msg = "batch compute latency task.";
+      task->BindFrontTasks(last_tasks);
+      tp_->SubmitTask(task);
+    }
     batched_finfos_.clear();
+    // all tasks of this batch have picked up their tickets, the next batch goes to the next buffers.
+    cpu_input_res_->NextBuffer();
+    mlu_input_res_->NextBuffer();
+    mlu_output_res_->NextBuffer();
+    if (cpu_output_res_) cpu_output_res_->NextBuffer();
   }
 }
 
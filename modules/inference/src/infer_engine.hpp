@@ -29,8 +29,11 @@
 #include <utility>
 #include <vector>
 
+#include "adaptive_batching.hpp"
 #include "batching_done_stage.hpp"
 #include "cnstream_frame_va.hpp"
+#include "obj_batching_order.hpp"
+#include "obj_infer_cache.hpp"
 #include "timeout_helper.hpp"
 
 namespace edk {
@@ -72,18 +75,55 @@ class InferEngine {
               const std::shared_ptr<ObjPostproc>& obj_postprocessor = nullptr,
               const std::shared_ptr<ObjFilter>& obj_filter = nullptr, std::string dump_resized_image_dir = "",
               CNDataFormat model_input_pixel_format = CNDataFormat::CN_PIXEL_FORMAT_RGBA32,
-              bool mem_on_mlu_for_postproc = false, bool saving_infer_input = false, std::string module_name = "",
-              ModuleProfiler* profiler = nullptr, int pad_method = 0);
+              bool mem_on_mlu_for_postproc = false, bool saving_infer_input = false,
+              size_t module_id = INVALID_MODULE_ID, ModuleProfiler* profiler = nullptr, int pad_method = 0,
+              bool adaptive_batching = false, float latency_slo = 0, uint32_t io_buffer_num = 1,
+              ObjBatchingOrder obj_batching_order = ObjBatchingOrder::NONE, uint32_t obj_infer_interval = 1,
+              float obj_box_growth = 0, float obj_score_gain = 0);
   ~InferEngine();
   ResultWaitingCard FeedData(std::shared_ptr<CNFrameInfo> finfo);
 
   void ForceBatchingDone() {
-    BatchingDone();
+    timeout_helper_.LockOperator();
+    BatchingDone(BatchCloseReason::FLUSH);
+    timeout_helper_.Reset(NULL);
+    timeout_helper_.UnlockOperator();
+  }
+
+  /**
+   * @brief Gets the batching metrics. Only available when adaptive batching is enabled.
+   *
+   * @param[out] stats The batching metrics.
+   *
+   * @return Returns false if adaptive batching is not enabled.
+   */
+  bool GetBatchingStats(BatchingStats* stats) const;
+
+  /**
+   * @brief Gets the number of inferred and skipped objects. Only available when objects are inferred by track, see
+   * obj_infer_interval of Inferencer.
+   *
+   * @param[out] inferred The number of inferred objects.
+   * @param[out] skipped The number of objects whose results are copied from the cache.
+   *
+   * @return Returns false if objects are not inferred by track.
+   */
+  bool GetObjInferCacheStats(uint64_t* inferred, uint64_t* skipped) const;
+
+  /**
+   * @brief Drops the cached object results of a stream, called at the end of the stream.
+   */
+  void RemoveStream(const std::string& stream_id) {
+    if (obj_infer_cache_) obj_infer_cache_->RemoveStream(stream_id);
   }
 
  private:
   void StageAssemble();
-  void BatchingDone();
+  /* close the current batch when it is full, otherwise (re)start the batching timeout */
+  void OnBatched();
+  void BatchingDone(BatchCloseReason reason = BatchCloseReason::TIMEOUT);
+  /* sorts the objects of the current batch by obj_batching_order_ and batches them up */
+  void BatchingSortedObjs();
   std::shared_ptr<edk::ModelLoader> model_;
   std::shared_ptr<Preproc> preprocessor_;
   std::shared_ptr<Postproc> postprocessor_;
@@ -101,6 +141,7 @@ class InferEngine {
   std::shared_ptr<RCOpResource> rcop_res_;
 
   TimeoutHelper timeout_helper_;
+  std::shared_ptr<AdaptiveBatchingPolicy> batching_policy_ = nullptr;
   std::shared_ptr<InferThreadPool> tp_;
   std::function<void(const std::string& err_msg)> error_func_ = NULL;
   int dev_id_ = 0;
@@ -112,6 +153,10 @@ class InferEngine {
   std::shared_ptr<ObjPostproc> obj_postprocessor_ = nullptr;
   std::shared_ptr<ObjFilter> obj_filter_ = nullptr;
   std::vector<std::shared_ptr<CNInferObject>> batched_objs_;
+  /* objects are batched up when the batch is closed, instead of on arrival, if it is not NONE */
+  ObjBatchingOrder obj_batching_order_ = ObjBatchingOrder::NONE;
+  /* skips objects of tracks inferred recently, nullptr if obj_infer_interval is 1 */
+  std::shared_ptr<ObjInferCache> obj_infer_cache_ = nullptr;
   std::shared_ptr<ObjPostprocessingBatchingDoneStage> obj_postproc_stage_ = nullptr;
   std::string infer_thread_id_;
   std::string dump_resized_image_dir_ = "";
@@ -119,7 +164,7 @@ class InferEngine {
   uint32_t cached_frame_cnt_ = 0;
   bool mem_on_mlu_for_postproc_ = false;
   bool saving_infer_input_ = false;
-  std::string module_name_ = "";
+  size_t module_id_ = INVALID_MODULE_ID;
   ModuleProfiler* profiler_ = nullptr;
 };  // class InferEngine
 
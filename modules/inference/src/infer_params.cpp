@@ -165,6 +165,96 @@ void InferParamManager::RegisterAll(ParamRegister *pregister) {
   };
   ASSERT(RegisterParam(pregister, param));
 
+  param.name = "adaptive_batching";
+  param.desc_str =
+      "Optional. Close partial batches by the estimated arrival rate and compute latency of the engine instead of a "
+      "fixed timeout. [batching_timeout] is the upper bound of the wait time in this mode. "
+      "1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
+  param.default_value = "false";
+  param.type = "bool";
+  param.parser = [](const std::string &value, InferParams *param_set) -> bool {
+    return STR2BOOL(value, &param_set->adaptive_batching);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "latency_slo";
+  param.desc_str =
+      "Optional. The latency objective of one frame from batching to postprocessing done, valid when "
+      "[adaptive_batching] is true. [batching_timeout] is used when it is 0. unit[ms].";
+  param.default_value = "0";
+  param.type = "float";
+  param.parser = [](const std::string &value, InferParams *param_set) -> bool {
+    return STR2FLOAT(value, &param_set->latency_slo) && param_set->latency_slo >= 0;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "io_buffer_num";
+  param.desc_str =
+      "Optional. The number of input and output buffers. With more than one buffer, the next batch is preprocessed "
+      "and copied to device while the previous batches are running on the device and postprocessing. value range : "
+      "1 - 4.";
+  param.default_value = "1";
+  param.type = "uint32";
+  param.parser = [](const std::string &value, InferParams *param_set) -> bool {
+    if (!STR2U32(value, &param_set->io_buffer_num)) return false;
+    if (param_set->io_buffer_num == 0 || param_set->io_buffer_num > 4) {
+      LOGE(INFERENCER) << "io_buffer_num should be in range [1, 4], but got " << value;
+      return false;
+    }
+    return true;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "obj_batching_order";
+  param.desc_str =
+      "Optional. The order of the objects in one batch, valid when [object_infer] is true. Objects from different "
+      "frames and streams are grouped by size or aspect ratio bucket before preprocessing, so similar crops are "
+      "resized together. value range : none/size/aspect_ratio.";
+  param.default_value = "none";
+  param.type = "string";
+  param.parser = [](const std::string &value, InferParams *param_set) -> bool {
+    if (!ParseObjBatchingOrder(value, &param_set->obj_batching_order)) {
+      LOGE(INFERENCER) << "obj_batching_order should be one of none/size/aspect_ratio, but got " << value;
+      return false;
+    }
+    return true;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "obj_infer_interval";
+  param.desc_str =
+      "Optional. Inferring interval of the objects of one track, valid when [object_infer] is true. Objects of a "
+      "track inferred less than [obj_infer_interval] frames ago are not inferred again, the cached results are "
+      "copied to them. New tracks and objects without track_id are always inferred. 1 means infer all objects.";
+  param.default_value = "1";
+  param.type = "uint32";
+  param.parser = [](const std::string &value, InferParams *param_set) -> bool {
+    return STR2U32(value, &param_set->obj_infer_interval) && param_set->obj_infer_interval > 0;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "obj_box_growth";
+  param.desc_str =
+      "Optional. Valid when [obj_infer_interval] is greater than 1. The object is inferred again when its box area "
+      "is (1 + obj_box_growth) times the area at the last inference of the track. 0 means disabled.";
+  param.default_value = "0";
+  param.type = "float";
+  param.parser = [](const std::string &value, InferParams *param_set) -> bool {
+    return STR2FLOAT(value, &param_set->obj_box_growth) && param_set->obj_box_growth >= 0;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "obj_score_gain";
+  param.desc_str =
+      "Optional. Valid when [obj_infer_interval] is greater than 1. The object is inferred again when its score is "
+      "obj_score_gain higher than the score at the last inference of the track. 0 means disabled.";
+  param.default_value = "0";
+  param.type = "float";
+  param.parser = [](const std::string &value, InferParams *param_set) -> bool {
+    return STR2FLOAT(value, &param_set->obj_score_gain) && param_set->obj_score_gain >= 0;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
   param.name = "data_order";
   param.desc_str = "Optional. The order in which the output data of the model are placed.value range : NCHW/NHWC.";
   param.default_value = "NHWC";
@@ -415,4 +505,24 @@ bool InferParamManager::ParseBy(const ModuleParamSet &raw_params, InferParams *p
   return true;
 }
 
+bool InferParamManager::ParseStreamParams(const ModuleParamSet &raw_params, InferParams *pout) {
+  if (!pout) return false;
+  // the parameters taking effect per frame, the others are bound to the engines
+  static const std::set<std::string> kStreamParams = {"infer_interval", "threshold"};
+  for (const auto &it : raw_params) {
+    InferParamDesc key;
+    key.name = it.first;
+    auto desc = param_descs_.find(key);
+    if (!kStreamParams.count(it.first) || desc == param_descs_.end()) {
+      LOGE(INFERENCER) << "Parameter named [" << it.first << "] can not be overridden per stream.";
+      return false;
+    }
+    if (!desc->parser(it.second, pout)) {
+      LOGE(INFERENCER) << "Parse parameter [" << it.first << "] failed. value is [" << it.second << "]";
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace cnstream
@@ -29,6 +29,7 @@
 #include "cnstream_config.hpp"
 #include "cnstream_frame_va.hpp"
 #include "easyinfer/model_loader.h"
+#include "obj_batching_order.hpp"
 
 namespace cnstream {
 
@@ -39,6 +40,13 @@ struct InferParams {
   bool use_scaler = false;
   uint32_t infer_interval = 1;
   uint32_t batching_timeout = 3000;  // ms
+  bool adaptive_batching = false;
+  float latency_slo = 0;  // ms, batching_timeout is used when it is 0
+  uint32_t io_buffer_num = 1;  // number of batches in flight
+  ObjBatchingOrder obj_batching_order = ObjBatchingOrder::NONE;  // object_infer only
+  uint32_t obj_infer_interval = 1;  // frames, object_infer only, by track_id
+  float obj_box_growth = 0;
+  float obj_score_gain = 0;
   bool keep_aspect_ratio = false;  // mlu preprocessing, keep aspect ratio
   CNDataFormat model_input_pixel_format = CNDataFormat::CN_PIXEL_FORMAT_RGBA32;
   bool mem_on_mlu_for_postproc = false;
@@ -67,7 +75,7 @@ struct InferParamDesc {
 };  // struct InferParamDesc
 
 struct InferParamDescLessCompare {
-  bool operator() (const InferParamDesc &p1, const InferParamDesc &p2) {
+  bool operator() (const InferParamDesc &p1, const InferParamDesc &p2) const {
     return p1.name < p2.name;
   }
 };  // struct InferParamDescLessCompare
@@ -77,6 +85,8 @@ class InferParamManager {
   void RegisterAll(ParamRegister *pregister);
 
   bool ParseBy(const ModuleParamSet &raw_params, InferParams *pout);
+  // parses the parameters overridden for a stream into pout, only infer_interval and threshold are accepted
+  bool ParseStreamParams(const ModuleParamSet &raw_params, InferParams *pout);
 
  private:
   bool RegisterParam(ParamRegister *pregister, const InferParamDesc &param_desc);
@@ -25,19 +25,35 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 #include <bitset>
 
 #include "inferencer.hpp"
 
 namespace cnstream {
 
-IOResource::IOResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : InferResource<IOResValue>(model, batchsize) {}
+IOResource::IOResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num)
+    : InferResource<IOResValue>(model, batchsize), buffer_num_(buffer_num ? buffer_num : 1) {}
 
 IOResource::~IOResource() {}
 
-CpuInputResource::CpuInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : IOResource(model, batchsize) {}
+void IOResource::Init() {
+  buffers_.clear();
+  for (uint32_t buf_idx = 0; buf_idx < buffer_num_; ++buf_idx) {
+    buffers_.push_back(std::make_shared<IOBuffer>(Allocate(model_, batchsize_)));
+  }
+  value_ = buffers_[0]->GetValue();
+  cur_buf_ = 0;
+}
+
+void IOResource::Destroy() {
+  for (const auto& buffer : buffers_) Deallocate(model_, batchsize_, buffer->GetValue());
+  buffers_.clear();
+  value_ = IOResValue();
+}
+
+CpuInputResource::CpuInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num)
+    : IOResource(model, batchsize, buffer_num) {}
 
 CpuInputResource::~CpuInputResource() {}
 
@@ -64,8 +80,8 @@ void CpuInputResource::Deallocate(std::shared_ptr<edk::ModelLoader> model, uint3
   if (value.ptrs) mem_op.FreeCpuInput(value.ptrs);
 }
 
-CpuOutputResource::CpuOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : IOResource(model, batchsize) {}
+CpuOutputResource::CpuOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num)
+    : IOResource(model, batchsize, buffer_num) {}
 
 CpuOutputResource::~CpuOutputResource() {}
 
@@ -93,8 +109,8 @@ void CpuOutputResource::Deallocate(std::shared_ptr<edk::ModelLoader> model, uint
   if (value.ptrs) mem_op.FreeCpuOutput(value.ptrs);
 }
 
-MluInputResource::MluInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : IOResource(model, batchsize) {}
+MluInputResource::MluInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num)
+    : IOResource(model, batchsize, buffer_num) {}
 
 MluInputResource::~MluInputResource() {}
 
@@ -121,8 +137,8 @@ void MluInputResource::Deallocate(std::shared_ptr<edk::ModelLoader> model, uint3
   if (value.ptrs) mem_op.FreeMluInput(value.ptrs);
 }
 
-MluOutputResource::MluOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : IOResource(model, batchsize) {}
+MluOutputResource::MluOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num)
+    : IOResource(model, batchsize, buffer_num) {}
 
 MluOutputResource::~MluOutputResource() {}
 
@@ -67,24 +67,59 @@ struct IOResValue {
   std::vector<OneData> datas;
 };  // struct IOResValue
 
+/**
+ * One buffer of an IOResource. The users of the buffer are served in the order they pick up tickets.
+ */
+class IOBuffer : public QueuingServer {
+ public:
+  explicit IOBuffer(const IOResValue& value) : value_(value) {}
+  IOResValue WaitResourceByTicket(QueuingTicket* pticket) {
+    WaitByTicket(pticket);
+    return value_;
+  }
+  const IOResValue& GetValue() const { return value_; }
+
+ private:
+  IOResValue value_;
+};  // class IOBuffer
+
+using IOBufferSptr = std::shared_ptr<IOBuffer>;
+
 CNSTREAM_REGISTER_EXCEPTION(IOResource);
 class IOResource : public InferResource<IOResValue> {
  public:
-  IOResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  IOResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num = 1);
   virtual ~IOResource();
 
-  void Init() override { value_ = Allocate(model_, batchsize_); }
+  void Init() override;
+
+  void Destroy() override;
+
+  /**
+   * The buffer used by the batch being assembled. All tickets of one batch are picked up from the same buffer, the
+   * next batch uses the next buffer. So with more than one buffer, a batch is preprocessed and copied while the
+   * previous ones are still running on the device or postprocessing.
+   */
+  const IOBufferSptr& CurrentBuffer() const { return buffers_[cur_buf_]; }
 
-  void Destroy() override { Deallocate(model_, batchsize_, value_); }
+  /* switches to the next buffer, called once the batch has picked up all of its tickets. */
+  void NextBuffer() { cur_buf_ = (cur_buf_ + 1) % buffer_num_; }
+
+  uint32_t BufferNum() const { return buffer_num_; }
 
  protected:
   virtual IOResValue Allocate(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize) = 0;
   virtual void Deallocate(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, const IOResValue& value) = 0;
+
+ private:
+  const uint32_t buffer_num_ = 1;
+  std::vector<IOBufferSptr> buffers_;
+  uint32_t cur_buf_ = 0;
 };  // class IOResource
 
 class CpuInputResource : public IOResource {
  public:
-  CpuInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  CpuInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num = 1);
   ~CpuInputResource();
 
  protected:
@@ -94,7 +129,7 @@ class CpuInputResource : public IOResource {
 
 class CpuOutputResource : public IOResource {
  public:
-  CpuOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  CpuOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num = 1);
   ~CpuOutputResource();
 
  protected:
@@ -104,7 +139,7 @@ class CpuOutputResource : public IOResource {
 
 class MluInputResource : public IOResource {
  public:
-  MluInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  MluInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num = 1);
   ~MluInputResource();
 
  protected:
@@ -114,7 +149,7 @@ class MluInputResource : public IOResource {
 
 class MluOutputResource : public IOResource {
  public:
-  MluOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  MluOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t buffer_num = 1);
   ~MluOutputResource();
 
  protected:
@@ -34,9 +34,17 @@ namespace cnstream {
 class InferTask;
 using InferTaskSptr = std::shared_ptr<InferTask>;
 
+// Tasks with a higher priority are popped first by InferThreadPool, tasks with the same priority are popped in the
+// order they are submitted.
+enum class InferTaskPriority {
+  NORMAL = 0,  // host tasks, e.g. preprocessing and postprocessing
+  DEVICE = 1,  // tasks submitting work to device, so that the device is not left idle behind long host tasks
+};
+
 class InferTask {
  public:
   std::string task_msg = "task";  // for debug.
+  InferTaskPriority priority = InferTaskPriority::NORMAL;
 
   explicit InferTask(const std::function<int()>& task_func) {
     func_ = task_func;
@@ -27,12 +27,15 @@
 #include "cnstream_logging.hpp"
 #include "device/mlu_context.h"
 #include "exception.hpp"
+#include "private/cnstream_affinity.hpp"
 
 namespace cnstream {
 
 void InferThreadPool::Init(int dev_id, size_t thread_num) {
   std::unique_lock<std::mutex> lk(mtx_);
   dev_id_ = dev_id;
+  // workers inherit the cpu affinity of the calling thread, remember its NUMA node for host memory allocation.
+  numa_node_ = GetCurrentThreadNumaNode();
   running_ = true;
   max_tnum_ = 2 * thread_num;
   for (size_t ti = 0; ti < thread_num; ++ti) {
@@ -53,21 +56,24 @@ void InferThreadPool::Destroy() {
 
   lk.lock();
   threads_.clear();
-  while (!task_q_.empty()) {
-    task_q_.pop();
-  }
+  device_task_q_.clear();
+  task_q_.clear();
 }
 
 void InferThreadPool::SubmitTask(const InferTaskSptr& task) {
   if (!task.get()) return;
   std::unique_lock<std::mutex> lk(mtx_);
 
-  q_push_cond_.wait(lk, [this]() -> bool { return task_q_.size() < max_tnum_ || !running_; });
-  assert(task_q_.size() < max_tnum_);
+  q_push_cond_.wait(lk, [this]() -> bool { return TaskNum() < max_tnum_ || !running_; });
+  assert(TaskNum() < max_tnum_);
 
   if (!running_) return;
 
-  task_q_.push(task);
+  if (task->priority == InferTaskPriority::DEVICE) {
+    device_task_q_.push_back(task);
+  } else {
+    task_q_.push_back(task);
+  }
 
   lk.unlock();
   q_pop_cond_.notify_one();
@@ -79,14 +85,17 @@ void InferThreadPool::SubmitTask(const std::vector<InferTaskSptr>& tasks) {
 
 InferTaskSptr InferThreadPool::PopTask() {
   std::unique_lock<std::mutex> lk(mtx_);
-  assert(task_q_.size() <= max_tnum_);
+  assert(TaskNum() <= max_tnum_);
 
-  q_pop_cond_.wait(lk, [this]() -> bool { return task_q_.size() > 0 || !running_; });
+  q_pop_cond_.wait(lk, [this]() -> bool { return TaskNum() > 0 || !running_; });
 
   if (!running_) return NULL;
 
-  auto task = task_q_.front();
-  task_q_.pop();
+  // the device tasks jump the queued host tasks. A device task waits for its front host tasks (e.g. preprocessing)
+  // through the resource tickets, the pool has more threads than the tasks in flight so they are still popped.
+  std::deque<InferTaskSptr>* q = device_task_q_.empty() ? &task_q_ : &device_task_q_;
+  auto task = q->front();
+  q->pop_front();
 
   lk.unlock();
   q_push_cond_.notify_one();
@@ -102,6 +111,7 @@ void InferThreadPool::TaskLoop() {
   edk::MluContext context;
   context.SetDeviceId(dev_id_);
   context.BindDevice();
+  if (numa_node_ >= 0) SetCurrentThreadAffinity(GetNumaNodeCpus(numa_node_), numa_node_);
   while (running_) {
     InferTaskSptr task = PopTask();
     if (task.get() == nullptr) {
@@ -21,9 +21,10 @@
 #ifndef MODULES_INFERENCE_SRC_INFER_THREAD_POOL_HPP_
 #define MODULES_INFERENCE_SRC_INFER_THREAD_POOL_HPP_
 
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
 #include <vector>
@@ -55,13 +56,16 @@ class InferThreadPool {
 
   void TaskLoop();
   std::vector<std::thread> threads_;
-  std::queue<InferTaskSptr> task_q_;
+  size_t TaskNum() const { return device_task_q_.size() + task_q_.size(); }
+  std::deque<InferTaskSptr> device_task_q_;  // tasks of InferTaskPriority::DEVICE
+  std::deque<InferTaskSptr> task_q_;
   size_t max_tnum_ = 20;
   std::mutex mtx_;
   std::condition_variable q_push_cond_;
   std::condition_variable q_pop_cond_;
   volatile bool running_ = false;
   int dev_id_ = 0;
+  int numa_node_ = -1;
   std::function<void(const std::string& err_msg)> error_func_ = NULL;
 };  // class InferThreadPool
 
@@ -21,6 +21,7 @@
 #include "infer_trans_data_helper.hpp"
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -46,11 +47,11 @@ InferTransDataHelper::~InferTransDataHelper() {
 }
 
 void InferTransDataHelper::SubmitData(
-    const std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>& data) {
+    const std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>& data, std::function<void()> done) {
   std::unique_lock<std::mutex> lk(mtx_);
   cond_not_full_.wait(lk, [this] () { return !running_.load() || queue_.size() < size_t(3 * batchsize_); });
   if (!running_.load()) return;
-  queue_.push(data);
+  queue_.push(Item{data.first, data.second, std::move(done)});
   lk.unlock();
   cond_not_empty_.notify_one();
 }
@@ -60,21 +61,22 @@ void InferTransDataHelper::Loop() {
     std::unique_lock<std::mutex> lk(mtx_);
     cond_not_empty_.wait(lk, [this]() { return !running_.load() || !queue_.empty(); });
     if (!running_.load()) break;
-    auto data = queue_.front();
+    Item item = std::move(queue_.front());
     queue_.pop();
     lk.unlock();
     cond_not_full_.notify_one();
 
-    if (cnstream::IsStreamRemoved(data.first->stream_id)) {
-      if (!data.first->IsEos()) {
+    if (cnstream::IsStreamRemoved(item.data->stream_id)) {
+      if (!item.data->IsEos()) {
         // discard packet if stream has been removed
         continue;
       }
     }
 
-    auto finfo = data.first;
-    auto card = data.second;
+    auto finfo = item.data;
+    auto card = item.card;
     card.WaitForCall();
+    if (item.done) item.done();
 
     if (infer_) {
       infer_->TransmitData(finfo);
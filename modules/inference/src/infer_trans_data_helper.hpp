@@ -23,6 +23,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -41,14 +42,21 @@ class InferTransDataHelper {
   explicit InferTransDataHelper(Inferencer* infer, int batchsize);
   ~InferTransDataHelper();
 
-  void SubmitData(const std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>& data);
+  // done is called when the result is ready, before the data is transmitted
+  void SubmitData(const std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>& data,
+                  std::function<void()> done = nullptr);
 
  private:
   void Loop();
   std::mutex mtx_;
   std::condition_variable cond_not_full_;
   std::condition_variable cond_not_empty_;
-  std::queue<std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>> queue_;
+  struct Item {
+    std::shared_ptr<CNFrameInfo> data;
+    InferEngine::ResultWaitingCard card;
+    std::function<void()> done;
+  };
+  std::queue<Item> queue_;
   Inferencer* infer_ = nullptr;
   std::thread th_;
   std::atomic<bool> running_;
@@ -21,6 +21,9 @@
 #include <device/mlu_context.h>
 #include <easyinfer/model_loader.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <sstream>
@@ -35,10 +38,12 @@
 #include "preproc.hpp"
 
 #include "cnstream_frame_va.hpp"
+#include "cnstream_mapped_file.hpp"
 #include "inferencer.hpp"
 #include "infer_params.hpp"
 
 #include "profiler/module_profiler.hpp"
+#include "util/cnstream_stream_param_table.hpp"
 
 namespace cnstream {
 
@@ -52,6 +57,27 @@ struct InferContext {
 
 using InferContextSptr = std::shared_ptr<InferContext>;
 
+// the parameters overridden for a stream, see Inferencer::SetStreamParams
+struct InferStreamParams {
+  uint32_t infer_interval = 1;
+  float threshold = 0;
+  mutable std::atomic<uint64_t> drop_count{0};
+};  // struct InferStreamParams
+
+// removes the objects from the index first on whose scores are lower than the threshold
+static void FilterObjectsByScore(const CNFrameInfoPtr &data, size_t first, float threshold) {
+  if (!data->collection.HasValue(kCNInferObjsSlot)) return;
+  CNInferObjsPtr objs_holder = data->collection.Get(kCNInferObjsSlot);
+  std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+  std::vector<CNInferObjectPtr> &objs = objs_holder->objs_;
+  if (first >= objs.size()) return;
+  auto end = std::remove_if(objs.begin() + first, objs.end(),
+                            [threshold](const CNInferObjectPtr &obj) { return obj->score < threshold; });
+  if (end == objs.end()) return;
+  objs.erase(end, objs.end());
+  objs_holder->Publish();
+}
+
 class InferencerPrivate {
  public:
   explicit InferencerPrivate(Inferencer* q) : q_ptr_(q) {}
@@ -69,6 +95,7 @@ class InferencerPrivate {
 
   std::map<std::thread::id, InferContextSptr> ctxs_;
   std::mutex ctx_mtx_;
+  StreamParamTable<InferStreamParams> stream_params_;
 
   void InferEngineErrorHnadleFunc(const std::string& err_msg) {
     LOGE(INFERENCER) << err_msg;
@@ -83,7 +110,11 @@ class InferencerPrivate {
 
     std::string model_path = GetPathRelativeToTheJSONFile(params.model_path, param_set);
     try {
-      auto model_loader = std::make_shared<edk::ModelLoader>(model_path, params.func_name);
+      // loaded from the mapped file, the processes loading the model share its pages. The loader copies what it
+      // needs, the file is unmapped after loading.
+      std::shared_ptr<MappedFile> model_file = MappedFile::Open(model_path);
+      auto model_loader = model_file ? std::make_shared<edk::ModelLoader>(model_file->Data(), params.func_name)
+                                     : std::make_shared<edk::ModelLoader>(model_path, params.func_name);
 
       for (uint32_t index = 0; index < model_loader->OutputNum(); ++index) {
         edk::DataLayout layout;
@@ -189,7 +220,9 @@ class InferencerPrivate {
           tid_str, std::bind(&InferencerPrivate::InferEngineErrorHnadleFunc, this, std::placeholders::_1),
           params_.keep_aspect_ratio, params_.object_infer, obj_preproc_, obj_postproc_, obj_filter_,
           dump_resized_image_dir_, params_.model_input_pixel_format, params_.mem_on_mlu_for_postproc,
-          params_.saving_infer_input, module_name_, q_ptr_->GetProfiler(), params_.pad_method);
+          params_.saving_infer_input, q_ptr_->GetId(), q_ptr_->GetProfiler(), params_.pad_method,
+          params_.adaptive_batching, params_.latency_slo, params_.io_buffer_num, params_.obj_batching_order,
+          params_.obj_infer_interval, params_.obj_box_growth, params_.obj_score_gain);
       ctx->trans_data_helper = std::make_shared<InferTransDataHelper>(q_ptr_, params_.infer_interval * bsize_ * 2);
       ctxs_[tid] = ctx;
     }
@@ -243,7 +276,16 @@ bool Inferencer::Open(ModuleParamSet raw_params) {
       if (!params.use_scaler && params.preproc_name.empty()) {
         GetProfiler()->RegisterProcessName("RESIZE CONVERT");
       }
+      if (!params.preproc_name.empty()) {
+        GetProfiler()->RegisterProcessName("H2D");
+      }
       GetProfiler()->RegisterProcessName("RUN MODEL");
+      if (!params.mem_on_mlu_for_postproc) {
+        GetProfiler()->RegisterProcessName("D2H");
+      }
+      if (!params.object_infer) {
+        GetProfiler()->RegisterProcessName("POSTPROC");
+      }
     }
   }
 
@@ -255,6 +297,16 @@ void Inferencer::Close() {
 
   /*destroy infer contexts*/
   d_ptr_->ctx_mtx_.lock();
+  for (auto& it : d_ptr_->ctxs_) {
+    BatchingStats stats;
+    if (it.second->engine && it.second->engine->GetBatchingStats(&stats)) {
+      LOGI(INFERENCER) << "[" << GetName() << "] adaptive batching " << stats.ToString();
+    }
+    uint64_t inferred = 0, skipped = 0;
+    if (it.second->engine && it.second->engine->GetObjInferCacheStats(&inferred, &skipped)) {
+      LOGI(INFERENCER) << "[" << GetName() << "] objects inferred: " << inferred << ", skipped by track: " << skipped;
+    }
+  }
   d_ptr_->ctxs_.clear();
   d_ptr_->ctx_mtx_.unlock();
 
@@ -265,14 +317,21 @@ void Inferencer::Close() {
 int Inferencer::Process(CNFrameInfoPtr data) {
   std::shared_ptr<InferContext> pctx = d_ptr_->GetInferContext();
   bool eos = data->IsEos();
-  bool drop_data = d_ptr_->params_.infer_interval > 0 && pctx->drop_count++ % d_ptr_->params_.infer_interval != 0;
+  std::shared_ptr<const InferStreamParams> stream_params = d_ptr_->stream_params_.Get(data->GetStreamIndex());
+  const uint32_t infer_interval = stream_params ? stream_params->infer_interval : d_ptr_->params_.infer_interval;
+  bool drop_data = false;
+  if (stream_params) {
+    drop_data = infer_interval > 0 && stream_params->drop_count++ % infer_interval != 0;
+  } else {
+    drop_data = infer_interval > 0 && pctx->drop_count++ % infer_interval != 0;
+  }
 
   if (!eos) {
     if (data->IsRemoved()) {
       // discard packets from removed-stream
       return 0;
     }
-    CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+    CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
     if (frame->dst_device_id < 0) {
       /* CNSyncedMemory data is on CPU */
       for (int i = 0; i < frame->GetPlanes(); i++) {
@@ -304,14 +363,28 @@ int Inferencer::Process(CNFrameInfoPtr data) {
       // minimize batch_timeout delay
       pctx->engine->ForceBatchingDone();
     }
-    if (drop_data) pctx->drop_count %= d_ptr_->params_.infer_interval;
+    if (eos) pctx->engine->RemoveStream(data->stream_id);
+    if (drop_data) {
+      if (!stream_params) pctx->drop_count %= infer_interval;
+      ModuleProfiler *profiler = eos ? nullptr : GetProfiler();
+      if (profiler) profiler->RecordDropped(data->stream_id, kDROP_REASON_INTERVAL);
+    }
     std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
     promise->set_value();
     InferEngine::ResultWaitingCard card(promise);
     pctx->trans_data_helper->SubmitData(std::make_pair(data, card));
   } else {
+    std::function<void()> done;
+    if (stream_params && stream_params->threshold > d_ptr_->params_.threshold && !d_ptr_->params_.object_infer) {
+      // the objects appended by the postprocessing are filtered by the threshold of the stream
+      const size_t first =
+          data->collection.HasValue(kCNInferObjsSlot) ? data->collection.Get(kCNInferObjsSlot)->GetSnapshot()->size()
+                                                      : 0;
+      const float threshold = stream_params->threshold;
+      done = [data, first, threshold] { FilterObjectsByScore(data, first, threshold); };
+    }
     InferEngine::ResultWaitingCard card = pctx->engine->FeedData(data);
-    pctx->trans_data_helper->SubmitData(std::make_pair(data, card));
+    pctx->trans_data_helper->SubmitData(std::make_pair(data, card), std::move(done));
   }
 
   return 1;
@@ -322,4 +395,30 @@ bool Inferencer::CheckParamSet(const ModuleParamSet &param_set) const {
   return param_manager_->ParseBy(param_set, &params);
 }
 
+bool Inferencer::CheckStreamParams(const ModuleParamSet &params) const {
+  InferParams overridden;
+  return param_manager_->ParseStreamParams(params, &overridden);
+}
+
+void Inferencer::SetStreamParams(uint32_t stream_index, const ModuleParamSet &params) {
+  if (!d_ptr_) return;
+  if (params.empty()) {
+    d_ptr_->stream_params_.Set(stream_index, nullptr);
+    return;
+  }
+  InferParams overridden = d_ptr_->params_;
+  if (!param_manager_->ParseStreamParams(params, &overridden)) return;
+  std::shared_ptr<InferStreamParams> stream_params = std::make_shared<InferStreamParams>();
+  stream_params->infer_interval = overridden.infer_interval;
+  stream_params->threshold = overridden.threshold;
+  d_ptr_->stream_params_.Set(stream_index, std::move(stream_params));
+}
+
+bool Inferencer::GetPreferredFrameSize(uint32_t *width, uint32_t *height) const {
+  if (!d_ptr_ || !d_ptr_->model_loader_ || d_ptr_->params_.object_infer) return false;
+  *width = d_ptr_->model_loader_->InputShape(0).W();
+  *height = d_ptr_->model_loader_->InputShape(0).H();
+  return true;
+}
+
 }  // namespace cnstream
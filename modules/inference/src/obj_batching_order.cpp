@@ -0,0 +1,76 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "obj_batching_order.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+bool ParseObjBatchingOrder(const std::string& str, ObjBatchingOrder* order) {
+  if (str == "none") {
+    *order = ObjBatchingOrder::NONE;
+  } else if (str == "size") {
+    *order = ObjBatchingOrder::SIZE;
+  } else if (str == "aspect_ratio") {
+    *order = ObjBatchingOrder::ASPECT_RATIO;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int ObjSizeBucket(float w, float h) {
+  w = std::max(w, 1.0f);
+  h = std::max(h, 1.0f);
+  return static_cast<int>(std::floor(std::log2(w * h)));
+}
+
+int ObjAspectRatioBucket(float w, float h) {
+  w = std::max(w, 1.0f);
+  h = std::max(h, 1.0f);
+  return static_cast<int>(std::lround(2 * std::log2(w / h)));
+}
+
+std::vector<size_t> SortObjsForBatching(const std::vector<std::pair<float, float>>& sizes, ObjBatchingOrder order) {
+  std::vector<size_t> indices(sizes.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  if (order == ObjBatchingOrder::NONE) return indices;
+  std::vector<std::pair<int, int>> keys;
+  keys.reserve(sizes.size());
+  for (const auto& it : sizes) {
+    int size_bucket = ObjSizeBucket(it.first, it.second);
+    int ratio_bucket = ObjAspectRatioBucket(it.first, it.second);
+    if (order == ObjBatchingOrder::SIZE) {
+      keys.emplace_back(size_bucket, ratio_bucket);
+    } else {
+      keys.emplace_back(ratio_bucket, size_bucket);
+    }
+  }
+  std::stable_sort(indices.begin(), indices.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+  return indices;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,75 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_SRC_OBJ_BATCHING_ORDER_HPP_
+#define MODULES_INFERENCE_SRC_OBJ_BATCHING_ORDER_HPP_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief The order of the objects in one batch.
+ */
+enum class ObjBatchingOrder {
+  NONE = 0,      ///< Arrival order.
+  SIZE,          ///< Grouped by size bucket, then by aspect ratio bucket.
+  ASPECT_RATIO,  ///< Grouped by aspect ratio bucket, then by size bucket.
+};
+
+/**
+ * @brief Parses the order from string, "none", "size" or "aspect_ratio".
+ *
+ * @return Returns false if the string is not a valid order.
+ */
+bool ParseObjBatchingOrder(const std::string& str, ObjBatchingOrder* order);
+
+/**
+ * @brief Size bucket of an object, the area doubles from one bucket to the next.
+ *
+ * @param w The width of the object in pixels.
+ * @param h The height of the object in pixels.
+ */
+int ObjSizeBucket(float w, float h);
+
+/**
+ * @brief Aspect ratio bucket of an object, the ratio grows by sqrt(2) from one bucket to the next. Bucket 0 is square.
+ *
+ * @param w The width of the object in pixels.
+ * @param h The height of the object in pixels.
+ */
+int ObjAspectRatioBucket(float w, float h);
+
+/**
+ * @brief Sorts objects by the given order. Objects in the same bucket keep their arrival order.
+ *
+ * @param sizes The width and height of each object in pixels.
+ * @param order The order.
+ *
+ * @return Returns the indices of the objects in batching order.
+ */
+std::vector<size_t> SortObjsForBatching(const std::vector<std::pair<float, float>>& sizes, ObjBatchingOrder order);
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_SRC_OBJ_BATCHING_ORDER_HPP_
@@ -0,0 +1,126 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "obj_infer_cache.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+ObjInferCache::ObjInferCache(uint32_t interval, float box_growth, float score_gain)
+    : interval_(interval ? interval : 1), box_growth_(box_growth), score_gain_(score_gain) {}
+
+void ObjInferCache::OnFrame(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  Stream& stream = streams_[stream_id];
+  stream.frame_idx++;
+  // tracks lost by the tracker are dropped, unless they still have waiters.
+  const uint64_t max_idle = std::max<uint64_t>(2 * interval_, 8);
+  for (auto it = stream.tracks.begin(); it != stream.tracks.end();) {
+    if (stream.frame_idx - it->second.seen_frame > max_idle && it->second.waiters.empty()) {
+      it = stream.tracks.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool ObjInferCache::Lookup(const std::string& stream_id, const std::shared_ptr<CNInferObject>& obj, float area,
+                           const std::shared_ptr<void>& holder) {
+  if (obj->track_id.empty() || obj->track_id == "-1") {
+    inferred_cnt_++;
+    return true;
+  }
+  std::lock_guard<std::mutex> lk(mutex_);
+  Stream& stream = streams_[stream_id];
+  auto it = stream.tracks.find(obj->track_id);
+  bool infer = it == stream.tracks.end();
+  if (!infer) {
+    const Track& track = it->second;
+    infer = stream.frame_idx - track.infer_frame >= interval_ ||
+            (box_growth_ > 0 && area > track.area * (1 + box_growth_)) ||
+            (score_gain_ > 0 && obj->score > track.score + score_gain_);
+  }
+  Track& track = stream.tracks[obj->track_id];
+  track.seen_frame = stream.frame_idx;
+  if (infer) {
+    track.infer_frame = stream.frame_idx;
+    track.area = area;
+    track.score = obj->score;
+    inferred_cnt_++;
+    return true;
+  }
+  if (track.ready) {
+    CopyResults(track, obj);
+  } else {
+    track.waiters.push_back({obj, holder});
+  }
+  skipped_cnt_++;
+  return false;
+}
+
+void ObjInferCache::OnInferred(const std::string& stream_id, const std::shared_ptr<CNInferObject>& obj) {
+  if (obj->track_id.empty() || obj->track_id == "-1") return;
+  std::vector<Waiter> waiters;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto stream_it = streams_.find(stream_id);
+    if (stream_it == streams_.end()) return;
+    auto it = stream_it->second.tracks.find(obj->track_id);
+    if (it == stream_it->second.tracks.end()) return;
+    Track& track = it->second;
+    track.attrs = obj->GetAttributes();
+    track.extra_attrs = obj->GetExtraAttributes();
+    track.features = obj->GetFeatures();
+    track.ready = true;
+    waiters.swap(track.waiters);
+    for (const auto& waiter : waiters) CopyResults(track, waiter.obj);
+  }
+  // holders are released here, out of the lock
+}
+
+void ObjInferCache::RemoveStream(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto stream_it = streams_.find(stream_id);
+  if (stream_it == streams_.end()) return;
+  // tracks with waiters are kept until their inference is done, the waiters would lose the results otherwise.
+  auto& tracks = stream_it->second.tracks;
+  for (auto it = tracks.begin(); it != tracks.end();) {
+    if (it->second.waiters.empty()) {
+      it = tracks.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (tracks.empty()) streams_.erase(stream_it);
+}
+
+void ObjInferCache::CopyResults(const Track& track, const std::shared_ptr<CNInferObject>& obj) {
+  for (const auto& attr : track.attrs) obj->AddAttribute(attr);
+  for (const auto& attr : track.extra_attrs) obj->AddExtraAttribute(attr.first, attr.second);
+  for (const auto& feature : track.features) obj->AddFeature(feature.first, feature.second);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,124 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_SRC_OBJ_INFER_CACHE_HPP_
+#define MODULES_INFERENCE_SRC_OBJ_INFER_CACHE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Caches the inference results of tracked objects, so that a secondary inferencer does not run on the same
+ * track every frame.
+ *
+ * An object is inferred when its track is new, when the track was inferred [interval] frames ago, when the box area
+ * grew by [box_growth] since the last inference or when the detection score is [score_gain] higher. Otherwise the
+ * cached attributes, extra attributes and features are copied to the object, attributes the object already has are
+ * kept. Objects without track id are always inferred.
+ *
+ * This class is thread-safe.
+ */
+class ObjInferCache {
+ public:
+  /**
+   * @param interval Inferring interval of one track in frames, must be greater than 0.
+   * @param box_growth Re-infers when the box area is (1 + box_growth) times larger. 0 means disabled.
+   * @param score_gain Re-infers when the score is score_gain higher. 0 means disabled.
+   */
+  ObjInferCache(uint32_t interval, float box_growth, float score_gain);
+
+  /**
+   * @brief Counts one frame of a stream. Must be called once per frame before Lookup, tracks not seen for a while are
+   * dropped here.
+   */
+  void OnFrame(const std::string& stream_id);
+
+  /**
+   * @brief Decides whether an object should be inferred.
+   *
+   * @param stream_id The stream the object belongs to.
+   * @param obj The object.
+   * @param area The area of the object in pixels.
+   * @param holder Kept until the cached results have been copied to the object. When the last inference of the track
+   *               is not finished yet, the results are copied by OnInferred.
+   *
+   * @return Returns true if the object should be inferred, then OnInferred must be called when its postprocessing is
+   *         done.
+   */
+  bool Lookup(const std::string& stream_id, const std::shared_ptr<CNInferObject>& obj, float area,
+              const std::shared_ptr<void>& holder);
+
+  /**
+   * @brief Stores the results of an inferred object.
+   */
+  void OnInferred(const std::string& stream_id, const std::shared_ptr<CNInferObject>& obj);
+
+  /**
+   * @brief Drops the tracks of a stream, e.g. at the end of the stream. Tracks still waiting for their inference are
+   * dropped later.
+   */
+  void RemoveStream(const std::string& stream_id);
+
+  uint64_t InferredCount() const { return inferred_cnt_; }
+  uint64_t SkippedCount() const { return skipped_cnt_; }
+
+ private:
+  struct Waiter {
+    std::shared_ptr<CNInferObject> obj;
+    std::shared_ptr<void> holder;
+  };
+  struct Track {
+    uint64_t infer_frame = 0;  // frame index of the last inference
+    uint64_t seen_frame = 0;   // frame index the track was last seen
+    float area = 0;
+    float score = 0;
+    bool ready = false;  // results of the last inference are stored
+    CNInferAttrs attrs;
+    StringPairs extra_attrs;
+    CNInferFeatures features;
+    std::vector<Waiter> waiters;
+  };
+  struct Stream {
+    uint64_t frame_idx = 0;
+    std::unordered_map<std::string, Track> tracks;
+  };
+  static void CopyResults(const Track& track, const std::shared_ptr<CNInferObject>& obj);
+
+  const uint32_t interval_ = 1;
+  const float box_growth_ = 0;
+  const float score_gain_ = 0;
+  std::mutex mutex_;
+  std::unordered_map<std::string, Stream> streams_;
+  std::atomic<uint64_t> inferred_cnt_{0};
+  std::atomic<uint64_t> skipped_cnt_{0};
+};  // class ObjInferCache
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_SRC_OBJ_INFER_CACHE_HPP_
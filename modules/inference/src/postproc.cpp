@@ -44,6 +44,25 @@ Postproc* Postproc::Create(const std::string& proc_name) { return ReflexObjectEx
 
 void Postproc::SetThreshold(const float threshold) { threshold_ = threshold; }
 
+// the outputs of the batch item, see Postproc::ExecuteBatch
+static vector<float*> BatchItemOutputs(const vector<float*>& net_outputs, const std::shared_ptr<edk::ModelLoader>& model,
+                                       size_t bidx) {
+  vector<float*> outputs;
+  for (size_t i = 0; i < net_outputs.size(); ++i) {
+    outputs.push_back(net_outputs[i] + bidx * model->OutputShape(i).DataCount());
+  }
+  return outputs;
+}
+
+int Postproc::ExecuteBatch(const vector<float*>& net_outputs, const std::shared_ptr<edk::ModelLoader>& model,
+                           const vector<CNFrameInfoPtr>& packages) {
+  int ret = 0;
+  for (size_t bidx = 0; bidx < packages.size(); ++bidx) {
+    if (Execute(BatchItemOutputs(net_outputs, model, bidx), model, packages[bidx]) != 0) ret = -1;
+  }
+  return ret;
+}
+
 ObjPostproc::~ObjPostproc() {}
 
 ObjPostproc* ObjPostproc::Create(const std::string& proc_name) {
@@ -52,4 +71,14 @@ ObjPostproc* ObjPostproc::Create(const std::string& proc_name) {
 
 void ObjPostproc::SetThreshold(const float threshold) { threshold_ = threshold; }
 
+int ObjPostproc::ExecuteBatch(const vector<float*>& net_outputs, const std::shared_ptr<edk::ModelLoader>& model,
+                              const vector<pair<CNFrameInfoPtr, std::shared_ptr<CNInferObject>>>& obj_infos) {
+  int ret = 0;
+  for (size_t bidx = 0; bidx < obj_infos.size(); ++bidx) {
+    const auto& obj_info = obj_infos[bidx];
+    if (Execute(BatchItemOutputs(net_outputs, model, bidx), model, obj_info.first, obj_info.second) != 0) ret = -1;
+  }
+  return ret;
+}
+
 }  // namespace cnstream
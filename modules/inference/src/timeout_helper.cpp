@@ -18,93 +18,91 @@
  * THE SOFTWARE.
  *************************************************************************/
 
-#include <condition_variable>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <mutex>
-#include <thread>
 
 #include "timeout_helper.hpp"
 #include "cnstream_logging.hpp"
 
 namespace cnstream {
 
-TimeoutHelper::TimeoutHelper() { handle_th_ = std::thread(&TimeoutHelper::HandleFunc, this); }
+TimeoutHelper::TimeoutHelper() : state_(std::make_shared<State>()) {}
 
 TimeoutHelper::~TimeoutHelper() {
-  std::unique_lock<std::mutex> lk(mtx_);
-  state_ = STATE_EXIT;
-  lk.unlock();
-  cond_.notify_all();
-  if (handle_th_.joinable()) handle_th_.join();
+  std::lock_guard<std::mutex> lk(state_->mtx);
+  state_->exit = true;
+  state_->func = nullptr;
+  TimerWheel::Instance().Cancel(state_->task_id);
 }
 
 int TimeoutHelper::SetTimeout(float timeout) {
   if (timeout < 0) {
     return 1;
   } else {
-    std::lock_guard<std::mutex> lk(mtx_);
+    std::lock_guard<std::mutex> lk(state_->mtx);
     timeout_ = timeout;
     return 0;
   }
 }
 
 int TimeoutHelper::Reset(const std::function<void()>& func) {
-  if (STATE_EXIT == state_) {
+  if (state_->exit) {
     LOGW(INFERENCER) << "Timeout Operator has been exit.";
     return 1;
   }
-  func_ = func;
-  if (func) {
-    if (STATE_NO_FUNC == state_) {
-      state_ = STATE_DO;
-    } else if (STATE_DO == state_ || STATE_RESET == state_) {
-      state_ = STATE_RESET;
-    } else {
-      LOGF(INFERENCER) << "Unexpected logic.";
-    }
-  } else {
-    state_ = STATE_NO_FUNC;
+  state_->func = func;
+  ++state_->generation;
+  if (!func) {
+    if (state_->task_id) TimerWheel::Instance().Cancel(state_->task_id);
+    state_->task_id = 0;
+    ++state_->task_seq;
+    return 0;
   }
-  cond_.notify_one();
+  state_->deadline =
+      std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<uint64_t>(timeout_ * 1e3));
+  // the task scheduled runs before the deadline is kept, it is scheduled again when it runs
+  if (state_->task_id && state_->wake <= state_->deadline) return 0;
+  if (state_->task_id) TimerWheel::Instance().Cancel(state_->task_id);
+  Schedule(state_, state_->deadline);
   return 0;
 }
 
-void TimeoutHelper::HandleFunc() {
-  std::unique_lock<std::mutex> lk(mtx_);
-  while (state_ != STATE_EXIT) {
-    cond_.wait(lk, [this]() -> bool { return state_ == STATE_EXIT || state_ != STATE_NO_FUNC; });
+int TimeoutHelper::Reset(const std::function<void()>& func, float timeout) {
+  if (timeout < 0) return 1;
+  timeout_ = timeout;
+  return Reset(func);
+}
 
-    auto wait_time = std::chrono::nanoseconds(static_cast<uint64_t>(timeout_ * 1e6));
-    cond_.wait_for(lk, wait_time, [this]() -> bool {
-      return state_ == STATE_EXIT || state_ == STATE_NO_FUNC || state_ == STATE_RESET;
-    });
+void TimeoutHelper::Schedule(const std::shared_ptr<State>& state, std::chrono::steady_clock::time_point when) {
+  const uint64_t task_seq = ++state->task_seq;
+  state->wake = when;
+  state->task_id = TimerWheel::Instance().Schedule(when, [state, task_seq]() { HandleFunc(state, task_seq); });
+}
 
-    if (STATE_RESET == state_) {
-      state_ = STATE_DO;
-      continue;
-    } else if (STATE_NO_FUNC == state_) {
-      continue;
-    } else if (STATE_EXIT == state_) {
-      break;
-    } else if (STATE_DO == state_) {
-      LOGF_IF(INFERENCER, static_cast<bool>(func_) == false) << "Bad logic: state_ is STATE_DO, but function is NULL.";
-      func_();
-      timeout_print_cnt_++;
-      if (timeout_print_cnt_ == TIMEOUT_PRINT_INTERVAL) {
-        timeout_print_cnt_ = 0;
-        LOGI(INFERENCER) << "Batching timeout. The trigger frequency of timeout processing can be reduced by"
-                     " increasing the timeout time(see batching_timeout parameter of the inferencer module). If the"
-                     " decoder memory is reused, the trigger frequency of timeout processing can also be reduced by"
-                     " increasing the number of cache blocks output by the decoder(see output_buf_number parameter of"
-                     " the source module). ";
-      }
-      func_ = NULL;  // unbind resources.
-      state_ = STATE_NO_FUNC;
-    } else {
-      LOGF(INFERENCER) << "Unexpected logic.";
-      break;
-    }
+void TimeoutHelper::HandleFunc(const std::shared_ptr<State>& state, uint64_t task_seq) {
+  std::lock_guard<std::mutex> lk(state->mtx);
+  // cancelled or destructed after the task is taken by the timer wheel
+  if (state->exit || state->task_seq != task_seq) return;
+  state->task_id = 0;
+  if (!state->func) return;
+  if (std::chrono::steady_clock::now() < state->deadline) {
+    // reset after the task is scheduled
+    Schedule(state, state->deadline);
+    return;
+  }
+  state->func();
+  state->timeout_print_cnt++;
+  if (state->timeout_print_cnt == TIMEOUT_PRINT_INTERVAL) {
+    state->timeout_print_cnt = 0;
+    LOGI(INFERENCER) << "Batching timeout. The trigger frequency of timeout processing can be reduced by"
+                 " increasing the timeout time(see batching_timeout parameter of the inferencer module). If the"
+                 " decoder memory is reused, the trigger frequency of timeout processing can also be reduced by"
+                 " increasing the number of cache blocks output by the decoder(see output_buf_number parameter of"
+                 " the source module). ";
   }
+  state->func = nullptr;  // unbind resources.
 }
 
 }  // namespace cnstream
@@ -21,15 +21,25 @@
 #ifndef MODULES_INFERENCE_SRC_FRAME_TIMEOUT_HELPER_HPP_
 #define MODULES_INFERENCE_SRC_FRAME_TIMEOUT_HELPER_HPP_
 
-#include <condition_variable>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <mutex>
-#include <thread>
+
+#include "util/cnstream_timer.hpp"
 
 #define TIMEOUT_PRINT_INTERVAL 100
 
 namespace cnstream {
 class TimeoutHelperTest;
+/**
+ * TimeoutHelper calls a function if it is not reset within the timeout. The timeouts of all the inferencers are
+ * served by the shared timer wheel, see TimerWheel.
+ *
+ * Resetting only moves the deadline. The task scheduled is kept if it runs no later than the new deadline, and it
+ * schedules itself again at the deadline when it runs early, so the wheel is touched about once per timeout instead
+ * of once per frame.
+ */
 class TimeoutHelper {
  public:
   friend class TimeoutHelperTest;
@@ -37,24 +47,37 @@ class TimeoutHelper {
 
   ~TimeoutHelper();
 
-  void LockOperator() { mtx_.lock(); }
+  void LockOperator() { state_->mtx.lock(); }
 
-  void UnlockOperator() { mtx_.unlock(); }
+  void UnlockOperator() { state_->mtx.unlock(); }
 
   int SetTimeout(float timeout);
 
   int Reset(const std::function<void()>& func);
 
+  /* Same as Reset(func), and waits for `timeout` ms this time. Must be called between LockOperator and
+   * UnlockOperator. */
+  int Reset(const std::function<void()>& func, float timeout);
+
  private:
-  enum State { STATE_NO_FUNC = 0, STATE_RESET, STATE_DO, STATE_EXIT } state_ = STATE_NO_FUNC;
-  void HandleFunc();
+  // shared with the tasks of the timer wheel, which may run after the helper is destructed
+  struct State {
+    std::mutex mtx;
+    std::function<void()> func;
+    uint64_t generation = 0;  // increased by each reset
+    bool exit = false;
+    uint32_t timeout_print_cnt = 0;
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::steady_clock::time_point wake;  // the time the task scheduled runs
+    TimerWheel::TaskId task_id = 0;  // 0 if no task is scheduled
+    uint64_t task_seq = 0;  // increased by each task scheduled, the tasks cancelled too late are ignored
+  };
+  // called with state->mtx locked
+  static void Schedule(const std::shared_ptr<State>& state, std::chrono::steady_clock::time_point when);
+  static void HandleFunc(const std::shared_ptr<State>& state, uint64_t task_seq);
 
-  std::mutex mtx_;
-  std::condition_variable cond_;
-  std::function<void()> func_;
-  std::thread handle_th_;
+  std::shared_ptr<State> state_;
   float timeout_ = 0;
-  uint32_t timeout_print_cnt_ = 0;
 };  // class TimeoutHelper
 
 }  // namespace cnstream
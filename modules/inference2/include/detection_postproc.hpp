@@ -0,0 +1,148 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE2_INCLUDE_DETECTION_POSTPROC_HPP_
+#define MODULES_INFERENCE2_INCLUDE_DETECTION_POSTPROC_HPP_
+
+/**
+ *  @file detection_postproc.hpp
+ *
+ *  This file contains the helpers shared by the postprocessing of detection networks.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief A detected box. The coordinates are normalized to the original image.
+ */
+struct DetectionBox {
+  int label = 0;
+  float score = 0;
+  float left = 0;
+  float top = 0;
+  float right = 0;
+  float bottom = 0;
+};
+
+/**
+ * @brief Maps the coordinates on the model input back to the original image.
+ *
+ * The image is expected to be placed at the center of the model input if the aspect ratio is kept, e.g.
+ * keep_aspect_ratio of Inferencer2 is true, or VideoPreprocYolov3 is used.
+ */
+class BoxRectifier {
+ public:
+  /**
+   * @param model_w The width of the model input.
+   * @param model_h The height of the model input.
+   * @param img_w The width of the original image.
+   * @param img_h The height of the original image.
+   * @param keep_aspect_ratio Whether the image is padded to the model input with the aspect ratio kept.
+   * @param normalized Whether the coordinates of the model outputs are normalized to the model input, or in pixels.
+   */
+  BoxRectifier(int model_w, int model_h, int img_w, int img_h, bool keep_aspect_ratio = true,
+               bool normalized = true);
+
+  float X(float x) const { return x * scale_x_ + offset_x_; }
+  float Y(float y) const { return y * scale_y_ + offset_y_; }
+
+ private:
+  float scale_x_ = 1;
+  float scale_y_ = 1;
+  float offset_x_ = 0;
+  float offset_y_ = 0;
+};  // class BoxRectifier
+
+/**
+ * @brief Decodes the boxes of the detection output layout, which is used by the ssd and yolo networks.
+ *
+ * Each box takes 7 floats: [batch index, label, score, left, top, right, bottom]. The boxes are filtered by the
+ * score before being rectified, and clamped to the image. Empty boxes are dropped.
+ *
+ * @param data The first box.
+ * @param box_num The number of boxes.
+ * @param threshold Boxes with a lower score are dropped. No box is dropped by the score if it is not positive.
+ * @param rectifier Maps the coordinates to the original image.
+ * @param boxes The decoded boxes are appended to it.
+ * @param label_offset Added to the labels, boxes with negative labels are dropped, e.g. -1 drops the background
+ *                     class 0 of ssd networks.
+ *
+ * @return Returns the number of decoded boxes.
+ */
+size_t DecodeDetections(const float* data, uint32_t box_num, float threshold, const BoxRectifier& rectifier,
+                        std::vector<DetectionBox>* boxes, int label_offset = 0);
+
+/**
+ * @brief Computes the sigmoid of n values, in and out could be the same.
+ */
+void Sigmoid(const float* in, size_t n, float* out);
+
+/**
+ * @brief Gets the logit of the probability, the inverse of sigmoid.
+ *
+ * Scores before sigmoid could be compared with the logit of the threshold, so that sigmoid is computed only on the
+ * values passing the threshold.
+ */
+float Logit(float p);
+
+/**
+ * @brief Gets the indices of the scores passing the threshold.
+ *
+ * @param scores The first score.
+ * @param n The number of the scores.
+ * @param stride The distance between two scores, in number of floats.
+ * @param threshold Scores not lower than it are selected.
+ * @param indices The indices of the selected scores are appended to it.
+ *
+ * @return Returns the number of the selected scores.
+ */
+size_t FilterByScore(const float* scores, size_t n, size_t stride, float threshold, std::vector<uint32_t>* indices);
+
+/**
+ * @brief Computes the intersection over union of two boxes.
+ */
+float IoU(const DetectionBox& a, const DetectionBox& b);
+
+/**
+ * @brief Non-maximum suppression.
+ *
+ * The boxes are sorted and partitioned by the labels, so that a box is only compared with the boxes of the same
+ * class with a higher score. The kept boxes are ordered by the label and then by the score in descending order.
+ *
+ * @param boxes The boxes, the suppressed boxes are removed.
+ * @param iou_threshold Boxes overlapping a box with a higher score by more than it are suppressed.
+ * @param class_agnostic Suppresses boxes of different classes too.
+ */
+void Nms(std::vector<DetectionBox>* boxes, float iou_threshold, bool class_agnostic = false);
+
+/**
+ * @brief Appends the boxes to the objects of a frame. The labels are set to the ids of the objects.
+ */
+void AppendInferObjects(const std::vector<DetectionBox>& boxes, CNInferObjs* objs_holder);
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE2_INCLUDE_DETECTION_POSTPROC_HPP_
@@ -23,12 +23,14 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
 #include "cnis/contrib/video_helper.h"
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
+#include "cnstream_config.hpp"
 #include "cnstream_frame_va.hpp"
 #include "frame_filter.hpp"
 #include "obj_filter.hpp"
@@ -63,11 +65,23 @@ using InferShape = infer_server::Shape;
 using InferCpuPreprocess = infer_server::PreprocessorHost;
 using InferPostprocess = infer_server::Postprocessor;
 
+/**
+ * @brief A region of interest of the frames. The frames are inferred on the crops of the regions instead of the whole
+ * frames, see Infer2Param::rois.
+ */
+struct InferRoi {
+  CNInferBoundingBox box = {0, 0, 1, 1};  ///< The crop normalized to the frame, the bounding box of the polygon.
+  std::vector<std::pair<float, float>> polygon;  ///< The vertices normalized to the frame, empty for rectangles.
+};  // struct InferRoi
+
 /**
  * @brief The inference parameters used in Inferencer2 Module.
  */
 struct Infer2Param {
   uint32_t device_id = 0;
+  std::vector<uint32_t> device_ids;  ///< devices to balance the streams over, device_id is used when it is empty
+  bool all_devices = false;  ///< balance the streams over all devices, set by device_ids "auto"
+  uint32_t affinity_threshold = 1;  ///< see DeviceLoadBalancer
   uint32_t priority = 0;
   uint32_t engine_num = 1;
   bool show_stats = false;
@@ -76,6 +90,7 @@ struct Infer2Param {
   bool keep_aspect_ratio = false;
   InferVideoPixelFmt model_input_pixel_format = InferVideoPixelFmt::RGBA;
   InferDimOrder data_order = InferDimOrder::NHWC;
+  bool native_data_order = false;  ///< the outputs keep the order of the model, not transposed on host
   std::vector<float> mean_;
   std::vector<float> std_;
   std::string func_name = "";
@@ -88,6 +103,27 @@ struct Infer2Param {
   bool object_infer = false;
   float threshold = 0.f;
   uint32_t infer_interval = 0;
+  bool share_session = false;  ///< share the session with the modules using the same model and processing
+  bool cache_model = false;  ///< keep the model loaded in the process, see ModelCache
+  bool warmup = false;  ///< run the model on dummy inputs of every batch size when opened
+  bool batch_postproc = false;  ///< postprocess all the inputs of a request in one call, see VideoPostproc::ExecuteBatch
+  uint32_t latency_budget = 0;  ///< unit[ms], 0 means no budget. The default budget of streams.
+  std::unordered_map<std::string, uint32_t> stream_latency_budgets;  ///< budgets of specified streams, unit[ms]
+  bool drop_late_frames = false;  ///< skip inference of frames which have exceeded the latency budget
+  float motion_threshold = 0.f;  ///< see MotionFrameFilter, 0 means the motion filter is disabled
+  uint32_t motion_max_skip = 25;  ///< frames skipped by the motion filter in a row at most, 0 means no limit
+  std::vector<InferRoi> rois;  ///< regions of interest of all streams, empty means the whole frames are inferred
+  std::unordered_map<std::string, std::vector<InferRoi>> stream_rois;  ///< regions of specified streams
+  uint32_t tile_width = 0;  ///< the frames are sliced into tiles of tile_width x tile_height, 0 means no tiling
+  uint32_t tile_height = 0;
+  float tile_overlap = 0.2f;  ///< the ratio of a tile overlapping its neighbours
+  bool tile_full_frame = false;  ///< infer the whole frame besides the tiles, for the large objects
+  float tile_merge_threshold = 0.5f;  ///< see MergeTileObjects
+  float tile_motion_threshold = 0.f;  ///< only the tiles with motion are inferred, 0 means all tiles are inferred
+  std::string cascade_attr;  ///< the attribute set by the earlier stage of a cascade, empty means no cascade
+  float cascade_threshold = 0.9f;  ///< the objects with cascade_attr scoring at least it exit the cascade
+  uint32_t result_cache_size = 0;  ///< the max number of frames whose objects are cached, 0 means no cache
+  std::vector<ModuleParamSet> secondary_models;  ///< parameters of the models inferring the objects in the same stage
   std::unordered_map<std::string, std::string> custom_preproc_params;
   std::unordered_map<std::string, std::string> custom_postproc_params;
 };  // struct Infer2Param
@@ -115,6 +151,12 @@ class InferHandler {
 
   void TransmitData(const CNFrameInfoPtr& data);
 
+  /**
+   * @brief Sets the handler inferring the objects of the frames transmitted by this handler, see
+   * Infer2Param::secondary_models. The frames are transmitted by the last handler of the chain.
+   */
+  void SetNext(std::shared_ptr<InferHandler> next) { next_ = std::move(next); }
+
  protected:
   Inferencer2* module_ = nullptr;
   Infer2Param params_;
@@ -122,6 +164,7 @@ class InferHandler {
   std::shared_ptr<VideoPreproc> preprocessor_ = nullptr;
   std::shared_ptr<FrameFilter> frame_filter_ = nullptr;
   std::shared_ptr<ObjFilter> obj_filter_ = nullptr;
+  std::shared_ptr<InferHandler> next_ = nullptr;
 };
 
 }  // namespace cnstream
@@ -24,8 +24,12 @@
  *  This file contains a declaration of class Inferencer2
  */
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "cnstream_frame.hpp"
@@ -36,6 +40,7 @@
 namespace cnstream {
 
 class Infer2ParamManager;
+class DeviceLoadBalancer;
 /**
  * @brief for inference based on infer_server.
  */
@@ -85,12 +90,77 @@ class Inferencer2 : public Module, public ModuleCreator<Inferencer2> {
    */
   bool CheckParamSet(const ModuleParamSet& paramSet) const override;
 
+  /**
+   * @brief Called by the loading thread of ReloadModel with whether the new model is used.
+   */
+  using ReloadCallback = std::function<void(bool success)>;
+
+  /**
+   * @brief Loads another model in the background and switches to it without stopping the pipeline.
+   *
+   * The handlers of the new model are opened and warmed up by a thread, the frames keep being inferred by the current
+   * model meanwhile. Once the new model is ready, the frames processed afterwards are inferred by it. The requests
+   * already sent are finished by the old model, and each stream is moved to the new model after its frames in flight,
+   * so the frames of a stream are still transmitted in order. If the new model fails to be loaded, an
+   * EVENT_WARNING is posted and the current model is kept.
+   *
+   * @param model_path The path of the new model.
+   * @param func_name The function name of the new model. The current one is used if it is empty.
+   * @param callback Called when the new model is used or fails to be loaded. It could be empty and it should not call
+   *                 ReloadModel.
+   *
+   * @return Returns false if the module is not opened or another model is being loaded.
+   */
+  bool ReloadModel(const std::string& model_path, const std::string& func_name = "", ReloadCallback callback = nullptr);
+
+  /**
+   * @brief Returns the number of models switched to by ReloadModel since the module is opened.
+   */
+  uint64_t GetModelGeneration() const { return generation_.load(); }
+
   virtual ~Inferencer2();
 
  private:
-  std::shared_ptr<InferHandler> infer_handler_ = nullptr;  ///< inference2 handler
+  /* the handlers of one model */
+  struct HandlerGroup {
+    std::vector<std::shared_ptr<InferHandler>> handlers;  ///< inference2 handlers, one for each device
+    uint64_t generation = 0;
+  };
+
+  /* the processors of a model */
+  struct Processors {
+    std::shared_ptr<VideoPreproc> pre_processor = nullptr;
+    std::shared_ptr<VideoPostproc> post_processor = nullptr;
+    std::shared_ptr<FrameFilter> frame_filter = nullptr;
+    std::shared_ptr<ObjFilter> obj_filter = nullptr;
+  };
+  /* a model inferring the objects after the model of the module, see Infer2Param::secondary_models */
+  struct SecondaryModel {
+    Infer2Param params;
+    Processors processors;
+  };
+
+  bool CreateProcessors(const Infer2Param& params, Processors* processors);
+  /* makes the frame data available on the device, copies it from the other device if needed */
+  void PrepareDeviceData(const CNDataFramePtr& frame, uint32_t device_id);
+  bool OpenHandlers(const Infer2Param& params, std::vector<std::shared_ptr<InferHandler>>* handlers);
+  /* gets the handlers of the current model for the stream, moves the stream to them after a reload */
+  std::shared_ptr<HandlerGroup> AcquireGroup(const CNFrameInfoPtr& data);
+  std::shared_ptr<HandlerGroup> CurrentGroup();
+
+  std::shared_ptr<HandlerGroup> group_ = nullptr;  ///< the handlers of the current model
+  std::mutex group_mutex_;
+  std::atomic<uint64_t> generation_{0};
+  std::vector<std::shared_ptr<HandlerGroup>> stream_groups_;  ///< the handlers last used, by stream index
+  std::shared_ptr<DeviceLoadBalancer> balancer_ = nullptr;  ///< routes streams to devices, null for one device
+  std::vector<uint32_t> device_ids_;
+  Processors processors_;
+  std::vector<SecondaryModel> secondary_models_;
   Infer2Param infer_params_;
   std::shared_ptr<Infer2ParamManager> param_manager_ = nullptr;
+  std::mutex reload_mutex_;
+  std::thread reload_thread_;
+  std::atomic<bool> reloading_{false};
 };  // class Inferencer2
 
 }  // namespace cnstream
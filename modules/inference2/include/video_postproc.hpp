@@ -96,8 +96,41 @@ class VideoPostproc : virtual public ReflexObjectEx<VideoPostproc> {
   virtual bool Execute(infer_server::InferData* output_data, const infer_server::ModelIO& model_output,
                        const infer_server::ModelInfo* model_info) = 0;
 
+  /**
+   * @brief Executes postprocessing on the model's output data of all the inputs of a request.
+   *
+   * @param[out] output_data The postprocessing results, one for each input of the request, e.g. each object of a
+   *                         frame on secondary inference.
+   * @param[in] model_outputs The neural network origin output data, one for each input.
+   * @param[in] model_info The model information, such as input/output number and shape.
+   *
+   * @return Returns true if successful, otherwise returns false.
+   *
+   * @note This function is executed instead of Execute when batch_postproc of Inferencer2 is enabled, in the
+   *       thread responsing the requests. Override it to postprocess the inputs in one call, e.g. to lock the
+   *       objects of a frame once. By default, Execute is called on each input.
+   */
+  virtual bool ExecuteBatch(const std::vector<infer_server::InferData*>& output_data,
+                            const std::vector<const infer_server::ModelIO*>& model_outputs,
+                            const infer_server::ModelInfo* model_info);
+
+  /**
+   * @brief Gets the region of interest the input being postprocessed is cropped from, see rois of Inferencer2.
+   *
+   * @return Returns the region normalized to the frame, which is the whole frame if the frame is not cropped.
+   *
+   * @note The boxes set by Execute should be normalized to the region, they are mapped back to the frame by
+   *       Inferencer2. E.g. the size of the region is the size of the image to rectify the boxes by when the aspect
+   *       ratio is kept. It is valid in Execute only.
+   */
+  static CNInferBoundingBox GetInputRoi();
+
  protected:
   float threshold_ = 0;
+
+ private:
+  friend class InferHandlerImpl;
+  static void SetInputRoi(const CNInferBoundingBox& roi);
 };  // class VideoPostproc
 
 }  // namespace cnstream
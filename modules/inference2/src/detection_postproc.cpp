@@ -0,0 +1,153 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "detection_postproc.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cnstream {
+
+BoxRectifier::BoxRectifier(int model_w, int model_h, int img_w, int img_h, bool keep_aspect_ratio, bool normalized) {
+  if (model_w <= 0 || model_h <= 0 || img_w <= 0 || img_h <= 0) return;
+  int scaled_w = model_w;
+  int scaled_h = model_h;
+  if (keep_aspect_ratio) {
+    const float scaling_factor = std::min(1.0 * model_w / img_w, 1.0 * model_h / img_h);
+    scaled_w = std::max(static_cast<int>(scaling_factor * img_w), 1);
+    scaled_h = std::max(static_cast<int>(scaling_factor * img_h), 1);
+  }
+  // x_on_image = (x_on_model_in_pixels - padding) / scaled_size
+  scale_x_ = (normalized ? model_w : 1.0f) / scaled_w;
+  scale_y_ = (normalized ? model_h : 1.0f) / scaled_h;
+  offset_x_ = -static_cast<float>((model_w - scaled_w) / 2) / scaled_w;
+  offset_y_ = -static_cast<float>((model_h - scaled_h) / 2) / scaled_h;
+}
+
+static inline float Clamp01(float v) { return std::max(0.0f, std::min(1.0f, v)); }
+
+size_t DecodeDetections(const float* data, uint32_t box_num, float threshold, const BoxRectifier& rectifier,
+                        std::vector<DetectionBox>* boxes, int label_offset) {
+  constexpr uint32_t kBoxStep = 7;
+  if (!data || !boxes) return 0;
+  // filters by score first, the other values of most boxes are not read
+  std::vector<uint32_t> indices;
+  FilterByScore(data + 2, box_num, kBoxStep, threshold > 0 ? threshold : -INFINITY, &indices);
+  const size_t origin_size = boxes->size();
+  boxes->reserve(origin_size + indices.size());
+  for (uint32_t idx : indices) {
+    const float* box = data + static_cast<size_t>(idx) * kBoxStep;
+    DetectionBox det;
+    det.label = static_cast<int>(box[1]) + label_offset;
+    if (det.label < 0) continue;
+    det.score = box[2];
+    det.left = Clamp01(rectifier.X(box[3]));
+    det.top = Clamp01(rectifier.Y(box[4]));
+    det.right = Clamp01(rectifier.X(box[5]));
+    det.bottom = Clamp01(rectifier.Y(box[6]));
+    if (det.right <= det.left || det.bottom <= det.top) continue;
+    boxes->push_back(det);
+  }
+  return boxes->size() - origin_size;
+}
+
+void Sigmoid(const float* in, size_t n, float* out) {
+  for (size_t i = 0; i < n; ++i) out[i] = 1.0f / (1.0f + std::exp(-in[i]));
+}
+
+float Logit(float p) {
+  if (p <= 0) return -INFINITY;
+  if (p >= 1) return INFINITY;
+  return std::log(p / (1.0f - p));
+}
+
+size_t FilterByScore(const float* scores, size_t n, size_t stride, float threshold, std::vector<uint32_t>* indices) {
+  if (!scores || !indices) return 0;
+  const size_t origin_size = indices->size();
+  for (size_t i = 0; i < n; ++i) {
+    if (scores[i * stride] >= threshold) indices->push_back(static_cast<uint32_t>(i));
+  }
+  return indices->size() - origin_size;
+}
+
+static inline float Area(const DetectionBox& box) { return (box.right - box.left) * (box.bottom - box.top); }
+
+static inline float IoU(const DetectionBox& a, float area_a, const DetectionBox& b, float area_b) {
+  const float w = std::min(a.right, b.right) - std::max(a.left, b.left);
+  const float h = std::min(a.bottom, b.bottom) - std::max(a.top, b.top);
+  if (w <= 0 || h <= 0) return 0;
+  const float inter = w * h;
+  return inter / (area_a + area_b - inter);
+}
+
+float IoU(const DetectionBox& a, const DetectionBox& b) { return IoU(a, Area(a), b, Area(b)); }
+
+void Nms(std::vector<DetectionBox>* boxes, float iou_threshold, bool class_agnostic) {
+  if (!boxes || boxes->size() < 2) return;
+  std::vector<DetectionBox>& dets = *boxes;
+  std::stable_sort(dets.begin(), dets.end(), [class_agnostic](const DetectionBox& a, const DetectionBox& b) {
+    if (!class_agnostic && a.label != b.label) return a.label < b.label;
+    return a.score > b.score;
+  });
+  std::vector<float> areas(dets.size());
+  for (size_t i = 0; i < dets.size(); ++i) areas[i] = Area(dets[i]);
+
+  size_t kept = 0;
+  size_t class_begin = 0;  // the first kept box of the current class
+  for (size_t i = 0; i < dets.size(); ++i) {
+    if (!class_agnostic && kept > class_begin && dets[kept - 1].label != dets[i].label) class_begin = kept;
+    bool suppressed = false;
+    // only the kept boxes of the same class with a higher score are compared
+    for (size_t k = class_begin; k < kept; ++k) {
+      if (IoU(dets[k], areas[k], dets[i], areas[i]) > iou_threshold) {
+        suppressed = true;
+        break;
+      }
+    }
+    if (suppressed) continue;
+    dets[kept] = dets[i];
+    areas[kept] = areas[i];
+    ++kept;
+  }
+  dets.resize(kept);
+}
+
+void AppendInferObjects(const std::vector<DetectionBox>& boxes, CNInferObjs* objs_holder) {
+  if (!objs_holder || boxes.empty()) return;
+  std::vector<std::shared_ptr<CNInferObject>> objs;
+  objs.reserve(boxes.size());
+  for (const DetectionBox& box : boxes) {
+    auto obj = objs_holder->CreateObject();
+    obj->id = std::to_string(box.label);
+    obj->score = box.score;
+    obj->bbox.x = box.left;
+    obj->bbox.y = box.top;
+    obj->bbox.w = box.right - box.left;
+    obj->bbox.h = box.bottom - box.top;
+    objs.push_back(obj);
+  }
+  objs_holder->Append(objs);
+}
+
+}  // namespace cnstream
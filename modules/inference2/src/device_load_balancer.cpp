@@ -0,0 +1,72 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "device_load_balancer.hpp"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cnstream {
+
+DeviceLoadBalancer::DeviceLoadBalancer(const std::vector<uint32_t>& device_ids, uint32_t affinity_threshold)
+    : device_ids_(device_ids), affinity_threshold_(affinity_threshold), stream_nums_(device_ids.size(), 0) {}
+
+size_t DeviceLoadBalancer::Route(const std::string& stream_id, int data_device) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto iter = routes_.find(stream_id);
+  if (iter != routes_.end()) return iter->second;
+
+  size_t least = 0;
+  for (size_t i = 1; i < stream_nums_.size(); ++i) {
+    if (stream_nums_[i] < stream_nums_[least]) least = i;
+  }
+  size_t index = least;
+  for (size_t i = 0; i < device_ids_.size(); ++i) {
+    if (data_device >= 0 && device_ids_[i] == static_cast<uint32_t>(data_device)) {
+      if (stream_nums_[i] - stream_nums_[least] <= affinity_threshold_) index = i;
+      break;
+    }
+  }
+  stream_nums_[index]++;
+  routes_[stream_id] = index;
+  return index;
+}
+
+int DeviceLoadBalancer::Find(const std::string& stream_id) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto iter = routes_.find(stream_id);
+  return iter == routes_.end() ? -1 : static_cast<int>(iter->second);
+}
+
+void DeviceLoadBalancer::Release(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto iter = routes_.find(stream_id);
+  if (iter == routes_.end()) return;
+  stream_nums_[iter->second]--;
+  routes_.erase(iter);
+}
+
+uint32_t DeviceLoadBalancer::GetStreamNum(size_t index) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return index < stream_nums_.size() ? stream_nums_[index] : 0;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,89 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_DEVICE_LOAD_BALANCER_HPP_
+#define MODULES_DEVICE_LOAD_BALANCER_HPP_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief DeviceLoadBalancer routes the streams of an Inferencer2 module to the devices it runs on.
+ *
+ * A stream stays on one device until it is released, so that the frames of a stream are inferred in order. A new
+ * stream is routed to the device holding its frames, unless that device has more than `affinity_threshold` streams
+ * more than the least loaded device. Moving the stream costs a peer copy of each frame, so it is only done when the
+ * load gain outweighs it.
+ */
+class DeviceLoadBalancer {
+ public:
+  /**
+   * @param device_ids The devices to balance the streams over, must not be empty.
+   * @param affinity_threshold Streams keep the device of their frames while that device has no more than
+   *                           `affinity_threshold` streams more than the least loaded one.
+   */
+  DeviceLoadBalancer(const std::vector<uint32_t>& device_ids, uint32_t affinity_threshold);
+
+  /**
+   * @brief Gets the device of a stream, routes the stream if it has not been routed.
+   *
+   * @param stream_id The stream identification.
+   * @param data_device The device holding the frame data, -1 if the data is on CPU.
+   *
+   * @return Returns the index of the device in device ids.
+   */
+  size_t Route(const std::string& stream_id, int data_device);
+
+  /**
+   * @brief Finds the device of a stream.
+   *
+   * @return Returns the index of the device in device ids, -1 if the stream has not been routed.
+   */
+  int Find(const std::string& stream_id) const;
+
+  /**
+   * @brief Releases a stream, the device of the stream will not count it any more.
+   */
+  void Release(const std::string& stream_id);
+
+  size_t GetDeviceNum() const { return device_ids_.size(); }
+
+  uint32_t GetDeviceId(size_t index) const { return device_ids_[index]; }
+
+  /**
+   * @brief Gets the number of streams routed to a device.
+   */
+  uint32_t GetStreamNum(size_t index) const;
+
+ private:
+  const std::vector<uint32_t> device_ids_;
+  const uint32_t affinity_threshold_;
+  mutable std::mutex mtx_;
+  std::vector<uint32_t> stream_nums_;
+  std::map<std::string, size_t> routes_;
+};  // class DeviceLoadBalancer
+
+}  // namespace cnstream
+
+#endif  // MODULES_DEVICE_LOAD_BALANCER_HPP_
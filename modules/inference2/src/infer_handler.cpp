@@ -18,6 +18,7 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <queue>
@@ -27,10 +28,17 @@
 #include <typeinfo>
 #include <condition_variable>
 #include <algorithm>
+#include <iterator>
 
+#include "cnstream_mapped_file.hpp"
 #include "device/mlu_context.h"
 #include "infer_handler.hpp"
+#include "infer_roi.hpp"
+#include "model_cache.hpp"
+#include "motion_frame_filter.hpp"
 #include "postproc.hpp"
+#include "result_cache.hpp"
+#include "shared_infer_session.hpp"
 
 namespace cnstream {
 
@@ -43,11 +51,7 @@ class InferDataObserver : public InferEngineDataObserver {
       : infer_handler_(infer_handler) {}
 
   void Response(InferStatus status, InferPackagePtr result, InferUserData user_data) noexcept override {
-    if (status != InferStatus::SUCCESS) {
-      infer_handler_->PostEvent(EventType::EVENT_ERROR, "Process inference failed");
-    }
-    CNFrameInfoPtr data = infer_server::any_cast<CNFrameInfoPtr>(user_data);
-    infer_handler_->TransmitData(data);
+    infer_handler_->OnResponse(status, infer_server::any_cast<CNFrameInfoPtr>(user_data), result);
   }
 
  private:
@@ -79,12 +83,52 @@ InferHandlerImpl::~InferHandlerImpl() {
 }
 
 bool InferHandlerImpl::Open() {
+  auto start = std::chrono::steady_clock::now();
   // init cnrt environment
   if (!infer_server::SetCurrentDevice(params_.device_id)) return false;
-  return LinkInferServer();
+  if (params_.motion_threshold > 0) {
+    motion_filter_ = std::make_shared<MotionFrameFilter>(params_.motion_threshold, params_.motion_max_skip);
+  }
+  if (params_.tile_width > 0) {
+    tile_scheduler_ = std::make_shared<TileScheduler>(params_.tile_width, params_.tile_height, params_.tile_overlap,
+                                                      params_.tile_full_frame, params_.tile_motion_threshold,
+                                                      params_.motion_max_skip);
+  }
+  if (params_.result_cache_size > 0) result_cache_ = std::make_shared<ResultCache>(params_.result_cache_size);
+  if (!LinkInferServer()) return false;
+  std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+  startup_time_ = dura.count();
+  first_response_reported_ = false;
+  LOGI(INFERENCER2) << "[" << module_->GetName() << "] startup cost " << startup_time_ << "ms";
+  return true;
 }
 
 void InferHandlerImpl::Close() {
+  if (late_frame_cnt_.load()) {
+    LOGI(INFERENCER2) << "[" << module_->GetName() << "] frames exceeding the latency budget: " << late_frame_cnt_
+                      << ", not inferred: " << late_drop_cnt_;
+    late_frame_cnt_ = 0;
+    late_drop_cnt_ = 0;
+  }
+  if (static_frame_cnt_.load()) {
+    LOGI(INFERENCER2) << "[" << module_->GetName() << "] static frames not inferred: " << static_frame_cnt_;
+    static_frame_cnt_ = 0;
+  }
+  uint64_t cascade_total = cascade_exit_cnt_ + cascade_infer_cnt_;
+  if (cascade_total) {
+    LOGI(INFERENCER2) << "[" << module_->GetName() << "] objects exiting the cascade: " << cascade_exit_cnt_ << "/"
+                      << cascade_total << " (" << 100.0 * cascade_exit_cnt_ / cascade_total << "%)";
+    cascade_exit_cnt_ = 0;
+    cascade_infer_cnt_ = 0;
+  }
+  if (result_cache_) {
+    LOGI(INFERENCER2) << "[" << module_->GetName() << "] result cache hits: " << result_cache_->HitCount()
+                      << ", misses: " << result_cache_->MissCount();
+  }
+  if (shared_session_) {
+    shared_session_->RemoveCaller(this);
+    shared_session_.reset();
+  }
   infer_server::SetCurrentDevice(params_.device_id);
   if (session_) {
     infer_server_->DestroySession(session_);
@@ -107,33 +151,279 @@ inline int GetChannelNum(InferVideoPixelFmt pix_fmt) {
   }
 }
 
+void InferHandlerImpl::OnResponse(InferStatus status, const CNFrameInfoPtr& data, const InferPackagePtr& result) {
+  if (status != InferStatus::SUCCESS) {
+    PostEvent(EventType::EVENT_ERROR, "Process inference failed");
+    DropRois(data.get());
+  } else {
+    if (params_.batch_postproc && result) BatchPostprocess(result);
+    if (tile_scheduler_) MergeTiles(data);
+  }
+  if (result_cache_) WriteResultCache(data, status == InferStatus::SUCCESS);
+  if (motion_filter_ && !params_.object_infer) ReuseObjects(data);
+  if (!first_response_reported_.exchange(true)) {
+    first_frame_latency_ = data->GetElapsedTime();
+    LOGI(INFERENCER2) << "[" << module_->GetName() << "] first frame latency " << first_frame_latency_ << "ms";
+  }
+  TransmitData(data);
+}
+
+void InferHandlerImpl::ReuseObjects(const CNFrameInfoPtr& data) {
+  // responses of a stream are in order, the last inferred frame is responsed before the frames reusing its objects
+  std::lock_guard<std::mutex> lk(reuse_mutex_);
+  auto iter = reused_frames_.find(data.get());
+  if (iter == reused_frames_.end()) {
+    if (!data->collection.HasValue(kCNInferObjsSlot)) return;
+    // copied before being transmitted, the objects could be modified by the downstream modules
+    auto objs_holder = data->collection.Get(kCNInferObjsSlot);
+    std::vector<CNInferObjectPtr>& last_objs = last_objs_[data->stream_id];
+    last_objs.clear();
+    std::lock_guard<std::mutex> objs_lk(objs_holder->mutex_);
+    for (auto& obj : objs_holder->objs_) last_objs.push_back(CopyInferObject(obj));
+    return;
+  }
+  reused_frames_.erase(iter);
+  auto last_iter = last_objs_.find(data->stream_id);
+  if (last_iter == last_objs_.end()) return;
+  if (!data->collection.HasValue(kCNInferObjsSlot)) {
+    data->collection.Add(kCNInferObjsSlot, std::make_shared<CNInferObjs>());
+  }
+  std::vector<CNInferObjectPtr> objs;
+  for (auto& obj : last_iter->second) objs.push_back(CopyInferObject(obj));
+  data->collection.Get(kCNInferObjsSlot)->Append(objs);
+}
+
+bool InferHandlerImpl::ExitCascade(const CNInferObjectPtr& obj) {
+  // a missing attribute scores 0, the object is inferred
+  if (obj->GetAttribute(params_.cascade_attr).score >= params_.cascade_threshold) {
+    cascade_exit_cnt_++;
+    return true;
+  }
+  obj->RemoveAttribute(params_.cascade_attr);
+  cascade_infer_cnt_++;
+  return false;
+}
+
+bool InferHandlerImpl::ReadResultCache(const CNFrameInfoPtr& data, uint64_t key) {
+  if (!data->collection.HasValue(kCNInferObjsSlot)) {
+    data->collection.Add(kCNInferObjsSlot, std::make_shared<CNInferObjs>());
+  }
+  auto objs_holder = data->collection.Get(kCNInferObjsSlot);
+  std::vector<CNInferObjectPtr> objs;
+  if (result_cache_->Get(key, &objs)) {
+    objs_holder->Append(objs);
+    return true;
+  }
+  std::lock_guard<std::mutex> objs_lk(objs_holder->mutex_);
+  std::lock_guard<std::mutex> lk(cache_mutex_);
+  cache_misses_[data.get()] = {key, objs_holder->objs_.size()};
+  return false;
+}
+
+void InferHandlerImpl::WriteResultCache(const CNFrameInfoPtr& data, bool success) {
+  CacheMiss miss;
+  {
+    std::lock_guard<std::mutex> lk(cache_mutex_);
+    auto iter = cache_misses_.find(data.get());
+    if (iter == cache_misses_.end()) return;
+    miss = iter->second;
+    cache_misses_.erase(iter);
+  }
+  if (!success) return;
+  auto objs_holder = data->collection.Get(kCNInferObjsSlot);
+  std::lock_guard<std::mutex> objs_lk(objs_holder->mutex_);
+  auto first = objs_holder->objs_.begin() + std::min(miss.begin, objs_holder->objs_.size());
+  result_cache_->Put(miss.key, std::vector<CNInferObjectPtr>(first, objs_holder->objs_.end()));
+}
+
+void InferHandlerImpl::BatchPostprocess(const InferPackagePtr& result) {
+  std::vector<infer_server::InferData*> output_data;
+  // copied, the outputs could be replaced by the results set in postprocessing
+  std::vector<infer_server::ModelIO> model_outputs;
+  output_data.reserve(result->data.size());
+  model_outputs.reserve(result->data.size());
+  for (auto& data : result->data) {
+    if (!data->HasValue()) continue;
+    const InferRoi* roi = TakeRoi(data.get());
+    if (roi) {
+      // the crops are postprocessed one by one, so that their objects are mapped back to the frame
+      PostprocessRoi(*roi, data.get(), data->GetLref<infer_server::ModelIO>(), model_info_.get());
+      continue;
+    }
+    output_data.push_back(data.get());
+    model_outputs.push_back(data->GetLref<infer_server::ModelIO>());
+  }
+  if (output_data.empty()) return;
+  std::vector<const infer_server::ModelIO*> outputs;
+  outputs.reserve(model_outputs.size());
+  for (auto& output : model_outputs) outputs.push_back(&output);
+  if (!postprocessor_->ExecuteBatch(output_data, outputs, model_info_.get())) {
+    LOGE(INFERENCER2) << "[" << module_->GetName() << "] batch postprocessing failed.";
+  }
+}
+
+const std::vector<InferRoi>* InferHandlerImpl::GetRois(const std::string& stream_id) const {
+  auto iter = params_.stream_rois.find(stream_id);
+  const std::vector<InferRoi>& rois = iter != params_.stream_rois.end() ? iter->second : params_.rois;
+  return rois.empty() ? nullptr : &rois;
+}
+
+const InferRoi* InferHandlerImpl::TakeRoi(const infer_server::InferData* data) {
+  std::lock_guard<std::mutex> lk(roi_mutex_);
+  auto iter = roi_inputs_.find(data);
+  if (iter == roi_inputs_.end()) return nullptr;
+  const InferRoi* roi = iter->second.roi;
+  roi_inputs_.erase(iter);
+  return roi;
+}
+
+void InferHandlerImpl::DropRois(const CNFrameInfo* frame) {
+  std::lock_guard<std::mutex> lk(roi_mutex_);
+  for (auto iter = roi_inputs_.begin(); iter != roi_inputs_.end();) {
+    iter = iter->second.frame == frame ? roi_inputs_.erase(iter) : std::next(iter);
+  }
+  tiled_frames_.erase(frame);
+}
+
+bool InferHandlerImpl::Postprocess(infer_server::InferData* output_data, const infer_server::ModelIO& model_output,
+                                   const infer_server::ModelInfo* model_info) {
+  const InferRoi* roi = TakeRoi(output_data);
+  if (roi) return PostprocessRoi(*roi, output_data, model_output, model_info);
+  return postprocessor_->Execute(output_data, model_output, model_info);
+}
+
+void InferHandlerImpl::MergeTiles(const CNFrameInfoPtr& data) {
+  TiledFrame tiled;
+  {
+    std::lock_guard<std::mutex> lk(roi_mutex_);
+    auto iter = tiled_frames_.find(data.get());
+    if (iter == tiled_frames_.end()) return;
+    tiled = std::move(iter->second);
+    tiled_frames_.erase(iter);
+  }
+  if (!data->collection.HasValue(kCNInferObjsSlot)) {
+    data->collection.Add(kCNInferObjsSlot, std::make_shared<CNInferObjs>());
+  }
+  auto objs_holder = data->collection.Get(kCNInferObjsSlot);
+  std::lock_guard<std::mutex> objs_lk(objs_holder->mutex_);
+  auto& objs = objs_holder->objs_;
+  // only the objects detected on the tiles are merged
+  auto first = objs.begin() + std::min(tiled.begin, objs.size());
+  std::vector<CNInferObjectPtr> tile_objs(std::make_move_iterator(first), std::make_move_iterator(objs.end()));
+  objs.erase(first, objs.end());
+  tile_scheduler_->Merge(data->stream_id, *tiled.tiles, tiled.inferred, params_.tile_merge_threshold, &tile_objs);
+  objs.insert(objs.end(), std::make_move_iterator(tile_objs.begin()), std::make_move_iterator(tile_objs.end()));
+  objs_holder->Publish();
+}
+
+bool InferHandlerImpl::PostprocessRoi(const InferRoi& roi, infer_server::InferData* output_data,
+                                      const infer_server::ModelIO& model_output,
+                                      const infer_server::ModelInfo* model_info) {
+  CNFrameInfoPtr frame = output_data->GetUserData<CNFrameInfoPtr>();
+  std::lock_guard<std::mutex> lk(roi_postproc_mutex_);
+  if (!frame->collection.HasValue(kCNInferObjsSlot)) {
+    frame->collection.Add(kCNInferObjsSlot, std::make_shared<CNInferObjs>());
+  }
+  auto objs_holder = frame->collection.Get(kCNInferObjsSlot);
+  size_t begin = 0;
+  {
+    std::lock_guard<std::mutex> objs_lk(objs_holder->mutex_);
+    begin = objs_holder->objs_.size();
+  }
+  VideoPostproc::SetInputRoi(roi.box);
+  bool ret = postprocessor_->Execute(output_data, model_output, model_info);
+  VideoPostproc::SetInputRoi({0, 0, 1, 1});
+  std::lock_guard<std::mutex> objs_lk(objs_holder->mutex_);
+  auto& objs = objs_holder->objs_;
+  auto first = objs.begin() + std::min(begin, objs.size());
+  for (auto iter = first; iter != objs.end(); ++iter) (*iter)->bbox = MapRoiBox(roi, (*iter)->bbox);
+  if (!roi.polygon.empty()) {
+    objs.erase(std::remove_if(first, objs.end(), [&roi](const CNInferObjectPtr& obj) {
+      return !InferRoiContains(roi, obj->bbox.x + obj->bbox.w / 2, obj->bbox.y + obj->bbox.h / 2);
+    }), objs.end());
+  }
+  objs_holder->Publish();
+  return ret;
+}
+
 bool InferHandlerImpl::LinkInferServer() {
+  if (!params_.share_session) {
+    data_observer_ = std::make_shared<InferDataObserver>(this);
+    return CreateSession(data_observer_);
+  }
+  // the first module creates the session, the engine and the session are owned by the shared session then.
+  auto create = [this](SharedInferSession* shared) {
+    if (!CreateSession(shared->GetObserver())) return false;
+    shared->Reset(params_.device_id, std::move(infer_server_), session_, model_info_);
+    session_ = nullptr;
+    return true;
+  };
+  shared_session_ = InferSessionRegistry::Instance().Get(SharedInferSession::GetKey(params_), create);
+  if (!shared_session_) return false;
+  model_info_ = shared_session_->GetModel();
+  shared_session_->AddCaller(this);
+  return true;
+}
+
+bool InferHandlerImpl::Request(InferPackagePtr in, const CNFrameInfoPtr& data) {
+  if (shared_session_) return shared_session_->Request(this, std::move(in), data);
+  return infer_server_->Request(session_, std::move(in), data);
+}
+
+uint32_t InferHandlerImpl::GetLatencyBudget(const std::string& stream_id) const {
+  auto iter = params_.stream_latency_budgets.find(stream_id);
+  if (iter != params_.stream_latency_budgets.end()) return iter->second;
+  return params_.latency_budget;
+}
+
+bool InferHandlerImpl::IsLate(const CNFrameInfoPtr& data) {
+  uint32_t budget = GetLatencyBudget(data->stream_id);
+  if (0 == budget || data->GetElapsedTime() <= budget) return false;
+  late_frame_cnt_++;
+  return true;
+}
+
+bool InferHandlerImpl::CreateSession(std::shared_ptr<InferEngineDataObserver> observer) {
   // create inference2 engine, load model
   infer_server_.reset(new InferEngine(params_.device_id));
   std::shared_ptr<infer_server::ModelInfo> model_info{nullptr};
   std::string backend = infer_server::Predictor::Backend();
-  if (backend == "cnrt") {
-    if (params_.model_path.empty()) {
-      LOGE(INFERENCER2) << "[" << module_->GetName() << "] init offline model failed, "
-                      << "no valid model path.";
-      return false;
-    }
-    model_info = infer_server_->LoadModel(params_.model_path, params_.func_name);
-  } else if (backend == "magicmind") {
-    if (params_.model_path.empty()) {
-      LOGE(INFERENCER2) << "[" << module_->GetName() << "] init offline model failed, "
-                      << "no valid model path.";
-      return false;
+  auto load_model = [this, &backend]() -> InferModelInfoPtr {
+    if (backend == "cnrt") {
+      if (params_.model_path.empty()) {
+        LOGE(INFERENCER2) << "[" << module_->GetName() << "] init offline model failed, "
+                        << "no valid model path.";
+        return nullptr;
+      }
+      // loaded from the mapped file, the processes loading the model share its pages
+      std::shared_ptr<MappedFile> model_file = MappedFile::Open(params_.model_path);
+      if (model_file) return infer_server_->LoadModel(model_file->Data(), params_.func_name);
+      return infer_server_->LoadModel(params_.model_path, params_.func_name);
+    } else if (backend == "magicmind") {
+      if (params_.model_path.empty()) {
+        LOGE(INFERENCER2) << "[" << module_->GetName() << "] init offline model failed, "
+                        << "no valid model path.";
+        return nullptr;
+      }
+      std::shared_ptr<MappedFile> model_file = MappedFile::Open(params_.model_path);
+      if (model_file) return infer_server_->LoadModel(model_file->Data(), model_file->Size());
+      return infer_server_->LoadModel(params_.model_path);
     }
-    model_info = infer_server_->LoadModel(params_.model_path);
-  } else {
     LOGF(INFERENCER2) << "[" << module_->GetName() << "] backend not supported" << backend;
+    return nullptr;
+  };
+  if (params_.cache_model) {
+    model_info = ModelCache::Instance().Get(
+        ModelCache::GetKey(params_.device_id, params_.model_path, params_.func_name), load_model);
+  } else {
+    model_info = load_model();
   }
   if (!model_info) {
     LOGE(INFERENCER2) << "[" << module_->GetName() << "] init offline model failed,"
                       << "create model failed.";
     return false;
   }
+  model_info_ = model_info;
   int c = 3;
   switch (model_info->InputLayout(0).order) {
     case InferDimOrder::NHWC:
@@ -151,6 +441,13 @@ bool InferHandlerImpl::LinkInferServer() {
                         << model_info->InputShape(0);
       return false;
   }
+  // mean and std are applied per channel in the same pass as color conversion and resize
+  if (params_.preproc_name == "CNCV" && ((!params_.mean_.empty() && params_.mean_.size() != static_cast<size_t>(c)) ||
+                                         (!params_.std_.empty() && params_.std_.size() != static_cast<size_t>(c)))) {
+    LOGE(INFERENCER2) << "[" << module_->GetName() << "] the size of mean and std should be equal to the channel"
+                      << " number of the model input: " << c;
+    return false;
+  }
 
   InferSessionDesc desc;
   desc.name = module_->GetName();
@@ -166,6 +463,18 @@ bool InferHandlerImpl::LinkInferServer() {
     desc.host_input_layout = {InferDataType::FLOAT32, InferDimOrder::NHWC};
   }
   desc.host_output_layout = {InferDataType::FLOAT32, params_.data_order};
+  if (params_.native_data_order) {
+    // the outputs are only converted to float on host, one order is shared by all outputs
+    desc.host_output_layout.order = model_info->OutputLayout(0).order;
+    for (uint32_t i = 1; i < model_info->OutputNum(); ++i) {
+      if (model_info->OutputLayout(i).order != desc.host_output_layout.order) {
+        LOGW(INFERENCER2) << "[" << module_->GetName() << "] the outputs of the model are in different orders,"
+                          << " data_order NATIVE falls back to NHWC.";
+        desc.host_output_layout.order = InferDimOrder::NHWC;
+        break;
+      }
+    }
+  }
   InferVideoPixelFmt dst_format = params_.model_input_pixel_format;
   // preprocess
   if (params_.preproc_name == "RCOP") {
@@ -193,13 +502,28 @@ bool InferHandlerImpl::LinkInferServer() {
   }
   // postprocess
   desc.postproc = std::make_shared<InferPostprocess>();
-  auto postproc_func = std::bind(&VideoPostproc::Execute, postprocessor_, std::placeholders::_1,
-                                 std::placeholders::_2, std::placeholders::_3);
-  desc.postproc->SetParams<InferPostprocess::ProcessFunction>("process_function", postproc_func);
-  // observer
-  data_observer_ = std::make_shared<InferDataObserver>(this);
+  if (params_.batch_postproc) {
+    // the outputs are kept in the results, and postprocessed by VideoPostproc::ExecuteBatch when responsed
+    desc.postproc->SetParams<InferPostprocess::ProcessFunction>(
+        "process_function", [](infer_server::InferData* output_data, const infer_server::ModelIO& model_output,
+                               const infer_server::ModelInfo*) {
+          output_data->Set(model_output);
+          return true;
+        });
+  } else if (!params_.rois.empty() || !params_.stream_rois.empty() || params_.tile_width > 0) {
+    // the objects of the crops are mapped back to the frames, the session is destroyed before the handler
+    desc.postproc->SetParams<InferPostprocess::ProcessFunction>(
+        "process_function", [this](infer_server::InferData* output_data, const infer_server::ModelIO& model_output,
+                                   const infer_server::ModelInfo* model_info) {
+          return Postprocess(output_data, model_output, model_info);
+        });
+  } else {
+    auto postproc_func = std::bind(&VideoPostproc::Execute, postprocessor_, std::placeholders::_1,
+                                   std::placeholders::_2, std::placeholders::_3);
+    desc.postproc->SetParams<InferPostprocess::ProcessFunction>("process_function", postproc_func);
+  }
   // create session
-  session_ = infer_server_->CreateSession(desc, data_observer_);
+  session_ = infer_server_->CreateSession(desc, observer);
 
   bool ret = session_ != nullptr;
 
@@ -207,26 +531,99 @@ bool InferHandlerImpl::LinkInferServer() {
     LOGE(INFERENCER2) << "[" << module_->GetName() << "] [infer_server_] create session failed!";
   }
 
+  if (ret && params_.warmup) Warmup(desc);
+
   return session_ != nullptr;
 }
 
+void InferHandlerImpl::Warmup(const InferSessionDesc& session_desc) {
+  // A separated synchronous session with pre/postprocessing doing nothing, the model is run on dummy inputs.
+  // The inputs and outputs of the user processes are not touched, and the responses are not transmitted.
+  InferSessionDesc desc = session_desc;
+  desc.name = module_->GetName() + "/warmup";
+  desc.strategy = InferBatchStrategy::STATIC;
+  desc.show_perf = false;
+  desc.preproc = std::make_shared<InferCpuPreprocess>();
+  desc.preproc->SetParams<InferCpuPreprocess::ProcessFunction>(
+      "process_function",
+      [](infer_server::ModelIO*, const infer_server::InferData&, const infer_server::ModelInfo*) { return true; });
+  desc.postproc = std::make_shared<InferPostprocess>();
+  desc.postproc->SetParams<InferPostprocess::ProcessFunction>(
+      "process_function",
+      [](infer_server::InferData*, const infer_server::ModelIO&, const infer_server::ModelInfo*) { return true; });
+  InferEngineSession session = infer_server_->CreateSyncSession(desc);
+  if (!session) {
+    LOGW(INFERENCER2) << "[" << module_->GetName() << "] create warm-up session failed, skip warm-up.";
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  // every batch size could be met in dynamic batch strategy
+  uint32_t batch_size = desc.model->BatchSize();
+  for (uint32_t n = 1; n <= batch_size; ++n) {
+    InferPackagePtr in = infer_server::Package::Create(n, "__warmup__");
+    for (uint32_t i = 0; i < n; ++i) in->data[i]->Set(i);
+    InferPackagePtr out = infer_server::Package::Create(0);
+    InferStatus status;
+    if (!infer_server_->RequestSync(session, std::move(in), &status, out) || status != InferStatus::SUCCESS) {
+      LOGW(INFERENCER2) << "[" << module_->GetName() << "] warm-up with batch size " << n << " failed.";
+      break;
+    }
+  }
+  infer_server_->DestroySession(session);
+  std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+  LOGI(INFERENCER2) << "[" << module_->GetName() << "] warm-up " << batch_size << " batch sizes cost "
+                    << dura.count() << "ms";
+}
+
 int InferHandlerImpl::Process(CNFrameInfoPtr data, bool with_objs) {
   if (nullptr == data || data->IsEos()) return -1;
-  CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
 
   thread_local uint32_t drop_cnt = params_.infer_interval - 1;
   bool drop_data = params_.infer_interval > 0 && drop_cnt++ != params_.infer_interval - 1;
+  const char* drop_reason = kDROP_REASON_INTERVAL;
 
   if (!drop_data && frame_filter_ && !frame_filter_->Filter(data)) {
     drop_data = true;
     drop_cnt = 0;
+    drop_reason = kDROP_REASON_FILTER;
+  }
+
+  if (!drop_data && motion_filter_ && !motion_filter_->Filter(data)) {
+    drop_data = true;
+    drop_cnt = 0;
+    drop_reason = kDROP_REASON_FILTER;
+    static_frame_cnt_++;
+    if (!with_objs) {
+      std::lock_guard<std::mutex> lk(reuse_mutex_);
+      reused_frames_.insert(data.get());
+    }
+  }
+
+  // late frames are not inferred, so that they do not delay the frames still in time.
+  if (!drop_data && IsLate(data) && params_.drop_late_frames) {
+    drop_data = true;
+    drop_cnt = 0;
+    drop_reason = kDROP_REASON_LATE;
+    late_drop_cnt_++;
+  }
+
+  // the frames with the same content as a cached frame get its objects without inference
+  uint64_t cache_key = 0;
+  if (!drop_data && !with_objs && result_cache_ && HashFrame(frame, &cache_key) && ReadResultCache(data, cache_key)) {
+    drop_data = true;
+    drop_cnt = 0;
+    drop_reason = kDROP_REASON_CACHED;
   }
 
   if (drop_data) {
+    // the frame is passed through without inference, it is accounted as dropped by the inference
+    ModuleProfiler* profiler = module_->GetProfiler();
+    if (profiler) profiler->RecordDropped(data->stream_id, drop_reason);
     // to keep data in sequence, we pass empty package to infer_server, with CNFrameInfo as user data.
     // frame won't be inferred, and CNFrameInfo will be responsed in sequence
     infer_server::PackagePtr in = infer_server::Package::Create(0, data->stream_id);
-    if (!infer_server_->Request(session_, std::move(in), data)) {
+    if (!Request(std::move(in), data)) {
       LOGE(INFERENCER2) << "[" << module_->GetName() << "]"<< " Request sending data to infer server failed."
                         << " stream id: " << data->stream_id << " frame id: " << frame->frame_id;
       return -1;
@@ -261,20 +658,66 @@ int InferHandlerImpl::Process(CNFrameInfoPtr data, bool with_objs) {
   }
 
   if (!with_objs) {
-    infer_server::PackagePtr in = infer_server::Package::Create(1, data->stream_id);
-    in->data[0]->Set(std::move(vframe));
-    in->data[0]->SetUserData(data);
-    if (!infer_server_->Request(session_, std::move(in), data)) {
+    const std::vector<InferRoi>* rois = GetRois(data->stream_id);
+    std::vector<bool> inferred;
+    if (tile_scheduler_) {
+      // the tiles without motion are not inferred, their last objects are reused in MergeTiles
+      rois = &tile_scheduler_->GetTiles(frame->width, frame->height);
+      std::vector<uint8_t> thumbnail;
+      if (params_.tile_motion_threshold > 0) {
+        ReadMotionThumbnail(tile_scheduler_->GetMotionDetector(), frame, &thumbnail);
+      }
+      inferred = tile_scheduler_->Select(data->stream_id, *rois, std::move(thumbnail));
+    }
+    infer_server::PackagePtr in = infer_server::Package::Create(rois ? 0 : 1, data->stream_id);
+    if (!rois) {
+      in->data[0]->Set(std::move(vframe));
+      in->data[0]->SetUserData(data);
+    } else {
+      // the crops of the regions are batched instead of the whole frame
+      std::lock_guard<std::mutex> lk(roi_mutex_);
+      in->data.reserve(rois->size());
+      for (size_t idx = 0; idx < rois->size(); ++idx) {
+        if (!inferred.empty() && !inferred[idx]) continue;
+        const InferRoi& roi = (*rois)[idx];
+        InferVideoFrame tmp_frame = vframe;
+        tmp_frame.roi.x = roi.box.x;
+        tmp_frame.roi.y = roi.box.y;
+        tmp_frame.roi.w = roi.box.w;
+        tmp_frame.roi.h = roi.box.h;
+        auto* tmp = new infer_server::InferData;
+        tmp->Set(std::move(tmp_frame));
+        tmp->SetUserData(data);
+        in->data.emplace_back(tmp);
+        roi_inputs_[tmp] = {&roi, data.get()};
+      }
+      if (tile_scheduler_) {
+        size_t begin = 0;
+        if (data->collection.HasValue(kCNInferObjsSlot)) {
+          auto objs_holder = data->collection.Get(kCNInferObjsSlot);
+          std::lock_guard<std::mutex> objs_lk(objs_holder->mutex_);
+          begin = objs_holder->objs_.size();
+        }
+        tiled_frames_[data.get()] = {rois, std::move(inferred), begin};
+      }
+    }
+    if (!Request(std::move(in), data)) {
       LOGE(INFERENCER2) << "[" << module_->GetName() << "]"<< " Request sending data to infer server failed."
                         << " stream id: " << data->stream_id << " frame id: " << frame->frame_id;
+      if (rois) DropRois(data.get());
+      if (result_cache_) WriteResultCache(data, false);
       return -1;
     }
   } else {  /* secondary inference */
-    auto objs = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+    auto objs = data->collection.Get(kCNInferObjsSlot);
     infer_server::PackagePtr in = infer_server::Package::Create(0, data->stream_id);
     in->data.reserve(objs->objs_.size());
-    for (auto& obj : objs->objs_) {
-      if (obj_filter_ && !obj_filter_->Filter(data, obj)) continue;
+    std::vector<uint8_t> selected;
+    if (obj_filter_) obj_filter_->FilterObjects(data, objs->objs_, &selected);
+    for (size_t idx = 0; idx < objs->objs_.size(); ++idx) {
+      if (obj_filter_ && !selected[idx]) continue;
+      auto& obj = objs->objs_[idx];
+      if (!params_.cascade_attr.empty() && ExitCascade(obj)) continue;
       InferVideoFrame tmp_frame = vframe;
       infer_server::video::BoundingBox& box = tmp_frame.roi;
       box.x = obj->bbox.x;
@@ -286,7 +729,7 @@ int InferHandlerImpl::Process(CNFrameInfoPtr data, bool with_objs) {
       tmp->SetUserData(obj);
       in->data.emplace_back(tmp);
     }
-    if (!infer_server_->Request(session_, std::move(in), data)) {
+    if (!Request(std::move(in), data)) {
       LOGE(INFERENCER2) << "[" << module_->GetName() << "]"<< " Request sending data to infer server failed."
                         << " stream id: " << data->stream_id << " frame id: " << frame->frame_id;
       return -1;
@@ -296,7 +739,19 @@ int InferHandlerImpl::Process(CNFrameInfoPtr data, bool with_objs) {
 }
 
 void InferHandlerImpl::WaitTaskDone(const std::string& stream_id) {
-  if (infer_server_) infer_server_->WaitTaskDone(session_, stream_id);
+  if (shared_session_) {
+    shared_session_->WaitTaskDone(stream_id);
+  } else if (infer_server_) {
+    infer_server_->WaitTaskDone(session_, stream_id);
+  }
+  if (motion_filter_) {
+    motion_filter_->RemoveStream(stream_id);
+    std::lock_guard<std::mutex> lk(reuse_mutex_);
+    last_objs_.erase(stream_id);
+  }
+  if (tile_scheduler_) tile_scheduler_->RemoveStream(stream_id);
+  // the frames of the stream are all passed on to the next handler
+  if (next_) next_->WaitTaskDone(stream_id);
 }
 
 }  // namespace cnstream
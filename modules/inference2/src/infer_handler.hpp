@@ -21,14 +21,23 @@
 #ifndef MODULES_INFER_HANDLER_HPP_
 #define MODULES_INFER_HANDLER_HPP_
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "inferencer2.hpp"
 
 namespace cnstream {
 
 class InferDataObserver;
+class MotionFrameFilter;
+class ResultCache;
+class SharedInferSession;
+class TileScheduler;
 
 /**
  * @brief for inference handler used to do inference based on infer_server.
@@ -50,18 +59,131 @@ class InferHandlerImpl : public InferHandler {
   void WaitTaskDone(const std::string& stream_id) override;
 
   void PostEvent(EventType e, const std::string& msg) { module_->PostEvent(e, msg); }
+  /**
+   * @brief Called when the response of a request sent by this handler is received.
+   */
+  void OnResponse(InferStatus status, const CNFrameInfoPtr& data, const InferPackagePtr& result = nullptr);
+
+#ifdef UNIT_TEST
+ public:  // NOLINT
+#endif
+  /**
+   * @brief Returns the number of frames exceeding the latency budget when arriving at this handler.
+   */
+  uint64_t GetLateFrameCount() const { return late_frame_cnt_.load(); }
+
+  /**
+   * @brief Returns the latency budget of the stream, unit[ms]. 0 means no budget.
+   */
+  uint32_t GetLatencyBudget(const std::string& stream_id) const;
+
+  /**
+   * @brief Returns the number of frames not inferred as they are static, see Infer2Param::motion_threshold.
+   */
+  uint64_t GetStaticFrameCount() const { return static_frame_cnt_.load(); }
+
+  /**
+   * @brief Returns the number of objects exiting the cascade before this handler, see Infer2Param::cascade_attr.
+   */
+  uint64_t GetCascadeExitCount() const { return cascade_exit_cnt_.load(); }
+
+  /**
+   * @brief Returns the number of objects passed on to this handler by the cascade, see Infer2Param::cascade_attr.
+   */
+  uint64_t GetCascadeInferCount() const { return cascade_infer_cnt_.load(); }
+
+  /**
+   * @brief Returns the time cost by Open, including loading the model and warming up, unit[ms].
+   */
+  double GetStartupTime() const { return startup_time_; }
+
+  /**
+   * @brief Returns the latency of the first frame responsed after opened, unit[ms]. 0 if no frame is responsed.
+   */
+  double GetFirstFrameLatency() const { return first_frame_latency_; }
 
  private:
   bool LinkInferServer();
+  bool CreateSession(std::shared_ptr<InferEngineDataObserver> observer);
+  bool Request(InferPackagePtr in, const CNFrameInfoPtr& data);
+  bool IsLate(const CNFrameInfoPtr& data);
+  void ReuseObjects(const CNFrameInfoPtr& data);
+  bool ExitCascade(const CNInferObjectPtr& obj);
+  // results cached by the content of the frames, see Infer2Param::result_cache_size
+  bool ReadResultCache(const CNFrameInfoPtr& data, uint64_t key);
+  void WriteResultCache(const CNFrameInfoPtr& data, bool success);
+  void Warmup(const InferSessionDesc& session_desc);
+  void BatchPostprocess(const InferPackagePtr& result);
+  // regions of interest, see Infer2Param::rois
+  const std::vector<InferRoi>* GetRois(const std::string& stream_id) const;
+  const InferRoi* TakeRoi(const infer_server::InferData* data);
+  void DropRois(const CNFrameInfo* frame);
+  // tiles, see Infer2Param::tile_width
+  void MergeTiles(const CNFrameInfoPtr& data);
+  bool Postprocess(infer_server::InferData* output_data, const infer_server::ModelIO& model_output,
+                   const infer_server::ModelInfo* model_info);
+  bool PostprocessRoi(const InferRoi& roi, infer_server::InferData* output_data,
+                      const infer_server::ModelIO& model_output, const infer_server::ModelInfo* model_info);
 
  private:
   std::unique_ptr<InferEngine> infer_server_ = nullptr;
   std::shared_ptr<InferDataObserver> data_observer_ = nullptr;
   InferEngineSession session_ = nullptr;
+  InferModelInfoPtr model_info_ = nullptr;
+  // used instead of infer_server_ and session_ if share_session is enabled
+  std::shared_ptr<SharedInferSession> shared_session_ = nullptr;
   InferPreprocessType scale_platform_ = InferPreprocessType::UNKNOWN;
+  std::atomic<uint64_t> late_frame_cnt_{0};
+  std::atomic<uint64_t> late_drop_cnt_{0};
+  std::shared_ptr<MotionFrameFilter> motion_filter_ = nullptr;
+  std::atomic<uint64_t> static_frame_cnt_{0};
+  std::atomic<uint64_t> cascade_exit_cnt_{0};
+  std::atomic<uint64_t> cascade_infer_cnt_{0};
+  std::shared_ptr<ResultCache> result_cache_ = nullptr;
+  // the frames missing the cache in flight, their objects are cached when responsed
+  struct CacheMiss {
+    uint64_t key;
+    size_t begin;  // the number of the objects of the frame before inference
+  };
+  std::mutex cache_mutex_;
+  std::unordered_map<const CNFrameInfo*, CacheMiss> cache_misses_;
+  // frames skipped by the motion filter, which reuse the objects of the last inferred frame of the stream
+  std::mutex reuse_mutex_;
+  std::unordered_set<const CNFrameInfo*> reused_frames_;
+  std::unordered_map<std::string, std::vector<CNInferObjectPtr>> last_objs_;
+  // the cropped inputs in flight, keyed by the input data
+  struct RoiInput {
+    const InferRoi* roi;
+    const CNFrameInfo* frame;
+  };
+  std::mutex roi_mutex_;
+  std::unordered_map<const infer_server::InferData*, RoiInput> roi_inputs_;
+  // the objects of the crops of a frame are appended and mapped back to the frame one crop at a time
+  std::mutex roi_postproc_mutex_;
+  std::shared_ptr<TileScheduler> tile_scheduler_ = nullptr;
+  // the tiled frames in flight, guarded by roi_mutex_
+  struct TiledFrame {
+    const std::vector<InferRoi>* tiles;
+    std::vector<bool> inferred;
+    size_t begin;  // the number of the objects of the frame before inference
+  };
+  std::unordered_map<const CNFrameInfo*, TiledFrame> tiled_frames_;
+  double startup_time_ = 0;
+  double first_frame_latency_ = 0;
+  std::atomic<bool> first_response_reported_{false};
 };
 
 inline void InferHandler::TransmitData(const CNFrameInfoPtr& data) {
+  if (next_) {
+    // the objects are inferred by the next model of the module, the frame stays on the device
+    if (!data->collection.HasValue(kCNInferObjsSlot)) {
+      data->collection.Add(kCNInferObjsSlot, std::make_shared<CNInferObjs>());
+    }
+    if (next_->Process(data, true) == 0) return;
+    if (module_) {
+      module_->PostEvent(EventType::EVENT_ERROR, "[" + module_->GetName() + "] secondary inference failed.");
+    }
+  }
   if (module_) module_->TransmitData(data);
 }
 
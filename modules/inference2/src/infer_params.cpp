@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstdio>
 #include <functional>
 #include <iostream>
 #include <limits>
@@ -33,8 +34,10 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <utility>
 
 #include "infer_params.hpp"
+#include "infer_roi.hpp"
 #define ASSERT(value) {                                 \
   bool __attribute__((unused)) ret = (value);           \
   assert(ret);                                          \
@@ -103,6 +106,54 @@ static std::vector<float> STR2VECTORFLOAT(const std::string &value) {
   }
 }
 
+// accepts numbers separated by spaces or commas
+static bool STR2VECTORU32(const std::string &value, std::vector<uint32_t> *ret) {
+  std::string str = value;
+  std::replace(str.begin(), str.end(), ',', ' ');
+  std::istringstream ss(str);
+  std::string tmp;
+  std::vector<uint32_t> res;
+  while (ss >> tmp) {
+    uint32_t v = 0;
+    if (!STR2U32(tmp, &v)) return false;
+    res.push_back(v);
+  }
+  *ret = std::move(res);
+  return true;
+}
+
+/**
+ * @brief The settings of the CNCV preprocessing equal to the preprocessing of the networks.
+ */
+struct PreprocPreset {
+  bool keep_aspect_ratio;
+  std::vector<float> mean;
+  std::vector<float> std;
+  bool normalize;
+};
+
+static const std::map<std::string, PreprocPreset>& GetPreprocPresets() {
+  static const std::map<std::string, PreprocPreset> presets = {
+    // see VideoPreprocYolov3, letterbox with uint8 output
+    {"CNCV_YOLOV3", {true, {}, {}, false}},
+    // see VideoPreprocYolov5, letterbox and scaled to [0, 1]
+    {"CNCV_YOLOV5", {true, {0, 0, 0}, {1, 1, 1}, true}},
+  };
+  return presets;
+}
+
+// the parameters set by users are not overridden
+static void ApplyPreprocPreset(const ModuleParamSet &raw_params, Infer2Param *pout) {
+  auto iter = GetPreprocPresets().find(pout->preproc_name);
+  if (iter == GetPreprocPresets().end()) return;
+  const PreprocPreset& preset = iter->second;
+  pout->preproc_name = "CNCV";
+  if (!raw_params.count("keep_aspect_ratio")) pout->keep_aspect_ratio = preset.keep_aspect_ratio;
+  if (!raw_params.count("mean")) pout->mean_ = preset.mean;
+  if (!raw_params.count("std")) pout->std_ = preset.std;
+  if (!raw_params.count("normalize")) pout->normalize = preset.normalize;
+}
+
 void Infer2ParamManager::RegisterAll(ParamRegister *pregister) {
   Infer2ParamDesc param;
   param.name = "model_path";
@@ -172,7 +223,11 @@ void Infer2ParamManager::RegisterAll(ParamRegister *pregister) {
       " 1. rcop/RCOP. Preprocessing will be done on MLU by ResizeYuv2Rgb operator\n"
       " 2. scaler/SCALER. Preprocessing will be done on Scaler\n"
       " 3. cncv/CNCV. Preprocessing will be done on MLU by CNCV\n"
-      " 4. The class name of custom preprocessing. The class specified by this"
+      " 4. cncv_yolov3/CNCV_YOLOV3, cncv_yolov5/CNCV_YOLOV5. Preprocessing will be done on MLU by CNCV, with the"
+      " keep_aspect_ratio, mean, std and normalize of the YOLOv3/YOLOv5 networks if they are not set. Color"
+      " conversion, resize with padding and normalization are done in one pass on MLU, without copying"
+      " frames to host as VideoPreprocYolov3/VideoPreprocYolov5 do.\n"
+      " 5. The class name of custom preprocessing. The class specified by this"
       " name must inherit from class cnstream::VideoPreproc.";
   param.default_value = "cncv";
   param.type = "string";
@@ -183,8 +238,8 @@ void Infer2ParamManager::RegisterAll(ParamRegister *pregister) {
       param_set->preproc_name = "SCALER";
     } else if ("RCOP" == value_transform) {
       param_set->preproc_name = "RCOP";
-    } else if ("CNCV" == value_transform) {
-      param_set->preproc_name = "CNCV";
+    } else if ("CNCV" == value_transform || GetPreprocPresets().count(value_transform)) {
+      param_set->preproc_name = value_transform;
     } else {
       param_set->preproc_name = value;
     }
@@ -201,6 +256,33 @@ void Infer2ParamManager::RegisterAll(ParamRegister *pregister) {
   };
   ASSERT(RegisterParam(pregister, param));
 
+  param.name = "device_ids";
+  param.desc_str = "Optional. The MLU devices to run on, e.g. \"0,1,2,3\", or \"auto\" for all devices. Engines are"
+                   " created on each device, every stream is routed to one of them by the load of the devices and"
+                   " the device its frames are on. device_id is used when it is not set.";
+  param.default_value = "";
+  param.type = "string";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    param_set->all_devices = value == "auto";
+    if (param_set->all_devices) {
+      param_set->device_ids.clear();
+      return true;
+    }
+    return STR2VECTORU32(value, &param_set->device_ids);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "affinity_threshold";
+  param.desc_str = "Optional. Valid when running on multiple devices. A new stream is routed to the device its frames"
+                   " are on, unless that device has more than affinity_threshold streams more than the least loaded"
+                   " device, in which case the frames are copied to the least loaded one.";
+  param.default_value = "1";
+  param.type = "uint32";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2U32(value, &param_set->affinity_threshold);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
   param.name = "engine_num";
   param.desc_str = "Optional. infer server engine number. Increase the engine number to improve performance."
                    " However, more MLU resources will be used. It is important to choose a proper number."
@@ -252,6 +334,53 @@ void Infer2ParamManager::RegisterAll(ParamRegister *pregister) {
   };
   ASSERT(RegisterParam(pregister, param));
 
+  param.name = "share_session";
+  param.desc_str = "Optional. Whether to share the inference session with other inferencer2 modules of the process"
+                   " using the same model, preprocessing, postprocessing and batch strategy. Requests of them are"
+                   " merged into the same batches. The first module opened decides the other session settings."
+                   " 1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
+  param.default_value = "false";
+  param.type = "bool";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2BOOL(value, &param_set->share_session);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "cache_model";
+  param.desc_str = "Optional. Whether to keep the model loaded in the process after the module is closed. Modules"
+                   " opened later with the same model on the same device, e.g. the pipeline restarted, use the"
+                   " cached model instead of loading it again."
+                   " 1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
+  param.default_value = "false";
+  param.type = "bool";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2BOOL(value, &param_set->cache_model);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "warmup";
+  param.desc_str = "Optional. Whether to run the model on dummy inputs of every batch size when the module is"
+                   " opened, so that the first frames are not delayed by the runtime initialization."
+                   " 1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
+  param.default_value = "false";
+  param.type = "bool";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2BOOL(value, &param_set->warmup);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "batch_postproc";
+  param.desc_str = "Optional. Whether to postprocess the outputs of all the inputs of a request in one call, see"
+                   " cnstream::VideoPostproc::ExecuteBatch. A request contains a frame, or all the objects of a frame"
+                   " when object_infer is true. The postprocessing runs in the thread responsing the requests."
+                   " 1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
+  param.default_value = "false";
+  param.type = "bool";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2BOOL(value, &param_set->batch_postproc);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
   param.name = "priority";
   param.desc_str = "Optional. The priority of this infer task in infer server.";
   param.default_value = "0";
@@ -261,12 +390,279 @@ void Infer2ParamManager::RegisterAll(ParamRegister *pregister) {
   };
   ASSERT(RegisterParam(pregister, param));
 
+  param.name = "latency_budget";
+  param.desc_str = "Optional. The latency budget of each frame, counted from the frame being created by the source."
+                   " Frames exceeding the budget when arriving at this module are counted as late frames, and they"
+                   " are not inferred if drop_late_frames is true. 0 means no budget. unit[ms].";
+  param.default_value = "0";
+  param.type = "uint32";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2U32(value, &param_set->latency_budget);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "stream_latency_budgets";
+  param.desc_str = "Optional. The latency budgets of specified streams, which override latency_budget."
+                   " e.g. {\"alarm_camera\" : 200, \"archive_camera\" : 2000}. unit[ms].";
+  param.default_value = "";
+  param.type = "json string";
+  param.parser = [](const std::string &value, Infer2Param *param_set) -> bool {
+    param_set->stream_latency_budgets.clear();
+    if (value.empty()) return true;
+    rapidjson::Document doc;
+    if (doc.Parse<rapidjson::kParseCommentsFlag>(value.c_str()).HasParseError() || !doc.IsObject()) {
+      LOGE(INFERENCER2) << "Parse stream latency budgets failed. JSON:" << value;
+      return false;
+    }
+    for (auto iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+      if (!iter->value.IsUint()) {
+        LOGE(INFERENCER2) << "Latency budget of stream [" << iter->name.GetString()
+                          << "] must be an unsigned integer.";
+        return false;
+      }
+      param_set->stream_latency_budgets[iter->name.GetString()] = iter->value.GetUint();
+    }
+    return true;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "drop_late_frames";
+  param.desc_str = "Optional. Whether to skip inference of frames exceeding the latency budget. The skipped frames"
+                   " are still transmitted in order."
+                   " 1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
+  param.default_value = "false";
+  param.type = "bool";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2BOOL(value, &param_set->drop_late_frames);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "motion_threshold";
+  param.desc_str = "Optional. The motion threshold of the built-in motion filter, in [0, 1]. The Y plane of each frame"
+                   " is reduced to a grid of cells and compared with the last inferred frame of the stream. Frames"
+                   " with a lower ratio of changed cells are not inferred, and reuse the inference results of the"
+                   " last inferred frame when inferring on frames. Only NV12/NV21 frames are filtered."
+                   " Frames scored by the decoder (see the motion_activity param of DataSource) are compared by the"
+                   " sum of their activities since the last inferred frame instead, without reading the pixels."
+                   " 0 means the motion filter is disabled.";
+  param.default_value = "0";
+  param.type = "float";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    bool ret = STR2FLOAT(value, &param_set->motion_threshold);
+    if (ret && (param_set->motion_threshold < 0 || param_set->motion_threshold > 1)) ret = false;
+    return ret;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "motion_max_skip";
+  param.desc_str = "Optional. Valid when motion_threshold is set. At most motion_max_skip frames in a row are skipped"
+                   " by the motion filter, the next frame is inferred anyway. 0 means no limit.";
+  param.default_value = "25";
+  param.type = "uint32";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2U32(value, &param_set->motion_max_skip);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "rois";
+  param.desc_str = "Optional. The regions of interest of the frames, e.g."
+                   " [[0.1, 0.5, 0.4, 0.5], [[0.2, 0.2], [0.6, 0.2], [0.5, 0.9]]]. A rectangle is [x, y, w, h],"
+                   " a polygon is an array of vertices [x, y], normalized to the frame. The crop of each region (the"
+                   " bounding box of a polygon) is inferred instead of the whole frame, the objects are mapped back to"
+                   " the frame, and the objects whose centers are out of a polygon are dropped. An object on"
+                   " overlapping regions could be detected twice. Not supported with object_infer or share_session.";
+  param.default_value = "";
+  param.type = "json string";
+  param.parser = [](const std::string &value, Infer2Param *param_set) -> bool {
+    param_set->rois.clear();
+    return value.empty() || ParseInferRois(value, &param_set->rois);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "stream_rois";
+  param.desc_str = "Optional. The regions of interest of specified streams, which override rois, e.g."
+                   " {\"lane_camera\" : [[0.1, 0.5, 0.4, 0.5]]}. An empty array means the whole frames of the stream"
+                   " are inferred.";
+  param.default_value = "";
+  param.type = "json string";
+  param.parser = [](const std::string &value, Infer2Param *param_set) -> bool {
+    param_set->stream_rois.clear();
+    if (value.empty()) return true;
+    rapidjson::Document doc;
+    if (doc.Parse<rapidjson::kParseCommentsFlag>(value.c_str()).HasParseError() || !doc.IsObject()) {
+      LOGE(INFERENCER2) << "Parse stream regions of interest failed. JSON:" << value;
+      return false;
+    }
+    for (auto iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+      rapidjson::StringBuffer buffer;
+      rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+      iter->value.Accept(writer);
+      if (!ParseInferRois(buffer.GetString(), &param_set->stream_rois[iter->name.GetString()])) return false;
+    }
+    return true;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "tile_size";
+  param.desc_str = "Optional. The size of the tiles in pixels, e.g. 640x640. The frames are sliced into overlapping"
+                   " tiles, which are inferred instead of the whole frames, so that small objects on high resolution"
+                   " frames are not lost by downscaling. The tiles of the frames are batched together. The objects"
+                   " are mapped back to the frames, and the objects detected on overlapping tiles are merged."
+                   " Empty means the frames are not sliced. Not supported with object_infer, share_session or rois.";
+  param.default_value = "";
+  param.type = "string";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    param_set->tile_width = param_set->tile_height = 0;
+    if (value.empty()) return true;
+    char tail = 0;
+    if (sscanf(value.c_str(), "%ux%u%c", &param_set->tile_width, &param_set->tile_height, &tail) != 2 ||
+        param_set->tile_width == 0 || param_set->tile_height == 0) {
+      LOGE(INFERENCER2) << "tile_size should be in the format of WIDTHxHEIGHT, e.g. 640x640. But got " << value;
+      return false;
+    }
+    return true;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "tile_overlap";
+  param.desc_str = "Optional. Valid when tile_size is set. The ratio of a tile overlapping its neighbours, in [0, 0.9]."
+                   " Objects cut by a tile are expected to be whole on the neighbour.";
+  param.default_value = "0.2";
+  param.type = "float";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    bool ret = STR2FLOAT(value, &param_set->tile_overlap);
+    if (ret && (param_set->tile_overlap < 0 || param_set->tile_overlap > 0.9f)) ret = false;
+    return ret;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "tile_full_frame";
+  param.desc_str = "Optional. Valid when tile_size is set. Whether to infer the whole frame besides the tiles, for the"
+                   " objects larger than the tiles. 1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
+  param.default_value = "false";
+  param.type = "bool";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2BOOL(value, &param_set->tile_full_frame);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "tile_merge_threshold";
+  param.desc_str = "Optional. Valid when tile_size is set. Objects of the same label overlapping by more than it are"
+                   " merged into one, the overlap is the intersection over the smaller object, in (0, 1].";
+  param.default_value = "0.5";
+  param.type = "float";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    bool ret = STR2FLOAT(value, &param_set->tile_merge_threshold);
+    if (ret && (param_set->tile_merge_threshold <= 0 || param_set->tile_merge_threshold > 1)) ret = false;
+    return ret;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "tile_motion_threshold";
+  param.desc_str = "Optional. Valid when tile_size is set. The motion threshold of the tiles in [0, 1], see"
+                   " motion_threshold. Only the tiles with motion are inferred, the other tiles reuse the objects last"
+                   " detected on them. At most motion_max_skip frames in a row are skipped by a tile. The whole frame"
+                   " of tile_full_frame is always inferred. 0 means all tiles are inferred.";
+  param.default_value = "0";
+  param.type = "float";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    bool ret = STR2FLOAT(value, &param_set->tile_motion_threshold);
+    if (ret && (param_set->tile_motion_threshold < 0 || param_set->tile_motion_threshold > 1)) ret = false;
+    return ret;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "cascade_attr";
+  param.desc_str = "Optional. Valid when object_infer is true. The key of the attribute set by an earlier Inferencer2"
+                   " in the pipeline, e.g. a lightweight classifier. The objects whose attribute scores at least"
+                   " cascade_threshold exit the cascade and are not inferred by this module. The attribute of the"
+                   " other objects is removed before inference, so that the postprocessing of this module sets it"
+                   " again. Empty means all objects are inferred.";
+  param.default_value = "";
+  param.type = "string";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    param_set->cascade_attr = value;
+    return true;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "cascade_threshold";
+  param.desc_str = "Optional. Valid when cascade_attr is set. The confidence of the earlier stage to exit the cascade,"
+                   " in [0, 1].";
+  param.default_value = "0.9";
+  param.type = "float";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    bool ret = STR2FLOAT(value, &param_set->cascade_threshold);
+    if (ret && (param_set->cascade_threshold < 0 || param_set->cascade_threshold > 1)) ret = false;
+    return ret;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "result_cache_size";
+  param.desc_str = "Optional. The max number of frames whose objects are cached by the hash of their Y plane. A frame"
+                   " with the same content as a cached one, e.g. an image uploaded again, gets copies of the cached"
+                   " objects without preprocessing and inference. The least recently used frames are evicted. Only"
+                   " NV12 and NV21 frames are cached. 0 means no cache. Not supported with object_infer or"
+                   " stream_rois.";
+  param.default_value = "0";
+  param.type = "uint32";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    return STR2U32(value, &param_set->result_cache_size);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "secondary_models";
+  param.desc_str = "Optional. The models inferring the objects of the frames after the model of this module, e.g."
+                   " classifiers after a detector, as an array of Inferencer2 parameters, e.g. [{\"model_path\" :"
+                   " \"cls.cambricon\", \"preproc_name\" : \"RCOP\", \"postproc_name\" : \"PostprocClass\"}]."
+                   " They run in order in this module on the device of the frame, with object_infer set, instead of"
+                   " being separate modules with their own queues and batching. With preprocessing on device, the"
+                   " objects are cropped from the frame on device. The device parameters are taken from this module."
+                   " Not supported with object_infer.";
+  param.default_value = "";
+  param.type = "json string";
+  param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
+    param_set->secondary_models.clear();
+    if (value.empty()) return true;
+    rapidjson::Document doc;
+    if (doc.Parse<rapidjson::kParseCommentsFlag>(value.c_str()).HasParseError() || !doc.IsArray()) {
+      LOGE(INFERENCER2) << "Parse secondary models failed, an array of parameters is expected. JSON:" << value;
+      return false;
+    }
+    for (auto model = doc.Begin(); model != doc.End(); ++model) {
+      if (!model->IsObject()) {
+        LOGE(INFERENCER2) << "Parse secondary models failed, an array of parameters is expected. JSON:" << value;
+        return false;
+      }
+      ModuleParamSet raw_params;
+      for (auto iter = model->MemberBegin(); iter != model->MemberEnd(); ++iter) {
+        if (iter->value.IsString()) {
+          raw_params[iter->name.GetString()] = iter->value.GetString();
+        } else {
+          rapidjson::StringBuffer sbuf;
+          rapidjson::Writer<rapidjson::StringBuffer> jwriter(sbuf);
+          iter->value.Accept(jwriter);
+          raw_params[iter->name.GetString()] = sbuf.GetString();
+        }
+      }
+      param_set->secondary_models.push_back(std::move(raw_params));
+    }
+    return true;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
   param.name = "data_order";
-  param.desc_str = "Optional. The order in which the output data of the model are placed.value range : NCHW/NHWC.";
+  param.desc_str = "Optional. The order in which the output data of the model are placed.value range : NCHW/NHWC/NATIVE."
+                   " The outputs are transposed on host after being copied from device if the order differs from the"
+                   " order of the model. NATIVE keeps the order of the model, so that the transposition is skipped,"
+                   " and the postprocessing should read the order by ModelInfo::OutputLayout.";
   param.default_value = "NHWC";
   param.type = "string";
   param.parser = [] (const std::string &value, Infer2Param *param_set) -> bool {
-    if ("NCHW" == value) {
+    param_set->native_data_order = "NATIVE" == value;
+    if (param_set->native_data_order) {
+      return true;
+    } else if ("NCHW" == value) {
       param_set->data_order = InferDimOrder::NCHW;
       return true;
     } else if ("NHWC" == value) {
@@ -308,7 +704,7 @@ void Infer2ParamManager::RegisterAll(ParamRegister *pregister) {
   ASSERT(RegisterParam(pregister, param));
 
   param.name = "keep_aspect_ratio";
-  param.desc_str = "Optional. Only when rcop preproc is used, it is valid."
+  param.desc_str = "Optional. Only when rcop or cncv preproc is used, it is valid."
                    " Remain the scale of width and height to constant."
                    " 1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
   param.default_value = "false";
@@ -489,6 +885,7 @@ bool Infer2ParamManager::ParseBy(const ModuleParamSet &raw_params, Infer2Param *
       return false;
     }
   }
+  ApplyPreprocPreset(raw_params, pout);
   return true;
 }
 
@@ -0,0 +1,257 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "infer_roi.hpp"
+
+#include <rapidjson/document.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+static bool IsCoordinate(const rapidjson::Value& value) {
+  return value.IsNumber() && value.GetDouble() >= 0 && value.GetDouble() <= 1;
+}
+
+static bool ParseRoi(const rapidjson::Value& value, InferRoi* roi) {
+  if (!value.IsArray() || value.Empty()) return false;
+  if (value[0].IsNumber()) {
+    if (value.Size() != 4) return false;
+    for (auto& coord : value.GetArray()) {
+      if (!IsCoordinate(coord)) return false;
+    }
+    roi->box = {value[0].GetFloat(), value[1].GetFloat(), value[2].GetFloat(), value[3].GetFloat()};
+    roi->polygon.clear();
+    return roi->box.w > 0 && roi->box.h > 0 && roi->box.x + roi->box.w <= 1 && roi->box.y + roi->box.h <= 1;
+  }
+  if (value.Size() < 3) return false;
+  roi->polygon.clear();
+  float left = 1, top = 1, right = 0, bottom = 0;
+  for (auto& vertex : value.GetArray()) {
+    if (!vertex.IsArray() || vertex.Size() != 2 || !IsCoordinate(vertex[0]) || !IsCoordinate(vertex[1])) {
+      return false;
+    }
+    float x = vertex[0].GetFloat(), y = vertex[1].GetFloat();
+    roi->polygon.emplace_back(x, y);
+    left = std::min(left, x);
+    top = std::min(top, y);
+    right = std::max(right, x);
+    bottom = std::max(bottom, y);
+  }
+  roi->box = {left, top, right - left, bottom - top};
+  return roi->box.w > 0 && roi->box.h > 0;
+}
+
+bool ParseInferRois(const std::string& value, std::vector<InferRoi>* rois) {
+  rois->clear();
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(value.c_str()).HasParseError() || !doc.IsArray()) {
+    LOGE(INFERENCER2) << "Parse regions of interest failed, it should be an array. JSON:" << value;
+    return false;
+  }
+  for (auto& item : doc.GetArray()) {
+    InferRoi roi;
+    if (!ParseRoi(item, &roi)) {
+      LOGE(INFERENCER2) << "Invalid region of interest, it should be a rectangle [x, y, w, h] or a polygon "
+                        << "[[x, y], ...] of at least 3 vertices, normalized to the frame. JSON:" << value;
+      return false;
+    }
+    rois->push_back(roi);
+  }
+  return true;
+}
+
+bool InferRoiContains(const InferRoi& roi, float x, float y) {
+  if (x < roi.box.x || x > roi.box.x + roi.box.w || y < roi.box.y || y > roi.box.y + roi.box.h) return false;
+  if (roi.polygon.empty()) return true;
+  // ray casting, the point is inside if a ray from it crosses the edges an odd number of times
+  bool inside = false;
+  for (size_t i = 0, j = roi.polygon.size() - 1; i < roi.polygon.size(); j = i++) {
+    const auto& a = roi.polygon[i];
+    const auto& b = roi.polygon[j];
+    if ((a.second > y) != (b.second > y) &&
+        x < (b.first - a.first) * (y - a.second) / (b.second - a.second) + a.first) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+CNInferBoundingBox MapRoiBox(const InferRoi& roi, const CNInferBoundingBox& box) {
+  return {roi.box.x + box.x * roi.box.w, roi.box.y + box.y * roi.box.h, box.w * roi.box.w, box.h * roi.box.h};
+}
+
+CNInferObjectPtr CopyInferObject(const CNInferObjectPtr& src) {
+  auto dst = std::make_shared<CNInferObject>();
+  dst->id = src->id;
+  dst->track_id = src->track_id;
+  dst->score = src->score;
+  dst->bbox = src->bbox;
+  for (auto& attr : src->GetAttributes()) dst->AddAttribute(attr);
+  for (auto& attr : src->GetExtraAttributes()) dst->AddExtraAttribute(attr.first, attr.second);
+  for (auto& feature : src->GetFeatures()) dst->AddFeature(feature.first, feature.second);
+  return dst;
+}
+
+// the offsets of the tiles along an axis, in pixels
+static std::vector<uint32_t> TileOffsets(uint32_t length, uint32_t tile, float overlap) {
+  if (tile >= length) return {0};
+  const float stride = tile * (1 - overlap);
+  const uint32_t num = static_cast<uint32_t>(std::ceil((length - tile) / std::max(stride, 1.0f))) + 1;
+  std::vector<uint32_t> offsets;
+  for (uint32_t i = 0; i < num; ++i) {
+    offsets.push_back(static_cast<uint32_t>(static_cast<uint64_t>(length - tile) * i / (num - 1)));
+  }
+  return offsets;
+}
+
+std::vector<InferRoi> MakeTiles(uint32_t width, uint32_t height, uint32_t tile_width, uint32_t tile_height,
+                                float overlap) {
+  std::vector<InferRoi> tiles;
+  if (!width || !height || !tile_width || !tile_height) return tiles;
+  tile_width = std::min(tile_width, width);
+  tile_height = std::min(tile_height, height);
+  for (uint32_t y : TileOffsets(height, tile_height, overlap)) {
+    for (uint32_t x : TileOffsets(width, tile_width, overlap)) {
+      InferRoi tile;
+      tile.box = {static_cast<float>(x) / width, static_cast<float>(y) / height, static_cast<float>(tile_width) / width,
+                  static_cast<float>(tile_height) / height};
+      tiles.push_back(tile);
+    }
+  }
+  return tiles;
+}
+
+void MergeTileObjects(std::vector<CNInferObjectPtr>* objs, float threshold) {
+  std::stable_sort(objs->begin(), objs->end(),
+                   [](const CNInferObjectPtr& a, const CNInferObjectPtr& b) { return a->score > b->score; });
+  std::vector<bool> merged(objs->size(), false);
+  for (size_t i = 0; i < objs->size(); ++i) {
+    if (merged[i]) continue;
+    CNInferBoundingBox& keep = (*objs)[i]->bbox;
+    for (size_t j = i + 1; j < objs->size(); ++j) {
+      const CNInferObjectPtr& other = (*objs)[j];
+      if (merged[j] || other->id != (*objs)[i]->id) continue;
+      const CNInferBoundingBox& box = other->bbox;
+      float iw = std::min(keep.x + keep.w, box.x + box.w) - std::max(keep.x, box.x);
+      float ih = std::min(keep.y + keep.h, box.y + box.h) - std::max(keep.y, box.y);
+      float smaller = std::min(keep.w * keep.h, box.w * box.h);
+      if (iw <= 0 || ih <= 0 || smaller <= 0 || iw * ih < threshold * smaller) continue;
+      float right = std::max(keep.x + keep.w, box.x + box.w), bottom = std::max(keep.y + keep.h, box.y + box.h);
+      keep.x = std::min(keep.x, box.x);
+      keep.y = std::min(keep.y, box.y);
+      keep.w = right - keep.x;
+      keep.h = bottom - keep.y;
+      merged[j] = true;
+    }
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < objs->size(); ++i) {
+    if (!merged[i]) (*objs)[kept++] = std::move((*objs)[i]);
+  }
+  objs->resize(kept);
+}
+
+TileScheduler::TileScheduler(uint32_t tile_width, uint32_t tile_height, float overlap, bool full_frame,
+                             float motion_threshold, uint32_t max_skip)
+    : tile_width_(tile_width), tile_height_(tile_height), overlap_(overlap), full_frame_(full_frame),
+      motion_threshold_(motion_threshold), max_skip_(max_skip) {}
+
+const std::vector<InferRoi>& TileScheduler::GetTiles(uint32_t width, uint32_t height) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = layouts_.find(static_cast<uint64_t>(width) << 32 | height);
+  if (iter != layouts_.end()) return iter->second;
+  std::vector<InferRoi> tiles = MakeTiles(width, height, tile_width_, tile_height_, overlap_);
+  if (full_frame_ && tiles.size() > 1) tiles.push_back(InferRoi());
+  return layouts_.emplace(static_cast<uint64_t>(width) << 32 | height, std::move(tiles)).first->second;
+}
+
+TileScheduler::StreamState& TileScheduler::GetState(const std::string& stream_id,
+                                                    const std::vector<InferRoi>& tiles) {
+  StreamState& state = streams_[stream_id];
+  if (state.tiles != &tiles) {
+    // the resolution of the stream is changed
+    state.tiles = &tiles;
+    state.refs.assign(tiles.size(), {});
+    state.skipped.assign(tiles.size(), 0);
+    state.objs.assign(tiles.size(), {});
+  }
+  return state;
+}
+
+std::vector<bool> TileScheduler::Select(const std::string& stream_id, const std::vector<InferRoi>& tiles,
+                                        std::vector<uint8_t> thumbnail) {
+  std::vector<bool> selected(tiles.size(), true);
+  if (motion_threshold_ <= 0 || thumbnail.empty()) return selected;
+  std::lock_guard<std::mutex> lk(mutex_);
+  StreamState& state = GetState(stream_id, tiles);
+  // the whole frame of full_frame is always inferred
+  for (size_t i = 0; i < TileNum(tiles); ++i) {
+    const CNInferBoundingBox& box = tiles[i].box;
+    bool force = max_skip_ > 0 && state.skipped[i] >= max_skip_;
+    if (force || detector_.Score(state.refs[i], thumbnail, box.x, box.y, box.w, box.h) >= motion_threshold_) {
+      state.refs[i] = thumbnail;
+      state.skipped[i] = 0;
+    } else {
+      state.skipped[i]++;
+      selected[i] = false;
+    }
+  }
+  return selected;
+}
+
+void TileScheduler::Merge(const std::string& stream_id, const std::vector<InferRoi>& tiles,
+                          const std::vector<bool>& inferred, float threshold, std::vector<CNInferObjectPtr>* objs) {
+  if (motion_threshold_ <= 0) {
+    MergeTileObjects(objs, threshold);
+    return;
+  }
+  std::lock_guard<std::mutex> lk(mutex_);
+  StreamState& state = GetState(stream_id, tiles);
+  // copied, the objects could be modified by the downstream modules
+  for (size_t i = 0; i < TileNum(tiles); ++i) {
+    if (inferred[i]) continue;
+    for (auto& obj : state.objs[i]) objs->push_back(CopyInferObject(obj));
+  }
+  MergeTileObjects(objs, threshold);
+  for (size_t i = 0; i < TileNum(tiles); ++i) {
+    if (!inferred[i]) continue;
+    state.objs[i].clear();
+    for (auto& obj : *objs) {
+      if (InferRoiContains(tiles[i], obj->bbox.x + obj->bbox.w / 2, obj->bbox.y + obj->bbox.h / 2)) {
+        state.objs[i].push_back(CopyInferObject(obj));
+      }
+    }
+  }
+}
+
+void TileScheduler::RemoveStream(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  streams_.erase(stream_id);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,164 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFER_ROI_HPP_
+#define MODULES_INFER_ROI_HPP_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "infer_base.hpp"
+#include "motion_detector.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Parses the regions of interest, e.g. [[0.1, 0.5, 0.4, 0.5], [[0.2, 0.2], [0.6, 0.2], [0.5, 0.9]]].
+ * A rectangle is [x, y, w, h], a polygon is an array of at least 3 vertices [x, y]. The coordinates are normalized to
+ * the frame.
+ *
+ * @param value The regions in JSON.
+ * @param rois The parsed regions.
+ *
+ * @return Returns false if the regions are not valid.
+ */
+bool ParseInferRois(const std::string& value, std::vector<InferRoi>* rois);
+
+/**
+ * @brief Checks whether a point normalized to the frame is in a region.
+ */
+bool InferRoiContains(const InferRoi& roi, float x, float y);
+
+/**
+ * @brief Maps a box normalized to the crop of a region back to the frame.
+ */
+CNInferBoundingBox MapRoiBox(const InferRoi& roi, const CNInferBoundingBox& box);
+
+/**
+ * @brief Copies an object, the copy does not share the attributes and features with the source.
+ */
+CNInferObjectPtr CopyInferObject(const CNInferObjectPtr& src);
+
+/**
+ * @brief Slices a frame into overlapping tiles. The tiles of a row or a column are spread evenly, the first and the
+ * last tiles are at the edges of the frame.
+ *
+ * @param width, height The size of the frame.
+ * @param tile_width, tile_height The size of the tiles, clipped to the frame.
+ * @param overlap The min ratio of a tile overlapping its neighbours.
+ *
+ * @return Returns the tiles normalized to the frame, row by row.
+ */
+std::vector<InferRoi> MakeTiles(uint32_t width, uint32_t height, uint32_t tile_width, uint32_t tile_height,
+                                float overlap);
+
+/**
+ * @brief Merges the objects of the same label overlapping by more than the threshold, e.g. the objects detected on
+ * overlapping tiles or cut by the edges of the tiles. The overlap is the intersection over the area of the smaller
+ * object. The object with the higher score is kept, and its box is extended to cover the merged ones.
+ *
+ * @param objs The objects, the merged objects are removed.
+ * @param threshold The overlap threshold in (0, 1].
+ */
+void MergeTileObjects(std::vector<CNInferObjectPtr>* objs, float threshold);
+
+/**
+ * @brief Schedules the tiles of the frames of Inferencer2, see Infer2Param::tile_width.
+ *
+ * With a motion threshold, only the tiles with motion against the last time they were inferred are inferred, the
+ * objects last detected on the other tiles are reused.
+ */
+class TileScheduler {
+ public:
+  TileScheduler(uint32_t tile_width, uint32_t tile_height, float overlap, bool full_frame, float motion_threshold,
+                uint32_t max_skip);
+
+  /**
+   * @brief Gets the tiles of the frames of a resolution, the whole frame is the last one with full_frame.
+   *
+   * @return Returns the tiles, which are valid until the scheduler is destroyed.
+   */
+  const std::vector<InferRoi>& GetTiles(uint32_t width, uint32_t height);
+
+  /**
+   * @brief Gets the motion detector the thumbnails should be made by, see ReadMotionThumbnail.
+   */
+  const MotionDetector& GetMotionDetector() const { return detector_; }
+
+  /**
+   * @brief Selects the tiles of a frame to infer.
+   *
+   * @param stream_id The stream of the frame.
+   * @param tiles The tiles got by GetTiles.
+   * @param thumbnail The motion thumbnail of the frame. All tiles are inferred if it is empty.
+   *
+   * @return Returns whether each tile is inferred.
+   */
+  std::vector<bool> Select(const std::string& stream_id, const std::vector<InferRoi>& tiles,
+                           std::vector<uint8_t> thumbnail);
+
+  /**
+   * @brief Merges the objects detected on the tiles of a frame, the objects last detected on the tiles not inferred
+   * are added before being merged, see MergeTileObjects.
+   *
+   * @param stream_id The stream of the frame.
+   * @param tiles The tiles of the frame.
+   * @param inferred Whether each tile is inferred, see Select.
+   * @param threshold The merge threshold.
+   * @param objs The objects detected on the tiles, which are merged.
+   */
+  void Merge(const std::string& stream_id, const std::vector<InferRoi>& tiles, const std::vector<bool>& inferred,
+             float threshold, std::vector<CNInferObjectPtr>* objs);
+
+  /**
+   * @brief Drops the states of a stream.
+   */
+  void RemoveStream(const std::string& stream_id);
+
+ private:
+  struct StreamState {
+    const std::vector<InferRoi>* tiles = nullptr;
+    std::vector<std::vector<uint8_t>> refs;  // the thumbnails of the frames last inferred on each tile
+    std::vector<uint32_t> skipped;
+    std::vector<std::vector<CNInferObjectPtr>> objs;  // the objects last detected on each tile
+  };
+  StreamState& GetState(const std::string& stream_id, const std::vector<InferRoi>& tiles);
+  // the number of the tiles, excluding the whole frame
+  size_t TileNum(const std::vector<InferRoi>& tiles) const {
+    return full_frame_ && tiles.size() > 1 ? tiles.size() - 1 : tiles.size();
+  }
+
+  uint32_t tile_width_;
+  uint32_t tile_height_;
+  float overlap_;
+  bool full_frame_;
+  float motion_threshold_;
+  uint32_t max_skip_;
+  MotionDetector detector_;
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, std::vector<InferRoi>> layouts_;  // keyed by the resolution
+  std::unordered_map<std::string, StreamState> streams_;
+};  // class TileScheduler
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFER_ROI_HPP_
@@ -21,9 +21,14 @@
 
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "cnrt.h"
 #include "device/mlu_context.h"
+#include "device_load_balancer.hpp"
 #include "infer_handler.hpp"
 #include "infer_params.hpp"
 #include "postproc.hpp"
@@ -40,78 +45,303 @@ Inferencer2::Inferencer2(const std::string& name) : Module(name) {
 }
 
 bool Inferencer2::Open(ModuleParamSet raw_params) {
+  Close();
   Infer2Param params;
   if (!param_manager_->ParseBy(raw_params, &params)) {
     LOGE(INFERENCER2) << "[" << GetName() << "] parse parameters failed.";
     return false;
   }
 
+  if ((!params.rois.empty() || !params.stream_rois.empty()) && (params.object_infer || params.share_session)) {
+    LOGE(INFERENCER2) << "[" << GetName() << "] rois and stream_rois are not supported with object_infer or"
+                      << " share_session.";
+    return false;
+  }
+  if (params.tile_width && (params.object_infer || params.share_session || !params.rois.empty() ||
+                            !params.stream_rois.empty())) {
+    LOGE(INFERENCER2) << "[" << GetName() << "] tile_size is not supported with object_infer, share_session or"
+                      << " rois.";
+    return false;
+  }
+  if (!params.cascade_attr.empty() && !params.object_infer) {
+    LOGE(INFERENCER2) << "[" << GetName() << "] cascade_attr is only supported with object_infer.";
+    return false;
+  }
+  if (params.result_cache_size && (params.object_infer || !params.stream_rois.empty())) {
+    LOGE(INFERENCER2) << "[" << GetName() << "] result_cache_size is not supported with object_infer or stream_rois.";
+    return false;
+  }
+  if (!params.secondary_models.empty() && params.object_infer) {
+    LOGE(INFERENCER2) << "[" << GetName() << "] secondary_models is not supported with object_infer.";
+    return false;
+  }
+
   infer_params_ = params;
 
   // fix paths
   if (!infer_params_.model_path.empty())
     infer_params_.model_path = GetPathRelativeToTheJSONFile(infer_params_.model_path, raw_params);
 
+  std::vector<uint32_t> device_ids = params.device_ids;
+  if (params.all_devices) {
+    unsigned int dev_num = 0;
+    cnrtGetDeviceCount(&dev_num);
+    for (unsigned int dev = 0; dev < dev_num; ++dev) device_ids.push_back(dev);
+    if (device_ids.empty()) {
+      LOGE(INFERENCER2) << "[" << GetName() << "] There is no valid device.";
+      return false;
+    }
+  }
+  if (device_ids.empty()) device_ids.push_back(params.device_id);
+  infer_params_.device_id = params.device_id = device_ids[0];
+
   // check preprocess
   if (!infer_server::SetCurrentDevice(params.device_id)) return false;
 
+  Processors processors;
+  if (!CreateProcessors(params, &processors)) return false;
+
+  std::vector<SecondaryModel> secondary_models;
+  for (const ModuleParamSet& model_raw_params : params.secondary_models) {
+    SecondaryModel model;
+    ModuleParamSet raws = model_raw_params;
+    auto json_dir = raw_params.find("json_file_dir");
+    if (json_dir != raw_params.end()) raws[json_dir->first] = json_dir->second;
+    if (!param_manager_->ParseBy(raws, &model.params)) {
+      LOGE(INFERENCER2) << "[" << GetName() << "] parse parameters of secondary models failed.";
+      return false;
+    }
+    if (!model.params.rois.empty() || !model.params.stream_rois.empty() || model.params.tile_width ||
+        model.params.result_cache_size || !model.params.secondary_models.empty()) {
+      LOGE(INFERENCER2) << "[" << GetName() << "] rois, stream_rois, tile_size, result_cache_size and"
+                        << " secondary_models are not supported by secondary models.";
+      return false;
+    }
+    // the objects are inferred on the device chosen for the frame by this module
+    model.params.object_infer = true;
+    model.params.device_id = params.device_id;
+    model.params.device_ids.clear();
+    model.params.all_devices = false;
+    if (!model.params.model_path.empty()) {
+      model.params.model_path = GetPathRelativeToTheJSONFile(model.params.model_path, raws);
+    }
+    if (!CreateProcessors(model.params, &model.processors)) return false;
+    secondary_models.push_back(std::move(model));
+  }
+
+  device_ids_ = device_ids;
+  processors_ = processors;
+  secondary_models_ = std::move(secondary_models);
+  auto group = std::make_shared<HandlerGroup>();
+  if (!OpenHandlers(infer_params_, &group->handlers)) return false;
+  {
+    std::lock_guard<std::mutex> lk(group_mutex_);
+    group_ = group;
+  }
+  generation_ = 0;
+  stream_groups_.assign(GetMaxStreamNumber(), nullptr);
+  if (device_ids.size() > 1) {
+    balancer_ = std::make_shared<DeviceLoadBalancer>(device_ids, params.affinity_threshold);
+    LOGI(INFERENCER2) << "[" << GetName() << "] Balance streams over " << device_ids.size() << " devices.";
+  }
+  return true;
+}
+
+bool Inferencer2::CreateProcessors(const Infer2Param& params, Processors* processors) {
   if (params.preproc_name.empty()) {
     LOGE(INFERENCER2) << "Preproc name can't be empty string. Please set preproc_name.";
     return false;
   }
-  std::shared_ptr<VideoPreproc> pre_processor = nullptr;
   if (params.preproc_name != "RCOP" && params.preproc_name != "SCALER" && params.preproc_name != "CNCV") {
-    pre_processor.reset(VideoPreproc::Create(params.preproc_name));
-    if (!pre_processor) {
+    processors->pre_processor.reset(VideoPreproc::Create(params.preproc_name));
+    if (!processors->pre_processor) {
       LOGE(INFERENCER2) << "Can not find VideoPreproc implemention by name: " << params.preproc_name;
       return false;
     }
-    if (!pre_processor->Init(params.custom_preproc_params)) {
+    if (!processors->pre_processor->Init(params.custom_preproc_params)) {
       LOGE(INFERENCER2) << "VideoPreprocessor init failed.";
       return false;
     }
-    pre_processor->SetModelInputPixelFormat(params.model_input_pixel_format);
+    processors->pre_processor->SetModelInputPixelFormat(params.model_input_pixel_format);
   }
 
-  std::shared_ptr<VideoPostproc> post_processor = nullptr;
   if (params.postproc_name.empty()) {
     LOGE(INFERENCER2) << "Postproc name can't be empty string. Please set postproc_name.";
     return false;
   }
-  post_processor.reset(VideoPostproc::Create(params.postproc_name));
-  if (!post_processor) {
+  processors->post_processor.reset(VideoPostproc::Create(params.postproc_name));
+  if (!processors->post_processor) {
     LOGE(INFERENCER2) << "Can not find VideoPostproc implemention by name: " << params.postproc_name;
     return false;
   }
-  if (!post_processor->Init(params.custom_postproc_params)) {
+  if (!processors->post_processor->Init(params.custom_postproc_params)) {
     LOGE(INFERENCER2) << "Postprocessor init failed.";
     return false;
   }
-  post_processor->SetThreshold(params.threshold);
+  processors->post_processor->SetThreshold(params.threshold);
 
-  std::shared_ptr<FrameFilter> frame_filter = nullptr;
   if (!params.frame_filter_name.empty()) {
-    frame_filter.reset(FrameFilter::Create(params.frame_filter_name));
-    if (!frame_filter) {
+    processors->frame_filter.reset(FrameFilter::Create(params.frame_filter_name));
+    if (!processors->frame_filter) {
       LOGE(INFERENCER2) << "Can not find FrameFilter implemention by name: " << params.frame_filter_name;
       return false;
     }
   }
-  std::shared_ptr<ObjFilter> obj_filter = nullptr;
   if (!params.obj_filter_name.empty()) {
-    obj_filter.reset(ObjFilter::Create(params.obj_filter_name));
-    if (!obj_filter) {
+    processors->obj_filter.reset(ObjFilter::Create(params.obj_filter_name));
+    if (!processors->obj_filter) {
       LOGE(INFERENCER2) << "Can not find ObjFilter implemention by name: " << params.obj_filter_name;
       return false;
     }
   }
+  return true;
+}
+
+bool Inferencer2::OpenHandlers(const Infer2Param& params, std::vector<std::shared_ptr<InferHandler>>* handlers) {
+  for (uint32_t device_id : device_ids_) {
+    Infer2Param handler_params = params;
+    handler_params.device_id = device_id;
+    auto handler = std::make_shared<InferHandlerImpl>(this, handler_params, processors_.post_processor,
+                                                      processors_.pre_processor, processors_.frame_filter,
+                                                      processors_.obj_filter);
+    if (!handler->Open()) {
+      LOGE(INFERENCER2) << "[" << GetName() << "] Open inference handler on device " << device_id << " failed.";
+      handlers->clear();
+      return false;
+    }
+    // the handlers of the secondary models are chained after it on the same device
+    std::shared_ptr<InferHandler> last = handler;
+    for (const SecondaryModel& model : secondary_models_) {
+      Infer2Param model_params = model.params;
+      model_params.device_id = device_id;
+      auto next = std::make_shared<InferHandlerImpl>(this, model_params, model.processors.post_processor,
+                                                     model.processors.pre_processor, model.processors.frame_filter,
+                                                     model.processors.obj_filter);
+      if (!next->Open()) {
+        LOGE(INFERENCER2) << "[" << GetName() << "] Open inference handler of secondary model "
+                          << model_params.model_path << " on device " << device_id << " failed.";
+        handlers->clear();
+        return false;
+      }
+      last->SetNext(next);
+      last = next;
+    }
+    handlers->push_back(handler);
+  }
+  return true;
+}
 
-  infer_handler_ =
-      std::make_shared<InferHandlerImpl>(this, infer_params_, post_processor, pre_processor, frame_filter, obj_filter);
-  return infer_handler_->Open();
+void Inferencer2::Close() {
+  {
+    std::lock_guard<std::mutex> lk(reload_mutex_);
+    if (reload_thread_.joinable()) reload_thread_.join();
+  }
+  stream_groups_.clear();
+  {
+    std::lock_guard<std::mutex> lk(group_mutex_);
+    group_.reset();
+  }
+  balancer_.reset();
 }
 
-void Inferencer2::Close() { infer_handler_.reset(); }
+bool Inferencer2::ReloadModel(const std::string& model_path, const std::string& func_name, ReloadCallback callback) {
+  std::lock_guard<std::mutex> lk(reload_mutex_);
+  if (!CurrentGroup()) {
+    LOGE(INFERENCER2) << "[" << GetName() << "] Reload model failed, the module is not opened.";
+    return false;
+  }
+  if (reloading_.load()) {
+    LOGE(INFERENCER2) << "[" << GetName() << "] Reload model failed, another model is being loaded.";
+    return false;
+  }
+  if (reload_thread_.joinable()) reload_thread_.join();
+  Infer2Param params;
+  {
+    std::lock_guard<std::mutex> group_lk(group_mutex_);
+    params = infer_params_;
+  }
+  params.model_path = model_path;
+  if (!func_name.empty()) params.func_name = func_name;
+  // the first requests on the new model should not be slower than the ones on the old model
+  params.warmup = true;
+  reloading_ = true;
+  reload_thread_ = std::thread([this, params, callback] {
+    LOGI(INFERENCER2) << "[" << GetName() << "] Loading model " << params.model_path;
+    auto group = std::make_shared<HandlerGroup>();
+    bool ret = OpenHandlers(params, &group->handlers);
+    if (ret) {
+      std::shared_ptr<HandlerGroup> old_group;
+      {
+        std::lock_guard<std::mutex> lk(group_mutex_);
+        group->generation = group_->generation + 1;
+        old_group = group_;
+        group_ = group;
+        infer_params_.model_path = params.model_path;
+        infer_params_.func_name = params.func_name;
+      }
+      // the streams move to the new handlers by their next frames, the old ones are released by the last stream
+      generation_ = group->generation;
+      old_group.reset();
+      LOGI(INFERENCER2) << "[" << GetName() << "] Switched to model " << params.model_path;
+    } else {
+      PostEvent(EventType::EVENT_WARNING, "[" + GetName() + "] Load model " + params.model_path +
+                                              " failed, the current model is kept.");
+    }
+    group.reset();
+    reloading_ = false;
+    if (callback) callback(ret);
+  });
+  return true;
+}
+
+std::shared_ptr<Inferencer2::HandlerGroup> Inferencer2::CurrentGroup() {
+  std::lock_guard<std::mutex> lk(group_mutex_);
+  return group_;
+}
+
+std::shared_ptr<Inferencer2::HandlerGroup> Inferencer2::AcquireGroup(const CNFrameInfoPtr& data) {
+  uint32_t stream_idx = data->GetStreamIndex();
+  // the frames created out of pipelines have no stream index
+  if (stream_idx >= stream_groups_.size()) return CurrentGroup();
+  // only accessed by the thread processing the stream
+  std::shared_ptr<HandlerGroup>& last = stream_groups_[stream_idx];
+  if (last && last->generation == generation_.load()) return last;
+  std::shared_ptr<HandlerGroup> current = CurrentGroup();
+  if (last && last != current) {
+    // finishes the frames in flight on the old model first, keeps the frames of the stream in order
+    int index = balancer_ ? balancer_->Find(data->stream_id) : 0;
+    if (index >= 0) last->handlers[index]->WaitTaskDone(data->stream_id);
+  }
+  last = current;
+  return last;
+}
+
+void Inferencer2::PrepareDeviceData(const CNDataFramePtr& frame, uint32_t device_id) {
+  if (frame->dst_device_id < 0) {
+    /* CNSyncedMemory data is on CPU */
+    for (int i = 0; i < frame->GetPlanes(); i++) {
+      frame->data[i]->SetMluDevContext(device_id);
+    }
+    frame->dst_device_id = device_id;
+  } else if (static_cast<uint32_t>(frame->dst_device_id) != device_id &&
+             frame->ctx.dev_type == DevContext::DevType::MLU) {
+    /* CNSyncedMemory data is on different MLU from the data this module needed, and SOURCE data is on MLU*/
+    frame->CopyToSyncMemOnDevice(device_id);
+    frame->dst_device_id = device_id;
+  } else if (static_cast<uint32_t>(frame->dst_device_id) != device_id &&
+             frame->ctx.dev_type == DevContext::DevType::CPU) {
+    /* CNSyncedMemory data is on different MLU from the data this module needed, and SOURCE data is on CPU*/
+    void *dst = frame->cpu_data.get();
+    for (int i = 0; i < frame->GetPlanes(); i++) {
+      size_t plane_size = frame->GetPlaneBytes(i);
+      frame->data[i].reset(new CNSyncedMemory(plane_size));
+      frame->data[i]->SetCpuData(dst);
+      dst = reinterpret_cast<void *>(reinterpret_cast<uint8_t *>(dst) + plane_size);
+      frame->data[i]->SetMluDevContext(device_id);
+    }
+    frame->dst_device_id = device_id;  // set dst_device_id to the device of the handler
+  }
+}
 
 int Inferencer2::Process(std::shared_ptr<CNFrameInfo> data) {
   if (!data) {
@@ -119,37 +349,37 @@ int Inferencer2::Process(std::shared_ptr<CNFrameInfo> data) {
     return -1;
   }
 
+  std::shared_ptr<HandlerGroup> group = AcquireGroup(data);
+  if (!group) {
+    LOGE(INFERENCER2) << "[" << GetName() << "] Process failed, the module is not opened.";
+    return -1;
+  }
   if (!data->IsEos()) {
-    CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
-    if (frame->dst_device_id < 0) {
-      /* CNSyncedMemory data is on CPU */
-      for (int i = 0; i < frame->GetPlanes(); i++) {
-        frame->data[i]->SetMluDevContext(infer_params_.device_id);
+    CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+    size_t index = 0;
+    if (balancer_) {
+      // the device holding the frame data, streams prefer it to avoid peer copies
+      int data_device = -1;
+      if (frame->dst_device_id >= 0) {
+        data_device = frame->dst_device_id;
+      } else if (frame->ctx.dev_type == DevContext::DevType::MLU) {
+        data_device = frame->ctx.dev_id;
       }
-      frame->dst_device_id = infer_params_.device_id;
-    } else if (static_cast<uint32_t>(frame->dst_device_id) != infer_params_.device_id &&
-               frame->ctx.dev_type == DevContext::DevType::MLU) {
-      /* CNSyncedMemory data is on different MLU from the data this module needed, and SOURCE data is on MLU*/
-      frame->CopyToSyncMemOnDevice(infer_params_.device_id);
-      frame->dst_device_id = infer_params_.device_id;
-    } else if (static_cast<uint32_t>(frame->dst_device_id) != infer_params_.device_id &&
-               frame->ctx.dev_type == DevContext::DevType::CPU) {
-      /* CNSyncedMemory data is on different MLU from the data this module needed, and SOURCE data is on CPU*/
-      void *dst = frame->cpu_data.get();
-      for (int i = 0; i < frame->GetPlanes(); i++) {
-        size_t plane_size = frame->GetPlaneBytes(i);
-        frame->data[i].reset(new CNSyncedMemory(plane_size));
-        frame->data[i]->SetCpuData(dst);
-        dst = reinterpret_cast<void *>(reinterpret_cast<uint8_t *>(dst) + plane_size);
-        frame->data[i]->SetMluDevContext(infer_params_.device_id);
-      }
-      frame->dst_device_id = infer_params_.device_id;  // set dst_device_id to param_.device_id
+      index = balancer_->Route(data->stream_id, data_device);
     }
-    if (infer_handler_->Process(data, infer_params_.object_infer) != 0) {
+    PrepareDeviceData(frame, balancer_ ? balancer_->GetDeviceId(index) : infer_params_.device_id);
+    if (group->handlers[index]->Process(data, infer_params_.object_infer) != 0) {
       return -1;
     }
   } else {
-    infer_handler_->WaitTaskDone(data->stream_id);
+    if (balancer_) {
+      int index = balancer_->Find(data->stream_id);
+      if (index >= 0) group->handlers[index]->WaitTaskDone(data->stream_id);
+      balancer_->Release(data->stream_id);
+    } else {
+      group->handlers[0]->WaitTaskDone(data->stream_id);
+    }
+    if (data->GetStreamIndex() < stream_groups_.size()) stream_groups_[data->GetStreamIndex()].reset();
     TransmitData(data);
   }
 
@@ -162,7 +392,12 @@ Inferencer2::~Inferencer2() {
 
 bool Inferencer2::CheckParamSet(const ModuleParamSet& param_set) const {
   Infer2Param params;
-  return param_manager_->ParseBy(param_set, &params);
+  if (!param_manager_->ParseBy(param_set, &params)) return false;
+  for (const ModuleParamSet& model_params : params.secondary_models) {
+    Infer2Param secondary_params;
+    if (!param_manager_->ParseBy(model_params, &secondary_params)) return false;
+  }
+  return true;
 }
 
 }  // namespace cnstream
@@ -0,0 +1,64 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "model_cache.hpp"
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace cnstream {
+
+ModelCache& ModelCache::Instance() {
+  static ModelCache cache;
+  return cache;
+}
+
+std::string ModelCache::GetKey(uint32_t device_id, const std::string& model_path, const std::string& func_name) {
+  std::ostringstream ss;
+  ss << "device:" << device_id << ";model:" << model_path << ";func:" << func_name;
+  return ss.str();
+}
+
+InferModelInfoPtr ModelCache::Get(const std::string& key, const std::function<InferModelInfoPtr()>& load) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = models_.find(key);
+  if (iter != models_.end()) {
+    hit_cnt_++;
+    return iter->second;
+  }
+  InferModelInfoPtr model = load();
+  if (model) models_[key] = model;
+  return model;
+}
+
+void ModelCache::Clear() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  models_.clear();
+}
+
+size_t ModelCache::Size() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return models_.size();
+}
+
+}  // namespace cnstream
@@ -0,0 +1,73 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_MODEL_CACHE_HPP_
+#define MODULES_MODEL_CACHE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "infer_base.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Keeps the loaded models alive in the process, so that pipelines created later do not load them again.
+ */
+class ModelCache {
+ public:
+  static ModelCache& Instance();
+  /**
+   * @brief Gets the key of a model.
+   */
+  static std::string GetKey(uint32_t device_id, const std::string& model_path, const std::string& func_name);
+  /**
+   * @brief Gets the model of the key. The model is loaded by ``load`` if it is not cached.
+   *
+   * @param key The key of the model, see GetKey.
+   * @param load The function loading the model, it returns nullptr if failed.
+   *
+   * @return Returns the model, or nullptr if the model is not loaded.
+   */
+  InferModelInfoPtr Get(const std::string& key, const std::function<InferModelInfoPtr()>& load);
+  /**
+   * @brief Releases the cached models. The models are unloaded when they are not used by any session.
+   */
+  void Clear();
+  size_t Size();
+  /**
+   * @brief Returns the number of models got from the cache without loading.
+   */
+  uint64_t HitCount() const { return hit_cnt_.load(); }
+
+ private:
+  ModelCache() = default;
+  std::mutex mutex_;
+  std::map<std::string, InferModelInfoPtr> models_;
+  std::atomic<uint64_t> hit_cnt_{0};
+};  // class ModelCache
+
+}  // namespace cnstream
+
+#endif  // MODULES_MODEL_CACHE_HPP_
@@ -0,0 +1,94 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "motion_detector.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace cnstream {
+
+MotionDetector::MotionDetector(uint32_t grid_w, uint32_t grid_h, uint32_t cell_threshold)
+    : grid_w_(std::max(grid_w, 1u)), grid_h_(std::max(grid_h, 1u)), cell_threshold_(cell_threshold) {}
+
+std::vector<uint32_t> MotionDetector::SampleRows(uint32_t height) const {
+  std::vector<uint32_t> rows;
+  if (height == 0) return rows;
+  uint32_t row_num = std::min(grid_h_, height);
+  rows.reserve(row_num);
+  for (uint32_t i = 0; i < row_num; ++i) {
+    // the center row of each cell row
+    rows.push_back(static_cast<uint32_t>((2 * i + 1) * static_cast<uint64_t>(height) / (2 * row_num)));
+  }
+  return rows;
+}
+
+std::vector<uint8_t> MotionDetector::Thumbnail(const std::vector<const uint8_t*>& rows, uint32_t width) const {
+  std::vector<uint8_t> cells;
+  if (rows.empty() || width == 0) return cells;
+  uint32_t col_num = std::min(grid_w_, width);
+  cells.reserve(rows.size() * col_num);
+  for (const uint8_t* row : rows) {
+    if (!row) return {};
+    for (uint32_t col = 0; col < col_num; ++col) {
+      uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(col) * width / col_num);
+      uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(col + 1) * width / col_num);
+      uint32_t sum = 0;
+      for (uint32_t x = begin; x < end; ++x) sum += row[x];
+      cells.push_back(static_cast<uint8_t>(sum / (end - begin)));
+    }
+  }
+  return cells;
+}
+
+float MotionDetector::Score(const std::vector<uint8_t>& ref, const std::vector<uint8_t>& cur) const {
+  if (ref.empty() || ref.size() != cur.size()) return 1.0f;
+  uint32_t changed = 0;
+  for (size_t i = 0; i < ref.size(); ++i) {
+    if (static_cast<uint32_t>(std::abs(static_cast<int>(ref[i]) - static_cast<int>(cur[i]))) > cell_threshold_) {
+      changed++;
+    }
+  }
+  return static_cast<float>(changed) / ref.size();
+}
+
+float MotionDetector::Score(const std::vector<uint8_t>& ref, const std::vector<uint8_t>& cur, float x, float y,
+                            float w, float h) const {
+  if (ref.empty() || ref.size() != cur.size() || ref.size() % grid_w_) return 1.0f;
+  const size_t row_num = ref.size() / grid_w_;
+  uint32_t changed = 0, total = 0;
+  for (size_t row = 0; row < row_num; ++row) {
+    float cy = (row + 0.5f) / row_num;
+    if (cy < y || cy > y + h) continue;
+    for (size_t col = 0; col < grid_w_; ++col) {
+      float cx = (col + 0.5f) / grid_w_;
+      if (cx < x || cx > x + w) continue;
+      size_t i = row * grid_w_ + col;
+      total++;
+      if (static_cast<uint32_t>(std::abs(static_cast<int>(ref[i]) - static_cast<int>(cur[i]))) > cell_threshold_) {
+        changed++;
+      }
+    }
+  }
+  return total ? static_cast<float>(changed) / total : 1.0f;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,85 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_MOTION_DETECTOR_HPP_
+#define MODULES_MOTION_DETECTOR_HPP_
+
+#include <cstdint>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief Cheap scene change score of luma planes.
+ *
+ * The Y plane is reduced to a thumbnail of grid_w x grid_h cells. Only one row per cell row is read, so on device only
+ * grid_h rows have to be copied to host. Each cell is the mean of its span of the sampled row. The score of two
+ * thumbnails is the ratio of cells that change by more than cell_threshold.
+ */
+class MotionDetector {
+ public:
+  MotionDetector(uint32_t grid_w = 32, uint32_t grid_h = 18, uint32_t cell_threshold = 8);
+
+  /**
+   * @brief Gets the rows to read of a plane.
+   *
+   * @param height The height of the plane.
+   *
+   * @return Returns the indices of the rows, one per cell row.
+   */
+  std::vector<uint32_t> SampleRows(uint32_t height) const;
+
+  /**
+   * @brief Builds the thumbnail from the sampled rows.
+   *
+   * @param rows The sampled rows, see SampleRows.
+   * @param width The width of the rows.
+   *
+   * @return Returns the cells of the thumbnail, empty if the rows are not valid.
+   */
+  std::vector<uint8_t> Thumbnail(const std::vector<const uint8_t*>& rows, uint32_t width) const;
+
+  /**
+   * @brief Computes the motion score of two thumbnails.
+   *
+   * @return Returns the ratio of the changed cells in [0, 1]. Returns 1 if the thumbnails are not comparable.
+   */
+  float Score(const std::vector<uint8_t>& ref, const std::vector<uint8_t>& cur) const;
+
+  /**
+   * @brief Computes the motion score of a region of two thumbnails, e.g. a tile of the frames.
+   *
+   * @param x, y, w, h The region normalized to the frame, the cells whose centers are in it are compared.
+   *
+   * @return Returns the ratio of the changed cells of the region in [0, 1]. Returns 1 if the thumbnails are not
+   * comparable or no cell is in the region.
+   */
+  float Score(const std::vector<uint8_t>& ref, const std::vector<uint8_t>& cur, float x, float y, float w,
+              float h) const;
+
+ private:
+  uint32_t grid_w_;
+  uint32_t grid_h_;
+  uint32_t cell_threshold_;
+};  // class MotionDetector
+
+}  // namespace cnstream
+
+#endif  // MODULES_MOTION_DETECTOR_HPP_
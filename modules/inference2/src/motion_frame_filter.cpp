@@ -0,0 +1,109 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "motion_frame_filter.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnrt.h"
+#include "cnstream_logging.hpp"
+#include "device/mlu_context.h"
+
+namespace cnstream {
+
+IMPLEMENT_REFLEX_OBJECT_EX(MotionFrameFilter, FrameFilter)
+
+bool ReadMotionThumbnail(const MotionDetector& detector, const CNDataFramePtr& frame,
+                         std::vector<uint8_t>* thumbnail) {
+  if (frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 &&
+      frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21) {
+    return false;
+  }
+  const uint32_t width = frame->width;
+  const uint32_t stride = frame->stride[0];
+  std::vector<uint32_t> row_indices = detector.SampleRows(frame->height);
+  std::vector<const uint8_t*> rows;
+  std::vector<uint8_t> host_rows;
+  if (frame->data[0]->GetHead() == CNSyncedMemory::SyncedHead::HEAD_AT_MLU) {
+    // copies the sampled rows only, instead of synchronizing the whole plane to host
+    infer_server::SetCurrentDevice(frame->data[0]->GetMluDevId());
+    const uint8_t* y_plane = reinterpret_cast<const uint8_t*>(frame->data[0]->GetMluData());
+    host_rows.resize(static_cast<size_t>(row_indices.size()) * width);
+    for (size_t i = 0; i < row_indices.size(); ++i) {
+      void* src = const_cast<uint8_t*>(y_plane + static_cast<size_t>(row_indices[i]) * stride);
+      if (CNRT_RET_SUCCESS != cnrtMemcpy(host_rows.data() + i * width, src, width, CNRT_MEM_TRANS_DIR_DEV2HOST)) {
+        LOGW(INFERENCER2) << "MotionFrameFilter copy Y plane rows failed.";
+        return false;
+      }
+      rows.push_back(host_rows.data() + i * width);
+    }
+  } else {
+    const uint8_t* y_plane = reinterpret_cast<const uint8_t*>(frame->data[0]->GetCpuData());
+    if (!y_plane) return false;
+    for (uint32_t row : row_indices) rows.push_back(y_plane + static_cast<size_t>(row) * stride);
+  }
+  *thumbnail = detector.Thumbnail(rows, width);
+  return !thumbnail->empty();
+}
+
+bool MotionFrameFilter::Filter(const CNFrameInfoPtr& finfo) {
+  if (!finfo->collection.HasValue(kCNDataFrameSlot)) return true;
+  CNDataFramePtr frame = finfo->collection.Get(kCNDataFrameSlot);
+  if (frame->activity >= 0) {
+    // scored by the decoder, the activities since the last inferred frame are summed up so slow motion is not missed
+    std::lock_guard<std::mutex> lk(mutex_);
+    StreamState& state = streams_[finfo->stream_id];
+    state.activity += frame->activity;
+    bool force = max_skip_ > 0 && state.skipped >= max_skip_;
+    if (force || state.activity >= threshold_) {
+      state.ref.clear();  // the thumbnail of this frame is not read
+      state.activity = 0;
+      state.skipped = 0;
+      return true;
+    }
+    state.skipped++;
+    return false;
+  }
+  std::vector<uint8_t> thumbnail;
+  // frames which can not be scored are always inferred
+  if (!ReadMotionThumbnail(detector_, frame, &thumbnail)) return true;
+
+  std::lock_guard<std::mutex> lk(mutex_);
+  StreamState& state = streams_[finfo->stream_id];
+  bool force = max_skip_ > 0 && state.skipped >= max_skip_;
+  if (force || detector_.Score(state.ref, thumbnail) >= threshold_) {
+    state.ref = std::move(thumbnail);
+    state.activity = 0;
+    state.skipped = 0;
+    return true;
+  }
+  state.skipped++;
+  return false;
+}
+
+void MotionFrameFilter::RemoveStream(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  streams_.erase(stream_id);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,87 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_MOTION_FRAME_FILTER_HPP_
+#define MODULES_MOTION_FRAME_FILTER_HPP_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "frame_filter.hpp"
+#include "motion_detector.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Reads the thumbnail of the Y plane of a frame, see MotionDetector. When the frame is on device, only the
+ * sampled rows are copied to host.
+ *
+ * @return Returns false if the frame is not NV12 or NV21, or the rows fail to be read.
+ */
+bool ReadMotionThumbnail(const MotionDetector& detector, const CNDataFramePtr& frame,
+                         std::vector<uint8_t>* thumbnail);
+
+/**
+ * @brief Built-in frame filter skipping frames of static scenes.
+ *
+ * A frame is filtered out when the motion score of its Y plane against the last inferred frame of the stream is lower
+ * than the threshold, see MotionDetector. When the frame is on device, only the sampled rows are copied to host. Only
+ * NV12 and NV21 frames are filtered.
+ *
+ * When the frame is scored by the decoder (see CNDataFrame::activity), the pixels are not read. The frame is filtered
+ * out when the sum of the activities of the frames since the last inferred frame is lower than the threshold.
+ */
+class MotionFrameFilter : public FrameFilter {
+ public:
+  MotionFrameFilter() = default;
+  /**
+   * @param threshold Frames with a lower motion score are filtered out, see MotionDetector::Score.
+   * @param max_skip At most max_skip frames in a row are filtered out of one stream. 0 means no limit.
+   */
+  MotionFrameFilter(float threshold, uint32_t max_skip) : threshold_(threshold), max_skip_(max_skip) {}
+
+  bool Filter(const CNFrameInfoPtr& finfo) override;
+
+  /**
+   * @brief Drops the reference frame of a stream.
+   */
+  void RemoveStream(const std::string& stream_id);
+
+ private:
+  struct StreamState {
+    std::vector<uint8_t> ref;  // thumbnail of the last inferred frame
+    uint32_t skipped = 0;
+    float activity = 0;  // the sum of the activities scored by the decoder since the last inferred frame
+  };
+  float threshold_ = 0.01f;
+  uint32_t max_skip_ = 25;
+  MotionDetector detector_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, StreamState> streams_;
+
+  DECLARE_REFLEX_OBJECT_EX(MotionFrameFilter, FrameFilter)
+};  // class MotionFrameFilter
+
+}  // namespace cnstream
+
+#endif  // MODULES_MOTION_FRAME_FILTER_HPP_
@@ -0,0 +1,118 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "result_cache.hpp"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "infer_roi.hpp"
+
+namespace cnstream {
+
+static constexpr uint64_t kHashPrime1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t kHashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+static inline uint64_t HashMix(uint64_t hash, uint64_t word) {
+  word *= kHashPrime2;
+  word = (word << 31) | (word >> 33);
+  hash ^= word * kHashPrime1;
+  return ((hash << 27) | (hash >> 37)) * kHashPrime1 + kHashPrime2;
+}
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint64_t hash = seed ^ (size * kHashPrime1);
+  size_t pos = 0;
+  for (; pos + sizeof(uint64_t) <= size; pos += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes + pos, sizeof(word));
+    hash = HashMix(hash, word);
+  }
+  if (pos < size) {
+    uint64_t word = 0;
+    memcpy(&word, bytes + pos, size - pos);
+    hash = HashMix(hash, word);
+  }
+  // avalanche, so that the nearby inputs are spread
+  hash ^= hash >> 33;
+  hash *= kHashPrime2;
+  hash ^= hash >> 29;
+  return hash;
+}
+
+bool HashFrame(const CNDataFramePtr& frame, uint64_t* hash) {
+  if (frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 &&
+      frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21) {
+    return false;
+  }
+  const uint8_t* y_plane = reinterpret_cast<const uint8_t*>(frame->data[0]->GetCpuData());
+  if (!y_plane) return false;
+  const int header[3] = {static_cast<int>(frame->fmt), frame->width, frame->height};
+  uint64_t value = HashBytes(header, sizeof(header));
+  for (int row = 0; row < frame->height; ++row) {
+    value = HashBytes(y_plane + static_cast<size_t>(row) * frame->stride[0], frame->width, value);
+  }
+  *hash = value;
+  return true;
+}
+
+ResultCache::ResultCache(size_t capacity) : capacity_(capacity) {}
+
+bool ResultCache::Get(uint64_t key, std::vector<CNInferObjectPtr>* objs) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = index_.find(key);
+  if (iter == index_.end()) {
+    miss_cnt_++;
+    return false;
+  }
+  hit_cnt_++;
+  entries_.splice(entries_.begin(), entries_, iter->second);
+  // copied, the objects could be modified by the downstream modules
+  for (auto& obj : iter->second->second) objs->push_back(CopyInferObject(obj));
+  return true;
+}
+
+void ResultCache::Put(uint64_t key, const std::vector<CNInferObjectPtr>& objs) {
+  std::vector<CNInferObjectPtr> copies;
+  copies.reserve(objs.size());
+  for (auto& obj : objs) copies.push_back(CopyInferObject(obj));
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = index_.find(key);
+  if (iter != index_.end()) {
+    iter->second->second = std::move(copies);
+    entries_.splice(entries_.begin(), entries_, iter->second);
+    return;
+  }
+  entries_.emplace_front(key, std::move(copies));
+  index_[key] = entries_.begin();
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+size_t ResultCache::Size() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return entries_.size();
+}
+
+}  // namespace cnstream
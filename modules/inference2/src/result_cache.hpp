@@ -0,0 +1,91 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_RESULT_CACHE_HPP_
+#define MODULES_RESULT_CACHE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Hashes bytes with a fast non-cryptographic 64-bit hash, 8 bytes at a time.
+ */
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+/**
+ * @brief Hashes the content of a frame, the size, the format and the Y plane without the padding of the stride. The
+ * frame is synchronized to host if it is on device.
+ *
+ * @return Returns false if the frame is not NV12 or NV21, or its data can not be read.
+ */
+bool HashFrame(const CNDataFramePtr& frame, uint64_t* hash);
+
+/**
+ * @brief Caches the objects inferred on the frames by the hash of their content, so that a duplicate frame, e.g. an
+ * image uploaded again, gets the objects without inference. The least recently used frames are evicted.
+ *
+ * This class is thread-safe.
+ */
+class ResultCache {
+ public:
+  /**
+   * @param capacity The max number of frames cached, must be greater than 0.
+   */
+  explicit ResultCache(size_t capacity);
+  /**
+   * @brief Gets the objects of a frame.
+   *
+   * @param key The hash of the frame, see HashFrame.
+   * @param objs The copies of the cached objects are appended to it on hit.
+   *
+   * @return Returns true on hit.
+   */
+  bool Get(uint64_t key, std::vector<CNInferObjectPtr>* objs);
+  /**
+   * @brief Caches copies of the objects of a frame, replacing the objects cached by the key.
+   */
+  void Put(uint64_t key, const std::vector<CNInferObjectPtr>& objs);
+  size_t Size() const;
+  uint64_t HitCount() const { return hit_cnt_; }
+  uint64_t MissCount() const { return miss_cnt_; }
+
+ private:
+  using Entry = std::pair<uint64_t, std::vector<CNInferObjectPtr>>;
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  std::list<Entry> entries_;  // the most recently used first
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+  std::atomic<uint64_t> hit_cnt_{0};
+  std::atomic<uint64_t> miss_cnt_{0};
+};  // class ResultCache
+
+}  // namespace cnstream
+
+#endif  // MODULES_RESULT_CACHE_HPP_
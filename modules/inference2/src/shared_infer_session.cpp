@@ -0,0 +1,158 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "shared_infer_session.hpp"
+
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "infer_handler.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief The user data of requests sent to the shared session, it records which handler the request belongs to.
+ */
+struct SharedRequestData {
+  InferHandlerImpl* caller = nullptr;
+  CNFrameInfoPtr data = nullptr;
+};
+
+class SharedSessionObserver : public InferEngineDataObserver {
+ public:
+  explicit SharedSessionObserver(SharedInferSession* session) : session_(session) {}
+
+  void Response(InferStatus status, InferPackagePtr result, InferUserData user_data) noexcept override {
+    session_->Response(status, std::move(result), std::move(user_data));
+  }
+
+ private:
+  SharedInferSession* session_ = nullptr;
+};
+
+template <typename MapT>
+static void AppendMap(std::ostringstream* ss, const MapT& params) {
+  // sorted, the order of unordered_map is not determined
+  std::map<std::string, std::string> sorted(params.begin(), params.end());
+  for (const auto& it : sorted) *ss << it.first << "=" << it.second << ",";
+}
+
+std::string SharedInferSession::GetKey(const Infer2Param& params) {
+  std::ostringstream ss;
+  ss << "device:" << params.device_id << ";model:" << params.model_path << ";func:" << params.func_name
+     << ";strategy:" << static_cast<int>(params.batch_strategy)
+     << ";preproc:" << params.preproc_name << "," << static_cast<int>(params.model_input_pixel_format) << ","
+     << params.keep_aspect_ratio << "," << params.normalize << ",mean:";
+  for (float v : params.mean_) ss << v << ",";
+  ss << "std:";
+  for (float v : params.std_) ss << v << ",";
+  AppendMap(&ss, params.custom_preproc_params);
+  ss << ";postproc:" << params.postproc_name << "," << static_cast<int>(params.data_order) << ","
+     << params.native_data_order << ","
+     << params.threshold << "," << params.batch_postproc << ",";
+  AppendMap(&ss, params.custom_postproc_params);
+  return ss.str();
+}
+
+SharedInferSession::SharedInferSession() {
+  observer_ = std::make_shared<SharedSessionObserver>(this);
+}
+
+SharedInferSession::~SharedInferSession() {
+  if (engine_ && session_) {
+    infer_server::SetCurrentDevice(device_id_);
+    engine_->DestroySession(session_);
+  }
+}
+
+void SharedInferSession::Reset(uint32_t device_id, std::unique_ptr<InferEngine> engine, InferEngineSession session,
+                               InferModelInfoPtr model) {
+  device_id_ = device_id;
+  engine_ = std::move(engine);
+  session_ = session;
+  model_ = std::move(model);
+}
+
+void SharedInferSession::AddCaller(InferHandlerImpl* caller) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  callers_[caller] = 0;
+}
+
+void SharedInferSession::RemoveCaller(InferHandlerImpl* caller) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  cond_.wait(lk, [&] {
+    auto iter = callers_.find(caller);
+    return iter == callers_.end() || iter->second == 0;
+  });
+  callers_.erase(caller);
+}
+
+bool SharedInferSession::Request(InferHandlerImpl* caller, InferPackagePtr in, const CNFrameInfoPtr& data) {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    callers_[caller]++;
+  }
+  SharedRequestData request;
+  request.caller = caller;
+  request.data = data;
+  if (engine_->Request(session_, std::move(in), request)) return true;
+  std::lock_guard<std::mutex> lk(mutex_);
+  callers_[caller]--;
+  cond_.notify_all();
+  return false;
+}
+
+void SharedInferSession::Response(InferStatus status, InferPackagePtr result, InferUserData user_data) {
+  SharedRequestData request = infer_server::any_cast<SharedRequestData>(user_data);
+  request.caller->OnResponse(status, request.data, result);
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = callers_.find(request.caller);
+  if (iter != callers_.end() && iter->second) iter->second--;
+  cond_.notify_all();
+}
+
+void SharedInferSession::WaitTaskDone(const std::string& stream_id) {
+  // the tasks of the stream sent by other modules are waited too.
+  if (engine_) engine_->WaitTaskDone(session_, stream_id);
+}
+
+InferSessionRegistry& InferSessionRegistry::Instance() {
+  static InferSessionRegistry registry;
+  return registry;
+}
+
+std::shared_ptr<SharedInferSession> InferSessionRegistry::Get(
+    const std::string& key, const std::function<bool(SharedInferSession*)>& create) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = sessions_.find(key);
+  if (iter != sessions_.end()) {
+    std::shared_ptr<SharedInferSession> session = iter->second.lock();
+    if (session) return session;
+  }
+  std::shared_ptr<SharedInferSession> session(new SharedInferSession);
+  if (!create(session.get())) return nullptr;
+  sessions_[key] = session;
+  return session;
+}
+
+}  // namespace cnstream
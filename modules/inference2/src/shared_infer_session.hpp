@@ -0,0 +1,113 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_SHARED_INFER_SESSION_HPP_
+#define MODULES_SHARED_INFER_SESSION_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "infer_base.hpp"
+
+namespace cnstream {
+
+class InferHandlerImpl;
+
+/**
+ * @brief SharedInferSession is an inference session shared by Inferencer2 modules using the same model, the same
+ * preprocessing and the same postprocessing. Requests of all of them are merged into the same batches, and the
+ * responses are routed back to the handler sending the request.
+ */
+class SharedInferSession {
+ public:
+  ~SharedInferSession();
+  /**
+   * @brief Gets the key of parameters. Modules are able to share the session only if their keys are the same.
+   */
+  static std::string GetKey(const Infer2Param& params);
+  /**
+   * @brief Takes the ownership of the engine and the session created by the first handler.
+   */
+  void Reset(uint32_t device_id, std::unique_ptr<InferEngine> engine, InferEngineSession session,
+             InferModelInfoPtr model);
+  /**
+   * @brief The model of the session.
+   */
+  InferModelInfoPtr GetModel() const { return model_; }
+  /**
+   * @brief The observer should be used to create the session.
+   */
+  std::shared_ptr<InferEngineDataObserver> GetObserver() const { return observer_; }
+
+  void AddCaller(InferHandlerImpl* caller);
+  /**
+   * @brief Removes the caller, it blocks until the responses of all requests sent by the caller are received.
+   */
+  void RemoveCaller(InferHandlerImpl* caller);
+  bool Request(InferHandlerImpl* caller, InferPackagePtr in, const CNFrameInfoPtr& data);
+  void WaitTaskDone(const std::string& stream_id);
+
+ private:
+  friend class SharedSessionObserver;
+  friend class InferSessionRegistry;
+  SharedInferSession();
+  void Response(InferStatus status, InferPackagePtr result, InferUserData user_data);
+
+  uint32_t device_id_ = 0;
+  std::unique_ptr<InferEngine> engine_ = nullptr;
+  InferEngineSession session_ = nullptr;
+  InferModelInfoPtr model_ = nullptr;
+  std::shared_ptr<InferEngineDataObserver> observer_ = nullptr;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::map<InferHandlerImpl*, uint64_t> callers_;  // caller -> requests without response
+};  // class SharedInferSession
+
+/**
+ * @brief InferSessionRegistry keeps the shared sessions of the process. A session is destroyed after all modules
+ * using it are closed.
+ */
+class InferSessionRegistry {
+ public:
+  static InferSessionRegistry& Instance();
+  /**
+   * @brief Gets the shared session of the key. The session is created by ``create`` if it does not exist.
+   *
+   * @param key The key of the session, see SharedInferSession::GetKey.
+   * @param create The function creating the engine and the session, it returns false if failed.
+   *
+   * @return Returns the shared session, or nullptr if the session is not created.
+   */
+  std::shared_ptr<SharedInferSession> Get(const std::string& key,
+                                          const std::function<bool(SharedInferSession*)>& create);
+
+ private:
+  InferSessionRegistry() = default;
+  std::mutex mutex_;
+  std::map<std::string, std::weak_ptr<SharedInferSession>> sessions_;
+};  // class InferSessionRegistry
+
+}  // namespace cnstream
+
+#endif  // MODULES_SHARED_INFER_SESSION_HPP_
@@ -21,6 +21,7 @@
 #include "video_postproc.hpp"
 
 #include <string>
+#include <vector>
 
 namespace cnstream {
 
@@ -34,4 +35,22 @@ VideoPostproc* VideoPostproc::Create(const std::string& proc_name) {
 
 void VideoPostproc::SetThreshold(const float threshold) { threshold_ = threshold; }
 
+// set by the inference handler around the postprocessing of each cropped input
+static thread_local CNInferBoundingBox g_input_roi = {0, 0, 1, 1};
+
+CNInferBoundingBox VideoPostproc::GetInputRoi() { return g_input_roi; }
+
+void VideoPostproc::SetInputRoi(const CNInferBoundingBox& roi) { g_input_roi = roi; }
+
+bool VideoPostproc::ExecuteBatch(const std::vector<infer_server::InferData*>& output_data,
+                                 const std::vector<const infer_server::ModelIO*>& model_outputs,
+                                 const infer_server::ModelInfo* model_info) {
+  if (output_data.size() != model_outputs.size()) return false;
+  bool ret = true;
+  for (size_t i = 0; i < output_data.size(); ++i) {
+    ret = Execute(output_data[i], *model_outputs[i], model_info) && ret;
+  }
+  return ret;
+}
+
 }  // namespace cnstream
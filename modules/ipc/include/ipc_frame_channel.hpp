@@ -0,0 +1,225 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_IPC_FRAME_CHANNEL_HPP_
+#define MODULES_IPC_FRAME_CHANNEL_HPP_
+
+/**
+ *  @file ipc_frame_channel.hpp
+ *
+ *  This file contains a declaration of the IpcFrameChannel class.
+ */
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cnstream {
+
+struct IpcChannelHeader;
+struct IpcBufferState;
+
+/**
+ * @brief The description of a frame passed through an IpcFrameChannel.
+ */
+struct IpcFrameDesc {
+  static constexpr int kMaxPlanes = 3;        ///< The max number of planes of a frame.
+  static constexpr uint32_t kNoBuffer = ~0u;  ///< The buffer index of the descriptions without pixels, e.g. eos.
+
+  char stream_id[128];          ///< The stream identification, terminated by '\0'.
+  uint64_t frame_id;            ///< The frame index of the stream.
+  int64_t timestamp;            ///< The timestamp of the frame.
+  uint32_t buffer;              ///< The index of the buffer holding the planes, or kNoBuffer.
+  uint32_t eos;                 ///< 1 if it is the end of the stream.
+  int32_t fmt;                  ///< The CNDataFormat of the frame.
+  int32_t width;                ///< The width of the frame.
+  int32_t height;               ///< The height of the frame.
+  int32_t planes;               ///< The number of planes.
+  int32_t stride[kMaxPlanes];   ///< The strides of the planes.
+  uint64_t offset[kMaxPlanes];  ///< The offsets of the planes in the buffer.
+  uint64_t size[kMaxPlanes];    ///< The sizes of the planes in bytes.
+  uint64_t extra_offset;        ///< The offset of the extra data in the buffer, e.g. an InferObjsCodec message.
+  uint64_t extra_size;          ///< The size of the extra data in bytes, 0 if there is none.
+};  // struct IpcFrameDesc
+
+/**
+ * @class IpcFrameChannel
+ *
+ * @brief IpcFrameChannel passes frames from a producer process to a consumer process through POSIX shared memory.
+ *
+ * The shared memory holds a pool of fixed size buffers and a bounded queue of frame descriptions. The producer
+ * fills a free buffer and publishes a description of it, the consumer maps the planes in place, so the pixels are
+ * never copied by the consumer. Every buffer has a reference count shared by the processes and the pid of its
+ * holder, both are updated together by one atomic operation:
+ *
+ * @verbatim
+ * AcquireBuffer (producer, 0 -> 1) -> Publish -> Receive (consumer, holder changes) -> ReleaseBuffer (1 -> 0)
+ * @endverbatim
+ *
+ * Neither side waits for the other one. The producer drops frames when no buffer is free or the queue is full. A
+ * crashed consumer does not leak buffers, the buffers held by a dead process are taken back by the producer, and
+ * a new consumer continues with the frames left in the queue.
+ *
+ * The layout of the shared memory (native endian, all fields are naturally aligned):
+ *
+ * @verbatim
+ * header  := magic(u32 "CNIC") version(u32) buffer_count(u32) queue_size(u32) buffer_size(u64)
+ *            producer_pid(i32) consumer_pid(i32) head(u64) tail(u64) padding to 64 bytes
+ * states  := state(u64) * buffer_count, the holder pid in the high 32 bits and the reference count in the low ones
+ * queue   := IpcFrameDesc * queue_size, description n is put at n % queue_size
+ * buffers := buffer * buffer_count, starting at a page boundary, each one is rounded up to pages
+ * @endverbatim
+ *
+ * head is the number of frames published and tail is the number of frames received.
+ *
+ * @note There is one producer and one consumer per channel. The functions of a producer must not be called
+ *       concurrently except AcquireBuffer and ReleaseBuffer.
+ */
+class IpcFrameChannel {
+ public:
+  static constexpr uint32_t kMagic = 0x43494E43;  ///< "CNIC" in little-endian.
+  static constexpr uint32_t kVersion = 2;         ///< The version of the layout.
+
+  IpcFrameChannel() = default;
+  ~IpcFrameChannel();
+  IpcFrameChannel(const IpcFrameChannel &) = delete;
+  IpcFrameChannel &operator=(const IpcFrameChannel &) = delete;
+
+  /**
+   * @brief Creates the shared memory as the producer. The existing one with the same name is replaced, the consumer
+   *        attached to it should attach again.
+   *
+   * @param[in] name The name of the shared memory, e.g. "cnstream_frames" for /dev/shm/cnstream_frames.
+   * @param[in] buffer_count The number of buffers.
+   * @param[in] buffer_size The size of a buffer in bytes, it should hold all planes of a frame.
+   * @param[in] queue_size The max number of frames published and not received.
+   *
+   * @return Returns false if the shared memory fails to be created.
+   */
+  bool Create(const std::string &name, uint32_t buffer_count, size_t buffer_size, uint32_t queue_size);
+
+  /**
+   * @brief Attaches to the shared memory as the consumer.
+   *
+   * @param[in] name The name of the shared memory.
+   *
+   * @return Returns false if the shared memory does not exist, it is not a channel or another living process is
+   *         the consumer.
+   */
+  bool Attach(const std::string &name);
+
+  /**
+   * @brief Unmaps the shared memory. The producer removes it as well.
+   *
+   * @return No return value.
+   *
+   * @note The consumer should release the buffers received before closing.
+   */
+  void Close();
+
+  /**
+   * @brief Takes a free buffer with a reference. The buffers held by dead processes are taken back if no one is free.
+   *
+   * @param[out] index The index of the buffer.
+   *
+   * @return Returns the buffer, nullptr if no buffer is free.
+   */
+  uint8_t *AcquireBuffer(uint32_t *index);
+
+  /**
+   * @brief Publishes a frame as the producer. The reference of the buffer in the description is handed to the
+   *        consumer.
+   *
+   * @param[in] desc The description.
+   *
+   * @return Returns false if the queue is full, the buffer is released then.
+   */
+  bool Publish(const IpcFrameDesc &desc);
+
+  /**
+   * @brief Receives a frame as the consumer without waiting. The reference of the buffer is held by the caller.
+   *
+   * @param[out] desc The description.
+   * @param[out] buffer The buffer holding the planes, nullptr if the description has no buffer.
+   *
+   * @return Returns false if no frame is published.
+   */
+  bool Receive(IpcFrameDesc *desc, uint8_t **buffer);
+
+  /**
+   * @brief Releases a reference of a buffer.
+   *
+   * @param[in] index The index of the buffer.
+   *
+   * @return No return value.
+   */
+  void ReleaseBuffer(uint32_t index);
+
+  /**
+   * @brief Checks whether the process on the other side is alive.
+   *
+   * @return Returns true if the peer is attached and alive.
+   */
+  bool IsPeerAlive() const;
+
+  /**
+   * @brief Gets the reference count of a buffer.
+   *
+   * @param[in] index The index of the buffer.
+   *
+   * @return Returns the reference count, -1 if the index is invalid.
+   */
+  int RefCount(uint32_t index) const;
+
+  /**
+   * @brief Gets the size of a buffer.
+   *
+   * @return Returns the size in bytes, 0 if the channel is not opened.
+   */
+  size_t BufferSize() const;
+
+  /**
+   * @brief Checks whether the channel is opened.
+   *
+   * @return Returns true if the channel is created or attached.
+   */
+  bool IsOpened() const { return header_ != nullptr; }
+
+ private:
+  bool Map(int fd, size_t size);
+  void Reclaim();
+
+  std::string name_;
+  bool producer_ = false;
+  void *base_ = nullptr;
+  size_t size_ = 0;
+  pid_t pid_ = 0;
+  IpcChannelHeader *header_ = nullptr;
+  IpcBufferState *states_ = nullptr;
+  IpcFrameDesc *queue_ = nullptr;
+  uint8_t *buffers_ = nullptr;
+  std::atomic<uint32_t> next_buffer_{0};
+};  // class IpcFrameChannel
+
+}  // namespace cnstream
+
+#endif  // MODULES_IPC_FRAME_CHANNEL_HPP_
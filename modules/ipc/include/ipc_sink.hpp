@@ -0,0 +1,128 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_IPC_SINK_HPP_
+#define MODULES_IPC_SINK_HPP_
+
+/**
+ *  @file ipc_sink.hpp
+ *
+ *  This file contains a declaration of the IpcSink class.
+ */
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_module.hpp"
+#include "ipc_frame_channel.hpp"
+
+namespace cnstream {
+
+/**
+ * @class IpcSink
+ *
+ * @brief IpcSink passes the frames to a pipeline in another process, which receives them by IpcSource.
+ *
+ * The planes of every frame are put into a buffer of an IpcFrameChannel, the receiver uses them in place. It splits
+ * e.g. decoding and analysis into processes, so that a crashed analysis process does not stop decoding. Frames are
+ * never blocked by the receiver, they are dropped when the receiver falls behind or does not exist.
+ */
+class IpcSink : public Module, public ModuleCreator<IpcSink> {
+ public:
+  /**
+   * @brief Constructs an IpcSink object.
+   *
+   * @param[in] name The name of this module.
+   *
+   * @return No return value.
+   */
+  explicit IpcSink(const std::string &name);
+
+  /**
+   * @brief Destructs an IpcSink object.
+   *
+   * @return No return value.
+   */
+  ~IpcSink();
+
+  /**
+   * @brief Creates the channel.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the channel is created successfully.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Removes the channel.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+
+  /**
+   * @brief Passes a frame to the receiver.
+   *
+   * @param[in] data The frame.
+   *
+   * @return Returns 0, frames are never blocked by the receiver.
+   */
+  int Process(std::shared_ptr<CNFrameInfo> data) override;
+
+  /**
+   * @brief Passes the end of a stream to the receiver.
+   *
+   * @param[in] stream_id The stream identification.
+   *
+   * @return No return value.
+   */
+  void OnEos(const std::string &stream_id) override;
+
+  /**
+   * @brief Checks the parameters of this module.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool CheckParamSet(const ModuleParamSet &paramSet) const override;
+
+  /**
+   * @brief Gets the number of frames dropped since the module is opened.
+   *
+   * @return Returns the number of dropped frames.
+   */
+  uint64_t Dropped() const { return dropped_.load(); }
+
+ private:
+  bool Publish(const IpcFrameDesc &desc);
+  void Drop(const std::string &stream_id, const char *reason);
+
+  IpcFrameChannel channel_;
+  std::mutex publish_mutex_;
+  std::atomic<uint64_t> dropped_{0};
+};  // class IpcSink
+
+}  // namespace cnstream
+
+#endif  // MODULES_IPC_SINK_HPP_
@@ -0,0 +1,113 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_IPC_SOURCE_HPP_
+#define MODULES_IPC_SOURCE_HPP_
+
+/**
+ *  @file ipc_source.hpp
+ *
+ *  This file contains a declaration of the IpcSource class.
+ */
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_source.hpp"
+#include "ipc_frame_channel.hpp"
+
+namespace cnstream {
+
+/**
+ * @class IpcSource
+ *
+ * @brief IpcSource receives the frames passed by IpcSink in another process.
+ *
+ * The planes of the frames are used in place in the shared memory, the buffer is given back to the sender when the
+ * frame is released. The streams are added when their first frames are received, and they end with the eos passed
+ * by the sender. The streams ended should be removed by the application as the streams of DataSource.
+ *
+ * If the sender process exits, all streams end and IpcSource waits for the channel to be created again.
+ */
+class IpcSource : public SourceModule, public ModuleCreator<IpcSource> {
+ public:
+  /**
+   * @brief Constructs an IpcSource object.
+   *
+   * @param[in] name The name of this module.
+   *
+   * @return No return value.
+   */
+  explicit IpcSource(const std::string &name);
+
+  /**
+   * @brief Destructs an IpcSource object.
+   *
+   * @return No return value.
+   */
+  ~IpcSource();
+
+  /**
+   * @brief Starts receiving frames.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Stops receiving frames and removes all streams.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+
+  /**
+   * @brief Checks the parameters of this module.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool CheckParamSet(const ModuleParamSet &paramSet) const override;
+
+ private:
+  class StreamHandler;
+
+  void Loop();
+  void OnFrame(const IpcFrameDesc &desc, uint8_t *buffer);
+  void EndStream(const std::string &stream_id);
+  std::shared_ptr<StreamHandler> GetStream(const std::string &stream_id);
+
+  std::string channel_name_;
+  int device_id_ = -1;
+  std::shared_ptr<IpcFrameChannel> channel_;
+  std::map<std::string, std::shared_ptr<StreamHandler>> streams_;  // the streams not ended, used by the loop only
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};  // class IpcSource
+
+}  // namespace cnstream
+
+#endif  // MODULES_IPC_SOURCE_HPP_
@@ -0,0 +1,127 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_IPC_WORKER_HPP_
+#define MODULES_IPC_WORKER_HPP_
+
+/**
+ *  @file ipc_worker.hpp
+ *
+ *  This file contains a declaration of the IpcWorker class.
+ */
+#include <memory>
+#include <string>
+
+#include "cnstream_frame_va.hpp"
+#include "ipc_frame_channel.hpp"
+
+namespace cnstream {
+
+/**
+ * @class IpcWorker
+ *
+ * @brief IpcWorker is used in a worker process started by the IpcWorkers module. It receives the frames of the
+ * pipeline and sends back their inference objects.
+ *
+ * The planes of a frame are used in place in the shared memory, and the inference objects of the frame are decoded
+ * into its CNInferObjs. A worker runs e.g. a python interpreter of its own, so that python code is not limited to one
+ * core by the GIL of the pipeline process. See python/samples/ipc_module_worker.py.
+ *
+ * @verbatim
+ * while (worker.IsHostAlive()) {
+ *   CNFrameInfoPtr data = worker.Receive(100);
+ *   if (!data) continue;
+ *   // reads the planes and modifies the inference objects
+ *   worker.Reply(data);
+ * }
+ * @endverbatim
+ *
+ * The frames are received in the order they are sent, and each one must be replied in the same order.
+ */
+class IpcWorker {
+ public:
+  static constexpr const char *kInputEnv = "CNSTREAM_IPC_WORKER_INPUT";    ///< The name of the input channel.
+  static constexpr const char *kOutputEnv = "CNSTREAM_IPC_WORKER_OUTPUT";  ///< The name of the output channel.
+  static constexpr uint32_t kOutputBuffers = 8;                            ///< The buffers of the output channel.
+  static constexpr size_t kOutputBufferSize = 1 << 20;                     ///< The size of an output buffer.
+
+  IpcWorker() = default;
+  ~IpcWorker();
+  IpcWorker(const IpcWorker &) = delete;
+  IpcWorker &operator=(const IpcWorker &) = delete;
+
+  /**
+   * @brief Opens the channels to the host.
+   *
+   * @param[in] input The name of the channel the frames are received from.
+   * @param[in] output The name of the channel the inference objects are sent to, it is created by the worker.
+   *
+   * @return Returns false if the channels fail to be opened.
+   */
+  bool Open(const std::string &input, const std::string &output);
+
+  /**
+   * @brief Opens the channels named by the environment variables set by IpcWorkers.
+   *
+   * @return Returns false if the environment variables are not set or the channels fail to be opened.
+   */
+  bool Open();
+
+  /**
+   * @brief Closes the channels.
+   *
+   * @return No return value.
+   */
+  void Close();
+
+  /**
+   * @brief Receives a frame.
+   *
+   * @param[in] timeout_ms The max time to wait for a frame in milliseconds.
+   *
+   * @return Returns the frame, nullptr if no frame is received before the timeout.
+   */
+  CNFrameInfoPtr Receive(int timeout_ms);
+
+  /**
+   * @brief Sends the inference objects of a frame back to the host.
+   *
+   * @param[in] data The frame received.
+   *
+   * @return Returns false if the host is gone.
+   */
+  bool Reply(const CNFrameInfoPtr &data);
+
+  /**
+   * @brief Checks whether the host process is alive.
+   *
+   * @return Returns true if the host is alive.
+   */
+  bool IsHostAlive() const;
+
+ private:
+  std::shared_ptr<IpcFrameChannel> input_;
+  IpcFrameChannel output_;
+  std::string message_;  // reused by Reply
+};  // class IpcWorker
+
+}  // namespace cnstream
+
+#endif  // MODULES_IPC_WORKER_HPP_
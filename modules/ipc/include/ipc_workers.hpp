@@ -0,0 +1,129 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_IPC_WORKERS_HPP_
+#define MODULES_IPC_WORKERS_HPP_
+
+/**
+ *  @file ipc_workers.hpp
+ *
+ *  This file contains a declaration of the IpcWorkers class.
+ */
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_module.hpp"
+#include "ipc_frame_channel.hpp"
+
+namespace cnstream {
+
+/**
+ * @class IpcWorkers
+ *
+ * @brief IpcWorkers processes the frames in worker processes, e.g. python modules which would be limited to one core
+ * by the GIL in the pipeline process.
+ *
+ * Every worker is started by the command set by ``command``, it receives the frames and sends back the inference
+ * objects by IpcWorker, see python/samples/ipc_module_worker.py. The frames of a stream are always processed by the
+ * same worker, and are transmitted in order once their objects come back:
+ *
+ * @verbatim
+ * Process -> input channel (planes and objects) -> worker -> output channel (objects) -> TransmitData
+ * @endverbatim
+ *
+ * The inference objects of a frame are replaced by the ones sent back, only the fields encoded by InferObjsCodec are
+ * kept. A worker which exits is started again, the frames it has not replied are transmitted unchanged.
+ */
+class IpcWorkers : public Module, public ModuleCreator<IpcWorkers> {
+ public:
+  /**
+   * @brief Constructs an IpcWorkers object.
+   *
+   * @param[in] name The name of this module.
+   *
+   * @return No return value.
+   */
+  explicit IpcWorkers(const std::string &name);
+
+  /**
+   * @brief Destructs an IpcWorkers object.
+   *
+   * @return No return value.
+   */
+  ~IpcWorkers();
+
+  /**
+   * @brief Starts the workers.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the workers are started.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Stops the workers.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+
+  /**
+   * @brief Passes a frame to the worker of its stream.
+   *
+   * @param[in] data The frame.
+   *
+   * @return Returns 0, the frame is transmitted by this module.
+   */
+  int Process(std::shared_ptr<CNFrameInfo> data) override;
+
+  /**
+   * @brief Checks the parameters of this module.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool CheckParamSet(const ModuleParamSet &paramSet) const override;
+
+ private:
+  struct Worker;
+
+  bool Spawn(Worker *worker);
+  void Stop(Worker *worker);
+  bool Send(Worker *worker, const CNFrameInfoPtr &data);
+  bool WaitReply(Worker *worker, const CNFrameInfoPtr &data);
+  void Restart(Worker *worker);
+  void Loop(Worker *worker);
+
+  std::string command_;
+  uint32_t buffer_count_ = 0;
+  size_t buffer_size_ = 0;
+  uint32_t queue_size_ = 0;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<bool> running_{false};
+};  // class IpcWorkers
+
+}  // namespace cnstream
+
+#endif  // MODULES_IPC_WORKERS_HPP_
@@ -0,0 +1,99 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "ipc_frame.hpp"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace cnstream {
+
+bool DescribeIpcFrame(const CNFrameInfoPtr &data, IpcFrameDesc *desc, uint64_t *bytes) {
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+  memset(desc, 0, sizeof(*desc));
+  if (data->stream_id.size() >= sizeof(desc->stream_id) || frame->GetPlanes() > IpcFrameDesc::kMaxPlanes) {
+    return false;
+  }
+  data->stream_id.copy(desc->stream_id, sizeof(desc->stream_id) - 1);
+  desc->frame_id = frame->frame_id;
+  desc->timestamp = data->timestamp;
+  desc->fmt = static_cast<int32_t>(frame->fmt);
+  desc->width = frame->width;
+  desc->height = frame->height;
+  desc->planes = frame->GetPlanes();
+  uint64_t offset = 0;
+  for (int i = 0; i < desc->planes; ++i) {
+    desc->stride[i] = frame->stride[i];
+    desc->offset[i] = offset;
+    desc->size[i] = frame->GetPlaneBytes(i);
+    offset += (desc->size[i] + 63) & ~static_cast<uint64_t>(63);
+  }
+  *bytes = offset;
+  return true;
+}
+
+void CopyIpcFrame(const CNDataFramePtr &frame, const IpcFrameDesc &desc, uint8_t *buffer) {
+  for (int i = 0; i < desc.planes; ++i) {
+    memcpy(buffer + desc.offset[i], frame->data[i]->GetCpuData(), desc.size[i]);
+  }
+}
+
+CNDataFramePtr WrapIpcFrame(const std::shared_ptr<IpcFrameChannel> &channel, const IpcFrameDesc &desc,
+                            uint8_t *buffer, int device_id) {
+  auto frame = std::make_shared<CNDataFrame>();
+  frame->fmt = static_cast<CNDataFormat>(desc.fmt);
+  frame->width = desc.width;
+  frame->height = desc.height;
+  bool valid = buffer && desc.width > 0 && desc.height > 0 && frame->GetPlanes() == desc.planes;
+  for (int i = 0; valid && i < desc.planes; ++i) {
+    frame->stride[i] = desc.stride[i];
+    valid = desc.stride[i] >= desc.width && desc.size[i] >= frame->GetPlaneBytes(i);
+  }
+  if (!valid) return nullptr;
+  frame->frame_id = desc.frame_id;
+  frame->ctx.dev_type = DevContext::DevType::CPU;
+  frame->ctx.dev_id = -1;
+  frame->ctx.ddr_channel = -1;
+  frame->dst_device_id = device_id;
+  for (int i = 0; i < desc.planes; ++i) {
+    frame->data[i].reset(new (std::nothrow) CNSyncedMemory(desc.size[i], device_id));
+    frame->data[i]->SetCpuData(buffer + desc.offset[i]);
+  }
+  frame->deAllocator_.reset(new IpcBufferRef(channel, desc.buffer));
+  return frame;
+}
+
+bool DecodeIpcObjs(const uint8_t *message, size_t size, const CNFrameInfoPtr &data) {
+  InferObjsCodec::Frame decoded;
+  if (!InferObjsCodec::Decode(message, size, &decoded)) return false;
+  if (!data->collection.HasValue(kCNInferObjsSlot)) {
+    data->collection.Add(kCNInferObjsSlot, std::make_shared<CNInferObjs>());
+  }
+  CNInferObjsPtr objs_holder = data->collection.Get(kCNInferObjsSlot);
+  std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+  objs_holder->objs_ = std::move(decoded.objs);
+  objs_holder->Publish();
+  return true;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,87 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_IPC_FRAME_HPP_
+#define MODULES_IPC_FRAME_HPP_
+
+#include <cstdint>
+#include <memory>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_infer_objs_codec.hpp"
+#include "ipc_frame_channel.hpp"
+#include "private/cnstream_allocator.hpp"
+
+namespace cnstream {
+
+// the inference objects passed between IpcWorkers and IpcWorker are encoded with all the optional parts
+static constexpr uint8_t kIpcObjsFlags = InferObjsCodec::EXTRA_ATTRIBUTES | InferObjsCodec::FEATURES;
+
+// holds the reference of a buffer of the channel until the frame is released
+class IpcBufferRef : public IDataDeallocator {
+ public:
+  IpcBufferRef(std::shared_ptr<IpcFrameChannel> channel, uint32_t index) : channel_(channel), index_(index) {}
+  ~IpcBufferRef() { channel_->ReleaseBuffer(index_); }
+
+ private:
+  std::shared_ptr<IpcFrameChannel> channel_;
+  uint32_t index_;
+};  // class IpcBufferRef
+
+/**
+ * @brief Describes the planes of a frame laid out in a buffer, the buffer index is not set.
+ *
+ * @param[in] data The frame, it must have a CNDataFrame.
+ * @param[out] desc The description.
+ * @param[out] bytes The bytes of the planes, rounded up to 64 bytes each.
+ *
+ * @return Returns false if the stream id is too long or the format has too many planes.
+ */
+bool DescribeIpcFrame(const CNFrameInfoPtr &data, IpcFrameDesc *desc, uint64_t *bytes);
+
+/**
+ * @brief Copies the planes of a frame into a buffer as described by DescribeIpcFrame.
+ */
+void CopyIpcFrame(const CNDataFramePtr &frame, const IpcFrameDesc &desc, uint8_t *buffer);
+
+/**
+ * @brief Wraps the planes received from a channel into a frame in place. The frame holds the reference of the
+ *        buffer.
+ *
+ * @param[in] channel The channel the frame is received from.
+ * @param[in] desc The description.
+ * @param[in] buffer The buffer holding the planes.
+ * @param[in] device_id The MLU device the planes are copied to when they are used on MLU, -1 for CPU only.
+ *
+ * @return Returns the frame, nullptr if the description is invalid. The buffer is not released then.
+ */
+CNDataFramePtr WrapIpcFrame(const std::shared_ptr<IpcFrameChannel> &channel, const IpcFrameDesc &desc,
+                            uint8_t *buffer, int device_id);
+
+/**
+ * @brief Replaces the inference objects of a frame by the ones decoded from an InferObjsCodec message.
+ *
+ * @return Returns false if the message is invalid, the objects are not changed then.
+ */
+bool DecodeIpcObjs(const uint8_t *message, size_t size, const CNFrameInfoPtr &data);
+
+}  // namespace cnstream
+
+#endif  // MODULES_IPC_FRAME_HPP_
@@ -0,0 +1,309 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "ipc_frame_channel.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+constexpr int IpcFrameDesc::kMaxPlanes;
+constexpr uint32_t IpcFrameDesc::kNoBuffer;
+constexpr uint32_t IpcFrameChannel::kMagic;
+constexpr uint32_t IpcFrameChannel::kVersion;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "the channel needs lock-free atomics to be shared by processes");
+
+struct IpcChannelHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t buffer_count;
+  uint32_t queue_size;
+  uint64_t buffer_size;
+  std::atomic<int32_t> producer_pid;
+  std::atomic<int32_t> consumer_pid;
+  std::atomic<uint64_t> head;
+  std::atomic<uint64_t> tail;
+  char padding[16];
+};  // struct IpcChannelHeader
+
+struct IpcBufferState {
+  std::atomic<uint64_t> state;
+};  // struct IpcBufferState
+
+static_assert(sizeof(IpcChannelHeader) == 64, "the layout of the header is shared by processes");
+static_assert(sizeof(IpcBufferState) == 8, "the layout of the buffer state is shared by processes");
+
+static constexpr size_t kPageSize = 4096;
+
+static std::string ShmPath(const std::string& name) { return name.empty() || name[0] != '/' ? "/" + name : name; }
+
+static size_t RoundUpToPage(size_t size) { return (size + kPageSize - 1) & ~(kPageSize - 1); }
+
+static size_t BuffersOffset(uint32_t buffer_count, uint32_t queue_size) {
+  return RoundUpToPage(sizeof(IpcChannelHeader) + buffer_count * sizeof(IpcBufferState) +
+                       queue_size * sizeof(IpcFrameDesc));
+}
+
+static size_t MappingSize(uint32_t buffer_count, size_t buffer_size, uint32_t queue_size) {
+  return BuffersOffset(buffer_count, queue_size) + buffer_count * RoundUpToPage(buffer_size);
+}
+
+static inline uint64_t MakeState(pid_t holder, uint32_t refcount) {
+  return static_cast<uint64_t>(static_cast<uint32_t>(holder)) << 32 | refcount;
+}
+static inline pid_t StateHolder(uint64_t state) { return static_cast<pid_t>(state >> 32); }
+static inline uint32_t StateRefCount(uint64_t state) { return static_cast<uint32_t>(state); }
+
+static bool ProcessAlive(pid_t pid) { return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM); }
+
+IpcFrameChannel::~IpcFrameChannel() { Close(); }
+
+bool IpcFrameChannel::Map(int fd, size_t size) {
+  void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) return false;
+  base_ = base;
+  size_ = size;
+  header_ = static_cast<IpcChannelHeader*>(base);
+  states_ = reinterpret_cast<IpcBufferState*>(header_ + 1);
+  return true;
+}
+
+bool IpcFrameChannel::Create(const std::string& name, uint32_t buffer_count, size_t buffer_size,
+                             uint32_t queue_size) {
+  Close();
+  if (buffer_count == 0 || buffer_size == 0 || queue_size == 0) {
+    LOGE(IPC) << "IpcFrameChannel::Create() buffer count, buffer size and queue size should be positive";
+    return false;
+  }
+  std::string path = ShmPath(name);
+  shm_unlink(path.c_str());
+  int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    LOGE(IPC) << "IpcFrameChannel::Create() shm_open " << path << " failed, " << strerror(errno);
+    return false;
+  }
+  size_t size = MappingSize(buffer_count, buffer_size, queue_size);
+  bool mapped = ftruncate(fd, static_cast<off_t>(size)) == 0 && Map(fd, size);
+  close(fd);
+  if (!mapped) {
+    LOGE(IPC) << "IpcFrameChannel::Create() map " << size << " bytes failed, " << strerror(errno);
+    shm_unlink(path.c_str());
+    return false;
+  }
+  // the memory is zero filled by ftruncate, so that every buffer is free and the queue is empty
+  pid_ = getpid();
+  header_->version = kVersion;
+  header_->buffer_count = buffer_count;
+  header_->queue_size = queue_size;
+  header_->buffer_size = buffer_size;
+  header_->producer_pid.store(pid_, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->magic = kMagic;
+  queue_ = reinterpret_cast<IpcFrameDesc*>(states_ + buffer_count);
+  buffers_ = static_cast<uint8_t*>(base_) + BuffersOffset(buffer_count, queue_size);
+  name_ = path;
+  producer_ = true;
+  next_buffer_ = 0;
+  return true;
+}
+
+bool IpcFrameChannel::Attach(const std::string& name) {
+  Close();
+  std::string path = ShmPath(name);
+  int fd = shm_open(path.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    // the consumer usually waits for the producer to create the channel
+    if (errno != ENOENT) LOGE(IPC) << "IpcFrameChannel::Attach() shm_open " << path << " failed, " << strerror(errno);
+    return false;
+  }
+  struct stat st;
+  bool mapped = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(IpcChannelHeader) &&
+                Map(fd, st.st_size);
+  close(fd);
+  if (!mapped) {
+    LOGE(IPC) << "IpcFrameChannel::Attach() map " << path << " failed";
+    return false;
+  }
+  bool valid = header_->magic == kMagic;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  valid = valid && header_->version == kVersion && header_->buffer_count && header_->queue_size &&
+          header_->buffer_size &&
+          size_ >= MappingSize(header_->buffer_count, header_->buffer_size, header_->queue_size);
+  if (!valid) {
+    LOGE(IPC) << "IpcFrameChannel::Attach() " << path << " is not a channel of version " << kVersion;
+    munmap(base_, size_);
+    base_ = nullptr;
+    header_ = nullptr;
+    return false;
+  }
+  pid_ = getpid();
+  int32_t consumer = header_->consumer_pid.load(std::memory_order_acquire);
+  do {
+    if (consumer != 0 && consumer != pid_ && ProcessAlive(consumer)) {
+      LOGE(IPC) << "IpcFrameChannel::Attach() " << path << " is consumed by process " << consumer;
+      munmap(base_, size_);
+      base_ = nullptr;
+      header_ = nullptr;
+      return false;
+    }
+  } while (!header_->consumer_pid.compare_exchange_weak(consumer, pid_, std::memory_order_acq_rel));
+  queue_ = reinterpret_cast<IpcFrameDesc*>(states_ + header_->buffer_count);
+  buffers_ = static_cast<uint8_t*>(base_) + BuffersOffset(header_->buffer_count, header_->queue_size);
+  name_ = path;
+  producer_ = false;
+  return true;
+}
+
+void IpcFrameChannel::Close() {
+  if (!base_) return;
+  if (producer_) {
+    header_->producer_pid.store(0, std::memory_order_release);
+    shm_unlink(name_.c_str());
+  } else {
+    int32_t self = pid_;
+    header_->consumer_pid.compare_exchange_strong(self, 0, std::memory_order_acq_rel);
+  }
+  munmap(base_, size_);
+  base_ = nullptr;
+  size_ = 0;
+  header_ = nullptr;
+  states_ = nullptr;
+  queue_ = nullptr;
+  buffers_ = nullptr;
+  producer_ = false;
+  name_.clear();
+}
+
+uint8_t* IpcFrameChannel::AcquireBuffer(uint32_t* index) {
+  if (!header_ || !producer_ || !index) return nullptr;
+  const uint32_t count = header_->buffer_count;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (uint32_t i = 0; i < count; ++i) {
+      uint32_t idx = next_buffer_.fetch_add(1, std::memory_order_relaxed) % count;
+      uint64_t expected = 0;
+      if (states_[idx].state.compare_exchange_strong(expected, MakeState(pid_, 1), std::memory_order_acq_rel)) {
+        *index = idx;
+        return buffers_ + idx * RoundUpToPage(header_->buffer_size);
+      }
+    }
+    if (pass == 0) Reclaim();
+  }
+  return nullptr;
+}
+
+void IpcFrameChannel::Reclaim() {
+  for (uint32_t i = 0; i < header_->buffer_count; ++i) {
+    uint64_t state = states_[i].state.load(std::memory_order_acquire);
+    pid_t holder = StateHolder(state);
+    if (StateRefCount(state) == 0 || holder == pid_ || ProcessAlive(holder)) continue;
+    // the state is changed only if the holder is still the dead process
+    if (states_[i].state.compare_exchange_strong(state, 0, std::memory_order_acq_rel)) {
+      LOGW(IPC) << "IpcFrameChannel buffer " << i << " held by dead process " << holder << " is taken back";
+    }
+  }
+}
+
+bool IpcFrameChannel::Publish(const IpcFrameDesc& desc) {
+  if (!header_ || !producer_) return false;
+  uint64_t head = header_->head.load(std::memory_order_relaxed);
+  uint64_t tail = header_->tail.load(std::memory_order_acquire);
+  if (head - tail >= header_->queue_size) {
+    if (desc.buffer != IpcFrameDesc::kNoBuffer) ReleaseBuffer(desc.buffer);
+    return false;
+  }
+  queue_[head % header_->queue_size] = desc;
+  header_->head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+bool IpcFrameChannel::Receive(IpcFrameDesc* desc, uint8_t** buffer) {
+  if (!header_ || producer_ || !desc || !buffer) return false;
+  while (true) {
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (tail == head) return false;
+    *desc = queue_[tail % header_->queue_size];
+    bool has_buffer = desc->buffer < header_->buffer_count;
+    bool valid = (has_buffer || desc->buffer == IpcFrameDesc::kNoBuffer) && desc->planes >= 0 &&
+                 desc->planes <= IpcFrameDesc::kMaxPlanes;
+    for (int i = 0; valid && i < desc->planes; ++i) {
+      valid = has_buffer && desc->offset[i] <= header_->buffer_size &&
+              desc->size[i] <= header_->buffer_size - desc->offset[i];
+    }
+    valid = valid && (desc->extra_size == 0 || (has_buffer && desc->extra_offset <= header_->buffer_size &&
+                                                desc->extra_size <= header_->buffer_size - desc->extra_offset));
+    // the reference is taken over before the description leaves the queue, so that it is never lost when this
+    // process crashes in between
+    if (has_buffer) {
+      uint64_t state = states_[desc->buffer].state.load(std::memory_order_acquire);
+      while (StateRefCount(state) &&
+             !states_[desc->buffer].state.compare_exchange_weak(state, MakeState(pid_, StateRefCount(state)),
+                                                                std::memory_order_acq_rel)) {
+      }
+    }
+    header_->tail.store(tail + 1, std::memory_order_release);
+    if (valid) {
+      desc->stream_id[sizeof(desc->stream_id) - 1] = '\0';
+      *buffer = has_buffer ? buffers_ + desc->buffer * RoundUpToPage(header_->buffer_size) : nullptr;
+      return true;
+    }
+    LOGW(IPC) << "IpcFrameChannel::Receive() invalid frame description is dropped";
+    if (has_buffer) ReleaseBuffer(desc->buffer);
+  }
+}
+
+void IpcFrameChannel::ReleaseBuffer(uint32_t index) {
+  if (!header_ || index >= header_->buffer_count) return;
+  uint64_t state = states_[index].state.load(std::memory_order_relaxed);
+  while (StateRefCount(state)) {
+    uint32_t refcount = StateRefCount(state) - 1;
+    uint64_t next = refcount ? MakeState(StateHolder(state), refcount) : 0;
+    if (states_[index].state.compare_exchange_weak(state, next, std::memory_order_acq_rel)) return;
+  }
+}
+
+bool IpcFrameChannel::IsPeerAlive() const {
+  if (!header_) return false;
+  pid_t peer = producer_ ? header_->consumer_pid.load(std::memory_order_acquire)
+                         : header_->producer_pid.load(std::memory_order_acquire);
+  return ProcessAlive(peer);
+}
+
+int IpcFrameChannel::RefCount(uint32_t index) const {
+  if (!header_ || index >= header_->buffer_count) return -1;
+  return static_cast<int>(StateRefCount(states_[index].state.load(std::memory_order_acquire)));
+}
+
+size_t IpcFrameChannel::BufferSize() const { return header_ ? header_->buffer_size : 0; }
+
+}  // namespace cnstream
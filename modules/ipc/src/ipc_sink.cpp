@@ -0,0 +1,153 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "ipc_sink.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "cnstream_logging.hpp"
+#include "ipc_frame.hpp"
+
+namespace cnstream {
+
+IpcSink::IpcSink(const std::string &name) : Module(name) {
+  param_register_.SetModuleDesc("IpcSink is a module which passes frames to a pipeline in another process through"
+      " shared memory, the pipeline receives them by IpcSource.");
+  param_register_.Register("channel", "The name of the shared memory, it is created in /dev/shm."
+      " Default is cnstream_frames.");
+  param_register_.Register("buffer_count", "The number of frames kept in the shared memory. Default is 16.");
+  param_register_.Register("buffer_size", "The size of a buffer holding all planes of a frame in MB. Default is 4.");
+  param_register_.Register("queue_size", "The max number of frames passed and not received. Default is 8.");
+}
+
+IpcSink::~IpcSink() { Close(); }
+
+bool IpcSink::Open(ModuleParamSet paramSet) {
+  if (!CheckParamSet(paramSet)) return false;
+  auto get = [&paramSet](const std::string &key, const std::string &default_value) {
+    return paramSet.find(key) != paramSet.end() ? paramSet[key] : default_value;
+  };
+  std::string channel = get("channel", "cnstream_frames");
+  uint32_t buffer_count = std::stoul(get("buffer_count", "16"));
+  size_t buffer_size = static_cast<size_t>(std::stoul(get("buffer_size", "4"))) << 20;
+  uint32_t queue_size = std::stoul(get("queue_size", "8"));
+
+  std::lock_guard<std::mutex> lk(publish_mutex_);
+  if (!channel_.Create(channel, buffer_count, buffer_size, queue_size)) {
+    LOGE(IPC) << "[" << GetName() << "] Create channel [" << channel << "] failed";
+    return false;
+  }
+  dropped_ = 0;
+  LOGI(IPC) << "[" << GetName() << "] Pass frames through /dev/shm/" << channel << ", " << buffer_count
+            << " buffers of " << (buffer_size >> 20) << " MB";
+  return true;
+}
+
+void IpcSink::Close() {
+  std::lock_guard<std::mutex> lk(publish_mutex_);
+  if (channel_.IsOpened() && dropped_.load()) {
+    LOGI(IPC) << "[" << GetName() << "] " << dropped_.load() << " frames are dropped";
+  }
+  channel_.Close();
+}
+
+void IpcSink::Drop(const std::string &stream_id, const char *reason) {
+  uint64_t dropped = ++dropped_;
+  if (dropped == 1 || dropped % 100 == 0) {
+    LOGW(IPC) << "[" << GetName() << "] Frame of stream [" << stream_id << "] is dropped, " << reason << ". "
+              << dropped << " frames are dropped in total";
+  }
+}
+
+bool IpcSink::Publish(const IpcFrameDesc &desc) {
+  std::lock_guard<std::mutex> lk(publish_mutex_);
+  return channel_.Publish(desc);
+}
+
+int IpcSink::Process(std::shared_ptr<CNFrameInfo> data) {
+  if (!data || data->IsEos() || data->IsRemoved() || !data->collection.HasValue(kCNDataFrameSlot)) return 0;
+  IpcFrameDesc desc;
+  uint64_t bytes = 0;
+  if (!DescribeIpcFrame(data, &desc, &bytes)) {
+    Drop(data->stream_id, "the stream id is too long or the format is not supported");
+    return 0;
+  }
+  if (bytes > channel_.BufferSize()) {
+    Drop(data->stream_id, "the frame is larger than a buffer");
+    return 0;
+  }
+  uint8_t *buffer = channel_.AcquireBuffer(&desc.buffer);
+  if (!buffer) {
+    Drop(data->stream_id, "no buffer is free");
+    return 0;
+  }
+  // the only copy of the pixels, it is the copy to CPU done by the receiver otherwise
+  CopyIpcFrame(data->collection.Get(kCNDataFrameSlot), desc, buffer);
+  if (!Publish(desc)) Drop(data->stream_id, "the receiver falls behind");
+  return 0;
+}
+
+void IpcSink::OnEos(const std::string &stream_id) {
+  IpcFrameDesc desc;
+  memset(&desc, 0, sizeof(desc));
+  if (stream_id.size() >= sizeof(desc.stream_id)) return;
+  stream_id.copy(desc.stream_id, sizeof(desc.stream_id) - 1);
+  desc.buffer = IpcFrameDesc::kNoBuffer;
+  desc.eos = 1;
+  // eos is not dropped as long as the receiver is alive
+  while (!Publish(desc)) {
+    if (!channel_.IsPeerAlive()) {
+      LOGW(IPC) << "[" << GetName() << "] Eos of stream [" << stream_id << "] is dropped, no receiver";
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+bool IpcSink::CheckParamSet(const ModuleParamSet &paramSet) const {
+  bool ret = true;
+  ParametersChecker checker;
+  for (auto &it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOGW(IPC) << "[" << GetName() << "] Unknown param: " << it.first;
+    }
+  }
+  std::string err_msg;
+  if (!checker.IsNum({"buffer_count", "buffer_size", "queue_size"}, paramSet, err_msg, true)) {
+    LOGE(IPC) << "[" << GetName() << "] " << err_msg;
+    return false;
+  }
+  auto positive = [&paramSet](const std::string &key, int max_value) {
+    return paramSet.find(key) == paramSet.end() ||
+           (std::stoi(paramSet.at(key)) > 0 && std::stoi(paramSet.at(key)) <= max_value);
+  };
+  if (!positive("buffer_count", 1 << 10) || !positive("buffer_size", 1 << 10) || !positive("queue_size", 1 << 10)) {
+    LOGE(IPC) << "[" << GetName() << "] [buffer_count], [buffer_size] and [queue_size] should be in [1, 1024]";
+    ret = false;
+  }
+  return ret;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,167 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "ipc_source.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+#include "ipc_frame.hpp"
+
+namespace cnstream {
+
+class IpcSource::StreamHandler : public SourceHandler {
+ public:
+  StreamHandler(IpcSource *module, const std::string &stream_id) : SourceHandler(module, stream_id) {}
+  bool Open() override { return true; }
+  void Close() override {}
+};  // class IpcSource::StreamHandler
+
+IpcSource::IpcSource(const std::string &name) : SourceModule(name) {
+  param_register_.SetModuleDesc("IpcSource is a module which receives frames passed by IpcSink in another process"
+      " through shared memory. The planes of the frames are used in place.");
+  param_register_.Register("channel", "The name of the shared memory created by IpcSink. Default is cnstream_frames.");
+  param_register_.Register("device_id", "The MLU device the frames are copied to when they are used on MLU."
+      " -1 means the frames are used on CPU only. Default is -1.");
+}
+
+IpcSource::~IpcSource() { Close(); }
+
+bool IpcSource::Open(ModuleParamSet paramSet) {
+  if (!CheckParamSet(paramSet)) return false;
+  Close();
+  channel_name_ = paramSet.find("channel") != paramSet.end() ? paramSet["channel"] : "cnstream_frames";
+  device_id_ = paramSet.find("device_id") != paramSet.end() ? std::stoi(paramSet["device_id"]) : -1;
+  running_ = true;
+  thread_ = std::thread(&IpcSource::Loop, this);
+  return true;
+}
+
+void IpcSource::Close() {
+  running_ = false;
+  if (thread_.joinable()) thread_.join();
+  streams_.clear();
+  RemoveSources();
+  // the channel is unmapped when the frames received are released
+  channel_.reset();
+}
+
+void IpcSource::Loop() {
+  while (running_) {
+    if (!channel_) {
+      auto channel = std::make_shared<IpcFrameChannel>();
+      // the channel left by a crashed sender is replaced when it is created again
+      if (!channel->Attach(channel_name_) || !channel->IsPeerAlive()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        continue;
+      }
+      LOGI(IPC) << "[" << GetName() << "] Receive frames from /dev/shm/" << channel_name_;
+      channel_ = channel;
+    }
+    IpcFrameDesc desc;
+    uint8_t *buffer = nullptr;
+    if (channel_->Receive(&desc, &buffer)) {
+      if (desc.eos) {
+        EndStream(desc.stream_id);
+      } else {
+        OnFrame(desc, buffer);
+      }
+      continue;
+    }
+    if (!channel_->IsPeerAlive()) {
+      LOGW(IPC) << "[" << GetName() << "] The sender of /dev/shm/" << channel_name_ << " exits, all streams end";
+      std::vector<std::string> stream_ids;
+      for (auto &it : streams_) stream_ids.push_back(it.first);
+      for (auto &stream_id : stream_ids) EndStream(stream_id);
+      channel_.reset();
+      continue;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+std::shared_ptr<IpcSource::StreamHandler> IpcSource::GetStream(const std::string &stream_id) {
+  auto it = streams_.find(stream_id);
+  if (it != streams_.end()) return it->second;
+  // the stream ended before and is not removed by the application yet
+  if (GetSourceHandler(stream_id)) RemoveSource(stream_id);
+  auto handler = std::make_shared<StreamHandler>(this, stream_id);
+  if (AddSource(handler) != 0) {
+    LOGE(IPC) << "[" << GetName() << "] Add stream [" << stream_id << "] failed";
+    return nullptr;
+  }
+  LOGI(IPC) << "[" << GetName() << "] Stream [" << stream_id << "] starts";
+  streams_[stream_id] = handler;
+  return handler;
+}
+
+void IpcSource::EndStream(const std::string &stream_id) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) return;
+  auto data = it->second->CreateFrameInfo(true);
+  if (data) it->second->SendData(data);
+  streams_.erase(it);
+}
+
+void IpcSource::OnFrame(const IpcFrameDesc &desc, uint8_t *buffer) {
+  // the buffer is released with the frame from now on
+  CNDataFramePtr frame = WrapIpcFrame(channel_, desc, buffer, device_id_);
+  if (!frame) {
+    LOGW(IPC) << "[" << GetName() << "] Frame of stream [" << desc.stream_id << "] is invalid";
+    channel_->ReleaseBuffer(desc.buffer);
+    return;
+  }
+  std::shared_ptr<StreamHandler> handler = GetStream(desc.stream_id);
+  if (!handler) return;
+  std::shared_ptr<CNFrameInfo> data = handler->CreateFrameInfo();
+  while (!data) {
+    if (!running_) return;
+    handler->WaitForFrame(100);
+    data = handler->CreateFrameInfo();
+  }
+  data->timestamp = desc.timestamp;
+  data->collection.Add(kCNDataFrameSlot, frame);
+  handler->SendData(data);
+}
+
+bool IpcSource::CheckParamSet(const ModuleParamSet &paramSet) const {
+  ParametersChecker checker;
+  for (auto &it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOGW(IPC) << "[" << GetName() << "] Unknown param: " << it.first;
+    }
+  }
+  std::string err_msg;
+  if (!checker.IsNum({"device_id"}, paramSet, err_msg)) {
+    LOGE(IPC) << "[" << GetName() << "] " << err_msg;
+    return false;
+  }
+  if (paramSet.find("device_id") != paramSet.end() && std::stoi(paramSet.at("device_id")) < -1) {
+    LOGE(IPC) << "[" << GetName() << "] [device_id] should be -1 or a device index";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,135 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "ipc_worker.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "cnstream_logging.hpp"
+#include "ipc_frame.hpp"
+
+namespace cnstream {
+
+constexpr const char *IpcWorker::kInputEnv;
+constexpr const char *IpcWorker::kOutputEnv;
+constexpr uint32_t IpcWorker::kOutputBuffers;
+constexpr size_t IpcWorker::kOutputBufferSize;
+
+IpcWorker::~IpcWorker() { Close(); }
+
+bool IpcWorker::Open(const std::string &input, const std::string &output) {
+  Close();
+  auto channel = std::make_shared<IpcFrameChannel>();
+  if (!channel->Attach(input)) {
+    LOGE(IPC) << "IpcWorker::Open() attach input channel [" << input << "] failed";
+    return false;
+  }
+  if (!output_.Create(output, kOutputBuffers, kOutputBufferSize, kOutputBuffers)) {
+    LOGE(IPC) << "IpcWorker::Open() create output channel [" << output << "] failed";
+    return false;
+  }
+  input_ = channel;
+  return true;
+}
+
+bool IpcWorker::Open() {
+  const char *input = getenv(kInputEnv);
+  const char *output = getenv(kOutputEnv);
+  if (!input || !output) {
+    LOGE(IPC) << "IpcWorker::Open() " << kInputEnv << " and " << kOutputEnv << " should be set by IpcWorkers";
+    return false;
+  }
+  return Open(input, output);
+}
+
+void IpcWorker::Close() {
+  output_.Close();
+  // the channel is unmapped when the frames received are released
+  input_.reset();
+}
+
+bool IpcWorker::IsHostAlive() const { return input_ && input_->IsPeerAlive(); }
+
+CNFrameInfoPtr IpcWorker::Receive(int timeout_ms) {
+  if (!input_) return nullptr;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  IpcFrameDesc desc;
+  uint8_t *buffer = nullptr;
+  while (!input_->Receive(&desc, &buffer)) {
+    if (std::chrono::steady_clock::now() >= deadline || !input_->IsPeerAlive()) return nullptr;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CNFrameInfoPtr data = CNFrameInfo::Create(desc.stream_id);
+  CNDataFramePtr frame = data ? WrapIpcFrame(input_, desc, buffer, -1) : nullptr;
+  if (!frame) {
+    LOGW(IPC) << "IpcWorker::Receive() frame of stream [" << desc.stream_id << "] is invalid";
+    if (buffer) input_->ReleaseBuffer(desc.buffer);
+    // the host still waits for the reply of the frame, the objects are kept
+    desc.buffer = IpcFrameDesc::kNoBuffer;
+    desc.planes = 0;
+    desc.extra_size = 0;
+    while (!output_.Publish(desc) && input_->IsPeerAlive()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return nullptr;
+  }
+  data->timestamp = desc.timestamp;
+  data->collection.Add(kCNDataFrameSlot, frame);
+  data->collection.Add(kCNInferObjsSlot, std::make_shared<CNInferObjs>());
+  if (desc.extra_size && !DecodeIpcObjs(buffer + desc.extra_offset, desc.extra_size, data)) {
+    LOGW(IPC) << "IpcWorker::Receive() objects of stream [" << desc.stream_id << "] are invalid";
+  }
+  return data;
+}
+
+bool IpcWorker::Reply(const CNFrameInfoPtr &data) {
+  if (!input_ || !data || !data->collection.HasValue(kCNDataFrameSlot)) return false;
+  IpcFrameDesc desc;
+  memset(&desc, 0, sizeof(desc));
+  data->stream_id.copy(desc.stream_id, sizeof(desc.stream_id) - 1);
+  desc.frame_id = data->collection.Get(kCNDataFrameSlot)->frame_id;
+  desc.timestamp = data->timestamp;
+  message_.clear();
+  InferObjsCodec::Encode(data, kIpcObjsFlags, &message_);
+  if (message_.size() > output_.BufferSize()) {
+    LOGW(IPC) << "IpcWorker::Reply() objects of stream [" << data->stream_id << "] are larger than a buffer, "
+              << "the host keeps the objects sent";
+    message_.clear();
+  }
+  // waits for the host, it receives the replies in order
+  while (input_->IsPeerAlive()) {
+    desc.buffer = IpcFrameDesc::kNoBuffer;
+    desc.extra_size = 0;
+    uint8_t *buffer = message_.empty() ? nullptr : output_.AcquireBuffer(&desc.buffer);
+    if (buffer) {
+      memcpy(buffer, message_.data(), message_.size());
+      desc.extra_size = message_.size();
+    }
+    // the buffer is released if the queue is full
+    if ((message_.empty() || buffer) && output_.Publish(desc)) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,316 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "ipc_workers.hpp"
+
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+#include "ipc_frame.hpp"
+#include "ipc_worker.hpp"
+
+extern char **environ;
+
+namespace cnstream {
+
+struct IpcWorkers::Worker {
+  std::string input_name;
+  std::string output_name;
+  pid_t pid = -1;  // used by the loop only once started
+  std::chrono::steady_clock::time_point spawn_time;
+  std::atomic<bool> alive{false};
+  std::mutex send_mutex;  // guards the input channel and keeps the frames in the order they are sent
+  IpcFrameChannel input;
+  std::string message;     // the objects sent, guarded by send_mutex
+  IpcFrameChannel output;  // used by the loop only
+  std::mutex mutex;        // guards the frames
+  std::condition_variable cond;
+  std::deque<std::pair<CNFrameInfoPtr, bool>> frames;  // the frames not transmitted, and whether they are sent
+  std::thread thread;
+};  // struct IpcWorkers::Worker
+
+IpcWorkers::IpcWorkers(const std::string &name) : Module(name) {
+  hasTransmit_.store(true);
+  param_register_.SetModuleDesc("IpcWorkers is a module which processes frames in worker processes, e.g. python"
+      " modules running on interpreters of their own. The frames are passed through shared memory and the inference"
+      " objects are sent back.");
+  param_register_.Register("command", "The shell command starting a worker, e.g."
+      " \"python3 ipc_module_worker.py my_module.MyModule\". Required.");
+  param_register_.Register("workers", "The number of worker processes, the frames of a stream are processed by the"
+      " same worker. Default is 1.");
+  param_register_.Register("channel", "The prefix of the names of the shared memory, they are created in /dev/shm."
+      " Default is cnstream_workers_<pid>_<module name>.");
+  param_register_.Register("buffer_count", "The number of frames kept in the shared memory of a worker. Default is 8.");
+  param_register_.Register("buffer_size", "The size of a buffer holding a frame and its objects in MB. Default is 4.");
+  param_register_.Register("queue_size", "The max number of frames passed to a worker and not received. Default is 4.");
+}
+
+IpcWorkers::~IpcWorkers() { Close(); }
+
+bool IpcWorkers::Open(ModuleParamSet paramSet) {
+  if (!CheckParamSet(paramSet)) return false;
+  Close();
+  auto get = [&paramSet](const std::string &key, const std::string &default_value) {
+    return paramSet.find(key) != paramSet.end() ? paramSet[key] : default_value;
+  };
+  std::string default_channel = "cnstream_workers_" + std::to_string(getpid()) + "_" + GetName();
+  for (auto &c : default_channel) {
+    if (!isalnum(static_cast<unsigned char>(c))) c = '_';
+  }
+  std::string channel = get("channel", default_channel);
+  int workers = std::stoi(get("workers", "1"));
+  command_ = paramSet["command"];
+  buffer_count_ = std::stoul(get("buffer_count", "8"));
+  buffer_size_ = static_cast<size_t>(std::stoul(get("buffer_size", "4"))) << 20;
+  queue_size_ = std::stoul(get("queue_size", "4"));
+
+  running_ = true;
+  for (int i = 0; i < workers; ++i) {
+    workers_.emplace_back(new Worker);
+    Worker *worker = workers_.back().get();
+    worker->input_name = channel + "_" + std::to_string(i) + "_in";
+    worker->output_name = channel + "_" + std::to_string(i) + "_out";
+    if (!Spawn(worker)) {
+      Close();
+      return false;
+    }
+    worker->thread = std::thread(&IpcWorkers::Loop, this, worker);
+  }
+  return true;
+}
+
+void IpcWorkers::Close() {
+  running_ = false;
+  for (auto &worker : workers_) {
+    { std::lock_guard<std::mutex> lk(worker->mutex); }
+    worker->cond.notify_all();
+    if (worker->thread.joinable()) worker->thread.join();
+    Stop(worker.get());
+  }
+  workers_.clear();
+}
+
+bool IpcWorkers::Spawn(Worker *worker) {
+  worker->spawn_time = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> send_lk(worker->send_mutex);
+  if (!worker->input.Create(worker->input_name, buffer_count_, buffer_size_, queue_size_)) {
+    LOGE(IPC) << "[" << GetName() << "] Create channel [" << worker->input_name << "] failed";
+    return false;
+  }
+  // prepared before fork, only async-signal-safe functions are called by the child
+  std::vector<std::string> vars = {std::string(IpcWorker::kInputEnv) + "=" + worker->input_name,
+                                   std::string(IpcWorker::kOutputEnv) + "=" + worker->output_name};
+  std::vector<char *> envp;
+  for (char **env = environ; env && *env; ++env) {
+    if (strncmp(*env, "CNSTREAM_IPC_WORKER_", strlen("CNSTREAM_IPC_WORKER_"))) envp.push_back(*env);
+  }
+  for (auto &var : vars) envp.push_back(&var[0]);
+  envp.push_back(nullptr);
+  std::string shell_command = "exec " + command_;
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // the worker exits with the pipeline process
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    execle("/bin/sh", "sh", "-c", shell_command.c_str(), static_cast<char *>(nullptr), envp.data());
+    _exit(127);
+  }
+  if (pid < 0) {
+    LOGE(IPC) << "[" << GetName() << "] Start worker failed, " << strerror(errno);
+    worker->input.Close();
+    return false;
+  }
+  worker->pid = pid;
+  worker->alive = true;
+  LOGI(IPC) << "[" << GetName() << "] Worker " << pid << " started, frames are passed through /dev/shm/"
+            << worker->input_name;
+  return true;
+}
+
+void IpcWorkers::Stop(Worker *worker) {
+  worker->alive = false;
+  if (worker->pid > 0) {
+    kill(worker->pid, SIGTERM);
+    // killed if it does not exit in a second
+    for (int i = 0; waitpid(worker->pid, nullptr, WNOHANG) == 0; ++i) {
+      if (i == 100) kill(worker->pid, SIGKILL);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    worker->pid = -1;
+  }
+  std::lock_guard<std::mutex> send_lk(worker->send_mutex);
+  worker->input.Close();
+  // the frames not replied are transmitted unchanged
+  std::lock_guard<std::mutex> lk(worker->mutex);
+  for (auto &it : worker->frames) it.second = false;
+  worker->output.Close();
+}
+
+int IpcWorkers::Process(std::shared_ptr<CNFrameInfo> data) {
+  if (workers_.empty()) return -1;
+  Worker *worker = workers_[std::hash<std::string>()(data->stream_id) % workers_.size()].get();
+  bool to_send = !data->IsEos() && !data->IsRemoved() && data->collection.HasValue(kCNDataFrameSlot);
+  {
+    std::lock_guard<std::mutex> send_lk(worker->send_mutex);
+    bool sent = to_send && Send(worker, data);
+    std::lock_guard<std::mutex> lk(worker->mutex);
+    worker->frames.emplace_back(data, sent);
+  }
+  worker->cond.notify_one();
+  return 0;
+}
+
+bool IpcWorkers::Send(Worker *worker, const CNFrameInfoPtr &data) {
+  IpcFrameDesc desc;
+  uint64_t bytes = 0;
+  worker->message.clear();
+  if (!DescribeIpcFrame(data, &desc, &bytes)) {
+    LOGW_EVERY_T(IPC, 1) << "[" << GetName() << "] Frame of stream [" << data->stream_id << "] is not processed, "
+                         << "the stream id is too long or the format is not supported";
+    return false;
+  }
+  InferObjsCodec::Encode(data, kIpcObjsFlags, &worker->message);
+  desc.extra_offset = bytes;
+  desc.extra_size = worker->message.size();
+  if (bytes + desc.extra_size > buffer_size_) {
+    LOGW_EVERY_T(IPC, 1) << "[" << GetName() << "] Frame of stream [" << data->stream_id << "] is not processed, "
+                         << "it is larger than a buffer";
+    return false;
+  }
+  // waits for the worker, the frames of a stream are not dropped
+  while (running_ && worker->alive) {
+    uint8_t *buffer = worker->input.AcquireBuffer(&desc.buffer);
+    if (buffer) {
+      CopyIpcFrame(data->collection.Get(kCNDataFrameSlot), desc, buffer);
+      memcpy(buffer + desc.extra_offset, worker->message.data(), desc.extra_size);
+      // the buffer is released if the queue is full
+      if (worker->input.Publish(desc)) return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+bool IpcWorkers::WaitReply(Worker *worker, const CNFrameInfoPtr &data) {
+  const uint64_t frame_id = data->collection.Get(kCNDataFrameSlot)->frame_id;
+  while (running_) {
+    // the channel left by an exited worker is replaced when the new one creates it
+    if (!worker->output.IsOpened() && worker->output.Attach(worker->output_name) && !worker->output.IsPeerAlive()) {
+      worker->output.Close();
+    }
+    IpcFrameDesc desc;
+    uint8_t *buffer = nullptr;
+    if (worker->output.IsOpened() && worker->output.Receive(&desc, &buffer)) {
+      bool matched = data->stream_id == desc.stream_id && frame_id == desc.frame_id;
+      // a reply without objects keeps the objects of the frame
+      if (matched && buffer && desc.extra_size &&
+          !DecodeIpcObjs(buffer + desc.extra_offset, desc.extra_size, data)) {
+        LOGW(IPC) << "[" << GetName() << "] Objects of stream [" << data->stream_id << "] are invalid";
+      }
+      if (buffer) worker->output.ReleaseBuffer(desc.buffer);
+      if (matched) return true;
+      LOGW(IPC) << "[" << GetName() << "] Unexpected reply of stream [" << desc.stream_id << "] is dropped";
+      continue;
+    }
+    int status = 0;
+    if (waitpid(worker->pid, &status, WNOHANG) == worker->pid) {
+      LOGE(IPC) << "[" << GetName() << "] Worker " << worker->pid << " exits with status " << status
+                << ", the frames not replied are transmitted unchanged";
+      worker->pid = -1;
+      Stop(worker);
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+void IpcWorkers::Loop(Worker *worker) {
+  while (true) {
+    CNFrameInfoPtr data;
+    bool sent = false;
+    {
+      std::unique_lock<std::mutex> lk(worker->mutex);
+      worker->cond.wait(lk, [&] { return !worker->frames.empty() || !running_; });
+      if (!running_) return;
+      data = worker->frames.front().first;
+      sent = worker->frames.front().second;
+    }
+    // an exited worker is started again, at most once a second
+    if (worker->pid < 0 && std::chrono::steady_clock::now() - worker->spawn_time >= std::chrono::seconds(1)) {
+      Spawn(worker);
+    }
+    if (sent && !WaitReply(worker, data) && !running_) return;
+    {
+      std::lock_guard<std::mutex> lk(worker->mutex);
+      worker->frames.pop_front();
+    }
+    TransmitData(data);
+  }
+}
+
+bool IpcWorkers::CheckParamSet(const ModuleParamSet &paramSet) const {
+  ParametersChecker checker;
+  for (auto &it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOGW(IPC) << "[" << GetName() << "] Unknown param: " << it.first;
+    }
+  }
+  if (paramSet.find("command") == paramSet.end() || paramSet.at("command").empty()) {
+    LOGE(IPC) << "[" << GetName() << "] [command] should be set";
+    return false;
+  }
+  std::string err_msg;
+  if (!checker.IsNum({"workers", "buffer_count", "buffer_size", "queue_size"}, paramSet, err_msg, true)) {
+    LOGE(IPC) << "[" << GetName() << "] " << err_msg;
+    return false;
+  }
+  auto positive = [&paramSet](const std::string &key, int max_value) {
+    return paramSet.find(key) == paramSet.end() ||
+           (std::stoi(paramSet.at(key)) > 0 && std::stoi(paramSet.at(key)) <= max_value);
+  };
+  if (!positive("workers", 64)) {
+    LOGE(IPC) << "[" << GetName() << "] [workers] should be in [1, 64]";
+    return false;
+  }
+  if (!positive("buffer_count", 1 << 10) || !positive("buffer_size", 1 << 10) || !positive("queue_size", 1 << 10)) {
+    LOGE(IPC) << "[" << GetName() << "] [buffer_count], [buffer_size] and [queue_size] should be in [1, 1024]";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace cnstream
@@ -21,10 +21,12 @@
 #ifndef MODULES_KAFKA_HPP_
 #define MODULES_KAFKA_HPP_
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <map>
+#include <thread>
 
 #include "cnstream_module.hpp"
 #include "cnstream_frame_va.hpp"
@@ -32,6 +34,7 @@
 namespace cnstream {
 
 struct KafkaContext;
+class KafkaClient;
 
 using CNFrameInfoPtr = std::shared_ptr<cnstream::CNFrameInfo>;
 
@@ -43,9 +46,12 @@ class Kafka : public cnstream::Module, public cnstream::ModuleCreator<Kafka> {
   bool Open(cnstream::ModuleParamSet paramSet) override;
   void Close() override;
   int Process(CNFrameInfoPtr data) override;
+  bool NeedsPixels() const override { return needs_pixels_; }
 
  private:
   KafkaContext *GetContext(CNFrameInfoPtr data);
+  // consumes the control topic in batches and posts the messages as EVENT_CONTROL events
+  void ControlLoop();
 
   std::mutex mutex_;
   std::map<int, KafkaContext *> contexts_;
@@ -54,6 +60,16 @@ class Kafka : public cnstream::Module, public cnstream::ModuleCreator<Kafka> {
   // the topic_ is prefix of a real topic. eg: if you set topic in json is "cndata",
   // the stream_id 0`s real topic is "cndata_0"
   std::string topic_;
+  std::map<std::string, std::string> producer_properties_;
+  bool async_ = false;
+  size_t max_inflight_bytes_ = 0;
+  std::string spill_dir_;
+  bool needs_pixels_ = true;
+  std::string control_topic_;
+  size_t control_batch_size_ = 64;
+  std::unique_ptr<KafkaClient> control_consumer_;
+  std::thread control_thread_;
+  std::atomic<bool> control_running_{false};
 };  // class Kafka
 
 }  // namespace cnstream
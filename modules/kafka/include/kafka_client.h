@@ -23,9 +23,16 @@
 
 #include <librdkafka/rdkafka.h>
 #include <stdarg.h>
+#include <sys/types.h>
 
+#include <atomic>
+#include <cstdio>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace cnstream {
 
@@ -36,13 +43,40 @@ class KafkaClient {
     CONSUMER,
   };
 
+  struct Options {
+    // librdkafka configuration properties, e.g. "linger.ms", "batch.num.messages", "compression.codec"
+    std::map<std::string, std::string> properties;
+    // delivery reports are served by a background thread, otherwise by Produce
+    bool async = false;
+    // bytes of the messages produced and not delivered yet, 0 means no limit
+    size_t max_inflight_bytes = 0;
+    // messages over the budget are appended to this file and produced later, they are dropped if it is empty
+    std::string spill_file;
+  };
+
+  struct Statistics {
+    uint64_t produced = 0;
+    uint64_t delivered = 0;
+    uint64_t failed = 0;
+    uint64_t dropped = 0;
+    uint64_t spilled = 0;
+    size_t inflight_bytes = 0;
+  };
+
   explicit KafkaClient(TYPE type, const std::string &brokers, const std::string &topic, int32_t partition);
+  KafkaClient(TYPE type, const std::string &brokers, const std::string &topic, int32_t partition,
+              const Options &options);
   ~KafkaClient();
 
   bool Start();
   bool Stop(bool instant = false);
+  // never blocks, returns false if the message is dropped
   bool Produce(const uint8_t *p_payload, size_t length);
   bool Consume(uint8_t **p_payload, size_t *p_length, int timeout_ms = 0);
+  // consumes up to max_count messages with one call, waits at most timeout_ms for the first one.
+  // the messages are appended to messages, returns the number of them
+  size_t ConsumeBatch(std::vector<std::string> *messages, size_t max_count, int timeout_ms);
+  Statistics GetStatistics() const;
 
  private:
   enum class STATE {
@@ -56,6 +90,12 @@ class KafkaClient {
   static void logger(const rd_kafka_t *rk, int level, const char *fac, const char *buf);
   static void msg_delivered(rd_kafka_t *rk, const rd_kafka_message_t *msg, void *opaque);
   bool msg_consume(rd_kafka_message_t *msg, uint8_t **p_payload, size_t *p_len);
+  // returns rd_kafka_resp_err_t
+  int ProduceMessage(const uint8_t *payload, size_t length);
+  bool Spill(const uint8_t *payload, size_t length);
+  // produces the spilled messages while the in-flight budget allows, returns false if some are left
+  bool ReplaySpilled();
+  void PollLoop();
 
   TYPE type_;
   const std::string brokers_;
@@ -68,6 +108,17 @@ class KafkaClient {
   rd_kafka_conf_t *conf_ = nullptr;
   rd_kafka_topic_conf_t *topic_conf_ = nullptr;
   rd_kafka_message_t *message_ = nullptr;
+
+  Options options_;
+  std::thread poll_thread_;
+  std::atomic<bool> polling_{false};
+  std::atomic<size_t> inflight_bytes_{0};
+  std::atomic<uint64_t> produced_{0}, delivered_{0}, failed_{0}, dropped_{0}, spilled_{0};
+  // spilled messages are stored as 4 bytes length and payload, replayed from spill_read_pos_
+  std::mutex spill_mtx_;
+  FILE *spill_ = nullptr;
+  off_t spill_read_pos_ = 0;
+  off_t spill_write_pos_ = 0;
 };
 }  // namespace cnstream
 
@@ -21,8 +21,10 @@
 #ifndef MODULES_KAFKA_INCLUDE_HANDLER_HPP_
 #define MODULES_KAFKA_INCLUDE_HANDLER_HPP_
 
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "cnstream_frame_va.hpp"
 
@@ -40,16 +42,25 @@ class KafkaHandler : virtual public ReflexObjectEx<KafkaHandler> {
   virtual ~KafkaHandler() {}
 
   virtual int UpdateFrame(const CNFrameInfoPtr &data) { return 0; }
+  // whether UpdateFrame reads the pixels of frames, the pixels are released early if no module needs them
+  virtual bool NeedsPixels() const { return true; }
 
   friend class Kafka;
 
  protected:
   bool Produce(const std::string &content);
   bool Consume(std::string *content, int timeout_ms);
+  // consumes up to max_count messages at a time, returns the number of messages appended to contents
+  size_t ConsumeBatch(std::vector<std::string> *contents, size_t max_count, int timeout_ms);
 
  private:
   std::string brokers_;
   std::string topic_;
+  // options of the producer, see KafkaClient::Options
+  std::map<std::string, std::string> producer_properties_;
+  bool async_ = false;
+  size_t max_inflight_bytes_ = 0;
+  std::string spill_file_;
   std::unique_ptr<KafkaClient> producer_ = nullptr;
   std::unique_ptr<KafkaClient> consumer_ = nullptr;
 };  // class KafkaHandler
@@ -25,6 +25,7 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "cnstream_logging.hpp"
@@ -46,6 +47,22 @@ Kafka::Kafka(const std::string &name) : Module(name) {
   param_register_.Register("brokers", "The Brokers list of Kafka. "
       "It is a ,-separated list of brokers in the format: <host1>[:<port1>],<host2>[:<port2>]....");
   param_register_.Register("topic", "Topic is the basic unit of Kafka data writing operation.");
+  param_register_.Register("async", "Whether delivery reports are served by a background thread, so that producing"
+      " never waits for the broker. It should be true or false. Default is false.");
+  param_register_.Register("linger_ms", "Milliseconds to wait for more messages to fill a batch (librdkafka"
+      " linger.ms).");
+  param_register_.Register("batch_size", "Max number of messages in a batch (librdkafka batch.num.messages).");
+  param_register_.Register("compression", "Compression codec of the messages, none, gzip, snappy, lz4 or zstd"
+      " (librdkafka compression.codec).");
+  param_register_.Register("max_inflight_size", "Budget of the messages not delivered yet in KB of each topic."
+      " Messages over the budget are spilled to disk if spill_dir is set, otherwise they are dropped."
+      " 0 means no limit. Default is 0.");
+  param_register_.Register("spill_dir", "Directory of the files to spill messages over the budget to. The messages"
+      " are produced later in order, and the ones left are produced the next time the module is opened.");
+  param_register_.Register("control_topic", "Topic of the control messages, e.g. adding or removing streams. The"
+      " messages are consumed in batches by a thread and posted to the event bus of the pipeline as EVENT_CONTROL"
+      " events. No topic is consumed if it is not set.");
+  param_register_.Register("control_batch_size", "Max number of control messages consumed at a time. Default is 64.");
 }
 
 KafkaContext *Kafka::GetContext(CNFrameInfoPtr data) {
@@ -64,6 +81,10 @@ KafkaContext *Kafka::GetContext(CNFrameInfoPtr data) {
     }
     ctx->handler->brokers_ = brokers_;
     ctx->handler->topic_ = topic;
+    ctx->handler->producer_properties_ = producer_properties_;
+    ctx->handler->async_ = async_;
+    ctx->handler->max_inflight_bytes_ = max_inflight_bytes_;
+    if (!spill_dir_.empty()) ctx->handler->spill_file_ = spill_dir_ + "/" + topic + ".spill";
     contexts_[data->GetStreamIndex()] = ctx;
   }
 
@@ -86,10 +107,94 @@ bool Kafka::Open(cnstream::ModuleParamSet paramSet) {
   } else {
     topic_ = "CnstreamData";
   }
+
+  async_ = false;
+  if (paramSet.find("async") != paramSet.end()) {
+    if (paramSet["async"] != "true" && paramSet["async"] != "false") {
+      LOGE(Kafka) << "[async] should be true or false";
+      return false;
+    }
+    async_ = paramSet["async"] == "true";
+  }
+
+  producer_properties_.clear();
+  static const std::map<std::string, std::string> property_names = {
+      {"linger_ms", "linger.ms"}, {"batch_size", "batch.num.messages"}, {"compression", "compression.codec"}};
+  for (auto &it : property_names) {
+    if (paramSet.find(it.first) != paramSet.end()) producer_properties_[it.second] = paramSet[it.first];
+  }
+
+  max_inflight_bytes_ = 0;
+  if (paramSet.find("max_inflight_size") != paramSet.end()) {
+    size_t pos = 0;
+    int kbytes = -1;
+    try {
+      kbytes = std::stoi(paramSet["max_inflight_size"], &pos);
+    } catch (...) {
+    }
+    if (kbytes < 0 || pos != paramSet["max_inflight_size"].size()) {
+      LOGE(Kafka) << "[max_inflight_size] should be a non-negative integer";
+      return false;
+    }
+    max_inflight_bytes_ = static_cast<size_t>(kbytes) << 10;
+  }
+
+  spill_dir_.clear();
+  if (paramSet.find("spill_dir") != paramSet.end()) spill_dir_ = paramSet["spill_dir"];
+
+  // the handlers are created per stream, a probe tells whether the pixels are read by them
+  std::unique_ptr<KafkaHandler> probe(KafkaHandler::Create(handler_name_));
+  needs_pixels_ = !probe || probe->NeedsPixels();
+
+  control_topic_.clear();
+  if (paramSet.find("control_topic") != paramSet.end()) control_topic_ = paramSet["control_topic"];
+  control_batch_size_ = 64;
+  if (paramSet.find("control_batch_size") != paramSet.end()) {
+    int batch_size = 0;
+    try {
+      batch_size = std::stoi(paramSet["control_batch_size"]);
+    } catch (...) {
+    }
+    if (batch_size <= 0) {
+      LOGE(Kafka) << "[control_batch_size] should be a positive integer";
+      return false;
+    }
+    control_batch_size_ = batch_size;
+  }
+  if (!control_topic_.empty()) {
+    control_consumer_.reset(new KafkaClient(KafkaClient::TYPE::CONSUMER, brokers_, control_topic_, 0));
+    if (!control_consumer_->Start()) {
+      LOGE(Kafka) << "Start consuming control topic " << control_topic_ << " failed";
+      control_consumer_.reset();
+      return false;
+    }
+    control_running_ = true;
+    control_thread_ = std::thread(&Kafka::ControlLoop, this);
+  }
   return true;
 }
 
+void Kafka::ControlLoop() {
+  std::vector<std::string> messages;
+  while (control_running_) {
+    if (messages.empty()) control_consumer_->ConsumeBatch(&messages, control_batch_size_, 100);
+    // the messages are kept until the event bus runs, e.g. they are consumed before the pipeline starts
+    size_t posted = 0;
+    while (posted < messages.size() && PostEvent(EventType::EVENT_CONTROL, messages[posted])) ++posted;
+    messages.erase(messages.begin(), messages.begin() + posted);
+    if (!messages.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
 void Kafka::Close() {
+  if (control_thread_.joinable()) {
+    control_running_ = false;
+    control_thread_.join();
+  }
+  if (control_consumer_) {
+    control_consumer_->Stop();
+    control_consumer_.reset();
+  }
   if (contexts_.empty()) {
     return;
   }
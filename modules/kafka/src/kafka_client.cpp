@@ -21,12 +21,14 @@
 #include <errno.h>
 #include <signal.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "cnstream_logging.hpp"
 
@@ -45,7 +47,11 @@ namespace cnstream {
 #define RDKAFKA_LOG_DEBUG   7
 
 KafkaClient::KafkaClient(TYPE type, const std::string &brokers, const std::string &topic, int32_t partition)
-    : type_(type), brokers_(brokers), topic_(topic), partition_(partition) {
+    : KafkaClient(type, brokers, topic, partition, Options()) {}
+
+KafkaClient::KafkaClient(TYPE type, const std::string &brokers, const std::string &topic, int32_t partition,
+                         const Options &options)
+    : type_(type), brokers_(brokers), topic_(topic), partition_(partition), options_(options) {
   state_ = STATE::IDLE;
   rk_ = nullptr;
   rkt_ = nullptr;
@@ -78,6 +84,15 @@ bool KafkaClient::Start() {
   snprintf(signal, sizeof(signal), "%i", SIGIO);
   rd_kafka_conf_set(conf_, "internal.termination.signal", signal, nullptr, 0);
 
+  for (auto &property : options_.properties) {
+    if (rd_kafka_conf_set(conf_, property.first.c_str(), property.second.c_str(), errstr, sizeof(errstr)) !=
+        RD_KAFKA_CONF_OK) {
+      LOGE(Kafka) << "Failed to set " << property.first << "=" << property.second << ": " << errstr;
+      Stop();
+      return false;
+    }
+  }
+
   /* Topic configuration */
   topic_conf_ = rd_kafka_topic_conf_new();
   if (!topic_conf_) {
@@ -101,6 +116,20 @@ bool KafkaClient::Start() {
      * It will be called once for each message, either on successful
      * delivery to brokers, or upon failure to deliver to brokers */
     rd_kafka_conf_set_dr_msg_cb(conf_, KafkaClient::msg_delivered);
+    rd_kafka_conf_set_opaque(conf_, this);
+
+    if (!options_.spill_file.empty()) {
+      // messages left by the last run are produced first
+      spill_ = fopen(options_.spill_file.c_str(), "a+b");
+      if (!spill_) {
+        LOGE(Kafka) << "Failed to open spill file " << options_.spill_file << ", errno=" << errno;
+        Stop();
+        return false;
+      }
+      fseeko(spill_, 0, SEEK_END);
+      spill_read_pos_ = 0;
+      spill_write_pos_ = ftello(spill_);
+    }
 
     /* Create Kafka producer */
     if (!(rk_ = rd_kafka_new(RD_KAFKA_PRODUCER, conf_, errstr, sizeof(errstr)))) {
@@ -139,6 +168,10 @@ bool KafkaClient::Start() {
     state_ = STATE::CONSUME;
   } else {
     state_ = STATE::PRODUCE;
+    if (options_.async) {
+      polling_ = true;
+      poll_thread_ = std::thread(&KafkaClient::PollLoop, this);
+    }
   }
 
   return true;
@@ -156,29 +189,50 @@ bool KafkaClient::Stop(bool instant) {
       rd_kafka_consume_stop(rkt_, partition_);
     }
   } else {
+    if (poll_thread_.joinable()) {
+      polling_ = false;
+      poll_thread_.join();
+    }
     if (rk_) {
       /* Poll to handle delivery reports */
       rd_kafka_poll(rk_, 0);
       /* Wait for messages to be delivered */
-      while (!instant && rd_kafka_outq_len(rk_) > 0) {
+      while (!instant && (!ReplaySpilled() || rd_kafka_outq_len(rk_) > 0)) {
         rd_kafka_poll(rk_, 100);
       }
     }
+    if (spill_) {
+      bool spill_empty = ReplaySpilled();
+      fclose(spill_);
+      spill_ = nullptr;
+      if (spill_empty) {
+        remove(options_.spill_file.c_str());
+      } else {
+        LOGW(Kafka) << "Spilled messages are left in " << options_.spill_file;
+      }
+    }
+    if (state_ == STATE::PRODUCE) {
+      LOGI(Kafka) << "Producer of topic " << topic_ << " produced: " << produced_ << ", delivered: " << delivered_
+                  << ", failed: " << failed_ << ", spilled: " << spilled_ << ", dropped: " << dropped_;
+    }
   }
 
   /* Destroy topic */
   if (rkt_) {
     rd_kafka_topic_destroy(rkt_);
+    rkt_ = nullptr;
   }
 
   /* Destroy handle */
   if (rk_) {
     rd_kafka_destroy(rk_);
+    rk_ = nullptr;
   }
 
   /* Destroy message */
   if (message_) {
     rd_kafka_message_destroy(message_);
+    message_ = nullptr;
   }
 
   state_ = STATE::IDLE;
@@ -220,23 +274,143 @@ bool KafkaClient::Consume(uint8_t **p_payload, size_t *p_length, int timeout_ms)
   } while (1);
 }
 
+size_t KafkaClient::ConsumeBatch(std::vector<std::string> *messages, size_t max_count, int timeout_ms) {
+  if (state_ != STATE::CONSUME || !messages || !max_count) {
+    return 0;
+  }
+
+  /* Poll for errors, etc. */
+  rd_kafka_poll(rk_, 0);
+
+  std::vector<rd_kafka_message_t *> batch(max_count);
+  ssize_t count = rd_kafka_consume_batch(rkt_, partition_, timeout_ms, batch.data(), max_count);
+  if (count < 0) {
+    LOGE(Kafka) << "Consume batch error for topic:" << topic_ << " " << rd_kafka_err2str(rd_kafka_last_error());
+    return 0;
+  }
+  size_t consumed = 0;
+  for (ssize_t i = 0; i < count; ++i) {
+    rd_kafka_message_t *msg = batch[i];
+    if (!msg->err) {
+      messages->emplace_back(reinterpret_cast<const char *>(msg->payload), msg->len);
+      ++consumed;
+    } else if (msg->err != RD_KAFKA_RESP_ERR__PARTITION_EOF) {
+      // reaching the end of the partition is expected while waiting for new messages
+      LOGE(Kafka) << "Consume error for topic:" << topic_ << " offset:" << msg->offset << " "
+                  << rd_kafka_message_errstr(msg);
+    }
+    rd_kafka_message_destroy(msg);
+  }
+  return consumed;
+}
+
 bool KafkaClient::Produce(const uint8_t *payload, size_t length) {
   if (state_ != STATE::PRODUCE) {
     return false;
   }
 
+  bool ret = false;
+  bool over_budget = options_.max_inflight_bytes && inflight_bytes_ + length > options_.max_inflight_bytes;
+  bool spilled;
+  {
+    std::lock_guard<std::mutex> lk(spill_mtx_);
+    spilled = spill_read_pos_ < spill_write_pos_;
+  }
+  // spilled messages are produced first to keep the order
+  if (over_budget || spilled) {
+    ret = Spill(payload, length);
+  } else {
+    int err = ProduceMessage(payload, length);
+    ret = err == RD_KAFKA_RESP_ERR__QUEUE_FULL ? Spill(payload, length) : err == RD_KAFKA_RESP_ERR_NO_ERROR;
+  }
+
+  if (!options_.async) {
+    /* Poll to handle delivery reports */
+    rd_kafka_poll(rk_, 0);
+    ReplaySpilled();
+  }
+  return ret;
+}
+
+KafkaClient::Statistics KafkaClient::GetStatistics() const {
+  Statistics statistics;
+  statistics.produced = produced_;
+  statistics.delivered = delivered_;
+  statistics.failed = failed_;
+  statistics.dropped = dropped_;
+  statistics.spilled = spilled_;
+  statistics.inflight_bytes = inflight_bytes_;
+  return statistics;
+}
+
+int KafkaClient::ProduceMessage(const uint8_t *payload, size_t length) {
   /* Send/Produce message. */
   if (rd_kafka_produce(rkt_, partition_, RD_KAFKA_MSG_F_COPY, const_cast<uint8_t *>(payload),
                        length, nullptr, 0, nullptr) == -1) {
-    LOGE(Kafka) << "Failed to produce to topic: " << rd_kafka_topic_name(rkt_) << " partition: " << partition_;
-    return false;
+    rd_kafka_resp_err_t err = rd_kafka_last_error();
+    if (err != RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+      LOGE(Kafka) << "Failed to produce to topic: " << rd_kafka_topic_name(rkt_) << " partition: " << partition_
+                  << ", " << rd_kafka_err2str(err);
+    }
+    return err;
   }
+  inflight_bytes_ += length;
+  produced_++;
+  return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
 
-  /* Poll to handle delivery reports */
-  rd_kafka_poll(rk_, 0);
+bool KafkaClient::Spill(const uint8_t *payload, size_t length) {
+  std::lock_guard<std::mutex> lk(spill_mtx_);
+  uint32_t len = length;
+  if (spill_ && fseeko(spill_, spill_write_pos_, SEEK_SET) == 0 && fwrite(&len, sizeof(len), 1, spill_) == 1 &&
+      fwrite(payload, 1, length, spill_) == length) {
+    spill_write_pos_ += sizeof(len) + length;
+    spilled_++;
+    return true;
+  }
+  if (spill_) {
+    LOGE(Kafka) << "Failed to write spill file " << options_.spill_file << ", errno=" << errno;
+    // the message may be written partly, drop it
+    fflush(spill_);
+    if (ftruncate(fileno(spill_), spill_write_pos_) != 0) {
+      LOGE(Kafka) << "Failed to truncate spill file " << options_.spill_file << ", errno=" << errno;
+    }
+  }
+  if (dropped_++ % 100 == 0) {
+    LOGW(Kafka) << "Over the in-flight budget, drop the message to topic " << topic_ << ", dropped: " << dropped_;
+  }
+  return false;
+}
+
+bool KafkaClient::ReplaySpilled() {
+  std::lock_guard<std::mutex> lk(spill_mtx_);
+  if (!spill_) return true;
+  if (!rkt_) return spill_read_pos_ >= spill_write_pos_;
+  std::vector<uint8_t> payload;
+  while (spill_read_pos_ < spill_write_pos_) {
+    uint32_t len = 0;
+    if (fseeko(spill_, spill_read_pos_, SEEK_SET) != 0 || fread(&len, sizeof(len), 1, spill_) != 1) break;
+    if (options_.max_inflight_bytes && inflight_bytes_ + len > options_.max_inflight_bytes) break;
+    payload.resize(len);
+    if (fread(payload.data(), 1, len, spill_) != len) break;
+    if (ProduceMessage(payload.data(), len) == RD_KAFKA_RESP_ERR__QUEUE_FULL) break;
+    spill_read_pos_ += sizeof(len) + len;
+  }
+  if (spill_read_pos_ < spill_write_pos_) return false;
+  if (spill_write_pos_ > 0) {
+    fflush(spill_);
+    if (ftruncate(fileno(spill_), 0) == 0) spill_read_pos_ = spill_write_pos_ = 0;
+  }
   return true;
 }
 
+void KafkaClient::PollLoop() {
+  while (polling_) {
+    rd_kafka_poll(rk_, 100);
+    ReplaySpilled();
+  }
+}
+
 /* Kafka logger callback (optional) */
 void KafkaClient::logger(const rd_kafka_t *rk, int level, const char *fac, const char *buf) {
   LOGD(Kafka) << "logger";
@@ -279,6 +453,15 @@ bool KafkaClient::msg_consume(rd_kafka_message_t *msg, uint8_t **p_payload, size
 
 /* Message delivery report callback using the richer rd_kafka_message_t object. */
 void KafkaClient::msg_delivered(rd_kafka_t *rk, const rd_kafka_message_t *msg, void *opaque) {
+  KafkaClient *client = reinterpret_cast<KafkaClient *>(opaque);
+  if (client) {
+    client->inflight_bytes_ -= msg->len;
+    if (msg->err) {
+      client->failed_++;
+    } else {
+      client->delivered_++;
+    }
+  }
   if (msg->err) {
     LOGE(Kafka) << "%% Message delivery failed: " << rd_kafka_err2str(msg->err);
   }
@@ -19,6 +19,7 @@
  *************************************************************************/
 
 #include <string>
+#include <vector>
 
 #include "kafka_client.h"
 #include "kafka_handler.hpp"
@@ -31,7 +32,12 @@ KafkaHandler *KafkaHandler::Create(const std::string &name) {
 
 bool KafkaHandler::Produce(const std::string &content) {
   if (!producer_) {
-    producer_.reset(new KafkaClient(KafkaClient::TYPE::PRODUCER, brokers_, topic_, 0));
+    KafkaClient::Options options;
+    options.properties = producer_properties_;
+    options.async = async_;
+    options.max_inflight_bytes = max_inflight_bytes_;
+    options.spill_file = spill_file_;
+    producer_.reset(new KafkaClient(KafkaClient::TYPE::PRODUCER, brokers_, topic_, 0, options));
     producer_->Start();
   }
   const uint8_t *payload = reinterpret_cast<const uint8_t *>(content.c_str());
@@ -51,4 +57,12 @@ bool KafkaHandler::Consume(std::string *content, int timeout_ms) {
   return true;
 }
 
+size_t KafkaHandler::ConsumeBatch(std::vector<std::string> *contents, size_t max_count, int timeout_ms) {
+  if (!consumer_) {
+    consumer_.reset(new KafkaClient(KafkaClient::TYPE::CONSUMER, brokers_, topic_, 0));
+    consumer_->Start();
+  }
+  return consumer_->ConsumeBatch(contents, max_count, timeout_ms);
+}
+
 }  // namespace cnstream
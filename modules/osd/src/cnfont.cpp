@@ -26,7 +26,9 @@
 #include "opencv2/imgcodecs/imgcodecs.hpp"
 #endif
 
+#include <algorithm>
 #include <string>
+#include <utility>
 
 #include "cnstream_logging.hpp"
 
@@ -81,6 +83,9 @@ void CnFont::restoreFont(float font_pixel, float space, float step) {
 
   // Set character size
   FT_Set_Pixel_Sizes(m_face, static_cast<int>(m_fontSize.val[0]), 0);
+
+  // The cached bitmaps are rasterized with the old settings
+  ClearCache();
 }
 
 uint32_t CnFont::GetFontPixel() {
@@ -91,9 +96,22 @@ uint32_t CnFont::GetFontPixel() {
   return m_fontSize.val[0];
 }
 
-int CnFont::ToWchar(char*& src, wchar_t*& dest, const char* locale) {
+void CnFont::ClearCache() {
+  glyphs_.clear();
+  labels_.clear();
+  label_index_.clear();
+}
+
+void CnFont::TakeCacheStats(uint64_t* hits, uint64_t* lookups) {
+  *hits = cache_hits_;
+  *lookups = cache_lookups_;
+  cache_hits_ = 0;
+  cache_lookups_ = 0;
+}
+
+int CnFont::ToWchar(const char* src, std::wstring* dest, const char* locale) {
+  dest->clear();
   if (src == NULL) {
-    dest = NULL;
     return 0;
   }
 
@@ -101,23 +119,88 @@ int CnFont::ToWchar(char*& src, wchar_t*& dest, const char* locale) {
   setlocale(LC_CTYPE, locale);
 
   // Gets the required wide character size to convert to
-  int w_size = mbstowcs(NULL, src, 0) + 1;
-
-  if (w_size == 0) {
-    dest = NULL;
+  size_t w_size = mbstowcs(NULL, src, 0);
+  if (w_size == static_cast<size_t>(-1)) {
     return -1;
   }
 
-  dest = new (std::nothrow) wchar_t[w_size];
-  if (!dest) {
+  dest->resize(w_size + 1);
+  if (mbstowcs(&(*dest)[0], src, w_size + 1) == static_cast<size_t>(-1)) {
+    dest->clear();
     return -1;
   }
+  dest->resize(w_size);
+  return 0;
+}
 
-  int ret = mbstowcs(dest, src, strlen(src) + 1);
-  if (ret <= 0) {
-    return -1;
+const CnFont::Glyph& CnFont::GetGlyph(wchar_t wc) {
+  auto it = glyphs_.find(wc);
+  if (it != glyphs_.end()) return it->second;
+
+  // Generate a binary bitmap of a font based on unicode
+  FT_UInt glyph_index = FT_Get_Char_Index(m_face, wc);
+  FT_Load_Glyph(m_face, glyph_index, FT_LOAD_DEFAULT);
+  FT_Render_Glyph(m_face->glyph, FT_RENDER_MODE_MONO);
+
+  FT_GlyphSlot slot = m_face->glyph;
+  Glyph& glyph = glyphs_[wc];
+  glyph.rows = slot->bitmap.rows;
+  glyph.cols = slot->bitmap.width;
+  glyph.mask.resize(glyph.rows * glyph.cols);
+  for (int i = 0; i < glyph.rows; ++i) {
+    for (int j = 0; j < glyph.cols; ++j) {
+      int off = i * slot->bitmap.pitch + j / 8;
+      glyph.mask[i * glyph.cols + j] = (slot->bitmap.buffer[off] & (0xC0 >> (j % 8))) ? 1 : 0;
+    }
   }
-  return 0;
+  // The output position of the next word
+  double space = m_fontSize.val[0] * m_fontSize.val[1];
+  double sep = m_fontSize.val[0] * m_fontSize.val[2];
+  glyph.advance = static_cast<int>((glyph.cols ? glyph.cols : space) + sep);
+  return glyph;
+}
+
+const CnFont::Label* CnFont::GetLabel(const std::string& text) {
+  ++cache_lookups_;
+  auto it = label_index_.find(text);
+  if (it != label_index_.end()) {
+    ++cache_hits_;
+    labels_.splice(labels_.begin(), labels_, it->second);
+    return &it->second->second;
+  }
+
+  std::wstring w_str;
+  if (ToWchar(text.c_str(), &w_str) == -1) {
+    return nullptr;
+  }
+
+  Label label;
+  for (wchar_t wc : w_str) {
+    const Glyph& glyph = GetGlyph(wc);
+    label.rows = std::max(label.rows, glyph.rows);
+    label.cols += glyph.advance;
+  }
+  label.mask.assign(label.rows * label.cols, 0);
+  // Glyphs are aligned at the bottom row
+  int x = 0;
+  for (wchar_t wc : w_str) {
+    const Glyph& glyph = GetGlyph(wc);
+    int top = label.rows - glyph.rows;
+    for (int i = 0; i < glyph.rows; ++i) {
+      for (int j = 0; j < glyph.cols && x + j < label.cols; ++j) {
+        label.mask[(top + i) * label.cols + x + j] |= glyph.mask[i * glyph.cols + j];
+      }
+    }
+    x += glyph.advance;
+  }
+
+  if (labels_.size() >= kMaxCachedLabels) {
+    label_index_.erase(labels_.back().first);
+    labels_.pop_back();
+  }
+  labels_.emplace_front(text, std::move(label));
+  label_index_[text] = labels_.begin();
+  return &labels_.front().second;
 }
 
 bool CnFont::GetTextSize(char* text, uint32_t* width, uint32_t* height) {
@@ -129,23 +212,22 @@ bool CnFont::GetTextSize(char* text, uint32_t* width, uint32_t* height) {
     LOGE(OSD) << " [CnFont] [GetTextSize] Please init CnFont first.";
     return false;
   }
-  wchar_t* w_str;
-  if (ToWchar(text, w_str) == -1) {
+  std::wstring w_str;
+  if (ToWchar(text, &w_str) == -1) {
     LOGE(OSD) << "[CnFont] [GetTextSize] [ToWchar] failed.";
-    return -1;
+    return false;
   }
 
-  uint32_t w_char_width = 0, w_char_height = 0;
   double space = m_fontSize.val[0] * m_fontSize.val[1];
   double sep = m_fontSize.val[0] * m_fontSize.val[2];
 
-  for (int i = 0; w_str[i] != '\0'; ++i) {
-    GetWCharSize(w_str[i], &w_char_width, &w_char_height);
-    if (*height < w_char_height) {
-      *height = w_char_height;
+  for (wchar_t wc : w_str) {
+    const Glyph& glyph = GetGlyph(wc);
+    if (*height < static_cast<uint32_t>(glyph.rows)) {
+      *height = glyph.rows;
     }
-    if (w_char_width) {
-      *width += w_char_width;
+    if (glyph.cols) {
+      *width += glyph.cols;
     } else {
       *width += space;
     }
@@ -154,23 +236,6 @@ bool CnFont::GetTextSize(char* text, uint32_t* width, uint32_t* height) {
   return true;
 }
 
-void CnFont::GetWCharSize(wchar_t wc, uint32_t* width, uint32_t* height) {
-  if (!width || !height) {
-    LOGE(OSD) << " [CnFont] [GetWCharSize] The width or height is nullptr.";
-    return;
-  }
-
-  FT_UInt glyph_index = FT_Get_Char_Index(m_face, wc);
-  FT_Load_Glyph(m_face, glyph_index, FT_LOAD_DEFAULT);
-  FT_Render_Glyph(m_face->glyph, FT_RENDER_MODE_MONO);
-
-  FT_GlyphSlot slot = m_face->glyph;
-
-  // height and width
-  *height = slot->bitmap.rows;
-  *width = slot->bitmap.width;
-}
-
 int CnFont::putText(cv::Mat& img, char* text, cv::Point pos, cv::Scalar color) {
   if (img.data == nullptr) {
     LOGE(OSD) << "[CnFont] [putText] img.data is nullptr.";
@@ -179,6 +244,7 @@ int CnFont::putText(cv::Mat& img, char* text, cv::Point pos, cv::Scalar color) {
 
   if (text == nullptr) {
     LOGE(OSD) << "[CnFont] [putText] text is nullptr.";
+    return -1;
   }
 
   if (!is_initialized_) {
@@ -186,60 +252,30 @@ int CnFont::putText(cv::Mat& img, char* text, cv::Point pos, cv::Scalar color) {
     return -1;
   }
 
-  wchar_t* w_str;
-  if (ToWchar(text, w_str) == -1) {
+  const Label* label = GetLabel(text);
+  if (!label) {
     LOGE(OSD) << "[CnFont] [putText] [ToWchar] failed.";
     return -1;
   }
 
-  for (int i = 0; w_str[i] != '\0'; ++i) {
-    putWChar(img, w_str[i], pos, color);
-  }
-
-  return 0;
-}
-
-// Output the current character and update the m pos position
-void CnFont::putWChar(cv::Mat& img, wchar_t wc, cv::Point& pos, cv::Scalar color) {
-  // Generate a binary bitmap of a font based on unicode
-  FT_UInt glyph_index = FT_Get_Char_Index(m_face, wc);
-  FT_Load_Glyph(m_face, glyph_index, FT_LOAD_DEFAULT);
-  FT_Render_Glyph(m_face->glyph, FT_RENDER_MODE_MONO);
-
-  FT_GlyphSlot slot = m_face->glyph;
-
-  // Cols and rows
-  int rows = slot->bitmap.rows;
-  int cols = slot->bitmap.width;
-
-  for (int i = 0; i < rows; ++i) {
-    for (int j = 0; j < cols; ++j) {
-      int off = i * slot->bitmap.pitch + j / 8;
-      if (slot->bitmap.buffer[off] & (0xC0 >> (j % 8))) {
-        int r = pos.y - (rows - 1 - i);
-        int c = pos.x + j;
-
-        if (r >= 0 && r < img.rows && c >= 0 && c < img.cols) {
-          cv::Vec3b pixel = img.at<cv::Vec3b>(cv::Point(c, r));
-          cv::Scalar scalar = cv::Scalar(pixel.val[0], pixel.val[1], pixel.val[2]);
-
-          // Color fusion
-          float p = m_fontDiaphaneity;
-          for (int k = 0; k < 4; ++k) {
-            scalar.val[k] = scalar.val[k] * (1 - p) + color.val[k] * p;
-          }
-          img.at<cv::Vec3b>(cv::Point(c, r))[0] = (unsigned char)(scalar.val[0]);
-          img.at<cv::Vec3b>(cv::Point(c, r))[1] = (unsigned char)(scalar.val[1]);
-          img.at<cv::Vec3b>(cv::Point(c, r))[2] = (unsigned char)(scalar.val[2]);
-        }
+  // The bottom row of the label is drawn at pos.y
+  const int top = pos.y - (label->rows - 1);
+  const int r_begin = std::max(0, -top), r_end = std::min(label->rows, img.rows - top);
+  const int c_begin = std::max(0, -pos.x), c_end = std::min(label->cols, img.cols - pos.x);
+  const float p = m_fontDiaphaneity;
+  for (int i = r_begin; i < r_end; ++i) {
+    const uint8_t* mask = &label->mask[i * label->cols];
+    cv::Vec3b* row = img.ptr<cv::Vec3b>(top + i);
+    for (int j = c_begin; j < c_end; ++j) {
+      if (!mask[j]) continue;
+      // Color fusion
+      cv::Vec3b& pixel = row[pos.x + j];
+      for (int k = 0; k < 3; ++k) {
+        pixel[k] = (unsigned char)(pixel[k] * (1 - p) + color.val[k] * p);
       }
     }
   }
-  // Modify the output position of the next word
-  double space = m_fontSize.val[0] * m_fontSize.val[1];
-  double sep = m_fontSize.val[0] * m_fontSize.val[2];
-
-  pos.x += static_cast<int>((cols ? cols : space) + sep);
+  return 0;
 }
 #endif
 
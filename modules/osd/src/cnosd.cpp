@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "cnfont.hpp"
+#include "private/cnstream_parallel.hpp"
 
 #define CLIP(x) x < 0 ? 0 : (x > 1 ? 1 : x)
 
@@ -104,25 +105,135 @@ CnOsd::CnOsd(const std::vector<std::string>& labels) : labels_(labels) {
   colors_ = GenerateColorsForCategories(labels_.size());
 }
 
-void CnOsd::DrawLogo(cv::Mat image, std::string logo) const {
-  cv::Point logo_pos(5, image.rows - 5);
+void BgrCanvas::Rectangle(const cv::Point& top_left, const cv::Point& bottom_right, const cv::Scalar& color,
+                          int thickness, int row_begin, int row_end) {
+  row_begin = std::max(row_begin, 0);
+  row_end = std::min(row_end, image_.rows);
+  if (row_begin >= row_end) return;
+  // drawn on the band with shifted coordinates, the pixels are the same as those drawn on the whole image
+  cv::Mat band = image_.rowRange(row_begin, row_end);
+  const cv::Point offset(0, row_begin);
+  cv::rectangle(band, top_left - offset, bottom_right - offset, color, thickness < 0 ? CV_FILLED : thickness);
+}
+
+void BgrCanvas::PutMask(const OsdTextMask& mask, const cv::Point& org, const cv::Scalar& color, int row_begin,
+                        int row_end) {
+  const cv::Vec3b pixel(cv::saturate_cast<uint8_t>(color[0]), cv::saturate_cast<uint8_t>(color[1]),
+                        cv::saturate_cast<uint8_t>(color[2]));
+  const int left = org.x - mask.org.x, top = org.y - mask.org.y;
+  const int x0 = std::max(left, 0), x1 = std::min(left + mask.mask.cols, image_.cols);
+  const int y0 = std::max(std::max(top, row_begin), 0);
+  const int y1 = std::min(std::min(top + mask.mask.rows, row_end), image_.rows);
+  for (int y = y0; y < y1; ++y) {
+    const uint8_t* src = mask.mask.ptr<uint8_t>(y - top);
+    cv::Vec3b* dst = image_.ptr<cv::Vec3b>(y);
+    for (int x = x0; x < x1; ++x) {
+      if (src[x - left]) dst[x] = pixel;
+    }
+  }
+}
+
+// BT.601 limited range, the same as the conversion of frames to BGR
+static void BgrToYuv(const cv::Scalar& color, uint8_t yuv[3]) {
+  const double b = color[0], g = color[1], r = color[2];
+  yuv[0] = cv::saturate_cast<uint8_t>(16 + 0.257 * r + 0.504 * g + 0.098 * b);
+  yuv[1] = cv::saturate_cast<uint8_t>(128 - 0.148 * r - 0.291 * g + 0.439 * b);
+  yuv[2] = cv::saturate_cast<uint8_t>(128 + 0.439 * r - 0.368 * g - 0.071 * b);
+}
+
+void YuvCanvas::Fill(int x0, int y0, int x1, int y1, const uint8_t yuv[3], int row_begin, int row_end) {
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, std::max(row_begin, 0));
+  x1 = std::min(x1, width_);
+  y1 = std::min(y1, std::min(row_end, height_));
+  if (x0 >= x1 || y0 >= y1) return;
+  for (int y = y0; y < y1; ++y) memset(y_plane_ + y * y_stride_ + x0, yuv[0], x1 - x0);
+  // the chroma rows belong to the band as its boundaries are even
+  const uint8_t u = nv21_ ? yuv[2] : yuv[1], v = nv21_ ? yuv[1] : yuv[2];
+  for (int y = y0 / 2; y <= (y1 - 1) / 2; ++y) {
+    uint8_t* uv = uv_plane_ + y * uv_stride_;
+    for (int x = x0 / 2; x <= (x1 - 1) / 2; ++x) {
+      uv[2 * x] = u;
+      uv[2 * x + 1] = v;
+    }
+  }
+}
+
+void YuvCanvas::Rectangle(const cv::Point& top_left, const cv::Point& bottom_right, const cv::Scalar& color,
+                          int thickness, int row_begin, int row_end) {
+  uint8_t yuv[3];
+  BgrToYuv(color, yuv);
+  const int x0 = std::min(top_left.x, bottom_right.x), x1 = std::max(top_left.x, bottom_right.x);
+  const int y0 = std::min(top_left.y, bottom_right.y), y1 = std::max(top_left.y, bottom_right.y);
+  if (thickness < 0) {
+    Fill(x0, y0, x1 + 1, y1 + 1, yuv, row_begin, row_end);
+    return;
+  }
+  // the lines are centered on the edges, as cv::rectangle does
+  const int begin = -thickness / 2, end = begin + thickness;
+  Fill(x0 + begin, y0 + begin, x1 + end, y0 + end, yuv, row_begin, row_end);
+  Fill(x0 + begin, y1 + begin, x1 + end, y1 + end, yuv, row_begin, row_end);
+  Fill(x0 + begin, y0 + end, x0 + end, y1 + begin, yuv, row_begin, row_end);
+  Fill(x1 + begin, y0 + end, x1 + end, y1 + begin, yuv, row_begin, row_end);
+}
+
+void YuvCanvas::PutMask(const OsdTextMask& mask, const cv::Point& org, const cv::Scalar& color, int row_begin,
+                        int row_end) {
+  uint8_t yuv[3];
+  BgrToYuv(color, yuv);
+  const uint8_t u = nv21_ ? yuv[2] : yuv[1], v = nv21_ ? yuv[1] : yuv[2];
+  const int left = org.x - mask.org.x, top = org.y - mask.org.y;
+  const int x0 = std::max(left, 0), x1 = std::min(left + mask.mask.cols, width_);
+  const int y0 = std::max(std::max(top, row_begin), 0);
+  const int y1 = std::min(std::min(top + mask.mask.rows, row_end), height_);
+  for (int y = y0; y < y1; ++y) {
+    const uint8_t* src = mask.mask.ptr<uint8_t>(y - top);
+    uint8_t* luma = y_plane_ + y * y_stride_;
+    uint8_t* uv = uv_plane_ + (y / 2) * uv_stride_;
+    for (int x = x0; x < x1; ++x) {
+      if (!src[x - left]) continue;
+      luma[x] = yuv[0];
+      uv[x / 2 * 2] = u;
+      uv[x / 2 * 2 + 1] = v;
+    }
+  }
+}
+
+void CnOsd::DrawLogo(cv::Mat image, std::string logo) {
+  BgrCanvas canvas(image);
+  DrawLogo(&canvas, logo);
+}
+
+void CnOsd::DrawLogo(OsdCanvas* canvas, std::string logo) {
+  cv::Point logo_pos(5, canvas->Height() - 5);
   uint32_t scale = 1;
   uint32_t thickness = 2;
   cv::Scalar color(200, 200, 200);
-  cv::putText(image, logo, logo_pos, font_, scale, color, thickness);
+  std::vector<DrawOp> ops;
+  AddText(logo, logo_pos, color, scale, thickness, nullptr, &ops);
+  Draw(canvas, ops);
+}
+
+void CnOsd::DrawLabel(cv::Mat image, const CNInferObjsPtr& objs_holder, std::vector<std::string> attr_keys) {
+  BgrCanvas canvas(image);
+  DrawLabel(&canvas, objs_holder, attr_keys);
 }
 
-void CnOsd::DrawLabel(cv::Mat image, const CNInferObjsPtr& objs_holder, std::vector<std::string> attr_keys) const {
+void CnOsd::DrawLabel(OsdCanvas* canvas, const CNInferObjsPtr& objs_holder,
+                      std::vector<std::string> attr_keys) {
   // check input data
-  if (image.cols * image.rows == 0) {
+  if (!objs_holder) return;
+  if (canvas->Width() * canvas->Height() == 0) {
     LOGE(OSD) << "Osd: the image is empty.";
     return;
   }
 
-  for (uint32_t i = 0; i < objs_holder->objs_.size(); ++i) {
-    std::shared_ptr<cnstream::CNInferObject> object = objs_holder->objs_[i];
+  std::vector<DrawOp> ops;
+  // the objects may be appended by a parallel branch, a snapshot of them is drawn
+  CNInferObjsSnapshot objs = objs_holder->GetSnapshot();
+  for (const std::shared_ptr<cnstream::CNInferObject>& object : *objs) {
     if (!object) continue;
-    std::pair<cv::Point, cv::Point> corner = GetBboxCorner(*object.get(), image.cols, image.rows);
+    std::pair<cv::Point, cv::Point> corner = GetBboxCorner(*object.get(), canvas->Width(), canvas->Height());
     cv::Point top_left = corner.first;
     cv::Point bottom_right = corner.second;
     cv::Point bottom_left(top_left.x, bottom_right.y);
@@ -139,7 +250,7 @@ void CnOsd::DrawLabel(cv::Mat image, const CNInferObjsPtr& objs_holder, std::vec
     LOGD(OSD) << "Draw Bounding Box: "
               << "top_left: (" << top_left.x << "," << top_left.y << ") bottom_right:(" << bottom_right.x << ","
               << bottom_right.y << ")";
-    DrawBox(image, top_left, bottom_right, color);
+    DrawBox(canvas, top_left, bottom_right, color, &ops);
 
     // Draw Text label + score + track id
     std::string text;
@@ -155,7 +266,7 @@ void CnOsd::DrawLabel(cv::Mat image, const CNInferObjsPtr& objs_holder, std::vec
     } else {
       LOGD(OSD) << "Draw Label and Score: " << text;
     }
-    DrawText(image, bottom_left, text, color);
+    DrawText(canvas, bottom_left, text, color, &ops);
 
     // draw secondary inference information
     int label_bottom_y = 0;
@@ -166,17 +277,18 @@ void CnOsd::DrawLabel(cv::Mat image, const CNInferObjsPtr& objs_holder, std::vec
         std::string attr_value = object->GetExtraAttribute(key);
         if (attr_value.empty()) continue;
         std::string secondary_text = key + " : " + attr_value;
-        DrawText(image, top_left + cv::Point(0, label_bottom_y), secondary_text, color, 0.5, &text_height);
+        DrawText(canvas, top_left + cv::Point(0, label_bottom_y), secondary_text, color, &ops, 0.5, &text_height);
       } else {
         std::string secondary_label = secondary_labels_[infer_attr.value];
         std::string secondary_score = std::to_string(infer_attr.score);
         secondary_score = secondary_score.substr(0, std::min(size_t(4), secondary_score.size()));
         std::string secondary_text = key + " : " + secondary_label + " score[" + secondary_score + "]";
-        DrawText(image, top_left + cv::Point(0, label_bottom_y), secondary_text, color, 0.5, &text_height);
+        DrawText(canvas, top_left + cv::Point(0, label_bottom_y), secondary_text, color, &ops, 0.5, &text_height);
       }
       label_bottom_y += text_height;
     }
   }
+  Draw(canvas, ops);
 }
 
 std::pair<cv::Point, cv::Point> CnOsd::GetBboxCorner(const CNInferObject& object, int img_width, int img_height) const {
@@ -202,16 +314,17 @@ int CnOsd::GetLabelId(const std::string& label_id_str) const {
   return label_id_str.empty() ? -1 : std::stoi(label_id_str);
 }
 
-void CnOsd::DrawBox(cv::Mat image, const cv::Point& top_left, const cv::Point& bottom_right,
-                    const cv::Scalar& color) const {
-  cv::rectangle(image, top_left, bottom_right, color, CalcThickness(image.cols, box_thickness_));
+void CnOsd::DrawBox(const OsdCanvas* canvas, const cv::Point& top_left, const cv::Point& bottom_right,
+                    const cv::Scalar& color, std::vector<DrawOp>* ops) const {
+  AddRectangle(top_left, bottom_right, color, CalcThickness(canvas->Width(), box_thickness_), ops);
 }
 
-void CnOsd::DrawText(cv::Mat image, const cv::Point& bottom_left, const std::string& text, const cv::Scalar& color,
-                     float scale, int* text_height) const {
-  double txt_scale = CalcScale(image.cols, text_scale_) * scale;
-  int txt_thickness = CalcThickness(image.cols, text_thickness_) * scale;
-  int box_thickness = CalcThickness(image.cols, box_thickness_) * scale;
+void CnOsd::DrawText(const OsdCanvas* canvas, const cv::Point& bottom_left, const std::string& text,
+                     const cv::Scalar& color, std::vector<DrawOp>* ops, float scale, int* text_height) {
+  const int image_cols = canvas->Width(), image_rows = canvas->Height();
+  double txt_scale = CalcScale(image_cols, text_scale_) * scale;
+  int txt_thickness = CalcThickness(image_cols, text_thickness_) * scale;
+  int box_thickness = CalcThickness(image_cols, box_thickness_) * scale;
 
   int baseline = 0;
   int space_before = 0;
@@ -235,28 +348,102 @@ void CnOsd::DrawText(cv::Mat image, const cv::Point& bottom_left, const std::str
   cv::Point label_top_left = bottom_left + cv::Point(offset, offset);
   cv::Point label_bottom_right = label_top_left + cv::Point(text_size.width + offset, label_height);
   // move up if the label is beyond the bottom of the image
-  if (label_bottom_right.y > image.rows) {
+  if (label_bottom_right.y > image_rows) {
     label_bottom_right.y -= label_height;
     label_top_left.y -= label_height;
   }
   // move left if the label is beyond the right side of the image
-  if (label_bottom_right.x > image.cols) {
-    label_bottom_right.x = image.cols;
-    label_top_left.x = image.cols - text_size.width;
+  if (label_bottom_right.x > image_cols) {
+    label_bottom_right.x = image_cols;
+    label_top_left.x = image_cols - text_size.width;
   }
   // draw text background
-  cv::rectangle(image, label_top_left, label_bottom_right, color, CV_FILLED);
+  AddRectangle(label_top_left, label_bottom_right, color, -1, ops);
   // draw text
   cv::Point text_left_bottom =
       label_top_left + cv::Point(space_before, label_height - baseline / 2 - txt_thickness / 2);
   cv::Scalar text_color = cv::Scalar(255, 255, 255) - color;
-  if (cn_font_ == nullptr) {
-    cv::putText(image, text, text_left_bottom, font_, txt_scale, text_color, txt_thickness);
+  AddText(text, text_left_bottom, text_color, txt_scale, txt_thickness, cn_font_.get(), ops);
+  if (text_height) *text_height = text_size.height + baseline;
+}
+
+void CnOsd::AddRectangle(const cv::Point& top_left, const cv::Point& bottom_right, const cv::Scalar& color,
+                         int thickness, std::vector<DrawOp>* ops) const {
+  DrawOp op;
+  op.top_left = top_left;
+  op.bottom_right = bottom_right;
+  op.color = color;
+  op.thickness = thickness;
+  const int margin = std::max(thickness, 0) + 1;
+  op.row_begin = std::min(top_left.y, bottom_right.y) - margin;
+  op.row_end = std::max(top_left.y, bottom_right.y) + margin;
+  ops->push_back(std::move(op));
+}
+
+void CnOsd::AddText(const std::string& text, const cv::Point& org, const cv::Scalar& color, double scale,
+                    int thickness, CnFont* cn_font, std::vector<DrawOp>* ops) {
+  DrawOp op;
+  op.top_left = org;
+  op.color = color;
+  op.mask = GetTextMask(text, scale, thickness, cn_font);
+  op.row_begin = org.y - op.mask->org.y;
+  op.row_end = op.row_begin + op.mask->mask.rows;
+  ops->push_back(std::move(op));
+}
+
+std::shared_ptr<const OsdTextMask> CnOsd::GetTextMask(const std::string& text, double scale, int thickness,
+                                                      CnFont* cn_font) {
+  const std::string key = text + '\n' + std::to_string(scale) + ' ' + std::to_string(thickness) +
+                          (cn_font ? " cn" : "");
+  auto iter = text_masks_.find(key);
+  if (iter != text_masks_.end()) return iter->second;
+  // texts like scores and track ids change often, the cache is bounded. The masks of the frame being drawn are
+  // held by the recorded drawings.
+  constexpr size_t kMaxCachedTexts = 512;
+  if (text_masks_.size() >= kMaxCachedTexts) text_masks_.clear();
+
+  std::shared_ptr<OsdTextMask> text_mask = std::make_shared<OsdTextMask>();
+  const int margin = thickness + 1;
+  if (cn_font == nullptr) {
+    int baseline = 0;
+    cv::Size size = cv::getTextSize(text, font_, scale, thickness, &baseline);
+    text_mask->mask = cv::Mat::zeros(size.height + baseline + 2 * margin, size.width + 2 * margin, CV_8UC1);
+    text_mask->org = cv::Point(margin, margin + size.height);
+    cv::putText(text_mask->mask, text, text_mask->org, font_, scale, cv::Scalar(255), thickness);
   } else {
+    uint32_t text_w = 0, text_h = 0;
     char* str = const_cast<char*>(text.data());
-    cn_font_->putText(image, str, text_left_bottom, text_color);
+    cn_font->GetTextSize(str, &text_w, &text_h);
+    cv::Mat bgr = cv::Mat::zeros(text_h + 2 * margin, text_w + 2 * margin, CV_8UC3);
+    text_mask->org = cv::Point(margin, margin + text_h);
+    cn_font->putText(bgr, str, text_mask->org, cv::Scalar(255, 255, 255));
+    cv::cvtColor(bgr, text_mask->mask, cv::COLOR_BGR2GRAY);
   }
-  if (text_height) *text_height = text_size.height + baseline;
+  text_masks_[key] = text_mask;
+  return text_mask;
+}
+
+// Drawings are split into bands only if there are enough of them, e.g. a few objects are drawn on one thread.
+static constexpr size_t kMinParallelOps = 16;
+static constexpr int kMinBandRows = 256;
+
+void CnOsd::Draw(OsdCanvas* canvas, const std::vector<DrawOp>& ops) const {
+  // the drawings are done in order in each band, so the overlapped ones look the same as drawn serially
+  auto draw_band = [&](int begin, int end) {
+    for (const auto& op : ops) {
+      if (op.row_end <= begin || op.row_begin >= end) continue;
+      if (op.mask) {
+        canvas->PutMask(*op.mask, op.top_left, op.color, begin, end);
+      } else {
+        canvas->Rectangle(op.top_left, op.bottom_right, op.color, op.thickness, begin, end);
+      }
+    }
+  };
+  if (ops.size() < kMinParallelOps) {
+    draw_band(0, canvas->Height());
+    return;
+  }
+  ParallelFor(canvas->Height(), kMinBandRows, 2, draw_band);
 }
 
 int CnOsd::CalcThickness(int image_width, float thickness) const {
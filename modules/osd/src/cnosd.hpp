@@ -24,8 +24,10 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include <cstdint>
 #include <cstring>
 #include <fstream>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -38,6 +40,90 @@ namespace cnstream {
 
 class CnFont;
 
+/**
+ * @brief Text rasterized into a mask, it is drawn by OsdCanvas::PutMask.
+ */
+struct OsdTextMask {
+  cv::Mat mask;   // CV_8UC1, pixels of the text are not zero
+  cv::Point org;  // the origin of the text in the mask
+};
+
+/**
+ * @brief The image CnOsd draws on. Colors are in BGR.
+ *
+ * Drawing is clipped by the rows [row_begin, row_end), bands of rows are drawn concurrently. Row boundaries of
+ * the bands are even.
+ */
+class OsdCanvas {
+ public:
+  virtual ~OsdCanvas() = default;
+  virtual int Width() const = 0;
+  virtual int Height() const = 0;
+  /**
+   * @brief Draws a rectangle, it is filled if thickness is negative.
+   */
+  virtual void Rectangle(const cv::Point &top_left, const cv::Point &bottom_right, const cv::Scalar &color,
+                         int thickness, int row_begin, int row_end) = 0;
+  /**
+   * @brief Draws the pixels of the mask in color, the origin of the mask is put at org.
+   */
+  virtual void PutMask(const OsdTextMask &mask, const cv::Point &org, const cv::Scalar &color, int row_begin,
+                       int row_end) = 0;
+};
+
+/**
+ * @brief Draws on a BGR image with OpenCV.
+ */
+class BgrCanvas : public OsdCanvas {
+ public:
+  explicit BgrCanvas(cv::Mat image) : image_(image) {}
+  int Width() const override { return image_.cols; }
+  int Height() const override { return image_.rows; }
+  void Rectangle(const cv::Point &top_left, const cv::Point &bottom_right, const cv::Scalar &color, int thickness,
+                 int row_begin, int row_end) override;
+  void PutMask(const OsdTextMask &mask, const cv::Point &org, const cv::Scalar &color, int row_begin,
+               int row_end) override;
+
+ private:
+  cv::Mat image_;
+};  // class BgrCanvas
+
+/**
+ * @brief Draws on the Y and UV planes of a NV12 or NV21 frame directly, so that the frame is not converted to BGR.
+ *
+ * The chroma of a 2x2 block is set if any pixel of the block is drawn.
+ */
+class YuvCanvas : public OsdCanvas {
+ public:
+  YuvCanvas(uint8_t *y_plane, int y_stride, uint8_t *uv_plane, int uv_stride, int width, int height, bool nv21)
+      : y_plane_(y_plane), uv_plane_(uv_plane), y_stride_(y_stride), uv_stride_(uv_stride), width_(width),
+        height_(height), nv21_(nv21) {}
+  int Width() const override { return width_; }
+  int Height() const override { return height_; }
+  void Rectangle(const cv::Point &top_left, const cv::Point &bottom_right, const cv::Scalar &color, int thickness,
+                 int row_begin, int row_end) override;
+  void PutMask(const OsdTextMask &mask, const cv::Point &org, const cv::Scalar &color, int row_begin,
+               int row_end) override;
+
+ private:
+  // fills [x0, x1) * [y0, y1) clipped by the image and the rows [row_begin, row_end)
+  void Fill(int x0, int y0, int x1, int y1, const uint8_t yuv[3], int row_begin, int row_end);
+
+  uint8_t *y_plane_ = nullptr;
+  uint8_t *uv_plane_ = nullptr;
+  int y_stride_ = 0;
+  int uv_stride_ = 0;
+  int width_ = 0;
+  int height_ = 0;
+  bool nv21_ = false;
+};  // class YuvCanvas
+
+/**
+ * @brief Draws objects on frames. A CnOsd is used by one thread at a time.
+ *
+ * The drawings of a frame are recorded first, text is rasterized into masks and cached. Then the drawings are
+ * done on bands of rows concurrently, so large frames with many objects are drawn by several threads.
+ */
 class CnOsd {
  public:
   CnOsd() = delete;
@@ -48,18 +134,43 @@ class CnOsd {
   inline void SetBoxThickness(float thickness)  { box_thickness_ = thickness; }
   inline void SetSecondaryLabels(std::vector<std::string> labels) { secondary_labels_ = labels; }
   inline void SetCnFont(std::shared_ptr<CnFont> cn_font) { cn_font_ = cn_font; }
+  inline CnFont* GetCnFont() const { return cn_font_.get(); }
 
-  void DrawLabel(cv::Mat image, const CNInferObjsPtr &objects, std::vector<std::string> attr_keys = {}) const;
-  void DrawLogo(cv::Mat image, std::string logo) const;
+  void DrawLabel(cv::Mat image, const CNInferObjsPtr &objects, std::vector<std::string> attr_keys = {});
+  void DrawLogo(cv::Mat image, std::string logo);
+  void DrawLabel(OsdCanvas *canvas, const CNInferObjsPtr &objects, std::vector<std::string> attr_keys = {});
+  void DrawLogo(OsdCanvas *canvas, std::string logo);
 
  private:
+  /**
+   * @brief A recorded drawing, a rectangle or a text mask.
+   */
+  struct DrawOp {
+    cv::Point top_left;      // the origin of the text for masks
+    cv::Point bottom_right;
+    cv::Scalar color;
+    int thickness = 0;
+    std::shared_ptr<const OsdTextMask> mask;  // draws the mask if it is not nullptr
+    int row_begin = 0;       // the rows [row_begin, row_end) that may be drawn
+    int row_end = 0;
+  };
+
   std::pair<cv::Point, cv::Point> GetBboxCorner(const cnstream::CNInferObject &object,
                                                 int img_width, int img_height) const;
   bool LabelIsFound(const int &label_id) const;
   int GetLabelId(const std::string &label_id_str) const;
-  void DrawBox(cv::Mat image, const cv::Point &top_left, const cv::Point &bottom_right, const cv::Scalar &color) const;
-  void DrawText(cv::Mat image, const cv::Point &bottom_left, const std::string &text, const cv::Scalar &color,
-                float scale = 1, int *text_height = nullptr) const;
+  void DrawBox(const OsdCanvas *canvas, const cv::Point &top_left, const cv::Point &bottom_right,
+               const cv::Scalar &color, std::vector<DrawOp> *ops) const;
+  void DrawText(const OsdCanvas *canvas, const cv::Point &bottom_left, const std::string &text,
+                const cv::Scalar &color, std::vector<DrawOp> *ops, float scale = 1, int *text_height = nullptr);
+  void AddRectangle(const cv::Point &top_left, const cv::Point &bottom_right, const cv::Scalar &color, int thickness,
+                    std::vector<DrawOp> *ops) const;
+  void AddText(const std::string &text, const cv::Point &org, const cv::Scalar &color, double scale, int thickness,
+               CnFont *cn_font, std::vector<DrawOp> *ops);
+  std::shared_ptr<const OsdTextMask> GetTextMask(const std::string &text, double scale, int thickness,
+                                                 CnFont *cn_font);
+  // Does the recorded drawings on bands of the canvas concurrently
+  void Draw(OsdCanvas *canvas, const std::vector<DrawOp> &ops) const;
   int CalcThickness(int image_width, float thickness) const;
   double CalcScale(int image_width, float scale) const;
 
@@ -71,6 +182,7 @@ class CnOsd {
   std::vector<cv::Scalar> colors_;
   int font_ = cv::FONT_HERSHEY_SIMPLEX;
   std::shared_ptr<CnFont> cn_font_;
+  std::map<std::string, std::shared_ptr<const OsdTextMask>> text_masks_;
 };  // class CnOsd
 
 }  // namespace cnstream
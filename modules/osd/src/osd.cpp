@@ -20,10 +20,10 @@
 
 #include "osd.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include "opencv2/highgui/highgui.hpp"
@@ -35,6 +35,7 @@
 #include "cnfont.hpp"
 #include "cnosd.hpp"
 #include "cnstream_frame_va.hpp"
+#include "cnstream_pipeline.hpp"
 
 namespace cnstream {
 
@@ -68,50 +69,54 @@ Osd::Osd(const std::string& name) : Module(name) {
   param_register_.Register("secondary_label_path", "The path of the secondary label file");
   param_register_.Register("attr_keys", "The keys of attribute which you want to draw on image");
   param_register_.Register("logo", "draw 'logo' on each frame");
+  param_register_.Register("draw_format", "The format of the image drawn on, 'bgr' or 'yuv'. The default value is bgr."
+                           " 'yuv' draws on the planes of NV12 and NV21 frames directly without converting them to"
+                           " BGR, the following modules should use the frame planes, e.g. encode with input_frame 'mlu'."
+                           " Frames in other formats are still drawn on BGR images.");
 }
 
 Osd::~Osd() { Close(); }
 
-std::shared_ptr<CnOsd> Osd::GetOsdContext() {
-  std::shared_ptr<CnOsd> ctx = nullptr;
-  std::thread::id thread_id = std::this_thread::get_id();
-  {
-    RwLockReadGuard lg(ctx_lock_);
-    if (osd_ctxs_.find(thread_id) != osd_ctxs_.end()) {
-      ctx = osd_ctxs_[thread_id];
-    }
-  }
-  if (!ctx) {
-    ctx = std::make_shared<CnOsd>(labels_);
-    if (!ctx) {
-      LOGE(OSD) << "Osd::GetOsdContext() create Osd Context Failed";
-      return nullptr;
-    }
-    ctx->SetTextScale(label_size_ * text_scale_);
-    ctx->SetTextThickness(label_size_ * text_thickness_);
-    ctx->SetBoxThickness(label_size_ * box_thickness_);
+std::unique_ptr<CnOsd> Osd::CreateOsdContext() {
+  std::unique_ptr<CnOsd> ctx(new CnOsd(labels_));
+  ctx->SetTextScale(label_size_ * text_scale_);
+  ctx->SetTextThickness(label_size_ * text_thickness_);
+  ctx->SetBoxThickness(label_size_ * box_thickness_);
 
-    ctx->SetSecondaryLabels(secondary_labels_);
+  ctx->SetSecondaryLabels(secondary_labels_);
 
 #ifdef HAVE_FREETYPE
-    if (!font_path_.empty()) {
-      std::shared_ptr<CnFont> font = std::make_shared<CnFont>();
-      float font_size = label_size_ * text_scale_ * 30;
-      float space = font_size / 75;
-      float step = font_size / 200;
-      if (font && font->Init(font_path_, font_size, space, step)) {
-        ctx->SetCnFont(font);
-      } else {
-        LOGE(OSD) << "Create and initialize CnFont failed.";
-      }
+  if (!font_path_.empty()) {
+    std::shared_ptr<CnFont> font = std::make_shared<CnFont>();
+    float font_size = label_size_ * text_scale_ * 30;
+    float space = font_size / 75;
+    float step = font_size / 200;
+    if (font && font->Init(font_path_, font_size, space, step)) {
+      ctx->SetCnFont(font);
+    } else {
+      LOGE(OSD) << "Create and initialize CnFont failed.";
     }
+  }
 #endif
-    RwLockWriteGuard lg(ctx_lock_);
-    osd_ctxs_[thread_id] = ctx;
+  return ctx;
+}
+
+CnOsd* Osd::AcquireOsdContext() {
+  std::lock_guard<std::mutex> lk(ctx_mutex_);
+  if (idle_ctxs_.empty()) {
+    osd_ctxs_.push_back(CreateOsdContext());
+    idle_ctxs_.push_back(osd_ctxs_.back().get());
   }
+  CnOsd* ctx = idle_ctxs_.back();
+  idle_ctxs_.pop_back();
   return ctx;
 }
 
+void Osd::ReleaseOsdContext(CnOsd* ctx) {
+  std::lock_guard<std::mutex> lk(ctx_mutex_);
+  idle_ctxs_.push_back(ctx);
+}
+
 bool Osd::Open(cnstream::ModuleParamSet paramSet) {
   std::string label_path = "";
   if (paramSet.find("label_path") == paramSet.end()) {
@@ -173,38 +178,93 @@ bool Osd::Open(cnstream::ModuleParamSet paramSet) {
   if (paramSet.find("logo") != paramSet.end()) {
     logo_ = paramSet["logo"];
   }
+
+  if (paramSet.find("draw_format") != paramSet.end()) {
+    draw_yuv_ = paramSet["draw_format"] == "yuv";
+  }
+
+  // one context for each thread calling Process, including the threads added by the autoscaler
+  int ctx_num = 1;
+  if (GetContainer()) {
+    CNModuleConfig config = GetContainer()->GetModuleConfig(GetName());
+    ctx_num = std::max(ctx_num, std::max(config.parallelism, config.maxParallelism));
+  }
+  std::lock_guard<std::mutex> lk(ctx_mutex_);
+  osd_ctxs_.clear();
+  idle_ctxs_.clear();
+  for (int i = 0; i < ctx_num; ++i) {
+    osd_ctxs_.push_back(CreateOsdContext());
+    idle_ctxs_.push_back(osd_ctxs_.back().get());
+  }
   return true;
 }
 
 void Osd::Close() {
+  std::lock_guard<std::mutex> lk(ctx_mutex_);
+  idle_ctxs_.clear();
   osd_ctxs_.clear();
 }
 
 int Osd::Process(std::shared_ptr<CNFrameInfo> data) {
-  std::shared_ptr<CnOsd> ctx = GetOsdContext();
-  if (ctx == nullptr) {
-    LOGE(OSD) << "Get Osd Context Failed.";
-    return -1;
-  }
+  CnOsd* ctx = AcquireOsdContext();
+  int ret = DrawFrame(ctx, data);
+  ReleaseOsdContext(ctx);
+  return ret;
+}
 
-  CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+int Osd::DrawFrame(CnOsd* ctx, const std::shared_ptr<CNFrameInfo>& data) {
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
   if (frame->width < 0 || frame->height < 0) {
     LOGE(OSD) << "OSD module processed illegal frame: width or height may < 0.";
     return -1;
   }
 
   CNInferObjsPtr objs_holder = nullptr;
-  if (data->collection.HasValue(kCNInferObjsTag)) {
-    objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+  if (data->collection.HasValue(kCNInferObjsSlot)) {
+    objs_holder = data->collection.Get(kCNInferObjsSlot);
   }
 
-  if (!logo_.empty()) {
-    ctx->DrawLogo(frame->ImageBGR(), logo_);
+  // a BGR image converted before, e.g. drawn by another module, is still drawn on to keep the drawing together
+  const bool is_yuv = frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 ||
+                      frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21;
+  if (draw_yuv_ && is_yuv && !frame->HasBGRImage()) {
+    // the planes are updated on CPU, they are synchronized to MLU again once they are used on MLU
+    YuvCanvas canvas(static_cast<uint8_t *>(frame->data[0]->GetMutableCpuData()), frame->stride[0],
+                     static_cast<uint8_t *>(frame->data[1]->GetMutableCpuData()), frame->stride[1], frame->width,
+                     frame->height, frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21);
+    if (!logo_.empty()) {
+      ctx->DrawLogo(&canvas, logo_);
+    }
+    ctx->DrawLabel(&canvas, objs_holder, attr_keys_);
+  } else {
+    if (!logo_.empty()) {
+      ctx->DrawLogo(frame->ImageBGRMutable(), logo_);
+    }
+    ctx->DrawLabel(frame->ImageBGRMutable(), objs_holder, attr_keys_);
   }
-  ctx->DrawLabel(frame->ImageBGR(), objs_holder, attr_keys_);
+  RecordFontCacheStats(ctx);
   return 0;
 }
 
+void Osd::RecordFontCacheStats(CnOsd* ctx) {
+  CnFont* font = ctx->GetCnFont();
+  ModuleProfiler* profiler = GetProfiler();
+  if (!font || !profiler) return;
+  uint64_t hits = 0, lookups = 0;
+  font->TakeCacheStats(&hits, &lookups);
+  if (!lookups) return;
+  // hit rate = font_cache_hits / font_cache_lookups
+  profiler->AddCounter("font_cache_hits", hits);
+  profiler->AddCounter("font_cache_lookups", lookups);
+}
+
+void Osd::Prefetch(const std::shared_ptr<CNFrameInfo>& data) {
+  if (!data->collection.HasValue(kCNDataFrameSlot)) return;
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+  // draws on the BGR image, the planes are needed on CPU
+  frame->PrefetchToCpu();
+}
+
 bool Osd::CheckParamSet(const ModuleParamSet& paramSet) const {
   bool ret = true;
   ParametersChecker checker;
@@ -236,6 +296,13 @@ bool Osd::CheckParamSet(const ModuleParamSet& paramSet) const {
     LOGE(OSD) << "[Osd] " << err_msg;
     ret = false;
   }
+  if (paramSet.find("draw_format") != paramSet.end()) {
+    std::string draw_format = paramSet.at("draw_format");
+    if (draw_format != "bgr" && draw_format != "yuv") {
+      LOGE(OSD) << "[Osd] [draw_format] : " << draw_format << " is not supported. Please choose from 'bgr', 'yuv'.";
+      ret = false;
+    }
+  }
   if (paramSet.find("label_size") != paramSet.end()) {
     std::string label_size = paramSet.at("label_size");
     if (label_size != "normal" && label_size != "large" && label_size != "larger" &&
@@ -0,0 +1,138 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_REID_GALLERY_HPP_
+#define MODULES_REID_GALLERY_HPP_
+
+/**
+ *  @file reid_gallery.hpp
+ *
+ *  This file contains a declaration of the ReidGallery class.
+ */
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_module.hpp"
+
+namespace cnstream {
+
+class ReidIndex;
+
+/**
+ * @class ReidGallery
+ *
+ * @brief ReidGallery matches the objects of all streams against the tracks recently seen by the other streams, e.g.
+ * to follow a person across cameras, without sending the features out of the process.
+ *
+ * The gallery keeps the latest feature (``feature_key``, e.g. the one added by Tracker) of each track of all streams
+ * in an approximate nearest neighbor index, see ReidIndex. The objects of a frame are searched as one batch, then
+ * their tracks are added. The tracks not seen for ``expire_time_ms`` are evicted.
+ *
+ * The ``top_k`` nearest tracks within ``max_distance`` (cosine distance) are attached to the object, the i-th one as
+ * the attribute ``reid_match_<i>`` whose score is ``1 - distance``, and the extended attribute ``reid_match_<i>``
+ * holding ``<stream_id>:<track_id>``. The value of the attribute is the track id if it is a number, otherwise -1.
+ */
+class ReidGallery : public Module, public ModuleCreator<ReidGallery> {
+ public:
+  /**
+   * @brief Constructs a ReidGallery object.
+   *
+   * @param[in] name The name of this module.
+   *
+   * @return No return value.
+   */
+  explicit ReidGallery(const std::string &name);
+
+  /**
+   * @brief Destructs a ReidGallery object.
+   *
+   * @return No return value.
+   */
+  ~ReidGallery();
+
+  /**
+   * @brief Opens the module and clears the gallery.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Releases the gallery.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+
+  /**
+   * @brief Matches the objects of a frame and adds their tracks to the gallery.
+   *
+   * @param[in] data The frame.
+   *
+   * @return Returns 0.
+   */
+  int Process(std::shared_ptr<CNFrameInfo> data) override;
+
+  /**
+   * @brief Checks the parameters of this module.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool CheckParamSet(const ModuleParamSet &paramSet) const override;
+
+  /**
+   * @brief The pixels are never read by this module.
+   *
+   * @return Returns false.
+   */
+  bool NeedsPixels() const override { return false; }
+
+  /**
+   * @brief Gets the number of tracks in the gallery.
+   *
+   * @return Returns the number of tracks.
+   */
+  size_t GetGallerySize() const;
+
+ private:
+  std::string feature_key_ = "track";
+  size_t top_k_ = 3;
+  float max_distance_ = 0.3;
+  bool cross_stream_only_ = true;
+  std::chrono::milliseconds expire_time_{60000};
+  size_t nlist_ = 64;
+  size_t nprobe_ = 8;
+  size_t train_size_ = 1024;
+  size_t max_entries_ = 100000;
+  mutable std::mutex mutex_;  // guards the members below, the frames of all streams share the gallery
+  std::unique_ptr<ReidIndex> index_;  // created with the dimension of the first feature
+  std::chrono::steady_clock::time_point last_evict_time_;
+};  // class ReidGallery
+
+}  // namespace cnstream
+
+#endif  // MODULES_REID_GALLERY_HPP_
@@ -0,0 +1,209 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "reid_gallery.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_logging.hpp"
+#include "reid_index.hpp"
+
+namespace cnstream {
+
+namespace {
+
+// the expired tracks are evicted at most once per interval
+constexpr std::chrono::milliseconds kEvictInterval(1000);
+
+int ParseTrackId(const std::string &track_id) {
+  char *end = nullptr;
+  const long value = std::strtol(track_id.c_str(), &end, 10);  // NOLINT
+  return track_id.empty() || *end ? -1 : static_cast<int>(value);
+}
+
+}  // namespace
+
+ReidGallery::ReidGallery(const std::string &name) : Module(name) {
+  param_register_.SetModuleDesc("ReidGallery is a module which matches the objects against the tracks recently seen"
+      " by the other streams, by an approximate nearest neighbor index of the track features kept in the process.");
+  param_register_.Register("feature_key", "The key of the feature of the objects. Default is track, the feature"
+      " added by Tracker.");
+  param_register_.Register("top_k", "The max number of tracks matched by an object. Default is 3.");
+  param_register_.Register("max_distance", "The max cosine distance of the tracks matched. Default is 0.3.");
+  param_register_.Register("cross_stream_only", "Whether the tracks of the same stream are not matched, true or"
+      " false. Default is true.");
+  param_register_.Register("expire_time_ms", "The tracks not seen for this time are evicted. Default is 60000.");
+  param_register_.Register("nlist", "The max number of lists of the index. Default is 64.");
+  param_register_.Register("nprobe", "The number of lists searched by an object. Default is 8.");
+  param_register_.Register("train_size", "The number of tracks the index is first trained on, it is searched"
+      " exhaustively before. Default is 1024.");
+  param_register_.Register("max_entries", "The max number of tracks, the oldest ones are evicted beyond it."
+      " Default is 100000.");
+}
+
+ReidGallery::~ReidGallery() { Close(); }
+
+bool ReidGallery::Open(ModuleParamSet paramSet) {
+  if (!CheckParamSet(paramSet)) return false;
+  auto get = [&paramSet](const std::string &key, const std::string &default_value) {
+    return paramSet.find(key) != paramSet.end() ? paramSet[key] : default_value;
+  };
+  feature_key_ = get("feature_key", "track");
+  top_k_ = std::stoul(get("top_k", "3"));
+  max_distance_ = std::stof(get("max_distance", "0.3"));
+  cross_stream_only_ = get("cross_stream_only", "true") == "true";
+  expire_time_ = std::chrono::milliseconds(std::stoll(get("expire_time_ms", "60000")));
+  nlist_ = std::stoul(get("nlist", "64"));
+  nprobe_ = std::stoul(get("nprobe", "8"));
+  train_size_ = std::stoul(get("train_size", "1024"));
+  max_entries_ = std::stoul(get("max_entries", "100000"));
+  std::lock_guard<std::mutex> lk(mutex_);
+  index_.reset();
+  last_evict_time_ = std::chrono::steady_clock::now();
+  return true;
+}
+
+void ReidGallery::Close() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  index_.reset();
+}
+
+int ReidGallery::Process(std::shared_ptr<CNFrameInfo> data) {
+  if (data->IsEos() || !data->collection.HasValue(kCNInferObjsSlot)) return 0;
+  CNInferObjsSnapshot objs = data->collection.Get(kCNInferObjsSlot)->GetSnapshot();
+  size_t dim = 0;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (index_) dim = index_->Dim();
+  }
+  // the features of the frame are decoded into one buffer, quantized ones are not restored to CNInferFeature first.
+  // the features of another dimension than the gallery are skipped.
+  std::vector<CNInferObjectPtr> queried;
+  std::vector<float> features;
+  auto append = [&](size_t dimension) -> float * {
+    if (!dim) dim = dimension;
+    if (!dim || dimension != dim) return nullptr;
+    features.resize(features.size() + dim);
+    return features.data() + features.size() - dim;
+  };
+  for (const auto &obj : *objs) {
+    bool quantized = obj->VisitQuantizedFeature(feature_key_, [&](const CNInferQuantizedFeature &feature) {
+      float *dst = append(feature.dimension);
+      if (!dst) return;
+      feature.Dequantize(dst);
+      queried.push_back(obj);
+    });
+    if (quantized) continue;
+    obj->VisitFeature(feature_key_, [&](const CNInferFeature &feature) {
+      float *dst = append(feature.size());
+      if (!dst) return;
+      std::copy(feature.begin(), feature.end(), dst);
+      queried.push_back(obj);
+    });
+  }
+  if (queried.empty()) return 0;
+
+  std::vector<ReidQuery> queries(queried.size());
+  for (size_t i = 0; i < queried.size(); ++i) {
+    queries[i].feature = features.data() + i * dim;
+    queries[i].stream_id = data->stream_id;
+    queries[i].track_id = queried[i]->track_id;
+  }
+  std::vector<std::vector<ReidMatch>> results;
+  const auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!index_) {
+      ReidIndex::Params params;
+      params.nlist = nlist_;
+      params.nprobe = nprobe_;
+      params.train_size = train_size_;
+      params.max_entries = max_entries_;
+      index_.reset(new ReidIndex(dim, params));
+    }
+    // another stream may have created the index with another dimension
+    if (index_->Dim() != dim) return 0;
+    index_->Search(queries, top_k_, max_distance_, cross_stream_only_, &results);
+    for (const auto &query : queries) {
+      if (!query.track_id.empty()) index_->Add(query.stream_id, query.track_id, query.feature, now);
+    }
+    if (now - last_evict_time_ >= kEvictInterval) {
+      index_->Evict(now - expire_time_);
+      last_evict_time_ = now;
+    }
+  }
+
+  for (size_t i = 0; i < queried.size(); ++i) {
+    for (size_t m = 0; m < results[i].size(); ++m) {
+      const ReidMatch &match = results[i][m];
+      const std::string key = "reid_match_" + std::to_string(m);
+      CNInferAttr attr;
+      attr.id = static_cast<int>(m);
+      attr.value = ParseTrackId(match.track_id);
+      attr.score = 1.f - match.distance;
+      queried[i]->AddAttribute(key, attr);
+      queried[i]->AddExtraAttribute(key, match.stream_id + ":" + match.track_id);
+    }
+  }
+  return 0;
+}
+
+size_t ReidGallery::GetGallerySize() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return index_ ? index_->Size() : 0;
+}
+
+bool ReidGallery::CheckParamSet(const ModuleParamSet &paramSet) const {
+  ParametersChecker checker;
+  for (auto &it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOGW(ReidGallery) << "[" << GetName() << "] Unknown param: " << it.first;
+    }
+  }
+  std::string err_msg;
+  if (!checker.IsNum({"top_k", "max_distance", "expire_time_ms", "nlist", "nprobe", "train_size", "max_entries"},
+                     paramSet, err_msg, true)) {
+    LOGE(ReidGallery) << "[" << GetName() << "] " << err_msg;
+    return false;
+  }
+  for (const std::string key : {"top_k", "expire_time_ms", "nlist", "nprobe", "max_entries"}) {
+    if (paramSet.find(key) != paramSet.end() && std::stod(paramSet.at(key)) < 1) {
+      LOGE(ReidGallery) << "[" << GetName() << "] [" << key << "] should be greater than 0";
+      return false;
+    }
+  }
+  if (paramSet.find("cross_stream_only") != paramSet.end() && paramSet.at("cross_stream_only") != "true" &&
+      paramSet.at("cross_stream_only") != "false") {
+    LOGE(ReidGallery) << "[" << GetName() << "] [cross_stream_only] should be true or false";
+    return false;
+  }
+  if (paramSet.find("feature_key") != paramSet.end() && paramSet.at("feature_key").empty()) {
+    LOGE(ReidGallery) << "[" << GetName() << "] [feature_key] should not be empty";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,351 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "reid_index.hpp"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+constexpr size_t ReidIndex::kRowAlign;
+
+namespace {
+
+// the centroids are trained on at most kTrainRowsPerList samples per list, and a list has kMinRowsPerList rows at
+// least when they are trained.
+constexpr size_t kTrainRowsPerList = 64;
+constexpr size_t kMinRowsPerList = 32;
+constexpr int kTrainIterations = 8;
+
+// the length of rows is a multiple of kRowAlign, no tail is left for the kernels.
+#if defined(__SSE__)
+
+inline float HorizontalSum(__m128 v) {
+  __m128 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+}
+
+inline void Dot4(const float *a0, const float *a1, const float *a2, const float *a3, const float *b, size_t len,
+                 float *out) {
+  __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps(), s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+  for (size_t k = 0; k < len; k += 4) {
+    __m128 vb = _mm_loadu_ps(b + k);
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a0 + k), vb));
+    s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a1 + k), vb));
+    s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(a2 + k), vb));
+    s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(a3 + k), vb));
+  }
+  out[0] = HorizontalSum(s0);
+  out[1] = HorizontalSum(s1);
+  out[2] = HorizontalSum(s2);
+  out[3] = HorizontalSum(s3);
+}
+
+inline float Dot1(const float *a, const float *b, size_t len) {
+  __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+  for (size_t k = 0; k < len; k += 8) {
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+    s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + k + 4), _mm_loadu_ps(b + k + 4)));
+  }
+  return HorizontalSum(_mm_add_ps(s0, s1));
+}
+
+#elif defined(__ARM_NEON)
+
+inline float HorizontalSum(float32x4_t v) {
+  float32x2_t sum = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+  return vget_lane_f32(vpadd_f32(sum, sum), 0);
+}
+
+inline void Dot4(const float *a0, const float *a1, const float *a2, const float *a3, const float *b, size_t len,
+                 float *out) {
+  float32x4_t s0 = vdupq_n_f32(0), s1 = vdupq_n_f32(0), s2 = vdupq_n_f32(0), s3 = vdupq_n_f32(0);
+  for (size_t k = 0; k < len; k += 4) {
+    float32x4_t vb = vld1q_f32(b + k);
+    s0 = vmlaq_f32(s0, vld1q_f32(a0 + k), vb);
+    s1 = vmlaq_f32(s1, vld1q_f32(a1 + k), vb);
+    s2 = vmlaq_f32(s2, vld1q_f32(a2 + k), vb);
+    s3 = vmlaq_f32(s3, vld1q_f32(a3 + k), vb);
+  }
+  out[0] = HorizontalSum(s0);
+  out[1] = HorizontalSum(s1);
+  out[2] = HorizontalSum(s2);
+  out[3] = HorizontalSum(s3);
+}
+
+inline float Dot1(const float *a, const float *b, size_t len) {
+  float32x4_t s0 = vdupq_n_f32(0), s1 = vdupq_n_f32(0);
+  for (size_t k = 0; k < len; k += 8) {
+    s0 = vmlaq_f32(s0, vld1q_f32(a + k), vld1q_f32(b + k));
+    s1 = vmlaq_f32(s1, vld1q_f32(a + k + 4), vld1q_f32(b + k + 4));
+  }
+  return HorizontalSum(vaddq_f32(s0, s1));
+}
+
+#else
+
+inline void Dot4(const float *a0, const float *a1, const float *a2, const float *a3, const float *b, size_t len,
+                 float *out) {
+  float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  for (size_t k = 0; k < len; ++k) {
+    s0 += a0[k] * b[k];
+    s1 += a1[k] * b[k];
+    s2 += a2[k] * b[k];
+    s3 += a3[k] * b[k];
+  }
+  out[0] = s0;
+  out[1] = s1;
+  out[2] = s2;
+  out[3] = s3;
+}
+
+inline float Dot1(const float *a, const float *b, size_t len) {
+  float sum = 0;
+  for (size_t k = 0; k < len; ++k) sum += a[k] * b[k];
+  return sum;
+}
+
+#endif
+
+}  // namespace
+
+ReidIndex::ReidIndex(size_t dim, const Params &params)
+    : dim_(dim), stride_((dim + kRowAlign - 1) / kRowAlign * kRowAlign), params_(params), lists_(1), row_(stride_) {}
+
+bool ReidIndex::Normalize(const float *feature, float *row) const {
+  std::fill_n(row, stride_, 0.f);
+  double norm = 0;
+  for (size_t k = 0; k < dim_; ++k) norm += static_cast<double>(feature[k]) * feature[k];
+  if (norm <= 0) return false;
+  const float scale = static_cast<float>(1.0 / std::sqrt(norm));
+  for (size_t k = 0; k < dim_; ++k) row[k] = feature[k] * scale;
+  return true;
+}
+
+size_t ReidIndex::NearestList(const float *row) const {
+  size_t nearest = 0;
+  float max_dot = -2;
+  for (size_t i = 0; i < centroids_.size() / stride_; ++i) {
+    const float dot = Dot1(row, centroids_.data() + i * stride_, stride_);
+    if (dot > max_dot) {
+      max_dot = dot;
+      nearest = i;
+    }
+  }
+  return nearest;
+}
+
+void ReidIndex::AppendRow(Entry *entry, uint32_t list, const float *row) {
+  List &dst = lists_[list];
+  entry->list = list;
+  entry->row = static_cast<uint32_t>(dst.entries.size());
+  dst.data.insert(dst.data.end(), row, row + stride_);
+  dst.entries.push_back(entry);
+}
+
+void ReidIndex::RemoveRow(Entry *entry) {
+  // the last row is moved to the removed one
+  List &list = lists_[entry->list];
+  const size_t last = list.entries.size() - 1;
+  if (entry->row != last) {
+    memcpy(list.data.data() + entry->row * stride_, list.data.data() + last * stride_, stride_ * sizeof(float));
+    list.entries[entry->row] = list.entries[last];
+    list.entries[entry->row]->row = entry->row;
+  }
+  list.entries.pop_back();
+  list.data.resize(last * stride_);
+}
+
+bool ReidIndex::Add(const std::string &stream_id, const std::string &track_id, const float *feature,
+                    Clock::time_point time) {
+  if (!Normalize(feature, row_.data())) return false;
+  std::string key = stream_id;
+  key.push_back('\0');
+  key += track_id;
+  auto ret = entries_.emplace(key, Entry());
+  Entry *entry = &ret.first->second;
+  const uint32_t list = static_cast<uint32_t>(NearestList(row_.data()));
+  if (ret.second) {
+    entry->stream_id = stream_id;
+    entry->track_id = track_id;
+    AppendRow(entry, list, row_.data());
+  } else if (entry->list == list) {
+    memcpy(lists_[list].data.data() + entry->row * stride_, row_.data(), stride_ * sizeof(float));
+  } else {
+    RemoveRow(entry);
+    AppendRow(entry, list, row_.data());
+  }
+  entry->time = time;
+  order_.emplace_back(time, std::move(key));
+  if (entries_.size() > params_.max_entries) Evict(Clock::time_point::min());
+  if (params_.nlist > 1 && entries_.size() >= std::max(params_.train_size, 4 * trained_size_)) Train();
+  return true;
+}
+
+size_t ReidIndex::Evict(Clock::time_point expire_before) {
+  size_t removed = 0;
+  while (!order_.empty() && (order_.front().first < expire_before || entries_.size() > params_.max_entries)) {
+    auto it = entries_.find(order_.front().second);
+    // a track seen again is kept, it is in the order again later
+    if (it != entries_.end() && it->second.time == order_.front().first) {
+      RemoveRow(&it->second);
+      entries_.erase(it);
+      ++removed;
+    }
+    order_.pop_front();
+  }
+  return removed;
+}
+
+void ReidIndex::Train() {
+  std::vector<Entry *> entries;
+  entries.reserve(entries_.size());
+  for (auto &it : entries_) entries.push_back(&it.second);
+  const size_t num = entries.size();
+  trained_size_ = num;
+  const size_t k = std::min(params_.nlist, num / kMinRowsPerList);
+  if (k <= 1) return;
+
+  // spherical k-means on samples spread over the index, the centroids start from samples
+  const size_t sample_num = std::min(num, k * kTrainRowsPerList);
+  std::vector<float> samples(sample_num * stride_);
+  for (size_t i = 0; i < sample_num; ++i) {
+    const Entry *entry = entries[i * num / sample_num];
+    memcpy(samples.data() + i * stride_, lists_[entry->list].data.data() + entry->row * stride_,
+           stride_ * sizeof(float));
+  }
+  centroids_.resize(k * stride_);
+  for (size_t c = 0; c < k; ++c) {
+    memcpy(centroids_.data() + c * stride_, samples.data() + c * sample_num / k * stride_, stride_ * sizeof(float));
+  }
+  std::vector<double> sums(k * stride_);
+  for (int iter = 0; iter < kTrainIterations; ++iter) {
+    std::fill(sums.begin(), sums.end(), 0.0);
+    for (size_t i = 0; i < sample_num; ++i) {
+      const float *sample = samples.data() + i * stride_;
+      double *sum = sums.data() + NearestList(sample) * stride_;
+      for (size_t d = 0; d < dim_; ++d) sum[d] += sample[d];
+    }
+    for (size_t c = 0; c < k; ++c) {
+      const double *sum = sums.data() + c * stride_;
+      double norm = 0;
+      for (size_t d = 0; d < dim_; ++d) norm += sum[d] * sum[d];
+      // an empty cluster keeps its centroid
+      if (norm <= 0) continue;
+      const double scale = 1.0 / std::sqrt(norm);
+      float *centroid = centroids_.data() + c * stride_;
+      for (size_t d = 0; d < dim_; ++d) centroid[d] = static_cast<float>(sum[d] * scale);
+    }
+  }
+
+  std::vector<List> old_lists(k);
+  lists_.swap(old_lists);
+  for (Entry *entry : entries) {
+    const float *row = old_lists[entry->list].data.data() + entry->row * stride_;
+    AppendRow(entry, static_cast<uint32_t>(NearestList(row)), row);
+  }
+}
+
+void ReidIndex::Search(const std::vector<ReidQuery> &queries, size_t top_k, float max_distance,
+                       bool cross_stream_only, std::vector<std::vector<ReidMatch>> *results) const {
+  const size_t num = queries.size();
+  results->assign(num, std::vector<ReidMatch>());
+  if (!num || !top_k || entries_.empty()) return;
+  std::vector<float> rows(num * stride_);
+  // the queries probing each list
+  std::vector<std::vector<uint32_t>> probes(lists_.size());
+  const size_t nprobe = std::min(std::max<size_t>(params_.nprobe, 1), lists_.size());
+  std::vector<std::pair<float, uint32_t>> scores(lists_.size());
+  for (uint32_t q = 0; q < num; ++q) {
+    float *row = rows.data() + q * stride_;
+    if (!queries[q].feature || !Normalize(queries[q].feature, row)) continue;
+    if (lists_.size() == 1) {
+      probes[0].push_back(q);
+      continue;
+    }
+    for (uint32_t l = 0; l < lists_.size(); ++l) {
+      scores[l] = std::make_pair(-Dot1(row, centroids_.data() + l * stride_, stride_), l);
+    }
+    std::partial_sort(scores.begin(), scores.begin() + nprobe, scores.end());
+    for (size_t i = 0; i < nprobe; ++i) probes[scores[i].second].push_back(q);
+  }
+
+  // the nearest tracks of each query are kept in a max-heap of top_k
+  using Candidate = std::pair<float, const Entry *>;
+  auto farther = [](const Candidate &a, const Candidate &b) { return a.first < b.first; };
+  std::vector<std::vector<Candidate>> heaps(num);
+  auto push = [&](uint32_t q, float distance, const Entry *entry) {
+    std::vector<Candidate> &heap = heaps[q];
+    if (distance > max_distance || (heap.size() == top_k && distance >= heap.front().first)) return;
+    const ReidQuery &query = queries[q];
+    if (entry->stream_id == query.stream_id && (cross_stream_only || entry->track_id == query.track_id)) return;
+    heap.emplace_back(distance, entry);
+    std::push_heap(heap.begin(), heap.end(), farther);
+    if (heap.size() > top_k) {
+      std::pop_heap(heap.begin(), heap.end(), farther);
+      heap.pop_back();
+    }
+  };
+  float dots[4];
+  for (size_t l = 0; l < lists_.size(); ++l) {
+    const std::vector<uint32_t> &list_queries = probes[l];
+    if (list_queries.empty()) continue;
+    const List &list = lists_[l];
+    const size_t list_rows = list.entries.size();
+    size_t r = 0;
+    // 4 rows of the list are computed with all the queries probing it
+    for (; r + 4 <= list_rows; r += 4) {
+      const float *a0 = list.data.data() + r * stride_;
+      for (uint32_t q : list_queries) {
+        Dot4(a0, a0 + stride_, a0 + 2 * stride_, a0 + 3 * stride_, rows.data() + q * stride_, stride_, dots);
+        for (size_t j = 0; j < 4; ++j) push(q, 1.f - dots[j], list.entries[r + j]);
+      }
+    }
+    for (; r < list_rows; ++r) {
+      const float *a = list.data.data() + r * stride_;
+      for (uint32_t q : list_queries) push(q, 1.f - Dot1(a, rows.data() + q * stride_, stride_), list.entries[r]);
+    }
+  }
+  for (size_t q = 0; q < num; ++q) {
+    std::vector<Candidate> &heap = heaps[q];
+    std::sort_heap(heap.begin(), heap.end(), farther);
+    std::vector<ReidMatch> &matches = (*results)[q];
+    matches.resize(heap.size());
+    for (size_t i = 0; i < heap.size(); ++i) {
+      matches[i].stream_id = heap[i].second->stream_id;
+      matches[i].track_id = heap[i].second->track_id;
+      matches[i].distance = heap[i].first;
+    }
+  }
+}
+
+}  // namespace cnstream
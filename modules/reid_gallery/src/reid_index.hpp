@@ -0,0 +1,148 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_REID_GALLERY_REID_INDEX_HPP_
+#define MODULES_REID_GALLERY_REID_INDEX_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief A track of the gallery matched by a query.
+ */
+struct ReidMatch {
+  std::string stream_id;
+  std::string track_id;
+  float distance = 0;  ///< The cosine distance to the query.
+};
+
+/**
+ * @brief A feature searched in the gallery.
+ */
+struct ReidQuery {
+  const float *feature = nullptr;  ///< ``Dim()`` floats, it is not required to be normalized.
+  std::string stream_id;           ///< The stream of the query.
+  std::string track_id;            ///< The track of the query, empty if the object is not tracked.
+};
+
+/**
+ * @class ReidIndex
+ *
+ * @brief ReidIndex is an inverted file (IVF) index over the latest feature of each track, searched by cosine
+ * distance.
+ *
+ * The features are L2 normalized and stored contiguously in the list of their nearest centroid, the rows are padded
+ * with zeros to a multiple of ``kRowAlign`` floats for the distance kernels. Until ``train_size`` tracks are added,
+ * the index has one list searched exhaustively. Then the centroids are trained by spherical k-means on the features
+ * in the index, and trained again each time the index grows 4 times larger than the features they were trained on.
+ * A query probes the ``nprobe`` lists with the nearest centroids, the queries probing a list are computed together
+ * while its rows are in cache.
+ *
+ * It is not thread-safe.
+ */
+class ReidIndex {
+ public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr size_t kRowAlign = 8;
+
+  struct Params {
+    size_t nlist = 64;            ///< The max number of lists.
+    size_t nprobe = 8;            ///< The number of lists searched by a query.
+    size_t train_size = 1024;     ///< The number of tracks the centroids are trained first on.
+    size_t max_entries = 100000;  ///< The max number of tracks, the oldest ones are evicted beyond it.
+  };
+
+  ReidIndex(size_t dim, const Params &params);
+  /**
+   * @brief Adds the feature of a track, or replaces it if the track is in the index.
+   *
+   * @param[in] stream_id The stream of the track.
+   * @param[in] track_id The track.
+   * @param[in] feature The feature of ``Dim()`` floats.
+   * @param[in] time The time the track is seen, see Evict.
+   *
+   * @return Returns false if the feature is zero, it is not added.
+   */
+  bool Add(const std::string &stream_id, const std::string &track_id, const float *feature, Clock::time_point time);
+  /**
+   * @brief Searches the nearest tracks of the queries.
+   *
+   * @param[in] queries The queries.
+   * @param[in] top_k The max number of tracks matched by a query.
+   * @param[in] max_distance The tracks farther than it are not matched.
+   * @param[in] cross_stream_only Whether the tracks of the stream of a query are skipped. The track of a query is
+   *                              skipped anyway.
+   * @param[out] results The tracks matched by each query, nearest first.
+   */
+  void Search(const std::vector<ReidQuery> &queries, size_t top_k, float max_distance, bool cross_stream_only,
+              std::vector<std::vector<ReidMatch>> *results) const;
+  /**
+   * @brief Removes the tracks not seen since a time.
+   *
+   * @param[in] expire_before The tracks seen before it are removed.
+   *
+   * @return Returns the number of tracks removed.
+   */
+  size_t Evict(Clock::time_point expire_before);
+
+  size_t Size() const { return entries_.size(); }
+  size_t Dim() const { return dim_; }
+  size_t ListNum() const { return lists_.size(); }
+
+ private:
+  struct Entry {
+    uint32_t list = 0;
+    uint32_t row = 0;
+    Clock::time_point time;
+    std::string stream_id;
+    std::string track_id;
+  };
+  struct List {
+    std::vector<float> data;       // rows of stride_ floats
+    std::vector<Entry *> entries;  // the entry of each row, entries are kept by entries_
+  };
+  // normalizes a feature into a padded row, returns false if it is zero
+  bool Normalize(const float *feature, float *row) const;
+  size_t NearestList(const float *row) const;
+  void AppendRow(Entry *entry, uint32_t list, const float *row);
+  void RemoveRow(Entry *entry);
+  void Train();
+
+  size_t dim_;
+  size_t stride_;
+  Params params_;
+  size_t trained_size_ = 0;       // the number of tracks the centroids are trained on, 0 before training
+  std::vector<float> centroids_;  // a row per list, empty before training
+  std::vector<List> lists_;
+  std::unordered_map<std::string, Entry> entries_;               // keyed by stream id and track id
+  std::deque<std::pair<Clock::time_point, std::string>> order_;  // the keys in the order they are seen
+  std::vector<float> row_;                                       // the row being added
+};  // class ReidIndex
+
+}  // namespace cnstream
+
+#endif  // MODULES_REID_GALLERY_REID_INDEX_HPP_
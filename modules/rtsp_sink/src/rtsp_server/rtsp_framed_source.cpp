@@ -103,19 +103,37 @@ void RtspFramedSource::doGetNextFrame() { deliverFrame(); }
 void RtspFramedSource::deliverFrame() {
   int frameSize;
   int bufferPercent = 0;
+  // the backlog is dropped from dropPercent full to under keepPercent, about one gop in low latency mode
+  const int dropPercent = fServer->param_.low_latency ? 10 : 80;
+  const int keepPercent = fServer->param_.low_latency ? 1 : 50;
 
   if (!isCurrentlyAwaitingData()) {
-    /* we're not ready for the data yet, just wait buffer fill to 80% full and then drop the beginning data. */
+    /* we're not ready for the data yet, just wait buffer fill to dropPercent full and then drop the beginning data. */
     while (1) {
       fServer->param_.get_packet(nullptr, 0, nullptr, &bufferPercent);
-      if (bufferPercent < 80) break;
+      if (bufferPercent < dropPercent) break;
       frameSize = fServer->param_.get_packet(nullptr, -1, nullptr, nullptr);
-      // LOGI(RtspFramedSource) << "deliverFrame() dropped " << frameSize << " bytes, for buffer is >= 80% full.";
+      // LOGI(RtspFramedSource) << "deliverFrame() dropped " << frameSize << " bytes, for buffer is too full.";
+      if (frameSize <= 0) break;
+      // the following frames refer to the dropped ones, restart from the next key frame
+      fFirstFrame = True;
     }
     return;
   }
 
-  frameSize = fServer->param_.get_packet(nullptr, 0, nullptr, nullptr);
+  frameSize = fServer->param_.get_packet(nullptr, 0, nullptr, &bufferPercent);
+  if (frameSize > 0) fServer->OnBacklog(bufferPercent);
+  if (frameSize > 0 && bufferPercent >= dropPercent) {
+    /* the clients fall too far behind, drop the backlog and restart from the next key frame */
+    LOGW(RtspFramedSource) << "deliverFrame() buffer is " << bufferPercent
+                           << "% full, drop frames to the next key frame";
+    while (frameSize > 0 && bufferPercent >= keepPercent) {
+      fServer->param_.get_packet(nullptr, -1, nullptr, nullptr);
+      bufferPercent = 0;
+      frameSize = fServer->param_.get_packet(nullptr, 0, nullptr, &bufferPercent);
+    }
+    fFirstFrame = True;
+  }
   if (frameSize > 0) {
     /* This should never happen, but check anyway.. */
     if (static_cast<unsigned>(frameSize) > fMaxSize) {
@@ -144,6 +162,8 @@ void RtspFramedSource::deliverFrame() {
       } else {
         // LOGI(RtspFramedSource) << "deliverFrame() skipped " << fFrameSize << " bytes before IDR frame.";
         fFrameSize = 0;
+        // look for the key frame in the queued packets
+        envir().taskScheduler().triggerEvent(fEventTriggerId, this);
         return;
       }
     }
@@ -162,18 +182,24 @@ void RtspFramedSource::deliverFrame() {
       fFrameSize -= offset;
     }
 
-    if (fInitPTS == -1) {
-      gettimeofday(&fInitTimestamp, nullptr);
-      fInitPTS = timestamp;
-    }
-    double pts = timestamp - fInitPTS;
-    int64_t pts_secs = static_cast<int64_t>(pts);
-    int64_t pts_usecs = (pts - pts_secs) * 1e6;
-    fPresentationTime.tv_sec = fInitTimestamp.tv_sec + pts_secs;
-    fPresentationTime.tv_usec = fInitTimestamp.tv_usec + pts_usecs;
-    if (fPresentationTime.tv_usec >= 1e6) {
-      fPresentationTime.tv_usec -= 1e6;
-      fPresentationTime.tv_sec++;
+    if (fServer->param_.low_latency) {
+      // the packets come at the pace of the source, present them at once instead of at their pts, which the
+      // receivers would buffer for if it drifts behind the wall clock
+      gettimeofday(&fPresentationTime, nullptr);
+    } else {
+      if (fInitPTS == -1) {
+        gettimeofday(&fInitTimestamp, nullptr);
+        fInitPTS = timestamp;
+      }
+      double pts = timestamp - fInitPTS;
+      int64_t pts_secs = static_cast<int64_t>(pts);
+      int64_t pts_usecs = (pts - pts_secs) * 1e6;
+      fPresentationTime.tv_sec = fInitTimestamp.tv_sec + pts_secs;
+      fPresentationTime.tv_usec = fInitTimestamp.tv_usec + pts_usecs;
+      if (fPresentationTime.tv_usec >= 1e6) {
+        fPresentationTime.tv_usec -= 1e6;
+        fPresentationTime.tv_sec++;
+      }
     }
     // fDurationInMicroseconds = 33333;
   } else {
@@ -20,11 +20,14 @@
 
 #include "rtsp_media_subsession.hpp"
 
+#include <algorithm>
+
 namespace cnstream {
 
-RtspMediaSubsession *RtspMediaSubsession::createNew(UsageEnvironment &env, StreamReplicator *replicator,
-                                                    RtspServer::CodecType codecType, Boolean discrete) {
-  return new RtspMediaSubsession(env, replicator, codecType, discrete);
+RtspMediaSubsession *RtspMediaSubsession::createNew(UsageEnvironment &env, RtspServer *server,
+                                                    StreamReplicator *replicator, RtspServer::CodecType codecType,
+                                                    Boolean discrete, Boolean reuseFirstSource) {
+  return new RtspMediaSubsession(env, server, replicator, codecType, discrete, reuseFirstSource);
 }
 
 FramedSource *RtspMediaSubsession::createNewStreamSource(unsigned clientSessionId, unsigned &estBitrate) {
@@ -67,4 +70,27 @@ RTPSink *RtspMediaSubsession::createNewRTPSink(Groupsock *rtpGroupsock, unsigned
   return nullptr;
 }
 
+RTCPInstance *RtspMediaSubsession::createRTCP(Groupsock *RTCPgs, unsigned totSessionBW, unsigned char const *cname,
+                                              RTPSink *sink) {
+  RTCPInstance *rtcp = OnDemandServerMediaSubsession::createRTCP(RTCPgs, totSessionBW, cname, sink);
+  if (rtcp && sink && fServer) {
+    RtcpClient &client = fRtcpClients[sink];
+    client.subsession = this;
+    client.sink = sink;
+    rtcp->setRRHandler(RtspMediaSubsession::onReceiverReport, &client);
+  }
+  return rtcp;
+}
+
+void RtspMediaSubsession::onReceiverReport(void *clientData) {
+  RtcpClient *client = reinterpret_cast<RtcpClient *>(clientData);
+  RTPTransmissionStatsDB::Iterator iter(client->sink->transmissionStatsDB());
+  RTPTransmissionStats *stats;
+  double fraction_lost = 0;
+  while ((stats = iter.next()) != nullptr) {
+    fraction_lost = std::max(fraction_lost, stats->packetLossRatio() / 256.0);
+  }
+  client->subsession->fServer->OnReceiverReport(fraction_lost);
+}
+
 }  // namespace cnstream
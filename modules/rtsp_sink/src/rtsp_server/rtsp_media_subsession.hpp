@@ -35,14 +35,17 @@
 #include <StreamReplicator.hh>
 #include <UsageEnvironment.hh>
 
+#include <map>
+
 #include "rtsp_server.hpp"
 
 namespace cnstream {
 
 class RtspMediaSubsession : public OnDemandServerMediaSubsession {
  public:
-  static RtspMediaSubsession *createNew(UsageEnvironment &env, StreamReplicator *replicator,  // NOLINT
-                                        RtspServer::CodecType codecType, Boolean discrete = True);
+  static RtspMediaSubsession *createNew(UsageEnvironment &env, RtspServer *server,  // NOLINT
+                                        StreamReplicator *replicator, RtspServer::CodecType codecType,
+                                        Boolean discrete = True, Boolean reuseFirstSource = False);
 
   void SetBitrate(uint64_t br) {
     if (br > 102400) {
@@ -53,9 +56,10 @@ class RtspMediaSubsession : public OnDemandServerMediaSubsession {
   }
 
  protected:
-  RtspMediaSubsession(UsageEnvironment &env, StreamReplicator *replicator,  // NOLINT
-                      RtspServer::CodecType codecType, Boolean discrete = True)
-      : OnDemandServerMediaSubsession(env, False),
+  RtspMediaSubsession(UsageEnvironment &env, RtspServer *server, StreamReplicator *replicator,  // NOLINT
+                      RtspServer::CodecType codecType, Boolean discrete = True, Boolean reuseFirstSource = False)
+      : OnDemandServerMediaSubsession(env, reuseFirstSource),
+        fServer(server),
         fReplicator(replicator),
         fCodecType(codecType),
         fDiscrete(discrete),
@@ -63,6 +67,18 @@ class RtspMediaSubsession : public OnDemandServerMediaSubsession {
   virtual FramedSource *createNewStreamSource(unsigned clientSessionId, unsigned &estBitrate);  // NOLINT
   virtual RTPSink *createNewRTPSink(Groupsock *rtpGroupsock, unsigned char rtpPayloadTypeIfDynamic,
                                     FramedSource *inputSource);
+  virtual RTCPInstance *createRTCP(Groupsock *RTCPgs, unsigned totSessionBW, unsigned char const *cname,
+                                   RTPSink *sink);
+
+  struct RtcpClient {
+    RtspMediaSubsession *subsession;
+    RTPSink *sink;
+  };
+  static void onReceiverReport(void *clientData);
+
+  RtspServer *fServer;
+  // an RR handler is never called after its sink is closed, there is one client per sink address at a time
+  std::map<RTPSink *, RtcpClient> fRtcpClients;
   StreamReplicator *fReplicator;
   uint64_t fCodecType;
   Boolean fDiscrete;
@@ -18,6 +18,7 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <algorithm>
 #include <string>
 
 #include "BasicUsageEnvironment.hh"
@@ -69,6 +70,38 @@ void RtspServer::OnEvent(Event event) {
   if (source_) source_->onEvent(event);
 }
 
+void RtspServer::OnBacklog(int buffer_percent) { backlog_percent_ = std::max(backlog_percent_, buffer_percent); }
+
+void RtspServer::OnReceiverReport(double fraction_lost) { fraction_lost_ = std::max(fraction_lost_, fraction_lost); }
+
+void RtspServer::ControlRate() {
+  static constexpr int64_t kIntervalUs = 1000000;
+  static constexpr double kMinRateScale = 0.25;
+  static constexpr int kStableIntervals = 5;
+  // the slowest client holds the replicator, so the packets queued for the server are its send backlog
+  bool congested = backlog_percent_ >= 50 || fraction_lost_ >= 0.05;
+  bool stable = backlog_percent_ < 10 && fraction_lost_ < 0.01;
+  double scale = rate_scale_;
+  if (congested) {
+    scale = std::max(kMinRateScale, rate_scale_ * 0.7);
+    stable_count_ = 0;
+  } else if (!stable) {
+    stable_count_ = 0;
+  } else if (++stable_count_ >= kStableIntervals) {
+    scale = std::min(1.0, rate_scale_ + 0.1);
+    stable_count_ = 0;
+  }
+  if (scale != rate_scale_) {
+    LOGI(RtspServer) << "ControlRate() backlog " << backlog_percent_ << "%, fraction lost " << fraction_lost_
+                     << ", rate scale " << rate_scale_ << " -> " << scale;
+    rate_scale_ = scale;
+    param_.rate_control(rate_scale_);
+  }
+  backlog_percent_ = 0;
+  fraction_lost_ = 0;
+  env_->taskScheduler().scheduleDelayedTask(kIntervalUs, RtspServer::ControlRateStub, this);
+}
+
 void RtspServer::Loop() {
   TaskScheduler *scheduler;
   UsageEnvironment *env;
@@ -96,7 +129,8 @@ void RtspServer::Loop() {
     StreamReplicator *replicator = StreamReplicator::createNew(*env, source_, false);
     char const *descriptionString = "RTSP Live Streaming Session";
     ServerMediaSession *sms = ServerMediaSession::createNew(*env, streamName, streamName, descriptionString);
-    RtspMediaSubsession *sub = RtspMediaSubsession::createNew(*env, replicator, param_.codec_type, !param_.stream_mode);
+    RtspMediaSubsession *sub = RtspMediaSubsession::createNew(*env, this, replicator, param_.codec_type,
+                                                              !param_.stream_mode, param_.shared_rtp);
     sub->SetBitrate(param_.bit_rate);
     sms->addSubsession(sub);
     rtspServer->addServerMediaSession(sms);
@@ -105,6 +139,14 @@ void RtspServer::Loop() {
     LOGI(RtspServer) << "\033[36m Stream URL \"" << url << "\"\033[0m";
     delete[] url;
 
+    env_ = env;
+    if (param_.rate_control) {
+      // the delayed task is released with the scheduler
+      rate_scale_ = 1;
+      stable_count_ = 0;
+      env->taskScheduler().scheduleDelayedTask(1000000, RtspServer::ControlRateStub, this);
+    }
+
     // signal(SIGNIT,sighandler);
     env->taskScheduler().doEventLoop(&quit_);  // does not return
 
@@ -25,9 +25,12 @@
 #include <thread>
 #include <string>
 
+class UsageEnvironment;
+
 namespace cnstream {
 
 class RtspFramedSource;
+class RtspMediaSubsession;
 
 class RtspServer {
  public:
@@ -38,6 +41,8 @@ class RtspServer {
   };
 
   using GetPacket = std::function<int(uint8_t *, int, double *, int *)>;
+  // called in the server thread with the ratio of the encoding rate the clients can afford, in [0.25, 1]
+  using RateControl = std::function<void(double)>;
 
   struct Param {
     int port = 8554;
@@ -49,6 +54,11 @@ class RtspServer {
     uint32_t bit_rate;
     CodecType codec_type = H264;
     GetPacket get_packet = nullptr;
+    RateControl rate_control = nullptr;  // adaptive rate is enabled if it is set
+    // the clients share one RTP sink, so each frame is packetized once for all of them instead of once per client
+    bool shared_rtp = false;
+    // the packets are presented at the time they are delivered, and the backlog of slow clients is dropped sooner
+    bool low_latency = false;
   };
 
   enum Event {
@@ -65,14 +75,25 @@ class RtspServer {
   void OnEvent(Event event);
 
   friend class RtspFramedSource;
+  friend class RtspMediaSubsession;
 
  private:
   void Loop();
+  static void ControlRateStub(void *client_data) { (reinterpret_cast<RtspServer *>(client_data))->ControlRate(); }
+  void ControlRate();
+  void OnBacklog(int buffer_percent);
+  void OnReceiverReport(double fraction_lost);
 
   Param param_;
   char quit_ = 1;
   std::thread thread_;
   RtspFramedSource *source_ = nullptr;
+  // the following are accessed in the server thread only
+  UsageEnvironment *env_ = nullptr;
+  int backlog_percent_ = 0;
+  double fraction_lost_ = 0;
+  double rate_scale_ = 1;
+  int stable_count_ = 0;
 };  // RtspServer
 
 }  // namespace cnstream
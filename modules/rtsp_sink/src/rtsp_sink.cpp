@@ -20,12 +20,16 @@
 
 #include "rtsp_sink.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "cnstream_pipeline.hpp"
 #include "rtsp_server/rtsp_server.hpp"
-#include "video/video_stream/video_stream.hpp"
+#include "video/video_stream/video_stream_bus.hpp"
 
 namespace cnstream {
 
@@ -43,13 +47,63 @@ typedef struct RtspSinkParam {
   int tile_cols = 0;
   int tile_rows = 0;
   bool resample = false;
+  bool share_encoder = false;
+  bool adaptive_rate = false;
+  bool shared_rtp = false;
+  int server_threads = 1;
+  bool low_latency = false;
 } RtspSinkParam;
 
 struct RtspSinkContext {
-  std::unique_ptr<VideoStream> stream = nullptr;
+  std::unique_ptr<VideoStreamBus::Subscriber> stream = nullptr;
   std::unique_ptr<RtspServer> server = nullptr;
+  // the other servers listening on the same port, each one reads the packets from its own subscriber
+  std::vector<std::unique_ptr<VideoStreamBus::Subscriber>> shard_streams;
+  std::vector<std::unique_ptr<RtspServer>> shard_servers;
+  // set by the rtsp servers, the lowest one is applied to the video stream in Process
+  std::mutex rate_mtx;
+  std::vector<double> rate_scales;
+  std::atomic<double> rate_scale{1};
+  double applied_rate_scale = 1;
+  double frame_rate = 0;
+  uint64_t rate_dropped_frames = 0;  // the frames dropped by the frame rate control, reported to the profiler
 };
 
+// Frames decoded on MLU and not touched on CPU are passed to the MLU encoder from MLU memory directly. The frame is
+// resized on MLU if needed, which requires CNCV.
+static bool IsMluFrameAvailable(const CNDataFramePtr &frame, int device_id) {
+#ifdef HAVE_CNCV
+  if (frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 &&
+      frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21) {
+    return false;
+  }
+  if (frame->ctx.dev_type != DevContext::DevType::MLU || frame->dst_device_id != device_id) return false;
+  // the BGR image may have been modified, e.g. by osd
+  if (frame->HasBGRImage()) return false;
+  for (int i = 0; i < 2; ++i) {
+    if (!frame->data[i]) return false;
+    CNSyncedMemory::SyncedHead head = frame->data[i]->GetHead();
+    if (head != CNSyncedMemory::SyncedHead::HEAD_AT_MLU && head != CNSyncedMemory::SyncedHead::SYNCED) return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+static void DestroyContext(RtspSinkContext *ctx) {
+  if (!ctx) return;
+  for (auto &stream : ctx->shard_streams) {
+    if (stream) stream->Close();
+  }
+  for (auto &server : ctx->shard_servers) {
+    if (server) server->Stop();
+  }
+  if (ctx->stream) ctx->stream->Close();
+  if (ctx->server) ctx->server->Stop();
+  delete ctx;
+}
+
 RtspSinkContext *RtspSink::GetContext(CNFrameInfoPtr data) {
   auto params = param_helper_->GetParams();
   std::lock_guard<std::mutex> lk(ctx_lock_);
@@ -84,7 +138,7 @@ RtspSinkContext *RtspSink::GetContext(CNFrameInfoPtr data) {
 RtspSinkContext * RtspSink::CreateContext(CNFrameInfoPtr data, const std::string &stream_id) {
   if (data->IsEos()) return nullptr;
 
-  CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
   auto params = param_helper_->GetParams();
   RtspSinkContext *ctx = new RtspSinkContext;
 
@@ -106,15 +160,13 @@ RtspSinkContext * RtspSink::CreateContext(CNFrameInfoPtr data, const std::string
   sparam.codec_type = VideoCodecType::H264;
   sparam.mlu_encoder = params.mlu_encoder;
   sparam.device_id = params.device_id;
-  ctx->stream.reset(new VideoStream(sparam));
-  if (!ctx->stream) {
-    LOGE(RtspSink) << "CreateContext() create video stream failed";
-    delete ctx;
-    return nullptr;
-  }
+  sparam.mlu_input = params.mlu_input_frame;
+  sparam.low_latency = params.low_latency;
 
-  auto get_packet = [time_base](VideoStream *stream, uint8_t *data, int size, double *timestamp, int *buffer_percent) {
-    if (!stream) return -1;
+  // packets are queued in the subscriber of video stream bus, and pulled by the rtsp server
+  auto get_packet = [time_base](std::unique_ptr<VideoStreamBus::Subscriber> *stream, uint8_t *data, int size,
+                                double *timestamp, int *buffer_percent) {
+    if (!*stream) return -1;
     VideoPacket packet, *pkt;
     VideoStream::PacketInfo info;
     memset(&packet, 0, sizeof(VideoPacket));
@@ -128,7 +180,7 @@ RtspSinkContext * RtspSink::CreateContext(CNFrameInfoPtr data, const std::string
       packet.size = size;
       pkt = &packet;
     }
-    int ret = stream->GetPacket(pkt, &info);
+    int ret = (*stream)->GetPacket(pkt, &info);
     if (ret > 0) {
       if (pkt && timestamp) *timestamp = static_cast<double>(pkt->pts) / time_base;
       if (buffer_percent) *buffer_percent = info.buffer_size * 100 / info.buffer_capacity;
@@ -144,18 +196,10 @@ RtspSinkContext * RtspSink::CreateContext(CNFrameInfoPtr data, const std::string
   rparam.height = sparam.height;
   rparam.bit_rate = sparam.bit_rate;
   rparam.codec_type = sparam.codec_type == VideoCodecType::H264 ? RtspServer::H264 : RtspServer::H265;
-  rparam.get_packet = std::bind(get_packet, ctx->stream.get(), std::placeholders::_1, std::placeholders::_2,
-                                std::placeholders::_3, std::placeholders::_4);
-  ctx->server.reset(new RtspServer(rparam));
-  if (!ctx->server) {
-    LOGE(RtspSink) << "CreateContext() create rtsp server failed";
-    delete ctx;
-    return nullptr;
-  }
-  if (!ctx->server->Start()) {
-    LOGE(RtspSink) << "CreateContext() start rtsp server failed";
-    delete ctx;
-    return nullptr;
+  rparam.shared_rtp = params.shared_rtp;
+  rparam.low_latency = params.low_latency;
+  if (params.adaptive_rate) {
+    ctx->frame_rate = sparam.frame_rate > 0 && sparam.frame_rate <= 60 ? sparam.frame_rate : 25;
   }
 
   auto event_callback = [](RtspServer *server, VideoStream::Event event) {
@@ -170,13 +214,40 @@ RtspSinkContext * RtspSink::CreateContext(CNFrameInfoPtr data, const std::string
     }
   };
 
-  if (!ctx->stream->Open()) {
-    LOGE(RtspSink) << "CreateContext() open video stream failed";
-    ctx->server->Stop();
-    delete ctx;
-    return nullptr;
+  std::string channel = (GetContainer() ? GetContainer()->GetName() : "") + "/";
+  channel += (params.share_encoder ? "" : GetName() + "/") + stream_id;
+  // the servers of a stream share the port, the kernel spreads the rtsp connections to their event loops
+  const int server_num = std::max(params.server_threads, 1);
+  ctx->shard_streams.resize(server_num - 1);
+  ctx->shard_servers.resize(server_num - 1);
+  ctx->rate_scales.assign(server_num, 1);
+  for (int i = 0; i < server_num; ++i) {
+    std::unique_ptr<VideoStreamBus::Subscriber> *stream = i ? &ctx->shard_streams[i - 1] : &ctx->stream;
+    std::unique_ptr<RtspServer> *server = i ? &ctx->shard_servers[i - 1] : &ctx->server;
+    rparam.get_packet = std::bind(get_packet, stream, std::placeholders::_1, std::placeholders::_2,
+                                  std::placeholders::_3, std::placeholders::_4);
+    if (params.adaptive_rate) {
+      rparam.rate_control = [ctx, i](double scale) {
+        std::lock_guard<std::mutex> lk(ctx->rate_mtx);
+        ctx->rate_scales[i] = scale;
+        ctx->rate_scale = *std::min_element(ctx->rate_scales.begin(), ctx->rate_scales.end());
+      };
+    }
+    server->reset(new RtspServer(rparam));
+    // subscribe before starting the server, packets of a shared stream may come at once
+    *stream = VideoStreamBus::Subscribe(channel, sparam, nullptr,
+                                        std::bind(event_callback, server->get(), std::placeholders::_1));
+    if (!*stream) {
+      LOGE(RtspSink) << "CreateContext() open video stream failed";
+      DestroyContext(ctx);
+      return nullptr;
+    }
+    if (!(*server)->Start()) {
+      LOGE(RtspSink) << "CreateContext() start rtsp server failed";
+      DestroyContext(ctx);
+      return nullptr;
+    }
   }
-  ctx->stream->SetEventCallback(std::bind(event_callback, ctx->server.get(), std::placeholders::_1));
 
   contexts_[stream_id] = ctx;
   return ctx;
@@ -200,10 +271,20 @@ bool RtspSink::Open(ModuleParamSet paramSet) {
     LOGE(RtspSink) << "Open() mlu encoder, but specified device_id < 0";
     return false;
   }
+#ifndef HAVE_CNCV
   if (params.mlu_input_frame && (params.tile_cols > 1 || params.tile_rows > 1)) {
-    LOGE(RtspSink) << "Open() mlu input tiling is not supported";
+    LOGE(RtspSink) << "Open() mlu input tiling is not supported. Please install CNCV.";
     return false;
   }
+#endif
+  if (params.server_threads < 1 || (params.server_threads > 1 && params.rtsp_over_http)) {
+    LOGE(RtspSink) << "Open() server_threads should be at least 1, and only 1 with rtsp_over_http, for the two"
+                   << " connections of a tunnel must reach the same server";
+    return false;
+  }
+  if (params.adaptive_rate && params.share_encoder) {
+    LOGW(RtspSink) << "Open() adaptive rate changes the encoding shared with the other modules";
+  }
   return true;
 }
 
@@ -212,12 +293,7 @@ void RtspSink::Close() {
     return;
   }
   for (auto &it : contexts_) {
-    RtspSinkContext *ctx = it.second;
-    if (ctx) {
-      if (ctx->stream) ctx->stream->Close();
-      if (ctx->server) ctx->server->Stop();
-      delete ctx;
-    }
+    DestroyContext(it.second);
   }
   contexts_.clear();
 }
@@ -230,15 +306,37 @@ int RtspSink::Process(CNFrameInfoPtr data) {
     return -1;
   }
 
-  CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
 
-  if (!params.mlu_input_frame) {
-    if (!ctx->stream->Update(frame->ImageBGR(), VideoStream::ColorFormat::BGR, data->timestamp, data->stream_id)) {
+  if (params.adaptive_rate) {
+    double scale = ctx->rate_scale;
+    if (scale != ctx->applied_rate_scale) {
+      // lower the bit rate first, frames are dropped if the encoder can not change bit rate or it is not enough
+      bool bit_rate_changed = ctx->stream->SetBitRate(params.bit_rate * scale);
+      double frame_scale = bit_rate_changed ? std::min(1.0, scale * 2) : scale;
+      ctx->stream->SetFrameRate(frame_scale < 1 ? ctx->frame_rate * frame_scale : 0);
+      ctx->applied_rate_scale = scale;
+      LOGI(RtspSink) << "Process() stream " << data->stream_id << " rate scale " << scale << ", bit rate "
+                     << (bit_rate_changed ? "changed" : "unchanged") << ", frame rate "
+                     << ctx->frame_rate * frame_scale;
+    }
+  }
+
+  bool mlu_input_frame = params.mlu_input_frame;
+  // resample is disabled in low latency mode
+  if (!mlu_input_frame && params.mlu_encoder && params.tile_cols <= 1 && params.tile_rows <= 1 &&
+      (!params.resample || params.low_latency)) {
+    mlu_input_frame = IsMluFrameAvailable(frame, params.device_id);
+  }
+
+  if (!mlu_input_frame) {
+    if (!ctx->stream->Update(frame->ImageBGR(), VideoStream::ColorFormat::BGR, data->timestamp, data->stream_id,
+                             frame->frame_id)) {
       LOGE(RtspSink) << "Process() video stream update failed";
     }
   } else {
 #ifndef HAVE_CNCV
-    if (params.mlu_input_frame && params.mlu_encoder) {
+    if (params.mlu_encoder) {
       LOGE(RtspSink) << "Process() Encode mlu input frame on mlu is not supported. Please install CNCV.";
       return -1;
     }
@@ -258,11 +356,21 @@ int RtspSink::Process(CNFrameInfoPtr data) {
     buffer.color = frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 ? VideoStream::ColorFormat::YUV_NV12
                                                                            : VideoStream::ColorFormat::YUV_NV21;
     buffer.mlu_device_id = frame->dst_device_id;
-    if (!ctx->stream->Update(&buffer, data->timestamp, data->stream_id)) {
+    if (!ctx->stream->Update(&buffer, data->timestamp, data->stream_id, frame->frame_id)) {
       LOGE(RtspSink) << "Process() video stream update failed";
     }
   }
 
+  if (params.adaptive_rate) {
+    const uint64_t rate_dropped_frames = ctx->stream->GetRateDroppedFrames();
+    ModuleProfiler *profiler = GetProfiler();
+    if (profiler && rate_dropped_frames > ctx->rate_dropped_frames) {
+      profiler->RecordDropped(data->stream_id, kDROP_REASON_RATE_CONTROL,
+                              rate_dropped_frames - ctx->rate_dropped_frames);
+    }
+    ctx->rate_dropped_frames = rate_dropped_frames;
+  }
+
   return 0;
 }
 
@@ -292,7 +400,9 @@ RtspSink::RtspSink(const std::string &name) : Module(name) {
        ModuleParamParser<int>::Parser, "int"},
       {"encoder_type", "mlu", "Selection for encoder type. It should be 'mlu' or 'cpu.", PARAM_OPTIONAL,
        OFFSET(RtspSinkParam, mlu_encoder), input_encoder_type_parser, "bool"},
-      {"input_frame", "cpu", "Frame source type. It should be 'mlu' or 'cpu'.", PARAM_OPTIONAL,
+      {"input_frame", "cpu", "Frame source type. It should be 'mlu' or 'cpu'."
+       " With 'cpu', frames decoded on MLU and not changed on CPU are still encoded from MLU memory if mlu encoder"
+       " is used.", PARAM_OPTIONAL,
        OFFSET(RtspSinkParam, mlu_input_frame), input_encoder_type_parser, "bool"},
       {"dst_width", "0", "Output video width. 0 means dst width is same with source", PARAM_OPTIONAL,
        OFFSET(RtspSinkParam, width), ModuleParamParser<int>::Parser, "int"},
@@ -310,6 +420,27 @@ RtspSink::RtspSink(const std::string &name) : Module(name) {
        OFFSET(RtspSinkParam, tile_rows), ModuleParamParser<int>::Parser, "int"},
       {"resample", "false", "Resample frame with canvas, only support cpu input.", PARAM_OPTIONAL,
        OFFSET(RtspSinkParam, resample), ModuleParamParser<bool>::Parser, "bool"},
+      {"share_encoder", "false",
+       "Share one encoder with the other Encode and RtspSink modules in the pipeline, which encode the same stream"
+       " with the same parameters.", PARAM_OPTIONAL, OFFSET(RtspSinkParam, share_encoder),
+       ModuleParamParser<bool>::Parser, "bool"},
+      {"adaptive_rate", "false",
+       "Lower the bit rate and frame rate when the clients fall behind or report packet losses, and restore them"
+       " when the network recovers. The bit rate is changed by cpu encoder only.", PARAM_OPTIONAL,
+       OFFSET(RtspSinkParam, adaptive_rate), ModuleParamParser<bool>::Parser, "bool"},
+      {"shared_rtp", "false",
+       "The clients of a stream share one RTP sink, so that each frame is packetized once for all of them."
+       " The clients joining later start from the frame being sent instead of a key frame.", PARAM_OPTIONAL,
+       OFFSET(RtspSinkParam, shared_rtp), ModuleParamParser<bool>::Parser, "bool"},
+      {"server_threads", "1",
+       "How many rtsp servers of a stream listen on the same port, each with its own event loop thread. The client"
+       " connections are spread to them by the kernel. Not supported with rtsp_over_http.", PARAM_OPTIONAL,
+       OFFSET(RtspSinkParam, server_threads), ModuleParamParser<int>::Parser, "int"},
+      {"low_latency", "false",
+       "Encode each frame at once without pre-buffering or resampling, encode without B frames or lookahead, and send"
+       " the packets at once. The tiled canvas is still encoded at frame_rate. The clients falling about one gop"
+       " behind skip to the next key frame.", PARAM_OPTIONAL, OFFSET(RtspSinkParam, low_latency),
+       ModuleParamParser<bool>::Parser, "bool"},
       {"udp_port", "", "Replaced by port", PARAM_DEPRECATED},
       {"http_port", "", "Replaced by rtsp_over_http", PARAM_DEPRECATED},
       {"kbit_rate", "", "Replaced by bit_rate", PARAM_DEPRECATED},
@@ -332,23 +463,13 @@ void RtspSink::OnEos(const std::string &stream_id) {
     tile_streams_.erase(stream_id);
     if (tile_streams_.empty()) {
       LOGI(RtspSink) << "OnEos() all streams stopped";
-      RtspSinkContext *ctx = contexts_.begin()->second;
-      if (ctx) {
-        if (ctx->stream) ctx->stream->Close();
-        if (ctx->server) ctx->server->Stop();
-        delete ctx;
-      }
+      DestroyContext(contexts_.begin()->second);
       contexts_.clear();
     }
   } else {
     auto search = contexts_.find(stream_id);
     if (search != contexts_.end()) {
-      RtspSinkContext *ctx = search->second;
-      if (ctx) {
-        if (ctx->stream) ctx->stream->Close();
-        if (ctx->server) ctx->server->Stop();
-        delete ctx;
-      }
+      DestroyContext(search->second);
       contexts_.erase(stream_id);
     }
   }
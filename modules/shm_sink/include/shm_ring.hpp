@@ -0,0 +1,187 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_SHM_RING_HPP_
+#define MODULES_SHM_RING_HPP_
+
+/**
+ *  @file shm_ring.hpp
+ *
+ *  This file contains a declaration of the ShmRingWriter and ShmRingReader classes.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cnstream {
+
+struct ShmRingHeader;
+struct ShmRingSlot;
+
+/**
+ * @class ShmRingWriter
+ *
+ * @brief ShmRingWriter publishes messages into a ring of fixed size slots in POSIX shared memory.
+ *
+ * The ring has one writer and any number of readers in other processes. Every message has a sequence number starting
+ * from 1. The writer never waits for readers, it overwrites the oldest slot when the ring is full. Each slot is
+ * guarded by a sequence lock, so that readers detect the slots overwritten while they are being copied.
+ *
+ * The layout of the shared memory (native endian, all fields are naturally aligned):
+ *
+ * @verbatim
+ * header := magic(u32 "CNSR") version(u32) slot_count(u32) slot_size(u32) write_seq(u64) padding to 64 bytes
+ * slot   := lock(u64) result_size(u32) thumbnail_size(u32) result thumbnail, padded to 16 + slot_size bytes
+ * @endverbatim
+ *
+ * write_seq is the sequence number of the last published message. The slot of message n is (n - 1) % slot_count,
+ * its lock is 2n - 1 while the message is written and 2n after it is published.
+ *
+ * @note The functions of a writer must not be called concurrently.
+ */
+class ShmRingWriter {
+ public:
+  static constexpr uint32_t kMagic = 0x52534E43;  ///< "CNSR" in little-endian.
+  static constexpr uint32_t kVersion = 1;         ///< The version of the layout.
+
+  ShmRingWriter() = default;
+  ~ShmRingWriter();
+  ShmRingWriter(const ShmRingWriter &) = delete;
+  ShmRingWriter &operator=(const ShmRingWriter &) = delete;
+
+  /**
+   * @brief Creates the shared memory. The existing one with the same name is replaced, readers attached to it
+   *        should attach again.
+   *
+   * @param[in] name The name of the shared memory, e.g. "cnstream_results" for /dev/shm/cnstream_results.
+   * @param[in] slot_count The number of slots.
+   * @param[in] slot_size The max size of the result and the thumbnail of a message in bytes.
+   *
+   * @return Returns false if the shared memory fails to be created.
+   */
+  bool Create(const std::string &name, uint32_t slot_count, uint32_t slot_size);
+
+  /**
+   * @brief Publishes a message. It never blocks.
+   *
+   * @param[in] result The result, e.g. a message encoded by InferObjsCodec.
+   * @param[in] result_size The size of the result.
+   * @param[in] thumbnail The thumbnail, could be nullptr.
+   * @param[in] thumbnail_size The size of the thumbnail. The thumbnail is dropped if the message does not fit in
+   *            a slot with it.
+   *
+   * @return Returns the sequence number of the message. Returns 0 if the ring is not created or the result is larger
+   *         than a slot.
+   */
+  uint64_t Write(const void *result, size_t result_size, const void *thumbnail = nullptr, size_t thumbnail_size = 0);
+
+  /**
+   * @brief Unmaps and removes the shared memory. Readers attached keep their mappings.
+   *
+   * @return No return value.
+   */
+  void Destroy();
+
+  /**
+   * @brief Gets the sequence number of the last published message.
+   *
+   * @return Returns the sequence number, 0 if none is published.
+   */
+  uint64_t LastSequence() const;
+
+ private:
+  std::string name_;
+  void *base_ = nullptr;
+  size_t size_ = 0;
+  ShmRingHeader *header_ = nullptr;
+};  // class ShmRingWriter
+
+/**
+ * @class ShmRingReader
+ *
+ * @brief ShmRingReader reads the messages published by a ShmRingWriter in another process.
+ *
+ * The ring is mapped read-only, readers do not disturb the writer or each other. A reader falling behind by more than
+ * the number of slots skips the overwritten messages and counts them as dropped.
+ */
+class ShmRingReader {
+ public:
+  /**
+   * @brief The status of reading.
+   */
+  enum class Status {
+    OK,       ///< A message is read.
+    EMPTY,    ///< No new message is published.
+    ERROR,    ///< The reader is not attached.
+  };
+
+  ShmRingReader() = default;
+  ~ShmRingReader();
+  ShmRingReader(const ShmRingReader &) = delete;
+  ShmRingReader &operator=(const ShmRingReader &) = delete;
+
+  /**
+   * @brief Attaches to the shared memory created by a ShmRingWriter.
+   *
+   * @param[in] name The name of the shared memory.
+   * @param[in] from_oldest Reads from the oldest message kept in the ring if true, otherwise reads the messages
+   *            published after attaching.
+   *
+   * @return Returns false if the shared memory does not exist or it is not a ring.
+   */
+  bool Attach(const std::string &name, bool from_oldest = false);
+
+  /**
+   * @brief Reads the next message.
+   *
+   * @param[out] result The result of the message.
+   * @param[out] thumbnail The thumbnail of the message, could be nullptr. It is empty if the message has no
+   *             thumbnail.
+   * @param[out] seq The sequence number of the message, could be nullptr.
+   *
+   * @return Returns Status::OK if a message is read.
+   */
+  Status Read(std::string *result, std::string *thumbnail = nullptr, uint64_t *seq = nullptr);
+
+  /**
+   * @brief Detaches from the shared memory.
+   *
+   * @return No return value.
+   */
+  void Detach();
+
+  /**
+   * @brief Gets the number of messages overwritten before being read.
+   *
+   * @return Returns the number of dropped messages.
+   */
+  uint64_t Dropped() const { return dropped_; }
+
+ private:
+  const void *base_ = nullptr;
+  size_t size_ = 0;
+  const ShmRingHeader *header_ = nullptr;
+  uint64_t next_seq_ = 1;
+  uint64_t dropped_ = 0;
+};  // class ShmRingReader
+
+}  // namespace cnstream
+
+#endif  // MODULES_SHM_RING_HPP_
@@ -0,0 +1,119 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_SHM_SINK_HPP_
+#define MODULES_SHM_SINK_HPP_
+
+/**
+ *  @file shm_sink.hpp
+ *
+ *  This file contains a declaration of the ShmSink class.
+ */
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_module.hpp"
+#include "shm_ring.hpp"
+
+namespace cnstream {
+
+/**
+ * @class ShmSink
+ *
+ * @brief ShmSink publishes the results of every frame into a shared memory ring for processes on the same host.
+ *
+ * The results are encoded by InferObjsCodec, the frame can be published with a JPEG thumbnail. Consumers read the ring
+ * by ShmRingReader in C++ or python/samples/shm_ring_reader.py in python. Publishing never waits for the consumers,
+ * the oldest messages are overwritten when the ring is full.
+ */
+class ShmSink : public Module, public ModuleCreator<ShmSink> {
+ public:
+  /**
+   * @brief Constructs a ShmSink object.
+   *
+   * @param[in] name The name of this module.
+   *
+   * @return No return value.
+   */
+  explicit ShmSink(const std::string &name);
+
+  /**
+   * @brief Destructs a ShmSink object.
+   *
+   * @return No return value.
+   */
+  ~ShmSink();
+
+  /**
+   * @brief Creates the shared memory ring.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the ring is created successfully.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Removes the shared memory ring.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+
+  /**
+   * @brief Publishes the results and the thumbnail of a frame.
+   *
+   * @param[in] data The frame.
+   *
+   * @return Returns 0, frames are never blocked by the consumers.
+   */
+  int Process(std::shared_ptr<CNFrameInfo> data) override;
+
+  /**
+   * @brief Checks whether the pixels of frames are read.
+   *
+   * @return Returns true if thumbnails are published.
+   */
+  bool NeedsPixels() const override { return thumbnail_width_ > 0; }
+
+  /**
+   * @brief Checks the parameters of this module.
+   *
+   * @param[in] paramSet The parameters of this module.
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool CheckParamSet(const ModuleParamSet &paramSet) const override;
+
+ private:
+  bool EncodeThumbnail(const std::shared_ptr<CNFrameInfo> &data, std::string *thumbnail) const;
+
+  ShmRingWriter writer_;
+  std::mutex writer_mutex_;
+  uint8_t codec_flags_ = 0;
+  int thumbnail_width_ = 0;  // 0 means no thumbnail
+  int thumbnail_quality_ = 80;
+};  // class ShmSink
+
+}  // namespace cnstream
+
+#endif  // MODULES_SHM_SINK_HPP_
@@ -0,0 +1,235 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "shm_ring.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+constexpr uint32_t ShmRingWriter::kMagic;
+constexpr uint32_t ShmRingWriter::kVersion;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the ring needs lock-free 64-bit atomics to be shared by processes");
+
+struct ShmRingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t slot_size;
+  std::atomic<uint64_t> write_seq;
+  char padding[40];
+};  // struct ShmRingHeader
+
+struct ShmRingSlot {
+  std::atomic<uint64_t> lock;
+  std::atomic<uint32_t> result_size;
+  std::atomic<uint32_t> thumbnail_size;
+};  // struct ShmRingSlot
+
+static_assert(sizeof(ShmRingHeader) == 64, "the layout of the header is shared with readers in other languages");
+static_assert(sizeof(ShmRingSlot) == 16, "the layout of the slot is shared with readers in other languages");
+
+static std::string ShmPath(const std::string& name) { return name.empty() || name[0] != '/' ? "/" + name : name; }
+
+static size_t SlotStride(uint32_t slot_size) {
+  return (sizeof(ShmRingSlot) + slot_size + 15) & ~static_cast<size_t>(15);
+}
+
+static ShmRingSlot* SlotAt(void* base, const ShmRingHeader* header, uint64_t seq) {
+  size_t index = static_cast<size_t>((seq - 1) % header->slot_count);
+  return reinterpret_cast<ShmRingSlot*>(static_cast<char*>(base) + sizeof(ShmRingHeader) +
+                                        index * SlotStride(header->slot_size));
+}
+
+ShmRingWriter::~ShmRingWriter() { Destroy(); }
+
+bool ShmRingWriter::Create(const std::string& name, uint32_t slot_count, uint32_t slot_size) {
+  Destroy();
+  if (slot_count == 0 || slot_size == 0) {
+    LOGE(ShmSink) << "ShmRingWriter::Create() slot count and slot size should be positive";
+    return false;
+  }
+  std::string path = ShmPath(name);
+  shm_unlink(path.c_str());
+  int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    LOGE(ShmSink) << "ShmRingWriter::Create() shm_open " << path << " failed, " << strerror(errno);
+    return false;
+  }
+  size_t size = sizeof(ShmRingHeader) + slot_count * SlotStride(slot_size);
+  void* base = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+    base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) {
+    LOGE(ShmSink) << "ShmRingWriter::Create() map " << size << " bytes failed, " << strerror(errno);
+    shm_unlink(path.c_str());
+    return false;
+  }
+  // the memory is zero filled by ftruncate, so that every slot is unlocked and no message is published
+  header_ = static_cast<ShmRingHeader*>(base);
+  header_->version = kVersion;
+  header_->slot_count = slot_count;
+  header_->slot_size = slot_size;
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->magic = kMagic;
+  name_ = path;
+  base_ = base;
+  size_ = size;
+  return true;
+}
+
+uint64_t ShmRingWriter::Write(const void* result, size_t result_size, const void* thumbnail, size_t thumbnail_size) {
+  if (!header_) return 0;
+  if (result_size > header_->slot_size) {
+    LOGW(ShmSink) << "ShmRingWriter::Write() result of " << result_size << " bytes is larger than a slot";
+    return 0;
+  }
+  if (!thumbnail || result_size + thumbnail_size > header_->slot_size) thumbnail_size = 0;
+
+  uint64_t seq = header_->write_seq.load(std::memory_order_relaxed) + 1;
+  ShmRingSlot* slot = SlotAt(base_, header_, seq);
+  slot->lock.store(2 * seq - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  char* data = reinterpret_cast<char*>(slot + 1);
+  memcpy(data, result, result_size);
+  if (thumbnail_size) memcpy(data + result_size, thumbnail, thumbnail_size);
+  slot->result_size.store(static_cast<uint32_t>(result_size), std::memory_order_relaxed);
+  slot->thumbnail_size.store(static_cast<uint32_t>(thumbnail_size), std::memory_order_relaxed);
+  slot->lock.store(2 * seq, std::memory_order_release);
+  header_->write_seq.store(seq, std::memory_order_release);
+  return seq;
+}
+
+void ShmRingWriter::Destroy() {
+  if (!base_) return;
+  munmap(base_, size_);
+  shm_unlink(name_.c_str());
+  base_ = nullptr;
+  header_ = nullptr;
+  size_ = 0;
+  name_.clear();
+}
+
+uint64_t ShmRingWriter::LastSequence() const {
+  return header_ ? header_->write_seq.load(std::memory_order_acquire) : 0;
+}
+
+ShmRingReader::~ShmRingReader() { Detach(); }
+
+bool ShmRingReader::Attach(const std::string& name, bool from_oldest) {
+  Detach();
+  std::string path = ShmPath(name);
+  int fd = shm_open(path.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    LOGE(ShmSink) << "ShmRingReader::Attach() shm_open " << path << " failed, " << strerror(errno);
+    return false;
+  }
+  struct stat st;
+  void* base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmRingHeader)) {
+    base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) {
+    LOGE(ShmSink) << "ShmRingReader::Attach() map " << path << " failed";
+    return false;
+  }
+  const ShmRingHeader* header = static_cast<const ShmRingHeader*>(base);
+  bool valid = header->magic == ShmRingWriter::kMagic;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  valid = valid && header->version == ShmRingWriter::kVersion && header->slot_count && header->slot_size &&
+          static_cast<size_t>(st.st_size) >= sizeof(ShmRingHeader) + header->slot_count * SlotStride(header->slot_size);
+  if (!valid) {
+    LOGE(ShmSink) << "ShmRingReader::Attach() " << path << " is not a ring of version " << ShmRingWriter::kVersion;
+    munmap(base, st.st_size);
+    return false;
+  }
+  base_ = base;
+  size_ = st.st_size;
+  header_ = header;
+  uint64_t latest = header_->write_seq.load(std::memory_order_acquire);
+  if (from_oldest) {
+    next_seq_ = latest >= header_->slot_count ? latest - header_->slot_count + 1 : 1;
+  } else {
+    next_seq_ = latest + 1;
+  }
+  dropped_ = 0;
+  return true;
+}
+
+ShmRingReader::Status ShmRingReader::Read(std::string* result, std::string* thumbnail, uint64_t* seq) {
+  if (!header_ || !result) return Status::ERROR;
+  const uint32_t slot_count = header_->slot_count;
+  while (true) {
+    uint64_t latest = header_->write_seq.load(std::memory_order_acquire);
+    if (next_seq_ > latest) return Status::EMPTY;
+    if (latest - next_seq_ >= slot_count) {
+      dropped_ += latest - slot_count + 1 - next_seq_;
+      next_seq_ = latest - slot_count + 1;
+    }
+    const ShmRingSlot* slot = SlotAt(const_cast<void*>(base_), header_, next_seq_);
+    uint64_t lock = slot->lock.load(std::memory_order_acquire);
+    bool valid = lock == 2 * next_seq_;
+    if (valid) {
+      uint32_t result_size = slot->result_size.load(std::memory_order_relaxed);
+      uint32_t thumbnail_size = slot->thumbnail_size.load(std::memory_order_relaxed);
+      valid = static_cast<uint64_t>(result_size) + thumbnail_size <= header_->slot_size;
+      if (valid) {
+        const char* data = reinterpret_cast<const char*>(slot + 1);
+        result->assign(data, result_size);
+        if (thumbnail) thumbnail->assign(data + result_size, thumbnail_size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        valid = slot->lock.load(std::memory_order_relaxed) == lock;
+      }
+    }
+    if (!valid) {
+      // overwritten by a newer message while reading
+      ++dropped_;
+      ++next_seq_;
+      continue;
+    }
+    if (seq) *seq = next_seq_;
+    ++next_seq_;
+    return Status::OK;
+  }
+}
+
+void ShmRingReader::Detach() {
+  if (!base_) return;
+  munmap(const_cast<void*>(base_), size_);
+  base_ = nullptr;
+  header_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,143 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "shm_sink.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_infer_objs_codec.hpp"
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+ShmSink::ShmSink(const std::string &name) : Module(name) {
+  param_register_.SetModuleDesc("ShmSink is a module which publishes the inference results of frames into a shared"
+      " memory ring, so that processes on the same host read them without copies through sockets.");
+  param_register_.Register("shm_name", "The name of the shared memory, it is created in /dev/shm."
+      " Default is cnstream_results.");
+  param_register_.Register("slot_count", "The number of messages kept in the ring. Default is 64.");
+  param_register_.Register("slot_size", "The max size of a message including the thumbnail in KB. Default is 256.");
+  param_register_.Register("with_extra_attributes", "Whether the extended attributes of objects are published."
+      " It should be true or false. Default is true.");
+  param_register_.Register("with_features", "Whether the features of objects are published."
+      " It should be true or false. Default is false.");
+  param_register_.Register("thumbnail_width", "The width of the JPEG thumbnail published with the results, the height"
+      " keeps the aspect ratio. 0 means no thumbnail. Default is 0.");
+  param_register_.Register("thumbnail_quality", "The JPEG quality of the thumbnail, from 1 to 100. Default is 80.");
+}
+
+ShmSink::~ShmSink() { Close(); }
+
+bool ShmSink::Open(ModuleParamSet paramSet) {
+  if (!CheckParamSet(paramSet)) return false;
+  auto get = [&paramSet](const std::string &key, const std::string &default_value) {
+    return paramSet.find(key) != paramSet.end() ? paramSet[key] : default_value;
+  };
+  std::string shm_name = get("shm_name", "cnstream_results");
+  uint32_t slot_count = std::stoul(get("slot_count", "64"));
+  uint32_t slot_size = std::stoul(get("slot_size", "256")) << 10;
+  codec_flags_ = 0;
+  if (get("with_extra_attributes", "true") == "true") codec_flags_ |= InferObjsCodec::EXTRA_ATTRIBUTES;
+  if (get("with_features", "false") == "true") codec_flags_ |= InferObjsCodec::FEATURES;
+  thumbnail_width_ = std::stoi(get("thumbnail_width", "0"));
+  thumbnail_quality_ = std::stoi(get("thumbnail_quality", "80"));
+
+  std::lock_guard<std::mutex> lk(writer_mutex_);
+  if (!writer_.Create(shm_name, slot_count, slot_size)) {
+    LOGE(ShmSink) << "[" << GetName() << "] Create shared memory ring [" << shm_name << "] failed";
+    return false;
+  }
+  LOGI(ShmSink) << "[" << GetName() << "] Publish results to /dev/shm/" << shm_name << ", " << slot_count
+                << " slots of " << (slot_size >> 10) << " KB";
+  return true;
+}
+
+void ShmSink::Close() {
+  std::lock_guard<std::mutex> lk(writer_mutex_);
+  writer_.Destroy();
+}
+
+bool ShmSink::EncodeThumbnail(const std::shared_ptr<CNFrameInfo> &data, std::string *thumbnail) const {
+  if (!data->collection.HasValue(kCNDataFrameSlot)) return false;
+  CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+  if (frame->width <= 0 || frame->height <= 0) return false;
+  cv::Mat bgr = frame->ImageBGR();
+  if (bgr.empty()) return false;
+  cv::Mat resized;
+  int height = std::max(1, thumbnail_width_ * bgr.rows / bgr.cols);
+  cv::resize(bgr, resized, cv::Size(thumbnail_width_, height));
+  std::vector<uint8_t> jpeg;
+  if (!cv::imencode(".jpg", resized, jpeg, {cv::IMWRITE_JPEG_QUALITY, thumbnail_quality_})) return false;
+  thumbnail->assign(reinterpret_cast<const char *>(jpeg.data()), jpeg.size());
+  return true;
+}
+
+int ShmSink::Process(std::shared_ptr<CNFrameInfo> data) {
+  if (!data || data->IsEos() || data->IsRemoved()) return 0;
+  // encoding is done before locking, only copying into the ring is serialized
+  std::string result;
+  if (!InferObjsCodec::Encode(data, codec_flags_, &result)) return 0;
+  std::string thumbnail;
+  if (thumbnail_width_ > 0 && !EncodeThumbnail(data, &thumbnail)) {
+    LOGW(ShmSink) << "[" << GetName() << "] Encode thumbnail of stream [" << data->stream_id << "] failed";
+  }
+  std::lock_guard<std::mutex> lk(writer_mutex_);
+  if (!writer_.Write(result.data(), result.size(), thumbnail.data(), thumbnail.size())) {
+    LOGW(ShmSink) << "[" << GetName() << "] Results of stream [" << data->stream_id << "] are dropped";
+  }
+  return 0;
+}
+
+bool ShmSink::CheckParamSet(const ModuleParamSet &paramSet) const {
+  bool ret = true;
+  ParametersChecker checker;
+  for (auto &it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOGW(ShmSink) << "[" << GetName() << "] Unknown param: " << it.first;
+    }
+  }
+  std::string err_msg;
+  if (!checker.IsNum({"slot_count", "slot_size", "thumbnail_width", "thumbnail_quality"}, paramSet, err_msg, true)) {
+    LOGE(ShmSink) << "[" << GetName() << "] " << err_msg;
+    return false;
+  }
+  auto positive = [&paramSet](const std::string &key, int max_value) {
+    return paramSet.find(key) == paramSet.end() ||
+           (std::stoi(paramSet.at(key)) > 0 && std::stoi(paramSet.at(key)) <= max_value);
+  };
+  if (!positive("slot_count", 1 << 20) || !positive("slot_size", 1 << 20) || !positive("thumbnail_quality", 100)) {
+    LOGE(ShmSink) << "[" << GetName() << "] [slot_count] and [slot_size] should be positive, [thumbnail_quality]"
+                  << " should be in [1, 100]";
+    ret = false;
+  }
+  for (const std::string key : {"with_extra_attributes", "with_features"}) {
+    if (paramSet.find(key) != paramSet.end() && paramSet.at(key) != "true" && paramSet.at(key) != "false") {
+      LOGE(ShmSink) << "[" << GetName() << "] [" << key << "] should be true or false";
+      ret = false;
+    }
+  }
+  return ret;
+}
+
+}  // namespace cnstream
@@ -24,7 +24,7 @@
  *  @file data_source.hpp
  *
  *  This file contains a declaration of the DataSourceParam and ESPacket struct, and the DataSource, FileHandler,
- *  RtspHandler, ESMemHandler, ESJpegMemHandler and RawImgMemHandler class.
+ *  RtspHandler, ESMemHandler, ReplayHandler, ESJpegMemHandler and RawImgMemHandler class.
  */
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
@@ -32,18 +32,28 @@
 #include "opencv2/imgcodecs/imgcodecs.hpp"
 #endif
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "cnstream_frame.hpp"
 #include "cnstream_frame_va.hpp"
 #include "cnstream_pipeline.hpp"
 #include "cnstream_source.hpp"
 #include "data_source_param.hpp"
+#include "util/cnstream_stream_param_table.hpp"
 
 namespace cnstream {
 
+class Decoder;
+class DecodeWorkerPool;
+class IDecodeResult;
+class JpegDecodeEngine;
+class StreamPlacer;
+
 /*!
  * @class DataSource
  *
@@ -107,8 +117,101 @@ class DataSource : public SourceModule, public ModuleCreator<DataSource> {
    */
   DataSourceParam GetSourceParam() const { return param_; }
 
+  /*!
+   * @brief Gets the parameters of a stream of the DataSource module.
+   *
+   * With several ``device_ids``, the stream is placed on one of the devices when it is first called for the stream,
+   * by the live codec and compute utilization of the devices, and ``device_id_`` is set to it. The stream is decoded
+   * and output to the device until it is removed.
+   *
+   * @param[in] stream_id The stream identification.
+   *
+   * @return Returns the parameters of the stream.
+   *
+   * @note This function should be called after ``Open`` function.
+   */
+  DataSourceParam GetSourceParam(const std::string &stream_id) const;
+
+  /*!
+   * @brief Gets the decoder pool shared by the streams of this module.
+   *
+   * @return Returns nullptr if ``decode_pool_threads`` is not set, each stream decodes in its own thread then.
+   *
+   * @note This function should be called after ``Open`` function.
+   */
+  DecodeWorkerPool *GetDecodePool() const { return decode_pool_.get(); }
+
+  /*!
+   * @brief Gets the decode priority class of a stream.
+   *
+   * It is ``decode_priority`` overridden for the stream by Pipeline::SetStreamParams, or the one of the module. In the
+   * decoder pool, the streams of a higher class are decoded first, and whole GOPs of the low priority streams are
+   * skipped while the pool is under pressure, see ``decode_pressure_ms``.
+   *
+   * @param[in] stream_index The stream index.
+   *
+   * @return Returns the decode priority class.
+   */
+  DecodePriority GetDecodePriority(uint32_t stream_index) const;
+
+  /*!
+   * @brief Checks the parameters overridden for a stream, only ``decode_priority`` is supported.
+   */
+  bool CheckStreamParams(const ModuleParamSet &params) const override;
+
+  /*!
+   * @brief Overrides ``decode_priority`` for a stream, see GetDecodePriority.
+   */
+  void SetStreamParams(uint32_t stream_index, const ModuleParamSet &params) override;
+
+  /*!
+   * @brief Gets the jpeg decoders shared by the ESJpegMemHandler streams of this module.
+   *
+   * @return Returns nullptr if ``jpeg_decode_lanes`` is not set, each stream creates its own decoder then.
+   *
+   * @note This function should be called after ``Open`` function.
+   */
+  JpegDecodeEngine *GetJpegEngine() const { return jpeg_engine_.get(); }
+
+  /*!
+   * @brief Gets the resolution the decoders scale frames to.
+   *
+   * With ``output_resolution`` set to auto, it is the preferred frame size (Module::GetPreferredFrameSize) of
+   * the next modules. The frames keep the original resolution if any of the next modules has no preference or
+   * they prefer different resolutions.
+   *
+   * @param[out] width The width of decoded frames.
+   * @param[out] height The height of decoded frames.
+   *
+   * @return Returns false if frames should be decoded in the original resolution.
+   *
+   * @note This function should be called after the pipeline is started.
+   */
+  bool GetOutputResolution(uint32_t *width, uint32_t *height) const;
+
+  /*!
+   * @brief Scales the resolution the decoders scale frames to, when the pipeline is degraded.
+   *
+   * @param[in] scale The ratio of the width and the height, 1 restores the output resolution.
+   *
+   * @return Returns false if ``output_resolution`` is not set, the original resolution is not known beforehand.
+   *
+   * @note It takes effect on the decoders created afterwards, i.e. the streams added or reconnected.
+   */
+  bool SetOutputScale(double scale) override;
+
  private:
+  // creates the decoder of a jpeg decode engine lane, an mlu decoder falls back to a cpu decoder on failure
+  std::shared_ptr<Decoder> CreateJpegDecoder(IDecodeResult *result) const;
+  // releases the device the stream is placed on
+  void OnSourceClosed(const std::string &stream_id) override;
+
   DataSourceParam param_;
+  std::unique_ptr<DecodeWorkerPool> decode_pool_;
+  StreamParamTable<DecodePriority> stream_priorities_;  // see SetStreamParams
+  std::unique_ptr<JpegDecodeEngine> jpeg_engine_;
+  std::unique_ptr<StreamPlacer> placer_;
+  std::atomic<double> output_scale_{1.0};  // see SetOutputScale
 };  // class DataSource
 
 /*!
@@ -355,7 +458,7 @@ class ESMemHandler : public SourceHandler {
    */
   int WriteEos();
 
- private:
+ protected:
   explicit ESMemHandler(DataSource *module, const std::string &stream_id,
                         const MaximumVideoResolution& maximum_resolution);
 
@@ -367,6 +470,76 @@ class ESMemHandler : public SourceHandler {
   ESMemHandlerImpl *impl_ = nullptr;
 };  // class ESMemHandler
 
+/*!
+ * @struct ReplayParam
+ *
+ * @brief ReplayParam is a structure describing the capture replayed by ReplayHandler and how it is replayed.
+ */
+struct ReplayParam {
+  std::string path;   /*!< The capture file, ``<capture_dir>/<stream_id>.cncap`` written by DataSource. */
+  double speed = 1;   /*!< The packets are sent at ``speed`` times the rate they arrived. 0 sends them as fast as
+                           they are decoded. */
+  bool loop = false;  /*!< Whether to replay the capture again and again. */
+};  // struct ReplayParam
+
+class ReplayHandlerImpl;
+/*!
+ * @class ReplayHandler
+ *
+ * @brief ReplayHandler is a class of source handler replaying the packets captured by DataSource (see
+ * ``capture_dir``) with the time they arrived, so that a problem seen on a live stream is reproduced offline.
+ *
+ * The packets are written to the decoder by a thread as ESMemHandler::Write does, the eos is sent after the last
+ * packet unless the capture is looped.
+ */
+class ReplayHandler : public ESMemHandler {
+ public:
+  /*!
+   * @brief Creates source handler.
+   *
+   * @param[in] module The data source module.
+   * @param[in] stream_id The stream id of the stream.
+   * @param[in] param The capture and how it is replayed.
+   *
+   * @return Returns source handler if it is created successfully, otherwise returns nullptr.
+   */
+  static std::shared_ptr<SourceHandler> Create(DataSource *module, const std::string &stream_id,
+                                               const ReplayParam &param);
+  /*!
+   * @brief The destructor of ReplayHandler.
+   *
+   * @return No return value.
+   */
+  ~ReplayHandler();
+  /*!
+   * @brief Opens source handler and starts to replay the capture.
+   *
+   * @return Returns true if the source handler is opened successfully, otherwise returns false, e.g. the capture
+   *         could not be read.
+   */
+  bool Open() override;
+  /*!
+   * @brief Stops source handler. The Close() function should be called afterwards.
+   *
+   * @return No return value.
+   */
+  void Stop() override;
+  /*!
+   * @brief Closes source handler.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+
+ private:
+  explicit ReplayHandler(DataSource *module, const std::string &stream_id, const ReplayParam &param);
+
+#ifdef UNIT_TEST
+ public:  // NOLINT
+#endif
+  ReplayHandlerImpl *replay_impl_ = nullptr;
+};  // class ReplayHandler
+
 class ESJpegMemHandlerImpl;
 /*!
  * @class ESJpegMemHandler
@@ -416,7 +589,22 @@ class ESJpegMemHandler : public SourceHandler {
    */
   int Write(ESPacket *pkt);
 
- private:
+  /*!
+   * @brief Sends images in frame mode at once. If the images are decoded by the shared jpeg decoders (see
+   *        ``jpeg_decode_lanes``), they are submitted together, so that the decoders take them in full batches.
+   *        Otherwise, they are written one by one as Write does.
+   *
+   * @param[in] pkts The data packets.
+   * @param[in] num The number of the packets.
+   *
+   * @return Returns the number of the packets written from the front. It is less than ``num`` if the handler is
+   *         closed, or a packet is empty or carries the eos flag.
+   *
+   * @note The eos is not sent by this function, calls Write with the eos flag after the last batch.
+   */
+  int WriteBatch(ESPacket *pkts, int num);
+
+ protected:
   explicit ESJpegMemHandler(DataSource *module, const std::string &stream_id, int max_width, int max_height);
 
 #ifdef UNIT_TEST
@@ -425,7 +613,115 @@ class ESJpegMemHandler : public SourceHandler {
   ESJpegMemHandlerImpl *impl_ = nullptr;
 };  // class ESJpegMemHandler
 
+/*!
+ * @struct ImageSetParam
+ *
+ * @brief ImageSetParam is a structure describing the images sent by ImageSetHandler and how they are read.
+ */
+struct ImageSetParam {
+  /*! A directory of jpeg images, which are sent in the order of their names, or a list file with one image path per
+      line. */
+  std::string path;
+  std::vector<std::string> files;  /*!< The image paths, used if ``path`` is empty. */
+  uint32_t reader_num = 4;         /*!< The number of threads reading the images. */
+  uint32_t window = 64;            /*!< The maximum number of images read ahead of the decoder. */
+  uint32_t batch_size = 8;         /*!< The maximum number of images written to the decoder at a time. */
+  bool loop = false;               /*!< Whether to send the images again and again. */
+  int max_width = 7680;            /*!< The maximum width of the images. */
+  int max_height = 4320;           /*!< The maximum height of the images. */
+};  // struct ImageSetParam
+
+/*!
+ * @struct ImageSetStats
+ *
+ * @brief ImageSetStats is a structure describing the throughput of ImageSetHandler.
+ */
+struct ImageSetStats {
+  uint64_t written = 0;           /*!< The images written to the decoder. */
+  uint64_t failed = 0;            /*!< The images which could not be read. */
+  uint64_t read_bytes = 0;        /*!< The bytes read from the files. */
+  double images_per_second = 0;   /*!< The images written per second since the handler is opened. */
+};  // struct ImageSetStats
+
+class ImageSetHandlerImpl;
+/*!
+ * @class ImageSetHandler
+ *
+ * @brief ImageSetHandler is a class of source handler for a set of jpeg images, e.g. a directory, in one stream.
+ *
+ * The files are read ahead by a pool of reader threads and written to the decoder in batches, as
+ * ESJpegMemHandler::WriteBatch does, so that the shared jpeg decoders (see ``jpeg_decode_lanes``) are kept busy. The
+ * eos is sent after the last image, or when the handler is closed.
+ */
+class ImageSetHandler : public ESJpegMemHandler {
+ public:
+  /*!
+   * @brief Creates source handler.
+   *
+   * @param[in] module The data source module.
+   * @param[in] stream_id The stream id of the stream.
+   * @param[in] param The images and how they are read.
+   *
+   * @return Returns source handler if it is created successfully, otherwise returns nullptr.
+   */
+  static std::shared_ptr<SourceHandler> Create(DataSource *module, const std::string &stream_id,
+                                               const ImageSetParam &param);
+  /*!
+   * @brief The destructor of ImageSetHandler.
+   *
+   * @return No return value.
+   */
+  ~ImageSetHandler();
+  /*!
+   * @brief Opens source handler and starts to read the images.
+   *
+   * @return Returns true if the source handler is opened successfully, otherwise returns false, e.g. no image is
+   *         found.
+   */
+  bool Open() override;
+  /*!
+   * @brief Closes source handler.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+  /*!
+   * @brief Gets the throughput of the handler.
+   *
+   * @return Returns the throughput.
+   */
+  ImageSetStats GetStats() const;
+
+ private:
+  explicit ImageSetHandler(DataSource *module, const std::string &stream_id, const ImageSetParam &param);
+
+#ifdef UNIT_TEST
+ public:  // NOLINT
+#endif
+  ImageSetHandlerImpl *image_set_impl_ = nullptr;
+};  // class ImageSetHandler
+
 class RawImgMemHandlerImpl;
+/*!
+ * @struct RawImgBuffer
+ *
+ * @brief RawImgBuffer describes an image buffer of the caller, which is sent by RawImgMemHandler without copying.
+ */
+struct RawImgBuffer {
+  CNDataFormat fmt = CNDataFormat::CN_INVALID;  /*!< The pixel format, bgr24, rgb24, nv21 or nv12. */
+  int width = 0;                                /*!< The width of the image. */
+  int height = 0;                               /*!< The height of the image. */
+  void *planes[CN_MAX_PLANES] = {nullptr};      /*!< The address of each plane. bgr24 and rgb24 have one plane. */
+  int stride[CN_MAX_PLANES] = {0};              /*!< The stride of each plane in pixels, as CNDataFrame::stride. */
+  int dev_id = -1;                              /*!< The MLU device the planes are on, -1 means host memory. */
+  /*!
+   * Called once when the buffer is not used any more, i.e. the frame referring to it is released, or the buffer is
+   * copied or rejected by RawImgMemHandler::Write. The caller frees or reuses the buffer in it. It is called by the
+   * thread releasing the frame, so it should not block.
+   */
+  std::function<void()> release = nullptr;
+};
+
 /*!
  * @class RawImgMemHandler
  *
@@ -498,6 +794,26 @@ class RawImgMemHandler : public SourceHandler {
   int Write(const uint8_t *data, const int size, const uint64_t pts, const int width = 0, const int height = 0,
             const CNDataFormat pixel_fmt = CNDataFormat::CN_INVALID);
 
+  /*!
+   * @brief Sends raw image in a buffer of the caller. Nv12 and nv21 images are wrapped into the frame without
+   *        copying, the buffer is referred to by the frame until the frame is released.
+   *
+   * @param[in] buffer The image buffer. The planes on host are used as they are. If the output type is mlu, they
+   *            are copied to the device by the first module accessing the frame on MLU. The planes on MLU must be
+   *            on the device of this module and the output type must be mlu.
+   * @param[in] pts The pts for raw image, should be different for each image.
+   *
+   * @return Returns 0 if the data is written successfully.
+   *         Returns -1 if failed to write data. The possible reason is the end of the stream is received or failed to
+   *         process the data.
+   *         Returns -2 if the data is invalid.
+   *
+   * @note Bgr24 and rgb24 images, or nv12 and nv21 images whose stride does not meet ``apply_stride_align_for_scaler``
+   *       are converted as the other Write functions do, which requires continuous planes on host. ``buffer.release``
+   *       is called in any case, even though -1 or -2 is returned.
+   */
+  int Write(const RawImgBuffer &buffer, const uint64_t pts);
+
  private:
   explicit RawImgMemHandler(DataSource *module, const std::string &stream_id);
 
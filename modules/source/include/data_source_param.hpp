@@ -21,6 +21,10 @@
 #ifndef MODULES_DATA_SOURCE_PARAM_HPP_
 #define MODULES_DATA_SOURCE_PARAM_HPP_
 
+#include <set>
+#include <string>
+#include <vector>
+
 namespace cnstream {
 /*!
  * @enum OutputType
@@ -38,6 +42,15 @@ enum class DecoderType {
   DECODER_CPU,  /*!< CPU decoder is used. */
   DECODER_MLU   /*!< MLU decoder is used. */
 };
+/*!
+ * @enum DecodePriority
+ * @brief Enumeration variables describing the decode priority class of a stream, see DataSource::GetDecodePriority.
+ */
+enum class DecodePriority {
+  HIGH,    /*!< Decoded before the other streams, e.g. critical cameras. */
+  NORMAL,  /*!< The default class. */
+  LOW      /*!< Decoded after the other streams, whole GOPs are skipped while the decoder pool is under pressure. */
+};
 /*!
  * @brief DataSourceParam is a structure for private usage.
  */
@@ -47,10 +60,41 @@ struct DataSourceParam {
   DecoderType decoder_type_ = DecoderType::DECODER_CPU;  /*!< The decoder type. */
   bool reuse_cndec_buf = false;  /*!< Whether to enable the mechanism to reuse MLU codec's buffers by next modules. */
   int device_id_ = -1;              /*!< The device ordinal. -1 is for CPU and >=0 is for MLU. */
+  std::vector<int> device_ids_;     /*!< The devices the streams are placed on, see DataSource::GetSourceParam. */
   uint32_t input_buf_number_ = 2;   /*!< Input buffer's number used by MLU codec. */
   uint32_t output_buf_number_ = 3;  /*!< Output buffer's number used by MLU codec. */
   bool apply_stride_align_for_scaler_ = false;  /*!< Whether to set outputs meet the Scaler alignment requirement. */
   bool only_key_frame_ = false;                   /*!< Whether only to decode key frames. */
+  uint32_t gop_interval_ = 1;  /*!< Decodes one GOP of every gop_interval_ GOPs, other packets are dropped
+                                   before decoding. */
+  uint32_t rtsp_reactor_threads_ = 0;  /*!< Live555 event loop threads shared by all rtsp streams. 0 means one loop
+                                           and one demux thread per stream. */
+  std::set<std::string> rtsp_standby_streams_;  /*!< The rtsp streams connected twice, a standby session takes over
+                                                   at once when the active one is lost. */
+  uint32_t decode_pool_threads_ = 0;  /*!< Decoder threads shared by all the streams. 0 means one decode thread
+                                          per stream. */
+  DecodePriority decode_priority_ = DecodePriority::NORMAL;  /*!< The decode priority class of the streams, it is
+                                                               overridden per stream by ``decode_priority``. */
+  uint32_t decode_pressure_ms_ = 20;  /*!< The average time the streams wait for a decoder pool thread above which
+                                          the pool is under pressure. 0 means never. */
+  uint32_t jpeg_decode_lanes_ = 0;  /*!< Jpeg decoders shared by all the ESJpegMemHandler streams. 0 means one decoder
+                                       per stream. */
+  uint32_t jpeg_decode_batch_ = 8;  /*!< The maximum number of images fed to a shared jpeg decoder at a time. */
+  bool max_speed_ = false;  /*!< Whether to ignore the framerate of file sources, for benchmarks. */
+  bool file_packet_cache_ = false;  /*!< Whether to share the demuxed packets of a local file between streams. */
+  bool motion_activity_ = false;  /*!< Whether to score the activity of frames by the motion vectors of the FFmpeg
+                                      decoders, see CNDataFrame::activity. */
+  uint32_t pyramid_levels_ = 0;  /*!< The number of pyramid levels built for the frames on cpu, see
+                                     CNDataFrame::BuildPyramid. */
+  std::vector<std::string> decoder_fallback_;  /*!< The decoders tried by mlu decoders when no codec channel is left,
+                                                   "cpu" or an FFmpeg hwaccel. */
+  uint32_t output_width_ = 0;   /*!< The width of decoded frames scaled by the codec. 0 means the original width. */
+  uint32_t output_height_ = 0;  /*!< The height of decoded frames scaled by the codec. 0 means the original height. */
+  bool auto_output_resolution_ = false;  /*!< Whether to take the output resolution from the next modules, see
+                                             DataSource::GetOutputResolution. */
+  std::string capture_dir_;  /*!< The directory the packets of the streams are captured into, empty means no capture.
+                                 See ReplayHandler. */
+  std::set<std::string> capture_streams_;  /*!< The streams captured, all the file and rtsp streams if it is empty. */
 };
 }  // namespace cnstream
 
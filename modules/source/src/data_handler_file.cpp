@@ -90,10 +90,20 @@ void FileHandler::Close() {
 
 bool FileHandlerImpl::Open() {
   DataSource *source = dynamic_cast<DataSource *>(module_);
-  param_ = source->GetSourceParam();
+  param_ = source->GetSourceParam(stream_id_);
+  capture_ = OpenPacketCapture(param_, stream_id_);
 
-  // start separate thread
   running_.store(1);
+  decode_pool_ = source->GetDecodePool();
+  if (decode_pool_) {
+    loop_prepared_ = false;
+    const uint32_t priority = decode_qos_.Init(module_, &handler_, decode_pool_);
+    decode_job_ = decode_pool_->Submit([this](uint32_t *idle_us) { return Step(idle_us); }, priority);
+    if (decode_job_) return true;
+    decode_pool_ = nullptr;
+  }
+  decode_qos_.Init(module_, &handler_, nullptr);
+  // start separate thread
   thread_ = std::thread(&FileHandlerImpl::Loop, this);
   return true;
 }
@@ -106,9 +116,14 @@ void FileHandlerImpl::Stop() {
 
 void FileHandlerImpl::Close() {
   Stop();
+  if (decode_pool_ && decode_job_) {
+    decode_pool_->Wait(decode_job_);
+    decode_job_ = 0;
+  }
   if (thread_.joinable()) {
     thread_.join();
   }
+  capture_.reset();
 }
 
 void FileHandlerImpl::Loop() {
@@ -116,7 +131,28 @@ void FileHandlerImpl::Loop() {
    *  for cpu case(device_id < 0), MluDeviceGuard will do nothing
    */
   MluDeviceGuard guard(param_.device_id_);
+  if (module_) module_->BindThreadToCpus();
+  handler_.BindMemoryOwner();
+
+  if (!PrepareLoop()) {
+    return;
+  }
+
+  LOGD(SOURCE) << "[" << stream_id_ << "]: "
+               << "File handler DecodeLoop";
+  while (running_.load()) {
+    if (!Process()) {
+      break;
+    }
+    fr_controller_.Control();
+  }
+
+  LOGD(SOURCE) << "[" << stream_id_ << "]: "
+               << "File handler DecoderLoop Exit.";
+  ClearResources();
+}
 
+bool FileHandlerImpl::PrepareLoop() {
   if (!PrepareResources()) {
     ClearResources();
     if (nullptr != module_) {
@@ -130,38 +166,79 @@ void FileHandlerImpl::Loop() {
     }
     LOGE(SOURCE) << "[" << stream_id_ << "]: "
                  << "PrepareResources failed.";
-    return;
+    return false;
   }
 
-  FrController controller(framerate_);
-  if (framerate_ > 0) controller.Start();
+  // max_speed ignores framerate, FrController does not wait with a frame rate of 0
+  fr_controller_.SetFrameRate((framerate_ > 0 && !param_.max_speed_) ? framerate_ : 0);
+  return true;
+}
 
-  LOGD(SOURCE) << "[" << stream_id_ << "]: "
-               << "File handler DecodeLoop";
-  while (running_.load()) {
-    if (!Process()) {
-      break;
+bool FileHandlerImpl::Step(uint32_t *idle_us) {
+  // the workers are shared by streams, the memory owner is bound for each step
+  handler_.BindMemoryOwner();
+  if (!loop_prepared_) {
+    if (!PrepareLoop()) {
+      return false;
     }
-    if (framerate_ > 0) controller.Control();
+    loop_prepared_ = true;
+    LOGD(SOURCE) << "[" << stream_id_ << "]: "
+                 << "File handler decodes in decoder pool";
+  }
+  if (running_.load() && Process()) {
+    *idle_us = fr_controller_.NextDelay().count();
+    return true;
   }
 
   LOGD(SOURCE) << "[" << stream_id_ << "]: "
-               << "File handler DecoderLoop Exit.";
+               << "File handler exits decoder pool.";
   ClearResources();
+  return false;
 }
 
 bool FileHandlerImpl::PrepareResources(bool demux_only) {
   LOGD(SOURCE) << "[" << stream_id_ << "]: "
                << "Begin preprare resources";
-  int ret = parser_.Open(filename_, this, param_.only_key_frame_);
+  if (param_.file_packet_cache_ && !packet_table_) {
+    packet_table_ = PacketTableCache::Instance().Get(filename_);
+    if (!packet_table_) {
+      LOGW(SOURCE) << "[" << stream_id_ << "]: "
+                   << "Packets of " << filename_ << " are not cached, read by ffmpeg.";
+    }
+  }
+  int ret;
+  if (packet_table_) {
+    ret = cached_parser_.Open(packet_table_, this, param_.only_key_frame_, param_.gop_interval_);
+  } else {
+    ret = parser_.Open(filename_, this, param_.only_key_frame_, param_.gop_interval_);
+  }
   LOGD(SOURCE) << "[" << stream_id_ << "]: "
                << "Finish preprare resources";
   if (ret < 0 || dec_create_failed_) {
     return false;
   }
+  if (!demux_only) Resume();
   return true;
 }
 
+void FileHandlerImpl::Resume() {
+  resume_pts_.store(-1);
+  Pipeline *pipeline = module_ ? module_->GetContainer() : nullptr;
+  CheckpointStore *checkpoint = pipeline ? pipeline->GetCheckpointStore() : nullptr;
+  if (!checkpoint) return;
+  const int64_t pts = checkpoint->Resume(stream_id_, filename_);
+  if (pts < 0) return;
+  LOGI(SOURCE) << "[" << stream_id_ << "]: "
+               << "Resume from checkpoint, the frames up to pts " << pts << " are skipped.";
+  // the frames before the key frame are not read if the file is seekable
+  if (packet_table_) {
+    cached_parser_.Seek(pts);
+  } else {
+    parser_.Seek(pts);
+  }
+  resume_pts_.store(pts);
+}
+
 void FileHandlerImpl::ClearResources(bool demux_only) {
   LOGD(SOURCE) << "[" << stream_id_ << "]: "
                << "Begin clear resources";
@@ -169,13 +246,22 @@ void FileHandlerImpl::ClearResources(bool demux_only) {
     decoder_->Destroy();
     decoder_.reset();
   }
-  parser_.Close();
+  if (packet_table_) {
+    cached_parser_.Close();
+    if (!demux_only) packet_table_.reset();
+  } else {
+    parser_.Close();
+  }
   LOGD(SOURCE) << "[" << stream_id_ << "]: "
                << "Finish clear resources";
 }
 
 bool FileHandlerImpl::Process() {
-  parser_.Parse();
+  if (packet_table_) {
+    cached_parser_.Parse();
+  } else {
+    parser_.Parse();
+  }
   if (eos_reached_) {
     if (this->loop_) {
       LOGI(SOURCE) << "[" << stream_id_ << "]: "
@@ -197,6 +283,7 @@ bool FileHandlerImpl::Process() {
         return false;
       }
       eos_reached_ = false;
+      resume_pts_.store(-1);
       return true;
     } else {
       if (decoder_) decoder_->Process(nullptr);
@@ -214,6 +301,7 @@ bool FileHandlerImpl::Process() {
 
 // IParserResult methods
 void FileHandlerImpl::OnParserInfo(VideoInfo *info) {
+  if (capture_) capture_->SetInfo(*info);
   if (decoder_) {
     return;  // for the case:  loop and reset demux only
   }
@@ -235,6 +323,12 @@ void FileHandlerImpl::OnParserInfo(VideoInfo *info) {
     extra.device_id = param_.device_id_;
     extra.input_buf_num = param_.input_buf_number_;
     extra.output_buf_num = param_.output_buf_number_;
+    if (param_.reuse_cndec_buf) codec_buf_tracker_ = std::make_shared<CodecBufferTracker>(param_.output_buf_number_);
+    if (module_) extra.memory_owner = module_->GetMemoryOwner(stream_id_);
+    SetResourceOwner(module_, &extra);
+    extra.fallback_decoders = param_.decoder_fallback_;
+    extra.export_motion_vectors = param_.motion_activity_;
+    SetOutputResolution(module_, &extra);
     extra.max_width = 7680;  // FIXME (for MLU220/MLU270 jpeg decode)
     extra.max_height = 4320;  // FIXME (for MLU220/MLU270 jpeg decode)
     bool ret = decoder_->Create(info, &extra);
@@ -257,12 +351,15 @@ void FileHandlerImpl::OnParserFrame(VideoEsFrame *frame) {
   pkt.data = frame->data;
   pkt.len = frame->len;
   pkt.pts = frame->pts;
+  pkt.flags = (frame->flags & VideoEsFrame::FLAG_KEY_FRAME) ? VideoEsPacket::FLAG_KEY_FRAME : 0;
+  if (capture_) capture_->Write(frame->data, frame->len, frame->pts, pkt.flags != 0);
+  if (!decode_qos_.KeepPacket(pkt.flags != 0, pkt.pts)) return;
 
   if (module_ && module_->GetProfiler()) {
-    auto record_key = std::make_pair(stream_id_, pkt.pts);
-    module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, record_key);
+    const uint32_t stream_index = handler_.GetStreamIndex();
+    module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, stream_index, stream_id_, pkt.pts);
     if (module_->GetContainer() && module_->GetContainer()->GetProfiler()) {
-      module_->GetContainer()->GetProfiler()->RecordInput(record_key);
+      module_->GetContainer()->GetProfiler()->RecordInput(stream_index, stream_id_, pkt.pts);
     }
   }
 
@@ -274,6 +371,10 @@ void FileHandlerImpl::OnParserFrame(VideoEsFrame *frame) {
 
 // IDecodeResult methods
 void FileHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
+  if (DecodeErrorCode::ERROR_CORRUPT_DATA == error_code) {
+    handler_.RecordDropped(kDROP_REASON_CORRUPT_DATA);
+    return;
+  }
   if (nullptr != module_) {
     Event e;
     e.type = EventType::EVENT_STREAM_ERROR;
@@ -287,7 +388,13 @@ void FileHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void FileHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
-  if (frame_count_++ % param_.interval_ != 0) {
+  if (frame) decode_qos_.OnFrame(frame->pts);
+  const int64_t resume_pts = resume_pts_.load();
+  if (resume_pts >= 0 && frame) {
+    if (frame->pts <= resume_pts) return;  // processed before the checkpoint
+    resume_pts_.store(-1);
+  }
+  if (!KeepFrame(param_.interval_)) {
     return;  // discard frames
   }
 
@@ -308,7 +415,7 @@ void FileHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
     return;
   }
 
-  int ret = SourceRender::Process(data, frame, frame_id_++, param_);
+  int ret = SourceRender::Process(data, frame, frame_id_++, param_, codec_buf_tracker_);
   if (ret < 0) {
     return;
   }
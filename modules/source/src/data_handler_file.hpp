@@ -21,6 +21,7 @@
 #ifndef MODULES_SOURCE_HANDLER_FILE_HPP_
 #define MODULES_SOURCE_HANDLER_FILE_HPP_
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <sstream>
@@ -30,12 +31,72 @@
 #include "cnstream_logging.hpp"
 #include "data_handler_util.hpp"
 #include "data_source.hpp"
+#include "util/decode_worker_pool.hpp"
+#include "util/frame_pacer.hpp"
+#include "util/packet_table.hpp"
 #include "util/video_parser.hpp"
 #include "util/video_decoder.hpp"
 
 
 namespace cnstream {
 
+/***********************************************************************
+ * @brief FrController is used to control the frequency of sending data.
+ *
+ * The frames are due at absolute deadlines, ``start + n / frame_rate``, so a late wakeup is made up by the next
+ * frames instead of delaying all of them (drift correction). When a stream falls behind by more than
+ * ``kMaxLagFrames`` frames, e.g. it was blocked downstream, the deadlines restart from now instead of bursting.
+ * The waiting streams are released by the shared FramePacer.
+ ***********************************************************************/
+class FrController {
+ public:
+  static constexpr uint32_t kMaxLagFrames = 3;
+  FrController() {}
+  explicit FrController(uint32_t frame_rate) : frame_rate_(frame_rate) {}
+  void Start() {
+    start_ = std::chrono::steady_clock::now();
+    frame_idx_ = 0;
+  }
+  void Control() {
+    if (0 == frame_rate_) return;
+    FramePacer::Instance().WaitUntil(NextDeadline());
+  }
+  /**
+   * Same as Control, but returns the time to wait instead of waiting, used by the decoder pool.
+   */
+  std::chrono::microseconds NextDelay() {
+    if (0 == frame_rate_) return std::chrono::microseconds(0);
+    auto delay = NextDeadline() - std::chrono::steady_clock::now();
+    if (delay.count() <= 0) return std::chrono::microseconds(0);
+    return std::chrono::duration_cast<std::chrono::microseconds>(delay);
+  }
+  inline uint32_t GetFrameRate() const { return frame_rate_; }
+  /**
+   * Changes the frame rate, the deadlines of the new frame rate start from now.
+   */
+  inline void SetFrameRate(uint32_t frame_rate) {
+    frame_rate_ = frame_rate;
+    Start();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point NextDeadline() {
+    const std::chrono::duration<double> period(1.0 / frame_rate_);
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * ++frame_idx_);
+    if (now - deadline > period * static_cast<double>(kMaxLagFrames)) {
+      start_ = now;
+      frame_idx_ = 0;
+      return now;
+    }
+    return deadline;
+  }
+
+  uint32_t frame_rate_ = 0;
+  uint64_t frame_idx_ = 0;
+  std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+};  // class FrController
+
 class FileHandlerImpl : public IParserResult, public IDecodeResult, public SourceRender {
  public:
   explicit FileHandlerImpl(DataSource *module, const std::string &filename, int framerate, bool loop,
@@ -67,6 +128,12 @@ class FileHandlerImpl : public IParserResult, public IDecodeResult, public Sourc
   void ClearResources(bool demux_only = false);
   bool Process();
   void Loop();
+  // Prepares resources for Loop or Step, posts a stream error event on failure.
+  bool PrepareLoop();
+  // Seeks to the checkpoint of the stream if it was processed before, see CheckpointConfig.
+  void Resume();
+  // One step of the decode loop when the stream is driven by the decoder pool of DataSource.
+  bool Step(uint32_t *idle_us);
 
   // IParserResult methods
   void OnParserInfo(VideoInfo *info) override;
@@ -81,13 +148,25 @@ class FileHandlerImpl : public IParserResult, public IDecodeResult, public Sourc
   std::atomic<int> running_{0};
   std::thread thread_;
   bool eos_sent_ = false;
+  DecodeWorkerPool *decode_pool_ = nullptr;
+  uint64_t decode_job_ = 0;
+  DecodeQos decode_qos_;
+  bool loop_prepared_ = false;
+  FrController fr_controller_;
 
  private:
   FFParser parser_;
+  // replaces parser_ when file_packet_cache is enabled and filename_ is a local file
+  PacketTableParser cached_parser_;
+  std::shared_ptr<const PacketTable> packet_table_ = nullptr;
+  // the packets of the stream are recorded into it if the stream is captured, see capture_dir
+  std::unique_ptr<PacketCaptureWriter> capture_;
   std::shared_ptr<Decoder> decoder_ = nullptr;
   bool dec_create_failed_ = false;
   bool decode_failed_ = false;
   bool eos_reached_ = false;
+  // the frames up to the checkpoint are skipped when the stream is resumed, -1 if there is none. See CheckpointConfig
+  std::atomic<int64_t> resume_pts_{-1};
 
 #ifdef UNIT_TEST
  public:  // NOLINT
@@ -95,37 +174,6 @@ class FileHandlerImpl : public IParserResult, public IDecodeResult, public Sourc
 #endif
 };  // class FileHandlerImpl
 
-/***********************************************************************
- * @brief FrController is used to control the frequency of sending data.
- ***********************************************************************/
-class FrController {
- public:
-  FrController() {}
-  explicit FrController(uint32_t frame_rate) : frame_rate_(frame_rate) {}
-  void Start() { start_ = std::chrono::steady_clock::now(); }
-  void Control() {
-    if (0 == frame_rate_) return;
-    double delay = 1000.0 / frame_rate_;
-    end_ = std::chrono::steady_clock::now();
-    std::chrono::duration<double, std::milli> diff = end_ - start_;
-    auto gap = delay - diff.count() - time_gap_;
-    if (gap > 0) {
-      std::chrono::duration<double, std::milli> dura(gap);
-      std::this_thread::sleep_for(dura);
-      time_gap_ = 0;
-    } else {
-      time_gap_ = -gap;
-    }
-    Start();
-  }
-  inline uint32_t GetFrameRate() const { return frame_rate_; }
-  inline void SetFrameRate(uint32_t frame_rate) { frame_rate_ = frame_rate; }
-
- private:
-  uint32_t frame_rate_ = 0;
-  double time_gap_ = 0;
-  std::chrono::time_point<std::chrono::steady_clock> start_, end_;
-};  // class FrController
 
 }  // namespace cnstream
 
@@ -0,0 +1,177 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "data_handler_image_set.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+#include "profiler/module_profiler.hpp"
+
+namespace cnstream {
+
+std::shared_ptr<SourceHandler> ImageSetHandler::Create(DataSource *module, const std::string &stream_id,
+                                                       const ImageSetParam &param) {
+  if (!module || stream_id.empty()) {
+    LOGE(SOURCE) << "source module or stream id must not be empty";
+    return nullptr;
+  }
+  std::shared_ptr<ImageSetHandler> handler(new (std::nothrow) ImageSetHandler(module, stream_id, param));
+  return handler;
+}
+
+ImageSetHandler::ImageSetHandler(DataSource *module, const std::string &stream_id, const ImageSetParam &param)
+    : ESJpegMemHandler(module, stream_id, param.max_width, param.max_height) {
+  image_set_impl_ = new (std::nothrow) ImageSetHandlerImpl(this, param);
+}
+
+ImageSetHandler::~ImageSetHandler() {
+  // the images are not written any more before the jpeg handler is destroyed
+  if (image_set_impl_) {
+    delete image_set_impl_, image_set_impl_ = nullptr;
+  }
+}
+
+bool ImageSetHandler::Open() {
+  if (!image_set_impl_) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: "
+                 << "ImageSetHandler open failed, no memory left";
+    return false;
+  }
+  if (!ESJpegMemHandler::Open()) return false;
+  if (!image_set_impl_->Open()) {
+    ESJpegMemHandler::Close();
+    return false;
+  }
+  return true;
+}
+
+void ImageSetHandler::Close() {
+  if (image_set_impl_) {
+    image_set_impl_->Close();
+  }
+  ESJpegMemHandler::Close();
+}
+
+ImageSetStats ImageSetHandler::GetStats() const {
+  if (image_set_impl_) {
+    return image_set_impl_->GetStats();
+  }
+  return ImageSetStats();
+}
+
+bool ImageSetHandlerImpl::Open() {
+  std::vector<std::string> files = param_.files;
+  if (!param_.path.empty()) {
+    files.clear();
+    if (!ListImageFiles(param_.path, &files)) {
+      LOGE(SOURCE) << "[" << stream_id_ << "]: "
+                   << "Failed to read " << param_.path;
+      return false;
+    }
+  }
+  if (files.empty()) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: "
+                 << "No image is found";
+    return false;
+  }
+  Close();
+  prefetcher_.reset(new ImagePrefetcher(files, param_.reader_num, param_.window, param_.loop));
+  written_ = 0;
+  failed_ = 0;
+  {
+    std::lock_guard<std::mutex> lk(time_mutex_);
+    start_time_ = std::chrono::steady_clock::now();
+    finished_ = false;
+  }
+  prefetcher_->Start();
+  feeder_ = std::thread(&ImageSetHandlerImpl::FeedLoop, this);
+  LOGI(SOURCE) << "[" << stream_id_ << "]: "
+               << files.size() << " images are read by " << param_.reader_num << " threads";
+  return true;
+}
+
+void ImageSetHandlerImpl::Close() {
+  if (prefetcher_) prefetcher_->Stop();
+  if (feeder_.joinable()) feeder_.join();
+  prefetcher_.reset();
+}
+
+ImageSetStats ImageSetHandlerImpl::GetStats() const {
+  ImageSetStats stats;
+  stats.written = written_.load();
+  stats.failed = failed_.load();
+  // the prefetcher is only replaced by Open and Close, which are not called concurrently with GetStats
+  stats.read_bytes = prefetcher_ ? prefetcher_->GetReadBytes() : 0;
+  std::lock_guard<std::mutex> lk(time_mutex_);
+  const auto end = finished_ ? end_time_ : std::chrono::steady_clock::now();
+  const double elapsed_s = std::chrono::duration<double>(end - start_time_).count();
+  if (elapsed_s > 0) stats.images_per_second = stats.written / elapsed_s;
+  return stats;
+}
+
+void ImageSetHandlerImpl::FeedLoop() {
+  handler_.BindMemoryOwner();
+  std::vector<ESPacket> pkts;
+  while (true) {
+    std::vector<ImagePrefetcher::Image> images = prefetcher_->PopBatch(param_.batch_size);
+    if (images.empty()) break;
+    pkts.clear();
+    for (const auto &image : images) {
+      if (!image.ok) {
+        LOGW(SOURCE) << "[" << stream_id_ << "]: "
+                     << "Failed to read " << image.path;
+        handler_.RecordDropped(kDROP_REASON_READ_ERROR);
+        ++failed_;
+        continue;
+      }
+      ESPacket pkt;
+      pkt.data = const_cast<unsigned char *>(image.data.data());
+      pkt.size = image.data.size();
+      pkt.pts = image.seq;
+      pkts.push_back(pkt);
+    }
+    const int written = handler_.WriteBatch(pkts.data(), pkts.size());
+    written_ += written;
+    if (written < static_cast<int>(pkts.size())) {
+      LOGE(SOURCE) << "[" << stream_id_ << "]: "
+                   << "Failed to write images, the handler may be closed";
+      break;
+    }
+  }
+  ESPacket eos;
+  eos.flags = static_cast<uint32_t>(ESPacket::FLAG::FLAG_EOS);
+  handler_.Write(&eos);
+  {
+    std::lock_guard<std::mutex> lk(time_mutex_);
+    end_time_ = std::chrono::steady_clock::now();
+    finished_ = true;
+  }
+  const ImageSetStats stats = GetStats();
+  LOGI(SOURCE) << "[" << stream_id_ << "]: "
+               << stats.written << " images written, " << stats.failed << " failed, "
+               << stats.images_per_second << " images/s";
+}
+
+}  // namespace cnstream
@@ -0,0 +1,65 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_SOURCE_HANDLER_IMAGE_SET_HPP_
+#define MODULES_SOURCE_HANDLER_IMAGE_SET_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "data_source.hpp"
+#include "util/image_prefetcher.hpp"
+
+namespace cnstream {
+
+class ImageSetHandlerImpl {
+ public:
+  ImageSetHandlerImpl(ImageSetHandler *handler, const ImageSetParam &param)
+      : handler_(*handler), param_(param), stream_id_(handler->GetStreamId()) {}
+  ~ImageSetHandlerImpl() { Close(); }
+
+  bool Open();
+  void Close();
+  ImageSetStats GetStats() const;
+
+ private:
+  // writes the prefetched images to the decoder in batches, then sends the eos
+  void FeedLoop();
+
+  ImageSetHandler &handler_;
+  ImageSetParam param_;
+  std::string stream_id_;
+  std::unique_ptr<ImagePrefetcher> prefetcher_;
+  std::thread feeder_;
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> failed_{0};
+  mutable std::mutex time_mutex_;
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::steady_clock::time_point end_time_;
+  bool finished_ = false;
+};  // class ImageSetHandlerImpl
+
+}  // namespace cnstream
+
+#endif  // MODULES_SOURCE_HANDLER_IMAGE_SET_HPP_
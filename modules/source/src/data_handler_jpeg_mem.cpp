@@ -26,6 +26,7 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "data_handler_jpeg_mem.hpp"
 #include "profiler/module_profiler.hpp"
@@ -82,6 +83,13 @@ void ESJpegMemHandler::Close() {
   }
 }
 
+int ESJpegMemHandler::WriteBatch(ESPacket *pkts, int num) {
+  if (impl_) {
+    return impl_->WriteBatch(pkts, num);
+  }
+  return 0;
+}
+
 int ESJpegMemHandler::Write(ESPacket *pkt) {
   if (impl_) {
     return impl_->Write(pkt);
@@ -92,13 +100,22 @@ int ESJpegMemHandler::Write(ESPacket *pkt) {
 bool ESJpegMemHandlerImpl::Open() {
   DataSource *source = dynamic_cast<DataSource *>(module_);
   if (nullptr != source) {
-    param_ = source->GetSourceParam();
+    param_ = source->GetSourceParam(stream_id_);
   } else {
     LOGE(SOURCE) << "[" << stream_id_ << "]: "
                  << "source module is null";
     return false;
   }
-  int ret = InitDecoder();
+  jpeg_engine_ = source->GetJpegEngine();
+  int ret;
+  if (jpeg_engine_) {
+    render_param_ = param_;
+    render_param_.reuse_cndec_buf = false;
+    jpeg_stream_ = jpeg_engine_->Attach(this);
+    ret = jpeg_stream_ != nullptr;
+  } else {
+    ret = InitDecoder();
+  }
   if (ret) {
     running_ = true;
     eos_reached_ = false;
@@ -108,6 +125,10 @@ bool ESJpegMemHandlerImpl::Open() {
 
 void ESJpegMemHandlerImpl::Close() {
   running_ = false;
+  if (jpeg_stream_) {
+    jpeg_engine_->Detach(jpeg_stream_);
+    jpeg_stream_.reset();
+  }
   if (decoder_) {
     decoder_->Destroy();
     decoder_ = nullptr;
@@ -115,13 +136,55 @@ void ESJpegMemHandlerImpl::Close() {
 }
 
 int ESJpegMemHandlerImpl::Write(ESPacket *pkt) {
-  if (pkt && decoder_) {
+  if (pkt && (decoder_ || jpeg_stream_)) {
     if (ProcessImage(pkt)) return 0;
   }
 
   return -1;
 }
 
+int ESJpegMemHandlerImpl::WriteBatch(ESPacket *pkts, int num) {
+  if (!pkts || num <= 0) return 0;
+  const auto is_image = [](const ESPacket &pkt) {
+    return pkt.data && pkt.size > 0 && !(pkt.flags & static_cast<size_t>(ESPacket::FLAG::FLAG_EOS));
+  };
+  if (!jpeg_stream_) {
+    int written = 0;
+    while (written < num && is_image(pkts[written]) && Write(&pkts[written]) == 0) ++written;
+    return written;
+  }
+  if (eos_reached_ || !running_) return 0;
+
+  std::vector<JpegDecodeEngine::Image> images;
+  std::vector<int> pkt_indices;  // the index in pkts of each image submitted
+  images.reserve(num);
+  pkt_indices.reserve(num);
+  int image_num = 0;
+  for (; image_num < num && is_image(pkts[image_num]); ++image_num) {
+    const ESPacket &pkt = pkts[image_num];
+    if (!KeepFrame(param_.interval_)) continue;
+    RecordInput(pkt.pts);
+    JpegDecodeEngine::Image image;
+    image.data = pkt.data;
+    image.len = pkt.size;
+    image.pts = pkt.pts;
+    images.push_back(image);
+    pkt_indices.push_back(image_num);
+  }
+  const size_t submitted = jpeg_engine_->SubmitBatch(jpeg_stream_, images);
+  return submitted < images.size() ? pkt_indices[submitted] : image_num;
+}
+
+void ESJpegMemHandlerImpl::RecordInput(uint64_t pts) {
+  if (module_ && module_->GetProfiler()) {
+    const uint32_t stream_index = handler_.GetStreamIndex();
+    module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, stream_index, stream_id_, pts);
+    if (module_->GetContainer() && module_->GetContainer()->GetProfiler()) {
+      module_->GetContainer()->GetProfiler()->RecordInput(stream_index, stream_id_, pts);
+    }
+  }
+}
+
 bool ESJpegMemHandlerImpl::ProcessImage(ESPacket *in_pkt) {
   if (eos_reached_ || !running_) {
     return false;
@@ -129,23 +192,29 @@ bool ESJpegMemHandlerImpl::ProcessImage(ESPacket *in_pkt) {
   if (in_pkt->flags & static_cast<size_t>(ESPacket::FLAG::FLAG_EOS)) {
     LOGI(SOURCE) << "[" << stream_id_ << "]: "
                  << "EOS reached in ESJpegMemHandler";
-    decoder_->Process(nullptr);
+    if (jpeg_stream_) {
+      jpeg_engine_->SubmitEos(jpeg_stream_);
+    } else {
+      decoder_->Process(nullptr);
+    }
     return false;
   }
 
+  // the images are discarded before decoding, the engine does not see the order in which they are decoded
+  if (jpeg_stream_ && !KeepFrame(param_.interval_)) {
+    return true;
+  }
+
   VideoEsPacket pkt;
   pkt.data = in_pkt->data;
   pkt.len = in_pkt->size;
   pkt.pts = in_pkt->pts;
 
-  if (module_ && module_->GetProfiler()) {
-    auto record_key = std::make_pair(stream_id_, pkt.pts);
-    module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, record_key);
-    if (module_->GetContainer() && module_->GetContainer()->GetProfiler()) {
-      module_->GetContainer()->GetProfiler()->RecordInput(record_key);
-    }
-  }
+  RecordInput(pkt.pts);
 
+  if (jpeg_stream_) {
+    return jpeg_engine_->Submit(jpeg_stream_, pkt.data, pkt.len, pkt.pts);
+  }
   if (!decoder_->Process(&pkt)) {
     return false;
   }
@@ -175,6 +244,9 @@ bool ESJpegMemHandlerImpl::InitDecoder() {
   extra.device_id = param_.device_id_;
   extra.input_buf_num = param_.input_buf_number_;
   extra.output_buf_num = param_.output_buf_number_;
+  if (param_.reuse_cndec_buf) codec_buf_tracker_ = std::make_shared<CodecBufferTracker>(param_.output_buf_number_);
+  if (module_) extra.memory_owner = module_->GetMemoryOwner(stream_id_);
+  SetResourceOwner(module_, &extra);
   extra.max_width = max_width_;
   extra.max_height = max_height_;
   bool ret = decoder_->Create(&info, &extra);
@@ -188,6 +260,10 @@ bool ESJpegMemHandlerImpl::InitDecoder() {
 
 // IDecodeResult methods
 void ESJpegMemHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
+  if (DecodeErrorCode::ERROR_CORRUPT_DATA == error_code) {
+    handler_.RecordDropped(kDROP_REASON_CORRUPT_DATA);
+    return;
+  }
   // FIXME,  handle decode error ...
   if (nullptr != module_) {
     Event e;
@@ -202,7 +278,7 @@ void ESJpegMemHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void ESJpegMemHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
-  if (frame_count_++ % param_.interval_ != 0) {
+  if (!KeepFrame(param_.interval_)) {
     return;  // discard frames
   }
   if (!frame) return;
@@ -217,7 +293,7 @@ void ESJpegMemHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
     this->SendFrameInfo(data);
     return;
   }
-  int ret = SourceRender::Process(data, frame, frame_id_++, param_);
+  int ret = SourceRender::Process(data, frame, frame_id_++, param_, codec_buf_tracker_);
   if (ret < 0) {
     return;
   }
@@ -227,4 +303,35 @@ void ESJpegMemHandlerImpl::OnDecodeEos() {
   this->SendFlowEos();
 }
 
+// IJpegDecodeResult methods
+std::shared_ptr<CNFrameInfo> ESJpegMemHandlerImpl::OnJpegDecoded(DecodeFrame *frame, int64_t pts, uint64_t seq) {
+  // the lanes are shared by streams, the memory owner is bound for each image
+  handler_.BindMemoryOwner();
+  std::shared_ptr<CNFrameInfo> data = this->CreateFrameInfo();
+  if (!data) {
+    return nullptr;
+  }
+  data->timestamp = pts;
+  if (!frame->valid) {
+    data->flags = static_cast<size_t>(CNFrameFlag::CN_FRAME_FLAG_INVALID);
+    return data;
+  }
+  if (SourceRender::Process(data, frame, seq, render_param_) < 0) {
+    return nullptr;
+  }
+  return data;
+}
+
+void ESJpegMemHandlerImpl::OnJpegOutput(std::shared_ptr<CNFrameInfo> data) {
+  this->SendFrameInfo(data);
+}
+
+void ESJpegMemHandlerImpl::OnJpegOutputs(const std::vector<std::shared_ptr<CNFrameInfo>> &data) {
+  this->SendFrameInfoBatch(data);
+}
+
+void ESJpegMemHandlerImpl::OnJpegEos() {
+  this->SendFlowEos();
+}
+
 }  // namespace cnstream
@@ -26,15 +26,17 @@
 #include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
 
 #include "cnstream_logging.hpp"
 #include "data_handler_util.hpp"
 #include "data_source.hpp"
+#include "util/jpeg_decode_engine.hpp"
 #include "util/video_decoder.hpp"
 
 namespace cnstream {
 
-class ESJpegMemHandlerImpl : public IDecodeResult, public SourceRender {
+class ESJpegMemHandlerImpl : public IDecodeResult, public IJpegDecodeResult, public SourceRender {
  public:
   explicit ESJpegMemHandlerImpl(DataSource *module, ESJpegMemHandler *handler,
                                 int max_width, int max_height)
@@ -48,12 +50,19 @@ class ESJpegMemHandlerImpl : public IDecodeResult, public SourceRender {
   void Close();
 
   int Write(ESPacket *pkt);
+  int WriteBatch(ESPacket *pkts, int num);
 
   // IDecodeResult methods
   void OnDecodeError(DecodeErrorCode error_code) override;
   void OnDecodeFrame(DecodeFrame *frame) override;
   void OnDecodeEos() override;
 
+  // IJpegDecodeResult methods, the images are decoded by the jpeg decode engine of DataSource
+  std::shared_ptr<CNFrameInfo> OnJpegDecoded(DecodeFrame *frame, int64_t pts, uint64_t seq) override;
+  void OnJpegOutput(std::shared_ptr<CNFrameInfo> data) override;
+  void OnJpegOutputs(const std::vector<std::shared_ptr<CNFrameInfo>> &data) override;
+  void OnJpegEos() override;
+
  private:
   DataSource *module_ = nullptr;
   ESJpegMemHandler &handler_;
@@ -67,9 +76,16 @@ class ESJpegMemHandlerImpl : public IDecodeResult, public SourceRender {
 #endif
   bool InitDecoder();
   bool ProcessImage(ESPacket *pkt);
+  // records the time the image enters the module and the pipeline
+  void RecordInput(uint64_t pts);
 
  private:
   std::shared_ptr<Decoder> decoder_ = nullptr;
+  // replaces decoder_ when jpeg_decode_lanes is set
+  JpegDecodeEngine *jpeg_engine_ = nullptr;
+  std::shared_ptr<JpegDecodeEngine::Stream> jpeg_stream_ = nullptr;
+  // the frames are held until they are in order, codec buffers are never reused by them
+  DataSourceParam render_param_;
   // maximum resolution 8K
   int max_width_ = 7680;
   int max_height_ = 4320;
@@ -115,7 +115,7 @@ int ESMemHandler::WriteEos() {
 
 bool ESMemHandlerImpl::Open() {
   DataSource *source = dynamic_cast<DataSource *>(module_);
-  param_ = source->GetSourceParam();
+  param_ = source->GetSourceParam(stream_id_);
   /*
   if (param_.decoder_type_ != DECODER_MLU) {
     LOGE(SOURCE) << "decoder_type not supported:" << param_.decoder_type_;
@@ -124,14 +124,23 @@ bool ESMemHandlerImpl::Open() {
   */
 
   size_t MaxSize = 60;  // FIXME
-  queue_ = new (std::nothrow) cnstream::BoundedQueue<std::shared_ptr<EsPacket>>(MaxSize);
+  queue_ = new (std::nothrow) SpscPacketQueue(MaxSize);
   if (!queue_) {
-    LOGE(SOURCE) << "[ESMemHandlerImpl] open function, failed to create BoundedQueue.";
+    LOGE(SOURCE) << "[ESMemHandlerImpl] open function, failed to create packet queue.";
     return false;
   }
 
-  // start decode Loop
   running_.store(true);
+  decode_pool_ = source->GetDecodePool();
+  if (decode_pool_) {
+    loop_prepared_ = false;
+    const uint32_t priority = decode_qos_.Init(module_, &handler_, decode_pool_);
+    decode_job_ = decode_pool_->Submit([this](uint32_t *idle_us) { return Step(idle_us); }, priority);
+    if (decode_job_) return true;
+    decode_pool_ = nullptr;
+  }
+  decode_qos_.Init(module_, &handler_, nullptr);
+  // start decode Loop
   thread_ = std::thread(&ESMemHandlerImpl::DecodeLoop, this);
   return true;
 }
@@ -142,6 +151,10 @@ void ESMemHandlerImpl::Stop() {
 
 void ESMemHandlerImpl::Close() {
   Stop();
+  if (decode_pool_ && decode_job_) {
+    decode_pool_->Wait(decode_job_);
+    decode_job_ = 0;
+  }
   if (thread_.joinable()) {
     thread_.join();
   }
@@ -228,7 +241,7 @@ void ESMemHandlerImpl::OnParserFrame(VideoEsFrame *frame) {
   while (running_.load()) {
     int timeoutMs = 1000;
     std::lock_guard<std::mutex> lk(queue_mutex_);
-    if (queue_ && queue_->Push(timeoutMs, std::make_shared<EsPacket>(&pkt))) {
+    if (queue_ && queue_->Push(timeoutMs, pkt.data, pkt.size, pkt.pts, pkt.flags)) {
       break;
     }
     if (!queue_) {
@@ -243,7 +256,27 @@ void ESMemHandlerImpl::DecodeLoop() {
    *  for cpu case(device_id < 0), MluDeviceGuard will do nothing
    */
   MluDeviceGuard guard(param_.device_id_);
+  if (module_) module_->BindThreadToCpus();
+  handler_.BindMemoryOwner();
+
+  if (!PrepareLoop()) {
+    return;
+  }
 
+  LOGD(SOURCE) << "[" << stream_id_ << "]: "
+               << "Mem handler DecodeLoop.";
+  while (running_.load()) {
+    if (!Process()) {
+      break;
+    }
+  }
+
+  LOGD(SOURCE) << "[" << stream_id_ << "]: "
+               << "Mem handler DecodeLoop Exit.";
+  ClearResources();
+}
+
+bool ESMemHandlerImpl::PrepareLoop() {
   if (!PrepareResources()) {
     ClearResources();
     if (eos_reached_ && !info_set_.load()) {
@@ -260,20 +293,38 @@ void ESMemHandlerImpl::DecodeLoop() {
       }
       LOGE(SOURCE) << "PrepareResources failed.";
     }
-    return;
+    return false;
   }
+  return true;
+}
 
-  LOGD(SOURCE) << "[" << stream_id_ << "]: "
-               << "Mem handler DecodeLoop.";
-  while (running_.load()) {
-    if (!Process()) {
-      break;
+bool ESMemHandlerImpl::Step(uint32_t *idle_us) {
+  static constexpr uint32_t kIdleUs = 1000;
+  // the workers are shared by streams, the memory owner is bound for each step
+  handler_.BindMemoryOwner();
+  if (!loop_prepared_) {
+    // PrepareResources waits for the video info, a worker must not be blocked on it
+    if (running_.load() && !info_set_.load() && !eos_reached_) {
+      *idle_us = kIdleUs;
+      return true;
+    }
+    if (!PrepareLoop()) {
+      return false;
     }
+    loop_prepared_ = true;
+    LOGD(SOURCE) << "[" << stream_id_ << "]: "
+                 << "Mem handler decodes in decoder pool.";
+  }
+  bool idle = false;
+  if (running_.load() && Process(0, &idle)) {
+    if (idle) *idle_us = kIdleUs;
+    return true;
   }
 
   LOGD(SOURCE) << "[" << stream_id_ << "]: "
-               << "Mem handler DecodeLoop Exit.";
+               << "Mem handler exits decoder pool.";
   ClearResources();
+  return false;
 }
 
 bool ESMemHandlerImpl::PrepareResources() {
@@ -317,7 +368,13 @@ bool ESMemHandlerImpl::PrepareResources() {
   extra.device_id = param_.device_id_;
   extra.input_buf_num = param_.input_buf_number_;
   extra.output_buf_num = param_.output_buf_number_;
+  if (param_.reuse_cndec_buf) codec_buf_tracker_ = std::make_shared<CodecBufferTracker>(param_.output_buf_number_);
+  if (module_) extra.memory_owner = module_->GetMemoryOwner(stream_id_);
+  SetResourceOwner(module_, &extra);
+  extra.fallback_decoders = param_.decoder_fallback_;
+  extra.export_motion_vectors = param_.motion_activity_;
   extra.apply_stride_align_for_scaler = param_.apply_stride_align_for_scaler_;
+  SetOutputResolution(module_, &extra);
   bool ret = decoder_->Create(&info, &extra);
   if (!ret) {
     return false;
@@ -337,43 +394,50 @@ void ESMemHandlerImpl::ClearResources() {
                << "Finish clearing resources";
 }
 
-bool ESMemHandlerImpl::Process() {
-  using EsPacketPtr = std::shared_ptr<EsPacket>;
-
-  EsPacketPtr in;
-  int timeoutMs  = 1000;
-  bool ret = this->queue_->Pop(timeoutMs, in);
+bool ESMemHandlerImpl::Process(int timeout_ms, bool *idle) {
+  const SpscPacketQueue::Packet *in = queue_->Front(timeout_ms);
 
-  if (!ret) {
+  if (!in) {
     // continue.. not exit
+    if (idle) *idle = true;
     return true;
   }
 
-  if (in->pkt_.flags & static_cast<size_t>(ESPacket::FLAG::FLAG_EOS)) {
+  if (in->flags & static_cast<uint32_t>(ESPacket::FLAG::FLAG_EOS)) {
     LOGI(SOURCE) << "[" << stream_id_ << "]: " << " Process EOS frame in ESMemHandler";
+    queue_->PopFront();
     decoder_->Process(nullptr);
     return false;
   }  // if (!ret)
 
   VideoEsPacket pkt;
-  pkt.data = in->pkt_.data;
-  pkt.len = in->pkt_.size;
-  pkt.pts = in->pkt_.pts;
+  pkt.data = const_cast<uint8_t *>(in->data);
+  pkt.len = in->size;
+  pkt.pts = in->pts;
+  pkt.flags = (in->flags & static_cast<uint32_t>(ESPacket::FLAG::FLAG_KEY_FRAME)) ? VideoEsPacket::FLAG_KEY_FRAME : 0;
+  if (!decode_qos_.KeepPacket(pkt.flags != 0, pkt.pts)) {
+    queue_->PopFront();
+    return true;
+  }
   if (module_ && module_->GetProfiler()) {
-    auto record_key = std::make_pair(stream_id_, pkt.pts);
-    module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, record_key);
+    const uint32_t stream_index = handler_.GetStreamIndex();
+    module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, stream_index, stream_id_, pkt.pts);
     if (module_->GetContainer() && module_->GetContainer()->GetProfiler()) {
-      module_->GetContainer()->GetProfiler()->RecordInput(record_key);
+      module_->GetContainer()->GetProfiler()->RecordInput(stream_index, stream_id_, pkt.pts);
     }
   }
-  if (!decoder_->Process(&pkt)) {
-    return false;
-  }
-  return true;
+  // the slot is given back once the decoder has copied the packet
+  bool ret = decoder_->Process(&pkt);
+  queue_->PopFront();
+  return ret;
 }
 
 // IDecodeResult methods
 void ESMemHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
+  if (DecodeErrorCode::ERROR_CORRUPT_DATA == error_code) {
+    handler_.RecordDropped(kDROP_REASON_CORRUPT_DATA);
+    return;
+  }
   // FIXME,  handle decode error ...
   if (nullptr != module_) {
     Event e;
@@ -388,7 +452,8 @@ void ESMemHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void ESMemHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
-  if (frame_count_++ % param_.interval_ != 0) {
+  if (frame) decode_qos_.OnFrame(frame->pts);
+  if (!KeepFrame(param_.interval_)) {
     return;  // discard frames
   }
   if (!frame) {
@@ -409,7 +474,7 @@ void ESMemHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
     return;
   }
 
-  int ret = SourceRender::Process(data, frame, frame_id_++, param_);
+  int ret = SourceRender::Process(data, frame, frame_id_++, param_, codec_buf_tracker_);
   if (ret < 0) {
     LOGE(SOURCE) << "[" << stream_id_ << "]: "
                  << "Render frame failed";
@@ -30,6 +30,8 @@
 #include "cnstream_logging.hpp"
 #include "data_handler_util.hpp"
 #include "data_source.hpp"
+#include "util/decode_worker_pool.hpp"
+#include "util/spsc_packet_queue.hpp"
 #include "util/video_decoder.hpp"
 #include "util/video_parser.hpp"
 
@@ -53,9 +55,9 @@ class ESMemHandlerImpl : public IParserResult, public IDecodeResult, public Sour
     data_type_ = data_type;
     int ret = -1;
     if (data_type_ == ESMemHandler::DataType::H264) {
-      ret = parser_.Open(AV_CODEC_ID_H264, this, nullptr, 0, param_.only_key_frame_);
+      ret = parser_.Open(AV_CODEC_ID_H264, this, nullptr, 0, param_.only_key_frame_, param_.gop_interval_);
     } else if (data_type_ == ESMemHandler::DataType::H265) {
-      ret = parser_.Open(AV_CODEC_ID_HEVC, this, nullptr, 0, param_.only_key_frame_);
+      ret = parser_.Open(AV_CODEC_ID_HEVC, this, nullptr, 0, param_.only_key_frame_, param_.gop_interval_);
     } else {
       LOGF(SOURCE) << "Unsupported data type " << static_cast<int>(data_type);
       ret = -1;
@@ -96,20 +98,28 @@ class ESMemHandlerImpl : public IParserResult, public IDecodeResult, public Sour
 #endif
   bool PrepareResources();
   void ClearResources();
-  bool Process();
+  bool Process(int timeout_ms = 1000, bool *idle = nullptr);
   bool Extract();
   void DecodeLoop();
+  // Prepares resources for DecodeLoop or Step, posts a stream error event on failure.
+  bool PrepareLoop();
+  // One step of the decode loop when the stream is driven by the decoder pool of DataSource.
+  bool Step(uint32_t *idle_us);
 
  private:
   /**/
   std::atomic<bool> running_{false};
   std::thread thread_;
   bool eos_sent_ = false;
+  DecodeWorkerPool *decode_pool_ = nullptr;
+  uint64_t decode_job_ = 0;
+  DecodeQos decode_qos_;
+  bool loop_prepared_ = false;
   std::atomic<bool> generate_pts_{false};
   uint64_t fake_pts_ = 0;
 
   EsParser parser_;
-  BoundedQueue<std::shared_ptr<EsPacket>> *queue_ = nullptr;
+  SpscPacketQueue *queue_ = nullptr;
   /*
    * Ensure that the queue_ is not deleted when the push is blocked.
    */
@@ -20,8 +20,10 @@
 
 #include "data_handler_rawimg.hpp"
 #include <cnrt.h>
+#include <libyuv.h>
 
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <queue>
 #include <sstream>
@@ -30,6 +32,7 @@
 #include <utility>
 
 #include "cnstream_frame_va.hpp"
+#include "private/cnstream_parallel.hpp"
 #include "profiler/module_profiler.hpp"
 #include "profiler/pipeline_profiler.hpp"
 
@@ -38,6 +41,26 @@
 
 namespace cnstream {
 
+// images higher than two bands are converted on multiple threads
+static constexpr int kMinConvertBandRows = 360;
+
+// converts BGR24 (or RGB24) with even width and height to NV12 directly, in bands of even rows.
+static bool CvtBGRToNV12(const uint8_t *src_bgr, uint8_t *dst_nv12, const int width, const int height,
+                         const int dst_stride, bool rgb) {
+  uint8_t *dst_uv = dst_nv12 + dst_stride * height;
+  ParallelFor(height, kMinConvertBandRows, 2, [&](int begin, int end) {
+    const uint8_t *src = src_bgr + begin * width * 3;
+    uint8_t *y = dst_nv12 + begin * dst_stride;
+    uint8_t *uv = dst_uv + begin / 2 * dst_stride;
+    // RGB24 of libyuv is BGR in memory, RAW is RGB in memory
+    if (rgb)
+      libyuv::RAWToNV12(src, width * 3, y, dst_stride, uv, dst_stride, width, end - begin);
+    else
+      libyuv::RGB24ToNV12(src, width * 3, y, dst_stride, uv, dst_stride, width, end - begin);
+  });
+  return true;
+}
+
 static bool CvtI420ToNV12(const uint8_t *src_I420, uint8_t *dst_nv12, const int width,
     const int height, const int dst_stride) {
   if (!src_I420 || !dst_nv12 || width <= 0 || height <= 0 || dst_stride <= 0) {
@@ -198,14 +221,24 @@ int RawImgMemHandler::Write(const uint8_t *data, const int size, const uint64_t
   return -1;
 }
 
+int RawImgMemHandler::Write(const RawImgBuffer &buffer, const uint64_t pts) {
+  if (impl_) {
+    return impl_->Write(buffer, pts);
+  }
+  if (buffer.release) buffer.release();
+  return -1;
+}
+
 bool RawImgMemHandlerImpl::Open() {
   // updated with paramSet
   DataSource *source = dynamic_cast<DataSource *>(module_);
-  param_ = source->GetSourceParam();
+  param_ = source->GetSourceParam(stream_id_);
   return true;
 }
 
 void RawImgMemHandlerImpl::Close() {
+  // wakes up the writer waiting for frames, see SourceRender::CreateFrameInfo
+  interrupt_.store(true);
   if (src_mat_) {
     delete src_mat_;
     src_mat_ = nullptr;
@@ -234,10 +267,10 @@ int RawImgMemHandlerImpl::Write(const cv::Mat *mat_data, const uint64_t pts) {
     int height = mat_data->rows;
     int size = mat_data->step * height;
     if (module_ && module_->GetProfiler()) {
-      auto record_key = std::make_pair(stream_id_, pts);
-      module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, record_key);
+      const uint32_t stream_index = handler_.GetStreamIndex();
+      module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, stream_index, stream_id_, pts);
       if (module_->GetContainer() && module_->GetContainer()->GetProfiler()) {
-        module_->GetContainer()->GetProfiler()->RecordInput(record_key);
+        module_->GetContainer()->GetProfiler()->RecordInput(stream_index, stream_id_, pts);
       }
     }
     if (ProcessImage(mat_data->data, size, width, height, CNDataFormat::CN_PIXEL_FORMAT_BGR24, pts)) {
@@ -263,10 +296,10 @@ int RawImgMemHandlerImpl::Write(const uint8_t *img_data, const int size, const u
     return 0;
   } else if (CheckRawImageParams(img_data, size, w, h, pixel_fmt)) {
     if (module_ && module_->GetProfiler()) {
-      auto record_key = std::make_pair(stream_id_, pts);
-      module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, record_key);
+      const uint32_t stream_index = handler_.GetStreamIndex();
+      module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, stream_index, stream_id_, pts);
       if (module_->GetContainer() && module_->GetContainer()->GetProfiler()) {
-        module_->GetContainer()->GetProfiler()->RecordInput(record_key);
+        module_->GetContainer()->GetProfiler()->RecordInput(stream_index, stream_id_, pts);
       }
     }
     if (ProcessImage(img_data, size, w, h, pixel_fmt, pts)) {
@@ -279,6 +312,142 @@ int RawImgMemHandlerImpl::Write(const uint8_t *img_data, const int size, const u
   return -2;
 }
 
+int RawImgMemHandlerImpl::Write(const RawImgBuffer &buffer, const uint64_t pts) {
+  // the release callback is called once the last reference to the buffer is gone, also when the buffer is rejected
+  std::function<void()> release = buffer.release;
+  std::shared_ptr<void> holder(buffer.planes[0], [release](void *) {
+    if (release) release();
+  });
+  if (eos_got_.load()) {
+    LOGW(SOURCE) << "[" << stream_id_ << "]: " << "eos got, can not feed data any more.";
+    return -1;
+  }
+  if (!buffer.planes[0] || buffer.width <= 0 || buffer.height <= 0) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: " << "RawImgMemHandler Write, invalid buffer.";
+    return -2;
+  }
+
+  if (module_ && module_->GetProfiler()) {
+    const uint32_t stream_index = handler_.GetStreamIndex();
+    module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, stream_index, stream_id_, pts);
+    if (module_->GetContainer() && module_->GetContainer()->GetProfiler()) {
+      module_->GetContainer()->GetProfiler()->RecordInput(stream_index, stream_id_, pts);
+    }
+  }
+
+  if (CanWrapBuffer(buffer)) {
+    return WrapBuffer(buffer, holder, pts) ? 0 : -1;
+  }
+
+  // falls back to converting the image, which is only possible for continuous planes on host
+  const uint8_t *data = static_cast<const uint8_t *>(buffer.planes[0]);
+  int size = 0;
+  bool continuous = buffer.dev_id < 0 && buffer.stride[0] == buffer.width;
+  switch (buffer.fmt) {
+    case CNDataFormat::CN_PIXEL_FORMAT_BGR24:
+    case CNDataFormat::CN_PIXEL_FORMAT_RGB24:
+      size = buffer.width * buffer.height * 3;
+      break;
+    case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21:
+    case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12:
+      size = buffer.width * buffer.height * 3 / 2;
+      continuous = continuous && buffer.planes[1] == data + buffer.width * buffer.height;
+      break;
+    default:
+      break;
+  }
+  if (!continuous || !CheckRawImageParams(data, size, buffer.width, buffer.height, buffer.fmt)) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: "
+                 << "RawImgMemHandler Write, the buffer can not be wrapped or converted.";
+    return -2;
+  }
+  return ProcessImage(data, size, buffer.width, buffer.height, buffer.fmt, pts) ? 0 : -1;
+}
+
+bool RawImgMemHandlerImpl::CanWrapBuffer(const RawImgBuffer &buffer) const {
+  if (buffer.fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 &&
+      buffer.fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21) {
+    return false;
+  }
+  if (!buffer.planes[1] || buffer.width % 2 || buffer.stride[0] < buffer.width || buffer.stride[1] < buffer.width) {
+    return false;
+  }
+  if (param_.apply_stride_align_for_scaler_ &&
+      (buffer.stride[0] % STRIDE_ALIGN_FOR_SCALER_NV12 || buffer.stride[1] % STRIDE_ALIGN_FOR_SCALER_NV12)) {
+    return false;
+  }
+  if (buffer.dev_id >= 0) {
+    // the planes on device can not be given to modules expecting frames on host
+    return param_.output_type_ == OutputType::OUTPUT_MLU && buffer.dev_id == param_.device_id_;
+  }
+  return true;
+}
+
+bool RawImgMemHandlerImpl::WrapBuffer(const RawImgBuffer &buffer, std::shared_ptr<void> holder, const uint64_t pts) {
+  if (!KeepFrame(param_.interval_)) {
+    return true;  // discard frames
+  }
+  // the frame is allocated by the thread of the caller
+  handler_.BindMemoryOwner();
+  std::shared_ptr<CNFrameInfo> data = CreateFrameInfo();
+  if (!data) {
+    LOGE(SOURCE) << "[RawImgMemHandlerImpl] WrapBuffer function, failed to create FrameInfo.";
+    return false;
+  }
+  std::shared_ptr<CNDataFrame> dataframe(new (std::nothrow) CNDataFrame());
+  if (!dataframe) {
+    LOGE(SOURCE) << "[RawImgMemHandlerImpl] WrapBuffer function, failed to create dataframe.";
+    return false;
+  }
+
+  if (param_.output_type_ == OutputType::OUTPUT_MLU) {
+    dataframe->ctx.dev_type = DevContext::DevType::MLU;
+    dataframe->ctx.dev_id = param_.device_id_;
+  } else {
+    dataframe->ctx.dev_type = DevContext::DevType::CPU;
+    dataframe->ctx.dev_id = -1;
+  }
+  dataframe->ctx.ddr_channel = -1;
+  dataframe->fmt = buffer.fmt;
+  dataframe->width = buffer.width;
+  dataframe->height = buffer.height;
+  dataframe->stride[0] = buffer.stride[0];
+  dataframe->stride[1] = buffer.stride[1];
+
+  bool on_mlu = buffer.dev_id >= 0;
+  for (int i = 0; i < dataframe->GetPlanes(); ++i) {
+    size_t plane_size = dataframe->GetPlaneBytes(i);
+    CNSyncedMemory *CNSyncedMemory_ptr = nullptr;
+    if (dataframe->ctx.dev_type == DevContext::DevType::MLU) {
+      // host planes are copied to the device by CNSyncedMemory when they are accessed on MLU
+      CNSyncedMemory_ptr =
+          new (std::nothrow) CNSyncedMemory(plane_size, dataframe->ctx.dev_id, dataframe->ctx.ddr_channel);
+    } else {
+      CNSyncedMemory_ptr = new (std::nothrow) CNSyncedMemory(plane_size);
+    }
+    LOGF_IF(SOURCE, nullptr == CNSyncedMemory_ptr) << "[" << stream_id_ << "]: "
+                                                   << "RawImgMemHandlerImpl new CNSyncedMemory failed";
+    dataframe->data[i].reset(CNSyncedMemory_ptr);
+    if (on_mlu) {
+      dataframe->data[i]->SetMluData(buffer.planes[i]);
+    } else {
+      dataframe->data[i]->SetCpuData(buffer.planes[i]);
+    }
+  }
+  // the frame holds the buffer of the caller, the buffer is released with the frame
+  if (on_mlu) {
+    dataframe->mlu_data = holder;
+  } else {
+    dataframe->cpu_data = holder;
+  }
+
+  dataframe->frame_id = frame_id_++;
+  data->timestamp = pts;
+  data->collection.Get(kCNDataFrameSlot) = dataframe;
+  SendFrameInfo(data);
+  return true;
+}
+
 bool RawImgMemHandlerImpl::CheckRawImageParams(const uint8_t *data, const int size,
     const int width, const int height, const CNDataFormat pixel_fmt) {
   if (data && size > 0 && width > 0 && height > 0) {
@@ -305,9 +474,11 @@ bool RawImgMemHandlerImpl::ProcessImage(const uint8_t *img_data, const int size,
     LOGE(SOURCE) << "[RawImgMemHandlerImpl] ProcessImage function img_data is nullptr.";
     return false;
   }
-  if (frame_count_++ % param_.interval_ != 0) {
+  if (!KeepFrame(param_.interval_)) {
     return true;  // discard frames
   }
+  // the frame is allocated by the thread of the caller
+  handler_.BindMemoryOwner();
   int dst_stride = width;
   dst_stride = std::ceil(1.0 * dst_stride / STRIDE_ALIGN) * STRIDE_ALIGN;  // align stride to 64 by default
   if (param_.apply_stride_align_for_scaler_) {
@@ -331,11 +502,10 @@ bool RawImgMemHandlerImpl::ProcessImage(const uint8_t *img_data, const int size,
   }
 
   // create cnframedata and fill it
-  std::shared_ptr<CNFrameInfo> data;
-  while (true) {
-    data = CreateFrameInfo();
-    if (data != nullptr) break;
-    std::this_thread::sleep_for(std::chrono::microseconds(5));
+  std::shared_ptr<CNFrameInfo> data = CreateFrameInfo();
+  if (!data) {
+    LOGE(SOURCE) << "[RawImgMemHandlerImpl] ProcessImage function, failed to create FrameInfo.";
+    return false;
   }
   std::shared_ptr<CNDataFrame> dataframe(new (std::nothrow) CNDataFrame());
   if (!dataframe) {
@@ -404,7 +574,7 @@ bool RawImgMemHandlerImpl::ProcessImage(const uint8_t *img_data, const int size,
 
   dataframe->frame_id = frame_id_++;
   data->timestamp = pts;
-  data->collection.Get<CNDataFramePtr>(kCNDataFrameTag) = dataframe;
+  data->collection.Get(kCNDataFrameSlot) = dataframe;
   SendFrameInfo(data);
   return true;
 }
@@ -473,10 +643,12 @@ bool RawImgMemHandlerImpl::CvtColorWithStride(const uint8_t *data, const int siz
 
   switch (pixel_fmt) {
     case CNDataFormat::CN_PIXEL_FORMAT_BGR24:
+      if (width % 2 == 0 && height % 2 == 0) return CvtBGRToNV12(data, dst_nv12_data, width, height, dst_stride, false);
       if (!PrepareConvertCtx(data, size, width, height, pixel_fmt)) return false;
       cv::cvtColor(*src_mat_, *dst_mat_, cv::COLOR_BGR2YUV_I420);
       return CvtI420ToNV12(dst_mat_->data, dst_nv12_data, width, height, dst_stride);
     case CNDataFormat::CN_PIXEL_FORMAT_RGB24:
+      if (width % 2 == 0 && height % 2 == 0) return CvtBGRToNV12(data, dst_nv12_data, width, height, dst_stride, true);
       if (!PrepareConvertCtx(data, size, width, height, pixel_fmt)) return false;
       cv::cvtColor(*src_mat_, *dst_mat_, cv::COLOR_RGB2YUV_I420);
       return CvtI420ToNV12(dst_mat_->data, dst_nv12_data, width, height, dst_stride);
@@ -79,6 +79,17 @@ class RawImgMemHandlerImpl : public SourceRender {
   int Write(const uint8_t *data, const int size, const uint64_t pts = 0, const int width = 0, const int height = 0,
             const CNDataFormat pixel_fmt = CNDataFormat::CN_INVALID);
 
+  /**
+   * @brief Sends raw image in a buffer of the caller, nv12 and nv21 images are not copied.
+   * @param
+          - buffer: image buffer, buffer.release is called when the buffer is not used any more
+          - pts: pts for image, should be different for each image
+   * @retval 0: The data is write successfully,
+   * @retval -1: Write failed, maybe eos got or handler is closed.
+   * @retval -2: Invalid data.
+   */
+  int Write(const RawImgBuffer &buffer, const uint64_t pts);
+
  private:
   DataSource *module_ = nullptr;
   RawImgMemHandler &handler_;
@@ -102,6 +113,10 @@ class RawImgMemHandlerImpl : public SourceRender {
   bool ProcessImage(const uint8_t *data, const int size, const int width,
       const int height, const CNDataFormat pixel_fmt, const uint64_t pts);
 
+  bool CanWrapBuffer(const RawImgBuffer &buffer) const;
+
+  bool WrapBuffer(const RawImgBuffer &buffer, std::shared_ptr<void> holder, const uint64_t pts);
+
  private:
   std::atomic<bool> eos_got_{false};
   uint64_t frame_id_ = 0;
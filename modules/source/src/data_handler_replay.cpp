@@ -0,0 +1,198 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "data_handler_replay.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+std::shared_ptr<SourceHandler> ReplayHandler::Create(DataSource *module, const std::string &stream_id,
+                                                     const ReplayParam &param) {
+  if (!module || stream_id.empty() || param.path.empty() || param.speed < 0) {
+    LOGE(SOURCE) << "[ReplayHandler] Create function, invalid paramters.";
+    return nullptr;
+  }
+  std::shared_ptr<ReplayHandler> handler(new (std::nothrow) ReplayHandler(module, stream_id, param));
+  return handler;
+}
+
+ReplayHandler::ReplayHandler(DataSource *module, const std::string &stream_id, const ReplayParam &param)
+    : ESMemHandler(module, stream_id, MaximumVideoResolution()) {
+  replay_impl_ = new (std::nothrow) ReplayHandlerImpl(this, param);
+}
+
+ReplayHandler::~ReplayHandler() {
+  // the packets are not written any more before the es handler is destroyed
+  if (replay_impl_) {
+    Stop();
+    delete replay_impl_, replay_impl_ = nullptr;
+  }
+}
+
+bool ReplayHandler::Open() {
+  if (!replay_impl_) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: "
+                 << "ReplayHandler open failed, no memory left";
+    return false;
+  }
+  if (!replay_impl_->Open()) return false;
+  if (!ESMemHandler::Open()) return false;
+  if (!replay_impl_->Start()) {
+    ESMemHandler::Close();
+    return false;
+  }
+  return true;
+}
+
+void ReplayHandler::Stop() {
+  if (replay_impl_) {
+    replay_impl_->Stop();
+  }
+  // wakes up the replay thread blocked by a full packet queue
+  ESMemHandler::Stop();
+}
+
+void ReplayHandler::Close() {
+  Stop();
+  if (replay_impl_) {
+    replay_impl_->Close();
+  }
+  ESMemHandler::Close();
+}
+
+bool ReplayHandlerImpl::Open() {
+  if (!reader_.Open(param_.path)) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: "
+                 << "Failed to read capture " << param_.path;
+    return false;
+  }
+  LOGI(SOURCE) << "[" << stream_id_ << "]: "
+               << "Replay " << param_.path << ", " << reader_.GetIndex().size() << " key frames";
+  return true;
+}
+
+bool ReplayHandlerImpl::Start() {
+  ESMemHandler::DataType type = ESMemHandler::DataType::INVALID;
+  if (reader_.GetCodecId() == AV_CODEC_ID_H264) {
+    type = ESMemHandler::DataType::H264;
+  } else if (reader_.GetCodecId() == AV_CODEC_ID_HEVC) {
+    type = ESMemHandler::DataType::H265;
+  } else {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: "
+                 << "Unsupported codec of capture " << param_.path << ", only H264 and H265 are replayed";
+    return false;
+  }
+  if (handler_.SetDataType(type) != 0) return false;
+  running_.store(true);
+  thread_ = std::thread(&ReplayHandlerImpl::ReplayLoop, this);
+  return true;
+}
+
+void ReplayHandlerImpl::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    running_.store(false);
+  }
+  cond_.notify_all();
+}
+
+void ReplayHandlerImpl::Close() {
+  Stop();
+  if (thread_.joinable()) thread_.join();
+  reader_.Close();
+}
+
+bool ReplayHandlerImpl::WaitUntil(std::chrono::steady_clock::time_point time) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  cond_.wait_until(lk, time, [this] { return !running_.load(); });
+  return running_.load();
+}
+
+void ReplayHandlerImpl::ReplayLoop() {
+  // the parameter sets in annex-b format are sent with the first packet, the ones of mp4 files (avcC/hvcC) are not
+  // needed as the packets carry them in-band
+  const std::vector<uint8_t> &extra_data = reader_.GetExtraData();
+  const bool annexb_extra = extra_data.size() > 3 && extra_data[0] == 0 && extra_data[1] == 0 &&
+                            (extra_data[2] == 1 || (extra_data[2] == 0 && extra_data[3] == 1));
+  std::vector<uint8_t> first_data;
+  bool first = true;
+
+  CapturedPacket pkt;
+  uint64_t written = 0;
+  // the time and pts added to the packets of the later loops
+  int64_t loop_us = 0, loop_pts = 0;
+  int64_t last_us = 0, last_pts = 0, step_us = 0, step_pts = 0;
+  bool eos = true;
+  const auto start = std::chrono::steady_clock::now();
+  while (running_.load()) {
+    if (!reader_.Read(&pkt)) {
+      if (!param_.loop || !written) break;
+      // the next loop goes on after the last packet as the packets went on before it
+      reader_.Rewind();
+      loop_us = last_us + step_us;
+      loop_pts = last_pts + step_pts;
+      continue;
+    }
+    const int64_t arrival_us = loop_us + pkt.arrival_us;
+    const int64_t pts = loop_pts + pkt.pts;
+    if (written) {
+      step_us = arrival_us - last_us;
+      step_pts = pts - last_pts;
+    }
+    last_us = arrival_us;
+    last_pts = pts;
+    if (param_.speed > 0 &&
+        !WaitUntil(start + std::chrono::microseconds(static_cast<int64_t>(arrival_us / param_.speed)))) {
+      break;
+    }
+
+    ESPacket es_pkt;
+    es_pkt.data = pkt.data.data();
+    es_pkt.size = static_cast<int>(pkt.data.size());
+    if (first && annexb_extra) {
+      first_data = extra_data;
+      first_data.insert(first_data.end(), pkt.data.begin(), pkt.data.end());
+      es_pkt.data = first_data.data();
+      es_pkt.size = static_cast<int>(first_data.size());
+    }
+    first = false;
+    es_pkt.pts = static_cast<uint64_t>(pts);
+    es_pkt.flags = (pkt.flags & VideoEsFrame::FLAG_KEY_FRAME) ? static_cast<uint32_t>(ESPacket::FLAG::FLAG_KEY_FRAME)
+                                                               : 0;
+    if (handler_.Write(&es_pkt) != 0) {
+      // the handler is closed or the eos is sent
+      eos = false;
+      break;
+    }
+    ++written;
+  }
+  if (eos) handler_.WriteEos();
+  LOGI(SOURCE) << "[" << stream_id_ << "]: "
+               << written << " packets are replayed";
+}
+
+}  // namespace cnstream
@@ -0,0 +1,66 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_SOURCE_HANDLER_REPLAY_HPP_
+#define MODULES_SOURCE_HANDLER_REPLAY_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "data_source.hpp"
+#include "util/packet_capture.hpp"
+
+namespace cnstream {
+
+class ReplayHandlerImpl {
+ public:
+  ReplayHandlerImpl(ReplayHandler *handler, const ReplayParam &param)
+      : handler_(*handler), param_(param), stream_id_(handler->GetStreamId()) {}
+  ~ReplayHandlerImpl() { Close(); }
+
+  // reads the header of the capture
+  bool Open();
+  // starts to replay, called after ESMemHandler is opened
+  bool Start();
+  void Stop();
+  void Close();
+
+ private:
+  // writes the packets to ESMemHandler at the time they arrived, then sends the eos
+  void ReplayLoop();
+  // returns false if it is stopped
+  bool WaitUntil(std::chrono::steady_clock::time_point time);
+
+  ReplayHandler &handler_;
+  ReplayParam param_;
+  std::string stream_id_;
+  PacketCaptureReader reader_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};  // class ReplayHandlerImpl
+
+}  // namespace cnstream
+
+#endif  // MODULES_SOURCE_HANDLER_REPLAY_HPP_
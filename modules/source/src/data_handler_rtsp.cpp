@@ -28,6 +28,8 @@ extern "C" {
 }
 #endif
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -35,6 +37,7 @@ extern "C" {
 #include <utility>
 
 #include "data_handler_rtsp.hpp"
+#include "util/rtsp_failover.hpp"
 
 #include "profiler/module_profiler.hpp"
 #include "profiler/pipeline_profiler.hpp"
@@ -60,6 +63,9 @@ class IDemuxer {
   virtual bool PrepareResources(std::atomic<int> &exit_flag) = 0;  // NOLINT
   virtual void ClearResources(std::atomic<int> &exit_flag) = 0;   // NOLINT
   virtual bool Process() = 0;  // process one frame
+  // Non-blocking PrepareResources for the decoder pool: StartPrepare once, then PollPrepare until it is not 0.
+  virtual bool StartPrepare() { return false; }
+  virtual int PollPrepare() { return -1; }  // 1: ready, 0: in progress, -1: failed
   bool GetInfo(VideoInfo &info) {  // NOLINT
     std::unique_lock<std::mutex> lk(mutex_);
     if (info_set_) {
@@ -83,13 +89,15 @@ class IDemuxer {
 
 class FFmpegDemuxer : public rtsp_detail::IDemuxer, public IParserResult {
  public:
-  FFmpegDemuxer(const std::string &stream_id, FrameQueue *queue, const std::string &url, bool only_I)
-      : rtsp_detail::IDemuxer(), queue_(queue), url_name_(url), parser_(stream_id), only_key_frame_(only_I) {}
+  FFmpegDemuxer(const std::string &stream_id, SpscPacketQueue *queue, const std::string &url, bool only_I,
+                uint32_t gop_interval, PacketCaptureWriter *capture)
+      : rtsp_detail::IDemuxer(), queue_(queue), url_name_(url), parser_(stream_id), only_key_frame_(only_I),
+        gop_interval_(gop_interval), capture_(capture) {}
 
   ~FFmpegDemuxer() { }
 
   bool PrepareResources(std::atomic<int> &exit_flag) override {
-    if (parser_.Open(url_name_, this, only_key_frame_) == 0) {
+    if (parser_.Open(url_name_, this, only_key_frame_, gop_interval_) == 0) {
       eos_reached_ = false;
       return true;
     }
@@ -111,6 +119,7 @@ class FFmpegDemuxer : public rtsp_detail::IDemuxer, public IParserResult {
   // IParserResult methods
   void OnParserInfo(VideoInfo *info) override {
     this->SetInfo(*info);
+    if (capture_) capture_->SetInfo(*info);
   }
   void OnParserFrame(VideoEsFrame *frame) override {
     ESPacket pkt;
@@ -122,36 +131,66 @@ class FFmpegDemuxer : public rtsp_detail::IDemuxer, public IParserResult {
       if (frame->flags & AV_PKT_FLAG_KEY) {
         pkt.flags |= static_cast<size_t>(ESPacket::FLAG::FLAG_KEY_FRAME);
       }
+      if (capture_) capture_->Write(frame->data, frame->len, frame->pts, frame->flags & AV_PKT_FLAG_KEY);
     } else {
       pkt.flags = static_cast<size_t>(ESPacket::FLAG::FLAG_EOS);
       eos_reached_ = true;
     }
     if (queue_) {
-      queue_->Push(std::make_shared<EsPacket>(&pkt));
+      queue_->Push(-1, pkt.data, pkt.size, pkt.pts, pkt.flags);
     }
   }
 
  private:
-  FrameQueue *queue_ = nullptr;
+  SpscPacketQueue *queue_ = nullptr;
   std::string url_name_;
   FFParser parser_;
   bool eos_reached_ = false;
   bool only_key_frame_ = false;
+  uint32_t gop_interval_ = 1;
+  PacketCaptureWriter *capture_ = nullptr;
 };  // class FFmpegDemuxer
 
 class Live555Demuxer : public rtsp_detail::IDemuxer, public IRtspCB {
  public:
-  Live555Demuxer(const std::string &stream_id, FrameQueue *queue, const std::string &url, int reconnect, bool only_I)
+  Live555Demuxer(const std::string &stream_id, SpscPacketQueue *queue, const std::string &url, int reconnect, bool only_I,
+                 uint32_t gop_interval, uint32_t reactor_threads, bool standby,
+                 std::function<void(uint64_t)> on_preroll, PacketCaptureWriter *capture)
       : rtsp_detail::IDemuxer(),
         stream_id_(stream_id),
         queue_(queue),
         url_(url),
         reconnect_(reconnect),
-        only_key_frame_(only_I) {}
+        only_key_frame_(only_I),
+        gop_interval_(gop_interval),
+        reactor_threads_(reactor_threads),
+        standby_(standby),
+        on_preroll_(on_preroll),
+        capture_(capture),
+        standby_cb_(this),
+        failover_([this](const uint8_t *data, size_t size, uint64_t pts, bool key_frame, bool preroll) {
+          PushPacket(data, size, pts, key_frame, preroll);
+        }, standby ? 2 : 1) {}
 
   virtual ~Live555Demuxer() {}
 
   bool PrepareResources(std::atomic<int> &exit_flag) override {
+    StartPrepare();
+
+    int ret = 0;
+    while (!exit_flag && (ret = PollPrepare()) == 0) {
+      usleep(1000);
+    }
+    if (exit_flag || ret < 0) {
+      return false;
+    }
+
+    LOGD(SOURCE) << "[" << stream_id_ << "]: "
+                 << "Finish prepare resources";
+    return true;
+  }
+
+  bool StartPrepare() override {
     LOGD(SOURCE) << "[" << stream_id_ << "]: "
                  << "Begin prepare resources";
     // start rtsp_client
@@ -159,89 +198,154 @@ class Live555Demuxer : public rtsp_detail::IDemuxer, public IRtspCB {
     param.url = url_;
     param.reconnect = reconnect_;
     param.only_key_frame = only_key_frame_;
+    param.gop_interval = gop_interval_;
     param.cb = dynamic_cast<IRtspCB*>(this);
+    param.reactor_threads = reactor_threads_;
     rtsp_session_.Open(param);
-
-    while (1) {
-      if (info_set_) {
-        break;
-      }
-      if (exit_flag) {
-        break;
-      }
-      if (connect_failed_) {
-        return false;
-      }
-    }
-    if (exit_flag) {
-      return false;
+    if (standby_) {
+      // the standby session is connected in advance and keeps the last GOP, see RtspFailover
+      LOGI(SOURCE) << "[" << stream_id_ << "]: "
+                   << "Open standby rtsp session";
+      param.cb = &standby_cb_;
+      standby_session_.Open(param);
     }
-
-    LOGD(SOURCE) << "[" << stream_id_ << "]: "
-                 << "Finish prepare resources";
     return true;
   }
 
+  int PollPrepare() override {
+    if (info_set_) return 1;
+    if (connect_failed_) return -1;
+    return 0;
+  }
+
   void ClearResources(std::atomic<int> &exit_flag) override {
     LOGD(SOURCE) << "[" << stream_id_ << "]: "
                  << "Begin clear resources";
     rtsp_session_.Close();
+    if (standby_) standby_session_.Close();
     LOGD(SOURCE) << "[" << stream_id_ << "]: "
                  << "Finish clear resources";
   }
 
   bool Process() override {
+    if (reactor_threads_ > 0) {
+      // called by the decode thread when no packet is available
+      return !eos_reached_.load();
+    }
     usleep(100 * 1000);
     return true;
   }
 
  private:
-  // IRtspCB methods
-  void OnRtspInfo(VideoInfo *info) override {
+  // IRtspCB methods of the main session
+  void OnRtspInfo(VideoInfo *info) override { OnSessionInfo(info); }
+  void OnRtspFrame(VideoEsFrame *frame) override { OnSessionFrame(0, frame); }
+  void OnRtspEvent(int type) override { OnSessionEvent(0, type); }
+
+  struct StandbyCallback : public IRtspCB {
+    explicit StandbyCallback(Live555Demuxer *demuxer) : demuxer_(demuxer) {}
+    void OnRtspInfo(VideoInfo *info) override { demuxer_->OnSessionInfo(info); }
+    void OnRtspFrame(VideoEsFrame *frame) override { demuxer_->OnSessionFrame(1, frame); }
+    void OnRtspEvent(int type) override { demuxer_->OnSessionEvent(1, type); }
+    Live555Demuxer *demuxer_;
+  };
+
+  void OnSessionInfo(VideoInfo *info) {
+    // the sessions connect to the same camera, the first info is kept
+    if (info_set_) return;
     this->SetInfo(*info);
+    if (capture_) capture_->SetInfo(*info);
     info_set_.store(true);
   }
-  void OnRtspFrame(VideoEsFrame *frame) override {
-    ESPacket pkt;
+
+  void OnSessionFrame(int session, VideoEsFrame *frame) {
     if (frame) {
-      pkt.data = frame->data;
-      pkt.size = frame->len;
-      pkt.pts = frame->pts;
-      pkt.flags = 0;
-      if (frame->flags & AV_PKT_FLAG_KEY) {
-        pkt.flags |= static_cast<size_t>(ESPacket::FLAG::FLAG_KEY_FRAME);
-      }
       if (!connect_done_) {
         connect_done_.store(true);
         LOGI(SOURCE) << "[" << stream_id_ << "]: "
                      << "Rtsp connect success";
       }
-    } else {
-      pkt.flags = static_cast<size_t>(ESPacket::FLAG::FLAG_EOS);
-      if (!connect_done_) {
-        // Failed to connect server...
+      failover_.OnPacket(session, frame->data, frame->len, frame->pts, frame->flags & AV_PKT_FLAG_KEY,
+                         std::chrono::steady_clock::now());
+      return;
+    }
+    // the session will not reconnect any more
+    if (!failover_.OnFinished(session)) {
+      LOGW(SOURCE) << "[" << stream_id_ << "]: "
+                   << "Rtsp session " << session << " finished, the other session goes on";
+      return;
+    }
+    if (!connect_done_) {
+      // Failed to connect server...
+      LOGW(SOURCE) << "[" << stream_id_ << "]: "
+                   << "Rtsp connect failed";
+      connect_failed_.store(true);
+    }
+    eos_reached_.store(true);
+    if (!queue_) return;
+    // a dropped eos is found by Process() with the shared event loops
+    queue_->Push(reactor_threads_ == 0 ? -1 : 0, nullptr, 0, 0, static_cast<uint32_t>(ESPacket::FLAG::FLAG_EOS));
+  }
+
+  void OnSessionEvent(int session, int type) {
+    if (type == RTSP_EVENT_DISCONNECTED) {
+      int active = failover_.GetActiveSession();
+      failover_.OnDisconnected(session);
+      if (session == active) {
         LOGW(SOURCE) << "[" << stream_id_ << "]: "
-                     << "Rtsp connect failed";
-        connect_failed_.store(true);
+                     << "Rtsp connection lost, " << (failover_.GetActiveSession() != active ?
+                        "switched to the standby session" : "reconnecting");
       }
     }
-    if (queue_) {
-      queue_->Push(std::make_shared<EsPacket>(&pkt));
-    }
   }
 
-  void OnRtspEvent(int type) override {}
+  // called by RtspFailover
+  void PushPacket(const uint8_t *data, size_t size, uint64_t pts, bool key_frame, bool preroll) {
+    uint32_t flags = key_frame ? static_cast<uint32_t>(ESPacket::FLAG::FLAG_KEY_FRAME) : 0;
+    // the packets of the active session are captured, including the ones dropped by a full queue
+    if (capture_) capture_->Write(data, size, pts, key_frame);
+    if (!queue_) return;
+    // set before the packet is decoded
+    if (preroll && on_preroll_) on_preroll_(pts);
+    if (reactor_threads_ == 0) {
+      queue_->Push(-1, data, size, pts, flags);
+      return;
+    }
+    // The event loop is shared by many streams, a slow decoder must not block it. Packets are dropped until the next
+    // key frame when the queue is full.
+    if (wait_key_frame_ && !key_frame) return;
+    if (!queue_->Push(0, data, size, pts, flags)) {
+      if (!wait_key_frame_) {
+        LOGW(SOURCE) << "[" << stream_id_ << "]: "
+                     << "Packet queue is full, drop packets until the next key frame";
+      }
+      wait_key_frame_ = true;
+      return;
+    }
+    wait_key_frame_ = false;
+  }
 
  private:
   std::string stream_id_;
-  FrameQueue *queue_ = nullptr;
+  SpscPacketQueue *queue_ = nullptr;
   std::string url_;
   int reconnect_ = 0;
   bool only_key_frame_ = false;
-  RtspSession rtsp_session_;
   std::atomic<bool> connect_done_{false};
   std::atomic<bool> connect_failed_{false};
   std::atomic<bool> info_set_{false};
+  uint32_t gop_interval_ = 1;
+  uint32_t reactor_threads_ = 0;
+  std::atomic<bool> eos_reached_{false};
+  bool wait_key_frame_ = false;  // guarded by the lock of failover_
+  bool standby_ = false;
+  std::function<void(uint64_t)> on_preroll_;
+  PacketCaptureWriter *capture_ = nullptr;
+  StandbyCallback standby_cb_;
+  RtspFailover failover_;
+  // destructed first, the sessions call back until they are closed
+  RtspSession rtsp_session_;
+  RtspSession standby_session_;
 };  // class Live555Demuxer
 
 RtspHandler::RtspHandler(DataSource *module, const std::string &stream_id, const std::string &url_name, bool use_ffmpeg,
@@ -277,6 +381,15 @@ bool RtspHandler::Open() {
   return impl_->Open();
 }
 
+RtspHandlerImpl::RtspHandlerImpl(DataSource *module, const std::string &url_name, RtspHandler *handler,
+                                 bool use_ffmpeg, int reconnect, const MaximumVideoResolution& maximum_resolution)
+    : SourceRender(handler), module_(module), url_name_(url_name), handler_(handler),
+      use_ffmpeg_(use_ffmpeg), reconnect_(reconnect), maximum_resolution_(maximum_resolution) {
+  stream_id_ = handler_->GetStreamId();
+}
+
+RtspHandlerImpl::~RtspHandlerImpl() {}
+
 void RtspHandler::Close() {
   if (impl_) {
     impl_->Close();
@@ -285,18 +398,30 @@ void RtspHandler::Close() {
 
 bool RtspHandlerImpl::Open() {
   DataSource *source = dynamic_cast<DataSource *>(module_);
-  param_ = source->GetSourceParam();
+  param_ = source->GetSourceParam(stream_id_);
 
   size_t maxSize = 60;  // FIXME
-  queue_ = new FrameQueue(maxSize);
+  queue_ = new (std::nothrow) SpscPacketQueue(maxSize);
   if (!queue_) {
     return false;
   }
+  capture_ = OpenPacketCapture(param_, stream_id_);
 
   decode_exit_flag_ = 0;
-  decode_thread_ = std::thread(&RtspHandlerImpl::DecodeLoop, this);
   demux_exit_flag_ = 0;
-  demux_thread_ = std::thread(&RtspHandlerImpl::DemuxLoop, this);
+  decode_pool_ = source->GetDecodePool();
+  if (decode_pool_) {
+    const uint32_t priority = decode_qos_.Init(module_, handler_, decode_pool_);
+    decode_job_ = decode_pool_->Submit([this](uint32_t *idle_us) { return DecodeStep(idle_us); }, priority);
+    if (!decode_job_) decode_pool_ = nullptr;
+  }
+  if (!decode_pool_) {
+    decode_qos_.Init(module_, handler_, nullptr);
+    decode_thread_ = std::thread(&RtspHandlerImpl::DecodeLoop, this);
+  }
+  if (!UseSharedReactor()) {
+    demux_thread_ = std::thread(&RtspHandlerImpl::DemuxLoop, this);
+  }
   return true;
 }
 
@@ -309,6 +434,10 @@ void RtspHandlerImpl::Close() {
   }
   if (!decode_exit_flag_) {
     decode_exit_flag_ = 1;
+    if (decode_pool_ && decode_job_) {
+      decode_pool_->Wait(decode_job_);
+      decode_job_ = 0;
+    }
     if (decode_thread_.joinable()) {
       decode_thread_.join();
     }
@@ -319,37 +448,60 @@ void RtspHandlerImpl::Close() {
     delete queue_;
     queue_ = nullptr;
   }
+  // the demuxers writing it are gone with the threads
+  capture_.reset();
 }
 
-void RtspHandlerImpl::DemuxLoop() {
+std::unique_ptr<rtsp_detail::IDemuxer> RtspHandlerImpl::CreateDemuxer() {
   LOGD(SOURCE) << "[" << stream_id_ << "]: "
                << "Create demuxer...";
   std::unique_ptr<rtsp_detail::IDemuxer> demuxer;
   if (use_ffmpeg_) {
-    demuxer.reset(new FFmpegDemuxer(stream_id_, queue_, url_name_, param_.only_key_frame_));
+    if (param_.rtsp_standby_streams_.count(stream_id_)) {
+      LOGW(SOURCE) << "[" << stream_id_ << "]: "
+                   << "Standby rtsp session is not supported by the ffmpeg demuxer";
+    }
+    demuxer.reset(new (std::nothrow) FFmpegDemuxer(stream_id_, queue_, url_name_, param_.only_key_frame_,
+                                                   param_.gop_interval_, capture_.get()));
   } else {
-    demuxer.reset(new Live555Demuxer(stream_id_, queue_, url_name_, reconnect_, param_.only_key_frame_));
+    uint32_t reactor_threads = UseSharedReactor() ? param_.rtsp_reactor_threads_ : 0;
+    bool standby = param_.rtsp_standby_streams_.count(stream_id_) > 0;
+    demuxer.reset(new (std::nothrow) Live555Demuxer(stream_id_, queue_, url_name_, reconnect_,
+                                                    param_.only_key_frame_, param_.gop_interval_, reactor_threads,
+                                                    standby, [this](uint64_t pts) { preroll_pts_.store(pts); },
+                                                    capture_.get()));
   }
   if (!demuxer) {
     LOGE(SOURCE) << "[" << stream_id_ << "]: "
                  << "Failed to create demuxer";
-    return;
   }
+  return demuxer;
+}
+
+void RtspHandlerImpl::PostPrepareError() {
+  if (nullptr != module_) {
+    Event e;
+    e.type = EventType::EVENT_STREAM_ERROR;
+    e.module_name = module_->GetName();
+    e.message = "Prepare codec resources failed.";
+    e.stream_id = stream_id_;
+    e.thread_id = std::this_thread::get_id();
+    module_->PostEvent(e);
+  }
+  LOGE(SOURCE) << "[" << stream_id_ << "]: "
+               << "PrepareResources failed";
+}
+
+bool RtspHandlerImpl::PrepareDemuxer(rtsp_detail::IDemuxer *demuxer) {
   if (!demuxer->PrepareResources(demux_exit_flag_)) {
-    if (nullptr != module_) {
-      Event e;
-      e.type = EventType::EVENT_STREAM_ERROR;
-      e.module_name = module_->GetName();
-      e.message = "Prepare codec resources failed.";
-      e.stream_id = stream_id_;
-      e.thread_id = std::this_thread::get_id();
-      module_->PostEvent(e);
-    }
-    LOGE(SOURCE) << "[" << stream_id_ << "]: "
-                 << "PrepareResources failed";
-    return;
+    PostPrepareError();
+    return false;
   }
+  SetStreamInfo(demuxer);
+  return true;
+}
 
+void RtspHandlerImpl::SetStreamInfo(rtsp_detail::IDemuxer *demuxer) {
   LOGI(SOURCE) << "[" << stream_id_ << "]: "
                << "Wait stream info...";
 
@@ -367,6 +519,15 @@ void RtspHandlerImpl::DemuxLoop() {
 
   LOGI(SOURCE) << "[" << stream_id_ << "]: "
                << "Got stream info";
+}
+
+void RtspHandlerImpl::DemuxLoop() {
+  if (module_) module_->BindThreadToCpus();
+  handler_->BindMemoryOwner();
+  std::unique_ptr<rtsp_detail::IDemuxer> demuxer = CreateDemuxer();
+  if (!demuxer || !PrepareDemuxer(demuxer.get())) {
+    return;
+  }
 
   while (!demux_exit_flag_) {
     if (demuxer->Process() != true) {
@@ -384,6 +545,16 @@ void RtspHandlerImpl::DecodeLoop() {
    *  for cpu case(device_id < 0), MluDeviceGuard will do nothing
    */
   MluDeviceGuard guard(param_.device_id_);
+  if (module_) module_->BindThreadToCpus();
+  handler_->BindMemoryOwner();
+
+  if (UseSharedReactor()) {
+    demuxer_ = CreateDemuxer();
+    if (!demuxer_ || !PrepareDemuxer(demuxer_.get())) {
+      ClearDecodeResources();
+      return;
+    }
+  }
 
   // wait stream_info
   while (!decode_exit_flag_) {
@@ -392,39 +563,111 @@ void RtspHandlerImpl::DecodeLoop() {
     }
     usleep(1000);
   }
-  if (decode_exit_flag_) {
+  if (decode_exit_flag_ || !PrepareDecoder()) {
+    ClearDecodeResources();
     return;
   }
 
-  std::unique_ptr<Decoder> decoder_ = nullptr;
+  while (!decode_exit_flag_) {
+    if (!DecodePacket(1000)) {
+      break;
+    }
+    std::this_thread::yield();
+  }
+
+  LOGD(SOURCE) << "RTSP handler DecodeLoop Exit";
+  ClearDecodeResources();
+}
+
+bool RtspHandlerImpl::DecodeStep(uint32_t *idle_us) {
+  static constexpr uint32_t kIdleUs = 1000;
+  // the workers are shared by streams, the memory owner is bound for each step
+  handler_->BindMemoryOwner();
+  if (decode_exit_flag_) {
+    ClearDecodeResources();
+    return false;
+  }
+
+  if (!decoder_) {
+    if (UseSharedReactor() && !stream_info_set_) {
+      // PrepareDemuxer waits for the connection, poll it instead of blocking a worker
+      if (!demuxer_) {
+        demuxer_ = CreateDemuxer();
+        if (!demuxer_ || !demuxer_->StartPrepare()) {
+          PostPrepareError();
+          ClearDecodeResources();
+          return false;
+        }
+      }
+      int ret = demuxer_->PollPrepare();
+      if (ret < 0) {
+        PostPrepareError();
+        ClearDecodeResources();
+        return false;
+      }
+      if (ret == 0) {
+        *idle_us = kIdleUs;
+        return true;
+      }
+      SetStreamInfo(demuxer_.get());
+    }
+    if (!stream_info_set_) {
+      *idle_us = kIdleUs;
+      return true;
+    }
+    if (!PrepareDecoder()) {
+      ClearDecodeResources();
+      return false;
+    }
+    LOGD(SOURCE) << "[" << stream_id_ << "]: "
+                 << "RTSP handler decodes in decoder pool";
+  }
+
+  bool idle = false;
+  if (!DecodePacket(0, &idle)) {
+    LOGD(SOURCE) << "[" << stream_id_ << "]: "
+                 << "RTSP handler exits decoder pool";
+    ClearDecodeResources();
+    return false;
+  }
+  if (idle) *idle_us = kIdleUs;
+  return true;
+}
+
+bool RtspHandlerImpl::PrepareDecoder() {
   if (param_.decoder_type_ == DecoderType::DECODER_MLU) {
-    decoder_.reset(new MluDecoder(stream_id_, this));
+    decoder_.reset(new (std::nothrow) MluDecoder(stream_id_, this));
   } else if (param_.decoder_type_ == DecoderType::DECODER_CPU) {
-    decoder_.reset(new FFmpegCpuDecoder(stream_id_, this));
+    decoder_.reset(new (std::nothrow) FFmpegCpuDecoder(stream_id_, this));
   } else {
     LOGE(SOURCE) << "unsupported decoder_type";
-    return;
+    return false;
   }
-  if (decoder_) {
-    ExtraDecoderInfo extra;
-    extra.device_id = param_.device_id_;
-    extra.input_buf_num = param_.input_buf_number_;
-    extra.output_buf_num = param_.output_buf_number_;
-    extra.apply_stride_align_for_scaler = param_.apply_stride_align_for_scaler_;
-    extra.extra_info = stream_info_.extra_data;
+  if (!decoder_) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: "
+                 << "Failed to create decoder";
+    return false;
+  }
+
+  ExtraDecoderInfo extra;
+  extra.device_id = param_.device_id_;
+  extra.input_buf_num = param_.input_buf_number_;
+  extra.output_buf_num = param_.output_buf_number_;
+  if (param_.reuse_cndec_buf) codec_buf_tracker_ = std::make_shared<CodecBufferTracker>(param_.output_buf_number_);
+  if (module_) extra.memory_owner = module_->GetMemoryOwner(stream_id_);
+  SetResourceOwner(module_, &extra);
+  extra.fallback_decoders = param_.decoder_fallback_;
+  extra.export_motion_vectors = param_.motion_activity_;
+  extra.apply_stride_align_for_scaler = param_.apply_stride_align_for_scaler_;
+  SetOutputResolution(module_, &extra);
+  extra.extra_info = stream_info_.extra_data;
+  {
     std::lock_guard<std::mutex> lk(mutex_);
-    bool ret = decoder_->Create(&stream_info_, &extra);
-    if (!ret) {
+    if (!decoder_->Create(&stream_info_, &extra)) {
       LOGE(SOURCE) << "[" << stream_id_ << "]: "
                    << "Failed to create decoder";
-      decoder_->Destroy();
-      return;
+      return false;
     }
-  } else {
-    LOGE(SOURCE) << "[" << stream_id_ << "]: "
-                 << "Failed to create decoder";
-    decoder_->Destroy();
-    return;
   }
 
   // feed extradata first
@@ -434,55 +677,78 @@ void RtspHandlerImpl::DecodeLoop() {
     pkt.len = stream_info_.extra_data.size();
     pkt.pts = 0;
     if (!decoder_->Process(&pkt)) {
-      return;
+      return false;
     }
   }
+  return true;
+}
 
-  using EsPacketPtr = std::shared_ptr<EsPacket>;
-  while (!decode_exit_flag_) {
-    EsPacketPtr in;
-    int timeoutMs = 1000;
-    bool ret = this->queue_->Pop(timeoutMs, in);
-    if (!ret) {
+bool RtspHandlerImpl::DecodePacket(int timeout_ms, bool *idle) {
+  const SpscPacketQueue::Packet *in = queue_->Front(timeout_ms);
+  if (!in) {
+    if (timeout_ms > 0) {
       LOGD(SOURCE) << "[" << stream_id_ << "]: "
                    << "Read packet Timeout";
-      continue;
     }
-
-    if (in->pkt_.flags & static_cast<size_t>(ESPacket::FLAG::FLAG_EOS)) {
+    if (demuxer_ && !demuxer_->Process()) {
       LOGI(SOURCE) << "[" << stream_id_ << "]: "
                    << "EOS reached in RtspHandler";
       decoder_->Process(nullptr);
-      break;
-    }  // if (eos)
-
-    VideoEsPacket pkt;
-    pkt.data = in->pkt_.data;
-    pkt.len = in->pkt_.size;
-    pkt.pts = in->pkt_.pts;
-
-    if (module_ && module_->GetProfiler()) {
-      auto record_key = std::make_pair(stream_id_, pkt.pts);
-      module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, record_key);
-      if (module_->GetContainer() && module_->GetContainer()->GetProfiler()) {
-        module_->GetContainer()->GetProfiler()->RecordInput(record_key);
-      }
+      return false;
     }
+    if (idle) *idle = true;
+    return true;
+  }
 
-    if (!decoder_->Process(&pkt)) {
-      break;
+  if (in->flags & static_cast<uint32_t>(ESPacket::FLAG::FLAG_EOS)) {
+    LOGI(SOURCE) << "[" << stream_id_ << "]: "
+                 << "EOS reached in RtspHandler";
+    queue_->PopFront();
+    decoder_->Process(nullptr);
+    return false;
+  }  // if (eos)
+
+  VideoEsPacket pkt;
+  pkt.data = const_cast<uint8_t *>(in->data);
+  pkt.len = in->size;
+  pkt.pts = in->pts;
+  pkt.flags = (in->flags & static_cast<uint32_t>(ESPacket::FLAG::FLAG_KEY_FRAME)) ? VideoEsPacket::FLAG_KEY_FRAME : 0;
+  if (!decode_qos_.KeepPacket(pkt.flags != 0, pkt.pts)) {
+    queue_->PopFront();
+    return true;
+  }
+
+  if (module_ && module_->GetProfiler()) {
+    const uint32_t stream_index = handler_->GetStreamIndex();
+    module_->GetProfiler()->RecordProcessStart(kPROCESS_PROFILER_NAME, stream_index, stream_id_, pkt.pts);
+    if (module_->GetContainer() && module_->GetContainer()->GetProfiler()) {
+      module_->GetContainer()->GetProfiler()->RecordInput(stream_index, stream_id_, pkt.pts);
     }
-    std::this_thread::yield();
   }
 
-  LOGD(SOURCE) << "RTSP handler DecodeLoop Exit";
-  if (decoder_.get()) {
+  // the slot is given back once the decoder has copied the packet
+  bool ret = decoder_->Process(&pkt);
+  queue_->PopFront();
+  return ret;
+}
+
+void RtspHandlerImpl::ClearDecodeResources() {
+  if (decoder_) {
     decoder_->Destroy();
+    decoder_.reset();
+  }
+  if (demuxer_) {
+    demuxer_->ClearResources(demux_exit_flag_);
+    demuxer_.reset();
   }
 }
 
 // IDecodeResult methods
 void RtspHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
+  if (DecodeErrorCode::ERROR_CORRUPT_DATA == error_code) {
+    handler_->RecordDropped(kDROP_REASON_CORRUPT_DATA);
+    return;
+  }
   // FIXME,  handle decode error ...
   if (nullptr != module_) {
     Event e;
@@ -497,17 +763,22 @@ void RtspHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void RtspHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
-  if (frame_count_++ % param_.interval_ != 0) {
+  if (frame) decode_qos_.OnFrame(frame->pts);
+  // the frames of a cached GOP, which have been sent before the session switch
+  if (frame && static_cast<int64_t>(frame->pts) <= preroll_pts_.load()) {
+    return;
+  }
+  if (!KeepFrame(param_.interval_)) {
     return;  // discard frames
   }
   if (!frame) {
-    LOGW(SOURCE) << "[RtspHandlerImpl] OnDecodeFrame, frame is nullptr.";
+    LOGW_EVERY_T(SOURCE, 1) << "[RtspHandlerImpl] OnDecodeFrame, frame is nullptr.";
     return;
   }
 
   std::shared_ptr<CNFrameInfo> data = this->CreateFrameInfo();
   if (!data) {
-    LOGW(SOURCE) << "[RtspHandlerImpl] OnDecodeFrame, failed to create FrameInfo.";
+    LOGW_EVERY_T(SOURCE, 1) << "[RtspHandlerImpl] OnDecodeFrame, failed to create FrameInfo.";
     return;
   }
 
@@ -518,7 +789,7 @@ void RtspHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
     return;
   }
 
-  int ret = SourceRender::Process(data, frame, frame_id_++, param_);
+  int ret = SourceRender::Process(data, frame, frame_id_++, param_, codec_buf_tracker_);
   if (ret < 0) {
     return;
   }
@@ -39,21 +39,23 @@ extern "C" {
 #include "cnstream_logging.hpp"
 #include "data_handler_util.hpp"
 #include "data_source.hpp"
+#include "util/decode_worker_pool.hpp"
 #include "util/rtsp_client.hpp"
-#include "util/cnstream_queue.hpp"
+#include "util/spsc_packet_queue.hpp"
 #include "util/video_decoder.hpp"
 
 namespace cnstream {
 
+namespace rtsp_detail {
+class IDemuxer;
+}  // namespace rtsp_detail
+
 class RtspHandlerImpl : public IDecodeResult, public SourceRender {
  public:
+  // defined in the source file, where rtsp_detail::IDemuxer is complete
   explicit RtspHandlerImpl(DataSource *module, const std::string &url_name, RtspHandler *handler,
-                           bool use_ffmpeg, int reconnect, const MaximumVideoResolution& maximum_resolution)
-      : SourceRender(handler), module_(module), url_name_(url_name), handler_(handler),
-        use_ffmpeg_(use_ffmpeg), reconnect_(reconnect), maximum_resolution_(maximum_resolution) {
-    stream_id_ = handler_->GetStreamId();
-  }
-  ~RtspHandlerImpl() {}
+                           bool use_ffmpeg, int reconnect, const MaximumVideoResolution& maximum_resolution);
+  ~RtspHandlerImpl();
   bool Open();
   void Close();
 
@@ -78,9 +80,32 @@ class RtspHandlerImpl : public IDecodeResult, public SourceRender {
   std::atomic<bool> stream_info_set_{false};
   std::mutex mutex_;
   VideoInfo stream_info_;
-  BoundedQueue<std::shared_ptr<EsPacket>> *queue_ = nullptr;
+  SpscPacketQueue *queue_ = nullptr;
+  // decoded frames with pts not greater than it are dropped, they are the preroll of a session switch
+  std::atomic<int64_t> preroll_pts_{-1};
+  // The live555 demuxer does not need a thread when the sessions share the reactor event loops,
+  // it is prepared and cleared by the decode thread instead.
+  bool UseSharedReactor() const { return !use_ffmpeg_ && param_.rtsp_reactor_threads_ > 0; }
+  std::unique_ptr<rtsp_detail::IDemuxer> CreateDemuxer();
+  bool PrepareDemuxer(rtsp_detail::IDemuxer *demuxer);
+  void SetStreamInfo(rtsp_detail::IDemuxer *demuxer);
+  void PostPrepareError();
+  bool PrepareDecoder();
+  // Decodes one packet, returns false on eos or error. Sets idle if there is no packet in timeout_ms.
+  bool DecodePacket(int timeout_ms, bool *idle = nullptr);
+  void ClearDecodeResources();
   void DemuxLoop();
   void DecodeLoop();
+  // One step of DecodeLoop when the stream is driven by the decoder pool of DataSource.
+  bool DecodeStep(uint32_t *idle_us);
+  // owned by the decode thread or the decoder pool job
+  std::unique_ptr<rtsp_detail::IDemuxer> demuxer_;
+  std::unique_ptr<Decoder> decoder_;
+  // the packets of the stream are recorded into it if the stream is captured, see capture_dir
+  std::unique_ptr<PacketCaptureWriter> capture_;
+  DecodeWorkerPool *decode_pool_ = nullptr;
+  uint64_t decode_job_ = 0;
+  DecodeQos decode_qos_;
 
 #ifdef UNIT_TEST
  public:  // NOLINT
@@ -21,20 +21,103 @@
 
 #include <libyuv.h>
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <string>
 
+#include "cnstream_pipeline.hpp"
 #include "private/cnstream_allocator.hpp"
+#include "profiler/module_profiler.hpp"
+#include "util/decode_worker_pool.hpp"
 
 namespace cnstream {
 
 // #define DEBUG_DUMP_IMAGE 1
 
+void SetOutputResolution(const Module *module, ExtraDecoderInfo *extra) {
+  const DataSource *source = dynamic_cast<const DataSource *>(module);
+  uint32_t width = 0, height = 0;
+  if (!source || !source->GetOutputResolution(&width, &height)) return;
+  extra->output_width = width;
+  extra->output_height = height;
+}
+
+void SetResourceOwner(const Module *module, ExtraDecoderInfo *extra) {
+  if (module && module->GetContainer()) extra->pipeline_name = module->GetContainer()->GetName();
+}
+
+std::unique_ptr<PacketCaptureWriter> OpenPacketCapture(const DataSourceParam &param, const std::string &stream_id) {
+  if (param.capture_dir_.empty()) return nullptr;
+  if (!param.capture_streams_.empty() && !param.capture_streams_.count(stream_id)) return nullptr;
+  std::string name = stream_id;
+  std::replace(name.begin(), name.end(), '/', '_');
+  std::unique_ptr<PacketCaptureWriter> capture(new PacketCaptureWriter);
+  if (!capture->Open(param.capture_dir_ + "/" + name + ".cncap")) return nullptr;
+  LOGI(SOURCE) << "[" << stream_id << "]: "
+               << "Capture packets into " << param.capture_dir_ << "/" << name << ".cncap";
+  return capture;
+}
+
+const char *GetDecodeProfilerName(DecodePriority priority) {
+  switch (priority) {
+    case DecodePriority::HIGH:
+      return "DECODE HIGH";
+    case DecodePriority::LOW:
+      return "DECODE LOW";
+    default:
+      return "DECODE NORMAL";
+  }
+}
+
+uint32_t DecodeQos::Init(SourceModule *module, SourceHandler *handler, DecodeWorkerPool *pool) {
+  source_ = dynamic_cast<DataSource *>(module);
+  handler_ = handler;
+  pool_ = pool;
+  skip_gop_ = false;
+  const DecodePriority priority = source_ ? source_->GetDecodePriority(handler_->GetStreamIndex())
+                                          : DecodePriority::NORMAL;
+  priority_.store(priority);
+  return static_cast<uint32_t>(priority);
+}
+
+bool DecodeQos::KeepPacket(bool is_key_frame, uint64_t pts) {
+  if (!source_) return true;
+  const uint32_t stream_index = handler_->GetStreamIndex();
+  const DecodePriority priority = source_->GetDecodePriority(stream_index);
+  if (priority != priority_.load()) {
+    priority_.store(priority);
+    if (pool_) DecodeWorkerPool::SetCurrentPriority(static_cast<uint32_t>(priority));
+  }
+  if (is_key_frame) {
+    skip_gop_ = priority == DecodePriority::LOW && pool_ && pool_->IsUnderPressure();
+  }
+  if (skip_gop_) {
+    handler_->RecordReceived();
+    handler_->RecordDropped(kDROP_REASON_DECODE_PRESSURE);
+    return false;
+  }
+  if (source_->GetProfiler()) {
+    source_->GetProfiler()->RecordProcessStart(GetDecodeProfilerName(priority), stream_index,
+                                               handler_->GetStreamId(), pts);
+  }
+  return true;
+}
+
+void DecodeQos::OnFrame(uint64_t pts) {
+  if (source_ && source_->GetProfiler()) {
+    source_->GetProfiler()->RecordProcessEnd(GetDecodeProfilerName(priority_.load()), handler_->GetStreamIndex(),
+                                             handler_->GetStreamId(), pts);
+  }
+}
+
 int SourceRender::Process(std::shared_ptr<CNFrameInfo> frame_info, DecodeFrame *decode_frame, uint64_t frame_id,
-                          const DataSourceParam &param_) {
-  CNDataFramePtr dataframe = frame_info->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+                          const DataSourceParam &param_, std::shared_ptr<CodecBufferTracker> codec_buf_tracker) {
+  CNDataFramePtr dataframe = frame_info->collection.Get(kCNDataFrameSlot);
   if (!dataframe) return -1;
 
   dataframe->frame_id = frame_id;
+  dataframe->activity = decode_frame->activity;
   /*fill source data info*/
   dataframe->width = decode_frame->width;
   dataframe->height = decode_frame->height;
@@ -61,25 +144,36 @@ int SourceRender::Process(std::shared_ptr<CNFrameInfo> frame_info, DecodeFrame *
     }
 
     if (OutputType::OUTPUT_MLU == param_.output_type_) {
-      if (param_.reuse_cndec_buf && decode_frame->buf_ref) {
+      // if few codec buffers are left, the frame is copied out and the codec buffer is given back by the decoder.
+      if (param_.reuse_cndec_buf && decode_frame->buf_ref && (!codec_buf_tracker || codec_buf_tracker->Acquire())) {
         class Deallocator : public IDataDeallocator {
          public:
-          explicit Deallocator(IDecBufRef *ptr) {
+          explicit Deallocator(IDecBufRef *ptr, std::shared_ptr<CodecBufferTracker> tracker)
+              : tracker_(tracker), start_(std::chrono::steady_clock::now()) {
             ptr_.reset(ptr);
           }
-          ~Deallocator() = default;
+          ~Deallocator() {
+            ptr_.reset();
+            if (tracker_) {
+              std::chrono::duration<double, std::milli> hold = std::chrono::steady_clock::now() - start_;
+              tracker_->Release(hold.count());
+            }
+          }
 
          private:
           std::unique_ptr<IDecBufRef> ptr_;
+          std::shared_ptr<CodecBufferTracker> tracker_;
+          std::chrono::steady_clock::time_point start_;
         };
         IDecBufRef *ptr = decode_frame->buf_ref.release();
-        dataframe->deAllocator_.reset(new Deallocator(ptr));
+        dataframe->deAllocator_.reset(new Deallocator(ptr, codec_buf_tracker));
       }
       dataframe->dst_device_id = param_.device_id_;
       dataframe->CopyToSyncMem(decode_frame->plane, true);
     } else {
       dataframe->dst_device_id = -1;  // unused
       dataframe->CopyToSyncMem(decode_frame->plane, false);
+      if (param_.pyramid_levels_ > 0) dataframe->BuildPyramid(param_.pyramid_levels_);
     }
 
     #ifdef DEBUG_DUMP_IMAGE
@@ -94,7 +188,7 @@ int SourceRender::Process(std::shared_ptr<CNFrameInfo> frame_info, DecodeFrame *
 
   // decoder with cpu-output
   if (decode_frame->fmt != DecodeFrame::PixFmt::FMT_I420 && decode_frame->fmt != DecodeFrame::PixFmt::FMT_J420 &&
-      decode_frame->fmt != DecodeFrame::PixFmt::FMT_YUYV) {
+      decode_frame->fmt != DecodeFrame::PixFmt::FMT_YUYV && decode_frame->fmt != DecodeFrame::PixFmt::FMT_NV12) {
     LOGF(SOURCE) << " Unsupported format";
     return -1;
   }
@@ -160,6 +254,16 @@ int SourceRender::Process(std::shared_ptr<CNFrameInfo> frame_info, DecodeFrame *
              dataframe->height);
       break;
     }
+    case DecodeFrame::PixFmt::FMT_NV12: {
+      // from the hwaccel decoders
+      uint8_t *dst_y = static_cast<uint8_t*>(dataframe->cpu_data.get());
+      uint8_t *dst_uv = dst_y + dataframe->GetPlaneBytes(0);
+      libyuv::CopyPlane(static_cast<uint8_t *>(decode_frame->plane[0]), decode_frame->stride[0], dst_y,
+                        dataframe->stride[0], dataframe->width, dataframe->height);
+      libyuv::CopyPlane(static_cast<uint8_t *>(decode_frame->plane[1]), decode_frame->stride[1], dst_uv,
+                        dataframe->stride[1], (dataframe->width + 1) / 2 * 2, (dataframe->height + 1) / 2);
+      break;
+    }
     default : {
       LOGF(SOURCE) << "Should not come here";
       return -1;
@@ -175,6 +279,9 @@ int SourceRender::Process(std::shared_ptr<CNFrameInfo> frame_info, DecodeFrame *
     dst = reinterpret_cast<void *>(reinterpret_cast<uint8_t *>(dst) + plane_size);
   }
 
+  // the pyramid is scaled from the cpu planes before they are copied to mlu
+  if (param_.pyramid_levels_ > 0) dataframe->BuildPyramid(param_.pyramid_levels_);
+
   // sync memory from cpu if needed
   if (OutputType::OUTPUT_MLU == param_.output_type_) {
     dataframe->dst_device_id = param_.device_id_;  // assume the param_.device_id is dst_device_id
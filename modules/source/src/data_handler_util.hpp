@@ -23,6 +23,7 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <chrono>
@@ -32,120 +33,150 @@
 #include <iostream>
 #include <thread>
 #include <string>
+#include <vector>
 
 #include "cnstream_frame_va.hpp"
 #include "cnstream_logging.hpp"
 #include "data_source.hpp"
+#include "util/packet_capture.hpp"
 #include "util/video_decoder.hpp"
 
 namespace cnstream {
 
-struct EsPacket {
-  explicit EsPacket(ESPacket *pkt) {
-    if (pkt && pkt->data && pkt->size) {
-      pkt_.data = new(std::nothrow) unsigned char[pkt->size];
-      if (pkt_.data) {
-        memcpy(pkt_.data, pkt->data, pkt->size);
-        pkt_.size = pkt->size;
-      } else {
-        pkt_.size = 0;
-      }
-      pkt_.pts = pkt->pts;
-      pkt_.flags = pkt->flags;
-    } else {
-      pkt_.data = nullptr;
-      pkt_.size = 0;
-      pkt_.flags = static_cast<size_t>(ESPacket::FLAG::FLAG_EOS);
-      pkt_.pts = ~0;
-    }
-  }
-
-  ~EsPacket() {
-    if (pkt_.data) {
-      delete []pkt_.data, pkt_.data = nullptr;
-    }
-    pkt_.size = 0;
-    pkt_.flags = 0;
-    pkt_.pts = 0;
-  }
-
-  ESPacket pkt_;
+/***********************************************************************
+ * @brief CodecBufferStats describes how the output buffers of MLU codec are held by frames.
+ ***********************************************************************/
+struct CodecBufferStats {
+  uint64_t zero_copy_num = 0;   // frames that hold codec buffers
+  uint64_t copy_out_num = 0;    // frames copied out because few codec buffers were left
+  uint64_t late_release_num = 0;  // codec buffers held longer than the late release threshold
+  uint32_t in_flight = 0;       // codec buffers held by frames now
+  uint32_t peak_in_flight = 0;
+  double avg_hold_ms = 0;
+  double max_hold_ms = 0;
 };
 
-template<typename T>
-class BoundedQueue {
+/***********************************************************************
+ * @brief CodecBufferTracker tracks the codec buffers held by frames when reuse_cndec_buf is enabled.
+ *
+ * A slow module holding the buffers starves MLU codec. When handing down one more buffer would leave the codec
+ * less than ``reserve_num`` free buffers, the frame is copied out to the memory pool instead, and the codec buffer
+ * is given back as soon as the frame is processed by source.
+ ***********************************************************************/
+class CodecBufferTracker {
  public:
-  BoundedQueue(const BoundedQueue<T>&) = delete;
-  BoundedQueue& operator=(const BoundedQueue<T>&) = delete;
-
-  explicit BoundedQueue<T>(size_t maxSize)
-    : mutex_(),
-    maxSize_(maxSize)
-  {}
-
-  void Push(const T& x) {
-    std::unique_lock<std::mutex> lk(mutex_);
-    notFull_.wait(lk, [this]() {return queue_.size() < maxSize_; });
-    queue_.push(x);
-    lk.unlock();
-    notEmpty_.notify_one();
-  }
-
-  bool Push(int timeoutMs, const T& x) {
-    std::unique_lock<std::mutex> lk(mutex_);
-    notFull_.wait_for(lk, std::chrono::milliseconds(timeoutMs),  [this]() {return queue_.size() < maxSize_; });
-    if (queue_.size() >= maxSize_) {
+  explicit CodecBufferTracker(uint32_t buf_num, uint32_t reserve_num = 1, double late_release_ms = 1000)
+      : buf_num_(buf_num), reserve_num_(reserve_num), late_release_ms_(late_release_ms) {}
+  /**
+   * Decides whether the frame holds the codec buffer. Returns false if the frame should be copied out.
+   */
+  bool Acquire() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (stats_.in_flight + reserve_num_ >= buf_num_) {
+      stats_.copy_out_num++;
       return false;
     }
-    queue_.push(x);
-    lk.unlock();
-    notEmpty_.notify_one();
+    stats_.zero_copy_num++;
+    stats_.in_flight++;
+    stats_.peak_in_flight = std::max(stats_.peak_in_flight, stats_.in_flight);
     return true;
   }
-
-  T Pop() {
-    std::unique_lock<std::mutex> lk(mutex_);
-    notEmpty_.wait(lk, [this]() {return !queue_.empty(); });
-    T front(queue_.front());
-    queue_.pop();
-    lk.unlock();
-    notFull_.notify_one();
-    return front;
+  /**
+   * Called when the codec buffer acquired is given back.
+   */
+  void Release(double hold_ms) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (stats_.in_flight) stats_.in_flight--;
+    stats_.max_hold_ms = std::max(stats_.max_hold_ms, hold_ms);
+    total_hold_ms_ += hold_ms;
+    released_num_++;
+    stats_.avg_hold_ms = total_hold_ms_ / released_num_;
+    if (hold_ms > late_release_ms_) stats_.late_release_num++;
   }
-
-  bool Pop(int timeoutMs, T& out) {  // NOLINT
-    std::unique_lock<std::mutex> lk(mutex_);
-    notEmpty_.wait_for(lk, std::chrono::milliseconds(timeoutMs), [this]() {return !queue_.empty(); });
-    if (queue_.empty()) return false;
-    out = queue_.front();
-    queue_.pop();
-    lk.unlock();
-    notFull_.notify_one();
-    return true;
+  CodecBufferStats GetStats() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return stats_;
   }
 
-  bool Empty() const {
-    std::unique_lock<std::mutex> lk(mutex_);
-    return queue_.empty();
-  }
+ private:
+  uint32_t buf_num_;
+  uint32_t reserve_num_;
+  double late_release_ms_;
+  mutable std::mutex mutex_;
+  CodecBufferStats stats_;
+  double total_hold_ms_ = 0;
+  uint64_t released_num_ = 0;
+};  // class CodecBufferTracker
 
-  size_t Size() const {
-    std::unique_lock<std::mutex> lk(mutex_);
-    return queue_.size();
-  }
+/**
+ * @brief Sets the resolution the codec scales frames to, see DataSource::GetOutputResolution.
+ *
+ * @param[in] module The DataSource module the stream belongs to.
+ * @param[out] extra The decoder info to be set. It is left unchanged if frames keep the original resolution.
+ */
+void SetOutputResolution(const Module *module, ExtraDecoderInfo *extra);
 
-  size_t MaxSize() const {
-    return maxSize_;
-  }
+/**
+ * @brief Sets the pipeline the codec channels are taken for, see DeviceResourceManager.
+ *
+ * @param[in] module The DataSource module the stream belongs to.
+ * @param[out] extra The decoder info to be set.
+ */
+void SetResourceOwner(const Module *module, ExtraDecoderInfo *extra);
+
+/**
+ * @brief Opens the capture file of a stream, ``<capture_dir>/<stream_id>.cncap``, see PacketCaptureWriter.
+ *
+ * @param[in] param The parameters of the DataSource module.
+ * @param[in] stream_id The stream id.
+ *
+ * @return Returns nullptr if the stream is not captured or the file fails to be opened.
+ */
+std::unique_ptr<PacketCaptureWriter> OpenPacketCapture(const DataSourceParam &param, const std::string &stream_id);
+
+/**
+ * @brief Gets the name the decode latency of a priority class is profiled by, e.g. "DECODE HIGH".
+ */
+const char *GetDecodeProfilerName(DecodePriority priority);
+
+/**
+ * @brief DecodeQos applies the decode priority class of a stream, see DataSource::GetDecodePriority.
+ *
+ * The decode job of the stream in the decoder pool follows the class of the stream, and whole GOPs of a low priority
+ * stream are skipped while the pool is under pressure. Skipping starts and stops at key frames, the decoder always
+ * gets a valid sequence. The decode latency of the packets is profiled by the name of the class.
+ */
+class DecodeQos {
+ public:
+  /**
+   * @brief Binds the stream.
+   *
+   * @param[in] module The DataSource module the stream belongs to.
+   * @param[in] handler The handler of the stream.
+   * @param[in] pool The decoder pool, nullptr if the stream runs its own decode thread.
+   *
+   * @return Returns the priority class the decode job of the stream is submitted with.
+   */
+  uint32_t Init(SourceModule *module, SourceHandler *handler, DecodeWorkerPool *pool);
+  /**
+   * @brief Checks whether a packet is sent to the decoder. It should be called for each packet in order, by the decode
+   * job of the stream in the pool.
+   *
+   * @return Returns false if the packet is skipped, otherwise the decode start of the packet is recorded.
+   */
+  bool KeepPacket(bool is_key_frame, uint64_t pts);
+  /**
+   * @brief Records the decode end of a frame.
+   */
+  void OnFrame(uint64_t pts);
 
  private:
-  mutable std::mutex mutex_;
-  std::condition_variable notEmpty_;
-  std::condition_variable notFull_;
-  size_t maxSize_;
-  std::queue<T> queue_;
-};
-using FrameQueue = BoundedQueue<std::shared_ptr<EsPacket>>;
+  DataSource *source_ = nullptr;
+  SourceHandler *handler_ = nullptr;
+  DecodeWorkerPool *pool_ = nullptr;
+  std::atomic<DecodePriority> priority_{DecodePriority::NORMAL};
+  bool skip_gop_ = false;
+};  // class DecodeQos
 
 class SourceRender {
  public:
@@ -158,24 +189,32 @@ class SourceRender {
     while (1) {
       data = handler_->CreateFrameInfo(eos);
       if (data != nullptr) break;
-      if (CreateInterrupt()) break;
-      std::this_thread::sleep_for(std::chrono::microseconds(5));
+      if (CreateInterrupt()) return nullptr;
+      // blocks until a frame is released by the pipeline, wakes up periodically to check the interruption.
+      handler_->WaitForFrame(kCreateFrameWaitMs);
     }
-    auto dataframe = std::make_shared<CNDataFrame>();
-    if (!dataframe) {
-      return nullptr;
+    // frames recycled by the frame pool of pipeline may already hold reset data, see DataSource::Open.
+    if (!data->collection.HasValue(kCNDataFrameSlot)) {
+      auto dataframe = std::make_shared<CNDataFrame>();
+      if (!dataframe) {
+        return nullptr;
+      }
+      data->collection.Add(kCNDataFrameSlot, dataframe);
     }
-    auto inferobjs = std::make_shared<CNInferObjs>();
-    if (!inferobjs) {
-      return nullptr;
+    if (!data->collection.HasValue(kCNInferObjsSlot)) {
+      auto inferobjs = std::make_shared<CNInferObjs>();
+      if (!inferobjs) {
+        return nullptr;
+      }
+      data->collection.Add(kCNInferObjsSlot, inferobjs);
     }
-    auto inferdata =  std::make_shared<CNInferData>();
-    if (!inferdata) {
-      return nullptr;
+    if (!data->collection.HasValue(kCNInferDataSlot)) {
+      auto inferdata =  std::make_shared<CNInferData>();
+      if (!inferdata) {
+        return nullptr;
+      }
+      data->collection.Add(kCNInferDataSlot, inferdata);
     }
-    data->collection.Add(kCNDataFrameTag, dataframe);
-    data->collection.Add(kCNInferObjsTag, inferobjs);
-    data->collection.Add(kCNInferDataTag, inferdata);
     return data;
   }
 
@@ -191,24 +230,48 @@ class SourceRender {
     eos_sent_ = true;
     LOGI(SOURCE) << "[" << handler_->GetStreamId() << "]: "
                   << "Send EOS frame info";
+    if (codec_buf_tracker_) {
+      CodecBufferStats stats = codec_buf_tracker_->GetStats();
+      LOGI(SOURCE) << "[" << handler_->GetStreamId() << "]: "
+                   << "Codec buffers held by " << stats.zero_copy_num << " frames, avg " << stats.avg_hold_ms
+                   << " ms, max " << stats.max_hold_ms << " ms, late released " << stats.late_release_num
+                   << ", copied out " << stats.copy_out_num << " frames";
+    }
   }
 
   bool SendFrameInfo(std::shared_ptr<CNFrameInfo> data) {
     return handler_->SendData(data);
   }
 
+  // sends a burst of frames together, see SourceModule::SendDataBatch
+  bool SendFrameInfoBatch(const std::vector<std::shared_ptr<CNFrameInfo>> &data_vec) {
+    return handler_->SendDataBatch(data_vec);
+  }
+
+  // counts a frame got from the stream, returns false if it is discarded by DataSourceParam::interval_.
+  bool KeepFrame(uint32_t interval) {
+    handler_->RecordReceived();
+    if (frame_count_++ % interval == 0) return true;
+    handler_->RecordDropped(kDROP_REASON_INTERVAL);
+    return false;
+  }
+
  protected:
   SourceHandler *handler_;
   bool eos_sent_ = false;
 
  protected:
+  static constexpr uint32_t kCreateFrameWaitMs = 10;
   std::atomic<bool> interrupt_{false};
   uint64_t frame_count_ = 0;
   uint64_t frame_id_ = 0;
+  // tracks the codec buffers held by frames, created by handlers when reuse_cndec_buf is enabled.
+  std::shared_ptr<CodecBufferTracker> codec_buf_tracker_ = nullptr;
 
  public:
   static int Process(std::shared_ptr<CNFrameInfo> frame_info,
-                     DecodeFrame *frame, uint64_t frame_id, const DataSourceParam &param_);
+                     DecodeFrame *frame, uint64_t frame_id, const DataSourceParam &param_,
+                     std::shared_ptr<CodecBufferTracker> codec_buf_tracker = nullptr);
 };
 
 }  // namespace cnstream
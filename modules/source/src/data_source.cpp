@@ -19,15 +19,28 @@
  *************************************************************************/
 #include "data_source.hpp"
 
+#include <cnrt.h>
+#include <sys/stat.h>
+
 #include <algorithm>
 #include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "cnstream_logging.hpp"
+#include "cnstream_resource_manager.hpp"
+#include "data_handler_util.hpp"
+#include "private/cnstream_allocator.hpp"
 #include "profiler/module_profiler.hpp"
+#include "profiler/pipeline_profiler.hpp"
+#include "util/decode_worker_pool.hpp"
+#include "util/jpeg_decode_engine.hpp"
+#include "util/stream_placer.hpp"
+#include "util/video_decoder.hpp"
 
 namespace cnstream {
 
@@ -39,13 +52,21 @@ DataSource::DataSource(const std::string &name) : SourceModule(name) {
                            "Where the outputs will be stored. It could be cpu or mlu,"
                            "It is used when decoder_type is cpu.");
   param_register_.Register("device_id", "Which device will be used. If there is only one device, it might be 0.");
+  param_register_.Register("device_ids",
+                           "The devices the streams are decoded on, e.g. \"0,1,2,3\", or auto for all devices."
+                           " Each stream is placed on the device with the lowest codec and compute utilization when it"
+                           " is added, and stays there. Set the same devices to device_ids of Inferencer2 to infer"
+                           " the streams on their devices, only the streams over its affinity_threshold are copied"
+                           " to the other devices. Not used with decode_pool_threads or jpeg_decode_lanes."
+                           " device_id is used when it is not set.");
   param_register_.Register("interval",
                            "How many frames will be discarded between two frames"
                            " which will be sent to next modules.");
   param_register_.Register("decoder_type", "Which the input data will be decoded by. It could be cpu or mlu.");
   param_register_.Register("reuse_cndec_buf",
                            "This parameter decides whether the codec buffer that stores output data"
-                           "will be held and reused by the framework afterwards. It should be true or false.");
+                           "will be held and reused by the framework afterwards. It should be true or false."
+                           " If few codec buffers are left, frames are copied out and the buffers are given back.");
   param_register_.Register("input_buf_number",
                            "Codec buffer number for storing input data."
                            " Basically, we do not need to set it, as it will be allocated automatically.");
@@ -53,16 +74,145 @@ DataSource::DataSource(const std::string &name) : SourceModule(name) {
                            "Codec buffer number for storing output data."
                            " Basically, we do not need to set it, as it will be allocated automatically.");
   param_register_.Register("only_key_frame", "Only decode key frames and other frames are discarded. Default is false");
+  param_register_.Register("gop_interval",
+                           "Decode one GOP of every gop_interval GOPs (only its key frame if only_key_frame is true),"
+                           " the other packets are dropped before decoding. Default is 1."
+                           " Unlike interval, the skipped frames cost no codec time.");
   param_register_.Register("apply_stride_align_for_scaler",
                            "The output data will align the scaler(hardware on mlu220) requirements."
                            " Recommended for use with scaler on mlu220 platforms.");
+  param_register_.Register("rtsp_reactor_threads",
+                           "How many live555 event loop threads are shared by all rtsp streams (live555 demuxer only)."
+                           " 0 means each stream runs its own event loop and demux thread. Default is 0."
+                           " Recommended when there are lots of cameras.");
+  param_register_.Register("rtsp_standby_streams",
+                           "The stream ids of critical cameras, separated by commas (live555 demuxer only)."
+                           " Each of them is connected twice, the standby session keeps the last GOP and takes over"
+                           " when the active session is lost or stalls, so the video goes on in a few hundred"
+                           " milliseconds. It doubles the bandwidth of the camera. Default is empty.");
+  param_register_.Register("decode_pool_threads",
+                           "How many decoder threads are shared by all the video streams (file, rtsp and es memory)."
+                           " The packets of one stream are still decoded in order."
+                           " 0 means each stream runs its own decode thread. Default is 0.");
+  param_register_.Register("decode_priority",
+                           "The decode priority class of the streams, high, normal or low. It is overridden for a"
+                           " stream by Pipeline::SetStreamParams, e.g. high for critical cameras. In the decoder pool"
+                           " (decode_pool_threads), the streams of a higher class are decoded first, and whole GOPs of"
+                           " the low priority streams are skipped while the pool is under pressure. The decode latency"
+                           " of each class is profiled as DECODE HIGH, DECODE NORMAL and DECODE LOW."
+                           " Default is normal.");
+  param_register_.Register("decode_pressure_ms",
+                           "The average time in milliseconds the streams wait for a thread of the decoder pool above"
+                           " which the pool is under pressure, i.e. the decoders are saturated. 0 means the low"
+                           " priority streams are never skipped. Default is 20.");
+  param_register_.Register("cpu_decoder_threads",
+                           "How many threads are shared by all the FFmpeg cpu decoders of the process. Each decoder"
+                           " takes an even share of them, at least 1 and at most 8, for frame and slice threading."
+                           " 0 means the number of cpu cores. Default is 0.");
+  param_register_.Register("decoder_fallback",
+                           "The decoders tried in order by mlu decoders when no codec channel is left on the device,"
+                           " separated by commas, e.g. vaapi,cpu. Each of them is cpu or an FFmpeg hwaccel (FFmpeg 4.0"
+                           " or later). Default is empty, the stream fails to open then.");
+  param_register_.Register("file_packet_cache",
+                           "Whether to demux each local video file once and keep its packets in memory, shared by all"
+                           " the streams replaying the file. Looping does not read the file again."
+                           " Recommended for short clips replayed on lots of channels. Default is false.");
+  param_register_.Register("jpeg_decode_lanes",
+                           "How many jpeg decoders are shared by all the jpeg memory streams. The images of all the"
+                           " streams are batched into them and output in order per stream. If the mlu decoder fails to"
+                           " be created, the decoder falls back to cpu. 0 means each stream creates its own decoder."
+                           " Default is 0.");
+  param_register_.Register("jpeg_decode_batch",
+                           "The maximum number of images fed to a shared jpeg decoder at a time, valid when"
+                           " jpeg_decode_lanes is set. Default is 8.");
+  param_register_.Register("max_speed",
+                           "Whether to ignore the framerate of file sources and feed frames as fast as they are decoded."
+                           " Used for benchmarks. Default is false.");
+  param_register_.Register("motion_activity",
+                           "Whether the FFmpeg cpu decoders export the motion vectors of inter frames to score"
+                           " their activity, the ratio of the frame area not covered by static blocks"
+                           " (CNDataFrame::activity). The next modules, e.g. the motion filter of Inferencer2, skip"
+                           " static frames by it at almost no cost. Not supported by mlu decoders and hwaccels."
+                           " Default is false.");
+  param_register_.Register("pyramid_levels",
+                           "The number of levels of the pyramid built for each frame on cpu, the levels of 1/2, 1/4,"
+                           " ... of the frame size in NV12, see CNDataFrame::BuildPyramid. The images and crops of the"
+                           " next modules are converted from the nearest level instead of the full resolution frame."
+                           " Not built for the frames kept on mlu (mlu decoders with output_type mlu)."
+                           " Default is 0, no pyramid.");
+  param_register_.Register("output_resolution",
+                           "The resolution of decoded frames, WIDTHxHEIGHT (e.g. 640x640) or auto (mlu300 decoder only)."
+                           " auto takes the input resolution of the model of the next module when all the next modules"
+                           " prefer the same resolution, otherwise frames keep the original resolution."
+                           " The codec scales the frames, they are not resized again by preprocessing."
+                           " Default is the original resolution.");
+  param_register_.Register("capture_dir",
+                           "The directory the compressed packets of the file and rtsp streams are captured into, with"
+                           " the time they arrive, one <stream_id>.cncap file per stream. The captures are replayed"
+                           " by ReplayHandler with the original timing. Default is empty, nothing is captured.");
+  param_register_.Register("capture_streams",
+                           "The stream ids captured, separated by commas, valid when capture_dir is set."
+                           " Default is empty, all the file and rtsp streams are captured.");
 }
 
-DataSource::~DataSource() {}
+static bool ParseDecodePriority(const std::string &str, DecodePriority *priority) {
+  if (str == "high") {
+    *priority = DecodePriority::HIGH;
+  } else if (str == "normal") {
+    *priority = DecodePriority::NORMAL;
+  } else if (str == "low") {
+    *priority = DecodePriority::LOW;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+DataSource::~DataSource() {
+  // streams have to leave the decoder pool before it is destroyed
+  RemoveSources();
+}
+
+static bool ParseResolution(const std::string &str, uint32_t *width, uint32_t *height) {
+  char x = 0;
+  std::string rest;
+  std::stringstream ss(str);
+  if (str.find('-') != std::string::npos) return false;
+  if (!(ss >> *width >> x >> *height) || (x != 'x' && x != 'X') || (ss >> rest)) return false;
+  return *width > 0 && *height > 0;
+}
+
+// the codecs take even sizes, see SetOutputScale
+static void ScaleResolution(double scale, uint32_t *width, uint32_t *height) {
+  if (scale >= 1) return;
+  *width = std::max<uint32_t>(static_cast<uint32_t>(*width * scale) & ~1u, 2);
+  *height = std::max<uint32_t>(static_cast<uint32_t>(*height * scale) & ~1u, 2);
+}
+
+// parses the device ids separated by commas, "auto" is not accepted
+static bool ParseDeviceIds(const std::string &str, std::vector<int> *device_ids) {
+  std::stringstream ss(str);
+  std::string item;
+  std::vector<int> ids;
+  while (std::getline(ss, item, ',')) {
+    std::stringstream item_ss(item);
+    int id = -1;
+    std::string rest;
+    if (!(item_ss >> id) || id < 0 || (item_ss >> rest)) return false;
+    if (std::find(ids.begin(), ids.end(), id) == ids.end()) ids.push_back(id);
+  }
+  if (ids.empty()) return false;
+  *device_ids = std::move(ids);
+  return true;
+}
 
 static int GetDeviceId(ModuleParamSet paramSet) {
   if (paramSet.find("device_id") == paramSet.end()) {
-    return -1;
+    // the first of device_ids
+    if (paramSet.find("device_ids") == paramSet.end()) return -1;
+    if (paramSet["device_ids"] == "auto") return 0;
+    std::vector<int> device_ids;
+    return ParseDeviceIds(paramSet["device_ids"], &device_ids) ? device_ids[0] : -1;
   }
   std::stringstream ss;
   int device_id;
@@ -72,6 +222,29 @@ static int GetDeviceId(ModuleParamSet paramSet) {
   return device_id;
 }
 
+// the codec channels in use (see DeviceResourceManager) and the utilization of the devices (see
+// PipelineProfiler::SetDeviceUtilizationSampler)
+static std::vector<DeviceLoad> SampleDeviceLoads(Pipeline *pipeline) {
+  std::map<int, DeviceLoad> loads;
+  if (pipeline && pipeline->GetProfiler()) {
+    for (const auto &utilization : pipeline->GetProfiler()->SampleDeviceUtilizations()) {
+      DeviceLoad &load = loads[utilization.device_id];
+      load.device_id = utilization.device_id;
+      if (utilization.codec_utilization >= 0) load.codec = utilization.codec_utilization / 100;
+      if (utilization.core_utilization >= 0) load.compute = utilization.core_utilization / 100;
+    }
+  }
+  for (const auto &usage : DeviceResourceManager::Instance().GetUsages()) {
+    if (usage.kind != kRESOURCE_VIDEO_DECODER || !usage.capacity) continue;
+    DeviceLoad &load = loads[usage.device_id];
+    load.device_id = usage.device_id;
+    load.codec = std::max(load.codec, static_cast<double>(usage.in_use) / usage.capacity);
+  }
+  std::vector<DeviceLoad> ret;
+  for (const auto &it : loads) ret.push_back(it.second);
+  return ret;
+}
+
 bool DataSource::Open(ModuleParamSet paramSet) {
   if(!CheckParamSet(paramSet)) {
     return false;
@@ -159,10 +332,294 @@ bool DataSource::Open(ModuleParamSet paramSet) {
     param_.only_key_frame_ = (paramSet["only_key_frame"] == "true");
   }
 
+  if (paramSet.find("max_speed") != paramSet.end()) {
+    param_.max_speed_ = (paramSet["max_speed"] == "true");
+  }
+
+  if (paramSet.find("motion_activity") != paramSet.end()) {
+    param_.motion_activity_ = (paramSet["motion_activity"] == "true");
+  }
+
+  if (paramSet.find("pyramid_levels") != paramSet.end()) {
+    std::stringstream ss;
+    ss << paramSet["pyramid_levels"];
+    ss >> param_.pyramid_levels_;
+  }
+
+  if (paramSet.find("file_packet_cache") != paramSet.end()) {
+    param_.file_packet_cache_ = (paramSet["file_packet_cache"] == "true");
+  }
+
+  if (paramSet.find("gop_interval") != paramSet.end()) {
+    std::stringstream ss;
+    int gop_interval;
+    ss << paramSet["gop_interval"];
+    ss >> gop_interval;
+    if (gop_interval <= 0) {
+      LOGE(SOURCE) << "gop_interval : invalid";
+      return false;
+    }
+    param_.gop_interval_ = gop_interval;
+  }
+
+  if (paramSet.find("rtsp_reactor_threads") != paramSet.end()) {
+    std::stringstream ss;
+    ss << paramSet["rtsp_reactor_threads"];
+    ss >> param_.rtsp_reactor_threads_;
+  }
+
+  param_.rtsp_standby_streams_.clear();
+  if (paramSet.find("rtsp_standby_streams") != paramSet.end()) {
+    std::stringstream ss(paramSet["rtsp_standby_streams"]);
+    std::string stream_id;
+    while (std::getline(ss, stream_id, ',')) {
+      stream_id.erase(0, stream_id.find_first_not_of(' '));
+      stream_id.erase(stream_id.find_last_not_of(' ') + 1);
+      if (!stream_id.empty()) param_.rtsp_standby_streams_.insert(stream_id);
+    }
+  }
+
+  param_.capture_dir_.clear();
+  if (paramSet.find("capture_dir") != paramSet.end()) {
+    param_.capture_dir_ = paramSet["capture_dir"];
+  }
+
+  param_.capture_streams_.clear();
+  if (paramSet.find("capture_streams") != paramSet.end()) {
+    std::stringstream ss(paramSet["capture_streams"]);
+    std::string stream_id;
+    while (std::getline(ss, stream_id, ',')) {
+      stream_id.erase(0, stream_id.find_first_not_of(' '));
+      stream_id.erase(stream_id.find_last_not_of(' ') + 1);
+      if (!stream_id.empty()) param_.capture_streams_.insert(stream_id);
+    }
+  }
+
+  if (paramSet.find("cpu_decoder_threads") != paramSet.end()) {
+    std::stringstream ss;
+    int cpu_decoder_threads = 0;
+    ss << paramSet["cpu_decoder_threads"];
+    ss >> cpu_decoder_threads;
+    DecodeThreadBudget::Instance().SetTotal(cpu_decoder_threads);
+  }
+
+  param_.decoder_fallback_.clear();
+  if (paramSet.find("decoder_fallback") != paramSet.end()) {
+    std::stringstream ss(paramSet["decoder_fallback"]);
+    std::string decoder;
+    while (std::getline(ss, decoder, ',')) {
+      decoder.erase(0, decoder.find_first_not_of(' '));
+      decoder.erase(decoder.find_last_not_of(' ') + 1);
+      if (!decoder.empty()) param_.decoder_fallback_.push_back(decoder);
+    }
+  }
+
+  if (paramSet.find("decode_pool_threads") != paramSet.end()) {
+    std::stringstream ss;
+    ss << paramSet["decode_pool_threads"];
+    ss >> param_.decode_pool_threads_;
+  }
+
+  param_.decode_priority_ = DecodePriority::NORMAL;
+  if (paramSet.find("decode_priority") != paramSet.end()) {
+    ParseDecodePriority(paramSet["decode_priority"], &param_.decode_priority_);
+  }
+
+  if (paramSet.find("decode_pressure_ms") != paramSet.end()) {
+    std::stringstream ss;
+    ss << paramSet["decode_pressure_ms"];
+    ss >> param_.decode_pressure_ms_;
+  }
+
+  param_.output_width_ = param_.output_height_ = 0;
+  param_.auto_output_resolution_ = false;
+  if (paramSet.find("output_resolution") != paramSet.end()) {
+    if (paramSet["output_resolution"] == "auto") {
+      param_.auto_output_resolution_ = true;
+    } else {
+      ParseResolution(paramSet["output_resolution"], &param_.output_width_, &param_.output_height_);
+    }
+  }
+
+  if (paramSet.find("jpeg_decode_lanes") != paramSet.end()) {
+    std::stringstream ss;
+    ss << paramSet["jpeg_decode_lanes"];
+    ss >> param_.jpeg_decode_lanes_;
+  }
+
+  if (paramSet.find("jpeg_decode_batch") != paramSet.end()) {
+    std::stringstream ss;
+    ss << paramSet["jpeg_decode_batch"];
+    ss >> param_.jpeg_decode_batch_;
+  }
+
+  jpeg_engine_.reset();
+  if (param_.jpeg_decode_lanes_ > 0) {
+    auto init_func = [this]() {
+      std::shared_ptr<void> guard = std::make_shared<MluDeviceGuard>(param_.device_id_);
+      BindThreadToCpus();
+      return guard;
+    };
+    jpeg_engine_.reset(new (std::nothrow) JpegDecodeEngine(param_.jpeg_decode_lanes_, param_.jpeg_decode_batch_,
+        [this](IDecodeResult *result) { return CreateJpegDecoder(result); }, init_func));
+    if (!jpeg_engine_ || !jpeg_engine_->Start()) {
+      LOGE(SOURCE) << "[DataSource] Failed to start jpeg decode engine";
+      jpeg_engine_.reset();
+      return false;
+    }
+  }
+
+  decode_pool_.reset();
+  if (param_.decode_pool_threads_ > 0) {
+    int device_id = param_.device_id_;
+    decode_pool_.reset(new (std::nothrow) DecodeWorkerPool(param_.decode_pool_threads_, [this, device_id]() {
+      /*meet cnrt requirement,
+       *  for cpu case(device_id < 0), MluDeviceGuard will do nothing
+       */
+      std::shared_ptr<void> guard = std::make_shared<MluDeviceGuard>(device_id);
+      BindThreadToCpus();
+      return guard;
+    }));
+    if (!decode_pool_ || !decode_pool_->Start()) {
+      LOGE(SOURCE) << "[DataSource] Failed to start decoder pool";
+      decode_pool_.reset();
+      return false;
+    }
+    decode_pool_->SetPressureThreshold(param_.decode_pressure_ms_ * 1000);
+  }
+  if (GetProfiler()) {
+    for (DecodePriority priority : {DecodePriority::HIGH, DecodePriority::NORMAL, DecodePriority::LOW}) {
+      GetProfiler()->RegisterProcessName(GetDecodeProfilerName(priority));
+    }
+  }
+
+  param_.device_ids_.clear();
+  if (paramSet.find("device_ids") != paramSet.end()) {
+    if (paramSet["device_ids"] == "auto") {
+      unsigned int dev_num = 0;
+      cnrtGetDeviceCount(&dev_num);
+      for (unsigned int dev = 0; dev < dev_num; ++dev) param_.device_ids_.push_back(dev);
+    } else {
+      ParseDeviceIds(paramSet["device_ids"], &param_.device_ids_);
+    }
+  }
+  placer_.reset();
+  if (param_.device_id_ >= 0 && param_.device_ids_.size() > 1) {
+    if (decode_pool_ || jpeg_engine_) {
+      LOGW(SOURCE) << "[DataSource] The shared decoders run on device " << param_.device_id_
+                   << ", device_ids is not used with decode_pool_threads or jpeg_decode_lanes";
+    } else {
+      placer_.reset(new StreamPlacer(param_.device_ids_, [this] { return SampleDeviceLoads(GetContainer()); }));
+    }
+  }
+
+  // keeps the frame data of recycled frames, they are reused by SourceRender::CreateFrameInfo.
+  CNFrameInfoPool* pool = GetContainer() ? GetContainer()->GetFramePool() : nullptr;
+  if (pool) {
+    pool->RegisterRecycler<CNDataFrame>(kCNDataFrameTag);
+    pool->RegisterRecycler<CNInferObjs>(kCNInferObjsTag);
+    pool->RegisterRecycler<CNInferData>(kCNInferDataTag);
+  }
+
+  return true;
+}
+
+bool DataSource::GetOutputResolution(uint32_t *width, uint32_t *height) const {
+  if (!param_.auto_output_resolution_) {
+    *width = param_.output_width_;
+    *height = param_.output_height_;
+    if (!*width || !*height) return false;
+    ScaleResolution(output_scale_.load(), width, height);
+    return true;
+  }
+  Pipeline *pipeline = GetContainer();
+  if (!pipeline) return false;
+  uint32_t w = 0, h = 0;
+  for (const auto &name : pipeline->GetModuleConfig(GetName()).next) {
+    Module *next = pipeline->GetModule(name);
+    uint32_t next_w = 0, next_h = 0;
+    // a subgraph or a module working on the original frames
+    if (!next || !next->GetPreferredFrameSize(&next_w, &next_h) || !next_w || !next_h) return false;
+    if (w && (w != next_w || h != next_h)) return false;
+    w = next_w;
+    h = next_h;
+  }
+  if (!w || !h) return false;
+  ScaleResolution(output_scale_.load(), &w, &h);
+  *width = w;
+  *height = h;
+  return true;
+}
+
+bool DataSource::SetOutputScale(double scale) {
+  if (!param_.auto_output_resolution_ && !(param_.output_width_ && param_.output_height_)) return false;
+  output_scale_.store(scale);
+  return true;
+}
+
+std::shared_ptr<Decoder> DataSource::CreateJpegDecoder(IDecodeResult *result) const {
+  VideoInfo info;
+  info.codec_id = AV_CODEC_ID_MJPEG;
+  ExtraDecoderInfo extra;
+  extra.apply_stride_align_for_scaler = param_.apply_stride_align_for_scaler_;
+  extra.device_id = param_.device_id_;
+  extra.input_buf_num = param_.input_buf_number_;
+  extra.output_buf_num = param_.output_buf_number_;
+  extra.max_width = 7680;
+  extra.max_height = 4320;
+  std::shared_ptr<Decoder> decoder;
+  if (param_.decoder_type_ == DecoderType::DECODER_MLU) {
+    decoder = std::make_shared<MluDecoder>("jpeg_engine", result);
+    if (decoder->Create(&info, &extra)) return decoder;
+    LOGW(SOURCE) << "[DataSource] Failed to create mlu jpeg decoder, fall back to cpu decoder";
+  }
+  decoder = std::make_shared<FFmpegCpuDecoder>("jpeg_engine", result);
+  if (decoder->Create(&info, &extra)) return decoder;
+  return nullptr;
+}
+
+DataSourceParam DataSource::GetSourceParam(const std::string &stream_id) const {
+  DataSourceParam param = param_;
+  if (placer_) param.device_id_ = placer_->Place(stream_id);
+  return param;
+}
+
+DecodePriority DataSource::GetDecodePriority(uint32_t stream_index) const {
+  std::shared_ptr<const DecodePriority> priority = stream_priorities_.Get(stream_index);
+  return priority ? *priority : param_.decode_priority_;
+}
+
+bool DataSource::CheckStreamParams(const ModuleParamSet &params) const {
+  DecodePriority priority;
+  for (const auto &it : params) {
+    if (it.first != "decode_priority" || !ParseDecodePriority(it.second, &priority)) {
+      LOGE(SOURCE) << "[DataSource] [" << it.first << "] " << it.second << " can not be overridden per stream.";
+      return false;
+    }
+  }
   return true;
 }
 
-void DataSource::Close() { RemoveSources(); }
+void DataSource::SetStreamParams(uint32_t stream_index, const ModuleParamSet &params) {
+  DecodePriority priority;
+  auto iter = params.find("decode_priority");
+  if (iter == params.end() || !ParseDecodePriority(iter->second, &priority)) {
+    stream_priorities_.Set(stream_index, nullptr);
+    return;
+  }
+  stream_priorities_.Set(stream_index, std::make_shared<const DecodePriority>(priority));
+}
+
+void DataSource::OnSourceClosed(const std::string &stream_id) {
+  if (placer_) placer_->Release(stream_id);
+}
+
+void DataSource::Close() {
+  RemoveSources();
+  // the streams have left the pool and the jpeg decode engine
+  decode_pool_.reset();
+  jpeg_engine_.reset();
+}
 
 bool DataSource::CheckParamSet(const ModuleParamSet &paramSet) const {
   bool ret = true;
@@ -185,7 +642,10 @@ bool DataSource::CheckParamSet(const ModuleParamSet &paramSet) const {
   }
 
   std::string err_msg;
-  if (!checker.IsNum({"interval", "input_buf_number", "output_buf_number"}, paramSet, err_msg, true)) {
+  if (!checker.IsNum({"interval", "gop_interval", "input_buf_number", "output_buf_number", "rtsp_reactor_threads",
+                      "decode_pool_threads", "decode_pressure_ms", "jpeg_decode_lanes", "jpeg_decode_batch",
+                      "cpu_decoder_threads"},
+                     paramSet, err_msg, true)) {
     LOGE(SOURCE) << "[DataSource] " << err_msg;
     ret = false;
   }
@@ -208,6 +668,42 @@ bool DataSource::CheckParamSet(const ModuleParamSet &paramSet) const {
     }
   }
 
+  if (paramSet.find("device_ids") != paramSet.end()) {
+    std::vector<int> device_ids;
+    if (paramSet.at("device_ids") != "auto" && !ParseDeviceIds(paramSet.at("device_ids"), &device_ids)) {
+      LOGE(SOURCE) << "[DataSource] [device_ids] " << paramSet.at("device_ids")
+                   << " should be auto or device ids separated by commas, e.g. 0,1,2,3";
+      ret = false;
+    }
+  }
+
+  if (paramSet.find("output_resolution") != paramSet.end()) {
+    uint32_t width, height;
+    const std::string &res = paramSet.at("output_resolution");
+    if (res != "auto" && !ParseResolution(res, &width, &height)) {
+      LOGE(SOURCE) << "[DataSource] [output_resolution] " << res << " should be auto or WIDTHxHEIGHT, e.g. 640x640";
+      ret = false;
+    }
+  }
+
+  if (paramSet.find("decode_priority") != paramSet.end()) {
+    DecodePriority priority;
+    if (!ParseDecodePriority(paramSet.at("decode_priority"), &priority)) {
+      LOGE(SOURCE) << "[DataSource] [decode_priority] " << paramSet.at("decode_priority")
+                   << " should be high, normal or low";
+      ret = false;
+    }
+  }
+
+  if (paramSet.find("capture_dir") != paramSet.end()) {
+    struct stat st;
+    const std::string &dir = paramSet.at("capture_dir");
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+      LOGE(SOURCE) << "[DataSource] [capture_dir] " << dir << " is not a directory";
+      ret = false;
+    }
+  }
+
   return ret;
 }
 
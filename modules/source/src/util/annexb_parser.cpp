@@ -0,0 +1,310 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "annexb_parser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace cnstream {
+
+namespace {
+
+// enough for the slice header fields read, see AnnexBParser::IsKeyFrame
+constexpr size_t kNalHeaderBytes = 16;
+
+class BitReader {
+ public:
+  BitReader(const uint8_t *data, size_t len) : data_(data), bits_(len * 8) {}
+  uint32_t ReadBit() {
+    if (pos_ >= bits_) {
+      overrun_ = true;
+      return 0;
+    }
+    uint32_t bit = (data_[pos_ >> 3] >> (7 - (pos_ & 7))) & 1;
+    ++pos_;
+    return bit;
+  }
+  uint32_t ReadBits(int n) {
+    uint32_t value = 0;
+    while (n-- > 0) value = (value << 1) | ReadBit();
+    return value;
+  }
+  // unsigned Exp-Golomb code
+  uint32_t ReadUe() {
+    int zeros = 0;
+    while (!ReadBit()) {
+      if (overrun_ || ++zeros > 31) {
+        overrun_ = true;
+        return 0;
+      }
+    }
+    return ((1u << zeros) - 1) + ReadBits(zeros);
+  }
+  // signed Exp-Golomb code
+  int32_t ReadSe() {
+    uint32_t value = ReadUe();
+    return (value & 1) ? static_cast<int32_t>((value + 1) / 2) : -static_cast<int32_t>(value / 2);
+  }
+  bool Ok() const { return !overrun_; }
+
+ private:
+  const uint8_t *data_;
+  size_t bits_;
+  size_t pos_ = 0;
+  bool overrun_ = false;
+};  // class BitReader
+
+// the profiles with chroma_format_idc and the scaling matrices in the H.264 sps
+bool HasChromaFormat(uint32_t profile_idc) {
+  static const uint32_t kProfiles[] = {44, 83, 86, 100, 110, 118, 122, 128, 134, 135, 138, 139, 144, 244};
+  return std::find(std::begin(kProfiles), std::end(kProfiles), profile_idc) != std::end(kProfiles);
+}
+
+}  // namespace
+
+const uint8_t *AnnexBParser::FindStartCode(const uint8_t *begin, const uint8_t *end) {
+  if (end - begin < 3) return end;
+  // memchr is vectorized by libc, and 0x01 is much rarer than 0x00 in the slice data
+  const uint8_t *p = begin + 2;
+  while (p < end) {
+    p = static_cast<const uint8_t *>(memchr(p, 1, end - p));
+    if (!p) break;
+    if (p[-1] == 0 && p[-2] == 0) return p - 2;
+    // the next 00 00 01 can not overlap the 01 found
+    p += 3;
+  }
+  return end;
+}
+
+bool AnnexBParser::Open(AVCodecID codec_id) {
+  if (codec_id != AV_CODEC_ID_H264 && codec_id != AV_CODEC_ID_HEVC) return false;
+  hevc_ = codec_id == AV_CODEC_ID_HEVC;
+  progressive_ = true;
+  pps_extra_bits_.fill(0);
+  Reset();
+  return true;
+}
+
+void AnnexBParser::Reset() {
+  buffer_.clear();
+  scan_pos_ = au_begin_ = last_nal_ = chunk_begin_ = 0;
+  has_last_nal_ = au_has_vcl_ = au_key_ = false;
+}
+
+void AnnexBParser::Parse(const uint8_t *data, size_t len, int64_t pts, const AccessUnitFunc &func) {
+  if (!data || !len) return;
+  if (buffer_.empty()) au_pts_ = pts;
+  prev_chunk_pts_ = chunk_pts_;
+  chunk_pts_ = pts;
+  chunk_begin_ = buffer_.size();
+  // the buffer keeps its capacity, nothing is allocated once it holds the largest access unit
+  buffer_.insert(buffer_.end(), data, data + len);
+  Scan(false, func);
+}
+
+void AnnexBParser::Flush(const AccessUnitFunc &func) {
+  Scan(true, func);
+  if (has_last_nal_) ParseParameterSet(buffer_.data() + last_nal_, buffer_.size() - last_nal_);
+  if (au_has_vcl_) Output(buffer_.size(), func);
+  Reset();
+}
+
+void AnnexBParser::ParseParameterSets(const uint8_t *data, size_t len) {
+  const uint8_t *end = data + len;
+  const uint8_t *start_code = FindStartCode(data, end);
+  while (start_code != end) {
+    const uint8_t *nal = start_code + 3;
+    start_code = FindStartCode(nal, end);
+    ParseParameterSet(nal, start_code - nal);
+  }
+}
+
+void AnnexBParser::Scan(bool flush, const AccessUnitFunc &func) {
+  const uint8_t *base = buffer_.data();
+  const size_t size = buffer_.size();
+  while (true) {
+    const uint8_t *start_code = FindStartCode(base + scan_pos_, base + size);
+    if (start_code == base + size) {
+      // a start code may be split between two chunks
+      scan_pos_ = std::max(scan_pos_, size > 2 ? size - 2 : 0);
+      break;
+    }
+    const size_t pos = start_code - base;
+    if (!flush && size - pos - 3 < kNalHeaderBytes) {
+      scan_pos_ = pos;  // waits for the slice header
+      break;
+    }
+    OnNal(pos, pos + 3, func);
+    scan_pos_ = pos + 3;
+  }
+  if (au_begin_ > 0) {
+    buffer_.erase(buffer_.begin(), buffer_.begin() + au_begin_);
+    scan_pos_ -= au_begin_;
+    last_nal_ = has_last_nal_ ? last_nal_ - au_begin_ : 0;
+    chunk_begin_ -= std::min(chunk_begin_, au_begin_);
+    au_begin_ = 0;
+  }
+}
+
+void AnnexBParser::OnNal(size_t start_code, size_t nal, const AccessUnitFunc &func) {
+  if (has_last_nal_) ParseParameterSet(buffer_.data() + last_nal_, start_code - last_nal_);
+  has_last_nal_ = false;
+  const uint8_t *data = buffer_.data() + nal;
+  const size_t len = std::min(buffer_.size() - nal, kNalHeaderBytes);
+  if (len < (hevc_ ? 3u : 2u)) return;
+  if (au_has_vcl_ && IsAccessUnitStart(data, len)) {
+    size_t end = start_code;
+    // trailing zeros and the leading zero of a 4-byte start code go to the next access unit
+    while (end > au_begin_ && buffer_[end - 1] == 0) --end;
+    Output(end, func);
+    au_begin_ = end;
+    au_pts_ = au_begin_ >= chunk_begin_ ? chunk_pts_ : prev_chunk_pts_;
+    au_has_vcl_ = au_key_ = false;
+  }
+  if (!au_has_vcl_ && IsVcl(data)) {
+    au_has_vcl_ = true;
+    au_key_ = IsKeyFrame(data, len);
+  }
+  last_nal_ = nal;
+  has_last_nal_ = true;
+}
+
+void AnnexBParser::Output(size_t end, const AccessUnitFunc &func) {
+  AccessUnit au;
+  au.data = buffer_.data() + au_begin_;
+  au.len = end - au_begin_;
+  au.pts = au_pts_;
+  au.key_frame = au_key_;
+  func(au);
+}
+
+bool AnnexBParser::IsAccessUnitStart(const uint8_t *nal, size_t len) const {
+  if (!hevc_) {
+    const int type = nal[0] & 0x1f;
+    // first_mb_in_slice is 0
+    if (type == 1 || type == 2 || type == 5) return len > 1 && (nal[1] & 0x80);
+    // sei, sps, pps, access unit delimiter and the reserved types
+    return (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+  }
+  const int type = (nal[0] >> 1) & 0x3f;
+  // first_slice_segment_in_pic_flag
+  if (type < 32) return len > 2 && (nal[2] & 0x80);
+  // vps, sps, pps, access unit delimiter, prefix sei and the reserved types
+  return (type >= 32 && type <= 35) || type == 39 || (type >= 41 && type <= 44) || (type >= 48 && type <= 55);
+}
+
+bool AnnexBParser::IsVcl(const uint8_t *nal) const {
+  if (!hevc_) {
+    const int type = nal[0] & 0x1f;
+    return type >= 1 && type <= 5;
+  }
+  return ((nal[0] >> 1) & 0x3f) < 32;
+}
+
+bool AnnexBParser::IsKeyFrame(const uint8_t *nal, size_t len) {
+  if (!hevc_) {
+    if ((nal[0] & 0x1f) == 5) return true;  // idr
+    Unescape(nal + 1, len - 1);
+    BitReader reader(rbsp_.data(), rbsp_.size());
+    reader.ReadUe();  // first_mb_in_slice
+    const uint32_t slice_type = reader.ReadUe();
+    return reader.Ok() && slice_type % 5 == 2;
+  }
+  const int type = (nal[0] >> 1) & 0x3f;
+  if (type >= 16 && type <= 23) return true;  // irap
+  Unescape(nal + 2, len - 2);
+  BitReader reader(rbsp_.data(), rbsp_.size());
+  if (!reader.ReadBit()) return false;  // not the first slice segment
+  const uint32_t pps_id = reader.ReadUe();
+  reader.ReadBits(pps_id < pps_extra_bits_.size() ? pps_extra_bits_[pps_id] : 0);
+  const uint32_t slice_type = reader.ReadUe();
+  return reader.Ok() && slice_type == 2;
+}
+
+void AnnexBParser::ParseParameterSet(const uint8_t *nal, size_t len) {
+  if (len < (hevc_ ? 3u : 2u)) return;
+  if (!hevc_ && (nal[0] & 0x1f) == 7) {
+    Unescape(nal + 1, len - 1);
+    BitReader reader(rbsp_.data(), rbsp_.size());
+    const uint32_t profile_idc = reader.ReadBits(8);
+    reader.ReadBits(16);  // constraint flags and level_idc
+    reader.ReadUe();      // seq_parameter_set_id
+    if (HasChromaFormat(profile_idc)) {
+      const uint32_t chroma_format_idc = reader.ReadUe();
+      if (chroma_format_idc == 3) reader.ReadBit();  // separate_colour_plane_flag
+      reader.ReadUe();                                // bit_depth_luma_minus8
+      reader.ReadUe();                                // bit_depth_chroma_minus8
+      reader.ReadBit();                               // qpprime_y_zero_transform_bypass_flag
+      if (reader.ReadBit()) {                         // seq_scaling_matrix_present_flag
+        for (int i = 0; i < (chroma_format_idc != 3 ? 8 : 12) && reader.Ok(); ++i) {
+          if (!reader.ReadBit()) continue;
+          int last_scale = 8;
+          int next_scale = 8;
+          for (int j = 0; j < (i < 6 ? 16 : 64) && next_scale != 0; ++j) {
+            next_scale = (last_scale + reader.ReadSe() + 256) % 256;
+            if (next_scale != 0) last_scale = next_scale;
+          }
+        }
+      }
+    }
+    reader.ReadUe();  // log2_max_frame_num_minus4
+    const uint32_t pic_order_cnt_type = reader.ReadUe();
+    if (pic_order_cnt_type == 0) {
+      reader.ReadUe();  // log2_max_pic_order_cnt_lsb_minus4
+    } else if (pic_order_cnt_type == 1) {
+      reader.ReadBit();  // delta_pic_order_always_zero_flag
+      reader.ReadSe();   // offset_for_non_ref_pic
+      reader.ReadSe();   // offset_for_top_to_bottom_field
+      const uint32_t cycle = reader.ReadUe();
+      for (uint32_t i = 0; i < cycle && reader.Ok(); ++i) reader.ReadSe();
+    }
+    reader.ReadUe();   // max_num_ref_frames
+    reader.ReadBit();  // gaps_in_frame_num_value_allowed_flag
+    reader.ReadUe();   // pic_width_in_mbs_minus1
+    reader.ReadUe();   // pic_height_in_map_units_minus1
+    const uint32_t frame_mbs_only_flag = reader.ReadBit();
+    if (reader.Ok()) progressive_ = frame_mbs_only_flag != 0;
+  } else if (hevc_ && ((nal[0] >> 1) & 0x3f) == 34) {
+    Unescape(nal + 2, len - 2);
+    BitReader reader(rbsp_.data(), rbsp_.size());
+    const uint32_t pps_id = reader.ReadUe();
+    reader.ReadUe();     // pps_seq_parameter_set_id
+    reader.ReadBits(2);  // dependent_slice_segments_enabled_flag and output_flag_present_flag
+    const uint32_t extra_bits = reader.ReadBits(3);
+    if (reader.Ok() && pps_id < pps_extra_bits_.size()) pps_extra_bits_[pps_id] = extra_bits;
+  }
+}
+
+void AnnexBParser::Unescape(const uint8_t *data, size_t len) {
+  rbsp_.clear();
+  int zeros = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (zeros >= 2 && data[i] == 3) {
+      zeros = 0;
+      continue;
+    }
+    zeros = data[i] ? 0 : zeros + 1;
+    rbsp_.push_back(data[i]);
+  }
+}
+
+}  // namespace cnstream
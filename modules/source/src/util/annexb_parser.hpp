@@ -0,0 +1,102 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_ANNEXB_PARSER_HPP_
+#define CNSTREAM_ANNEXB_PARSER_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavcodec/avcodec.h>
+#ifdef __cplusplus
+}
+#endif
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief AnnexBParser splits H.264 and H.265 Annex-B byte streams into access units, the counterpart of the FFmpeg
+ * parsers for the elementary streams written to memory.
+ *
+ * Only the NAL unit headers, the first bytes of the slice headers and the parameter sets are read. The chunks written
+ * are appended to one buffer reused for the whole stream, an access unit is output once the first NAL unit of the
+ * next one is found. The output data is valid until the next call.
+ */
+class AnnexBParser {
+ public:
+  struct AccessUnit {
+    const uint8_t *data = nullptr;
+    size_t len = 0;
+    int64_t pts = 0;         // the pts of the chunk where the access unit begins
+    bool key_frame = false;  // an IDR, IRAP or intra picture
+  };
+  using AccessUnitFunc = std::function<void(const AccessUnit &)>;
+
+  /* only AV_CODEC_ID_H264 and AV_CODEC_ID_HEVC are supported */
+  bool Open(AVCodecID codec_id);
+  void Parse(const uint8_t *data, size_t len, int64_t pts, const AccessUnitFunc &func);
+  /* outputs the last access unit at eos */
+  void Flush(const AccessUnitFunc &func);
+  /* reads the parameter sets given out of band, nothing is output */
+  void ParseParameterSets(const uint8_t *data, size_t len);
+  /* false if the H.264 sequence parameter set allows field pictures */
+  bool Progressive() const { return progressive_; }
+
+  /* returns the position of the first 00 00 01 in [begin, end), or end if there is none */
+  static const uint8_t *FindStartCode(const uint8_t *begin, const uint8_t *end);
+
+ private:
+  void Reset();
+  void Scan(bool flush, const AccessUnitFunc &func);
+  void OnNal(size_t start_code, size_t nal, const AccessUnitFunc &func);
+  // outputs [au_begin_, end) as an access unit
+  void Output(size_t end, const AccessUnitFunc &func);
+  bool IsAccessUnitStart(const uint8_t *nal, size_t len) const;
+  bool IsVcl(const uint8_t *nal) const;
+  bool IsKeyFrame(const uint8_t *nal, size_t len);
+  void ParseParameterSet(const uint8_t *nal, size_t len);
+  // removes the emulation prevention bytes into rbsp_
+  void Unescape(const uint8_t *data, size_t len);
+
+  bool hevc_ = false;
+  std::vector<uint8_t> buffer_;
+  std::vector<uint8_t> rbsp_;
+  size_t scan_pos_ = 0;
+  size_t au_begin_ = 0;
+  int64_t au_pts_ = 0;
+  bool au_has_vcl_ = false;
+  bool au_key_ = false;
+  size_t last_nal_ = 0;
+  bool has_last_nal_ = false;
+  size_t chunk_begin_ = 0;
+  int64_t chunk_pts_ = 0;
+  int64_t prev_chunk_pts_ = 0;
+  bool progressive_ = true;
+  std::array<uint8_t, 64> pps_extra_bits_{};  // num_extra_slice_header_bits of the H.265 pps
+};  // class AnnexBParser
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_ANNEXB_PARSER_HPP_
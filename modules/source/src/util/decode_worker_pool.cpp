@@ -0,0 +1,156 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "decode_worker_pool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace cnstream {
+
+thread_local DecodeWorkerPool::Job *DecodeWorkerPool::current_job_ = nullptr;
+
+bool DecodeWorkerPool::Start() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (running_ || thread_num_ == 0) return false;
+  running_ = true;
+  for (uint32_t i = 0; i < thread_num_; ++i) {
+    threads_.emplace_back(&DecodeWorkerPool::WorkerLoop, this);
+  }
+  return true;
+}
+
+void DecodeWorkerPool::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!running_) return;
+    running_ = false;
+  }
+  work_cond_.notify_all();
+  for (auto &thread : threads_) {
+    if (thread.joinable()) thread.join();
+  }
+  threads_.clear();
+
+  std::lock_guard<std::mutex> lk(mutex_);
+  for (auto &jobs : ready_jobs_) jobs.clear();
+  ready_num_ = 0;
+  idle_jobs_.clear();
+  alive_jobs_.clear();
+  done_cond_.notify_all();
+}
+
+uint64_t DecodeWorkerPool::Submit(StepFunc step, uint32_t priority) {
+  if (!step) return 0;
+  std::shared_ptr<Job> job = std::make_shared<Job>();
+  job->step = std::move(step);
+  job->priority = std::min(priority, kPriorityNum - 1);
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!running_) return 0;
+    job->id = next_job_id_++;
+    alive_jobs_.insert(job->id);
+    PushReady(job, Clock::now());
+  }
+  work_cond_.notify_one();
+  return job->id;
+}
+
+void DecodeWorkerPool::SetCurrentPriority(uint32_t priority) {
+  // only read by the worker after the step returns
+  if (current_job_) current_job_->priority = std::min(priority, kPriorityNum - 1);
+}
+
+void DecodeWorkerPool::Wait(uint64_t job_id) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  done_cond_.wait(lk, [this, job_id] { return !alive_jobs_.count(job_id); });
+}
+
+size_t DecodeWorkerPool::GetJobNum() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return alive_jobs_.size();
+}
+
+void DecodeWorkerPool::PushReady(std::shared_ptr<Job> job, Clock::time_point now) {
+  job->ready_time = now;
+  ready_jobs_[job->priority].push_back(std::move(job));
+  ++ready_num_;
+}
+
+std::shared_ptr<DecodeWorkerPool::Job> DecodeWorkerPool::PopReady(Clock::time_point now) {
+  for (auto &jobs : ready_jobs_) {
+    if (jobs.empty()) continue;
+    std::shared_ptr<Job> job = jobs.front();
+    jobs.pop_front();
+    --ready_num_;
+    // moving average of the time waited for a worker, over about the last 16 steps
+    const double wait_us = std::chrono::duration<double, std::micro>(now - job->ready_time).count();
+    avg_wait_us_value_ += (wait_us - avg_wait_us_value_) / 16;
+    avg_wait_us_.store(static_cast<uint32_t>(avg_wait_us_value_));
+    return job;
+  }
+  return nullptr;
+}
+
+void DecodeWorkerPool::WorkerLoop() {
+  std::shared_ptr<void> thread_ctx = init_func_ ? init_func_() : nullptr;
+
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (running_) {
+    // wake up the jobs whose idle time is over
+    Clock::time_point now = Clock::now();
+    while (!idle_jobs_.empty() && idle_jobs_.begin()->first <= now) {
+      // the job has been ready since its idle time is over
+      PushReady(idle_jobs_.begin()->second, idle_jobs_.begin()->first);
+      idle_jobs_.erase(idle_jobs_.begin());
+    }
+    if (!ready_num_) {
+      if (idle_jobs_.empty()) {
+        work_cond_.wait(lk);
+      } else {
+        work_cond_.wait_until(lk, idle_jobs_.begin()->first);
+      }
+      continue;
+    }
+
+    std::shared_ptr<Job> job = PopReady(now);
+    lk.unlock();
+    uint32_t idle_us = 0;
+    current_job_ = job.get();
+    bool unfinished = job->step(&idle_us);
+    current_job_ = nullptr;
+    lk.lock();
+
+    if (!unfinished) {
+      alive_jobs_.erase(job->id);
+      done_cond_.notify_all();
+    } else if (idle_us == 0) {
+      PushReady(job, Clock::now());
+      if (ready_num_ > 1) work_cond_.notify_one();
+    } else {
+      idle_jobs_.emplace(Clock::now() + std::chrono::microseconds(idle_us), job);
+      // the other workers may sleep longer than this job
+      work_cond_.notify_one();
+    }
+  }
+}
+
+}  // namespace cnstream
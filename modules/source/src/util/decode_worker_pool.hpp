@@ -0,0 +1,152 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_DECODE_WORKER_POOL_HPP_
+#define CNSTREAM_DECODE_WORKER_POOL_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief DecodeWorkerPool drives the decode loops of many streams with a fixed number of threads.
+ *
+ * A stream is submitted as a job made of steps. A job is run by one worker at a time and its steps never overlap,
+ * so the packets of one stream are decoded in order. After each step the job goes to the back of the ready queue,
+ * or waits for the idle time the step asked for, so idle streams do not hold threads.
+ *
+ * The ready jobs are served by priority class, a job runs only when no job of a higher class is ready, and in turn
+ * within a class. The time the ready jobs wait for a worker is averaged, the pool is under pressure when it is above
+ * the threshold, e.g. when the decoders are saturated.
+ */
+class DecodeWorkerPool {
+ public:
+  /**
+   * @brief Runs one step of a job, it should only do a bounded piece of work (e.g. decode one packet).
+   *
+   * @param[out] idle_us Sets it to postpone the next step, 0 by default.
+   *
+   * @return Returns false when the job is finished, it will not be run again.
+   */
+  using StepFunc = std::function<bool(uint32_t *idle_us)>;
+  /**
+   * @brief Called once by each worker thread before running jobs. The returned object lives as long as the thread,
+   * e.g. a device guard.
+   */
+  using ThreadInitFunc = std::function<std::shared_ptr<void>()>;
+  /**
+   * @brief The number of priority classes, 0 is the highest.
+   */
+  static constexpr uint32_t kPriorityNum = 3;
+
+  explicit DecodeWorkerPool(uint32_t thread_num, ThreadInitFunc init_func = nullptr)
+      : thread_num_(thread_num), init_func_(init_func) {}
+  ~DecodeWorkerPool() { Stop(); }
+
+  bool Start();
+  /**
+   * @brief Stops the workers. Unfinished jobs are dropped and the callers of Wait are released.
+   */
+  void Stop();
+  bool IsRunning() const { return running_; }
+
+  /**
+   * @brief Submits a job.
+   *
+   * @param[in] step The step of the job.
+   * @param[in] priority The priority class of the job, less than kPriorityNum.
+   *
+   * @return Returns the job id, 0 if the pool is not running.
+   */
+  uint64_t Submit(StepFunc step, uint32_t priority = 1);
+  /**
+   * @brief Changes the priority class of the job running the step, it takes effect when the step returns. It must be
+   * called by a step.
+   */
+  static void SetCurrentPriority(uint32_t priority);
+  /**
+   * @brief Blocks until the job is finished. It must not be called by the job itself.
+   */
+  void Wait(uint64_t job_id);
+
+  uint32_t GetThreadNum() const { return thread_num_; }
+  size_t GetJobNum();
+
+  /**
+   * @brief Sets the average time the ready jobs wait for a worker above which the pool is under pressure. 0, the
+   * default, means the pool is never under pressure.
+   */
+  void SetPressureThreshold(uint32_t wait_us) { pressure_wait_us_.store(wait_us); }
+  bool IsUnderPressure() const {
+    const uint32_t threshold = pressure_wait_us_.load();
+    return threshold > 0 && avg_wait_us_.load() > threshold;
+  }
+  /**
+   * @brief Gets the average time the ready jobs wait for a worker, in microseconds.
+   */
+  uint32_t GetAverageWaitUs() const { return avg_wait_us_.load(); }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  struct Job {
+    uint64_t id = 0;
+    uint32_t priority = 1;
+    Clock::time_point ready_time;
+    StepFunc step;
+  };
+
+  void WorkerLoop();
+  // the caller holds mutex_
+  void PushReady(std::shared_ptr<Job> job, Clock::time_point now);
+  std::shared_ptr<Job> PopReady(Clock::time_point now);
+
+  static thread_local Job *current_job_;  // the job run by the worker thread
+
+  uint32_t thread_num_ = 0;
+  ThreadInitFunc init_func_;
+  bool running_ = false;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable work_cond_;
+  std::condition_variable done_cond_;
+  std::deque<std::shared_ptr<Job>> ready_jobs_[kPriorityNum];
+  size_t ready_num_ = 0;
+  std::multimap<Clock::time_point, std::shared_ptr<Job>> idle_jobs_;
+  std::set<uint64_t> alive_jobs_;
+  uint64_t next_job_id_ = 1;
+  std::atomic<uint32_t> pressure_wait_us_{0};
+  double avg_wait_us_value_ = 0;  // guarded by mutex_, mirrored by avg_wait_us_
+  std::atomic<uint32_t> avg_wait_us_{0};
+};  // class DecodeWorkerPool
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_DECODE_WORKER_POOL_HPP_
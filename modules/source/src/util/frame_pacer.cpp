@@ -0,0 +1,57 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "frame_pacer.hpp"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace cnstream {
+
+namespace {
+
+struct PacerWaiter {
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool released = false;
+};
+
+}  // namespace
+
+FramePacer &FramePacer::Instance() {
+  static FramePacer pacer;
+  return pacer;
+}
+
+void FramePacer::WaitUntil(const std::chrono::steady_clock::time_point &deadline) {
+  if (std::chrono::steady_clock::now() >= deadline) return;
+  // shared with the timer thread, its handler may still hold the waiter when this function returns
+  std::shared_ptr<PacerWaiter> waiter = std::make_shared<PacerWaiter>();
+  TimerWheel::Instance().Schedule(deadline, [waiter]() {
+    std::lock_guard<std::mutex> lk(waiter->mutex);
+    waiter->released = true;
+    waiter->cond.notify_one();
+  });
+  std::unique_lock<std::mutex> lk(waiter->mutex);
+  waiter->cond.wait(lk, [&waiter] { return waiter->released; });
+}
+
+}  // namespace cnstream
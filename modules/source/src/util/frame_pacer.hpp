@@ -0,0 +1,52 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_FRAME_PACER_HPP_
+#define CNSTREAM_FRAME_PACER_HPP_
+
+#include <chrono>
+
+#include "util/cnstream_timer.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief FramePacer releases the paced streams of all the source modules from the shared timer wheel.
+ *
+ * Streams wait for absolute deadlines instead of sleeping for relative delays. One clock wakes them all, so the
+ * jitter does not grow with the number of streams and the sleep overshoot of each frame does not add up.
+ */
+class FramePacer {
+ public:
+  static FramePacer &Instance();
+  /**
+   * @brief Blocks the calling thread until deadline. Returns at once if deadline has passed.
+   */
+  void WaitUntil(const std::chrono::steady_clock::time_point &deadline);
+
+ private:
+  FramePacer() = default;
+  FramePacer(const FramePacer &) = delete;
+  FramePacer &operator=(const FramePacer &) = delete;
+};  // class FramePacer
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_FRAME_PACER_HPP_
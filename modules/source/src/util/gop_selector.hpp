@@ -0,0 +1,66 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_GOP_SELECTOR_HPP_
+#define CNSTREAM_GOP_SELECTOR_HPP_
+
+#include <cstdint>
+
+namespace cnstream {
+
+/**
+ * @brief GopSelector decides which packets are sent to the decoder, so that skipped frames are never decoded.
+ *
+ * One GOP out of every gop_interval GOPs is kept, the first GOP is always kept. With only_key_frame, only the key
+ * frame of a kept GOP is sent. Dropping starts and stops at key frames, the decoder always gets a valid sequence.
+ */
+class GopSelector {
+ public:
+  explicit GopSelector(bool only_key_frame = false, uint32_t gop_interval = 1)
+      : only_key_frame_(only_key_frame), gop_interval_(gop_interval ? gop_interval : 1) {}
+
+  /**
+   * @brief Checks whether the packet is sent to the decoder. It should be called for each packet in order.
+   */
+  bool Keep(bool is_key_frame) {
+    if (is_key_frame) {
+      keep_gop_ = (gop_cnt_++ % gop_interval_) == 0;
+      return keep_gop_;
+    }
+    return keep_gop_ && !only_key_frame_;
+  }
+
+  void Reset() {
+    gop_cnt_ = 0;
+    keep_gop_ = false;
+  }
+
+  bool IsPassThrough() const { return !only_key_frame_ && gop_interval_ == 1; }
+
+ private:
+  bool only_key_frame_ = false;
+  uint32_t gop_interval_ = 1;
+  uint64_t gop_cnt_ = 0;
+  bool keep_gop_ = false;
+};  // class GopSelector
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_GOP_SELECTOR_HPP_
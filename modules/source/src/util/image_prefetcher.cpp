@@ -0,0 +1,170 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "util/image_prefetcher.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+static bool IsJpegName(const std::string &name) {
+  const size_t dot = name.rfind('.');
+  if (dot == std::string::npos) return false;
+  std::string ext = name.substr(dot + 1);
+  std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+  return ext == "jpg" || ext == "jpeg";
+}
+
+bool ListImageFiles(const std::string &path, std::vector<std::string> *files) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) return false;
+  if (S_ISDIR(st.st_mode)) {
+    DIR *dir = opendir(path.c_str());
+    if (!dir) return false;
+    std::vector<std::string> names;
+    while (struct dirent *entry = readdir(dir)) {
+      if (IsJpegName(entry->d_name)) names.emplace_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    const std::string prefix = path.back() == '/' ? path : path + "/";
+    for (const auto &name : names) files->push_back(prefix + name);
+    return true;
+  }
+  std::ifstream list(path);
+  if (!list.is_open()) return false;
+  std::string line;
+  while (std::getline(list, line)) {
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (line.empty() || line[0] == '#') continue;
+    files->push_back(line);
+  }
+  return true;
+}
+
+static bool ReadFile(const std::string &path, std::vector<uint8_t> *data) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0 && st.st_size > 0;
+  if (ok) {
+    data->resize(st.st_size);
+    size_t offset = 0;
+    while (offset < data->size()) {
+      const ssize_t n = read(fd, data->data() + offset, data->size() - offset);
+      if (n <= 0) {
+        ok = false;
+        break;
+      }
+      offset += n;
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+ImagePrefetcher::ImagePrefetcher(const std::vector<std::string> &files, uint32_t reader_num, uint32_t window,
+                                 bool loop)
+    : files_(files), reader_num_(std::max(reader_num, 1u)), window_(std::max(window, 1u)),
+      end_seq_(loop && !files.empty() ? std::numeric_limits<uint64_t>::max() : files.size()) {}
+
+ImagePrefetcher::~ImagePrefetcher() {
+  Stop();
+}
+
+bool ImagePrefetcher::Start() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (running_ || !readers_.empty()) return false;
+  running_ = true;
+  slots_.assign(window_, Image());
+  slot_ready_.assign(window_, false);
+  for (uint32_t i = 0; i < reader_num_; ++i) readers_.emplace_back(&ImagePrefetcher::ReaderLoop, this);
+  return true;
+}
+
+void ImagePrefetcher::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    running_ = false;
+  }
+  not_full_.notify_all();
+  ready_.notify_all();
+  for (auto &reader : readers_) {
+    if (reader.joinable()) reader.join();
+  }
+}
+
+void ImagePrefetcher::ReaderLoop() {
+  while (true) {
+    Image image;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      not_full_.wait(lk, [this] { return !running_ || read_seq_ >= end_seq_ || read_seq_ < pop_seq_ + window_; });
+      if (!running_ || read_seq_ >= end_seq_) return;
+      image.seq = read_seq_++;
+    }
+    image.path = files_[image.seq % files_.size()];
+    image.ok = ReadFile(image.path, &image.data);
+    if (!image.ok) image.data.clear();
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      read_bytes_ += image.data.size();
+      const size_t slot = image.seq % window_;
+      slots_[slot] = std::move(image);
+      slot_ready_[slot] = true;
+    }
+    ready_.notify_all();
+  }
+}
+
+std::vector<ImagePrefetcher::Image> ImagePrefetcher::PopBatch(size_t max_num) {
+  std::vector<Image> images;
+  std::unique_lock<std::mutex> lk(mutex_);
+  ready_.wait(lk, [this] { return !running_ || pop_seq_ >= end_seq_ || slot_ready_[pop_seq_ % window_]; });
+  if (!running_) return images;
+  while (images.size() < max_num && pop_seq_ < end_seq_ && slot_ready_[pop_seq_ % window_]) {
+    const size_t slot = pop_seq_ % window_;
+    images.push_back(std::move(slots_[slot]));
+    slots_[slot] = Image();
+    slot_ready_[slot] = false;
+    ++pop_seq_;
+  }
+  lk.unlock();
+  not_full_.notify_all();
+  return images;
+}
+
+uint64_t ImagePrefetcher::GetReadBytes() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return read_bytes_;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,94 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_IMAGE_PREFETCHER_HPP_
+#define CNSTREAM_IMAGE_PREFETCHER_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief Lists the jpeg images of a directory in the order of their names, or the image paths in a list file, one
+ * path per line. Empty lines and lines starting with '#' are skipped.
+ *
+ * @return Returns false if the path could not be read.
+ */
+bool ListImageFiles(const std::string &path, std::vector<std::string> *files);
+
+/**
+ * @brief ImagePrefetcher reads image files ahead of the decoder with a pool of reader threads.
+ *
+ * The files are read in parallel but popped in order. At most ``window`` images are read and not popped yet, so the
+ * memory is bounded however slow the consumer is.
+ */
+class ImagePrefetcher {
+ public:
+  struct Image {
+    uint64_t seq = 0;  // the index of the image in all images read, it keeps growing when looping
+    std::string path;
+    std::vector<uint8_t> data;
+    bool ok = false;   // false if the file could not be read
+  };
+
+  ImagePrefetcher(const std::vector<std::string> &files, uint32_t reader_num, uint32_t window, bool loop);
+  ~ImagePrefetcher();
+
+  bool Start();
+  /**
+   * @brief Stops the readers, PopBatch returns no image afterwards.
+   */
+  void Stop();
+  /**
+   * @brief Pops up to ``max_num`` images in order. It blocks until the next image is read.
+   *
+   * @return Returns the images, empty if all the images are popped or the prefetcher is stopped.
+   */
+  std::vector<Image> PopBatch(size_t max_num);
+
+  uint64_t GetReadBytes() const;
+
+ private:
+  void ReaderLoop();
+
+  std::vector<std::string> files_;
+  uint32_t reader_num_;
+  uint32_t window_;
+  uint64_t end_seq_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable ready_;
+  bool running_ = false;
+  uint64_t read_seq_ = 0;  // the next image to read
+  uint64_t pop_seq_ = 0;   // the next image to pop
+  uint64_t read_bytes_ = 0;
+  std::vector<Image> slots_;  // image seq is in slot seq % window
+  std::vector<bool> slot_ready_;
+  std::vector<std::thread> readers_;
+};  // class ImagePrefetcher
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_IMAGE_PREFETCHER_HPP_
@@ -0,0 +1,360 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "jpeg_decode_engine.hpp"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+struct JpegDecodeEngine::Stream {
+  explicit Stream(IJpegDecodeResult *r) : result(r) {}
+  IJpegDecodeResult *result;
+  std::mutex mutex;
+  std::condition_variable cond;
+  uint64_t submit_seq = 0;   // seq of the next submitted image
+  uint64_t output_seq = 0;   // seq of the next output
+  bool eos_submitted = false;
+  struct Done {
+    bool completed = false;
+    bool eos = false;
+    std::shared_ptr<CNFrameInfo> data;
+  };
+  // the images from output_seq on, indexed by seq - output_seq. The images in flight are bounded by the queue, a dense
+  // window is cheaper than a map keyed by seq.
+  std::deque<Done> done;
+};
+
+/**
+ * A lane owns one decoder. The decoded frames are matched to the jobs by pts, the lane replaces the pts of the images
+ * by its own job ids.
+ */
+class JpegDecodeEngine::Lane : public IDecodeResult {
+ public:
+  explicit Lane(JpegDecodeEngine *engine) : engine_(engine) {}
+  void Start() { thread_ = std::thread(&Lane::Run, this); }
+  void Join() {
+    if (thread_.joinable()) thread_.join();
+  }
+
+  // IDecodeResult methods
+  void OnDecodeError(DecodeErrorCode error_code) override {
+    // the decoder skips corrupt data and goes on
+    if (DecodeErrorCode::ERROR_CORRUPT_DATA != error_code) broken_ = true;
+  }
+  void OnDecodeFrame(DecodeFrame *frame) override {
+    if (!frame) return;
+    Job job;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      auto it = in_flight_.find(frame->pts);
+      // a broken image may be reported without pts while it is being fed
+      if (it == in_flight_.end() && !frame->valid) it = in_flight_.find(feeding_id_);
+      if (it == in_flight_.end()) return;
+      job = std::move(it->second.first);
+      in_flight_.erase(it);
+    }
+    cond_.notify_all();
+    std::shared_ptr<CNFrameInfo> data = job.stream->result->OnJpegDecoded(frame, job.pts, job.seq);
+    engine_->Complete(job.stream, job.seq, data);
+  }
+  void OnDecodeEos() override {}
+
+ private:
+  static constexpr std::chrono::seconds kJobTimeout{3};
+
+  bool CreateDecoder() {
+    decoder_ = engine_->creator_(this);
+    broken_ = false;
+    if (!decoder_) {
+      LOGE(SOURCE) << "[JpegDecodeEngine] Failed to create decoder";
+      return false;
+    }
+    return true;
+  }
+
+  void DestroyDecoder() {
+    if (decoder_) {
+      // flushes the images being decoded
+      decoder_->Destroy();
+      decoder_.reset();
+    }
+    FailJobs(true);
+  }
+
+  // drops the jobs which are lost by the decoder, or all of them
+  void FailJobs(bool all) {
+    std::vector<Job> failed;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      auto now = std::chrono::steady_clock::now();
+      for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+        if (all || now - it->second.second > kJobTimeout) {
+          failed.push_back(std::move(it->second.first));
+          it = in_flight_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    cond_.notify_all();
+    for (auto &job : failed) {
+      LOGW(SOURCE) << "[JpegDecodeEngine] Image " << job.seq << " (pts " << job.pts << ") is not decoded, dropped";
+      engine_->Complete(job.stream, job.seq, nullptr);
+    }
+  }
+
+  void Feed(Job &&job) {
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      // the decoder is fed batch_size images at most at a time
+      while (in_flight_.size() >= engine_->batch_size_ && !broken_ && engine_->running_) {
+        if (!cond_.wait_for(lk, std::chrono::milliseconds(100),
+                            [this] { return in_flight_.size() < engine_->batch_size_; })) {
+          lk.unlock();
+          FailJobs(false);
+          lk.lock();
+        }
+      }
+    }
+    if (broken_ || !decoder_ || !engine_->running_) {
+      engine_->Complete(job.stream, job.seq, nullptr);
+      return;
+    }
+    const int64_t id = next_id_++;
+    VideoEsPacket pkt;
+    pkt.data = job.data.data();
+    pkt.len = job.data.size();
+    pkt.pts = id;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      feeding_id_ = id;
+      in_flight_.emplace(id, std::make_pair(std::move(job), std::chrono::steady_clock::now()));
+    }
+    bool ret = decoder_->Process(&pkt);
+    Job failed;
+    bool lost = false;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      feeding_id_ = -1;
+      auto it = in_flight_.find(id);
+      if (!ret && it != in_flight_.end()) {
+        failed = std::move(it->second.first);
+        in_flight_.erase(it);
+        lost = true;
+      }
+    }
+    if (lost) engine_->Complete(failed.stream, failed.seq, nullptr);
+  }
+
+  void Run() {
+    std::shared_ptr<void> thread_ctx = engine_->init_func_ ? engine_->init_func_() : nullptr;
+    CreateDecoder();
+    while (engine_->running_) {
+      std::vector<Job> batch = engine_->PopBatch(std::chrono::milliseconds(100));
+      for (auto &job : batch) Feed(std::move(job));
+      FailJobs(false);
+      if (broken_ || !decoder_) {
+        LOGW(SOURCE) << "[JpegDecodeEngine] Decoder error, recreate decoder";
+        DestroyDecoder();
+        CreateDecoder();
+        if (!decoder_) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+    }
+    DestroyDecoder();
+  }
+
+  JpegDecodeEngine *engine_;
+  std::thread thread_;
+  std::shared_ptr<Decoder> decoder_ = nullptr;
+  std::atomic<bool> broken_{false};
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int64_t next_id_ = 0;
+  int64_t feeding_id_ = -1;
+  std::map<int64_t, std::pair<Job, std::chrono::steady_clock::time_point>> in_flight_;
+};  // class JpegDecodeEngine::Lane
+
+constexpr std::chrono::seconds JpegDecodeEngine::Lane::kJobTimeout;
+
+JpegDecodeEngine::JpegDecodeEngine(uint32_t lane_num, uint32_t batch_size, DecoderCreator creator,
+                                   ThreadInitFunc init_func)
+    : lane_num_(lane_num), batch_size_(batch_size ? batch_size : 1), creator_(creator), init_func_(init_func) {
+  queue_capacity_ = static_cast<size_t>(lane_num_) * batch_size_ * 2;
+}
+
+JpegDecodeEngine::~JpegDecodeEngine() { Stop(); }
+
+bool JpegDecodeEngine::Start() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (running_ || lane_num_ == 0 || !creator_) return false;
+  running_ = true;
+  batch_num_ = image_num_ = 0;
+  for (uint32_t i = 0; i < lane_num_; ++i) {
+    lanes_.emplace_back(new Lane(this));
+    lanes_.back()->Start();
+  }
+  return true;
+}
+
+void JpegDecodeEngine::Stop() {
+  std::deque<Job> dropped;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!running_) return;
+    running_ = false;
+    dropped.swap(queue_);
+  }
+  not_empty_.notify_all();
+  not_full_.notify_all();
+  for (auto &lane : lanes_) lane->Join();
+  lanes_.clear();
+  for (auto &job : dropped) Complete(job.stream, job.seq, nullptr);
+  if (batch_num_) {
+    LOGI(SOURCE) << "[JpegDecodeEngine] Decoded " << image_num_ << " images in " << batch_num_ << " batches, "
+                 << static_cast<double>(image_num_) / batch_num_ << " images per batch";
+  }
+}
+
+std::shared_ptr<JpegDecodeEngine::Stream> JpegDecodeEngine::Attach(IJpegDecodeResult *result) {
+  if (!result) return nullptr;
+  return std::make_shared<Stream>(result);
+}
+
+void JpegDecodeEngine::Detach(const std::shared_ptr<Stream> &stream) {
+  if (!stream) return;
+  std::unique_lock<std::mutex> lk(stream->mutex);
+  stream->cond.wait(lk, [&stream] { return stream->output_seq == stream->submit_seq; });
+}
+
+bool JpegDecodeEngine::Submit(const std::shared_ptr<Stream> &stream, const uint8_t *data, size_t len, int64_t pts) {
+  if (!stream || !data || !len) return false;
+  Job job;
+  job.stream = stream;
+  job.pts = pts;
+  job.data.assign(data, data + len);
+  std::unique_lock<std::mutex> lk(mutex_);
+  not_full_.wait(lk, [this] { return queue_.size() < queue_capacity_ || !running_; });
+  if (!running_) return false;
+  {
+    std::lock_guard<std::mutex> stream_lk(stream->mutex);
+    if (stream->eos_submitted) return false;
+    job.seq = stream->submit_seq++;
+  }
+  queue_.push_back(std::move(job));
+  lk.unlock();
+  not_empty_.notify_one();
+  return true;
+}
+
+size_t JpegDecodeEngine::SubmitBatch(const std::shared_ptr<Stream> &stream, const std::vector<Image> &images) {
+  if (!stream) return 0;
+  std::vector<Job> jobs;
+  jobs.reserve(images.size());
+  for (const Image &image : images) {
+    if (!image.data || !image.len) break;
+    Job job;
+    job.stream = stream;
+    job.pts = image.pts;
+    job.data.assign(image.data, image.data + image.len);
+    jobs.push_back(std::move(job));
+  }
+  size_t submitted = 0;
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (submitted < jobs.size()) {
+    not_full_.wait(lk, [this] { return queue_.size() < queue_capacity_ || !running_; });
+    if (!running_) break;
+    {
+      std::lock_guard<std::mutex> stream_lk(stream->mutex);
+      if (stream->eos_submitted) break;
+      while (submitted < jobs.size() && queue_.size() < queue_capacity_) {
+        jobs[submitted].seq = stream->submit_seq++;
+        queue_.push_back(std::move(jobs[submitted++]));
+      }
+    }
+    not_empty_.notify_all();
+  }
+  return submitted;
+}
+
+bool JpegDecodeEngine::SubmitEos(const std::shared_ptr<Stream> &stream) {
+  if (!stream) return false;
+  uint64_t seq;
+  {
+    std::lock_guard<std::mutex> lk(stream->mutex);
+    if (stream->eos_submitted) return false;
+    stream->eos_submitted = true;
+    seq = stream->submit_seq++;
+  }
+  Complete(stream, seq, nullptr, true);
+  return true;
+}
+
+std::vector<JpegDecodeEngine::Job> JpegDecodeEngine::PopBatch(std::chrono::milliseconds timeout) {
+  std::vector<Job> batch;
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (!not_empty_.wait_for(lk, timeout, [this] { return !queue_.empty() || !running_; }) || !running_) {
+    return batch;
+  }
+  while (!queue_.empty() && batch.size() < batch_size_) {
+    batch.push_back(std::move(queue_.front()));
+    queue_.pop_front();
+  }
+  batch_num_++;
+  image_num_ += batch.size();
+  lk.unlock();
+  not_full_.notify_all();
+  return batch;
+}
+
+void JpegDecodeEngine::Complete(const std::shared_ptr<Stream> &stream, uint64_t seq,
+                                std::shared_ptr<CNFrameInfo> data, bool eos) {
+  std::lock_guard<std::mutex> lk(stream->mutex);
+  const size_t index = seq - stream->output_seq;
+  if (index >= stream->done.size()) stream->done.resize(index + 1);
+  Stream::Done &done = stream->done[index];
+  done.completed = true;
+  done.eos = eos;
+  done.data = std::move(data);
+  // the outputs of one stream are serialized by its mutex, the images completed in a burst are output together
+  std::vector<std::shared_ptr<CNFrameInfo>> outputs;
+  while (!stream->done.empty() && stream->done.front().completed) {
+    Stream::Done out = std::move(stream->done.front());
+    stream->done.pop_front();
+    if (out.eos) {
+      if (!outputs.empty()) stream->result->OnJpegOutputs(outputs);
+      outputs.clear();
+      stream->result->OnJpegEos();
+    } else if (out.data) {
+      outputs.push_back(std::move(out.data));
+    }
+    stream->output_seq++;
+  }
+  if (!outputs.empty()) stream->result->OnJpegOutputs(outputs);
+  stream->cond.notify_all();
+}
+
+}  // namespace cnstream
@@ -0,0 +1,185 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_JPEG_DECODE_ENGINE_HPP_
+#define CNSTREAM_JPEG_DECODE_ENGINE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "util/video_decoder.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief IJpegDecodeResult receives the images of one stream decoded by JpegDecodeEngine.
+ */
+class IJpegDecodeResult {
+ public:
+  virtual ~IJpegDecodeResult() = default;
+  /**
+   * @brief Called on a decoder thread as soon as an image is decoded. The images of one stream are decoded by
+   * several decoders, they may be out of order here.
+   *
+   * @param[in] frame The decoded image, ``frame->valid`` is false if the image is broken.
+   * @param[in] pts The pts of the image passed to JpegDecodeEngine::Submit.
+   * @param[in] seq The index of the image in its stream, starting from 0.
+   *
+   * @return Returns the data to be output, nullptr to drop the image.
+   */
+  virtual std::shared_ptr<CNFrameInfo> OnJpegDecoded(DecodeFrame *frame, int64_t pts, uint64_t seq) = 0;
+  /**
+   * @brief Called in submission order with the data returned by OnJpegDecoded. Images lost by decoders are skipped.
+   */
+  virtual void OnJpegOutput(std::shared_ptr<CNFrameInfo> data) = 0;
+  /**
+   * @brief Called instead of OnJpegOutput with the data of the images completed together, e.g. a burst of images
+   * decoded by the lanes, in submission order. Calls OnJpegOutput for each by default.
+   */
+  virtual void OnJpegOutputs(const std::vector<std::shared_ptr<CNFrameInfo>> &data) {
+    for (const auto &it : data) OnJpegOutput(it);
+  }
+  /**
+   * @brief Called after the outputs of all the images submitted before JpegDecodeEngine::SubmitEos.
+   */
+  virtual void OnJpegEos() = 0;
+};
+
+/**
+ * @brief JpegDecodeEngine decodes the jpeg images of many streams with a few shared decoders.
+ *
+ * The images are put into one submission queue. Each decoder (lane) takes up to ``batch_size`` images at once,
+ * whatever streams they come from, and feeds them to its codec back to back, so the codec is kept busy by small
+ * images. The outputs are reordered per stream as the images of one stream are decoded by several lanes.
+ */
+class JpegDecodeEngine {
+ public:
+  /**
+   * @brief Creates the decoder of a lane, it is called on the lane thread.
+   *
+   * @param[in] result The lane, which receives the decoded frames.
+   *
+   * @return Returns the created decoder, nullptr on failure.
+   */
+  using DecoderCreator = std::function<std::shared_ptr<Decoder>(IDecodeResult *result)>;
+  /**
+   * @brief Called once by each lane thread before creating its decoder. The returned object lives as long as the
+   * thread, e.g. a device guard.
+   */
+  using ThreadInitFunc = std::function<std::shared_ptr<void>()>;
+  struct Stream;
+  /**
+   * @brief An image of JpegDecodeEngine::SubmitBatch.
+   */
+  struct Image {
+    const uint8_t *data = nullptr;
+    size_t len = 0;
+    int64_t pts = 0;
+  };
+
+  JpegDecodeEngine(uint32_t lane_num, uint32_t batch_size, DecoderCreator creator,
+                   ThreadInitFunc init_func = nullptr);
+  ~JpegDecodeEngine();
+
+  bool Start();
+  /**
+   * @brief Stops the lanes. The images which are not decoded yet are dropped, the outputs of the decoded ones and
+   * the eos of the streams are still delivered.
+   */
+  void Stop();
+  bool IsRunning() const { return running_; }
+
+  /**
+   * @brief Adds a stream, the returned handle is used to submit its images.
+   */
+  std::shared_ptr<Stream> Attach(IJpegDecodeResult *result);
+  /**
+   * @brief Blocks until all the submitted images of the stream are output. The result is not called afterwards.
+   */
+  void Detach(const std::shared_ptr<Stream> &stream);
+  /**
+   * @brief Submits one image, the data is copied. It blocks while the submission queue is full.
+   *
+   * @return Returns false if the engine is not running.
+   */
+  bool Submit(const std::shared_ptr<Stream> &stream, const uint8_t *data, size_t len, int64_t pts);
+  /**
+   * @brief Submits the images of a stream, the data is copied. The images are queued under one lock as long as the
+   * queue has room, so that the lanes take them in full batches. It blocks while the submission queue is full.
+   *
+   * @return Returns the number of images submitted from the front. It is less than ``images.size()`` if the engine
+   * is not running, the eos has been submitted or an image is empty.
+   */
+  size_t SubmitBatch(const std::shared_ptr<Stream> &stream, const std::vector<Image> &images);
+  /**
+   * @brief Ends the stream, IJpegDecodeResult::OnJpegEos is called after the outputs of the submitted images.
+   *
+   * @return Returns false if the eos has been submitted.
+   */
+  bool SubmitEos(const std::shared_ptr<Stream> &stream);
+
+  uint32_t GetLaneNum() const { return lane_num_; }
+  uint32_t GetBatchSize() const { return batch_size_; }
+
+ private:
+  struct Job {
+    std::shared_ptr<Stream> stream;
+    uint64_t seq = 0;
+    int64_t pts = 0;
+    std::vector<uint8_t> data;
+  };
+  class Lane;
+  JpegDecodeEngine(const JpegDecodeEngine &) = delete;
+  JpegDecodeEngine &operator=(const JpegDecodeEngine &) = delete;
+
+  // pops up to batch_size_ jobs, returns an empty batch on timeout or when stopped
+  std::vector<Job> PopBatch(std::chrono::milliseconds timeout);
+  // the image seq of stream is done, outputs the images which are in order
+  void Complete(const std::shared_ptr<Stream> &stream, uint64_t seq, std::shared_ptr<CNFrameInfo> data,
+                bool eos = false);
+
+  uint32_t lane_num_;
+  uint32_t batch_size_;
+  size_t queue_capacity_;
+  DecoderCreator creator_;
+  ThreadInitFunc init_func_;
+  std::atomic<bool> running_{false};
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<Job> queue_;
+  std::vector<std::unique_ptr<Lane>> lanes_;
+  uint64_t batch_num_ = 0;
+  uint64_t image_num_ = 0;
+};  // class JpegDecodeEngine
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_JPEG_DECODE_ENGINE_HPP_
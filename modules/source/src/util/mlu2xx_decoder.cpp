@@ -201,6 +201,7 @@ void Mlu2xxDecoder::Destroy() {
       }
     }
   }
+  ReleaseOutputBuffers();
   LOGI(SOURCE) << "[" << stream_id_ << "]: Finish destroy decoder";
 }
 
@@ -433,6 +434,7 @@ void Mlu2xxDecoder::SequenceCallback(cnvideoDecSequenceInfo *pFormat) {
     }
     return;
   }
+  ChargeOutputBuffers(extra_.memory_owner, create_info_.outputBufNum, create_info_.width, create_info_.height);
   // LOGI(SOURCE) << " cnvideoDecStart called done, " << instance_  << "\n";
 }
 
@@ -441,6 +443,7 @@ void Mlu2xxDecoder::CorruptCallback(const cnvideoDecStreamCorruptInfo &streamcor
                << "Skip frame number: " << streamcorruptinfo.frameNumber
                << ", frame count: " << streamcorruptinfo.frameCount
                << ", " << instance_;
+  if (result_) result_->OnDecodeError(DecodeErrorCode::ERROR_CORRUPT_DATA);
   #define CORRUPT_PTS_CNCODEC_VERSION 10800
   #if CNCODEC_VERSION >= CORRUPT_PTS_CNCODEC_VERSION
     GetVpuTimestamp(streamcorruptinfo.pts, nullptr);
@@ -585,6 +588,11 @@ bool Mlu2xxDecoder::CreateVideoDecoder(VideoInfo *info, ExtraDecoderInfo *extra)
   // LOGI(SOURCE) << this << " cnvideoDecCreate called Done, " << &create_info_
   //              << ", instance = " << instance_ << "\n";
 
+  if (extra && extra->output_width > 0 && extra->output_height > 0) {
+    LOGW(SOURCE) << "[" << stream_id_ << "]: "
+                 << "The codec of MLU200 can not scale frames, output_resolution is ignored.";
+  }
+
   int stride_align = 1;
   if (extra && extra->apply_stride_align_for_scaler) {
     stride_align = 128;  // YUV420SP_STRIDE_ALIGN_FOR_SCALER;
@@ -811,6 +819,8 @@ bool Mlu2xxDecoder::CreateJpegDecoder(VideoInfo *info, ExtraDecoderInfo *extra)
                  << "Call cnjpegDecCreate failed, ret = " << ret;
     return false;
   }
+  ChargeOutputBuffers(extra ? extra->memory_owner : MemoryOwner(), create_jpg_info_.outputBufNum,
+                      create_jpg_info_.width, create_jpg_info_.height);
   return true;
 }
 
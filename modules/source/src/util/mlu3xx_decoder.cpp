@@ -20,14 +20,20 @@
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "cnstream_common.hpp"
 #include "cnstream_logging.hpp"
+#include "private/cnstream_allocator.hpp"
 #include "video_decoder.hpp"
 
 
@@ -38,6 +44,45 @@
 
 namespace cnstream {
 
+class Mlu3xxDecoder;
+
+// the user context of the codec callbacks, it is set when the instance is taken by a decoder
+using Mlu3xxCodecOwner = std::atomic<Mlu3xxDecoder *>;
+
+struct Mlu3xxCodecInstance {
+  cncodecHandle_t handle = 0;
+  std::unique_ptr<Mlu3xxCodecOwner> owner;
+};
+
+/**
+ * Spare codec instances created in background, so that a decoder reset does not wait for cncodecDecCreate.
+ * The output buffers are allocated by cncodecDecSetParams, a spare instance only takes a codec channel.
+ */
+class Mlu3xxInstancePool {
+ public:
+  static Mlu3xxInstancePool &Instance() {
+    // never destroyed, the spares are released with the process
+    static Mlu3xxInstancePool *pool = new Mlu3xxInstancePool;
+    return *pool;
+  }
+  // takes a spare instance or creates one, a new spare is created in background if replenish is true
+  bool Take(const cncodecDecCreateInfo_t &create_info, Mlu3xxDecoder *decoder, bool replenish,
+            Mlu3xxCodecInstance *instance);
+
+ private:
+  Mlu3xxInstancePool() = default;
+  using Key = std::pair<int, int>;  // device id and codec type
+  static bool Create(const cncodecDecCreateInfo_t &create_info, Mlu3xxCodecInstance *instance);
+  void Loop();
+
+  static constexpr size_t kMaxSpares = 1;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::map<Key, std::vector<Mlu3xxCodecInstance>> spares_;
+  std::deque<cncodecDecCreateInfo_t> requests_;
+  std::thread thread_;
+};  // class Mlu3xxInstancePool
+
 class Mlu3xxDecoder : public Decoder {
  public:
   explicit Mlu3xxDecoder(const std::string& stream_id, IDecodeResult *cb) : Decoder(stream_id, cb) {}
@@ -77,6 +122,10 @@ class Mlu3xxDecoder : public Decoder {
   };  // class CNDeallocator
   void ResetFlags();
   bool SetDecParams();
+  bool Send(VideoEsPacket *pkt);
+  // replaces the codec instance when a new sequence does not fit the output buffers
+  bool Reset();
+  void DestroyInstance();
 
  private:
   std::atomic<int> cndec_buf_ref_count_{0};
@@ -84,6 +133,12 @@ class Mlu3xxDecoder : public Decoder {
   std::atomic<bool> timeout_{false};
   std::atomic<bool> error_flag_{false};
   std::atomic<bool> created_{false};
+  // the packets are dropped until the next key frame after the stream is corrupt
+  std::atomic<bool> wait_key_frame_{false};
+  std::atomic<bool> reset_pending_{false};
+  std::vector<uint8_t> key_frame_;  // the last key frame, sent again to a new instance
+  int64_t key_frame_pts_ = 0;
+  std::unique_ptr<Mlu3xxCodecOwner> owner_;
   std::unique_ptr<std::promise<void>> eos_promise_;
   cncodecDecCreateInfo_t create_info_;
   cncodecDecParams_t codec_params_;
@@ -94,7 +149,8 @@ class Mlu3xxDecoder : public Decoder {
 
 static
 i32_t Mlu3xxEventCallback(cncodecEventType_t type, void *ctx, void *output) {
-  auto decoder = reinterpret_cast<Mlu3xxDecoder*>(ctx);
+  auto decoder = reinterpret_cast<Mlu3xxCodecOwner*>(ctx)->load();
+  if (!decoder) return 0;  // a spare instance
   switch (type) {
     case CNCODEC_EVENT_NEW_FRAME:
       decoder->ReceiveFrame(reinterpret_cast<cncodecFrame_t*>(output));
@@ -145,17 +201,18 @@ bool Mlu3xxDecoder::Create(VideoInfo *info, ExtraDecoderInfo *extra) {
     }
   }
   create_info_.stream_buf_size = 4 << 20;  // FIXME
-  create_info_.user_context    = this;
   extra_info_ = *extra;
 
   ResetFlags();
 
-  int codec_ret = cncodecDecCreate(&instance_, &Mlu3xxEventCallback, &create_info_);
-  if (CNCODEC_SUCCESS != codec_ret) {
-    LOGE(SOURCE) << "[" << stream_id_ << "]: "
-                 << "Call cncodecDecCreate failed, ret = " << codec_ret;
+  Mlu3xxCodecInstance instance;
+  if (!Mlu3xxInstancePool::Instance().Take(create_info_, this, false, &instance)) {
     return false;
   }
+  instance_ = instance.handle;
+  owner_ = std::move(instance.owner);
+  receive_seq_time_ = 0;
+  key_frame_.clear();
 
   created_ = true;
 
@@ -177,6 +234,14 @@ bool Mlu3xxDecoder::Create(VideoInfo *info, ExtraDecoderInfo *extra) {
     }
     codec_params_.stride_align = 1;
     codec_params_.dec_mode = CNCODEC_DEC_MODE_IPB;
+    if (extra_info_.output_width > 0 && extra_info_.output_height > 0) {
+      // frames are scaled by the codec post processor, the output buffers are in the scaled resolution.
+      codec_params_.pp_attr.scale.width = extra_info_.output_width;
+      codec_params_.pp_attr.scale.height = extra_info_.output_height;
+      LOGI(SOURCE) << "[" << stream_id_ << "]: "
+                   << "Decoded frames are scaled to " << extra_info_.output_width << " x "
+                   << extra_info_.output_height;
+    }
   }
 
   return true;
@@ -196,16 +261,52 @@ void Mlu3xxDecoder::Destroy() {
   /**
    * make sure all cndec buffers released before destorying cndecoder
    */
+  DestroyInstance();
+  ResetFlags();
+}
+
+void Mlu3xxDecoder::DestroyInstance() {
   while (cndec_buf_ref_count_) {
     std::this_thread::yield();
   }
-  int codec_ret = cncodecDecDestroy(instance_);
-  if (CNCODEC_SUCCESS != codec_ret) {
-    LOGF(SOURCE) << "[" << stream_id_ << "]: "
-                 << "Call cncodecDecDestroy failed, ret = " << codec_ret;
+  if (instance_) {
+    int codec_ret = cncodecDecDestroy(instance_);
+    if (CNCODEC_SUCCESS != codec_ret) {
+      LOGF(SOURCE) << "[" << stream_id_ << "]: "
+                   << "Call cncodecDecDestroy failed, ret = " << codec_ret;
+    }
   }
   instance_ = 0;  // FIXME(lmx): INVALID HANDLE?
-  ResetFlags();
+  owner_.reset();
+  ReleaseOutputBuffers();
+}
+
+bool Mlu3xxDecoder::Reset() {
+  LOGI(SOURCE) << "[" << stream_id_ << "]: Replace the codec instance for the new sequence, max width x max height : "
+               << codec_params_.max_width << " x " << codec_params_.max_height << ", output buffer number "
+               << codec_params_.output_buf_num;
+  DestroyInstance();
+  Mlu3xxCodecInstance instance;
+  if (!Mlu3xxInstancePool::Instance().Take(create_info_, this, true, &instance)) {
+    error_flag_ = true;
+    if (result_) result_->OnDecodeError(DecodeErrorCode::ERROR_ABORT);
+    return false;
+  }
+  instance_ = instance.handle;
+  owner_ = std::move(instance.owner);
+  // the parameters enlarged for the new sequence are set when it is received again
+  receive_seq_time_ = 0;
+  reset_pending_ = false;
+  if (key_frame_.empty()) {
+    wait_key_frame_ = true;
+    return true;
+  }
+  VideoEsPacket pkt;
+  pkt.data = key_frame_.data();
+  pkt.len = key_frame_.size();
+  pkt.pts = key_frame_pts_;
+  pkt.flags = VideoEsPacket::FLAG_KEY_FRAME;
+  return Send(&pkt);
 }
 
 bool Mlu3xxDecoder::Process(VideoEsPacket *pkt) {
@@ -222,51 +323,69 @@ bool Mlu3xxDecoder::Process(VideoEsPacket *pkt) {
     }
   } else {
     if (eos_sent_) {
-      LOGW(SOURCE) << "[" << stream_id_ << "]: "
-                   << "EOS has been sent yet, process packet failed, pts:" << pkt->pts;
+      LOGW_EVERY_T(SOURCE, 1) << "[" << stream_id_ << "]: "
+                              << "EOS has been sent yet, process packet failed, pts:" << pkt->pts;
       return false;
     }
     if (error_flag_) {
-      LOGW(SOURCE) << "[" << stream_id_ << "]: "
-                   << "Error occurred in decoder, process packet failed, pts:" << pkt->pts;
+      LOGW_EVERY_T(SOURCE, 1) << "[" << stream_id_ << "]: "
+                              << "Error occurred in decoder, process packet failed, pts:" << pkt->pts;
       return false;
     }
-    cncodecStream_t codec_input;
-    memset(&codec_input, 0, sizeof(codec_input));
-    codec_input.mem_type = CNCODEC_MEM_TYPE_HOST;
-    codec_input.mem_addr = reinterpret_cast<u64_t>(pkt->data);
-    codec_input.data_len = pkt->len;
-    codec_input.pts = pkt->pts;
-    int max_try_send_time = 3;
-    while (max_try_send_time--) {
-      int codec_ret = cncodecDecSendStream(instance_, &codec_input, 10000);
-      switch (codec_ret) {
-        case CNCODEC_SUCCESS: return true;
-        case CNCODEC_ERROR_BAD_STREAM: {
-          // parse jpeg stream failed.
-          DecodeFrame cn_frame;
-          cn_frame.valid  = false;
-          result_->OnDecodeFrame(&cn_frame);
-          return true;
-        }
-        case CNCODEC_ERROR_TIMEOUT:
-          LOGW(SOURCE) << "[" << stream_id_ << "]: "
-                       << "cncodecDecSendStream timeout happened, retry feed data, time: "
-                       << 3 - max_try_send_time;
-          continue;
-        default:
-          LOGE(SOURCE) << "[" << stream_id_ << "]: "
-                       << "Call cncodecDecSendStream failed, ret = " << codec_ret;
-          return false;
-      }  // switch send stream ret
-    }  // while timeout
-    timeout_ = true;
-    return false;
+    const bool key_frame = pkt->flags & VideoEsPacket::FLAG_KEY_FRAME;
+    if (reset_pending_) {
+      // a key frame is sent to the new instance instead of the last one
+      if (key_frame) key_frame_.clear();
+      if (!Reset()) return false;
+    }
+    if (wait_key_frame_ && !key_frame) {
+      return true;  // dropped, the references are broken
+    }
+    wait_key_frame_ = false;
+    if (key_frame && CNCODEC_JPEG != create_info_.codec) {
+      key_frame_.assign(pkt->data, pkt->data + pkt->len);
+      key_frame_pts_ = pkt->pts;
+    }
+    return Send(pkt);
   }
 
   return true;
 }
 
+bool Mlu3xxDecoder::Send(VideoEsPacket *pkt) {
+  cncodecStream_t codec_input;
+  memset(&codec_input, 0, sizeof(codec_input));
+  codec_input.mem_type = CNCODEC_MEM_TYPE_HOST;
+  codec_input.mem_addr = reinterpret_cast<u64_t>(pkt->data);
+  codec_input.data_len = pkt->len;
+  codec_input.pts = pkt->pts;
+  int max_try_send_time = 3;
+  while (max_try_send_time--) {
+    int codec_ret = cncodecDecSendStream(instance_, &codec_input, 10000);
+    switch (codec_ret) {
+      case CNCODEC_SUCCESS: return true;
+      case CNCODEC_ERROR_BAD_STREAM: {
+        // parse jpeg stream failed.
+        DecodeFrame cn_frame;
+        cn_frame.valid  = false;
+        result_->OnDecodeFrame(&cn_frame);
+        return true;
+      }
+      case CNCODEC_ERROR_TIMEOUT:
+        LOGW_EVERY_T(SOURCE, 1) << "[" << stream_id_ << "]: "
+                                << "cncodecDecSendStream timeout happened, retry feed data, time: "
+                                << 3 - max_try_send_time;
+        continue;
+      default:
+        LOGE_EVERY_T(SOURCE, 1) << "[" << stream_id_ << "]: "
+                                << "Call cncodecDecSendStream failed, ret = " << codec_ret;
+        return false;
+    }  // switch send stream ret
+  }  // while timeout
+  timeout_ = true;
+  return false;
+}
+
 inline
 bool Mlu3xxDecoder::SetDecParams() {
   int codec_ret = cncodecDecSetParams(instance_, &codec_params_);
@@ -276,6 +395,13 @@ bool Mlu3xxDecoder::SetDecParams() {
     error_flag_ = true;
     return false;
   }
+  if (codec_params_.pp_attr.scale.width && codec_params_.pp_attr.scale.height) {
+    ChargeOutputBuffers(extra_info_.memory_owner, codec_params_.output_buf_num, codec_params_.pp_attr.scale.width,
+                        codec_params_.pp_attr.scale.height);
+  } else {
+    ChargeOutputBuffers(extra_info_.memory_owner, codec_params_.output_buf_num, codec_params_.max_width,
+                        codec_params_.max_height);
+  }
   return true;
 }
 
@@ -285,14 +411,17 @@ void Mlu3xxDecoder::ResetFlags() {
   timeout_  = false;
   error_flag_ = false;
   created_ = false;
+  wait_key_frame_ = false;
+  reset_pending_ = false;
 }
 
 void Mlu3xxDecoder::ReceiveFrame(cncodecFrame_t *codec_frame) {
   if (error_flag_) {
-    LOGW(SOURCE) << "[" << stream_id_ << "]: "
-                 << "Drop frame [pts:" << codec_frame->pts << "] because of error occurred in decoder.";
+    LOGW_EVERY_T(SOURCE, 1) << "[" << stream_id_ << "]: "
+                            << "Drop frame [pts:" << codec_frame->pts << "] because of error occurred in decoder.";
     return;
   }
+  if (reset_pending_) return;  // the instance is being replaced
 
   DecodeFrame cn_frame;
   cn_frame.valid  = true;
@@ -340,7 +469,7 @@ void Mlu3xxDecoder::ReceiveSequence(cncodecDecSequenceInfo_t *seq_info) {
     if (codec_params_.output_buf_num < seq_info->min_output_buf_num + 1 ||
         codec_params_.max_width < seq_info->coded_width ||
         codec_params_.max_height < seq_info->coded_height) {
-      LOGE(SOURCE) << "[" << stream_id_ << "]: "
+      LOGW(SOURCE) << "[" << stream_id_ << "]: "
                    << "Variable video resolutions, the preset parameters do not meet requirements."
                    << "max width[" << codec_params_.max_width << "], "
                    << "max height[" << codec_params_.max_height << "], "
@@ -349,9 +478,13 @@ void Mlu3xxDecoder::ReceiveSequence(cncodecDecSequenceInfo_t *seq_info) {
                    << "coded width[" << seq_info->coded_width << "], "
                    << "coded height[" << seq_info->coded_height << "], "
                    << "min output buffer number[" << seq_info->min_output_buf_num << "].";
-      error_flag_ = true;
-      if (result_) result_->OnDecodeError(DecodeErrorCode::ERROR_ABORT);
+      // the instance is replaced by the feeding thread, a codec instance can not be destroyed in its callbacks
+      codec_params_.max_width = std::max(codec_params_.max_width, seq_info->coded_width);
+      codec_params_.max_height = std::max(codec_params_.max_height, seq_info->coded_height);
+      codec_params_.output_buf_num = std::max(seq_info->min_output_buf_num + 1, codec_params_.output_buf_num);
+      reset_pending_ = true;
     }
+    // otherwise the output buffers allocated fit the new sequence and are reused
   } else {
     if (codec_params_.max_width && codec_params_.max_height) {
       LOGI(SOURCE) << "[" << stream_id_ << "]: "
@@ -381,8 +514,11 @@ void Mlu3xxDecoder::ReceiveEOS() {
 
 inline
 void Mlu3xxDecoder::HandleStreamCorrupt() {
-  LOGW(SOURCE) << "[" << stream_id_ << "]: "
-               << "Stream corrupt...";
+  LOGW_EVERY_T(SOURCE, 1) << "[" << stream_id_ << "]: "
+                          << "Stream corrupt...";
+  // the frames referring to the corrupt ones are broken too, the decoder starts again from the next key frame
+  if (CNCODEC_JPEG != create_info_.codec) wait_key_frame_ = true;
+  if (result_) result_->OnDecodeError(DecodeErrorCode::ERROR_CORRUPT_DATA);
 }
 
 inline
@@ -399,6 +535,63 @@ void Mlu3xxDecoder::HandleUnknownEvent(cncodecEventType_t type) {
                << "Unknown event, event type: " << static_cast<int>(type);
 }
 
+constexpr size_t Mlu3xxInstancePool::kMaxSpares;
+
+bool Mlu3xxInstancePool::Create(const cncodecDecCreateInfo_t &create_info, Mlu3xxCodecInstance *instance) {
+  cncodecDecCreateInfo_t info = create_info;
+  instance->owner.reset(new Mlu3xxCodecOwner(nullptr));
+  info.user_context = instance->owner.get();
+  int codec_ret = cncodecDecCreate(&instance->handle, &Mlu3xxEventCallback, &info);
+  if (CNCODEC_SUCCESS != codec_ret) {
+    LOGE(SOURCE) << "Call cncodecDecCreate failed, ret = " << codec_ret;
+    instance->owner.reset();
+    return false;
+  }
+  return true;
+}
+
+bool Mlu3xxInstancePool::Take(const cncodecDecCreateInfo_t &create_info, Mlu3xxDecoder *decoder, bool replenish,
+                              Mlu3xxCodecInstance *instance) {
+  const Key key(create_info.device_id, create_info.codec);
+  bool taken = false;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = spares_.find(key);
+    if (it != spares_.end() && !it->second.empty()) {
+      *instance = std::move(it->second.back());
+      it->second.pop_back();
+      taken = true;
+    }
+    if (replenish) {
+      requests_.push_back(create_info);
+      if (!thread_.joinable()) thread_ = std::thread(&Mlu3xxInstancePool::Loop, this);
+    }
+  }
+  if (replenish) cond_.notify_one();
+  if (!taken && !Create(create_info, instance)) return false;
+  // the callbacks of the instance go to the decoder from now on
+  instance->owner->store(decoder);
+  return true;
+}
+
+void Mlu3xxInstancePool::Loop() {
+  while (true) {
+    cncodecDecCreateInfo_t create_info;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      cond_.wait(lk, [this] { return !requests_.empty(); });
+      create_info = requests_.front();
+      requests_.pop_front();
+      if (spares_[Key(create_info.device_id, create_info.codec)].size() >= kMaxSpares) continue;
+    }
+    MluDeviceGuard guard(create_info.device_id);
+    Mlu3xxCodecInstance instance;
+    if (!Create(create_info, &instance)) continue;
+    std::lock_guard<std::mutex> lk(mutex_);
+    spares_[Key(create_info.device_id, create_info.codec)].push_back(std::move(instance));
+  }
+}
+
 Decoder* CreateMlu3xxDecoder(const std::string& stream_id, IDecodeResult *cb) {
   return new Mlu3xxDecoder(stream_id, cb);
 }
@@ -0,0 +1,240 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "packet_capture.hpp"
+
+#include <sys/types.h>
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+static const char kCaptureMagic[8] = {'C', 'N', 'C', 'A', 'P', '0', '0', '1'};
+static const char kIndexMagic[8] = {'C', 'N', 'C', 'A', 'P', 'I', 'D', 'X'};
+// arrival time, pts, flags and size
+static constexpr size_t kPacketHeaderSize = 8 + 8 + 4 + 4;
+// the offset of the index and the magic
+static constexpr size_t kTailSize = 8 + 8;
+
+bool PacketCaptureWriter::Open(const std::string &path) {
+  Close();
+  std::lock_guard<std::mutex> lk(mutex_);
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_) {
+    LOGE(SOURCE) << "[PacketCaptureWriter] Failed to open " << path;
+    return false;
+  }
+  path_ = path;
+  header_written_ = false;
+  failed_ = false;
+  offset_ = 0;
+  packet_num_ = 0;
+  index_.clear();
+  return true;
+}
+
+bool PacketCaptureWriter::WriteBytes(const void *data, size_t len) {
+  if (failed_) return false;
+  if (len && fwrite(data, 1, len, file_) != len) {
+    LOGE(SOURCE) << "[PacketCaptureWriter] Failed to write " << path_ << ", the capture stops.";
+    failed_ = true;
+    return false;
+  }
+  offset_ += len;
+  return true;
+}
+
+void PacketCaptureWriter::SetInfo(const VideoInfo &info) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (!file_ || header_written_) return;
+  const uint32_t codec_id = static_cast<uint32_t>(info.codec_id);
+  const uint32_t extra_size = static_cast<uint32_t>(info.extra_data.size());
+  WriteBytes(kCaptureMagic, sizeof(kCaptureMagic));
+  WriteBytes(&codec_id, sizeof(codec_id));
+  WriteBytes(&extra_size, sizeof(extra_size));
+  WriteBytes(info.extra_data.data(), extra_size);
+  header_written_ = true;
+}
+
+bool PacketCaptureWriter::Write(const uint8_t *data, size_t len, int64_t pts, bool key_frame) {
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (!file_ || !header_written_ || failed_ || !data || !len) return false;
+  if (!packet_num_) start_ = now;
+  const int64_t arrival_us = std::chrono::duration_cast<std::chrono::microseconds>(now - start_).count();
+  const uint32_t flags = key_frame ? VideoEsFrame::FLAG_KEY_FRAME : 0;
+  const uint32_t size = static_cast<uint32_t>(len);
+  if (key_frame) {
+    PacketCaptureIndexEntry entry;
+    entry.offset = offset_;
+    entry.arrival_us = arrival_us;
+    index_.push_back(entry);
+  }
+  if (!WriteBytes(&arrival_us, sizeof(arrival_us)) || !WriteBytes(&pts, sizeof(pts)) ||
+      !WriteBytes(&flags, sizeof(flags)) || !WriteBytes(&size, sizeof(size)) || !WriteBytes(data, len)) {
+    return false;
+  }
+  ++packet_num_;
+  return true;
+}
+
+void PacketCaptureWriter::Close() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (!file_) return;
+  if (header_written_) {
+    const uint64_t index_offset = offset_;
+    const uint32_t count = static_cast<uint32_t>(index_.size());
+    WriteBytes(&count, sizeof(count));
+    for (const auto &entry : index_) {
+      WriteBytes(&entry.offset, sizeof(entry.offset));
+      WriteBytes(&entry.arrival_us, sizeof(entry.arrival_us));
+    }
+    WriteBytes(&index_offset, sizeof(index_offset));
+    WriteBytes(kIndexMagic, sizeof(kIndexMagic));
+  }
+  fclose(file_);
+  file_ = nullptr;
+  LOGI(SOURCE) << "[PacketCaptureWriter] " << packet_num_ << " packets are captured into " << path_;
+}
+
+bool PacketCaptureReader::ReadAt(uint64_t offset, void *data, size_t len) {
+  if (fseeko(file_, static_cast<off_t>(offset), SEEK_SET) != 0) return false;
+  return fread(data, 1, len, file_) == len;
+}
+
+bool PacketCaptureReader::Open(const std::string &path) {
+  Close();
+  file_ = fopen(path.c_str(), "rb");
+  if (!file_) {
+    LOGE(SOURCE) << "[PacketCaptureReader] Failed to open " << path;
+    return false;
+  }
+  char magic[sizeof(kCaptureMagic)];
+  uint32_t codec_id = 0;
+  uint32_t extra_size = 0;
+  if (!ReadAt(0, magic, sizeof(magic)) || memcmp(magic, kCaptureMagic, sizeof(magic)) ||
+      fread(&codec_id, sizeof(codec_id), 1, file_) != 1 || fread(&extra_size, sizeof(extra_size), 1, file_) != 1) {
+    LOGE(SOURCE) << "[PacketCaptureReader] " << path << " is not a capture file";
+    Close();
+    return false;
+  }
+  extra_data_.resize(extra_size);
+  if (extra_size && fread(extra_data_.data(), 1, extra_size, file_) != extra_size) {
+    LOGE(SOURCE) << "[PacketCaptureReader] " << path << " is cut short";
+    Close();
+    return false;
+  }
+  codec_id_ = static_cast<AVCodecID>(codec_id);
+  data_start_ = sizeof(kCaptureMagic) + sizeof(codec_id) + sizeof(extra_size) + extra_size;
+  fseeko(file_, 0, SEEK_END);
+  const uint64_t file_size = static_cast<uint64_t>(ftello(file_));
+  if (!ReadIndex(file_size)) {
+    LOGW(SOURCE) << "[PacketCaptureReader] " << path << " was not closed, the index is rebuilt.";
+    data_end_ = file_size;
+    ScanIndex();
+  }
+  pos_ = data_start_;
+  return true;
+}
+
+void PacketCaptureReader::Close() {
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+  index_.clear();
+  extra_data_.clear();
+  data_start_ = data_end_ = pos_ = 0;
+}
+
+bool PacketCaptureReader::ReadIndex(uint64_t file_size) {
+  uint64_t index_offset = 0;
+  char magic[sizeof(kIndexMagic)];
+  uint32_t count = 0;
+  if (file_size < data_start_ + kTailSize + sizeof(count)) return false;
+  if (!ReadAt(file_size - kTailSize, &index_offset, sizeof(index_offset)) ||
+      fread(magic, 1, sizeof(magic), file_) != sizeof(magic) || memcmp(magic, kIndexMagic, sizeof(magic))) {
+    return false;
+  }
+  if (index_offset < data_start_ || index_offset + sizeof(count) > file_size - kTailSize ||
+      !ReadAt(index_offset, &count, sizeof(count)) ||
+      index_offset + sizeof(count) + count * (sizeof(uint64_t) + sizeof(int64_t)) != file_size - kTailSize) {
+    return false;
+  }
+  index_.resize(count);
+  for (auto &entry : index_) {
+    if (fread(&entry.offset, sizeof(entry.offset), 1, file_) != 1 ||
+        fread(&entry.arrival_us, sizeof(entry.arrival_us), 1, file_) != 1) {
+      index_.clear();
+      return false;
+    }
+  }
+  data_end_ = index_offset;
+  return true;
+}
+
+void PacketCaptureReader::ScanIndex() {
+  index_.clear();
+  uint64_t offset = data_start_;
+  uint8_t header[kPacketHeaderSize];
+  while (offset + kPacketHeaderSize <= data_end_ && ReadAt(offset, header, sizeof(header))) {
+    PacketCaptureIndexEntry entry;
+    uint32_t flags = 0;
+    uint32_t size = 0;
+    memcpy(&entry.arrival_us, header, 8);
+    memcpy(&flags, header + 16, 4);
+    memcpy(&size, header + 20, 4);
+    if (offset + kPacketHeaderSize + size > data_end_) break;
+    entry.offset = offset;
+    if (flags & VideoEsFrame::FLAG_KEY_FRAME) index_.push_back(entry);
+    offset += kPacketHeaderSize + size;
+  }
+  // the packet cut short is dropped
+  data_end_ = offset;
+}
+
+bool PacketCaptureReader::Read(CapturedPacket *pkt) {
+  if (!file_ || !pkt || pos_ + kPacketHeaderSize > data_end_) return false;
+  uint8_t header[kPacketHeaderSize];
+  if (!ReadAt(pos_, header, sizeof(header))) return false;
+  uint32_t size = 0;
+  memcpy(&pkt->arrival_us, header, 8);
+  memcpy(&pkt->pts, header + 8, 8);
+  memcpy(&pkt->flags, header + 16, 4);
+  memcpy(&size, header + 20, 4);
+  if (pos_ + kPacketHeaderSize + size > data_end_) return false;
+  pkt->data.resize(size);
+  if (size && fread(pkt->data.data(), 1, size, file_) != size) return false;
+  pos_ += kPacketHeaderSize + size;
+  return true;
+}
+
+bool PacketCaptureReader::Seek(size_t key_frame) {
+  if (key_frame >= index_.size()) return false;
+  pos_ = index_[key_frame].offset;
+  return true;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,127 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_PACKET_CAPTURE_HPP_
+#define CNSTREAM_PACKET_CAPTURE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "util/video_parser.hpp"
+
+namespace cnstream {
+
+/*
+ * The capture file of a stream, written by PacketCaptureWriter and read by PacketCaptureReader.
+ *
+ * All the numbers are in the byte order of the host, little endian on the supported platforms.
+ *   header: "CNCAP001", codec id (u32), extra data size (u32), extra data
+ *   packet: arrival time in microseconds since the first packet (i64), pts (i64), flags (u32), size (u32), data
+ *   index:  the number of key frames (u32), then the offset (u64) and arrival time (i64) of each key frame
+ *   tail:   the offset of the index (u64), "CNCAPIDX"
+ * The index and the tail are written when the capture is closed. A file cut short, e.g. the process was killed, is
+ * still read up to its last complete packet, the index is rebuilt by scanning the packets then.
+ */
+struct PacketCaptureIndexEntry {
+  uint64_t offset = 0;
+  int64_t arrival_us = 0;
+};
+
+struct CapturedPacket {
+  int64_t arrival_us = 0;
+  int64_t pts = 0;
+  uint32_t flags = 0;  // VideoEsFrame::FLAG_KEY_FRAME
+  std::vector<uint8_t> data;
+};
+
+/**
+ * @brief PacketCaptureWriter records the compressed packets of a stream with the time they arrive.
+ *
+ * It is thread-safe.
+ */
+class PacketCaptureWriter {
+ public:
+  ~PacketCaptureWriter() { Close(); }
+  bool Open(const std::string &path);
+  /* writes the header, only the first info is written. The packets before it are dropped */
+  void SetInfo(const VideoInfo &info);
+  /* the arrival time is taken when it is called */
+  bool Write(const uint8_t *data, size_t len, int64_t pts, bool key_frame);
+  /* writes the index */
+  void Close();
+  uint64_t GetPacketNum() const { return packet_num_; }
+
+ private:
+  bool WriteBytes(const void *data, size_t len);
+
+  std::mutex mutex_;
+  FILE *file_ = nullptr;
+  std::string path_;
+  bool header_written_ = false;
+  bool failed_ = false;
+  uint64_t offset_ = 0;
+  uint64_t packet_num_ = 0;
+  std::chrono::steady_clock::time_point start_;
+  std::vector<PacketCaptureIndexEntry> index_;
+};  // class PacketCaptureWriter
+
+/**
+ * @brief PacketCaptureReader reads the packets of a capture file in order.
+ *
+ * It is not thread-safe.
+ */
+class PacketCaptureReader {
+ public:
+  ~PacketCaptureReader() { Close(); }
+  /* reads the header and the index */
+  bool Open(const std::string &path);
+  void Close();
+  /* reads the next packet, returns false at the end of the capture */
+  bool Read(CapturedPacket *pkt);
+  /* moves to the first packet */
+  void Rewind() { pos_ = data_start_; }
+  /* moves to the i-th key frame of the index */
+  bool Seek(size_t key_frame);
+
+  AVCodecID GetCodecId() const { return codec_id_; }
+  const std::vector<uint8_t> &GetExtraData() const { return extra_data_; }
+  const std::vector<PacketCaptureIndexEntry> &GetIndex() const { return index_; }
+
+ private:
+  bool ReadAt(uint64_t offset, void *data, size_t len);
+  bool ReadIndex(uint64_t file_size);
+  void ScanIndex();
+
+  FILE *file_ = nullptr;
+  AVCodecID codec_id_ = AV_CODEC_ID_NONE;
+  std::vector<uint8_t> extra_data_;
+  std::vector<PacketCaptureIndexEntry> index_;
+  uint64_t data_start_ = 0;
+  uint64_t data_end_ = 0;
+  uint64_t pos_ = 0;
+};  // class PacketCaptureReader
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_PACKET_CAPTURE_HPP_
@@ -0,0 +1,167 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "packet_table.hpp"
+
+#include <sys/stat.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+namespace {
+
+class PacketTableLoader : public IParserResult {
+ public:
+  explicit PacketTableLoader(PacketTable *table) : table_(table) {}
+  void OnParserInfo(VideoInfo *info) override {
+    if (info) table_->info = *info;
+  }
+  void OnParserFrame(VideoEsFrame *frame) override {
+    if (!frame) return;
+    PacketTable::Entry entry;
+    entry.offset = table_->data.size();
+    entry.len = frame->len;
+    entry.pts = frame->pts;
+    entry.flags = frame->flags;
+    table_->data.insert(table_->data.end(), frame->data, frame->data + frame->len);
+    table_->packets.push_back(entry);
+  }
+
+ private:
+  PacketTable *table_;
+};  // class PacketTableLoader
+
+std::shared_ptr<const PacketTable> LoadPacketTable(const std::string &filename) {
+  std::shared_ptr<PacketTable> table = std::make_shared<PacketTable>();
+  PacketTableLoader loader(table.get());
+  FFParser parser("packet_table");
+  if (parser.Open(filename, &loader) < 0) {
+    LOGE(SOURCE) << "[PacketTable] Failed to open " << filename;
+    parser.Close();
+    return nullptr;
+  }
+  while (parser.Parse() >= 0) {}
+  parser.Close();
+  if (table->packets.empty()) {
+    LOGE(SOURCE) << "[PacketTable] No video packet found in " << filename;
+    return nullptr;
+  }
+  table->data.shrink_to_fit();
+  table->packets.shrink_to_fit();
+  LOGI(SOURCE) << "[PacketTable] Loaded " << filename << ", " << table->packets.size() << " packets, "
+               << table->data.size() << " bytes";
+  return table;
+}
+
+}  // namespace
+
+PacketTableCache &PacketTableCache::Instance() {
+  static PacketTableCache cache;
+  return cache;
+}
+
+std::shared_ptr<const PacketTable> PacketTableCache::Get(const std::string &filename) {
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return nullptr;
+
+  std::shared_ptr<Slot> slot;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (auto it = slots_.begin(); it != slots_.end();) {
+      // drops the slots of released tables, except the ones being loaded
+      if (it->second.use_count() == 1 && it->second->table.expired()) {
+        it = slots_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    std::shared_ptr<Slot> &s = slots_[filename];
+    if (!s) s = std::make_shared<Slot>();
+    slot = s;
+  }
+  // the other streams of the same file wait here until the table is loaded, other files are not blocked
+  std::lock_guard<std::mutex> lk(slot->mutex);
+  std::shared_ptr<const PacketTable> table = slot->table.lock();
+  if (!table) {
+    table = LoadPacketTable(filename);
+    slot->table = table;
+  }
+  return table;
+}
+
+int PacketTableParser::Open(std::shared_ptr<const PacketTable> table, IParserResult *result, bool only_key_frame,
+                            uint32_t gop_interval) {
+  if (!table || !result) return -1;
+  table_ = std::move(table);
+  result_ = result;
+  pos_ = 0;
+  eos_reached_ = false;
+  selector_ = GopSelector(only_key_frame, gop_interval);
+  VideoInfo info = table_->info;
+  result_->OnParserInfo(&info);
+  return 0;
+}
+
+void PacketTableParser::Close() {
+  table_.reset();
+  result_ = nullptr;
+  pos_ = 0;
+  eos_reached_ = false;
+}
+
+int PacketTableParser::Parse() {
+  if (eos_reached_ || !table_) return -1;
+  if (pos_ >= table_->packets.size()) {
+    result_->OnParserFrame(nullptr);
+    eos_reached_ = true;
+    return -1;
+  }
+  const PacketTable::Entry &entry = table_->packets[pos_++];
+  if (selector_.Keep(entry.flags & AV_PKT_FLAG_KEY)) {
+    VideoEsFrame frame;
+    // the decoders do not write the packets
+    frame.data = const_cast<uint8_t *>(table_->data.data() + entry.offset);
+    frame.len = entry.len;
+    frame.pts = entry.pts;
+    frame.flags = entry.flags;
+    result_->OnParserFrame(&frame);
+  }
+  return 0;
+}
+
+int PacketTableParser::Seek(int64_t pts) {
+  if (!table_) return -1;
+  size_t pos = 0;
+  for (size_t i = 0; i < table_->packets.size(); ++i) {
+    const PacketTable::Entry &entry = table_->packets[i];
+    if ((entry.flags & AV_PKT_FLAG_KEY) && entry.pts <= pts) pos = i;
+  }
+  pos_ = pos;
+  eos_reached_ = false;
+  return 0;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,103 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_PACKET_TABLE_HPP_
+#define CNSTREAM_PACKET_TABLE_HPP_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "util/gop_selector.hpp"
+#include "util/video_parser.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief PacketTable holds all the video packets of a local file, demuxed once by FFParser.
+ *
+ * The packets are stored in annex-b format one after another in one buffer, they are not changed after loading
+ * and are read by all the streams replaying the file at the same time.
+ */
+struct PacketTable {
+  struct Entry {
+    size_t offset = 0;
+    size_t len = 0;
+    int64_t pts = 0;
+    uint32_t flags = 0;
+  };
+  VideoInfo info;
+  std::vector<uint8_t> data;
+  std::vector<Entry> packets;
+};
+
+/**
+ * @brief PacketTableCache shares the packet tables between streams. A table is loaded when the first stream opens
+ * the file and is released when the last stream reading it has been closed.
+ */
+class PacketTableCache {
+ public:
+  static PacketTableCache &Instance();
+  /**
+   * @brief Gets the packet table of a local file, loads it if it is not cached.
+   *
+   * @return Returns nullptr if filename is not a regular file or it fails to be demuxed.
+   */
+  std::shared_ptr<const PacketTable> Get(const std::string &filename);
+
+ private:
+  PacketTableCache() = default;
+  struct Slot {
+    std::mutex mutex;
+    std::weak_ptr<const PacketTable> table;
+  };
+  std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<Slot>> slots_;
+};  // class PacketTableCache
+
+/**
+ * @brief PacketTableParser replays a packet table, the counterpart of FFParser for cached files.
+ *
+ * Rewinding for loops only moves the read position, nothing is read from the file again.
+ */
+class PacketTableParser {
+ public:
+  /* gop_interval: one of every gop_interval GOPs is sent to the result, see GopSelector */
+  int Open(std::shared_ptr<const PacketTable> table, IParserResult *result, bool only_key_frame = false,
+           uint32_t gop_interval = 1);
+  void Close();
+  /* sends the next packet to the result, returns -1 when eos is reached */
+  int Parse();
+  /* moves to the key frame at or before pts, see FFParser::Seek */
+  int Seek(int64_t pts);
+
+ private:
+  std::shared_ptr<const PacketTable> table_ = nullptr;
+  IParserResult *result_ = nullptr;
+  size_t pos_ = 0;
+  bool eos_reached_ = false;
+  GopSelector selector_;
+};  // class PacketTableParser
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_PACKET_TABLE_HPP_
@@ -19,9 +19,18 @@
  *************************************************************************/
 
 #include "rtsp_client.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+
+#include "cnstream_logging.hpp"
 
 #define HAVE_LIVE555 1
 
@@ -83,8 +92,6 @@ class StreamClientState {
 // separate "StreamClientState" structure for each "RTSPClient".  To do this, we subclass "RTSPClient", and add a
 // "StreamClientState" field to the subclass:
 
-static cnstream::Timer s_rtspTimer;
-
 class ourRTSPClient : public RTSPClient {
  public:
   static ourRTSPClient* createNew(UsageEnvironment& env, char const* rtspURL, int verbosityLevel = 0,
@@ -103,14 +110,19 @@ class ourRTSPClient : public RTSPClient {
   char* eventLoopWatchVariable = nullptr;
   StreamClientState scs;
   bool only_key_frame = false;
+  uint32_t gop_interval = 1;
 
   // Use a timer to check liveness
   //
   int livenessTimeoutMs = 2000;
-  cnstream::timer_id timer_id_;
+  cnstream::TimerWheel::TaskId timer_id_ = 0;
+  void stopLivenessTimer() {
+    cnstream::TimerWheel::Instance().Cancel(timer_id_);
+    timer_id_ = 0;
+  }
   void resetLivenessTimer() {
-    s_rtspTimer.remove(timer_id_);
-    timer_id_ = s_rtspTimer.add(std::chrono::milliseconds(livenessTimeoutMs), [&](cnstream::timer_id) {
+    stopLivenessTimer();
+    timer_id_ = cnstream::TimerWheel::Instance().Schedule(std::chrono::milliseconds(livenessTimeoutMs), [&]() {
       *eventLoopWatchVariable = 2;
       envir() << "Liveness timeout occurred, shutdown stream...\n";
     });
@@ -128,11 +140,12 @@ class DummySink : public MediaSink, public cnstream::IParserResult {
  public:
   static DummySink* createNew(UsageEnvironment& env,    // NOLINT
                               MediaSubsession& subsession,  // NOLINT identifies the kind of data that's being received
-                              char const* streamId = NULL,
-                              bool only_I = false);  // identifies the stream itself (optional)
+                              char const* streamId = NULL,  // identifies the stream itself (optional)
+                              bool only_I = false, uint32_t gop_interval = 1);
 
  private:
-  DummySink(UsageEnvironment& env, MediaSubsession& subsession, char const* streamId, bool only_I);  // NOLINT
+  DummySink(UsageEnvironment& env, MediaSubsession& subsession, char const* streamId, bool only_I,  // NOLINT
+            uint32_t gop_interval);
   // called only by "createNew()"
   virtual ~DummySink();
 
@@ -160,6 +173,7 @@ class DummySink : public MediaSink, public cnstream::IParserResult {
   uint64_t frameTimeStampBase = 0;
   bool firstFrame = true;
   bool only_key_frame = false;
+  uint32_t gop_interval = 1;
   cnstream::EsParser parser_;
 };
 
@@ -292,7 +306,8 @@ void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultStri
     // (This will prepare the data sink to receive data; the actual flow of data from the client won't start happening
     // until later, after we've sent a RTSP "PLAY" command.)
 
-    scs.subsession->sink = DummySink::createNew(env, *scs.subsession, rtspClient->url(), client->only_key_frame);
+    scs.subsession->sink = DummySink::createNew(env, *scs.subsession, rtspClient->url(), client->only_key_frame,
+                                                   client->gop_interval);
     // perhaps use your own custom "MediaSink" subclass instead
     if (scs.subsession->sink == NULL) {
       env << *rtspClient << "Failed to create a data sink for the \"" << *scs.subsession
@@ -437,6 +452,9 @@ void shutdownStream(RTSPClient* rtspClient, int exitCode) {
     }
   }
 
+  // stop the liveness timer first, it must not mark a closed stream as timed out
+  ((ourRTSPClient*)rtspClient)->stopLivenessTimer();
+
   // leave the LIVE555 event loop
   (*((ourRTSPClient*)rtspClient)->eventLoopWatchVariable) = 1;
 
@@ -459,7 +477,7 @@ ourRTSPClient::ourRTSPClient(UsageEnvironment& env, char const* rtspURL, int ver
 
 ourRTSPClient::~ourRTSPClient() {
   envir() << "ourRTSPClient::~ourRTSPClient() called\n";
-  s_rtspTimer.remove(timer_id_);
+  stopLivenessTimer();
 }
 
 // Implementation of "StreamClientState":
@@ -485,12 +503,13 @@ StreamClientState::~StreamClientState() {
 #define DUMMY_SINK_RECEIVE_BUFFER_SIZE (1024 * 1024)
 
 DummySink* DummySink::createNew(UsageEnvironment& env, MediaSubsession& subsession, char const* streamId,
-                                bool only_key_frame) {
-  return new (std::nothrow) DummySink(env, subsession, streamId, only_key_frame);
+                                bool only_key_frame, uint32_t gop_interval) {
+  return new (std::nothrow) DummySink(env, subsession, streamId, only_key_frame, gop_interval);
 }
 
-DummySink::DummySink(UsageEnvironment& env, MediaSubsession& subsession, char const* streamId, bool only_I)
-    : MediaSink(env), fSubsession(subsession), only_key_frame(only_I) {
+DummySink::DummySink(UsageEnvironment& env, MediaSubsession& subsession, char const* streamId, bool only_I,
+                     uint32_t gop_interval)
+    : MediaSink(env), fSubsession(subsession), only_key_frame(only_I), gop_interval(gop_interval) {
   fStreamId = strDup(streamId);
   fReceiveBuffer.reset(new u_int8_t[DUMMY_SINK_RECEIVE_BUFFER_SIZE + 4]);
 
@@ -543,7 +562,7 @@ DummySink::DummySink(UsageEnvironment& env, MediaSubsession& subsession, char co
   for (unsigned j = 0; j < num; j++) {
     if (records[j]) delete[] records[j];
   }
-  parser_.Open(codec_id, this, paramset.get(), paramset_size, only_key_frame);
+  parser_.Open(codec_id, this, paramset.get(), paramset_size, only_key_frame, gop_interval);
 }
 
 DummySink::~DummySink() {
@@ -637,6 +656,267 @@ Boolean DummySink::continuePlaying() {
 
 namespace cnstream {
 
+// A connection which has been up for a while is retried at once, so a dropped camera is back quickly. Connections
+// failing sooner are retried after the delay.
+static constexpr std::chrono::milliseconds kRtspReconnectDelay(1000);
+
+#ifdef HAVE_LIVE555
+static void InitRtspClient(RTSPClient* rtspClient, const OpenParam& param, char* watchVariable) {
+  ourRTSPClient* client = reinterpret_cast<ourRTSPClient*>(rtspClient);
+  client->eventLoopWatchVariable = watchVariable;
+  client->livenessTimeoutMs = param.livenessTimeoutMs;
+  client->streammingPreferTcp = param.streammingPreferTcp;
+  client->only_key_frame = param.only_key_frame;
+  client->gop_interval = param.gop_interval;
+  client->streammingOverTcp = true;
+  client->setupOk = false;
+  client->cb_ = param.cb;
+}
+
+/**
+ * A rtsp session attached to a shared event loop. Its live555 objects are only touched by the loop thread.
+ */
+struct RtspReactorSession {
+  OpenParam param;
+  RTSPClient* client = nullptr;
+  // 0: running, 1: the stream has been shut down, 2: the stream should be shut down (e.g. liveness timeout)
+  char watch_variable = 0;
+  int reconnect = 0;
+  std::chrono::steady_clock::time_point connect_time;
+  std::atomic<bool> close_requested{false};
+  bool finished = false;  // guarded by RtspReactorLoop::mutex_
+};
+
+/**
+ * One live555 event loop serving many rtsp sessions. Sessions are handed over by Add and Remove, a periodic task on
+ * the loop thread connects, shuts down and reconnects them, so no live555 call is made from other threads.
+ */
+class RtspReactorLoop {
+ public:
+  ~RtspReactorLoop() { Stop(); }
+
+  bool Start() {
+    scheduler_ = BasicTaskScheduler::createNew();
+    if (!scheduler_) {
+      return false;
+    }
+    env_ = BasicUsageEnvironment::createNew(*scheduler_);
+    if (!env_) {
+      delete scheduler_, scheduler_ = nullptr;
+      return false;
+    }
+    exit_flag_ = 0;
+    thread_ = std::thread(&RtspReactorLoop::Run, this);
+    return true;
+  }
+
+  void Stop() {
+    if (thread_.joinable()) {
+      exit_flag_ = 1;
+      thread_.join();
+    }
+    if (env_) {
+      env_->reclaim();
+      env_ = nullptr;
+    }
+    if (scheduler_) {
+      delete scheduler_, scheduler_ = nullptr;
+    }
+  }
+
+  void Add(RtspReactorSession* session) {
+    session->reconnect = session->param.reconnect;
+    session->connect_time = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(mutex_);
+    pending_.push_back(session);
+    ++session_num_;
+  }
+
+  // Blocks until the loop has shut the stream down and delivered the EOS callback.
+  void Remove(RtspReactorSession* session) {
+    session->close_requested.store(true);
+    std::unique_lock<std::mutex> lk(mutex_);
+    cond_.wait(lk, [session] { return session->finished; });
+  }
+
+  uint32_t GetSessionNum() const { return session_num_.load(); }
+
+ private:
+  static constexpr int64_t kTickIntervalUs = 10 * 1000;
+
+  static void OnTick(void* data) {
+    RtspReactorLoop* loop = reinterpret_cast<RtspReactorLoop*>(data);
+    loop->Tick();
+    loop->scheduler_->scheduleDelayedTask(kTickIntervalUs, OnTick, loop);
+  }
+
+  void Run() {
+    scheduler_->scheduleDelayedTask(kTickIntervalUs, OnTick, this);
+    scheduler_->doEventLoop(&exit_flag_);
+
+    // sessions still attached when the loop stops are shut down here
+    std::list<RtspReactorSession*> sessions;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      sessions.swap(pending_);
+    }
+    sessions.splice(sessions.end(), sessions_);
+    for (auto session : sessions) {
+      if (session->client && session->watch_variable != 1) {
+        shutdownStream(session->client);
+      }
+      Finish(session);
+    }
+  }
+
+  void Tick() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      sessions_.splice(sessions_.end(), pending_);
+    }
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+      RtspReactorSession* session = *it;
+      if (Update(session, now)) {
+        it = sessions_.erase(it);
+        Finish(session);  // the session may be released by Remove from now on
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // Returns true if the session is finished.
+  bool Update(RtspReactorSession* session, std::chrono::steady_clock::time_point now) {
+    if (session->client) {
+      if (session->close_requested.load() && session->watch_variable == 0) {
+        session->watch_variable = 2;
+      }
+      if (session->watch_variable == 2) {
+        shutdownStream(session->client);
+      }
+      if (session->watch_variable != 1) {
+        return false;
+      }
+      session->client = nullptr;  // released by shutdownStream
+      if (session->param.cb && !session->close_requested.load()) {
+        session->param.cb->OnRtspEvent(RTSP_EVENT_DISCONNECTED);
+      }
+      return !Reconnect(session, now);
+    }
+    if (session->close_requested.load()) {
+      return true;
+    }
+    if (now < session->connect_time) {
+      return false;
+    }
+    if (!Connect(session)) {
+      return !Reconnect(session, now);
+    }
+    return false;
+  }
+
+  bool Connect(RtspReactorSession* session) {
+    RTSPClient* rtspClient =
+        ourRTSPClient::createNew(*env_, session->param.url.c_str(), RTSP_CLIENT_VERBOSITY_LEVEL, "cnstream");
+    if (rtspClient == NULL) {
+      *env_ << "Failed to create a RTSP client for URL \"" << session->param.url.c_str() << "\": "
+            << env_->getResultMsg() << "\n";
+      return false;
+    }
+    session->watch_variable = 0;
+    InitRtspClient(rtspClient, session->param, &session->watch_variable);
+    session->client = rtspClient;
+    rtspClient->sendDescribeCommand(continueAfterDESCRIBE);
+    return true;
+  }
+
+  // Same strategy as the dedicated event loop, see kRtspReconnectDelay.
+  bool Reconnect(RtspReactorSession* session, std::chrono::steady_clock::time_point now) {
+    if (session->close_requested.load() || session->reconnect < 0) {
+      return false;
+    }
+    --session->reconnect;
+    bool was_up = now - session->connect_time >= kRtspReconnectDelay;
+    session->connect_time = was_up ? now : now + kRtspReconnectDelay;
+    return true;
+  }
+
+  void Finish(RtspReactorSession* session) {
+    if (session->param.cb) {
+      session->param.cb->OnRtspFrame(nullptr);
+    }
+    std::lock_guard<std::mutex> lk(mutex_);
+    session->finished = true;
+    --session_num_;
+    cond_.notify_all();
+  }
+
+ private:
+  TaskScheduler* scheduler_ = nullptr;
+  UsageEnvironment* env_ = nullptr;
+  std::thread thread_;
+  char exit_flag_ = 0;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::list<RtspReactorSession*> pending_;  // guarded by mutex_
+  std::list<RtspReactorSession*> sessions_;  // only used by the loop thread
+  std::atomic<uint32_t> session_num_{0};
+  int RTSP_CLIENT_VERBOSITY_LEVEL = 1;
+};
+
+/**
+ * The shared event loops. New sessions go to the loop serving the fewest sessions.
+ */
+class RtspReactor {
+ public:
+  static RtspReactor* Instance(uint32_t thread_num) {
+    // the first caller decides the thread number
+    static RtspReactor reactor(thread_num);
+    return &reactor;
+  }
+
+  RtspReactorLoop* Pick() {
+    RtspReactorLoop* picked = nullptr;
+    for (auto& loop : loops_) {
+      if (!picked || loop->GetSessionNum() < picked->GetSessionNum()) {
+        picked = loop.get();
+      }
+    }
+    return picked;
+  }
+
+  static uint32_t GetThreadNum() { return thread_num_.load(); }
+
+ private:
+  explicit RtspReactor(uint32_t thread_num) {
+    for (uint32_t i = 0; i < thread_num; ++i) {
+      std::unique_ptr<RtspReactorLoop> loop(new RtspReactorLoop);
+      if (!loop->Start()) {
+        LOGE(SOURCE) << "[RtspReactor] Failed to create live555 event loop " << i;
+        break;
+      }
+      loops_.push_back(std::move(loop));
+    }
+    thread_num_.store(loops_.size());
+    LOGI(SOURCE) << "[RtspReactor] " << loops_.size() << " shared live555 event loop(s) started";
+  }
+
+  std::vector<std::unique_ptr<RtspReactorLoop>> loops_;
+  static std::atomic<uint32_t> thread_num_;
+};
+
+std::atomic<uint32_t> RtspReactor::thread_num_{0};
+#endif  // HAVE_LIVE555
+
+uint32_t GetRtspReactorThreadNum() {
+#ifdef HAVE_LIVE555
+  return RtspReactor::GetThreadNum();
+#else
+  return 0;
+#endif  // HAVE_LIVE555
+}
+
 class RtspSessionImpl {
  public:
   RtspSessionImpl() {}
@@ -646,6 +926,16 @@ class RtspSessionImpl {
 #ifdef HAVE_LIVE555
     param_ = param;
     exit_flag_ = 0;
+    if (param_.reactor_threads > 0) {
+      reactor_loop_ = RtspReactor::Instance(param_.reactor_threads)->Pick();
+      if (reactor_loop_) {
+        reactor_session_.reset(new RtspReactorSession);
+        reactor_session_->param = param_;
+        reactor_loop_->Add(reactor_session_.get());
+        return 0;
+      }
+      LOGW(SOURCE) << "[RtspSession] No shared event loop available, run a dedicated one for " << param_.url;
+    }
     thread_id_ = std::thread(&RtspSessionImpl::TaskRoutine, this);
     return 0;
 #else
@@ -654,6 +944,12 @@ class RtspSessionImpl {
   }
   void Close() {
 #ifdef HAVE_LIVE555
+    if (reactor_loop_) {
+      reactor_loop_->Remove(reactor_session_.get());
+      reactor_loop_ = nullptr;
+      reactor_session_.reset();
+      return;
+    }
     exit_flag_ = 1;
     if (thread_id_.joinable()) {
       this->eventLoopWatchVariable = 2;
@@ -666,14 +962,22 @@ class RtspSessionImpl {
   void TaskRoutine() {
     int reconnect = param_.reconnect;
     while (!exit_flag_) {
+      auto connect_time = std::chrono::steady_clock::now();
       TaskRoutine_();
+      if (exit_flag_) {
+        break;
+      }
+      if (param_.cb) {
+        param_.cb->OnRtspEvent(RTSP_EVENT_DISCONNECTED);
+      }
 
-      // FIXME, apply reconnect strategy
       if (reconnect < 0) {
         break;
       }
       --reconnect;
-      std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+      if (std::chrono::steady_clock::now() - connect_time < kRtspReconnectDelay) {
+        std::this_thread::sleep_for(kRtspReconnectDelay);
+      }
     }
 
     std::cout << "TaskRoutine exit" << std::endl;
@@ -703,13 +1007,7 @@ class RtspSessionImpl {
     }
 
     this->eventLoopWatchVariable = 0;
-    reinterpret_cast<ourRTSPClient*>(rtspClient)->eventLoopWatchVariable = &this->eventLoopWatchVariable;
-    reinterpret_cast<ourRTSPClient*>(rtspClient)->livenessTimeoutMs = param_.livenessTimeoutMs;
-    reinterpret_cast<ourRTSPClient*>(rtspClient)->streammingPreferTcp = param_.streammingPreferTcp;
-    reinterpret_cast<ourRTSPClient*>(rtspClient)->only_key_frame = param_.only_key_frame;
-    reinterpret_cast<ourRTSPClient*>(rtspClient)->streammingOverTcp = true;
-    reinterpret_cast<ourRTSPClient*>(rtspClient)->setupOk = false;
-    reinterpret_cast<ourRTSPClient*>(rtspClient)->cb_ = param_.cb;
+    InitRtspClient(rtspClient, param_, &this->eventLoopWatchVariable);
 
     // Next, send a RTSP "DESCRIBE" command, to get a SDP description for the stream.
     // Note that this command - like all RTSP commands - is sent asynchronously; we do not block, waiting for a
@@ -742,6 +1040,10 @@ class RtspSessionImpl {
   // by default, print verbose output from each "RTSPClient"
   int RTSP_CLIENT_VERBOSITY_LEVEL = 1;
   char eventLoopWatchVariable = 0;
+#ifdef HAVE_LIVE555
+  RtspReactorLoop* reactor_loop_ = nullptr;
+  std::unique_ptr<RtspReactorSession> reactor_session_;
+#endif  // HAVE_LIVE555
 };
 
 RtspSession::RtspSession() {}
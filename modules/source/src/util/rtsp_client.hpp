@@ -20,11 +20,17 @@
 #ifndef CNSTREAM_RTSP_CLIENT_H_
 #define CNSTREAM_RTSP_CLIENT_H_
 
+#include <cstdint>
 #include <string>
 #include "video_parser.hpp"
 
 namespace cnstream {
 
+/* the types of IRtspCB::OnRtspEvent */
+enum RtspEventType {
+  RTSP_EVENT_DISCONNECTED = 1,  // the connection is closed or failed, the session reconnects if reconnect allows
+};
+
 struct IRtspCB {
   virtual void OnRtspInfo(VideoInfo *info) = 0;
   virtual void OnRtspFrame(VideoEsFrame *frame) = 0;
@@ -41,6 +47,11 @@ struct OpenParam {
   int livenessTimeoutMs = 2000;
   IRtspCB *cb = nullptr;
   bool only_key_frame = false;
+  uint32_t gop_interval = 1;  // one of every gop_interval GOPs is sent to cb
+  uint32_t reactor_threads = 0; /*number of live555 event loop threads shared by all the sessions,
+                                 * 0 means each session runs its own event loop thread.
+                                 * The first session opened with a non-zero value decides the thread number.
+                                 */
 };
 
 class RtspSessionImpl;
@@ -58,6 +69,13 @@ class RtspSession {
   RtspSessionImpl *impl_ = nullptr;
 };
 
+/**
+ * @brief Gets the number of shared live555 event loop threads.
+ *
+ * @return Returns 0 if no session has been opened with OpenParam::reactor_threads greater than 0.
+ */
+uint32_t GetRtspReactorThreadNum();
+
 }  // namespace cnstream
 
 #endif  // CNSTREAM_RTSP_CLIENT_H_
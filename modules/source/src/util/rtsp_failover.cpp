@@ -0,0 +1,195 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "util/rtsp_failover.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace cnstream {
+
+static uint64_t HashPacket(const uint8_t *data, size_t size) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+void GopCache::Push(const uint8_t *data, size_t size, uint64_t pts, bool key_frame, Clock::time_point arrival) {
+  if (key_frame) {
+    packets_.clear();
+  } else if (packets_.empty()) {
+    return;  // waits for a key frame
+  } else if (packets_.size() >= max_packets_) {
+    packets_.clear();  // the GOP is too long to be kept, waits for the next key frame
+    return;
+  }
+  Packet pkt;
+  pkt.data.assign(data, data + size);
+  pkt.pts = pts;
+  pkt.key_frame = key_frame;
+  pkt.arrival = arrival;
+  packets_.push_back(std::move(pkt));
+}
+
+RtspFailover::RtspFailover(Output output, int session_num, uint32_t stall_ms)
+    : output_(output), session_num_(std::min(std::max(session_num, 1), 2)), stall_(std::chrono::milliseconds(stall_ms)) {
+  // a session which never receives anything is stalled since the beginning
+  Clock::time_point now = Clock::now();
+  for (auto &s : sessions_) s.last_arrival = now;
+}
+
+void RtspFailover::OnPacket(int session, const uint8_t *data, size_t size, uint64_t pts, bool key_frame,
+                            Clock::time_point now) {
+  if (session < 0 || session >= session_num_) return;
+  std::lock_guard<std::mutex> lk(mutex_);
+  Session &s = sessions_[session];
+  UpdateArrival(&s, now);
+  if (session == active_) {
+    Forward(&s, data, size, pts, key_frame, false);
+    return;
+  }
+  s.cache.Push(data, size, pts, key_frame, now);
+  // the active session is checked each time the standby session receives a packet
+  if (s.cache.Valid() && Stalled(sessions_[active_], now)) {
+    SwitchTo(session);
+  }
+}
+
+void RtspFailover::OnDisconnected(int session) {
+  if (session < 0 || session >= session_num_) return;
+  std::lock_guard<std::mutex> lk(mutex_);
+  Session &s = sessions_[session];
+  // the pts of the next connection start from 0 again
+  s.rebase = true;
+  s.cache.Clear();
+  int other = 1 - session;
+  if (session == active_ && session_num_ == 2 && !sessions_[other].finished && sessions_[other].cache.Valid()) {
+    SwitchTo(other);
+  }
+}
+
+bool RtspFailover::OnFinished(int session) {
+  if (session < 0 || session >= session_num_) return false;
+  std::lock_guard<std::mutex> lk(mutex_);
+  sessions_[session].finished = true;
+  sessions_[session].cache.Clear();
+  int other = 1 - session;
+  if (session == active_ && session_num_ == 2 && !sessions_[other].finished && sessions_[other].cache.Valid()) {
+    SwitchTo(other);
+  }
+  for (int i = 0; i < session_num_; ++i) {
+    if (!sessions_[i].finished) return false;
+  }
+  return true;
+}
+
+int RtspFailover::GetActiveSession() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return active_;
+}
+
+uint64_t RtspFailover::GetSwitchCount() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return switch_cnt_;
+}
+
+void RtspFailover::UpdateArrival(Session *s, Clock::time_point now) {
+  if (now > s->last_arrival) {
+    s->arrival_interval = now - s->last_arrival;
+    s->last_arrival = now;
+  }
+}
+
+bool RtspFailover::Stalled(const Session &s, Clock::time_point now) const {
+  if (s.finished) return true;
+  // slow cameras are not switched between two of their packets
+  Clock::duration threshold = std::max(stall_, 3 * s.arrival_interval);
+  return now - s.last_arrival > threshold;
+}
+
+void RtspFailover::Forward(Session *s, const uint8_t *data, size_t size, uint64_t pts, bool key_frame,
+                           bool preroll) {
+  if (s->rebase) {
+    s->offset = has_out_pts_ ? static_cast<int64_t>(last_out_pts_ + pts_interval_) - static_cast<int64_t>(pts) : 0;
+    s->rebase = false;
+  }
+  int64_t out = std::max<int64_t>(static_cast<int64_t>(pts) + s->offset, 0);
+  uint64_t out_pts = static_cast<uint64_t>(out);
+  if (!preroll) {
+    if (has_out_pts_ && out_pts > last_out_pts_) {
+      // packets out of order (b-frames) and gaps longer than one second do not change the interval
+      uint64_t interval = out_pts - last_out_pts_;
+      if (interval <= 90000) pts_interval_ = interval;
+    }
+    if (!has_out_pts_ || out_pts > last_out_pts_) last_out_pts_ = out_pts;
+    has_out_pts_ = true;
+    last_out_size_ = size;
+    last_out_hash_ = HashPacket(data, size);
+  }
+  if (output_) output_(data, size, out_pts, key_frame, preroll);
+}
+
+void RtspFailover::SwitchTo(int session) {
+  Session &prev = sessions_[active_];
+  Session &next = sessions_[session];
+  const std::vector<GopCache::Packet> &packets = next.cache.GetPackets();
+  // The sessions receive the same encoded stream, the last forwarded packet is looked for in the cache. The packets up
+  // to it have been forwarded already, and it keeps the pts it was forwarded with.
+  size_t first_new = 0;
+  bool matched = false;
+  if (has_out_pts_) {
+    for (size_t i = packets.size(); i > 0; --i) {
+      const GopCache::Packet &pkt = packets[i - 1];
+      if (pkt.data.size() == last_out_size_ && HashPacket(pkt.data.data(), pkt.data.size()) == last_out_hash_) {
+        first_new = i;
+        matched = true;
+        break;
+      }
+    }
+    if (!matched) {
+      // guesses by the arrival time
+      while (first_new < packets.size() && packets[first_new].arrival <= prev.last_arrival) ++first_new;
+    }
+  }
+  if (!has_out_pts_) {
+    next.offset = 0;
+  } else if (matched) {
+    next.offset = static_cast<int64_t>(last_out_pts_) - static_cast<int64_t>(packets[first_new - 1].pts);
+  } else if (first_new < packets.size()) {
+    next.offset = static_cast<int64_t>(last_out_pts_ + pts_interval_) - static_cast<int64_t>(packets[first_new].pts);
+  } else {
+    next.offset = static_cast<int64_t>(last_out_pts_) - static_cast<int64_t>(packets.back().pts);
+  }
+  next.rebase = false;
+  prev.rebase = true;
+  prev.cache.Clear();
+  active_ = session;
+  ++switch_cnt_;
+  for (size_t i = 0; i < packets.size(); ++i) {
+    const GopCache::Packet &pkt = packets[i];
+    Forward(&next, pkt.data.data(), pkt.data.size(), pkt.pts, pkt.key_frame, i < first_new);
+  }
+  next.cache.Clear();
+}
+
+}  // namespace cnstream
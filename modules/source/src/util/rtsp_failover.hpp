@@ -0,0 +1,138 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_RTSP_FAILOVER_HPP_
+#define CNSTREAM_RTSP_FAILOVER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief GopCache keeps the packets from the last key frame on, dropping the previous GOP when a key frame arrives.
+ */
+class GopCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+  struct Packet {
+    std::vector<uint8_t> data;
+    uint64_t pts = 0;
+    bool key_frame = false;
+    Clock::time_point arrival;
+  };
+
+  explicit GopCache(size_t max_packets = 600) : max_packets_(max_packets) {}
+
+  /**
+   * @brief Adds a packet. Packets before the first key frame are dropped, so are the GOPs longer than max_packets.
+   */
+  void Push(const uint8_t *data, size_t size, uint64_t pts, bool key_frame, Clock::time_point arrival);
+  /**
+   * @brief Checks whether the cache holds a GOP, i.e. it starts with a key frame.
+   */
+  bool Valid() const { return !packets_.empty(); }
+  const std::vector<Packet> &GetPackets() const { return packets_; }
+  void Clear() { packets_.clear(); }
+
+ private:
+  size_t max_packets_;
+  std::vector<Packet> packets_;
+};  // class GopCache
+
+/**
+ * @brief RtspFailover merges the packets of the rtsp sessions of one camera into one stream for the decoder.
+ *
+ * The packets of the active session are forwarded at once. A standby session only fills its GopCache. When the active
+ * session is disconnected, finished or stalls while the standby session keeps receiving, the standby session becomes
+ * active and its cached GOP is forwarded first, so the decoder goes on from a key frame instead of waiting for the
+ * next one. The cached packets already forwarded by the previous session are marked as preroll, they are decoded but
+ * should not be output. They are found by comparing the packets, as both sessions receive the same encoded stream.
+ *
+ * The pts of each connection start from 0, they are rebased to follow the last forwarded pts, so the pts of the stream
+ * keep increasing across reconnections and session switches.
+ */
+class RtspFailover {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Output = std::function<void(const uint8_t *data, size_t size, uint64_t pts, bool key_frame, bool preroll)>;
+
+  /**
+   * @brief Constructor.
+   *
+   * @param[in] output Receives the packets of the stream. It is called with the internal lock held.
+   * @param[in] session_num The number of sessions, 1 or 2. Session 0 is active at first.
+   * @param[in] stall_ms The active session is stalled if no packet arrives in this time, nor in three times its
+   *            packet interval.
+   */
+  explicit RtspFailover(Output output, int session_num = 2, uint32_t stall_ms = 300);
+
+  void OnPacket(int session, const uint8_t *data, size_t size, uint64_t pts, bool key_frame, Clock::time_point now);
+  /**
+   * @brief Notifies that the connection of a session is lost. The session reconnects by itself.
+   */
+  void OnDisconnected(int session);
+  /**
+   * @brief Notifies that a session will not reconnect any more.
+   *
+   * @return Returns true if all the sessions are finished, i.e. the stream reaches the end.
+   */
+  bool OnFinished(int session);
+
+  int GetActiveSession() const;
+  uint64_t GetSwitchCount() const;
+
+ private:
+  struct Session {
+    GopCache cache;
+    bool finished = false;
+    bool rebase = true;  // the offset is computed again on the next forwarded packet
+    int64_t offset = 0;
+    uint64_t last_in_pts = 0;
+    bool has_in_pts = false;
+    Clock::time_point last_arrival;
+    Clock::duration arrival_interval = Clock::duration::zero();
+  };
+
+  void UpdateArrival(Session *s, Clock::time_point now);
+  bool Stalled(const Session &s, Clock::time_point now) const;
+  void Forward(Session *s, const uint8_t *data, size_t size, uint64_t pts, bool key_frame, bool preroll);
+  void SwitchTo(int session);
+
+  Output output_;
+  int session_num_;
+  Clock::duration stall_;
+  mutable std::mutex mutex_;
+  Session sessions_[2];
+  int active_ = 0;
+  uint64_t switch_cnt_ = 0;
+  bool has_out_pts_ = false;
+  uint64_t last_out_pts_ = 0;
+  uint64_t pts_interval_ = 3600;  // 25 fps in 90 kHz
+  size_t last_out_size_ = 0;
+  uint64_t last_out_hash_ = 0;
+};  // class RtspFailover
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_RTSP_FAILOVER_HPP_
@@ -0,0 +1,90 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "util/spsc_packet_queue.hpp"
+
+#include <chrono>
+
+namespace cnstream {
+
+SpscPacketQueue::SpscPacketQueue(size_t capacity) : slots_(capacity ? capacity : 1) {}
+
+template <typename Pred>
+bool SpscPacketQueue::WaitFor(std::atomic<bool> *waiting, int timeout_ms, Pred ready) {
+  if (ready()) return true;
+  if (timeout_ms == 0) return false;
+  std::unique_lock<std::mutex> lk(mutex_);
+  // The flag is set before ready is checked again, and the other side sets the index before it reads the flag. All of
+  // them are sequentially consistent, so either the index is seen here or the other side sees the flag and notifies.
+  waiting->store(true);
+  bool ret = true;
+  if (timeout_ms < 0) {
+    cond_.wait(lk, ready);
+  } else {
+    ret = cond_.wait_for(lk, std::chrono::milliseconds(timeout_ms), ready);
+  }
+  waiting->store(false);
+  return ret;
+}
+
+void SpscPacketQueue::Wake(std::atomic<bool> *waiting) {
+  if (waiting->load()) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    cond_.notify_all();
+  }
+}
+
+bool SpscPacketQueue::Push(int timeout_ms, const uint8_t *data, size_t size, uint64_t pts, uint32_t flags) {
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  if (!WaitFor(&producer_waiting_, timeout_ms, [&] { return tail - head_.load() < slots_.size(); })) {
+    return false;
+  }
+  Slot &slot = slots_[tail % slots_.size()];
+  // assign keeps the capacity of the buffer
+  if (data && size) {
+    slot.buffer.assign(data, data + size);
+  } else {
+    slot.buffer.clear();
+  }
+  slot.packet.data = slot.buffer.empty() ? nullptr : slot.buffer.data();
+  slot.packet.size = slot.buffer.size();
+  slot.packet.pts = pts;
+  slot.packet.flags = flags;
+  tail_.store(tail + 1);
+  Wake(&consumer_waiting_);
+  return true;
+}
+
+const SpscPacketQueue::Packet *SpscPacketQueue::Front(int timeout_ms) {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  if (!WaitFor(&consumer_waiting_, timeout_ms, [&] { return tail_.load() != head; })) {
+    return nullptr;
+  }
+  return &slots_[head % slots_.size()].packet;
+}
+
+void SpscPacketQueue::PopFront() {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  if (tail_.load() == head) return;
+  head_.store(head + 1);
+  Wake(&producer_waiting_);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,102 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_SPSC_PACKET_QUEUE_HPP_
+#define CNSTREAM_SPSC_PACKET_QUEUE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief SpscPacketQueue is a bounded packet queue between one producer (the demuxer) and one consumer (the decoder).
+ *
+ * The slots are allocated at construction and their payload buffers are reused, so no memory is allocated once the
+ * buffers have grown to the packet size. Pushing and popping only touch two atomic indexes, the mutex is locked only
+ * when one side has to wait for the other.
+ *
+ * Calls of the producer (or of the consumer) may come from different threads if they are serialized by the caller.
+ */
+class SpscPacketQueue {
+ public:
+  struct Packet {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    uint64_t pts = 0;
+    uint32_t flags = 0;
+  };
+
+  explicit SpscPacketQueue(size_t capacity);
+
+  /**
+   * @brief Copies a packet into the queue. Called by the producer.
+   *
+   * @param[in] timeout_ms How long to wait for a free slot, a negative value means waiting until a slot is free.
+   *
+   * @return Returns false if the queue is still full after timeout_ms.
+   */
+  bool Push(int timeout_ms, const uint8_t *data, size_t size, uint64_t pts, uint32_t flags);
+  /**
+   * @brief Gets the first packet. Called by the consumer.
+   *
+   * @param[in] timeout_ms How long to wait for a packet, a negative value means waiting until a packet is pushed.
+   *
+   * @return Returns nullptr if the queue is still empty after timeout_ms. The packet is valid until PopFront is called.
+   */
+  const Packet *Front(int timeout_ms);
+  /**
+   * @brief Releases the packet returned by Front, its slot is given back to the producer.
+   */
+  void PopFront();
+
+  size_t Size() const { return tail_.load() - head_.load(); }
+  size_t Capacity() const { return slots_.size(); }
+
+ private:
+  SpscPacketQueue(const SpscPacketQueue &) = delete;
+  SpscPacketQueue &operator=(const SpscPacketQueue &) = delete;
+
+  template <typename Pred>
+  bool WaitFor(std::atomic<bool> *waiting, int timeout_ms, Pred ready);
+  void Wake(std::atomic<bool> *waiting);
+
+  struct Slot {
+    std::vector<uint8_t> buffer;
+    Packet packet;
+  };
+  std::vector<Slot> slots_;
+  // the indexes only increase, the slot of an index is index % capacity. They are written by different threads.
+  std::atomic<uint64_t> head_{0};  // written by the consumer
+  char head_pad_[64 - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint64_t> tail_{0};  // written by the producer
+  char tail_pad_[64 - sizeof(std::atomic<uint64_t>)];
+  std::atomic<bool> consumer_waiting_{false};
+  std::atomic<bool> producer_waiting_{false};
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};  // class SpscPacketQueue
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_SPSC_PACKET_QUEUE_HPP_
@@ -0,0 +1,118 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "stream_placer.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+// the load of a stream assumed before any stream is measured on the device, about 20 streams a device
+static constexpr double kDefaultStreamLoad = 0.05;
+
+StreamPlacer::StreamPlacer(const std::vector<int> &device_ids, LoadSampler sampler, uint32_t sample_interval_ms)
+    : sampler_(std::move(sampler)), sample_interval_(sample_interval_ms) {
+  for (int device_id : device_ids) {
+    DeviceState device;
+    device.device_id = device_id;
+    devices_.push_back(device);
+  }
+}
+
+void StreamPlacer::Sample() {
+  const auto now = std::chrono::steady_clock::now();
+  if (sampled_ && now - sample_time_ < sample_interval_) return;
+  sampled_ = true;
+  sample_time_ = now;
+  std::vector<DeviceLoad> loads;
+  if (sampler_) loads = sampler_();
+  for (auto &device : devices_) {
+    device.load = -1;
+    for (const auto &load : loads) {
+      if (load.device_id != device.device_id) continue;
+      // the load is unknown unless at least one of them is known
+      device.load = std::max(load.codec, load.compute);
+      break;
+    }
+    device.sampled_streams = device.streams;
+    device.placed_streams = 0;
+  }
+}
+
+int StreamPlacer::Place(const std::string &stream_id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto iter = placements_.find(stream_id);
+  if (iter != placements_.end()) return devices_[iter->second].device_id;
+
+  Sample();
+  bool loads_known = true;
+  std::vector<double> loads;
+  for (const auto &device : devices_) {
+    if (device.load < 0) loads_known = false;
+    double stream_load = kDefaultStreamLoad;
+    if (device.sampled_streams && device.load > 0) stream_load = device.load / device.sampled_streams;
+    loads.push_back(device.load + device.placed_streams * stream_load);
+  }
+  size_t index = 0;
+  for (size_t i = 1; i < devices_.size(); ++i) {
+    const DeviceState &device = devices_[i], &best = devices_[index];
+    if (loads_known && loads[i] != loads[index]) {
+      if (loads[i] < loads[index]) index = i;
+    } else if (device.streams < best.streams) {
+      index = i;
+    }
+  }
+  devices_[index].streams++;
+  devices_[index].placed_streams++;
+  placements_[stream_id] = index;
+  LOGI(SOURCE) << "[" << stream_id << "]: placed on device " << devices_[index].device_id << " with "
+               << devices_[index].streams << " streams"
+               << (loads_known ? ", load " + std::to_string(loads[index]) : std::string());
+  return devices_[index].device_id;
+}
+
+void StreamPlacer::Release(const std::string &stream_id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto iter = placements_.find(stream_id);
+  if (iter == placements_.end()) return;
+  devices_[iter->second].streams--;
+  placements_.erase(iter);
+}
+
+int StreamPlacer::Find(const std::string &stream_id) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto iter = placements_.find(stream_id);
+  return iter == placements_.end() ? -1 : devices_[iter->second].device_id;
+}
+
+uint32_t StreamPlacer::GetStreamNum(int device_id) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  for (const auto &device : devices_) {
+    if (device.device_id == device_id) return device.streams;
+  }
+  return 0;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,103 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_STREAM_PLACER_HPP_
+#define CNSTREAM_STREAM_PLACER_HPP_
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief The live load of a device, in [0, 1]. A negative value means it is unknown.
+ */
+struct DeviceLoad {
+  int device_id = 0;
+  double codec = -1;    // the codec channels in use or the codec utilization
+  double compute = -1;  // the core utilization
+};
+
+/**
+ * @brief StreamPlacer picks the device a new stream is decoded on, among the devices of a DataSource module.
+ *
+ * A stream is placed on the device with the lowest load, the larger of its codec and compute load. The loads are
+ * sampled at most once per ``sample_interval_ms``, each stream placed since the last sample adds the average load of a
+ * stream on the device, so that the streams added at once are spread over the devices. The streams are spread by
+ * their numbers if the loads of some devices are unknown.
+ *
+ * A stream stays on its device until it is released. The frames are decoded to the device, and the next modules
+ * running on several devices (e.g. Inferencer2 with ``device_ids``) keep the stream on it, so no peer copy is needed.
+ */
+class StreamPlacer {
+ public:
+  using LoadSampler = std::function<std::vector<DeviceLoad>()>;
+
+  /**
+   * @param device_ids The devices to place the streams on, must not be empty.
+   * @param sampler The function reading the loads of the devices, may be null.
+   * @param sample_interval_ms The minimum interval between two samples.
+   */
+  StreamPlacer(const std::vector<int> &device_ids, LoadSampler sampler, uint32_t sample_interval_ms = 1000);
+
+  /**
+   * @brief Gets the device of a stream, places the stream if it has not been placed.
+   */
+  int Place(const std::string &stream_id);
+  /**
+   * @brief Releases a stream, the device will not count it any more.
+   */
+  void Release(const std::string &stream_id);
+  /**
+   * @brief Gets the device of a stream, -1 if the stream is not placed.
+   */
+  int Find(const std::string &stream_id) const;
+  /**
+   * @brief Gets the number of streams placed on a device.
+   */
+  uint32_t GetStreamNum(int device_id) const;
+
+ private:
+  struct DeviceState {
+    int device_id = 0;
+    uint32_t streams = 0;
+    double load = -1;              // the load sampled
+    uint32_t sampled_streams = 0;  // the streams on the device when the load is sampled
+    uint32_t placed_streams = 0;   // the streams placed since the last sample
+  };
+  // called with mtx_ locked
+  void Sample();
+
+  std::vector<DeviceState> devices_;
+  LoadSampler sampler_;
+  std::chrono::milliseconds sample_interval_;
+  std::chrono::steady_clock::time_point sample_time_;
+  bool sampled_ = false;
+  mutable std::mutex mtx_;
+  std::map<std::string, size_t> placements_;
+};  // class StreamPlacer
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_STREAM_PLACER_HPP_
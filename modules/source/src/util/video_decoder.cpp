@@ -20,6 +20,7 @@
 
 #include <cnrt.h>
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <memory>
@@ -35,6 +36,17 @@
 #include "cnstream_logging.hpp"
 #include "video_decoder.hpp"
 
+// hwaccel device contexts of decoders are set up by AVCodecHWConfig since FFmpeg 4.0 (libavcodec 58.18.100)
+#define FFMPEG_HWACCEL_VERSION AV_VERSION_INT(58, 18, 100)
+#if LIBAVCODEC_VERSION_INT >= FFMPEG_HWACCEL_VERSION
+extern "C" {
+#include <libavutil/hwcontext.h>
+}
+#endif
+extern "C" {
+#include <libavutil/motion_vector.h>
+}
+
 CNS_IGNORE_DEPRECATED_PUSH
 
 namespace cnstream {
@@ -80,12 +92,35 @@ bool MluDecoder::Create(VideoInfo *info, ExtraDecoderInfo *extra) {
     return false;
   }
   if (nullptr == impl_) return false;
+  const char *kind = info->codec_id == AV_CODEC_ID_MJPEG ? kRESOURCE_JPEG_DECODER : kRESOURCE_VIDEO_DECODER;
+  // with fallback decoders, the stream does not wait for a codec channel
+  channel_lease_ = DeviceResourceManager::Instance().Acquire(
+      extra->pipeline_name, extra->device_id, kind, extra->fallback_decoders.empty() ? extra->resource_timeout_ms : 0);
+  if (!channel_lease_) {
+    LOGW(SOURCE) << "[" << stream_id_ << "]: No " << kind << " channel available on device " << extra->device_id;
+    delete impl_;
+    impl_ = nullptr;
+    for (const std::string& fallback : extra->fallback_decoders) {
+      ExtraDecoderInfo fallback_extra = *extra;
+      fallback_extra.hwaccel = fallback == "cpu" ? "" : fallback;
+      std::unique_ptr<FFmpegCpuDecoder> decoder(new FFmpegCpuDecoder(stream_id_, result_));
+      if (decoder->Create(info, &fallback_extra)) {
+        LOGW(SOURCE) << "[" << stream_id_ << "]: Fall back to the " << fallback << " decoder";
+        impl_ = decoder.release();
+        return true;
+      }
+    }
+    LOGE(SOURCE) << "[" << stream_id_ << "]: Create decoder failed, no " << kind << " channel is left";
+    return false;
+  }
   LOGI(SOURCE) << "[" << stream_id_ << "]: Begin create decoder";
   bool ret = impl_->Create(info, extra);
-  if (ret)
+  if (ret) {
     LOGI(SOURCE) << "[" << stream_id_ << "]: Finish create decoder";
-  else
+  } else {
     LOGE(SOURCE) << "[" << stream_id_ << "]: Create decoder failed";
+    channel_lease_.reset();
+  }
   return ret;
 }
 
@@ -95,6 +130,7 @@ void MluDecoder::Destroy() {
     delete impl_;
     impl_ = nullptr;
   }
+  channel_lease_.reset();
 }
 
 bool MluDecoder::Process(VideoEsPacket *pkt) {
@@ -106,6 +142,97 @@ bool MluDecoder::Process(VideoEsPacket *pkt) {
 
 //----------------------------------------------------------------------------
 // CPU decoder
+float MotionActivity(const AVMotionVector *mvs, size_t num, int width, int height) {
+  if (width <= 0 || height <= 0) return -1;
+  int64_t static_area = 0;
+  for (size_t i = 0; i < num; ++i) {
+    const AVMotionVector &mv = mvs[i];
+    if (mv.source < 0 && mv.src_x == mv.dst_x && mv.src_y == mv.dst_y) static_area += mv.w * mv.h;
+  }
+  const double area = static_cast<double>(width) * height;
+  return static_cast<float>(std::max(0.0, 1 - static_area / area));
+}
+
+constexpr int DecodeThreadBudget::kMaxThreadsPerDecoder;
+
+DecodeThreadBudget& DecodeThreadBudget::Instance() {
+  static DecodeThreadBudget budget;
+  return budget;
+}
+
+void DecodeThreadBudget::SetTotal(int total) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  total_ = total > 0 ? total : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+int DecodeThreadBudget::GetTotal() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return total_;
+}
+
+int DecodeThreadBudget::Acquire() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  // the decoders created later get less when the budget is used up, but one thread at least
+  const int share = std::min(total_ / (decoders_ + 1), total_ - used_);
+  const int threads = std::max(1, std::min(share, kMaxThreadsPerDecoder));
+  used_ += threads;
+  ++decoders_;
+  return threads;
+}
+
+void DecodeThreadBudget::Release(int threads) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  used_ -= threads;
+  --decoders_;
+}
+
+#if LIBAVCODEC_VERSION_INT >= FFMPEG_HWACCEL_VERSION
+AVPixelFormat FFmpegCpuDecoder::GetHwFormat(AVCodecContext *ctx, const AVPixelFormat *fmts) {
+  const AVPixelFormat hw_pix_fmt = static_cast<FFmpegCpuDecoder *>(ctx->opaque)->hw_pix_fmt_;
+  for (const AVPixelFormat *fmt = fmts; *fmt != AV_PIX_FMT_NONE; ++fmt) {
+    if (*fmt == hw_pix_fmt) return *fmt;
+  }
+  return AV_PIX_FMT_NONE;
+}
+
+bool FFmpegCpuDecoder::InitHwaccel(AVCodec *dec, const std::string& hwaccel) {
+  AVHWDeviceType type = av_hwdevice_find_type_by_name(hwaccel.c_str());
+  if (type == AV_HWDEVICE_TYPE_NONE) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: Unknown hwaccel " << hwaccel;
+    return false;
+  }
+  for (int i = 0;; ++i) {
+    const AVCodecHWConfig *config = avcodec_get_hw_config(dec, i);
+    if (!config) {
+      LOGE(SOURCE) << "[" << stream_id_ << "]: " << dec->name << " is not supported by hwaccel " << hwaccel;
+      return false;
+    }
+    if ((config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) && config->device_type == type) {
+      hw_pix_fmt_ = config->pix_fmt;
+      break;
+    }
+  }
+  if (av_hwdevice_ctx_create(&hw_device_ctx_, type, nullptr, nullptr, 0) < 0) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: Failed to create " << hwaccel << " device";
+    return false;
+  }
+  instance_->hw_device_ctx = av_buffer_ref(hw_device_ctx_);
+  instance_->opaque = this;
+  instance_->get_format = &FFmpegCpuDecoder::GetHwFormat;
+  sw_frame_ = av_frame_alloc();
+  return sw_frame_ != nullptr;
+}
+#else
+AVPixelFormat FFmpegCpuDecoder::GetHwFormat(AVCodecContext *ctx, const AVPixelFormat *fmts) {
+  return AV_PIX_FMT_NONE;
+}
+
+bool FFmpegCpuDecoder::InitHwaccel(AVCodec *dec, const std::string& hwaccel) {
+  LOGE(SOURCE) << "[" << stream_id_ << "]: hwaccel " << hwaccel << " requires FFmpeg 4.0 or later";
+  return false;
+}
+#endif
+
 bool FFmpegCpuDecoder::Create(VideoInfo *info, ExtraDecoderInfo *extra) {
   AVCodec *dec = avcodec_find_decoder(info->codec_id);
   if (!dec) {
@@ -131,17 +258,35 @@ bool FFmpegCpuDecoder::Create(VideoInfo *info, ExtraDecoderInfo *extra) {
   instance_->height = info->height;
   instance_->width = info->width;
 #endif
+  if (!extra->hwaccel.empty()) {
+    if (!InitHwaccel(dec, extra->hwaccel)) {
+      ReleaseCodec();
+      return false;
+    }
+  } else {
+    // frame and slice threading, the threads are shared by the cpu decoders of the process
+    threads_ = DecodeThreadBudget::Instance().Acquire();
+    instance_->thread_count = threads_;
+    instance_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    // the motion vectors are not exported by hwaccels
+    export_mvs_ = extra->export_motion_vectors;
+    if (export_mvs_) instance_->flags2 |= AV_CODEC_FLAG2_EXPORT_MVS;
+  }
   if (avcodec_open2(instance_, dec, NULL) < 0) {
     LOGE(SOURCE) << "[" << stream_id_ << "]: "
                  << "Failed to open codec";
+    ReleaseCodec();
     return false;
   }
   av_frame_ = av_frame_alloc();
   if (!av_frame_) {
     LOGE(SOURCE) << "[" << stream_id_ << "]: "
                  << "Could not alloc frame";
+    ReleaseCodec();
     return false;
   }
+  LOGI(SOURCE) << "[" << stream_id_ << "]: FFmpeg decoder created, "
+               << (extra->hwaccel.empty() ? std::to_string(threads_) + " threads" : "hwaccel " + extra->hwaccel);
   eos_got_.store(0);
   eos_sent_.store(0);
   return true;
@@ -157,14 +302,26 @@ void FFmpegCpuDecoder::Destroy() {
     while (!eos_got_.load()) {
       std::this_thread::yield();
     }
+  }
+  ReleaseCodec();
+  LOGI(SOURCE) << "[" << stream_id_ << "]: Finish destroy decoder";
+}
+
+void FFmpegCpuDecoder::ReleaseCodec() {
+  if (instance_ != nullptr) {
+    av_buffer_unref(&instance_->hw_device_ctx);
     avcodec_close(instance_), av_free(instance_);
     instance_ = nullptr;
   }
-  if (av_frame_) {
-    av_frame_free(&av_frame_);
-    av_frame_ = nullptr;
+  if (av_frame_) av_frame_free(&av_frame_);
+  if (sw_frame_) av_frame_free(&sw_frame_);
+  if (hw_device_ctx_) av_buffer_unref(&hw_device_ctx_);
+  hw_pix_fmt_ = AV_PIX_FMT_NONE;
+  export_mvs_ = false;
+  if (threads_) {
+    DecodeThreadBudget::Instance().Release(threads_);
+    threads_ = 0;
   }
-  LOGI(SOURCE) << "[" << stream_id_ << "]: Finish destroy decoder";
 }
 
 bool FFmpegCpuDecoder::Process(VideoEsPacket *pkt) {
@@ -216,10 +373,23 @@ bool FFmpegCpuDecoder::Process(AVPacket *pkt, bool eos) {
 
 
 bool FFmpegCpuDecoder::ProcessFrame(AVFrame *frame) {
-  if (instance_->pix_fmt != AV_PIX_FMT_YUV420P && instance_->pix_fmt != AV_PIX_FMT_YUVJ420P &&
-      instance_->pix_fmt != AV_PIX_FMT_YUYV422) {
-    LOGE(SOURCE) << "[" << stream_id_ << "]: "
-                 << "FFmpegCpuDecoder only supports AV_PIX_FMT_YUV420P , AV_PIX_FMT_YUVJ420P and AV_PIX_FMT_YUYV422";
+#if LIBAVCODEC_VERSION_INT >= FFMPEG_HWACCEL_VERSION
+  if (hw_device_ctx_ && frame->format == hw_pix_fmt_) {
+    // copied to host, NV12 for most hwaccels
+    av_frame_unref(sw_frame_);
+    if (av_hwframe_transfer_data(sw_frame_, frame, 0) < 0) {
+      LOGE(SOURCE) << "[" << stream_id_ << "]: Failed to copy the frame from the hwaccel device";
+      return false;
+    }
+    sw_frame_->pts = frame->pts;
+    return ProcessFrame(sw_frame_);
+  }
+#endif
+  const AVPixelFormat pix_fmt = static_cast<AVPixelFormat>(frame->format);
+  if (pix_fmt != AV_PIX_FMT_YUV420P && pix_fmt != AV_PIX_FMT_YUVJ420P && pix_fmt != AV_PIX_FMT_YUYV422 &&
+      pix_fmt != AV_PIX_FMT_NV12) {
+    LOGE(SOURCE) << "[" << stream_id_ << "]: FFmpegCpuDecoder only supports AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUVJ420P,"
+                 << " AV_PIX_FMT_YUYV422 and AV_PIX_FMT_NV12";
     return false;
   }
   DecodeFrame cn_frame;
@@ -231,7 +401,7 @@ bool FFmpegCpuDecoder::ProcessFrame(AVFrame *frame) {
 #else
   cn_frame.pts = frame->pts;
 #endif
-  switch (instance_->pix_fmt) {
+  switch (pix_fmt) {
     case AV_PIX_FMT_YUV420P:
       cn_frame.fmt = DecodeFrame::PixFmt::FMT_I420;
       cn_frame.planeNum = 3;
@@ -244,6 +414,10 @@ bool FFmpegCpuDecoder::ProcessFrame(AVFrame *frame) {
       cn_frame.fmt = DecodeFrame::PixFmt::FMT_YUYV;
       cn_frame.planeNum = 1;
       break;
+    case AV_PIX_FMT_NV12:
+      cn_frame.fmt = DecodeFrame::PixFmt::FMT_NV12;
+      cn_frame.planeNum = 2;
+      break;
     default:
       cn_frame.fmt = DecodeFrame::PixFmt::FMT_INVALID;
       cn_frame.planeNum = 0;
@@ -255,6 +429,13 @@ bool FFmpegCpuDecoder::ProcessFrame(AVFrame *frame) {
     cn_frame.plane[i] = frame->data[i];
   }
   cn_frame.buf_ref = nullptr;
+  if (export_mvs_ && frame->pict_type != AV_PICTURE_TYPE_I) {
+    // inter frames without motion vectors are all intra or skipped blocks, scored by MotionActivity as well
+    const AVFrameSideData *side_data = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+    const AVMotionVector *mvs = side_data ? reinterpret_cast<const AVMotionVector *>(side_data->data) : nullptr;
+    const size_t num = side_data ? side_data->size / sizeof(AVMotionVector) : 0;
+    cn_frame.activity = MotionActivity(mvs, num, frame->width, frame->height);
+  }
   if (result_) {
     result_->OnDecodeFrame(&cn_frame);
   }
@@ -23,9 +23,12 @@
 
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "cnstream_memory_accountant.hpp"
+#include "cnstream_resource_manager.hpp"
 #include "video_parser.hpp"
 
 namespace cnstream {
@@ -49,6 +52,7 @@ struct DecodeFrame {
   void *plane[MAX_PLANE_NUM];
   int stride[MAX_PLANE_NUM];
   std::unique_ptr<IDecBufRef> buf_ref = nullptr;
+  float activity = -1;  // see CNDataFrame::activity, only set by FFmpeg decoders exporting motion vectors
 
  public:
   ~DecodeFrame() {}
@@ -62,7 +66,18 @@ struct ExtraDecoderInfo {
   bool apply_stride_align_for_scaler = false;  // for MLU220
   int32_t max_width = 0;   // for jpu
   int32_t max_height = 0;  // for jpu
+  int32_t output_width = 0;   // scaled by the codec (MLU300 only), 0 means the coded width
+  int32_t output_height = 0;  // scaled by the codec (MLU300 only), 0 means the coded height
   std::vector<uint8_t> extra_info;
+  MemoryOwner memory_owner;  // the output buffers of mlu decoders are charged to it
+  std::string pipeline_name;  // the codec channels of mlu decoders are taken for it, see DeviceResourceManager
+  uint32_t resource_timeout_ms = 10000;  // the maximum time to wait for a codec channel
+  // tried in order by mlu decoders when no codec channel is left, "cpu" or an FFmpeg hwaccel, e.g. "vaapi"
+  std::vector<std::string> fallback_decoders;
+  // for FFmpeg decoders, the hwaccel device type, e.g. "vaapi". Empty means decoding on cpu
+  std::string hwaccel;
+  // for FFmpeg cpu decoders, exports the motion vectors to score the activity of frames, see MotionActivity
+  bool export_motion_vectors = false;
 };
 
 // FIXME
@@ -71,6 +86,7 @@ enum class DecodeErrorCode { ERROR_FAILED_TO_START, ERROR_CORRUPT_DATA, ERROR_RE
 class IDecodeResult {
  public:
   virtual ~IDecodeResult() = default;
+  // ERROR_CORRUPT_DATA is not fatal, the decoder skips the corrupt frames and goes on
   virtual void OnDecodeError(DecodeErrorCode error_code) {}
   virtual void OnDecodeFrame(DecodeFrame *frame) = 0;
   virtual void OnDecodeEos() = 0;
@@ -85,8 +101,16 @@ class Decoder {
   virtual void Destroy() = 0;
 
  protected:
+  // charges the NV12 output buffers allocated by the codec, replaces the former charge
+  void ChargeOutputBuffers(const MemoryOwner& owner, uint32_t buf_num, uint32_t width, uint32_t height) {
+    const size_t bytes = static_cast<size_t>(buf_num) * width * height * 3 / 2;
+    output_buf_charge_ = MemoryCharge(MemoryType::DEVICE, bytes, owner);
+  }
+  void ReleaseOutputBuffers() { output_buf_charge_.Release(); }
+
   std::string stream_id_ = "";
   IDecodeResult *result_;
+  MemoryCharge output_buf_charge_;
 };
 
 class MluDecoder : public Decoder {
@@ -104,6 +128,36 @@ class MluDecoder : public Decoder {
   MluDecoder& operator=(const MluDecoder& ) = delete;
   MluDecoder& operator=(MluDecoder&& ) = delete;
   MluDecoderImpl *impl_ = nullptr;
+  std::unique_ptr<ResourceLease> channel_lease_;
+};
+
+/**
+ * The activity of an inter frame from its motion vectors, the ratio of the frame area not covered by static blocks.
+ * Intra blocks and blocks predicted from a moved block are active. Only the blocks predicted from past frames are
+ * counted, so bi-predicted blocks are not counted twice.
+ */
+float MotionActivity(const AVMotionVector *mvs, size_t num, int width, int height);
+
+/**
+ * The threads of the FFmpeg decoders of the process. Each decoder takes a fair share of the budget when it is
+ * created, at least one thread, and gives it back when it is destroyed.
+ */
+class DecodeThreadBudget {
+ public:
+  static DecodeThreadBudget& Instance();
+  explicit DecodeThreadBudget(int total = 0) { SetTotal(total); }
+  // 0 means the number of cpu cores
+  void SetTotal(int total);
+  int GetTotal() const;
+  int Acquire();
+  void Release(int threads);
+
+ private:
+  static constexpr int kMaxThreadsPerDecoder = 8;
+  mutable std::mutex mutex_;
+  int total_ = 1;
+  int used_ = 0;
+  int decoders_ = 0;
 };
 
 class FFmpegCpuDecoder : public Decoder {
@@ -123,8 +177,18 @@ class FFmpegCpuDecoder : public Decoder {
   bool Process(AVPacket *pkt, bool eos);
 
  private:
+  bool InitHwaccel(AVCodec *dec, const std::string& hwaccel);
+  // frees the codec without flushing it
+  void ReleaseCodec();
+  static AVPixelFormat GetHwFormat(AVCodecContext *ctx, const AVPixelFormat *fmts);
+
   AVCodecContext *instance_ = nullptr;
   AVFrame *av_frame_ = nullptr;
+  int threads_ = 0;  // taken from DecodeThreadBudget
+  bool export_mvs_ = false;
+  AVBufferRef *hw_device_ctx_ = nullptr;
+  AVPixelFormat hw_pix_fmt_ = AV_PIX_FMT_NONE;
+  AVFrame *sw_frame_ = nullptr;  // the frame copied from the hwaccel device
   std::atomic<int> eos_got_{0};
   std::atomic<int> eos_sent_{0};
 
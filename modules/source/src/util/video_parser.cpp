@@ -18,12 +18,18 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <sys/stat.h>
+
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include "annexb_parser.hpp"
+#include "cnstream_async_io.hpp"
 #include "cnstream_logging.hpp"
+#include "gop_selector.hpp"
 #include "video_parser.hpp"
 
 CNS_IGNORE_DEPRECATED_PUSH
@@ -45,6 +51,11 @@ namespace cnstream {
 
 #define FFMPEG_VERSION_3_1 AV_VERSION_INT(57, 40, 100)
 
+#define VERSION_LAVF_AVIO_FREE AV_VERSION_INT(57, 80, 100)
+
+// the demuxer reads small chunks from the blocks read ahead by AsyncFileReader
+static constexpr int kIOBufferSize = 1 << 16;
+
 struct local_ffmpeg_init {
   local_ffmpeg_init() {
     avcodec_register_all();
@@ -83,7 +94,7 @@ class FFParserImpl {
     return false;
   }
 
-  int Open(const std::string &url, IParserResult *result, bool only_key_frame = false) {
+  int Open(const std::string &url, IParserResult *result, bool only_key_frame = false, uint32_t gop_interval = 1) {
     std::unique_lock<std::mutex> guard(mutex_);
     if (!result) return -1;
     result_ = result;
@@ -135,10 +146,21 @@ class FFParserImpl {
       av_dict_set(&options_, "max_delay", "500000", 0);
     }
 
+    if (!ifmt && !OpenAsyncFile()) {
+      LOGE(SOURCE) << "[" << stream_id_ << "]: Couldn't open file -- " << url_name_;
+      // the input is not opened yet, so the context is only freed
+      avformat_free_context(fmt_ctx_);
+      fmt_ctx_ = nullptr;
+      av_dict_free(&options_);
+      options_ = nullptr;
+      return -1;
+    }
+
     // open input
     ret_code = avformat_open_input(&fmt_ctx_, url_name_.c_str(), ifmt, &options_);
     if (0 != ret_code) {
       LOGI(SOURCE) << "[" << stream_id_ << "]: Couldn't open input stream -- " << url_name_;
+      CloseAsyncFile();
       return -1;
     }
     // find video stream information
@@ -234,7 +256,7 @@ class FFParserImpl {
     first_frame_ = true;
     eos_reached_ = false;
     open_success_ = true;
-    only_key_frame_ = only_key_frame;
+    selector_ = GopSelector(only_key_frame, gop_interval);
     return 0;
   }
 
@@ -251,6 +273,7 @@ class FFParserImpl {
       options_ = nullptr;
       fmt_ctx_ = nullptr;
     }
+    CloseAsyncFile();
     first_frame_ = true;
     eos_reached_ = false;
     open_success_ = false;
@@ -310,7 +333,7 @@ class FFParserImpl {
         frame.data = packet_.data;
         frame.len = packet_.size;
         frame.pts = packet_.pts;
-        if (!only_key_frame_ || (only_key_frame_ && (frame.flags & AV_PKT_FLAG_KEY))) {
+        if (selector_.Keep(frame.flags & AV_PKT_FLAG_KEY)) {
           result_->OnParserFrame(&frame);
         }
       }
@@ -322,8 +345,76 @@ class FFParserImpl {
     }
   }
 
+  int Seek(int64_t pts) {
+    std::unique_lock<std::mutex> guard(mutex_);
+    if (!open_success_) return -1;
+    AVStream *vstream = fmt_ctx_->streams[video_index_];
+    const int64_t timestamp = av_rescale_q(pts, {1, 90000}, vstream->time_base);
+    if (av_seek_frame(fmt_ctx_, video_index_, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+      LOGW(SOURCE) << "[" << stream_id_ << "]: Couldn't seek to " << pts << " -- " << url_name_;
+      return -1;
+    }
+    first_frame_ = true;  // starts from the key frame
+    eos_reached_ = false;
+    return 0;
+  }
+
+  static int ReadCallback(void* opaque, uint8_t* buf, int buf_size) {
+    int64_t ret = reinterpret_cast<AsyncFileReader*>(opaque)->Read(buf, buf_size);
+    if (ret == 0) return AVERROR_EOF;
+    return ret < 0 ? AVERROR(-ret) : static_cast<int>(ret);
+  }
+
+  static int64_t SeekCallback(void* opaque, int64_t offset, int whence) {
+    AsyncFileReader* reader = reinterpret_cast<AsyncFileReader*>(opaque);
+    if (whence & AVSEEK_SIZE) return reader->Size();
+    switch (whence & ~AVSEEK_FORCE) {
+      case SEEK_SET: break;
+      case SEEK_CUR: offset += reader->Tell(); break;
+      case SEEK_END: offset += reader->Size(); break;
+      default: return AVERROR(EINVAL);
+    }
+    int64_t ret = reader->Seek(offset);
+    return ret < 0 ? AVERROR(-ret) : ret;
+  }
+
+  // Reads a local file through the io ring, so that the demuxer does not block in the reads. Other urls are opened
+  // by ffmpeg, and so are the files if the ring is synchronous. Returns false if the file can not be opened.
+  bool OpenAsyncFile() {
+    struct stat st;
+    if (!IoRing::Instance().IsAsync() || stat(url_name_.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return true;
+    std::unique_ptr<AsyncFileReader> reader(new AsyncFileReader);
+    if (!reader->Open(url_name_)) return false;
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(av_malloc(kIOBufferSize));
+    if (!buffer) return false;
+    avio_ctx_ = avio_alloc_context(buffer, kIOBufferSize, 0, reader.get(), &FFParserImpl::ReadCallback, nullptr,
+                                   &FFParserImpl::SeekCallback);
+    if (!avio_ctx_) {
+      av_free(buffer);
+      return false;
+    }
+    fmt_ctx_->pb = avio_ctx_;
+    reader_ = std::move(reader);
+    return true;
+  }
+
+  // the custom io context is not freed by avformat_close_input
+  void CloseAsyncFile() {
+    if (avio_ctx_) {
+      av_freep(&avio_ctx_->buffer);
+#if LIBAVFORMAT_VERSION_INT < VERSION_LAVF_AVIO_FREE
+      av_freep(&avio_ctx_);
+#else
+      avio_context_free(&avio_ctx_);
+#endif
+    }
+    reader_.reset();
+  }
+
  private:
   AVFormatContext* fmt_ctx_ = nullptr;
+  AVIOContext* avio_ctx_ = nullptr;
+  std::unique_ptr<AsyncFileReader> reader_;
   AVBitStreamFilterContext *bsf_ctx_ = nullptr;
   AVDictionary* options_ = NULL;
   bool first_frame_ = true;
@@ -339,7 +430,7 @@ class FFParserImpl {
   bool eos_reached_ = false;
   bool open_success_ = false;
   std::mutex mutex_;
-  bool only_key_frame_ = false;
+  GopSelector selector_;
 };  // class FFmpegDemuxerImpl  // NOLINT
 
 FFParser::FFParser(const std::string& stream_id) {
@@ -350,9 +441,9 @@ FFParser::~FFParser() {
   if (impl_) delete impl_, impl_ = nullptr;
 }
 
-int FFParser::Open(const std::string &url, IParserResult *result, bool only_key_frame) {
+int FFParser::Open(const std::string &url, IParserResult *result, bool only_key_frame, uint32_t gop_interval) {
   if (impl_) {
-    return impl_->Open(url, result, only_key_frame);
+    return impl_->Open(url, result, only_key_frame, gop_interval);
   }
   return -1;
 }
@@ -370,13 +461,20 @@ int FFParser::Parse() {
   return -1;
 }
 
+int FFParser::Seek(int64_t pts) {
+  if (impl_) {
+    return impl_->Seek(pts);
+  }
+  return -1;
+}
+
 // H264/H265 ES Parser implementation
 class EsParserImpl {
  public:
   EsParserImpl() = default;
   ~EsParserImpl() = default;
   int Open(AVCodecID codec_id, IParserResult *result, uint8_t *paramset = nullptr, uint32_t paramset_size = 0,
-           bool only_key_frame = false) {
+           bool only_key_frame = false, uint32_t gop_interval = 1) {
     std::unique_lock<std::mutex> guard(mutex_);
     codec_id_ = codec_id;
     result_ = result;
@@ -386,77 +484,39 @@ class EsParserImpl {
     if (!result) {
       return -1;
     }
-
-    // create parser...
-    codec_ = avcodec_find_decoder(codec_id_);
-    if (!codec_) {
-      return -1;
-    }
-    codec_ctx_ = avcodec_alloc_context3(codec_);
-    if (!codec_ctx_){
+    if (!parser_.Open(codec_id_)) {
       return -1;
     }
-    codec_ctx_->time_base.den = 90000;
-    codec_ctx_->time_base.num = 1;
 
     if (paramset && paramset_size) {
       paramset_ = std::vector<uint8_t>(paramset, paramset + paramset_size);
-      codec_ctx_->extradata = paramset_.data();
-      codec_ctx_->extradata_size = paramset_.size();
+      parser_.ParseParameterSets(paramset_.data(), paramset_.size());
     }
-
-    if (avcodec_open2(codec_ctx_, codec_, NULL) < 0) {
-      return -1;
-    }
-
-    parser_ctx_ = av_parser_init(codec_id_);
-    if (!parser_ctx_) {
-      return -1;
-    }
-    frame_ = av_frame_alloc();
-    if (!frame_) {
-      return -1;
-    }
-    av_init_packet(&packet_);
+    first_time_ = true;
     open_success_ = true;
-    only_key_frame_ = only_key_frame;
+    selector_ = GopSelector(only_key_frame, gop_interval);
     return 0;
   }
   void Close() {
     std::unique_lock<std::mutex> guard(mutex_);
-    if (parser_ctx_) {
-      av_parser_close(parser_ctx_);
-      parser_ctx_ = nullptr;
-    }
-    if (frame_) {
-      av_frame_free(&frame_);
-      frame_ = nullptr;
-    }
-    if (codec_ctx_) {
-      codec_ctx_->extradata = nullptr;
-      codec_ctx_->extradata_size = 0;
-      avcodec_close(codec_ctx_);
-      av_free(codec_ctx_);
-      codec_ctx_ = nullptr;
-    }
     open_success_ = false;
   }
   void ParseEos();
+  /* outputs the last frame held by the parser */
+  void Flush();
   int Parse(const VideoEsPacket &pkt);
 
  private:
+  void OnAccessUnit(const AnnexBParser::AccessUnit &au);
+
   AVCodecID codec_id_;
   IParserResult *result_;
-  AVCodec *codec_ = nullptr;
-  AVCodecContext *codec_ctx_ = nullptr;
-  AVCodecParserContext *parser_ctx_ = nullptr;
-  AVFrame *frame_ = nullptr;
-  AVPacket packet_;
+  AnnexBParser parser_;
   std::vector<uint8_t> paramset_;
   bool first_time_ = true;
   bool open_success_ = false;
   std::mutex mutex_;
-  bool only_key_frame_ = false;
+  GopSelector selector_;
 };  // class StreamParserImpl
 
 EsParser::EsParser() {
@@ -468,9 +528,9 @@ EsParser::~EsParser() {
 }
 
 int EsParser::Open(AVCodecID codec_id, IParserResult *result, uint8_t *paramset, uint32_t paramset_size,
-                   bool only_key_frame) {
+                   bool only_key_frame, uint32_t gop_interval) {
   if (impl_) {
-    return impl_->Open(codec_id, result, paramset, paramset_size, only_key_frame);
+    return impl_->Open(codec_id, result, paramset, paramset_size, only_key_frame, gop_interval);
   }
   return -1;
 }
@@ -489,6 +549,7 @@ int EsParser::Parse(const VideoEsPacket &pkt) {
 }
 int EsParser::ParseEos() {
   if (impl_) {
+    impl_->Flush();
     impl_->ParseEos();
     return 0;
   }
@@ -505,6 +566,13 @@ inline void EsParserImpl::ParseEos() {
   }
 }
 
+void EsParserImpl::Flush() {
+  std::unique_lock<std::mutex> guard(mutex_);
+  if (open_success_) {
+    parser_.Flush([this](const AnnexBParser::AccessUnit &au) { OnAccessUnit(au); });
+  }
+}
+
 int EsParserImpl::Parse(const VideoEsPacket &pkt) {
   std::unique_lock<std::mutex> guard(mutex_);
   if (!open_success_) {
@@ -512,81 +580,41 @@ int EsParserImpl::Parse(const VideoEsPacket &pkt) {
     return 0;
   }
 
-  uint8_t *cur_ptr = pkt.data;
-  int cur_size = pkt.len;
-
-  do {
-    int len = av_parser_parse2(parser_ctx_, codec_ctx_, &packet_.data, &packet_.size,
-                               cur_ptr, cur_size, pkt.pts, AV_NOPTS_VALUE, AV_NOPTS_VALUE);
-    cur_ptr += len;
-    cur_size -= len;
-    if (packet_.size == 0)
-      continue;
+  auto func = [this](const AnnexBParser::AccessUnit &au) { OnAccessUnit(au); };
+  if (!pkt.data || !pkt.len) {
+    parser_.Flush(func);
+    ParseEos();
+    return 0;
+  }
+  parser_.Parse(pkt.data, pkt.len, pkt.pts, func);
+  return 0;
+}
 
-    if (parser_ctx_->pict_type == AV_PICTURE_TYPE_I) {
-      packet_.flags |= AV_PKT_FLAG_KEY;
+void EsParserImpl::OnAccessUnit(const AnnexBParser::AccessUnit &au) {
+  if (first_time_) {
+    if (!au.key_frame) return;
+    cnstream::VideoInfo info;
+    info.codec_id = codec_id_;
+    // from the sequence parameter set, the first frame is not decoded
+    info.progressive = parser_.Progressive() ? 1 : 0;
+    info.extra_data = paramset_;
+    if (result_) {
+      result_->OnParserInfo(&info);
     }
-    packet_.pts = parser_ctx_->pts != AV_NOPTS_VALUE ? parser_ctx_->pts : parser_ctx_->last_pts;
-
-    if (first_time_) {
-      if (!(packet_.flags & AV_PKT_FLAG_KEY)) {
-        av_packet_unref(&packet_);
-        continue;
-      }
-      int got_picture = 0;
-      int ret = avcodec_decode_video2(codec_ctx_, frame_, &got_picture, &packet_);
-      if (ret < 0) {
-        if (result_) {
-          result_->OnParserInfo(nullptr);
-        }
-        av_packet_unref(&packet_);
-        return ret;
-      }
-      cnstream::VideoInfo info;
-      info.codec_id = codec_id_;
-      switch (codec_ctx_->field_order) {
-      case AV_FIELD_TT:
-      case AV_FIELD_BB:
-      case AV_FIELD_TB:
-      case AV_FIELD_BT:
-        info.progressive = 0;
-        break;
-      case AV_FIELD_PROGRESSIVE:  // fall through
-      default:
-        info.progressive = 1;
-        break;
-      }
-
-      // info.width = codec_ctx_->width;
-      // info.height = codec_ctx_->height;
-
-      info.extra_data = paramset_;
+    first_time_ = false;
+  }
 
-      if (result_) {
-        result_->OnParserInfo(&info);
-      }
-      first_time_ = false;
-    }
+  if (result_) {
+    VideoEsFrame frame;
+    frame.data = const_cast<uint8_t *>(au.data);
+    frame.len = au.len;
+    frame.pts = au.pts;
+    frame.flags = au.key_frame ? AV_PKT_FLAG_KEY : 0;
 
-    if (result_) {
-      VideoEsFrame frame;
-      frame.data = packet_.data;
-      frame.len = packet_.size;
-      frame.pts = packet_.pts;
-      frame.flags = packet_.flags;
-
-      if (!only_key_frame_ || (only_key_frame_ && (frame.flags & AV_PKT_FLAG_KEY))) {
-        result_->OnParserFrame(&frame);
-      }
+    if (selector_.Keep(au.key_frame)) {
+      result_->OnParserFrame(&frame);
     }
-    av_packet_unref(&packet_);
-  } while (cur_size > 0);
-
-  if (!pkt.data || !pkt.len) {
-    ParseEos();
   }
-
-  return 0;
 }
 
 }  // namespace cnstream
@@ -81,6 +81,8 @@ struct VideoEsPacket {
   uint8_t *data = nullptr;
   size_t len = 0;
   int64_t pts = -1;
+  uint32_t flags = 0;
+  enum {FLAG_KEY_FRAME = 0x01};
 };
 
 // FFmpeg demuxer and parser
@@ -89,9 +91,12 @@ class FFParser {
  public:
   explicit FFParser(const std::string& stream_id);
   ~FFParser();
-  int Open(const std::string& url, IParserResult* result, bool only_key_frame = false);
+  /* gop_interval: one of every gop_interval GOPs is sent to the result, see GopSelector */
+  int Open(const std::string& url, IParserResult* result, bool only_key_frame = false, uint32_t gop_interval = 1);
   void Close();
   int Parse();
+  /* moves to the key frame at or before pts (in 1/90000 seconds), returns -1 if the input is not seekable */
+  int Seek(int64_t pts);
 
  private:
   FFParser(const FFParser& ) = delete;
@@ -108,7 +113,7 @@ class EsParser {
   EsParser();
   ~EsParser();
   int Open(AVCodecID codec_id, IParserResult* result, uint8_t* paramset = nullptr, uint32_t paramset_size = 0,
-           bool only_key_frame = false);
+           bool only_key_frame = false, uint32_t gop_interval = 1);
   void Close();
   int Parse(const VideoEsPacket &pkt);
   int ParseEos();
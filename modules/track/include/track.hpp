@@ -29,16 +29,20 @@
 #include <memory>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "cnstream_frame.hpp"
+#include "cnstream_frame_va.hpp"
 #include "cnstream_module.hpp"
-#include "easytrack/easy_track.h"
+#include "util/cnstream_stream_context_pool.hpp"
 
 namespace infer_server { class ModelInfo; }
 
 namespace cnstream {
 
 struct TrackerContext;
+struct TrackWorker;
+class FeatureExtractor;
 
 /**
  * @class Tracker
@@ -93,6 +97,22 @@ class Tracker : public Module, public ModuleCreator<Tracker> {
    */
   int Process(std::shared_ptr<CNFrameInfo> data) override;
 
+  /**
+   * @brief Checks whether the pixels of frames are read, only FeatureMatch extracts features from the pixels.
+   *
+   * @return Returns true if the tracker is FeatureMatch.
+   */
+  bool NeedsPixels() const override { return need_feature_; }
+
+  /**
+   * @brief Binds a context to the stream ahead, so that its first frame is tracked without creating one.
+   *
+   * @param[in] stream_id The stream identification.
+   *
+   * @return No return value.
+   */
+  void OnStreamAdded(const std::string &stream_id) override;
+
   /**
    * @brief Checks the parameters for a module.
    *
@@ -104,10 +124,15 @@ class Tracker : public Module, public ModuleCreator<Tracker> {
 
  private:
   bool InitFeatureExtractor(const CNFrameInfoPtr &data);
+  FeatureExtractor *GetFeatureExtractor();
   TrackerContext *GetContext(const CNFrameInfoPtr &data);
-  std::map<int, TrackerContext *> contexts_;
+  bool InitContexts();
+  int ProcessFrame(const CNFrameInfoPtr &data);
+  void WorkerLoop(TrackWorker *worker);
+  StreamContextPool<TrackerContext> context_pool_;
+  std::vector<TrackerContext *> contexts_;  // indexed by stream index, bound on the first frame of the stream
+  std::vector<std::unique_ptr<TrackWorker>> workers_;
   std::shared_ptr<infer_server::ModelInfo> model_ = nullptr;
-  std::mutex mutex_;
   std::function<void(const CNFrameInfoPtr, bool)> match_func_;
   int device_id_ = 0;
   std::string model_pattern1_ = "";
@@ -115,6 +140,15 @@ class Tracker : public Module, public ModuleCreator<Tracker> {
   std::string track_name_ = "";
   float max_cosine_distance_ = 0.2;
   int engine_num_ = 1;
+  uint32_t batch_timeout_ = 100;
+  int feature_reuse_frames_ = 0;
+  int thread_num_ = 0;
+  int warm_contexts_ = -1;
+  bool drop_tentative_ = false;
+  float min_score_ = 0;
+  CNFeaturePrecision feature_precision_ = CNFeaturePrecision::FP32;
+  std::mutex extractor_mutex_;
+  std::unique_ptr<FeatureExtractor> mlu_extractor_ = nullptr;  // shared by all threads
   bool need_feature_ = true;
 };  // class Tracker
 
@@ -27,6 +27,8 @@
 #include <opencv2/imgcodecs/imgcodecs.hpp>
 #endif
 
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
 #include <utility>
@@ -34,10 +36,13 @@
 
 #include "cnis/processor.h"
 #include "cnis/contrib/video_helper.h"
+#include "private/cnstream_parallel.hpp"
 
 namespace cnstream {
 
 const int kFeatureSizeForCpu = 512;
+// the longer side of objects is downscaled to it before ORB runs on CPU
+const int kMaxCropSizeForCpu = 128;
 
 class FeatureObserver : public infer_server::Observer {
  public:
@@ -52,8 +57,9 @@ class FeatureObserver : public infer_server::Observer {
 };
 
 FeatureExtractor::FeatureExtractor(const std::shared_ptr<infer_server::ModelInfo>& model,
-                                   std::function<void(const CNFrameInfoPtr, bool)> callback, int device_id)
-    : model_(model), callback_(callback) {
+                                   std::function<void(const CNFrameInfoPtr, bool)> callback, int device_id,
+                                   CNFeaturePrecision precision)
+    : model_(model), callback_(callback), precision_(precision) {
   if (!model_) {
     LOGI(TRACK) << "[FeatureExtractor] Model not set, using opencv to extract feature on CPU";
   } else {
@@ -80,7 +86,7 @@ FeatureExtractor::~FeatureExtractor() {
   if (session_) server_->DestroySession(session_);
 }
 
-bool FeatureExtractor::Init(int engine_num) {
+bool FeatureExtractor::Init(int engine_num, uint32_t batch_timeout) {
   if (!model_) {
     return true;
   }
@@ -94,7 +100,7 @@ bool FeatureExtractor::Init(int engine_num) {
   desc.engine_num = engine_num;
   desc.strategy = infer_server::BatchStrategy::DYNAMIC;
   desc.model = model_;
-  desc.batch_timeout = 100;
+  desc.batch_timeout = batch_timeout;
   desc.show_perf = false;
   desc.name = "Track/FeatureExtractor";
   desc.preproc = infer_server::video::PreprocessorMLU::Create();
@@ -109,13 +115,14 @@ bool FeatureExtractor::Init(int engine_num) {
                             infer_server::video::PreprocessType::RESIZE_CONVERT);
   }
 
-  auto postproc_func = [](infer_server::InferData* data, const infer_server::ModelIO& model_output,
-                          const infer_server::ModelInfo* model) {
+  const CNFeaturePrecision precision = precision_;
+  auto postproc_func = [precision](infer_server::InferData* data, const infer_server::ModelIO& model_output,
+                                   const infer_server::ModelInfo* model) {
     const float* res = reinterpret_cast<const float*>(model_output.buffers[0].Data());
     std::vector<float> feat;
     feat.insert(feat.end(), res, res + model_output.shapes[0].DataCount());
     CNInferObjectPtr obj = data->GetUserData<CNInferObjectPtr>();
-    obj->AddFeature("track", std::move(feat));
+    obj->AddFeature("track", feat, precision);
     return true;
   };
   desc.postproc->SetParams("process_function", infer_server::Postprocessor::ProcessFunction(postproc_func));
@@ -139,25 +146,30 @@ void FeatureExtractor::WaitTaskDone(const std::string& stream_id) {
 }
 
 bool FeatureExtractor::ExtractFeature(const CNFrameInfoPtr& info) {
+  std::vector<std::shared_ptr<CNInferObject>> objs;
+  if (info->collection.HasValue(kCNInferObjsSlot)) {
+    objs = info->collection.Get(kCNInferObjsSlot)->objs_;
+  }
+  return ExtractFeature(info, objs);
+}
+
+bool FeatureExtractor::ExtractFeature(const CNFrameInfoPtr& info, const std::vector<CNInferObjectPtr>& objs) {
   if (!model_) {
-    return ExtractFeatureOnCpu(info);
+    return ExtractFeatureOnCpu(info, objs);
   } else {
-    return ExtractFeatureOnMlu(info);
+    return ExtractFeatureOnMlu(info, objs);
   }
 }
 
-bool FeatureExtractor::ExtractFeatureOnMlu(const CNFrameInfoPtr& info) {
+bool FeatureExtractor::ExtractFeatureOnMlu(const CNFrameInfoPtr& info,
+                                           const std::vector<CNInferObjectPtr>& objs) {
   if (!is_initialized_) {
     LOGW(TRACK) << "[FeatureExtractor] Please Init first.";
     return false;
   }
-  std::vector<std::shared_ptr<CNInferObject>> objs;
-  if (info->collection.HasValue(kCNInferObjsTag)) {
-    objs = info->collection.Get<CNInferObjsPtr>(kCNInferObjsTag)->objs_;
-  }
   infer_server::video::VideoFrame vframe;
   if (objs.size()) {
-    const CNDataFramePtr& frame = info->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+    const CNDataFramePtr& frame = info->collection.Get(kCNDataFrameSlot);
     if (frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 &&
         frame->fmt != CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21) {
       LOGE(TRACK) << "Frame format only support NV12 / NV21.";
@@ -202,44 +214,86 @@ bool FeatureExtractor::ExtractFeatureOnMlu(const CNFrameInfoPtr& info) {
   return true;
 }
 
-bool FeatureExtractor::ExtractFeatureOnCpu(const CNFrameInfoPtr& info) {
-  const CNDataFramePtr& frame = info->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
-  std::vector<std::shared_ptr<CNInferObject>> objs;
-  if (info->collection.HasValue(kCNInferObjsTag)) {
-    objs = info->collection.Get<CNInferObjsPtr>(kCNInferObjsTag)->objs_;
-  }
-  const cv::Mat image = frame->ImageBGR();
-  for (uint32_t num = 0; num < objs.size(); ++num) {
-    auto& obj = objs[num];
-    cv::Rect rect = cv::Rect(obj->bbox.x * image.cols, obj->bbox.y * image.rows, obj->bbox.w * image.cols,
-                             obj->bbox.h * image.rows);
-    cv::Mat obj_img(image, rect);
+// the gray image of the frame, YUV frames use the Y plane directly
+static cv::Mat FrameGray(const CNDataFramePtr& frame) {
+  if (frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12 ||
+      frame->fmt == CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21) {
+    return cv::Mat(frame->height, frame->width, CV_8UC1, const_cast<void*>(frame->data[0]->GetCpuData()),
+                   frame->stride[0]);
+  }
+  cv::Mat gray;
+  cv::cvtColor(frame->ImageBGR(), gray, cv::COLOR_BGR2GRAY);
+  return gray;
+}
+
+static cv::Ptr<cv::ORB> GetOrb() {
+  // ORB instances are reused by each thread
+  thread_local cv::Ptr<cv::ORB> processer;
+  if (processer.empty()) {
 #if (CV_MAJOR_VERSION == 2)  // NOLINT
-    cv::Ptr<cv::ORB> processer = new cv::ORB(kFeatureSizeForCpu);
+    processer = new cv::ORB(kFeatureSizeForCpu);
 #elif (CV_MAJOR_VERSION >= 3)  //  NOLINT
-    cv::Ptr<cv::ORB> processer = cv::ORB::create(kFeatureSizeForCpu);
+    processer = cv::ORB::create(kFeatureSizeForCpu);
 #endif
+  }
+  return processer;
+}
+
+bool FeatureExtractor::ExtractFeatureOnCpu(const CNFrameInfoPtr& info,
+                                           const std::vector<CNInferObjectPtr>& objs) {
+  const CNDataFramePtr& frame = info->collection.Get(kCNDataFrameSlot);
+  if (objs.empty()) {
+    callback_(info, true);
+    return true;
+  }
+  const cv::Mat image = FrameGray(frame);
+  const cv::Rect image_rect(0, 0, image.cols, image.rows);
+  // objects are processed concurrently by the shared pool, each object is processed by one thread.
+  ParallelFor(objs.size(), 1, 1, [&](int begin, int end) {
+    cv::Ptr<cv::ORB> processer = GetOrb();
     std::vector<cv::KeyPoint> keypoints;
-    processer->detect(obj_img, keypoints);
-    cv::Mat desc;
-    processer->compute(obj_img, keypoints, desc);
-    std::vector<float> feature;
-    feature.reserve(kFeatureSizeForCpu);
-    for (int i = 0; i < kFeatureSizeForCpu; i++) {
-      feature.push_back((i < desc.rows ? CalcFeatureOfRow(desc, i) : 0));
+    cv::Mat obj_img, desc;
+    for (int num = begin; num < end; ++num) {
+      auto& obj = objs[num];
+      cv::Rect rect = cv::Rect(obj->bbox.x * image.cols, obj->bbox.y * image.rows, obj->bbox.w * image.cols,
+                               obj->bbox.h * image.rows) & image_rect;
+      keypoints.clear();
+      desc.release();
+      if (rect.area() > 0) {
+        // large objects are downscaled, the cost of ORB grows with the area
+        const double scale = static_cast<double>(kMaxCropSizeForCpu) / std::max(rect.width, rect.height);
+        if (scale < 1) {
+          cv::resize(image(rect), obj_img, cv::Size(), scale, scale, cv::INTER_AREA);
+        } else {
+          obj_img = image(rect);
+        }
+        processer->detect(obj_img, keypoints);
+        processer->compute(obj_img, keypoints, desc);
+      }
+      std::vector<float> feature;
+      feature.reserve(kFeatureSizeForCpu);
+      for (int i = 0; i < kFeatureSizeForCpu; i++) {
+        feature.push_back((i < desc.rows ? CalcFeatureOfRow(desc, i) : 0));
+      }
+      obj->AddFeature("track", feature, precision_);
     }
-    obj->AddFeature("track", std::move(feature));
-  }
+  });
   callback_(info, true);
   return true;
 }
 
 float FeatureExtractor::CalcFeatureOfRow(const cv::Mat& image, int n) {
+  // the value of each byte, bytes greater than 127 are positive and the others are negative
+  static const std::array<float, 256> kTable = [] {
+    std::array<float, 256> table;
+    for (int grey = 0; grey < 256; ++grey) {
+      table[grey] = grey > 127 ? static_cast<float>(grey) / 255 : -static_cast<float>(grey) / 255;
+    }
+    return table;
+  }();
+  const uchar* row = image.ptr<uchar>(n);
   float result = 0;
-  for (int i = 0; i < image.cols; i++) {
-    int grey = image.ptr<uchar>(n)[i];
-    result += grey > 127 ? static_cast<float>(grey) / 255 : -static_cast<float>(grey) / 255;
-  }
+  for (int i = 0; i < image.cols; i++) result += kTable[row[i]];
   return result;
 }
 
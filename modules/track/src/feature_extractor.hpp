@@ -39,12 +39,24 @@ using CNInferObjectPtr = std::shared_ptr<CNInferObject>;
 
 class FeatureExtractor {
  public:
-  explicit FeatureExtractor(std::function<void(const CNFrameInfoPtr, bool)> callback) : callback_(callback) {}
+  explicit FeatureExtractor(std::function<void(const CNFrameInfoPtr, bool)> callback,
+                            CNFeaturePrecision precision = CNFeaturePrecision::FP32)
+      : callback_(callback), precision_(precision) {}
   FeatureExtractor(const std::shared_ptr<infer_server::ModelInfo>& model,
-                   std::function<void(const CNFrameInfoPtr, bool)> callback, int device_id = 0);
+                   std::function<void(const CNFrameInfoPtr, bool)> callback, int device_id = 0,
+                   CNFeaturePrecision precision = CNFeaturePrecision::FP32);
   ~FeatureExtractor();
 
-  bool Init(int engine_num);
+  /*******************************************************
+   * @brief creates the inference session on MLU
+   * @param
+   *   engine_num[in] the number of inference engines
+   *   batch_timeout[in] the longest time (ms) to wait for objects to form a batch
+   * @return true if success, otherwise false
+   * @note objects of the frames from all streams are batched together, the callback of a frame is called once
+   *       the objects of the frame are done.
+   * *****************************************************/
+  bool Init(int engine_num, uint32_t batch_timeout = 100);
   /*******************************************************
    * @brief inference and extract features of objects
    * @param
@@ -52,12 +64,20 @@ class FeatureExtractor {
    * @return true if success, otherwise false
    * *****************************************************/
   bool ExtractFeature(const CNFrameInfoPtr& info);
+  /*******************************************************
+   * @brief inference and extract features of a part of objects
+   * @param
+   *   frame[in] full frame info
+   *   objs[in] the objects whose features need to be extracted, the callback is called once they are done
+   * @return true if success, otherwise false
+   * *****************************************************/
+  bool ExtractFeature(const CNFrameInfoPtr& info, const std::vector<CNInferObjectPtr>& objs);
 
   void WaitTaskDone(const std::string& stream_id);
 
  private:
-  bool ExtractFeatureOnMlu(const CNFrameInfoPtr& info);
-  bool ExtractFeatureOnCpu(const CNFrameInfoPtr& info);
+  bool ExtractFeatureOnMlu(const CNFrameInfoPtr& info, const std::vector<CNInferObjectPtr>& objs);
+  bool ExtractFeatureOnCpu(const CNFrameInfoPtr& info, const std::vector<CNInferObjectPtr>& objs);
   float CalcFeatureOfRow(const cv::Mat& image, int n);
 
   std::shared_ptr<infer_server::ModelInfo> model_{nullptr};
@@ -65,6 +85,7 @@ class FeatureExtractor {
   infer_server::Session_t session_{nullptr};
   std::function<void(const CNFrameInfoPtr, bool)> callback_{nullptr};
   int device_id_;
+  CNFeaturePrecision precision_;  // the precision the features are stored in
   bool is_initialized_ = false;
 };  // class FeatureExtractor
 
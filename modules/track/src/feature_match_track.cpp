@@ -0,0 +1,624 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "feature_match_track.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+namespace {
+
+constexpr double kStdWeightPosition = 1. / 20;
+constexpr double kStdWeightVelocity = 1. / 160;
+// the 0.95 quantile of the chi-square distribution with 4 degrees of freedom
+constexpr double kGatingThreshold = 9.4877;
+constexpr float kInfiniteCost = std::numeric_limits<float>::max();
+constexpr float kMinBoxSize = 1e-4;
+// detections are matched without features if the IoU with a track is at least kReuseIoU, and the IoUs with other
+// tracks and of other detections with the track are less than kAmbiguousIoU.
+constexpr float kReuseIoU = 0.7;
+constexpr float kAmbiguousIoU = 0.1;
+// the maximum number of cells of each side of the grid gating IoU matching
+constexpr int kMaxGridSize = 32;
+
+// state (cx, cy, aspect ratio, h) and their velocities, measurement (cx, cy, aspect ratio, h).
+struct KalmanState {
+  double mean[8];
+  double cov[8][8];
+};
+
+bool Invert4(const double m[4][4], double inv[4][4]) {
+  double a[4][8];
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      a[i][j] = m[i][j];
+      a[i][j + 4] = i == j ? 1 : 0;
+    }
+  }
+  for (int col = 0; col < 4; ++col) {
+    int pivot = col;
+    for (int r = col + 1; r < 4; ++r) {
+      if (std::fabs(a[r][col]) > std::fabs(a[pivot][col])) pivot = r;
+    }
+    if (std::fabs(a[pivot][col]) < 1e-30) return false;
+    if (pivot != col) {
+      for (int j = 0; j < 8; ++j) std::swap(a[col][j], a[pivot][j]);
+    }
+    const double scale = 1. / a[col][col];
+    for (int j = 0; j < 8; ++j) a[col][j] *= scale;
+    for (int r = 0; r < 4; ++r) {
+      if (r == col || a[r][col] == 0) continue;
+      const double f = a[r][col];
+      for (int j = 0; j < 8; ++j) a[r][j] -= f * a[col][j];
+    }
+  }
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) inv[i][j] = a[i][j + 4];
+  }
+  return true;
+}
+
+void KalmanInitiate(const double z[4], KalmanState *s) {
+  memset(s, 0, sizeof(*s));
+  for (int i = 0; i < 4; ++i) s->mean[i] = z[i];
+  const double h = z[3];
+  const double std[8] = {2 * kStdWeightPosition * h,  2 * kStdWeightPosition * h,  1e-2, 2 * kStdWeightPosition * h,
+                         10 * kStdWeightVelocity * h, 10 * kStdWeightVelocity * h, 1e-5, 10 * kStdWeightVelocity * h};
+  for (int i = 0; i < 8; ++i) s->cov[i][i] = std[i] * std[i];
+}
+
+void KalmanPredict(KalmanState *s) {
+  const double h = s->mean[3];
+  const double std[8] = {kStdWeightPosition * h, kStdWeightPosition * h, 1e-2, kStdWeightPosition * h,
+                         kStdWeightVelocity * h, kStdWeightVelocity * h, 1e-5, kStdWeightVelocity * h};
+  for (int i = 0; i < 4; ++i) s->mean[i] += s->mean[i + 4];
+  // cov = F * cov * F^T + Q, F = [[I, I], [0, I]]
+  double tmp[8][8];
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 8; ++j) tmp[i][j] = s->cov[i][j] + (i < 4 ? s->cov[i + 4][j] : 0);
+  }
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 8; ++j) s->cov[i][j] = tmp[i][j] + (j < 4 ? tmp[i][j + 4] : 0);
+    s->cov[i][i] += std[i] * std[i];
+  }
+}
+
+// the inverse of the innovation covariance H * cov * H^T + R
+bool KalmanInnovationInverse(const KalmanState &s, double inv[4][4]) {
+  const double h = s.mean[3];
+  const double std[4] = {kStdWeightPosition * h, kStdWeightPosition * h, 1e-1, kStdWeightPosition * h};
+  double cov[4][4];
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) cov[i][j] = s.cov[i][j];
+    cov[i][i] += std[i] * std[i];
+  }
+  return Invert4(cov, inv);
+}
+
+double GatingDistance(const KalmanState &s, const double inv[4][4], const double z[4]) {
+  double d[4];
+  for (int i = 0; i < 4; ++i) d[i] = z[i] - s.mean[i];
+  double dist = 0;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) dist += d[i] * inv[i][j] * d[j];
+  }
+  return dist;
+}
+
+void KalmanUpdate(KalmanState *s, const double z[4]) {
+  double inv[4][4];
+  if (!KalmanInnovationInverse(*s, inv)) return;
+  // gain = cov * H^T * inv, cov * H^T is the first 4 columns of cov
+  double gain[8][4];
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      gain[i][j] = 0;
+      for (int k = 0; k < 4; ++k) gain[i][j] += s->cov[i][k] * inv[k][j];
+    }
+  }
+  double innovation[4];
+  for (int i = 0; i < 4; ++i) innovation[i] = z[i] - s->mean[i];
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 4; ++j) s->mean[i] += gain[i][j] * innovation[j];
+  }
+  // cov = cov - gain * (cov * H^T)^T
+  double tmp[8][8];
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 8; ++j) {
+      tmp[i][j] = s->cov[i][j];
+      for (int k = 0; k < 4; ++k) tmp[i][j] -= gain[i][k] * s->cov[j][k];
+    }
+  }
+  memcpy(s->cov, tmp, sizeof(tmp));
+}
+
+// the box (x, y, w, h) of the state predicted steps frames later
+void StateBox(const KalmanState &s, int steps, double box[4]) {
+  const double cx = s.mean[0] + steps * s.mean[4], cy = s.mean[1] + steps * s.mean[5];
+  const double h = s.mean[3] + steps * s.mean[7], w = (s.mean[2] + steps * s.mean[6]) * h;
+  box[0] = cx - w / 2;
+  box[1] = cy - h / 2;
+  box[2] = w;
+  box[3] = h;
+}
+
+float IoU(const double box[4], const TrackDetection &det) {
+  const double x = box[0], y = box[1], w = box[2], h = box[3];
+  const double iw = std::min(x + w, static_cast<double>(det.x + det.w)) - std::max(x, static_cast<double>(det.x));
+  const double ih = std::min(y + h, static_cast<double>(det.y + det.h)) - std::max(y, static_cast<double>(det.y));
+  if (iw <= 0 || ih <= 0) return 0;
+  const double inter = iw * ih;
+  const double uni = w * h + det.w * det.h - inter;
+  return uni > 0 ? inter / uni : 0;
+}
+
+// Solves the assignment problem of a rows * cols cost matrix (rows <= cols) by the shortest augmenting path
+// algorithm. Each row is assigned to a column.
+void SolveAssignment(const float *cost, int rows, int cols, std::vector<int> *row_to_col) {
+  const double inf = std::numeric_limits<double>::max();
+  std::vector<double> u(rows + 1, 0), v(cols + 1, 0), min_v(cols + 1);
+  std::vector<int> p(cols + 1, 0), way(cols + 1, 0);
+  std::vector<char> used(cols + 1);
+  for (int i = 1; i <= rows; ++i) {
+    p[0] = i;
+    int j0 = 0;
+    std::fill(min_v.begin(), min_v.end(), inf);
+    std::fill(used.begin(), used.end(), 0);
+    do {
+      used[j0] = 1;
+      const int i0 = p[j0];
+      double delta = inf;
+      int j1 = 0;
+      for (int j = 1; j <= cols; ++j) {
+        if (used[j]) continue;
+        const double cur = cost[(i0 - 1) * cols + j - 1] - u[i0] - v[j];
+        if (cur < min_v[j]) {
+          min_v[j] = cur;
+          way[j] = j0;
+        }
+        if (min_v[j] < delta) {
+          delta = min_v[j];
+          j1 = j;
+        }
+      }
+      for (int j = 0; j <= cols; ++j) {
+        if (used[j]) {
+          u[p[j]] += delta;
+          v[j] -= delta;
+        } else {
+          min_v[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (p[j0] != 0);
+    do {
+      const int j1 = way[j0];
+      p[j0] = p[j1];
+      j0 = j1;
+    } while (j0);
+  }
+  row_to_col->assign(rows, -1);
+  for (int j = 1; j <= cols; ++j) {
+    if (p[j]) (*row_to_col)[p[j] - 1] = j - 1;
+  }
+}
+
+// Matches tracks and detections with the minimum total cost. Pairs with a cost greater than max_distance are not
+// matched. The matched detections are removed from dets.
+template <typename CostFunc>
+void MinCostMatching(CostFunc cost_func, float max_distance, const std::vector<int> &tracks, std::vector<int> *dets,
+                     std::vector<std::pair<int, int>> *matches, std::vector<int> *unmatched_tracks,
+                     std::vector<float> *cost, std::vector<int> *assignment) {
+  if (tracks.empty() || dets->empty()) {
+    unmatched_tracks->insert(unmatched_tracks->end(), tracks.begin(), tracks.end());
+    return;
+  }
+  const bool transposed = tracks.size() > dets->size();
+  const int rows = transposed ? dets->size() : tracks.size();
+  const int cols = transposed ? tracks.size() : dets->size();
+  const float max_cost = max_distance + 1e-5f;
+  cost->resize(rows * cols);
+  for (size_t t = 0; t < tracks.size(); ++t) {
+    for (size_t d = 0; d < dets->size(); ++d) {
+      const float c = std::min(cost_func(tracks[t], (*dets)[d]), max_cost);
+      if (transposed) {
+        (*cost)[d * cols + t] = c;
+      } else {
+        (*cost)[t * cols + d] = c;
+      }
+    }
+  }
+  SolveAssignment(cost->data(), rows, cols, assignment);
+  std::vector<char> track_matched(tracks.size(), 0), det_matched(dets->size(), 0);
+  for (int r = 0; r < rows; ++r) {
+    const int c = (*assignment)[r];
+    if (c < 0 || (*cost)[r * cols + c] > max_distance) continue;
+    const int t = transposed ? c : r, d = transposed ? r : c;
+    track_matched[t] = 1;
+    det_matched[d] = 1;
+    matches->emplace_back(tracks[t], (*dets)[d]);
+  }
+  for (size_t t = 0; t < tracks.size(); ++t) {
+    if (!track_matched[t]) unmatched_tracks->push_back(tracks[t]);
+  }
+  size_t remain = 0;
+  for (size_t d = 0; d < dets->size(); ++d) {
+    if (!det_matched[d]) (*dets)[remain++] = (*dets)[d];
+  }
+  dets->resize(remain);
+}
+
+int FindRoot(std::vector<int> *parent, int node) {
+  while ((*parent)[node] != node) {
+    (*parent)[node] = (*parent)[(*parent)[node]];
+    node = (*parent)[node];
+  }
+  return node;
+}
+
+}  // namespace
+
+struct FeatureMatchTracker::Track {
+  int id;
+  int label;
+  KalmanState kf;
+  int hits = 1;
+  int time_since_update = 0;
+  bool confirmed = false;
+  bool deleted = false;
+  FeatureMatrix gallery;  // the latest nn_budget features
+  size_t gallery_next = 0;
+  int reused_frames = 0;  // the number of frames matched without features since the last feature
+
+  void AddFeature(const FeatureMatrix &features, size_t row, size_t budget) {
+    if (gallery.Dim() != features.Dim()) {
+      gallery.Reset(features.Dim());
+      gallery_next = 0;
+    }
+    if (gallery.Rows() < budget) {
+      gallery.Resize(gallery.Rows() + 1);
+      gallery.CopyRow(gallery.Rows() - 1, features, row);
+    } else {
+      gallery.CopyRow(gallery_next, features, row);
+      gallery_next = (gallery_next + 1) % budget;
+    }
+  }
+};
+
+FeatureMatchTracker::FeatureMatchTracker(const Params &params) : params_(params) {
+  params_.nn_budget = std::max(params_.nn_budget, 1);
+  params_.max_age = std::max(params_.max_age, 1);
+}
+
+FeatureMatchTracker::~FeatureMatchTracker() = default;
+
+void FeatureMatchTracker::Reset() {
+  tracks_.clear();
+  next_id_ = 0;
+  feature_dim_ = 0;
+}
+
+size_t FeatureMatchTracker::GetConfirmedTrackNum() const {
+  return std::count_if(tracks_.begin(), tracks_.end(), [](const std::unique_ptr<Track> &t) { return t->confirmed; });
+}
+
+void FeatureMatchTracker::SelectFeatureDetections(const std::vector<TrackDetection> &detections,
+                                                  std::vector<char> *need_feature) const {
+  const size_t det_num = detections.size(), track_num = tracks_.size();
+  need_feature->assign(det_num, 1);
+  if (params_.feature_reuse_frames <= 0 || !track_num || !det_num) return;
+  // the IoUs of detections and the boxes of tracks predicted to the next frame
+  std::vector<float> ious(det_num * track_num);
+  double box[4];
+  for (size_t t = 0; t < track_num; ++t) {
+    StateBox(tracks_[t]->kf, 1, box);
+    for (size_t d = 0; d < det_num; ++d) ious[d * track_num + t] = IoU(box, detections[d]);
+  }
+  for (size_t d = 0; d < det_num; ++d) {
+    const float *det_ious = ious.data() + d * track_num;
+    const size_t best = std::max_element(det_ious, det_ious + track_num) - det_ious;
+    const Track &track = *tracks_[best];
+    if (det_ious[best] < kReuseIoU || !track.confirmed || track.time_since_update > 0 ||
+        track.label != detections[d].label || !track.gallery.Rows() ||
+        track.reused_frames >= params_.feature_reuse_frames) {
+      continue;
+    }
+    bool ambiguous = false;
+    for (size_t t = 0; t < track_num && !ambiguous; ++t) {
+      ambiguous = t != best && det_ious[t] >= kAmbiguousIoU;
+    }
+    for (size_t other = 0; other < det_num && !ambiguous; ++other) {
+      ambiguous = other != d && ious[other * track_num + best] >= kAmbiguousIoU;
+    }
+    if (!ambiguous) (*need_feature)[d] = 0;
+  }
+}
+
+void FeatureMatchTracker::UpdateAppearanceCost(const std::vector<TrackDetection> &detections,
+                                               const FeatureMatrix &features) {
+  const size_t det_num = detections.size();
+  appearance_row_.assign(tracks_.size(), -1);
+  size_t rows = 0;
+  for (size_t t = 0; t < tracks_.size(); ++t) {
+    if (tracks_[t]->confirmed) appearance_row_[t] = rows++;
+  }
+  appearance_cost_.resize(rows * det_num);
+  for (size_t t = 0; t < tracks_.size(); ++t) {
+    if (appearance_row_[t] < 0) continue;
+    const Track &track = *tracks_[t];
+    float *cost = appearance_cost_.data() + appearance_row_[t] * det_num;
+    std::fill_n(cost, det_num, kInfiniteCost);
+    double inv[4][4];
+    if (!track.gallery.Rows() || !KalmanInnovationInverse(track.kf, inv)) continue;
+    // features are compared only with the detections passing the gate
+    gated_dets_.clear();
+    for (size_t d = 0; d < det_num; ++d) {
+      if (detections[d].has_feature && track.label == detections[d].label &&
+          GatingDistance(track.kf, inv, measurements_[d].data()) <= kGatingThreshold) {
+        gated_dets_.push_back(d);
+      }
+    }
+    if (gated_dets_.empty()) continue;
+    // the nearest feature of the track to each detection
+    const size_t gated_num = gated_dets_.size();
+    gallery_dist_.resize(track.gallery.Rows() * gated_num);
+    CosineDistanceMatrix(track.gallery, features, gated_dets_.data(), gated_num, gallery_dist_.data());
+    for (size_t g = 0; g < track.gallery.Rows(); ++g) {
+      const float *dist = gallery_dist_.data() + g * gated_num;
+      for (size_t j = 0; j < gated_num; ++j) cost[gated_dets_[j]] = std::min(cost[gated_dets_[j]], dist[j]);
+    }
+  }
+}
+
+void FeatureMatchTracker::MatchCascade(const std::vector<int> &confirmed, std::vector<int> *unmatched_dets,
+                                       Matches *matches, std::vector<int> *unmatched_tracks) {
+  const size_t det_num = measurements_.size();
+  auto cost_func = [this, det_num](int t, int d) { return appearance_cost_[appearance_row_[t] * det_num + d]; };
+  const size_t matched_before = matches->size();
+  std::vector<int> level_tracks, level_unmatched;
+  // the tracks lost recently are matched first
+  for (int level = 0; level < params_.max_age && !unmatched_dets->empty(); ++level) {
+    level_tracks.clear();
+    for (int t : confirmed) {
+      if (tracks_[t]->time_since_update == level + 1) level_tracks.push_back(t);
+    }
+    if (level_tracks.empty()) continue;
+    level_unmatched.clear();
+    MinCostMatching(cost_func, params_.max_cosine_distance, level_tracks, unmatched_dets, matches, &level_unmatched,
+                    &assign_cost_, &assignment_);
+  }
+  std::vector<char> matched(tracks_.size(), 0);
+  for (size_t i = matched_before; i < matches->size(); ++i) matched[(*matches)[i].first] = 1;
+  for (int t : confirmed) {
+    if (!matched[t]) unmatched_tracks->push_back(t);
+  }
+}
+
+void FeatureMatchTracker::MatchIoU(const std::vector<int> &candidates, const std::vector<TrackDetection> &detections,
+                                   std::vector<int> *unmatched_dets, Matches *matches,
+                                   std::vector<int> *unmatched_tracks) {
+  auto cost_func = [this, &detections](int t, int d) {
+    const Track &track = *tracks_[t];
+    if (track.label != detections[d].label || track.time_since_update > 1) return kInfiniteCost;
+    double box[4];
+    StateBox(track.kf, 0, box);
+    return 1.f - IoU(box, detections[d]);
+  };
+  // boxes not overlapping are never matched only if max_iou_distance is less than 1
+  if (!params_.grid_gating || params_.max_iou_distance >= 1) {
+    MinCostMatching(cost_func, params_.max_iou_distance, candidates, unmatched_dets, matches, unmatched_tracks,
+                    &assign_cost_, &assignment_);
+    return;
+  }
+  const int track_num = candidates.size(), det_num = unmatched_dets->size();
+  if (!track_num || !det_num) {
+    unmatched_tracks->insert(unmatched_tracks->end(), candidates.begin(), candidates.end());
+    return;
+  }
+
+  // the detections are put into every cell of a uniform grid they overlap, a track is scored only with the
+  // detections in the cells its box overlaps.
+  const int grid = std::max(1, std::min(kMaxGridSize, static_cast<int>(std::sqrt(det_num))));
+  auto cell_of = [grid](double v) { return std::min(grid - 1, std::max(0, static_cast<int>(v * grid))); };
+  grid_start_.assign(grid * grid + 1, 0);
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int i = 0; i < det_num; ++i) {
+      const TrackDetection &det = detections[(*unmatched_dets)[i]];
+      const int x0 = cell_of(det.x), x1 = cell_of(det.x + det.w), y0 = cell_of(det.y), y1 = cell_of(det.y + det.h);
+      for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+          if (pass == 0) {
+            grid_start_[y * grid + x + 1]++;
+          } else {
+            grid_items_[grid_fill_[y * grid + x]++] = i;
+          }
+        }
+      }
+    }
+    if (pass == 0) {
+      for (int c = 0; c < grid * grid; ++c) grid_start_[c + 1] += grid_start_[c];
+      grid_items_.resize(grid_start_.back());
+      grid_fill_.assign(grid_start_.begin(), grid_start_.end() - 1);
+    }
+  }
+
+  // the feasible pairs, nodes [0, track_num) are tracks and [track_num, track_num + det_num) are detections
+  iou_pairs_.clear();
+  det_visited_.assign(det_num, -1);
+  double box[4];
+  for (int ti = 0; ti < track_num; ++ti) {
+    const Track &track = *tracks_[candidates[ti]];
+    if (track.time_since_update > 1) continue;
+    StateBox(track.kf, 0, box);
+    const int x0 = cell_of(box[0]), x1 = cell_of(box[0] + box[2]), y0 = cell_of(box[1]), y1 = cell_of(box[1] + box[3]);
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        for (int k = grid_start_[y * grid + x]; k < grid_start_[y * grid + x + 1]; ++k) {
+          const int i = grid_items_[k];
+          if (det_visited_[i] == ti) continue;
+          det_visited_[i] = ti;
+          const float cost = cost_func(candidates[ti], (*unmatched_dets)[i]);
+          if (cost <= params_.max_iou_distance) iou_pairs_.push_back({ti, track_num + i, cost});
+        }
+      }
+    }
+  }
+
+  // the optimal assignment is the union of the optimal assignments of the connected components of the pairs,
+  // the pairs out of the gate are all infeasible.
+  std::vector<int> parent(track_num + det_num);
+  for (size_t n = 0; n < parent.size(); ++n) parent[n] = n;
+  for (const IoUPair &pair : iou_pairs_) {
+    parent[FindRoot(&parent, pair.track)] = FindRoot(&parent, pair.det);
+  }
+  std::vector<int> component(parent.size(), -1), local(parent.size());
+  std::vector<std::vector<int>> comp_tracks, comp_dets;
+  std::vector<std::vector<IoUPair>> comp_pairs;
+  for (const IoUPair &pair : iou_pairs_) {
+    const int root = FindRoot(&parent, pair.track);
+    if (component[root] < 0) {
+      component[root] = comp_pairs.size();
+      comp_tracks.emplace_back();
+      comp_dets.emplace_back();
+      comp_pairs.emplace_back();
+    }
+    comp_pairs[component[root]].push_back(pair);
+  }
+  for (int n = 0; n < track_num + det_num; ++n) {
+    const int c = component[FindRoot(&parent, n)];
+    if (c < 0) {
+      if (n < track_num) unmatched_tracks->push_back(candidates[n]);
+      continue;
+    }
+    std::vector<int> &nodes = n < track_num ? comp_tracks[c] : comp_dets[c];
+    local[n] = nodes.size();
+    nodes.push_back(n < track_num ? candidates[n] : (*unmatched_dets)[n - track_num]);
+  }
+
+  std::vector<char> det_matched(detections.size(), 0);
+  std::vector<float> comp_cost;
+  std::vector<int> track_local(tracks_.size()), det_local(detections.size());
+  for (size_t c = 0; c < comp_pairs.size(); ++c) {
+    const size_t cols = comp_dets[c].size();
+    comp_cost.assign(comp_tracks[c].size() * cols, kInfiniteCost);
+    for (const IoUPair &pair : comp_pairs[c]) comp_cost[local[pair.track] * cols + local[pair.det]] = pair.cost;
+    for (size_t i = 0; i < comp_tracks[c].size(); ++i) track_local[comp_tracks[c][i]] = i;
+    for (size_t i = 0; i < cols; ++i) det_local[comp_dets[c][i]] = i;
+    auto comp_cost_func = [&](int t, int d) { return comp_cost[track_local[t] * cols + det_local[d]]; };
+    const size_t matched_before = matches->size();
+    MinCostMatching(comp_cost_func, params_.max_iou_distance, comp_tracks[c], &comp_dets[c], matches,
+                    unmatched_tracks, &assign_cost_, &assignment_);
+    for (size_t m = matched_before; m < matches->size(); ++m) det_matched[(*matches)[m].second] = 1;
+  }
+  size_t remain = 0;
+  for (int d : *unmatched_dets) {
+    if (!det_matched[d]) (*unmatched_dets)[remain++] = d;
+  }
+  unmatched_dets->resize(remain);
+}
+
+void FeatureMatchTracker::Update(const std::vector<TrackDetection> &detections, const FeatureMatrix &features,
+                                 std::vector<int> *track_ids, std::vector<char> *track_confirmed) {
+  const size_t det_num = detections.size();
+  track_ids->assign(det_num, -1);
+  if (track_confirmed) track_confirmed->assign(det_num, 0);
+  bool use_feature = det_num > 0 && features.Rows() == det_num && features.Dim() > 0;
+  if (use_feature && !feature_dim_) feature_dim_ = features.Dim();
+  use_feature = use_feature && features.Dim() == feature_dim_;
+
+  for (auto &track : tracks_) {
+    KalmanPredict(&track->kf);
+    track->time_since_update++;
+  }
+  measurements_.resize(det_num);
+  for (size_t d = 0; d < det_num; ++d) {
+    const double w = std::max(detections[d].w, kMinBoxSize), h = std::max(detections[d].h, kMinBoxSize);
+    measurements_[d] = {detections[d].x + w / 2, detections[d].y + h / 2, w / h, h};
+  }
+
+  std::vector<int> confirmed, iou_candidates, unmatched_dets(det_num), unmatched_tracks, cascade_unmatched;
+  for (size_t d = 0; d < det_num; ++d) unmatched_dets[d] = d;
+  for (size_t t = 0; t < tracks_.size(); ++t) {
+    if (tracks_[t]->confirmed) {
+      confirmed.push_back(t);
+    } else {
+      iou_candidates.push_back(t);
+    }
+  }
+  Matches matches;
+  if (use_feature) {
+    UpdateAppearanceCost(detections, features);
+    MatchCascade(confirmed, &unmatched_dets, &matches, &cascade_unmatched);
+  } else {
+    cascade_unmatched = confirmed;
+  }
+  // the confirmed tracks lost just now get a chance to be matched by IoU
+  for (int t : cascade_unmatched) {
+    if (tracks_[t]->time_since_update == 1) {
+      iou_candidates.push_back(t);
+    } else {
+      unmatched_tracks.push_back(t);
+    }
+  }
+  MatchIoU(iou_candidates, detections, &unmatched_dets, &matches, &unmatched_tracks);
+
+  for (const auto &match : matches) {
+    Track &track = *tracks_[match.first];
+    KalmanUpdate(&track.kf, measurements_[match.second].data());
+    if (use_feature && detections[match.second].has_feature) {
+      track.AddFeature(features, match.second, params_.nn_budget);
+      track.reused_frames = 0;
+    } else {
+      track.reused_frames++;
+    }
+    track.hits++;
+    track.time_since_update = 0;
+    if (!track.confirmed && track.hits >= params_.n_init) track.confirmed = true;
+    (*track_ids)[match.second] = track.id;
+    if (track_confirmed) (*track_confirmed)[match.second] = track.confirmed;
+  }
+  for (int t : unmatched_tracks) {
+    Track &track = *tracks_[t];
+    if (!track.confirmed || track.time_since_update > params_.max_age) track.deleted = true;
+  }
+  for (int d : unmatched_dets) {
+    std::unique_ptr<Track> track(new Track);
+    track->id = next_id_++;
+    track->label = detections[d].label;
+    KalmanInitiate(measurements_[d].data(), &track->kf);
+    track->confirmed = params_.n_init <= 1;
+    if (use_feature && detections[d].has_feature) track->AddFeature(features, d, params_.nn_budget);
+    (*track_ids)[d] = track->id;
+    if (track_confirmed) (*track_confirmed)[d] = track->confirmed;
+    tracks_.push_back(std::move(track));
+  }
+  tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(),
+                               [](const std::unique_ptr<Track> &t) { return t->deleted; }),
+                tracks_.end());
+}
+
+}  // namespace cnstream
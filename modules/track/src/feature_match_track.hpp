@@ -0,0 +1,148 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef FEATURE_MATCH_TRACK_HPP_
+#define FEATURE_MATCH_TRACK_HPP_
+
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "feature_matrix.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief The detection of an object in a frame. The bounding box is normalized to [0, 1].
+ */
+struct TrackDetection {
+  float x = 0;
+  float y = 0;
+  float w = 0;
+  float h = 0;
+  int label = -1;
+  bool has_feature = true;  ///< False if the feature is not extracted, the detection is matched by IoU only.
+};
+
+/**
+ * @class FeatureMatchTracker
+ *
+ * @brief FeatureMatchTracker tracks the objects of a stream by their features and bounding boxes (DeepSORT).
+ *
+ * Tracks are predicted by a Kalman filter. Confirmed tracks are matched to detections by the cosine distances of
+ * features first, in the order of the frames they were lost, and the rest are matched by IoU. Objects are matched
+ * only to the tracks with the same label.
+ *
+ * The cosine distances between the features kept by a track and the features of the detections passing its Kalman
+ * gate are computed as one matrix product, see CosineDistanceMatrix. The cost buffers are kept by the tracker and
+ * reused by the next frame.
+ *
+ * In IoU matching, only the tracks and detections whose boxes overlap in a uniform grid are scored, and the
+ * assignment is solved for each group of overlapping boxes separately. The matches are the same as scoring all
+ * pairs, since boxes not overlapping are never matched.
+ */
+class FeatureMatchTracker {
+ public:
+  struct Params {
+    float max_cosine_distance = 0.2;  ///< The maximum cosine distance of features of the same object.
+    int nn_budget = 100;              ///< The maximum number of features kept by a track.
+    float max_iou_distance = 0.7;     ///< The maximum 1 - IoU of the bounding boxes of the same object.
+    int max_age = 30;                 ///< The number of frames a lost track is kept.
+    int n_init = 3;                   ///< The number of frames a track is tentative.
+    int feature_reuse_frames = 0;     ///< The maximum number of frames a stable track is matched without features.
+    bool grid_gating = true;          ///< Scores only the overlapping boxes found by a grid in IoU matching.
+  };
+
+  explicit FeatureMatchTracker(const Params &params);
+  ~FeatureMatchTracker();
+  /**
+   * @brief Tracks the detections of a frame.
+   *
+   * @param[in] detections The detections of the frame.
+   * @param[in] features The features of the detections, row i for detection i. Only IoU is used to match the
+   *                     detections if the rows do not match the detections, e.g. the features are not extracted.
+   * @param[out] track_ids The track id of each detection. Detections not matched start new tracks.
+   * @param[out] track_confirmed Whether the track of each detection is confirmed after this frame. It is optional.
+   */
+  void Update(const std::vector<TrackDetection> &detections, const FeatureMatrix &features,
+              std::vector<int> *track_ids, std::vector<char> *track_confirmed = nullptr);
+  /**
+   * @brief Selects the detections of the next frame whose features need to be extracted.
+   *
+   * A detection does not need its feature if it overlaps the predicted box of a confirmed track with a high IoU,
+   * and neither the detection nor the track overlaps others, so that it is matched by IoU unambiguously. The
+   * feature of a track is refreshed at least once every ``feature_reuse_frames`` frames.
+   *
+   * @param[in] detections The detections of the next frame.
+   * @param[out] need_feature Whether the feature of each detection needs to be extracted. All detections need their
+   *                          features if ``feature_reuse_frames`` is 0.
+   */
+  void SelectFeatureDetections(const std::vector<TrackDetection> &detections, std::vector<char> *need_feature) const;
+  /**
+   * @brief Removes all tracks, e.g. for another stream. The buffers are kept.
+   */
+  void Reset();
+  /**
+   * @brief Gets the number of tracks, including the tentative and lost ones.
+   */
+  size_t GetTrackNum() const { return tracks_.size(); }
+  /**
+   * @brief Gets the number of confirmed tracks.
+   */
+  size_t GetConfirmedTrackNum() const;
+
+ private:
+  struct Track;
+  using Matches = std::vector<std::pair<int, int>>;  // (track index, detection index)
+  struct IoUPair {
+    int track;
+    int det;
+    float cost;
+  };
+
+  void UpdateAppearanceCost(const std::vector<TrackDetection> &detections, const FeatureMatrix &features);
+  void MatchCascade(const std::vector<int> &confirmed, std::vector<int> *unmatched_dets, Matches *matches,
+                    std::vector<int> *unmatched_tracks);
+  void MatchIoU(const std::vector<int> &candidates, const std::vector<TrackDetection> &detections,
+                std::vector<int> *unmatched_dets, Matches *matches, std::vector<int> *unmatched_tracks);
+
+  Params params_;
+  size_t feature_dim_ = 0;
+  int next_id_ = 0;
+  std::vector<std::unique_ptr<Track>> tracks_;
+  // reused by each frame
+  std::vector<float> appearance_cost_;  // confirmed tracks * detections
+  std::vector<int> appearance_row_;     // row of each track in appearance_cost_, -1 if not confirmed
+  std::vector<int> gated_dets_;
+  std::vector<float> gallery_dist_;
+  std::vector<float> assign_cost_;
+  std::vector<int> assignment_;
+  std::vector<std::array<double, 4>> measurements_;
+  std::vector<int> grid_start_;  // the detections in cell c are grid_items_[grid_start_[c], grid_start_[c + 1])
+  std::vector<int> grid_fill_;
+  std::vector<int> grid_items_;
+  std::vector<int> det_visited_;
+  std::vector<IoUPair> iou_pairs_;
+};  // class FeatureMatchTracker
+
+}  // namespace cnstream
+
+#endif  // FEATURE_MATCH_TRACK_HPP_
@@ -0,0 +1,206 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "feature_matrix.hpp"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace cnstream {
+
+namespace {
+
+// the length of rows is a multiple of kRowAlign, no tail is left for the kernels.
+#if defined(__SSE__)
+
+inline float HorizontalSum(__m128 v) {
+  __m128 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+}
+
+inline void Dot4(const float *a0, const float *a1, const float *a2, const float *a3, const float *b, size_t len,
+                 float *out) {
+  __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps(), s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+  for (size_t k = 0; k < len; k += 4) {
+    __m128 vb = _mm_loadu_ps(b + k);
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a0 + k), vb));
+    s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a1 + k), vb));
+    s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(a2 + k), vb));
+    s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(a3 + k), vb));
+  }
+  out[0] = HorizontalSum(s0);
+  out[1] = HorizontalSum(s1);
+  out[2] = HorizontalSum(s2);
+  out[3] = HorizontalSum(s3);
+}
+
+inline float Dot1(const float *a, const float *b, size_t len) {
+  __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+  for (size_t k = 0; k < len; k += 8) {
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+    s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + k + 4), _mm_loadu_ps(b + k + 4)));
+  }
+  return HorizontalSum(_mm_add_ps(s0, s1));
+}
+
+#elif defined(__ARM_NEON)
+
+inline float HorizontalSum(float32x4_t v) {
+  float32x2_t sum = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+  return vget_lane_f32(vpadd_f32(sum, sum), 0);
+}
+
+inline void Dot4(const float *a0, const float *a1, const float *a2, const float *a3, const float *b, size_t len,
+                 float *out) {
+  float32x4_t s0 = vdupq_n_f32(0), s1 = vdupq_n_f32(0), s2 = vdupq_n_f32(0), s3 = vdupq_n_f32(0);
+  for (size_t k = 0; k < len; k += 4) {
+    float32x4_t vb = vld1q_f32(b + k);
+    s0 = vmlaq_f32(s0, vld1q_f32(a0 + k), vb);
+    s1 = vmlaq_f32(s1, vld1q_f32(a1 + k), vb);
+    s2 = vmlaq_f32(s2, vld1q_f32(a2 + k), vb);
+    s3 = vmlaq_f32(s3, vld1q_f32(a3 + k), vb);
+  }
+  out[0] = HorizontalSum(s0);
+  out[1] = HorizontalSum(s1);
+  out[2] = HorizontalSum(s2);
+  out[3] = HorizontalSum(s3);
+}
+
+inline float Dot1(const float *a, const float *b, size_t len) {
+  float32x4_t s0 = vdupq_n_f32(0), s1 = vdupq_n_f32(0);
+  for (size_t k = 0; k < len; k += 8) {
+    s0 = vmlaq_f32(s0, vld1q_f32(a + k), vld1q_f32(b + k));
+    s1 = vmlaq_f32(s1, vld1q_f32(a + k + 4), vld1q_f32(b + k + 4));
+  }
+  return HorizontalSum(vaddq_f32(s0, s1));
+}
+
+#else
+
+inline void Dot4(const float *a0, const float *a1, const float *a2, const float *a3, const float *b, size_t len,
+                 float *out) {
+  float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  for (size_t k = 0; k < len; ++k) {
+    s0 += a0[k] * b[k];
+    s1 += a1[k] * b[k];
+    s2 += a2[k] * b[k];
+    s3 += a3[k] * b[k];
+  }
+  out[0] = s0;
+  out[1] = s1;
+  out[2] = s2;
+  out[3] = s3;
+}
+
+inline float Dot1(const float *a, const float *b, size_t len) {
+  float sum = 0;
+  for (size_t k = 0; k < len; ++k) sum += a[k] * b[k];
+  return sum;
+}
+
+#endif
+
+}  // namespace
+
+void FeatureMatrix::Reset(size_t dim) {
+  dim_ = dim;
+  stride_ = (dim + kRowAlign - 1) / kRowAlign * kRowAlign;
+  rows_ = 0;
+}
+
+void FeatureMatrix::Resize(size_t rows) {
+  if (data_.size() < rows * stride_) data_.resize(rows * stride_);
+  for (size_t row = rows_; row < rows; ++row) {
+    std::fill_n(data_.begin() + row * stride_, stride_, 0.f);
+  }
+  rows_ = rows;
+}
+
+size_t FeatureMatrix::Append(const float *feature) {
+  Resize(rows_ + 1);
+  Set(rows_ - 1, feature);
+  return rows_ - 1;
+}
+
+size_t FeatureMatrix::Append(const std::function<void(float *)> &decode) {
+  Resize(rows_ + 1);
+  float *dst = data_.data() + (rows_ - 1) * stride_;
+  decode(dst);
+  Normalize(dst);
+  return rows_ - 1;
+}
+
+void FeatureMatrix::Set(size_t row, const float *feature) {
+  float *dst = data_.data() + row * stride_;
+  std::fill_n(dst, stride_, 0.f);
+  if (!feature) return;
+  memcpy(dst, feature, dim_ * sizeof(float));
+  Normalize(dst);
+}
+
+void FeatureMatrix::Normalize(float *row) {
+  double norm = 0;
+  for (size_t k = 0; k < dim_; ++k) norm += static_cast<double>(row[k]) * row[k];
+  // zero features keep zero, their distances to any feature are 1.
+  if (norm <= 0) return;
+  const float scale = static_cast<float>(1.0 / std::sqrt(norm));
+  for (size_t k = 0; k < dim_; ++k) row[k] *= scale;
+}
+
+void FeatureMatrix::CopyRow(size_t row, const FeatureMatrix &src, size_t src_row) {
+  memcpy(data_.data() + row * stride_, src.Row(src_row), stride_ * sizeof(float));
+}
+
+void CosineDistanceMatrix(const FeatureMatrix &a, const FeatureMatrix &b, float *dist) {
+  CosineDistanceMatrix(a, b, nullptr, b.Rows(), dist);
+}
+
+void CosineDistanceMatrix(const FeatureMatrix &a, const FeatureMatrix &b, const int *b_rows, size_t b_num,
+                          float *dist) {
+  const size_t len = a.Stride();
+  const size_t a_rows = a.Rows();
+  size_t i = 0;
+  float dots[4];
+  for (; i + 4 <= a_rows; i += 4) {
+    const float *a0 = a.Row(i), *a1 = a.Row(i + 1), *a2 = a.Row(i + 2), *a3 = a.Row(i + 3);
+    for (size_t j = 0; j < b_num; ++j) {
+      Dot4(a0, a1, a2, a3, b.Row(b_rows ? b_rows[j] : j), len, dots);
+      dist[i * b_num + j] = 1.f - dots[0];
+      dist[(i + 1) * b_num + j] = 1.f - dots[1];
+      dist[(i + 2) * b_num + j] = 1.f - dots[2];
+      dist[(i + 3) * b_num + j] = 1.f - dots[3];
+    }
+  }
+  for (; i < a_rows; ++i) {
+    for (size_t j = 0; j < b_num; ++j) {
+      dist[i * b_num + j] = 1.f - Dot1(a.Row(i), b.Row(b_rows ? b_rows[j] : j), len);
+    }
+  }
+}
+
+}  // namespace cnstream
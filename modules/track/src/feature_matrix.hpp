@@ -0,0 +1,123 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef FEATURE_MATRIX_HPP_
+#define FEATURE_MATRIX_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @class FeatureMatrix
+ *
+ * @brief FeatureMatrix stores L2 normalized features contiguously, one feature per row.
+ *
+ * Rows are padded with zeros to a multiple of ``kRowAlign`` floats, so that the distance kernels work on whole
+ * vector registers. The storage is kept when the matrix is cleared, and reused by the next frame.
+ */
+class FeatureMatrix {
+ public:
+  static constexpr size_t kRowAlign = 8;
+
+  FeatureMatrix() = default;
+  explicit FeatureMatrix(size_t dim) { Reset(dim); }
+  /**
+   * @brief Removes all rows and sets the dimension of features. The storage is kept.
+   */
+  void Reset(size_t dim);
+  /**
+   * @brief Removes all rows. The storage is kept.
+   */
+  void Clear() { rows_ = 0; }
+  /**
+   * @brief Resizes the matrix to ``rows`` rows, the new rows are zero.
+   */
+  void Resize(size_t rows);
+  /**
+   * @brief Appends a feature.
+   *
+   * @param[in] feature The feature of ``Dim()`` floats. A zero row is appended if it is nullptr.
+   *
+   * @return Returns the index of the row.
+   */
+  size_t Append(const float *feature);
+  /**
+   * @brief Appends a feature decoded into the row directly, e.g. from a quantized feature, and normalizes it.
+   *
+   * @param[in] decode The function writing ``Dim()`` floats to the row.
+   *
+   * @return Returns the index of the row.
+   */
+  size_t Append(const std::function<void(float *)> &decode);
+  /**
+   * @brief Normalizes a feature and stores it in a row.
+   *
+   * @param[in] row The row index, it must be less than ``Rows()``.
+   * @param[in] feature The feature of ``Dim()`` floats. The row is set to zero if it is nullptr.
+   */
+  void Set(size_t row, const float *feature);
+  /**
+   * @brief Copies a row of another matrix with the same dimension.
+   */
+  void CopyRow(size_t row, const FeatureMatrix &src, size_t src_row);
+
+  const float *Row(size_t row) const { return data_.data() + row * stride_; }
+  size_t Rows() const { return rows_; }
+  size_t Dim() const { return dim_; }
+  size_t Stride() const { return stride_; }
+
+ private:
+  void Normalize(float *row);
+
+  size_t dim_ = 0;
+  size_t stride_ = 0;
+  size_t rows_ = 0;
+  std::vector<float> data_;
+};  // class FeatureMatrix
+
+/**
+ * @brief Computes the cosine distances between the rows of two matrices with the same dimension.
+ *
+ * @param[in] a The first matrix.
+ * @param[in] b The second matrix.
+ * @param[out] dist The distances, ``dist[i * b.Rows() + j]`` is ``1 - a_i * b_j``. It has ``a.Rows() * b.Rows()``
+ *                  floats.
+ *
+ * @note The rows of ``a`` are processed 4 at a time, so that each row of ``b`` is loaded once for 4 dot products.
+ */
+void CosineDistanceMatrix(const FeatureMatrix &a, const FeatureMatrix &b, float *dist);
+/**
+ * @brief Computes the cosine distances between the rows of ``a`` and the selected rows of ``b``.
+ *
+ * @param[in] a The first matrix.
+ * @param[in] b The second matrix.
+ * @param[in] b_rows The indexes of the selected rows of ``b``.
+ * @param[in] b_num The number of the selected rows.
+ * @param[out] dist The distances, ``dist[i * b_num + j]`` is ``1 - a_i * b_{b_rows[j]}``.
+ */
+void CosineDistanceMatrix(const FeatureMatrix &a, const FeatureMatrix &b, const int *b_rows, size_t b_num,
+                          float *dist);
+
+}  // namespace cnstream
+
+#endif  // FEATURE_MATRIX_HPP_
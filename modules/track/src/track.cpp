@@ -19,14 +19,20 @@
  *************************************************************************/
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "cnis/processor.h"
 #include "cnstream_frame_va.hpp"
+#include "cnstream_mapped_file.hpp"
 #include "device/mlu_context.h"
 #include "feature_extractor.hpp"
+#include "feature_match_track.hpp"
 #include "profiler/module_profiler.hpp"
+#include "util/cnstream_queue.hpp"
 #include "track.hpp"
 
 #define CLIP(x) ((x) < 0 ? 0 : ((x) > 1 ? 1 : (x)))
@@ -34,7 +40,16 @@
 namespace cnstream {
 
 struct TrackerContext {
-  std::unique_ptr<edk::EasyTrack> processer_ = nullptr;
+  // IoUMatch uses the same tracker without features
+  std::unique_ptr<FeatureMatchTracker> feature_tracker_ = nullptr;
+  // reused by each frame of the stream
+  std::vector<TrackDetection> detections_;
+  FeatureMatrix features_;
+  std::vector<int> track_ids_;
+  std::vector<char> track_confirmed_;
+  std::vector<char> need_feature_;
+  // guards feature_tracker_, features of a frame may be selected while the previous frame is matched in callback
+  std::mutex mutex_;
   TrackerContext() = default;
   ~TrackerContext() = default;
   TrackerContext(const TrackerContext &) = delete;
@@ -43,6 +58,104 @@ struct TrackerContext {
 
 thread_local std::unique_ptr<FeatureExtractor> g_feature_extractor;
 
+// tracks the frames of the streams assigned to it in order, a nullptr frame stops the worker
+struct TrackWorker {
+  ThreadSafeQueue<CNFrameInfoPtr> queue_;
+  std::thread thread_;
+};
+
+static void FillDetection(const CNInferObjectPtr &obj, TrackDetection *det) {
+  det->label = std::stoi(obj->id);
+  det->x = obj->bbox.x;
+  det->y = obj->bbox.y;
+  det->w = obj->bbox.w;
+  det->h = obj->bbox.h;
+}
+
+// selects the objects whose features need to be extracted, features of stable tracks are reused
+static void SelectFeatureObjects(TrackerContext *ctx, const std::vector<CNInferObjectPtr> &objs,
+                                 std::vector<CNInferObjectPtr> *selected) {
+  std::vector<TrackDetection> detections(objs.size());
+  for (size_t i = 0; i < objs.size(); i++) FillDetection(objs[i], &detections[i]);
+  std::lock_guard<std::mutex> lk(ctx->mutex_);
+  ctx->feature_tracker_->SelectFeatureDetections(detections, &ctx->need_feature_);
+  selected->clear();
+  for (size_t i = 0; i < objs.size(); i++) {
+    if (ctx->need_feature_[i]) selected->push_back(objs[i]);
+  }
+}
+
+static bool ParseFeaturePrecision(const std::string &value, CNFeaturePrecision *precision) {
+  if (value == "fp32") {
+    *precision = CNFeaturePrecision::FP32;
+  } else if (value == "fp16") {
+    *precision = CNFeaturePrecision::FP16;
+  } else if (value == "int8") {
+    *precision = CNFeaturePrecision::INT8;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// objects of tentative tracks (if drop_tentative) and objects with a score lower than min_score are removed from
+// the frame after being tracked.
+static void MatchObjects(TrackerContext *ctx, const CNInferObjsPtr &objs_holder, bool use_feature, bool drop_tentative,
+                         float min_score) {
+  auto &objs = objs_holder->objs_;
+  std::lock_guard<std::mutex> lk(ctx->mutex_);
+  ctx->detections_.resize(objs.size());
+  // the features are normalized into the matrix of the stream directly, they are not copied out of objects.
+  ctx->features_.Clear();
+  for (size_t i = 0; i < objs.size(); i++) {
+    TrackDetection &det = ctx->detections_[i];
+    FillDetection(objs[i], &det);
+    if (!use_feature) continue;
+    bool has_feature = false;
+    auto check_dim = [ctx, &has_feature](size_t dim) {
+      if (!ctx->features_.Dim()) {
+        // the dimension is got from the first feature of the stream
+        size_t rows = ctx->features_.Rows();
+        ctx->features_.Reset(dim);
+        ctx->features_.Resize(rows);
+      }
+      has_feature = dim == ctx->features_.Dim();
+      return has_feature;
+    };
+    // quantized features are decoded into the matrix, without being restored to a CNInferFeature first
+    bool quantized = objs[i]->VisitQuantizedFeature("track", [&](const CNInferQuantizedFeature &feature) {
+      if (check_dim(feature.dimension)) {
+        ctx->features_.Append([&feature](float *row) { feature.Dequantize(row); });
+      } else {
+        ctx->features_.Append(nullptr);
+      }
+    });
+    if (!quantized) {
+      objs[i]->VisitFeature("track", [&](const CNInferFeature &feature) {
+        ctx->features_.Append(check_dim(feature.size()) ? feature.data() : nullptr);
+      });
+    }
+    det.has_feature = has_feature;
+    if (ctx->features_.Rows() == i) ctx->features_.Append(nullptr);
+  }
+
+  ctx->feature_tracker_->Update(ctx->detections_, ctx->features_, &ctx->track_ids_, &ctx->track_confirmed_);
+
+  for (size_t i = 0; i < objs.size(); i++) {
+    objs[i]->track_id = std::to_string(ctx->track_ids_[i]);
+  }
+  if (!drop_tentative && min_score <= 0) return;
+  std::lock_guard<std::mutex> objs_lk(objs_holder->mutex_);
+  size_t remain = 0;
+  for (size_t i = 0; i < objs.size(); i++) {
+    if ((drop_tentative && !ctx->track_confirmed_[i]) || objs[i]->score < min_score) continue;
+    if (remain != i) objs[remain] = std::move(objs[i]);
+    remain++;
+  }
+  objs.resize(remain);
+  objs_holder->Publish();
+}
+
 Tracker::Tracker(const std::string &name) : Module(name) {
   hasTransmit_.store(true);
   param_register_.SetModuleDesc("Tracker is a module for realtime tracking.");
@@ -56,43 +169,106 @@ Tracker::Tracker(const std::string &name) : Module(name) {
   param_register_.Register("track_name", "Track algorithm name. Choose from FeatureMatch and IoUMatch.");
   param_register_.Register("device_id", "Which device will be used. If there is only one device, it might be 0.");
   param_register_.Register("max_cosine_distance", "Threshold of cosine distance.");
+  param_register_.Register("batch_timeout",
+                           "The longest time (ms) to wait for objects of all streams to form a batch when feature is"
+                           " extracted on MLU. Default 100.");
+  param_register_.Register("drop_tentative",
+                           "Whether the objects of tentative tracks are removed from the frame after tracking, so that"
+                           " the following modules only get the objects tracked stably. Default false.");
+  param_register_.Register("min_score",
+                           "The objects with a score lower than it are removed from the frame after tracking."
+                           " Default 0, no object is removed.");
+  param_register_.Register("thread_num",
+                           "The number of threads tracking the frames, the streams are distributed to the threads."
+                           " Default 0, frames are tracked on the threads calling Process.");
+  param_register_.Register("feature_reuse_frames",
+                           "The maximum number of frames the feature of a stable track is reused instead of being"
+                           " extracted, works only for FeatureMatch. Default 0, features of all objects are"
+                           " extracted.");
+  param_register_.Register("warm_contexts",
+                           "The number of stream contexts created in Open, the context of a stream is reused by"
+                           " another one after the end of the stream. Default the maximum number of streams.");
+  param_register_.Register("feature_precision",
+                           "The precision the features extracted are stored in, fp32, fp16 or int8. fp16 and int8"
+                           " take a half and a quarter of the memory, and are sent compactly by the sinks encoding"
+                           " features. Default fp32.");
 }
 
 Tracker::~Tracker() { Close(); }
 
 bool Tracker::InitFeatureExtractor(const CNFrameInfoPtr &data) {
-  if (!g_feature_extractor) {
-    if (!model_) {
+  if (!model_) {
+    if (!g_feature_extractor) {
       LOGI(TRACK) << "[Track] FeatureExtract model not set, extract feature on CPU";
-      g_feature_extractor.reset(new FeatureExtractor(match_func_));
-    } else {
-      if (!infer_server::SetCurrentDevice(device_id_)) return false;
-      g_feature_extractor.reset(new FeatureExtractor(model_, match_func_, device_id_));
-      if (!g_feature_extractor->Init(engine_num_)) {
-        LOGE(TRACK) << "[Track] Extract feature on MLU. Init extractor failed.";
-        g_feature_extractor.reset();
-        return false;
-      }
+      g_feature_extractor.reset(new FeatureExtractor(match_func_, feature_precision_));
+    }
+    return true;
+  }
+  // frames of all threads share an extractor on MLU, so that objects of all streams are batched together.
+  thread_local bool device_set = false;
+  if (!device_set) {
+    if (!infer_server::SetCurrentDevice(device_id_)) return false;
+    device_set = true;
+  }
+  std::lock_guard<std::mutex> lk(extractor_mutex_);
+  if (!mlu_extractor_) {
+    std::unique_ptr<FeatureExtractor> extractor(
+        new FeatureExtractor(model_, match_func_, device_id_, feature_precision_));
+    if (!extractor->Init(engine_num_, batch_timeout_)) {
+      LOGE(TRACK) << "[Track] Extract feature on MLU. Init extractor failed.";
+      return false;
     }
+    mlu_extractor_ = std::move(extractor);
   }
   return true;
 }
 
+FeatureExtractor *Tracker::GetFeatureExtractor() {
+  if (!model_) return g_feature_extractor.get();
+  std::lock_guard<std::mutex> lk(extractor_mutex_);
+  return mlu_extractor_.get();
+}
+
 TrackerContext *Tracker::GetContext(const CNFrameInfoPtr &data) {
-  TrackerContext *ctx = nullptr;
-  std::unique_lock<std::mutex> guard(mutex_);
-  auto search = contexts_.find(data->GetStreamIndex());
-  if (search != contexts_.end()) {
-    // context exists
-    ctx = search->second;
-  } else {
-    ctx = new TrackerContext;
-    edk::FeatureMatchTrack *track = new edk::FeatureMatchTrack;
-    track->SetParams(max_cosine_distance_, 100, 0.7, 30, 3);
-    ctx->processer_.reset(track);
-    contexts_[data->GetStreamIndex()] = ctx;
+  // the context is bound by ProcessFrame on the first frame of the stream, so that it is got without locking
+  return contexts_[data->GetStreamIndex()];
+}
+
+bool Tracker::InitContexts() {
+  FeatureMatchTracker::Params params;
+  params.max_cosine_distance = max_cosine_distance_;
+  if (need_feature_) params.feature_reuse_frames = feature_reuse_frames_;
+  auto creator = [params]() {
+    std::unique_ptr<TrackerContext> ctx(new TrackerContext);
+    ctx->feature_tracker_.reset(new FeatureMatchTracker(params));
+    return ctx;
+  };
+  // the buffers of a context are kept for the next stream, only the tracks are cleared
+  auto recycler = [](TrackerContext *ctx) {
+    ctx->feature_tracker_->Reset();
+    return true;
+  };
+  contexts_.assign(GetMaxStreamNumber(), nullptr);
+  const uint32_t warm_num = warm_contexts_ < 0 ? GetMaxStreamNumber() : warm_contexts_;
+  return context_pool_.Init(warm_num, creator, recycler);
+}
+
+void Tracker::OnStreamAdded(const std::string &stream_id) {
+  context_pool_.Acquire(stream_id);
+}
+
+void Tracker::WorkerLoop(TrackWorker *worker) {
+  CNFrameInfoPtr data;
+  while (true) {
+    worker->queue_.WaitAndPop(data);
+    if (!data) break;
+    if (ProcessFrame(data) < 0) {
+      PostEvent(EventType::EVENT_ERROR, "Track frame failed, stream id: " + data->stream_id);
+    }
+    data.reset();
   }
-  return ctx;
+  // the CPU feature extractor is owned by the worker thread
+  g_feature_extractor.reset();
 }
 
 bool Tracker::Open(ModuleParamSet paramSet) {
@@ -102,8 +278,11 @@ bool Tracker::Open(ModuleParamSet paramSet) {
       model_pattern1_ = paramSet["model_path"];
       model_pattern1_ = GetPathRelativeToTheJSONFile(model_pattern1_, paramSet);
     }
-    if (!model_pattern1_.empty())
-      model_ = infer_server::InferServer::LoadModel(model_pattern1_);
+    if (!model_pattern1_.empty()) {
+      std::shared_ptr<MappedFile> model_file = MappedFile::Open(model_pattern1_);
+      model_ = model_file ? infer_server::InferServer::LoadModel(model_file->Data(), model_file->Size())
+                          : infer_server::InferServer::LoadModel(model_pattern1_);
+    }
   } else {
     if (paramSet.find("model_path") != paramSet.end()) {
       model_pattern1_ = paramSet["model_path"];
@@ -114,8 +293,11 @@ bool Tracker::Open(ModuleParamSet paramSet) {
     if (paramSet.find("func_name") != paramSet.end()) {
       model_pattern2_ = paramSet["func_name"];
     }
-    if (!model_pattern1_.empty() && !model_pattern2_.empty())
-      model_ = infer_server::InferServer::LoadModel(model_pattern1_, model_pattern2_);
+    if (!model_pattern1_.empty() && !model_pattern2_.empty()) {
+      std::shared_ptr<MappedFile> model_file = MappedFile::Open(model_pattern1_);
+      model_ = model_file ? infer_server::InferServer::LoadModel(model_file->Data(), model_pattern2_)
+                          : infer_server::InferServer::LoadModel(model_pattern1_, model_pattern2_);
+    }
   }
 
   if (paramSet.find("max_cosine_distance") != paramSet.end()) {
@@ -126,10 +308,40 @@ bool Tracker::Open(ModuleParamSet paramSet) {
     engine_num_ = std::stoi(paramSet["engine_num"]);
   }
 
+  if (paramSet.find("batch_timeout") != paramSet.end()) {
+    batch_timeout_ = std::stoul(paramSet["batch_timeout"]);
+  }
+
   if (paramSet.find("device_id") != paramSet.end()) {
     device_id_ = std::stoi(paramSet["device_id"]);
   }
 
+  if (paramSet.find("feature_reuse_frames") != paramSet.end()) {
+    feature_reuse_frames_ = std::stoi(paramSet["feature_reuse_frames"]);
+  }
+
+  if (paramSet.find("thread_num") != paramSet.end()) {
+    thread_num_ = std::stoi(paramSet["thread_num"]);
+  }
+
+  if (paramSet.find("warm_contexts") != paramSet.end()) {
+    warm_contexts_ = std::stoi(paramSet["warm_contexts"]);
+  }
+
+  if (paramSet.find("drop_tentative") != paramSet.end()) {
+    drop_tentative_ = paramSet["drop_tentative"] == "true";
+  }
+
+  if (paramSet.find("min_score") != paramSet.end()) {
+    min_score_ = std::stof(paramSet["min_score"]);
+  }
+
+  if (paramSet.find("feature_precision") != paramSet.end() &&
+      !ParseFeaturePrecision(paramSet["feature_precision"], &feature_precision_)) {
+    LOGE(TRACK) << "Unsupported feature precision: " << paramSet["feature_precision"];
+    return false;
+  }
+
   track_name_ = "FeatureMatch";
   if (paramSet.find("track_name") != paramSet.end()) {
     track_name_ = paramSet["track_name"];
@@ -146,59 +358,72 @@ bool Tracker::Open(ModuleParamSet paramSet) {
       PostEvent(EventType::EVENT_ERROR, "Extract feature failed");
       return;
     }
-    CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
-
-    std::vector<edk::DetectObject> in, out;
-    in.reserve(objs_holder->objs_.size());
-    for (size_t i = 0; i < objs_holder->objs_.size(); i++) {
-      edk::DetectObject obj;
-      obj.label = std::stoi(objs_holder->objs_[i]->id);
-      obj.score = objs_holder->objs_[i]->score;
-      obj.bbox.x = objs_holder->objs_[i]->bbox.x;
-      obj.bbox.y = objs_holder->objs_[i]->bbox.y;
-      obj.bbox.width = objs_holder->objs_[i]->bbox.w;
-      obj.bbox.height = objs_holder->objs_[i]->bbox.h;
-      obj.feature = objs_holder->objs_[i]->GetFeature("track");
-      in.emplace_back(obj);
-    }
-
-    GetContext(data)->processer_->UpdateFrame(edk::TrackFrame(), in, &out);
-
-    for (size_t i = 0; i < out.size(); i++) {
-      objs_holder->objs_[out[i].detect_id]->track_id = std::to_string(out[i].track_id);
-    }
+    CNInferObjsPtr objs_holder = data->collection.Get(kCNInferObjsSlot);
+    MatchObjects(GetContext(data), objs_holder, need_feature_, drop_tentative_, min_score_);
     TransmitData(data);
   };
 
+  if (!InitContexts()) {
+    LOGE(TRACK) << "Create the stream contexts failed.";
+    return false;
+  }
+  for (int i = 0; i < thread_num_; ++i) {
+    std::unique_ptr<TrackWorker> worker(new TrackWorker);
+    worker->thread_ = std::thread(&Tracker::WorkerLoop, this, worker.get());
+    workers_.push_back(std::move(worker));
+  }
   return true;
 }
 
 void Tracker::Close() {
-  for (auto &pair : contexts_) {
-    delete pair.second;
+  // the frames queued are tracked before the workers exit
+  for (auto &worker : workers_) {
+    worker->queue_.Push(nullptr);
+  }
+  for (auto &worker : workers_) {
+    if (worker->thread_.joinable()) worker->thread_.join();
   }
+  workers_.clear();
+  // waits for the features being extracted before the contexts are released
+  mlu_extractor_.reset();
   contexts_.clear();
+  context_pool_.Clear();
   g_feature_extractor.reset();
 }
 
 int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
-  if (data->GetStreamIndex() >= GetMaxStreamNumber()) {
+  if (data->GetStreamIndex() >= contexts_.size()) {
     return -1;
   }
+  if (!workers_.empty()) {
+    // frames of a stream are always tracked by the same worker, EOS is transmitted after the frames before it
+    workers_[data->GetStreamIndex() % workers_.size()]->queue_.Push(data);
+    return 0;
+  }
+  return ProcessFrame(data);
+}
+
+int Tracker::ProcessFrame(const CNFrameInfoPtr &data) {
   if (need_feature_ && !InitFeatureExtractor(data)) {
     LOGE(TRACK) << "Init Feature Extractor Failed.";
     return -1;
   }
 
+  TrackerContext *&ctx = contexts_[data->GetStreamIndex()];
   if (!data->IsEos()) {
-    CNDataFramePtr frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+    CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
     if (frame->width <= 0 || frame->height <= 0) {
       LOGE(TRACK) << "Frame width and height can not be lower than 0.";
       return -1;
     }
-    bool have_obj = data->collection.HasValue(kCNInferObjsTag);
+    if (!ctx) ctx = context_pool_.Acquire(data->stream_id);
+    if (!ctx) {
+      LOGE(TRACK) << "Create the context of stream [" << data->stream_id << "] failed.";
+      return -1;
+    }
+    bool have_obj = data->collection.HasValue(kCNInferObjsSlot);
     if (have_obj) {
-      CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+      CNInferObjsPtr objs_holder = data->collection.Get(kCNInferObjsSlot);
       for (size_t idx = 0; idx < objs_holder->objs_.size(); ++idx) {
         auto &obj = objs_holder->objs_[idx];
         cnstream::CNInferBoundingBox &bbox = obj->bbox;
@@ -212,8 +437,16 @@ int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
     }
 
     if (need_feature_) {
+      bool extracted;
+      if (feature_reuse_frames_ > 0 && have_obj) {
+        std::vector<CNInferObjectPtr> selected;
+        SelectFeatureObjects(GetContext(data), data->collection.Get(kCNInferObjsSlot)->objs_, &selected);
+        extracted = GetFeatureExtractor()->ExtractFeature(data, selected);
+      } else {
+        extracted = GetFeatureExtractor()->ExtractFeature(data);
+      }
       // async extract feature
-      if (!g_feature_extractor->ExtractFeature(data)) {
+      if (!extracted) {
         LOGE(TRACK) << "Extract Feature failed";
         return -1;
       }
@@ -222,8 +455,11 @@ int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
     }
   } else {
     if (need_feature_) {
-      g_feature_extractor->WaitTaskDone(data->stream_id);
+      GetFeatureExtractor()->WaitTaskDone(data->stream_id);
     }
+    // the context is reset for the next stream getting the stream index
+    ctx = nullptr;
+    context_pool_.Release(data->stream_id);
     TransmitData(data);
   }
   return 0;
@@ -268,12 +504,62 @@ bool Tracker::CheckParamSet(const ModuleParamSet &paramSet) const {
     }
   }
 
+  if (paramSet.find("batch_timeout") != paramSet.end()) {
+    if (!checker.IsNum({"batch_timeout"}, paramSet, err_msg)) {
+      LOGE(TRACK) << "[Tracker] " << err_msg;
+      ret = false;
+    }
+  }
+
   if (paramSet.find("max_cosine_distance") != paramSet.end()) {
     if (!checker.IsNum({"max_cosine_distance"}, paramSet, err_msg)) {
       LOGE(TRACK) << "[Tracker] " << err_msg;
       ret = false;
     }
   }
+
+  if (paramSet.find("thread_num") != paramSet.end()) {
+    if (!checker.IsNum({"thread_num"}, paramSet, err_msg) || std::stoi(paramSet.at("thread_num")) < 0) {
+      LOGE(TRACK) << "[Tracker] [thread_num] : should be a non-negative number.";
+      ret = false;
+    }
+  }
+
+  if (paramSet.find("drop_tentative") != paramSet.end()) {
+    const std::string &value = paramSet.at("drop_tentative");
+    if (value != "true" && value != "false") {
+      LOGE(TRACK) << "[Tracker] [drop_tentative] : should be true or false.";
+      ret = false;
+    }
+  }
+
+  if (paramSet.find("min_score") != paramSet.end()) {
+    if (!checker.IsNum({"min_score"}, paramSet, err_msg)) {
+      LOGE(TRACK) << "[Tracker] " << err_msg;
+      ret = false;
+    }
+  }
+
+  if (paramSet.find("feature_reuse_frames") != paramSet.end()) {
+    if (!checker.IsNum({"feature_reuse_frames"}, paramSet, err_msg)) {
+      LOGE(TRACK) << "[Tracker] " << err_msg;
+      ret = false;
+    }
+  }
+
+  if (paramSet.find("warm_contexts") != paramSet.end()) {
+    if (!checker.IsNum({"warm_contexts"}, paramSet, err_msg)) {
+      LOGE(TRACK) << "[Tracker] " << err_msg;
+      ret = false;
+    }
+  }
+
+  CNFeaturePrecision precision;
+  if (paramSet.find("feature_precision") != paramSet.end() &&
+      !ParseFeaturePrecision(paramSet.at("feature_precision"), &precision)) {
+    LOGE(TRACK) << "[Tracker] [feature_precision] : should be fp32, fp16 or int8.";
+    ret = false;
+  }
   return ret;
 }
 
@@ -0,0 +1,168 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_TRACK_EVENT_HPP_
+#define MODULES_TRACK_EVENT_HPP_
+
+/**
+ *  @file track_event.hpp
+ *
+ *  This file contains a declaration of the TrackEventEmitter class.
+ */
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_frame_va.hpp"
+#include "cnstream_module.hpp"
+#include "private/cnstream_param.hpp"
+
+namespace cnstream {
+
+struct TrackEventContext;
+
+/**
+ * @brief The types of the events in the lifetime of a track.
+ */
+enum class TrackEventType {
+  APPEAR = 0,     ///< The track is seen for the first time.
+  UPDATE = 1,     ///< The track has moved significantly, or it is reported periodically.
+  DISAPPEAR = 2,  ///< The track is lost, or its stream ends.
+};
+
+/**
+ * @brief An event of a track.
+ */
+struct TrackEvent {
+  TrackEventType type = TrackEventType::APPEAR;  ///< The type of the event.
+  std::string stream_id;                         ///< The stream the track is in.
+  std::string track_id;                          ///< The track id of the object.
+  std::string label;                             ///< The label of the object, see CNInferObject::id.
+  float score = 0;                               ///< The score of the object.
+  CNInferBoundingBox bbox = {0, 0, 0, 0};        ///< The normalized bounding box of the object.
+  uint64_t frame_id = 0;                         ///< The frame the object is seen in, the last one for DISAPPEAR.
+  int64_t timestamp = 0;                         ///< The timestamp of the frame.
+  uint64_t frames = 0;                           ///< The number of frames from the appearance to the event.
+  CNInferObjectPtr object;                       ///< The object, nullptr for DISAPPEAR.
+};
+
+using TrackEvents = std::vector<TrackEvent>;
+
+/*!< value type in CNFrameInfo::Collection : TrackEvents, the events of the tracks happening at the frame. */
+static constexpr char kTrackEventsTag[] = "TrackEvents";
+
+struct TrackEventParam {
+  int update_interval = 25;     // A track is reported every update_interval frames, 0 means only when it moves
+  float move_threshold = 0.2f;  // A track is reported when it moves by this ratio of its size, 0 means never
+  int lost_frames = 25;         // A track disappears after not seen in lost_frames frames
+  bool keep_objects = false;    // Whether the objects without events are kept in the frame
+};
+
+/**
+ * @brief TrackEventEmitter is a module turning the tracked objects of each frame into the events of the tracks, so
+ * that the sinks send the changes of the scene instead of all objects of every frame.
+ *
+ * It is placed between Tracker and the sinks. For each track, it emits:
+ *   - APPEAR when the track is first seen,
+ *   - UPDATE when the box has moved or resized by ``move_threshold`` of its size since the track was last reported,
+ *     when the label changes, or ``update_interval`` frames after the last report,
+ *   - DISAPPEAR when the track is not seen for ``lost_frames`` frames, or its stream ends.
+ *
+ * The events are added to the frame in the collection tagged by kTrackEventsTag, e.g. sent by the Kafka module with
+ * TrackEventKafkaHandler, and notified by the callback set by SetTrackEventCallback. The DISAPPEAR events of the end
+ * of a stream are added to the EOS frame. Unless ``keep_objects`` is set, the tracked objects without APPEAR or UPDATE
+ * events are removed from the frame, so that the sinks dumping the objects of frames only send the changes. The
+ * objects without track ids are always kept.
+ */
+class TrackEventEmitter : public Module, public ModuleCreator<TrackEventEmitter> {
+ public:
+  /**
+   * @brief Notified of the events of a frame on the threads of the module. It should not block.
+   */
+  using TrackEventCallback = std::function<void(const TrackEvents &events)>;
+
+  /**
+   * @brief TrackEventEmitter constructor
+   *
+   * @param  name : module name
+   */
+  explicit TrackEventEmitter(const std::string &name);
+  /**
+   * @brief TrackEventEmitter destructor
+   */
+  ~TrackEventEmitter();
+
+  /**
+   * @brief Called by pipeline when pipeline start.
+   *
+   * @param paramSet : parameter set
+   *
+   * @return true if module open succeed, otherwise false.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+
+  /**
+   * @brief Called by pipeline when pipeline stop.
+   */
+  void Close() override;
+
+  /**
+   * @brief Updates the tracks of the stream with the objects of a frame, and attaches the events.
+   *
+   * @param data : data to be processed
+   *
+   * @return whether process succeed
+   * @retval 1: succeed, the frame is transmitted by this module
+   * @retval <0: failed
+   */
+  int Process(CNFrameInfoPtr data) override;
+
+  /**
+   * @brief The pixels are never read by this module.
+   *
+   * @return Returns false.
+   */
+  bool NeedsPixels() const override { return false; }
+
+  /**
+   * @brief Sets the callback of the events. It should be set before the pipeline starts.
+   *
+   * @param callback : the callback
+   */
+  void SetTrackEventCallback(TrackEventCallback callback);
+
+ private:
+  std::shared_ptr<TrackEventContext> GetContext(const std::string &stream_id, bool erase);
+  void Emit(const CNFrameInfoPtr &data, TrackEvents events);
+
+  std::unique_ptr<ModuleParamsHelper<TrackEventParam>> param_helper_ = nullptr;
+  TrackEventParam params_;
+  std::mutex ctx_lock_;
+  std::map<std::string, std::shared_ptr<TrackEventContext>> contexts_;
+  TrackEventCallback callback_ = nullptr;
+};  // class TrackEventEmitter
+
+}  // namespace cnstream
+
+#endif  // MODULES_TRACK_EVENT_HPP_
@@ -0,0 +1,227 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "track_event.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+struct TrackEventContext {
+  struct Track {
+    std::string label;
+    float score = 0;
+    CNInferBoundingBox bbox = {0, 0, 0, 0};      // the box last seen
+    uint64_t frame_id = 0;                       // the frame last seen in
+    int64_t timestamp = 0;
+    uint64_t first_index = 0;                    // the indexes of the frames of the stream
+    uint64_t last_seen_index = 0;
+    uint64_t reported_index = 0;
+    CNInferBoundingBox reported = {0, 0, 0, 0};  // the box last reported
+    std::string reported_label;
+  };
+  uint64_t frame_index = 0;
+  std::unordered_map<std::string, Track> tracks;
+};
+
+namespace {
+
+// the largest change of the center and the size of a box, in ratio of the size of the box before
+float Movement(const CNInferBoundingBox &from, const CNInferBoundingBox &to) {
+  const float w = std::max(from.w, 1e-6f), h = std::max(from.h, 1e-6f);
+  const float dx = std::abs(to.x + to.w / 2 - from.x - from.w / 2) / w;
+  const float dy = std::abs(to.y + to.h / 2 - from.y - from.h / 2) / h;
+  return std::max(std::max(dx, dy), std::max(std::abs(to.w - from.w) / w, std::abs(to.h - from.h) / h));
+}
+
+TrackEvent MakeEvent(TrackEventType type, const std::string &stream_id, const std::string &track_id,
+                     const TrackEventContext::Track &track) {
+  TrackEvent event;
+  event.type = type;
+  event.stream_id = stream_id;
+  event.track_id = track_id;
+  event.label = track.label;
+  event.score = track.score;
+  event.bbox = track.bbox;
+  event.frame_id = track.frame_id;
+  event.timestamp = track.timestamp;
+  event.frames = track.last_seen_index - track.first_index + 1;
+  return event;
+}
+
+}  // namespace
+
+TrackEventEmitter::TrackEventEmitter(const std::string &name) : Module(name) {
+  hasTransmit_.store(true);
+  param_register_.SetModuleDesc("TrackEventEmitter is a module turning the tracked objects of each frame into the"
+                                " appear, update and disappear events of the tracks.");
+  param_helper_.reset(new (std::nothrow) ModuleParamsHelper<TrackEventParam>(name));
+  static const std::vector<ModuleParamDesc> regist_param = {
+      {"update_interval", "25", "A track is reported every update_interval frames even if it does not move. 0 means"
+       " it is only reported when it moves.", PARAM_OPTIONAL, OFFSET(TrackEventParam, update_interval),
+       ModuleParamParser<int>::Parser, "int"},
+      {"move_threshold", "0.2", "A track is reported when its center or size changes by this ratio of its size since"
+       " it was last reported. 0 means it is not reported for moving.", PARAM_OPTIONAL,
+       OFFSET(TrackEventParam, move_threshold), ModuleParamParser<float>::Parser, "float"},
+      {"lost_frames", "25", "A track disappears when it is not seen in lost_frames frames.", PARAM_OPTIONAL,
+       OFFSET(TrackEventParam, lost_frames), ModuleParamParser<int>::Parser, "int"},
+      {"keep_objects", "false", "Whether the tracked objects without events are kept in the frame. By default they"
+       " are removed, so that the sinks dumping the objects of frames only send the changes.", PARAM_OPTIONAL,
+       OFFSET(TrackEventParam, keep_objects), ModuleParamParser<bool>::Parser, "bool"}};
+  param_helper_->Register(regist_param, &param_register_);
+}
+
+TrackEventEmitter::~TrackEventEmitter() { Close(); }
+
+bool TrackEventEmitter::Open(ModuleParamSet paramSet) {
+  if (!param_helper_->ParseParams(paramSet)) {
+    LOGE(TrackEvent) << "[" << GetName() << "] parse parameters failed.";
+    return false;
+  }
+  auto params = param_helper_->GetParams();
+  if (params.update_interval < 0 || params.move_threshold < 0 || params.lost_frames < 1) {
+    LOGE(TrackEvent) << "Open() update_interval and move_threshold should not be negative, lost_frames should be"
+                     << " greater than 0";
+    return false;
+  }
+  params_ = params;
+  Close();
+  return true;
+}
+
+void TrackEventEmitter::Close() {
+  std::lock_guard<std::mutex> lk(ctx_lock_);
+  contexts_.clear();
+}
+
+void TrackEventEmitter::SetTrackEventCallback(TrackEventCallback callback) { callback_ = std::move(callback); }
+
+std::shared_ptr<TrackEventContext> TrackEventEmitter::GetContext(const std::string &stream_id, bool erase) {
+  std::lock_guard<std::mutex> lk(ctx_lock_);
+  auto search = contexts_.find(stream_id);
+  if (erase) {
+    if (search == contexts_.end()) return nullptr;
+    std::shared_ptr<TrackEventContext> ctx = std::move(search->second);
+    contexts_.erase(search);
+    return ctx;
+  }
+  if (search != contexts_.end()) return search->second;
+  auto ctx = std::make_shared<TrackEventContext>();
+  contexts_[stream_id] = ctx;
+  return ctx;
+}
+
+void TrackEventEmitter::Emit(const CNFrameInfoPtr &data, TrackEvents events) {
+  if (events.empty()) return;
+  if (callback_) callback_(events);
+  data->collection.Add(kTrackEventsTag, std::move(events));
+}
+
+int TrackEventEmitter::Process(CNFrameInfoPtr data) {
+  if (nullptr == data) return -1;
+  if (data->IsEos()) {
+    // the tracks left disappear with the stream
+    std::shared_ptr<TrackEventContext> ctx = GetContext(data->stream_id, true);
+    TrackEvents events;
+    if (ctx) {
+      for (const auto &it : ctx->tracks) {
+        events.push_back(MakeEvent(TrackEventType::DISAPPEAR, data->stream_id, it.first, it.second));
+      }
+    }
+    Emit(data, std::move(events));
+    TransmitData(data);
+    return 1;
+  }
+  if (data->IsRemoved()) {
+    TransmitData(data);
+    return 1;
+  }
+
+  std::shared_ptr<TrackEventContext> ctx = GetContext(data->stream_id, false);
+  const uint64_t index = ctx->frame_index++;
+  const uint64_t frame_id =
+      data->collection.HasValue(kCNDataFrameSlot) ? data->collection.Get(kCNDataFrameSlot)->frame_id : index;
+  TrackEvents events;
+  CNInferObjsPtr objs_holder;
+  CNInferObjsSnapshot objs;
+  std::vector<CNInferObjectPtr> kept;
+  if (data->collection.HasValue(kCNInferObjsSlot)) {
+    objs_holder = data->collection.Get(kCNInferObjsSlot);
+    objs = objs_holder->GetSnapshot();
+    kept.reserve(objs->size());
+    for (const auto &obj : *objs) {
+      if (obj->track_id.empty()) {
+        kept.push_back(obj);
+        continue;
+      }
+      auto ret = ctx->tracks.emplace(obj->track_id, TrackEventContext::Track());
+      TrackEventContext::Track &track = ret.first->second;
+      track.label = obj->id;
+      track.score = obj->score;
+      track.bbox = obj->bbox;
+      track.frame_id = frame_id;
+      track.timestamp = data->timestamp;
+      track.last_seen_index = index;
+      TrackEventType type = TrackEventType::UPDATE;
+      if (ret.second) {
+        type = TrackEventType::APPEAR;
+        track.first_index = index;
+      } else if (track.label == track.reported_label &&
+                 (params_.move_threshold <= 0 || Movement(track.reported, track.bbox) < params_.move_threshold) &&
+                 (params_.update_interval <= 0 ||
+                  index - track.reported_index < static_cast<uint64_t>(params_.update_interval))) {
+        continue;
+      }
+      track.reported = track.bbox;
+      track.reported_label = track.label;
+      track.reported_index = index;
+      events.push_back(MakeEvent(type, data->stream_id, ret.first->first, track));
+      events.back().object = obj;
+      kept.push_back(obj);
+    }
+  }
+  for (auto it = ctx->tracks.begin(); it != ctx->tracks.end();) {
+    if (index - it->second.last_seen_index >= static_cast<uint64_t>(params_.lost_frames)) {
+      events.push_back(MakeEvent(TrackEventType::DISAPPEAR, data->stream_id, it->first, it->second));
+      it = ctx->tracks.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (!params_.keep_objects && objs && kept.size() != objs->size()) {
+    std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+    objs_holder->objs_ = std::move(kept);
+    objs_holder->Publish();
+  }
+  Emit(data, std::move(events));
+  TransmitData(data);
+  return 1;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,169 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "columnar_batch.hpp"
+#include "columnar_sink.hpp"
+
+namespace cnstream {
+
+static std::string TestOutputFile() { return "/tmp/cnstream_test_columnar_" + std::to_string(getpid()) + ".cncb"; }
+
+static std::string ReadFile(const std::string &path) {
+  std::ifstream ifs(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+static std::shared_ptr<CNFrameInfo> CreateFrame(const std::string &stream_id, int64_t pts, int obj_num) {
+  auto data = CNFrameInfo::Create(stream_id);
+  data->timestamp = pts;
+  auto objs_holder = std::make_shared<CNInferObjs>();
+  for (int i = 0; i < obj_num; ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = std::to_string(i % 3);
+    obj->track_id = std::to_string(i);
+    obj->score = 0.5f;
+    obj->bbox = {0.1f, 0.2f, 0.3f, 0.4f};
+    objs_holder->objs_.push_back(obj);
+  }
+  data->collection.Add(kCNInferObjsTag, objs_holder);
+  return data;
+}
+
+TEST(ColumnarSink, BatchSerializeAndParse) {
+  ColumnarBatch batch;
+  batch.Append("stream_0", 0, 100, 7, 1, 0.9f, 0.1f, 0.2f, 0.3f, 0.4f);
+  batch.Append("stream_1", 3, 300, -1, 2, 0.8f, 0.5f, 0.6f, 0.1f, 0.2f);
+  batch.Append("stream_0", 1, 200, 7, 1, 0.7f, 0.2f, 0.2f, 0.3f, 0.4f);
+  EXPECT_EQ(batch.Rows(), 3u);
+  ASSERT_EQ(batch.stream_dict.size(), 2u);
+
+  std::string chunk;
+  batch.Serialize(&chunk);
+  EXPECT_EQ(chunk.size() % 8, 0u);
+  // chunks are concatenated in a file
+  ColumnarBatch empty;
+  empty.Serialize(&chunk);
+
+  ColumnarBatch parsed;
+  size_t consumed = 0;
+  ASSERT_TRUE(parsed.Parse(chunk.data(), chunk.size(), &consumed));
+  ASSERT_EQ(parsed.Rows(), 3u);
+  EXPECT_EQ(parsed.stream_dict[parsed.stream_index[2]], "stream_0");
+  EXPECT_EQ(parsed.stream_dict[parsed.stream_index[1]], "stream_1");
+  EXPECT_EQ(parsed.frame_id[1], 3);
+  EXPECT_EQ(parsed.pts[2], 200);
+  EXPECT_EQ(parsed.track_id[1], -1);
+  EXPECT_EQ(parsed.label[0], 1);
+  EXPECT_FLOAT_EQ(parsed.score[1], 0.8f);
+  EXPECT_FLOAT_EQ(parsed.x[2], 0.2f);
+  EXPECT_FLOAT_EQ(parsed.h[1], 0.2f);
+  ASSERT_LT(consumed, chunk.size());
+  ASSERT_TRUE(parsed.Parse(chunk.data() + consumed, chunk.size() - consumed));
+  EXPECT_EQ(parsed.Rows(), 3u);
+
+  // truncated or broken chunks are not parsed
+  EXPECT_FALSE(parsed.Parse(chunk.data(), consumed - 1));
+  std::string broken = chunk.substr(0, consumed);
+  broken[0] = 'X';
+  EXPECT_FALSE(parsed.Parse(broken.data(), broken.size()));
+  EXPECT_EQ(parsed.Rows(), 3u);
+
+  batch.Clear();
+  EXPECT_EQ(batch.Rows(), 0u);
+  EXPECT_TRUE(batch.stream_dict.empty());
+}
+
+TEST(ColumnarSink, OpenClose) {
+  ColumnarSink module("columnar_sink");
+  ModuleParamSet params;
+  params["output_file"] = TestOutputFile();
+  EXPECT_TRUE(module.CheckParamSet(params));
+  EXPECT_TRUE(module.Open(params));
+  module.Close();
+  EXPECT_TRUE(ReadFile(TestOutputFile()).empty());
+
+  params["batch_rows"] = "0";
+  EXPECT_FALSE(module.Open(params));
+  params["batch_rows"] = "16";
+  params["max_pending_batches"] = "abc";
+  EXPECT_FALSE(module.Open(params));
+  params["max_pending_batches"] = "2";
+  params["output_file"] = "/nonexistent_dir/results.cncb";
+  EXPECT_FALSE(module.Open(params));
+  unlink(TestOutputFile().c_str());
+}
+
+TEST(ColumnarSink, Process) {
+  ColumnarSink module("columnar_sink");
+  ModuleParamSet params;
+  params["output_file"] = TestOutputFile();
+  params["batch_rows"] = "100";
+  params["max_pending_batches"] = "1";
+  ASSERT_TRUE(module.Open(params));
+  EXPECT_FALSE(module.NeedsPixels());
+
+  const int thread_num = 4, frame_num = 200, obj_num = 3;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < frame_num; ++i) EXPECT_EQ(module.Process(CreateFrame(std::to_string(t), i, obj_num)), 0);
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  // frames without objects and eos produce no rows
+  EXPECT_EQ(module.Process(CreateFrame("0", frame_num, 0)), 0);
+  EXPECT_EQ(module.Process(CNFrameInfo::Create("0", true)), 0);
+  module.OnEos("0");
+  module.Close();
+
+  const std::string content = ReadFile(TestOutputFile());
+  ColumnarBatch parsed;
+  size_t pos = 0, chunks = 0;
+  while (pos < content.size()) {
+    size_t consumed = 0;
+    ASSERT_TRUE(parsed.Parse(content.data() + pos, content.size() - pos, &consumed));
+    pos += consumed;
+    ++chunks;
+  }
+  ASSERT_EQ(parsed.Rows(), static_cast<size_t>(thread_num * frame_num * obj_num));
+  EXPECT_GE(chunks, static_cast<size_t>(thread_num * frame_num * obj_num / 102));
+  // the rows of every stream keep the order of frames
+  std::vector<int64_t> last_pts(thread_num, -1);
+  for (size_t r = 0; r < parsed.Rows(); ++r) {
+    const int stream = std::stoi(parsed.stream_dict[parsed.stream_index[r]]);
+    EXPECT_GE(parsed.pts[r], last_pts[stream]);
+    last_pts[stream] = parsed.pts[r];
+    EXPECT_EQ(parsed.frame_id[r], -1);
+    EXPECT_EQ(parsed.label[r], parsed.track_id[r] % 3);
+  }
+  unlink(TestOutputFile().c_str());
+}
+
+}  // namespace cnstream
@@ -0,0 +1,224 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "best_shot.hpp"
+#include "best_shot_selector.hpp"
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+static constexpr const char *gname = "best_shot";
+
+static CNInferObjectPtr MakeObject(const std::string &track_id, float score, float x, float y, float w, float h) {
+  auto obj = std::make_shared<CNInferObject>();
+  obj->id = "1";
+  obj->track_id = track_id;
+  obj->score = score;
+  obj->bbox.x = x;
+  obj->bbox.y = y;
+  obj->bbox.w = w;
+  obj->bbox.h = h;
+  return obj;
+}
+
+TEST(BestShot, SelectorKeepsBest) {
+  BestShotSelector::Param param;
+  param.lost_frames = 3;
+  BestShotSelector selector(param);
+  std::vector<BestShotCandidate> improved;
+  std::vector<std::string> finished;
+  // larger ones are better, a slight improvement is not cropped again
+  selector.Update(0, 1000, 1000, {MakeObject("1", 0.9, 0.4, 0.4, 0.1, 0.1)}, &improved, &finished);
+  ASSERT_EQ(1u, improved.size());
+  EXPECT_EQ("1", improved[0].track_id);
+  EXPECT_EQ(0, improved[0].frame_index);
+  selector.Update(1, 1000, 1000, {MakeObject("1", 0.9, 0.4, 0.4, 0.2, 0.2)}, &improved, &finished);
+  ASSERT_EQ(2u, improved.size());
+  EXPECT_EQ(1, improved[1].frame_index);
+  selector.Update(2, 1000, 1000, {MakeObject("1", 0.95, 0.4, 0.4, 0.2, 0.2)}, &improved, &finished);
+  selector.Update(3, 1000, 1000, {MakeObject("1", 0.9, 0.4, 0.4, 0.1, 0.1)}, &improved, &finished);
+  EXPECT_EQ(2u, improved.size());
+  // cut by the border, low scores, small ones and untracked ones are not better
+  selector.Update(4, 1000, 1000, {MakeObject("1", 0.9, 0, 0.4, 0.25, 0.25), MakeObject("2", 0.3, 0.1, 0.1, 0.5, 0.5),
+                                  MakeObject("3", 0.9, 0.1, 0.1, 0.02, 0.5), MakeObject("", 0.9, 0.1, 0.1, 0.5, 0.5)},
+                  &improved, &finished);
+  EXPECT_EQ(2u, improved.size());
+  EXPECT_TRUE(finished.empty());
+  EXPECT_EQ(3u, selector.GetTrackCount());
+  // tracks without crops are not finished
+  selector.Update(7, 1000, 1000, {}, &improved, &finished);
+  ASSERT_EQ(1u, finished.size());
+  EXPECT_EQ("1", finished[0]);
+  EXPECT_EQ(0u, selector.GetTrackCount());
+}
+
+TEST(BestShot, SelectorMaxTrackFrames) {
+  BestShotSelector::Param param;
+  param.lost_frames = 5;
+  param.max_track_frames = 10;
+  BestShotSelector selector(param);
+  std::vector<BestShotCandidate> improved;
+  std::vector<std::string> finished;
+  for (int i = 0; i < 30; ++i) {
+    float size = 0.1 + 0.02 * i;
+    selector.Update(i, 1000, 1000, {MakeObject("1", 0.9, 0.1, 0.1, size, size)}, &improved, &finished);
+  }
+  // finished once in time, the objects after it are ignored
+  ASSERT_EQ(1u, finished.size());
+  for (const auto &candidate : improved) EXPECT_LE(candidate.frame_index, 10);
+  selector.Flush(&finished);
+  EXPECT_EQ(1u, finished.size());
+
+  selector.Update(30, 1000, 1000, {MakeObject("2", 0.9, 0.1, 0.1, 0.1, 0.1)}, &improved, &finished);
+  selector.Flush(&finished);
+  ASSERT_EQ(2u, finished.size());
+  EXPECT_EQ("2", finished[1]);
+  EXPECT_EQ(0u, selector.GetTrackCount());
+}
+
+TEST(BestShot, Crop) {
+  int x, y, w, h;
+  // a tall object is grown in width to the square image
+  CNInferBoundingBox bbox{0.5, 0.25, 0.05, 0.5};
+  GetBestShotCrop(bbox, 1920, 1080, 224, 224, 0, &x, &y, &w, &h);
+  EXPECT_EQ(540, h);
+  EXPECT_EQ(540, w);
+  EXPECT_EQ(0, x % 2);
+  EXPECT_EQ(0, y % 2);
+  EXPECT_NEAR(960 + 48, x + w / 2, 2);
+  EXPECT_NEAR(270 + 270, y + h / 2, 2);
+  // kept in the frame
+  bbox = {0.9, 0.8, 0.1, 0.2};
+  GetBestShotCrop(bbox, 1920, 1080, 224, 224, 0.2, &x, &y, &w, &h);
+  EXPECT_LE(x + w, 1920);
+  EXPECT_LE(y + h, 1080);
+  EXPECT_GE(x, 0);
+  EXPECT_GE(y, 0);
+  EXPECT_NEAR(w, h, 2);
+  // larger than the frame
+  bbox = {0, 0, 1, 1};
+  GetBestShotCrop(bbox, 352, 288, 100, 200, 0.1, &x, &y, &w, &h);
+  EXPECT_EQ(0, x);
+  EXPECT_EQ(0, y);
+  EXPECT_EQ(352, w);
+  EXPECT_EQ(288, h);
+}
+
+TEST(BestShot, OpenClose) {
+  BestShot module(gname);
+  ModuleParamSet params;
+  params["encoder_type"] = "cpu";
+  EXPECT_TRUE(module.Open(params));
+  module.Close();
+  params["width"] = "128";
+  params["height"] = "256";
+  params["max_track_frames"] = "100";
+  EXPECT_TRUE(module.Open(params));
+  module.Close();
+}
+
+TEST(BestShot, OpenFailed) {
+  BestShot module(gname);
+  ModuleParamSet params;
+  params["encoder_type"] = "mlu";
+  params["device_id"] = "-1";
+  EXPECT_FALSE(module.Open(params));
+  params["encoder_type"] = "cpu";
+  params["width"] = "8";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("width");
+  params["jpeg_quality"] = "0";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("jpeg_quality");
+  params["lost_frames"] = "0";
+  EXPECT_FALSE(module.Open(params));
+}
+
+TEST(BestShot, ProcessCpuFrames) {
+  std::string folder_str = "./encode_output/best_shots";
+  int status = mkdir("./encode_output/", 0777);
+  ASSERT_FALSE((status < 0) && (errno != EEXIST));
+
+  BestShot module(gname);
+  ModuleParamSet params;
+  params["encoder_type"] = "cpu";
+  params["lost_frames"] = "5";
+  params["output_dir"] = folder_str;
+  std::mutex mtx;
+  std::vector<BestShotImagePtr> images;
+  module.SetBestShotCallback([&](const BestShotImagePtr &image) {
+    std::lock_guard<std::mutex> lk(mtx);
+    images.push_back(image);
+  });
+  ASSERT_TRUE(module.Open(params));
+
+  int width = 352, height = 288;
+  cv::Mat img(height, width, CV_8UC3, cv::Scalar(0, 127, 0));
+  size_t carried = 0;
+  for (int i = 0; i < 40; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+    frame->frame_id = i;
+    data->timestamp = i;
+    frame->width = width;
+    frame->height = height;
+    void *ptr_cpu[1] = {img.data};
+    frame->stride[0] = width;
+    frame->ctx.dev_type = DevContext::DevType::CPU;
+    frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_BGR24;
+    frame->CopyToSyncMem(ptr_cpu, false);
+    data->collection.Add(kCNDataFrameTag, frame);
+    // track 1 grows in the first 20 frames, track 2 lives to the end
+    auto objs_holder = std::make_shared<CNInferObjs>();
+    if (i < 20) objs_holder->objs_.push_back(MakeObject("1", 0.9, 0.2, 0.2, 0.2 + 0.02 * i, 0.2 + 0.02 * i));
+    objs_holder->objs_.push_back(MakeObject("2", 0.8, 0.5, 0.5, 0.3, 0.3));
+    data->collection.Add(kCNInferObjsTag, objs_holder);
+    EXPECT_EQ(0, module.Process(data));
+    if (data->collection.HasValue(kBestShotImagesTag)) {
+      carried += data->collection.Get<BestShotImages>(kBestShotImagesTag).size();
+    }
+  }
+  module.OnEos("0");
+  module.Close();
+
+  EXPECT_LE(carried, 1u);
+  std::lock_guard<std::mutex> lk(mtx);
+  ASSERT_EQ(2u, images.size());
+  for (const auto &image : images) {
+    EXPECT_EQ("0", image->stream_id);
+    EXPECT_FALSE(image->jpeg.empty());
+    EXPECT_EQ(224, image->width);
+    struct stat st;
+    EXPECT_EQ(0, stat(image->file_name.c_str(), &st));
+  }
+  // the latest crop of track 1 is the largest one
+  const BestShotImagePtr &first = images[0]->track_id == "1" ? images[0] : images[1];
+  EXPECT_GE(first->frame_id, 15u);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,182 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "clip_recorder.hpp"
+#include "cnstream_frame_va.hpp"
+#include "video/gop_ring.hpp"
+
+namespace cnstream {
+
+static constexpr const char *gname = "clip_recorder";
+
+static video::StoredPacketPtr MakePacket(int64_t pts, bool key, uint32_t size = 100) {
+  std::vector<uint8_t> data(size, 0);
+  VideoPacket packet;
+  memset(&packet, 0, sizeof(packet));
+  packet.data = data.data();
+  packet.size = size;
+  packet.pts = packet.dts = pts;
+  if (key) packet.SetKey();
+  return std::make_shared<video::StoredPacket>(packet);
+}
+
+TEST(ClipRecorder, GopRingKeepsPreRoll) {
+  // 25 fps in 90 kHz, a key frame every 5 frames, 1 second pre-roll
+  const int64_t interval = 3600, gop = 5 * interval, duration = 90000;
+  video::GopRing ring(duration, 1 << 20);
+  EXPECT_FALSE(ring.Push(MakePacket(-interval, false)));
+  EXPECT_EQ(0u, ring.GetBytes());
+  for (int i = 0; i < 100; ++i) EXPECT_TRUE(ring.Push(MakePacket(i * interval, i % 5 == 0)));
+  int64_t last = 99 * interval;
+  EXPECT_EQ(last, ring.GetLastPts());
+  // the oldest GOP starts before the pre-roll, the next one after it
+  EXPECT_LE(ring.GetStartPts(), last - duration);
+  EXPECT_GT(ring.GetStartPts() + gop, last - duration);
+  EXPECT_EQ(static_cast<size_t>((last - ring.GetStartPts()) / interval + 1) * 100, ring.GetBytes());
+
+  auto packets = ring.Since(last - duration);
+  ASSERT_FALSE(packets.empty());
+  EXPECT_TRUE(packets.front()->flags & VideoPacket::KEY);
+  EXPECT_EQ(ring.GetStartPts(), packets.front()->pts);
+  EXPECT_EQ(last, packets.back()->pts);
+  // a later pts starts at a later key frame
+  auto later = ring.Since(last - gop);
+  EXPECT_LT(later.size(), packets.size());
+  EXPECT_TRUE(later.front()->flags & VideoPacket::KEY);
+  EXPECT_LE(later.front()->pts, last - gop);
+
+  ring.Clear();
+  EXPECT_EQ(0u, ring.GetGopCount());
+  EXPECT_EQ(INVALID_TIMESTAMP, ring.GetStartPts());
+}
+
+TEST(ClipRecorder, GopRingMaxBytes) {
+  // the pre-roll is cut short by max bytes, but the latest GOP is always kept
+  video::GopRing ring(1000000, 1000);
+  for (int i = 0; i < 50; ++i) ring.Push(MakePacket(i, i % 5 == 0));
+  EXPECT_LE(ring.GetBytes(), 1000u);
+  EXPECT_EQ(2u, ring.GetGopCount());
+  for (int i = 50; i < 70; ++i) ring.Push(MakePacket(i, i == 50));
+  EXPECT_EQ(1u, ring.GetGopCount());
+  EXPECT_EQ(2000u, ring.GetBytes());
+}
+
+TEST(ClipRecorder, OpenClose) {
+  ClipRecorder module(gname);
+  ModuleParamSet params;
+  EXPECT_TRUE(module.Open(params));
+  module.Close();
+
+  params["file_name"] = "clips/clip.mkv";
+  params["pre_seconds"] = "5";
+  params["post_seconds"] = "0";
+  params["max_buffer_size"] = "16";
+  EXPECT_TRUE(module.Open(params));
+  module.Close();
+  EXPECT_FALSE(module.Trigger("0"));
+}
+
+TEST(ClipRecorder, OpenFailed) {
+  ClipRecorder module(gname);
+  ModuleParamSet params;
+  params["file_name"] = "clips/clip.h264";
+  EXPECT_FALSE(module.Open(params));
+  params["file_name"] = "clips/clip";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("file_name");
+  params["pre_seconds"] = "-1";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("pre_seconds");
+  params["max_buffer_size"] = "0";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("max_buffer_size");
+  params["obj_filter_name"] = "NoSuchFilter";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("obj_filter_name");
+  params["encoder_type"] = "mlu";
+  params["device_id"] = "-1";
+  EXPECT_FALSE(module.Open(params));
+}
+
+TEST(ClipRecorder, ProcessTriggeredClip) {
+  std::string folder_str = "./encode_output/";
+  int status = mkdir(folder_str.c_str(), 0777);
+  ASSERT_FALSE((status < 0) && (errno != EEXIST));
+  std::string clip_name = folder_str + "clip_0_0.mp4";
+  remove(clip_name.c_str());
+
+  ClipRecorder module(gname);
+  ModuleParamSet params;
+  params["encoder_type"] = "cpu";
+  params["frame_rate"] = "25";
+  params["gop_size"] = "5";
+  params["pre_seconds"] = "1";
+  params["post_seconds"] = "1";
+  params["file_name"] = folder_str + "clip.mp4";
+  std::mutex mtx;
+  std::vector<std::string> clips;
+  module.SetTrigger([](const CNFrameInfoPtr &data) {
+    return data->collection.Get(kCNDataFrameSlot)->frame_id == 50;
+  });
+  module.SetClipCallback([&](const std::string &stream_id, const std::string &file_name, bool success) {
+    std::lock_guard<std::mutex> lk(mtx);
+    EXPECT_EQ("0", stream_id);
+    EXPECT_TRUE(success);
+    clips.push_back(file_name);
+  });
+  ASSERT_TRUE(module.Open(params));
+
+  int width = 352, height = 288;
+  cv::Mat img(height, width, CV_8UC3, cv::Scalar(0, 127, 0));
+  for (int i = 0; i < 150; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+    frame->frame_id = i;
+    data->timestamp = INVALID_TIMESTAMP;
+    frame->width = width;
+    frame->height = height;
+    void *ptr_cpu[1] = {img.data};
+    frame->stride[0] = width;
+    frame->ctx.dev_type = DevContext::DevType::CPU;
+    frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_BGR24;
+    frame->CopyToSyncMem(ptr_cpu, false);
+    data->collection.Add(kCNDataFrameTag, frame);
+    EXPECT_EQ(0, module.Process(data));
+  }
+  module.OnEos("0");
+  module.Close();
+
+  // one clip of about 2 seconds around frame 50, not the whole stream
+  ASSERT_EQ(1u, clips.size());
+  EXPECT_EQ(clip_name, clips[0]);
+  struct stat st;
+  EXPECT_EQ(0, stat(clip_name.c_str(), &st));
+}
+
+}  // namespace cnstream
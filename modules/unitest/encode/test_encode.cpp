@@ -21,7 +21,9 @@
 #include <gtest/gtest.h>
 #include <sys/stat.h>
 
+#include <atomic>
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <memory>
@@ -32,6 +34,7 @@
 #include "cnstream_frame_va.hpp"
 #include "easyinfer/mlu_memory_op.h"
 #include "encode.hpp"
+#include "video/video_stream/video_stream_bus.hpp"
 
 namespace cnstream {
 static constexpr const char *gname = "encode";
@@ -81,7 +84,8 @@ TEST(EncodeModule, OpenFailed) {
   params["encoder_type"] = "cpu";
 
   std::vector<std::string> digit_params_vec = {
-      "device_id", "dst_width", "dst_height", "frame_rate", "bit_rate", "view_cols", "view_rows"};
+      "device_id", "dst_width", "dst_height", "frame_rate", "bit_rate", "view_cols", "view_rows", "crf",
+      "cpu_encoder_threads", "roi_qp_offset", "background_qp_offset"};
   for (auto& param_name : digit_params_vec) {
     params[param_name] = "not_digit";
     EXPECT_FALSE(module.Open(params));
@@ -99,10 +103,41 @@ TEST(EncodeModule, OpenFailed) {
   EXPECT_FALSE(module.Open(params));
   params["device_id"] = "0";
 
+  params["segment_duration"] = "-1";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("segment_duration");
+  params["write_buffer_size"] = "abc";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("write_buffer_size");
+  params["rate_control"] = "vbr";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("rate_control");
+  params["crf"] = "52";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("crf");
+  params["cpu_encoder_threads"] = "-1";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("cpu_encoder_threads");
+  params["overload_downscale"] = "not_bool";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("overload_downscale");
+  params["roi_qp_offset"] = "-52";
+  EXPECT_FALSE(module.Open(params));
+  params["roi_qp_offset"] = "-6";
+  params["background_qp_offset"] = "52";
+  EXPECT_FALSE(module.Open(params));
+  params["background_qp_offset"] = "6";
+  EXPECT_TRUE(module.Open(params));
+  params.erase("roi_qp_offset");
+  params.erase("background_qp_offset");
+
+#ifndef HAVE_CNCV
+  // tiling mlu input frames is done by cncv
   params["input_frame"] = "mlu";
   params["view_rows"] = "2";
   params["view_cols"] = "2";
   EXPECT_FALSE(module.Open(params));
+#endif
   module.Close();
 }
 
@@ -250,6 +285,34 @@ TEST(EncodeModule, ProcessEncode) {
   }
 }
 
+TEST(EncodeModule, ProcessEncodeSegments) {
+  std::vector<std::pair<uint32_t, uint32_t>> src_wh_vec = {{720, 480}};
+  ModuleParamSet params;
+  std::string folder_str = "./encode_output/";
+  int status = mkdir(folder_str.c_str(), 0777);
+  ASSERT_FALSE((status < 0) && (errno != EEXIST));
+
+  // 20 frames of 5 fps and 1 second segments, key frame every 5 frames
+  params["dst_width"] = "720";
+  params["dst_height"] = "480";
+  params["frame_rate"] = "5";
+  params["gop_size"] = "5";
+  params["segment_duration"] = "1";
+  params["write_buffer_size"] = "8";
+  for (std::string file_name_ext : {"mp4", "ts"}) {
+    for (std::string encoder_type : {"cpu", "mlu"}) {
+      params["encoder_type"] = encoder_type;
+      params["file_name"] = folder_str + "segments_" + encoder_type + "." + file_name_ext;
+      std::string segment_prefix = folder_str + "segments_" + encoder_type + "_0_";
+      for (int i = 0; i < 8; ++i) remove((segment_prefix + std::to_string(i) + "." + file_name_ext).c_str());
+      TestFunc(params, src_wh_vec, 20);
+      struct stat st;
+      EXPECT_EQ(0, stat((segment_prefix + "0." + file_name_ext).c_str(), &st));
+      EXPECT_EQ(0, stat((segment_prefix + "1." + file_name_ext).c_str(), &st));
+    }
+  }
+}
+
 TEST(EncodeModule, ProcessEncodeResample) {
   std::vector<std::pair<uint32_t, uint32_t>> src_wh_vec = {{720, 480}, {1200, 720}, {360, 240}};
   std::vector<std::pair<uint32_t, uint32_t>> dst_wh_vec = {{720, 480}, {1920, 1080}, {352, 288}, {501, 299}};
@@ -353,4 +416,59 @@ TEST(EncodeModule, ProcessCpuEncodeMultiViews) {
   }
 }
 
+TEST(EncodeModule, VideoStreamBusShareEncoder) {
+  VideoStream::Param param;
+  param.width = 320;
+  param.height = 240;
+  param.tile_cols = 0;
+  param.tile_rows = 0;
+  param.frame_rate = 25;
+  param.time_base = 1000;
+  param.bit_rate = 1000000;
+  param.gop_size = 10;
+  param.pixel_format = VideoPixelFormat::I420;
+  param.mlu_encoder = false;
+  param.resample = false;
+
+  std::atomic<int> callback_count{0};
+  auto sub_callback = VideoStreamBus::Subscribe("bus_test", param,
+                                                [&](const VideoPacket *) { callback_count++; }, nullptr);
+  ASSERT_TRUE(sub_callback);
+  auto sub_queue = VideoStreamBus::Subscribe("bus_test", param, nullptr, nullptr);
+  ASSERT_TRUE(sub_queue);
+  EXPECT_EQ(sub_queue->GetSubscriberCount(), 2u);
+
+  // another encoding parameter opens another channel
+  VideoStream::Param other_param = param;
+  other_param.bit_rate = 2000000;
+  auto sub_other = VideoStreamBus::Subscribe("bus_test", other_param, nullptr, nullptr);
+  ASSERT_TRUE(sub_other);
+  EXPECT_EQ(sub_other->GetSubscriberCount(), 1u);
+  sub_other->Close();
+
+  int frame_num = 30;
+  cv::Mat mat(param.height, param.width, CV_8UC3, cv::Scalar(0, 0, 0));
+  for (int i = 0; i < frame_num; ++i) {
+    // both consumers update the same frame, it is encoded only once
+    EXPECT_TRUE(sub_callback->Update(mat, VideoStream::ColorFormat::BGR, i * 40, "0", i));
+    EXPECT_TRUE(sub_queue->Update(mat, VideoStream::ColorFormat::BGR, i * 40, "0", i));
+  }
+  sub_callback->Close();
+  EXPECT_EQ(sub_queue->GetSubscriberCount(), 1u);
+  sub_queue->Close(true);
+
+  int packet_count = 0;
+  VideoPacket packet;
+  std::vector<uint8_t> data(0x100000);
+  packet.data = data.data();
+  packet.size = data.size();
+  while (sub_queue->GetPacket(&packet) > 0) {
+    packet_count++;
+    packet.size = data.size();
+  }
+  EXPECT_GT(packet_count, 0);
+  EXPECT_LE(packet_count, frame_num);
+  EXPECT_LE(callback_count.load(), packet_count);
+}
+
 }  // namespace cnstream
@@ -0,0 +1,103 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "scaler/scaler.hpp"
+
+namespace cnstream {
+
+static const char *scaler_color_str[] = {"I420", "NV12", "NV21", "BGR", "RGB", "BGRA", "RGBA", "ABGR", "ARGB"};
+
+static Scaler::Buffer AllocScalerBuffer(Scaler::ColorFormat color, uint32_t width, uint32_t height,
+                                        std::vector<uint8_t> *data) {
+  Scaler::Buffer buffer;
+  memset(&buffer, 0, sizeof(buffer));
+  buffer.mlu_device_id = -1;
+  buffer.width = width;
+  buffer.height = height;
+  buffer.color = color;
+  if (color <= Scaler::ColorFormat::YUV_NV21) {
+    data->resize(width * height * 3 / 2);
+    buffer.data[0] = data->data();
+    buffer.stride[0] = width;
+    buffer.data[1] = buffer.data[0] + width * height;
+    if (color == Scaler::ColorFormat::YUV_I420) {
+      buffer.stride[1] = buffer.stride[2] = width / 2;
+      buffer.data[2] = buffer.data[1] + width * height / 4;
+    } else {
+      buffer.stride[1] = width;
+    }
+  } else {
+    uint32_t bytes_in_pixel = color <= Scaler::ColorFormat::RGB ? 3 : 4;
+    data->resize(width * height * bytes_in_pixel);
+    buffer.data[0] = data->data();
+    buffer.stride[0] = width * bytes_in_pixel;
+  }
+  return buffer;
+}
+
+// fills the bgr buffer with a solid color
+static void FillBGR(Scaler::Buffer *buffer, uint8_t b, uint8_t g, uint8_t r) {
+  for (uint32_t i = 0; i < buffer->height; ++i) {
+    uint8_t *p = buffer->data[0] + i * buffer->stride[0];
+    for (uint32_t j = 0; j < buffer->width; ++j) {
+      p[j * 3] = b;
+      p[j * 3 + 1] = g;
+      p[j * 3 + 2] = r;
+    }
+  }
+}
+
+TEST(EncodeScaler, LibyuvConversionMatrix) {
+  const uint32_t width = 64, height = 48;
+  const uint8_t b = 40, g = 120, r = 200;
+  std::vector<uint8_t> bgr_data, src_data, dst_data, out_data;
+  Scaler::Buffer bgr = AllocScalerBuffer(Scaler::ColorFormat::BGR, width, height, &bgr_data);
+  FillBGR(&bgr, b, g, r);
+
+  for (int src_color = 0; src_color < Scaler::ColorFormat::COLOR_MAX; ++src_color) {
+    Scaler::Buffer src = AllocScalerBuffer(static_cast<Scaler::ColorFormat>(src_color), width, height, &src_data);
+    ASSERT_TRUE(Scaler::Process(&bgr, &src, nullptr, nullptr, Scaler::Carrier::LIBYUV));
+    for (int dst_color = 0; dst_color < Scaler::ColorFormat::COLOR_MAX; ++dst_color) {
+      for (auto scale : {1.0, 0.5, 1.5}) {
+        uint32_t dst_width = width * scale, dst_height = height * scale;
+        Scaler::Buffer dst =
+            AllocScalerBuffer(static_cast<Scaler::ColorFormat>(dst_color), dst_width, dst_height, &dst_data);
+        EXPECT_TRUE(Scaler::Process(&src, &dst, nullptr, nullptr, Scaler::Carrier::LIBYUV))
+            << scaler_color_str[src_color] << " -> " << scaler_color_str[dst_color] << ", scale " << scale;
+        // a solid color survives the conversions, with the error of yuv conversion
+        Scaler::Buffer out = AllocScalerBuffer(Scaler::ColorFormat::BGR, dst_width, dst_height, &out_data);
+        ASSERT_TRUE(Scaler::Process(&dst, &out, nullptr, nullptr, Scaler::Carrier::LIBYUV));
+        uint8_t *p = out.data[0] + (dst_height / 2) * out.stride[0] + (dst_width / 2) * 3;
+        EXPECT_NEAR(p[0], b, 8) << scaler_color_str[src_color] << " -> " << scaler_color_str[dst_color];
+        EXPECT_NEAR(p[1], g, 8) << scaler_color_str[src_color] << " -> " << scaler_color_str[dst_color];
+        EXPECT_NEAR(p[2], r, 8) << scaler_color_str[src_color] << " -> " << scaler_color_str[dst_color];
+      }
+    }
+  }
+}
+
+}  // namespace cnstream
@@ -0,0 +1,82 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+#include "video/spsc_ring.hpp"
+
+namespace cnstream {
+
+TEST(EncodeSpscRing, PushPop) {
+  video::SpscRing<int> ring(5);
+  EXPECT_EQ(ring.Capacity(), 8u);
+  EXPECT_TRUE(ring.Empty());
+  EXPECT_EQ(ring.Front(), nullptr);
+  for (int i = 0; i < 8; ++i) EXPECT_TRUE(ring.TryPush(i));
+  EXPECT_FALSE(ring.TryPush(8));
+  EXPECT_EQ(ring.Back(), nullptr);
+  EXPECT_EQ(ring.Size(), 8u);
+  int value = -1;
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(ring.TryPop(&value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(ring.TryPop(&value));
+
+  // the slots are reused in place
+  video::SpscRing<std::unique_ptr<int>> slots(2);
+  slots.Back()->reset(new int(1));
+  int *payload = slots.Back()->get();
+  slots.Push();
+  slots.Pop();
+  slots.Push();
+  slots.Pop();
+  EXPECT_EQ(slots.Back()->get(), payload);
+}
+
+TEST(EncodeSpscRing, ProducerConsumer) {
+  video::SpscRing<int> ring(4);
+  video::RingSignal data_signal, free_signal;
+  const int count = 100000;
+  bool in_order = true;
+  std::thread consumer([&]() {
+    for (int i = 0; i < count; ++i) {
+      int value = -1;
+      data_signal.Wait([&]() { return !ring.Empty(); });
+      ring.TryPop(&value);
+      if (value != i) in_order = false;
+      free_signal.Notify();
+    }
+  });
+  for (int i = 0; i < count; ++i) {
+    free_signal.Wait([&]() { return ring.Back() != nullptr; });
+    ring.TryPush(i);
+    data_signal.Notify();
+  }
+  consumer.join();
+  EXPECT_TRUE(in_order);
+  EXPECT_TRUE(ring.Empty());
+  EXPECT_FALSE(data_signal.Wait([&]() { return !ring.Empty(); }, 10));
+}
+
+}  // namespace cnstream
@@ -0,0 +1,144 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_sync.hpp"
+
+namespace cnstream {
+
+static constexpr const char *gname = "frame_sync";
+
+class FrameSyncObserver : public IModuleObserver {
+ public:
+  void notify(std::shared_ptr<CNFrameInfo> data) override { frames.push_back(data); }
+  std::vector<std::shared_ptr<CNFrameInfo>> frames;
+};
+
+static std::shared_ptr<CNFrameInfo> CreateFrame(const std::string &stream_id, int64_t timestamp) {
+  auto data = CNFrameInfo::Create(stream_id);
+  data->timestamp = timestamp;
+  return data;
+}
+
+static FrameSyncGroupPtr GetGroup(const std::shared_ptr<CNFrameInfo> &data) {
+  if (!data->collection.HasValue(kFrameSyncGroupTag)) return nullptr;
+  return data->collection.Get<FrameSyncGroupPtr>(kFrameSyncGroupTag);
+}
+
+TEST(FrameSync, OpenClose) {
+  FrameSync module(gname);
+  ModuleParamSet params;
+  EXPECT_FALSE(module.Open(params));
+  params["stream_groups"] = "left,right;cam2, cam3 ,cam4";
+  EXPECT_TRUE(module.Open(params));
+  params["tolerance"] = "-1";
+  EXPECT_FALSE(module.Open(params));
+  params["tolerance"] = "10";
+  params["max_buffered_frames"] = "0";
+  EXPECT_FALSE(module.Open(params));
+  params["max_buffered_frames"] = "4";
+  params["drop_policy"] = "abc";
+  EXPECT_FALSE(module.Open(params));
+  params["drop_policy"] = "pass";
+  EXPECT_TRUE(module.Open(params));
+  params["stream_groups"] = "left";
+  EXPECT_FALSE(module.Open(params));
+  params["stream_groups"] = "left,right;right,cam2";
+  EXPECT_FALSE(module.Open(params));
+  module.Close();
+}
+
+TEST(FrameSync, Group) {
+  FrameSync module(gname);
+  FrameSyncObserver observer;
+  module.SetObserver(&observer);
+  ModuleParamSet params;
+  params["stream_groups"] = "left,right";
+  params["tolerance"] = "10";
+  ASSERT_TRUE(module.Open(params));
+
+  // the frames of the streams not in any group are sent at once
+  module.Process(CreateFrame("other", 0));
+  ASSERT_EQ(observer.frames.size(), 1u);
+  EXPECT_EQ(GetGroup(observer.frames[0]), nullptr);
+
+  module.Process(CreateFrame("left", 100));
+  module.Process(CreateFrame("left", 140));
+  EXPECT_EQ(observer.frames.size(), 1u);
+  module.Process(CreateFrame("right", 105));
+  ASSERT_EQ(observer.frames.size(), 3u);
+  FrameSyncGroupPtr group = GetGroup(observer.frames[1]);
+  ASSERT_NE(group, nullptr);
+  EXPECT_EQ(group, GetGroup(observer.frames[2]));
+  EXPECT_EQ(group->group_id, 0u);
+  EXPECT_EQ(group->timestamp, 100);
+  ASSERT_EQ(group->frames.size(), 2u);
+  EXPECT_EQ(group->stream_ids[1], "right");
+  EXPECT_EQ(group->frames[1].lock()->timestamp, 105);
+
+  // left 140 is given up once right is later by more than the tolerance
+  module.Process(CreateFrame("right", 180));
+  module.Process(CreateFrame("left", 185));
+  ASSERT_EQ(observer.frames.size(), 5u);
+  EXPECT_EQ(GetGroup(observer.frames[3])->group_id, 1u);
+  EXPECT_EQ(observer.frames[3]->timestamp, 185);
+  EXPECT_EQ(module.GetGroupCount(), 2u);
+  EXPECT_EQ(module.GetUnsyncedCount(), 1u);
+  module.Close();
+}
+
+TEST(FrameSync, BufferLimitAndEos) {
+  FrameSync module(gname);
+  FrameSyncObserver observer;
+  module.SetObserver(&observer);
+  ModuleParamSet params;
+  params["stream_groups"] = "left,right";
+  params["max_buffered_frames"] = "2";
+  params["drop_policy"] = "pass";
+  ASSERT_TRUE(module.Open(params));
+
+  // right never comes, left is sent alone beyond the buffer limit
+  for (int i = 0; i < 5; ++i) module.Process(CreateFrame("left", i * 40));
+  ASSERT_EQ(observer.frames.size(), 3u);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(observer.frames[i]->timestamp, i * 40);
+    EXPECT_EQ(GetGroup(observer.frames[i]), nullptr);
+  }
+
+  // the frames waiting for an ended stream are sent, the EOS follows the frames of its stream
+  module.Process(CNFrameInfo::Create("right", true));
+  ASSERT_EQ(observer.frames.size(), 6u);
+  EXPECT_EQ(observer.frames[4]->timestamp, 160);
+  EXPECT_TRUE(observer.frames[5]->IsEos());
+  module.Process(CreateFrame("left", 200));
+  ASSERT_EQ(observer.frames.size(), 7u);
+  module.Process(CNFrameInfo::Create("left", true));
+  ASSERT_EQ(observer.frames.size(), 8u);
+  EXPECT_TRUE(observer.frames[7]->IsEos());
+  EXPECT_EQ(module.GetUnsyncedCount(), 6u);
+  module.Close();
+}
+
+}  // namespace cnstream
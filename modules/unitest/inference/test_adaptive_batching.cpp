@@ -0,0 +1,92 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "adaptive_batching.hpp"
+
+namespace cnstream {
+
+using Clock = AdaptiveBatchingPolicy::Clock;
+
+static Clock::time_point After(Clock::time_point tp, int ms) { return tp + std::chrono::milliseconds(ms); }
+
+TEST(Inferencer, AdaptiveBatching_WaitForFullBatch) {
+  // arrivals every 5ms, slo 100ms, compute 10ms: a batch of 4 fits the objective.
+  AdaptiveBatchingPolicy policy(4, 100, 50);
+  policy.OnBatchComputed(10);
+  Clock::time_point t0 = Clock::now();
+  EXPECT_FLOAT_EQ(policy.OnArrival(1, t0), 50);
+  for (uint32_t n = 2; n < 4; ++n) {
+    EXPECT_GT(policy.OnArrival(n, After(t0, 5 * (n - 1))), 0);
+  }
+  EXPECT_EQ(policy.OnArrival(4, After(t0, 15)), 0);
+  policy.OnBatchClosed(4, BatchCloseReason::FULL, After(t0, 15));
+  BatchingStats stats = policy.GetStats();
+  EXPECT_EQ(stats.batch_cnt, 1u);
+  EXPECT_EQ(stats.full_cnt, 1u);
+  EXPECT_EQ(stats.batch_size_hist[4], 1u);
+  EXPECT_DOUBLE_EQ(stats.avg_batch_size, 4);
+  EXPECT_NEAR(stats.avg_wait_ms, 15, 1e-3);
+  EXPECT_NEAR(stats.arrival_interval_ms, 5, 1e-3);
+}
+
+TEST(Inferencer, AdaptiveBatching_CloseBySlo) {
+  // arrivals every 45ms, slo 50ms, compute 10ms: the second frame can not join the batch in time.
+  AdaptiveBatchingPolicy policy(4, 50, 3000);
+  policy.OnBatchComputed(10);
+  Clock::time_point t0 = Clock::now();
+  policy.OnArrival(1, t0);
+  policy.OnBatchClosed(1, BatchCloseReason::TIMEOUT, After(t0, 40));
+  EXPECT_EQ(policy.GetStats().slo_cnt, 1u);  // the timeout was shortened by the deadline
+  EXPECT_EQ(policy.OnArrival(1, After(t0, 45)), 0);
+  policy.OnBatchClosed(1, BatchCloseReason::SLO, After(t0, 45));
+  BatchingStats stats = policy.GetStats();
+  EXPECT_EQ(stats.slo_cnt, 2u);
+  EXPECT_EQ(stats.batch_size_hist[1], 2u);
+}
+
+TEST(Inferencer, AdaptiveBatching_DeadlineBoundTimeout) {
+  AdaptiveBatchingPolicy policy(8, 40, 3000);
+  policy.OnBatchComputed(10);
+  Clock::time_point t0 = Clock::now();
+  EXPECT_FLOAT_EQ(policy.OnArrival(1, t0), 30);
+  EXPECT_NEAR(policy.OnArrival(2, After(t0, 2)), 28, 1e-3);
+  // computing slows down, there is no time left to wait.
+  policy.OnBatchComputed(200);
+  EXPECT_EQ(policy.OnArrival(3, After(t0, 4)), 0);
+}
+
+TEST(Inferencer, AdaptiveBatching_MaxTimeout) {
+  AdaptiveBatchingPolicy policy(4, 1000, 20);
+  Clock::time_point t0 = Clock::now();
+  EXPECT_FLOAT_EQ(policy.OnArrival(1, t0), 20);
+  policy.OnBatchClosed(1, BatchCloseReason::TIMEOUT, After(t0, 20));
+  policy.OnBatchClosed(0, BatchCloseReason::FLUSH, After(t0, 20));
+  BatchingStats stats = policy.GetStats();
+  EXPECT_EQ(stats.timeout_cnt, 1u);
+  EXPECT_EQ(stats.flush_cnt, 0u);
+  EXPECT_EQ(stats.batch_cnt, 1u);
+  EXPECT_FALSE(stats.ToString().empty());
+}
+
+}  // namespace cnstream
@@ -64,6 +64,13 @@ bool InferParamsEQ(const InferParams &p1, const InferParams &p2) {
          p1.use_scaler == p2.use_scaler &&
          p1.infer_interval == p2.infer_interval &&
          p1.batching_timeout == p2.batching_timeout &&
+         p1.adaptive_batching == p2.adaptive_batching &&
+         p1.latency_slo == p2.latency_slo &&
+         p1.io_buffer_num == p2.io_buffer_num &&
+         p1.obj_batching_order == p2.obj_batching_order &&
+         p1.obj_infer_interval == p2.obj_infer_interval &&
+         p1.obj_box_growth == p2.obj_box_growth &&
+         p1.obj_score_gain == p2.obj_score_gain &&
          p1.keep_aspect_ratio == p2.keep_aspect_ratio &&
          p1.data_order == p2.data_order &&
          p1.func_name == p2.func_name &&
@@ -89,6 +96,13 @@ TEST(Inferencer, infer_param_manager) {
     "use_scaler",
     "infer_interval",
     "batching_timeout",
+    "adaptive_batching",
+    "latency_slo",
+    "io_buffer_num",
+    "obj_batching_order",
+    "obj_infer_interval",
+    "obj_box_growth",
+    "obj_score_gain",
     "keep_aspect_ratio",
     "data_order",
     "func_name",
@@ -113,6 +127,13 @@ TEST(Inferencer, infer_param_manager) {
   expect_ret.use_scaler = true;
   expect_ret.infer_interval = 1;
   expect_ret.batching_timeout = 3;
+  expect_ret.adaptive_batching = true;
+  expect_ret.latency_slo = 20;
+  expect_ret.io_buffer_num = 2;
+  expect_ret.obj_batching_order = ObjBatchingOrder::SIZE;
+  expect_ret.obj_infer_interval = 5;
+  expect_ret.obj_box_growth = 0.5;
+  expect_ret.obj_score_gain = 0.1;
   expect_ret.keep_aspect_ratio = false;
   expect_ret.data_order = edk::DimOrder::NCHW;
   expect_ret.func_name = "fake_name";
@@ -134,6 +155,13 @@ TEST(Inferencer, infer_param_manager) {
   raw_params["use_scaler"] = std::to_string(expect_ret.use_scaler);
   raw_params["infer_interval"] = std::to_string(expect_ret.infer_interval);
   raw_params["batching_timeout"] = std::to_string(expect_ret.batching_timeout);
+  raw_params["adaptive_batching"] = std::to_string(expect_ret.adaptive_batching);
+  raw_params["latency_slo"] = std::to_string(expect_ret.latency_slo);
+  raw_params["io_buffer_num"] = std::to_string(expect_ret.io_buffer_num);
+  raw_params["obj_batching_order"] = "size";
+  raw_params["obj_infer_interval"] = std::to_string(expect_ret.obj_infer_interval);
+  raw_params["obj_box_growth"] = std::to_string(expect_ret.obj_box_growth);
+  raw_params["obj_score_gain"] = std::to_string(expect_ret.obj_score_gain);
   raw_params["keep_aspect_ratio"] = std::to_string(expect_ret.keep_aspect_ratio);
   raw_params["data_order"] = "NCHW";
   raw_params["func_name"] = expect_ret.func_name;
@@ -162,6 +190,13 @@ TEST(Inferencer, infer_param_manager) {
     default_value.use_scaler = false;
     default_value.infer_interval = 1;
     default_value.batching_timeout = 3000;
+    default_value.adaptive_batching = false;
+    default_value.latency_slo = 0;
+    default_value.io_buffer_num = 1;
+    default_value.obj_batching_order = ObjBatchingOrder::NONE;
+    default_value.obj_infer_interval = 1;
+    default_value.obj_box_growth = 0;
+    default_value.obj_score_gain = 0;
     default_value.keep_aspect_ratio = false;
     default_value.data_order = edk::DimOrder::NHWC;
     default_value.func_name = "";
@@ -220,6 +255,46 @@ TEST(Inferencer, infer_param_manager) {
     EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
   }
 
+  raw_params.clear();
+  {
+    InferParams ret;
+    raw_params["latency_slo"] = "-1";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
+
+  raw_params.clear();
+  {
+    InferParams ret;
+    raw_params["io_buffer_num"] = "0";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+    raw_params["io_buffer_num"] = "5";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
+
+  raw_params.clear();
+  {
+    InferParams ret;
+    raw_params["obj_batching_order"] = "wrong";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
+
+  raw_params.clear();
+  {
+    InferParams ret;
+    raw_params["obj_infer_interval"] = "0";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
+
+  raw_params.clear();
+  {
+    InferParams ret;
+    raw_params["obj_box_growth"] = "-1";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+    raw_params.clear();
+    raw_params["obj_score_gain"] = "-1";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
+
   raw_params.clear();
   {
     InferParams ret;
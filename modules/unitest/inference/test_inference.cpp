@@ -365,6 +365,48 @@ TEST(Inferencer, ProcessFrame) {
     ASSERT_NO_THROW(infer->Close());
   }
 
+  // test with multiple io buffers
+  {
+    std::shared_ptr<Module> infer = std::make_shared<Inferencer>(name);
+    ModuleParamSet param;
+    param["model_path"] = model_path;
+    param["func_name"] = g_func_name;
+    param["preproc_name"] = "FakePreproc";
+    param["postproc_name"] = g_postproc_name;
+    param["device_id"] = std::to_string(g_dev_id);
+    param["batching_timeout"] = "30";
+    param["io_buffer_num"] = "2";
+    ASSERT_TRUE(infer->Open(param));
+
+    const int width = 1920, height = 1080;
+    size_t nbytes = width * height * sizeof(uint8_t) * 3 / 2;
+    uint8_t *frame_data = new uint8_t[nbytes];
+
+    // more frames than one batch, so the batches go through different buffers
+    for (int i = 0; i < 10; ++i) {
+      auto data = cnstream::CNFrameInfo::Create(std::to_string(g_channel_id));
+      std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+      frame->frame_id = i;
+      data->timestamp = 1000 + i;
+      frame->width = width;
+      frame->height = height;
+      void *ptr_cpu[2] = {frame_data, frame_data + nbytes * 2 / 3};
+      frame->stride[0] = frame->stride[1] = width;
+      frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21;
+      frame->ctx.dev_type = DevContext::DevType::CPU;
+      frame->dst_device_id = g_dev_id;
+      frame->CopyToSyncMem(ptr_cpu, true);
+      data->collection.Add(kCNDataFrameTag, frame);
+
+      int ret = infer->Process(data);
+      EXPECT_EQ(ret, 1);
+    }
+    // create eos frame for clearing stream idx
+    cnstream::CNFrameInfo::Create(std::to_string(g_channel_id), true);
+    ASSERT_NO_THROW(infer->Close());
+    delete[] frame_data;
+  }
+
   // test mem_on_mlu_for_postproc
   {
     std::shared_ptr<Module> infer = std::make_shared<Inferencer>(name);
@@ -523,6 +565,45 @@ TEST(Inferencer, ProcessObject) {
     }
 
     ASSERT_NO_THROW(infer->Close());
+    param["obj_batching_order"] = "size";
+    ASSERT_TRUE(infer->Open(param));
+
+    // test obj_batching_order, objects of different sizes are sorted before resize convert
+    {
+      auto data = cnstream::CNFrameInfo::Create(std::to_string(g_channel_id));
+      std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+      frame->frame_id = 1;
+      data->timestamp = 1000;
+      frame->width = width;
+      frame->height = height;
+      void *ptr_mlu[2] = {planes[0], planes[1]};
+      frame->stride[0] = frame->stride[1] = width;
+      frame->ctx.ddr_channel = g_channel_id;
+      frame->ctx.dev_id = g_dev_id;
+      frame->ctx.dev_type = DevContext::DevType::MLU;
+      frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21;
+      frame->dst_device_id = g_dev_id;
+      frame->CopyToSyncMem(ptr_mlu, true);
+      std::shared_ptr<CNInferObjs> objs_holder = std::make_shared<CNInferObjs>();
+      for (int i = 0; i < 3; ++i) {
+        auto small_obj = std::make_shared<CNInferObject>();
+        small_obj->id = std::to_string(i);
+        small_obj->score = 0.8;
+        small_obj->bbox.x = 0.1;
+        small_obj->bbox.y = 0.1;
+        small_obj->bbox.w = small_obj->bbox.h = 0.3 / (i + 1);
+        objs_holder->objs_.push_back(small_obj);
+      }
+      data->collection.Add(kCNDataFrameTag, frame);
+      data->collection.Add(kCNInferObjsTag, objs_holder);
+      int ret = infer->Process(data);
+      EXPECT_EQ(ret, 1);
+      // create eos frame for clearing stream idx
+      cnstream::CNFrameInfo::Create(std::to_string(g_channel_id), true);
+    }
+
+    ASSERT_NO_THROW(infer->Close());
+    param.erase("obj_batching_order");
     param["mem_on_mlu_for_postproc"] = "true";
     ASSERT_TRUE(infer->Open(param));
     ResetGlobal();
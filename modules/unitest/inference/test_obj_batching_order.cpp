@@ -0,0 +1,68 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+#include "obj_batching_order.hpp"
+
+namespace cnstream {
+
+TEST(Inferencer, ObjBatchingOrder_Parse) {
+  ObjBatchingOrder order;
+  EXPECT_TRUE(ParseObjBatchingOrder("none", &order));
+  EXPECT_EQ(order, ObjBatchingOrder::NONE);
+  EXPECT_TRUE(ParseObjBatchingOrder("size", &order));
+  EXPECT_EQ(order, ObjBatchingOrder::SIZE);
+  EXPECT_TRUE(ParseObjBatchingOrder("aspect_ratio", &order));
+  EXPECT_EQ(order, ObjBatchingOrder::ASPECT_RATIO);
+  EXPECT_FALSE(ParseObjBatchingOrder("wrong", &order));
+}
+
+TEST(Inferencer, ObjBatchingOrder_Buckets) {
+  EXPECT_EQ(ObjSizeBucket(32, 32), 10);
+  EXPECT_EQ(ObjSizeBucket(64, 32), 11);
+  EXPECT_EQ(ObjSizeBucket(0, 0), 0);
+  EXPECT_EQ(ObjAspectRatioBucket(50, 50), 0);
+  EXPECT_EQ(ObjAspectRatioBucket(100, 50), 2);
+  EXPECT_EQ(ObjAspectRatioBucket(50, 100), -2);
+  // small differences stay in one bucket
+  EXPECT_EQ(ObjSizeBucket(33, 34), ObjSizeBucket(32, 32));
+  EXPECT_EQ(ObjAspectRatioBucket(52, 50), ObjAspectRatioBucket(50, 50));
+}
+
+TEST(Inferencer, ObjBatchingOrder_Sort) {
+  std::vector<std::pair<float, float>> sizes = {{200, 100}, {30, 30}, {100, 200}, {32, 31}, {400, 400}};
+  std::vector<size_t> none = SortObjsForBatching(sizes, ObjBatchingOrder::NONE);
+  EXPECT_EQ(none, std::vector<size_t>({0, 1, 2, 3, 4}));
+
+  std::vector<size_t> by_size = SortObjsForBatching(sizes, ObjBatchingOrder::SIZE);
+  // 30x30 and 32x31 share a bucket and keep arrival order, 100x200 comes before 200x100 by aspect ratio.
+  EXPECT_EQ(by_size, std::vector<size_t>({1, 3, 2, 0, 4}));
+
+  std::vector<size_t> by_ratio = SortObjsForBatching(sizes, ObjBatchingOrder::ASPECT_RATIO);
+  EXPECT_EQ(by_ratio, std::vector<size_t>({2, 1, 3, 4, 0}));
+
+  EXPECT_TRUE(SortObjsForBatching({}, ObjBatchingOrder::SIZE).empty());
+}
+
+}  // namespace cnstream
@@ -0,0 +1,141 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "cnstream_frame_va.hpp"
+#include "obj_infer_cache.hpp"
+
+namespace cnstream {
+
+static std::shared_ptr<CNInferObject> MakeObj(const std::string& track_id, float score = 0.5) {
+  auto obj = std::make_shared<CNInferObject>();
+  obj->track_id = track_id;
+  obj->score = score;
+  return obj;
+}
+
+static void SetResults(const std::shared_ptr<CNInferObject>& obj, int value) {
+  CNInferAttr attr;
+  attr.id = 0;
+  attr.value = value;
+  attr.score = 0.9;
+  obj->AddAttribute("color", attr);
+  obj->AddExtraAttribute("plate", std::to_string(value));
+  obj->AddFeature("feature", CNInferFeature{1, 2, 3});
+}
+
+TEST(Inferencer, ObjInferCache_Interval) {
+  ObjInferCache cache(3, 0, 0);
+  const std::string stream_id = "0";
+  auto holder = std::make_shared<int>(0);
+  cache.OnFrame(stream_id);
+  auto obj = MakeObj("1");
+  // new track
+  EXPECT_TRUE(cache.Lookup(stream_id, obj, 100, holder));
+  SetResults(obj, 3);
+  cache.OnInferred(stream_id, obj);
+
+  for (int i = 0; i < 2; ++i) {
+    cache.OnFrame(stream_id);
+    auto skipped = MakeObj("1");
+    EXPECT_FALSE(cache.Lookup(stream_id, skipped, 100, holder));
+    EXPECT_EQ(skipped->GetAttribute("color").value, 3);
+    EXPECT_EQ(skipped->GetExtraAttribute("plate"), "3");
+    EXPECT_EQ(skipped->GetFeature("feature"), CNInferFeature({1, 2, 3}));
+  }
+  cache.OnFrame(stream_id);
+  EXPECT_TRUE(cache.Lookup(stream_id, MakeObj("1"), 100, holder));
+  // objects without track id are always inferred
+  EXPECT_TRUE(cache.Lookup(stream_id, MakeObj(""), 100, holder));
+  EXPECT_TRUE(cache.Lookup(stream_id, MakeObj("-1"), 100, holder));
+  EXPECT_EQ(cache.InferredCount(), 4u);
+  EXPECT_EQ(cache.SkippedCount(), 2u);
+}
+
+TEST(Inferencer, ObjInferCache_BoxGrowthAndScore) {
+  ObjInferCache cache(100, 0.5, 0.2);
+  const std::string stream_id = "0";
+  auto holder = std::make_shared<int>(0);
+  cache.OnFrame(stream_id);
+  auto obj = MakeObj("1", 0.5);
+  EXPECT_TRUE(cache.Lookup(stream_id, obj, 100, holder));
+  cache.OnInferred(stream_id, obj);
+
+  cache.OnFrame(stream_id);
+  EXPECT_FALSE(cache.Lookup(stream_id, MakeObj("1", 0.6), 140, holder));
+  cache.OnFrame(stream_id);
+  EXPECT_TRUE(cache.Lookup(stream_id, MakeObj("1", 0.5), 160, holder));
+  cache.OnFrame(stream_id);
+  EXPECT_TRUE(cache.Lookup(stream_id, MakeObj("1", 0.8), 160, holder));
+}
+
+TEST(Inferencer, ObjInferCache_WaitForPendingInference) {
+  ObjInferCache cache(5, 0, 0);
+  const std::string stream_id = "0";
+  cache.OnFrame(stream_id);
+  auto obj = MakeObj("1");
+  EXPECT_TRUE(cache.Lookup(stream_id, obj, 100, nullptr));
+
+  cache.OnFrame(stream_id);
+  auto skipped = MakeObj("1");
+  auto holder = std::make_shared<int>(0);
+  std::weak_ptr<int> weak_holder = holder;
+  EXPECT_FALSE(cache.Lookup(stream_id, skipped, 100, holder));
+  holder.reset();
+  // the results are not ready yet, the holder is kept by the cache
+  EXPECT_FALSE(weak_holder.expired());
+  EXPECT_EQ(skipped->GetAttribute("color").id, -1);
+
+  SetResults(obj, 7);
+  cache.OnInferred(stream_id, obj);
+  EXPECT_TRUE(weak_holder.expired());
+  EXPECT_EQ(skipped->GetAttribute("color").value, 7);
+}
+
+TEST(Inferencer, ObjInferCache_StreamsAndLostTracks) {
+  ObjInferCache cache(100, 0, 0);
+  auto holder = std::make_shared<int>(0);
+  cache.OnFrame("0");
+  cache.OnFrame("1");
+  auto obj = MakeObj("1");
+  EXPECT_TRUE(cache.Lookup("0", obj, 100, holder));
+  cache.OnInferred("0", obj);
+  // same track id on another stream is another track
+  EXPECT_TRUE(cache.Lookup("1", MakeObj("1"), 100, holder));
+
+  cache.RemoveStream("0");
+  cache.OnFrame("0");
+  EXPECT_TRUE(cache.Lookup("0", MakeObj("1"), 100, holder));
+
+  // a track lost for many frames is dropped and inferred as a new track
+  for (int i = 0; i < 50; ++i) cache.OnFrame("1");
+  EXPECT_FALSE(cache.Lookup("1", MakeObj("1"), 100, holder));
+  for (int i = 0; i < 250; ++i) cache.OnFrame("1");
+  auto lost = MakeObj("1");
+  EXPECT_TRUE(cache.Lookup("1", lost, 100, holder));
+  cache.OnFrame("1");
+  EXPECT_FALSE(cache.Lookup("1", MakeObj("1"), 100, holder));
+}
+
+}  // namespace cnstream
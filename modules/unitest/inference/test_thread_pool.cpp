@@ -25,6 +25,7 @@
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 
 #include "infer_thread_pool.hpp"
@@ -38,7 +39,7 @@ class InferThreadPoolTest {
   int GetThreadNum() { return static_cast<int>(tp_->threads_.size()); }
   int GetTaskNum() {
     std::unique_lock<std::mutex> lk(tp_->mtx_);
-    return static_cast<int>(tp_->task_q_.size());
+    return static_cast<int>(tp_->TaskNum());
   }
 
  private:
@@ -134,6 +135,51 @@ TEST(Inferencer, InferThreadPool_PopTask) {
   tp.Destroy();
 }
 
+TEST(Inferencer, InferThreadPool_PopTaskPriority) {
+  std::condition_variable pause;
+  std::mutex mtx;
+  bool paused = true;
+  std::atomic<int> task_run(0);
+  /*
+    pause and block the two threads in threadpool, four tasks can be queued
+  */
+  auto func = [&]() -> int {
+    std::unique_lock<std::mutex> lk(mtx);
+    task_run.fetch_add(1);
+    pause.wait(lk, [&]() -> bool { return !paused; });
+    return 1;
+  };
+  InferThreadPool tp;
+  tp.Init(0, 2);
+  tp.SubmitTask({std::make_shared<InferTask>(func), std::make_shared<InferTask>(func)});
+  while (task_run.load() != 2) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  InferTaskSptr host_tasks[2], device_tasks[2];  // NOLINT
+  for (int i = 0; i < 2; ++i) {
+    host_tasks[i] = std::make_shared<InferTask>([]() -> int { return 0; });
+    host_tasks[i]->task_msg = "host" + std::to_string(i);
+    device_tasks[i] = std::make_shared<InferTask>([]() -> int { return 0; });
+    device_tasks[i]->task_msg = "device" + std::to_string(i);
+    device_tasks[i]->priority = InferTaskPriority::DEVICE;
+  }
+  tp.SubmitTask({host_tasks[0], device_tasks[0], host_tasks[1], device_tasks[1]});
+  InferThreadPoolTest tp_test(&tp);
+  EXPECT_EQ(tp_test.GetTaskNum(), 4);
+  // device tasks first, FIFO within the same priority
+  EXPECT_EQ(tp_test.PopTask()->task_msg, "device0");
+  EXPECT_EQ(tp_test.PopTask()->task_msg, "device1");
+  EXPECT_EQ(tp_test.PopTask()->task_msg, "host0");
+  EXPECT_EQ(tp_test.PopTask()->task_msg, "host1");
+  EXPECT_EQ(tp_test.GetTaskNum(), 0);
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    paused = false;
+  }
+  pause.notify_all();
+  tp.Destroy();
+}
+
 TEST(Inferencer, InferThreadPool_TaskSequence) {
   constexpr int ktask_num = 5;
   InferThreadPool tp;
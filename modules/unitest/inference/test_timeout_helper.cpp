@@ -34,15 +34,13 @@ namespace cnstream {
 class TimeoutHelperTest {
  public:
   explicit TimeoutHelperTest(TimeoutHelper* th) : th_(th) {}
-  std::thread& getThread() { return th_->handle_th_; }
   float getTime() { return th_->timeout_; }
   void setTime(float time) { th_->timeout_ = time; }
-  TimeoutHelper::State getState() { return th_->state_; }
-  void setState(int number) { th_->state_ = TimeoutHelper::State(number); }
-  // condition_variable do not support move or reference
-  void ConditionNotify() { th_->cond_.notify_one(); }
-  int get_timeout_print_cnt() { return static_cast<int>(th_->timeout_print_cnt_); }
-  void set_timeout_print_cnt(int number) { th_->timeout_print_cnt_ = number; }
+  TimerWheel::TaskId getTaskId() { return th_->state_->task_id; }
+  uint64_t getGeneration() { return th_->state_->generation; }
+  void setExit(bool exit) { th_->state_->exit = exit; }
+  int get_timeout_print_cnt() { return static_cast<int>(th_->state_->timeout_print_cnt); }
+  void set_timeout_print_cnt(int number) { th_->state_->timeout_print_cnt = number; }
 
  private:
   TimeoutHelper* th_;
@@ -50,10 +48,9 @@ class TimeoutHelperTest {
 
 TEST(Inferencer, TimeoutHelper_Constructor) {
   std::shared_ptr<TimeoutHelper> th = nullptr;
-  EXPECT_NO_THROW(th = std::make_shared<TimeoutHelper>());  // 此时创建handle_th_线程
+  EXPECT_NO_THROW(th = std::make_shared<TimeoutHelper>());
   TimeoutHelperTest th_test(th.get());
-  std::thread& Threadhandle = th_test.getThread();
-  EXPECT_EQ(Threadhandle.joinable(), true);
+  EXPECT_EQ(th_test.getTaskId(), 0u);
 }
 
 TEST(Inferencer, TimeoutHelper_SetTimeout) {
@@ -69,23 +66,33 @@ TEST(Inferencer, TimeoutHelper_Reset) {
   std::function<void()> Func = NULL;
 
   TimeoutHelperTest th_test(th.get());
-  th_test.setState(3);
+  th_test.setExit(true);
   EXPECT_EQ(th->Reset(Func), 1);
+  th_test.setExit(false);
 
+  th->SetTimeout(1000);
   Func = []() -> void {};
-  th_test.setState(0);
   th->Reset(Func);
-  EXPECT_EQ(static_cast<int>(th_test.getState()), 2);
+  TimerWheel::TaskId task_id = th_test.getTaskId();
+  EXPECT_NE(task_id, 0u);
+  EXPECT_EQ(th_test.getGeneration(), 1u);
 
+  // the task scheduled runs before the new deadline, it is kept
   Func = []() -> void {};
-  th_test.setState(2);
   th->Reset(Func);
-  EXPECT_EQ(static_cast<int>(th_test.getState()), 1);
+  EXPECT_EQ(th_test.getTaskId(), task_id);
+  EXPECT_EQ(th_test.getGeneration(), 2u);
+
+  // the new deadline is earlier, the task scheduled is cancelled
+  th->Reset(Func, 500);
+  EXPECT_NE(th_test.getTaskId(), 0u);
+  EXPECT_NE(th_test.getTaskId(), task_id);
+  EXPECT_FALSE(TimerWheel::Instance().Cancel(task_id));
+  EXPECT_EQ(th_test.getGeneration(), 3u);
 
   Func = nullptr;
-  th_test.setState(0);
   EXPECT_EQ(th->Reset(Func), 0);
-  EXPECT_EQ(static_cast<int>(th_test.getState()), 0);
+  EXPECT_EQ(th_test.getTaskId(), 0u);
 }
 
 TEST(Inferencer, TimeoutHelper_HandleFunc) {
@@ -106,4 +113,29 @@ TEST(Inferencer, TimeoutHelper_HandleFunc) {
   EXPECT_GE(used_time.count(), timeout);
 }
 
+TEST(Inferencer, TimeoutHelper_ResetMovesDeadline) {
+  TimeoutHelper helper;
+  const double timeout = 40;  // ms
+  helper.SetTimeout(timeout);
+  std::atomic<int> call_cnt(0);
+  std::promise<std::chrono::steady_clock::time_point> task_call_promise;
+  auto task = [&] () {
+    if (call_cnt.fetch_add(1) == 0) task_call_promise.set_value(std::chrono::steady_clock::now());
+  };
+  helper.LockOperator();
+  helper.Reset(task);
+  helper.UnlockOperator();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  // the task scheduled by the first reset runs early, and waits for the deadline of the second reset
+  helper.LockOperator();
+  auto task_submit_time = std::chrono::steady_clock::now();
+  helper.Reset(task);
+  helper.UnlockOperator();
+  auto task_call_time = task_call_promise.get_future().get();
+  std::chrono::duration<double, std::milli> used_time = task_call_time - task_submit_time;
+  EXPECT_GE(used_time.count(), timeout);
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  EXPECT_EQ(call_cnt.load(), 1);
+}
+
 }  // namespace cnstream
@@ -0,0 +1,177 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "detection_postproc.hpp"
+
+namespace cnstream {
+
+static void AppendBox(std::vector<float>* data, float label, float score, float l, float t, float r, float b) {
+  data->insert(data->end(), {0, label, score, l, t, r, b});
+}
+
+TEST(Inferencer2, DetectionPostproc_Rectifier) {
+  // 1920x1080 letterboxed to 416x416, scaled to 416x234 with 91 rows padded on the top
+  BoxRectifier rectifier(416, 416, 1920, 1080, true, true);
+  EXPECT_NEAR(rectifier.X(0), 0, 1e-5);
+  EXPECT_NEAR(rectifier.X(1), 1, 1e-5);
+  EXPECT_NEAR(rectifier.Y(91.0f / 416), 0, 1e-5);
+  EXPECT_NEAR(rectifier.Y((91.0f + 234) / 416), 1, 1e-5);
+  // coordinates in pixels
+  BoxRectifier pixel_rectifier(416, 416, 1920, 1080, true, false);
+  EXPECT_NEAR(pixel_rectifier.Y(91), 0, 1e-5);
+  EXPECT_NEAR(pixel_rectifier.X(208), 0.5, 1e-5);
+  // stretched
+  BoxRectifier stretch_rectifier(300, 300, 1920, 1080, false, true);
+  EXPECT_NEAR(stretch_rectifier.X(0.25), 0.25, 1e-5);
+  EXPECT_NEAR(stretch_rectifier.Y(0.75), 0.75, 1e-5);
+}
+
+TEST(Inferencer2, DetectionPostproc_Decode) {
+  std::vector<float> data;
+  AppendBox(&data, 0, 0.9, 0.1, 0.1, 0.3, 0.3);
+  AppendBox(&data, 1, 0.2, 0.1, 0.1, 0.3, 0.3);    // low score
+  AppendBox(&data, 2, 0.8, -0.1, 0.5, 1.2, 0.7);   // clamped
+  AppendBox(&data, 3, 0.7, 0.5, 0.5, 0.5, 0.6);    // empty
+  AppendBox(&data, 4, 0.6, 0.2, 0.2, 0.4, 0.4);
+  BoxRectifier rectifier(300, 300, 300, 300, false);
+  std::vector<DetectionBox> boxes;
+  EXPECT_EQ(DecodeDetections(data.data(), 5, 0.5, rectifier, &boxes), 3u);
+  ASSERT_EQ(boxes.size(), 3u);
+  EXPECT_EQ(boxes[0].label, 0);
+  EXPECT_FLOAT_EQ(boxes[0].score, 0.9);
+  EXPECT_FLOAT_EQ(boxes[0].right, 0.3);
+  EXPECT_EQ(boxes[1].label, 2);
+  EXPECT_FLOAT_EQ(boxes[1].left, 0);
+  EXPECT_FLOAT_EQ(boxes[1].right, 1);
+  // the boxes after the dropped boxes are decoded
+  EXPECT_EQ(boxes[2].label, 4);
+  EXPECT_FLOAT_EQ(boxes[2].top, 0.2);
+
+  // label 0 is the background of ssd networks
+  boxes.clear();
+  EXPECT_EQ(DecodeDetections(data.data(), 5, 0, rectifier, &boxes, -1), 3u);
+  EXPECT_EQ(boxes[0].label, 0);
+  EXPECT_EQ(boxes[1].label, 1);
+  EXPECT_EQ(boxes[2].label, 3);
+}
+
+TEST(Inferencer2, DetectionPostproc_Sigmoid) {
+  std::vector<float> values = {-2, 0, 2};
+  Sigmoid(values.data(), values.size(), values.data());
+  EXPECT_NEAR(values[0], 1 / (1 + std::exp(2.0f)), 1e-6);
+  EXPECT_FLOAT_EQ(values[1], 0.5);
+  EXPECT_NEAR(values[2], 1 / (1 + std::exp(-2.0f)), 1e-6);
+  EXPECT_NEAR(Logit(values[2]), 2, 1e-4);
+  EXPECT_EQ(Logit(0), -INFINITY);
+  EXPECT_EQ(Logit(1), INFINITY);
+
+  std::vector<float> scores = {0.1, 9, 0.9, 9, 0.5, 9};
+  std::vector<uint32_t> indices;
+  EXPECT_EQ(FilterByScore(scores.data(), 3, 2, 0.5, &indices), 2u);
+  EXPECT_EQ(indices, std::vector<uint32_t>({1, 2}));
+}
+
+// the straight forward implementation, compares all pairs of boxes
+static std::vector<DetectionBox> ReferenceNms(std::vector<DetectionBox> boxes, float iou_threshold) {
+  std::vector<bool> suppressed(boxes.size(), false);
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    for (size_t j = 0; j < boxes.size(); ++j) {
+      if (i == j || boxes[i].label != boxes[j].label || suppressed[j]) continue;
+      bool higher = boxes[j].score > boxes[i].score || (boxes[j].score == boxes[i].score && j < i);
+      if (!higher) continue;
+      // a box is suppressed by the kept boxes with a higher score only, it is decided in the order of the scores
+      bool j_kept = true;
+      for (size_t k = 0; k < boxes.size(); ++k) {
+        if (k == j || boxes[k].label != boxes[j].label) continue;
+        bool k_higher = boxes[k].score > boxes[j].score || (boxes[k].score == boxes[j].score && k < j);
+        if (k_higher && !suppressed[k] && IoU(boxes[k], boxes[j]) > iou_threshold) j_kept = false;
+      }
+      if (j_kept && IoU(boxes[i], boxes[j]) > iou_threshold) suppressed[i] = true;
+    }
+  }
+  std::vector<DetectionBox> kept;
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    if (!suppressed[i]) kept.push_back(boxes[i]);
+  }
+  return kept;
+}
+
+static std::vector<DetectionBox> RandomBoxes(size_t num, int class_num, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> pos(0, 0.9), size(0.02, 0.1), score(0, 1);
+  std::uniform_int_distribution<int> label(0, class_num - 1);
+  std::vector<DetectionBox> boxes(num);
+  for (auto& box : boxes) {
+    box.label = label(gen);
+    box.score = score(gen);
+    box.left = pos(gen);
+    box.top = pos(gen);
+    box.right = box.left + size(gen);
+    box.bottom = box.top + size(gen);
+  }
+  return boxes;
+}
+
+static DetectionBox MakeBox(int label, float score, float l, float t, float r, float b) {
+  DetectionBox box;
+  box.label = label;
+  box.score = score;
+  box.left = l;
+  box.top = t;
+  box.right = r;
+  box.bottom = b;
+  return box;
+}
+
+TEST(Inferencer2, DetectionPostproc_Nms) {
+  std::vector<DetectionBox> boxes(3);
+  boxes[0] = MakeBox(0, 0.8, 0.1, 0.1, 0.5, 0.5);
+  boxes[1] = MakeBox(0, 0.9, 0.12, 0.12, 0.52, 0.52);  // suppresses box 0
+  boxes[2] = MakeBox(1, 0.7, 0.1, 0.1, 0.5, 0.5);      // another class
+  std::vector<DetectionBox> kept = boxes;
+  Nms(&kept, 0.5);
+  ASSERT_EQ(kept.size(), 2u);
+  EXPECT_FLOAT_EQ(kept[0].score, 0.9);
+  EXPECT_EQ(kept[1].label, 1);
+  kept = boxes;
+  Nms(&kept, 0.5, true);
+  ASSERT_EQ(kept.size(), 1u);
+  EXPECT_FLOAT_EQ(kept[0].score, 0.9);
+
+  // same results as the reference implementation
+  boxes = RandomBoxes(300, 4, 0);
+  kept = boxes;
+  Nms(&kept, 0.3);
+  std::vector<DetectionBox> expected = ReferenceNms(boxes, 0.3);
+  ASSERT_EQ(kept.size(), expected.size());
+  for (auto& box : expected) {
+    bool found = false;
+    for (auto& k : kept) found = found || (k.label == box.label && k.score == box.score && k.left == box.left);
+    EXPECT_TRUE(found);
+  }
+}
+
+}  // namespace cnstream
@@ -0,0 +1,68 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "device_load_balancer.hpp"
+
+namespace cnstream {
+
+TEST(Inferencer2, DeviceLoadBalancerAffinity) {
+  // all frames are decoded on device 0
+  DeviceLoadBalancer balancer({0, 1, 2, 3}, 1);
+  EXPECT_EQ(balancer.GetDeviceNum(), 4u);
+  std::vector<size_t> routes;
+  for (int i = 0; i < 8; ++i) routes.push_back(balancer.Route("stream_" + std::to_string(i), 0));
+  // device 0 keeps the streams until it has more than 1 stream more than the others
+  EXPECT_EQ(routes[0], 0u);
+  EXPECT_EQ(routes[1], 0u);
+  EXPECT_EQ(balancer.GetStreamNum(0), 3u);
+  for (size_t i = 1; i < 4; ++i) {
+    EXPECT_GE(balancer.GetStreamNum(i), 1u);
+    EXPECT_LE(balancer.GetStreamNum(0) - balancer.GetStreamNum(i), 2u);
+  }
+  // routes are sticky
+  for (int i = 0; i < 8; ++i) EXPECT_EQ(balancer.Route("stream_" + std::to_string(i), 3), routes[i]);
+}
+
+TEST(Inferencer2, DeviceLoadBalancerLeastLoaded) {
+  DeviceLoadBalancer balancer({2, 5}, 0);
+  // data on cpu or on a device not used by the module goes to the least loaded device
+  EXPECT_EQ(balancer.Route("a", -1), 0u);
+  EXPECT_EQ(balancer.Route("b", 1), 1u);
+  EXPECT_EQ(balancer.Route("c", 5), 1u);  // no more than affinity_threshold streams more
+  EXPECT_EQ(balancer.Route("d", 5), 0u);
+  EXPECT_EQ(balancer.GetDeviceId(1), 5u);
+  EXPECT_EQ(balancer.Find("c"), 1);
+  EXPECT_EQ(balancer.Find("e"), -1);
+
+  balancer.Release("a");
+  balancer.Release("d");
+  balancer.Release("e");  // not routed, ignored
+  EXPECT_EQ(balancer.GetStreamNum(0), 0u);
+  EXPECT_EQ(balancer.GetStreamNum(1), 2u);
+  EXPECT_EQ(balancer.Find("a"), -1);
+  EXPECT_EQ(balancer.Route("e", 5), 0u);
+}
+
+}  // namespace cnstream
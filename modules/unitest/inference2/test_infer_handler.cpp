@@ -20,8 +20,12 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "easyinfer/mlu_memory_op.h"
 #include "cnstream_logging.hpp"
@@ -32,6 +36,8 @@
 #include "test_base.hpp"
 #include "infer_handler.hpp"
 #include "infer_params.hpp"
+#include "model_cache.hpp"
+#include "shared_infer_session.hpp"
 
 namespace cnstream {
 
@@ -340,4 +346,337 @@ TEST(Inferencer2, InferHandlerProcess) {
   }
 }
 
+TEST(Inferencer2, SharedSessionKey) {
+  Infer2Param param;
+  param.model_path = "model";
+  param.preproc_name = "RCOP";
+  param.postproc_name = "VideoPostprocSsd";
+  Infer2Param other = param;
+  other.batching_timeout = 10;  // decided by the first module
+  EXPECT_EQ(SharedInferSession::GetKey(param), SharedInferSession::GetKey(other));
+  other.custom_postproc_params["key"] = "value";
+  EXPECT_NE(SharedInferSession::GetKey(param), SharedInferSession::GetKey(other));
+  other = param;
+  other.threshold = 0.5;
+  EXPECT_NE(SharedInferSession::GetKey(param), SharedInferSession::GetKey(other));
+  other = param;
+  other.preproc_name = "CNCV";
+  EXPECT_NE(SharedInferSession::GetKey(param), SharedInferSession::GetKey(other));
+  other = param;
+  other.batch_postproc = true;
+  EXPECT_NE(SharedInferSession::GetKey(param), SharedInferSession::GetKey(other));
+  other = param;
+  other.native_data_order = true;
+  EXPECT_NE(SharedInferSession::GetKey(param), SharedInferSession::GetKey(other));
+}
+
+TEST(Inferencer2, InferHandlerShareSession) {
+  std::string exe_path = GetExePath();
+  std::unique_ptr<Inferencer2> infer0(new Inferencer2("detector0"));
+  std::unique_ptr<Inferencer2> infer1(new Inferencer2("detector1"));
+  std::shared_ptr<VideoPreproc> pre_processor(VideoPreproc::Create("VideoPreprocCpu"));
+  std::shared_ptr<VideoPostproc> post_processor(VideoPostproc::Create("VideoPostprocSsd"));
+  bool use_magicmind = infer_server::Predictor::Backend() == "magicmind";
+
+  Infer2Param param;
+  if (use_magicmind) {
+    param.model_path = exe_path + GetModelPathMM();
+    param.model_input_pixel_format = InferVideoPixelFmt::RGB24;
+    param.preproc_name = "CNCV";
+  } else {
+    param.model_path = exe_path + GetModelPath();
+    param.func_name = "subnet0";
+    param.model_input_pixel_format = InferVideoPixelFmt::ARGB;
+    param.preproc_name = "RCOP";
+  }
+  param.postproc_name = "VideoPostprocSsd";
+  param.device_id = 0;
+  param.batch_strategy = InferBatchStrategy::DYNAMIC;
+  param.batching_timeout = 300;
+  param.share_session = true;
+
+  std::shared_ptr<InferHandler> infer_handler0 =
+      std::make_shared<InferHandlerImpl>(infer0.get(), param, post_processor, pre_processor, nullptr, nullptr);
+  std::shared_ptr<InferHandler> infer_handler1 =
+      std::make_shared<InferHandlerImpl>(infer1.get(), param, post_processor, pre_processor, nullptr, nullptr);
+  ASSERT_TRUE(infer_handler0->Open());
+  ASSERT_TRUE(infer_handler1->Open());
+  auto data0 = CreatData(std::to_string(param.device_id));
+  auto data1 = CreatData(std::to_string(param.device_id));
+  EXPECT_EQ(infer_handler0->Process(data0), 0);
+  EXPECT_EQ(infer_handler1->Process(data1), 0);
+  infer_handler0->WaitTaskDone(data0->stream_id);
+  infer_handler1->WaitTaskDone(data1->stream_id);
+  // the session is still used by the other handler after one is closed
+  infer_handler0->Close();
+  auto data2 = CreatData(std::to_string(param.device_id));
+  EXPECT_EQ(infer_handler1->Process(data2), 0);
+  infer_handler1->WaitTaskDone(data2->stream_id);
+}
+
+TEST(Inferencer2, InferHandlerLateFrames) {
+  std::string exe_path = GetExePath();
+  std::unique_ptr<Inferencer2> infer(new Inferencer2("detector"));
+  std::shared_ptr<VideoPreproc> pre_processor(VideoPreproc::Create("VideoPreprocCpu"));
+  std::shared_ptr<VideoPostproc> post_processor(VideoPostproc::Create("VideoPostprocSsd"));
+  bool use_magicmind = infer_server::Predictor::Backend() == "magicmind";
+
+  Infer2Param param;
+  if (use_magicmind) {
+    param.model_path = exe_path + GetModelPathMM();
+    param.model_input_pixel_format = InferVideoPixelFmt::RGB24;
+    param.preproc_name = "CNCV";
+  } else {
+    param.model_path = exe_path + GetModelPath();
+    param.func_name = "subnet0";
+    param.model_input_pixel_format = InferVideoPixelFmt::ARGB;
+    param.preproc_name = "RCOP";
+  }
+  param.device_id = 0;
+  param.batching_timeout = 300;
+  param.latency_budget = 60000;
+  param.stream_latency_budgets["1"] = 1;  // stream id of CreatData
+  param.drop_late_frames = true;
+
+  InferHandlerImpl infer_handler(infer.get(), param, post_processor, pre_processor, nullptr, nullptr);
+  EXPECT_EQ(infer_handler.GetLatencyBudget("1"), 1u);
+  EXPECT_EQ(infer_handler.GetLatencyBudget("other"), 60000u);
+  ASSERT_TRUE(infer_handler.Open());
+
+  auto data = CreatData(std::to_string(param.device_id));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  // late frames are transmitted without inference
+  EXPECT_EQ(infer_handler.Process(data), 0);
+  infer_handler.WaitTaskDone(data->stream_id);
+  EXPECT_EQ(infer_handler.GetLateFrameCount(), 1u);
+
+  data = CreatData(std::to_string(param.device_id));
+  data->stream_id = "other";
+  EXPECT_EQ(infer_handler.Process(data), 0);
+  infer_handler.WaitTaskDone(data->stream_id);
+  EXPECT_EQ(infer_handler.GetLateFrameCount(), 1u);
+}
+
+TEST(Inferencer2, InferHandlerCascade) {
+  std::string exe_path = GetExePath();
+  std::unique_ptr<Inferencer2> infer(new Inferencer2("classifier"));
+  std::shared_ptr<VideoPreproc> pre_processor(VideoPreproc::Create("VideoPreprocCpu"));
+  std::shared_ptr<VideoPostproc> post_processor(VideoPostproc::Create("VideoPostprocSsd"));
+  bool use_magicmind = infer_server::Predictor::Backend() == "magicmind";
+
+  Infer2Param param;
+  if (use_magicmind) {
+    param.model_path = exe_path + GetModelPathMM();
+    param.model_input_pixel_format = InferVideoPixelFmt::RGB24;
+    param.preproc_name = "CNCV";
+  } else {
+    param.model_path = exe_path + GetModelPath();
+    param.func_name = "subnet0";
+    param.model_input_pixel_format = InferVideoPixelFmt::ARGB;
+    param.preproc_name = "RCOP";
+  }
+  param.device_id = 0;
+  param.batching_timeout = 300;
+  param.object_infer = true;
+  param.cascade_attr = "classification";
+  param.cascade_threshold = 0.9;
+
+  InferHandlerImpl infer_handler(infer.get(), param, post_processor, pre_processor, nullptr, nullptr);
+  ASSERT_TRUE(infer_handler.Open());
+
+  // classified by the earlier stage confidently, not confidently, or not classified
+  auto data = CreatData(std::to_string(param.device_id));
+  CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+  for (float score : {0.95f, 0.5f, -1.f}) {
+    auto object = std::make_shared<CNInferObject>();
+    object->bbox = {0.2f, 0.2f, 0.3f, 0.3f};
+    if (score >= 0) {
+      CNInferAttr attr;
+      attr.id = 0;
+      attr.value = 1;
+      attr.score = score;
+      object->AddAttribute(param.cascade_attr, attr);
+    }
+    objs_holder->objs_.push_back(object);
+  }
+  EXPECT_EQ(infer_handler.Process(data, param.object_infer), 0);
+  infer_handler.WaitTaskDone(data->stream_id);
+  EXPECT_EQ(infer_handler.GetCascadeExitCount(), 1u);
+  EXPECT_EQ(infer_handler.GetCascadeInferCount(), 2u);
+  // the answer of the earlier stage is kept only for the object exiting the cascade
+  EXPECT_FLOAT_EQ(objs_holder->objs_[0]->GetAttribute(param.cascade_attr).score, 0.95f);
+  EXPECT_EQ(objs_holder->objs_[1]->GetAttribute(param.cascade_attr).id, -1);
+}
+
+TEST(Inferencer2, InferHandlerWarmupAndModelCache) {
+  std::string exe_path = GetExePath();
+  std::unique_ptr<Inferencer2> infer(new Inferencer2("detector"));
+  std::shared_ptr<VideoPreproc> pre_processor(VideoPreproc::Create("VideoPreprocCpu"));
+  std::shared_ptr<VideoPostproc> post_processor(VideoPostproc::Create("VideoPostprocSsd"));
+  bool use_magicmind = infer_server::Predictor::Backend() == "magicmind";
+
+  Infer2Param param;
+  if (use_magicmind) {
+    param.model_path = exe_path + GetModelPathMM();
+    param.model_input_pixel_format = InferVideoPixelFmt::RGB24;
+    param.preproc_name = "CNCV";
+  } else {
+    param.model_path = exe_path + GetModelPath();
+    param.func_name = "subnet0";
+    param.model_input_pixel_format = InferVideoPixelFmt::ARGB;
+    param.preproc_name = "RCOP";
+  }
+  param.device_id = 0;
+  param.batching_timeout = 300;
+  param.cache_model = true;
+  param.warmup = true;
+
+  ModelCache::Instance().Clear();
+  uint64_t hit_cnt = ModelCache::Instance().HitCount();
+  {
+    InferHandlerImpl infer_handler(infer.get(), param, post_processor, pre_processor, nullptr, nullptr);
+    ASSERT_TRUE(infer_handler.Open());
+    EXPECT_GT(infer_handler.GetStartupTime(), 0);
+    EXPECT_EQ(infer_handler.GetFirstFrameLatency(), 0);
+    auto data = CreatData(std::to_string(param.device_id));
+    EXPECT_EQ(infer_handler.Process(data), 0);
+    infer_handler.WaitTaskDone(data->stream_id);
+    EXPECT_GT(infer_handler.GetFirstFrameLatency(), 0);
+  }
+  EXPECT_EQ(ModelCache::Instance().Size(), 1u);
+  EXPECT_EQ(ModelCache::Instance().HitCount(), hit_cnt);
+
+  // the model is not loaded again when the module is reopened
+  {
+    InferHandlerImpl infer_handler(infer.get(), param, post_processor, pre_processor, nullptr, nullptr);
+    ASSERT_TRUE(infer_handler.Open());
+    EXPECT_EQ(ModelCache::Instance().HitCount(), hit_cnt + 1);
+  }
+  EXPECT_EQ(ModelCache::Instance().Size(), 1u);
+  ModelCache::Instance().Clear();
+  EXPECT_EQ(ModelCache::Instance().Size(), 0u);
+}
+
+class CountingVideoPostproc : public VideoPostproc {
+ public:
+  bool Execute(infer_server::InferData* output_data, const infer_server::ModelIO& model_output,
+               const infer_server::ModelInfo* model_info) override {
+    execute_cnt++;
+    return true;
+  }
+  bool ExecuteBatch(const std::vector<infer_server::InferData*>& output_data,
+                    const std::vector<const infer_server::ModelIO*>& model_outputs,
+                    const infer_server::ModelInfo* model_info) override {
+    batch_cnt++;
+    EXPECT_EQ(output_data.size(), model_outputs.size());
+    EXPECT_NE(model_info, nullptr);
+    return VideoPostproc::ExecuteBatch(output_data, model_outputs, model_info);
+  }
+  std::atomic<int> execute_cnt{0};
+  std::atomic<int> batch_cnt{0};
+};  // class CountingVideoPostproc
+
+TEST(Inferencer2, InferHandlerBatchPostproc) {
+  // Execute is called on each output by default
+  CountingVideoPostproc postproc;
+  infer_server::InferData data0, data1;
+  infer_server::ModelIO output0, output1;
+  EXPECT_TRUE(postproc.VideoPostproc::ExecuteBatch({&data0, &data1}, {&output0, &output1}, nullptr));
+  EXPECT_EQ(postproc.execute_cnt, 2);
+  EXPECT_FALSE(postproc.VideoPostproc::ExecuteBatch({&data0}, {}, nullptr));
+
+  std::string exe_path = GetExePath();
+  std::unique_ptr<Inferencer2> infer(new Inferencer2("detector"));
+  std::shared_ptr<VideoPreproc> pre_processor(VideoPreproc::Create("VideoPreprocCpu"));
+  auto post_processor = std::make_shared<CountingVideoPostproc>();
+  bool use_magicmind = infer_server::Predictor::Backend() == "magicmind";
+
+  Infer2Param param;
+  if (use_magicmind) {
+    param.model_path = exe_path + GetModelPathMM();
+    param.model_input_pixel_format = InferVideoPixelFmt::RGB24;
+    param.preproc_name = "CNCV";
+  } else {
+    param.model_path = exe_path + GetModelPath();
+    param.func_name = "subnet0";
+    param.model_input_pixel_format = InferVideoPixelFmt::ARGB;
+    param.preproc_name = "RCOP";
+  }
+  param.device_id = 0;
+  param.batching_timeout = 300;
+  param.batch_postproc = true;
+
+  InferHandlerImpl infer_handler(infer.get(), param, post_processor, pre_processor, nullptr, nullptr);
+  ASSERT_TRUE(infer_handler.Open());
+  const int frame_num = 4;
+  std::string stream_id;
+  for (int i = 0; i < frame_num; ++i) {
+    auto data = CreatData(std::to_string(param.device_id));
+    stream_id = data->stream_id;
+    EXPECT_EQ(infer_handler.Process(data), 0);
+  }
+  infer_handler.WaitTaskDone(stream_id);
+  // one request for each frame
+  EXPECT_EQ(post_processor->batch_cnt, frame_num);
+  EXPECT_EQ(post_processor->execute_cnt, frame_num);
+}
+
+class ObjectVideoPostproc : public CountingVideoPostproc {
+ public:
+  bool Execute(infer_server::InferData* output_data, const infer_server::ModelIO& model_output,
+               const infer_server::ModelInfo* model_info) override {
+    CountingVideoPostproc::Execute(output_data, model_output, model_info);
+    CNFrameInfoPtr frame = output_data->GetUserData<CNFrameInfoPtr>();
+    CNInferObjsPtr objs_holder = frame->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+    auto obj = objs_holder->CreateObject();
+    obj->id = "1";
+    obj->score = 0.9f;
+    objs_holder->Append({obj});
+    return true;
+  }
+};  // class ObjectVideoPostproc
+
+TEST(Inferencer2, InferHandlerResultCacheSnapshot) {
+  std::string exe_path = GetExePath();
+  std::unique_ptr<Inferencer2> infer(new Inferencer2("detector"));
+  std::shared_ptr<VideoPreproc> pre_processor(VideoPreproc::Create("VideoPreprocCpu"));
+  auto post_processor = std::make_shared<ObjectVideoPostproc>();
+  bool use_magicmind = infer_server::Predictor::Backend() == "magicmind";
+
+  Infer2Param param;
+  if (use_magicmind) {
+    param.model_path = exe_path + GetModelPathMM();
+    param.model_input_pixel_format = InferVideoPixelFmt::RGB24;
+    param.preproc_name = "CNCV";
+  } else {
+    param.model_path = exe_path + GetModelPath();
+    param.func_name = "subnet0";
+    param.model_input_pixel_format = InferVideoPixelFmt::ARGB;
+    param.preproc_name = "RCOP";
+  }
+  param.device_id = 0;
+  param.batching_timeout = 300;
+  param.result_cache_size = 4;
+
+  InferHandlerImpl infer_handler(infer.get(), param, post_processor, pre_processor, nullptr, nullptr);
+  ASSERT_TRUE(infer_handler.Open());
+  auto data = CreatData(std::to_string(param.device_id), false, false);
+  EXPECT_EQ(infer_handler.Process(data), 0);
+  infer_handler.WaitTaskDone(data->stream_id);
+  EXPECT_EQ(post_processor->execute_cnt, 1);
+
+  // the frame with the same content gets the cached objects, a snapshot taken before sees them once they are read
+  auto cached = CreatData(std::to_string(param.device_id), false, false);
+  CNInferObjsPtr objs_holder = cached->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+  EXPECT_TRUE(objs_holder->GetSnapshot()->empty());
+  const uint64_t version = objs_holder->GetVersion();
+  EXPECT_EQ(infer_handler.Process(cached), 0);
+  infer_handler.WaitTaskDone(cached->stream_id);
+  EXPECT_EQ(post_processor->execute_cnt, 1);
+  EXPECT_GT(objs_holder->GetVersion(), version);
+  CNInferObjsSnapshot snapshot = objs_holder->GetSnapshot();
+  ASSERT_EQ(snapshot->size(), 1u);
+  EXPECT_EQ((*snapshot)[0]->id, "1");
+}
+
 }  // namespace cnstream
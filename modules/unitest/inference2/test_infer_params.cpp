@@ -23,9 +23,11 @@
 #include <memory>
 #include <string>
 #include <list>
+#include <vector>
 
 #include "cnstream_logging.hpp"
 
+#include "infer_params.hpp"
 #include "inferencer2.hpp"
 #include "video_postproc.hpp"
 #include "video_preproc.hpp"
@@ -58,6 +60,16 @@ TEST(Inferencer2, CheckParamSet) {
   EXPECT_FALSE(infer->CheckParamSet(param));
   param["device_id"] = "0";
   EXPECT_TRUE(infer->CheckParamSet(param));
+  param["device_ids"] = "0,x";  // device ids must be numbers
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  for (auto ids : {"0,1", "0 1 2", "auto", ""}) {
+    param["device_ids"] = ids;
+    EXPECT_TRUE(infer->CheckParamSet(param));
+  }
+  param["affinity_threshold"] = "no_number";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["affinity_threshold"] = "2";
+  EXPECT_TRUE(infer->CheckParamSet(param));
 
   param["engine_num"] = "no_number";  // engine num must be a number
   EXPECT_FALSE(infer->CheckParamSet(param));
@@ -78,8 +90,8 @@ TEST(Inferencer2, CheckParamSet) {
     EXPECT_TRUE(infer->CheckParamSet(param));
   }
 
-  // data order must be NCHW or NHWC
-  std::list<std::string> data_order = {"NCHW", "NHWC"};
+  // data order must be NCHW, NHWC or NATIVE
+  std::list<std::string> data_order = {"NCHW", "NHWC", "NATIVE"};
   param["data_order"] = "error_type";
   EXPECT_FALSE(infer->CheckParamSet(param));
   for (auto type : data_order) {
@@ -123,6 +135,123 @@ TEST(Inferencer2, CheckParamSet) {
     EXPECT_TRUE(infer->CheckParamSet(param));
   }
 
+  // share_session must be one of bool_type
+  param["share_session"] = "error_type";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  for (auto type : bool_type) {
+    param["share_session"] = type;
+    EXPECT_TRUE(infer->CheckParamSet(param));
+  }
+
+  // cache_model must be one of bool_type
+  param["cache_model"] = "error_type";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  for (auto type : bool_type) {
+    param["cache_model"] = type;
+    EXPECT_TRUE(infer->CheckParamSet(param));
+  }
+
+  // warmup must be one of bool_type
+  param["warmup"] = "error_type";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  for (auto type : bool_type) {
+    param["warmup"] = type;
+    EXPECT_TRUE(infer->CheckParamSet(param));
+  }
+
+  // batch_postproc must be one of bool_type
+  param["batch_postproc"] = "error_type";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  for (auto type : bool_type) {
+    param["batch_postproc"] = type;
+    EXPECT_TRUE(infer->CheckParamSet(param));
+  }
+
+  // drop_late_frames must be one of bool_type
+  param["drop_late_frames"] = "error_type";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  for (auto type : bool_type) {
+    param["drop_late_frames"] = type;
+    EXPECT_TRUE(infer->CheckParamSet(param));
+  }
+
+  param["latency_budget"] = "no_number";  // latency budget must be a number
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["latency_budget"] = "2000";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+  // stream latency budgets must be a json object of unsigned integers
+  param["stream_latency_budgets"] = "{\"alarm\" : \"fast\"}";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["stream_latency_budgets"] = "{\"alarm\" : 200, \"archive\" : 2000}";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+
+  // regions of interest must be rectangles or polygons normalized to the frame
+  param["rois"] = "[[0.5, 0.5, 0.6, 0.2]]";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["rois"] = "[[[0.2, 0.2], [0.6, 0.2]]]";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["rois"] = "[[0.1, 0.5, 0.4, 0.5], [[0.2, 0.2], [0.6, 0.2], [0.5, 0.9]]]";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+  param["stream_rois"] = "{\"lane\" : [0.1, 0.5, 0.4, 0.5]}";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["stream_rois"] = "{\"lane\" : [[0.1, 0.5, 0.4, 0.5]], \"door\" : []}";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+
+  // motion threshold must be a number in [0, 1]
+  param["motion_threshold"] = "-0.1";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["motion_threshold"] = "1.5";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["motion_threshold"] = "0.02";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+  param["motion_max_skip"] = "-1";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["motion_max_skip"] = "50";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+
+  // tile size must be WIDTHxHEIGHT, the tile parameters must be in their ranges
+  param["tile_size"] = "640";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["tile_size"] = "640x0";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["tile_size"] = "640x640";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+  param["tile_overlap"] = "0.95";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["tile_overlap"] = "0.25";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+  param["tile_merge_threshold"] = "0";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["tile_merge_threshold"] = "0.6";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+  param["tile_motion_threshold"] = "1.5";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["tile_motion_threshold"] = "0.05";
+  param["tile_full_frame"] = "true";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+
+  // cascade threshold must be a number in [0, 1]
+  param["cascade_attr"] = "classification";
+  param["cascade_threshold"] = "1.2";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["cascade_threshold"] = "0.85";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+  param["result_cache_size"] = "-1";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["result_cache_size"] = "1000";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+
+  // secondary models must be an array of valid parameters
+  param["secondary_models"] = "{\"model_path\" : \"cls.cambricon\"}";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["secondary_models"] = "[{\"model_path\" : \"cls.cambricon\", \"threshold\" : \"high\"}]";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["secondary_models"] = "[{\"model_path\" : \"cls.cambricon\", \"not_exist\" : 1}]";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["secondary_models"] = "[{\"model_path\" : \"cls.cambricon\", \"threshold\" : 0.6,"
+                              " \"keep_aspect_ratio\" : true}, {\"model_path\" : \"attr.cambricon\"}]";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+
   // model_input_pixel_format must be one of format
   std::list<std::string> format = {"RGBA32", "BGRA32", "ARGB32", "ABGR32", "RGB24", "BGR24"};
   param["model_input_pixel_format"] = "error_type";
@@ -135,4 +264,44 @@ TEST(Inferencer2, CheckParamSet) {
   // TODO(dmh): test mean and std
 }
 
+TEST(Inferencer2, PreprocPreset) {
+  ParamRegister param_register;
+  Infer2ParamManager manager;
+  manager.RegisterAll(&param_register);
+  ModuleParamSet param;
+  param["model_path"] = "fake_path";
+  param["func_name"] = "subnet0";
+  param["postproc_name"] = "empty_postproc";
+
+  Infer2Param params;
+  param["preproc_name"] = "cncv_yolov5";
+  ASSERT_TRUE(manager.ParseBy(param, &params));
+  EXPECT_EQ(params.preproc_name, "CNCV");
+  EXPECT_TRUE(params.keep_aspect_ratio);
+  EXPECT_EQ(params.mean_, std::vector<float>({0, 0, 0}));
+  EXPECT_EQ(params.std_, std::vector<float>({1, 1, 1}));
+  EXPECT_TRUE(params.normalize);
+
+  // parameters set by users are not overridden
+  params = Infer2Param();
+  param["preproc_name"] = "CNCV_YOLOV3";
+  param["keep_aspect_ratio"] = "false";
+  param["mean"] = "1, 2, 3, 4";
+  ASSERT_TRUE(manager.ParseBy(param, &params));
+  EXPECT_EQ(params.preproc_name, "CNCV");
+  EXPECT_FALSE(params.keep_aspect_ratio);
+  EXPECT_EQ(params.mean_, std::vector<float>({1, 2, 3, 4}));
+  EXPECT_TRUE(params.std_.empty());
+  EXPECT_FALSE(params.normalize);
+
+  // custom preprocessing is not affected
+  params = Infer2Param();
+  param.erase("keep_aspect_ratio");
+  param.erase("mean");
+  param["preproc_name"] = "VideoPreprocYolov5";
+  ASSERT_TRUE(manager.ParseBy(param, &params));
+  EXPECT_EQ(params.preproc_name, "VideoPreprocYolov5");
+  EXPECT_FALSE(params.keep_aspect_ratio);
+}
+
 }  // namespace cnstream
@@ -0,0 +1,194 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "infer_roi.hpp"
+
+namespace cnstream {
+
+TEST(Inferencer2, InferRoi_Parse) {
+  std::vector<InferRoi> rois;
+  ASSERT_TRUE(ParseInferRois("[[0.1, 0.5, 0.4, 0.5], [[0.2, 0.2], [0.6, 0.2], [0.5, 0.9]]]", &rois));
+  ASSERT_EQ(rois.size(), 2u);
+  EXPECT_TRUE(rois[0].polygon.empty());
+  EXPECT_FLOAT_EQ(rois[0].box.x, 0.1f);
+  EXPECT_FLOAT_EQ(rois[0].box.h, 0.5f);
+  // the crop of a polygon is its bounding box
+  ASSERT_EQ(rois[1].polygon.size(), 3u);
+  EXPECT_FLOAT_EQ(rois[1].box.x, 0.2f);
+  EXPECT_FLOAT_EQ(rois[1].box.y, 0.2f);
+  EXPECT_FLOAT_EQ(rois[1].box.w, 0.4f);
+  EXPECT_FLOAT_EQ(rois[1].box.h, 0.7f);
+
+  EXPECT_TRUE(ParseInferRois("[]", &rois));
+  EXPECT_TRUE(rois.empty());
+  EXPECT_FALSE(ParseInferRois("{}", &rois));
+  // out of the frame
+  EXPECT_FALSE(ParseInferRois("[[0.5, 0.5, 0.6, 0.2]]", &rois));
+  EXPECT_FALSE(ParseInferRois("[[[0.2, 0.2], [1.2, 0.2], [0.5, 0.9]]]", &rois));
+  // empty
+  EXPECT_FALSE(ParseInferRois("[[0.5, 0.5, 0, 0.2]]", &rois));
+  EXPECT_FALSE(ParseInferRois("[[[0.2, 0.2], [0.6, 0.2], [0.4, 0.2]]]", &rois));
+  // not enough coordinates or vertices
+  EXPECT_FALSE(ParseInferRois("[[0.1, 0.5, 0.4]]", &rois));
+  EXPECT_FALSE(ParseInferRois("[[[0.2, 0.2], [0.6, 0.2]]]", &rois));
+}
+
+TEST(Inferencer2, InferRoi_Contains) {
+  std::vector<InferRoi> rois;
+  ASSERT_TRUE(ParseInferRois("[[0.1, 0.5, 0.4, 0.5], [[0.2, 0.2], [0.6, 0.2], [0.6, 0.6]]]", &rois));
+  EXPECT_TRUE(InferRoiContains(rois[0], 0.3f, 0.7f));
+  EXPECT_FALSE(InferRoiContains(rois[0], 0.6f, 0.7f));
+  EXPECT_FALSE(InferRoiContains(rois[0], 0.3f, 0.4f));
+  // in the bounding box of the triangle, but above its hypotenuse
+  EXPECT_TRUE(InferRoiContains(rois[1], 0.5f, 0.3f));
+  EXPECT_FALSE(InferRoiContains(rois[1], 0.3f, 0.5f));
+  EXPECT_FALSE(InferRoiContains(rois[1], 0.7f, 0.3f));
+}
+
+TEST(Inferencer2, InferRoi_MapBox) {
+  std::vector<InferRoi> rois;
+  ASSERT_TRUE(ParseInferRois("[[0.2, 0.4, 0.5, 0.5]]", &rois));
+  CNInferBoundingBox box = MapRoiBox(rois[0], {0.5f, 0.2f, 0.4f, 1.0f});
+  EXPECT_FLOAT_EQ(box.x, 0.45f);
+  EXPECT_FLOAT_EQ(box.y, 0.5f);
+  EXPECT_FLOAT_EQ(box.w, 0.2f);
+  EXPECT_FLOAT_EQ(box.h, 0.5f);
+  // the whole crop is the region
+  box = MapRoiBox(rois[0], {0, 0, 1, 1});
+  EXPECT_FLOAT_EQ(box.x, 0.2f);
+  EXPECT_FLOAT_EQ(box.y, 0.4f);
+  EXPECT_FLOAT_EQ(box.w, 0.5f);
+  EXPECT_FLOAT_EQ(box.h, 0.5f);
+}
+
+TEST(Inferencer2, InferRoi_MakeTiles) {
+  std::vector<InferRoi> tiles = MakeTiles(1920, 1080, 640, 640, 0.2f);
+  // 4 columns at 0, 426, 853, 1280 and 2 rows at 0, 440
+  ASSERT_EQ(tiles.size(), 8u);
+  EXPECT_FLOAT_EQ(tiles[0].box.x, 0);
+  EXPECT_FLOAT_EQ(tiles[0].box.w, 640.f / 1920);
+  EXPECT_FLOAT_EQ(tiles[1].box.x, 426.f / 1920);
+  EXPECT_FLOAT_EQ(tiles[3].box.x + tiles[3].box.w, 1);
+  EXPECT_FLOAT_EQ(tiles[4].box.y, 440.f / 1080);
+  EXPECT_FLOAT_EQ(tiles[7].box.y + tiles[7].box.h, 1);
+  for (auto& tile : tiles) EXPECT_TRUE(tile.polygon.empty());
+  // the tiles are clipped to the frame
+  tiles = MakeTiles(1920, 1080, 4096, 4096, 0.2f);
+  ASSERT_EQ(tiles.size(), 1u);
+  EXPECT_FLOAT_EQ(tiles[0].box.w, 1);
+  EXPECT_FLOAT_EQ(tiles[0].box.h, 1);
+  EXPECT_TRUE(MakeTiles(0, 1080, 640, 640, 0.2f).empty());
+}
+
+static CNInferObjectPtr MakeObject(const std::string& id, float score, const CNInferBoundingBox& bbox) {
+  auto obj = std::make_shared<CNInferObject>();
+  obj->id = id;
+  obj->score = score;
+  obj->bbox = bbox;
+  return obj;
+}
+
+TEST(Inferencer2, InferRoi_MergeTileObjects) {
+  std::vector<CNInferObjectPtr> objs;
+  // cut by the edge of a tile
+  objs.push_back(MakeObject("1", 0.6f, {0.25f, 0.1f, 0.1f, 0.2f}));
+  objs.push_back(MakeObject("1", 0.9f, {0.1f, 0.1f, 0.2f, 0.2f}));
+  // another label, or far away
+  objs.push_back(MakeObject("2", 0.8f, {0.1f, 0.1f, 0.2f, 0.2f}));
+  objs.push_back(MakeObject("1", 0.7f, {0.6f, 0.6f, 0.2f, 0.2f}));
+  MergeTileObjects(&objs, 0.5f);
+  ASSERT_EQ(objs.size(), 3u);
+  // the object with the higher score is kept and covers the merged one
+  EXPECT_FLOAT_EQ(objs[0]->score, 0.9f);
+  EXPECT_FLOAT_EQ(objs[0]->bbox.x, 0.1f);
+  EXPECT_FLOAT_EQ(objs[0]->bbox.w, 0.25f);
+  EXPECT_FLOAT_EQ(objs[0]->bbox.h, 0.2f);
+  EXPECT_EQ(objs[1]->id, "2");
+  EXPECT_FLOAT_EQ(objs[2]->bbox.x, 0.6f);
+
+  // not overlapping enough
+  objs.clear();
+  objs.push_back(MakeObject("1", 0.9f, {0.1f, 0.1f, 0.2f, 0.2f}));
+  objs.push_back(MakeObject("1", 0.6f, {0.28f, 0.1f, 0.1f, 0.2f}));
+  MergeTileObjects(&objs, 0.5f);
+  EXPECT_EQ(objs.size(), 2u);
+}
+
+TEST(Inferencer2, InferRoi_TileScheduler) {
+  const uint32_t width = 64, height = 64;
+  TileScheduler scheduler(32, 32, 0, true, 0.1f, 2);
+  const std::vector<InferRoi>& tiles = scheduler.GetTiles(width, height);
+  // 4 tiles and the whole frame
+  ASSERT_EQ(tiles.size(), 5u);
+  EXPECT_FLOAT_EQ(tiles[4].box.w, 1);
+  EXPECT_EQ(&tiles, &scheduler.GetTiles(width, height));
+
+  const MotionDetector& detector = scheduler.GetMotionDetector();
+  auto thumbnail = [&detector](const std::vector<uint8_t>& plane) {
+    std::vector<const uint8_t*> rows;
+    for (uint32_t row : detector.SampleRows(height)) rows.push_back(plane.data() + row * width);
+    return detector.Thumbnail(rows, width);
+  };
+  std::vector<uint8_t> plane(width * height, 100);
+  std::vector<uint8_t> top_left(plane);
+  for (uint32_t r = 0; r < height / 2; ++r) {
+    for (uint32_t c = 0; c < width / 2; ++c) top_left[r * width + c] = 200;
+  }
+
+  // the first frame is inferred
+  std::vector<bool> inferred = scheduler.Select("0", tiles, thumbnail(plane));
+  EXPECT_EQ(inferred, std::vector<bool>(5, true));
+  std::vector<CNInferObjectPtr> objs = {MakeObject("1", 0.9f, {0.1f, 0.1f, 0.2f, 0.2f})};
+  scheduler.Merge("0", tiles, inferred, 0.5f, &objs);
+  ASSERT_EQ(objs.size(), 1u);
+
+  // static, only the whole frame is inferred and the objects of the tiles are reused
+  inferred = scheduler.Select("0", tiles, thumbnail(plane));
+  EXPECT_EQ(inferred, std::vector<bool>({false, false, false, false, true}));
+  objs.clear();
+  scheduler.Merge("0", tiles, inferred, 0.5f, &objs);
+  ASSERT_EQ(objs.size(), 1u);
+  EXPECT_FLOAT_EQ(objs[0]->bbox.x, 0.1f);
+
+  // the top left tile moves, and the object leaves
+  inferred = scheduler.Select("0", tiles, thumbnail(top_left));
+  EXPECT_EQ(inferred, std::vector<bool>({true, false, false, false, true}));
+  objs.clear();
+  scheduler.Merge("0", tiles, inferred, 0.5f, &objs);
+  EXPECT_TRUE(objs.empty());
+
+  // the tiles skipped twice are inferred
+  inferred = scheduler.Select("0", tiles, thumbnail(top_left));
+  EXPECT_EQ(inferred, std::vector<bool>({false, true, true, true, true}));
+
+  // no thumbnail, or a new stream
+  EXPECT_EQ(scheduler.Select("0", tiles, {}), std::vector<bool>(5, true));
+  EXPECT_EQ(scheduler.Select("1", tiles, thumbnail(plane)), std::vector<bool>(5, true));
+  scheduler.RemoveStream("0");
+  EXPECT_EQ(scheduler.Select("0", tiles, thumbnail(plane)), std::vector<bool>(5, true));
+}
+
+}  // namespace cnstream
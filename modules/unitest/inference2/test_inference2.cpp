@@ -20,6 +20,8 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
 
@@ -284,4 +286,42 @@ TEST(Inferencer2, Process) {
   EXPECT_NO_THROW(infer->Close());
 }
 
+TEST(Inferencer2, ReloadModel) {
+  bool use_magicmind = infer_server::Predictor::Backend() == "magicmind";
+  std::string exe_path = GetExePath();
+  std::unique_ptr<Inferencer2> infer(new Inferencer2("detector"));
+  ModuleParamSet param;
+  if (use_magicmind) {
+    param["model_path"] = exe_path + GetModelPathMM();
+    param["model_input_pixel_format"] = "RGB24";
+  } else {
+    param["model_path"] = exe_path + GetModelPath();
+    param["model_input_pixel_format"] = "ARGB32";
+  }
+  param["preproc_name"] = "FakeVideoPreproc";
+  param["postproc_name"] = "FakeVideoPostproc";
+  param["device_id"] = "0";
+  // not opened
+  EXPECT_FALSE(infer->ReloadModel(param["model_path"]));
+
+  ASSERT_TRUE(infer->Open(param));
+  auto reload = [&infer](const std::string& model_path) {
+    std::promise<bool> done;
+    std::future<bool> result = done.get_future();
+    EXPECT_TRUE(infer->ReloadModel(model_path, "", [&done](bool success) { done.set_value(success); }));
+    EXPECT_EQ(result.wait_for(std::chrono::seconds(60)), std::future_status::ready);
+    return result.get();
+  };
+  EXPECT_EQ(infer->Process(CreatData(param["device_id"])), 0);
+  EXPECT_TRUE(reload(param["model_path"]));
+  EXPECT_EQ(infer->GetModelGeneration(), 1u);
+  EXPECT_EQ(infer->Process(CreatData(param["device_id"])), 0);
+  EXPECT_EQ(infer->Process(CreatData(param["device_id"], true)), 0);
+  // the current model is kept
+  EXPECT_FALSE(reload(exe_path + "fake_model_path"));
+  EXPECT_EQ(infer->GetModelGeneration(), 1u);
+  EXPECT_EQ(infer->Process(CreatData(param["device_id"])), 0);
+  EXPECT_NO_THROW(infer->Close());
+}
+
 }  // namespace cnstream
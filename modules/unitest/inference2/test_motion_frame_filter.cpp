@@ -0,0 +1,153 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "motion_detector.hpp"
+#include "motion_frame_filter.hpp"
+
+namespace cnstream {
+
+static std::vector<const uint8_t*> GetRows(const std::vector<uint8_t>& plane, uint32_t width,
+                                           const std::vector<uint32_t>& row_indices) {
+  std::vector<const uint8_t*> rows;
+  for (uint32_t row : row_indices) rows.push_back(plane.data() + static_cast<size_t>(row) * width);
+  return rows;
+}
+
+TEST(Inferencer2, MotionDetector_SampleRows) {
+  MotionDetector detector(4, 4);
+  std::vector<uint32_t> rows = detector.SampleRows(64);
+  ASSERT_EQ(rows.size(), 4u);
+  for (size_t i = 1; i < rows.size(); ++i) EXPECT_GT(rows[i], rows[i - 1]);
+  EXPECT_LT(rows.back(), 64u);
+  // the plane is lower than the grid
+  EXPECT_LE(detector.SampleRows(2).size(), 2u);
+  EXPECT_TRUE(detector.SampleRows(0).empty());
+}
+
+TEST(Inferencer2, MotionDetector_Score) {
+  const uint32_t width = 64, height = 64;
+  MotionDetector detector(4, 4, 8);
+  std::vector<uint32_t> row_indices = detector.SampleRows(height);
+  std::vector<uint8_t> plane(width * height, 100);
+  std::vector<uint8_t> ref = detector.Thumbnail(GetRows(plane, width, row_indices), width);
+  ASSERT_EQ(ref.size(), 16u);
+
+  // no reference
+  EXPECT_FLOAT_EQ(detector.Score({}, ref), 1.0f);
+  // static frame and small noise
+  EXPECT_FLOAT_EQ(detector.Score(ref, ref), 0.0f);
+  std::vector<uint8_t> noise(plane);
+  for (auto& v : noise) v += 3;
+  EXPECT_FLOAT_EQ(detector.Score(ref, detector.Thumbnail(GetRows(noise, width, row_indices), width)), 0.0f);
+  // the whole frame changed
+  std::vector<uint8_t> changed(width * height, 200);
+  EXPECT_FLOAT_EQ(detector.Score(ref, detector.Thumbnail(GetRows(changed, width, row_indices), width)), 1.0f);
+  // left half changed
+  std::vector<uint8_t> half(plane);
+  for (uint32_t r = 0; r < height; ++r) {
+    for (uint32_t c = 0; c < width / 2; ++c) half[r * width + c] = 200;
+  }
+  std::vector<uint8_t> half_thumbnail = detector.Thumbnail(GetRows(half, width, row_indices), width);
+  EXPECT_FLOAT_EQ(detector.Score(ref, half_thumbnail), 0.5f);
+  // the regions of the left and the right halves
+  EXPECT_FLOAT_EQ(detector.Score(ref, half_thumbnail, 0, 0, 0.5f, 1), 1.0f);
+  EXPECT_FLOAT_EQ(detector.Score(ref, half_thumbnail, 0.5f, 0, 0.5f, 1), 0.0f);
+  EXPECT_FLOAT_EQ(detector.Score(ref, half_thumbnail, 0.25f, 0, 0.5f, 1), 0.5f);
+  // no cell in the region
+  EXPECT_FLOAT_EQ(detector.Score(ref, ref, 0.5f, 0.5f, 0.01f, 0.01f), 1.0f);
+  // not comparable
+  EXPECT_FLOAT_EQ(detector.Score(ref, std::vector<uint8_t>(4, 100)), 1.0f);
+  EXPECT_TRUE(detector.Thumbnail({}, width).empty());
+}
+
+static CNFrameInfoPtr CreateCpuFrame(const std::string& stream_id, std::vector<uint8_t>* image, int width,
+                                     int height) {
+  auto data = CNFrameInfo::Create(stream_id);
+  std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+  frame->width = width;
+  frame->height = height;
+  frame->stride[0] = frame->stride[1] = width;
+  frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+  frame->ctx.dev_type = DevContext::DevType::CPU;
+  frame->ctx.dev_id = -1;
+  void* ptr_cpu[2] = {image->data(), image->data() + width * height};
+  frame->CopyToSyncMem(ptr_cpu, false);
+  data->collection.Add(kCNDataFrameTag, frame);
+  return data;
+}
+
+TEST(Inferencer2, MotionFrameFilter_Filter) {
+  const int width = 320, height = 180;
+  std::vector<uint8_t> still(width * height * 3 / 2, 100);
+  std::vector<uint8_t> moving(width * height * 3 / 2, 200);
+  const uint32_t max_skip = 3;
+  MotionFrameFilter filter(0.01f, max_skip);
+
+  // the first frame of a stream is always inferred
+  EXPECT_TRUE(filter.Filter(CreateCpuFrame("0", &still, width, height)));
+  for (uint32_t i = 0; i < max_skip; ++i) {
+    EXPECT_FALSE(filter.Filter(CreateCpuFrame("0", &still, width, height)));
+  }
+  // inference is forced after max_skip frames
+  EXPECT_TRUE(filter.Filter(CreateCpuFrame("0", &still, width, height)));
+  EXPECT_FALSE(filter.Filter(CreateCpuFrame("0", &still, width, height)));
+  EXPECT_TRUE(filter.Filter(CreateCpuFrame("0", &moving, width, height)));
+  EXPECT_FALSE(filter.Filter(CreateCpuFrame("0", &moving, width, height)));
+
+  // streams are independent
+  EXPECT_TRUE(filter.Filter(CreateCpuFrame("1", &moving, width, height)));
+  filter.RemoveStream("0");
+  EXPECT_TRUE(filter.Filter(CreateCpuFrame("0", &moving, width, height)));
+
+  // frames without data frame are not filtered
+  EXPECT_TRUE(filter.Filter(CNFrameInfo::Create("0")));
+}
+
+TEST(Inferencer2, MotionFrameFilter_Activity) {
+  const int width = 320, height = 180;
+  std::vector<uint8_t> still(width * height * 3 / 2, 100);
+  MotionFrameFilter filter(0.1f, 0);
+  auto create_frame = [&](float activity) {
+    CNFrameInfoPtr data = CreateCpuFrame("0", &still, width, height);
+    data->collection.Get(kCNDataFrameSlot)->activity = activity;
+    return data;
+  };
+
+  // key frames are compared by pixels
+  EXPECT_TRUE(filter.Filter(create_frame(-1)));
+  EXPECT_FALSE(filter.Filter(create_frame(-1)));
+  // the activities since the last inferred frame are summed up
+  EXPECT_FALSE(filter.Filter(create_frame(0.04f)));
+  EXPECT_FALSE(filter.Filter(create_frame(0.04f)));
+  EXPECT_TRUE(filter.Filter(create_frame(0.04f)));
+  EXPECT_FALSE(filter.Filter(create_frame(0)));
+  EXPECT_TRUE(filter.Filter(create_frame(0.5f)));
+  // the thumbnail of the frames scored by the decoder is not kept, the next key frame is inferred
+  EXPECT_TRUE(filter.Filter(create_frame(-1)));
+}
+
+}  // namespace cnstream
@@ -0,0 +1,126 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "result_cache.hpp"
+
+namespace cnstream {
+
+TEST(Inferencer2, ResultCache_HashBytes) {
+  std::vector<uint8_t> bytes(37);
+  for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i);
+  uint64_t hash = HashBytes(bytes.data(), bytes.size());
+  EXPECT_EQ(hash, HashBytes(bytes.data(), bytes.size()));
+  // the tail shorter than 8 bytes, the size and the seed count
+  bytes.back() ^= 1;
+  EXPECT_NE(hash, HashBytes(bytes.data(), bytes.size()));
+  EXPECT_NE(HashBytes(bytes.data(), 36), HashBytes(bytes.data(), 37));
+  EXPECT_NE(HashBytes(bytes.data(), 36), HashBytes(bytes.data(), 36, 1));
+  std::vector<uint8_t> zeros(16, 0);
+  EXPECT_NE(HashBytes(zeros.data(), 8), HashBytes(zeros.data(), 16));
+}
+
+static CNDataFramePtr CreateCpuFrame(std::vector<uint8_t>* image, int width, int height, int stride) {
+  std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+  frame->width = width;
+  frame->height = height;
+  frame->stride[0] = frame->stride[1] = stride;
+  frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+  frame->ctx.dev_type = DevContext::DevType::CPU;
+  frame->ctx.dev_id = -1;
+  void* ptr_cpu[2] = {image->data(), image->data() + stride * height};
+  frame->CopyToSyncMem(ptr_cpu, false);
+  return frame;
+}
+
+TEST(Inferencer2, ResultCache_HashFrame) {
+  const int width = 30, height = 16, stride = 32;
+  std::vector<uint8_t> image(stride * height * 3 / 2, 100);
+  std::vector<uint8_t> other(image);
+  // the padding of the stride is not hashed
+  other[width] = 0;
+  uint64_t hash = 0, other_hash = 1;
+  ASSERT_TRUE(HashFrame(CreateCpuFrame(&image, width, height, stride), &hash));
+  ASSERT_TRUE(HashFrame(CreateCpuFrame(&other, width, height, stride), &other_hash));
+  EXPECT_EQ(hash, other_hash);
+  other[0] = 0;
+  ASSERT_TRUE(HashFrame(CreateCpuFrame(&other, width, height, stride), &other_hash));
+  EXPECT_NE(hash, other_hash);
+  // the format is not supported
+  CNDataFramePtr frame = CreateCpuFrame(&image, width, height, stride);
+  frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_RGB24;
+  EXPECT_FALSE(HashFrame(frame, &hash));
+}
+
+static std::vector<CNInferObjectPtr> MakeObjects(const std::string& id, size_t num) {
+  std::vector<CNInferObjectPtr> objs;
+  for (size_t i = 0; i < num; ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = id;
+    obj->score = 0.9f;
+    objs.push_back(obj);
+  }
+  return objs;
+}
+
+TEST(Inferencer2, ResultCache_GetPut) {
+  ResultCache cache(2);
+  std::vector<CNInferObjectPtr> objs;
+  EXPECT_FALSE(cache.Get(1, &objs));
+  std::vector<CNInferObjectPtr> cached = MakeObjects("1", 2);
+  cache.Put(1, cached);
+  // copies are cached and got
+  cached[0]->score = 0.1f;
+  ASSERT_TRUE(cache.Get(1, &objs));
+  ASSERT_EQ(objs.size(), 2u);
+  EXPECT_FLOAT_EQ(objs[0]->score, 0.9f);
+  EXPECT_NE(objs[0], cached[0]);
+  // frames without objects are cached too
+  cache.Put(2, {});
+  objs.clear();
+  EXPECT_TRUE(cache.Get(2, &objs));
+  EXPECT_TRUE(objs.empty());
+  EXPECT_EQ(cache.HitCount(), 2u);
+  EXPECT_EQ(cache.MissCount(), 1u);
+
+  // the least recently used frame is evicted
+  ASSERT_TRUE(cache.Get(1, &objs));
+  cache.Put(3, MakeObjects("3", 1));
+  EXPECT_EQ(cache.Size(), 2u);
+  objs.clear();
+  EXPECT_FALSE(cache.Get(2, &objs));
+  EXPECT_TRUE(cache.Get(1, &objs));
+  EXPECT_TRUE(cache.Get(3, &objs));
+  // replaced
+  cache.Put(3, MakeObjects("4", 3));
+  objs.clear();
+  ASSERT_TRUE(cache.Get(3, &objs));
+  ASSERT_EQ(objs.size(), 3u);
+  EXPECT_EQ(objs[0]->id, "4");
+  EXPECT_EQ(cache.Size(), 2u);
+}
+
+}  // namespace cnstream
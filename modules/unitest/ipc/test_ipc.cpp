@@ -0,0 +1,342 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ipc_frame_channel.hpp"
+#include "ipc_sink.hpp"
+#include "ipc_source.hpp"
+#include "ipc_worker.hpp"
+#include "ipc_workers.hpp"
+
+namespace cnstream {
+
+static std::string TestChannelName() { return "cnstream_test_ipc_" + std::to_string(getpid()); }
+
+static IpcFrameDesc MakeDesc(const std::string &stream_id, uint32_t buffer, uint64_t frame_id) {
+  IpcFrameDesc desc;
+  memset(&desc, 0, sizeof(desc));
+  stream_id.copy(desc.stream_id, sizeof(desc.stream_id) - 1);
+  desc.buffer = buffer;
+  desc.frame_id = frame_id;
+  desc.planes = 1;
+  desc.size[0] = 16;
+  return desc;
+}
+
+TEST(Ipc, ChannelPublishAndReceive) {
+  IpcFrameChannel producer, consumer;
+  uint32_t index = 0;
+  IpcFrameDesc desc;
+  uint8_t *buffer = nullptr;
+  EXPECT_FALSE(consumer.Attach(TestChannelName()));
+  EXPECT_FALSE(producer.Create(TestChannelName(), 0, 64, 2));
+  ASSERT_TRUE(producer.Create(TestChannelName(), 3, 64, 2));
+  EXPECT_EQ(producer.BufferSize(), 64u);
+  EXPECT_FALSE(producer.IsPeerAlive());
+  ASSERT_TRUE(consumer.Attach(TestChannelName()));
+  EXPECT_TRUE(producer.IsPeerAlive());
+  EXPECT_TRUE(consumer.IsPeerAlive());
+  EXPECT_FALSE(consumer.Receive(&desc, &buffer));
+  // only the producer publishes, only the consumer receives
+  EXPECT_EQ(consumer.AcquireBuffer(&index), nullptr);
+  EXPECT_FALSE(producer.Receive(&desc, &buffer));
+
+  uint8_t *data = producer.AcquireBuffer(&index);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(producer.RefCount(index), 1);
+  memcpy(data, "0123456789abcdef", 16);
+  EXPECT_TRUE(producer.Publish(MakeDesc("stream_0", index, 7)));
+  ASSERT_TRUE(consumer.Receive(&desc, &buffer));
+  EXPECT_STREQ(desc.stream_id, "stream_0");
+  EXPECT_EQ(desc.frame_id, 7u);
+  EXPECT_EQ(desc.buffer, index);
+  // the planes are mapped in place
+  EXPECT_EQ(std::string(reinterpret_cast<char *>(buffer), 16), "0123456789abcdef");
+  EXPECT_EQ(consumer.RefCount(index), 1);
+  consumer.ReleaseBuffer(index);
+  EXPECT_EQ(producer.RefCount(index), 0);
+  consumer.ReleaseBuffer(index);
+  EXPECT_EQ(producer.RefCount(index), 0);
+
+  // the buffer is released when the queue is full
+  uint32_t indexes[3];
+  for (auto &i : indexes) ASSERT_NE(producer.AcquireBuffer(&i), nullptr);
+  EXPECT_EQ(producer.AcquireBuffer(&index), nullptr);
+  EXPECT_TRUE(producer.Publish(MakeDesc("stream_0", indexes[0], 8)));
+  EXPECT_TRUE(producer.Publish(MakeDesc("stream_0", indexes[1], 9)));
+  EXPECT_FALSE(producer.Publish(MakeDesc("stream_0", indexes[2], 10)));
+  EXPECT_EQ(producer.RefCount(indexes[2]), 0);
+
+  // descriptions out of the buffer are dropped
+  IpcFrameDesc invalid = MakeDesc("stream_0", IpcFrameDesc::kNoBuffer, 11);
+  ASSERT_TRUE(consumer.Receive(&desc, &buffer));
+  EXPECT_EQ(desc.frame_id, 8u);
+  EXPECT_TRUE(producer.Publish(invalid));
+  ASSERT_TRUE(consumer.Receive(&desc, &buffer));
+  EXPECT_EQ(desc.frame_id, 9u);
+  EXPECT_FALSE(consumer.Receive(&desc, &buffer));
+  invalid.planes = 0;
+  invalid.eos = 1;
+  EXPECT_TRUE(producer.Publish(invalid));
+  ASSERT_TRUE(consumer.Receive(&desc, &buffer));
+  EXPECT_EQ(desc.eos, 1u);
+  EXPECT_EQ(buffer, nullptr);
+
+  consumer.Close();
+  EXPECT_FALSE(consumer.IsPeerAlive());
+  EXPECT_FALSE(producer.IsPeerAlive());
+  // the channel is removed by the producer
+  producer.Close();
+  EXPECT_FALSE(consumer.Attach(TestChannelName()));
+}
+
+TEST(Ipc, ChannelCrashedConsumer) {
+  const std::string name = TestChannelName();
+  IpcFrameChannel producer;
+  ASSERT_TRUE(producer.Create(name, 2, 64, 2));
+  uint32_t index[2];
+  for (auto &i : index) {
+    ASSERT_NE(producer.AcquireBuffer(&i), nullptr);
+    ASSERT_TRUE(producer.Publish(MakeDesc("stream_0", i, i)));
+  }
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    // receives a frame and exits without releasing it
+    IpcFrameChannel consumer;
+    IpcFrameDesc desc;
+    uint8_t *buffer;
+    _exit(consumer.Attach(name) && consumer.Receive(&desc, &buffer) ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_EQ(producer.RefCount(index[0]), 1);
+  EXPECT_EQ(producer.RefCount(index[1]), 1);
+
+  // the buffer held by the dead consumer is taken back, the one in the queue is kept
+  uint32_t reclaimed;
+  ASSERT_NE(producer.AcquireBuffer(&reclaimed), nullptr);
+  EXPECT_EQ(reclaimed, index[0]);
+  uint32_t none;
+  EXPECT_EQ(producer.AcquireBuffer(&none), nullptr);
+
+  // a new consumer continues with the frames left in the queue
+  IpcFrameChannel consumer;
+  ASSERT_TRUE(consumer.Attach(name));
+  IpcFrameDesc desc;
+  uint8_t *buffer;
+  ASSERT_TRUE(consumer.Receive(&desc, &buffer));
+  EXPECT_EQ(desc.buffer, index[1]);
+  consumer.ReleaseBuffer(desc.buffer);
+  EXPECT_EQ(producer.RefCount(index[1]), 0);
+}
+
+TEST(Ipc, OpenClose) {
+  IpcSink sink("ipc_sink");
+  ModuleParamSet params;
+  params["channel"] = TestChannelName();
+  EXPECT_TRUE(sink.CheckParamSet(params));
+  EXPECT_TRUE(sink.Open(params));
+  sink.Close();
+  params["buffer_count"] = "0";
+  EXPECT_FALSE(sink.Open(params));
+  params["buffer_count"] = "4";
+  params["buffer_size"] = "-1";
+  EXPECT_FALSE(sink.Open(params));
+  params["buffer_size"] = "1";
+  params["queue_size"] = "2048";
+  EXPECT_FALSE(sink.Open(params));
+  params["queue_size"] = "2";
+  EXPECT_TRUE(sink.Open(params));
+  sink.Close();
+
+  IpcSource source("ipc_source");
+  params.clear();
+  params["channel"] = TestChannelName();
+  params["device_id"] = "-2";
+  EXPECT_FALSE(source.Open(params));
+  params["device_id"] = "0";
+  EXPECT_TRUE(source.Open(params));
+  source.Close();
+}
+
+TEST(Ipc, SinkToSource) {
+  IpcSink sink("ipc_sink");
+  ModuleParamSet params;
+  params["channel"] = TestChannelName();
+  params["buffer_count"] = "2";
+  params["buffer_size"] = "1";
+  ASSERT_TRUE(sink.Open(params));
+  IpcFrameChannel channel;
+
+  const int width = 64, height = 32;
+  std::vector<uint8_t> y(width * height, 16), uv(width * height / 2, 128);
+  auto data = CNFrameInfo::Create("stream_0");
+  auto frame = std::make_shared<CNDataFrame>();
+  frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+  frame->width = width;
+  frame->height = height;
+  frame->stride[0] = frame->stride[1] = width;
+  frame->ctx.dev_type = DevContext::DevType::CPU;
+  frame->data[0].reset(new CNSyncedMemory(y.size()));
+  frame->data[0]->SetCpuData(y.data());
+  frame->data[1].reset(new CNSyncedMemory(uv.size()));
+  frame->data[1]->SetCpuData(uv.data());
+  data->collection.Add(kCNDataFrameSlot, frame);
+  // dropped without a receiver once the queue is full
+  for (int i = 0; i < 3; ++i) EXPECT_EQ(sink.Process(data), 0);
+  EXPECT_EQ(sink.Dropped(), 1u);
+
+  IpcSource source("ipc_source");
+  params.clear();
+  params["channel"] = TestChannelName();
+  ASSERT_TRUE(source.Open(params));
+  // the frames are released as there is no pipeline, so the buffers are given back
+  for (int i = 0; i < 100 && !source.GetSourceHandler("stream_0"); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_NE(source.GetSourceHandler("stream_0"), nullptr);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(sink.Process(data), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  sink.OnEos("stream_0");
+  EXPECT_EQ(sink.Dropped(), 1u);
+  sink.Close();
+  source.Close();
+  EXPECT_EQ(source.GetSourceHandler("stream_0"), nullptr);
+}
+
+class IpcTestObserver : public IModuleObserver {
+ public:
+  void notify(std::shared_ptr<CNFrameInfo> data) override {
+    std::lock_guard<std::mutex> lk(mutex_);
+    frames_.push_back(data);
+  }
+  std::vector<std::shared_ptr<CNFrameInfo>> Frames() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return frames_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<CNFrameInfo>> frames_;
+};  // class IpcTestObserver
+
+TEST(Ipc, Workers) {
+  const std::string channel = TestChannelName() + "_workers";
+  IpcWorkers workers("ipc_workers");
+  ModuleParamSet params;
+  EXPECT_FALSE(workers.CheckParamSet(params));
+  // the worker process only keeps alive, the frames are processed by a thread of this process
+  params["command"] = "sleep 60";
+  params["channel"] = channel;
+  params["buffer_size"] = "1";
+  params["workers"] = "0";
+  EXPECT_FALSE(workers.Open(params));
+  params["workers"] = "1";
+  ASSERT_TRUE(workers.Open(params));
+  IpcTestObserver observer;
+  workers.SetObserver(&observer);
+
+  const int width = 64, height = 32;
+  std::vector<uint8_t> y(width * height, 16), uv(width * height / 2, 128);
+  std::atomic<int> replied{0};
+  std::thread worker_thread([&] {
+    IpcWorker worker;
+    ASSERT_TRUE(worker.Open(channel + "_0_in", channel + "_0_out"));
+    EXPECT_TRUE(worker.IsHostAlive());
+    while (replied.load() < 1) {
+      auto data = worker.Receive(100);
+      if (!data) continue;
+      // the planes are used in place, the objects of the frame are received
+      CNDataFramePtr frame = data->collection.Get(kCNDataFrameSlot);
+      EXPECT_EQ(frame->frame_id, 7u);
+      EXPECT_EQ(memcmp(frame->data[1]->GetCpuData(), uv.data(), uv.size()), 0);
+      CNInferObjsPtr objs_holder = data->collection.Get(kCNInferObjsSlot);
+      ASSERT_EQ(objs_holder->objs_.size(), 1u);
+      EXPECT_EQ(objs_holder->objs_[0]->id, "0");
+      auto obj = std::make_shared<CNInferObject>();
+      obj->id = "1";
+      obj->score = 0.5;
+      objs_holder->objs_.push_back(obj);
+      EXPECT_TRUE(worker.Reply(data));
+      ++replied;
+    }
+    // the replies are received from the channel of the worker, it is removed when the worker exits
+    for (int i = 0; i < 500 && observer.Frames().size() < 2; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+
+  auto data = CNFrameInfo::Create("stream_0");
+  auto frame = std::make_shared<CNDataFrame>();
+  frame->frame_id = 7;
+  frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+  frame->width = width;
+  frame->height = height;
+  frame->stride[0] = frame->stride[1] = width;
+  frame->ctx.dev_type = DevContext::DevType::CPU;
+  frame->data[0].reset(new CNSyncedMemory(y.size()));
+  frame->data[0]->SetCpuData(y.data());
+  frame->data[1].reset(new CNSyncedMemory(uv.size()));
+  frame->data[1]->SetCpuData(uv.data());
+  data->collection.Add(kCNDataFrameSlot, frame);
+  auto objs_holder = std::make_shared<CNInferObjs>();
+  auto obj = std::make_shared<CNInferObject>();
+  obj->id = "0";
+  objs_holder->objs_.push_back(obj);
+  data->collection.Add(kCNInferObjsSlot, objs_holder);
+  EXPECT_EQ(workers.Process(data), 0);
+  // eos is not passed to the worker, it is transmitted after the frame
+  EXPECT_EQ(workers.Process(CNFrameInfo::Create("stream_0", true)), 0);
+
+  for (int i = 0; i < 500 && observer.Frames().size() < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  worker_thread.join();
+  auto frames = observer.Frames();
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0], data);
+  EXPECT_TRUE(frames[1]->IsEos());
+  // the objects are replaced by the ones sent back
+  auto objs = data->collection.Get(kCNInferObjsSlot)->objs_;
+  ASSERT_EQ(objs.size(), 2u);
+  EXPECT_EQ(objs[0]->id, "0");
+  EXPECT_EQ(objs[1]->id, "1");
+  EXPECT_FLOAT_EQ(objs[1]->score, 0.5);
+  workers.Close();
+}
+
+}  // namespace cnstream
@@ -23,6 +23,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
@@ -32,6 +33,7 @@
 #include "cnstream_frame_va.hpp"
 #include "cnstream_module.hpp"
 #include "osd.hpp"
+#include "private/cnstream_parallel.hpp"
 #include "test_base.hpp"
 
 namespace cnstream {
@@ -140,6 +142,96 @@ TEST(Osd, Process) {
   EXPECT_EQ(osd->Process(data), -1);
 }
 
+TEST(Osd, ProcessYuv) {
+  std::shared_ptr<Module> osd = std::make_shared<Osd>(gname);
+  ModuleParamSet param;
+  param["label_path"] = GetExePath() + glabel_path;
+  param["logo"] = "Cambricon-test";
+  param["draw_format"] = "yuv";
+  ASSERT_TRUE(osd->Open(param));
+
+  // prepare a black NV12 frame
+  int width = 1920;
+  int height = 1080;
+  std::vector<uint8_t> y_plane(width * height, 16), uv_plane(width * height / 2, 128);
+  auto data = cnstream::CNFrameInfo::Create(std::to_string(0));
+  std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+  data->SetStreamIndex(0);
+  frame->frame_id = 1;
+  frame->width = width;
+  frame->height = height;
+  void* ptr_cpu[2] = {y_plane.data(), uv_plane.data()};
+  frame->stride[0] = width;
+  frame->stride[1] = width;
+  frame->ctx.dev_type = DevContext::DevType::CPU;
+  frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+  frame->CopyToSyncMem(ptr_cpu, false);
+  data->collection.Add(kCNDataFrameTag, frame);
+
+  std::shared_ptr<CNInferObjs> objs_holder = std::make_shared<CNInferObjs>();
+  auto obj = std::make_shared<CNInferObject>();
+  obj->id = std::to_string(1);
+  obj->bbox = {0.25, 0.25, 0.5, 0.5};
+  objs_holder->objs_.push_back(obj);
+  data->collection.Add(kCNInferObjsTag, objs_holder);
+
+  EXPECT_EQ(osd->Process(data), 0);
+  // drawn on the planes, the frame is not converted to BGR
+  EXPECT_FALSE(frame->HasBGRImage());
+  const uint8_t* y = static_cast<const uint8_t*>(frame->data[0]->GetCpuData());
+  EXPECT_NE(y[height / 4 * width + width / 2], 16);  // the top edge of the box
+  EXPECT_NE(y[height / 2 * width + width / 4], 16);  // the left edge of the box
+  EXPECT_EQ(y[height / 2 * width + width / 2], 16);  // inside the box
+  EXPECT_EQ(y[height / 8 * width + width / 8], 16);  // outside the box
+  osd->Close();
+}
+
+TEST(Osd, ProcessParallel) {
+  std::shared_ptr<Module> osd = std::make_shared<Osd>(gname);
+  ModuleParamSet param;
+  param["label_path"] = GetExePath() + glabel_path;
+  ASSERT_TRUE(osd->Open(param));
+
+  std::shared_ptr<CNInferObjs> objs_holder = std::make_shared<CNInferObjs>();
+  for (int i = 0; i < 40; ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = std::to_string(i % 5);
+    obj->score = 0.5 + i * 0.01;
+    obj->track_id = std::to_string(i);
+    obj->bbox = {(i % 8) * 0.12f, (i / 8) * 0.19f, 0.15f, 0.25f};
+    objs_holder->objs_.push_back(obj);
+  }
+
+  // a 4K frame drawn on bands concurrently is the same as the one drawn serially
+  auto draw = [&](int thread_num) {
+    int width = 3840;
+    int height = 2160;
+    cv::Mat img(height, width, CV_8UC3, cv::Scalar(0, 0, 0));
+    auto data = cnstream::CNFrameInfo::Create(std::to_string(0));
+    std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+    data->SetStreamIndex(0);
+    frame->width = width;
+    frame->height = height;
+    void* ptr_cpu[1] = {img.data};
+    frame->stride[0] = width;
+    frame->ctx.dev_type = DevContext::DevType::CPU;
+    frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_BGR24;
+    frame->CopyToSyncMem(ptr_cpu, false);
+    data->collection.Add(kCNDataFrameTag, frame);
+    data->collection.Add(kCNInferObjsTag, objs_holder);
+    int saved_thread_num = GetParallelThreadNum();
+    SetParallelThreadNum(thread_num);
+    EXPECT_EQ(osd->Process(data), 0);
+    SetParallelThreadNum(saved_thread_num);
+    return frame->ImageBGR().clone();
+  };
+  cv::Mat serial = draw(0);
+  cv::Mat parallel = draw(4);
+  EXPECT_GT(cv::countNonZero(serial.reshape(1)), 0);
+  EXPECT_EQ(cv::countNonZero(serial.reshape(1) != parallel.reshape(1)), 0);
+  osd->Close();
+}
+
 TEST(Osd, ProcessSecondary) {
   // create osd
   std::shared_ptr<Module> osd = std::make_shared<Osd>(gname);
@@ -249,6 +341,12 @@ TEST(Osd, CheckParamSet) {
   EXPECT_FALSE(osd->CheckParamSet(param));
   param.clear();
 
+  param["draw_format"] = "yuv";
+  EXPECT_TRUE(osd->CheckParamSet(param));
+  param["draw_format"] = "rgb";
+  EXPECT_FALSE(osd->CheckParamSet(param));
+  param.clear();
+
   param["test_param"] = "test";
   EXPECT_TRUE(osd->CheckParamSet(param));
 }
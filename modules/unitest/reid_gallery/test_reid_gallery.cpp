@@ -0,0 +1,225 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "reid_gallery.hpp"
+#include "reid_index.hpp"
+
+namespace cnstream {
+
+static constexpr const char *gname = "reid_gallery";
+
+static std::vector<float> RandomFeature(std::mt19937 *gen, size_t dim) {
+  std::normal_distribution<float> dist(0, 1);
+  std::vector<float> feature(dim);
+  for (auto &v : feature) v = dist(*gen);
+  return feature;
+}
+
+static std::vector<float> Perturb(std::mt19937 *gen, const std::vector<float> &feature, float noise) {
+  std::normal_distribution<float> dist(0, noise);
+  std::vector<float> perturbed = feature;
+  for (auto &v : perturbed) v += dist(*gen);
+  return perturbed;
+}
+
+TEST(ReidGallery, IndexSearch) {
+  std::mt19937 gen(5);
+  const size_t dim = 36;
+  ReidIndex::Params params;
+  params.nlist = 1;
+  ReidIndex index(dim, params);
+  auto now = ReidIndex::Clock::now();
+  std::vector<std::vector<float>> features;
+  for (int i = 0; i < 10; ++i) {
+    features.push_back(RandomFeature(&gen, dim));
+    ASSERT_TRUE(index.Add("cam" + std::to_string(i % 2), std::to_string(i), features.back().data(), now));
+  }
+  EXPECT_FALSE(index.Add("cam0", "zero", std::vector<float>(dim, 0.f).data(), now));
+  EXPECT_EQ(index.Size(), 10u);
+
+  std::vector<float> query = Perturb(&gen, features[3], 0.1f);
+  std::vector<ReidQuery> queries(2);
+  queries[0].feature = query.data();
+  queries[0].stream_id = "cam0";
+  queries[1].feature = query.data();
+  queries[1].stream_id = "cam1";
+  queries[1].track_id = "3";
+  std::vector<std::vector<ReidMatch>> results;
+  index.Search(queries, 3, 2.f, true, &results);
+  ASSERT_EQ(results.size(), 2u);
+  ASSERT_EQ(results[0].size(), 3u);
+  EXPECT_EQ(results[0][0].stream_id, "cam1");
+  EXPECT_EQ(results[0][0].track_id, "3");
+  EXPECT_LT(results[0][0].distance, 0.05f);
+  EXPECT_LE(results[0][0].distance, results[0][1].distance);
+  EXPECT_LE(results[0][1].distance, results[0][2].distance);
+  // the tracks of the stream of the query are skipped
+  for (const auto &match : results[1]) EXPECT_EQ(match.stream_id, "cam0");
+
+  // the track of the query is skipped anyway
+  index.Search(queries, 3, 2.f, false, &results);
+  EXPECT_NE(results[1][0].track_id, "3");
+  // too far
+  index.Search(queries, 3, 0.f, false, &results);
+  EXPECT_TRUE(results[0].empty());
+
+  // a track is replaced
+  std::vector<float> moved = RandomFeature(&gen, dim);
+  ASSERT_TRUE(index.Add("cam1", "3", moved.data(), now));
+  EXPECT_EQ(index.Size(), 10u);
+  queries[0].feature = moved.data();
+  index.Search(queries, 1, 2.f, true, &results);
+  ASSERT_EQ(results[0].size(), 1u);
+  EXPECT_EQ(results[0][0].track_id, "3");
+  EXPECT_NEAR(results[0][0].distance, 0.f, 1e-5);
+}
+
+TEST(ReidGallery, IndexEvict) {
+  std::mt19937 gen(6);
+  const size_t dim = 16;
+  ReidIndex::Params params;
+  params.max_entries = 8;
+  ReidIndex index(dim, params);
+  auto start = ReidIndex::Clock::now();
+  for (int i = 0; i < 10; ++i) {
+    index.Add("cam0", std::to_string(i), RandomFeature(&gen, dim).data(), start + std::chrono::seconds(i));
+  }
+  // the oldest tracks are evicted beyond max_entries
+  EXPECT_EQ(index.Size(), 8u);
+  // a track seen again is kept
+  index.Add("cam0", "2", RandomFeature(&gen, dim).data(), start + std::chrono::seconds(20));
+  EXPECT_EQ(index.Evict(start + std::chrono::seconds(9)), 6u);
+  EXPECT_EQ(index.Size(), 2u);
+  std::vector<float> query = RandomFeature(&gen, dim);
+  std::vector<ReidQuery> queries(1);
+  queries[0].feature = query.data();
+  std::vector<std::vector<ReidMatch>> results;
+  index.Search(queries, 5, 2.f, false, &results);
+  ASSERT_EQ(results[0].size(), 2u);
+  std::vector<std::string> tracks = {results[0][0].track_id, results[0][1].track_id};
+  std::sort(tracks.begin(), tracks.end());
+  EXPECT_EQ(tracks, std::vector<std::string>({"2", "9"}));
+}
+
+TEST(ReidGallery, IndexRecall) {
+  // clustered features, the lists probed are expected to hold the nearest track of most queries
+  std::mt19937 gen(7);
+  const size_t dim = 64, clusters = 40, tracks = 4000;
+  ReidIndex::Params params;
+  params.nlist = 32;
+  params.nprobe = 4;
+  params.train_size = 1024;
+  ReidIndex index(dim, params);
+  std::vector<std::vector<float>> centers, features;
+  for (size_t c = 0; c < clusters; ++c) centers.push_back(RandomFeature(&gen, dim));
+  auto now = ReidIndex::Clock::now();
+  for (size_t i = 0; i < tracks; ++i) {
+    features.push_back(Perturb(&gen, centers[i % clusters], 0.5f));
+    index.Add("cam0", std::to_string(i), features.back().data(), now);
+  }
+  EXPECT_GT(index.ListNum(), 1u);
+  EXPECT_EQ(index.Size(), tracks);
+
+  std::vector<std::vector<float>> query_features;
+  std::vector<ReidQuery> queries(200);
+  for (size_t q = 0; q < queries.size(); ++q) query_features.push_back(Perturb(&gen, features[q * 17], 0.05f));
+  for (size_t q = 0; q < queries.size(); ++q) {
+    queries[q].feature = query_features[q].data();
+    queries[q].stream_id = "cam1";
+  }
+  std::vector<std::vector<ReidMatch>> results;
+  index.Search(queries, 1, 2.f, true, &results);
+  size_t hit = 0;
+  for (size_t q = 0; q < queries.size(); ++q) {
+    hit += !results[q].empty() && results[q][0].track_id == std::to_string(q * 17);
+  }
+  EXPECT_GE(hit, queries.size() * 9 / 10);
+}
+
+static std::shared_ptr<CNFrameInfo> CreateFrame(const std::string &stream_id, const std::vector<float> &feature,
+                                                const std::string &track_id, CNFeaturePrecision precision) {
+  auto data = CNFrameInfo::Create(stream_id);
+  auto objs_holder = std::make_shared<CNInferObjs>();
+  auto obj = objs_holder->CreateObject();
+  obj->id = "0";
+  obj->track_id = track_id;
+  obj->AddFeature("track", feature, precision);
+  objs_holder->Append({obj});
+  data->collection.Add(kCNInferObjsTag, objs_holder);
+  return data;
+}
+
+static CNInferObjectPtr GetObject(const std::shared_ptr<CNFrameInfo> &data) {
+  return data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag)->objs_[0];
+}
+
+TEST(ReidGallery, Process) {
+  ReidGallery module(gname);
+  ModuleParamSet params;
+  params["top_k"] = "0";
+  EXPECT_FALSE(module.Open(params));
+  params["top_k"] = "2";
+  params["cross_stream_only"] = "yes";
+  EXPECT_FALSE(module.Open(params));
+  params["cross_stream_only"] = "true";
+  params["max_distance"] = "0.2";
+  ASSERT_TRUE(module.Open(params));
+
+  std::mt19937 gen(8);
+  std::vector<float> person = RandomFeature(&gen, 128), car = RandomFeature(&gen, 128);
+  EXPECT_EQ(module.Process(CreateFrame("cam0", person, "1", CNFeaturePrecision::FP32)), 0);
+  EXPECT_EQ(module.Process(CreateFrame("cam0", car, "2", CNFeaturePrecision::FP32)), 0);
+  EXPECT_EQ(module.GetGallerySize(), 2u);
+
+  // the person is seen by another camera, the feature is quantized
+  auto data = CreateFrame("cam1", Perturb(&gen, person, 0.05f), "7", CNFeaturePrecision::INT8);
+  EXPECT_EQ(module.Process(data), 0);
+  auto obj = GetObject(data);
+  EXPECT_EQ(obj->GetExtraAttribute("reid_match_0"), "cam0:1");
+  CNInferAttr attr = obj->GetAttribute("reid_match_0");
+  EXPECT_EQ(attr.value, 1);
+  EXPECT_GT(attr.score, 0.8f);
+  EXPECT_TRUE(obj->GetExtraAttribute("reid_match_1").empty());
+  EXPECT_EQ(module.GetGallerySize(), 3u);
+
+  // the tracks of the same camera are not matched
+  data = CreateFrame("cam0", Perturb(&gen, car, 0.05f), "3", CNFeaturePrecision::FP16);
+  EXPECT_EQ(module.Process(data), 0);
+  EXPECT_TRUE(GetObject(data)->GetExtraAttribute("reid_match_0").empty());
+
+  // the features of another dimension are skipped
+  EXPECT_EQ(module.Process(CreateFrame("cam2", RandomFeature(&gen, 64), "1", CNFeaturePrecision::FP32)), 0);
+  EXPECT_EQ(module.GetGallerySize(), 4u);
+  EXPECT_EQ(module.Process(CNFrameInfo::Create("cam0", true)), 0);
+  module.Close();
+  EXPECT_EQ(module.GetGallerySize(), 0u);
+}
+
+}  // namespace cnstream
@@ -85,6 +85,32 @@ TEST(RtspModule, OpenClose) {
   params["dst_height"] = "720";
   EXPECT_TRUE(module.Open(params));
 
+  params["adaptive_rate"] = "true";
+  EXPECT_TRUE(module.Open(params));
+  params["adaptive_rate"] = "abc";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("adaptive_rate");
+
+  params["shared_rtp"] = "true";
+  params["server_threads"] = "2";
+  EXPECT_TRUE(module.Open(params));
+  params["server_threads"] = "0";
+  EXPECT_FALSE(module.Open(params));
+  params["server_threads"] = "2";
+  params["rtsp_over_http"] = "true";
+  EXPECT_FALSE(module.Open(params));
+  params["rtsp_over_http"] = "false";
+  params.erase("shared_rtp");
+  params.erase("server_threads");
+
+  params["low_latency"] = "true";
+  params["resample"] = "true";
+  EXPECT_TRUE(module.Open(params));
+  params["low_latency"] = "abc";
+  EXPECT_FALSE(module.Open(params));
+  params.erase("low_latency");
+  params["resample"] = "false";
+
   params["input_frame"] = "mlu";
   params["encoder_type"] = "mlu";
   params["device_id"] = "-1";
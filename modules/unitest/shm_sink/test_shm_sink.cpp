@@ -0,0 +1,176 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "cnstream_infer_objs_codec.hpp"
+#include "shm_ring.hpp"
+#include "shm_sink.hpp"
+
+namespace cnstream {
+
+static std::string TestShmName() { return "cnstream_test_shm_" + std::to_string(getpid()); }
+
+TEST(ShmSink, RingWriteAndRead) {
+  ShmRingWriter writer;
+  ShmRingReader reader;
+  EXPECT_FALSE(reader.Attach(TestShmName()));
+  EXPECT_FALSE(writer.Create(TestShmName(), 0, 16));
+  ASSERT_TRUE(writer.Create(TestShmName(), 4, 16));
+  EXPECT_EQ(writer.Write("first", 5), 1u);
+
+  std::string result, thumbnail;
+  uint64_t seq = 0;
+  // reads from the oldest or from the messages published after attaching
+  ASSERT_TRUE(reader.Attach(TestShmName(), true));
+  EXPECT_EQ(reader.Read(&result, &thumbnail, &seq), ShmRingReader::Status::OK);
+  EXPECT_EQ(result, "first");
+  EXPECT_TRUE(thumbnail.empty());
+  EXPECT_EQ(seq, 1u);
+  ASSERT_TRUE(reader.Attach(TestShmName()));
+  EXPECT_EQ(reader.Read(&result), ShmRingReader::Status::EMPTY);
+
+  EXPECT_EQ(writer.Write("second", 6, "jpeg", 4), 2u);
+  // the thumbnail is dropped if the message does not fit in a slot
+  EXPECT_EQ(writer.Write("third", 5, "too large thumbnail", 19), 3u);
+  // the result larger than a slot is dropped
+  EXPECT_EQ(writer.Write("result larger than a slot", 25), 0u);
+  EXPECT_EQ(reader.Read(&result, &thumbnail, &seq), ShmRingReader::Status::OK);
+  EXPECT_EQ(result, "second");
+  EXPECT_EQ(thumbnail, "jpeg");
+  EXPECT_EQ(reader.Read(&result, &thumbnail, &seq), ShmRingReader::Status::OK);
+  EXPECT_EQ(result, "third");
+  EXPECT_TRUE(thumbnail.empty());
+  EXPECT_EQ(seq, 3u);
+  EXPECT_EQ(reader.Read(&result), ShmRingReader::Status::EMPTY);
+  EXPECT_EQ(reader.Dropped(), 0u);
+
+  // the writer never waits, the reader falling behind skips the overwritten messages
+  for (int i = 4; i <= 10; ++i) writer.Write(std::to_string(i).data(), std::to_string(i).size());
+  EXPECT_EQ(reader.Read(&result, nullptr, &seq), ShmRingReader::Status::OK);
+  EXPECT_EQ(seq, 7u);
+  EXPECT_EQ(result, "7");
+  EXPECT_EQ(reader.Dropped(), 3u);
+
+  writer.Destroy();
+  EXPECT_EQ(writer.Write("closed", 6), 0u);
+  EXPECT_FALSE(ShmRingReader().Attach(TestShmName()));
+  reader.Detach();
+  EXPECT_EQ(reader.Read(&result), ShmRingReader::Status::ERROR);
+}
+
+TEST(ShmSink, RingConcurrentReader) {
+  ShmRingWriter writer;
+  ASSERT_TRUE(writer.Create(TestShmName(), 8, 64));
+  ShmRingReader reader;
+  ASSERT_TRUE(reader.Attach(TestShmName()));
+  const uint64_t total = 100000;
+  std::atomic<bool> done{false};
+  std::thread writer_thread([&]() {
+    for (uint64_t i = 1; i <= total; ++i) {
+      std::string msg(static_cast<size_t>(i % 48) + 8, static_cast<char>('a' + i % 26));
+      writer.Write(msg.data(), msg.size());
+    }
+    done.store(true);
+  });
+  uint64_t read = 0, last_seq = 0;
+  std::string result;
+  while (true) {
+    bool finished = done.load();
+    uint64_t seq;
+    while (reader.Read(&result, nullptr, &seq) == ShmRingReader::Status::OK) {
+      // every message read is complete and in order
+      ASSERT_GT(seq, last_seq);
+      ASSERT_EQ(result, std::string(static_cast<size_t>(seq % 48) + 8, static_cast<char>('a' + seq % 26)));
+      last_seq = seq;
+      ++read;
+    }
+    if (finished) break;
+  }
+  writer_thread.join();
+  EXPECT_EQ(last_seq, total);
+  EXPECT_EQ(read + reader.Dropped(), total);
+}
+
+TEST(ShmSink, OpenClose) {
+  ShmSink module("shm_sink");
+  ModuleParamSet params;
+  params["shm_name"] = TestShmName();
+  EXPECT_TRUE(module.CheckParamSet(params));
+  EXPECT_TRUE(module.Open(params));
+  module.Close();
+
+  params["slot_count"] = "0";
+  EXPECT_FALSE(module.Open(params));
+  params["slot_count"] = "16";
+  params["slot_size"] = "-1";
+  EXPECT_FALSE(module.Open(params));
+  params["slot_size"] = "64";
+  params["thumbnail_quality"] = "101";
+  EXPECT_FALSE(module.Open(params));
+  params["thumbnail_quality"] = "90";
+  params["with_features"] = "yes";
+  EXPECT_FALSE(module.Open(params));
+  params["with_features"] = "true";
+  params["thumbnail_width"] = "320";
+  EXPECT_TRUE(module.Open(params));
+  module.Close();
+}
+
+TEST(ShmSink, Process) {
+  ShmSink module("shm_sink");
+  ModuleParamSet params;
+  params["shm_name"] = TestShmName();
+  params["with_features"] = "true";
+  ASSERT_TRUE(module.Open(params));
+  ShmRingReader reader;
+  ASSERT_TRUE(reader.Attach(TestShmName()));
+
+  auto data = CNFrameInfo::Create("stream_0");
+  auto objs_holder = std::make_shared<CNInferObjs>();
+  auto obj = std::make_shared<CNInferObject>();
+  obj->id = "1";
+  obj->track_id = "7";
+  obj->AddFeature("reid", CNInferFeature{0.5f, 1.5f});
+  objs_holder->objs_.push_back(obj);
+  data->collection.Add(kCNInferObjsTag, objs_holder);
+  EXPECT_EQ(module.Process(data), 0);
+  // eos is not published
+  EXPECT_EQ(module.Process(CNFrameInfo::Create("stream_0", true)), 0);
+
+  std::string result;
+  ASSERT_EQ(reader.Read(&result), ShmRingReader::Status::OK);
+  InferObjsCodec::Frame frame;
+  ASSERT_TRUE(InferObjsCodec::Decode(result.data(), result.size(), &frame));
+  EXPECT_EQ(frame.stream_id, "stream_0");
+  ASSERT_EQ(frame.objs.size(), 1u);
+  EXPECT_EQ(frame.objs[0]->track_id, "7");
+  EXPECT_EQ(frame.objs[0]->GetFeature("reid"), obj->GetFeature("reid"));
+  EXPECT_EQ(reader.Read(&result), ShmRingReader::Status::EMPTY);
+  module.Close();
+}
+
+}  // namespace cnstream
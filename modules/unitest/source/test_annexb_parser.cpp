@@ -0,0 +1,136 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "test_base.hpp"
+#include "util/annexb_parser.hpp"
+
+namespace cnstream {
+
+static constexpr const char *gh264_path = "../../modules/unitest/source/data/raw.h264";
+static constexpr const char *gh265_path = "../../modules/unitest/source/data/raw.h265";
+
+struct AccessUnitCollector {
+  void operator()(const AnnexBParser::AccessUnit &au) {
+    data.insert(data.end(), au.data, au.data + au.len);
+    lens.push_back(au.len);
+    pts.push_back(au.pts);
+    keys.push_back(au.key_frame);
+  }
+  std::vector<uint8_t> data;
+  std::vector<size_t> lens;
+  std::vector<int64_t> pts;
+  std::vector<bool> keys;
+};
+
+static std::vector<uint8_t> ReadFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// parses the file in chunks of chunk_size bytes, the whole file at once if chunk_size is 0
+static AccessUnitCollector ParseFile(AVCodecID codec_id, const std::vector<uint8_t> &data, size_t chunk_size) {
+  AccessUnitCollector collector;
+  auto func = [&collector](const AnnexBParser::AccessUnit &au) { collector(au); };
+  AnnexBParser parser;
+  EXPECT_TRUE(parser.Open(codec_id));
+  if (!chunk_size) chunk_size = data.size();
+  for (size_t pos = 0; pos < data.size(); pos += chunk_size) {
+    parser.Parse(data.data() + pos, std::min(chunk_size, data.size() - pos), 0, func);
+  }
+  parser.Flush(func);
+  return collector;
+}
+
+TEST(SourceAnnexBParser, FindStartCode) {
+  std::vector<uint8_t> data = {0, 0, 1, 0x65};
+  EXPECT_EQ(AnnexBParser::FindStartCode(data.data(), data.data() + data.size()), data.data());
+  data = {1, 0, 0, 1, 0x65};
+  EXPECT_EQ(AnnexBParser::FindStartCode(data.data(), data.data() + data.size()), data.data() + 1);
+  data = {0x65, 1, 1, 0, 0, 0, 1};
+  EXPECT_EQ(AnnexBParser::FindStartCode(data.data(), data.data() + data.size()), data.data() + 4);
+  data = {0, 1, 0, 0, 2, 0, 0};
+  EXPECT_EQ(AnnexBParser::FindStartCode(data.data(), data.data() + data.size()), data.data() + data.size());
+  EXPECT_EQ(AnnexBParser::FindStartCode(data.data(), data.data() + 2), data.data() + 2);
+}
+
+TEST(SourceAnnexBParser, Unsupported) {
+  AnnexBParser parser;
+  EXPECT_FALSE(parser.Open(AV_CODEC_ID_MJPEG));
+  EXPECT_TRUE(parser.Open(AV_CODEC_ID_H264));
+  EXPECT_TRUE(parser.Open(AV_CODEC_ID_HEVC));
+}
+
+TEST(SourceAnnexBParser, SplitFiles) {
+  for (auto codec_id : {AV_CODEC_ID_H264, AV_CODEC_ID_HEVC}) {
+    std::vector<uint8_t> data = ReadFile(GetExePath() + (codec_id == AV_CODEC_ID_H264 ? gh264_path : gh265_path));
+    ASSERT_FALSE(data.empty());
+    AccessUnitCollector whole = ParseFile(codec_id, data, 0);
+    ASSERT_EQ(whole.lens.size(), 5u);
+    EXPECT_TRUE(whole.keys[0]);
+    EXPECT_FALSE(whole.keys[4]);
+    EXPECT_EQ(whole.data, data);
+    // the start codes split between chunks
+    for (size_t chunk_size : {1, 7, 100, 4096}) {
+      AccessUnitCollector chunks = ParseFile(codec_id, data, chunk_size);
+      EXPECT_EQ(chunks.lens, whole.lens);
+      EXPECT_EQ(chunks.keys, whole.keys);
+      EXPECT_EQ(chunks.data, data);
+    }
+  }
+}
+
+TEST(SourceAnnexBParser, OneAccessUnitPerChunk) {
+  const std::vector<uint8_t> padding(16, 0xff);
+  // sps with frame_mbs_only_flag 0, pps and an idr slice
+  std::vector<uint8_t> idr = {0, 0, 0, 1, 0x67, 0x42, 0xc0, 0x1e, 0xf4, 0x0a, 0x0f, 0x24,
+                              0, 0, 0, 1, 0x68, 0xce, 0x38, 0x80,
+                              0, 0, 0, 1, 0x65, 0x88};
+  idr.insert(idr.end(), padding.begin(), padding.end());
+  // p slice, first_mb_in_slice 0
+  std::vector<uint8_t> p = {0, 0, 0, 1, 0x41, 0x9a};
+  p.insert(p.end(), padding.begin(), padding.end());
+
+  AccessUnitCollector collector;
+  auto func = [&collector](const AnnexBParser::AccessUnit &au) { collector(au); };
+  AnnexBParser parser;
+  ASSERT_TRUE(parser.Open(AV_CODEC_ID_H264));
+  parser.Parse(idr.data(), idr.size(), 0, func);
+  // the access unit ends when the next one begins
+  EXPECT_TRUE(collector.lens.empty());
+  parser.Parse(p.data(), p.size(), 1, func);
+  parser.Parse(p.data(), p.size(), 2, func);
+  ASSERT_EQ(collector.lens.size(), 2u);
+  EXPECT_EQ(collector.lens[0], idr.size());
+  parser.Flush(func);
+  ASSERT_EQ(collector.lens.size(), 3u);
+  EXPECT_EQ(collector.pts, std::vector<int64_t>({0, 1, 2}));
+  EXPECT_EQ(collector.keys, std::vector<bool>({true, false, false}));
+  EXPECT_FALSE(parser.Progressive());
+}
+
+}  // namespace cnstream
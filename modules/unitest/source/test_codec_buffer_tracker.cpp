@@ -0,0 +1,63 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "data_handler_util.hpp"
+
+namespace cnstream {
+
+TEST(SourceCodecBufferTracker, CopyOutWhenBuffersRunLow) {
+  CodecBufferTracker tracker(3);
+  // one buffer is reserved for the codec
+  EXPECT_TRUE(tracker.Acquire());
+  EXPECT_TRUE(tracker.Acquire());
+  EXPECT_FALSE(tracker.Acquire());
+  CodecBufferStats stats = tracker.GetStats();
+  EXPECT_EQ(stats.in_flight, 2u);
+  EXPECT_EQ(stats.peak_in_flight, 2u);
+  EXPECT_EQ(stats.zero_copy_num, 2u);
+  EXPECT_EQ(stats.copy_out_num, 1u);
+  tracker.Release(10);
+  EXPECT_TRUE(tracker.Acquire());
+  EXPECT_EQ(tracker.GetStats().zero_copy_num, 3u);
+}
+
+TEST(SourceCodecBufferTracker, HoldTime) {
+  CodecBufferTracker tracker(4, 1, 100);
+  EXPECT_TRUE(tracker.Acquire());
+  EXPECT_TRUE(tracker.Acquire());
+  tracker.Release(10);
+  tracker.Release(200);
+  CodecBufferStats stats = tracker.GetStats();
+  EXPECT_EQ(stats.in_flight, 0u);
+  EXPECT_DOUBLE_EQ(stats.avg_hold_ms, 105);
+  EXPECT_DOUBLE_EQ(stats.max_hold_ms, 200);
+  EXPECT_EQ(stats.late_release_num, 1u);
+}
+
+TEST(SourceCodecBufferTracker, SingleBuffer) {
+  // the only buffer is never held by frames
+  CodecBufferTracker tracker(1);
+  EXPECT_FALSE(tracker.Acquire());
+  EXPECT_EQ(tracker.GetStats().in_flight, 0u);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,166 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "util/decode_worker_pool.hpp"
+
+namespace cnstream {
+
+TEST(SourceDecodeWorkerPool, KeepOrderPerJob) {
+  DecodeWorkerPool pool(4);
+  EXPECT_TRUE(pool.Start());
+  EXPECT_FALSE(pool.Start());
+  constexpr int job_num = 16;
+  constexpr int step_num = 200;
+  std::vector<std::vector<int>> outputs(job_num);
+  std::vector<std::unique_ptr<std::atomic<bool>>> in_step;
+  std::atomic<bool> overlapped{false};
+  std::vector<uint64_t> job_ids;
+  for (int i = 0; i < job_num; ++i) {
+    in_step.emplace_back(new std::atomic<bool>(false));
+    std::atomic<bool> *flag = in_step.back().get();
+    std::vector<int> *output = &outputs[i];
+    job_ids.push_back(pool.Submit([=, &overlapped](uint32_t *idle_us) {
+      if (flag->exchange(true)) overlapped = true;
+      output->push_back(output->size());
+      flag->store(false);
+      return static_cast<int>(output->size()) < step_num;
+    }));
+    EXPECT_GT(job_ids.back(), 0u);
+  }
+  for (auto id : job_ids) pool.Wait(id);
+  EXPECT_EQ(0u, pool.GetJobNum());
+  EXPECT_FALSE(overlapped.load());
+  for (auto &output : outputs) {
+    ASSERT_EQ(step_num, static_cast<int>(output.size()));
+    for (int i = 0; i < step_num; ++i) EXPECT_EQ(i, output[i]);
+  }
+  pool.Stop();
+  EXPECT_FALSE(pool.IsRunning());
+  EXPECT_EQ(0u, pool.Submit([](uint32_t *) { return false; }));
+}
+
+TEST(SourceDecodeWorkerPool, IdleJobsDoNotHoldThreads) {
+  // one thread serves a job that is idle most of the time and a busy one
+  DecodeWorkerPool pool(1);
+  ASSERT_TRUE(pool.Start());
+  std::atomic<int> idle_steps{0}, busy_steps{0};
+  uint64_t idle_job = pool.Submit([&](uint32_t *idle_us) {
+    *idle_us = 20 * 1000;
+    return ++idle_steps < 5;
+  });
+  uint64_t busy_job = pool.Submit([&](uint32_t *idle_us) { return ++busy_steps < 1000; });
+  pool.Wait(busy_job);
+  EXPECT_EQ(1000, busy_steps.load());
+  EXPECT_LT(idle_steps.load(), 5);
+  auto start = std::chrono::steady_clock::now();
+  pool.Wait(idle_job);
+  auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  EXPECT_EQ(5, idle_steps.load());
+  EXPECT_GE(cost.count(), 20);
+}
+
+TEST(SourceDecodeWorkerPool, ServeHigherPriorityFirst) {
+  DecodeWorkerPool pool(1);
+  ASSERT_TRUE(pool.Start());
+  std::promise<void> submitted;
+  std::shared_future<void> submitted_future = submitted.get_future().share();
+  // holds the worker until the other jobs are submitted
+  pool.Submit([&](uint32_t *) {
+    submitted_future.wait();
+    return false;
+  }, 0);
+  std::vector<int> order;  // only touched by the worker
+  uint64_t low_job = pool.Submit([&](uint32_t *) {
+    order.push_back(2);
+    return false;
+  }, 2);
+  pool.Submit([&](uint32_t *) {
+    order.push_back(1);
+    return false;
+  });
+  // moves itself to the lowest class after the first step
+  int steps = 0;
+  uint64_t high_job = pool.Submit([&](uint32_t *) {
+    order.push_back(0);
+    DecodeWorkerPool::SetCurrentPriority(2);
+    return ++steps < 2;
+  }, 0);
+  submitted.set_value();
+  pool.Wait(low_job);
+  pool.Wait(high_job);
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 0}), order);
+}
+
+TEST(SourceDecodeWorkerPool, Pressure) {
+  DecodeWorkerPool pool(1);
+  ASSERT_TRUE(pool.Start());
+  EXPECT_FALSE(pool.IsUnderPressure());
+  pool.SetPressureThreshold(1000);
+  // two busy jobs on one thread, each waits for the other's step
+  std::atomic<bool> under_pressure{false};
+  auto step = [&](uint32_t *) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    if (pool.IsUnderPressure()) under_pressure.store(true);
+    return !under_pressure.load();
+  };
+  uint64_t job1 = pool.Submit(step);
+  uint64_t job2 = pool.Submit(step);
+  pool.Wait(job1);
+  pool.Wait(job2);
+  EXPECT_TRUE(under_pressure.load());
+  EXPECT_GT(pool.GetAverageWaitUs(), 1000u);
+  pool.SetPressureThreshold(0);
+  EXPECT_FALSE(pool.IsUnderPressure());
+}
+
+TEST(SourceDecodeWorkerPool, ThreadInitAndStop) {
+  std::atomic<int> init_cnt{0}, release_cnt{0};
+  DecodeWorkerPool pool(3, [&]() {
+    init_cnt++;
+    return std::shared_ptr<void>(nullptr, [&](void *) { release_cnt++; });
+  });
+  EXPECT_EQ(3u, pool.GetThreadNum());
+  ASSERT_TRUE(pool.Start());
+  // never finishes by itself
+  uint64_t job = pool.Submit([](uint32_t *idle_us) {
+    *idle_us = 1000;
+    return true;
+  });
+  std::thread waiter([&] { pool.Wait(job); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(1u, pool.GetJobNum());
+  pool.Stop();
+  waiter.join();
+  EXPECT_EQ(3, init_cnt.load());
+  EXPECT_EQ(3, release_cnt.load());
+  EXPECT_EQ(0u, pool.GetJobNum());
+}
+
+}  // namespace cnstream
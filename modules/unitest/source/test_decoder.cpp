@@ -24,6 +24,7 @@
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "cnrt.h"
 #include "cnstream_source.hpp"
@@ -165,6 +166,42 @@ TEST(SourceCpuFFmpegDecoder, Process) {
   env.ffmpeg_cpu_decoder->Destroy();
 }
 
+TEST(SourceCpuFFmpegDecoder, ThreadBudget) {
+  DecodeThreadBudget budget(4);
+  EXPECT_EQ(budget.GetTotal(), 4);
+  int first = budget.Acquire();
+  EXPECT_EQ(first, 4);
+  // used up, one thread at least
+  EXPECT_EQ(budget.Acquire(), 1);
+  budget.Release(first);
+  EXPECT_EQ(budget.Acquire(), 2);
+
+  budget.SetTotal(0);
+  EXPECT_GE(budget.GetTotal(), 1);
+}
+
+TEST(SourceCpuFFmpegDecoder, MotionActivity) {
+  const int width = 64, height = 32;
+  std::vector<AVMotionVector> mvs(8);
+  for (size_t i = 0; i < mvs.size(); ++i) {
+    AVMotionVector &mv = mvs[i];
+    mv.source = -1;
+    mv.w = mv.h = 16;
+    mv.dst_x = mv.src_x = (i % 4) * 16 + 8;
+    mv.dst_y = mv.src_y = (i / 4) * 16 + 8;
+  }
+  EXPECT_FLOAT_EQ(MotionActivity(mvs.data(), mvs.size(), width, height), 0);
+  // a moved block
+  mvs[0].src_x += 2;
+  EXPECT_FLOAT_EQ(MotionActivity(mvs.data(), mvs.size(), width, height), 0.125f);
+  // blocks predicted from future frames are not counted, the area not covered is active
+  mvs[1].source = 1;
+  EXPECT_FLOAT_EQ(MotionActivity(mvs.data(), mvs.size(), width, height), 0.25f);
+  EXPECT_FLOAT_EQ(MotionActivity(mvs.data(), 4, width, height), 0.75f);
+  EXPECT_FLOAT_EQ(MotionActivity(nullptr, 0, width, height), 1);
+  EXPECT_FLOAT_EQ(MotionActivity(nullptr, 0, 0, 0), -1);
+}
+
 // Mlu Mem Decoder
 TEST(SourceMluDecoder, CreateDestroy) {
   PrepareEnvMem env;
@@ -20,10 +20,12 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "cnrt.h"
 #include "cnstream_source.hpp"
@@ -58,29 +60,89 @@ TEST(SourceFrController, Control) {
   auto start = std::chrono::steady_clock::now();
   fr_controller.Start();
 
+  // deadlines are absolute, the n-th frame is sent n frame intervals after start at the earliest
   std::chrono::duration<double, std::milli> diff;
   uint32_t loop_num = 10;
-  while (loop_num--) {
+  for (uint32_t i = 1; i <= loop_num; ++i) {
     fr_controller.Control();
-    auto end = std::chrono::steady_clock::now();
-    diff = end - start;
-
-    EXPECT_TRUE(diff.count() >= static_cast<double>(1000) / static_cast<double>(frame_rate));
-    start = end;
+    diff = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(diff.count(), static_cast<double>(1000) * i / static_cast<double>(frame_rate));
   }
 
   // reset frame rate to 30
   frame_rate = 30;
   fr_controller.SetFrameRate(frame_rate);
+  start = std::chrono::steady_clock::now();
 
   loop_num = 20;
-  while (loop_num--) {
+  for (uint32_t i = 1; i <= loop_num; ++i) {
     fr_controller.Control();
-    auto end = std::chrono::steady_clock::now();
-    diff = end - start;
-    EXPECT_TRUE(diff.count() >= static_cast<double>(1000) / static_cast<double>(frame_rate));
-    start = end;
+    diff = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(diff.count(), static_cast<double>(1000) * i / static_cast<double>(frame_rate));
+  }
+}
+
+TEST(SourceFrController, NoDrift) {
+  // 100 fps, the wakeup overshoots do not add up
+  FrController fr_controller(100);
+  auto start = std::chrono::steady_clock::now();
+  fr_controller.Start();
+  for (int i = 0; i < 50; ++i) fr_controller.Control();
+  std::chrono::duration<double, std::milli> diff = std::chrono::steady_clock::now() - start;
+  EXPECT_GE(diff.count(), 500);
+  EXPECT_LT(diff.count(), 525);
+}
+
+TEST(SourceFrController, Resync) {
+  // 20 fps, one frame every 50ms
+  FrController fr_controller(20);
+  fr_controller.Start();
+  // blocked for more than kMaxLagFrames frames, the frames are not burst out to catch up
+  std::this_thread::sleep_for(std::chrono::milliseconds(50 * (FrController::kMaxLagFrames + 2)));
+  EXPECT_EQ(0, fr_controller.NextDelay().count());
+  EXPECT_GT(fr_controller.NextDelay().count(), 40 * 1000);
+}
+
+TEST(SourceFramePacer, WaitUntil) {
+  auto start = std::chrono::steady_clock::now();
+  FramePacer::Instance().WaitUntil(start - std::chrono::milliseconds(1));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(5));
+
+  // streams are released by one timer
+  std::vector<std::thread> threads;
+  std::atomic<int> early{0};
+  for (int i = 0; i < 16; ++i) {
+    threads.emplace_back([&, i] {
+      auto deadline = start + std::chrono::milliseconds(20 + i);
+      FramePacer::Instance().WaitUntil(deadline);
+      if (std::chrono::steady_clock::now() < deadline) early++;
+    });
   }
+  for (auto &th : threads) th.join();
+  EXPECT_EQ(0, early.load());
+}
+
+TEST(SourceFrController, NextDelay) {
+  FrController fr_controller(0);
+  EXPECT_EQ(0, fr_controller.NextDelay().count());
+
+  // 20 fps, one frame every 50ms
+  fr_controller.SetFrameRate(20);
+  fr_controller.Start();
+  auto delay = fr_controller.NextDelay();
+  EXPECT_GT(delay.count(), 40 * 1000);
+  EXPECT_LE(delay.count(), 50 * 1000);
+
+  // the caller waits for the delay itself, the next frame is due 50ms later
+  std::this_thread::sleep_for(delay);
+  delay = fr_controller.NextDelay();
+  EXPECT_GT(delay.count(), 40 * 1000);
+  EXPECT_LE(delay.count(), 50 * 1000);
+
+  // late by more than one frame, no delay and the gap is made up by the next frame
+  std::this_thread::sleep_for(delay + std::chrono::milliseconds(60));
+  EXPECT_EQ(0, fr_controller.NextDelay().count());
+  EXPECT_LT(fr_controller.NextDelay().count(), 50 * 1000);
 }
 
 }  // namespace cnstream
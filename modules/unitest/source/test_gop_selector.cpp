@@ -0,0 +1,85 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "util/gop_selector.hpp"
+
+namespace cnstream {
+
+// 4 gops of 5 frames, the first frame of each gop is a key frame
+static std::vector<bool> KeptFrames(GopSelector *selector) {
+  std::vector<bool> kept;
+  for (int gop = 0; gop < 4; ++gop) {
+    for (int i = 0; i < 5; ++i) kept.push_back(selector->Keep(i == 0));
+  }
+  return kept;
+}
+
+static int CountKept(const std::vector<bool> &kept) {
+  int cnt = 0;
+  for (bool k : kept) cnt += k;
+  return cnt;
+}
+
+TEST(SourceGopSelector, PassThrough) {
+  GopSelector selector;
+  EXPECT_TRUE(selector.IsPassThrough());
+  EXPECT_EQ(20, CountKept(KeptFrames(&selector)));
+  // gop_interval 0 is taken as 1
+  GopSelector zero(false, 0);
+  EXPECT_TRUE(zero.IsPassThrough());
+}
+
+TEST(SourceGopSelector, OnlyKeyFrame) {
+  GopSelector selector(true, 1);
+  EXPECT_FALSE(selector.IsPassThrough());
+  auto kept = KeptFrames(&selector);
+  EXPECT_EQ(4, CountKept(kept));
+  for (size_t i = 0; i < kept.size(); ++i) EXPECT_EQ(i % 5 == 0, kept[i]);
+}
+
+TEST(SourceGopSelector, GopInterval) {
+  GopSelector selector(false, 2);
+  auto kept = KeptFrames(&selector);
+  EXPECT_EQ(10, CountKept(kept));
+  // the whole first and third gops are kept
+  for (size_t i = 0; i < kept.size(); ++i) EXPECT_EQ((i / 5) % 2 == 0, kept[i]);
+
+  GopSelector key_only(true, 3);
+  kept = KeptFrames(&key_only);
+  EXPECT_EQ(2, CountKept(kept));
+  EXPECT_TRUE(kept[0]);
+  EXPECT_TRUE(kept[15]);
+}
+
+TEST(SourceGopSelector, WaitForFirstKeyFrame) {
+  GopSelector selector(false, 2);
+  EXPECT_FALSE(selector.Keep(false));
+  EXPECT_TRUE(selector.Keep(true));
+  EXPECT_TRUE(selector.Keep(false));
+  selector.Reset();
+  EXPECT_FALSE(selector.Keep(false));
+  EXPECT_TRUE(selector.Keep(true));
+}
+
+}  // namespace cnstream
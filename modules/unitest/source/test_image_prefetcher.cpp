@@ -0,0 +1,119 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "util/image_prefetcher.hpp"
+
+namespace cnstream {
+
+class SourceImagePrefetcher : public testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/cnstream_image_prefetcher_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+    // the images hold their indices
+    for (int i = 0; i < kImageNum; ++i) {
+      char name[32];
+      snprintf(name, sizeof(name), "/%03d.jpg", i);
+      files_.push_back(dir_ + name);
+      std::ofstream(files_.back()) << i;
+    }
+    std::ofstream(dir_ + "/readme.txt") << "not an image";
+  }
+  void TearDown() override {
+    for (const auto &file : files_) remove(file.c_str());
+    remove((dir_ + "/readme.txt").c_str());
+    remove((dir_ + "/files.list").c_str());
+    rmdir(dir_.c_str());
+  }
+
+  static constexpr int kImageNum = 50;
+  std::string dir_;
+  std::vector<std::string> files_;
+};
+
+TEST_F(SourceImagePrefetcher, ListImageFiles) {
+  std::vector<std::string> files;
+  EXPECT_TRUE(ListImageFiles(dir_, &files));
+  EXPECT_EQ(files, files_);
+
+  std::ofstream list(dir_ + "/files.list");
+  list << "# images\n" << files_[1] << "\n\n" << files_[0] << " \n";
+  list.close();
+  files.clear();
+  EXPECT_TRUE(ListImageFiles(dir_ + "/files.list", &files));
+  EXPECT_EQ(files, std::vector<std::string>({files_[1], files_[0]}));
+
+  EXPECT_FALSE(ListImageFiles(dir_ + "/not_exist", &files));
+}
+
+TEST_F(SourceImagePrefetcher, PopInOrder) {
+  std::vector<std::string> files = files_;
+  files[10] = dir_ + "/not_exist.jpg";
+  ImagePrefetcher prefetcher(files, 4, 8, false);
+  // not started
+  EXPECT_TRUE(prefetcher.PopBatch(4).empty());
+  ASSERT_TRUE(prefetcher.Start());
+  uint64_t seq = 0;
+  while (true) {
+    auto images = prefetcher.PopBatch(3);
+    if (images.empty()) break;
+    EXPECT_LE(images.size(), 3u);
+    for (const auto &image : images) {
+      EXPECT_EQ(image.seq, seq);
+      EXPECT_EQ(image.path, files[seq]);
+      EXPECT_EQ(image.ok, seq != 10);
+      if (image.ok) {
+        EXPECT_EQ(std::string(image.data.begin(), image.data.end()), std::to_string(seq));
+      }
+      ++seq;
+    }
+  }
+  EXPECT_EQ(seq, static_cast<uint64_t>(kImageNum));
+  EXPECT_GT(prefetcher.GetReadBytes(), 0u);
+  prefetcher.Stop();
+}
+
+TEST_F(SourceImagePrefetcher, LoopAndStop) {
+  ImagePrefetcher prefetcher(files_, 2, 4, true);
+  ASSERT_TRUE(prefetcher.Start());
+  uint64_t seq = 0;
+  while (seq < 3 * kImageNum) {
+    auto images = prefetcher.PopBatch(8);
+    ASSERT_FALSE(images.empty());
+    for (const auto &image : images) {
+      EXPECT_EQ(image.seq, seq);
+      EXPECT_EQ(image.path, files_[seq % kImageNum]);
+      ++seq;
+    }
+  }
+  prefetcher.Stop();
+  EXPECT_TRUE(prefetcher.PopBatch(8).empty());
+}
+
+}  // namespace cnstream
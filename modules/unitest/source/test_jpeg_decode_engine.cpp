@@ -0,0 +1,198 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "util/jpeg_decode_engine.hpp"
+
+namespace cnstream {
+
+// decodes the index written in the image, the images starting with 0xff are broken
+class FakeJpegDecoder : public Decoder {
+ public:
+  explicit FakeJpegDecoder(IDecodeResult *cb) : Decoder("fake_jpeg", cb) {}
+  bool Create(VideoInfo *info, ExtraDecoderInfo *extra = nullptr) override { return true; }
+  bool Process(VideoEsPacket *pkt) override {
+    if (!pkt || !pkt->data) return true;
+    std::this_thread::sleep_for(std::chrono::microseconds(pkt->data[1] * 10));
+    DecodeFrame frame;
+    frame.valid = pkt->data[0] != 0xff;
+    frame.pts = frame.valid ? pkt->pts : -100;  // broken images are reported without pts
+    frame.width = pkt->data[1];
+    result_->OnDecodeFrame(&frame);
+    return true;
+  }
+  void Destroy() override {}
+};
+
+class JpegResult : public IJpegDecodeResult {
+ public:
+  explicit JpegResult(const std::string &stream_id) : stream_id_(stream_id) {}
+  std::shared_ptr<CNFrameInfo> OnJpegDecoded(DecodeFrame *frame, int64_t pts, uint64_t seq) override {
+    EXPECT_EQ(frame->width, static_cast<int32_t>(seq % 200));
+    if (!frame->valid) {
+      broken_num++;
+      return nullptr;
+    }
+    std::shared_ptr<CNFrameInfo> data = CNFrameInfo::Create(stream_id_);
+    data->timestamp = pts;
+    return data;
+  }
+  void OnJpegOutput(std::shared_ptr<CNFrameInfo> data) override {
+    EXPECT_FALSE(eos);
+    pts.push_back(data->timestamp);
+  }
+  void OnJpegEos() override { eos = true; }
+
+  std::string stream_id_;
+  std::atomic<int> broken_num{0};
+  std::vector<int64_t> pts;
+  bool eos = false;
+};
+
+static JpegDecodeEngine::DecoderCreator FakeCreator() {
+  return [](IDecodeResult *result) { return std::make_shared<FakeJpegDecoder>(result); };
+}
+
+TEST(SourceJpegDecodeEngine, StartStop) {
+  JpegDecodeEngine engine(2, 4, FakeCreator());
+  EXPECT_EQ(engine.GetLaneNum(), 2u);
+  EXPECT_EQ(engine.GetBatchSize(), 4u);
+  JpegResult result("stream");
+  auto stream = engine.Attach(&result);
+  ASSERT_NE(stream, nullptr);
+  uint8_t image[2] = {0, 0};
+  // not running
+  EXPECT_FALSE(engine.Submit(stream, image, sizeof(image), 0));
+  EXPECT_TRUE(engine.Start());
+  EXPECT_TRUE(engine.IsRunning());
+  EXPECT_FALSE(engine.Start());
+  EXPECT_TRUE(engine.Submit(stream, image, sizeof(image), 0));
+  EXPECT_TRUE(engine.SubmitEos(stream));
+  EXPECT_FALSE(engine.SubmitEos(stream));
+  EXPECT_FALSE(engine.Submit(stream, image, sizeof(image), 1));
+  engine.Detach(stream);
+  EXPECT_TRUE(result.eos);
+  EXPECT_EQ(result.pts.size(), 1u);
+  engine.Stop();
+  EXPECT_FALSE(engine.IsRunning());
+
+  // no lanes or no decoder creator
+  EXPECT_FALSE(JpegDecodeEngine(0, 4, FakeCreator()).Start());
+  EXPECT_FALSE(JpegDecodeEngine(2, 4, nullptr).Start());
+}
+
+TEST(SourceJpegDecodeEngine, OrderedOutputs) {
+  const int stream_num = 4, image_num = 200;
+  JpegDecodeEngine engine(3, 4, FakeCreator());
+  ASSERT_TRUE(engine.Start());
+  std::vector<std::unique_ptr<JpegResult>> results;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < stream_num; ++i) {
+    results.emplace_back(new JpegResult("stream" + std::to_string(i)));
+  }
+  for (int i = 0; i < stream_num; ++i) {
+    threads.emplace_back([&, i] {
+      auto stream = engine.Attach(results[i].get());
+      for (int n = 0; n < image_num; ++n) {
+        // every 10th image of stream 0 is broken
+        uint8_t image[2] = {static_cast<uint8_t>((i == 0 && n % 10 == 0) ? 0xff : 0), static_cast<uint8_t>(n)};
+        EXPECT_TRUE(engine.Submit(stream, image, sizeof(image), n));
+      }
+      EXPECT_TRUE(engine.SubmitEos(stream));
+      engine.Detach(stream);
+    });
+  }
+  for (auto &th : threads) th.join();
+  engine.Stop();
+
+  for (int i = 0; i < stream_num; ++i) {
+    JpegResult *result = results[i].get();
+    EXPECT_TRUE(result->eos);
+    std::vector<int64_t> expected;
+    for (int n = 0; n < image_num; ++n) {
+      if (i != 0 || n % 10 != 0) expected.push_back(n);
+    }
+    EXPECT_EQ(result->pts, expected);
+    EXPECT_EQ(result->broken_num.load(), i == 0 ? image_num / 10 : 0);
+  }
+}
+
+TEST(SourceJpegDecodeEngine, SubmitBatch) {
+  const int image_num = 50;
+  JpegDecodeEngine engine(2, 4, FakeCreator());
+  JpegResult result("stream");
+  auto stream = engine.Attach(&result);
+  std::vector<std::vector<uint8_t>> data;
+  std::vector<JpegDecodeEngine::Image> images;
+  for (int n = 0; n < image_num; ++n) data.push_back({0, static_cast<uint8_t>(n)});
+  for (int n = 0; n < image_num; ++n) {
+    JpegDecodeEngine::Image image;
+    image.data = data[n].data();
+    image.len = data[n].size();
+    image.pts = n;
+    images.push_back(image);
+  }
+  // not running
+  EXPECT_EQ(engine.SubmitBatch(stream, images), 0u);
+  ASSERT_TRUE(engine.Start());
+  // more images than the submission queue holds
+  EXPECT_EQ(engine.SubmitBatch(stream, images), static_cast<size_t>(image_num));
+  // the images after an empty one are not submitted
+  std::vector<JpegDecodeEngine::Image> broken(2);
+  broken[1] = images[0];
+  EXPECT_EQ(engine.SubmitBatch(stream, broken), 0u);
+  EXPECT_TRUE(engine.SubmitEos(stream));
+  EXPECT_EQ(engine.SubmitBatch(stream, images), 0u);
+  engine.Detach(stream);
+  engine.Stop();
+  EXPECT_TRUE(result.eos);
+  std::vector<int64_t> expected;
+  for (int n = 0; n < image_num; ++n) expected.push_back(n);
+  EXPECT_EQ(result.pts, expected);
+}
+
+TEST(SourceJpegDecodeEngine, StopWithPendingImages) {
+  JpegDecodeEngine engine(1, 2, FakeCreator());
+  ASSERT_TRUE(engine.Start());
+  JpegResult result("stream");
+  auto stream = engine.Attach(&result);
+  for (int n = 0; n < 4; ++n) {
+    uint8_t image[2] = {0, static_cast<uint8_t>(n)};
+    EXPECT_TRUE(engine.Submit(stream, image, sizeof(image), n));
+  }
+  EXPECT_TRUE(engine.SubmitEos(stream));
+  // the images which are not decoded are dropped, the eos is still output
+  engine.Stop();
+  engine.Detach(stream);
+  EXPECT_TRUE(result.eos);
+  EXPECT_LE(result.pts.size(), 4u);
+}
+
+}  // namespace cnstream
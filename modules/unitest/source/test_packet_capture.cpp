@@ -0,0 +1,121 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "util/packet_capture.hpp"
+
+namespace cnstream {
+
+static std::string CapturePath() { return "/tmp/packet_capture_test_" + std::to_string(getpid()) + ".cncap"; }
+
+static void WriteCapture(const std::string &path) {
+  VideoInfo info;
+  info.codec_id = AV_CODEC_ID_H264;
+  info.extra_data = {0, 0, 0, 1, 0x67, 0x42};
+  PacketCaptureWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  uint8_t data[4] = {0, 0, 1, 0x65};
+  // dropped before the info
+  EXPECT_FALSE(writer.Write(data, sizeof(data), 0, true));
+  writer.SetInfo(info);
+  for (int i = 0; i < 10; ++i) {
+    data[3] = static_cast<uint8_t>(i);
+    EXPECT_TRUE(writer.Write(data, sizeof(data), i * 3600, i % 5 == 0));
+  }
+  EXPECT_EQ(writer.GetPacketNum(), 10u);
+  writer.Close();
+}
+
+static void CheckCapture(const std::string &path) {
+  PacketCaptureReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  EXPECT_EQ(reader.GetCodecId(), AV_CODEC_ID_H264);
+  EXPECT_EQ(reader.GetExtraData(), std::vector<uint8_t>({0, 0, 0, 1, 0x67, 0x42}));
+  ASSERT_EQ(reader.GetIndex().size(), 2u);
+  CapturedPacket pkt;
+  int64_t last_arrival = 0;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(reader.Read(&pkt));
+    EXPECT_EQ(pkt.pts, i * 3600);
+    EXPECT_EQ(pkt.flags != 0, i % 5 == 0);
+    ASSERT_EQ(pkt.data.size(), 4u);
+    EXPECT_EQ(pkt.data[3], i);
+    EXPECT_GE(pkt.arrival_us, last_arrival);
+    last_arrival = pkt.arrival_us;
+  }
+  EXPECT_FALSE(reader.Read(&pkt));
+
+  ASSERT_TRUE(reader.Seek(1));
+  ASSERT_TRUE(reader.Read(&pkt));
+  EXPECT_EQ(pkt.pts, 5 * 3600);
+  EXPECT_EQ(pkt.arrival_us, reader.GetIndex()[1].arrival_us);
+  EXPECT_FALSE(reader.Seek(2));
+  reader.Rewind();
+  ASSERT_TRUE(reader.Read(&pkt));
+  EXPECT_EQ(pkt.pts, 0);
+}
+
+TEST(SourcePacketCapture, ReadWrite) {
+  const std::string path = CapturePath();
+  WriteCapture(path);
+  CheckCapture(path);
+  remove(path.c_str());
+}
+
+TEST(SourcePacketCapture, NotClosed) {
+  const std::string path = CapturePath();
+  WriteCapture(path);
+  // cuts the index and the tail off, as if the process was killed, the index is rebuilt
+  struct stat st;
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  ASSERT_EQ(truncate(path.c_str(), st.st_size - (4 + 2 * 16) - 16), 0);
+  CheckCapture(path);
+  // the packet cut short is dropped
+  FILE *file = fopen(path.c_str(), "ab");
+  ASSERT_NE(file, nullptr);
+  const char partial[10] = {0};
+  fwrite(partial, 1, sizeof(partial), file);
+  fclose(file);
+  CheckCapture(path);
+  remove(path.c_str());
+}
+
+TEST(SourcePacketCapture, InvalidFile) {
+  PacketCaptureReader reader;
+  EXPECT_FALSE(reader.Open("/path/to/nothing.cncap"));
+  const std::string path = CapturePath();
+  FILE *file = fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  fputs("not a capture", file);
+  fclose(file);
+  EXPECT_FALSE(reader.Open(path));
+  remove(path.c_str());
+  PacketCaptureWriter writer;
+  EXPECT_FALSE(writer.Open("/path/to/nothing.cncap"));
+}
+
+}  // namespace cnstream
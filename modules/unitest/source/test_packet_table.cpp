@@ -0,0 +1,103 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_base.hpp"
+#include "util/packet_table.hpp"
+
+namespace cnstream {
+
+static constexpr const char *gmp4_path = "../../modules/unitest/source/data/img.mp4";
+
+class PacketCollector : public IParserResult {
+ public:
+  void OnParserInfo(VideoInfo *info) override { info_num++; }
+  void OnParserFrame(VideoEsFrame *frame) override {
+    if (!frame) {
+      eos = true;
+      return;
+    }
+    pts.push_back(frame->pts);
+    key_frames += (frame->flags & AV_PKT_FLAG_KEY) ? 1 : 0;
+  }
+  int info_num = 0;
+  int key_frames = 0;
+  bool eos = false;
+  std::vector<int64_t> pts;
+};
+
+TEST(SourcePacketTable, NotRegularFile) {
+  EXPECT_EQ(PacketTableCache::Instance().Get("/path/to/nothing.mp4"), nullptr);
+  EXPECT_EQ(PacketTableCache::Instance().Get("/tmp"), nullptr);
+  EXPECT_EQ(PacketTableCache::Instance().Get("rtsp://127.0.0.1:1/live"), nullptr);
+}
+
+TEST(SourcePacketTable, Shared) {
+  std::string mp4_path = GetExePath() + gmp4_path;
+  std::shared_ptr<const PacketTable> table;
+  std::shared_ptr<const PacketTable> other;
+  std::thread th([&] { other = PacketTableCache::Instance().Get(mp4_path); });
+  table = PacketTableCache::Instance().Get(mp4_path);
+  th.join();
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(table, other);
+  EXPECT_FALSE(table->packets.empty());
+  EXPECT_TRUE(table->packets[0].flags & AV_PKT_FLAG_KEY);
+}
+
+TEST(SourcePacketTable, Replay) {
+  std::string mp4_path = GetExePath() + gmp4_path;
+  std::shared_ptr<const PacketTable> table = PacketTableCache::Instance().Get(mp4_path);
+  ASSERT_NE(table, nullptr);
+
+  // the same packets as FFParser
+  PacketCollector expected;
+  FFParser ff_parser("packet_table_test");
+  ASSERT_EQ(ff_parser.Open(mp4_path, &expected), 0);
+  while (ff_parser.Parse() >= 0) {}
+  ff_parser.Close();
+
+  PacketTableParser parser;
+  PacketCollector result;
+  EXPECT_EQ(parser.Open(nullptr, &result), -1);
+  ASSERT_EQ(parser.Open(table, &result), 0);
+  EXPECT_EQ(result.info_num, 1);
+  while (parser.Parse() >= 0) {}
+  EXPECT_TRUE(result.eos);
+  EXPECT_EQ(result.pts, expected.pts);
+  EXPECT_EQ(parser.Parse(), -1);
+
+  // loops by reopening, only the read position is reset
+  parser.Close();
+  PacketCollector only_key;
+  ASSERT_EQ(parser.Open(table, &only_key, true), 0);
+  while (parser.Parse() >= 0) {}
+  EXPECT_TRUE(only_key.eos);
+  EXPECT_EQ(only_key.pts.size(), static_cast<size_t>(expected.key_frames));
+  parser.Close();
+}
+
+}  // namespace cnstream
@@ -0,0 +1,166 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "util/rtsp_failover.hpp"
+
+namespace cnstream {
+
+struct FailoverOutput {
+  uint8_t data;
+  uint64_t pts;
+  bool key_frame;
+  bool preroll;
+};
+
+class SourceRtspFailover : public testing::Test {
+ protected:
+  using Clock = RtspFailover::Clock;
+  void SetUp() override { start_ = Clock::now(); }
+  RtspFailover::Output MakeOutput() {
+    return [this](const uint8_t *data, size_t size, uint64_t pts, bool key_frame, bool preroll) {
+      ASSERT_EQ(size, 1u);
+      outputs_.push_back({data[0], pts, key_frame, preroll});
+    };
+  }
+  // packet i of a 25 fps camera, it arrives at i * 40ms
+  void Push(RtspFailover *failover, int session, uint8_t i, uint64_t base_pts, bool key_frame,
+            int delay_ms = 0) {
+    failover->OnPacket(session, &i, 1, base_pts + i * 3600, key_frame,
+                       start_ + std::chrono::milliseconds(i * 40 + delay_ms));
+  }
+  Clock::time_point start_;
+  std::vector<FailoverOutput> outputs_;
+};
+
+TEST_F(SourceRtspFailover, ForwardActiveSession) {
+  RtspFailover failover(MakeOutput(), 2);
+  for (uint8_t i = 0; i < 10; ++i) {
+    Push(&failover, 0, i, 0, i % 5 == 0);
+    Push(&failover, 1, i, 90000, i % 5 == 0, 5);
+  }
+  ASSERT_EQ(outputs_.size(), 10u);
+  for (uint8_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(outputs_[i].data, i);
+    EXPECT_EQ(outputs_[i].pts, i * 3600u);
+    EXPECT_FALSE(outputs_[i].preroll);
+  }
+  EXPECT_EQ(failover.GetActiveSession(), 0);
+  EXPECT_EQ(failover.GetSwitchCount(), 0u);
+}
+
+TEST_F(SourceRtspFailover, SwitchOnDisconnect) {
+  RtspFailover failover(MakeOutput(), 2);
+  // the standby session receives the same packets slightly later, with its own pts base
+  for (uint8_t i = 0; i < 8; ++i) {
+    Push(&failover, 0, i, 0, i % 5 == 0);
+    Push(&failover, 1, i, 90000, i % 5 == 0, 5);
+  }
+  failover.OnDisconnected(0);
+  EXPECT_EQ(failover.GetActiveSession(), 1);
+  EXPECT_EQ(failover.GetSwitchCount(), 1u);
+  // the cached GOP starts from packet 5, all of them have been forwarded by session 0
+  ASSERT_EQ(outputs_.size(), 11u);
+  for (size_t i = 8; i < 11; ++i) {
+    EXPECT_EQ(outputs_[i].data, i - 3);
+    EXPECT_TRUE(outputs_[i].preroll);
+    EXPECT_LE(outputs_[i].pts, 7 * 3600u);
+  }
+  EXPECT_TRUE(outputs_[8].key_frame);
+  Push(&failover, 1, 8, 90000, false, 5);
+  ASSERT_EQ(outputs_.size(), 12u);
+  EXPECT_FALSE(outputs_.back().preroll);
+  EXPECT_EQ(outputs_.back().pts, 8 * 3600u);
+  // the old session becomes the standby one
+  Push(&failover, 0, 9, 0, false);
+  EXPECT_EQ(outputs_.size(), 12u);
+}
+
+TEST_F(SourceRtspFailover, SwitchOnStall) {
+  RtspFailover failover(MakeOutput(), 2, 300);
+  for (uint8_t i = 0; i < 6; ++i) {
+    Push(&failover, 0, i, 0, i % 5 == 0);
+    Push(&failover, 1, i, 90000, i % 5 == 0, 5);
+  }
+  // session 0 stops receiving, session 1 takes over when session 0 has been silent for 300ms
+  uint8_t i = 6;
+  for (; i < 20 && failover.GetActiveSession() == 0; ++i) {
+    Push(&failover, 1, i, 90000, false, 5);
+  }
+  EXPECT_EQ(failover.GetActiveSession(), 1);
+  EXPECT_LE((i - 1 - 5) * 40, 400);
+  // the packets session 0 did not receive are output, the pts go on
+  uint64_t last_pts = 0;
+  size_t new_cnt = 0;
+  for (size_t k = 6; k < outputs_.size(); ++k) {
+    if (outputs_[k].preroll) continue;
+    EXPECT_GT(outputs_[k].pts, last_pts);
+    last_pts = outputs_[k].pts;
+    EXPECT_EQ(outputs_[k].pts, outputs_[k].data * 3600u);
+    ++new_cnt;
+  }
+  EXPECT_EQ(new_cnt, static_cast<size_t>(i - 6));
+}
+
+TEST_F(SourceRtspFailover, RebaseAfterReconnect) {
+  RtspFailover failover(MakeOutput(), 1);
+  for (uint8_t i = 0; i < 5; ++i) Push(&failover, 0, i, 0, i == 0);
+  failover.OnDisconnected(0);
+  // the new connection starts from pts 0 again
+  uint8_t data = 5;
+  failover.OnPacket(0, &data, 1, 0, true, start_ + std::chrono::milliseconds(300));
+  ASSERT_EQ(outputs_.size(), 6u);
+  EXPECT_EQ(outputs_.back().pts, 5 * 3600u);
+  EXPECT_FALSE(failover.OnFinished(1));
+  EXPECT_TRUE(failover.OnFinished(0));
+}
+
+TEST_F(SourceRtspFailover, FinishedSessions) {
+  RtspFailover failover(MakeOutput(), 2);
+  Push(&failover, 0, 0, 0, true);
+  Push(&failover, 1, 0, 0, true, 5);
+  EXPECT_FALSE(failover.OnFinished(0));
+  EXPECT_EQ(failover.GetActiveSession(), 1);
+  EXPECT_TRUE(failover.OnFinished(1));
+}
+
+TEST(SourceGopCache, KeepLastGop) {
+  GopCache cache(4);
+  uint8_t data = 0;
+  auto now = std::chrono::steady_clock::now();
+  cache.Push(&data, 1, 0, false, now);
+  EXPECT_FALSE(cache.Valid());
+  cache.Push(&data, 1, 1, true, now);
+  cache.Push(&data, 1, 2, false, now);
+  EXPECT_EQ(cache.GetPackets().size(), 2u);
+  cache.Push(&data, 1, 3, true, now);
+  ASSERT_EQ(cache.GetPackets().size(), 1u);
+  EXPECT_EQ(cache.GetPackets()[0].pts, 3u);
+  // too long GOPs are dropped
+  for (int i = 0; i < 4; ++i) cache.Push(&data, 1, 4 + i, false, now);
+  EXPECT_FALSE(cache.Valid());
+}
+
+}  // namespace cnstream
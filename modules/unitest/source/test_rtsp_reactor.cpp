@@ -0,0 +1,98 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "util/rtsp_client.hpp"
+
+namespace cnstream {
+
+// nothing listens on port 1, the connection is refused at once
+static constexpr const char *gunreachable_url = "rtsp://127.0.0.1:1/unreachable";
+
+class RtspEosCounter : public IRtspCB {
+ public:
+  void OnRtspInfo(VideoInfo *info) override {}
+  void OnRtspFrame(VideoEsFrame *frame) override {
+    if (!frame) eos_cnt++;
+  }
+  void OnRtspEvent(int type) override {}
+  std::atomic<int> eos_cnt{0};
+};
+
+static OpenParam MakeReactorParam(IRtspCB *cb, int reconnect) {
+  OpenParam param;
+  param.url = gunreachable_url;
+  param.reconnect = reconnect;
+  param.cb = cb;
+  param.reactor_threads = 2;
+  return param;
+}
+
+TEST(SourceRtspReactor, SharedEventLoops) {
+  constexpr int session_num = 8;
+  std::vector<RtspEosCounter> cbs(session_num);
+  std::vector<std::unique_ptr<RtspSession>> sessions;
+  for (int i = 0; i < session_num; ++i) {
+    sessions.emplace_back(new RtspSession);
+    EXPECT_EQ(0, sessions.back()->Open(MakeReactorParam(&cbs[i], -1)));
+  }
+  EXPECT_EQ(2u, GetRtspReactorThreadNum());
+
+  auto all_done = [&cbs] {
+    for (auto &cb : cbs) {
+      if (cb.eos_cnt.load() == 0) return false;
+    }
+    return true;
+  };
+  for (int retry = 0; retry < 500 && !all_done(); ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  for (auto &session : sessions) {
+    session->Close();
+  }
+  // each failed session reports eos exactly once
+  for (auto &cb : cbs) {
+    EXPECT_EQ(1, cb.eos_cnt.load());
+  }
+}
+
+TEST(SourceRtspReactor, CloseWhileReconnecting) {
+  RtspEosCounter cb;
+  RtspSession session;
+  EXPECT_EQ(0, session.Open(MakeReactorParam(&cb, 100)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto start = std::chrono::steady_clock::now();
+  session.Close();
+  auto cost = std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(1, cb.eos_cnt.load());
+  // the reconnect delay must not block Close
+  EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(cost).count(), 1000);
+  session.Close();
+  EXPECT_EQ(1, cb.eos_cnt.load());
+}
+
+}  // namespace cnstream
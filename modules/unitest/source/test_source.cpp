@@ -22,6 +22,7 @@
 
 #include <chrono>
 #include <memory>
+#include <set>
 #include <string>
 #include <thread>
 #include <vector>
@@ -132,6 +133,80 @@ TEST(Source, OpenClose) {
   EXPECT_FALSE(src->Process(data));
 }
 
+TEST(Source, OutputResolution) {
+  std::shared_ptr<DataSource> src = std::make_shared<DataSource>(gname);
+  ModuleParamSet param;
+  param["output_type"] = "cpu";
+  param["decoder_type"] = "cpu";
+  uint32_t width = 0, height = 0;
+
+  // original resolution by default
+  EXPECT_TRUE(src->Open(param));
+  EXPECT_FALSE(src->GetOutputResolution(&width, &height));
+  src->Close();
+
+  param["output_resolution"] = "416x416";
+  EXPECT_TRUE(src->Open(param));
+  EXPECT_TRUE(src->GetOutputResolution(&width, &height));
+  EXPECT_EQ(width, 416u);
+  EXPECT_EQ(height, 416u);
+  src->Close();
+
+  // not in a pipeline, no next modules
+  param["output_resolution"] = "auto";
+  EXPECT_TRUE(src->Open(param));
+  EXPECT_FALSE(src->GetOutputResolution(&width, &height));
+  src->Close();
+
+  for (const char *res : {"416", "416x", "0x416", "416*416", "416x416x3", "-1x416", "foo"}) {
+    param["output_resolution"] = res;
+    EXPECT_FALSE(src->CheckParamSet(param)) << res;
+    EXPECT_FALSE(src->Open(param)) << res;
+  }
+}
+
+TEST(Source, CaptureParams) {
+  std::shared_ptr<DataSource> src = std::make_shared<DataSource>(gname);
+  ModuleParamSet param;
+  param["capture_dir"] = "/tmp";
+  param["capture_streams"] = "1, 2,,3";
+  EXPECT_TRUE(src->Open(param));
+  DataSourceParam source_param = src->GetSourceParam();
+  EXPECT_EQ(source_param.capture_dir_, "/tmp");
+  EXPECT_EQ(source_param.capture_streams_, std::set<std::string>({"1", "2", "3"}));
+  src->Close();
+
+  param["capture_dir"] = "/path/to/nothing";
+  EXPECT_FALSE(src->CheckParamSet(param));
+  EXPECT_FALSE(src->Open(param));
+}
+
+TEST(Source, DecodePriority) {
+  std::shared_ptr<DataSource> src = std::make_shared<DataSource>(gname);
+  ModuleParamSet param;
+  param["decode_priority"] = "low";
+  param["decode_pressure_ms"] = "10";
+  ASSERT_TRUE(src->CheckParamSet(param));
+  ASSERT_TRUE(src->Open(param));
+  DataSourceParam source_param = src->GetSourceParam();
+  EXPECT_EQ(source_param.decode_pressure_ms_, 10u);
+  EXPECT_EQ(src->GetDecodePriority(0), DecodePriority::LOW);
+
+  EXPECT_TRUE(src->CheckStreamParams({{"decode_priority", "high"}}));
+  EXPECT_FALSE(src->CheckStreamParams({{"decode_priority", "urgent"}}));
+  EXPECT_FALSE(src->CheckStreamParams({{"interval", "2"}}));
+  src->SetStreamParams(1, {{"decode_priority", "high"}});
+  EXPECT_EQ(src->GetDecodePriority(1), DecodePriority::HIGH);
+  EXPECT_EQ(src->GetDecodePriority(0), DecodePriority::LOW);
+  // restored
+  src->SetStreamParams(1, {});
+  EXPECT_EQ(src->GetDecodePriority(1), DecodePriority::LOW);
+  src->Close();
+
+  param["decode_priority"] = "urgent";
+  EXPECT_FALSE(src->CheckParamSet(param));
+}
+
 TEST(Source, AddSource) {
   auto src = std::make_shared<DataSource>(gname);
   std::string stream_id1 = "1";
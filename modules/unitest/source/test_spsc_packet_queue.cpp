@@ -0,0 +1,99 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "util/spsc_packet_queue.hpp"
+
+namespace cnstream {
+
+TEST(SourceSpscPacketQueue, PushPop) {
+  SpscPacketQueue queue(2);
+  EXPECT_EQ(queue.Capacity(), 2u);
+  EXPECT_EQ(queue.Front(0), nullptr);
+  uint8_t data[3] = {1, 2, 3};
+  EXPECT_TRUE(queue.Push(0, data, 3, 10, 1));
+  EXPECT_TRUE(queue.Push(0, nullptr, 0, 11, 2));
+  EXPECT_FALSE(queue.Push(0, data, 3, 12, 0));
+  EXPECT_EQ(queue.Size(), 2u);
+  // the payload is copied
+  data[0] = 0;
+  const SpscPacketQueue::Packet *pkt = queue.Front(0);
+  ASSERT_NE(pkt, nullptr);
+  ASSERT_EQ(pkt->size, 3u);
+  EXPECT_EQ(pkt->data[0], 1);
+  EXPECT_EQ(pkt->pts, 10u);
+  EXPECT_EQ(pkt->flags, 1u);
+  queue.PopFront();
+  pkt = queue.Front(0);
+  ASSERT_NE(pkt, nullptr);
+  EXPECT_EQ(pkt->data, nullptr);
+  EXPECT_EQ(pkt->size, 0u);
+  EXPECT_EQ(pkt->flags, 2u);
+  queue.PopFront();
+  EXPECT_EQ(queue.Size(), 0u);
+  // PopFront on an empty queue does nothing
+  queue.PopFront();
+  EXPECT_EQ(queue.Size(), 0u);
+}
+
+TEST(SourceSpscPacketQueue, Timeout) {
+  SpscPacketQueue queue(1);
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(queue.Front(50), nullptr);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+  uint8_t data = 0;
+  EXPECT_TRUE(queue.Push(50, &data, 1, 0, 0));
+  start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(queue.Push(50, &data, 1, 0, 0));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+}
+
+TEST(SourceSpscPacketQueue, ProducerConsumer) {
+  SpscPacketQueue queue(8);
+  constexpr uint32_t packet_num = 100000;
+  std::thread producer([&] {
+    std::vector<uint8_t> data;
+    for (uint32_t i = 0; i < packet_num; ++i) {
+      // sizes change so that the buffers of the slots grow and shrink
+      data.assign(1 + i % 64, static_cast<uint8_t>(i));
+      ASSERT_TRUE(queue.Push(-1, data.data(), data.size(), i, 0));
+    }
+  });
+  uint32_t received = 0;
+  while (received < packet_num) {
+    const SpscPacketQueue::Packet *pkt = queue.Front(1000);
+    ASSERT_NE(pkt, nullptr);
+    ASSERT_EQ(pkt->pts, received);
+    ASSERT_EQ(pkt->size, 1 + received % 64);
+    EXPECT_EQ(pkt->data[pkt->size - 1], static_cast<uint8_t>(received));
+    queue.PopFront();
+    ++received;
+  }
+  producer.join();
+  EXPECT_EQ(queue.Size(), 0u);
+}
+
+}  // namespace cnstream
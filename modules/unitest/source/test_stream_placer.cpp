@@ -0,0 +1,88 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "util/stream_placer.hpp"
+
+namespace cnstream {
+
+TEST(SourceStreamPlacer, ByStreamNumber) {
+  // no sampler, the streams are spread by their numbers
+  StreamPlacer placer({0, 1, 2}, nullptr);
+  EXPECT_EQ(placer.Place("stream_0"), 0);
+  EXPECT_EQ(placer.Place("stream_1"), 1);
+  EXPECT_EQ(placer.Place("stream_2"), 2);
+  EXPECT_EQ(placer.Place("stream_3"), 0);
+  // a stream keeps its device
+  EXPECT_EQ(placer.Place("stream_1"), 1);
+  EXPECT_EQ(placer.Find("stream_3"), 0);
+  EXPECT_EQ(placer.GetStreamNum(0), 2u);
+  placer.Release("stream_1");
+  EXPECT_EQ(placer.Find("stream_1"), -1);
+  EXPECT_EQ(placer.GetStreamNum(1), 0u);
+  EXPECT_EQ(placer.Place("stream_4"), 1);
+  placer.Release("not_placed");
+  EXPECT_EQ(placer.GetStreamNum(3), 0u);
+}
+
+TEST(SourceStreamPlacer, ByLoad) {
+  std::vector<DeviceLoad> loads(2);
+  loads[0].device_id = 0;
+  loads[0].codec = 0.2;
+  loads[0].compute = 0.8;  // busy with inference
+  loads[1].device_id = 1;
+  loads[1].codec = 0.5;
+  loads[1].compute = 0.1;
+  StreamPlacer placer({0, 1}, [&loads] { return loads; }, 0);
+  EXPECT_EQ(placer.Place("stream_0"), 1);
+  // device 1 gets busier than device 0
+  loads[1].codec = 0.9;
+  EXPECT_EQ(placer.Place("stream_1"), 0);
+  // the load of a device is unknown, the streams are spread by their numbers
+  loads[0].codec = loads[0].compute = -1;
+  EXPECT_EQ(placer.Place("stream_2"), 0);
+  EXPECT_EQ(placer.Place("stream_3"), 1);
+}
+
+TEST(SourceStreamPlacer, Burst) {
+  // the loads are sampled once for the streams added at once
+  int samples = 0;
+  StreamPlacer placer({0, 1}, [&samples] {
+    ++samples;
+    std::vector<DeviceLoad> loads(2);
+    loads[0].device_id = 0;
+    loads[0].compute = 0.1;
+    loads[1].device_id = 1;
+    loads[1].compute = 0.3;
+    return loads;
+  }, 60000);
+  std::vector<int> stream_nums(2, 0);
+  for (int i = 0; i < 10; ++i) stream_nums[placer.Place("stream_" + std::to_string(i))]++;
+  EXPECT_EQ(samples, 1);
+  // 0.1 + 7 * 0.05 versus 0.3 + 3 * 0.05
+  EXPECT_EQ(stream_nums[0], 7);
+  EXPECT_EQ(stream_nums[1], 3);
+}
+
+}  // namespace cnstream
@@ -18,7 +18,11 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <ctime>
+#include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
@@ -33,6 +37,7 @@
 #include "cnrt.h"
 #include "cnstream_frame.hpp"
 #include "cnstream_frame_va.hpp"
+#include "private/cnstream_parallel.hpp"
 
 namespace cnstream {
 
@@ -120,6 +125,168 @@ TEST(CoreFrame, ConvertYUV21ImageToBGR2) {
   RunConvertImageTest(&frame, 2, ptr_cpu);
 }
 
+TEST(CoreFrame, ImageViewFromBGR) {
+  CNDataFrame frame;
+  void* ptr_cpu[1];
+  InitFrame(&frame, 0, ptr_cpu);
+  frame.fmt = CNDataFormat::CN_PIXEL_FORMAT_BGR24;
+  uint8_t* bgr = static_cast<uint8_t*>(ptr_cpu[0]);
+  for (int i = 0; i < frame.height * frame.stride[0]; ++i) {
+    bgr[i * 3] = 1;
+    bgr[i * 3 + 1] = 2;
+    bgr[i * 3 + 2] = 3;
+  }
+  frame.dst_device_id = g_dev_id;
+  frame.CopyToSyncMem(ptr_cpu, true);
+  cv::Mat crop = frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_RGB24, 0, 0, cv::Rect(100, 100, 64, 32));
+  ASSERT_EQ(crop.cols, 64);
+  ASSERT_EQ(crop.rows, 32);
+  EXPECT_EQ(crop.at<cv::Vec3b>(0, 0), cv::Vec3b(3, 2, 1));
+  cv::Mat small = frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_BGR24, frame.width / 4, frame.height / 4);
+  ASSERT_EQ(small.cols, frame.width / 4);
+  ASSERT_EQ(small.rows, frame.height / 4);
+  EXPECT_EQ(small.at<cv::Vec3b>(10, 10), cv::Vec3b(1, 2, 3));
+  // cached
+  EXPECT_EQ(frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_BGR24, frame.width / 4, frame.height / 4).data, small.data);
+  EXPECT_TRUE(frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12).empty());
+  EXPECT_FALSE(frame.HasBGRImage());
+  free(ptr_cpu[0]);
+}
+
+TEST(CoreFrame, PinPixels) {
+  CNDataFrame frame;
+  frame.fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+  frame.width = frame.stride[0] = frame.stride[1] = 64;
+  frame.height = 32;
+  frame.data[0].reset(new CNSyncedMemory(frame.GetPlaneBytes(0)));
+  frame.data[1].reset(new CNSyncedMemory(frame.GetPlaneBytes(1)));
+  void* y = frame.data[0]->GetMutableCpuData();
+  std::shared_ptr<void> pin = frame.PinPixels();
+  EXPECT_EQ(frame.PinPixels(), pin);
+  frame.ReleasePixels();
+  EXPECT_FALSE(frame.HasPixels());
+  // the planes released are kept by the pin
+  memset(y, 1, frame.GetPlaneBytes(0));
+  pin.reset();
+  EXPECT_NE(frame.PinPixels(), nullptr);
+}
+
+TEST(CoreFrame, ReleasePixelCopy) {
+  CNDataFrame frame;
+  frame.fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+  frame.width = frame.stride[0] = frame.stride[1] = 64;
+  frame.height = 32;
+  frame.data[0].reset(new CNSyncedMemory(frame.GetPlaneBytes(0)));
+  frame.data[1].reset(new CNSyncedMemory(frame.GetPlaneBytes(1)));
+  memset(frame.data[0]->GetMutableCpuData(), 1, frame.GetPlaneBytes(0));
+  memset(frame.data[1]->GetMutableCpuData(), 1, frame.GetPlaneBytes(1));
+  // the only copy of the pixels is kept
+  EXPECT_FALSE(frame.ReleaseHostPixels());
+  EXPECT_FALSE(frame.ReleaseDevicePixels());
+  EXPECT_FALSE(frame.data[0]->ReleaseCpuMirror());
+  EXPECT_FALSE(frame.data[0]->ReleaseMluMirror());
+  EXPECT_TRUE(frame.HasPixels());
+  EXPECT_EQ(frame.data[0]->GetHead(), CNSyncedMemory::SyncedHead::HEAD_AT_CPU);
+  EXPECT_EQ(static_cast<const uint8_t*>(frame.data[0]->GetCpuData())[0], 1);
+}
+
+TEST(CoreFrame, BuildPyramid) {
+  CNDataFrame frame;
+  frame.fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+  frame.width = frame.stride[0] = frame.stride[1] = 64;
+  frame.height = 32;
+  frame.data[0].reset(new CNSyncedMemory(frame.GetPlaneBytes(0)));
+  frame.data[1].reset(new CNSyncedMemory(frame.GetPlaneBytes(1)));
+  uint8_t* y = static_cast<uint8_t*>(frame.data[0]->GetMutableCpuData());
+  uint8_t* uv = static_cast<uint8_t*>(frame.data[1]->GetMutableCpuData());
+  // columns of 100 and 200 are averaged to 150
+  for (int i = 0; i < frame.width * frame.height; ++i) y[i] = i % 2 ? 200 : 100;
+  memset(uv, 128, frame.GetPlaneBytes(1));
+  EXPECT_FALSE(frame.BuildPyramid(0));
+  EXPECT_TRUE(frame.GetPyramid().empty());
+  // the levels smaller than 2x2 are not built
+  ASSERT_TRUE(frame.BuildPyramid(8));
+  std::vector<CNFramePyramidLevel> pyramid = frame.GetPyramid();
+  ASSERT_EQ(pyramid.size(), 4u);
+  EXPECT_EQ(pyramid[0].width, 32);
+  EXPECT_EQ(pyramid[0].height, 16);
+  EXPECT_EQ(pyramid[3].width, 4);
+  EXPECT_EQ(pyramid[3].height, 2);
+  EXPECT_EQ(pyramid[0].uv.cols, 16);
+  EXPECT_EQ(pyramid[0].uv.rows, 8);
+  EXPECT_EQ(pyramid[0].y.at<uint8_t>(3, 5), 150);
+  EXPECT_EQ(pyramid[2].y.at<uint8_t>(1, 1), 150);
+
+  CNFramePyramidLevel level;
+  ASSERT_TRUE(frame.GetPyramidLevel(10, 5, &level));
+  EXPECT_EQ(level.width, 16);
+  EXPECT_FALSE(frame.GetPyramidLevel(40, 5, &level));
+
+  // the small views are converted from the pyramid, the crops of full resolution from the frame
+  memset(y, 0, frame.GetPlaneBytes(0));
+  cv::Mat small = frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_BGR24, 16, 8);
+  ASSERT_EQ(small.cols, 16);
+  EXPECT_GT(small.at<cv::Vec3b>(4, 4)[1], 100);
+  cv::Mat crop = frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_BGR24, 0, 0, cv::Rect(4, 4, 16, 8));
+  ASSERT_EQ(crop.cols, 16);
+  EXPECT_LT(crop.at<cv::Vec3b>(4, 4)[1], 50);
+
+  frame.ReleasePixels();
+  EXPECT_TRUE(frame.GetPyramid().empty());
+  frame.fmt = CNDataFormat::CN_PIXEL_FORMAT_BGR24;
+  EXPECT_FALSE(frame.BuildPyramid(2));
+}
+
+TEST(CoreFrame, ImageViewFromYUV) {
+  for (int image_type : {1, 2}) {
+    CNDataFrame frame;
+    void* ptr_cpu[2];
+    InitFrame(&frame, image_type, ptr_cpu);
+    frame.fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+    frame.dst_device_id = g_dev_id;
+    frame.CopyToSyncMem(ptr_cpu, true);
+    cv::Mat small = frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_BGR24, 481, 271);
+    EXPECT_EQ(small.cols, 481);
+    EXPECT_EQ(small.rows, 271);
+    cv::Mat crop = frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_RGB24, 0, 0, cv::Rect(11, 11, 100, 50));
+    EXPECT_EQ(crop.cols, 100);
+    EXPECT_EQ(crop.rows, 50);
+    EXPECT_EQ(frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_RGB24, 0, 0, cv::Rect(11, 11, 100, 50)).data, crop.data);
+    // the region is clipped by the frame
+    cv::Mat corner = frame.ImageView(CNDataFormat::CN_PIXEL_FORMAT_BGR24, 0, 0, cv::Rect(1900, 1000, 100, 100));
+    EXPECT_EQ(corner.cols, 20);
+    EXPECT_EQ(corner.rows, frame.height - 1000);
+    free(ptr_cpu[0]);
+    free(ptr_cpu[1]);
+  }
+}
+
+TEST(CoreFrame, ConvertYUVImageToBGRInBands) {
+  // 4K NV12, the conversion in bands on the shared pool gives the same image as on one thread
+  const int w = 3840, h = 2160;
+  std::vector<uint8_t> yuv(w * h * 3 / 2);
+  for (size_t i = 0; i < yuv.size(); ++i) yuv[i] = static_cast<uint8_t>(i * 7);
+  auto convert = [&]() {
+    CNDataFrame frame;
+    frame.ctx.dev_type = DevContext::DevType::CPU;
+    frame.fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+    frame.width = w;
+    frame.height = h;
+    frame.stride[0] = frame.stride[1] = w;
+    void* ptr_cpu[2] = {yuv.data(), yuv.data() + w * h};
+    frame.dst_device_id = g_dev_id;
+    frame.CopyToSyncMem(ptr_cpu, false);
+    return frame.ImageBGR();
+  };
+  const int thread_num = GetParallelThreadNum();
+  SetParallelThreadNum(0);
+  cv::Mat expected = convert();
+  SetParallelThreadNum(thread_num);
+  cv::Mat bgr = convert();
+  ASSERT_EQ(bgr.size(), expected.size());
+  EXPECT_EQ(cv::norm(bgr, expected, cv::NORM_INF), 0);
+}
+
 TEST(CoreFrame, ConvertImageToBGRFailed) {
   CNDataFrame frame;
   void* ptr_cpu[2];
@@ -219,6 +386,31 @@ TEST(CoreFrame, InferObjGetAttribute) {
   EXPECT_EQ(infer_attr.score, value.score);
 }
 
+TEST(CoreFrame, InferObjGetAttributes) {
+  CNInferObject infer_obj;
+  EXPECT_TRUE(infer_obj.GetAttributes().empty());
+
+  CNInferAttr value;
+  value.id = 1;
+  value.value = 2;
+  value.score = 0.9;
+  EXPECT_TRUE(infer_obj.AddAttribute("key1", value));
+  EXPECT_TRUE(infer_obj.AddAttribute("key2", value));
+  CNInferAttrs attrs = infer_obj.GetAttributes();
+  ASSERT_EQ(attrs.size(), 2u);
+  EXPECT_EQ(attrs[0].first, "key1");
+  EXPECT_EQ(attrs[1].first, "key2");
+  EXPECT_EQ(attrs[1].second.value, value.value);
+
+  EXPECT_TRUE(infer_obj.RemoveAttribute("key1"));
+  EXPECT_TRUE(infer_obj.RemoveAttribute("wrong_key"));
+  EXPECT_EQ(infer_obj.GetAttribute("key1").id, -1);
+  ASSERT_EQ(infer_obj.GetAttributes().size(), 1u);
+  // added again after being removed
+  EXPECT_TRUE(infer_obj.AddAttribute("key1", value));
+  EXPECT_EQ(infer_obj.GetAttributes().size(), 2u);
+}
+
 TEST(CoreFrame, InferObjAddExtraAttribute) {
   CNInferObject infer_obj;
   std::string key = "test_key";
@@ -244,6 +436,23 @@ TEST(CoreFrame, InferObjGetExtraAttribute) {
   EXPECT_EQ(infer_obj.GetExtraAttribute(key), value);
 }
 
+TEST(CoreFrame, InferObjExtraAttributesSortedByKey) {
+  CNInferObject infer_obj;
+  EXPECT_TRUE(infer_obj.AddExtraAttributes({{"c", "3"}, {"a", "1"}}));
+  // "a" exists, "b" is added
+  EXPECT_FALSE(infer_obj.AddExtraAttributes({{"b", "2"}, {"a", "0"}}));
+  StringPairs attributes = infer_obj.GetExtraAttributes();
+  ASSERT_EQ(attributes.size(), 3u);
+  EXPECT_EQ(attributes[0], std::make_pair(std::string("a"), std::string("1")));
+  EXPECT_EQ(attributes[1], std::make_pair(std::string("b"), std::string("2")));
+  EXPECT_EQ(attributes[2], std::make_pair(std::string("c"), std::string("3")));
+
+  EXPECT_TRUE(infer_obj.RemoveExtraAttribute("b"));
+  EXPECT_TRUE(infer_obj.RemoveExtraAttribute("wrong_key"));
+  EXPECT_EQ(infer_obj.GetExtraAttribute("b"), "");
+  EXPECT_EQ(infer_obj.GetExtraAttributes().size(), 2u);
+}
+
 TEST(CoreFrame, InferObjAddAndGetfeature) {
   CNInferObject infer_obj;
 
@@ -262,6 +471,154 @@ TEST(CoreFrame, InferObjAddAndGetfeature) {
   EXPECT_EQ(infer_obj.GetFeature("feature2"), infer_feature2);
 }
 
+TEST(CoreFrame, InferObjQuantizedFeature) {
+  CNInferFeature feature{0.5f, -1.f, 0.25f, 3.f, -0.001f, 0.f, 65504.f, 1e-6f};
+  CNInferQuantizedFeature fp16 = CNInferQuantizedFeature::Quantize(feature.data(), feature.size(),
+                                                                   CNFeaturePrecision::FP16);
+  EXPECT_EQ(fp16.dimension, feature.size());
+  EXPECT_EQ(fp16.data.size(), feature.size() * 2);
+  CNInferFeature restored = fp16.Dequantize();
+  for (size_t i = 0; i < feature.size(); ++i) {
+    // the last value is a subnormal half
+    EXPECT_NEAR(restored[i], feature[i], std::max(std::abs(feature[i]) / 1024, 6e-8f));
+  }
+
+  CNInferQuantizedFeature int8 = CNInferQuantizedFeature::Quantize(feature.data(), 4, CNFeaturePrecision::INT8);
+  EXPECT_EQ(int8.data.size(), 4u);
+  EXPECT_FLOAT_EQ(int8.scale, 3.f / 127);
+  restored = int8.Dequantize();
+  for (size_t i = 0; i < 4; ++i) EXPECT_NEAR(restored[i], feature[i], int8.scale / 2);
+
+  CNInferObject infer_obj;
+  EXPECT_TRUE(infer_obj.AddFeature("b", feature, CNFeaturePrecision::INT8));
+  EXPECT_TRUE(infer_obj.AddFeature("a", feature, CNFeaturePrecision::FP32));
+  EXPECT_TRUE(infer_obj.AddFeature("c", feature, CNFeaturePrecision::FP16));
+  // the keys are shared by all precisions
+  EXPECT_FALSE(infer_obj.AddFeature("a", feature, CNFeaturePrecision::FP16));
+  EXPECT_FALSE(infer_obj.AddFeature("b", feature));
+  EXPECT_FALSE(infer_obj.VisitQuantizedFeature("a", [](const CNInferQuantizedFeature&) {}));
+  EXPECT_TRUE(infer_obj.VisitQuantizedFeature("c", [](const CNInferQuantizedFeature& quantized) {
+    EXPECT_EQ(quantized.precision, CNFeaturePrecision::FP16);
+  }));
+  EXPECT_EQ(infer_obj.GetFeature("c"), fp16.Dequantize());
+  EXPECT_TRUE(infer_obj.VisitFeature("b", [](const CNInferFeature& value) { EXPECT_EQ(value.size(), 8u); }));
+  CNInferFeatures features = infer_obj.GetFeatures();
+  ASSERT_EQ(features.size(), 3u);
+  EXPECT_EQ(features[0].first, "a");
+  EXPECT_EQ(features[1].first, "b");
+  EXPECT_EQ(features[2].first, "c");
+
+  CNInferObject copied;
+  infer_obj.CopyTo(&copied);
+  EXPECT_EQ(copied.GetFeature("b"), infer_obj.GetFeature("b"));
+}
+
+TEST(CoreFrame, InferObjsCreateObject) {
+  std::weak_ptr<CNInferObject> released;
+  CNInferObjectPtr kept;
+  {
+    auto objs_holder = std::make_shared<CNInferObjs>();
+    for (int i = 0; i < 1000; ++i) {
+      CNInferObjectPtr obj = objs_holder->CreateObject();
+      ASSERT_NE(obj, nullptr);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(obj.get()) % alignof(CNInferObject), 0u);
+      obj->id = std::to_string(i);
+      CNInferAttr attr;
+      attr.id = 1;
+      attr.value = i;
+      EXPECT_TRUE(obj->AddAttribute("color", attr));
+      objs_holder->objs_.push_back(obj);
+    }
+    EXPECT_TRUE(objs_holder->objs_.front()->id == "0");
+    EXPECT_EQ(objs_holder->objs_.back()->GetAttribute("color").value, 999);
+    released = objs_holder->objs_.front();
+    kept = objs_holder->objs_.back();
+  }
+  // the arena lives as long as an object of it
+  EXPECT_TRUE(released.expired());
+  EXPECT_EQ(kept->id, "999");
+  EXPECT_EQ(kept->GetAttribute("color").value, 999);
+}
+
+TEST(CoreFrame, InferObjArena) {
+  InferObjArena arena;
+  EXPECT_EQ(arena.GetCapacity(), 0u);
+  char* a = static_cast<char*>(arena.Allocate(3, 1));
+  char* b = static_cast<char*>(arena.Allocate(8, 8));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 8, 0u);
+  EXPECT_GE(b, a + 3);
+  EXPECT_LT(b, a + 16);
+  const size_t first = arena.GetCapacity();
+  EXPECT_GT(first, 0u);
+  // large allocations take a chunk of their own
+  EXPECT_NE(arena.Allocate(first * 4, 8), nullptr);
+  EXPECT_GE(arena.GetCapacity(), first * 5);
+}
+
+TEST(CoreFrame, InferDataByModuleId) {
+  CNInferData infer_data;
+  EXPECT_TRUE(infer_data.Get(0).empty());
+  auto first = std::make_shared<InferData>();
+  auto second = std::make_shared<InferData>();
+  auto other = std::make_shared<InferData>();
+  infer_data.Add(3, first);
+  infer_data.Add(5, other);
+  infer_data.Add(3, second);
+  std::vector<std::shared_ptr<InferData>> datas = infer_data.Get(3);
+  ASSERT_EQ(datas.size(), 2u);
+  EXPECT_EQ(datas[0], first);
+  EXPECT_EQ(datas[1], second);
+  ASSERT_EQ(infer_data.Get(5).size(), 1u);
+  EXPECT_EQ(infer_data.Get(5)[0], other);
+  EXPECT_TRUE(infer_data.Get(4).empty());
+
+  // the tensors are read on the cpu
+  first->outputs_.push_back(std::make_shared<CNSyncedMemory>(4 * sizeof(float)));
+  float* output = static_cast<float*>(first->outputs_[0]->GetMutableCpuData());
+  for (int i = 0; i < 4; ++i) output[i] = i;
+  EXPECT_EQ(static_cast<const float*>(infer_data.Get(3)[0]->outputs_[0]->GetCpuData())[3], 3);
+}
+
+TEST(CoreFrame, InferObjsSnapshot) {
+  CNInferObjs objs_holder;
+  CNInferObjsSnapshot empty = objs_holder.GetSnapshot();
+  ASSERT_NE(empty, nullptr);
+  EXPECT_TRUE(empty->empty());
+  EXPECT_EQ(objs_holder.GetSnapshot(), empty);
+
+  CNInferObjectPtr obj = objs_holder.CreateObject();
+  obj->id = "1";
+  obj->AddExtraAttribute("color", "red");
+  objs_holder.Append({obj});
+  EXPECT_EQ(objs_holder.GetVersion(), 1u);
+  CNInferObjsSnapshot first = objs_holder.GetSnapshot();
+  ASSERT_EQ(first->size(), 1u);
+  EXPECT_TRUE(empty->empty());
+
+  // the object is cloned, the former snapshot keeps the former object
+  CNInferObjectPtr clone = objs_holder.Modify(obj, [](CNInferObject* o) { o->track_id = "7"; });
+  ASSERT_NE(clone, nullptr);
+  EXPECT_EQ(clone->id, "1");
+  EXPECT_EQ(clone->track_id, "7");
+  EXPECT_EQ(clone->GetExtraAttribute("color"), "red");
+  EXPECT_TRUE(obj->track_id.empty());
+  EXPECT_EQ(first->at(0), obj);
+  EXPECT_EQ(objs_holder.GetSnapshot()->at(0), clone);
+  EXPECT_EQ(objs_holder.objs_[0], clone);
+  // not one of the objects
+  EXPECT_EQ(objs_holder.Modify(obj, [](CNInferObject*) {}), nullptr);
+
+  // the objects changed directly are seen after Publish
+  {
+    std::lock_guard<std::mutex> lk(objs_holder.mutex_);
+    objs_holder.objs_.push_back(std::make_shared<CNInferObject>());
+  }
+  EXPECT_EQ(objs_holder.GetSnapshot()->size(), 1u);
+  objs_holder.Publish();
+  EXPECT_EQ(objs_holder.GetSnapshot()->size(), 2u);
+  EXPECT_EQ(objs_holder.GetVersion(), 3u);
+}
+
 TEST(CoreFrame, CreateFrameInfo) {
   // create frame success
   EXPECT_NE(CNFrameInfo::Create("0"), nullptr);
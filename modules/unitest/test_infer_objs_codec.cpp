@@ -0,0 +1,171 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_infer_objs_codec.hpp"
+
+namespace cnstream {
+
+static CNInferAttr MakeAttr(int id, int value, float score) {
+  CNInferAttr attr;
+  attr.id = id;
+  attr.value = value;
+  attr.score = score;
+  return attr;
+}
+
+static CNObjsVec CreateObjs(int num, int feature_dim) {
+  CNObjsVec objs;
+  for (int i = 0; i < num; ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = std::to_string(i % 80);
+    obj->track_id = std::to_string(i);
+    obj->score = 0.5f + i * 0.001f;
+    obj->bbox.x = 0.1f;
+    obj->bbox.y = 0.2f + i * 0.0001f;
+    obj->bbox.w = 0.3f;
+    obj->bbox.h = 0.4f;
+    obj->AddAttribute("color", MakeAttr(1, i % 10, 0.9f));
+    obj->AddAttribute("type", MakeAttr(2, -1, 0.8f));
+    obj->AddExtraAttribute("plate", "A12345");
+    if (feature_dim) obj->AddFeature("reid", CNInferFeature(feature_dim, 0.25f * i));
+    objs.push_back(obj);
+  }
+  return objs;
+}
+
+TEST(InferObjsCodec, EncodeAndDecode) {
+  CNObjsVec objs = CreateObjs(3, 8);
+  std::string buffer;
+  InferObjsCodec::Encode("stream_0", 42, 1000, objs, InferObjsCodec::EXTRA_ATTRIBUTES | InferObjsCodec::FEATURES,
+                         &buffer);
+  size_t first_size = buffer.size();
+  // messages are appended
+  InferObjsCodec::Encode("stream_1", 43, 1001, objs, 0, &buffer);
+
+  InferObjsCodec::Frame frame;
+  size_t consumed = 0;
+  ASSERT_TRUE(InferObjsCodec::Decode(buffer.data(), buffer.size(), &frame, &consumed));
+  EXPECT_EQ(consumed, first_size);
+  EXPECT_EQ(frame.stream_id, "stream_0");
+  EXPECT_EQ(frame.frame_id, 42u);
+  EXPECT_EQ(frame.timestamp, 1000);
+  ASSERT_EQ(frame.objs.size(), objs.size());
+  for (size_t i = 0; i < objs.size(); ++i) {
+    EXPECT_EQ(frame.objs[i]->id, objs[i]->id);
+    EXPECT_EQ(frame.objs[i]->track_id, objs[i]->track_id);
+    EXPECT_FLOAT_EQ(frame.objs[i]->score, objs[i]->score);
+    EXPECT_FLOAT_EQ(frame.objs[i]->bbox.y, objs[i]->bbox.y);
+    EXPECT_FLOAT_EQ(frame.objs[i]->bbox.h, objs[i]->bbox.h);
+    CNInferAttr attr = frame.objs[i]->GetAttribute("color");
+    EXPECT_EQ(attr.id, 1);
+    EXPECT_EQ(attr.value, static_cast<int>(i % 10));
+    EXPECT_EQ(frame.objs[i]->GetAttribute("type").value, -1);
+    EXPECT_EQ(frame.objs[i]->GetExtraAttribute("plate"), "A12345");
+    EXPECT_EQ(frame.objs[i]->GetFeature("reid"), objs[i]->GetFeature("reid"));
+  }
+
+  ASSERT_TRUE(InferObjsCodec::Decode(buffer.data() + consumed, buffer.size() - consumed, &frame));
+  EXPECT_EQ(frame.stream_id, "stream_1");
+  EXPECT_EQ(frame.flags, 0);
+  ASSERT_EQ(frame.objs.size(), objs.size());
+  EXPECT_TRUE(frame.objs[0]->GetExtraAttributes().empty());
+  EXPECT_TRUE(frame.objs[0]->GetFeatures().empty());
+  EXPECT_EQ(frame.objs[0]->GetAttributes().size(), 2u);
+}
+
+TEST(InferObjsCodec, QuantizedFeatures) {
+  CNObjsVec objs = CreateObjs(1, 0);
+  CNInferFeature feature(128);
+  for (size_t i = 0; i < feature.size(); ++i) feature[i] = std::sin(0.1f * i);
+  ASSERT_TRUE(objs[0]->AddFeature("fp16", feature, CNFeaturePrecision::FP16));
+  ASSERT_TRUE(objs[0]->AddFeature("int8", feature, CNFeaturePrecision::INT8));
+  std::string fp32_buffer, buffer;
+  CNObjsVec fp32_objs = CreateObjs(1, 0);
+  fp32_objs[0]->AddFeature("fp16", feature);
+  fp32_objs[0]->AddFeature("int8", feature);
+  InferObjsCodec::Encode("stream_0", 0, 0, fp32_objs, InferObjsCodec::FEATURES, &fp32_buffer);
+  InferObjsCodec::Encode("stream_0", 0, 0, objs, InferObjsCodec::FEATURES, &buffer);
+  // 2 + 1 bytes per value instead of 4 + 4
+  EXPECT_LT(buffer.size() + 4 * feature.size(), fp32_buffer.size());
+
+  InferObjsCodec::Frame frame;
+  ASSERT_TRUE(InferObjsCodec::Decode(buffer.data(), buffer.size(), &frame));
+  ASSERT_EQ(frame.objs.size(), 1u);
+  EXPECT_TRUE(frame.objs[0]->VisitQuantizedFeature("fp16", [&](const CNInferQuantizedFeature& decoded) {
+    EXPECT_EQ(decoded.precision, CNFeaturePrecision::FP16);
+    EXPECT_EQ(decoded.dimension, feature.size());
+  }));
+  EXPECT_EQ(frame.objs[0]->GetFeature("fp16"), objs[0]->GetFeature("fp16"));
+  EXPECT_EQ(frame.objs[0]->GetFeature("int8"), objs[0]->GetFeature("int8"));
+  for (size_t i = 0; i < feature.size(); ++i) EXPECT_NEAR(frame.objs[0]->GetFeature("int8")[i], feature[i], 0.005f);
+
+  // not written without the flag
+  buffer.clear();
+  InferObjsCodec::Encode("stream_0", 0, 0, objs, 0, &buffer);
+  ASSERT_TRUE(InferObjsCodec::Decode(buffer.data(), buffer.size(), &frame));
+  EXPECT_TRUE(frame.objs[0]->GetFeatures().empty());
+}
+
+TEST(InferObjsCodec, EncodeFrameInfo) {
+  auto data = CNFrameInfo::Create("stream_0");
+  data->timestamp = 7;
+  std::string buffer;
+  InferObjsCodec::Frame frame;
+  // no objects
+  ASSERT_TRUE(InferObjsCodec::Encode(data, 0, &buffer));
+  ASSERT_TRUE(InferObjsCodec::Decode(buffer.data(), buffer.size(), &frame));
+  EXPECT_EQ(frame.timestamp, 7);
+  EXPECT_TRUE(frame.objs.empty());
+
+  auto objs_holder = std::make_shared<CNInferObjs>();
+  objs_holder->objs_ = CreateObjs(2, 0);
+  data->collection.Add(kCNInferObjsTag, objs_holder);
+  buffer.clear();
+  ASSERT_TRUE(InferObjsCodec::Encode(data, 0, &buffer));
+  ASSERT_TRUE(InferObjsCodec::Decode(buffer.data(), buffer.size(), &frame));
+  EXPECT_EQ(frame.stream_id, "stream_0");
+  EXPECT_EQ(frame.objs.size(), 2u);
+
+  EXPECT_FALSE(InferObjsCodec::Encode(CNFrameInfo::Create("stream_0", true), 0, &buffer));
+  EXPECT_FALSE(InferObjsCodec::Encode(data, 0, nullptr));
+}
+
+TEST(InferObjsCodec, DecodeFailed) {
+  std::string buffer;
+  InferObjsCodec::Encode("stream_0", 1, 0, CreateObjs(2, 4), InferObjsCodec::FEATURES, &buffer);
+  InferObjsCodec::Frame frame;
+  for (size_t size = 0; size < buffer.size(); size += 7) {
+    EXPECT_FALSE(InferObjsCodec::Decode(buffer.data(), size, &frame));
+  }
+  std::string bad_version = buffer;
+  bad_version[4] = InferObjsCodec::kVersion + 1;
+  EXPECT_FALSE(InferObjsCodec::Decode(bad_version.data(), bad_version.size(), &frame));
+  std::string json = "{\"StreamName\":\"stream_0\"}";
+  EXPECT_FALSE(InferObjsCodec::Decode(json.data(), json.size(), &frame));
+}
+
+}  // namespace cnstream
@@ -0,0 +1,70 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "cnstream_mapped_file.hpp"
+
+namespace cnstream {
+
+static void WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+  ofs << content;
+}
+
+TEST(MappedFile, MapAndShare) {
+  const std::string path = "/tmp/cnstream_test_mapped_file_" + std::to_string(getpid());
+  WriteFile(path, "model content");
+
+  std::shared_ptr<MappedFile> file = MappedFile::Open(path);
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(file->Size(), strlen("model content"));
+  EXPECT_EQ(0, memcmp(file->Data(), "model content", file->Size()));
+  EXPECT_EQ(file->Path(), path);
+  // opened again while mapped, the mapping is shared
+  EXPECT_EQ(MappedFile::Open(path), file);
+
+  // rewritten, the file is mapped again
+  WriteFile(path, "new model content");
+  std::shared_ptr<MappedFile> new_file = MappedFile::Open(path);
+  ASSERT_NE(new_file, nullptr);
+  EXPECT_NE(new_file, file);
+  EXPECT_EQ(new_file->Size(), strlen("new model content"));
+  EXPECT_EQ(0, memcmp(new_file->Data(), "new model content", new_file->Size()));
+  remove(path.c_str());
+}
+
+TEST(MappedFile, OpenFailed) {
+  EXPECT_EQ(MappedFile::Open("/tmp/cnstream_test_mapped_file_not_exist"), nullptr);
+  EXPECT_EQ(MappedFile::Open("/tmp"), nullptr);
+  const std::string path = "/tmp/cnstream_test_mapped_file_empty_" + std::to_string(getpid());
+  WriteFile(path, "");
+  EXPECT_EQ(MappedFile::Open(path), nullptr);
+  remove(path.c_str());
+}
+
+}  // namespace cnstream
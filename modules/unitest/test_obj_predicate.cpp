@@ -0,0 +1,143 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_obj_predicate.hpp"
+
+namespace cnstream {
+
+static CNInferObjectPtr MakeObj(const std::string& id, float score, float x, float y, float w, float h) {
+  auto obj = std::make_shared<CNInferObject>();
+  obj->id = id;
+  obj->score = score;
+  obj->bbox.x = x;
+  obj->bbox.y = y;
+  obj->bbox.w = w;
+  obj->bbox.h = h;
+  return obj;
+}
+
+// the objects are more than the lanes of the kernels, so that both the vector and the scalar paths are run
+static CNObjsVec MakeObjs() {
+  CNObjsVec objs;
+  for (int i = 0; i < 11; ++i) {
+    const float pos = 0.05f + 0.08f * i;
+    objs.push_back(MakeObj(std::to_string(i % 4), 0.1f * i, pos, pos, 0.02f * (i + 1), 0.02f * (i + 1)));
+  }
+  objs.push_back(MakeObj("car", 0.9f, 0.5f, 0.5f, 0.1f, 0.1f));
+  return objs;
+}
+
+// checks the snapshot and the single object evaluation agree
+static std::vector<uint8_t> Evaluate(const ObjPredicate& predicate, const CNObjsVec& objs) {
+  ObjsSnapshot snapshot;
+  snapshot.Reset(objs);
+  std::vector<uint8_t> selected;
+  predicate.Evaluate(snapshot, &selected);
+  EXPECT_EQ(selected.size(), objs.size());
+  for (size_t i = 0; i < objs.size(); ++i) EXPECT_EQ(selected[i] != 0, predicate.Evaluate(*objs[i])) << i;
+  return selected;
+}
+
+TEST(ObjPredicate, Snapshot) {
+  ObjsSnapshot snapshot;
+  snapshot.Reset(MakeObjs());
+  ASSERT_EQ(snapshot.Size(), 12u);
+  EXPECT_EQ(snapshot.labels[5], 1);
+  EXPECT_EQ(snapshot.labels[11], -1);
+  EXPECT_FLOAT_EQ(snapshot.scores[3], 0.3f);
+  EXPECT_FLOAT_EQ(snapshot.x[11], 0.5f);
+  EXPECT_FLOAT_EQ(snapshot.h[0], 0.02f);
+  snapshot.Reset(CNObjsVec());
+  EXPECT_EQ(snapshot.Size(), 0u);
+}
+
+TEST(ObjPredicate, Conditions) {
+  const CNObjsVec objs = MakeObjs();
+  ObjPredicate predicate;
+  EXPECT_TRUE(predicate.Empty());
+  EXPECT_EQ(Evaluate(predicate, objs), std::vector<uint8_t>(objs.size(), 1));
+
+  predicate.SetLabels({1, 3, 100});
+  EXPECT_FALSE(predicate.Empty());
+  EXPECT_EQ(Evaluate(predicate, objs), std::vector<uint8_t>({0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 0}));
+
+  predicate = ObjPredicate();
+  predicate.SetMinScore(0.45f);
+  EXPECT_EQ(Evaluate(predicate, objs), std::vector<uint8_t>({0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1}));
+
+  predicate = ObjPredicate();
+  predicate.SetAreaRange(0.0015f, 0.0105f);  // the sides from 0.04 to 0.1
+  EXPECT_EQ(Evaluate(predicate, objs), std::vector<uint8_t>({0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 1}));
+
+  // all conditions are satisfied
+  predicate = ObjPredicate();
+  predicate.SetLabels({1, 3}).SetMinScore(0.2f).SetAreaRange(0, 0.02f);
+  EXPECT_EQ(Evaluate(predicate, objs), std::vector<uint8_t>({0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0}));
+}
+
+TEST(ObjPredicate, Roi) {
+  const CNObjsVec objs = MakeObjs();
+  ObjPredicate predicate;
+  // the lower right triangle, the centers of the objects are on the diagonal from 0.06 to 0.96
+  predicate.SetRoi({{1, 0}, {1, 1}, {0, 1}});
+  std::vector<uint8_t> selected = Evaluate(predicate, objs);
+  EXPECT_EQ(selected, std::vector<uint8_t>({0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1}));
+  // a square in the middle
+  predicate.SetRoi({{0.3f, 0.3f}, {0.7f, 0.3f}, {0.7f, 0.7f}, {0.3f, 0.7f}});
+  selected = Evaluate(predicate, objs);
+  EXPECT_EQ(selected, std::vector<uint8_t>({0, 0, 0, 1, 1, 1, 1, 1, 0, 0, 0, 1}));
+  // a degenerate polygon contains nothing
+  predicate.SetRoi({{0, 0}, {1, 1}});
+  EXPECT_EQ(Evaluate(predicate, objs), std::vector<uint8_t>(objs.size(), 0));
+}
+
+class TestPredicateFilter : public PredicateObjFilter {
+ public:
+  TestPredicateFilter() { predicate_.SetLabels({2}); }
+};
+
+class TestScoreFilter : public ObjFilter {
+ public:
+  bool Filter(const CNFrameInfoPtr& finfo, const CNInferObjectPtr& obj) override { return obj->score > 0.5f; }
+};
+
+TEST(ObjPredicate, FilterObjects) {
+  const CNObjsVec objs = MakeObjs();
+  std::vector<uint8_t> selected;
+  TestPredicateFilter predicate_filter;
+  predicate_filter.FilterObjects(nullptr, objs, &selected);
+  EXPECT_EQ(selected, std::vector<uint8_t>({0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0}));
+  EXPECT_TRUE(predicate_filter.Filter(nullptr, objs[2]));
+  EXPECT_FALSE(predicate_filter.Filter(nullptr, objs[3]));
+  // the default implementation filters the objects one by one
+  TestScoreFilter score_filter;
+  score_filter.FilterObjects(nullptr, objs, &selected);
+  EXPECT_EQ(selected, std::vector<uint8_t>({0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1}));
+}
+
+}  // namespace cnstream
@@ -0,0 +1,251 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "feature_match_track.hpp"
+#include "feature_matrix.hpp"
+
+namespace cnstream {
+
+static std::vector<float> RandomFeature(std::mt19937 *gen, size_t dim) {
+  std::normal_distribution<float> dist(0, 1);
+  std::vector<float> feature(dim);
+  for (auto &v : feature) v = dist(*gen);
+  return feature;
+}
+
+TEST(TrackerFeatureMatch, CosineDistanceMatrix) {
+  std::mt19937 gen(7);
+  const size_t dim = 37;
+  std::vector<std::vector<float>> a_features, b_features;
+  FeatureMatrix a(dim), b(dim);
+  for (int i = 0; i < 7; ++i) {
+    a_features.push_back(RandomFeature(&gen, dim));
+    a.Append(a_features.back().data());
+  }
+  for (int i = 0; i < 5; ++i) {
+    b_features.push_back(RandomFeature(&gen, dim));
+    b.Append(b_features.back().data());
+  }
+  b.Append(nullptr);
+  EXPECT_EQ(a.Stride() % FeatureMatrix::kRowAlign, 0u);
+  std::vector<float> dist(a.Rows() * b.Rows());
+  CosineDistanceMatrix(a, b, dist.data());
+  for (size_t i = 0; i < a.Rows(); ++i) {
+    for (size_t j = 0; j < b_features.size(); ++j) {
+      double dot = 0, norm_a = 0, norm_b = 0;
+      for (size_t k = 0; k < dim; ++k) {
+        dot += a_features[i][k] * b_features[j][k];
+        norm_a += a_features[i][k] * a_features[i][k];
+        norm_b += b_features[j][k] * b_features[j][k];
+      }
+      EXPECT_NEAR(dist[i * b.Rows() + j], 1 - dot / std::sqrt(norm_a * norm_b), 1e-5);
+    }
+    // zero features are far from any feature
+    EXPECT_FLOAT_EQ(dist[i * b.Rows() + b.Rows() - 1], 1.f);
+  }
+  // the storage is reused
+  const float *row = a.Row(0);
+  a.Clear();
+  a.Append(a_features[0].data());
+  EXPECT_EQ(a.Row(0), row);
+}
+
+TEST(TrackerFeatureMatch, AppendDecoded) {
+  std::mt19937 gen(3);
+  const size_t dim = 29;
+  std::vector<float> feature = RandomFeature(&gen, dim);
+  FeatureMatrix a(dim), b(dim);
+  a.Append(feature.data());
+  b.Append([&feature](float *row) { std::copy(feature.begin(), feature.end(), row); });
+  for (size_t k = 0; k < b.Stride(); ++k) EXPECT_FLOAT_EQ(a.Row(0)[k], b.Row(0)[k]);
+  // zero features keep zero
+  b.Append([](float *row) {});
+  for (size_t k = 0; k < b.Stride(); ++k) EXPECT_EQ(b.Row(1)[k], 0.f);
+}
+
+TEST(TrackerFeatureMatch, KeepTrackIds) {
+  std::mt19937 gen(1);
+  const size_t dim = 128;
+  std::vector<float> person = RandomFeature(&gen, dim), car = RandomFeature(&gen, dim);
+  FeatureMatchTracker tracker(FeatureMatchTracker::Params{});
+  std::vector<TrackDetection> dets(2);
+  FeatureMatrix features(dim);
+  std::vector<int> ids, first_ids;
+  for (int n = 0; n < 20; ++n) {
+    dets[0].x = 0.1 + 0.005 * n, dets[0].y = 0.2, dets[0].w = 0.1, dets[0].h = 0.3, dets[0].label = 0;
+    dets[1].x = 0.7 - 0.005 * n, dets[1].y = 0.5, dets[1].w = 0.2, dets[1].h = 0.1, dets[1].label = 2;
+    features.Clear();
+    features.Append(person.data());
+    features.Append(car.data());
+    tracker.Update(dets, features, &ids);
+    ASSERT_EQ(ids.size(), 2u);
+    if (n == 0) first_ids = ids;
+    EXPECT_EQ(ids, first_ids);
+  }
+  EXPECT_NE(ids[0], ids[1]);
+  EXPECT_EQ(tracker.GetTrackNum(), 2u);
+  EXPECT_EQ(tracker.GetConfirmedTrackNum(), 2u);
+
+  // the object lost for several frames is matched by its feature
+  FeatureMatrix empty(dim);
+  std::vector<TrackDetection> none;
+  for (int n = 0; n < 5; ++n) tracker.Update(none, empty, &ids);
+  EXPECT_EQ(tracker.GetTrackNum(), 2u);
+  dets.resize(1);
+  dets[0].x = 0.25, dets[0].y = 0.22, dets[0].w = 0.1, dets[0].h = 0.3, dets[0].label = 0;
+  features.Clear();
+  features.Append(person.data());
+  tracker.Update(dets, features, &ids);
+  EXPECT_EQ(ids[0], first_ids[0]);
+}
+
+TEST(TrackerFeatureMatch, NewTracks) {
+  std::mt19937 gen(3);
+  const size_t dim = 64;
+  std::vector<float> feature = RandomFeature(&gen, dim);
+  FeatureMatchTracker::Params params;
+  params.max_age = 3;
+  FeatureMatchTracker tracker(params);
+  std::vector<TrackDetection> dets(1);
+  dets[0].x = 0.4, dets[0].y = 0.4, dets[0].w = 0.1, dets[0].h = 0.1, dets[0].label = 0;
+  FeatureMatrix features(dim);
+  features.Append(feature.data());
+  std::vector<int> ids;
+  tracker.Update(dets, features, &ids);
+  const int id = ids[0];
+
+  // objects of other labels are not matched
+  dets[0].label = 1;
+  tracker.Update(dets, features, &ids);
+  EXPECT_NE(ids[0], id);
+
+  // tentative tracks are removed once missed, confirmed tracks are removed after max_age frames
+  FeatureMatrix empty(dim);
+  std::vector<TrackDetection> none;
+  tracker.Update(none, empty, &ids);
+  EXPECT_EQ(tracker.GetTrackNum(), 0u);
+  dets[0].label = 0;
+  for (int n = 0; n < 3; ++n) tracker.Update(dets, features, &ids);
+  EXPECT_EQ(tracker.GetConfirmedTrackNum(), 1u);
+  for (int n = 0; n < 3; ++n) tracker.Update(none, empty, &ids);
+  EXPECT_EQ(tracker.GetTrackNum(), 1u);
+  tracker.Update(none, empty, &ids);
+  EXPECT_EQ(tracker.GetTrackNum(), 0u);
+}
+
+TEST(TrackerFeatureMatch, ReuseFeatures) {
+  std::mt19937 gen(5);
+  const size_t dim = 32;
+  std::vector<std::vector<float>> obj_features = {RandomFeature(&gen, dim), RandomFeature(&gen, dim),
+                                                  RandomFeature(&gen, dim)};
+  FeatureMatchTracker::Params params;
+  params.feature_reuse_frames = 3;
+  FeatureMatchTracker tracker(params);
+  std::vector<TrackDetection> dets(3);
+  FeatureMatrix features(dim);
+  std::vector<char> need_feature;
+  std::vector<int> ids, first_ids;
+  std::vector<int> skipped(3, 0), max_skipped(3, 0);
+  for (int n = 0; n < 20; ++n) {
+    // object 0 is alone, objects 1 and 2 overlap
+    dets[0].x = 0.1 + 0.002 * n, dets[0].y = 0.1, dets[0].w = 0.2, dets[0].h = 0.2;
+    dets[1].x = 0.5, dets[1].y = 0.5 + 0.002 * n, dets[1].w = 0.2, dets[1].h = 0.2;
+    dets[2].x = 0.6, dets[2].y = 0.55 + 0.002 * n, dets[2].w = 0.2, dets[2].h = 0.2;
+    for (auto &det : dets) det.label = 0;
+    tracker.SelectFeatureDetections(dets, &need_feature);
+    ASSERT_EQ(need_feature.size(), dets.size());
+    features.Clear();
+    for (size_t i = 0; i < dets.size(); ++i) {
+      dets[i].has_feature = need_feature[i];
+      features.Append(need_feature[i] ? obj_features[i].data() : nullptr);
+      skipped[i] = need_feature[i] ? 0 : skipped[i] + 1;
+      max_skipped[i] = std::max(max_skipped[i], skipped[i]);
+    }
+    tracker.Update(dets, features, &ids);
+    if (n == 0) first_ids = ids;
+    EXPECT_EQ(ids, first_ids);
+  }
+  // the feature of the stable track is refreshed every 4 frames
+  EXPECT_EQ(max_skipped[0], 3);
+  EXPECT_EQ(max_skipped[1], 0);
+  EXPECT_EQ(max_skipped[2], 0);
+
+  // features are always needed if reuse is disabled
+  FeatureMatchTracker no_reuse(FeatureMatchTracker::Params{});
+  for (int n = 0; n < 5; ++n) no_reuse.Update(dets, features, &ids);
+  no_reuse.SelectFeatureDetections(dets, &need_feature);
+  EXPECT_EQ(need_feature, std::vector<char>(3, 1));
+}
+
+TEST(TrackerFeatureMatch, MatchByIoUWithoutFeature) {
+  FeatureMatchTracker tracker(FeatureMatchTracker::Params{});
+  std::vector<TrackDetection> dets(3);
+  FeatureMatrix features;
+  std::vector<int> ids, first_ids;
+  for (int n = 0; n < 10; ++n) {
+    for (int i = 0; i < 3; ++i) {
+      dets[i].x = 0.1 + 0.3 * i + 0.002 * n, dets[i].y = 0.3, dets[i].w = 0.2, dets[i].h = 0.4, dets[i].label = 0;
+    }
+    tracker.Update(dets, features, &ids);
+    if (n == 0) first_ids = ids;
+    EXPECT_EQ(ids, first_ids);
+  }
+  EXPECT_EQ(tracker.GetConfirmedTrackNum(), 3u);
+}
+
+TEST(TrackerFeatureMatch, GridGatingSameAsAllPairs) {
+  // a crowd of small objects moving randomly, some of them are missed or appear in each frame
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> pos(0, 0.95), size(0.02, 0.06), step(-0.004, 0.004), prob(0, 1);
+  const int obj_num = 300;
+  std::vector<TrackDetection> objs(obj_num);
+  for (int i = 0; i < obj_num; ++i) {
+    objs[i].x = pos(gen), objs[i].y = pos(gen), objs[i].w = size(gen), objs[i].h = size(gen), objs[i].label = i % 3;
+  }
+  FeatureMatchTracker::Params params;
+  FeatureMatchTracker gated(params);
+  params.grid_gating = false;
+  FeatureMatchTracker all_pairs(params);
+  FeatureMatrix features;
+  std::vector<TrackDetection> dets;
+  std::vector<int> gated_ids, all_ids;
+  for (int n = 0; n < 30; ++n) {
+    dets.clear();
+    for (auto &obj : objs) {
+      obj.x += step(gen), obj.y += step(gen);
+      if (prob(gen) > 0.05) dets.push_back(obj);
+    }
+    std::shuffle(dets.begin(), dets.end(), gen);
+    gated.Update(dets, features, &gated_ids);
+    all_pairs.Update(dets, features, &all_ids);
+    ASSERT_EQ(gated_ids, all_ids) << "frame " << n;
+  }
+  EXPECT_EQ(gated.GetTrackNum(), all_pairs.GetTrackNum());
+  EXPECT_GT(gated.GetConfirmedTrackNum(), obj_num / 2u);
+}
+
+}  // namespace cnstream
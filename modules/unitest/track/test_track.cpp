@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "opencv2/highgui/highgui.hpp"
@@ -35,6 +36,7 @@
 #include "cnstream_module.hpp"
 #include "device/mlu_context.h"
 #include "easyinfer/mlu_memory_op.h"
+#include "feature_extractor.hpp"
 #include "test_base.hpp"
 #include "track.hpp"
 
@@ -101,6 +103,46 @@ TEST(Tracker, CheckParamSet) {
 
   param["max_cosine_distance"] = std::to_string(g_max_cosine_distance);
   EXPECT_TRUE(track->CheckParamSet(param));
+
+  param["batch_timeout"] = "fake_timeout";
+  EXPECT_FALSE(track->CheckParamSet(param));
+
+  param["batch_timeout"] = "10";
+  EXPECT_TRUE(track->CheckParamSet(param));
+  param["feature_reuse_frames"] = "fake_frames";
+  EXPECT_FALSE(track->CheckParamSet(param));
+
+  param["feature_reuse_frames"] = "3";
+  EXPECT_TRUE(track->CheckParamSet(param));
+  param["thread_num"] = "-1";
+  EXPECT_FALSE(track->CheckParamSet(param));
+
+  param["thread_num"] = "2";
+  EXPECT_TRUE(track->CheckParamSet(param));
+
+  param["drop_tentative"] = "yes";
+  EXPECT_FALSE(track->CheckParamSet(param));
+
+  param["drop_tentative"] = "true";
+  EXPECT_TRUE(track->CheckParamSet(param));
+
+  param["min_score"] = "fake_score";
+  EXPECT_FALSE(track->CheckParamSet(param));
+
+  param["min_score"] = "0.5";
+  EXPECT_TRUE(track->CheckParamSet(param));
+
+  param["warm_contexts"] = "fake_num";
+  EXPECT_FALSE(track->CheckParamSet(param));
+
+  param["warm_contexts"] = "4";
+  EXPECT_TRUE(track->CheckParamSet(param));
+
+  param["feature_precision"] = "fp8";
+  EXPECT_FALSE(track->CheckParamSet(param));
+
+  param["feature_precision"] = "int8";
+  EXPECT_TRUE(track->CheckParamSet(param));
 }
 
 TEST(Tracker, OpenClose) {
@@ -160,14 +202,14 @@ std::shared_ptr<CNFrameInfo> GenTestData(int iter, int obj_num) {
   return data;
 }
 
-std::shared_ptr<CNFrameInfo> GenTestYUVData(int iter, int obj_num) {
+std::shared_ptr<CNFrameInfo> GenTestYUVData(int iter, int obj_num, int stream_index = g_channel_id) {
   // prepare data
   int width = 1920;
   int height = 1080;
   cv::Mat img(height + height / 2, width, CV_8UC1);
 
-  auto data = cnstream::CNFrameInfo::Create(std::to_string(0));
-  data->SetStreamIndex(g_channel_id);
+  auto data = cnstream::CNFrameInfo::Create(std::to_string(stream_index));
+  data->SetStreamIndex(stream_index);
   std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
   frame->frame_id = 1;
   data->timestamp = 1000;
@@ -280,6 +322,58 @@ TEST(Tracker, ProcessCpuFeature) {
   }
 }
 
+TEST(Tracker, ProcessCpuQuantizedFeature) {
+  std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["feature_precision"] = "int8";
+  ASSERT_TRUE(track->Open(param));
+
+  auto data = GenTestImageData();
+  EXPECT_EQ(track->Process(data), 0);
+  CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+  ASSERT_FALSE(objs_holder->objs_.empty());
+  for (auto& obj : objs_holder->objs_) {
+    EXPECT_FALSE(obj->track_id.empty());
+    EXPECT_TRUE(obj->VisitQuantizedFeature("track", [](const CNInferQuantizedFeature& feature) {
+      EXPECT_EQ(feature.precision, CNFeaturePrecision::INT8);
+    }));
+  }
+  track->Close();
+}
+
+TEST(Tracker, CpuFeatureExtractor) {
+  // a crowded 1080p frame, the features of all the objects are extracted from one BGR image
+  const int width = 1920, height = 1080, obj_num = 64;
+  cv::Mat img(height, width, CV_8UC3);
+  cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+  auto data = cnstream::CNFrameInfo::Create(std::to_string(0));
+  std::shared_ptr<CNDataFrame> frame(new (std::nothrow) CNDataFrame());
+  frame->width = width;
+  frame->height = height;
+  frame->stride[0] = width;
+  frame->ctx.dev_type = DevContext::DevType::CPU;
+  frame->fmt = CNDataFormat::CN_PIXEL_FORMAT_BGR24;
+  void* ptr_cpu[1] = {img.data};
+  frame->CopyToSyncMem(ptr_cpu, false);
+  std::shared_ptr<CNInferObjs> objs_holder = std::make_shared<CNInferObjs>();
+  for (int i = 0; i < obj_num; ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = "0";
+    obj->bbox = {(i % 16) / 16.f, (i / 16) / 4.f, 1 / 16.f, 1 / 4.f};
+    objs_holder->objs_.push_back(obj);
+  }
+  data->collection.Add(kCNDataFrameTag, frame);
+  data->collection.Add(kCNInferObjsTag, objs_holder);
+
+  int done = 0;
+  FeatureExtractor extractor([&done](const CNFrameInfoPtr, bool valid) { done += valid; });
+  ASSERT_TRUE(extractor.ExtractFeature(data));
+  EXPECT_EQ(done, 1);
+  for (auto& obj : objs_holder->objs_) {
+    EXPECT_EQ(obj->GetFeature("track").size(), 512u);
+  }
+}
+
 TEST(Tracker, ProcessFeatureMatchCPU0) {
   // create track
   std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
@@ -380,6 +474,89 @@ TEST(Tracker, ProcessFeatureMatchCPU4) {
   }
 }
 
+TEST(Tracker, ProcessIoUMatchDropObjects) {
+  std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "IoUMatch";
+  param["drop_tentative"] = "true";
+  param["min_score"] = "0.5";
+  ASSERT_TRUE(track->Open(param));
+
+  int obj_num = 4;
+  int repeat_time = 5;
+  for (int n = 0; n < repeat_time; ++n) {
+    auto data = GenTestData(n, obj_num);
+    CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+    for (int i = 0; i < obj_num; ++i) objs_holder->objs_[i]->score = i % 2 ? 0.1 : 0.9;
+    EXPECT_EQ(track->Process(data), 0);
+    // tracks are confirmed in the third frame, the objects with low scores are always dropped
+    ASSERT_EQ(objs_holder->objs_.size(), n < 2 ? 0u : obj_num / 2u);
+    for (auto &obj : objs_holder->objs_) {
+      EXPECT_GE(obj->score, 0.5f);
+      EXPECT_FALSE(obj->track_id.empty());
+    }
+  }
+  track->Close();
+}
+
+TEST(Tracker, ProcessIoUMatchReuseContext) {
+  std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "IoUMatch";
+  param["drop_tentative"] = "true";
+  param["warm_contexts"] = "1";
+  ASSERT_TRUE(track->Open(param));
+
+  // the second stream gets the stream index and the context of the first one, the tracks are confirmed again
+  const int obj_num = 2;
+  for (const std::string stream_id : {"0", "1"}) {
+    track->OnStreamAdded(stream_id);
+    for (int n = 0; n < 3; ++n) {
+      auto data = GenTestData(n, obj_num);
+      data->stream_id = stream_id;
+      EXPECT_EQ(track->Process(data), 0);
+      CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+      EXPECT_EQ(objs_holder->objs_.size(), n < 2 ? 0u : static_cast<size_t>(obj_num));
+    }
+    auto eos = cnstream::CNFrameInfo::Create(stream_id, true);
+    eos->SetStreamIndex(g_channel_id);
+    EXPECT_EQ(track->Process(eos), 0);
+  }
+  track->Close();
+}
+
+TEST(Tracker, ProcessFeatureMatchCPUThreads) {
+  std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "FeatureMatch";
+  param["thread_num"] = "2";
+  ASSERT_TRUE(track->Open(param));
+
+  // streams processed by one thread are tracked by the workers concurrently
+  const int stream_num = 3, repeat_time = 5, obj_num = 2;
+  std::vector<CNFrameInfoPtr> datas;
+  for (int n = 0; n < repeat_time; ++n) {
+    for (int s = 0; s < stream_num; ++s) {
+      datas.push_back(GenTestYUVData(n, obj_num, s));
+      EXPECT_EQ(track->Process(datas.back()), 0);
+    }
+  }
+  for (int s = 0; s < stream_num; ++s) {
+    auto eos = cnstream::CNFrameInfo::Create(std::to_string(s), true);
+    eos->SetStreamIndex(s);
+    EXPECT_EQ(track->Process(eos), 0);
+  }
+  // the queued frames are tracked before Close returns
+  track->Close();
+
+  for (auto &data : datas) {
+    CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+    for (auto &obj : objs_holder->objs_) {
+      EXPECT_FALSE(obj->track_id.empty());
+    }
+  }
+}
+
 TEST(Tracker, ProcessFeatureMatchMLU1) {
   // create track
   std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
@@ -476,4 +653,45 @@ TEST(Tracker, ProcessFeatureMatchMLU3) {
   }
 }
 
+TEST(Tracker, ProcessFeatureMatchMLUMultiStream) {
+  // create track
+  std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "FeatureMatch";
+  param["batch_timeout"] = "10";
+  param["model_path"] = GetExePath() + GetDSModelPath();
+  if (infer_server::Predictor::Backend() != "magicmind") {
+    param["func_name"] = gfunc_name;
+  }
+  ASSERT_TRUE(track->Open(param));
+
+  // streams processed by different threads share the extractor
+  const int stream_num = 2, repeat_time = 10, obj_num = 2;
+  std::vector<std::vector<CNFrameInfoPtr>> datas(stream_num);
+  std::vector<std::thread> threads;
+  for (int s = 0; s < stream_num; ++s) {
+    threads.emplace_back([&, s] {
+      for (int n = 0; n < repeat_time; ++n) {
+        datas[s].push_back(GenTestYUVData(n, obj_num, s));
+        EXPECT_EQ(track->Process(datas[s].back()), 0);
+      }
+      // send eos to ensure data process done
+      auto eos = cnstream::CNFrameInfo::Create(std::to_string(s), true);
+      eos->SetStreamIndex(s);
+      EXPECT_EQ(track->Process(eos), 0);
+    });
+  }
+  for (auto &thread : threads) thread.join();
+
+  for (auto &stream_datas : datas) {
+    for (auto &data : stream_datas) {
+      CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+      for (auto &obj : objs_holder->objs_) {
+        EXPECT_FALSE(obj->track_id.empty());
+      }
+    }
+  }
+  track->Close();
+}
+
 }  // namespace cnstream
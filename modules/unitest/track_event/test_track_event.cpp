@@ -0,0 +1,190 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "track_event.hpp"
+
+namespace cnstream {
+
+static constexpr const char *gname = "track_event";
+
+class TrackEventObserver : public IModuleObserver {
+ public:
+  void notify(std::shared_ptr<CNFrameInfo> data) override { frames.push_back(data); }
+  std::vector<std::shared_ptr<CNFrameInfo>> frames;
+};
+
+struct TestObject {
+  std::string track_id;
+  float x;
+  float w;
+};
+
+static std::shared_ptr<CNFrameInfo> CreateFrame(const std::string &stream_id, const std::vector<TestObject> &objects) {
+  auto data = CNFrameInfo::Create(stream_id);
+  auto objs_holder = std::make_shared<CNInferObjs>();
+  std::vector<CNInferObjectPtr> objs;
+  for (const auto &it : objects) {
+    auto obj = objs_holder->CreateObject();
+    obj->id = "0";
+    obj->track_id = it.track_id;
+    obj->bbox = {it.x, 0.1f, it.w, 0.2f};
+    objs.push_back(obj);
+  }
+  objs_holder->Append(objs);
+  data->collection.Add(kCNInferObjsTag, objs_holder);
+  return data;
+}
+
+static TrackEvents GetEvents(const std::shared_ptr<CNFrameInfo> &data) {
+  if (!data->collection.HasValue(kTrackEventsTag)) return {};
+  return data->collection.Get<TrackEvents>(kTrackEventsTag);
+}
+
+static size_t GetObjectNum(const std::shared_ptr<CNFrameInfo> &data) {
+  return data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag)->GetSnapshot()->size();
+}
+
+TEST(TrackEvent, OpenClose) {
+  TrackEventEmitter module(gname);
+  ModuleParamSet params;
+  EXPECT_TRUE(module.Open(params));
+  params["update_interval"] = "-1";
+  EXPECT_FALSE(module.Open(params));
+  params["update_interval"] = "0";
+  params["move_threshold"] = "-0.1";
+  EXPECT_FALSE(module.Open(params));
+  params["move_threshold"] = "0";
+  params["lost_frames"] = "0";
+  EXPECT_FALSE(module.Open(params));
+  params["lost_frames"] = "1";
+  params["keep_objects"] = "yes";
+  EXPECT_FALSE(module.Open(params));
+  params["keep_objects"] = "true";
+  EXPECT_TRUE(module.Open(params));
+  module.Close();
+}
+
+TEST(TrackEvent, Lifecycle) {
+  TrackEventEmitter module(gname);
+  TrackEventObserver observer;
+  module.SetObserver(&observer);
+  size_t callback_events = 0;
+  module.SetTrackEventCallback([&](const TrackEvents &events) { callback_events += events.size(); });
+  ModuleParamSet params;
+  params["update_interval"] = "4";
+  params["move_threshold"] = "0.5";
+  params["lost_frames"] = "2";
+  ASSERT_TRUE(module.Open(params));
+
+  // appear, the object without a track id is kept without events
+  EXPECT_EQ(module.Process(CreateFrame("cam0", {{"1", 0.1f, 0.2f}, {"", 0.5f, 0.1f}})), 1);
+  ASSERT_EQ(observer.frames.size(), 1u);
+  TrackEvents events = GetEvents(observer.frames[0]);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].type, TrackEventType::APPEAR);
+  EXPECT_EQ(events[0].stream_id, "cam0");
+  EXPECT_EQ(events[0].track_id, "1");
+  EXPECT_EQ(events[0].frames, 1u);
+  ASSERT_NE(events[0].object, nullptr);
+  EXPECT_EQ(GetObjectNum(observer.frames[0]), 2u);
+
+  // small moves are not reported, the objects are removed from the frames
+  EXPECT_EQ(module.Process(CreateFrame("cam0", {{"1", 0.15f, 0.2f}})), 1);
+  EXPECT_TRUE(GetEvents(observer.frames[1]).empty());
+  EXPECT_EQ(GetObjectNum(observer.frames[1]), 0u);
+  // moved by 0.15 / 0.2 of the size since reported
+  EXPECT_EQ(module.Process(CreateFrame("cam0", {{"1", 0.25f, 0.2f}})), 1);
+  events = GetEvents(observer.frames[2]);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].type, TrackEventType::UPDATE);
+  EXPECT_FLOAT_EQ(events[0].bbox.x, 0.25f);
+  EXPECT_EQ(events[0].frames, 3u);
+  EXPECT_EQ(GetObjectNum(observer.frames[2]), 1u);
+
+  // reported every 4 frames even if it does not move
+  for (int i = 0; i < 4; ++i) EXPECT_EQ(module.Process(CreateFrame("cam0", {{"1", 0.25f, 0.2f}})), 1);
+  for (int i = 3; i < 6; ++i) EXPECT_TRUE(GetEvents(observer.frames[i]).empty());
+  events = GetEvents(observer.frames[6]);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].type, TrackEventType::UPDATE);
+
+  // the label changes
+  auto data = CreateFrame("cam0", {{"1", 0.25f, 0.2f}, {"2", 0.6f, 0.1f}});
+  data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag)->GetSnapshot()->at(0)->id = "1";
+  EXPECT_EQ(module.Process(data), 1);
+  events = GetEvents(observer.frames[7]);
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[0].type, TrackEventType::UPDATE);
+  EXPECT_EQ(events[0].label, "1");
+  EXPECT_EQ(events[1].type, TrackEventType::APPEAR);
+  EXPECT_EQ(events[1].track_id, "2");
+
+  // track 1 is lost after 2 frames
+  EXPECT_EQ(module.Process(CreateFrame("cam0", {{"2", 0.6f, 0.1f}})), 1);
+  EXPECT_TRUE(GetEvents(observer.frames[8]).empty());
+  EXPECT_EQ(module.Process(CreateFrame("cam0", {{"2", 0.6f, 0.1f}})), 1);
+  events = GetEvents(observer.frames[9]);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].type, TrackEventType::DISAPPEAR);
+  EXPECT_EQ(events[0].track_id, "1");
+  EXPECT_EQ(events[0].frame_id, 7u);
+  EXPECT_EQ(events[0].frames, 8u);
+  EXPECT_EQ(events[0].object, nullptr);
+
+  // the other streams are independent, the tracks left disappear at the end of the stream
+  EXPECT_EQ(module.Process(CreateFrame("cam1", {{"2", 0.6f, 0.1f}})), 1);
+  EXPECT_EQ(GetEvents(observer.frames[10]).size(), 1u);
+  EXPECT_EQ(module.Process(CNFrameInfo::Create("cam0", true)), 1);
+  ASSERT_EQ(observer.frames.size(), 12u);
+  EXPECT_TRUE(observer.frames[11]->IsEos());
+  events = GetEvents(observer.frames[11]);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].type, TrackEventType::DISAPPEAR);
+  EXPECT_EQ(events[0].stream_id, "cam0");
+  EXPECT_EQ(events[0].track_id, "2");
+  EXPECT_EQ(callback_events, 8u);
+  module.Close();
+}
+
+TEST(TrackEvent, KeepObjects) {
+  TrackEventEmitter module(gname);
+  TrackEventObserver observer;
+  module.SetObserver(&observer);
+  ModuleParamSet params;
+  params["update_interval"] = "0";
+  params["keep_objects"] = "true";
+  ASSERT_TRUE(module.Open(params));
+  for (int i = 0; i < 3; ++i) EXPECT_EQ(module.Process(CreateFrame("cam0", {{"1", 0.1f, 0.2f}})), 1);
+  ASSERT_EQ(observer.frames.size(), 3u);
+  EXPECT_EQ(GetEvents(observer.frames[0]).size(), 1u);
+  for (int i = 1; i < 3; ++i) {
+    EXPECT_TRUE(GetEvents(observer.frames[i]).empty());
+    EXPECT_EQ(GetObjectNum(observer.frames[i]), 1u);
+  }
+  module.Close();
+}
+
+}  // namespace cnstream
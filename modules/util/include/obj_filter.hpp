@@ -27,6 +27,7 @@
  *  This file contains a declaration of class ObjFilter
  */
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -68,6 +69,23 @@ class ObjFilter : virtual public ReflexObjectEx<ObjFilter> {
    * @return Returns true if this object is satisfied, otherwise returns false.
    */
   virtual bool Filter(const CNFrameInfoPtr& finfo, const CNInferObjectPtr& pobj) = 0;
+
+  /**
+   * @brief Filters all objects of the frame at once.
+   *
+   * @param finfo: The smart pointer of struct to store origin frame data, (objects are detected from this frame).
+   * @param objs: The objects of the frame.
+   * @param selected: Outputs whether each object is satisfied, 1 or 0, in the order of objs.
+   *
+   * @return None
+   *
+   * @note The default implementation calls Filter for each object. The filters working on the labels, scores and
+   *       bounding boxes only derive from PredicateObjFilter to evaluate all objects together.
+   */
+  virtual void FilterObjects(const CNFrameInfoPtr& finfo, const CNObjsVec& objs, std::vector<uint8_t>* selected) {
+    selected->resize(objs.size());
+    for (size_t i = 0; i < objs.size(); ++i) (*selected)[i] = Filter(finfo, objs[i]);
+  }
 };  // class ObjFilter
 
 }  // namespace cnstream
@@ -24,8 +24,12 @@
  *  This file contains a declaration of struct DiscardFrame
  */
 
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -34,7 +38,25 @@
 
 namespace cnstream {
 /**
- * @brief discard frame every n frames
+ * @brief Discards frames to lighten the downstream modules.
+ *
+ * With ``discard_interval`` n, one frame of every n frames of a stream is sent.
+ *
+ * With ``adaptive`` enabled, each stream has a discard ratio kept between ``min_discard_ratio`` and
+ * ``max_discard_ratio``, the frames discarded are spread evenly. Every ``control_interval_ms`` the load of the
+ * downstream modules is sampled from the pipeline (see Pipeline::GetModuleStates):
+ *   - the discard ratios are raised by ``adjust_step`` if the input queues of a downstream module are filled over
+ *     ``high_watermark`` or block their upstream modules, or if the latency of the stream exceeds
+ *     ``target_latency_ms``,
+ *   - and lowered by half a step if the queues are filled below half of ``high_watermark`` and the latency is below
+ *     80% of ``target_latency_ms``.
+ *
+ * The latency of each stream is measured over the last interval if tracing is enabled in the profiler config.
+ * Otherwise the process latencies of the downstream modules are summed up as the latency of all streams, which
+ * needs profiling enabled. Without profiling only the queues are watched.
+ *
+ * The frames discarded are recorded by the profiler of this module as dropped for ``discard``, and the adjustments
+ * are counted by the counters ``discard_ratio_raised`` and ``discard_ratio_lowered``.
  */
 
 class DiscardFrame : public Module, public ModuleCreator<DiscardFrame> {
@@ -53,7 +75,10 @@ class DiscardFrame : public Module, public ModuleCreator<DiscardFrame> {
    *
    * @param paramSet:
    * @verbatim
-   *       discard_interval:discard_interval
+   *       discard_interval: send one frame of every discard_interval frames
+   *       adaptive: adjust the discard ratios by the downstream load
+   *       target_latency_ms, min_discard_ratio, max_discard_ratio, adjust_step, high_watermark, control_interval_ms:
+   *         see the class description
    * @endverbatim
    *
    * @return if module open succeed
@@ -70,10 +95,8 @@ class DiscardFrame : public Module, public ModuleCreator<DiscardFrame> {
    *
    * @param data : Pointer to the frame info
    *
-   * @return whether process will discard frame
-   * @retval 0: donot discard frame
-   * @retval 1: discard frame
-   *
+   * @return The frames kept are sent by this module.
+   * @retval 1: succeed
    */
   int Process(std::shared_ptr<CNFrameInfo> data) override;
 
@@ -86,10 +109,56 @@ class DiscardFrame : public Module, public ModuleCreator<DiscardFrame> {
    */
   bool CheckParamSet(const ModuleParamSet& paramSet) const override;
 
+  /**
+   * @brief Runs on the thread of the upstream module, the process is light and never blocks.
+   *
+   * @return Returns true.
+   */
+  bool IsFusable() const override { return true; }
+
+  /**
+   * @brief Adjusts the discard ratios by one sample of the downstream load. It is called by Process every
+   * ``control_interval_ms`` if ``adaptive`` is enabled.
+   *
+   * @param queue_fill_ratio : the largest fill ratio of the input queues of the downstream modules, 1 if a module
+   *                           blocks its upstream modules
+   * @param latencies : the latency of each stream in milliseconds
+   * @param default_latency : the latency of the streams not in ``latencies``, negative if it is unknown
+   */
+  void Adjust(double queue_fill_ratio, const std::map<std::string, double>& latencies, double default_latency);
+
+  /**
+   * @brief Gets the discard ratio of a stream.
+   *
+   * @param stream_id : the stream id
+   *
+   * @return The ratio of the frames discarded, ``min_discard_ratio`` for an unknown stream.
+   */
+  double GetDiscardRatio(const std::string& stream_id);
+
   virtual ~DiscardFrame();
 
  private:
+  struct StreamState {
+    double discard_ratio = 0;
+    double keep_credit = 1;  // a frame is kept when the credit reaches 1
+    uint64_t frame_count = 0;
+  };
+  bool Keep(const std::string& stream_id);
+  void SampleLoad();
+
   int frame_Mod = 0;
+  bool adaptive_ = false;
+  double target_latency_ms_ = 200;
+  double min_discard_ratio_ = 0;
+  double max_discard_ratio_ = 0.8;
+  double adjust_step_ = 0.1;
+  double high_watermark_ = 0.8;
+  int control_interval_ms_ = 500;
+  std::mutex mutex_;  // guards the stream states
+  std::map<std::string, StreamState> streams_;
+  std::mutex sample_mutex_;  // only one thread samples the load, the others go on
+  std::chrono::steady_clock::time_point last_sample_;
 };  // class DiscardFrame
 
 }  // namespace cnstream
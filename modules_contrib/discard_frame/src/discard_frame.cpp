@@ -19,48 +19,178 @@
  *************************************************************************/
 #include "discard_frame.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <vector>
+
+#include "cnstream_pipeline.hpp"
+#include "profiler/module_profiler.hpp"
+#include "profiler/pipeline_profiler.hpp"
 
 namespace cnstream {
 DiscardFrame::DiscardFrame(const std::string& name) : Module(name) {
   hasTransmit_.store(1);
-  param_register_.SetModuleDesc("DiscardFrame is a module for discard frame every n frames.");
+  param_register_.SetModuleDesc("DiscardFrame is a module for discard frame every n frames,"
+                                " or by a discard ratio adjusted by the downstream load.");
   param_register_.Register("discard_interval",
                            "How many frames will be discarded between two frames"
                            " which will be sent to next modeule.");
+  param_register_.Register("adaptive", "Adjust the discard ratio of each stream by the downstream load,"
+                           " discard_interval is ignored. true or false. Default value is false.");
+  param_register_.Register("target_latency_ms", "The end-to-end latency kept by the adaptive discard,"
+                           " in milliseconds. Default value is 200.");
+  param_register_.Register("min_discard_ratio", "The lower bound of the discard ratios, from 0 to 1."
+                           " Default value is 0.");
+  param_register_.Register("max_discard_ratio", "The upper bound of the discard ratios, from 0 to 1."
+                           " Default value is 0.8.");
+  param_register_.Register("adjust_step", "The discard ratios are raised by the step when overloaded, and lowered"
+                           " by half of the step when idle. Default value is 0.1.");
+  param_register_.Register("high_watermark", "The downstream modules are overloaded when their input queues are"
+                           " filled over the ratio. Default value is 0.8.");
+  param_register_.Register("control_interval_ms", "The interval of sampling the downstream load, in milliseconds."
+                           " Default value is 500.");
 }
 
 bool DiscardFrame::Open(ModuleParamSet paramSet) {
-  if (paramSet.find("discard_interval") == paramSet.end()) {
-    // set the default value
-    frame_Mod = 0;
-    std::cout << "warning! use the default diacard_frame value." << std::endl;
-  } else {
-    frame_Mod = std::stoi(paramSet["discard_interval"]);
-    if (frame_Mod < 0) {
-      std::cout << "cannot give the negative value!" << std::endl;
-      return false;
+  if (!CheckParamSet(paramSet)) return false;
+  auto get = [&paramSet](const std::string& key, const std::string& default_value) {
+    auto it = paramSet.find(key);
+    return it == paramSet.end() ? default_value : it->second;
+  };
+  frame_Mod = std::stoi(get("discard_interval", "0"));
+  adaptive_ = get("adaptive", "false") == "true";
+  target_latency_ms_ = std::stod(get("target_latency_ms", "200"));
+  min_discard_ratio_ = std::stod(get("min_discard_ratio", "0"));
+  max_discard_ratio_ = std::stod(get("max_discard_ratio", "0.8"));
+  adjust_step_ = std::stod(get("adjust_step", "0.1"));
+  high_watermark_ = std::stod(get("high_watermark", "0.8"));
+  control_interval_ms_ = std::stoi(get("control_interval_ms", "500"));
+  std::lock_guard<std::mutex> lk(mutex_);
+  streams_.clear();
+  last_sample_ = std::chrono::steady_clock::now();
+  return true;
+}
+
+void DiscardFrame::Close() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  streams_.clear();
+}
+
+bool DiscardFrame::Keep(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto ret = streams_.emplace(stream_id, StreamState());
+  StreamState& stream = ret.first->second;
+  if (ret.second) stream.discard_ratio = min_discard_ratio_;
+  if (!adaptive_) return frame_Mod <= 1 || stream.frame_count++ % frame_Mod == 0;
+  // the frames kept are spread evenly, e.g. every other frame is kept at the ratio 0.5
+  stream.keep_credit += 1 - stream.discard_ratio;
+  if (stream.keep_credit < 1) return false;
+  stream.keep_credit -= 1;
+  return true;
+}
+
+void DiscardFrame::SampleLoad() {
+  Pipeline* pipeline = GetContainer();
+  if (!pipeline) return;
+  std::vector<AutoscaleSample> states = pipeline->GetModuleStates();
+  // the modules reached from this module, all modules if this module is fused into its upstream module
+  std::set<std::string> downstream;
+  auto self = std::find_if(states.begin(), states.end(),
+                           [this](const AutoscaleSample& state) { return state.module_name == GetName(); });
+  if (self != states.end()) {
+    std::deque<std::string> pending(self->next_modules.begin(), self->next_modules.end());
+    while (!pending.empty()) {
+      std::string name = pending.front();
+      pending.pop_front();
+      if (!downstream.insert(name).second) continue;
+      for (const auto& state : states) {
+        if (state.module_name != name) continue;
+        pending.insert(pending.end(), state.next_modules.begin(), state.next_modules.end());
+      }
     }
   }
-  return true;
+  double fill = 0;
+  double latency = 0;
+  bool latency_known = false;
+  for (const auto& state : states) {
+    if (state.module_name == GetName() || (self != states.end() && !downstream.count(state.module_name))) continue;
+    fill = std::max(fill, state.blocking_upstream ? 1.0 : state.queue_fill_ratio);
+    if (state.process_latency_ms > 0) {
+      latency += state.process_latency_ms;
+      latency_known = true;
+    }
+  }
+
+  std::map<std::string, double> latencies;
+  PipelineProfiler* profiler = pipeline->GetProfiler();
+  if (profiler && profiler->GetConfig().enable_tracing) {
+    PipelineProfile profile = profiler->GetProfileBefore(Clock::now(), Duration(control_interval_ms_));
+    for (const auto& stream : profile.overall_profile.stream_profiles) {
+      if (stream.completed) latencies[stream.stream_name] = stream.latency;
+    }
+  }
+  Adjust(fill, latencies, latency_known ? latency : -1);
 }
-void DiscardFrame::Close() { /*empty*/
+
+void DiscardFrame::Adjust(double queue_fill_ratio, const std::map<std::string, double>& latencies,
+                          double default_latency) {
+  uint64_t raised = 0, lowered = 0;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (auto& it : streams_) {
+      auto latency_it = latencies.find(it.first);
+      const double latency = latency_it == latencies.end() ? default_latency : latency_it->second;
+      double ratio = it.second.discard_ratio;
+      if (queue_fill_ratio >= high_watermark_ || latency > target_latency_ms_) {
+        ratio = std::min(ratio + adjust_step_, max_discard_ratio_);
+      } else if (queue_fill_ratio < high_watermark_ / 2 && latency < target_latency_ms_ * 0.8) {
+        ratio = std::max(ratio - adjust_step_ / 2, min_discard_ratio_);
+      }
+      if (ratio > it.second.discard_ratio) ++raised;
+      if (ratio < it.second.discard_ratio) ++lowered;
+      it.second.discard_ratio = ratio;
+    }
+  }
+  ModuleProfiler* profiler = GetProfiler();
+  if (profiler) {
+    if (raised) profiler->AddCounter("discard_ratio_raised", raised);
+    if (lowered) profiler->AddCounter("discard_ratio_lowered", lowered);
+  }
+}
+
+double DiscardFrame::GetDiscardRatio(const std::string& stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto it = streams_.find(stream_id);
+  return it == streams_.end() ? min_discard_ratio_ : it->second.discard_ratio;
 }
 
 int DiscardFrame::Process(std::shared_ptr<CNFrameInfo> data) {
-  if (0 == frame_Mod) {
-    hasTransmit_.store(0);
-    return 0;
-  } else {
-    if (data->frame.flags & CNFrameFlag::CN_FRAME_FLAG_EOS) {
-      container_->ProvideData(this, data);
+  if (data->IsEos()) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      streams_.erase(data->stream_id);
     }
-    if ((data->frame.frame_id + 1) % frame_Mod == 0) {
-      container_->ProvideData(this, data);
+    TransmitData(data);
+    return 1;
+  }
+  if (adaptive_) {
+    std::unique_lock<std::mutex> lk(sample_mutex_, std::try_to_lock);
+    const auto now = std::chrono::steady_clock::now();
+    if (lk.owns_lock() && now - last_sample_ >= std::chrono::milliseconds(control_interval_ms_)) {
+      last_sample_ = now;
+      SampleLoad();
     }
   }
+  if (Keep(data->stream_id)) {
+    TransmitData(data);
+  } else if (GetProfiler()) {
+    GetProfiler()->RecordDropped(data->stream_id, "discard");
+  }
   return 1;
 }
 
@@ -74,12 +204,30 @@ bool DiscardFrame::CheckParamSet(const ModuleParamSet& paramSet) const {
     }
   }
 
-  if (paramSet.find("discard_interval") != paramSet.end()) {
-    std::string err_msg;
-    if (!checker.IsNum({"discard_interval"}, paramSet, err_msg)) {
-      LOGE(MODULESCONTRIB) << "[DiscardFrame] " << err_msg;
-      return false;
-    }
+  std::string err_msg;
+  if (!checker.IsNum({"discard_interval", "target_latency_ms", "min_discard_ratio", "max_discard_ratio",
+                      "adjust_step", "high_watermark", "control_interval_ms"}, paramSet, err_msg, true)) {
+    LOGE(MODULESCONTRIB) << "[DiscardFrame] " << err_msg;
+    return false;
+  }
+  auto it = paramSet.find("adaptive");
+  if (it != paramSet.end() && it->second != "true" && it->second != "false") {
+    LOGE(MODULESCONTRIB) << "[DiscardFrame] adaptive must be true or false, but got " << it->second;
+    return false;
+  }
+  auto get = [&paramSet](const std::string& key, double default_value) {
+    auto it = paramSet.find(key);
+    return it == paramSet.end() ? default_value : std::stod(it->second);
+  };
+  const double min_ratio = get("min_discard_ratio", 0), max_ratio = get("max_discard_ratio", 0.8);
+  if (min_ratio > max_ratio || max_ratio > 1) {
+    LOGE(MODULESCONTRIB) << "[DiscardFrame] The discard ratios must be 0 <= min_discard_ratio <= max_discard_ratio"
+                         << " <= 1, but got " << min_ratio << " and " << max_ratio;
+    return false;
+  }
+  if (get("control_interval_ms", 500) < 1) {
+    LOGE(MODULESCONTRIB) << "[DiscardFrame] control_interval_ms must be greater than 0.";
+    return false;
   }
   return true;
 }
@@ -20,7 +20,9 @@
 
 #include <gtest/gtest.h>
 
+#include <map>
 #include <memory>
+#include <string>
 
 #include "discard_frame.hpp"
 #include "test_base.hpp"
@@ -58,19 +60,72 @@ TEST(DiscardFrame, OpenClose) {
   discard_frame->Close();
 }
 
+class DiscardFrameObserver : public IModuleObserver {
+ public:
+  void notify(std::shared_ptr<CNFrameInfo> data) override {
+    if (!data->IsEos()) ++frames[data->stream_id];
+  }
+  std::map<std::string, int> frames;
+};
+
 TEST(DiscardFrame, Process) {
   std::shared_ptr<Module> discard_frame = std::make_shared<DiscardFrame>(gname);
+  DiscardFrameObserver observer;
+  discard_frame->SetObserver(&observer);
   ModuleParamSet param;
-  auto data = cnstream::CNFrameInfo::Create(std::to_string(0));
-  EXPECT_EQ(discard_frame->Process(data), 0);
-
   param["discard_interval"] = std::to_string(3);
-  Pipeline Container("pipe");
-  Container.Start();
-  Container.AddModule(discard_frame);
-  discard_frame->Open(param);
-  EXPECT_EQ(discard_frame->Process(data), 1);
-  Container.Stop();
+  ASSERT_TRUE(discard_frame->Open(param));
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_EQ(discard_frame->Process(cnstream::CNFrameInfo::Create("0")), 1);
+  }
+  EXPECT_EQ(observer.frames["0"], 3);
+  EXPECT_EQ(discard_frame->Process(cnstream::CNFrameInfo::Create("0", true)), 1);
+  discard_frame->Close();
+}
+
+TEST(DiscardFrame, Adaptive) {
+  std::shared_ptr<DiscardFrame> discard_frame = std::make_shared<DiscardFrame>(gname);
+  DiscardFrameObserver observer;
+  discard_frame->SetObserver(&observer);
+  ModuleParamSet param;
+  param["adaptive"] = "true";
+  param["max_discard_ratio"] = "0.6";
+  param["min_discard_ratio"] = "0.8";
+  EXPECT_FALSE(discard_frame->Open(param));
+  param["min_discard_ratio"] = "0";
+  param["control_interval_ms"] = "100000";
+  param["target_latency_ms"] = "100";
+  param["adjust_step"] = "0.25";
+  ASSERT_TRUE(discard_frame->Open(param));
+
+  for (int i = 0; i < 4; ++i) discard_frame->Process(cnstream::CNFrameInfo::Create("0"));
+  discard_frame->Process(cnstream::CNFrameInfo::Create("1"));
+  EXPECT_EQ(observer.frames["0"], 4);
+
+  // overloaded queues raise the ratios of all streams up to the upper bound
+  discard_frame->Adjust(0.9, {}, -1);
+  EXPECT_DOUBLE_EQ(discard_frame->GetDiscardRatio("0"), 0.25);
+  EXPECT_DOUBLE_EQ(discard_frame->GetDiscardRatio("1"), 0.25);
+  discard_frame->Adjust(0.9, {}, -1);
+  discard_frame->Adjust(0.9, {}, -1);
+  EXPECT_DOUBLE_EQ(discard_frame->GetDiscardRatio("0"), 0.6);
+
+  // the latency of one stream is over the target, the other one is idle
+  discard_frame->Adjust(0.1, {{"0", 150}, {"1", 10}}, -1);
+  EXPECT_DOUBLE_EQ(discard_frame->GetDiscardRatio("0"), 0.6);
+  EXPECT_DOUBLE_EQ(discard_frame->GetDiscardRatio("1"), 0.475);
+  // the latency between 80% and 100% of the target keeps the ratio
+  discard_frame->Adjust(0.1, {}, 90);
+  EXPECT_DOUBLE_EQ(discard_frame->GetDiscardRatio("1"), 0.475);
+
+  observer.frames.clear();
+  for (int i = 0; i < 100; ++i) discard_frame->Process(cnstream::CNFrameInfo::Create("0"));
+  EXPECT_NEAR(observer.frames["0"], 40, 1);
+
+  // streams are forgotten after EOS
+  discard_frame->Process(cnstream::CNFrameInfo::Create("0", true));
+  EXPECT_DOUBLE_EQ(discard_frame->GetDiscardRatio("0"), 0);
+  discard_frame->Close();
 }
 
 }  // namespace cnstream
@@ -86,6 +86,13 @@ class FakeSink : public Module, public ModuleCreator<FakeSink> {
    * @return Returns true if this API run successfully. Otherwise, returns false.
    */
   bool CheckParamSet(const ModuleParamSet& paramSet) const override;
+
+  /**
+   * @brief Runs on the thread of the upstream module, the process is light and never blocks.
+   *
+   * @return Returns true.
+   */
+  bool IsFusable() const override { return true; }
 };  // class FakeSink
 
 }  // namespace cnstream
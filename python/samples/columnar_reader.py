@@ -0,0 +1,86 @@
+# Reads the files written by the ColumnarSink module.
+# It only depends on the standard library, the columns are converted to numpy arrays without copies if numpy is
+# installed. See modules/columnar_sink/include/columnar_batch.hpp for the layout.
+#
+# usage: python columnar_reader.py results.cncb
+
+import array
+import struct
+import sys
+
+MAGIC = 0x42434E43
+VERSION = 1
+
+INT32, INT64, FLOAT32, DICT = 1, 2, 3, 4
+_ARRAY_TYPES = {INT32: "i", INT64: "q", FLOAT32: "f"}
+
+_CHUNK = struct.Struct("=IIIIQ")
+_COLUMN = struct.Struct("=16sIIQ")
+_U32 = struct.Struct("=I")
+
+try:
+    import numpy
+    _NUMPY_TYPES = {INT32: numpy.int32, INT64: numpy.int64, FLOAT32: numpy.float32}
+except ImportError:
+    numpy = None
+
+
+def _to_array(data, column_type):
+    if numpy is not None:
+        return numpy.frombuffer(data, dtype=_NUMPY_TYPES[column_type])
+    values = array.array(_ARRAY_TYPES[column_type])
+    values.frombytes(data)
+    return values
+
+
+def _read_dict(data, rows):
+    count = _U32.unpack_from(data, 0)[0]
+    offset = _U32.size
+    entries = []
+    for _ in range(count):
+        size = _U32.unpack_from(data, offset)[0]
+        offset += _U32.size
+        entries.append(bytes(data[offset:offset + size]).decode("utf-8"))
+        offset += size
+    offset = (offset + 3) & ~3
+    indices = array.array("I")
+    indices.frombytes(data[offset:offset + 4 * rows])
+    return [entries[i] for i in indices]
+
+
+def read_chunks(path):
+    """Yields a dict of columns for each chunk of the file.
+
+    Numeric columns are numpy arrays, or array.array if numpy is not installed. The stream_id column is a list of
+    strings. Unknown columns are skipped.
+    """
+    with open(path, "rb") as f:
+        content = memoryview(f.read())
+    pos = 0
+    while pos + _CHUNK.size <= len(content):
+        magic, version, rows, column_count, chunk_size = _CHUNK.unpack_from(content, pos)
+        if magic != MAGIC or version != VERSION or pos + chunk_size > len(content):
+            raise ValueError("%s has no chunk of version %d at offset %d" % (path, VERSION, pos))
+        offset = pos + _CHUNK.size
+        columns = {}
+        for _ in range(column_count):
+            name, column_type, _, data_size = _COLUMN.unpack_from(content, offset)
+            offset += _COLUMN.size
+            data = content[offset:offset + data_size]
+            name = name.rstrip(b"\0").decode("utf-8")
+            if column_type == DICT:
+                columns[name] = _read_dict(data, rows)
+            elif column_type in _ARRAY_TYPES:
+                columns[name] = _to_array(data, column_type)
+            offset += (data_size + 7) & ~7
+        yield columns
+        pos += chunk_size
+
+
+if __name__ == "__main__":
+    total = 0
+    for index, chunk in enumerate(read_chunks(sys.argv[1])):
+        rows = len(chunk["frame_id"])
+        total += rows
+        print("chunk %d: %d objects of streams %s" % (index, rows, sorted(set(chunk["stream_id"]))))
+    print("%d objects in total" % total)
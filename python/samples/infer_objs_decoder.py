@@ -0,0 +1,97 @@
+# Decodes the messages encoded by cnstream::InferObjsCodec, e.g. the ones produced by BinaryKafkaHandler.
+# It only depends on the standard library, so that consumers do not need the cnstream package.
+# See modules/cnstream_infer_objs_codec.hpp for the format.
+
+import struct
+
+MAGIC = 0x4F494E43
+VERSION = 2
+FP16 = 1
+INT8 = 2
+
+_HEADER = struct.Struct("<IBBH")
+_U16 = struct.Struct("<H")
+_U32 = struct.Struct("<I")
+_FRAME = struct.Struct("<QqI")
+_OBJECT = struct.Struct("<5f")
+_ATTR = struct.Struct("<iif")
+_QFEATURE = struct.Struct("<IBf")
+
+
+class _Reader:
+    def __init__(self, data, offset):
+        self.data = memoryview(data)
+        self.pos = offset
+
+    def unpack(self, fmt):
+        if len(self.data) - self.pos < fmt.size:
+            raise ValueError("message is truncated")
+        values = fmt.unpack_from(self.data, self.pos)
+        self.pos += fmt.size
+        return values
+
+    def string(self, len_fmt=_U16):
+        length, = self.unpack(len_fmt)
+        if len(self.data) - self.pos < length:
+            raise ValueError("message is truncated")
+        value = bytes(self.data[self.pos:self.pos + length]).decode("utf-8", errors="replace")
+        self.pos += length
+        return value
+
+    def floats(self, count):
+        return list(self.unpack(struct.Struct("<%df" % count)))
+
+    def quantized(self, count, precision, scale):
+        if precision == FP16:
+            return list(self.unpack(struct.Struct("<%de" % count)))
+        if precision == INT8:
+            return [value * scale for value in self.unpack(struct.Struct("<%db" % count))]
+        raise ValueError("unsupported feature precision %d" % precision)
+
+
+def decode(data, offset=0):
+    """Decodes one message from data starting at offset.
+
+    Returns a tuple of the decoded frame and the offset of the next message. The frame is a dict with
+    stream_id, frame_id, timestamp, flags and objs. Every object is a dict with id, track_id, score, bbox (x, y, w, h),
+    attributes ({key: (id, value, score)}), extra_attributes ({key: value}) and features ({key: [float]}).
+    The features stored in half precision or 8-bit integers are restored to floats.
+    Raises ValueError if the data is not a valid message.
+    """
+    reader = _Reader(data, offset)
+    magic, version, flags, _ = reader.unpack(_HEADER)
+    if magic != MAGIC:
+        raise ValueError("not an inference objects message")
+    if version < 1 or version > VERSION:
+        raise ValueError("unsupported version %d" % version)
+    frame = {"stream_id": reader.string(), "flags": flags}
+    frame["frame_id"], frame["timestamp"], obj_count = reader.unpack(_FRAME)
+    objs = []
+    for _ in range(obj_count):
+        obj = {"id": reader.string(), "track_id": reader.string()}
+        obj["score"], x, y, w, h = reader.unpack(_OBJECT)
+        obj["bbox"] = (x, y, w, h)
+        obj["attributes"] = {}
+        count, = reader.unpack(_U16)
+        for _ in range(count):
+            key = reader.string()
+            obj["attributes"][key] = reader.unpack(_ATTR)
+        obj["extra_attributes"] = {}
+        count, = reader.unpack(_U16)
+        for _ in range(count):
+            key = reader.string()
+            obj["extra_attributes"][key] = reader.string(_U32)
+        obj["features"] = {}
+        count, = reader.unpack(_U16)
+        for _ in range(count):
+            key = reader.string()
+            dimension, = reader.unpack(_U32)
+            obj["features"][key] = reader.floats(dimension)
+        count, = reader.unpack(_U16) if version >= 2 else (0,)
+        for _ in range(count):
+            key = reader.string()
+            dimension, precision, scale = reader.unpack(_QFEATURE)
+            obj["features"][key] = reader.quantized(dimension, precision, scale)
+        objs.append(obj)
+    frame["objs"] = objs
+    return frame, reader.pos
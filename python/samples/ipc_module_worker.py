@@ -0,0 +1,57 @@
+# Runs a python module in a worker process started by the IpcWorkers module, so that python modules are not limited
+# to one core by the GIL of the pipeline process. The module is a cnstream.Module as used by cnstream::PyModule, its
+# open is called with the parameters, process is called on every frame, and close is called when the pipeline exits.
+# The inference objects of the frames are sent back to the pipeline. Modules transmitting the frames by themselves are
+# not supported.
+#
+# usage: python ipc_module_worker.py pyclass_name [key=value ...]
+#
+# e.g. the parameters of IpcWorkers in the pipeline configuration:
+#   "command" : "python3 ipc_module_worker.py my_module.MyModule threshold=0.5", "workers" : "4"
+
+import importlib
+import os
+import sys
+import traceback
+
+sys.path.append(os.path.split(os.path.realpath(__file__))[0] + "/../lib")
+import cnstream
+
+
+def create_module(pyclass_name):
+    module_name, class_name = pyclass_name.rsplit(".", 1)
+    return getattr(importlib.import_module(module_name), class_name)(class_name)
+
+
+def main():
+    if len(sys.argv) < 2 or "." not in sys.argv[1]:
+        print("usage: python ipc_module_worker.py pyclass_name [key=value ...]")
+        return 1
+    params = dict(arg.split("=", 1) for arg in sys.argv[2:])
+    worker = cnstream.IpcWorker()
+    if not worker.open():
+        return 1
+    module = create_module(sys.argv[1])
+    if not module.open(params):
+        print("[%s] open failed" % sys.argv[1])
+        worker.close()
+        return 1
+    try:
+        while worker.is_host_alive():
+            frame = worker.receive(100)
+            if frame is None:
+                continue
+            try:
+                module.process(frame)
+            except Exception:
+                # replied anyway, the pipeline waits for the frames in order
+                traceback.print_exc()
+            worker.reply(frame)
+    finally:
+        module.close()
+        worker.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
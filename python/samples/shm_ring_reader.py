@@ -0,0 +1,89 @@
+# Reads the results published by the ShmSink module from the shared memory ring.
+# It only depends on the standard library, so that consumers do not need the cnstream package.
+# See modules/shm_sink/include/shm_ring.hpp for the layout.
+#
+# usage: python shm_ring_reader.py [shm_name]
+
+import mmap
+import os
+import struct
+import sys
+import time
+
+import infer_objs_decoder
+
+MAGIC = 0x52534E43
+VERSION = 1
+
+_HEADER = struct.Struct("=IIIIQ")
+_HEADER_SIZE = 64
+_SLOT = struct.Struct("=QII")
+_U64 = struct.Struct("=Q")
+
+
+class ShmRingReader:
+    def __init__(self, name="cnstream_results", from_oldest=False):
+        """Attaches to the ring created by ShmSink. Raises ValueError if the shared memory is not a ring."""
+        fd = os.open("/dev/shm/" + name.lstrip("/"), os.O_RDONLY)
+        try:
+            self.shm = mmap.mmap(fd, 0, mmap.MAP_SHARED, mmap.PROT_READ)
+        finally:
+            os.close(fd)
+        magic, version, self.slot_count, self.slot_size, latest = _HEADER.unpack_from(self.shm, 0)
+        if magic != MAGIC or version != VERSION or self.slot_count == 0:
+            raise ValueError("%s is not a ring of version %d" % (name, VERSION))
+        self.slot_stride = (_SLOT.size + self.slot_size + 15) & ~15
+        if len(self.shm) < _HEADER_SIZE + self.slot_count * self.slot_stride:
+            raise ValueError("%s is truncated" % name)
+        if from_oldest:
+            self.next_seq = latest - self.slot_count + 1 if latest >= self.slot_count else 1
+        else:
+            self.next_seq = latest + 1
+        self.dropped = 0
+
+    def _latest(self):
+        return _U64.unpack_from(self.shm, 16)[0]
+
+    def read(self):
+        """Reads the next message without waiting.
+
+        Returns a tuple of the sequence number, the result and the thumbnail, None if no new message is published.
+        The result is a message of InferObjsCodec, the thumbnail is JPEG data or empty bytes.
+        """
+        while True:
+            latest = self._latest()
+            if self.next_seq > latest:
+                return None
+            if latest - self.next_seq >= self.slot_count:
+                self.dropped += latest - self.slot_count + 1 - self.next_seq
+                self.next_seq = latest - self.slot_count + 1
+            offset = _HEADER_SIZE + (self.next_seq - 1) % self.slot_count * self.slot_stride
+            lock, result_size, thumbnail_size = _SLOT.unpack_from(self.shm, offset)
+            valid = lock == 2 * self.next_seq and result_size + thumbnail_size <= self.slot_size
+            if valid:
+                data = offset + _SLOT.size
+                result = self.shm[data:data + result_size]
+                thumbnail = self.shm[data + result_size:data + result_size + thumbnail_size]
+                # the slot is overwritten while being copied if the lock is changed
+                valid = _U64.unpack_from(self.shm, offset)[0] == lock
+            seq = self.next_seq
+            self.next_seq += 1
+            if valid:
+                return seq, result, thumbnail
+            self.dropped += 1
+
+    def close(self):
+        self.shm.close()
+
+
+if __name__ == "__main__":
+    reader = ShmRingReader(sys.argv[1] if len(sys.argv) > 1 else "cnstream_results")
+    while True:
+        message = reader.read()
+        if message is None:
+            time.sleep(0.005)
+            continue
+        seq, result, thumbnail = message
+        frame, _ = infer_objs_decoder.decode(result)
+        print("[%d] stream %s frame %d: %d objects, thumbnail %d bytes, dropped %d" % (
+            seq, frame["stream_id"], frame["frame_id"], len(frame["objs"]), len(thumbnail), reader.dropped))
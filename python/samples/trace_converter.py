@@ -0,0 +1,105 @@
+# Converts the trace files streamed by the pipeline (profiler_config.trace_file) to the chrome tracing format, the
+# same as the one written by TraceSerializeHelper, to be opened by chrome://tracing or Perfetto UI.
+# It only depends on the standard library. See framework/core/include/profiler/trace_file.hpp for the format.
+#
+# usage: python trace_converter.py pipeline.cntrace trace.json
+
+import json
+import struct
+import sys
+
+MAGIC = 0x52544E43
+VERSION = 1
+
+STRING, EVENT, DROPPED = 1, 2, 3
+PIPELINE, MODULE = 0, 1
+
+_HEADER = struct.Struct("=II")
+
+
+class _Input(object):
+    def __init__(self, content):
+        self.content = content
+        self.pos = 0
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            if self.pos >= len(self.content):
+                raise EOFError()
+            byte = self.content[self.pos]
+            self.pos += 1
+            value |= (byte & 0x7f) << shift
+            if not byte & 0x80:
+                return value
+            shift += 7
+
+    def signed_varint(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+
+def read_events(path):
+    """Yields a dict for each event of the file, a truncated record at the end of the file is ignored.
+
+    The keys are stream_name, timestamp, module_name, process_name, level (PIPELINE or MODULE), end (True for the
+    process-end events) and time (nanoseconds of the steady clock).
+    """
+    with open(path, "rb") as f:
+        content = bytearray(f.read())
+    if len(content) < _HEADER.size or _HEADER.unpack_from(content, 0) != (MAGIC, VERSION):
+        raise ValueError("%s is not a trace file of version %d" % (path, VERSION))
+    data = _Input(content)
+    data.pos = _HEADER.size
+    strings = [""]
+    time = 0
+    try:
+        while data.pos < len(content):
+            tag = content[data.pos]
+            data.pos += 1
+            if tag == STRING:
+                data.varint()
+                size = data.varint()
+                if data.pos + size > len(content):
+                    return
+                strings.append(bytes(content[data.pos:data.pos + size]).decode("utf-8"))
+                data.pos += size
+            elif tag == DROPPED:
+                data.varint()
+            elif tag == EVENT:
+                flags = data.varint()
+                stream_id = data.varint()
+                timestamp = data.signed_varint()
+                module_id = data.varint()
+                process_id = data.varint()
+                time += data.signed_varint()
+                yield {"stream_name": strings[stream_id], "timestamp": timestamp, "module_name": strings[module_id],
+                       "process_name": strings[process_id], "level": flags >> 1, "end": bool(flags & 1),
+                       "time": time}
+            else:
+                raise ValueError("%s has an unknown record %d at offset %d" % (path, tag, data.pos - 1))
+    except EOFError:
+        return
+
+
+def to_chrome_event(event):
+    module_name = event["module_name"] if event["level"] == MODULE else "pipeline"
+    value = {"name": event["process_name"], "ph": "e" if event["end"] else "b", "ts": event["time"] // 1000,
+             "pid": module_name, "cat": "%s_%s_%s" % (event["stream_name"], module_name, event["process_name"]),
+             "id": event["timestamp"]}
+    if event["end"]:
+        value["args"] = {"stream_name": event["stream_name"], "timestamp": event["timestamp"]}
+    return value
+
+
+if __name__ == "__main__":
+    count = 0
+    with open(sys.argv[2], "w") as out:
+        out.write("[")
+        for event in read_events(sys.argv[1]):
+            out.write(",\n" if count else "\n")
+            out.write(json.dumps(to_chrome_event(event)))
+            count += 1
+        out.write("\n]\n")
+    print("%d events converted" % count)
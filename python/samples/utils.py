@@ -21,14 +21,16 @@ class PrintPerformance:
     def print_process_perf(self, profile):
         if self.perf_level <= 1:
             if self.perf_level == 1:
-                print("[Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms".format(
-                        profile.latency, profile.minimum_latency, profile.maximum_latency))
+                print("[Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms, (P50): {:.4f}ms, (P99): {:.4f}ms, (P999): {:.4f}ms".format(
+                        profile.latency, profile.minimum_latency, profile.maximum_latency,
+                    profile.latency_p50, profile.latency_p99, profile.latency_p999))
             print("[Counter]: {}, [Throughput]: {:.4f}fps".format(profile.counter, profile.fps))
         elif self.perf_level >= 2:
             print("[Counter]: {}, [Completed]: {}, [Dropped]: {}, [Ongoing]: {}".format(
                     profile.counter, profile.completed, profile.dropped, profile.ongoing))
-            print("[Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms".format(
-                    profile.latency, profile.minimum_latency, profile.maximum_latency))
+            print("[Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms, (P50): {:.4f}ms, (P99): {:.4f}ms, (P999): {:.4f}ms".format(
+                    profile.latency, profile.minimum_latency, profile.maximum_latency,
+                    profile.latency_p50, profile.latency_p99, profile.latency_p999))
             print("[Throughput]: {:.4f}fps".format(profile.fps))
 
         if self.perf_level >= 3:
@@ -36,8 +38,9 @@ class PrintPerformance:
             for stream_profile in profile.stream_profiles:
                 print("{: <15s} [Counter]: {}, [Completed]: {}, [Dropped]: {}".format("[" + stream_profile.stream_name + "]",
                        stream_profile.counter, stream_profile.completed, stream_profile.dropped))
-                print("{: <15s} [Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms".format("",
-                       stream_profile.latency, stream_profile.minimum_latency, stream_profile.maximum_latency))
+                print("{: <15s} [Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms, (P50): {:.4f}ms, (P99): {:.4f}ms, (P999): {:.4f}ms".format("",
+                       stream_profile.latency, stream_profile.minimum_latency, stream_profile.maximum_latency,
+                       stream_profile.latency_p50, stream_profile.latency_p99, stream_profile.latency_p999))
                 print("{: <15s} [Throughput]: {:.4f}fps".format("", stream_profile.fps))
 
     def print_pipeline_perf(self, profile, prefix_str):
@@ -119,7 +119,8 @@ class Yolov3Preproc(Preproc):
 
     def execute(self, input_shapes, frame_info):
         data_frame = frame_info.get_cn_data_frame()
-        bgr = data_frame.image_bgr()
+        # read-only, the image is not copied again
+        bgr = data_frame.image_bgr_view()
         src_w = data_frame.width
         src_h = data_frame.height
         dst_w = input_shapes[0][2]
@@ -51,7 +51,14 @@ void ConfigWrapper(py::module &m) {  // NOLINT
       .def("parse_by_json_str", &ProfilerConfig::ParseByJSONStr)
       .def_readwrite("enable_profiling", &ProfilerConfig::enable_profiling)
       .def_readwrite("enable_tracing", &ProfilerConfig::enable_tracing)
-      .def_readwrite("trace_event_capacity", &ProfilerConfig::trace_event_capacity);
+      .def_readwrite("trace_event_capacity", &ProfilerConfig::trace_event_capacity)
+      .def_readwrite("enable_latency_breakdown", &ProfilerConfig::enable_latency_breakdown)
+      .def_readwrite("enable_perf_counters", &ProfilerConfig::enable_perf_counters)
+      .def_readwrite("trace_file", &ProfilerConfig::trace_file)
+      .def_readwrite("trace_sample_interval", &ProfilerConfig::trace_sample_interval)
+      .def_readwrite("trace_streams", &ProfilerConfig::trace_streams)
+      .def_readwrite("trace_latency_threshold", &ProfilerConfig::trace_latency_threshold)
+      .def_readwrite("trace_burst_duration", &ProfilerConfig::trace_burst_duration);
   py::class_<CNModuleConfig, CNConfigBase>(m, "CNModuleConfig")
       .def(py::init())
       .def("parse_by_json_str", &CNModuleConfig::ParseByJSONStr)
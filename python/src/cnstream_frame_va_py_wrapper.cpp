@@ -23,11 +23,13 @@
 
 #include <algorithm>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "cnstream_frame.hpp"
 #include "cnstream_frame_va.hpp"
+#include "cnstream_infer_objs_codec.hpp"
 
 #include "common_wrapper.hpp"
 
@@ -51,6 +53,24 @@ std::shared_ptr<CNInferObjs> GetCNInferObjects(std::shared_ptr<CNFrameInfo> fram
   return frame->collection.Get<std::shared_ptr<CNInferObjs>>(kCNInferObjsTag);
 }
 
+// keeps the frame and its pixels alive as long as the arrays sharing them
+struct PixelsOwner {
+  std::shared_ptr<CNDataFrame> frame;
+  std::shared_ptr<void> pin;
+  cv::Mat mat;
+};
+
+// the array shares the pixels without copying them. It is read-only, as the pixels may be shared by other modules.
+static py::array PixelsToArray(std::shared_ptr<CNDataFrame> frame, std::shared_ptr<void> pin,
+                               std::vector<py::ssize_t> shape, std::vector<py::ssize_t> strides, const void* ptr,
+                               cv::Mat mat = cv::Mat()) {
+  py::capsule base(new PixelsOwner{std::move(frame), std::move(pin), mat},
+                   [](void *v) { delete reinterpret_cast<PixelsOwner*>(v); });
+  py::array array(py::dtype::of<uint8_t>(), std::move(shape), std::move(strides), ptr, base);
+  array.attr("setflags")(py::arg("write") = false);
+  return array;
+}
+
 void CNDataFrameWrapper(const py::module &m) {
   py::class_<CNDataFrame, std::shared_ptr<CNDataFrame>>(m, "CNDataFrame")
       .def(py::init([]() {
@@ -60,9 +80,39 @@ void CNDataFrameWrapper(const py::module &m) {
       .def("get_plane_bytes", &CNDataFrame::GetPlaneBytes)
       .def("get_bytes", &CNDataFrame::GetBytes)
       .def("image_bgr", [](std::shared_ptr<CNDataFrame> data_frame) {
-        cv::Mat bgr_img = data_frame->ImageBGR();
+        // the array may be modified in python
+        cv::Mat bgr_img = data_frame->ImageBGRMutable();
         return MatToArray(bgr_img);
       })
+      .def("image_bgr_view", [](std::shared_ptr<CNDataFrame> data_frame) {
+        // the image is shared with the frame, e.g. the cpu data of a BGR24 frame
+        std::shared_ptr<void> pin = data_frame->PinPixels();
+        cv::Mat bgr_img = data_frame->ImageBGR();
+        if (bgr_img.empty()) throw std::runtime_error("The frame has no pixels.");
+        return PixelsToArray(data_frame, pin, {bgr_img.rows, bgr_img.cols, 3},
+                             {static_cast<py::ssize_t>(bgr_img.step[0]), 3, 1}, bgr_img.data, bgr_img);
+      })
+      .def("plane", [](std::shared_ptr<CNDataFrame> data_frame, int plane_idx) {
+        if (plane_idx < 0 || plane_idx >= data_frame->GetPlanes()) throw std::out_of_range("Plane index out of range.");
+        std::shared_ptr<void> pin = data_frame->PinPixels();
+        if (!data_frame->data[plane_idx]) throw std::runtime_error("The frame has no pixels.");
+        const void* ptr = data_frame->data[plane_idx]->GetCpuData();
+        const py::ssize_t height = data_frame->height;
+        const py::ssize_t width = data_frame->width;
+        const py::ssize_t stride = data_frame->stride[plane_idx];
+        switch (data_frame->fmt) {
+          case CNDataFormat::CN_PIXEL_FORMAT_BGR24:
+          case CNDataFormat::CN_PIXEL_FORMAT_RGB24:
+            return PixelsToArray(data_frame, pin, {height, width, 3}, {stride * 3, 3, 1}, ptr);
+          case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12:
+          case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21:
+            if (plane_idx == 0) return PixelsToArray(data_frame, pin, {height, width}, {stride, 1}, ptr);
+            // the interleaved chroma samples
+            return PixelsToArray(data_frame, pin, {height / 2, width / 2, 2}, {stride, 2, 1}, ptr);
+          default:
+            throw std::invalid_argument("Data format is not supported.");
+        }
+      })
       .def("has_bgr_image", &CNDataFrame::HasBGRImage)
       .def("data", [](const CNDataFrame& data_frame, int plane_idx) {
           return data_frame.data[plane_idx].get();
@@ -118,10 +168,10 @@ void CNInferObjsWrapper(const py::module &m) {
       }, [](std::shared_ptr<CNInferObjs> objs_holder, std::vector<std::shared_ptr<CNInferObject>> objs) {
           std::lock_guard<std::mutex> lk(objs_holder->mutex_);
           objs_holder->objs_ = objs;
+          objs_holder->Publish();
       })
       .def("push_back", [](std::shared_ptr<CNInferObjs> objs_holder, std::shared_ptr<CNInferObject> obj) {
-          std::lock_guard<std::mutex> lk(objs_holder->mutex_);
-          objs_holder->objs_.push_back(obj);
+          objs_holder->Append({obj});
       });
 
 
@@ -187,9 +237,42 @@ void CNInferObjsWrapper(const py::module &m) {
       .def("get_features", &CNInferObject::GetFeatures);
 }
 
+void InferObjsCodecWrapper(const py::module &m) {
+  py::class_<InferObjsCodec> codec(m, "InferObjsCodec");
+  py::enum_<InferObjsCodec::Flags>(codec, "Flags", py::arithmetic())
+      .value("EXTRA_ATTRIBUTES", InferObjsCodec::EXTRA_ATTRIBUTES)
+      .value("FEATURES", InferObjsCodec::FEATURES)
+      .export_values();
+
+  py::class_<InferObjsCodec::Frame>(codec, "Frame")
+      .def(py::init<>())
+      .def_readwrite("stream_id", &InferObjsCodec::Frame::stream_id)
+      .def_readwrite("frame_id", &InferObjsCodec::Frame::frame_id)
+      .def_readwrite("timestamp", &InferObjsCodec::Frame::timestamp)
+      .def_readwrite("flags", &InferObjsCodec::Frame::flags)
+      .def_readwrite("objs", &InferObjsCodec::Frame::objs);
+
+  codec.def_static("encode", [](std::shared_ptr<CNFrameInfo> frame, uint8_t flags) {
+        std::string buffer;
+        if (!InferObjsCodec::Encode(frame, flags, &buffer)) {
+          throw std::invalid_argument("Encode inference objects of the frame failed.");
+        }
+        return py::bytes(buffer);
+      }, py::arg("frame"), py::arg("flags") = 0)
+      .def_static("decode", [](py::bytes data) {
+        std::string buffer = data;
+        InferObjsCodec::Frame frame;
+        if (!InferObjsCodec::Decode(buffer.data(), buffer.size(), &frame)) {
+          throw std::invalid_argument("Data is not a valid inference objects message.");
+        }
+        return frame;
+      });
+}
+
 void CNFrameVaWrapper(const py::module &m) {
   CNDataFrameWrapper(m);
   CNInferObjsWrapper(m);
+  InferObjsCodecWrapper(m);
 
   gPyframeRegister->def("get_cn_data_frame", &GetCNDataFrame);
   gPyframeRegister->def("get_cn_infer_objects", &GetCNInferObjects);
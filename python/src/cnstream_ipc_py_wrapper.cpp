@@ -0,0 +1,45 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <string>
+
+#include "ipc_worker.hpp"
+
+namespace py = pybind11;
+
+namespace cnstream {
+
+void IpcWrapper(const py::module &m) {
+  py::class_<IpcWorker>(m, "IpcWorker")
+      .def(py::init())
+      .def("open", static_cast<bool (IpcWorker::*)()>(&IpcWorker::Open))
+      .def("open", static_cast<bool (IpcWorker::*)(const std::string &, const std::string &)>(&IpcWorker::Open),
+           py::arg("input"), py::arg("output"))
+      .def("close", &IpcWorker::Close)
+      // the GIL is released while waiting, so that the other python threads of the worker keep running
+      .def("receive", &IpcWorker::Receive, py::arg("timeout_ms") = 100, py::call_guard<py::gil_scoped_release>())
+      .def("reply", &IpcWorker::Reply, py::call_guard<py::gil_scoped_release>())
+      .def("is_host_alive", &IpcWorker::IsHostAlive);
+}
+
+}  // namespace cnstream
@@ -193,6 +193,9 @@ void ModuleWrapper(py::module &m) {  // NOLINT
       .value("event_error", EventType::EVENT_ERROR)
       .value("event_warning", EventType::EVENT_WARNING)
       .value("event_stream_error", EventType::EVENT_STREAM_ERROR)
+      .value("event_control", EventType::EVENT_CONTROL)
+      .value("event_circuit_breaker", EventType::EVENT_CIRCUIT_BREAKER)
+      .value("event_degradation", EventType::EVENT_DEGRADATION)
       .export_values();
   py::class_<detail::Pybind11Module, detail::Pybind11ModuleV<detail::Pybind11Module>>(m, "Module")
       .def(py::init<const std::string&>())
@@ -27,6 +27,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace py = pybind11;
 
@@ -74,6 +75,8 @@ void PipelineWrapper(py::module &m) {  // NOLINT
            },
            py::return_value_policy::reference)
       .def("get_module_config", &Pipeline::GetModuleConfig)
+      .def("attach_branch", &Pipeline::AttachBranch, py::call_guard<py::gil_scoped_release>())
+      .def("detach_branch", &Pipeline::DetachBranch, py::call_guard<py::gil_scoped_release>())
       .def("is_profiling_enabled", &Pipeline::IsProfilingEnabled)
       .def("is_tracing_enabled", &Pipeline::IsTracingEnabled)
       .def("provide_data",
@@ -37,6 +37,7 @@ namespace cnstream {
 
 PostprocPyObjects::~PostprocPyObjects() {
   py::gil_scoped_acquire gil;
+  pyexecute_batch.release();
   pyexecute.release();
   pyinit.release();
   pyinstance.release();
@@ -139,6 +140,7 @@ bool PostprocPyObjects::Init(const std::map<std::string, std::string> &params) {
     pyinstance = pymodule.attr(pyclass_name.c_str())();
     pyinit = pyinstance.attr("init");
     pyexecute = pyinstance.attr("execute");
+    if (py::hasattr(pyinstance, "execute_batch")) pyexecute_batch = pyinstance.attr("execute_batch");
     auto tparams = params;
     tparams.erase("pyclass_name");
     return py::cast<bool>(pyinit(tparams));
@@ -172,6 +174,19 @@ std::vector<py::array> ToArray(const std::vector<float*> &vec, const std::vector
   return ret;
 }
 
+// the outputs of the whole batch, the n dimension is the number of the frames or objects
+static
+std::vector<py::array> ToBatchArray(const std::vector<float*> &vec, const std::vector<std::vector<int>> &shapes,
+                                    size_t batch_size) {
+  std::vector<py::array> ret;
+  for (size_t i = 0; i < vec.size(); ++i) {
+    auto sp = shapes[i];
+    sp[0] = static_cast<int>(batch_size);
+    ret.emplace_back(py::array(sp, vec[i]));
+  }
+  return ret;
+}
+
 int PyPostproc::Execute(const std::vector<float*> &net_outputs,
                         const std::shared_ptr<edk::ModelLoader> &model,
                         const cnstream::CNFrameInfoPtr &finfo) {
@@ -199,6 +214,39 @@ int PyObjPostproc::Execute(const std::vector<float*> &net_outputs,
   return 0;
 }
 
+int PyPostproc::ExecuteBatch(const std::vector<float*> &net_outputs,
+                             const std::shared_ptr<edk::ModelLoader> &model,
+                             const std::vector<CNFrameInfoPtr> &finfos) {
+  auto io_shapes = GetModelIOShapes(model);
+  try {
+    py::gil_scoped_acquire gil;
+    pyobjs_.pyexecute_batch(ToBatchArray(net_outputs, io_shapes.second, finfos.size()), io_shapes.first, finfos);
+  } catch (std::runtime_error e) {
+    LOGF(PyPostproc) << "[" << pyobjs_.pyclass_name << "] Call execute_batch failed : " << e.what();
+  }
+  return 0;
+}
+
+int PyObjPostproc::ExecuteBatch(
+    const std::vector<float*> &net_outputs, const std::shared_ptr<edk::ModelLoader> &model,
+    const std::vector<std::pair<CNFrameInfoPtr, std::shared_ptr<CNInferObject>>> &obj_infos) {
+  auto io_shapes = GetModelIOShapes(model);
+  std::vector<CNFrameInfoPtr> finfos;
+  std::vector<std::shared_ptr<CNInferObject>> objs;
+  for (const auto &obj_info : obj_infos) {
+    finfos.push_back(obj_info.first);
+    objs.push_back(obj_info.second);
+  }
+  try {
+    py::gil_scoped_acquire gil;
+    pyobjs_.pyexecute_batch(ToBatchArray(net_outputs, io_shapes.second, obj_infos.size()), io_shapes.first,
+                            finfos, objs);
+  } catch (std::runtime_error e) {
+    LOGF(PyObjPostproc) << "[" << pyobjs_.pyclass_name << "] Call execute_batch failed : " << e.what();
+  }
+  return 0;
+}
+
 int PyPostproc::Execute(const std::vector<void*> &net_outputs,
                         const std::shared_ptr<edk::ModelLoader> &model,
                         const std::vector<CNFrameInfoPtr> &finfos) {
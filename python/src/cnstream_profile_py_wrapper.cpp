@@ -18,13 +18,19 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "cnstream_pipeline.hpp"
 #include "profiler/module_profiler.hpp"
 #include "profiler/pipeline_profiler.hpp"
+#include "profiler/profile_snapshot.hpp"
 
 namespace py = pybind11;
 
@@ -35,11 +41,59 @@ void ProfileWrapper(const py::module &m) {
       .def(py::init())
       .def_readwrite("pipeline_name", &PipelineProfile::pipeline_name)
       .def_readwrite("module_profiles", &PipelineProfile::module_profiles)
-      .def_readwrite("overall_profile", &PipelineProfile::overall_profile);
+      .def_readwrite("overall_profile", &PipelineProfile::overall_profile)
+      .def_readwrite("memory_usage", &PipelineProfile::memory_usage)
+      .def_readwrite("stream_memory_usages", &PipelineProfile::stream_memory_usages)
+      .def_readwrite("latency_breakdowns", &PipelineProfile::latency_breakdowns)
+      .def_readwrite("device_utilizations", &PipelineProfile::device_utilizations)
+      .def_readwrite("startup_time", &PipelineProfile::startup_time);
+  py::class_<DeviceUtilization>(m, "DeviceUtilization")
+      .def(py::init())
+      .def_readwrite("device_id", &DeviceUtilization::device_id)
+      .def_readwrite("core_utilization", &DeviceUtilization::core_utilization)
+      .def_readwrite("memory_utilization", &DeviceUtilization::memory_utilization)
+      .def_readwrite("codec_utilization", &DeviceUtilization::codec_utilization);
+  py::class_<StreamLatencyBreakdown>(m, "StreamLatencyBreakdown")
+      .def(py::init())
+      .def_readwrite("stream_name", &StreamLatencyBreakdown::stream_name)
+      .def_readwrite("frames", &StreamLatencyBreakdown::frames)
+      .def_readwrite("latency", &StreamLatencyBreakdown::latency)
+      .def_readwrite("bottleneck_module", &StreamLatencyBreakdown::bottleneck_module)
+      .def_readwrite("modules", &StreamLatencyBreakdown::modules);
+  py::class_<ModuleLatencyBreakdown>(m, "ModuleLatencyBreakdown")
+      .def(py::init())
+      .def_readwrite("module_name", &ModuleLatencyBreakdown::module_name)
+      .def_readwrite("frames", &ModuleLatencyBreakdown::frames)
+      .def_readwrite("queue_wait", &ModuleLatencyBreakdown::queue_wait)
+      .def_readwrite("maximum_queue_wait", &ModuleLatencyBreakdown::maximum_queue_wait)
+      .def_readwrite("process", &ModuleLatencyBreakdown::process)
+      .def_readwrite("maximum_process", &ModuleLatencyBreakdown::maximum_process)
+      .def_readwrite("critical_frames", &ModuleLatencyBreakdown::critical_frames)
+      .def_readwrite("critical_queue_wait", &ModuleLatencyBreakdown::critical_queue_wait)
+      .def_readwrite("critical_process", &ModuleLatencyBreakdown::critical_process);
+  py::class_<MemoryUsage>(m, "MemoryUsage")
+      .def(py::init())
+      .def_readwrite("host_bytes", &MemoryUsage::host_bytes)
+      .def_readwrite("device_bytes", &MemoryUsage::device_bytes)
+      .def_readwrite("peak_host_bytes", &MemoryUsage::peak_host_bytes)
+      .def_readwrite("peak_device_bytes", &MemoryUsage::peak_device_bytes);
   py::class_<ModuleProfile>(m, "ModuleProfile")
       .def(py::init())
       .def_readwrite("module_name", &ModuleProfile::module_name)
-      .def_readwrite("process_profiles", &ModuleProfile::process_profiles);
+      .def_readwrite("process_profiles", &ModuleProfile::process_profiles)
+      .def_readwrite("stream_conveyors", &ModuleProfile::stream_conveyors)
+      .def_readwrite("counters", &ModuleProfile::counters)
+      .def_readwrite("frame_accounting", &ModuleProfile::frame_accounting)
+      .def_readwrite("stream_frame_accountings", &ModuleProfile::stream_frame_accountings)
+      .def_readwrite("open_begin", &ModuleProfile::open_begin)
+      .def_readwrite("open_time", &ModuleProfile::open_time);
+  py::class_<FrameAccounting>(m, "FrameAccounting")
+      .def(py::init())
+      .def_readwrite("stream_name", &FrameAccounting::stream_name)
+      .def_readwrite("received", &FrameAccounting::received)
+      .def_readwrite("dropped", &FrameAccounting::dropped)
+      .def_readwrite("dropped_by_reason", &FrameAccounting::dropped_by_reason)
+      .def_readwrite("stalled", &FrameAccounting::stalled);
   py::class_<ProcessProfile>(m, "ProcessProfile")
       .def(py::init())
       .def_readwrite("process_name", &ProcessProfile::process_name)
@@ -50,6 +104,9 @@ void ProfileWrapper(const py::module &m) {
       .def_readwrite("latency", &ProcessProfile::latency)
       .def_readwrite("maximum_latency", &ProcessProfile::maximum_latency)
       .def_readwrite("minimum_latency", &ProcessProfile::minimum_latency)
+      .def_readwrite("latency_p50", &ProcessProfile::latency_p50)
+      .def_readwrite("latency_p99", &ProcessProfile::latency_p99)
+      .def_readwrite("latency_p999", &ProcessProfile::latency_p999)
       .def_readwrite("fps", &ProcessProfile::fps)
       .def_readwrite("stream_profiles", &ProcessProfile::stream_profiles);
   py::class_<StreamProfile>(m, "StreamProfile")
@@ -61,6 +118,34 @@ void ProfileWrapper(const py::module &m) {
       .def_readwrite("latency", &StreamProfile::latency)
       .def_readwrite("maximum_latency", &StreamProfile::maximum_latency)
       .def_readwrite("minimum_latency", &StreamProfile::minimum_latency)
+      .def_readwrite("latency_p50", &StreamProfile::latency_p50)
+      .def_readwrite("latency_p99", &StreamProfile::latency_p99)
+      .def_readwrite("latency_p999", &StreamProfile::latency_p999)
       .def_readwrite("fps", &StreamProfile::fps);
+  // the changed counters are returned as arrays, so that a snapshot costs a few python objects however large the
+  // pipeline is
+  py::class_<ProfileDelta>(m, "ProfileDelta")
+      .def(py::init())
+      .def_readonly("reset", &ProfileDelta::reset)
+      .def_readonly("new_keys", &ProfileDelta::new_keys)
+      .def_property_readonly("indices", [](const ProfileDelta& delta) {
+        return py::array_t<uint32_t>(delta.indices.size(), delta.indices.data());
+      })
+      .def_property_readonly("values", [](const ProfileDelta& delta) {
+        return py::array_t<double>(delta.values.size(), delta.values.data());
+      });
+  py::class_<ProfileSnapshotter>(m, "ProfileSnapshotter")
+      .def(py::init([](Pipeline* pipeline) {
+        if (!pipeline->GetProfiler()) throw std::runtime_error("Profiling of the pipeline is not enabled.");
+        return new ProfileSnapshotter(pipeline->GetProfiler());
+      }), py::keep_alive<1, 2>())
+      .def("get_delta", [](ProfileSnapshotter* snapshotter) { return snapshotter->GetDelta(); },
+           py::call_guard<py::gil_scoped_release>())
+      .def("reset", &ProfileSnapshotter::Reset)
+      .def_static("flatten", [](const PipelineProfile& profile) {
+        std::vector<std::pair<std::string, double>> counters;
+        ProfileSnapshotter::Flatten(profile, &counters);
+        return counters;
+      });
 }
 }  // namespace cnstream
@@ -38,6 +38,7 @@ void PostprocWrapper(const py::module &m);
 void VideoPreprocWrapper(const py::module &);
 void VideoPostprocWrapper(const py::module &);
 void ProfileWrapper(const py::module &);
+void IpcWrapper(const py::module &);
 
 PYBIND11_MODULE(cnstream, m) {
   m.doc() = "cnstream python api";
@@ -55,6 +56,7 @@ PYBIND11_MODULE(cnstream, m) {
   VideoPreprocWrapper(m);
   VideoPostprocWrapper(m);
   ProfileWrapper(m);
+  IpcWrapper(m);
 }
 
 }  // namespace cnstream
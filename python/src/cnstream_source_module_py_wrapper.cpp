@@ -17,11 +17,13 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  *************************************************************************/
+#include <pybind11/functional.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "cnstream_source.hpp"
 #include "data_source.hpp"
@@ -86,8 +88,19 @@ void SourceModuleWrapper(const py::module &m) {
              return source->RemoveSource(stream_id, force);
            },
            py::arg("stream_id"), py::arg("force") = false, py::call_guard<py::gil_scoped_release>())
-      .def("remove_sources", &SourceModule::RemoveSources, py::arg("force") = false,
-          py::call_guard<py::gil_scoped_release>());
+      .def("add_sources", &SourceModule::AddSources, py::arg("handlers"), py::call_guard<py::gil_scoped_release>())
+      .def("remove_sources",
+           [](SourceModule* source, bool force) {
+             return source->RemoveSources(force);
+           },
+           py::arg("force") = false, py::call_guard<py::gil_scoped_release>())
+      .def("remove_sources",
+           [](SourceModule* source, const std::vector<std::string>& stream_ids, bool force) {
+             return source->RemoveSources(stream_ids, force);
+           },
+           py::arg("stream_ids"), py::arg("force") = false, py::call_guard<py::gil_scoped_release>())
+      .def("remove_sources_async", &SourceModule::RemoveSourcesAsync, py::arg("stream_ids"), py::arg("callback"),
+           py::arg("force") = false, py::call_guard<py::gil_scoped_release>());
 
   py::class_<SourceHandler, std::shared_ptr<SourceHandler>, detail::PySourceHandler>(m, "SourceHandler")
       .def(py::init<SourceModule*, const std::string&>())
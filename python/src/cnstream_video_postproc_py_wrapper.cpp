@@ -38,6 +38,7 @@ namespace cnstream {
 
 PyVideoPostproc::~PyVideoPostproc() {
   py::gil_scoped_acquire gil;
+  pyexecute_batch_.release();
   pyexecute_.release();
   pyinit_.release();
   pyinstance_.release();
@@ -101,6 +102,7 @@ bool PyVideoPostproc::Init(const std::unordered_map<std::string, std::string> &p
     pyinstance_ = pymodule.attr(pyclass_name.c_str())();
     pyinit_ = pyinstance_.attr("init");
     pyexecute_ = pyinstance_.attr("execute");
+    if (py::hasattr(pyinstance_, "execute_batch")) pyexecute_batch_ = pyinstance_.attr("execute_batch");
     auto tparams = params;
     tparams.erase("pyclass_name");
     return py::cast<bool>(pyinit_(tparams));
@@ -122,18 +124,23 @@ std::vector<py::array> ToArray(const std::vector<const float*> &vec, const std::
   return ret;
 }
 
-bool PyVideoPostproc::Execute(infer_server::InferData *output_data,
-                              const infer_server::ModelIO &model_output,
-                              const infer_server::ModelInfo *model_info) {
+static
+std::vector<py::array> ToArray(const infer_server::ModelIO &model_output) {
   std::vector<const float*> net_outputs;
   std::vector<std::vector<int64_t>> output_shapes;
   for (size_t i = 0; i < model_output.buffers.size(); ++i) {
     net_outputs.emplace_back(static_cast<const float*>(model_output.buffers[i].Data()));
     output_shapes.emplace_back(model_output.shapes[i].Vectorize());
   }
+  return ToArray(net_outputs, output_shapes);
+}
+
+bool PyVideoPostproc::Execute(infer_server::InferData *output_data,
+                              const infer_server::ModelIO &model_output,
+                              const infer_server::ModelInfo *model_info) {
   try {
     py::gil_scoped_acquire gil;
-    pyexecute_(output_data, ToArray(net_outputs, output_shapes), model_info);
+    pyexecute_(output_data, ToArray(model_output), model_info);
   } catch (std::runtime_error e) {
     LOGF(PyVideoPostproc) << "[" << pyclass_name_ << "] Call execute failed : " << e.what();
   }
@@ -141,6 +148,28 @@ bool PyVideoPostproc::Execute(infer_server::InferData *output_data,
   return true;
 }
 
+bool PyVideoPostproc::ExecuteBatch(const std::vector<infer_server::InferData*> &output_data,
+                                   const std::vector<const infer_server::ModelIO*> &model_outputs,
+                                   const infer_server::ModelInfo *model_info) {
+  try {
+    // the GIL is acquired once for all the inputs of the request
+    py::gil_scoped_acquire gil;
+    if (pyexecute_batch_) {
+      std::vector<std::vector<py::array>> net_outputs;
+      for (const auto &model_output : model_outputs) net_outputs.emplace_back(ToArray(*model_output));
+      pyexecute_batch_(output_data, net_outputs, model_info);
+    } else {
+      for (size_t i = 0; i < output_data.size(); ++i) {
+        pyexecute_(output_data[i], ToArray(*model_outputs[i]), model_info);
+      }
+    }
+  } catch (std::runtime_error e) {
+    LOGF(PyVideoPostproc) << "[" << pyclass_name_ << "] Call execute_batch failed : " << e.what();
+  }
+
+  return true;
+}
+
 void VideoPostprocWrapper(const py::module &m) {
   py::class_<detail::Pybind11VideoPostproc, detail::Pybind11VideoPostprocV>(m, "VideoPostproc")
       .def(py::init<>())
@@ -21,6 +21,7 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
@@ -32,6 +33,34 @@ namespace py = pybind11;
 
 namespace cnstream {
 
+// gets the size of a raw image from the shape of its array, [height, width, 3] or [height * 3 / 2, width]
+static bool GetRawImageSize(const CNDataFormat pixel_fmt, const std::vector<ssize_t>& shape, int* width,
+                            int* height) {
+  switch (pixel_fmt) {
+    case CNDataFormat::CN_PIXEL_FORMAT_BGR24:
+    case CNDataFormat::CN_PIXEL_FORMAT_RGB24:
+      if (shape.size() != 3) {
+        std::cout << "For RGB24/BGR24 data, the dim should be 3, but dim = " << shape.size() << std::endl;
+        return false;
+      }
+      *width = shape[1];
+      *height = shape[0];
+      return true;
+    case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12:
+    case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21:
+      if (shape.size() != 2) {
+        std::cout << "For YUVNV21/12 data, the dim should be 2, but dim = " << shape.size() << std::endl;
+        return false;
+      }
+      *width = shape[1];
+      *height = shape[0] * 2 / 3;
+      return true;
+    default:
+      std::cout << "Only support pixel format RGB24/BGR24/NV12/NV21" << std::endl;
+      return false;
+  }
+}
+
 void DataHandlerWrapper(const py::module &m) {
   py::class_<MaximumVideoResolution>(m, "MaximumVideoResolution")
       .def(py::init())
@@ -97,35 +126,35 @@ void DataHandlerWrapper(const py::module &m) {
       .def("write", [](std::shared_ptr<RawImgMemHandler> handler, const py::array_t<uint8_t>& data_array,
           const uint64_t pts, const CNDataFormat pixel_fmt = CNDataFormat::CN_PIXEL_FORMAT_BGR24) {
         py::buffer_info buf = data_array.request();
-        switch (pixel_fmt) {
-          case CNDataFormat::CN_PIXEL_FORMAT_BGR24:
-          case CNDataFormat::CN_PIXEL_FORMAT_RGB24:
-            if (buf.ndim != 3) {
-              std::cout << "For RGB24/BGR24 data, the dim should be 3, but dim = " << buf.ndim << std::endl;
-              return -1;
-            }
-            break;
-          case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12:
-          case CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21:
-            if (buf.ndim != 2) {
-              std::cout << "For YUVNV21/12 data, the dim should be 2, but dim = " << buf.ndim << std::endl;
-              return -1;
-            }
-            break;
-          default:
-            std::cout << "Only support pixel format RGB24/BGR24/NV12/NV21" << std::endl;
-            return -1;
+        int width, height;
+        if (!GetRawImageSize(pixel_fmt, buf.shape, &width, &height)) return -1;
+        return handler->Write(reinterpret_cast<uint8_t*>(buf.ptr), buf.size, pts, width, height, pixel_fmt);
+      }, py::arg().noconvert(), py::arg().noconvert(), py::arg("pixel_fmt") = CNDataFormat::CN_PIXEL_FORMAT_BGR24)
+      .def("write_batch", [](std::shared_ptr<RawImgMemHandler> handler,
+          const py::array_t<uint8_t, py::array::c_style | py::array::forcecast>& images,
+          const std::vector<uint64_t>& pts, const CNDataFormat pixel_fmt) {
+        // the images are stacked along the first dimension, i.e. [n, height, width, 3] or [n, height * 3 / 2, width]
+        py::buffer_info buf = images.request();
+        if (buf.ndim < 1 || static_cast<size_t>(buf.shape[0]) != pts.size()) {
+          std::cout << "The number of the images should be equal to the number of the pts" << std::endl;
+          return -1;
         }
         int width, height;
-        if (buf.ndim == 3) {
-          width = buf.shape[1];
-          height = buf.shape[0];
-        } else {
-          width = buf.shape[1];
-          height = buf.shape[0] * 2 / 3;
+        if (!GetRawImageSize(pixel_fmt, std::vector<ssize_t>(buf.shape.begin() + 1, buf.shape.end()), &width,
+                             &height)) {
+          return -1;
         }
-        return handler->Write(reinterpret_cast<uint8_t*>(buf.ptr), buf.size, pts, width, height, pixel_fmt);
-      }, py::arg().noconvert(), py::arg().noconvert(), py::arg("pixel_fmt") = CNDataFormat::CN_PIXEL_FORMAT_BGR24);
+        const size_t image_size = pts.empty() ? 0 : buf.size / pts.size();
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(buf.ptr);
+        py::gil_scoped_release release;
+        int written = 0;
+        for (; written < static_cast<int>(pts.size()); ++written) {
+          if (handler->Write(data + written * image_size, image_size, pts[written], width, height, pixel_fmt) != 0) {
+            break;
+          }
+        }
+        return written;
+      }, py::arg("images"), py::arg("pts"), py::arg("pixel_fmt") = CNDataFormat::CN_PIXEL_FORMAT_BGR24);
   py::class_<ESJpegMemHandler, std::shared_ptr<ESJpegMemHandler>, SourceHandler>(m, "ESJpegMemHandler")
       .def(py::init([](DataSource *module, const std::string &stream_id,
                        int max_width, int max_height) {
@@ -145,7 +174,58 @@ void DataHandlerWrapper(const py::module &m) {
           pkt.flags = static_cast<size_t>(cnstream::ESPacket::FLAG::FLAG_EOS);
         }
         return handler->Write(&pkt);
-      }, py::arg().noconvert(), py::arg().noconvert(), py::arg().noconvert(), py::arg("is_eos") = false);
+      }, py::arg().noconvert(), py::arg().noconvert(), py::arg().noconvert(), py::arg("is_eos") = false)
+      .def("write_batch", [](std::shared_ptr<ESJpegMemHandler> handler, const py::sequence& images,
+          const std::vector<uint64_t>& pts) {
+        // the images are any objects exposing a contiguous byte buffer, e.g. bytes or one-dimensional uint8 arrays
+        if (py::len(images) != pts.size()) {
+          std::cout << "The number of the images should be equal to the number of the pts" << std::endl;
+          return -1;
+        }
+        std::vector<py::buffer_info> bufs;
+        std::vector<ESPacket> pkts;
+        bufs.reserve(pts.size());
+        pkts.reserve(pts.size());
+        for (size_t i = 0; i < pts.size(); ++i) {
+          py::object image = images[i];
+          if (!PyObject_CheckBuffer(image.ptr())) break;
+          bufs.emplace_back(py::reinterpret_borrow<py::buffer>(image).request());
+          const py::buffer_info& buf = bufs.back();
+          if (buf.ndim != 1 || buf.itemsize != 1 || (buf.size > 1 && buf.strides[0] != 1)) break;
+          ESPacket pkt;
+          pkt.data = reinterpret_cast<unsigned char*>(buf.ptr);
+          pkt.size = buf.size;
+          pkt.pts = pts[i];
+          pkts.push_back(pkt);
+        }
+        // the buffers are released after the gil is acquired again
+        py::gil_scoped_release release;
+        return handler->WriteBatch(pkts.data(), pkts.size());
+      }, py::arg("images"), py::arg("pts"));
+  py::class_<ImageSetParam>(m, "ImageSetParam")
+      .def(py::init())
+      .def_readwrite("path", &ImageSetParam::path)
+      .def_readwrite("files", &ImageSetParam::files)
+      .def_readwrite("reader_num", &ImageSetParam::reader_num)
+      .def_readwrite("window", &ImageSetParam::window)
+      .def_readwrite("batch_size", &ImageSetParam::batch_size)
+      .def_readwrite("loop", &ImageSetParam::loop)
+      .def_readwrite("max_width", &ImageSetParam::max_width)
+      .def_readwrite("max_height", &ImageSetParam::max_height);
+  py::class_<ImageSetStats>(m, "ImageSetStats")
+      .def(py::init())
+      .def_readonly("written", &ImageSetStats::written)
+      .def_readonly("failed", &ImageSetStats::failed)
+      .def_readonly("read_bytes", &ImageSetStats::read_bytes)
+      .def_readonly("images_per_second", &ImageSetStats::images_per_second);
+  py::class_<ImageSetHandler, std::shared_ptr<ImageSetHandler>, ESJpegMemHandler>(m, "ImageSetHandler")
+      .def(py::init([](DataSource *module, const std::string &stream_id, const ImageSetParam &param) {
+        auto handler = ImageSetHandler::Create(module, stream_id, param);
+        return std::dynamic_pointer_cast<ImageSetHandler>(handler);
+      }), py::arg("module"), py::arg("stream_id"), py::arg("param"))
+      .def("open", &ImageSetHandler::Open)
+      .def("close", &ImageSetHandler::Close, py::call_guard<py::gil_scoped_release>())
+      .def("get_stats", &ImageSetHandler::GetStats);
 }
 
 }  // namespace cnstream
@@ -36,6 +36,7 @@ struct __attribute__((visibility("default"))) PostprocPyObjects {
   pybind11::object pyinstance;
   pybind11::object pyinit;
   pybind11::object pyexecute;
+  pybind11::object pyexecute_batch;  // optional, none if the python class does not define execute_batch
   std::map<std::string, std::string> params;
 };  // struct PostprocPyObjects
 
@@ -48,6 +49,9 @@ class __attribute__((visibility("default"))) PyPostproc : public Postproc {
               const cnstream::CNFrameInfoPtr &finfo) override;
   int Execute(const std::vector<void*> &net_outputs, const std::shared_ptr<edk::ModelLoader> &model,
               const std::vector<CNFrameInfoPtr> &finfos) override;
+  bool IsBatchExecute() const override { return static_cast<bool>(pyobjs_.pyexecute_batch); }
+  int ExecuteBatch(const std::vector<float*> &net_outputs, const std::shared_ptr<edk::ModelLoader> &model,
+                   const std::vector<CNFrameInfoPtr> &finfos) override;
 
  private:
   PostprocPyObjects pyobjs_;
@@ -63,6 +67,9 @@ class __attribute__((visibility("default"))) PyObjPostproc : public ObjPostproc
               const CNFrameInfoPtr &finfo, const std::shared_ptr<CNInferObject> &obj) override;
   int Execute(const std::vector<void*> &net_outputs, const std::shared_ptr<edk::ModelLoader> &model,
               const std::vector<std::pair<CNFrameInfoPtr, std::shared_ptr<CNInferObject>>> &obj_infos) override;
+  bool IsBatchExecute() const override { return static_cast<bool>(pyobjs_.pyexecute_batch); }
+  int ExecuteBatch(const std::vector<float*> &net_outputs, const std::shared_ptr<edk::ModelLoader> &model,
+                   const std::vector<std::pair<CNFrameInfoPtr, std::shared_ptr<CNInferObject>>> &obj_infos) override;
 
  private:
   PostprocPyObjects pyobjs_;
@@ -34,11 +34,15 @@ class __attribute__((visibility("default"))) PyVideoPostproc : public VideoPostp
   bool Init(const std::unordered_map<std::string, std::string> &params) override;
   bool Execute(infer_server::InferData *output_data, const infer_server::ModelIO &model_output,
                const infer_server::ModelInfo *model_info) override;
+  bool ExecuteBatch(const std::vector<infer_server::InferData*> &output_data,
+                    const std::vector<const infer_server::ModelIO*> &model_outputs,
+                    const infer_server::ModelInfo *model_info) override;
  private:
   std::string pyclass_name_;
   pybind11::object pyinstance_;
   pybind11::object pyinit_;
   pybind11::object pyexecute_;
+  pybind11::object pyexecute_batch_;  // optional, none if the python class does not define execute_batch
   DECLARE_REFLEX_OBJECT_EX(PyVideoPostproc, VideoPostproc);
 };  // class PyVideoPostproc
 
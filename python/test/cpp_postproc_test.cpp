@@ -49,7 +49,28 @@ bool TestPyObjPostproc(const std::map<std::string, std::string> &params) {
   return ret;
 }
 
+bool TestPyPostprocBatch(const std::map<std::string, std::string> &params, int batch_size) {
+  auto model = std::make_shared<edk::ModelLoader>("data/test_model.cambricon", "subnet0");
+  std::vector<float*> outputs;
+  for (uint32_t i = 0; i < model->OutputNum(); ++i) {
+    outputs.push_back(new float[model->OutputShape(i).DataCount() * batch_size]);
+  }
+  auto free_outputs = [&outputs] () {
+    for (auto ptr : outputs) delete[] ptr;
+  };
+  cnstream::PyPostproc pypostproc;
+  if (!pypostproc.Init(params) || !pypostproc.IsBatchExecute()) {
+    free_outputs();
+    return false;
+  }
+  std::vector<cnstream::CNFrameInfoPtr> finfos(batch_size, nullptr);
+  bool ret = 0 == pypostproc.ExecuteBatch(outputs, model, finfos);
+  free_outputs();
+  return ret;
+}
+
 void PostprocTestWrapper(py::module &m) {  // NOLINT
   m.def("cpptest_pypostproc", &TestPyPostproc);
+  m.def("cpptest_pypostproc_batch", &TestPyPostprocBatch);
   m.def("cpptest_pyobjpostproc", &TestPyObjPostproc);
 }
@@ -87,8 +87,12 @@ class TestSourceHandler():
         img_path = g_cur_dir + "/data/test_img_0.jpg"
         img = cv2.imread(img_path)
         assert 0 == file_handler.write(img, 0)
+        # stacked images
+        batch = np.ones([2, 720, 1280, 3], dtype=np.uint8)
+        assert 2 == file_handler.write_batch(batch, [1, 2], CNDataFormat.CN_PIXEL_FORMAT_BGR24)
+        assert -1 == file_handler.write_batch(batch, [3], CNDataFormat.CN_PIXEL_FORMAT_BGR24)
 
-        assert 3 == cpp_test_helper.get_count("stream_id_0")
+        assert 5 == cpp_test_helper.get_count("stream_id_0")
 
         file_handler.close()
         data_source.close()
@@ -113,8 +117,36 @@ class TestSourceHandler():
         data = binfile.read(file_size)
         rawdata = struct.unpack(file_size * 'B', data)
         assert 0 == handler.write(rawdata, file_size, 0)
+        assert 2 == handler.write_batch([data, np.frombuffer(data, dtype=np.uint8)], [1, 2])
+        # the images after an empty one are not written
+        assert 1 == handler.write_batch([data, b"", data], [3, 4, 5])
 
         # test eos
         assert -1 == handler.write([], 0, 0, True)
         handler.close()
-        data_source.close()
\ No newline at end of file
+        data_source.close()
+    def test_image_set_handler(self):
+        data_source = DataSource("test_source")
+        params = {"output_type" : "mlu", "device_id" : "0", "decoder_type" : "mlu"}
+        assert data_source.open(params)
+
+        cpp_test_helper = CppDataHanlderTestHelper()
+        cpp_test_helper.set_observer(data_source)
+
+        param = ImageSetParam()
+        param.path = g_cur_dir + "/data"
+        param.reader_num = 2
+        handler = ImageSetHandler(data_source, "stream_id_0", param)
+        # the handler is opened by add_source
+        assert 0 == data_source.add_source(handler)
+        time.sleep(1)
+        stats = handler.get_stats()
+        assert 1 == stats.written
+        assert 0 == stats.failed
+        assert stats.read_bytes == os.path.getsize(g_cur_dir + "/data/test_img_0.jpg")
+        assert 0 == data_source.remove_source("stream_id_0")
+
+        # no image
+        param.path = g_cur_dir + "/not_exist"
+        assert not ImageSetHandler(data_source, "stream_id_1", param).open()
+        data_source.close()
@@ -84,6 +84,43 @@ class TestFrameVa:
       assert img.all() == img_res.all()
       # cv2.imwrite("./test_img_res.jpg", img_res)
     
+    def test_dataframe_planes(self):
+      frame = CNFrameInfo("stream_id_0")
+      width = 1280
+      height = 720
+      stride = [1282, 1284]
+      src_data_frame = CNDataFrame()
+      src_data_frame.width = width
+      src_data_frame.height = height
+      src_data_frame.stride = stride
+      src_data_frame.fmt = CNDataFormat.CN_PIXEL_FORMAT_YUV420_NV12
+      src_data_frame.ctx.dev_type = DevType.CPU
+      set_data_frame(frame, src_data_frame)
+
+      data_frame = frame.get_cn_data_frame()
+      y = data_frame.plane(0)
+      uv = data_frame.plane(1)
+      assert_eq(y.shape, (height, width))
+      assert_eq(y.strides, (stride[0], 1))
+      assert_eq(uv.shape, (height // 2, width // 2, 2))
+      assert_eq(uv.strides, (stride[1], 2, 1))
+      # the arrays share the planes of the frame, they are read-only
+      assert_eq(y.flags.writeable, False)
+      assert_eq(y.flags.owndata, False)
+      try:
+        y[0, 0] = 1
+        assert False, "The plane should be read-only"
+      except ValueError:
+        pass
+      try:
+        data_frame.plane(2)
+        assert False, "The plane index should be out of range"
+      except IndexError:
+        pass
+      # the arrays keep the frame alive
+      del data_frame, src_data_frame, frame
+      assert_eq(int(y[height - 1, width - 1]), int(y.copy()[height - 1, width - 1]))
+
     def test_cninfer_objects(self):
       frame = CNFrameInfo("stream_id_0")
     
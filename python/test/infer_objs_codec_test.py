@@ -0,0 +1,71 @@
+import os, sys
+sys.path.append(os.path.split(os.path.realpath(__file__))[0] + "/../lib")
+sys.path.append(os.path.split(os.path.realpath(__file__))[0] + "/../samples")
+from cnstream import *
+from cnstream_cpptest import *
+import infer_objs_decoder
+
+def assert_eq(actual_val, expect_val):
+  assert actual_val == expect_val, "Actual value is " + str(actual_val) + ". Expect " + str(expect_val)
+
+class TestInferObjsCodec:
+    def create_frame(self):
+      frame = CNFrameInfo("stream_id_0")
+      set_infer_objs(frame, CNInferObjs())
+      objs_holder = frame.get_cn_infer_objects()
+      for i in range(3):
+        obj = CNInferObject()
+        obj.id = "1"
+        obj.track_id = str(i)
+        obj.score = 0.5
+        obj.bbox = CNInferBoundingBox(0.125, 0.25, 0.5, 0.75)
+        obj.add_attribute("color", CNInferAttr(0, i, 0.75))
+        obj.add_extra_attribute("plate", "A12345")
+        obj.add_feature("reid", [1.0, 2.0, 3.0])
+        objs_holder.push_back(obj)
+      return frame
+
+    def test_encode_and_decode(self):
+      data = InferObjsCodec.encode(self.create_frame(), InferObjsCodec.EXTRA_ATTRIBUTES | InferObjsCodec.FEATURES)
+      frame = InferObjsCodec.decode(data)
+      assert_eq(frame.stream_id, "stream_id_0")
+      assert_eq(len(frame.objs), 3)
+      for i, obj in enumerate(frame.objs):
+        assert_eq(obj.track_id, str(i))
+        assert_eq(obj.bbox.w, 0.5)
+        assert_eq(obj.get_attribute("color").value, i)
+        assert_eq(obj.get_extra_attribute("plate"), "A12345")
+        assert_eq(obj.get_feature("reid"), [1.0, 2.0, 3.0])
+
+      # without the optional parts
+      frame = InferObjsCodec.decode(InferObjsCodec.encode(self.create_frame()))
+      assert_eq(len(frame.objs[0].get_extra_attributes()), 0)
+      assert_eq(len(frame.objs[0].get_features()), 0)
+
+    def test_python_decoder(self):
+      data = InferObjsCodec.encode(self.create_frame(), InferObjsCodec.FEATURES)
+      data += InferObjsCodec.encode(CNFrameInfo("stream_id_1"))
+      frame, offset = infer_objs_decoder.decode(data)
+      assert_eq(frame["stream_id"], "stream_id_0")
+      assert_eq(len(frame["objs"]), 3)
+      obj = frame["objs"][2]
+      assert_eq(obj["track_id"], "2")
+      assert_eq(obj["score"], 0.5)
+      assert_eq(obj["bbox"], (0.125, 0.25, 0.5, 0.75))
+      assert_eq(obj["attributes"]["color"], (0, 2, 0.75))
+      assert_eq(obj["extra_attributes"], {})
+      assert_eq(obj["features"]["reid"], [1.0, 2.0, 3.0])
+      frame, offset = infer_objs_decoder.decode(data, offset)
+      assert_eq(frame["stream_id"], "stream_id_1")
+      assert_eq(len(frame["objs"]), 0)
+      assert_eq(offset, len(data))
+
+    def test_decode_failed(self):
+      data = InferObjsCodec.encode(self.create_frame())
+      for decode in [InferObjsCodec.decode, infer_objs_decoder.decode]:
+        for invalid in [data[:len(data) - 1], b"{\"StreamName\":\"stream_id_0\"}"]:
+          try:
+            decode(invalid)
+            assert False, "decoding invalid data should fail"
+          except ValueError:
+            pass
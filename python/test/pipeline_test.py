@@ -99,6 +99,20 @@ class TestPipeline:
         assert pipeline.is_root_node("test_module")
         assert not pipeline.is_root_node("test_not")
 
+    def test_profile_snapshotter(self):
+        pipeline = Pipeline("test_pipeline")
+        config = CreateConfigWithSourceModule()
+        assert pipeline.build_pipeline(config)
+        snapshotter = ProfileSnapshotter(pipeline)
+        delta = snapshotter.get_delta()
+        assert delta.reset
+        assert len(delta.new_keys) == len(delta.indices) == len(delta.values)
+        assert "overall/fps" in delta.new_keys
+        delta = snapshotter.get_delta()
+        assert not delta.reset
+        assert not delta.new_keys
+        assert len(delta.indices) == len(delta.values)
+
     def test_register_frame_done_cb(self):
         # TODO: wait for data handler api
         pass
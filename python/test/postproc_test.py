@@ -10,8 +10,10 @@ postproc_params = None
 obj_init_called = False
 obj_execute_called = False
 obj_postproc_params = None
+batch_execute_called = False
 received_input_shapes = None
 received_output_shape = None
+received_finfos_num = 0
 
 class CustomPostproc(Postproc):
     def __init__(self):
@@ -32,6 +34,26 @@ class CustomPostproc(Postproc):
         received_input_shapes = input_shapes
         received_output_shape = net_outputs[0].shape
 
+class CustomBatchPostproc(Postproc):
+    def __init__(self):
+        Postproc.__init__(self)
+
+    def init(self, params):
+        return True
+
+    def execute(self, net_outputs, input_shapes, finfo):
+        pass
+
+    def execute_batch(self, net_outputs, input_shapes, finfos):
+        global batch_execute_called
+        batch_execute_called = True
+        global received_input_shapes
+        global received_output_shape
+        global received_finfos_num
+        received_input_shapes = input_shapes
+        received_output_shape = net_outputs[0].shape
+        received_finfos_num = len(finfos)
+
 class CustomObjPostproc(ObjPostproc):
     def __init__(self):
         ObjPostproc.__init__(self)
@@ -67,6 +89,18 @@ class TestPostproc:
         assert expected_input_shapes == received_input_shapes
         assert expected_output_shape == received_output_shape
 
+    def test_postproc_batch(self):
+        params = {'pyclass_name' : 'test.postproc_test.CustomBatchPostproc'}
+        assert cpptest_pypostproc_batch(params, 3)
+        # test cpp call python execute_batch function once for the batch
+        assert batch_execute_called
+        assert 3 == received_finfos_num
+        # check I/O shapes, the outputs of the batch are in one array
+        expected_input_shapes = [[4, 160, 40, 4]]
+        expected_output_shape = (3, 20, 1, 84)
+        assert expected_input_shapes == received_input_shapes
+        assert expected_output_shape == received_output_shape
+
     def test_obj_postproc(self):
         params = {'pyclass_name' : 'test.postproc_test.CustomObjPostproc', 'param' : 'value'}
         assert cpptest_pyobjpostproc(params)
@@ -47,3 +47,15 @@ def test_source():
     assert handler2 == source.get_source_handler("stream_id_2")
     assert 0 == source.remove_sources()
     assert None == source.get_source_handler("stream_id_2")
+
+
+def test_bulk_sources():
+    source = CustomSourceModule("source_test")
+    handlers = [CustomSourceHandler(source, "stream_id_" + str(i)) for i in range(3)]
+    assert 3 == source.add_sources(handlers)
+    assert 0 == source.remove_sources(["stream_id_0"])
+    assert None == source.get_source_handler("stream_id_0")
+    removed = []
+    assert 0 == source.remove_sources_async(["stream_id_1", "stream_id_2"], removed.append)
+    assert 0 == source.remove_sources()
+    assert ["stream_id_1", "stream_id_2"] == removed
@@ -0,0 +1,617 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+// cns_bench measures the capacity of a pipeline with synthetic streams. The streams are raw frames generated in
+// memory or an elementary stream file loaded in memory and looped, so that reading files does not count. The
+// modules after the source are a chain of null modules busy waiting for a while, or the graph of a config file.
+// For each parallelism and max_input_queue_size, it measures the frame rate and the latency from writing the
+// frames to the source to the end of the pipeline, and with ``--streams=auto``, the max number of streams running in
+// real time.
+//
+// With ``--tune_modules``, engine_num, batching_timeout and batch_strategy of the Inferencer2 modules of the config
+// are swept with the parallelism, the cases no other case beats in both throughput and p99 latency are printed, and
+// the module configs of the fastest of them within max_latency_ms are written to ``--tuned_config``.
+//
+// e.g. an H.264 stream of 1080p made by ffmpeg and 4 null modules taking 2ms per frame:
+//   ffmpeg -f lavfi -i testsrc=size=1920x1080:rate=25 -t 10 -c:v libx264 -bsf:v h264_mp4toannexb 1080p.h264
+//   ./cns_bench --source=h264 --es_file=1080p.h264 --null_modules=4 --busy_us=2000
+//               --parallelism=1,2,4 --queue_size=4,20 --streams=auto
+//
+// e.g. tuning the detector of a config on 16 streams with p99 latency up to 200ms:
+//   ./cns_bench --source=h264 --es_file=1080p.h264 --config_fname=detection.json --tune_modules=detector
+//               --streams=16 --parallelism=1,2 --engine_num=1,2,4 --batching_timeout=50,300
+//               --batch_strategy=dynamic,static --max_latency_ms=200 --tuned_config=tuned.json
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_logging.hpp"
+#include "cnstream_pipeline.hpp"
+#include "data_source.hpp"
+
+DEFINE_string(source, "raw", "the streams, raw for nv12 frames generated in memory, h264 or h265 for es_file");
+DEFINE_string(es_file, "", "the h264 or h265 elementary stream with start codes, it is loaded in memory and looped");
+DEFINE_string(resolution, "1920x1080", "the resolution of the raw frames");
+DEFINE_double(fps, 25, "the frame rate of each stream, 0 means writing frames as fast as possible");
+DEFINE_string(streams, "1", "the numbers of streams, e.g. 1,4,16. auto searches the max number of streams running "
+              "at fps, up to max_streams");
+DEFINE_int32(max_streams, 64, "the max number of streams searched with --streams=auto");
+DEFINE_double(max_latency_ms, 0, "with --streams=auto, the streams are not real time if the p99 latency exceeds it. "
+              "0 means no limit");
+DEFINE_string(config_fname, "", "the graph config, the source module of it is named source. If it is empty, the "
+              "source is followed by null_modules null modules");
+DEFINE_int32(null_modules, 1, "the number of null modules after the source");
+DEFINE_int32(busy_us, 0, "the time each null module busy waits for a frame, in microseconds");
+DEFINE_string(parallelism, "1", "the parallelism of the modules except the source, e.g. 1,2,4");
+DEFINE_string(queue_size, "20", "the max_input_queue_size of the modules except the source, e.g. 4,20");
+DEFINE_string(tune_modules, "", "the Inferencer2 modules of config_fname tuned, e.g. detector,classifier. The "
+              "engine_num, batching_timeout and batch_strategy below are swept for them");
+DEFINE_string(engine_num, "1", "the engine_num of the tuned modules, e.g. 1,2,4");
+DEFINE_string(batching_timeout, "1000", "the batching_timeout of the tuned modules in milliseconds, e.g. 50,300");
+DEFINE_string(batch_strategy, "dynamic", "the batch_strategy of the tuned modules, e.g. dynamic,static");
+DEFINE_string(tuned_config, "", "the file the module configs of the fastest case on the Pareto front within "
+              "max_latency_ms are written to, it is not written if it is empty");
+DEFINE_string(decoder_type, "mlu", "the decoder_type of the source, mlu or cpu");
+DEFINE_string(output_type, "cpu", "the output_type of the source, mlu or cpu");
+DEFINE_int32(device_id, 0, "the device of the source");
+DEFINE_int32(warmup, 2, "the seconds each case runs before being measured");
+DEFINE_int32(duration, 10, "the seconds each case is measured");
+
+namespace cnstream {
+
+/**
+ * BenchNullModule busy waits for ``busy_us`` microseconds for each frame, it keeps a thread busy as a module
+ * processing on CPU does.
+ */
+class BenchNullModule : public Module, public ModuleCreator<BenchNullModule> {
+ public:
+  explicit BenchNullModule(const std::string &name) : Module(name) {}
+  bool Open(ModuleParamSet params) override {
+    busy_ = std::chrono::microseconds(params.count("busy_us") ? std::stoi(params["busy_us"]) : 0);
+    return true;
+  }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    if (busy_.count() <= 0) return 0;
+    auto end = std::chrono::steady_clock::now() + busy_;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+    return 0;
+  }
+
+ private:
+  std::chrono::microseconds busy_{0};
+};  // class BenchNullModule
+
+}  // namespace cnstream
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char *kSourceName = "source";
+// the write times of the frames in flight are kept in a ring per stream, indexed by the pts
+constexpr size_t kWriteTimeRing = 4096;
+
+std::vector<std::string> ParseStrings(const std::string &str) {
+  std::vector<std::string> values;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) values.push_back(item);
+  }
+  return values;
+}
+
+std::vector<int> ParseList(const std::string &str) {
+  std::vector<int> values;
+  for (const auto &item : ParseStrings(str)) values.push_back(std::stoi(item));
+  return values;
+}
+
+// The access units of an elementary stream, they are written in frame mode.
+struct ElementaryStream {
+  std::vector<unsigned char> data;
+  std::vector<std::pair<size_t, size_t>> frames;  // offset and size
+  std::vector<bool> key_frames;
+};
+
+// Splits the stream at the first slice of each picture, the parameter sets and sei before it belong to the picture.
+bool LoadElementaryStream(const std::string &path, bool h265, ElementaryStream *es) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    LOGE(BENCH) << "Open " << path << " failed";
+    return false;
+  }
+  es->data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  const std::vector<unsigned char> &data = es->data;
+  size_t frame_start = 0;
+  bool has_slice = false, key = false;
+  for (size_t i = 0; i + 4 < data.size(); ++i) {
+    if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) continue;
+    size_t nal_start = i > 0 && data[i - 1] == 0 ? i - 1 : i;
+    const unsigned char *nal = &data[i + 3];
+    bool slice, first_slice, nal_key, prefix;
+    if (h265) {
+      int type = (nal[0] >> 1) & 0x3F;
+      slice = type < 32;
+      first_slice = slice && i + 5 < data.size() && (nal[2] & 0x80);
+      nal_key = type >= 16 && type <= 21;
+      prefix = (type >= 32 && type <= 35) || type == 39;
+    } else {
+      int type = nal[0] & 0x1F;
+      slice = type >= 1 && type <= 5;
+      first_slice = slice && (nal[1] & 0x80);
+      nal_key = type == 5;
+      prefix = type >= 6 && type <= 9;
+    }
+    if (has_slice && (first_slice || prefix)) {
+      es->frames.emplace_back(frame_start, nal_start - frame_start);
+      es->key_frames.push_back(key);
+      frame_start = nal_start;
+      has_slice = key = false;
+    }
+    has_slice = has_slice || slice;
+    key = key || nal_key;
+    i += 2;
+  }
+  if (has_slice) {
+    es->frames.emplace_back(frame_start, data.size() - frame_start);
+    es->key_frames.push_back(key);
+  }
+  if (es->frames.empty()) {
+    LOGE(BENCH) << "No picture is found in " << path;
+    return false;
+  }
+  return true;
+}
+
+// engine_num, batching_timeout and batch_strategy are set to the tuned modules only
+struct CaseParams {
+  int parallelism = 1;
+  int queue_size = 20;
+  int engine_num = 1;
+  int batching_timeout = 1000;
+  std::string batch_strategy = "dynamic";
+};
+
+struct CaseResult {
+  CaseParams params;
+  int streams = 0;
+  double fps = 0;             // of all streams
+  double min_stream_fps = 0;  // of the slowest stream
+  double latency_p50_ms = 0;
+  double latency_p99_ms = 0;
+  bool real_time = false;
+};
+
+class BenchCase {
+ public:
+  BenchCase(const CaseParams &params, int streams)
+      : pipeline_("bench"), write_times_(streams * kWriteTimeRing), frame_counts_(streams) {
+    result_.params = params;
+    result_.streams = streams;
+  }
+
+  bool Run(const cnstream::CNGraphConfig &graph_config, const ElementaryStream *es, CaseResult *result) {
+    if (!pipeline_.BuildPipeline(graph_config)) {
+      LOGE(BENCH) << "Build pipeline failed";
+      return false;
+    }
+    pipeline_.RegisterFrameDoneCallBack([this](std::shared_ptr<cnstream::CNFrameInfo> data) { OnFrameDone(data); });
+    if (!pipeline_.Start()) {
+      LOGE(BENCH) << "Start pipeline failed";
+      return false;
+    }
+    auto source = dynamic_cast<cnstream::DataSource *>(pipeline_.GetModule(kSourceName));
+    bool ok = source != nullptr;
+    std::vector<std::thread> feeders;
+    for (int i = 0; ok && i < result_.streams; ++i) {
+      std::shared_ptr<cnstream::SourceHandler> handler;
+      std::string stream_id = "stream_" + std::to_string(i);
+      if (es) {
+        handler = cnstream::ESMemHandler::Create(source, stream_id);
+      } else {
+        handler = cnstream::RawImgMemHandler::Create(source, stream_id);
+      }
+      ok = handler && source->AddSource(handler) == 0;
+      if (ok) feeders.emplace_back([this, handler, es, i] { es ? FeedEs(handler, *es, i) : FeedRaw(handler, i); });
+    }
+    if (!ok) LOGE(BENCH) << "Add streams failed, the source module should be cnstream::DataSource named source";
+
+    if (ok) {
+      std::this_thread::sleep_for(std::chrono::seconds(FLAGS_warmup));
+      for (auto &count : frame_counts_) count = 0;
+      {
+        std::lock_guard<std::mutex> lk(latency_mtx_);
+        latencies_.clear();
+      }
+      measuring_ = true;
+      auto start = Clock::now();
+      std::this_thread::sleep_for(std::chrono::seconds(FLAGS_duration));
+      measuring_ = false;
+      Summarize(std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    running_ = false;
+    for (auto &feeder : feeders) feeder.join();
+    if (source) source->RemoveSources(true);
+    pipeline_.Stop();
+    *result = result_;
+    return ok;
+  }
+
+ private:
+  void Pace(int64_t frame_index, Clock::time_point start) {
+    if (FLAGS_fps <= 0) return;
+    std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                                              std::chrono::duration<double>(frame_index / FLAGS_fps)));
+  }
+
+  void RecordWrite(int stream, int64_t pts) {
+    write_times_[stream * kWriteTimeRing + pts % kWriteTimeRing] = Clock::now().time_since_epoch().count();
+  }
+
+  void FeedEs(std::shared_ptr<cnstream::SourceHandler> handler, const ElementaryStream &es, int stream) {
+    auto es_handler = std::dynamic_pointer_cast<cnstream::ESMemHandler>(handler);
+    es_handler->SetDataType(FLAGS_source == "h265" ? cnstream::ESMemHandler::DataType::H265
+                                                   : cnstream::ESMemHandler::DataType::H264);
+    auto start = Clock::now();
+    for (int64_t pts = 0; running_; ++pts) {
+      size_t index = pts % es.frames.size();
+      cnstream::ESPacket pkt;
+      pkt.data = const_cast<unsigned char *>(es.data.data()) + es.frames[index].first;
+      pkt.size = es.frames[index].second;
+      pkt.pts = pts;
+      if (es.key_frames[index]) pkt.flags = static_cast<uint32_t>(cnstream::ESPacket::FLAG::FLAG_KEY_FRAME);
+      Pace(pts, start);
+      RecordWrite(stream, pts);
+      if (es_handler->Write(&pkt) != 0) break;
+    }
+    es_handler->WriteEos();
+  }
+
+  void FeedRaw(std::shared_ptr<cnstream::SourceHandler> handler, int stream) {
+    auto raw_handler = std::dynamic_pointer_cast<cnstream::RawImgMemHandler>(handler);
+    int width = 1920, height = 1080;
+    if (sscanf(FLAGS_resolution.c_str(), "%dx%d", &width, &height) != 2) {
+      LOGW(BENCH) << "Invalid resolution " << FLAGS_resolution << ", 1920x1080 is used";
+    }
+    width &= ~1;
+    height &= ~1;
+    // the frames refer to the same image, which is not copied
+    std::shared_ptr<std::vector<uint8_t>> image = std::make_shared<std::vector<uint8_t>>(width * height * 3 / 2);
+    for (size_t i = 0; i < image->size(); ++i) (*image)[i] = static_cast<uint8_t>(i * 7);
+    cnstream::RawImgBuffer buffer;
+    buffer.fmt = cnstream::CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV12;
+    buffer.width = width;
+    buffer.height = height;
+    buffer.planes[0] = image->data();
+    buffer.planes[1] = image->data() + width * height;
+    buffer.stride[0] = buffer.stride[1] = width;
+    buffer.release = [image] {};
+    auto start = Clock::now();
+    for (int64_t pts = 0; running_; ++pts) {
+      Pace(pts, start);
+      RecordWrite(stream, pts);
+      if (raw_handler->Write(buffer, pts) != 0) break;
+    }
+    raw_handler->Write(nullptr, 0, 0);
+  }
+
+  void OnFrameDone(std::shared_ptr<cnstream::CNFrameInfo> data) {
+    if (data->IsEos() || !measuring_) return;
+    int stream = std::stoi(data->stream_id.substr(data->stream_id.find('_') + 1));
+    int64_t written = write_times_[stream * kWriteTimeRing + data->timestamp % kWriteTimeRing];
+    double latency_ms = std::chrono::duration<double, std::milli>(
+        Clock::duration(Clock::now().time_since_epoch().count() - written)).count();
+    ++frame_counts_[stream];
+    std::lock_guard<std::mutex> lk(latency_mtx_);
+    latencies_.push_back(latency_ms);
+  }
+
+  void Summarize(double seconds) {
+    uint64_t total = 0, min_count = UINT64_MAX;
+    for (auto &count : frame_counts_) {
+      total += count;
+      min_count = std::min<uint64_t>(min_count, count);
+    }
+    result_.fps = total / seconds;
+    result_.min_stream_fps = min_count / seconds;
+    std::lock_guard<std::mutex> lk(latency_mtx_);
+    if (!latencies_.empty()) {
+      std::sort(latencies_.begin(), latencies_.end());
+      result_.latency_p50_ms = latencies_[latencies_.size() / 2];
+      result_.latency_p99_ms = latencies_[std::min(latencies_.size() - 1, latencies_.size() * 99 / 100)];
+    }
+    // a stream falling behind by more than 5% is not real time
+    result_.real_time = FLAGS_fps > 0 && result_.min_stream_fps >= FLAGS_fps * 0.95 &&
+                        (FLAGS_max_latency_ms <= 0 || result_.latency_p99_ms <= FLAGS_max_latency_ms);
+  }
+
+  cnstream::Pipeline pipeline_;
+  CaseResult result_;
+  std::atomic<bool> running_{true};
+  std::atomic<bool> measuring_{false};
+  std::vector<std::atomic<int64_t>> write_times_;
+  std::vector<std::atomic<uint64_t>> frame_counts_;
+  std::mutex latency_mtx_;
+  std::vector<double> latencies_;
+};
+
+cnstream::CNModuleConfig SourceConfig() {
+  cnstream::CNModuleConfig config;
+  config.name = kSourceName;
+  config.className = "cnstream::DataSource";
+  config.parallelism = 0;
+  config.maxInputQueueSize = 30;
+  config.parameters = {{"output_type", FLAGS_output_type},
+                       {"decoder_type", FLAGS_decoder_type},
+                       {"device_id", std::to_string(FLAGS_device_id)}};
+  return config;
+}
+
+// the source followed by a chain of null modules, and FakeSink if it is built
+bool MakeGraphConfig(const CaseParams &params, cnstream::CNGraphConfig *graph_config) {
+  if (!FLAGS_config_fname.empty()) {
+    if (!graph_config->ParseByJSONFile(FLAGS_config_fname)) {
+      LOGE(BENCH) << "Parse " << FLAGS_config_fname << " failed";
+      return false;
+    }
+  } else {
+    std::vector<std::string> names;
+    for (int i = 0; i < FLAGS_null_modules; ++i) names.push_back("null" + std::to_string(i));
+#ifdef HAVE_MODULES_CONTRIB
+    names.push_back("sink");
+#endif
+    graph_config->module_configs = {SourceConfig()};
+    for (size_t i = 0; i < names.size(); ++i) {
+      graph_config->module_configs.back().next = {names[i]};
+      cnstream::CNModuleConfig config;
+      config.name = names[i];
+      config.className = names[i] == "sink" ? "cnstream::FakeSink" : "cnstream::BenchNullModule";
+      config.parameters = {{"busy_us", std::to_string(FLAGS_busy_us)}};
+      graph_config->module_configs.push_back(config);
+    }
+  }
+  for (auto &config : graph_config->module_configs) {
+    if (config.name == kSourceName) continue;
+    config.parallelism = params.parallelism;
+    config.maxInputQueueSize = params.queue_size;
+  }
+  for (const auto &name : ParseStrings(FLAGS_tune_modules)) {
+    auto iter = std::find_if(graph_config->module_configs.begin(), graph_config->module_configs.end(),
+                             [&name](const cnstream::CNModuleConfig &config) { return config.name == name; });
+    if (iter == graph_config->module_configs.end() || iter->className != "cnstream::Inferencer2") {
+      LOGE(BENCH) << "The tuned module " << name << " should be a cnstream::Inferencer2 module of the config";
+      return false;
+    }
+    iter->parameters["engine_num"] = std::to_string(params.engine_num);
+    iter->parameters["batching_timeout"] = std::to_string(params.batching_timeout);
+    iter->parameters["batch_strategy"] = params.batch_strategy;
+  }
+  return true;
+}
+
+bool RunCase(const CaseParams &params, int streams, const ElementaryStream *es, CaseResult *result) {
+  cnstream::CNGraphConfig graph_config;
+  if (!MakeGraphConfig(params, &graph_config)) return false;
+  LOGI(BENCH) << "Run parallelism " << params.parallelism << ", queue size " << params.queue_size
+              << (FLAGS_tune_modules.empty() ? "" : ", engine num " + std::to_string(params.engine_num) +
+                  ", batching timeout " + std::to_string(params.batching_timeout) + "ms, " + params.batch_strategy)
+              << ", " << streams << " streams";
+  BenchCase bench_case(params, streams);
+  return bench_case.Run(graph_config, es, result);
+}
+
+// Doubles the number of streams until they are not real time, then searches between the last two numbers.
+bool SearchMaxStreams(const CaseParams &params, const ElementaryStream *es, CaseResult *best) {
+  CaseResult result;
+  int pass = 0, fail = 0;
+  for (int streams = 1; streams <= FLAGS_max_streams; streams *= 2) {
+    if (!RunCase(params, streams, es, &result)) return false;
+    if (!result.real_time) {
+      fail = streams;
+      break;
+    }
+    pass = streams;
+    *best = result;
+  }
+  if (!fail) fail = FLAGS_max_streams + 1;
+  while (fail - pass > 1) {
+    int streams = (pass + fail) / 2;
+    if (!RunCase(params, streams, es, &result)) return false;
+    if (result.real_time) {
+      pass = streams;
+      *best = result;
+    } else {
+      fail = streams;
+    }
+  }
+  if (!pass) *best = CaseResult();
+  best->params = params;
+  return true;
+}
+
+// the throughput of a case is the number of streams running in real time with --streams=auto, or the frame rate
+double Throughput(const CaseResult &result, bool search) { return search ? result.streams : result.fps; }
+
+// The cases no other case beats in both throughput and p99 latency, in the descending order of throughput, so that
+// their latencies are descending too.
+std::vector<CaseResult> ParetoFront(std::vector<CaseResult> results, bool search) {
+  std::sort(results.begin(), results.end(), [search](const CaseResult &a, const CaseResult &b) {
+    if (Throughput(a, search) != Throughput(b, search)) return Throughput(a, search) > Throughput(b, search);
+    return a.latency_p99_ms < b.latency_p99_ms;
+  });
+  std::vector<CaseResult> front;
+  for (const auto &result : results) {
+    if (Throughput(result, search) <= 0) break;
+    if (front.empty() || result.latency_p99_ms < front.back().latency_p99_ms) front.push_back(result);
+  }
+  return front;
+}
+
+// The module configs of the case, to be merged into the config file. The source is not tuned.
+bool WriteTunedConfig(const CaseResult &result, const std::string &path) {
+  cnstream::CNGraphConfig graph_config;
+  if (!MakeGraphConfig(result.params, &graph_config)) return false;
+  const std::vector<std::string> tuned = ParseStrings(FLAGS_tune_modules);
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    LOGE(BENCH) << "Open " << path << " failed";
+    return false;
+  }
+  file << "{\n";
+  bool first = true;
+  for (const auto &config : graph_config.module_configs) {
+    if (config.name == kSourceName) continue;
+    file << (first ? "" : ",\n") << "  \"" << config.name << "\" : {\n"
+         << "    \"parallelism\" : " << result.params.parallelism << ",\n"
+         << "    \"max_input_queue_size\" : " << result.params.queue_size;
+    if (std::find(tuned.begin(), tuned.end(), config.name) != tuned.end()) {
+      file << ",\n    \"custom_params\" : {\n"
+           << "      \"engine_num\" : " << result.params.engine_num << ",\n"
+           << "      \"batching_timeout\" : " << result.params.batching_timeout << ",\n"
+           << "      \"batch_strategy\" : \"" << result.params.batch_strategy << "\"\n"
+           << "    }";
+    }
+    file << "\n  }";
+    first = false;
+  }
+  file << "\n}\n";
+  LOGI(BENCH) << "The tuned module configs are written to " << path;
+  return true;
+}
+
+void PrintTable(const std::string &title, const std::vector<CaseResult> &results) {
+  const bool tune = !FLAGS_tune_modules.empty();
+  std::cout << "\n" << title << "\n";
+  std::cout << std::setw(12) << "parallelism" << std::setw(12) << "queue_size";
+  if (tune) std::cout << std::setw(12) << "engine_num" << std::setw(14) << "timeout(ms)" << std::setw(10) << "strategy";
+  std::cout << std::setw(9) << "streams" << std::setw(12) << "fps" << std::setw(14) << "min_fps/str" << std::setw(13)
+            << "p50_lat(ms)" << std::setw(13) << "p99_lat(ms)" << std::endl;
+  for (const auto &result : results) {
+    std::cout << std::fixed << std::setprecision(1) << std::setw(12) << result.params.parallelism << std::setw(12)
+              << result.params.queue_size;
+    if (tune) {
+      std::cout << std::setw(12) << result.params.engine_num << std::setw(14) << result.params.batching_timeout
+                << std::setw(10) << result.params.batch_strategy;
+    }
+    std::cout << std::setw(9) << result.streams << std::setw(12) << result.fps << std::setw(14)
+              << result.min_stream_fps << std::setw(13) << result.latency_p50_ms << std::setw(13)
+              << result.latency_p99_ms << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, false);
+  cnstream::InitCNStreamLogging(nullptr);
+
+  ElementaryStream es;
+  if (FLAGS_source == "h264" || FLAGS_source == "h265") {
+    if (!LoadElementaryStream(FLAGS_es_file, FLAGS_source == "h265", &es)) return EXIT_FAILURE;
+    LOGI(BENCH) << "Loaded " << es.frames.size() << " frames from " << FLAGS_es_file;
+  } else if (FLAGS_source != "raw") {
+    LOGE(BENCH) << "Unknown source " << FLAGS_source << ", it should be raw, h264 or h265";
+    return EXIT_FAILURE;
+  }
+  const ElementaryStream *es_ptr = es.frames.empty() ? nullptr : &es;
+
+  const bool search = FLAGS_streams == "auto";
+  if (search && FLAGS_fps <= 0) {
+    LOGE(BENCH) << "--streams=auto needs a frame rate";
+    return EXIT_FAILURE;
+  }
+  const bool tune = !FLAGS_tune_modules.empty();
+  if (tune && FLAGS_config_fname.empty()) {
+    LOGE(BENCH) << "--tune_modules needs the config_fname they belong to";
+    return EXIT_FAILURE;
+  }
+  std::vector<CaseParams> cases;
+  for (int parallelism : ParseList(FLAGS_parallelism)) {
+    for (int queue_size : ParseList(FLAGS_queue_size)) {
+      CaseParams params;
+      params.parallelism = parallelism;
+      params.queue_size = queue_size;
+      if (!tune) {
+        cases.push_back(params);
+        continue;
+      }
+      for (int engine_num : ParseList(FLAGS_engine_num)) {
+        for (int batching_timeout : ParseList(FLAGS_batching_timeout)) {
+          for (const auto &batch_strategy : ParseStrings(FLAGS_batch_strategy)) {
+            params.engine_num = engine_num;
+            params.batching_timeout = batching_timeout;
+            params.batch_strategy = batch_strategy;
+            cases.push_back(params);
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<int> stream_nums = search ? std::vector<int>() : ParseList(FLAGS_streams);
+  std::vector<CaseResult> results;
+  for (const auto &params : cases) {
+    CaseResult result;
+    if (search) {
+      if (!SearchMaxStreams(params, es_ptr, &result)) return EXIT_FAILURE;
+      results.push_back(result);
+      continue;
+    }
+    for (int streams : stream_nums) {
+      if (!RunCase(params, streams, es_ptr, &result)) return EXIT_FAILURE;
+      results.push_back(result);
+    }
+  }
+  PrintTable(search ? "Max streams at " + std::to_string(FLAGS_fps) + " fps" : "Throughput", results);
+
+  if (tune || !FLAGS_tuned_config.empty()) {
+    std::vector<CaseResult> front = ParetoFront(results, search);
+    PrintTable("Pareto front of throughput and p99 latency", front);
+    auto best = std::find_if(front.begin(), front.end(), [](const CaseResult &result) {
+      return FLAGS_max_latency_ms <= 0 || result.latency_p99_ms <= FLAGS_max_latency_ms;
+    });
+    if (best == front.end()) {
+      LOGW(BENCH) << "No case runs within " << FLAGS_max_latency_ms << "ms p99 latency";
+    } else if (!FLAGS_tuned_config.empty() && !WriteTunedConfig(*best, FLAGS_tuned_config)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  cnstream::ShutdownCNStreamLogging();
+  return EXIT_SUCCESS;
+}
@@ -25,9 +25,13 @@
 #include <opencv2/imgcodecs/imgcodecs.hpp>
 #endif
 
+#include <unistd.h>
+
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <list>
 #include <memory>
@@ -42,7 +46,12 @@
 #ifdef HAVE_DISPLAY
 #include "displayer.hpp"
 #endif
+#ifdef HAVE_INFERENCE2
+#include "inferencer2.hpp"
+#endif
 #include "cnstream_logging.hpp"
+#include "cluster_agent.hpp"
+#include "stream_control.hpp"
 #include "util.hpp"
 
 #include "profiler/pipeline_profiler.hpp"
@@ -65,6 +74,12 @@ DEFINE_bool(jpeg_from_mem, true, "Jpeg bitstream from mem.");
 DEFINE_bool(raw_img_input, false, "feed decompressed image to source");
 DEFINE_bool(use_cv_mat, true, "feed cv mat to source. It is valid only if ``raw_img_input`` is set to true");
 DEFINE_string(trace_data_dir, "", "dump trace data to specified dir. An empty string means that no data is stored");
+DEFINE_string(coordinator, "", "address of the stream coordinator, host:port. If it is set, the streams are assigned"
+    " by the coordinator instead of data_path and data_name");
+DEFINE_string(node_name, "", "name of the node reported to the coordinator. Default is the host name");
+DEFINE_bool(stream_control, false, "whether streams are added and removed by control messages, e.g. consumed from"
+            " the control_topic of the Kafka module. The launcher keeps running when all streams end");
+DEFINE_int32(max_streams, 0, "max number of streams assigned to the node by the coordinator, 0 means no limit");
 
 #ifdef HAVE_DISPLAY
 cnstream::Displayer *gdisplayer = nullptr;
@@ -89,6 +104,16 @@ class MsgObserver : cnstream::StreamMsgObserver {
   MsgObserver(cnstream::Pipeline *pipeline, std::string source_name)
       : pipeline_(pipeline), source_name_(source_name) {}
 
+  /**
+   * @brief Keeps the pipeline running when all streams are ended, e.g. the streams are assigned by a coordinator.
+   */
+  void SetKeepRunning(bool keep_running) { keep_running_ = keep_running; }
+
+  /**
+   * @brief Sets the function called when a stream is ended by eos or errors, not by RemoveStream.
+   */
+  void SetStreamEndedCallback(std::function<void(const std::string &)> callback) { ended_callback_ = callback; }
+
   void Update(const cnstream::StreamMsg &smsg) override {
     std::lock_guard<std::mutex> add_src_lg(gmutex_for_add_source);
     std::lock_guard<std::mutex> lg(mutex_);
@@ -101,8 +126,9 @@ class MsgObserver : cnstream::StreamMsgObserver {
         if (stream_set_.find(smsg.stream_id) != stream_set_.end()) {
           if (source) source->RemoveSource(smsg.stream_id);
           stream_set_.erase(smsg.stream_id);
+          if (ended_callback_) ended_callback_(smsg.stream_id);
         }
-        if (stream_set_.empty()) {
+        if (stream_set_.empty() && !keep_running_) {
           LOGI(DEMO) << "[" << pipeline_->GetName() << "] received all EOS";
           stop_ = true;
         }
@@ -114,8 +140,9 @@ class MsgObserver : cnstream::StreamMsgObserver {
         if (stream_set_.find(smsg.stream_id) != stream_set_.end()) {
           if (source) source->RemoveSource(smsg.stream_id, true);
           stream_set_.erase(smsg.stream_id);
+          if (ended_callback_) ended_callback_(smsg.stream_id);
         }
-        if (stream_set_.empty()) {
+        if (stream_set_.empty() && !keep_running_) {
           LOGI(DEMO) << "[" << pipeline_->GetName() << "] all streams is removed from pipeline, pipeline will stop.";
           stop_ = true;
         }
@@ -145,7 +172,7 @@ class MsgObserver : cnstream::StreamMsgObserver {
 
   void WaitForStop() {
     std::unique_lock<std::mutex> lk(mutex_);
-    if (stream_set_.empty()) {
+    if (stream_set_.empty() && !keep_running_) {
      stop_ = true;
     }
     wakener_.wait(lk, [this]() { return stop_.load(); });
@@ -162,10 +189,23 @@ class MsgObserver : cnstream::StreamMsgObserver {
     if (stop_) stop_ = false;
   }
 
+  void RemoveStream(const std::string &stream_id) {
+    std::lock_guard<std::mutex> add_src_lg(gmutex_for_add_source);
+    {
+      // erased first, so that the eos of the stream is not taken as the end of it
+      std::lock_guard<std::mutex> lg(mutex_);
+      if (!stream_set_.erase(stream_id)) return;
+    }
+    auto source = dynamic_cast<cnstream::DataSource *>(pipeline_->GetModule(source_name_));
+    if (source) source->RemoveSource(stream_id);
+  }
+
  private:
   cnstream::Pipeline *pipeline_ = nullptr;
   std::string source_name_;
   std::atomic<bool> stop_{false};
+  std::atomic<bool> keep_running_{false};
+  std::function<void(const std::string &)> ended_callback_;
   std::set<std::string> stream_set_;
   std::condition_variable wakener_;
   mutable std::mutex mutex_;
@@ -404,6 +444,69 @@ int AddSourceForFile(cnstream::DataSource *source, const std::string &stream_id,
   return source->AddSource(handler);
 }
 
+int AddSourceByUrl(cnstream::DataSource *source, const std::string &stream_id, const std::string &filename,
+                   const cnstream::MaximumVideoResolution& maximum_resolution) {
+  if (filename.find("rtsp://") != std::string::npos) {
+    return AddSourceForRtspStream(source, stream_id, filename, maximum_resolution);
+  } else if (filename.find("/dev/video") != std::string::npos) {  // only support linux
+    return AddSourceForUsbCam(source, stream_id, filename, FLAGS_src_frame_rate, FLAGS_loop, maximum_resolution);
+  } else if (filename.find(".jpg") != std::string::npos && FLAGS_jpeg_from_mem) {
+    return AddSourceForImageInMem(source, stream_id, filename, FLAGS_loop);
+  } else if (filename.find(".jpg") != std::string::npos && FLAGS_raw_img_input) {
+    return AddSourceForDecompressedImage(source, stream_id, filename, FLAGS_loop, FLAGS_use_cv_mat);
+  } else if (filename.find(".h264") != std::string::npos) {
+    return AddSourceForVideoInMem(source, stream_id, filename, FLAGS_loop, maximum_resolution);
+  }
+  return AddSourceForFile(source, stream_id, filename, FLAGS_src_frame_rate, FLAGS_loop, maximum_resolution);
+}
+
+/**
+ * @brief Creates the agent running the streams assigned by the coordinator. The load of the node is the frame rate
+ *        of the pipeline from the profiler and the fill ratio of the fullest input queues of modules.
+ */
+std::unique_ptr<ClusterAgent> CreateClusterAgent(cnstream::Pipeline *pipeline, cnstream::DataSource *source,
+                                                 MsgObserver *msg_observer,
+                                                 const cnstream::MaximumVideoResolution &maximum_resolution) {
+  std::string node_name = FLAGS_node_name;
+  if (node_name.empty()) {
+    char host_name[256] = {0};
+    gethostname(host_name, sizeof(host_name) - 1);
+    node_name = host_name;
+  }
+  auto add = [source, msg_observer, maximum_resolution](const std::string &stream_id, const std::string &url) {
+    std::unique_lock<std::mutex> lk(gmutex_for_add_source);
+    if (AddSourceByUrl(source, stream_id, url, maximum_resolution) != 0) return false;
+    msg_observer->IncreaseStream(stream_id);
+    return true;
+  };
+  auto remove = [msg_observer](const std::string &stream_id) { msg_observer->RemoveStream(stream_id); };
+  auto last_time = std::make_shared<cnstream::Time>(cnstream::Clock::now());
+  auto last_completed = std::make_shared<uint64_t>(0);
+  auto fill_load = [pipeline, last_time, last_completed](NodeReport *report) {
+    if (pipeline->IsProfilingEnabled()) {
+      // the profile is accumulated since the pipeline starts, the frame rate is the one of the last interval
+      cnstream::Time now = cnstream::Clock::now();
+      uint64_t completed = pipeline->GetProfiler()->GetProfile().overall_profile.completed;
+      double seconds = std::chrono::duration<double>(now - *last_time).count();
+      if (seconds > 0 && completed >= *last_completed) report->fps = (completed - *last_completed) / seconds;
+      *last_time = now;
+      *last_completed = completed;
+    }
+    for (const auto &state : pipeline->GetModuleStates()) {
+      report->queue_fill_ratio = std::max(report->queue_fill_ratio, state.queue_fill_ratio);
+      report->blocking = report->blocking || state.blocking_upstream;
+    }
+  };
+  std::unique_ptr<ClusterAgent> agent(new ClusterAgent(FLAGS_coordinator, node_name, FLAGS_max_streams, add, remove,
+                                                       fill_load));
+  msg_observer->SetKeepRunning(true);
+  ClusterAgent *agent_ptr = agent.get();
+  msg_observer->SetStreamEndedCallback([agent_ptr](const std::string &stream_id) {
+    agent_ptr->OnStreamEnded(stream_id);
+  });
+  return agent;
+}
+
 int main(int argc, char **argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, false);
   cnstream::InitCNStreamLogging(nullptr);
@@ -418,7 +521,9 @@ int main(int argc, char **argv) {
     flags to variables
   */
   std::list<std::string> video_urls;
-  if (FLAGS_data_name != "") {
+  if (!FLAGS_coordinator.empty()) {
+    // the streams are assigned by the coordinator
+  } else if (FLAGS_data_name != "") {
     video_urls = {FLAGS_data_name};
   } else {
     video_urls = ::ReadFileList(FLAGS_data_path);
@@ -451,6 +556,47 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
+  cnstream::MaximumVideoResolution maximum_video_resolution;
+  maximum_video_resolution.maximum_width = FLAGS_maximum_video_width;
+  maximum_video_resolution.maximum_height = FLAGS_maximum_video_height;
+  maximum_video_resolution.enable_variable_resolutions =
+      FLAGS_maximum_video_width != -1 && FLAGS_maximum_video_height != -1;
+
+  /*
+    apply control messages, the watcher is added before starting to receive the messages consumed at once
+   */
+  std::unique_ptr<StreamControl> stream_control;
+  if (FLAGS_stream_control) {
+    auto add = [source, &msg_observer, maximum_video_resolution](const std::string &stream_id,
+                                                                const std::string &url) {
+      std::unique_lock<std::mutex> lk(gmutex_for_add_source);
+      if (AddSourceByUrl(source, stream_id, url, maximum_video_resolution) != 0) return false;
+      msg_observer.IncreaseStream(stream_id);
+      return true;
+    };
+    auto remove = [&msg_observer](const std::string &stream_id) { msg_observer.RemoveStream(stream_id); };
+    auto reload = [&pipeline](const std::string &module_name, const std::string &model_path) {
+#ifdef HAVE_INFERENCE2
+      auto infer = dynamic_cast<cnstream::Inferencer2 *>(pipeline.GetModule(module_name));
+      if (!infer) {
+        LOGW(DEMO) << "Inferencer2 module [" << module_name << "] not found.";
+        return false;
+      }
+      return infer->ReloadModel(model_path, "", [module_name](bool success) {
+        LOGI(DEMO) << "Module [" << module_name << "] reload model " << (success ? "done" : "failed");
+      });
+#else
+      LOGW(DEMO) << "Reloading model is not supported without module inference2.";
+      return false;
+#endif
+    };
+    stream_control.reset(new StreamControl(add, remove, reload));
+    StreamControl *control = stream_control.get();
+    pipeline.GetEventBus()->AddBusWatch([control](const cnstream::Event &event) { return control->OnEvent(event); });
+    stream_control->Start();
+    msg_observer.SetKeepRunning(true);
+  }
+
   /*
     start pipeline
   */
@@ -499,11 +645,6 @@ int main(int argc, char **argv) {
   /*
     add stream sources...
   */
-  cnstream::MaximumVideoResolution maximum_video_resolution;
-  maximum_video_resolution.maximum_width = FLAGS_maximum_video_width;
-  maximum_video_resolution.maximum_height = FLAGS_maximum_video_height;
-  maximum_video_resolution.enable_variable_resolutions =
-      FLAGS_maximum_video_width != -1 && FLAGS_maximum_video_height != -1;
   int streams = static_cast<int>(video_urls.size());
   auto url_iter = video_urls.begin();
   for (int i = 0; i < streams; i++, url_iter++) {
@@ -513,20 +654,7 @@ int main(int argc, char **argv) {
     int ret = 0;
     std::unique_lock<std::mutex> lk(gmutex_for_add_source);
     if (nullptr != source) {
-      if (filename.find("rtsp://") != std::string::npos) {
-        ret = AddSourceForRtspStream(source, stream_id, filename, maximum_video_resolution);
-      } else if (filename.find("/dev/video") != std::string::npos) {  // only support linux
-        ret = AddSourceForUsbCam(source, stream_id, filename, FLAGS_src_frame_rate,
-            FLAGS_loop, maximum_video_resolution);
-      } else if (filename.find(".jpg") != std::string::npos && FLAGS_jpeg_from_mem) {
-        ret = AddSourceForImageInMem(source, stream_id, filename, FLAGS_loop);
-      } else if (filename.find(".jpg") != std::string::npos && FLAGS_raw_img_input) {
-        ret = AddSourceForDecompressedImage(source, stream_id, filename, FLAGS_loop, FLAGS_use_cv_mat);
-      } else if (filename.find(".h264") != std::string::npos) {
-        ret = AddSourceForVideoInMem(source, stream_id, filename, FLAGS_loop, maximum_video_resolution);
-      } else {
-        ret = AddSourceForFile(source, stream_id, filename, FLAGS_src_frame_rate, FLAGS_loop, maximum_video_resolution);
-      }
+      ret = AddSourceByUrl(source, stream_id, filename, maximum_video_resolution);
     }
 
     if (ret == 0) {
@@ -534,6 +662,13 @@ int main(int argc, char **argv) {
     }
   }
 
+  std::unique_ptr<ClusterAgent> cluster_agent;
+  if (!FLAGS_coordinator.empty()) {
+    cluster_agent = CreateClusterAgent(&pipeline, source, &msg_observer, maximum_video_resolution);
+    cluster_agent->Start();
+    LOGI(DEMO) << "Streams are assigned by coordinator [" << FLAGS_coordinator << "]";
+  }
+
 #ifdef HAVE_DISPLAY
   auto quit_callback = [&pipeline, &source, &msg_observer]() {
     // stop feed-data threads before remove-sources...
@@ -555,7 +690,7 @@ int main(int argc, char **argv) {
     /*
      * close pipeline
      */
-    if (FLAGS_loop) {
+    if (FLAGS_loop || cluster_agent || stream_control) {
       // stop by hand or by FLAGS_wait_time
       if (FLAGS_wait_time) {
         std::this_thread::sleep_for(std::chrono::seconds(FLAGS_wait_time));
@@ -565,6 +700,10 @@ int main(int argc, char **argv) {
         LOGI(DEMO) << "receive a character from stdin and quit...";
       }
 
+      // the streams are not changed by the coordinator while removing them
+      if (cluster_agent) cluster_agent->Stop();
+      if (stream_control) stream_control->Stop();
+      msg_observer.SetKeepRunning(false);
       thread_running.store(false);
       if (nullptr != source) {
         source->RemoveSources();
@@ -0,0 +1,141 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cluster_agent.hpp"
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+static constexpr int kReportIntervalMs = 1000;
+static constexpr int kReplyTimeoutMs = 3000;
+
+ClusterAgent::ClusterAgent(const std::string &coordinator, const std::string &node, uint32_t max_streams,
+                           AddStream add, RemoveStream remove, FillLoad fill_load)
+    : coordinator_(coordinator), node_(node), max_streams_(max_streams), add_(std::move(add)),
+      remove_(std::move(remove)), fill_load_(std::move(fill_load)) {}
+
+void ClusterAgent::Start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread(&ClusterAgent::Loop, this);
+}
+
+void ClusterAgent::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!running_.exchange(false)) return;
+  }
+  wakener_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+void ClusterAgent::OnStreamEnded(const std::string &stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (streams_.erase(stream_id)) ended_.insert(stream_id);
+}
+
+void ClusterAgent::WaitFor(int ms) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  wakener_.wait_for(lk, std::chrono::milliseconds(ms), [this] { return !running_.load(); });
+}
+
+void ClusterAgent::Loop() {
+  LineSocket socket;
+  bool warned = false;
+  while (running_) {
+    if (!socket.IsConnected()) {
+      if (!socket.Connect(coordinator_)) {
+        if (!warned) LOGW(CLUSTER) << "Connect to coordinator [" << coordinator_ << "] failed, keep on retrying";
+        warned = true;
+        WaitFor(kReportIntervalMs);
+        continue;
+      }
+      LOGI(CLUSTER) << "Node [" << node_ << "] connected to coordinator [" << coordinator_ << "]";
+      warned = false;
+    }
+
+    NodeReport report;
+    report.node = node_;
+    report.max_streams = max_streams_;
+    if (fill_load_) fill_load_(&report);
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      report.streams.assign(streams_.begin(), streams_.end());
+      report.ended.assign(ended_.begin(), ended_.end());
+    }
+    std::string reply;
+    std::vector<ClusterStream> assignment;
+    if (!socket.WriteLine(EncodeReport(report)) || !socket.ReadLine(&reply, kReplyTimeoutMs) ||
+        !DecodeAssignment(reply, &assignment)) {
+      // the running streams are kept until the coordinator is back
+      LOGW(CLUSTER) << "Lost coordinator [" << coordinator_ << "], keep on running " << report.streams.size()
+                    << " streams";
+      socket.Close();
+      WaitFor(kReportIntervalMs);
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      for (const auto &id : report.ended) ended_.erase(id);
+    }
+    Apply(assignment);
+    WaitFor(kReportIntervalMs);
+  }
+}
+
+void ClusterAgent::Apply(const std::vector<ClusterStream> &assignment) {
+  std::set<std::string> assigned;
+  for (const auto &stream : assignment) assigned.insert(stream.id);
+  std::set<std::string> running;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    running = streams_;
+  }
+  // the callbacks are called without locking, since they may end streams and call OnStreamEnded
+  for (const auto &id : running) {
+    if (assigned.count(id)) continue;
+    LOGI(CLUSTER) << "Node [" << node_ << "] removes stream [" << id << "]";
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      streams_.erase(id);
+    }
+    remove_(id);
+  }
+  for (const auto &stream : assignment) {
+    if (running.count(stream.id)) continue;
+    {
+      // inserted before adding, so that the stream ending at once is reported
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (ended_.count(stream.id)) continue;
+      streams_.insert(stream.id);
+    }
+    if (!add_(stream.id, stream.url)) {
+      LOGW(CLUSTER) << "Node [" << node_ << "] failed to add stream [" << stream.id << "] " << stream.url;
+      std::lock_guard<std::mutex> lk(mutex_);
+      streams_.erase(stream.id);
+      continue;
+    }
+    LOGI(CLUSTER) << "Node [" << node_ << "] adds stream [" << stream.id << "] " << stream.url;
+  }
+}
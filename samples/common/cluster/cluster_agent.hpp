@@ -0,0 +1,108 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef SAMPLES_COMMON_CLUSTER_CLUSTER_AGENT_HPP_
+#define SAMPLES_COMMON_CLUSTER_CLUSTER_AGENT_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cluster_protocol.hpp"
+#include "stream_balancer.hpp"
+
+/**
+ * @class ClusterAgent
+ *
+ * @brief ClusterAgent runs the streams assigned to a node by the coordinator.
+ *
+ * It reports the state of the node to the coordinator every second and applies the assignment replied: the streams
+ * not assigned any more are removed and the new ones are added. The streams keep running while the coordinator is
+ * unreachable, and the agent reconnects in the background.
+ */
+class ClusterAgent {
+ public:
+  /**
+   * @brief Adds a stream to the pipeline. Returns false if the stream fails to be added, it is tried again later.
+   */
+  using AddStream = std::function<bool(const std::string &stream_id, const std::string &url)>;
+  /**
+   * @brief Removes a stream from the pipeline.
+   */
+  using RemoveStream = std::function<void(const std::string &stream_id)>;
+  /**
+   * @brief Fills the load of the node into a report, i.e. ``fps``, ``queue_fill_ratio`` and ``blocking``.
+   */
+  using FillLoad = std::function<void(NodeReport *report)>;
+
+  ClusterAgent(const std::string &coordinator, const std::string &node, uint32_t max_streams, AddStream add,
+               RemoveStream remove, FillLoad fill_load);
+  ~ClusterAgent() { Stop(); }
+
+  /**
+   * @brief Starts reporting to the coordinator in a thread.
+   *
+   * @return No return value.
+   */
+  void Start();
+
+  /**
+   * @brief Stops reporting. The streams running are left to the caller.
+   *
+   * @return No return value.
+   */
+  void Stop();
+
+  /**
+   * @brief Tells the agent that a stream has ended by eos or errors, so that it is not assigned again.
+   *
+   * @param[in] stream_id The identification of the stream.
+   *
+   * @return No return value.
+   */
+  void OnStreamEnded(const std::string &stream_id);
+
+ private:
+  void Loop();
+  void Apply(const std::vector<ClusterStream> &assignment);
+  void WaitFor(int ms);
+
+  std::string coordinator_;
+  std::string node_;
+  uint32_t max_streams_ = 0;
+  AddStream add_;
+  RemoveStream remove_;
+  FillLoad fill_load_;
+
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable wakener_;
+  std::set<std::string> streams_;  // running streams
+  std::set<std::string> ended_;    // ended streams not reported yet
+};  // class ClusterAgent
+
+#endif  // SAMPLES_COMMON_CLUSTER_CLUSTER_AGENT_HPP_
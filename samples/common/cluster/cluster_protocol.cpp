@@ -0,0 +1,234 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cluster_protocol.hpp"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include "cnstream_logging.hpp"
+
+using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+
+static void WriteString(JsonWriter *writer, const std::string &str) {
+  writer->String(str.c_str(), static_cast<rapidjson::SizeType>(str.length()));
+}
+
+static void WriteStrings(JsonWriter *writer, const char *key, const std::vector<std::string> &strs) {
+  writer->Key(key);
+  writer->StartArray();
+  for (const auto &str : strs) WriteString(writer, str);
+  writer->EndArray();
+}
+
+static bool ReadStrings(const rapidjson::Value &obj, const char *key, std::vector<std::string> *strs) {
+  strs->clear();
+  if (!obj.HasMember(key)) return true;
+  const rapidjson::Value &array = obj[key];
+  if (!array.IsArray()) return false;
+  for (const auto &value : array.GetArray()) {
+    if (!value.IsString()) return false;
+    strs->emplace_back(value.GetString(), value.GetStringLength());
+  }
+  return true;
+}
+
+static bool ParseMessage(const std::string &line, const char *type, rapidjson::Document *doc) {
+  doc->Parse(line.c_str(), line.length());
+  return !doc->HasParseError() && doc->IsObject() && doc->HasMember("type") && (*doc)["type"].IsString() &&
+         std::string((*doc)["type"].GetString()) == type;
+}
+
+std::string EncodeReport(const NodeReport &report) {
+  rapidjson::StringBuffer buffer;
+  JsonWriter writer(buffer);
+  writer.StartObject();
+  writer.Key("type");
+  writer.String("report");
+  writer.Key("node");
+  WriteString(&writer, report.node);
+  writer.Key("max_streams");
+  writer.Uint(report.max_streams);
+  writer.Key("fps");
+  writer.Double(report.fps);
+  writer.Key("queue_fill_ratio");
+  writer.Double(report.queue_fill_ratio);
+  writer.Key("blocking");
+  writer.Bool(report.blocking);
+  WriteStrings(&writer, "streams", report.streams);
+  WriteStrings(&writer, "ended", report.ended);
+  writer.EndObject();
+  return buffer.GetString();
+}
+
+bool DecodeReport(const std::string &line, NodeReport *report) {
+  rapidjson::Document doc;
+  if (!ParseMessage(line, "report", &doc)) return false;
+  if (!doc.HasMember("node") || !doc["node"].IsString() || !doc["node"].GetStringLength()) return false;
+  report->node = doc["node"].GetString();
+  report->max_streams = doc.HasMember("max_streams") && doc["max_streams"].IsUint() ? doc["max_streams"].GetUint() : 0;
+  report->fps = doc.HasMember("fps") && doc["fps"].IsNumber() ? doc["fps"].GetDouble() : 0;
+  report->queue_fill_ratio =
+      doc.HasMember("queue_fill_ratio") && doc["queue_fill_ratio"].IsNumber() ? doc["queue_fill_ratio"].GetDouble() : 0;
+  report->blocking = doc.HasMember("blocking") && doc["blocking"].IsBool() && doc["blocking"].GetBool();
+  return ReadStrings(doc, "streams", &report->streams) && ReadStrings(doc, "ended", &report->ended);
+}
+
+std::string EncodeAssignment(const std::vector<ClusterStream> &streams) {
+  rapidjson::StringBuffer buffer;
+  JsonWriter writer(buffer);
+  writer.StartObject();
+  writer.Key("type");
+  writer.String("assign");
+  writer.Key("streams");
+  writer.StartArray();
+  for (const auto &stream : streams) {
+    writer.StartObject();
+    writer.Key("id");
+    WriteString(&writer, stream.id);
+    writer.Key("url");
+    WriteString(&writer, stream.url);
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+  return buffer.GetString();
+}
+
+bool DecodeAssignment(const std::string &line, std::vector<ClusterStream> *streams) {
+  rapidjson::Document doc;
+  if (!ParseMessage(line, "assign", &doc) || !doc.HasMember("streams") || !doc["streams"].IsArray()) return false;
+  streams->clear();
+  for (const auto &value : doc["streams"].GetArray()) {
+    if (!value.IsObject() || !value.HasMember("id") || !value["id"].IsString() || !value.HasMember("url") ||
+        !value["url"].IsString()) {
+      return false;
+    }
+    streams->push_back({value["id"].GetString(), value["url"].GetString()});
+  }
+  return true;
+}
+
+bool LineSocket::Connect(const std::string &address) {
+  Close();
+  size_t colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    LOGE(CLUSTER) << "Invalid address [" << address << "], it should be host:port";
+    return false;
+  }
+  std::string host = address.substr(0, colon), port = address.substr(colon + 1);
+  struct addrinfo hints, *result = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+  if (ret != 0) {
+    LOGE(CLUSTER) << "Resolve [" << address << "] failed, " << gai_strerror(ret);
+    return false;
+  }
+  for (struct addrinfo *ai = result; ai && fd_ < 0; ai = ai->ai_next) {
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) continue;
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      fd_ = fd;
+    } else {
+      close(fd);
+    }
+  }
+  freeaddrinfo(result);
+  return fd_ >= 0;
+}
+
+bool LineSocket::WriteLine(const std::string &line) {
+  if (fd_ < 0) return false;
+  std::string data = line + "\n";
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n = send(fd_, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      Close();
+      return false;
+    }
+    written += n;
+  }
+  return true;
+}
+
+bool LineSocket::ReadLine(std::string *line, int timeout_ms) {
+  while (fd_ >= 0) {
+    size_t pos = buffer_.find('\n');
+    if (pos != std::string::npos) {
+      line->assign(buffer_, 0, pos);
+      buffer_.erase(0, pos + 1);
+      return true;
+    }
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret == 0) return false;
+    char data[4096];
+    ssize_t n = ret > 0 ? recv(fd_, data, sizeof(data), 0) : -1;
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      Close();
+      return false;
+    }
+    buffer_.append(data, n);
+  }
+  return false;
+}
+
+void LineSocket::Close() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  buffer_.clear();
+}
+
+int LineSocket::Listen(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+    LOGE(CLUSTER) << "Listen on port " << port << " failed, " << strerror(errno);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
@@ -0,0 +1,83 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef SAMPLES_COMMON_CLUSTER_CLUSTER_PROTOCOL_HPP_
+#define SAMPLES_COMMON_CLUSTER_CLUSTER_PROTOCOL_HPP_
+
+#include <string>
+#include <vector>
+
+#include "stream_balancer.hpp"
+
+/*
+ * The nodes and the coordinator talk over TCP with JSON messages, one message per line:
+ *   node -> coordinator, every report interval:
+ *     {"type":"report","node":"host_0","max_streams":0,"fps":250.0,"queue_fill_ratio":0.3,"blocking":false,
+ *      "streams":["stream_0"],"ended":[]}
+ *   coordinator -> node, the reply of each report, all streams the node should run:
+ *     {"type":"assign","streams":[{"id":"stream_0","url":"rtsp://..."}]}
+ */
+std::string EncodeReport(const NodeReport &report);
+bool DecodeReport(const std::string &line, NodeReport *report);
+std::string EncodeAssignment(const std::vector<ClusterStream> &streams);
+bool DecodeAssignment(const std::string &line, std::vector<ClusterStream> *streams);
+
+/**
+ * @class LineSocket
+ *
+ * @brief LineSocket sends and receives the lines of a TCP connection.
+ */
+class LineSocket {
+ public:
+  explicit LineSocket(int fd = -1) : fd_(fd) {}
+  ~LineSocket() { Close(); }
+  LineSocket(const LineSocket &) = delete;
+  LineSocket &operator=(const LineSocket &) = delete;
+
+  /**
+   * @brief Connects to a server.
+   *
+   * @param[in] address The address of the server, "host:port".
+   *
+   * @return Returns false if the connection fails.
+   */
+  bool Connect(const std::string &address);
+  /**
+   * @brief Writes a line, '\n' is appended.
+   */
+  bool WriteLine(const std::string &line);
+  /**
+   * @brief Reads a line without '\n'. Returns false on timeout, errors or if the connection is closed.
+   */
+  bool ReadLine(std::string *line, int timeout_ms);
+  void Close();
+  bool IsConnected() const { return fd_ >= 0; }
+
+  /**
+   * @brief Listens on a port of all interfaces. Returns the socket, -1 on errors.
+   */
+  static int Listen(int port);
+
+ private:
+  int fd_ = -1;
+  std::string buffer_;
+};  // class LineSocket
+
+#endif  // SAMPLES_COMMON_CLUSTER_CLUSTER_PROTOCOL_HPP_
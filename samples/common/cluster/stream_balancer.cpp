@@ -0,0 +1,180 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "stream_balancer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+void StreamBalancer::SetStreams(const std::vector<ClusterStream> &streams) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  streams_ = streams;
+  stream_index_.clear();
+  for (size_t i = 0; i < streams_.size(); ++i) stream_index_[streams_[i].id] = i;
+}
+
+void StreamBalancer::Report(const NodeReport &report, int64_t now_ms) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto it = nodes_.find(report.node);
+  if (it == nodes_.end()) {
+    LOGI(CLUSTER) << "Node [" << report.node << "] joins";
+    it = nodes_.emplace(report.node, NodeState()).first;
+  }
+  it->second.report = report;
+  it->second.last_report_ms = now_ms;
+  for (const auto &stream_id : report.ended) {
+    if (stream_index_.count(stream_id) && ended_.insert(stream_id).second) {
+      LOGI(CLUSTER) << "Stream [" << stream_id << "] ends on node [" << report.node << "]";
+    }
+  }
+}
+
+void StreamBalancer::RemoveNode(const std::string &node) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (nodes_.erase(node)) LOGI(CLUSTER) << "Node [" << node << "] leaves";
+}
+
+bool StreamBalancer::IsOverloaded(const NodeState &node) const {
+  return node.report.blocking || node.report.queue_fill_ratio >= config_.high_watermark;
+}
+
+uint32_t StreamBalancer::Capacity(const NodeState &node) const {
+  uint32_t capacity = node.report.max_streams ? node.report.max_streams : std::numeric_limits<uint32_t>::max();
+  if (node.capacity_limit) capacity = std::min(capacity, node.capacity_limit);
+  return capacity;
+}
+
+StreamBalancer::NodeState *StreamBalancer::PickNode(const NodeState *except) {
+  NodeState *picked = nullptr;
+  for (auto &it : nodes_) {
+    NodeState &node = it.second;
+    if (&node == except || IsOverloaded(node) || node.streams.size() >= Capacity(node)) continue;
+    if (!picked || node.streams.size() < picked->streams.size()) picked = &node;
+  }
+  return picked;
+}
+
+int StreamBalancer::Balance(int64_t now_ms) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  int moved = 0;
+  for (auto it = nodes_.begin(); it != nodes_.end();) {
+    if (now_ms - it->second.last_report_ms > config_.node_timeout_ms) {
+      LOGW(CLUSTER) << "Node [" << it->first << "] does not report for " << now_ms - it->second.last_report_ms
+                    << " ms, it leaves";
+      moved += static_cast<int>(it->second.streams.size());
+      it = nodes_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  std::set<std::string> assigned;
+  for (auto &it : nodes_) {
+    NodeState &node = it.second;
+    auto removed = std::remove_if(node.streams.begin(), node.streams.end(), [this](const std::string &id) {
+      return !stream_index_.count(id) || ended_.count(id);
+    });
+    node.streams.erase(removed, node.streams.end());
+    // the capacity is estimated once the node is overloaded, and is kept while the node drains
+    if (now_ms >= node.limit_until_ms) {
+      node.capacity_limit = 0;
+      if (IsOverloaded(node) && node.streams.size() > 1) {
+        double kept = node.report.fps > 0 ? std::floor(node.report.fps / config_.stream_fps) : 0;
+        node.capacity_limit = static_cast<uint32_t>(
+            std::max(1.0, std::min<double>(kept ? kept : node.streams.size() - 1, node.streams.size() - 1)));
+        node.limit_until_ms = now_ms + config_.cooldown_ms;
+        LOGW(CLUSTER) << "Node [" << it.first << "] is overloaded at " << node.report.fps << " fps, "
+                      << node.streams.size() << " streams are cut down to " << node.capacity_limit;
+      }
+    }
+    while (node.streams.size() > Capacity(node)) {
+      node.streams.pop_back();
+      ++moved;
+    }
+    assigned.insert(node.streams.begin(), node.streams.end());
+  }
+
+  for (const auto &stream : streams_) {
+    if (assigned.count(stream.id) || ended_.count(stream.id)) continue;
+    NodeState *node = PickNode(nullptr);
+    if (!node) break;
+    node->streams.push_back(stream.id);
+    assigned.insert(stream.id);
+  }
+
+  for (uint32_t i = 0; i < config_.max_moves; ++i) {
+    NodeState *most = nullptr;
+    for (auto &it : nodes_) {
+      if (!most || it.second.streams.size() > most->streams.size()) most = &it.second;
+    }
+    NodeState *fewest = most ? PickNode(most) : nullptr;
+    if (!fewest || most->streams.size() <= fewest->streams.size() + 1) break;
+    fewest->streams.push_back(most->streams.back());
+    most->streams.pop_back();
+    ++moved;
+  }
+  return moved;
+}
+
+std::vector<ClusterStream> StreamBalancer::GetAssignment(const std::string &node) const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  std::vector<ClusterStream> streams;
+  auto it = nodes_.find(node);
+  if (it == nodes_.end()) return streams;
+  for (const auto &stream_id : it->second.streams) {
+    // the streams removed by SetStreams are left until the next round
+    auto index = stream_index_.find(stream_id);
+    if (index != stream_index_.end()) streams.push_back(streams_[index->second]);
+  }
+  return streams;
+}
+
+std::vector<std::string> StreamBalancer::GetUnassigned() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  std::set<std::string> assigned;
+  for (const auto &it : nodes_) assigned.insert(it.second.streams.begin(), it.second.streams.end());
+  std::vector<std::string> unassigned;
+  for (const auto &stream : streams_) {
+    if (!assigned.count(stream.id) && !ended_.count(stream.id)) unassigned.push_back(stream.id);
+  }
+  return unassigned;
+}
+
+std::string StreamBalancer::Summary() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  std::ostringstream ss;
+  for (const auto &it : nodes_) {
+    const NodeState &node = it.second;
+    ss << "[" << it.first << "] assigned: " << node.streams.size() << ", running: " << node.report.streams.size()
+       << ", fps: " << node.report.fps << ", queue: " << node.report.queue_fill_ratio
+       << (node.report.blocking ? ", blocking" : "");
+    if (node.capacity_limit) ss << ", capacity: " << node.capacity_limit;
+    ss << "\n";
+  }
+  return ss.str();
+}
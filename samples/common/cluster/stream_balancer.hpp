@@ -0,0 +1,165 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef SAMPLES_COMMON_CLUSTER_STREAM_BALANCER_HPP_
+#define SAMPLES_COMMON_CLUSTER_STREAM_BALANCER_HPP_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A stream shared by the nodes of a cluster.
+ */
+struct ClusterStream {
+  std::string id;   ///< The stream identification, the same on all nodes.
+  std::string url;  ///< The url or file name of the stream, see cns_launcher.
+};
+
+/**
+ * @brief The live state of a node reported to the coordinator periodically.
+ */
+struct NodeReport {
+  std::string node;                  ///< The name of the node.
+  uint32_t max_streams = 0;          ///< The max number of streams of the node. 0 means no limit.
+  double fps = 0;                    ///< The frames per second processed by the pipeline, 0 if it is not profiled.
+  double queue_fill_ratio = 0;       ///< The fill ratio of the fullest input queues of a module.
+  bool blocking = false;             ///< Whether a module is blocking its upstream modules with full queues.
+  std::vector<std::string> streams;  ///< The streams running on the node.
+  std::vector<std::string> ended;    ///< The streams ended on the node by eos or errors.
+};
+
+/**
+ * @class StreamBalancer
+ *
+ * @brief StreamBalancer assigns the streams of a cluster to its nodes according to their live capacity.
+ *
+ * Each balancing round:
+ *   - The nodes which have not reported for ``node_timeout_ms`` leave, their streams are assigned again.
+ *   - A node is overloaded if its fullest queues are filled over ``high_watermark`` or it is blocking its upstream
+ *     modules. Its capacity is estimated as the streams it keeps up with, ``fps / stream_fps``, and the streams over
+ *     the capacity are moved away. The estimation is kept for ``cooldown_ms`` while the node drains.
+ *   - The streams not assigned go to the node with the fewest streams and spare capacity.
+ *   - The streams are evened out by moving at most ``max_moves`` streams from the node with the most streams to the
+ *     node with the fewest ones, e.g. when a node joins.
+ * The ended streams are never assigned again.
+ *
+ * @note The functions are thread-safe.
+ */
+class StreamBalancer {
+ public:
+  /**
+   * @brief The configuration of the balancer.
+   */
+  struct Config {
+    double stream_fps = 25;          ///< The frame rate of a stream, used to estimate the capacity of nodes.
+    double high_watermark = 0.8;     ///< A node is overloaded if its queues are filled over it.
+    int64_t node_timeout_ms = 5000;  ///< A node leaves if it does not report for it.
+    int64_t cooldown_ms = 10000;     ///< How long the capacity estimated for an overloaded node is kept.
+    uint32_t max_moves = 1;          ///< The max number of streams moved to even out the nodes each round.
+  };
+
+  explicit StreamBalancer(const Config &config) : config_(config) {}
+
+  /**
+   * @brief Sets the streams of the cluster. The streams removed are removed from their nodes in the next round.
+   *
+   * @param[in] streams The streams.
+   *
+   * @return No return value.
+   */
+  void SetStreams(const std::vector<ClusterStream> &streams);
+
+  /**
+   * @brief Updates the state of a node. A node joins with its first report.
+   *
+   * @param[in] report The report of the node.
+   * @param[in] now_ms The current time in milliseconds.
+   *
+   * @return No return value.
+   */
+  void Report(const NodeReport &report, int64_t now_ms);
+
+  /**
+   * @brief Removes a node, e.g. when it disconnects. Its streams are assigned again in the next round.
+   *
+   * @param[in] node The name of the node.
+   *
+   * @return No return value.
+   */
+  void RemoveNode(const std::string &node);
+
+  /**
+   * @brief Runs a balancing round.
+   *
+   * @param[in] now_ms The current time in milliseconds.
+   *
+   * @return Returns the number of streams assigned to other nodes or left unassigned in this round.
+   */
+  int Balance(int64_t now_ms);
+
+  /**
+   * @brief Gets the streams assigned to a node.
+   *
+   * @param[in] node The name of the node.
+   *
+   * @return Returns the streams in the order they are assigned.
+   */
+  std::vector<ClusterStream> GetAssignment(const std::string &node) const;
+
+  /**
+   * @brief Gets the streams which are not assigned since no node has spare capacity.
+   *
+   * @return Returns the identifications of the streams.
+   */
+  std::vector<std::string> GetUnassigned() const;
+
+  /**
+   * @brief Gets a summary of the nodes for logging, one line per node.
+   *
+   * @return Returns the summary.
+   */
+  std::string Summary() const;
+
+ private:
+  struct NodeState {
+    NodeReport report;
+    int64_t last_report_ms = 0;
+    std::vector<std::string> streams;  // assigned streams, in the order they are assigned
+    uint32_t capacity_limit = 0;       // estimated when the node is overloaded, 0 means no estimation
+    int64_t limit_until_ms = 0;
+  };
+
+  bool IsOverloaded(const NodeState &node) const;
+  uint32_t Capacity(const NodeState &node) const;
+  NodeState *PickNode(const NodeState *except);
+
+  Config config_;
+  mutable std::mutex mutex_;
+  std::vector<ClusterStream> streams_;
+  std::map<std::string, size_t> stream_index_;  // stream id to index in streams_
+  std::set<std::string> ended_;
+  std::map<std::string, NodeState> nodes_;
+};  // class StreamBalancer
+
+#endif  // SAMPLES_COMMON_CLUSTER_STREAM_BALANCER_HPP_
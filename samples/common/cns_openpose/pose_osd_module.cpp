@@ -82,7 +82,7 @@ class PoseOsd : public cnstream::Module, public cnstream::ModuleCreator<PoseOsd>
     if (total_limbs.size() != nlimbs_) {
       LOGF(POSE_OSD) << "limbs number mismatch!";
     }
-    cv::Mat origin_img = frame->ImageBGR();
+    cv::Mat origin_img = frame->ImageBGRMutable();
     // draw limbs
     for (size_t i = 0; i < total_limbs.size(); ++i) {
       for (const auto& limb : total_limbs[i]) {
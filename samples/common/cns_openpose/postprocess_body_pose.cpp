@@ -24,6 +24,7 @@
 #include <array>
 #include <cmath>
 #include <cstring>
+#include <map>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -57,6 +58,7 @@ class PostprocPose : public cnstream::Postproc {
  public:
   virtual ~PostprocPose() {}
   using Heatmaps = std::array<cv::Mat, knHeatmaps>;
+  bool Init(const std::map<std::string, std::string>& params) override;
   int Execute(const std::vector<float*>& net_outputs, const std::shared_ptr<edk::ModelLoader>& model,
               const cnstream::CNFrameInfoPtr& package) override;
 
@@ -68,13 +70,27 @@ class PostprocPose : public cnstream::Postproc {
   Heatmaps GetHeatmaps(float* net_output, const std::shared_ptr<edk::ModelLoader>& model);
   cns_openpose::Keypoints GetKeypoints(const Heatmaps& heatmaps);
   cns_openpose::Limbs GetLimbs(const Heatmaps& heatmaps, const cns_openpose::Keypoints& keypoints);
+  bool nhwc_ = false;  // the heatmaps are interleaved, see Init
 };  // class PostprocPose
 
+template<int knKeypoints, int knLimbs>
+bool PostprocPose<knKeypoints, knLimbs>::Init(const std::map<std::string, std::string>& params) {
+  // set to the data_order of the Inferencer module
+  auto iter = params.find("data_order");
+  if (iter == params.end()) return true;
+  if (iter->second != "NCHW" && iter->second != "NHWC") {
+    LOGE(POSTPROC_POSE) << "data_order should be NCHW or NHWC, but got " << iter->second;
+    return false;
+  }
+  nhwc_ = iter->second == "NHWC";
+  return true;
+}
+
 template<int knKeypoints, int knLimbs>
 int PostprocPose<knKeypoints, knLimbs>::Execute(const std::vector<float*>& net_outputs,
                                                 const std::shared_ptr<edk::ModelLoader>& model,
                                                 const cnstream::CNFrameInfoPtr& package) {
-  // model output in NCHW order. see parameter named data_order in Inferencer module.
+  // model output in NCHW or NHWC order. see parameter named data_order in Inferencer module and Init.
   if (model->OutputShape(0).C() != knHeatmaps)
     LOGF(POSTPROC_POSE) << "The number of heatmaps in model mismatched.";
   auto frame = package->collection.Get<cnstream::CNDataFramePtr>(cnstream::kCNDataFrameTag);
@@ -95,8 +111,14 @@ PostprocPose<knKeypoints, knLimbs>::GetHeatmaps(float* net_output, const std::sh
   const int src_h = model->OutputShape(0).H();
   const int src_heatmap_len = src_w * src_h;
   const cv::Size dst_size(model->InputShape(0).W(), model->InputShape(0).H());
+  std::vector<cv::Mat> planes;
+  if (nhwc_) {
+    // the output keeps the order of the model, the heatmaps are split in one pass instead of transposing the output
+    // on host before postprocessing
+    cv::split(cv::Mat(src_h, src_w, CV_32FC(knHeatmaps), net_output), planes);
+  }
   for (int i = 0; i < knHeatmaps; ++i) {
-    cv::Mat src(src_h, src_w, CV_32FC1, net_output + i * src_heatmap_len);
+    cv::Mat src = nhwc_ ? planes[i] : cv::Mat(src_h, src_w, CV_32FC1, net_output + i * src_heatmap_len);
     cv::Mat dst;
     cv::resize(src, dst, dst_size, cv::INTER_CUBIC);
     heatmaps[i] = std::move(dst);
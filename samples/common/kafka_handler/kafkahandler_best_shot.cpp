@@ -0,0 +1,92 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <memory>
+#include <string>
+
+#include "kafka_client.h"
+#include "rapidjson/writer.h"
+
+#include "best_shot.hpp"
+#include "cnstream_logging.hpp"
+#include "kafka_handler.hpp"
+
+// Produces the best shots picked by the BestShot module, one message per image. A message is a line of JSON
+// describing the object followed by the JPEG data, e.g.
+//   {"StreamName":"0","TrackId":"3","Label":"2","Score":0.9,"FrameCount":120,"BBox":{...},"Size":5321}\n<JPEG>
+// Frames without best shots produce nothing.
+class BestShotKafkaHandler : public cnstream::KafkaHandler {
+ public:
+  ~BestShotKafkaHandler() {}
+  int UpdateFrame(const cnstream::CNFrameInfoPtr& data) override;
+  bool NeedsPixels() const override { return false; }
+  DECLARE_REFLEX_OBJECT_EX(BestShotKafkaHandler, cnstream::KafkaHandler)
+ private:
+  rapidjson::StringBuffer buffer_;
+  rapidjson::Writer<rapidjson::StringBuffer> writer_;
+  std::string message_;  // reused by images to avoid allocations
+};
+
+IMPLEMENT_REFLEX_OBJECT_EX(BestShotKafkaHandler, cnstream::KafkaHandler)
+
+int BestShotKafkaHandler::UpdateFrame(const std::shared_ptr<cnstream::CNFrameInfo>& data) {
+  if (data->IsEos() || !data->collection.HasValue(cnstream::kBestShotImagesTag)) return 0;
+  auto images = data->collection.Get<cnstream::BestShotImages>(cnstream::kBestShotImagesTag);
+  for (const auto& image : images) {
+    buffer_.Clear();
+    writer_.Reset(buffer_);
+    writer_.StartObject();
+    writer_.String("StreamName");
+    writer_.String(image->stream_id.c_str(), static_cast<rapidjson::SizeType>(image->stream_id.length()));
+    writer_.String("TrackId");
+    writer_.String(image->track_id.c_str(), static_cast<rapidjson::SizeType>(image->track_id.length()));
+    writer_.String("Label");
+    writer_.String(image->label.c_str(), static_cast<rapidjson::SizeType>(image->label.length()));
+    writer_.String("Score");
+    writer_.Double(image->score);
+    writer_.String("FrameCount");
+    writer_.Uint64(image->frame_id);
+    writer_.String("Timestamp");
+    writer_.Int64(image->timestamp);
+    writer_.String("BBox");
+    writer_.StartObject();
+    writer_.String("x");
+    writer_.Double(image->bbox.x);
+    writer_.String("y");
+    writer_.Double(image->bbox.y);
+    writer_.String("w");
+    writer_.Double(image->bbox.w);
+    writer_.String("h");
+    writer_.Double(image->bbox.h);
+    writer_.EndObject();
+    writer_.String("Size");
+    writer_.Uint64(image->jpeg.size());
+    writer_.EndObject();
+
+    message_.assign(buffer_.GetString(), buffer_.GetSize());
+    message_.push_back('\n');
+    message_.append(image->jpeg);
+    if (!Produce(message_)) {
+      LOGE(BESTSHOTKAFKAHANDLER) << "Produce Kafka message failed!";
+      return -1;
+    }
+  }
+  return 0;
+}
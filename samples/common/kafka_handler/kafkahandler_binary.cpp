@@ -0,0 +1,58 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+#include <memory>
+#include <string>
+
+#include "kafka_client.h"
+
+#include "cnstream_infer_objs_codec.hpp"
+#include "cnstream_logging.hpp"
+#include "kafka_handler.hpp"
+
+// Produces the inference objects in the binary format of cnstream::InferObjsCodec instead of JSON. The messages are
+// about a third of the size of the ones produced by DefaultKafkaHandler and several times faster to build.
+class BinaryKafkaHandler : public cnstream::KafkaHandler {
+ public:
+  ~BinaryKafkaHandler() {}
+  int UpdateFrame(const cnstream::CNFrameInfoPtr& data) override;
+  bool NeedsPixels() const override { return false; }
+  DECLARE_REFLEX_OBJECT_EX(BinaryKafkaHandler, cnstream::KafkaHandler)
+ private:
+  std::string buffer_;  // reused by frames to avoid allocations
+};
+
+IMPLEMENT_REFLEX_OBJECT_EX(BinaryKafkaHandler, cnstream::KafkaHandler)
+
+int BinaryKafkaHandler::UpdateFrame(const std::shared_ptr<cnstream::CNFrameInfo>& data) {
+  if (data->IsEos()) return 0;
+  buffer_.clear();
+  if (!cnstream::InferObjsCodec::Encode(data, cnstream::InferObjsCodec::EXTRA_ATTRIBUTES, &buffer_)) {
+    LOGW(BINARYKAFKAHANDLER) << "Encode inference objects failed!";
+    return 0;
+  }
+
+  // Produce Kafka Message
+  if (!Produce(buffer_)) {
+    LOGE(BINARYKAFKAHANDLER) << "Produce Kafka message failed!";
+    return -1;
+  }
+
+  return 0;
+}
@@ -22,7 +22,7 @@
 #include <string>
 
 #include "kafka_client.h"
-#include "rapidjson/prettywriter.h"
+#include "rapidjson/writer.h"
 
 #include "cnstream_logging.hpp"
 #include "kafka_handler.hpp"
@@ -31,10 +31,11 @@ class DefaultKafkaHandler : public cnstream::KafkaHandler {
  public:
   ~DefaultKafkaHandler() {}
   int UpdateFrame(const cnstream::CNFrameInfoPtr& data) override;
+  bool NeedsPixels() const override { return false; }
   DECLARE_REFLEX_OBJECT_EX(DefaultKafkaHandler, cnstream::KafkaHandler)
  private:
   rapidjson::StringBuffer buffer_;
-  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer_;
+  rapidjson::Writer<rapidjson::StringBuffer> writer_;
 };
 
 IMPLEMENT_REFLEX_OBJECT_EX(DefaultKafkaHandler, cnstream::KafkaHandler)
@@ -0,0 +1,103 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <memory>
+#include <string>
+
+#include "kafka_client.h"
+#include "rapidjson/writer.h"
+
+#include "cnstream_logging.hpp"
+#include "kafka_handler.hpp"
+#include "track_event.hpp"
+
+// Produces the track events emitted by the TrackEventEmitter module, one message per frame, e.g.
+//   {"StreamName":"0","Timestamp":4800,"Events":[
+//     {"Type":"appear","TrackId":"3","Label":"2","Score":0.9,"FrameCount":120,"BBox":{...},"Frames":1},...]}
+// Frames without events produce nothing. The tracks left at the end of a stream disappear with the EOS frame.
+class TrackEventKafkaHandler : public cnstream::KafkaHandler {
+ public:
+  ~TrackEventKafkaHandler() {}
+  int UpdateFrame(const cnstream::CNFrameInfoPtr& data) override;
+  bool NeedsPixels() const override { return false; }
+  DECLARE_REFLEX_OBJECT_EX(TrackEventKafkaHandler, cnstream::KafkaHandler)
+ private:
+  rapidjson::StringBuffer buffer_;
+  rapidjson::Writer<rapidjson::StringBuffer> writer_;
+};
+
+IMPLEMENT_REFLEX_OBJECT_EX(TrackEventKafkaHandler, cnstream::KafkaHandler)
+
+static const char* TrackEventTypeName(cnstream::TrackEventType type) {
+  switch (type) {
+    case cnstream::TrackEventType::APPEAR: return "appear";
+    case cnstream::TrackEventType::UPDATE: return "update";
+    default: return "disappear";
+  }
+}
+
+int TrackEventKafkaHandler::UpdateFrame(const std::shared_ptr<cnstream::CNFrameInfo>& data) {
+  if (!data->collection.HasValue(cnstream::kTrackEventsTag)) return 0;
+  const auto& events = data->collection.Get<cnstream::TrackEvents>(cnstream::kTrackEventsTag);
+  buffer_.Clear();
+  writer_.Reset(buffer_);
+  writer_.StartObject();
+  writer_.String("StreamName");
+  writer_.String(data->stream_id.c_str(), static_cast<rapidjson::SizeType>(data->stream_id.length()));
+  writer_.String("Timestamp");
+  writer_.Int64(data->timestamp);
+  writer_.String("Events");
+  writer_.StartArray();
+  for (const auto& event : events) {
+    writer_.StartObject();
+    writer_.String("Type");
+    writer_.String(TrackEventTypeName(event.type));
+    writer_.String("TrackId");
+    writer_.String(event.track_id.c_str(), static_cast<rapidjson::SizeType>(event.track_id.length()));
+    writer_.String("Label");
+    writer_.String(event.label.c_str(), static_cast<rapidjson::SizeType>(event.label.length()));
+    writer_.String("Score");
+    writer_.Double(event.score);
+    writer_.String("FrameCount");
+    writer_.Uint64(event.frame_id);
+    writer_.String("BBox");
+    writer_.StartObject();
+    writer_.String("x");
+    writer_.Double(event.bbox.x);
+    writer_.String("y");
+    writer_.Double(event.bbox.y);
+    writer_.String("w");
+    writer_.Double(event.bbox.w);
+    writer_.String("h");
+    writer_.Double(event.bbox.h);
+    writer_.EndObject();
+    writer_.String("Frames");
+    writer_.Uint64(event.frames);
+    writer_.EndObject();
+  }
+  writer_.EndArray();
+  writer_.EndObject();
+
+  if (!Produce(std::string(buffer_.GetString(), buffer_.GetSize()))) {
+    LOGE(TRACKEVENTKAFKAHANDLER) << "Produce Kafka message failed!";
+    return -1;
+  }
+  return 0;
+}
@@ -23,18 +23,13 @@
 #include <utility>
 #include <vector>
 
-#include "obj_filter.hpp"
+#include "cnstream_obj_predicate.hpp"
 
-class CarFilter : public cnstream::ObjFilter {
+class CarFilter : public cnstream::PredicateObjFilter {
  public:
-  bool Filter(const cnstream::CNFrameInfoPtr& finfo, const cnstream::CNInferObjectPtr& obj) override {
-    // for ssd with cnstream/data/models/label_voc.txt
-    int id = atoi(obj->id.c_str());
-    if (6 == id)
-      return true;  // cars will be inferenced.
-    else if (5 == id)
-      return true;  // bus will be inferenced.
-    return false;
+  CarFilter() {
+    // for ssd with cnstream/data/models/label_voc.txt, cars (6) and buses (5) will be inferenced.
+    predicate_.SetLabels({5, 6});
   }
 
   DECLARE_REFLEX_OBJECT_EX(CarFilter, cnstream::ObjFilter)
@@ -23,24 +23,13 @@
 #include <utility>
 #include <vector>
 
-#include "obj_filter.hpp"
+#include "cnstream_obj_predicate.hpp"
 
-class VehicleFilter : public cnstream::ObjFilter {
+class VehicleFilter : public cnstream::PredicateObjFilter {
  public:
-  bool Filter(const cnstream::CNFrameInfoPtr& finfo, const cnstream::CNInferObjectPtr& obj) override {
-    // for yolov3 with cnstream/data/models/label_map_coco.txt
-    int id = atoi(obj->id.c_str());
-    switch (id) {
-      // car
-      case 2:
-      // bus
-      case 5:
-      // truck
-      case 7:
-        return true;
-      default:
-        return false;
-    }
+  VehicleFilter() {
+    // for yolov3 with cnstream/data/models/label_map_coco.txt, cars (2), buses (5) and trucks (7).
+    predicate_.SetLabels({2, 5, 7});
   }
 
   DECLARE_REFLEX_OBJECT_EX(VehicleFilter, cnstream::ObjFilter)
@@ -65,8 +65,7 @@ int PostprocClassification::Execute(const std::vector<float*>& net_outputs,
   obj->score = mscore;
 
   cnstream::CNInferObjsPtr objs_holder = package->collection.Get<cnstream::CNInferObjsPtr>(cnstream::kCNInferObjsTag);
-  std::lock_guard<std::mutex> objs_mutex(objs_holder->mutex_);
-  objs_holder->objs_.push_back(obj);
+  objs_holder->Append({obj});
   return 0;
 }
 
@@ -100,6 +100,7 @@ int PostprocMSSDPlateDetection::Execute(const std::vector<float*>& net_outputs,
   cnstream::CNObjsVec& objs = objs_holder->objs_;
   std::lock_guard<std::mutex> lk(objs_holder->mutex_);
   objs.push_back(plate_object);
+  objs_holder->Publish();
   return 0;
 }
 
@@ -70,7 +70,7 @@ int PostprocSsd::Execute(const std::vector<float*>& net_outputs, const std::shar
   for (decltype(box_num) bi = 0; bi < box_num; ++bi) {
     if (data[1] == 0) continue;
     if (threshold_ > 0 && data[2] < threshold_) continue;
-    std::shared_ptr<cnstream::CNInferObject> object = std::make_shared<cnstream::CNInferObject>();
+    std::shared_ptr<cnstream::CNInferObject> object = objs_holder->CreateObject();
     object->id = std::to_string(data[1] - 1);
     object->score = data[2];
     object->bbox.x = data[3];
@@ -82,5 +82,6 @@ int PostprocSsd::Execute(const std::vector<float*>& net_outputs, const std::shar
     objs.push_back(object);
     data += 7;
   }
+  objs_holder->Publish();
   return 0;
 }
@@ -86,7 +86,7 @@ class PostprocYolov5 : public cnstream::Postproc {
       top = range_0_1(top);
       bottom = range_0_1(bottom);
 
-      auto obj = std::make_shared<cnstream::CNInferObject>();
+      auto obj = objs_holder->CreateObject();
       obj->id = std::to_string(static_cast<int>(net_output[64 + box_idx * box_step + 1]));
       obj->score = net_output[64 + box_idx * box_step + 2];
 
@@ -99,6 +99,7 @@ class PostprocYolov5 : public cnstream::Postproc {
       std::lock_guard<std::mutex> objs_mutex(objs_holder->mutex_);
       objs.push_back(obj);
     }
+    objs_holder->Publish();
 
     return 0;
   }
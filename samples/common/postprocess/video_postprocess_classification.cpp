@@ -78,8 +78,7 @@ bool VideoPostprocClassification::Execute(infer_server::InferData* output_data,
 
   cnstream::CNFrameInfoPtr frame = output_data->GetUserData<cnstream::CNFrameInfoPtr>();
   cnstream::CNInferObjsPtr objs_holder = frame->collection.Get<cnstream::CNInferObjsPtr>(cnstream::kCNInferObjsTag);
-  std::lock_guard<std::mutex> objs_mutex(objs_holder->mutex_);
-  objs_holder->objs_.push_back(obj);
+  objs_holder->Append({obj});
   return true;
 }
 
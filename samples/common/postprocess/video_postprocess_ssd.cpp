@@ -18,6 +18,7 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -25,6 +26,7 @@
 
 #include "cnstream_frame_va.hpp"
 #include "cnstream_logging.hpp"
+#include "detection_postproc.hpp"
 #include "video_postproc.hpp"
 
 /**
@@ -58,28 +60,16 @@ bool VideoPostprocSsd::Execute(infer_server::InferData* output_data,
   LOGF_IF(DEMO, model_info->OutputNum() != 1) << "VideoPostprocSsd: model output number is not equal to 1";
   LOGF_IF(DEMO, model_output.buffers.size() != 1) << "VideoPostprocSsd: model result size is not equal to 1";
 
-  cnstream::CNObjsVec objs;
-
   const float* data = reinterpret_cast<const float*>(model_output.buffers[0].Data());
-  unsigned box_num = static_cast<unsigned>(data[0]);
-  data += 64;
-  for (unsigned bi = 0; bi < box_num; ++bi) {
-    if (data[1] == 0) continue;
-    if (threshold_ > 0 && data[2] < threshold_) continue;
-    std::shared_ptr<cnstream::CNInferObject> object = std::make_shared<cnstream::CNInferObject>();
-    object->id = std::to_string(static_cast<int>(data[1] - 1));
-    object->score = data[2];
-    object->bbox.x = data[3];
-    object->bbox.y = data[4];
-    object->bbox.w = data[5] - object->bbox.x;
-    object->bbox.h = data[6] - object->bbox.y;
+  const int box_num = static_cast<int>(data[0]);
+  // the coordinates are normalized, and the input frame of the model does not keep aspect ratio
+  cnstream::BoxRectifier rectifier(1, 1, 1, 1, false, true);
+  std::vector<cnstream::DetectionBox> boxes;
+  // label 0 is the background
+  cnstream::DecodeDetections(data + 64, std::max(box_num, 0), threshold_, rectifier, &boxes, -1);
 
-    objs.push_back(object);
-    data += 7;
-  }
   cnstream::CNFrameInfoPtr frame = output_data->GetUserData<cnstream::CNFrameInfoPtr>();
   cnstream::CNInferObjsPtr objs_holder = frame->collection.Get<cnstream::CNInferObjsPtr>(cnstream::kCNInferObjsTag);
-  std::lock_guard<std::mutex> objs_mutex(objs_holder->mutex_);
-  objs_holder->objs_.insert(objs_holder->objs_.end(), objs.begin(), objs.end());
+  cnstream::AppendInferObjects(boxes, objs_holder.get());
   return true;
 }
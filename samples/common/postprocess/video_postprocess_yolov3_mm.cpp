@@ -26,6 +26,7 @@
 
 #include "cnstream_frame_va.hpp"
 #include "cnstream_logging.hpp"
+#include "detection_postproc.hpp"
 #include "video_postproc.hpp"
 
 /**
@@ -61,11 +62,12 @@ bool VideoPostprocYolov3MM::Execute(infer_server::InferData* output_data, const
 
   cnstream::CNFrameInfoPtr frame = output_data->GetUserData<cnstream::CNFrameInfoPtr>();
   cnstream::CNInferObjsPtr objs_holder = frame->collection.Get<cnstream::CNInferObjsPtr>(cnstream::kCNInferObjsTag);
-  cnstream::CNObjsVec& objs = objs_holder->objs_;
 
   const auto input_sp = model_info->InputShape(0);
-  const int img_w = frame->collection.Get<cnstream::CNDataFramePtr>(cnstream::kCNDataFrameTag)->width;
-  const int img_h = frame->collection.Get<cnstream::CNDataFramePtr>(cnstream::kCNDataFrameTag)->height;
+  // the image is the region of interest the input is cropped from, the boxes are mapped back by Inferencer2
+  const cnstream::CNInferBoundingBox roi = GetInputRoi();
+  const int img_w = frame->collection.Get<cnstream::CNDataFramePtr>(cnstream::kCNDataFrameTag)->width * roi.w;
+  const int img_h = frame->collection.Get<cnstream::CNDataFramePtr>(cnstream::kCNDataFrameTag)->height * roi.h;
 
   int w_idx = 2;
   int h_idx = 1;
@@ -76,57 +78,23 @@ bool VideoPostprocYolov3MM::Execute(infer_server::InferData* output_data, const
   const int model_input_w = static_cast<int>(input_sp[w_idx]);
   const int model_input_h = static_cast<int>(input_sp[h_idx]);
 
-  // scaling factors
-  const float scaling_factors = std::min(1.0 * model_input_w / img_w, 1.0 * model_input_h / img_h);
-
   // The input frame of the model should keep aspect ratio.
   // If mlu resize and convert operator is used as preproc, parameter keep_aspect_ratio of Inferencer2 module
   // should be set to true in config json file.
   // If cpu preproc is used as preproc, please make sure keep aspect ratio in custom preproc.
   // Scaler does not support keep aspect ratio.
-  // If the input frame does not keep aspect ratio, set scaled_w = model_input_w and scaled_h = model_input_h
-
-  // scaled size
-  const int scaled_w = scaling_factors * img_w;
-  const int scaled_h = scaling_factors * img_h;
+  // If the input frame does not keep aspect ratio, set keep_aspect_ratio of the rectifier to false.
+  cnstream::BoxRectifier rectifier(model_input_w, model_input_h, img_w, img_h, true, true);
 
   // second output contains box_num
   const int box_num = reinterpret_cast<const int*>(model_output.buffers[1].Data())[0];
-  int box_step = 7;
-  auto range_0_1 = [](float num) { return std::max(.0f, std::min(1.0f, num)); };
 
   // first output contains box, score and label
   const float* net_output = reinterpret_cast<const float*>(model_output.buffers[0].Data());
 
-  for (int box_idx = 0; box_idx < box_num; ++box_idx) {
-    float left = range_0_1(net_output[box_idx * box_step + 3]);
-    float right = range_0_1(net_output[box_idx * box_step + 5]);
-    float top = range_0_1(net_output[box_idx * box_step + 4]);
-    float bottom = range_0_1(net_output[box_idx * box_step + 6]);
-
-    // rectify
-    left = (left * model_input_w - (model_input_w - scaled_w) / 2) / scaled_w;
-    right = (right * model_input_w - (model_input_w - scaled_w) / 2) / scaled_w;
-    top = (top * model_input_h - (model_input_h - scaled_h) / 2) / scaled_h;
-    bottom = (bottom * model_input_h - (model_input_h - scaled_h) / 2) / scaled_h;
-    left = std::max(0.0f, left);
-    right = std::max(0.0f, right);
-    top = std::max(0.0f, top);
-    bottom = std::max(0.0f, bottom);
-
-    auto obj = std::make_shared<cnstream::CNInferObject>();
-    obj->id = std::to_string(static_cast<int>(net_output[box_idx * box_step + 1]));
-    obj->score = net_output[box_idx * box_step + 2];
-
-    obj->bbox.x = left;
-    obj->bbox.y = top;
-    obj->bbox.w = std::min(1.0f - obj->bbox.x, right - left);
-    obj->bbox.h = std::min(1.0f - obj->bbox.y, bottom - top);
-
-    if (obj->bbox.h <= 0 || obj->bbox.w <= 0 || (obj->score < threshold_ && threshold_ > 0)) continue;
-    std::lock_guard<std::mutex> objs_mutex(objs_holder->mutex_);
-    objs.push_back(obj);
-  }
+  std::vector<cnstream::DetectionBox> boxes;
+  cnstream::DecodeDetections(net_output, std::max(box_num, 0), threshold_, rectifier, &boxes);
+  cnstream::AppendInferObjects(boxes, objs_holder.get());
 
   return true;
 }
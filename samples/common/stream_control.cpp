@@ -0,0 +1,117 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "stream_control.hpp"
+
+#include <string>
+#include <utility>
+
+#include "rapidjson/document.h"
+
+#include "cnstream_logging.hpp"
+
+StreamControl::StreamControl(AddStream add, RemoveStream remove, ReloadModel reload)
+    : add_(std::move(add)), remove_(std::move(remove)), reload_(std::move(reload)) {}
+
+void StreamControl::Start() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (running_) return;
+  running_ = true;
+  thread_ = std::thread(&StreamControl::Loop, this);
+}
+
+void StreamControl::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!running_) return;
+    running_ = false;
+  }
+  wakener_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+cnstream::EventHandleFlag StreamControl::OnEvent(const cnstream::Event &event) {
+  if (event.type != cnstream::EventType::EVENT_CONTROL) return cnstream::EventHandleFlag::EVENT_HANDLE_NULL;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!running_) return cnstream::EventHandleFlag::EVENT_HANDLE_NULL;
+    messages_.push_back(event.message);
+  }
+  wakener_.notify_one();
+  return cnstream::EventHandleFlag::EVENT_HANDLE_SYNCED;
+}
+
+void StreamControl::Loop() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (true) {
+    wakener_.wait(lk, [this] { return !running_ || !messages_.empty(); });
+    if (!running_) break;
+    std::string message = std::move(messages_.front());
+    messages_.pop_front();
+    lk.unlock();
+    Apply(message);
+    lk.lock();
+  }
+}
+
+void StreamControl::Apply(const std::string &message) {
+  rapidjson::Document doc;
+  if (doc.Parse(message.c_str()).HasParseError() || !doc.IsObject() || !doc.HasMember("action") ||
+      !doc["action"].IsString()) {
+    LOGW(DEMO) << "Invalid control message: " << message;
+    return;
+  }
+  const std::string action = doc["action"].GetString();
+  if (action == "reload_model") {
+    if (!doc.HasMember("module") || !doc["module"].IsString() || !doc.HasMember("model_path") ||
+        !doc["model_path"].IsString()) {
+      LOGW(DEMO) << "Control message of reloading model has no module or model_path: " << message;
+      return;
+    }
+    const std::string module_name = doc["module"].GetString();
+    if (reload_ && reload_(module_name, doc["model_path"].GetString())) {
+      LOGI(DEMO) << "Module [" << module_name << "] is reloading model by control message";
+    } else {
+      LOGW(DEMO) << "Reload model of module [" << module_name << "] by control message failed";
+    }
+    return;
+  }
+  if (!doc.HasMember("stream_id") || !doc["stream_id"].IsString()) {
+    LOGW(DEMO) << "Invalid control message: " << message;
+    return;
+  }
+  const std::string stream_id = doc["stream_id"].GetString();
+  if (action == "add") {
+    if (!doc.HasMember("url") || !doc["url"].IsString()) {
+      LOGW(DEMO) << "Control message of adding stream [" << stream_id << "] has no url";
+      return;
+    }
+    if (add_(stream_id, doc["url"].GetString())) {
+      LOGI(DEMO) << "Stream [" << stream_id << "] is added by control message";
+    } else {
+      LOGW(DEMO) << "Add stream [" << stream_id << "] by control message failed";
+    }
+  } else if (action == "remove") {
+    remove_(stream_id);
+    LOGI(DEMO) << "Stream [" << stream_id << "] is removed by control message";
+  } else {
+    LOGW(DEMO) << "Unknown action of control message: " << action;
+  }
+}
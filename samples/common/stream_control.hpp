@@ -0,0 +1,106 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef SAMPLES_COMMON_STREAM_CONTROL_HPP_
+#define SAMPLES_COMMON_STREAM_CONTROL_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "cnstream_eventbus.hpp"
+
+/**
+ * @class StreamControl
+ *
+ * @brief StreamControl adds and removes streams, and reloads models, by the control messages posted to the event bus,
+ *        e.g. by the Kafka module consuming a control topic.
+ *
+ * A control message is a JSON object:
+ *
+ * @verbatim
+ * {"action": "add", "stream_id": "camera_0", "url": "rtsp://..."}
+ * {"action": "remove", "stream_id": "camera_0"}
+ * {"action": "reload_model", "module": "detector", "model_path": "/models/yolov3.cambricon"}
+ * @endverbatim
+ *
+ * The bus watcher only queues the messages, they are applied in order by a thread of StreamControl, so that the event
+ * loop is not blocked by opening or removing streams.
+ */
+class StreamControl {
+ public:
+  /**
+   * @brief Adds a stream to the pipeline. Returns false if the stream fails to be added.
+   */
+  using AddStream = std::function<bool(const std::string &stream_id, const std::string &url)>;
+  /**
+   * @brief Removes a stream from the pipeline.
+   */
+  using RemoveStream = std::function<void(const std::string &stream_id)>;
+  /**
+   * @brief Loads another model for an inference module without stopping the pipeline. Returns false if the model
+   *        fails to be reloaded.
+   */
+  using ReloadModel = std::function<bool(const std::string &module_name, const std::string &model_path)>;
+
+  StreamControl(AddStream add, RemoveStream remove, ReloadModel reload = nullptr);
+  ~StreamControl() { Stop(); }
+
+  /**
+   * @brief Starts applying the control messages in a thread.
+   *
+   * @return No return value.
+   */
+  void Start();
+
+  /**
+   * @brief Stops applying. The messages left are dropped.
+   *
+   * @return No return value.
+   */
+  void Stop();
+
+  /**
+   * @brief The bus watcher queuing the control messages.
+   *
+   * @param[in] event The event.
+   *
+   * @return Returns EVENT_HANDLE_SYNCED for control messages, EVENT_HANDLE_NULL for other events.
+   */
+  cnstream::EventHandleFlag OnEvent(const cnstream::Event &event);
+
+ private:
+  void Loop();
+  void Apply(const std::string &message);
+
+  AddStream add_;
+  RemoveStream remove_;
+  ReloadModel reload_;
+  bool running_ = false;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable wakener_;
+  std::deque<std::string> messages_;
+};  // class StreamControl
+
+#endif  // SAMPLES_COMMON_STREAM_CONTROL_HPP_
@@ -33,6 +33,7 @@
 #include <fstream>
 #include <limits>
 #include <list>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -200,7 +201,10 @@ void PrintProcessPerformance(std::ostream& os, const cnstream::ProcessProfile& p
     if (FLAGS_perf_level == 1) {
       os << "[Latency]: (Avg): " << profile.latency << "ms";
       os << ", (Min): " << profile.minimum_latency << "ms";
-      os << ", (Max): " << profile.maximum_latency << "ms" << std::endl;
+      os << ", (Max): " << profile.maximum_latency << "ms";
+      os << ", (P50): " << profile.latency_p50 << "ms";
+      os << ", (P99): " << profile.latency_p99 << "ms";
+      os << ", (P999): " << profile.latency_p999 << "ms" << std::endl;
     }
     os << "[Counter]: " << profile.counter;
     os << ", [Throughput]: " << profile.fps << "fps" << std::endl;
@@ -211,7 +215,10 @@ void PrintProcessPerformance(std::ostream& os, const cnstream::ProcessProfile& p
     os << ", [Ongoing]: " << profile.ongoing << std::endl;
     os << "[Latency]: (Avg): " << profile.latency << "ms";
     os << ", (Min): " << profile.minimum_latency << "ms";
-    os << ", (Max): " << profile.maximum_latency << "ms" << std::endl;
+    os << ", (Max): " << profile.maximum_latency << "ms";
+    os << ", (P50): " << profile.latency_p50 << "ms";
+    os << ", (P99): " << profile.latency_p99 << "ms";
+    os << ", (P999): " << profile.latency_p999 << "ms" << std::endl;
     os << "[Throughput]: " << profile.fps << "fps" << std::endl;
   }
 
@@ -229,7 +236,10 @@ void PrintProcessPerformance(std::ostream& os, const cnstream::ProcessProfile& p
       os << std::string(stream_name_max_length, ' ');
       os << "[Latency]: (Avg): " << stream_profile.latency << "ms";
       os << ", (Min): " << stream_profile.minimum_latency << "ms";
-      os << ", (Max): " << stream_profile.maximum_latency << "ms" << std::endl;
+      os << ", (Max): " << stream_profile.maximum_latency << "ms";
+      os << ", (P50): " << stream_profile.latency_p50 << "ms";
+      os << ", (P99): " << stream_profile.latency_p99 << "ms";
+      os << ", (P999): " << stream_profile.latency_p999 << "ms" << std::endl;
       os << std::string(stream_name_max_length, ' ');
       os << "[Throughput]: " << stream_profile.fps << "fps" << std::endl;
     }
@@ -255,9 +265,86 @@ void PrintPipelinePerformance(const std::string& prefix_str, const cnstream::Pip
       ss << "Process Name: [" << process_profile.process_name << "\033[0m" << "]\n";
       PrintProcessPerformance(ss, process_profile);
     }
+    if (FLAGS_perf_level >= 3 && module_profile.stream_conveyors.size()) {
+      ss << "\n------ Stream Conveyor ------\n";
+      for (const auto& it : module_profile.stream_conveyors) {
+        ss << "[" << it.first << "]: " << it.second << std::endl;
+      }
+    }
+    if (FLAGS_perf_level >= 2 && module_profile.counters.size()) {
+      ss << "\n------ Counters ------\n";
+      for (const auto& it : module_profile.counters) {
+        ss << "[" << it.first << "]: " << it.second << std::endl;
+      }
+    }
+    const cnstream::FrameAccounting& accounting = module_profile.frame_accounting;
+    if (accounting.dropped || accounting.stalled > 0) {
+      ss << "\n------ Frame Accounting ------\n";
+      ss << "[received]: " << accounting.received << ", [dropped]: " << accounting.dropped;
+      for (const auto& it : accounting.dropped_by_reason) ss << ", [" << it.first << "]: " << it.second;
+      ss << ", [stalled]: " << accounting.stalled << "ms" << std::endl;
+      if (FLAGS_perf_level >= 3) {
+        for (const auto& stream : module_profile.stream_frame_accountings) {
+          ss << "[" << stream.stream_name << "]: received " << stream.received << ", dropped " << stream.dropped
+             << ", stalled " << stream.stalled << "ms" << std::endl;
+        }
+      }
+    }
+    std::map<std::string, uint64_t> counters(module_profile.counters.begin(), module_profile.counters.end());
+    if (counters["perf_samples"]) {
+      const double samples = counters["perf_samples"];
+      ss << "\n------ Hardware Counters (per call) ------\n";
+      ss << "[cycles]: " << counters["perf_cycles"] / samples << ", [IPC]: "
+         << (counters["perf_cycles"] ? 1.0 * counters["perf_instructions"] / counters["perf_cycles"] : 0)
+         << ", [LLC misses]: " << counters["perf_llc_misses"] / samples
+         << ", [context switches]: " << counters["perf_context_switches"] / samples << std::endl;
+    }
   }
   ss << "\n\033[1m\033[32m" << FillStr("  Overall  ", length, '-') << "\033[0m\n";
   PrintProcessPerformance(ss, profile.overall_profile);
+  if (profile.memory_usage.peak_host_bytes || profile.memory_usage.peak_device_bytes) {
+    const double mb = 1024.0 * 1024.0;
+    ss << "\n\033[1m\033[32m" << FillStr("  Memory  ", length, '-') << "\033[0m\n";
+    ss << "[Host]: " << profile.memory_usage.host_bytes / mb << "MB"
+       << ", (Peak): " << profile.memory_usage.peak_host_bytes / mb << "MB";
+    ss << ", [Device]: " << profile.memory_usage.device_bytes / mb << "MB"
+       << ", (Peak): " << profile.memory_usage.peak_device_bytes / mb << "MB" << std::endl;
+    if (FLAGS_perf_level >= 2) {
+      for (const auto& it : profile.stream_memory_usages) {
+        ss << "[" << it.first << "]: [Host]: " << it.second.host_bytes / mb << "MB"
+           << ", [Device]: " << it.second.device_bytes / mb << "MB" << std::endl;
+      }
+    }
+  }
+  if (!profile.latency_breakdowns.empty()) {
+    ss << "\n\033[1m\033[32m" << FillStr("  Latency Breakdown  ", length, '-') << "\033[0m\n";
+    for (const auto& breakdown : profile.latency_breakdowns) {
+      ss << "[" << breakdown.stream_name << "]: frames: " << breakdown.frames << ", latency: " << breakdown.latency
+         << " ms, bottleneck: [" << breakdown.bottleneck_module << "]" << std::endl;
+      if (FLAGS_perf_level < 2) continue;
+      for (const auto& module : breakdown.modules) {
+        ss << "    [" << module.module_name << "]: queue wait: " << module.queue_wait << " ms (max "
+           << module.maximum_queue_wait << " ms), process: " << module.process << " ms, critical: "
+           << module.critical_frames << " frames, " << module.critical_queue_wait << " + " << module.critical_process
+           << " ms" << std::endl;
+      }
+    }
+  }
+  if (!profile.device_utilizations.empty()) {
+    ss << "\n\033[1m\033[32m" << FillStr("  Devices  ", length, '-') << "\033[0m\n";
+    for (const auto& device : profile.device_utilizations) {
+      ss << "[Device " << device.device_id << "]: core: " << device.core_utilization << "%, memory: "
+         << device.memory_utilization << "%, codec: " << device.codec_utilization << "%" << std::endl;
+    }
+  }
+  if (FLAGS_perf_level >= 2 && profile.startup_time > 0) {
+    ss << "\n\033[1m\033[32m" << FillStr("  Startup  ", length, '-') << "\033[0m\n";
+    ss << "[Modules opened]: " << profile.startup_time << " ms" << std::endl;
+    for (const auto& module_profile : profile.module_profiles) {
+      ss << "[" << module_profile.module_name << "]: open: " << module_profile.open_time << " ms, begin at "
+         << module_profile.open_begin << " ms" << std::endl;
+    }
+  }
   ss << "\033[1m\033[36m" << FillStr("  Performance Print End  (" + prefix_str + ")  ", length, '*') << "\033[0m\n";
   std::cout << ss.str() << std::endl;
 }
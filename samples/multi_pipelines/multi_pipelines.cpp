@@ -35,6 +35,7 @@
 #include "opencv2/imgcodecs/imgcodecs.hpp"
 #endif
 
+#include "cnstream_resource_manager.hpp"
 #include "cnstream_version.hpp"
 #include "data_source.hpp"
 #include "util.hpp"
@@ -46,6 +47,8 @@ DEFINE_int32(wait_time, 0, "time of one test case");
 DEFINE_bool(loop, false, "display repeat");
 DEFINE_string(config_fname, "", "pipeline config filename");
 DEFINE_string(config_fname1, "", "another pipeline config filename");
+DEFINE_int32(dev_id, 0, "device the video decoders run on");
+DEFINE_int32(decoder_channels, 0, "video decoder channels shared by the two pipelines, 0 means unlimited");
 
 std::atomic<bool> gstop_perf_print{false};
 
@@ -147,6 +150,10 @@ int main(int argc, char **argv) {
 
   std::string source_name = "source";  // source module name, which is defined in pipeline json config
 
+  // the pipelines take turns on the decoder channels instead of failing to create decoders
+  cnstream::DeviceResourceManager::Instance().SetCapacity(FLAGS_dev_id, cnstream::kRESOURCE_VIDEO_DECODER,
+                                                          FLAGS_decoder_channels);
+
   /*
     build pipeline
   */
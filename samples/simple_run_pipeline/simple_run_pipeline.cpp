@@ -316,6 +316,7 @@ int Postprocessor::ExecuteDetect(const std::vector<float*>& net_outputs,
     std::lock_guard<std::mutex> objs_mutex(objs_holder->mutex_);
     objs.push_back(obj);
   }
+  objs_holder->Publish();
   return 0;
 }
 
@@ -342,8 +343,7 @@ int Postprocessor::ExecuteClassify(const std::vector<float*>& net_outputs,
 
   cnstream::CNInferObjsPtr objs_holder =
     frame_info->collection.Get<cnstream::CNInferObjsPtr>(cnstream::kCNInferObjsTag);
-  std::lock_guard<std::mutex> objs_mutex(objs_holder->mutex_);
-  objs_holder->objs_.push_back(obj);  // stores detection objects here for other modules.
+  objs_holder->Append({obj});  // stores detection objects here for other modules.
   return 0;
 }
 
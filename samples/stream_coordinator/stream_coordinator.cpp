@@ -0,0 +1,125 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gflags/gflags.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cluster_protocol.hpp"
+#include "cnstream_logging.hpp"
+#include "stream_balancer.hpp"
+#include "util.hpp"
+
+DEFINE_int32(port, 9900, "the port the nodes connect to");
+DEFINE_string(data_path, "", "video file list, the same as the one of cns_launcher, the i-th line is stream_<i>");
+DEFINE_double(stream_fps, 25, "the frame rate of a stream, used to estimate the capacity of overloaded nodes");
+DEFINE_double(high_watermark, 0.8, "a node is overloaded if the fill ratio of its fullest queues is over it");
+DEFINE_int32(node_timeout_ms, 5000, "a node leaves if it does not report for it");
+DEFINE_int32(cooldown_ms, 10000, "how long the capacity estimated for an overloaded node is kept");
+DEFINE_int32(max_moves, 1, "the max number of streams moved each second to even out the nodes");
+DEFINE_int32(balance_interval_ms, 1000, "the interval of balancing rounds");
+
+static int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Serves a node until it disconnects. Each report is replied with the streams assigned to the node.
+static void ServeNode(int fd, StreamBalancer *balancer) {
+  LineSocket socket(fd);
+  std::string node, line;
+  while (socket.IsConnected()) {
+    if (!socket.ReadLine(&line, 1000)) continue;
+    NodeReport report;
+    if (!DecodeReport(line, &report)) {
+      LOGW(CLUSTER) << "Invalid report: " << line;
+      continue;
+    }
+    if (node.empty()) LOGI(CLUSTER) << "Node [" << report.node << "] joined";
+    node = report.node;
+    balancer->Report(report, NowMs());
+    socket.WriteLine(EncodeAssignment(balancer->GetAssignment(node)));
+  }
+  if (!node.empty()) {
+    LOGI(CLUSTER) << "Node [" << node << "] disconnected";
+    balancer->RemoveNode(node);
+  }
+}
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, false);
+  cnstream::InitCNStreamLogging(nullptr);
+
+  std::list<std::string> urls = ::ReadFileList(FLAGS_data_path);
+  std::vector<ClusterStream> streams;
+  for (const auto &url : urls) streams.push_back({"stream_" + std::to_string(streams.size()), url});
+
+  StreamBalancer::Config config;
+  config.stream_fps = FLAGS_stream_fps;
+  config.high_watermark = FLAGS_high_watermark;
+  config.node_timeout_ms = FLAGS_node_timeout_ms;
+  config.cooldown_ms = FLAGS_cooldown_ms;
+  config.max_moves = FLAGS_max_moves;
+  StreamBalancer balancer(config);
+  balancer.SetStreams(streams);
+
+  int listen_fd = LineSocket::Listen(FLAGS_port);
+  if (listen_fd < 0) {
+    cnstream::ShutdownCNStreamLogging();
+    return EXIT_FAILURE;
+  }
+  LOGI(CLUSTER) << "Coordinator of " << streams.size() << " streams listens on port " << FLAGS_port;
+
+  std::thread balance_thread([&balancer] {
+    int rounds = 0;
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_balance_interval_ms));
+      int moved = balancer.Balance(NowMs());
+      if (moved || ++rounds * FLAGS_balance_interval_ms >= 10000) {
+        std::cout << balancer.Summary() << "  unassigned streams: " << balancer.GetUnassigned().size() << std::endl;
+        rounds = 0;
+      }
+    }
+  });
+
+  while (true) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      LOGE(CLUSTER) << "Accept failed, " << strerror(errno);
+      break;
+    }
+    std::thread(ServeNode, fd, &balancer).detach();
+  }
+
+  close(listen_fd);
+  balance_thread.detach();
+  cnstream::ShutdownCNStreamLogging();
+  return EXIT_FAILURE;
+}
@@ -31,7 +31,7 @@ if [ ${SRC_TYPE} = 2 ]; then
   tar xf "${CWD}/${PACKAGE_NAME}.tar.gz" -C ${CWD}
 fi
 cd ${CWD}/${PACKAGE_NAME}
-sed -i '/COMPILE_OPTS =/ s/$/ -DRTP_PAYLOAD_MAX_SIZE=8192 -DALLOW_SERVER_PORT_REUSE=1 -DALLOW_RTSP_SERVER_PORT_REUSE=1 -DNO_OPENSSL=1/' ./config.${LIVE555_CONFIG}
+sed -i '/COMPILE_OPTS =/ s/$/ -DRTP_PAYLOAD_MAX_SIZE=8192 -DALLOW_SERVER_PORT_REUSE=1 -DALLOW_RTSP_SERVER_PORT_REUSE=1 -DREUSE_FOR_TCP -DNO_OPENSSL=1/' ./config.${LIVE555_CONFIG}
 sed -i 's/ -lssl -lcrypto//g' ./config.${LIVE555_CONFIG}
 ./genMakefiles ${LIVE555_CONFIG}
 
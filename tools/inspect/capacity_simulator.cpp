@@ -0,0 +1,509 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "capacity_simulator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+#include "profiler/module_profiler.hpp"
+#include "profiler/pipeline_profiler.hpp"
+#include "profiler/trace_file.hpp"
+
+namespace cnstream {
+
+bool TraceTimings::LoadTraceFile(const std::string& fname) {
+  TraceFileReader reader;
+  if (!reader.Open(fname)) {
+    LOGE(INSPECT) << "Failed to open trace file: " << fname;
+    return false;
+  }
+  process_ms.clear();
+  // the processes started but not ended yet, keyed by the module and the frame
+  std::map<std::pair<std::string, RecordKey>, Time> starts;
+  // the first and the last frame of each stream, and the number of frames
+  std::map<std::string, std::pair<Time, Time>> spans;
+  std::map<std::string, uint64_t> frames;
+  TraceEvent event;
+  while (reader.Next(&event)) {
+    if (event.level == TraceEvent::Level::PIPELINE) {
+      if (event.process_name != kOVERALL_PROCESS_NAME || event.type != TraceEvent::Type::START) continue;
+      auto ret = spans.emplace(event.key.first, std::make_pair(event.time, event.time));
+      ret.first->second.first = std::min(ret.first->second.first, event.time);
+      ret.first->second.second = std::max(ret.first->second.second, event.time);
+      ++frames[event.key.first];
+      continue;
+    }
+    if (event.process_name != kPROCESS_PROFILER_NAME) continue;
+    auto key = std::make_pair(event.module_name, event.key);
+    if (event.type == TraceEvent::Type::START) {
+      starts[key] = event.time;
+      continue;
+    }
+    auto iter = starts.find(key);
+    if (iter == starts.end()) continue;
+    process_ms[event.module_name].push_back(Duration(event.time - iter->second).count());
+    starts.erase(iter);
+  }
+  if (reader.GetDroppedNumber()) {
+    LOGW(INSPECT) << reader.GetDroppedNumber() << " events were dropped by the trace writer.";
+  }
+  if (process_ms.empty()) {
+    LOGE(INSPECT) << "No process time of modules is found in " << fname;
+    return false;
+  }
+  streams = static_cast<int>(spans.size());
+  stream_fps = 0;
+  int measured = 0;
+  for (const auto& span : spans) {
+    const double span_s = std::chrono::duration<double>(span.second.second - span.second.first).count();
+    if (span_s <= 0 || frames[span.first] < 2) continue;
+    stream_fps += (frames[span.first] - 1) / span_s;
+    ++measured;
+  }
+  if (measured) stream_fps /= measured;
+  return true;
+}
+
+namespace {
+
+std::string GetParam(const CNModuleConfig& config, const std::string& key, const std::string& default_value) {
+  auto iter = config.parameters.find(key);
+  return iter == config.parameters.end() ? default_value : iter->second;
+}
+
+class Simulator {
+ public:
+  Simulator(const SimulationParam& param, PipelineSimulation* result)
+      : duration_ms_(param.duration_s * 1000), warmup_ms_(duration_ms_ / 10), result_(result) {}
+
+  bool Init(const CNGraphConfig& config, const TraceTimings& trace, const PerfData& perf);
+  void Run();
+  void Collect();
+
+ private:
+  enum EventType { FRAME_DUE = 0, PROCESS_DONE };
+  struct Event {
+    double time;
+    uint64_t seq;
+    EventType type;
+    int module;
+    int server;
+    bool operator>(const Event& other) const { return time != other.time ? time > other.time : seq > other.seq; }
+  };
+  struct Server {
+    std::vector<uint32_t> frames;  // the batch being processed or delivered to the downstream modules
+    size_t deliver_pos = 0;        // the next pair of frame and downstream module to deliver
+    bool busy = false;             // processing or delivering
+    double busy_since = 0;
+    double blocked_since = 0;
+    std::deque<uint32_t> due;      // the head modules: the frames of the stream due but not processed yet
+  };
+  struct Module {
+    ModuleSimulation* stats = nullptr;
+    std::vector<int> children;
+    int parent_num = 0;
+    size_t capacity = 0;
+    uint32_t batch = 1;
+    QueueFullPolicy policy = QueueFullPolicy::BLOCK;
+    const std::vector<double>* samples = nullptr;  // the process times of the trace
+    size_t next_sample = 0;
+    double frame_ms = -1;  // the time of a frame measured in PerfData::modules
+    double batch_ms = -1;  // the time of a batch measured in PerfData::models
+    std::deque<std::pair<uint32_t, double>> queue;  // the frames and the time they are queued
+    std::vector<Server> servers;
+    std::vector<int> idle;                    // the idle servers, the head modules do not use it
+    std::deque<std::pair<int, int>> blocked;  // the upstream servers waiting for room in the queue
+    double busy_ms = 0;
+    double blocked_ms = 0;
+    double queue_ms = 0;
+    uint64_t processed = 0;
+    uint64_t dequeued = 0;
+  };
+
+  // the part of [start, end) after the warm-up
+  double Measured(double start, double end) const { return std::max(0.0, end - std::max(start, warmup_ms_)); }
+  void Schedule(double time, EventType type, int module, int server) {
+    events_.push(Event{time, seq_++, type, module, server});
+  }
+  double ProcessTime(Module* module, size_t frames);
+  void OnFrameDue(int stream);
+  void StartHead(int m, int s);
+  void TryStart(int m);
+  void WakeBlocked(int m);
+  void OnProcessDone(int m, int s);
+  void Deliver(int m, int s);
+  void Complete(uint32_t frame);
+
+  double duration_ms_;
+  double warmup_ms_;
+  double now_ = 0;
+  double frame_interval_ms_ = 0;
+  int streams_ = 0;
+  PipelineSimulation* result_;
+  std::vector<Module> modules_;
+  std::vector<int> heads_;
+  int leaf_num_ = 0;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  uint64_t seq_ = 0;
+  // per frame
+  std::vector<double> frame_due_;
+  std::vector<uint16_t> frame_parents_;  // the upstream modules each module still waits for, frames x modules
+  std::vector<uint16_t> frame_leaves_;   // the last modules the frame has not left yet
+  std::vector<double> latencies_;
+  uint64_t completed_ = 0;
+};
+
+bool Simulator::Init(const CNGraphConfig& config, const TraceTimings& trace, const PerfData& perf) {
+  if (!config.subgraph_configs.empty()) {
+    LOGE(INSPECT) << "Subgraphs are not supported by the simulation, put their modules in the graph instead.";
+    return false;
+  }
+  streams_ = result_->streams;
+  frame_interval_ms_ = 1000 / result_->stream_fps;
+  std::map<std::string, int> indexes;
+  for (const auto& module_config : config.module_configs) {
+    const int index = static_cast<int>(indexes.size());
+    indexes[module_config.name] = index;
+  }
+  result_->modules.resize(config.module_configs.size());
+  modules_.resize(config.module_configs.size());
+  for (size_t i = 0; i < config.module_configs.size(); ++i) {
+    const CNModuleConfig& module_config = config.module_configs[i];
+    for (const auto& next : module_config.next) {
+      auto iter = indexes.find(next);
+      if (iter == indexes.end()) {
+        LOGE(INSPECT) << "Unknown next module " << next << " of " << module_config.name;
+        return false;
+      }
+      modules_[i].children.push_back(iter->second);
+      modules_[iter->second].parent_num++;
+    }
+  }
+
+  for (size_t i = 0; i < config.module_configs.size(); ++i) {
+    const CNModuleConfig& module_config = config.module_configs[i];
+    Module& module = modules_[i];
+    ModuleSimulation& stats = result_->modules[i];
+    module.stats = &stats;
+    stats.name = module_config.name;
+    stats.class_name = module_config.className;
+    int servers = std::max(module_config.parallelism, 1);
+    module.batch = std::max<uint32_t>(module_config.maxBatchSize, 1);
+    module.policy = module_config.queueFullPolicy;
+    module.capacity = static_cast<size_t>(servers) * std::max(module_config.maxInputQueueSize, 1);
+
+    // the timings measured for the module itself take precedence, then the model, then the trace
+    for (const std::string& key : {module_config.name, module_config.className}) {
+      auto iter = perf.modules.find(key);
+      if (iter != perf.modules.end()) {
+        module.frame_ms = iter->second;
+        stats.basis = "modules." + key;
+        break;
+      }
+    }
+    const bool inferencer = module_config.className == "cnstream::Inferencer2" ||
+                            module_config.className == "cnstream::Inferencer";
+    if (module.frame_ms < 0 && inferencer) {
+      std::string model_name = GetParam(module_config, "model_path", "");
+      model_name = model_name.substr(model_name.find_last_of('/') + 1);
+      auto iter = perf.models.find(model_name);
+      if (iter != perf.models.end()) {
+        // Inferencer2 shares engine_num engines among its threads, Inferencer has an engine per thread
+        if (module_config.className == "cnstream::Inferencer2") {
+          servers = std::max<int>(std::strtol(GetParam(module_config, "engine_num", "1").c_str(), nullptr, 10), 1);
+        }
+        module.batch = iter->second.batch_size;
+        module.batch_ms = iter->second.hw_time_ms;
+        stats.basis = "models." + model_name;
+      }
+    }
+    if (stats.basis.empty()) {
+      auto iter = trace.process_ms.find(module_config.name);
+      if (iter != trace.process_ms.end() && !iter->second.empty()) {
+        module.samples = &iter->second;
+        stats.basis = "trace, " + std::to_string(iter->second.size()) + " frames";
+      }
+    }
+
+    if (!module.parent_num) {
+      // the head modules process the frames of each stream one by one
+      heads_.push_back(static_cast<int>(i));
+      servers = streams_;
+      module.capacity = 0;
+      module.batch = 1;
+    }
+    if (module.children.empty()) ++leaf_num_;
+    stats.servers = servers;
+    stats.queue_size = static_cast<int>(module.capacity);
+    stats.batch_size = module.batch;
+    module.servers.resize(servers);
+    for (int s = servers - 1; s >= 0; --s) module.idle.push_back(s);
+  }
+  if (heads_.empty()) {
+    LOGE(INSPECT) << "The graph has no head module.";
+    return false;
+  }
+  return true;
+}
+
+double Simulator::ProcessTime(Module* module, size_t frames) {
+  if (module->batch_ms >= 0) return module->batch_ms;
+  if (module->frame_ms >= 0) return module->frame_ms * frames;
+  double ms = 0;
+  if (module->samples) {
+    for (size_t i = 0; i < frames; ++i) {
+      ms += (*module->samples)[module->next_sample];
+      module->next_sample = (module->next_sample + 1) % module->samples->size();
+    }
+  }
+  return ms;
+}
+
+void Simulator::OnFrameDue(int stream) {
+  const uint32_t frame = static_cast<uint32_t>(frame_due_.size());
+  frame_due_.push_back(now_);
+  for (const Module& module : modules_) frame_parents_.push_back(static_cast<uint16_t>(module.parent_num));
+  frame_leaves_.push_back(static_cast<uint16_t>(leaf_num_));
+  for (int h : heads_) {
+    Server& server = modules_[h].servers[stream];
+    server.due.push_back(frame);
+    if (!server.busy) StartHead(h, stream);
+  }
+  Schedule(now_ + frame_interval_ms_, FRAME_DUE, -1, stream);
+}
+
+void Simulator::StartHead(int m, int s) {
+  Module& module = modules_[m];
+  Server& server = module.servers[s];
+  const uint32_t frame = server.due.front();
+  server.due.pop_front();
+  // the time a frame waits for the stream, e.g. the decoder is slower than the frame rate
+  if (now_ >= warmup_ms_) {
+    module.queue_ms += now_ - frame_due_[frame];
+    module.dequeued++;
+  }
+  server.frames.assign(1, frame);
+  server.busy = true;
+  server.busy_since = now_;
+  Schedule(now_ + ProcessTime(&module, 1), PROCESS_DONE, m, s);
+}
+
+void Simulator::TryStart(int m) {
+  Module& module = modules_[m];
+  bool popped = false;
+  while (!module.idle.empty() && !module.queue.empty()) {
+    const int s = module.idle.back();
+    module.idle.pop_back();
+    Server& server = module.servers[s];
+    server.frames.clear();
+    while (server.frames.size() < module.batch && !module.queue.empty()) {
+      if (now_ >= warmup_ms_) {
+        module.queue_ms += now_ - module.queue.front().second;
+        module.dequeued++;
+      }
+      server.frames.push_back(module.queue.front().first);
+      module.queue.pop_front();
+    }
+    popped = true;
+    server.busy = true;
+    server.busy_since = now_;
+    Schedule(now_ + ProcessTime(&module, server.frames.size()), PROCESS_DONE, m, s);
+  }
+  if (popped) WakeBlocked(m);
+}
+
+void Simulator::WakeBlocked(int m) {
+  Module& module = modules_[m];
+  while (!module.blocked.empty() && module.queue.size() < module.capacity) {
+    const std::pair<int, int> upstream = module.blocked.front();
+    module.blocked.pop_front();
+    Module& upstream_module = modules_[upstream.first];
+    upstream_module.blocked_ms += Measured(upstream_module.servers[upstream.second].blocked_since, now_);
+    Deliver(upstream.first, upstream.second);
+  }
+}
+
+void Simulator::OnProcessDone(int m, int s) {
+  Module& module = modules_[m];
+  Server& server = module.servers[s];
+  module.busy_ms += Measured(server.busy_since, now_);
+  if (now_ >= warmup_ms_) module.processed += server.frames.size();
+  server.deliver_pos = 0;
+  Deliver(m, s);
+}
+
+void Simulator::Deliver(int m, int s) {
+  Module& module = modules_[m];
+  Server& server = module.servers[s];
+  const size_t child_num = module.children.size();
+  const size_t total = server.frames.size() * child_num;
+  while (server.deliver_pos < total) {
+    const uint32_t frame = server.frames[server.deliver_pos / child_num];
+    const int c = module.children[server.deliver_pos % child_num];
+    uint16_t& waiting = frame_parents_[static_cast<size_t>(frame) * modules_.size() + c];
+    if (waiting > 1) {
+      // the frame enters the module after the last upstream module
+      --waiting;
+      ++server.deliver_pos;
+      continue;
+    }
+    Module& child = modules_[c];
+    if (child.queue.size() >= child.capacity) {
+      if (child.policy == QueueFullPolicy::BLOCK) {
+        server.blocked_since = now_;
+        child.blocked.emplace_back(m, s);
+        return;
+      }
+      child.stats->dropped++;
+      if (child.policy == QueueFullPolicy::DROP_NEWEST) {
+        waiting = 0;
+        ++server.deliver_pos;
+        continue;
+      }
+      child.queue.pop_front();
+    }
+    waiting = 0;
+    child.queue.emplace_back(frame, now_);
+    child.stats->max_queue_length = std::max(child.stats->max_queue_length, child.queue.size());
+    ++server.deliver_pos;
+    TryStart(c);
+  }
+  if (!child_num) {
+    for (uint32_t frame : server.frames) Complete(frame);
+  }
+  server.frames.clear();
+  server.busy = false;
+  if (!module.parent_num) {
+    if (!server.due.empty()) StartHead(m, s);
+    return;
+  }
+  module.idle.push_back(s);
+  TryStart(m);
+}
+
+void Simulator::Complete(uint32_t frame) {
+  if (--frame_leaves_[frame] || now_ < warmup_ms_) return;
+  ++completed_;
+  latencies_.push_back(now_ - frame_due_[frame]);
+}
+
+void Simulator::Run() {
+  for (int stream = 0; stream < streams_; ++stream) {
+    // the streams are spread over a frame interval
+    Schedule(frame_interval_ms_ * stream / streams_, FRAME_DUE, -1, stream);
+  }
+  while (!events_.empty() && events_.top().time <= duration_ms_) {
+    const Event event = events_.top();
+    events_.pop();
+    now_ = event.time;
+    if (event.type == FRAME_DUE) {
+      OnFrameDue(event.server);
+    } else {
+      OnProcessDone(event.module, event.server);
+    }
+  }
+}
+
+void Simulator::Collect() {
+  const double window_ms = duration_ms_ - warmup_ms_;
+  double max_utilization = -1;
+  for (Module& module : modules_) {
+    ModuleSimulation& stats = *module.stats;
+    stats.throughput_fps = module.processed * 1000 / window_ms;
+    stats.utilization = module.busy_ms / (window_ms * stats.servers);
+    stats.blocked_ratio = module.blocked_ms / (window_ms * stats.servers);
+    stats.avg_queue_ms = module.dequeued ? module.queue_ms / module.dequeued : 0;
+    result_->dropped += stats.dropped;
+    if (stats.utilization > max_utilization) {
+      max_utilization = stats.utilization;
+      result_->bottleneck = stats.name;
+    }
+  }
+  result_->throughput_fps = completed_ * 1000 / window_ms;
+  if (!latencies_.empty()) {
+    double sum = 0;
+    for (double latency : latencies_) sum += latency;
+    result_->avg_latency_ms = sum / latencies_.size();
+    auto p99 = latencies_.begin() + latencies_.size() * 99 / 100;
+    std::nth_element(latencies_.begin(), p99, latencies_.end());
+    result_->p99_latency_ms = *p99;
+  }
+}
+
+}  // namespace
+
+bool SimulateCapacity(const CNGraphConfig& config, const TraceTimings& trace, const PerfData& perf,
+                      const SimulationParam& param, PipelineSimulation* result) {
+  *result = PipelineSimulation();
+  result->streams = param.streams > 0 ? param.streams : trace.streams;
+  result->stream_fps = param.stream_fps > 0 ? param.stream_fps : trace.stream_fps;
+  if (result->streams <= 0 || result->stream_fps <= 0 || param.duration_s <= 0) {
+    LOGE(INSPECT) << "The number of streams, the frame rate and the duration must be positive, they are "
+                  << result->streams << ", " << result->stream_fps << " and " << param.duration_s;
+    return false;
+  }
+  result->offered_fps = result->streams * result->stream_fps;
+  Simulator simulator(param, result);
+  if (!simulator.Init(config, trace, perf)) return false;
+  simulator.Run();
+  simulator.Collect();
+  return true;
+}
+
+void PrintCapacitySimulation(const PipelineSimulation& result) {
+  std::cout << "\033[01;32m" << std::left << std::setw(32) << "Module" << std::right << std::setw(9) << "servers"
+            << std::setw(8) << "queue" << std::setw(7) << "batch" << std::setw(12) << "fps" << std::setw(8) << "busy"
+            << std::setw(10) << "blocked" << std::setw(12) << "wait(ms)" << std::setw(10) << "max_len"
+            << std::setw(10) << "dropped" << "  " << "Basis" << "\033[0m" << std::endl;
+  for (const auto& module : result.modules) {
+    std::cout << std::left << std::setw(32) << module.name << std::right << std::setw(9) << module.servers
+              << std::setw(8) << module.queue_size << std::setw(7) << module.batch_size << std::fixed
+              << std::setprecision(1) << std::setw(12) << module.throughput_fps << std::setw(7)
+              << module.utilization * 100 << "%" << std::setw(9) << module.blocked_ratio * 100 << "%"
+              << std::setw(12) << module.avg_queue_ms << std::setw(10) << module.max_queue_length << std::setw(10)
+              << module.dropped << "  " << (module.basis.empty() ? "not measured, takes no time" : module.basis)
+              << std::endl;
+  }
+  std::cout << std::endl;
+  std::cout << "Streams: " << result.streams << " x " << result.stream_fps << " fps, offered " << result.offered_fps
+            << " fps" << std::endl;
+  std::cout << "Throughput: " << result.throughput_fps << " fps" << std::endl;
+  std::cout << "Latency: avg " << result.avg_latency_ms << " ms, p99 " << result.p99_latency_ms << " ms"
+            << std::endl;
+  std::cout << "Bottleneck module: " << result.bottleneck << std::endl;
+  if (result.dropped) std::cout << "Frames dropped by full queues: " << result.dropped << std::endl;
+  if (result.throughput_fps < result.offered_fps * 0.99) {
+    std::cout << "\033[01;31m" << "The pipeline does not keep up with the streams." << "\033[0m" << std::endl;
+  }
+}
+
+}  // namespace cnstream
@@ -0,0 +1,120 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_INSPECT_CAPACITY_SIMULATOR_HPP_
+#define CNSTREAM_INSPECT_CAPACITY_SIMULATOR_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cnstream_config.hpp"
+#include "throughput_estimator.hpp"
+
+namespace cnstream {
+
+/**
+ * The timings of a pipeline run, loaded from a trace file streamed by PipelineTracer (see ProfilerConfig::trace_file).
+ */
+struct TraceTimings {
+  std::map<std::string, std::vector<double>> process_ms;  // the process times of the frames of each module, in order
+  int streams = 0;                                        // the streams seen in the trace
+  double stream_fps = 0;                                  // the average frame rate of the streams
+
+  bool LoadTraceFile(const std::string& fname);
+};
+
+/**
+ * The workload simulated.
+ */
+struct SimulationParam {
+  int streams = 0;          // the number of streams, 0 means the streams of the trace
+  double stream_fps = 0;    // the frame rate of each stream, 0 means the frame rate of the trace
+  double duration_s = 60;   // the simulated time, the first tenth of it is the warm-up and is not measured
+};
+
+/**
+ * The simulation of a module.
+ */
+struct ModuleSimulation {
+  std::string name;
+  std::string class_name;
+  std::string basis;             // where the process times come from, empty if the module is not measured
+  int servers = 0;               // the threads (or engines) processing frames at the same time
+  int queue_size = 0;            // the capacity of the input queues, 0 for the head modules
+  uint32_t batch_size = 1;
+  double throughput_fps = 0;     // the frames processed per second
+  double utilization = 0;        // the ratio of the time the servers are processing
+  double blocked_ratio = 0;      // the ratio of the time the servers wait for room in the downstream queues
+  double avg_queue_ms = 0;       // the average time a frame waits in the input queue
+  size_t max_queue_length = 0;
+  uint64_t dropped = 0;          // the frames dropped by the queue full policy
+};
+
+/**
+ * The simulation of a pipeline.
+ */
+struct PipelineSimulation {
+  std::vector<ModuleSimulation> modules;
+  int streams = 0;
+  double stream_fps = 0;
+  double offered_fps = 0;        // streams x stream_fps
+  double throughput_fps = 0;     // the frames that went through all the modules per second
+  double avg_latency_ms = 0;     // from the time a frame is due at the source to the time it leaves the last module
+  double p99_latency_ms = 0;
+  std::string bottleneck;        // the busiest module
+  uint64_t dropped = 0;
+};
+
+/**
+ * Simulates a graph processing a number of streams with the process times of a trace, a discrete event simulation
+ * of the modules and their input queues, so that the throughput, latency and bottleneck of another parallelism,
+ * queue size, batch size, module or number of streams are predicted without running the pipeline.
+ *
+ * The frames of each stream are due at its frame rate and are processed by the head modules one by one per stream.
+ * A frame enters a module when all its upstream modules have processed it, the module processes the frames with
+ * ``parallelism`` threads from one queue of ``parallelism x max_input_queue_size`` frames, up to ``max_batch_size``
+ * frames at a time. A full queue blocks the upstream thread or drops frames as ``queue_full_policy`` says.
+ *
+ * The process times of a module are replayed from the trace in order. A batch takes the sum of the times of its
+ * frames. The timings of ``perf`` take precedence, so that an added module or another model can be simulated: a
+ * module measured in ``modules`` takes that time for each frame, and an inferencer whose model is measured in
+ * ``models`` processes batches of the model on ``engine_num`` engines (Inferencer2) or one engine per thread
+ * (Inferencer). Modules measured nowhere take no time. The contention of the modules on the devices is not simulated.
+ *
+ * @param[in] config The graph, subgraphs are not supported.
+ * @param[in] trace The timings of the trace.
+ * @param[in] perf The measured timings, they may be empty.
+ * @param[in] param The workload.
+ * @param[out] result The simulation.
+ *
+ * @return Returns false if the graph is not supported or there is no stream to simulate.
+ */
+bool SimulateCapacity(const CNGraphConfig& config, const TraceTimings& trace, const PerfData& perf,
+                      const SimulationParam& param, PipelineSimulation* result);
+
+/**
+ * Prints the simulation.
+ */
+void PrintCapacitySimulation(const PipelineSimulation& result);
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_INSPECT_CAPACITY_SIMULATOR_HPP_
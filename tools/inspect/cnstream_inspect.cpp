@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <algorithm>
 #include <fstream>
@@ -39,6 +40,8 @@
 #include "cnstream_module.hpp"
 #include "cnstream_pipeline.hpp"
 #include "cnstream_version.hpp"
+#include "capacity_simulator.hpp"
+#include "throughput_estimator.hpp"
 
 static void Usage() {
   std::cout << "Usage:" << std::endl;
@@ -50,6 +53,18 @@ static void Usage() {
             << "Print all modules" << std::endl;
   std::cout << std::left << std::setw(40) << "\t -m, --module-name"
             << "List the module parameters" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -e, --estimate <config.json>"
+            << "Estimate the max streams of a pipeline config and its bottleneck module" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -p, --perf-data <perf.json>"
+            << "The measured timings of the decoders, models and modules used by --estimate" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -f, --fps <fps>"
+            << "The frame rate of each stream, 25 by default, or the frame rate of --trace" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -t, --trace <trace file>"
+            << "Simulate the config of --estimate with the process times of a trace file of the profiler" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -n, --streams <num>"
+            << "The number of streams used by --trace, the streams of the trace by default" << std::endl;
+  std::cout << std::left << std::setw(40) << "\t -d, --duration <seconds>"
+            << "The simulated time used by --trace, 60 by default" << std::endl;
   std::cout << std::left << std::setw(40) << "\t -v, --version"
             << "Print version information\n"
             << std::endl;
@@ -58,6 +73,12 @@ static void Usage() {
 static const struct option long_option[] = {{"help", no_argument, nullptr, 'h'},
                                             {"all", no_argument, nullptr, 'a'},
                                             {"module-name", required_argument, nullptr, 'm'},
+                                            {"estimate", required_argument, nullptr, 'e'},
+                                            {"perf-data", required_argument, nullptr, 'p'},
+                                            {"fps", required_argument, nullptr, 'f'},
+                                            {"trace", required_argument, nullptr, 't'},
+                                            {"streams", required_argument, nullptr, 'n'},
+                                            {"duration", required_argument, nullptr, 'd'},
                                             {"version", no_argument, nullptr, 'v'},
                                             {nullptr, 0, nullptr, 0}};
 
@@ -201,11 +222,53 @@ static void PrintModuleParameters(const std::string& module_name) {
   delete module;
 }
 
+static int RunSimulation(const std::string& config_file, const std::string& perf_file, const std::string& trace_file,
+                         const cnstream::SimulationParam& param) {
+  cnstream::CNGraphConfig config;
+  if (!config.ParseByJSONFile(config_file)) {
+    std::cout << "Failed to parse config file: " << config_file << std::endl;
+    return 1;
+  }
+  cnstream::PerfData perf;
+  if (!perf_file.empty() && !perf.ParseByJSONFile(perf_file)) return 1;
+  cnstream::TraceTimings trace;
+  if (!trace.LoadTraceFile(trace_file)) return 1;
+  cnstream::PipelineSimulation result;
+  if (!cnstream::SimulateCapacity(config, trace, perf, param, &result)) return 1;
+  std::cout << "\033[01;33m" << config_file << " Capacity Simulation (" << param.duration_s << " s):" << "\033[0m"
+            << std::endl;
+  cnstream::PrintCapacitySimulation(result);
+  return 0;
+}
+
+static int RunEstimate(const std::string& config_file, const std::string& perf_file, double fps) {
+  cnstream::CNGraphConfig config;
+  if (!config.ParseByJSONFile(config_file)) {
+    std::cout << "Failed to parse config file: " << config_file << std::endl;
+    return 1;
+  }
+  cnstream::PerfData perf;
+  if (perf_file.empty()) {
+    std::cout << "--estimate needs the measured timings given by --perf-data." << std::endl;
+    return 1;
+  }
+  if (!perf.ParseByJSONFile(perf_file)) return 1;
+  cnstream::PipelineEstimate estimate;
+  if (!cnstream::EstimateThroughput(config, perf, &estimate)) return 1;
+  std::cout << "\033[01;33m" << config_file << " Throughput Estimate:" << "\033[0m" << std::endl;
+  cnstream::PrintThroughputEstimate(estimate, fps);
+  return 0;
+}
+
 int main(int argc, char* argv[]) {
   int opt = 0;
   bool getopt = false;
   std::string config_file;
   std::string module_name;
+  std::string perf_file;
+  std::string trace_file;
+  double fps = 0;
+  cnstream::SimulationParam sim_param;
   std::stringstream ss;
 
   if (argc == 1) {
@@ -213,7 +276,7 @@ int main(int argc, char* argv[]) {
     return 0;
   }
 
-  while ((opt = getopt_long(argc, argv, "ham:c:v", long_option, nullptr)) != -1) {
+  while ((opt = getopt_long(argc, argv, "ham:e:p:f:t:n:d:v", long_option, nullptr)) != -1) {
     getopt = true;
     switch (opt) {
       case 'h':
@@ -232,6 +295,30 @@ int main(int argc, char* argv[]) {
         PrintModuleParameters(module_name);
         break;
 
+      case 'e':
+        config_file = optarg;
+        break;
+
+      case 'p':
+        perf_file = optarg;
+        break;
+
+      case 'f':
+        fps = atof(optarg);
+        break;
+
+      case 't':
+        trace_file = optarg;
+        break;
+
+      case 'n':
+        sim_param.streams = atoi(optarg);
+        break;
+
+      case 'd':
+        sim_param.duration_s = atof(optarg);
+        break;
+
       case 'v':
         PrintVersion();
         break;
@@ -241,6 +328,12 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (!config_file.empty() && !trace_file.empty()) {
+    sim_param.stream_fps = fps;
+    return RunSimulation(config_file, perf_file, trace_file, sim_param);
+  }
+  if (!config_file.empty()) return RunEstimate(config_file, perf_file, fps > 0 ? fps : 25);
+
   if (!getopt) {
     for (int i = 1; i < argc; i++) {
       ss.clear();
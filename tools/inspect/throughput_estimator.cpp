@@ -0,0 +1,201 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "throughput_estimator.hpp"
+
+#include <rapidjson/document.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+bool PerfData::ParseByJSONFile(const std::string& fname) {
+  std::ifstream ifs(fname);
+  if (!ifs.is_open()) {
+    LOGE(INSPECT) << "Failed to open file: " << fname;
+    return false;
+  }
+  std::string jstr((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(jstr.c_str()).HasParseError() || !doc.IsObject()) {
+    LOGE(INSPECT) << "Failed to parse " << fname << ", it should be a JSON object.";
+    return false;
+  }
+  const char* sections[] = {"decoders", "models", "modules"};
+  for (const char* section : sections) {
+    if (!doc.HasMember(section)) continue;
+    if (!doc[section].IsObject()) {
+      LOGE(INSPECT) << section << " must be an object.";
+      return false;
+    }
+    for (auto iter = doc[section].MemberBegin(); iter != doc[section].MemberEnd(); ++iter) {
+      const std::string key = iter->name.GetString();
+      const rapidjson::Value& value = iter->value;
+      if (std::string(section) != "models") {
+        if (!value.IsNumber() || value.GetDouble() <= 0) {
+          LOGE(INSPECT) << section << "." << key << " must be a positive number.";
+          return false;
+        }
+        (std::string(section) == "decoders" ? decoders : modules)[key] = value.GetDouble();
+        continue;
+      }
+      Model model;
+      if (!value.IsObject() || !value.HasMember("hw_time_ms") || !value["hw_time_ms"].IsNumber() ||
+          value["hw_time_ms"].GetDouble() <= 0) {
+        LOGE(INSPECT) << "models." << key << " must have a positive hw_time_ms.";
+        return false;
+      }
+      model.hw_time_ms = value["hw_time_ms"].GetDouble();
+      if (value.HasMember("batch_size")) {
+        if (!value["batch_size"].IsUint() || value["batch_size"].GetUint() == 0) {
+          LOGE(INSPECT) << "models." << key << ".batch_size must be a positive integer.";
+          return false;
+        }
+        model.batch_size = value["batch_size"].GetUint();
+      }
+      models[key] = model;
+    }
+  }
+  return true;
+}
+
+namespace {
+
+std::string GetParam(const CNModuleConfig& config, const std::string& key, const std::string& default_value) {
+  auto iter = config.parameters.find(key);
+  return iter == config.parameters.end() ? default_value : iter->second;
+}
+
+// Returns the frames per second a module keeps up with, or a negative value if it is not measured.
+double ModuleCapacity(const CNModuleConfig& config, const std::string& name, const PerfData& perf,
+                      std::string* basis) {
+  const uint32_t threads = std::max<uint32_t>(config.parallelism, 1);
+  // the timings measured for the module itself take precedence
+  for (const std::string& key : {name, config.className}) {
+    auto iter = perf.modules.find(key);
+    if (iter != perf.modules.end()) {
+      *basis = "modules." + key + " x " + std::to_string(threads) + " threads";
+      return threads * 1000 / iter->second;
+    }
+  }
+  if (config.className == "cnstream::DataSource") {
+    const std::string decoder_type = GetParam(config, "decoder_type", "cpu");
+    auto iter = perf.decoders.find(decoder_type);
+    if (iter == perf.decoders.end()) return -1;
+    *basis = "decoders." + decoder_type;
+    return iter->second;
+  }
+  if (config.className == "cnstream::Inferencer2" || config.className == "cnstream::Inferencer") {
+    std::string model_name = GetParam(config, "model_path", "");
+    model_name = model_name.substr(model_name.find_last_of('/') + 1);
+    auto iter = perf.models.find(model_name);
+    if (iter == perf.models.end()) return -1;
+    // Inferencer2 shares engine_num engines among its threads, Inferencer has an engine per thread
+    uint32_t engines = threads;
+    if (config.className == "cnstream::Inferencer2") {
+      engines = std::max<uint32_t>(std::strtoul(GetParam(config, "engine_num", "1").c_str(), nullptr, 10), 1);
+    }
+    *basis = "models." + model_name + " x " + std::to_string(engines) + " engines";
+    return engines * iter->second.batch_size * 1000 / iter->second.hw_time_ms;
+  }
+  return -1;
+}
+
+bool CollectModules(const CNGraphConfig& config, const std::string& prefix, const PerfData& perf,
+                    std::vector<ModuleEstimate>* modules) {
+  for (const auto& module_config : config.module_configs) {
+    ModuleEstimate module;
+    module.name = prefix + module_config.name;
+    module.class_name = module_config.className;
+    module.parallelism = module_config.parallelism;
+    module.queue_size = module_config.maxInputQueueSize;
+    module.capacity_fps = ModuleCapacity(module_config, module.name, perf, &module.basis);
+    // the head modules have no input queues
+    if (module.capacity_fps > 0 && module.parallelism > 0) {
+      module.queue_delay_ms = module.queue_size * 1000 / module.capacity_fps;
+    }
+    modules->push_back(module);
+  }
+  for (const auto& subgraph_config : config.subgraph_configs) {
+    CNGraphConfig subgraph;
+    if (!subgraph.ParseByJSONFile(subgraph_config.config_path)) {
+      LOGE(INSPECT) << "Failed to parse subgraph " << subgraph_config.name << ": " << subgraph_config.config_path;
+      return false;
+    }
+    if (!CollectModules(subgraph, prefix + subgraph_config.name + "/", perf, modules)) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool EstimateThroughput(const CNGraphConfig& config, const PerfData& perf, PipelineEstimate* estimate) {
+  *estimate = PipelineEstimate();
+  if (!CollectModules(config, "", perf, &estimate->modules)) return false;
+  for (const auto& module : estimate->modules) {
+    if (module.capacity_fps < 0) continue;
+    if (estimate->capacity_fps < 0 || module.capacity_fps < estimate->capacity_fps) {
+      estimate->capacity_fps = module.capacity_fps;
+      estimate->bottleneck = module.name;
+    }
+    estimate->max_latency_ms += module.queue_delay_ms;
+  }
+  return true;
+}
+
+void PrintThroughputEstimate(const PipelineEstimate& estimate, double stream_fps) {
+  std::cout << "\033[01;32m" << std::left << std::setw(32) << "Module" << std::setw(28) << "Class" << std::right
+            << std::setw(12) << "parallelism" << std::setw(12) << "queue_size" << std::setw(16) << "capacity(fps)"
+            << std::setw(14) << "queue(ms)" << "  " << "Basis" << "\033[0m" << std::endl;
+  for (const auto& module : estimate.modules) {
+    std::cout << std::left << std::setw(32) << module.name << std::setw(28) << module.class_name << std::right
+              << std::setw(12) << module.parallelism << std::setw(12) << module.queue_size << std::fixed
+              << std::setprecision(1);
+    if (module.capacity_fps < 0) {
+      std::cout << std::setw(16) << "-" << std::setw(14) << "-" << "  not measured, ignored" << std::endl;
+      continue;
+    }
+    std::cout << std::setw(16) << module.capacity_fps << std::setw(14) << module.queue_delay_ms << "  "
+              << module.basis << std::endl;
+  }
+  std::cout << std::endl;
+  if (estimate.capacity_fps < 0) {
+    std::cout << "No module is measured, the throughput is unknown." << std::endl;
+    return;
+  }
+  std::cout << "Pipeline capacity: " << estimate.capacity_fps << " fps" << std::endl;
+  std::cout << "Bottleneck module: " << estimate.bottleneck << std::endl;
+  if (stream_fps > 0) {
+    std::cout << "Max streams at " << stream_fps << " fps: "
+              << static_cast<int>(std::floor(estimate.capacity_fps / stream_fps)) << std::endl;
+  }
+  std::cout << "Max latency with all input queues full: " << estimate.max_latency_ms << " ms" << std::endl;
+}
+
+}  // namespace cnstream
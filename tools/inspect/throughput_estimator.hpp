@@ -0,0 +1,105 @@
+/*************************************************************************
+ * Copyright (C) [2021] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_INSPECT_THROUGHPUT_ESTIMATOR_HPP_
+#define CNSTREAM_INSPECT_THROUGHPUT_ESTIMATOR_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cnstream_config.hpp"
+
+namespace cnstream {
+
+/**
+ * The measured timings the estimation is based on, parsed from a JSON file:
+ *
+ * @code {.json}
+ * {
+ *   "decoders" : { "mlu" : 960, "cpu" : 240 },
+ *   "models" : {
+ *     "yolov3_b4.model" : { "batch_size" : 4, "hw_time_ms" : 31.5 }
+ *   },
+ *   "modules" : { "tracker" : 1.2, "cnstream::Osd" : 4.0 }
+ * }
+ * @endcode
+ *
+ * ``decoders`` are the frames decoded per second of one card (mlu) or of the host (cpu).
+ * ``models`` are keyed by the file name of model_path, hw_time_ms is the avg hardware time printed by
+ * get_model_perfinfo for a batch.
+ * ``modules`` are the milliseconds one thread of a module takes for a frame, e.g. measured by cns_bench or the
+ * profiler, keyed by the module name or the class name.
+ */
+struct PerfData {
+  struct Model {
+    int batch_size = 1;
+    double hw_time_ms = 0;
+  };
+  std::map<std::string, double> decoders;
+  std::map<std::string, Model> models;
+  std::map<std::string, double> modules;
+
+  bool ParseByJSONFile(const std::string& fname);
+};
+
+/**
+ * The estimation of a module.
+ */
+struct ModuleEstimate {
+  std::string name;           // with the subgraph prefixes
+  std::string class_name;
+  int parallelism = 0;
+  int queue_size = 0;
+  std::string basis;          // where the capacity comes from, empty if the module is not measured
+  double capacity_fps = -1;   // the frames per second the module keeps up with, negative if it is not measured
+  double queue_delay_ms = 0;  // the time a frame waits in a full input queue
+};
+
+/**
+ * The estimation of a pipeline. Every frame goes through every module, so the pipeline keeps up with the capacity of
+ * its slowest module.
+ */
+struct PipelineEstimate {
+  std::vector<ModuleEstimate> modules;
+  std::string bottleneck;
+  double capacity_fps = -1;
+  double max_latency_ms = 0;  // the sum of queue_delay_ms, the latency when all queues are full
+};
+
+/**
+ * Estimates the capacity of each module of a graph and of the whole pipeline from the measured timings.
+ *
+ * @param[in] config The graph, the subgraphs are parsed from their config files.
+ * @param[in] perf The measured timings.
+ * @param[out] estimate The estimation.
+ *
+ * @return Returns false if a subgraph fails to be parsed.
+ */
+bool EstimateThroughput(const CNGraphConfig& config, const PerfData& perf, PipelineEstimate* estimate);
+
+/**
+ * Prints the estimation and the max number of streams running at a frame rate.
+ */
+void PrintThroughputEstimate(const PipelineEstimate& estimate, double stream_fps);
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_INSPECT_THROUGHPUT_ESTIMATOR_HPP_
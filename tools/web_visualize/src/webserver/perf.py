@@ -31,14 +31,16 @@ class PrintPerformance:
     def print_process_perf(self, profile):
         if self.perf_level <= 1:
             if self.perf_level == 1:
-                logger.info("[Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms".format(
-                        profile.latency, profile.minimum_latency, profile.maximum_latency))
+                logger.info("[Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms, (P50): {:.4f}ms, (P99): {:.4f}ms, (P999): {:.4f}ms".format(
+                        profile.latency, profile.minimum_latency, profile.maximum_latency,
+                    profile.latency_p50, profile.latency_p99, profile.latency_p999))
             logger.info("[Counter]: {}, [Throughput]: {:.4f}fps".format(profile.counter, profile.fps))
         elif self.perf_level >= 2:
             logger.info("[Counter]: {}, [Completed]: {}, [Dropped]: {}, [Ongoing]: {}".format(
                     profile.counter, profile.completed, profile.dropped, profile.ongoing))
-            logger.info("[Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms".format(
-                    profile.latency, profile.minimum_latency, profile.maximum_latency))
+            logger.info("[Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms, (P50): {:.4f}ms, (P99): {:.4f}ms, (P999): {:.4f}ms".format(
+                    profile.latency, profile.minimum_latency, profile.maximum_latency,
+                    profile.latency_p50, profile.latency_p99, profile.latency_p999))
             logger.info("[Throughput]: {:.4f}fps".format(profile.fps))
 
         if self.perf_level >= 3:
@@ -46,8 +48,9 @@ class PrintPerformance:
             for stream_profile in profile.stream_profiles:
                 logger.info("{: <15s} [Counter]: {}, [Completed]: {}, [Dropped]: {}".format("[" + stream_profile.stream_name + "]",
                        stream_profile.counter, stream_profile.completed, stream_profile.dropped))
-                logger.info("{: <15s} [Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms".format("",
-                       stream_profile.latency, stream_profile.minimum_latency, stream_profile.maximum_latency))
+                logger.info("{: <15s} [Latency]: (Avg): {:.4f}ms, (Min): {:.4f}ms, (Max): {:.4f}ms, (P50): {:.4f}ms, (P99): {:.4f}ms, (P999): {:.4f}ms".format("",
+                       stream_profile.latency, stream_profile.minimum_latency, stream_profile.maximum_latency,
+                       stream_profile.latency_p50, stream_profile.latency_p99, stream_profile.latency_p999))
                 logger.info("{: <15s} [Throughput]: {:.4f}fps".format("", stream_profile.fps))
 
     def print_pipeline_perf(self, profile, prefix_str):
@@ -73,6 +76,39 @@ class PrintPerformance:
                                      "Last {:d} Seconds".format(duration//1000))
 
 
+class ProfileCounters:
+    """Keeps the flat profile counters of a pipeline up to date by the deltas of cnstream.ProfileSnapshotter,
+    so that polling a large pipeline converts only the changed counters."""
+    def __init__(self, pipeline):
+        # imported here as the path of cnstream is set up by the service
+        from cnstream import ProfileSnapshotter
+        self.snapshotter = ProfileSnapshotter(pipeline)
+        self.keys = []
+        self.indices = {}
+        self.values = []
+
+    def update(self):
+        """Returns the keys of the counters changed since the last update."""
+        delta = self.snapshotter.get_delta()
+        if delta.reset:
+            self.keys, self.indices, self.values = [], {}, []
+        for key in delta.new_keys:
+            self.indices[key] = len(self.keys)
+            self.keys.append(key)
+            self.values.append(0.0)
+        indices = delta.indices.tolist()
+        for index, value in zip(indices, delta.values.tolist()):
+            self.values[index] = value
+        return [self.keys[index] for index in indices]
+
+    def get(self, key, default=None):
+        index = self.indices.get(key)
+        return default if index is None else self.values[index]
+
+    def items(self):
+        return zip(self.keys, self.values)
+
+
 class PrintPerformanceLoop():
     def __init__(self, pipeline, perf_level=0):
         self.condition = threading.Condition()